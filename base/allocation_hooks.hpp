@@ -0,0 +1,46 @@
+#pragma once
+
+// Replaces the global operator new and delete of the binary with ones that
+// report the allocations and deallocations to the |AllocationTracker|.  The
+// other forms of operator new and delete call these ones.  Must be included in
+// exactly one translation unit of a binary.
+
+#include <cstdlib>
+#include <new>
+
+#include "base/allocation_tracker.hpp"
+
+namespace principia {
+namespace base {
+namespace internal {
+
+// Each block is preceded by a header which holds its size, so that operator
+// delete may report it.  The header is as large as the alignment of the blocks
+// returned by malloc, so that this alignment is preserved.
+std::size_t const kAllocationHeaderSize = 16;
+
+}  // namespace internal
+}  // namespace base
+}  // namespace principia
+
+void* operator new(std::size_t const size) {
+  using principia::base::internal::kAllocationHeaderSize;
+  principia::base::AllocationTracker::RecordAllocation(size);
+  void* const block = std::malloc(kAllocationHeaderSize + size);
+  if (block == nullptr) {
+    throw std::bad_alloc();
+  }
+  *static_cast<std::size_t*>(block) = size;
+  return static_cast<char*>(block) + kAllocationHeaderSize;
+}
+
+void operator delete(void* const pointer) throw() {
+  using principia::base::internal::kAllocationHeaderSize;
+  if (pointer == nullptr) {
+    return;
+  }
+  void* const block = static_cast<char*>(pointer) - kAllocationHeaderSize;
+  principia::base::AllocationTracker::RecordDeallocation(
+      *static_cast<std::size_t*>(block));
+  std::free(block);
+}
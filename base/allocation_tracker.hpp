@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace principia {
+namespace base {
+
+// The allocations made by the global operator new.
+struct AllocationCounts {
+  std::int64_t allocations = 0;
+  std::int64_t bytes = 0;
+};
+
+// Counts the allocations made by the global operator new on all threads.  The
+// counts only change in the binaries whose operator new reports to
+// |RecordAllocation|, i.e., which include base/allocation_hooks.hpp: the
+// benchmarks always do, and the plugin does when it is built with
+// |PRINCIPIA_TRACK_ALLOCATIONS| set to 1.  Elsewhere they remain 0.
+class AllocationTracker {
+ public:
+  AllocationTracker() = delete;
+
+  // Called by operator new for each allocation of |size| bytes.
+  static void RecordAllocation(std::size_t const size);
+
+  // Called by operator delete for each deallocation of a block of |size|
+  // bytes.
+  static void RecordDeallocation(std::size_t const size);
+
+  // The counts since the start of the program.
+  static AllocationCounts Total();
+
+  // The number of bytes currently allocated.
+  static std::int64_t LiveBytes();
+
+  // The largest number of bytes allocated at any time since the start of the
+  // program or the last call to |ResetPeakBytes|.
+  static std::int64_t PeakBytes();
+
+  // Sets the peak to the number of bytes currently allocated, so that the peak
+  // of a computation may be measured.
+  static void ResetPeakBytes();
+
+ private:
+  static std::atomic<std::int64_t>& allocations();
+  static std::atomic<std::int64_t>& bytes();
+  static std::atomic<std::int64_t>& live_bytes();
+  static std::atomic<std::int64_t>& peak_bytes();
+};
+
+// Counts the allocations made on all threads during the lifetime of this
+// object.  If |counts| is not null, the counts are added to it on destruction,
+// otherwise this object does nothing.  This makes it possible to count the
+// allocations of a scope conditionally.
+class ScopedAllocationCounter {
+ public:
+  explicit ScopedAllocationCounter(AllocationCounts* const counts);
+  ~ScopedAllocationCounter();
+
+  ScopedAllocationCounter(ScopedAllocationCounter const&) = delete;
+  ScopedAllocationCounter& operator=(ScopedAllocationCounter const&) = delete;
+
+ private:
+  AllocationCounts* const counts_;
+  AllocationCounts const start_;
+};
+
+}  // namespace base
+}  // namespace principia
+
+#include "base/allocation_tracker_body.hpp"
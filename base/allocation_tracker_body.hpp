@@ -0,0 +1,83 @@
+#pragma once
+
+#include "base/allocation_tracker.hpp"
+
+namespace principia {
+namespace base {
+
+inline void AllocationTracker::RecordAllocation(std::size_t const size) {
+  std::int64_t const signed_size = static_cast<std::int64_t>(size);
+  allocations().fetch_add(1, std::memory_order_relaxed);
+  bytes().fetch_add(signed_size, std::memory_order_relaxed);
+  std::int64_t const live =
+      live_bytes().fetch_add(signed_size, std::memory_order_relaxed) +
+      signed_size;
+  std::int64_t peak = peak_bytes().load(std::memory_order_relaxed);
+  while (live > peak &&
+         !peak_bytes().compare_exchange_weak(peak,
+                                             live,
+                                             std::memory_order_relaxed)) {
+  }
+}
+
+inline void AllocationTracker::RecordDeallocation(std::size_t const size) {
+  live_bytes().fetch_sub(static_cast<std::int64_t>(size),
+                         std::memory_order_relaxed);
+}
+
+inline AllocationCounts AllocationTracker::Total() {
+  AllocationCounts counts;
+  counts.allocations = allocations().load(std::memory_order_relaxed);
+  counts.bytes = bytes().load(std::memory_order_relaxed);
+  return counts;
+}
+
+inline std::int64_t AllocationTracker::LiveBytes() {
+  return live_bytes().load(std::memory_order_relaxed);
+}
+
+inline std::int64_t AllocationTracker::PeakBytes() {
+  return peak_bytes().load(std::memory_order_relaxed);
+}
+
+inline void AllocationTracker::ResetPeakBytes() {
+  peak_bytes().store(live_bytes().load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+}
+
+inline std::atomic<std::int64_t>& AllocationTracker::allocations() {
+  static std::atomic<std::int64_t> allocations(0);
+  return allocations;
+}
+
+inline std::atomic<std::int64_t>& AllocationTracker::bytes() {
+  static std::atomic<std::int64_t> bytes(0);
+  return bytes;
+}
+
+inline std::atomic<std::int64_t>& AllocationTracker::live_bytes() {
+  static std::atomic<std::int64_t> live_bytes(0);
+  return live_bytes;
+}
+
+inline std::atomic<std::int64_t>& AllocationTracker::peak_bytes() {
+  static std::atomic<std::int64_t> peak_bytes(0);
+  return peak_bytes;
+}
+
+inline ScopedAllocationCounter::ScopedAllocationCounter(
+    AllocationCounts* const counts)
+    : counts_(counts),
+      start_(counts == nullptr ? AllocationCounts()
+                               : AllocationTracker::Total()) {}
+
+inline ScopedAllocationCounter::~ScopedAllocationCounter() {
+  if (counts_ != nullptr) {
+    AllocationCounts const end = AllocationTracker::Total();
+    counts_->allocations += end.allocations - start_.allocations;
+    counts_->bytes += end.bytes - start_.bytes;
+  }
+}
+
+}  // namespace base
+}  // namespace principia
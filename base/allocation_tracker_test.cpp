@@ -0,0 +1,65 @@
+#include "base/allocation_tracker.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "base/allocation_hooks.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Eq;
+
+namespace principia {
+namespace base {
+
+TEST(AllocationTrackerTest, Total) {
+  AllocationCounts const before = AllocationTracker::Total();
+  // A new-expression could be elided, a call to operator new may not.
+  void* const block = ::operator new(1000);
+  AllocationCounts const after = AllocationTracker::Total();
+  ::operator delete(block);
+  EXPECT_THAT(after.allocations - before.allocations, Eq(1));
+  EXPECT_THAT(after.bytes - before.bytes, Eq(1000));
+}
+
+TEST(AllocationTrackerTest, PeakBytes) {
+  AllocationTracker::ResetPeakBytes();
+  std::int64_t const before = AllocationTracker::LiveBytes();
+  EXPECT_THAT(AllocationTracker::PeakBytes(), Eq(before));
+  void* const block1 = ::operator new(1000);
+  void* const block2 = ::operator new(500);
+  EXPECT_THAT(AllocationTracker::LiveBytes() - before, Eq(1500));
+  ::operator delete(block1);
+  void* const block3 = ::operator new(200);
+  ::operator delete(block2);
+  ::operator delete(block3);
+  EXPECT_THAT(AllocationTracker::LiveBytes(), Eq(before));
+  EXPECT_THAT(AllocationTracker::PeakBytes() - before, Eq(1500));
+  AllocationTracker::ResetPeakBytes();
+  EXPECT_THAT(AllocationTracker::PeakBytes(), Eq(before));
+}
+
+TEST(AllocationTrackerTest, ScopedCounter) {
+  std::vector<std::unique_ptr<std::vector<double>>> vectors;
+  vectors.reserve(2);
+  AllocationCounts counts;
+  for (int i = 0; i < 2; ++i) {
+    ScopedAllocationCounter const counter(&counts);
+    vectors.push_back(std::make_unique<std::vector<double>>(10));
+  }
+  EXPECT_THAT(counts.allocations, Eq(4));
+  EXPECT_THAT(counts.bytes,
+              Eq(2 * static_cast<std::int64_t>(sizeof(std::vector<double>) +
+                                               10 * sizeof(double))));
+
+  // A counter without counts does nothing.
+  {
+    ScopedAllocationCounter const counter(nullptr);
+    vectors.push_back(std::make_unique<std::vector<double>>(10));
+  }
+  EXPECT_THAT(counts.allocations, Eq(4));
+}
+
+}  // namespace base
+}  // namespace principia
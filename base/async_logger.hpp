@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/not_null.hpp"
+#include "glog/logging.h"
+
+namespace principia {
+namespace base {
+
+// A glog logger which forwards the messages to a |wrapped| logger on a
+// background thread, so that the thread that logs does not wait for the file
+// I/O.  The messages are copied into a byte ring buffer of fixed capacity.
+// glog calls |Write| with its log mutex held, so there is a single producer at
+// any time and enqueuing does not take any lock.  The producer only waits if
+// the ring buffer is full, and when glog asks for the message to be flushed,
+// e.g., for messages above |FLAGS_logbuflevel|, in which case |Write| returns
+// once the message has been written by |wrapped|.  This ensures that a FATAL
+// message reaches the file before the process aborts.
+// Note that this only makes the file output asynchronous: the formatting of
+// the message is done by glog on the calling thread, and the messages logged
+// to stderr are written synchronously by glog.
+class AsyncLogger : public google::base::Logger {
+ public:
+  // |wrapped| must outlive this object.  |capacity| is the size of the ring
+  // buffer in bytes.  A message that doesn't fit in the ring buffer is written
+  // synchronously.
+  AsyncLogger(not_null<google::base::Logger*> const wrapped,
+              std::int64_t const capacity);
+
+  // Writes the pending messages and joins the background thread.
+  ~AsyncLogger() override;
+
+  AsyncLogger(AsyncLogger const&) = delete;
+  AsyncLogger& operator=(AsyncLogger const&) = delete;
+
+  // Must not be called concurrently, see above.
+  void Write(bool force_flush,
+             time_t timestamp,
+             char const* message,
+             int message_len) override;
+
+  // Waits until the pending messages have been written, and flushes
+  // |wrapped|.
+  void Flush() override;
+
+  google::uint32 LogSize() override;
+
+  not_null<google::base::Logger*> wrapped() const;
+
+ private:
+  // The header preceding each message in the ring buffer.
+  struct Header {
+    time_t timestamp;
+    int message_len;
+    bool force_flush;
+  };
+
+  // Copies |size| bytes between |data| and the ring buffer at the (unwrapped)
+  // byte |position|.
+  void CopyIn(std::int64_t const position,
+              void const* const data,
+              std::int64_t const size);
+  void CopyOut(std::int64_t const position,
+               void* const data,
+               std::int64_t const size) const;
+
+  // Returns once the background thread has written everything up to the
+  // (unwrapped) byte |position|.
+  void WaitUntilWritten(std::int64_t const position);
+
+  // The body of the background thread.
+  void WriteMessages();
+
+  not_null<google::base::Logger*> const wrapped_;
+  std::vector<char> buffer_;
+
+  // The number of bytes ever enqueued and ever written, respectively.  Only
+  // |head_| is modified by the producer and only |tail_| by the background
+  // thread.
+  std::atomic<std::int64_t> head_;
+  std::atomic<std::int64_t> tail_;
+  std::atomic<bool> shutdown_;
+
+  // Only used by the background thread to sleep while there is nothing to
+  // write.  The producer never takes |lock_|.
+  std::mutex lock_;
+  std::condition_variable has_messages_;
+
+  std::thread writer_;
+};
+
+}  // namespace base
+}  // namespace principia
+
+#include "base/async_logger_body.hpp"
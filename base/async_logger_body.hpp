@@ -0,0 +1,130 @@
+#pragma once
+
+#include "base/async_logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace principia {
+namespace base {
+
+inline AsyncLogger::AsyncLogger(not_null<google::base::Logger*> const wrapped,
+                                std::int64_t const capacity)
+    : wrapped_(wrapped),
+      buffer_(capacity),
+      head_(0),
+      tail_(0),
+      shutdown_(false) {
+  CHECK_LT(static_cast<std::int64_t>(sizeof(Header)), capacity);
+  writer_ = std::thread(&AsyncLogger::WriteMessages, this);
+}
+
+inline AsyncLogger::~AsyncLogger() {
+  shutdown_ = true;
+  has_messages_.notify_one();
+  writer_.join();
+}
+
+inline void AsyncLogger::Write(bool force_flush,
+                               time_t timestamp,
+                               char const* message,
+                               int message_len) {
+  std::int64_t const capacity = buffer_.size();
+  std::int64_t const head = head_.load(std::memory_order_relaxed);
+  std::int64_t const size = sizeof(Header) + message_len;
+  if (size > capacity) {
+    // Preserve the order of the messages.
+    WaitUntilWritten(head);
+    wrapped_->Write(force_flush, timestamp, message, message_len);
+    return;
+  }
+  while (capacity - (head - tail_.load(std::memory_order_acquire)) < size) {
+    has_messages_.notify_one();
+    std::this_thread::yield();
+  }
+  Header const header = {timestamp, message_len, force_flush};
+  CopyIn(head, &header, sizeof(Header));
+  CopyIn(head + sizeof(Header), message, message_len);
+  head_.store(head + size, std::memory_order_release);
+  if (force_flush) {
+    WaitUntilWritten(head + size);
+  }
+}
+
+inline void AsyncLogger::Flush() {
+  WaitUntilWritten(head_.load(std::memory_order_relaxed));
+  wrapped_->Flush();
+}
+
+inline google::uint32 AsyncLogger::LogSize() {
+  return wrapped_->LogSize();
+}
+
+inline not_null<google::base::Logger*> AsyncLogger::wrapped() const {
+  return wrapped_;
+}
+
+inline void AsyncLogger::CopyIn(std::int64_t const position,
+                                void const* const data,
+                                std::int64_t const size) {
+  std::int64_t const capacity = buffer_.size();
+  std::int64_t const offset = position % capacity;
+  std::int64_t const first_part = std::min(size, capacity - offset);
+  char const* const bytes = static_cast<char const*>(data);
+  std::memcpy(&buffer_[offset], bytes, first_part);
+  std::memcpy(&buffer_[0], bytes + first_part, size - first_part);
+}
+
+inline void AsyncLogger::CopyOut(std::int64_t const position,
+                                 void* const data,
+                                 std::int64_t const size) const {
+  std::int64_t const capacity = buffer_.size();
+  std::int64_t const offset = position % capacity;
+  std::int64_t const first_part = std::min(size, capacity - offset);
+  char* const bytes = static_cast<char*>(data);
+  std::memcpy(bytes, &buffer_[offset], first_part);
+  std::memcpy(bytes + first_part, &buffer_[0], size - first_part);
+}
+
+inline void AsyncLogger::WaitUntilWritten(std::int64_t const position) {
+  while (tail_.load(std::memory_order_acquire) < position) {
+    has_messages_.notify_one();
+    std::this_thread::yield();
+  }
+}
+
+inline void AsyncLogger::WriteMessages() {
+  std::string message;
+  for (;;) {
+    // Read |shutdown_| first, so that we don't miss the last messages.
+    bool const shutdown = shutdown_;
+    std::int64_t tail = tail_.load(std::memory_order_relaxed);
+    std::int64_t const head = head_.load(std::memory_order_acquire);
+    if (tail == head) {
+      if (shutdown) {
+        return;
+      }
+      // The producer doesn't take |lock_| so it may notify while we are not
+      // waiting; the timeout bounds the latency in that case.
+      std::unique_lock<std::mutex> l(lock_);
+      has_messages_.wait_for(l, std::chrono::milliseconds(10));
+      continue;
+    }
+    while (tail < head) {
+      Header header;
+      CopyOut(tail, &header, sizeof(Header));
+      message.resize(header.message_len);
+      CopyOut(tail + sizeof(Header), &message[0], header.message_len);
+      wrapped_->Write(header.force_flush,
+                      header.timestamp,
+                      message.data(),
+                      header.message_len);
+      tail += sizeof(Header) + header.message_len;
+      tail_.store(tail, std::memory_order_release);
+    }
+  }
+}
+
+}  // namespace base
+}  // namespace principia
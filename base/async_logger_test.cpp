@@ -0,0 +1,148 @@
+#include "base/async_logger.hpp"
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::ElementsAre;
+using testing::Eq;
+using testing::SizeIs;
+
+namespace principia {
+namespace base {
+
+namespace {
+
+// A logger that remembers the messages written to it.
+class RecordingLogger : public google::base::Logger {
+ public:
+  void Write(bool force_flush,
+             time_t timestamp,
+             char const* message,
+             int message_len) override {
+    std::lock_guard<std::mutex> l(lock_);
+    messages_.emplace_back(message, message_len);
+    timestamps_.push_back(timestamp);
+    force_flushes_.push_back(force_flush);
+  }
+
+  void Flush() override {
+    std::lock_guard<std::mutex> l(lock_);
+    ++flushes_;
+  }
+
+  google::uint32 LogSize() override {
+    return 42;
+  }
+
+  std::vector<std::string> messages() {
+    std::lock_guard<std::mutex> l(lock_);
+    return messages_;
+  }
+
+  std::vector<time_t> timestamps() {
+    std::lock_guard<std::mutex> l(lock_);
+    return timestamps_;
+  }
+
+  std::vector<bool> force_flushes() {
+    std::lock_guard<std::mutex> l(lock_);
+    return force_flushes_;
+  }
+
+  int flushes() {
+    std::lock_guard<std::mutex> l(lock_);
+    return flushes_;
+  }
+
+ private:
+  std::mutex lock_;
+  std::vector<std::string> messages_;
+  std::vector<time_t> timestamps_;
+  std::vector<bool> force_flushes_;
+  int flushes_ = 0;
+};
+
+}  // namespace
+
+class AsyncLoggerTest : public testing::Test {
+ protected:
+  void Write(not_null<AsyncLogger*> const logger,
+             std::string const& message,
+             bool const force_flush = false) {
+    logger->Write(force_flush, 1729, message.data(), message.size());
+  }
+
+  RecordingLogger recording_logger_;
+};
+
+TEST_F(AsyncLoggerTest, Destruction) {
+  {
+    AsyncLogger logger(&recording_logger_, 1000);
+    Write(&logger, "a");
+    Write(&logger, "bc");
+    Write(&logger, "");
+    EXPECT_THAT(logger.LogSize(), Eq(42));
+    EXPECT_THAT(logger.wrapped(), Eq(&recording_logger_));
+  }
+  EXPECT_THAT(recording_logger_.messages(), ElementsAre("a", "bc", ""));
+  EXPECT_THAT(recording_logger_.timestamps(), ElementsAre(1729, 1729, 1729));
+}
+
+TEST_F(AsyncLoggerTest, ForceFlush) {
+  AsyncLogger logger(&recording_logger_, 1000);
+  Write(&logger, "buffered");
+  Write(&logger, "fatal", /*force_flush=*/true);
+  EXPECT_THAT(recording_logger_.messages(), ElementsAre("buffered", "fatal"));
+  EXPECT_THAT(recording_logger_.force_flushes(), ElementsAre(false, true));
+  Write(&logger, "flushed");
+  logger.Flush();
+  EXPECT_THAT(recording_logger_.messages(), SizeIs(3));
+  EXPECT_THAT(recording_logger_.flushes(), Eq(1));
+}
+
+// A small ring buffer exercises the wrap around and the waiting for space, and
+// a message larger than the buffer is written synchronously.
+TEST_F(AsyncLoggerTest, WrapAround) {
+  std::vector<std::string> expected_messages;
+  {
+    AsyncLogger logger(&recording_logger_, 100);
+    for (int i = 0; i < 1000; ++i) {
+      expected_messages.push_back(std::string(i % 50, 'a' + i % 26));
+      Write(&logger, expected_messages.back());
+    }
+    expected_messages.push_back(std::string(1000, 'z'));
+    Write(&logger, expected_messages.back());
+    expected_messages.push_back("last");
+    Write(&logger, expected_messages.back());
+  }
+  EXPECT_THAT(recording_logger_.messages(), Eq(expected_messages));
+}
+
+// glog serializes the calls to |Write|, but they may come from any thread.
+TEST_F(AsyncLoggerTest, Threads) {
+  std::mutex glog_lock;
+  {
+    AsyncLogger logger(&recording_logger_, 1000);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([this, &glog_lock, &logger]() {
+        for (int i = 0; i < 1000; ++i) {
+          std::lock_guard<std::mutex> l(glog_lock);
+          Write(&logger, "message");
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  EXPECT_THAT(recording_logger_.messages(), SizeIs(4000));
+}
+
+}  // namespace base
+}  // namespace principia
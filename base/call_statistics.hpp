@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base/not_null.hpp"
+
+namespace principia {
+namespace base {
+
+// A histogram of nonnegative integer values, e.g., latencies in nanoseconds,
+// in the style of HdrHistogram: the values below 2^|kSubBucketBits| have a
+// bucket each, and each interval [2^e, 2^(e + 1)[ above is split in
+// 2^|kSubBucketBits| buckets of equal width, so that the values are recorded
+// with a relative precision of 2^-|kSubBucketBits| whatever their magnitude,
+// in constant space and time.
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+
+  // |value| must be nonnegative.
+  void Record(std::int64_t const value);
+
+  std::int64_t count() const;
+  std::int64_t total() const;
+  std::int64_t maximum() const;
+
+  // Returns the largest value of the bucket containing the value below which
+  // |percentile| percent of the recorded values fall, but at most |maximum()|.
+  // |percentile| must be in [0, 100].  Returns 0 if no value was recorded.
+  std::int64_t ValueAtPercentile(double const percentile) const;
+
+  static int const kSubBucketBits = 3;
+
+ private:
+  static int BucketIndex(std::int64_t const value);
+  static std::int64_t BucketMaximum(int const index);
+
+  std::vector<std::int64_t> counts_;
+  std::int64_t count_ = 0;
+  std::int64_t total_ = 0;
+  std::int64_t maximum_ = 0;
+};
+
+// The number of calls to functions and the histograms of their durations.
+// Meant for instrumenting the functions called by another process, e.g., the
+// C interface called by the game, to find out which ones dominate.
+class CallStatistics {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // The statistics are initially disabled.
+  CallStatistics();
+
+  CallStatistics(CallStatistics const&) = delete;
+  CallStatistics& operator=(CallStatistics const&) = delete;
+
+  // Clears the statistics and enables them.
+  void Start();
+  // Disables the statistics, which are kept.
+  void Stop();
+
+  // An atomic load, so that the instrumented functions may check it on every
+  // call.
+  bool enabled() const;
+
+  // Records a call of |duration| to the function |name|.  |name| must have
+  // static storage duration, the calls are grouped by its address.  Does
+  // nothing if the statistics are disabled.
+  void Record(char const* const name, Clock::duration const& duration);
+
+  // The statistics of the function |name|, or null if it wasn't called.  The
+  // result is valid until the next call to |Start|.
+  LatencyHistogram const* histogram(char const* const name) const;
+
+  // A table of the number of calls to each function, and of the total, mean,
+  // median, 90th and 99th percentile, and maximum durations of the calls, in
+  // microseconds, by decreasing total duration.
+  std::string Summary() const;
+
+  // The statistics used by |ScopedCallTimer| by default.
+  static not_null<CallStatistics*> Global();
+
+ private:
+  std::atomic<bool> enabled_;
+
+  mutable std::mutex lock_;
+  // The durations in nanoseconds.
+  std::map<char const*, LatencyHistogram> histograms_;  // Guarded by |lock_|.
+};
+
+// Records a call spanning the lifetime of this object, if the statistics are
+// enabled when the object is constructed.  Typical usage is:
+//   ScopedCallTimer const call_timer(__FUNCTION__);
+class ScopedCallTimer {
+ public:
+  // Records the call in |CallStatistics::Global()|.  |name| must have static
+  // storage duration.
+  explicit ScopedCallTimer(char const* const name);
+  ScopedCallTimer(char const* const name,
+                  not_null<CallStatistics*> const statistics);
+  ~ScopedCallTimer();
+
+  ScopedCallTimer(ScopedCallTimer const&) = delete;
+  ScopedCallTimer& operator=(ScopedCallTimer const&) = delete;
+
+ private:
+  char const* const name_;
+  CallStatistics* const statistics_;  // Null if the statistics were disabled.
+  CallStatistics::Clock::time_point begin_;
+};
+
+}  // namespace base
+}  // namespace principia
+
+#include "base/call_statistics_body.hpp"
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "base/call_statistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace base {
+
+namespace {
+
+// The number of buckets needed for all the nonnegative 64-bit values.
+int const kLatencyHistogramBuckets =
+    (64 - LatencyHistogram::kSubBucketBits) *
+    (1 << LatencyHistogram::kSubBucketBits);
+
+}  // namespace
+
+inline LatencyHistogram::LatencyHistogram()
+    : counts_(kLatencyHistogramBuckets, 0) {}
+
+inline void LatencyHistogram::Record(std::int64_t const value) {
+  CHECK_LE(0, value);
+  ++counts_[BucketIndex(value)];
+  ++count_;
+  total_ += value;
+  maximum_ = std::max(maximum_, value);
+}
+
+inline std::int64_t LatencyHistogram::count() const {
+  return count_;
+}
+
+inline std::int64_t LatencyHistogram::total() const {
+  return total_;
+}
+
+inline std::int64_t LatencyHistogram::maximum() const {
+  return maximum_;
+}
+
+inline std::int64_t LatencyHistogram::ValueAtPercentile(
+    double const percentile) const {
+  CHECK_LE(0, percentile);
+  CHECK_LE(percentile, 100);
+  if (count_ == 0) {
+    return 0;
+  }
+  // The rank of the value, counting from 1.
+  std::int64_t const rank = std::max<std::int64_t>(
+      1, static_cast<std::int64_t>(std::ceil(percentile / 100 * count_)));
+  std::int64_t cumulated = 0;
+  for (int i = 0; i < kLatencyHistogramBuckets; ++i) {
+    cumulated += counts_[i];
+    if (cumulated >= rank) {
+      return std::min(BucketMaximum(i), maximum_);
+    }
+  }
+  return maximum_;
+}
+
+inline int LatencyHistogram::BucketIndex(std::int64_t const value) {
+  int const sub_buckets = 1 << kSubBucketBits;
+  if (value < sub_buckets) {
+    return static_cast<int>(value);
+  }
+  // The shift which brings |value| into [sub_buckets, 2 * sub_buckets[.
+  int shift = 0;
+  while ((value >> shift) >= 2 * sub_buckets) {
+    ++shift;
+  }
+  // The |kSubBucketBits| bits following the leading one.
+  int const sub_bucket = static_cast<int>(value >> shift) - sub_buckets;
+  return sub_buckets * (shift + 1) + sub_bucket;
+}
+
+inline std::int64_t LatencyHistogram::BucketMaximum(int const index) {
+  int const sub_buckets = 1 << kSubBucketBits;
+  if (index < sub_buckets) {
+    return index;
+  }
+  int const shift = index / sub_buckets - 1;
+  std::int64_t const sub_bucket = index % sub_buckets;
+  std::int64_t const width = static_cast<std::int64_t>(1) << shift;
+  // Written so as not to overflow for the last bucket.
+  return ((sub_buckets + sub_bucket) << shift) + (width - 1);
+}
+
+inline CallStatistics::CallStatistics() : enabled_(false) {}
+
+inline void CallStatistics::Start() {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    histograms_.clear();
+  }
+  enabled_ = true;
+}
+
+inline void CallStatistics::Stop() {
+  enabled_ = false;
+}
+
+inline bool CallStatistics::enabled() const {
+  return enabled_;
+}
+
+inline void CallStatistics::Record(char const* const name,
+                                   Clock::duration const& duration) {
+  if (!enabled_) {
+    return;
+  }
+  std::int64_t const nanoseconds =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  std::lock_guard<std::mutex> l(lock_);
+  histograms_[name].Record(std::max<std::int64_t>(0, nanoseconds));
+}
+
+inline LatencyHistogram const* CallStatistics::histogram(
+    char const* const name) const {
+  std::lock_guard<std::mutex> l(lock_);
+  auto const it = histograms_.find(name);
+  return it == histograms_.end() ? nullptr : &it->second;
+}
+
+inline std::string CallStatistics::Summary() const {
+  std::vector<std::pair<char const*, LatencyHistogram>> histograms;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    histograms.assign(histograms_.begin(), histograms_.end());
+  }
+  std::sort(histograms.begin(),
+            histograms.end(),
+            [](std::pair<char const*, LatencyHistogram> const& left,
+               std::pair<char const*, LatencyHistogram> const& right) {
+              return left.second.total() > right.second.total();
+            });
+  auto const microseconds = [](std::int64_t const nanoseconds) {
+    return nanoseconds / 1000.0;
+  };
+  std::stringstream summary;
+  summary << std::fixed << std::setprecision(1)
+          << "function calls total mean p50 p90 p99 max (us)\n";
+  for (auto const& pair : histograms) {
+    LatencyHistogram const& histogram = pair.second;
+    summary << pair.first << " " << histogram.count() << " "
+            << microseconds(histogram.total()) << " "
+            << microseconds(histogram.total()) / histogram.count() << " "
+            << microseconds(histogram.ValueAtPercentile(50)) << " "
+            << microseconds(histogram.ValueAtPercentile(90)) << " "
+            << microseconds(histogram.ValueAtPercentile(99)) << " "
+            << microseconds(histogram.maximum()) << "\n";
+  }
+  return summary.str();
+}
+
+inline not_null<CallStatistics*> CallStatistics::Global() {
+  static CallStatistics* const statistics = new CallStatistics;
+  return statistics;
+}
+
+inline ScopedCallTimer::ScopedCallTimer(char const* const name)
+    : ScopedCallTimer(name, CallStatistics::Global()) {}
+
+inline ScopedCallTimer::ScopedCallTimer(
+    char const* const name,
+    not_null<CallStatistics*> const statistics)
+    : name_(name),
+      statistics_(statistics->enabled()
+                      ? static_cast<CallStatistics*>(statistics)
+                      : nullptr) {
+  if (statistics_ != nullptr) {
+    begin_ = CallStatistics::Clock::now();
+  }
+}
+
+inline ScopedCallTimer::~ScopedCallTimer() {
+  if (statistics_ != nullptr) {
+    statistics_->Record(name_, CallStatistics::Clock::now() - begin_);
+  }
+}
+
+}  // namespace base
+}  // namespace principia
@@ -0,0 +1,110 @@
+#include "base/call_statistics.hpp"
+
+#include <chrono>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Eq;
+using testing::Ge;
+using testing::HasSubstr;
+using testing::IsNull;
+using testing::Le;
+using testing::NotNull;
+
+namespace principia {
+namespace base {
+
+TEST(LatencyHistogramTest, Empty) {
+  LatencyHistogram const histogram;
+  EXPECT_THAT(histogram.count(), Eq(0));
+  EXPECT_THAT(histogram.total(), Eq(0));
+  EXPECT_THAT(histogram.maximum(), Eq(0));
+  EXPECT_THAT(histogram.ValueAtPercentile(50), Eq(0));
+}
+
+// The small values are exact, and the large ones are within the precision of
+// the buckets.
+TEST(LatencyHistogramTest, Percentiles) {
+  LatencyHistogram histogram;
+  for (std::int64_t value = 1; value <= 1000; ++value) {
+    histogram.Record(value);
+  }
+  EXPECT_THAT(histogram.count(), Eq(1000));
+  EXPECT_THAT(histogram.total(), Eq(500500));
+  EXPECT_THAT(histogram.maximum(), Eq(1000));
+  EXPECT_THAT(histogram.ValueAtPercentile(0.5), Eq(5));
+  double const precision = 1.0 / (1 << LatencyHistogram::kSubBucketBits);
+  for (double const percentile : {50.0, 90.0, 99.0}) {
+    std::int64_t const exact = static_cast<std::int64_t>(percentile * 10);
+    EXPECT_THAT(histogram.ValueAtPercentile(percentile), Ge(exact));
+    EXPECT_THAT(histogram.ValueAtPercentile(percentile),
+                Le(exact * (1 + precision)));
+  }
+  EXPECT_THAT(histogram.ValueAtPercentile(100), Eq(1000));
+
+  // The largest values have a bucket too.
+  LatencyHistogram large;
+  large.Record(std::numeric_limits<std::int64_t>::max());
+  EXPECT_THAT(large.ValueAtPercentile(100),
+              Eq(std::numeric_limits<std::int64_t>::max()));
+}
+
+TEST(CallStatisticsTest, Disabled) {
+  CallStatistics statistics;
+  EXPECT_FALSE(statistics.enabled());
+  {
+    ScopedCallTimer const call_timer("Disabled", &statistics);
+  }
+  EXPECT_THAT(statistics.histogram("Disabled"), IsNull());
+}
+
+TEST(CallStatisticsTest, Calls) {
+  CallStatistics statistics;
+  statistics.Start();
+  EXPECT_TRUE(statistics.enabled());
+  char const* const fast = "Fast";
+  char const* const slow = "Slow";
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&statistics, fast]() {
+      for (int i = 0; i < 100; ++i) {
+        ScopedCallTimer const call_timer(fast, &statistics);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  {
+    ScopedCallTimer const call_timer(slow, &statistics);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_THAT(statistics.histogram(fast), NotNull());
+  EXPECT_THAT(statistics.histogram(fast)->count(), Eq(400));
+  ASSERT_THAT(statistics.histogram(slow), NotNull());
+  EXPECT_THAT(statistics.histogram(slow)->count(), Eq(1));
+  EXPECT_THAT(statistics.histogram(slow)->maximum(), Ge(10000000));
+
+  // The slowest function comes first.
+  std::string const summary = statistics.Summary();
+  EXPECT_THAT(summary, HasSubstr("Slow 1 "));
+  EXPECT_THAT(summary, HasSubstr("Fast 400 "));
+  EXPECT_THAT(summary.find("Slow"), Le(summary.find("Fast")));
+
+  // Stopping keeps the statistics, starting clears them.
+  statistics.Stop();
+  {
+    ScopedCallTimer const call_timer(slow, &statistics);
+  }
+  EXPECT_THAT(statistics.histogram(slow)->count(), Eq(1));
+  statistics.Start();
+  EXPECT_THAT(statistics.histogram(slow), IsNull());
+}
+
+}  // namespace base
+}  // namespace principia
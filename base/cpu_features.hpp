@@ -0,0 +1,47 @@
+#pragma once
+
+namespace principia {
+namespace base {
+
+// The vector instruction sets that the processor supports and that the
+// operating system has enabled, i.e., that saves their registers on context
+// switches.
+struct CPUFeatures {
+  bool avx = false;
+  bool avx512f = false;
+};
+
+// Queries the processor with CPUID on the first call and returns the cached
+// result afterwards.  The first call is not thread-safe on compilers that
+// don't guarantee the thread-safe initialization of function-local statics
+// (Visual C++ 2013), so it must be made before any concurrent use, e.g., when
+// initializing logging or when constructing the plugin.
+CPUFeatures const& DetectedCPUFeatures();
+
+// The vector instruction sets used by the kernels, in increasing order of
+// width.
+enum class VectorInstructionSet {
+  kNone = 0,
+  kAVX = 1,
+  kAVX512F = 2,
+};
+
+// Restricts the kernels to the instruction sets up to |maximum|, e.g., because
+// the narrower vectors turn out to be faster on a processor that lowers its
+// frequency when executing wide vector instructions.  |kAVX512F|, the default,
+// means no restriction.  May be called concurrently with the kernels, which
+// pick up the new value on their next call.
+void SetMaximumVectorInstructionSet(VectorInstructionSet const maximum);
+VectorInstructionSet MaximumVectorInstructionSet();
+
+// Whether the kernels for the given instruction set may be used.  False if the
+// instruction set exceeds |MaximumVectorInstructionSet|.  Otherwise true if
+// the compiler was allowed to use the instruction set, and determined by
+// |DetectedCPUFeatures| if it wasn't.
+bool UseAVX();
+bool UseAVX512F();
+
+}  // namespace base
+}  // namespace principia
+
+#include "base/cpu_features_body.hpp"
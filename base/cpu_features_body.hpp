@@ -0,0 +1,154 @@
+#pragma once
+
+#include "base/cpu_features.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+#include "base/macros.hpp"
+
+#if ARCH_CPU_X86_FAMILY
+#if PRINCIPIA_COMPILER_MSVC
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace principia {
+namespace base {
+
+namespace internal {
+
+#if ARCH_CPU_X86_FAMILY
+
+// The registers returned by CPUID for the given |leaf| and |subleaf|.
+struct CPUIDRegisters {
+  std::uint32_t eax;
+  std::uint32_t ebx;
+  std::uint32_t ecx;
+  std::uint32_t edx;
+};
+
+inline CPUIDRegisters CPUID(std::uint32_t const leaf,
+                            std::uint32_t const subleaf) {
+  CPUIDRegisters result;
+#if PRINCIPIA_COMPILER_MSVC
+  int registers[4];
+  __cpuidex(registers, leaf, subleaf);
+  result.eax = registers[0];
+  result.ebx = registers[1];
+  result.ecx = registers[2];
+  result.edx = registers[3];
+#else
+  __cpuid_count(leaf, subleaf, result.eax, result.ebx, result.ecx, result.edx);
+#endif
+  return result;
+}
+
+// The extended control register XCR0, which tells which register states the
+// operating system saves.  Must only be called if OSXSAVE is set.
+inline std::uint64_t XGETBV0() {
+#if PRINCIPIA_COMPILER_MSVC
+  return _xgetbv(0);
+#else
+  std::uint32_t eax;
+  std::uint32_t edx;
+  __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<std::uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+inline CPUFeatures QueryCPUFeatures() {
+  // Bits of CPUID leaf 1, register ECX.
+  std::uint32_t const kOSXSAVE = 1u << 27;
+  std::uint32_t const kAVX = 1u << 28;
+  // Bit of CPUID leaf 7, subleaf 0, register EBX.
+  std::uint32_t const kAVX512F = 1u << 16;
+  // The XCR0 states: SSE and AVX registers, and, for AVX-512, the opmask and
+  // the upper halves of ZMM0-15 and ZMM16-31.
+  std::uint64_t const kAVXState = 0x06;
+  std::uint64_t const kAVX512State = 0xE6;
+
+  CPUFeatures features;
+  std::uint32_t const max_leaf = CPUID(0, 0).eax;
+  if (max_leaf < 1) {
+    return features;
+  }
+  std::uint32_t const leaf_1_ecx = CPUID(1, 0).ecx;
+  if ((leaf_1_ecx & kOSXSAVE) == 0) {
+    return features;
+  }
+  std::uint64_t const xcr0 = XGETBV0();
+  features.avx = (leaf_1_ecx & kAVX) != 0 && (xcr0 & kAVXState) == kAVXState;
+  if (max_leaf >= 7) {
+    std::uint32_t const leaf_7_ebx = CPUID(7, 0).ebx;
+    features.avx512f = features.avx &&
+                       (leaf_7_ebx & kAVX512F) != 0 &&
+                       (xcr0 & kAVX512State) == kAVX512State;
+  }
+  return features;
+}
+
+#else
+
+inline CPUFeatures QueryCPUFeatures() {
+  return CPUFeatures();
+}
+
+#endif
+
+// The value set by |SetMaximumVectorInstructionSet|.
+inline std::atomic<int>& MaximumVectorInstructionSetStorage() {
+  static std::atomic<int> maximum(
+      static_cast<int>(VectorInstructionSet::kAVX512F));
+  return maximum;
+}
+
+inline bool IsAllowed(VectorInstructionSet const instruction_set) {
+  return MaximumVectorInstructionSetStorage().load(std::memory_order_relaxed) >=
+         static_cast<int>(instruction_set);
+}
+
+}  // namespace internal
+
+inline CPUFeatures const& DetectedCPUFeatures() {
+  // Also initializes the other static, for the benefit of the compilers that
+  // don't initialize them in a thread-safe manner.
+  internal::MaximumVectorInstructionSetStorage();
+  static CPUFeatures const features = internal::QueryCPUFeatures();
+  return features;
+}
+
+inline void SetMaximumVectorInstructionSet(
+    VectorInstructionSet const maximum) {
+  internal::MaximumVectorInstructionSetStorage().store(
+      static_cast<int>(maximum), std::memory_order_relaxed);
+}
+
+inline VectorInstructionSet MaximumVectorInstructionSet() {
+  return static_cast<VectorInstructionSet>(
+      internal::MaximumVectorInstructionSetStorage().load(
+          std::memory_order_relaxed));
+}
+
+inline bool UseAVX() {
+#if PRINCIPIA_USE_AVX
+  bool const supported = true;
+#else
+  bool const supported = DetectedCPUFeatures().avx;
+#endif
+  return supported && internal::IsAllowed(VectorInstructionSet::kAVX);
+}
+
+inline bool UseAVX512F() {
+#if PRINCIPIA_USE_AVX512F
+  bool const supported = true;
+#else
+  bool const supported = DetectedCPUFeatures().avx512f;
+#endif
+  return supported && internal::IsAllowed(VectorInstructionSet::kAVX512F);
+}
+
+}  // namespace base
+}  // namespace principia
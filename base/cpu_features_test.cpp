@@ -0,0 +1,54 @@
+#include "base/cpu_features.hpp"
+
+#include "base/macros.hpp"
+#include "gtest/gtest.h"
+
+namespace principia {
+namespace base {
+
+class CPUFeaturesTest : public testing::Test {};
+
+TEST_F(CPUFeaturesTest, Consistency) {
+  CPUFeatures const& features = DetectedCPUFeatures();
+  // The result is cached.
+  EXPECT_EQ(&features, &DetectedCPUFeatures());
+  // AVX-512F implies AVX.
+  EXPECT_TRUE(!features.avx512f || features.avx);
+#if PRINCIPIA_USE_AVX
+  // A binary compiled for AVX couldn't run here otherwise.
+  EXPECT_TRUE(features.avx);
+  EXPECT_TRUE(UseAVX());
+#else
+  EXPECT_EQ(features.avx, UseAVX());
+#endif
+#if PRINCIPIA_USE_AVX512F
+  EXPECT_TRUE(features.avx512f);
+  EXPECT_TRUE(UseAVX512F());
+#else
+  EXPECT_EQ(features.avx512f, UseAVX512F());
+#endif
+}
+
+TEST_F(CPUFeaturesTest, MaximumVectorInstructionSet) {
+  CPUFeatures const& features = DetectedCPUFeatures();
+  EXPECT_EQ(VectorInstructionSet::kAVX512F, MaximumVectorInstructionSet());
+  bool const use_avx = UseAVX();
+
+  SetMaximumVectorInstructionSet(VectorInstructionSet::kAVX);
+  EXPECT_EQ(VectorInstructionSet::kAVX, MaximumVectorInstructionSet());
+  EXPECT_FALSE(UseAVX512F());
+  EXPECT_EQ(use_avx, UseAVX());
+
+  SetMaximumVectorInstructionSet(VectorInstructionSet::kNone);
+  EXPECT_FALSE(UseAVX512F());
+  EXPECT_FALSE(UseAVX());
+
+  SetMaximumVectorInstructionSet(VectorInstructionSet::kAVX512F);
+  EXPECT_EQ(use_avx, UseAVX());
+#if !PRINCIPIA_USE_AVX512F
+  EXPECT_EQ(features.avx512f, UseAVX512F());
+#endif
+}
+
+}  // namespace base
+}  // namespace principia
@@ -68,6 +68,49 @@ char const* const kArchitecture = "x86-64";
 #error "Have you tried a Cray-1?"
 #endif
 
+// Vector instruction sets that the compiler was allowed to use (e.g., with
+// /arch:AVX or /arch:AVX2 for MSVC).
+#if ARCH_CPU_X86_FAMILY && defined(__AVX512F__)
+#define PRINCIPIA_USE_AVX512F 1
+#endif
+#if ARCH_CPU_X86_FAMILY && defined(__AVX__)
+#define PRINCIPIA_USE_AVX 1
+#endif
+
+// Set to 0 to only compile the vectorized kernels for the instruction sets
+// that the compiler was allowed to use.  Otherwise, on x86, the kernels for
+// AVX, and for AVX-512F if the compiler has its intrinsics, are compiled
+// irrespective of the compiler options and selected at run time according to
+// the features of the processor, see base/cpu_features.hpp.  The functions
+// that use the instructions of these sets are marked with
+// |PRINCIPIA_TARGET_AVX| or |PRINCIPIA_TARGET_AVX512F|.
+#if !defined(PRINCIPIA_DISPATCH_VECTOR_KERNELS)
+#define PRINCIPIA_DISPATCH_VECTOR_KERNELS 1
+#endif
+#if PRINCIPIA_USE_AVX || \
+    (ARCH_CPU_X86_FAMILY && PRINCIPIA_DISPATCH_VECTOR_KERNELS)
+#define PRINCIPIA_HAS_AVX_KERNELS 1
+#endif
+#if PRINCIPIA_USE_AVX512F ||                                     \
+    (ARCH_CPU_X86_FAMILY && PRINCIPIA_DISPATCH_VECTOR_KERNELS && \
+     !(defined(_MSC_VER) && _MSC_VER < 1910))
+#define PRINCIPIA_HAS_AVX512F_KERNELS 1
+#endif
+
+// Set to 1 to compute the inverse square roots in the gravitational kernels
+// with |InverseSqrtPrecision::kFast|, which avoids a division per pair of
+// bodies but changes the last bits of the accelerations.
+#if !defined(PRINCIPIA_USE_FAST_INVERSE_SQRT)
+#define PRINCIPIA_USE_FAST_INVERSE_SQRT 0
+#endif
+
+// Set to 1 to count the allocations of the plugin, see
+// base/allocation_tracker.hpp.  This replaces its global operator new with a
+// slightly slower one.
+#if !defined(PRINCIPIA_TRACK_ALLOCATIONS)
+#define PRINCIPIA_TRACK_ALLOCATIONS 0
+#endif
+
 #if defined(CDECL)
 #  error "CDECL already defined"
 #else
@@ -127,6 +170,41 @@ inline void noreturn() { exit(0); }
 #  error "What compiler is this?"
 #endif
 
+// Marks a function that uses the instructions of a given set, when
+// |PRINCIPIA_DISPATCH_VECTOR_KERNELS| compiles it irrespective of the compiler
+// options.  Visual C++ accepts the intrinsics without any annotation.
+#if PRINCIPIA_COMPILER_CLANG    ||  \
+    PRINCIPIA_COMPILER_CLANG_CL ||  \
+    PRINCIPIA_COMPILER_GCC      ||  \
+    PRINCIPIA_COMPILER_ICC
+#  define PRINCIPIA_TARGET_AVX __attribute__((target("avx")))
+#  define PRINCIPIA_TARGET_AVX512F __attribute__((target("avx512f")))
+#elif PRINCIPIA_COMPILER_MSVC
+#  define PRINCIPIA_TARGET_AVX
+#  define PRINCIPIA_TARGET_AVX512F
+#else
+#  error "What compiler is this?"
+#endif
+
+// |constexpr| if the compiler supports it.  Visual C++ 2013 doesn't, in which
+// case the functions so marked are evaluated, and the constants so marked are
+// initialized, at run time.
+#if PRINCIPIA_COMPILER_MSVC && _MSC_VER < 1900
+#  define CONSTEXPR
+#else
+#  define CONSTEXPR constexpr
+#endif
+
+// Whether the compiler supports |thread_local|.  Visual C++ 2013 doesn't, and
+// its |__declspec(thread)| doesn't support objects with destructors, so the
+// thread-local objects that have one must be held in thread-local storage
+// slots of the operating system instead.
+#if PRINCIPIA_COMPILER_MSVC && _MSC_VER < 1900
+#  define PRINCIPIA_HAS_THREAD_LOCAL 0
+#else
+#  define PRINCIPIA_HAS_THREAD_LOCAL 1
+#endif
+
 // A workaround for a MSVC bug wherein a |typename| is required by the standard
 // and by clang but forbidden by MSVC.
 #if PRINCIPIA_COMPILER_MSVC
@@ -151,5 +229,60 @@ inline void noreturn() { exit(0); }
 
 #define NAMED(expression) #expression << ": " << (expression)
 
+// Graded assertions.  The |CHECK|s of glog are always evaluated: they guard
+// the interfaces and the invariants whose violation would corrupt the state.
+// The |DEBUG_CHECK|s are for the checks made for each element in a hot loop,
+// which the callers already guarantee; they are evaluated if
+// |PRINCIPIA_CHECK_LEVEL| is at least 1, the default in debug builds.  The
+// |PARANOID_CHECK|s are for the checks that are costly in themselves, e.g.,
+// because they traverse a data structure; they are evaluated if
+// |PRINCIPIA_CHECK_LEVEL| is at least 2.  An assertion that is not evaluated
+// is compiled, so that it stays valid, but neither its condition nor its
+// message are executed.
+#if !defined(PRINCIPIA_CHECK_LEVEL)
+#  if defined(NDEBUG)
+#    define PRINCIPIA_CHECK_LEVEL 0
+#  else
+#    define PRINCIPIA_CHECK_LEVEL 1
+#  endif
+#endif
+
+#define PRINCIPIA_UNEVALUATED_CHECK(check) while (false) check
+
+#if PRINCIPIA_CHECK_LEVEL >= 1
+#  define DEBUG_CHECK(condition) CHECK(condition)
+#  define DEBUG_CHECK_EQ(left, right) CHECK_EQ(left, right)
+#  define DEBUG_CHECK_NE(left, right) CHECK_NE(left, right)
+#  define DEBUG_CHECK_LT(left, right) CHECK_LT(left, right)
+#  define DEBUG_CHECK_LE(left, right) CHECK_LE(left, right)
+#else
+#  define DEBUG_CHECK(condition) \
+      PRINCIPIA_UNEVALUATED_CHECK(CHECK(condition))
+#  define DEBUG_CHECK_EQ(left, right) \
+      PRINCIPIA_UNEVALUATED_CHECK(CHECK_EQ(left, right))
+#  define DEBUG_CHECK_NE(left, right) \
+      PRINCIPIA_UNEVALUATED_CHECK(CHECK_NE(left, right))
+#  define DEBUG_CHECK_LT(left, right) \
+      PRINCIPIA_UNEVALUATED_CHECK(CHECK_LT(left, right))
+#  define DEBUG_CHECK_LE(left, right) \
+      PRINCIPIA_UNEVALUATED_CHECK(CHECK_LE(left, right))
+#endif
+
+#if PRINCIPIA_CHECK_LEVEL >= 2
+#  define PARANOID_CHECK(condition) CHECK(condition)
+#  define PARANOID_CHECK_EQ(left, right) CHECK_EQ(left, right)
+#  define PARANOID_CHECK_LT(left, right) CHECK_LT(left, right)
+#  define PARANOID_CHECK_LE(left, right) CHECK_LE(left, right)
+#else
+#  define PARANOID_CHECK(condition) \
+      PRINCIPIA_UNEVALUATED_CHECK(CHECK(condition))
+#  define PARANOID_CHECK_EQ(left, right) \
+      PRINCIPIA_UNEVALUATED_CHECK(CHECK_EQ(left, right))
+#  define PARANOID_CHECK_LT(left, right) \
+      PRINCIPIA_UNEVALUATED_CHECK(CHECK_LT(left, right))
+#  define PARANOID_CHECK_LE(left, right) \
+      PRINCIPIA_UNEVALUATED_CHECK(CHECK_LE(left, right))
+#endif
+
 }  // namespace base
 }  // namespace principia
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "base/macros.hpp"
+
+namespace principia {
+namespace base {
+
+// A scratch file of a fixed size, mapped in memory for reading and writing.
+// The pages of the mapping are backed by the file rather than by the paging
+// file, so the operating system may evict them from memory at will.  The file
+// is created, or truncated, by the constructor and deleted by the destructor;
+// it is not meant to be read by anything else.
+class MappedFile {
+ public:
+  // |size| must be positive.
+  MappedFile(std::string const& filename, std::int64_t const size);
+  ~MappedFile();
+
+  MappedFile(MappedFile const&) = delete;
+  MappedFile& operator=(MappedFile const&) = delete;
+
+  // The address of the mapping, which remains valid for the lifetime of this
+  // object.
+  char* data() const;
+  std::int64_t size() const;
+
+ private:
+  std::string const filename_;
+  std::int64_t const size_;
+  char* data_ = nullptr;
+#if OS_WIN
+  void* file_ = nullptr;
+  void* mapping_ = nullptr;
+#else
+  int file_ = -1;
+#endif
+};
+
+// An existing file, mapped in memory for reading.  The pages are only read
+// from the file when they are first accessed, so mapping a large file takes
+// constant time.  The file is not modified, and not deleted by the destructor.
+class ReadOnlyMappedFile {
+ public:
+  // The file |filename| must exist and must not be empty.
+  explicit ReadOnlyMappedFile(std::string const& filename);
+  ~ReadOnlyMappedFile();
+
+  ReadOnlyMappedFile(ReadOnlyMappedFile const&) = delete;
+  ReadOnlyMappedFile& operator=(ReadOnlyMappedFile const&) = delete;
+
+  // The address of the mapping, which remains valid for the lifetime of this
+  // object.
+  char const* data() const;
+  std::int64_t size() const;
+
+ private:
+  std::string const filename_;
+  std::int64_t size_ = 0;
+  char const* data_ = nullptr;
+#if OS_WIN
+  void* file_ = nullptr;
+  void* mapping_ = nullptr;
+#else
+  int file_ = -1;
+#endif
+};
+
+}  // namespace base
+}  // namespace principia
+
+#include "base/mapped_file_body.hpp"
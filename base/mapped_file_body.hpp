@@ -0,0 +1,171 @@
+#pragma once
+
+#include "base/mapped_file.hpp"
+
+#if OS_WIN
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace base {
+
+#if OS_WIN
+
+inline MappedFile::MappedFile(std::string const& filename,
+                              std::int64_t const size)
+    : filename_(filename),
+      size_(size) {
+  CHECK_LT(0, size_);
+  HANDLE const file = CreateFileA(filename_.c_str(),
+                                  GENERIC_READ | GENERIC_WRITE,
+                                  /*dwShareMode=*/0,
+                                  /*lpSecurityAttributes=*/nullptr,
+                                  CREATE_ALWAYS,
+                                  FILE_ATTRIBUTE_TEMPORARY |
+                                      FILE_FLAG_DELETE_ON_CLOSE,
+                                  /*hTemplateFile=*/nullptr);
+  CHECK(file != INVALID_HANDLE_VALUE)
+      << filename_ << ": error " << GetLastError();
+  file_ = file;
+  HANDLE const mapping =
+      CreateFileMappingA(file,
+                         /*lpFileMappingAttributes=*/nullptr,
+                         PAGE_READWRITE,
+                         static_cast<DWORD>(size_ >> 32),
+                         static_cast<DWORD>(size_ & 0xFFFFFFFF),
+                         /*lpName=*/nullptr);
+  CHECK(mapping != nullptr) << filename_ << ": error " << GetLastError();
+  mapping_ = mapping;
+  data_ = static_cast<char*>(MapViewOfFile(mapping,
+                                           FILE_MAP_ALL_ACCESS,
+                                           /*dwFileOffsetHigh=*/0,
+                                           /*dwFileOffsetLow=*/0,
+                                           /*dwNumberOfBytesToMap=*/0));
+  CHECK(data_ != nullptr) << filename_ << ": error " << GetLastError();
+}
+
+inline MappedFile::~MappedFile() {
+  UnmapViewOfFile(data_);
+  CloseHandle(mapping_);
+  // Deletes the file.
+  CloseHandle(file_);
+}
+
+inline ReadOnlyMappedFile::ReadOnlyMappedFile(std::string const& filename)
+    : filename_(filename) {
+  HANDLE const file = CreateFileA(filename_.c_str(),
+                                  GENERIC_READ,
+                                  FILE_SHARE_READ,
+                                  /*lpSecurityAttributes=*/nullptr,
+                                  OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL,
+                                  /*hTemplateFile=*/nullptr);
+  CHECK(file != INVALID_HANDLE_VALUE)
+      << filename_ << ": error " << GetLastError();
+  file_ = file;
+  LARGE_INTEGER size;
+  CHECK(GetFileSizeEx(file, &size))
+      << filename_ << ": error " << GetLastError();
+  size_ = size.QuadPart;
+  CHECK_LT(0, size_) << filename_;
+  HANDLE const mapping =
+      CreateFileMappingA(file,
+                         /*lpFileMappingAttributes=*/nullptr,
+                         PAGE_READONLY,
+                         /*dwMaximumSizeHigh=*/0,
+                         /*dwMaximumSizeLow=*/0,
+                         /*lpName=*/nullptr);
+  CHECK(mapping != nullptr) << filename_ << ": error " << GetLastError();
+  mapping_ = mapping;
+  data_ = static_cast<char const*>(MapViewOfFile(mapping,
+                                                 FILE_MAP_READ,
+                                                 /*dwFileOffsetHigh=*/0,
+                                                 /*dwFileOffsetLow=*/0,
+                                                 /*dwNumberOfBytesToMap=*/0));
+  CHECK(data_ != nullptr) << filename_ << ": error " << GetLastError();
+}
+
+inline ReadOnlyMappedFile::~ReadOnlyMappedFile() {
+  UnmapViewOfFile(data_);
+  CloseHandle(mapping_);
+  CloseHandle(file_);
+}
+
+#else
+
+inline MappedFile::MappedFile(std::string const& filename,
+                              std::int64_t const size)
+    : filename_(filename),
+      size_(size) {
+  CHECK_LT(0, size_);
+  file_ = open(filename_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  PCHECK(file_ >= 0) << filename_;
+  PCHECK(ftruncate(file_, size_) == 0) << filename_;
+  void* const data = mmap(/*addr=*/nullptr,
+                          size_,
+                          PROT_READ | PROT_WRITE,
+                          MAP_SHARED,
+                          file_,
+                          /*offset=*/0);
+  PCHECK(data != MAP_FAILED) << filename_;
+  data_ = static_cast<char*>(data);
+}
+
+inline MappedFile::~MappedFile() {
+  munmap(data_, size_);
+  close(file_);
+  unlink(filename_.c_str());
+}
+
+inline ReadOnlyMappedFile::ReadOnlyMappedFile(std::string const& filename)
+    : filename_(filename) {
+  file_ = open(filename_.c_str(), O_RDONLY);
+  PCHECK(file_ >= 0) << filename_;
+  struct stat status;
+  PCHECK(fstat(file_, &status) == 0) << filename_;
+  size_ = status.st_size;
+  CHECK_LT(0, size_) << filename_;
+  void* const data = mmap(/*addr=*/nullptr,
+                          size_,
+                          PROT_READ,
+                          MAP_SHARED,
+                          file_,
+                          /*offset=*/0);
+  PCHECK(data != MAP_FAILED) << filename_;
+  data_ = static_cast<char const*>(data);
+}
+
+inline ReadOnlyMappedFile::~ReadOnlyMappedFile() {
+  munmap(const_cast<char*>(data_), size_);
+  close(file_);
+}
+
+#endif
+
+inline char* MappedFile::data() const {
+  return data_;
+}
+
+inline std::int64_t MappedFile::size() const {
+  return size_;
+}
+
+inline char const* ReadOnlyMappedFile::data() const {
+  return data_;
+}
+
+inline std::int64_t ReadOnlyMappedFile::size() const {
+  return size_;
+}
+
+}  // namespace base
+}  // namespace principia
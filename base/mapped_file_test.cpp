@@ -0,0 +1,48 @@
+#include "base/mapped_file.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Eq;
+
+namespace principia {
+namespace base {
+
+TEST(MappedFileTest, ReadWrite) {
+  char const filename[] = "mapped_file_test.bin";
+  {
+    MappedFile const file(filename, 1 << 20);
+    EXPECT_THAT(file.size(), Eq(1 << 20));
+    // The file is zero-filled.
+    EXPECT_THAT(file.data()[0], Eq(0));
+    EXPECT_THAT(file.data()[(1 << 20) - 1], Eq(0));
+    std::strcpy(file.data() + 1000, "Mapped");
+    EXPECT_THAT(std::strcmp(file.data() + 1000, "Mapped"), Eq(0));
+  }
+  // The file is deleted.
+  EXPECT_FALSE(std::ifstream(filename).good());
+}
+
+TEST(MappedFileTest, ReadOnly) {
+  char const filename[] = "read_only_mapped_file_test.bin";
+  {
+    std::ofstream file(filename, std::ios::binary);
+    file << "Mapped";
+  }
+  {
+    ReadOnlyMappedFile const file(filename);
+    EXPECT_THAT(file.size(), Eq(6));
+    EXPECT_THAT(std::string(file.data(), file.size()), Eq("Mapped"));
+  }
+  // The file is not deleted.
+  EXPECT_TRUE(std::ifstream(filename).good());
+  std::remove(filename);
+}
+
+}  // namespace base
+}  // namespace principia
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace principia {
+namespace base {
+
+// Estimates of the memory allocated by the standard containers, in bytes.
+// They exclude the container objects themselves, the memory owned by the
+// elements, and the overhead of the allocators.
+
+// For the node-based containers implemented as red-black trees, e.g.,
+// |std::map| and |std::set|.
+template<typename Tree>
+std::int64_t TreeMemoryUsage(Tree const& tree);
+
+template<typename T, typename Allocator>
+std::int64_t VectorMemoryUsage(std::vector<T, Allocator> const& vector);
+
+}  // namespace base
+}  // namespace principia
+
+#include "base/memory_usage_body.hpp"
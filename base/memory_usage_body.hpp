@@ -0,0 +1,21 @@
+#pragma once
+
+#include "base/memory_usage.hpp"
+
+namespace principia {
+namespace base {
+
+template<typename Tree>
+std::int64_t TreeMemoryUsage(Tree const& tree) {
+  // A node has three pointers and a colour in addition to its value.
+  return static_cast<std::int64_t>(tree.size()) *
+         (sizeof(typename Tree::value_type) + 4 * sizeof(void*));
+}
+
+template<typename T, typename Allocator>
+std::int64_t VectorMemoryUsage(std::vector<T, Allocator> const& vector) {
+  return static_cast<std::int64_t>(vector.capacity()) * sizeof(T);
+}
+
+}  // namespace base
+}  // namespace principia
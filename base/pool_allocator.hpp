@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+
+#include "base/macros.hpp"
+
+namespace principia {
+namespace base {
+
+// Recycles the memory of the small blocks which are allocated and freed at a
+// high rate, e.g., by the forks of the trajectories, without going through the
+// global heap.  The blocks of at most |kMaxPooledSize| bytes are grouped in
+// size classes, powers of two, and each thread has a free list per size class,
+// so no locking is needed.  A block may be freed by a different thread than
+// the one that allocated it.  The free lists are bounded: when a list holds
+// |kMaxPooledBytes| bytes, freed blocks are returned to the global heap, as are
+// the blocks of a list when its thread exits.
+class Pool {
+ public:
+  Pool() = delete;
+
+  static void* Allocate(std::size_t const size);
+  // |size| must be the size that was passed to |Allocate|.
+  static void Deallocate(void* const block, std::size_t const size);
+
+  static std::size_t const kMaxPooledSize = 4096;
+  static std::size_t const kMaxPooledBytes = 1 << 18;
+
+ private:
+  // The size classes are the powers of two from |kMinBlockSize| to
+  // |kMaxPooledSize|.  The smallest block holds a |FreeBlock|.
+  static std::size_t const kMinBlockSize = 16;
+  static int const kNumberOfSizeClasses = 9;
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  // The free lists of the calling thread, indexed by size class.
+  class FreeLists {
+   public:
+    FreeLists();
+    ~FreeLists();
+
+    FreeLists(FreeLists const&) = delete;
+    FreeLists& operator=(FreeLists const&) = delete;
+
+    void* Allocate(int const size_class);
+    void Deallocate(void* const block, int const size_class);
+
+   private:
+    FreeBlock* heads_[kNumberOfSizeClasses];
+    std::size_t lengths_[kNumberOfSizeClasses];
+  };
+
+  // The size class of |size|, which must be at most |kMaxPooledSize|.
+  static int SizeClass(std::size_t const size);
+  static std::size_t BlockSize(int const size_class);
+
+  static FreeLists& ThreadFreeLists();
+
+#if !PRINCIPIA_HAS_THREAD_LOCAL
+  // The destructor of the fiber-local storage slot holding the free lists of
+  // each thread, called when the thread exits.
+  static void __stdcall DeleteFreeLists(void* const free_lists);
+#endif
+};
+
+// A standard allocator which allocates from the |Pool|, for use by the
+// node-based containers.  All the instances are equal.
+template<typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+
+  PoolAllocator() = default;
+  template<typename U>
+  PoolAllocator(PoolAllocator<U> const& other);
+
+  T* allocate(std::size_t const n);
+  void deallocate(T* const p, std::size_t const n);
+};
+
+template<typename T, typename U>
+bool operator==(PoolAllocator<T> const& left, PoolAllocator<U> const& right);
+template<typename T, typename U>
+bool operator!=(PoolAllocator<T> const& left, PoolAllocator<U> const& right);
+
+}  // namespace base
+}  // namespace principia
+
+#include "base/pool_allocator_body.hpp"
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "base/pool_allocator.hpp"
+
+#include <new>
+
+#include "base/macros.hpp"
+
+#if !PRINCIPIA_HAS_THREAD_LOCAL
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace base {
+
+inline void* Pool::Allocate(std::size_t const size) {
+  if (size > kMaxPooledSize) {
+    return ::operator new(size);
+  }
+  return ThreadFreeLists().Allocate(SizeClass(size));
+}
+
+inline void Pool::Deallocate(void* const block, std::size_t const size) {
+  if (size > kMaxPooledSize) {
+    ::operator delete(block);
+    return;
+  }
+  ThreadFreeLists().Deallocate(block, SizeClass(size));
+}
+
+inline Pool::FreeLists::FreeLists() {
+  for (int size_class = 0; size_class < kNumberOfSizeClasses; ++size_class) {
+    heads_[size_class] = nullptr;
+    lengths_[size_class] = 0;
+  }
+}
+
+inline Pool::FreeLists::~FreeLists() {
+  for (int size_class = 0; size_class < kNumberOfSizeClasses; ++size_class) {
+    while (heads_[size_class] != nullptr) {
+      FreeBlock* const block = heads_[size_class];
+      heads_[size_class] = block->next;
+      ::operator delete(block);
+    }
+  }
+}
+
+inline void* Pool::FreeLists::Allocate(int const size_class) {
+  FreeBlock* const block = heads_[size_class];
+  if (block == nullptr) {
+    return ::operator new(BlockSize(size_class));
+  }
+  heads_[size_class] = block->next;
+  --lengths_[size_class];
+  return block;
+}
+
+inline void Pool::FreeLists::Deallocate(void* const block,
+                                        int const size_class) {
+  if ((lengths_[size_class] + 1) * BlockSize(size_class) > kMaxPooledBytes) {
+    ::operator delete(block);
+    return;
+  }
+  FreeBlock* const free_block = static_cast<FreeBlock*>(block);
+  free_block->next = heads_[size_class];
+  heads_[size_class] = free_block;
+  ++lengths_[size_class];
+}
+
+inline int Pool::SizeClass(std::size_t const size) {
+  DEBUG_CHECK(size <= kMaxPooledSize);
+  int size_class = 0;
+  while (BlockSize(size_class) < size) {
+    ++size_class;
+  }
+  return size_class;
+}
+
+inline std::size_t Pool::BlockSize(int const size_class) {
+  return kMinBlockSize << size_class;
+}
+
+#if PRINCIPIA_HAS_THREAD_LOCAL
+
+inline Pool::FreeLists& Pool::ThreadFreeLists() {
+  thread_local FreeLists free_lists;
+  return free_lists;
+}
+
+#else
+
+inline Pool::FreeLists& Pool::ThreadFreeLists() {
+  // A constant initialization, so there is no race on the initialization of
+  // the static.  The first threads to get here race to allocate the slot, the
+  // losers free theirs.
+  static LONG volatile slot = static_cast<LONG>(FLS_OUT_OF_INDEXES);
+  DWORD index = static_cast<DWORD>(slot);
+  if (index == FLS_OUT_OF_INDEXES) {
+    DWORD const allocated = FlsAlloc(&DeleteFreeLists);
+    CHECK_NE(FLS_OUT_OF_INDEXES, allocated) << GetLastError();
+    LONG const previous =
+        InterlockedCompareExchange(&slot,
+                                   static_cast<LONG>(allocated),
+                                   static_cast<LONG>(FLS_OUT_OF_INDEXES));
+    if (previous == static_cast<LONG>(FLS_OUT_OF_INDEXES)) {
+      index = allocated;
+    } else {
+      FlsFree(allocated);
+      index = static_cast<DWORD>(previous);
+    }
+  }
+  void* free_lists = FlsGetValue(index);
+  if (free_lists == nullptr) {
+    free_lists = new FreeLists;
+    CHECK(FlsSetValue(index, free_lists)) << GetLastError();
+  }
+  return *static_cast<FreeLists*>(free_lists);
+}
+
+inline void __stdcall Pool::DeleteFreeLists(void* const free_lists) {
+  delete static_cast<FreeLists*>(free_lists);
+}
+
+#endif
+
+template<typename T>
+template<typename U>
+PoolAllocator<T>::PoolAllocator(PoolAllocator<U> const& other) {}
+
+template<typename T>
+T* PoolAllocator<T>::allocate(std::size_t const n) {
+  return static_cast<T*>(Pool::Allocate(n * sizeof(T)));
+}
+
+template<typename T>
+void PoolAllocator<T>::deallocate(T* const p, std::size_t const n) {
+  Pool::Deallocate(p, n * sizeof(T));
+}
+
+template<typename T, typename U>
+bool operator==(PoolAllocator<T> const& left, PoolAllocator<U> const& right) {
+  return true;
+}
+
+template<typename T, typename U>
+bool operator!=(PoolAllocator<T> const& left, PoolAllocator<U> const& right) {
+  return false;
+}
+
+}  // namespace base
+}  // namespace principia
@@ -0,0 +1,62 @@
+#include "base/pool_allocator.hpp"
+
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Eq;
+using testing::Ne;
+
+namespace principia {
+namespace base {
+
+TEST(PoolAllocatorTest, Recycling) {
+  void* const block = Pool::Allocate(100);
+  Pool::Deallocate(block, 100);
+  // Same size class.
+  void* const recycled = Pool::Allocate(128);
+  EXPECT_THAT(recycled, Eq(block));
+  void* const other = Pool::Allocate(128);
+  EXPECT_THAT(other, Ne(block));
+  Pool::Deallocate(other, 128);
+  Pool::Deallocate(recycled, 128);
+
+  // Large blocks are not pooled.
+  void* const large = Pool::Allocate(Pool::kMaxPooledSize + 1);
+  Pool::Deallocate(large, Pool::kMaxPooledSize + 1);
+}
+
+TEST(PoolAllocatorTest, Containers) {
+  std::multimap<int, int, std::less<int>,
+                PoolAllocator<std::pair<int const, int>>> map;
+  std::vector<double, PoolAllocator<double>> vector;
+  for (int i = 0; i < 1000; ++i) {
+    map.emplace(i % 10, i);
+    vector.push_back(i);
+  }
+  EXPECT_THAT(map.count(3), Eq(100));
+  EXPECT_THAT(vector[999], Eq(999));
+  map.clear();
+  vector.clear();
+  vector.shrink_to_fit();
+  EXPECT_TRUE(PoolAllocator<int>() == PoolAllocator<double>());
+}
+
+// Blocks may be freed by another thread than the one that allocated them.
+TEST(PoolAllocatorTest, Threads) {
+  std::vector<void*> blocks;
+  for (int i = 0; i < 1000; ++i) {
+    blocks.push_back(Pool::Allocate(i % 200 + 1));
+  }
+  std::thread([&blocks]() {
+    for (int i = 0; i < 1000; ++i) {
+      Pool::Deallocate(blocks[i], i % 200 + 1);
+    }
+  }).join();
+}
+
+}  // namespace base
+}  // namespace principia
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace principia {
+namespace base {
+
+// Destroys objects on a background thread.  Destroying a large data structure,
+// e.g., a trajectory with millions of points, takes time proportional to its
+// size; with a |Reclaimer| the caller only unlinks it from its own data
+// structures and hands it over, which takes constant time.  The objects must
+// not be shared: their destructors must not touch any data that other threads
+// may use concurrently.  All the functions of this class must be called from
+// the same thread.
+class Reclaimer {
+ public:
+  Reclaimer();
+
+  // Destroys the pending objects and joins the background thread.
+  ~Reclaimer();
+
+  Reclaimer(Reclaimer const&) = delete;
+  Reclaimer& operator=(Reclaimer const&) = delete;
+
+  // Takes ownership of |object|, which is destroyed on the background thread.
+  template<typename T>
+  void Reclaim(std::unique_ptr<T> object);
+
+  // Returns once the objects reclaimed so far have been destroyed.
+  void Wait();
+
+  // The number of objects reclaimed so far, and the number of those that have
+  // been destroyed.
+  std::int64_t reclaimed() const;
+  std::int64_t destroyed() const;
+
+ private:
+  // The body of the background thread.
+  void DestroyObjects();
+
+  mutable std::mutex lock_;
+  // Signalled when objects are reclaimed and on shutdown.
+  std::condition_variable has_objects_;
+  // Signalled when objects have been destroyed.
+  std::condition_variable has_destroyed_;
+
+  // The type of the objects is erased by the deleter of the |shared_ptr|.
+  std::vector<std::shared_ptr<void>> pending_;  // Guarded by |lock_|.
+  std::int64_t reclaimed_ = 0;  // Guarded by |lock_|.
+  std::int64_t destroyed_ = 0;  // Guarded by |lock_|.
+  bool shutdown_ = false;  // Guarded by |lock_|.
+
+  std::thread destroyer_;
+};
+
+}  // namespace base
+}  // namespace principia
+
+#include "base/reclaimer_body.hpp"
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "base/reclaimer.hpp"
+
+#include <utility>
+
+namespace principia {
+namespace base {
+
+inline Reclaimer::Reclaimer() {
+  destroyer_ = std::thread(&Reclaimer::DestroyObjects, this);
+}
+
+inline Reclaimer::~Reclaimer() {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    shutdown_ = true;
+  }
+  has_objects_.notify_one();
+  destroyer_.join();
+}
+
+template<typename T>
+void Reclaimer::Reclaim(std::unique_ptr<T> object) {
+  if (object == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    pending_.emplace_back(std::move(object));
+    ++reclaimed_;
+  }
+  has_objects_.notify_one();
+}
+
+inline void Reclaimer::Wait() {
+  std::unique_lock<std::mutex> l(lock_);
+  std::int64_t const reclaimed = reclaimed_;
+  has_destroyed_.wait(l, [this, reclaimed]() {
+    return destroyed_ >= reclaimed;
+  });
+}
+
+inline std::int64_t Reclaimer::reclaimed() const {
+  std::lock_guard<std::mutex> l(lock_);
+  return reclaimed_;
+}
+
+inline std::int64_t Reclaimer::destroyed() const {
+  std::lock_guard<std::mutex> l(lock_);
+  return destroyed_;
+}
+
+inline void Reclaimer::DestroyObjects() {
+  std::vector<std::shared_ptr<void>> objects;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> l(lock_);
+      has_objects_.wait(l, [this]() {
+        return !pending_.empty() || shutdown_;
+      });
+      if (pending_.empty()) {
+        return;
+      }
+      // Take the whole batch, so that the destruction happens without holding
+      // |lock_| and doesn't block |Reclaim|.
+      objects.swap(pending_);
+    }
+    std::int64_t const count = objects.size();
+    objects.clear();
+    {
+      std::lock_guard<std::mutex> l(lock_);
+      destroyed_ += count;
+    }
+    has_destroyed_.notify_all();
+  }
+}
+
+}  // namespace base
+}  // namespace principia
@@ -0,0 +1,67 @@
+#include "base/reclaimer.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Eq;
+
+namespace principia {
+namespace base {
+
+namespace {
+
+// Records the thread on which it is destroyed.
+class Tracked {
+ public:
+  Tracked(std::atomic<int>* const destructions,
+          std::thread::id* const destroyer)
+      : destructions_(destructions),
+        destroyer_(destroyer) {}
+
+  ~Tracked() {
+    *destroyer_ = std::this_thread::get_id();
+    ++*destructions_;
+  }
+
+ private:
+  std::atomic<int>* const destructions_;
+  std::thread::id* const destroyer_;
+};
+
+}  // namespace
+
+class ReclaimerTest : public testing::Test {};
+
+TEST_F(ReclaimerTest, DestroysOnBackgroundThread) {
+  std::atomic<int> destructions(0);
+  std::thread::id destroyer;
+  Reclaimer reclaimer;
+  reclaimer.Reclaim(std::make_unique<Tracked>(&destructions, &destroyer));
+  reclaimer.Reclaim(std::unique_ptr<int>());
+  reclaimer.Wait();
+  EXPECT_THAT(destructions, Eq(1));
+  EXPECT_NE(std::this_thread::get_id(), destroyer);
+  EXPECT_THAT(reclaimer.reclaimed(), Eq(1));
+  EXPECT_THAT(reclaimer.destroyed(), Eq(1));
+}
+
+// Checks that the destructor destroys the pending objects.
+TEST_F(ReclaimerTest, Destruction) {
+  int const kCount = 1000;
+  std::atomic<int> destructions(0);
+  std::thread::id destroyer;
+  {
+    Reclaimer reclaimer;
+    for (int i = 0; i < kCount; ++i) {
+      reclaimer.Reclaim(std::make_unique<Tracked>(&destructions, &destroyer));
+    }
+  }
+  EXPECT_THAT(destructions, Eq(kCount));
+}
+
+}  // namespace base
+}  // namespace principia
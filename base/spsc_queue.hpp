@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "base/not_null.hpp"
+
+namespace principia {
+namespace base {
+
+// A queue of fixed capacity between a single producer thread and a single
+// consumer thread, which doesn't take any lock.  As in |AsyncLogger|, the
+// elements live in a ring buffer, only the producer modifies |head_| and only
+// the consumer modifies |tail_|.  Neither side ever waits: |TryPush| and
+// |TryPop| return false if the queue is full or empty, respectively, and it is
+// up to the caller to decide how to wait.
+// |T| must be default-constructible and move-assignable.
+template<typename T>
+class SPSCQueue {
+ public:
+  // |capacity| is the maximum number of elements in the queue, and must be
+  // positive.
+  explicit SPSCQueue(std::int64_t const capacity);
+
+  SPSCQueue(SPSCQueue const&) = delete;
+  SPSCQueue& operator=(SPSCQueue const&) = delete;
+
+  // Must only be called by the producer.  Moves |value| to the back of the
+  // queue and returns true, unless the queue is full, in which case |value| is
+  // left untouched and false is returned.
+  bool TryPush(T&& value);
+
+  // Must only be called by the consumer.  Moves the front of the queue to
+  // |value| and returns true, unless the queue is empty, in which case false
+  // is returned.
+  bool TryPop(not_null<T*> const value);
+
+  // The number of elements ever pushed and ever popped, respectively.  Exact
+  // when called by the producer and the consumer, respectively, and a lower
+  // bound otherwise.
+  std::int64_t pushed() const;
+  std::int64_t popped() const;
+
+ private:
+  std::vector<T> slots_;
+  std::atomic<std::int64_t> head_;
+  std::atomic<std::int64_t> tail_;
+};
+
+}  // namespace base
+}  // namespace principia
+
+#include "base/spsc_queue_body.hpp"
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "base/spsc_queue.hpp"
+
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace base {
+
+template<typename T>
+SPSCQueue<T>::SPSCQueue(std::int64_t const capacity)
+    : slots_(capacity),
+      head_(0),
+      tail_(0) {
+  CHECK_LT(0, capacity);
+}
+
+template<typename T>
+bool SPSCQueue<T>::TryPush(T&& value) {
+  std::int64_t const capacity = slots_.size();
+  std::int64_t const head = head_.load(std::memory_order_relaxed);
+  if (head - tail_.load(std::memory_order_acquire) == capacity) {
+    return false;
+  }
+  slots_[head % capacity] = std::move(value);
+  head_.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+template<typename T>
+bool SPSCQueue<T>::TryPop(not_null<T*> const value) {
+  std::int64_t const capacity = slots_.size();
+  std::int64_t const tail = tail_.load(std::memory_order_relaxed);
+  if (tail == head_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  T& slot = slots_[tail % capacity];
+  *value = std::move(slot);
+  // Don't keep the resources of the popped element until the slot is reused.
+  slot = T();
+  tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+template<typename T>
+std::int64_t SPSCQueue<T>::pushed() const {
+  return head_.load(std::memory_order_acquire);
+}
+
+template<typename T>
+std::int64_t SPSCQueue<T>::popped() const {
+  return tail_.load(std::memory_order_acquire);
+}
+
+}  // namespace base
+}  // namespace principia
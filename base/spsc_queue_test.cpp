@@ -0,0 +1,70 @@
+#include "base/spsc_queue.hpp"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Eq;
+
+namespace principia {
+namespace base {
+
+class SPSCQueueTest : public testing::Test {};
+
+TEST_F(SPSCQueueTest, FullAndEmpty) {
+  SPSCQueue<std::unique_ptr<int>> queue(2);
+  std::unique_ptr<int> value;
+  EXPECT_FALSE(queue.TryPop(&value));
+  EXPECT_TRUE(queue.TryPush(std::make_unique<int>(1)));
+  EXPECT_TRUE(queue.TryPush(std::make_unique<int>(2)));
+  std::unique_ptr<int> third = std::make_unique<int>(3);
+  EXPECT_FALSE(queue.TryPush(std::move(third)));
+  // Not moved from since the queue was full.
+  ASSERT_TRUE(third != nullptr);
+  EXPECT_TRUE(queue.TryPop(&value));
+  EXPECT_THAT(*value, Eq(1));
+  EXPECT_TRUE(queue.TryPush(std::move(third)));
+  EXPECT_TRUE(queue.TryPop(&value));
+  EXPECT_THAT(*value, Eq(2));
+  EXPECT_TRUE(queue.TryPop(&value));
+  EXPECT_THAT(*value, Eq(3));
+  EXPECT_FALSE(queue.TryPop(&value));
+  EXPECT_THAT(queue.pushed(), Eq(3));
+  EXPECT_THAT(queue.popped(), Eq(3));
+}
+
+// Checks that the elements cross threads in order and without loss, with a
+// capacity small enough for the producer to often find the queue full.
+TEST_F(SPSCQueueTest, Concurrent) {
+  int const kCount = 100000;
+  SPSCQueue<int> queue(7);
+  std::vector<int> popped;
+  popped.reserve(kCount);
+  std::thread consumer([&popped, &queue]() {
+    int value;
+    while (static_cast<int>(popped.size()) < kCount) {
+      if (queue.TryPop(&value)) {
+        popped.push_back(value);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  for (int i = 0; i < kCount; ++i) {
+    int value = i;
+    while (!queue.TryPush(std::move(value))) {
+      std::this_thread::yield();
+    }
+  }
+  consumer.join();
+  ASSERT_THAT(popped.size(), Eq(kCount));
+  for (int i = 0; i < kCount; ++i) {
+    ASSERT_THAT(popped[i], Eq(i));
+  }
+}
+
+}  // namespace base
+}  // namespace principia
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace principia {
+namespace base {
+
+// A pool of worker threads which execute the functions added to it.  Each
+// worker has its own queue: it executes the functions that it added itself
+// most recent first, and when its queue is empty it steals the oldest function
+// from the queue of another worker.  The functions added by other threads are
+// distributed among the queues in turn.  A single pool is meant to be shared by
+// all the parallel computations of a process, so that they don't oversubscribe
+// the processors.
+class ThreadPool {
+ public:
+  // Creates a pool with |number_of_threads| worker threads, which must be
+  // positive.
+  explicit ThreadPool(int const number_of_threads);
+
+  // Executes the functions that are still in the queues and joins the worker
+  // threads.
+  ~ThreadPool();
+
+  ThreadPool(ThreadPool const&) = delete;
+  ThreadPool& operator=(ThreadPool const&) = delete;
+
+  // Queues |function| for execution by one of the worker threads.  The
+  // returned future becomes ready when the execution is complete.
+  std::future<void> Add(std::function<void()> function);
+
+  // Returns when |future| is ready.  In the meantime the calling thread
+  // executes queued functions, so that a function executing on a worker thread
+  // may wait for the functions that it added without deadlocking.
+  void Join(std::future<void>& future);
+
+  // Calls |function(i)| for each |i| in [0, n[ and returns when all the calls
+  // have completed.  The calls for distinct values of |i| may be concurrent and
+  // may happen in any order.  The calling thread executes one of the calls and
+  // joins the others; this function may be called from a worker thread.
+  void ParallelFor(int const n, std::function<void(int const i)> const& function);
+
+  // Returns |reduce(...reduce(identity, map(0))..., map(n - 1))|.  The calls
+  // to |map| are executed as by |ParallelFor|, but the reduction is done by the
+  // calling thread in the order of the indices, so the result does not depend
+  // on the number of threads or on the scheduling even if |reduce| is not
+  // associative, as is the case for floating-point addition.
+  template<typename T>
+  T ParallelReduce(
+      int const n,
+      T const& identity,
+      std::function<T(int const i)> const& map,
+      std::function<T(T const& left, T const& right)> const& reduce);
+
+  int number_of_threads() const;
+
+ private:
+  struct Worker {
+    std::mutex lock;
+    std::deque<std::packaged_task<void()>> functions;  // Guarded by |lock|.
+  };
+
+  // The index of the worker running on the calling thread, or -1 if the
+  // calling thread is not a worker thread of this pool.
+  int WorkerIndex() const;
+
+  // Executes a function taken from the back of the queue of the worker with
+  // the given |index|, if it is not -1, or else from the front of the queue of
+  // another worker.  Returns false if there was nothing to execute.
+  bool TryExecuteOne(int const index);
+
+  // The body of the worker threads.
+  void DequeueAndExecute(int const index);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  // Set by the constructor, read-only thereafter.
+  std::map<std::thread::id, int> worker_indices_;
+
+  std::mutex lock_;
+  std::condition_variable has_work_;
+  // The queue to which the next function added by a thread other than a worker
+  // goes.
+  int next_worker_ = 0;  // Guarded by |lock_|.
+  // The number of functions added and not yet taken from the queues.
+  int queued_ = 0;  // Guarded by |lock_|.
+  bool shutdown_ = false;  // Guarded by |lock_|.
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace base
+}  // namespace principia
+
+#include "base/thread_pool_body.hpp"
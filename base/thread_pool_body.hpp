@@ -0,0 +1,168 @@
+#pragma once
+
+#include "base/thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace base {
+
+inline ThreadPool::ThreadPool(int const number_of_threads) {
+  CHECK_LT(0, number_of_threads);
+  for (int i = 0; i < number_of_threads; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (int i = 0; i < number_of_threads; ++i) {
+    threads_.emplace_back(&ThreadPool::DequeueAndExecute, this, i);
+    worker_indices_.emplace(threads_.back().get_id(), i);
+  }
+}
+
+inline ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    shutdown_ = true;
+  }
+  has_work_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+inline std::future<void> ThreadPool::Add(std::function<void()> function) {
+  int index = WorkerIndex();
+  std::future<void> result;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    // The functions executed during the destruction may still add functions,
+    // which the workers execute before terminating.
+    CHECK(!shutdown_ || index >= 0);
+    if (index < 0) {
+      index = next_worker_;
+      next_worker_ = (next_worker_ + 1) % static_cast<int>(workers_.size());
+    }
+    Worker& worker = *workers_[index];
+    {
+      std::lock_guard<std::mutex> worker_lock(worker.lock);
+      worker.functions.emplace_back(std::move(function));
+      result = worker.functions.back().get_future();
+    }
+    ++queued_;
+  }
+  has_work_.notify_one();
+  return result;
+}
+
+inline void ThreadPool::Join(std::future<void>& future) {
+  int const index = WorkerIndex();
+  while (future.wait_for(std::chrono::seconds(0)) !=
+             std::future_status::ready) {
+    if (!TryExecuteOne(index)) {
+      // The function is executing on another thread, but it may still add
+      // functions that we could help with: don't block for long.
+      future.wait_for(std::chrono::microseconds(50));
+    }
+  }
+}
+
+inline void ThreadPool::ParallelFor(
+    int const n,
+    std::function<void(int const i)> const& function) {
+  if (n <= 0) {
+    return;
+  }
+  std::vector<std::future<void>> futures;
+  futures.reserve(n - 1);
+  for (int i = 1; i < n; ++i) {
+    futures.push_back(Add([&function, i]() { function(i); }));
+  }
+  function(0);
+  for (auto& future : futures) {
+    Join(future);
+  }
+}
+
+template<typename T>
+T ThreadPool::ParallelReduce(
+    int const n,
+    T const& identity,
+    std::function<T(int const i)> const& map,
+    std::function<T(T const& left, T const& right)> const& reduce) {
+  if (n <= 0) {
+    return identity;
+  }
+  std::vector<T> mapped(n, identity);
+  ParallelFor(n, [&map, &mapped](int const i) { mapped[i] = map(i); });
+  T result = identity;
+  for (auto const& value : mapped) {
+    result = reduce(result, value);
+  }
+  return result;
+}
+
+inline int ThreadPool::number_of_threads() const {
+  return static_cast<int>(threads_.size());
+}
+
+inline int ThreadPool::WorkerIndex() const {
+  auto const it = worker_indices_.find(std::this_thread::get_id());
+  return it == worker_indices_.end() ? -1 : it->second;
+}
+
+inline bool ThreadPool::TryExecuteOne(int const index) {
+  int const number_of_workers = static_cast<int>(workers_.size());
+  std::packaged_task<void()> function;
+  bool found = false;
+  if (index >= 0) {
+    Worker& own = *workers_[index];
+    std::lock_guard<std::mutex> l(own.lock);
+    if (!own.functions.empty()) {
+      function = std::move(own.functions.back());
+      own.functions.pop_back();
+      found = true;
+    }
+  }
+  for (int i = 1; !found && i <= number_of_workers; ++i) {
+    int const victim = (std::max(index, 0) + i) % number_of_workers;
+    if (victim == index) {
+      continue;
+    }
+    Worker& other = *workers_[victim];
+    std::lock_guard<std::mutex> l(other.lock);
+    if (!other.functions.empty()) {
+      function = std::move(other.functions.front());
+      other.functions.pop_front();
+      found = true;
+    }
+  }
+  if (!found) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    --queued_;
+  }
+  function();
+  return true;
+}
+
+inline void ThreadPool::DequeueAndExecute(int const index) {
+  for (;;) {
+    if (TryExecuteOne(index)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> l(lock_);
+    has_work_.wait(l, [this] { return shutdown_ || queued_ > 0; });
+    if (shutdown_ && queued_ <= 0) {
+      // Shutting down and nothing left to do.
+      return;
+    }
+  }
+}
+
+}  // namespace base
+}  // namespace principia
@@ -0,0 +1,112 @@
+#include "base/thread_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Each;
+using testing::Eq;
+
+namespace principia {
+namespace base {
+
+class ThreadPoolTest : public testing::Test {
+ protected:
+  ThreadPoolTest() : pool_(4) {}
+
+  ThreadPool pool_;
+};
+
+TEST_F(ThreadPoolTest, Add) {
+  std::atomic<int> sum(0);
+  std::vector<std::future<void>> futures;
+  for (int i = 1; i <= 100; ++i) {
+    futures.push_back(pool_.Add([&sum, i]() { sum += i; }));
+  }
+  for (auto& future : futures) {
+    future.wait();
+  }
+  EXPECT_THAT(sum, Eq(5050));
+}
+
+TEST_F(ThreadPoolTest, ParallelFor) {
+  EXPECT_THAT(pool_.number_of_threads(), Eq(4));
+  std::vector<int> calls(37, 0);
+  pool_.ParallelFor(calls.size(), [&calls](int const i) { ++calls[i]; });
+  EXPECT_THAT(calls, Each(Eq(1)));
+  // Nothing to do.
+  pool_.ParallelFor(0, [](int const i) { FAIL(); });
+}
+
+// Checks that functions executing on the worker threads may themselves fork
+// and join, even if there is a single worker.
+TEST_F(ThreadPoolTest, NestedParallelFor) {
+  ThreadPool single_thread_pool(1);
+  for (ThreadPool* const pool : {&pool_, &single_thread_pool}) {
+    std::vector<std::vector<int>> calls(7, std::vector<int>(11, 0));
+    pool->ParallelFor(
+        calls.size(),
+        [pool, &calls](int const i) {
+          pool->ParallelFor(calls[i].size(),
+                            [&calls, i](int const j) { ++calls[i][j]; });
+        });
+    for (auto const& row : calls) {
+      EXPECT_THAT(row, Each(Eq(1)));
+    }
+    std::future<void> inner;
+    std::future<void> outer = pool->Add([pool, &inner]() {
+      inner = pool->Add([]() {});
+      pool->Join(inner);
+    });
+    pool->Join(outer);
+    EXPECT_EQ(std::future_status::ready,
+              inner.wait_for(std::chrono::seconds(0)));
+  }
+}
+
+// Checks that the reduction is done in the order of the indices: floating-point
+// addition is not associative, and the terms below have widely different
+// magnitudes.
+TEST_F(ThreadPoolTest, ParallelReduce) {
+  int const n = 1000;
+  std::vector<double> terms;
+  double serial = 0;
+  for (int i = 0; i < n; ++i) {
+    terms.push_back(std::pow(-1.7, i % 40) / (i + 1));
+    serial += terms.back();
+  }
+  for (int number_of_threads = 1; number_of_threads <= 8; ++number_of_threads) {
+    ThreadPool pool(number_of_threads);
+    double const parallel = pool.ParallelReduce<double>(
+        n,
+        0.0,
+        [&terms](int const i) { return terms[i]; },
+        [](double const& left, double const& right) { return left + right; });
+    EXPECT_EQ(serial, parallel) << number_of_threads;
+  }
+  EXPECT_EQ(42, pool_.ParallelReduce<int>(
+                    0,
+                    42,
+                    [](int const i) { return i; },
+                    [](int const& left, int const& right) { return 0; }));
+}
+
+// Checks that the destructor executes the functions that are still queued.
+TEST_F(ThreadPoolTest, Destruction) {
+  std::atomic<int> count(0);
+  {
+    ThreadPool pool(1);
+    for (int i = 0; i < 10; ++i) {
+      pool.Add([&count]() { ++count; });
+    }
+  }
+  EXPECT_THAT(count, Eq(10));
+}
+
+}  // namespace base
+}  // namespace principia
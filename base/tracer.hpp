@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/not_null.hpp"
+
+namespace principia {
+namespace base {
+
+// A tracer which records timed events and writes them to a file in the Chrome
+// trace event format, which can be loaded in chrome://tracing or Perfetto.
+// The events are recorded in a ring buffer of fixed capacity, which is flushed
+// to the file by a background thread, so that recording an event never does
+// any I/O.  If the background thread falls behind, the oldest events are
+// dropped.
+class Tracer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // Creates a tracer whose ring buffer holds |capacity| events, which must be
+  // positive.  The tracer is initially disabled.
+  explicit Tracer(std::int64_t const capacity);
+
+  // Stops the tracer if it is enabled.
+  ~Tracer();
+
+  Tracer(Tracer const&) = delete;
+  Tracer& operator=(Tracer const&) = delete;
+
+  // Enables the tracer and starts writing the events to the file |filename|,
+  // which is overwritten.  The tracer must be disabled.  |Start| and |Stop|
+  // must not be called concurrently.
+  void Start(std::string const& filename);
+
+  // Disables the tracer, writes the pending events and closes the file.  Does
+  // nothing if the tracer is disabled.
+  void Stop();
+
+  bool enabled() const;
+
+  // The number of events dropped because the ring buffer was full since the
+  // last call to |Start|.
+  std::int64_t dropped_events() const;
+
+  // Records an event named |name| which started at |begin| and ended at |end|
+  // on the calling thread.  |name| must outlive the tracer, typically it is a
+  // string literal.  Does nothing if the tracer is disabled.
+  void Record(char const* const name,
+              Clock::time_point const& begin,
+              Clock::time_point const& end);
+
+  // The tracer used by |ScopedTraceEvent| by default.
+  static not_null<Tracer*> Global();
+
+ private:
+  struct Event {
+    char const* name;
+    Clock::time_point begin;
+    Clock::time_point end;
+    std::thread::id thread;
+  };
+
+  // The body of the background thread.
+  void Flush();
+
+  // Writes |events| to |file_|.  Must only be called by the background thread,
+  // or after it has been joined.
+  void Write(std::vector<Event> const& events);
+
+  std::int64_t const capacity_;
+  std::atomic<bool> enabled_;
+
+  mutable std::mutex lock_;
+  std::condition_variable has_events_;
+  // A ring buffer of |size_| events starting at index |first_|.
+  std::vector<Event> events_;  // Guarded by |lock_|.
+  std::int64_t first_ = 0;  // Guarded by |lock_|.
+  std::int64_t size_ = 0;  // Guarded by |lock_|.
+  std::int64_t dropped_events_ = 0;  // Guarded by |lock_|.
+  bool stop_ = false;  // Guarded by |lock_|.
+
+  // Only accessed by the background thread while it runs.
+  std::ofstream file_;
+  Clock::time_point origin_;
+  bool first_event_written_ = false;
+  // Chrome wants small integers for the thread ids.
+  std::map<std::thread::id, int> thread_ids_;
+
+  std::thread flusher_;
+};
+
+// Records an event spanning the lifetime of this object, if the tracer is
+// enabled when the object is constructed.  Typical usage is:
+//   ScopedTraceEvent const trace_event(__FUNCTION__);
+class ScopedTraceEvent {
+ public:
+  // Records the event in |Tracer::Global()|.  |name| must have static storage
+  // duration.
+  explicit ScopedTraceEvent(char const* const name);
+  ScopedTraceEvent(char const* const name, not_null<Tracer*> const tracer);
+  ~ScopedTraceEvent();
+
+  ScopedTraceEvent(ScopedTraceEvent const&) = delete;
+  ScopedTraceEvent& operator=(ScopedTraceEvent const&) = delete;
+
+ private:
+  char const* const name_;
+  Tracer* const tracer_;  // Null if the tracer was disabled.
+  Tracer::Clock::time_point begin_;
+};
+
+}  // namespace base
+}  // namespace principia
+
+#include "base/tracer_body.hpp"
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "base/tracer.hpp"
+
+#include <iomanip>
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace base {
+
+inline Tracer::Tracer(std::int64_t const capacity)
+    : capacity_(capacity),
+      enabled_(false) {
+  CHECK_LT(0, capacity_);
+  events_.resize(capacity_);
+}
+
+inline Tracer::~Tracer() {
+  Stop();
+}
+
+inline void Tracer::Start(std::string const& filename) {
+  CHECK(!enabled_);
+  file_.open(filename, std::ios::out | std::ios::trunc);
+  CHECK(file_.good()) << filename;
+  file_ << std::fixed << std::setprecision(3) << "[";
+  origin_ = Clock::now();
+  first_event_written_ = false;
+  thread_ids_.clear();
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    first_ = 0;
+    size_ = 0;
+    dropped_events_ = 0;
+    stop_ = false;
+  }
+  flusher_ = std::thread(&Tracer::Flush, this);
+  enabled_ = true;
+}
+
+inline void Tracer::Stop() {
+  if (!enabled_.exchange(false)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    stop_ = true;
+  }
+  has_events_.notify_one();
+  flusher_.join();
+  file_ << "\n]\n";
+  file_.close();
+}
+
+inline bool Tracer::enabled() const {
+  return enabled_;
+}
+
+inline std::int64_t Tracer::dropped_events() const {
+  std::lock_guard<std::mutex> l(lock_);
+  return dropped_events_;
+}
+
+inline void Tracer::Record(char const* const name,
+                           Clock::time_point const& begin,
+                           Clock::time_point const& end) {
+  if (!enabled_) {
+    return;
+  }
+  bool half_full;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    if (size_ == capacity_) {
+      // Overwrite the oldest event.
+      first_ = (first_ + 1) % capacity_;
+      --size_;
+      ++dropped_events_;
+    }
+    events_[(first_ + size_) % capacity_] =
+        {name, begin, end, std::this_thread::get_id()};
+    ++size_;
+    half_full = 2 * size_ >= capacity_;
+  }
+  if (half_full) {
+    has_events_.notify_one();
+  }
+}
+
+inline not_null<Tracer*> Tracer::Global() {
+  // Never destroyed, so that no thread is joined during static destruction.
+  static Tracer* const tracer = new Tracer(1 << 16);
+  return tracer;
+}
+
+inline void Tracer::Flush() {
+  std::vector<Event> events;
+  for (;;) {
+    bool stop;
+    {
+      std::unique_lock<std::mutex> l(lock_);
+      // Wake up periodically so that the file is reasonably up-to-date even
+      // if few events are recorded.
+      has_events_.wait_for(l, std::chrono::milliseconds(100), [this]() {
+        return stop_ || 2 * size_ >= capacity_;
+      });
+      events.clear();
+      for (std::int64_t i = 0; i < size_; ++i) {
+        events.push_back(events_[(first_ + i) % capacity_]);
+      }
+      first_ = 0;
+      size_ = 0;
+      stop = stop_;
+    }
+    Write(events);
+    if (stop) {
+      return;
+    }
+  }
+}
+
+inline void Tracer::Write(std::vector<Event> const& events) {
+  for (Event const& event : events) {
+    auto const inserted = thread_ids_.emplace(
+        event.thread, static_cast<int>(thread_ids_.size()));
+    std::string name;
+    for (char const* c = event.name; *c != '\0'; ++c) {
+      if (*c == '"' || *c == '\\') {
+        name.push_back('\\');
+      }
+      name.push_back(*c);
+    }
+    double const ts =
+        std::chrono::duration<double, std::micro>(event.begin - origin_)
+            .count();
+    double const dur =
+        std::chrono::duration<double, std::micro>(event.end - event.begin)
+            .count();
+    file_ << (first_event_written_ ? ",\n" : "\n")
+          << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+          << inserted.first->second << ",\"ts\":" << ts
+          << ",\"dur\":" << dur << "}";
+    first_event_written_ = true;
+  }
+  file_.flush();
+}
+
+inline ScopedTraceEvent::ScopedTraceEvent(char const* const name)
+    : ScopedTraceEvent(name, Tracer::Global()) {}
+
+inline ScopedTraceEvent::ScopedTraceEvent(char const* const name,
+                                          not_null<Tracer*> const tracer)
+    : name_(name),
+      tracer_(tracer->enabled() ? static_cast<Tracer*>(tracer) : nullptr) {
+  if (tracer_ != nullptr) {
+    begin_ = Tracer::Clock::now();
+  }
+}
+
+inline ScopedTraceEvent::~ScopedTraceEvent() {
+  if (tracer_ != nullptr) {
+    tracer_->Record(name_, begin_, Tracer::Clock::now());
+  }
+}
+
+}  // namespace base
+}  // namespace principia
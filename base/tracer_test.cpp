@@ -0,0 +1,121 @@
+#include "base/tracer.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::EndsWith;
+using testing::Eq;
+using testing::HasSubstr;
+using testing::Not;
+using testing::StartsWith;
+
+namespace principia {
+namespace base {
+
+class TracerTest : public testing::Test {
+ protected:
+  TracerTest() : filename_("tracer_test.json") {}
+
+  std::string Contents() {
+    std::ifstream file(filename_);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+  }
+
+  static int Count(std::string const& haystack, std::string const& needle) {
+    int count = 0;
+    for (std::size_t position = haystack.find(needle);
+         position != std::string::npos;
+         position = haystack.find(needle, position + 1)) {
+      ++count;
+    }
+    return count;
+  }
+
+  std::string const filename_;
+};
+
+TEST_F(TracerTest, Disabled) {
+  Tracer tracer(10);
+  EXPECT_FALSE(tracer.enabled());
+  {
+    ScopedTraceEvent const trace_event("Disabled", &tracer);
+  }
+  tracer.Stop();
+  EXPECT_THAT(tracer.dropped_events(), Eq(0));
+}
+
+TEST_F(TracerTest, Events) {
+  Tracer tracer(1000);
+  tracer.Start(filename_);
+  EXPECT_TRUE(tracer.enabled());
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&tracer]() {
+      for (int i = 0; i < 100; ++i) {
+        ScopedTraceEvent const trace_event("Thread \"event\"", &tracer);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  tracer.Stop();
+  EXPECT_FALSE(tracer.enabled());
+  {
+    // Not recorded.
+    ScopedTraceEvent const trace_event("Stopped", &tracer);
+  }
+
+  std::string const contents = Contents();
+  EXPECT_THAT(contents, StartsWith("[\n{"));
+  EXPECT_THAT(contents, EndsWith("}\n]\n"));
+  EXPECT_THAT(contents, HasSubstr("\"name\":\"Thread \\\"event\\\"\""));
+  EXPECT_THAT(contents, Not(HasSubstr("Stopped")));
+  EXPECT_THAT(Count(contents, "\"ph\":\"X\""), Eq(400));
+  EXPECT_THAT(Count(contents, "\"tid\":3,"), Eq(100));
+  EXPECT_THAT(tracer.dropped_events(), Eq(0));
+}
+
+TEST_F(TracerTest, Overflow) {
+  Tracer tracer(10);
+  tracer.Start(filename_);
+  Tracer::Clock::time_point const now = Tracer::Clock::now();
+  // Whether events are dropped depends on the scheduling of the background
+  // thread, but each event is either written or counted as dropped.
+  int const events = 100000;
+  for (int i = 0; i < events; ++i) {
+    tracer.Record("Overflow", now, now);
+  }
+  std::int64_t const dropped_events = tracer.dropped_events();
+  tracer.Stop();
+  EXPECT_THAT(Count(Contents(), "\"ph\":\"X\""), Eq(events - dropped_events));
+}
+
+TEST_F(TracerTest, Restart) {
+  Tracer tracer(10);
+  tracer.Start(filename_);
+  {
+    ScopedTraceEvent const trace_event("First", &tracer);
+  }
+  tracer.Stop();
+  tracer.Start(filename_);
+  {
+    ScopedTraceEvent const trace_event("Second", &tracer);
+  }
+  tracer.Stop();
+  std::string const contents = Contents();
+  EXPECT_THAT(contents, Not(HasSubstr("First")));
+  EXPECT_THAT(contents, HasSubstr("\"name\":\"Second\""));
+  EXPECT_THAT(contents, HasSubstr("\"tid\":0,"));
+}
+
+}  // namespace base
+}  // namespace principia
@@ -0,0 +1,559 @@
+// .\Release\benchmarks.exe --benchmark_filter=Dimensionful\|Double
+// The benchmarks of the geometry come in pairs, like those of the quantities:
+// |BM_Dimensionful<Operation>| applies the frame-typed objects of geometry/ to
+// arrays of |kSize| elements, and |BM_Double<Operation>| performs the same
+// arithmetic, in the same order, on arrays of doubles.  The benchmark
+// executable fails if a dimensionful benchmark is significantly slower than
+// its double counterpart, see main.cpp, so the overhead of the abstractions,
+// including a loss of vectorization, doesn't go unnoticed.
+
+#include <cmath>
+#include <vector>
+
+#include "geometry/affine_map.hpp"
+#include "geometry/frame.hpp"
+#include "geometry/grassmann.hpp"
+#include "geometry/point.hpp"
+#include "geometry/quaternion.hpp"
+#include "geometry/r3_element.hpp"
+#include "geometry/r3x3_matrix.hpp"
+#include "geometry/rotation.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+#include "serialization/geometry.pb.h"
+
+// Must come last to avoid conflicts when defining the CHECK macros.
+#include "benchmark/benchmark.h"
+
+using principia::geometry::AffineMap;
+using principia::geometry::Barycentre;
+using principia::geometry::Bivector;
+using principia::geometry::Commutator;
+using principia::geometry::Frame;
+using principia::geometry::InnerProduct;
+using principia::geometry::Point;
+using principia::geometry::Quaternion;
+using principia::geometry::R3Element;
+using principia::geometry::R3x3Matrix;
+using principia::geometry::Rotation;
+using principia::geometry::Vector;
+using principia::geometry::Wedge;
+using principia::quantities::Area;
+using principia::quantities::Length;
+using principia::quantities::Mass;
+using principia::si::Kilogram;
+using principia::si::Metre;
+
+namespace principia {
+namespace benchmarks {
+
+namespace {
+
+using World = Frame<serialization::Frame::TestTag,
+                    serialization::Frame::TEST1, true>;
+using Other = Frame<serialization::Frame::TestTag,
+                    serialization::Frame::TEST2, true>;
+
+// The number of elements of the inputs.
+int const kSize = 1000;
+
+// The unit quaternion of the rotation by 1 radian around (1, 2, 3).
+double const kW = std::cos(0.5);
+double const kX = std::sin(0.5) * 1 / std::sqrt(14.0);
+double const kY = std::sin(0.5) * 2 / std::sqrt(14.0);
+double const kZ = std::sin(0.5) * 3 / std::sqrt(14.0);
+
+// The |kSize| triples of coordinates (offset + i, offset + i + 1,
+// offset + i + 2), stored contiguously.
+std::vector<double> Coordinates(double const offset) {
+  std::vector<double> coordinates;
+  coordinates.reserve(3 * kSize);
+  for (int i = 0; i < kSize; ++i) {
+    coordinates.push_back(offset + i);
+    coordinates.push_back(offset + i + 1);
+    coordinates.push_back(offset + i + 2);
+  }
+  return coordinates;
+}
+
+// The same coordinates as |Coordinates|, in metres.
+std::vector<Vector<Length, World>> Vectors(double const offset) {
+  std::vector<double> const coordinates = Coordinates(offset);
+  std::vector<Vector<Length, World>> vectors;
+  vectors.reserve(kSize);
+  for (int i = 0; i < kSize; ++i) {
+    vectors.push_back(Vector<Length, World>({coordinates[3 * i] * Metre,
+                                             coordinates[3 * i + 1] * Metre,
+                                             coordinates[3 * i + 2] * Metre}));
+  }
+  return vectors;
+}
+
+std::vector<Bivector<Length, World>> Bivectors(double const offset) {
+  std::vector<Bivector<Length, World>> bivectors;
+  bivectors.reserve(kSize);
+  for (Vector<Length, World> const& vector : Vectors(offset)) {
+    bivectors.push_back(Bivector<Length, World>(vector.coordinates()));
+  }
+  return bivectors;
+}
+
+std::vector<Point<Vector<Length, World>>> Points(double const offset) {
+  std::vector<Point<Vector<Length, World>>> points;
+  points.reserve(kSize);
+  for (Vector<Length, World> const& vector : Vectors(offset)) {
+    points.push_back(World::origin + vector);
+  }
+  return points;
+}
+
+// The quaternions and matrices are made of the coordinates of three
+// consecutive vectors, so they are neither unit nor orthogonal.
+std::vector<Quaternion> Quaternions(double const offset) {
+  std::vector<double> const coordinates = Coordinates(offset);
+  std::vector<Quaternion> quaternions;
+  quaternions.reserve(kSize);
+  for (int i = 0; i < kSize; ++i) {
+    quaternions.push_back(
+        Quaternion(coordinates[3 * i] + 3,
+                   R3Element<double>(coordinates[3 * i],
+                                     coordinates[3 * i + 1],
+                                     coordinates[3 * i + 2])));
+  }
+  return quaternions;
+}
+
+std::vector<double> QuaternionComponents(double const offset) {
+  std::vector<double> const coordinates = Coordinates(offset);
+  std::vector<double> components;
+  components.reserve(4 * kSize);
+  for (int i = 0; i < kSize; ++i) {
+    components.push_back(coordinates[3 * i] + 3);
+    components.push_back(coordinates[3 * i]);
+    components.push_back(coordinates[3 * i + 1]);
+    components.push_back(coordinates[3 * i + 2]);
+  }
+  return components;
+}
+
+std::vector<R3x3Matrix> Matrices(double const offset) {
+  std::vector<double> const coordinates = Coordinates(offset);
+  std::vector<R3x3Matrix> matrices;
+  matrices.reserve(kSize);
+  for (int i = 0; i < kSize; ++i) {
+    R3Element<double> const row(coordinates[3 * i],
+                                coordinates[3 * i + 1],
+                                coordinates[3 * i + 2]);
+    matrices.push_back(R3x3Matrix(row, 2 * row, 3 * row));
+  }
+  return matrices;
+}
+
+std::vector<double> MatrixEntries(double const offset) {
+  std::vector<double> const coordinates = Coordinates(offset);
+  std::vector<double> entries;
+  entries.reserve(9 * kSize);
+  for (int i = 0; i < kSize; ++i) {
+    for (double const factor : {1.0, 2.0, 3.0}) {
+      entries.push_back(factor * coordinates[3 * i]);
+      entries.push_back(factor * coordinates[3 * i + 1]);
+      entries.push_back(factor * coordinates[3 * i + 2]);
+    }
+  }
+  return entries;
+}
+
+Rotation<World, Other> const& RotationForBenchmarks() {
+  static Rotation<World, Other> const rotation(
+      Quaternion(kW, R3Element<double>(kX, kY, kZ)));
+  return rotation;
+}
+
+// Calls |operation| with each index of the inputs, for each iteration of
+// |state|.
+template<typename Operation>
+void BenchmarkIndices(
+    Operation const& operation,
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  while (state.KeepRunning()) {
+    for (int i = 0; i < kSize; ++i) {
+      operation(i);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+// Rotates the vector at |from| by the unit quaternion (kW, kX, kY, kZ) and
+// stores the result at |to|, like |Rotation::operator()|.
+inline void RotateByQuaternion(double const* const from, double* const to) {
+  double const x = from[0];
+  double const y = from[1];
+  double const z = from[2];
+  // v × r + w r.
+  double const a = (kY * z - kZ * y) + kW * x;
+  double const b = (kZ * x - kX * z) + kW * y;
+  double const c = (kX * y - kY * x) + kW * z;
+  // r + 2 v × (v × r + w r).
+  to[0] = x + 2 * (kY * c - kZ * b);
+  to[1] = y + 2 * (kZ * a - kX * c);
+  to[2] = z + 2 * (kX * b - kY * a);
+}
+
+// The entries of the matrix of the rotation by the unit quaternion (kW, kX,
+// kY, kZ), like |Rotation::Matrix|.
+struct RotationMatrix {
+  double const m00 = 1 - 2 * (kY * kY + kZ * kZ);
+  double const m01 = 2 * (kX * kY - kW * kZ);
+  double const m02 = 2 * (kX * kZ + kW * kY);
+  double const m10 = 2 * (kX * kY + kW * kZ);
+  double const m11 = 1 - 2 * (kX * kX + kZ * kZ);
+  double const m12 = 2 * (kY * kZ - kW * kX);
+  double const m20 = 2 * (kX * kZ - kW * kY);
+  double const m21 = 2 * (kY * kZ + kW * kX);
+  double const m22 = 1 - 2 * (kX * kX + kY * kY);
+};
+
+}  // namespace
+
+void BM_DimensionfulRotationApply(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  Rotation<World, Other> const& rotation = RotationForBenchmarks();
+  std::vector<Vector<Length, World>> const vectors = Vectors(1);
+  std::vector<Vector<Length, Other>> result(kSize);
+  BenchmarkIndices([&rotation, &vectors, &result](int const i) {
+    result[i] = rotation(vectors[i]);
+  }, state);
+}
+
+void BM_DoubleRotationApply(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<double> const vectors = Coordinates(1);
+  std::vector<double> result(3 * kSize);
+  BenchmarkIndices([&vectors, &result](int const i) {
+    RotateByQuaternion(&vectors[3 * i], &result[3 * i]);
+  }, state);
+}
+
+// The batched rotation uses the matrix of the rotation, and returns a new
+// array.
+void BM_DimensionfulRotationApplyBatch(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  Rotation<World, Other> const& rotation = RotationForBenchmarks();
+  std::vector<Vector<Length, World>> const vectors = Vectors(1);
+  while (state.KeepRunning()) {
+    std::vector<Vector<Length, Other>> const result = rotation(vectors);
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+void BM_DoubleRotationApplyBatch(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  RotationMatrix m;
+  std::vector<double> const vectors = Coordinates(1);
+  while (state.KeepRunning()) {
+    std::vector<double> result(3 * kSize);
+    for (int i = 0; i < 3 * kSize; i += 3) {
+      double const x = vectors[i];
+      double const y = vectors[i + 1];
+      double const z = vectors[i + 2];
+      result[i] = m.m00 * x + m.m01 * y + m.m02 * z;
+      result[i + 1] = m.m10 * x + m.m11 * y + m.m12 * z;
+      result[i + 2] = m.m20 * x + m.m21 * y + m.m22 * z;
+    }
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+void BM_DimensionfulQuaternionMultiply(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<Quaternion> const left = Quaternions(1);
+  std::vector<Quaternion> const right = Quaternions(2);
+  std::vector<Quaternion> result(kSize);
+  BenchmarkIndices([&left, &right, &result](int const i) {
+    result[i] = left[i] * right[i];
+  }, state);
+}
+
+void BM_DoubleQuaternionMultiply(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<double> const left = QuaternionComponents(1);
+  std::vector<double> const right = QuaternionComponents(2);
+  std::vector<double> result(4 * kSize);
+  BenchmarkIndices([&left, &right, &result](int const i) {
+    double const* const l = &left[4 * i];
+    double const* const r = &right[4 * i];
+    double* const q = &result[4 * i];
+    q[0] = l[0] * r[0] - (l[1] * r[1] + l[2] * r[2] + l[3] * r[3]);
+    q[1] = l[0] * r[1] + r[0] * l[1] + (l[2] * r[3] - l[3] * r[2]);
+    q[2] = l[0] * r[2] + r[0] * l[2] + (l[3] * r[1] - l[1] * r[3]);
+    q[3] = l[0] * r[3] + r[0] * l[3] + (l[1] * r[2] - l[2] * r[1]);
+  }, state);
+}
+
+void BM_DimensionfulR3x3MatrixApply(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<R3x3Matrix> const matrices = Matrices(1);
+  std::vector<R3Element<Length>> vectors;
+  for (Vector<Length, World> const& vector : Vectors(2)) {
+    vectors.push_back(vector.coordinates());
+  }
+  std::vector<R3Element<Length>> result(kSize);
+  BenchmarkIndices([&matrices, &vectors, &result](int const i) {
+    result[i] = matrices[i] * vectors[i];
+  }, state);
+}
+
+void BM_DoubleR3x3MatrixApply(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<double> const matrices = MatrixEntries(1);
+  std::vector<double> const vectors = Coordinates(2);
+  std::vector<double> result(3 * kSize);
+  BenchmarkIndices([&matrices, &vectors, &result](int const i) {
+    double const* const m = &matrices[9 * i];
+    double const* const v = &vectors[3 * i];
+    double* const r = &result[3 * i];
+    r[0] = m[0] * v[0] + m[1] * v[1] + m[2] * v[2];
+    r[1] = m[3] * v[0] + m[4] * v[1] + m[5] * v[2];
+    r[2] = m[6] * v[0] + m[7] * v[1] + m[8] * v[2];
+  }, state);
+}
+
+void BM_DimensionfulR3x3MatrixMultiply(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<R3x3Matrix> const left = Matrices(1);
+  std::vector<R3x3Matrix> const right = Matrices(2);
+  // |R3x3Matrix| is not default-constructible.
+  std::vector<R3x3Matrix> result = left;
+  BenchmarkIndices([&left, &right, &result](int const i) {
+    result[i] = left[i] * right[i];
+  }, state);
+}
+
+void BM_DoubleR3x3MatrixMultiply(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<double> const left = MatrixEntries(1);
+  std::vector<double> const right = MatrixEntries(2);
+  std::vector<double> result(9 * kSize);
+  BenchmarkIndices([&left, &right, &result](int const i) {
+    double const* const l = &left[9 * i];
+    double const* const r = &right[9 * i];
+    double* const m = &result[9 * i];
+    for (int row = 0; row < 3; ++row) {
+      for (int column = 0; column < 3; ++column) {
+        m[3 * row + column] = l[3 * row] * r[column] +
+                              l[3 * row + 1] * r[3 + column] +
+                              l[3 * row + 2] * r[6 + column];
+      }
+    }
+  }, state);
+}
+
+void BM_DimensionfulAffineMapApply(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  AffineMap<World, Other, Length, Rotation> const map(
+      World::origin + Vector<Length, World>({1 * Metre, 2 * Metre, 3 * Metre}),
+      Other::origin + Vector<Length, Other>({4 * Metre, 5 * Metre, 6 * Metre}),
+      RotationForBenchmarks());
+  std::vector<Point<Vector<Length, World>>> const points = Points(1);
+  std::vector<Point<Vector<Length, Other>>> result(kSize);
+  BenchmarkIndices([&map, &points, &result](int const i) {
+    result[i] = map(points[i]);
+  }, state);
+}
+
+void BM_DoubleAffineMapApply(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<double> const points = Coordinates(1);
+  std::vector<double> result(3 * kSize);
+  BenchmarkIndices([&points, &result](int const i) {
+    double const displacement[3] = {points[3 * i] - 1,
+                                    points[3 * i + 1] - 2,
+                                    points[3 * i + 2] - 3};
+    double* const r = &result[3 * i];
+    RotateByQuaternion(displacement, r);
+    r[0] += 4;
+    r[1] += 5;
+    r[2] += 6;
+  }, state);
+}
+
+// The batched affine map computes the displacements from the origin, maps them
+// with the batched rotation, and adds the result to the other origin, each
+// step producing a new array.
+void BM_DimensionfulAffineMapApplyBatch(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  AffineMap<World, Other, Length, Rotation> const map(
+      World::origin + Vector<Length, World>({1 * Metre, 2 * Metre, 3 * Metre}),
+      Other::origin + Vector<Length, Other>({4 * Metre, 5 * Metre, 6 * Metre}),
+      RotationForBenchmarks());
+  std::vector<Point<Vector<Length, World>>> const points = Points(1);
+  while (state.KeepRunning()) {
+    std::vector<Point<Vector<Length, Other>>> const result = map(points);
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+void BM_DoubleAffineMapApplyBatch(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  RotationMatrix m;
+  std::vector<double> const points = Coordinates(1);
+  while (state.KeepRunning()) {
+    std::vector<double> displacements;
+    displacements.reserve(3 * kSize);
+    for (int i = 0; i < 3 * kSize; i += 3) {
+      displacements.push_back(points[i] - 1);
+      displacements.push_back(points[i + 1] - 2);
+      displacements.push_back(points[i + 2] - 3);
+    }
+    std::vector<double> mapped_displacements(3 * kSize);
+    for (int i = 0; i < 3 * kSize; i += 3) {
+      double const x = displacements[i];
+      double const y = displacements[i + 1];
+      double const z = displacements[i + 2];
+      mapped_displacements[i] = m.m00 * x + m.m01 * y + m.m02 * z;
+      mapped_displacements[i + 1] = m.m10 * x + m.m11 * y + m.m12 * z;
+      mapped_displacements[i + 2] = m.m20 * x + m.m21 * y + m.m22 * z;
+    }
+    std::vector<double> result;
+    result.reserve(3 * kSize);
+    for (int i = 0; i < 3 * kSize; i += 3) {
+      result.push_back(mapped_displacements[i] + 4);
+      result.push_back(mapped_displacements[i + 1] + 5);
+      result.push_back(mapped_displacements[i + 2] + 6);
+    }
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+// Each iteration computes the barycentre of all the points.
+void BM_DimensionfulBarycentre(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<Point<Vector<Length, World>>> const points = Points(1);
+  std::vector<Mass> masses;
+  for (int i = 0; i < kSize; ++i) {
+    masses.push_back((i + 1) * Kilogram);
+  }
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(Barycentre(points, masses));
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+void BM_DoubleBarycentre(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<double> const points = Coordinates(1);
+  std::vector<double> masses;
+  for (int i = 0; i < kSize; ++i) {
+    masses.push_back(i + 1);
+  }
+  while (state.KeepRunning()) {
+    double x = points[0] * masses[0];
+    double y = points[1] * masses[0];
+    double z = points[2] * masses[0];
+    double mass = masses[0];
+    for (int i = 1; i < kSize; ++i) {
+      x += points[3 * i] * masses[i];
+      y += points[3 * i + 1] * masses[i];
+      z += points[3 * i + 2] * masses[i];
+      mass += masses[i];
+    }
+    double barycentre[3] = {x / mass, y / mass, z / mass};
+    benchmark::DoNotOptimize(barycentre);
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+void BM_DimensionfulGrassmannInnerProduct(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<Vector<Length, World>> const left = Vectors(1);
+  std::vector<Vector<Length, World>> const right = Vectors(2);
+  std::vector<Area> result(kSize);
+  BenchmarkIndices([&left, &right, &result](int const i) {
+    result[i] = InnerProduct(left[i], right[i]);
+  }, state);
+}
+
+void BM_DoubleGrassmannInnerProduct(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<double> const left = Coordinates(1);
+  std::vector<double> const right = Coordinates(2);
+  std::vector<double> result(kSize);
+  BenchmarkIndices([&left, &right, &result](int const i) {
+    double const* const l = &left[3 * i];
+    double const* const r = &right[3 * i];
+    result[i] = l[0] * r[0] + l[1] * r[1] + l[2] * r[2];
+  }, state);
+}
+
+void BM_DimensionfulGrassmannWedge(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<Vector<Length, World>> const left = Vectors(1);
+  std::vector<Vector<Length, World>> const right = Vectors(2);
+  std::vector<Bivector<Area, World>> result(kSize);
+  BenchmarkIndices([&left, &right, &result](int const i) {
+    result[i] = Wedge(left[i], right[i]);
+  }, state);
+}
+
+// The wedge product of vectors and the commutator of bivectors both compute
+// the cross product of the coordinates.
+void BM_DoubleGrassmannWedge(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<double> const left = Coordinates(1);
+  std::vector<double> const right = Coordinates(2);
+  std::vector<double> result(3 * kSize);
+  BenchmarkIndices([&left, &right, &result](int const i) {
+    double const* const l = &left[3 * i];
+    double const* const r = &right[3 * i];
+    double* const c = &result[3 * i];
+    c[0] = l[1] * r[2] - l[2] * r[1];
+    c[1] = l[2] * r[0] - l[0] * r[2];
+    c[2] = l[0] * r[1] - l[1] * r[0];
+  }, state);
+}
+
+void BM_DimensionfulGrassmannCommutator(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<Bivector<Length, World>> const left = Bivectors(1);
+  std::vector<Bivector<Length, World>> const right = Bivectors(2);
+  std::vector<Bivector<Area, World>> result(kSize);
+  BenchmarkIndices([&left, &right, &result](int const i) {
+    result[i] = Commutator(left[i], right[i]);
+  }, state);
+}
+
+void BM_DoubleGrassmannCommutator(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  BM_DoubleGrassmannWedge(state);
+}
+
+BENCHMARK(BM_DimensionfulRotationApply);
+BENCHMARK(BM_DoubleRotationApply);
+BENCHMARK(BM_DimensionfulRotationApplyBatch);
+BENCHMARK(BM_DoubleRotationApplyBatch);
+BENCHMARK(BM_DimensionfulQuaternionMultiply);
+BENCHMARK(BM_DoubleQuaternionMultiply);
+BENCHMARK(BM_DimensionfulR3x3MatrixApply);
+BENCHMARK(BM_DoubleR3x3MatrixApply);
+BENCHMARK(BM_DimensionfulR3x3MatrixMultiply);
+BENCHMARK(BM_DoubleR3x3MatrixMultiply);
+BENCHMARK(BM_DimensionfulAffineMapApply);
+BENCHMARK(BM_DoubleAffineMapApply);
+BENCHMARK(BM_DimensionfulAffineMapApplyBatch);
+BENCHMARK(BM_DoubleAffineMapApplyBatch);
+BENCHMARK(BM_DimensionfulBarycentre);
+BENCHMARK(BM_DoubleBarycentre);
+BENCHMARK(BM_DimensionfulGrassmannInnerProduct);
+BENCHMARK(BM_DoubleGrassmannInnerProduct);
+BENCHMARK(BM_DimensionfulGrassmannWedge);
+BENCHMARK(BM_DoubleGrassmannWedge);
+BENCHMARK(BM_DimensionfulGrassmannCommutator);
+BENCHMARK(BM_DoubleGrassmannCommutator);
+
+}  // namespace benchmarks
+}  // namespace principia
@@ -0,0 +1,406 @@
+// .\Release\benchmarks.exe --benchmark_filter=Interface
+// Measures the native cost of the functions of the C interface called by the
+// game at each frame, including the marshalling of their arguments and
+// results: the construction of the |GUID|s from the C strings, the conversions
+// between |XYZ| and |R3Element|, the |QP| results, and the |LineAndIterator|
+// fetch loops.  Each per-item benchmark has a batched counterpart doing the
+// same work in a single call, so that the difference is the overhead of the
+// interface, and the payoff of batching.  The argument is the number of
+// vessels, or of points of the rendered history; the items processed are the
+// vessels, or the rendered segments.
+
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/not_null.hpp"
+#include "geometry/grassmann.hpp"
+#include "geometry/named_quantities.hpp"
+#include "geometry/permutation.hpp"
+#include "ksp_plugin/frames.hpp"
+#include "ksp_plugin/interface.hpp"
+#include "ksp_plugin/plugin.hpp"
+#include "physics/transforms.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/numbers.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+#include "testing_utilities/solar_system.hpp"
+
+// Must come last to avoid conflicts when defining the CHECK macros.
+#include "benchmark/benchmark.h"
+
+using principia::base::make_not_null_unique;
+using principia::base::not_null;
+using principia::geometry::Permutation;
+using principia::ksp_plugin::AliceSun;
+using principia::ksp_plugin::Barycentric;
+using principia::ksp_plugin::GUID;
+using principia::ksp_plugin::Index;
+using principia::ksp_plugin::Plugin;
+using principia::ksp_plugin::Rendering;
+using principia::ksp_plugin::VesselHandle;
+using principia::physics::Transforms;
+using principia::si::Degree;
+using principia::si::Radian;
+using principia::testing_utilities::ICRFJ2000Ecliptic;
+using principia::testing_utilities::SolarSystem;
+
+namespace principia {
+namespace benchmarks {
+
+namespace {
+
+// The capacity of the buffer of |principia__FetchSegments|.
+int const kSegmentsPerFetch = 1000;
+
+// The duration of a frame of the game at 1x warp, in seconds.
+double const kFrameDuration = 0.02;
+
+// The rotation of the planetarium, which matches the one given to |NewPlugin|,
+// in degrees.
+double const kPlanetariumRotation = 1 * Radian / Degree;
+
+// Twice the default step of the histories, so that each call to
+// |principia__AdvanceTime| evolves them.
+double const kHistoryPointSpacing = 20;  // Seconds.
+
+// The gravitational parameter of the Earth, in m^3/s^2.
+double const kEarthGravitationalParameter = 3.986004418e14;
+
+// The arguments of the functions of the interface for |number_of_vessels|
+// vessels, as the adapter passes them.
+class Vessels {
+ public:
+  // The vessels are in circular orbits around the Earth, with radii between
+  // 7000 and 27000 km and inclinations spread over a full turn.
+  explicit Vessels(int const number_of_vessels)
+      : guids_(number_of_vessels),
+        c_guids_(number_of_vessels),
+        parent_indices_(number_of_vessels, SolarSystem::kEarth),
+        from_parents_(number_of_vessels),
+        handles_(number_of_vessels) {
+    for (int i = 0; i < number_of_vessels; ++i) {
+      guids_[i] = "Vessel " + std::to_string(i);
+      c_guids_[i] = guids_[i].c_str();
+      double const r = 7e6 + 2e7 * i / number_of_vessels;
+      double const v = std::sqrt(kEarthGravitationalParameter / r);
+      double const inclination = 2 * π * i / number_of_vessels;
+      from_parents_[i] = {{r, 0, 0},
+                          {0, v * std::cos(inclination),
+                           v * std::sin(inclination)}};
+    }
+  }
+
+  int size() const {
+    return static_cast<int>(guids_.size());
+  }
+
+  // Inserts the vessels with one call per vessel to
+  // |principia__InsertOrKeepVessel| and to |principia__SetVesselStateOffset|.
+  void InsertPerItem(not_null<Plugin*> const plugin) {
+    for (int i = 0; i < size(); ++i) {
+      principia__InsertOrKeepVessel(plugin, c_guids_[i], parent_indices_[i]);
+      principia__SetVesselStateOffset(plugin, c_guids_[i], from_parents_[i]);
+    }
+  }
+
+  // Inserts the vessels with a single call to |principia__InsertVessels|, and
+  // records their handles.
+  void InsertBatched(not_null<Plugin*> const plugin) {
+    principia__InsertVessels(plugin,
+                             c_guids_.data(),
+                             parent_indices_.data(),
+                             from_parents_.data(),
+                             size(),
+                             handles_.data());
+  }
+
+  // Removes the vessels, which requires advancing the time of |plugin| by a
+  // frame.
+  void Remove(not_null<Plugin*> const plugin) {
+    for (int i = 0; i < size(); ++i) {
+      principia__RemoveVessel(plugin, c_guids_[i]);
+    }
+    principia__AdvanceTime(plugin,
+                           principia__current_time(plugin) + kFrameDuration,
+                           kPlanetariumRotation);
+  }
+
+  char const* const* c_guids() const {
+    return c_guids_.data();
+  }
+
+  VesselHandle const* handles() const {
+    return handles_.data();
+  }
+
+ private:
+  std::vector<GUID> guids_;
+  // Point into |guids_|.
+  std::vector<char const*> c_guids_;
+  std::vector<int> parent_indices_;
+  std::vector<QP> from_parents_;
+  std::vector<VesselHandle> handles_;
+};
+
+// Returns a plugin for the major bodies of the solar system at the launch of
+// Спутник-1, without vessels.  The celestials are inserted directly, their
+// insertion isn't benchmarked.  If |earth_and_moon_only|, the other bodies are
+// omitted, so that the histories of the celestials, which grow with those of
+// the vessels, fit in memory.
+not_null<std::unique_ptr<Plugin>> NewPlugin(bool const earth_and_moon_only) {
+  Permutation<ICRFJ2000Ecliptic, AliceSun> const looking_glass(
+      Permutation<ICRFJ2000Ecliptic, AliceSun>::XZY);
+  not_null<std::unique_ptr<SolarSystem>> const solar_system =
+      SolarSystem::AtСпутник1Launch(SolarSystem::Accuracy::kMajorBodiesOnly);
+  SolarSystem::Bodies const bodies = solar_system->massive_bodies();
+  auto plugin = make_not_null_unique<Plugin>(
+      solar_system->trajectories().front()->last().time(),
+      SolarSystem::kSun,
+      bodies[SolarSystem::kSun]->gravitational_parameter(),
+      1 * Radian);  // planetarium_rotation
+  for (std::size_t index = SolarSystem::kSun + 1;
+       index < bodies.size();
+       ++index) {
+    if (earth_and_moon_only &&
+        index != SolarSystem::kEarth && index != SolarSystem::kMoon) {
+      continue;
+    }
+    Index const parent_index = SolarSystem::parent(index);
+    plugin->InsertCelestial(
+        index,
+        bodies[index]->gravitational_parameter(),
+        parent_index,
+        looking_glass(solar_system->trajectories()[index]->
+                          last().degrees_of_freedom() -
+                      solar_system->trajectories()[parent_index]->
+                          last().degrees_of_freedom()));
+  }
+  plugin->EndInitialization();
+  return plugin;
+}
+
+void InsertVesselsBenchmark(bool const batched,
+                            not_null<benchmark::State*> const state) {
+  not_null<std::unique_ptr<Plugin>> const plugin =
+      NewPlugin(false /*earth_and_moon_only*/);
+  Vessels vessels(state->range_x());
+  while (state->KeepRunning()) {
+    if (batched) {
+      vessels.InsertBatched(plugin.get());
+    } else {
+      vessels.InsertPerItem(plugin.get());
+    }
+    state->PauseTiming();
+    vessels.Remove(plugin.get());
+    state->ResumeTiming();
+  }
+  state->SetItemsProcessed(state->iterations() * vessels.size());
+}
+
+void KeepVesselsBenchmark(bool const batched,
+                          not_null<benchmark::State*> const state) {
+  not_null<std::unique_ptr<Plugin>> const plugin =
+      NewPlugin(false /*earth_and_moon_only*/);
+  Vessels vessels(state->range_x());
+  vessels.InsertBatched(plugin.get());
+  while (state->KeepRunning()) {
+    if (batched) {
+      principia__KeepVessels(plugin.get(), vessels.handles(), vessels.size());
+    } else {
+      for (int i = 0; i < vessels.size(); ++i) {
+        benchmark::DoNotOptimize(
+            principia__InsertOrKeepVessel(plugin.get(),
+                                          vessels.c_guids()[i],
+                                          SolarSystem::kEarth));
+      }
+    }
+  }
+  state->SetItemsProcessed(state->iterations() * vessels.size());
+}
+
+enum class Query {
+  kPerGUID,
+  kPerHandle,
+  kBatched,
+};
+
+void VesselsFromParentBenchmark(Query const query,
+                                not_null<benchmark::State*> const state) {
+  not_null<std::unique_ptr<Plugin>> const plugin =
+      NewPlugin(false /*earth_and_moon_only*/);
+  Vessels vessels(state->range_x());
+  vessels.InsertBatched(plugin.get());
+  std::vector<QP> from_parents(vessels.size());
+  while (state->KeepRunning()) {
+    switch (query) {
+      case Query::kPerGUID:
+        for (int i = 0; i < vessels.size(); ++i) {
+          from_parents[i] =
+              principia__VesselFromParent(plugin.get(), vessels.c_guids()[i]);
+        }
+        break;
+      case Query::kPerHandle:
+        for (int i = 0; i < vessels.size(); ++i) {
+          from_parents[i] = principia__VesselFromParentByHandle(
+                                plugin.get(), vessels.handles()[i]);
+        }
+        break;
+      case Query::kBatched:
+        principia__VesselsFromParentByHandle(plugin.get(),
+                                             vessels.handles(),
+                                             vessels.size(),
+                                             from_parents.data());
+        break;
+    }
+    benchmark::DoNotOptimize(from_parents.data());
+  }
+  state->SetItemsProcessed(state->iterations() * vessels.size());
+}
+
+enum class Fetch {
+  kFetchAndIncrement,
+  kFetchSegments,
+  kFetchVertices,
+};
+
+// Each iteration fetches all the segments of a rendered history of
+// |state->range_x()| points.  The rendering itself isn't benchmarked, see
+// rendering.cpp.
+void FetchBenchmark(Fetch const fetch,
+                    not_null<benchmark::State*> const state) {
+  int const history_points = state->range_x();
+  not_null<std::unique_ptr<Plugin>> const plugin =
+      NewPlugin(true /*earth_and_moon_only*/);
+  Vessels vessels(1);
+  vessels.InsertBatched(plugin.get());
+  for (int i = 0; i < history_points; ++i) {
+    principia__KeepVessels(plugin.get(), vessels.handles(), vessels.size());
+    principia__AdvanceTime(
+        plugin.get(),
+        principia__current_time(plugin.get()) + kHistoryPointSpacing,
+        kPlanetariumRotation);
+  }
+  Transforms<Barycentric, Rendering, Barycentric>* transforms =
+      principia__NewBodyCentredNonRotatingTransforms(plugin.get(),
+                                                     SolarSystem::kEarth);
+  LineAndIterator* line_and_iterator = principia__RenderedVesselTrajectory(
+      plugin.get(),
+      vessels.c_guids()[0],
+      transforms,
+      {0, 0, 0},  // sun_world_position
+      0,          // tolerance
+      principia__current_time(plugin.get()) -
+          (history_points + 1) * kHistoryPointSpacing);
+  int const segments = principia__NumberOfSegments(line_and_iterator);
+  std::vector<XYZSegment> buffer(kSegmentsPerFetch);
+  std::vector<float> vertices;
+  std::vector<int> indices;
+
+  while (state->KeepRunning()) {
+    line_and_iterator->it = line_and_iterator->rendered_trajectory.begin();
+    switch (fetch) {
+      case Fetch::kFetchAndIncrement:
+        while (!principia__AtEnd(line_and_iterator)) {
+          buffer[0] = principia__FetchAndIncrement(line_and_iterator);
+        }
+        break;
+      case Fetch::kFetchSegments:
+        while (principia__FetchSegments(line_and_iterator,
+                                        kSegmentsPerFetch,
+                                        buffer.data()) > 0) {}
+        break;
+      case Fetch::kFetchVertices:
+        // The buffers are sized as the adapter does, on each frame.
+        vertices.resize(3 * principia__NumberOfVertices(line_and_iterator));
+        indices.resize(2 * principia__NumberOfSegments(line_and_iterator));
+        principia__FetchVertices(line_and_iterator,
+                                 {0, 0, 0},  // origin
+                                 vertices.data(),
+                                 indices.data());
+        break;
+    }
+    benchmark::DoNotOptimize(buffer.data());
+    benchmark::DoNotOptimize(vertices.data());
+  }
+
+  principia__DeleteLineAndIterator(&line_and_iterator);
+  principia__DeleteTransforms(&transforms);
+  state->SetItemsProcessed(state->iterations() * segments);
+  state->SetLabel(std::to_string(segments) + " segments");
+}
+
+}  // namespace
+
+// The argument of the following benchmarks is the number of vessels.
+
+void BM_InterfaceInsertVesselsPerItem(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  InsertVesselsBenchmark(false /*batched*/, &state);
+}
+
+void BM_InterfaceInsertVesselsBatched(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  InsertVesselsBenchmark(true /*batched*/, &state);
+}
+
+void BM_InterfaceKeepVesselsPerItem(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  KeepVesselsBenchmark(false /*batched*/, &state);
+}
+
+void BM_InterfaceKeepVesselsBatched(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  KeepVesselsBenchmark(true /*batched*/, &state);
+}
+
+void BM_InterfaceVesselFromParentPerGUID(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  VesselsFromParentBenchmark(Query::kPerGUID, &state);
+}
+
+void BM_InterfaceVesselFromParentPerHandle(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  VesselsFromParentBenchmark(Query::kPerHandle, &state);
+}
+
+void BM_InterfaceVesselsFromParentBatched(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  VesselsFromParentBenchmark(Query::kBatched, &state);
+}
+
+// The argument of the following benchmarks is the number of points of the
+// rendered history.
+
+void BM_InterfaceFetchAndIncrement(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  FetchBenchmark(Fetch::kFetchAndIncrement, &state);
+}
+
+void BM_InterfaceFetchSegments(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  FetchBenchmark(Fetch::kFetchSegments, &state);
+}
+
+void BM_InterfaceFetchVertices(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  FetchBenchmark(Fetch::kFetchVertices, &state);
+}
+
+BENCHMARK(BM_InterfaceInsertVesselsPerItem)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_InterfaceInsertVesselsBatched)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_InterfaceKeepVesselsPerItem)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_InterfaceKeepVesselsBatched)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_InterfaceVesselFromParentPerGUID)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_InterfaceVesselFromParentPerHandle)
+    ->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_InterfaceVesselsFromParentBatched)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_InterfaceFetchAndIncrement)->Arg(1000)->Arg(10000);
+BENCHMARK(BM_InterfaceFetchSegments)->Arg(1000)->Arg(10000);
+BENCHMARK(BM_InterfaceFetchVertices)->Arg(1000)->Arg(10000);
+
+}  // namespace benchmarks
+}  // namespace principia
@@ -1,6 +1,348 @@
+// .\Release\benchmarks.exe [--json_output=<file>] [--baseline=<file>]
+//     [--regression_threshold=<ratio>] [--performance_counters=true]
+//     <benchmark flags>
+// With --json_output, writes one JSON record per line for each run: the name
+// of the benchmark, its parameters, the number of iterations, the CPU time per
+// iteration in ns, the items processed per second as set by the benchmark
+// (e.g., force evaluations), the bytes processed per second, the number of
+// allocations and the bytes allocated per iteration, and the label.  With
+// --baseline, compares the CPU time per iteration of each benchmark with that
+// recorded in a file written by --json_output, and fails if it is larger by
+// more than --regression_threshold, 1.1 by default.  With repetitions, the
+// fastest run of each benchmark is compared.  With --performance_counters=true,
+// the benchmarks of the integrators append to their label the hardware counts
+// (cycles, instructions, cache misses, branch misses) per evaluation of the
+// forces and per step, see |PerformanceCounters|.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/allocation_hooks.hpp"
+#include "base/allocation_tracker.hpp"
+#include "base/not_null.hpp"
+#include "benchmarks/performance_counters.hpp"
+#include "glog/logging.h"
+
+// Must come last to avoid conflicts when defining the CHECK macros.
 #include "benchmark/benchmark.h"
 
+using principia::base::AllocationCounts;
+using principia::base::AllocationTracker;
+using principia::base::not_null;
+using principia::benchmarks::PerformanceCounters;
+
+namespace principia {
+namespace benchmarks {
+
+namespace {
+
+// The benchmarks |BM_Dimensionful<operation>| and |BM_Double<operation>| run
+// the same code on quantities and on doubles.  The former may not be slower
+// than the latter by more than this factor, since the quantities are supposed
+// to be free.
+double const kMaximumDimensionfulOverhead = 1.1;
+
+std::string const kDimensionfulPrefix = "BM_Dimensionful";
+std::string const kDoublePrefix = "BM_Double";
+
+// A console reporter which also records the CPU time per iteration of the
+// zero-overhead benchmarks, keyed by operation.
+class ZeroOverheadReporter : public benchmark::ConsoleReporter {
+ public:
+  void ReportRuns(std::vector<Run> const& reports) override {
+    benchmark::ConsoleReporter::ReportRuns(reports);
+    for (Run const& run : reports) {
+      // The standard deviations of repeated runs are not comparable.
+      if (run.iterations <= 0 ||
+          run.benchmark_name.find("_stddev") != std::string::npos) {
+        continue;
+      }
+      double const time_per_iteration =
+          run.cpu_accumulated_time / run.iterations;
+      if (run.benchmark_name.compare(
+              0, kDimensionfulPrefix.size(), kDimensionfulPrefix) == 0) {
+        Record(run.benchmark_name.substr(kDimensionfulPrefix.size()),
+               time_per_iteration,
+               &dimensionful_times_);
+      } else if (run.benchmark_name.compare(
+                     0, kDoublePrefix.size(), kDoublePrefix) == 0) {
+        Record(run.benchmark_name.substr(kDoublePrefix.size()),
+               time_per_iteration,
+               &double_times_);
+      }
+    }
+  }
+
+  // Prints the ratio of the dimensionful and double times for each operation
+  // for which both were run.  Returns false if any of them exceeds
+  // |kMaximumDimensionfulOverhead|.
+  bool CheckOverhead() const {
+    bool success = true;
+    for (auto const& pair : dimensionful_times_) {
+      auto const it = double_times_.find(pair.first);
+      if (it == double_times_.end() || it->second <= 0) {
+        continue;
+      }
+      double const ratio = pair.second / it->second;
+      bool const overhead = ratio > kMaximumDimensionfulOverhead;
+      std::printf("%-40s %6.3f%s\n",
+                  pair.first.c_str(),
+                  ratio,
+                  overhead ? "  OVERHEAD" : "");
+      success &= !overhead;
+    }
+    return success;
+  }
+
+ private:
+  // Keeps the smallest time for each operation, as it is the least affected by
+  // noise when there are repetitions.
+  static void Record(std::string const& operation,
+                     double const time,
+                     not_null<std::map<std::string, double>*> const times) {
+    auto const it = times->find(operation);
+    if (it == times->end() || time < it->second) {
+      (*times)[operation] = time;
+    }
+  }
+
+  std::map<std::string, double> dimensionful_times_;
+  std::map<std::string, double> double_times_;
+};
+
+// Returns |text| quoted and escaped as a JSON string.
+std::string JSONString(std::string const& text) {
+  std::string result = "\"";
+  for (char const c : text) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      result += ' ';
+    } else {
+      result += c;
+    }
+  }
+  return result + "\"";
+}
+
+// Returns the number following |"key": | in |record|, or a negative number if
+// there is none.
+double NumberField(std::string const& record, std::string const& key) {
+  std::string::size_type const position = record.find("\"" + key + "\": ");
+  if (position == std::string::npos) {
+    return -1;
+  }
+  return std::strtod(record.c_str() + position + key.size() + 4, nullptr);
+}
+
+// Returns the string following |"key": | in |record|, or the empty string if
+// there is none.  The string may not contain escaped characters.
+std::string StringField(std::string const& record, std::string const& key) {
+  std::string::size_type const begin = record.find("\"" + key + "\": \"");
+  if (begin == std::string::npos) {
+    return "";
+  }
+  std::string::size_type const first = begin + key.size() + 5;
+  return record.substr(first, record.find('"', first) - first);
+}
+
+// A reporter which, in addition to checking the zero-overhead benchmarks,
+// writes the runs as JSON records and compares them with a baseline.
+class RecordingReporter : public ZeroOverheadReporter {
+ public:
+  // |json_output| and |baseline| may be empty, in which case nothing is
+  // written, resp. compared.
+  RecordingReporter(std::string const& json_output,
+                    std::string const& baseline,
+                    double const regression_threshold)
+      : regression_threshold_(regression_threshold),
+        last_allocations_(AllocationTracker::Total()) {
+    if (!json_output.empty()) {
+      json_output_.open(json_output);
+      CHECK(json_output_.good()) << json_output;
+    }
+    if (!baseline.empty()) {
+      std::ifstream baseline_file(baseline);
+      CHECK(baseline_file.good()) << baseline;
+      std::string record;
+      while (std::getline(baseline_file, record)) {
+        std::string const benchmark = StringField(record, "benchmark");
+        double const time = NumberField(record, "ns_per_iteration");
+        if (!benchmark.empty() && time > 0) {
+          Record(benchmark, time, &baseline_times_);
+        }
+      }
+    }
+  }
+
+  void ReportRuns(std::vector<Run> const& reports) override {
+    ZeroOverheadReporter::ReportRuns(reports);
+    // The allocations are not attributed to the repetitions individually, nor
+    // separated from the setup done while the timing is paused.
+    AllocationCounts const allocations = AllocationTracker::Total();
+    std::int64_t const allocation_count =
+        allocations.allocations - last_allocations_.allocations;
+    std::int64_t const bytes = allocations.bytes - last_allocations_.bytes;
+    last_allocations_ = allocations;
+    double total_iterations = 0;
+    for (Run const& run : reports) {
+      if (IsRaw(run)) {
+        total_iterations += run.iterations;
+      }
+    }
+    for (Run const& run : reports) {
+      if (run.iterations <= 0) {
+        continue;
+      }
+      double const ns_per_iteration =
+          1E9 * run.cpu_accumulated_time / run.iterations;
+      if (IsRaw(run)) {
+        Record(run.benchmark_name, ns_per_iteration, &times_);
+      }
+      if (json_output_.is_open()) {
+        WriteRecord(
+            run,
+            ns_per_iteration,
+            total_iterations > 0 ? allocation_count / total_iterations : 0,
+            total_iterations > 0 ? bytes / total_iterations : 0);
+      }
+    }
+  }
+
+  // Prints the ratio of the current and baseline times for each benchmark
+  // which was run and is in the baseline.  Returns false if any of them
+  // exceeds |regression_threshold_|.
+  bool CheckBaseline() const {
+    bool success = true;
+    for (auto const& pair : times_) {
+      auto const it = baseline_times_.find(pair.first);
+      if (it == baseline_times_.end()) {
+        continue;
+      }
+      double const ratio = pair.second / it->second;
+      bool const regression = ratio > regression_threshold_;
+      std::printf("%-60s %14.0f %14.0f %6.3f%s\n",
+                  pair.first.c_str(),
+                  it->second,
+                  pair.second,
+                  ratio,
+                  regression ? "  REGRESSION" : "");
+      success &= !regression;
+    }
+    return success;
+  }
+
+ private:
+  // True if |run| is a repetition rather than an aggregate of repetitions.
+  static bool IsRaw(Run const& run) {
+    return run.benchmark_name.find("_mean") == std::string::npos &&
+           run.benchmark_name.find("_stddev") == std::string::npos;
+  }
+
+  // Keeps the smallest time for each benchmark.
+  static void Record(std::string const& benchmark,
+                     double const time,
+                     not_null<std::map<std::string, double>*> const times) {
+    auto const it = times->find(benchmark);
+    if (it == times->end() || time < it->second) {
+      (*times)[benchmark] = time;
+    }
+  }
+
+  // The parameters are the components of the name that follow the first '/'.
+  void WriteRecord(Run const& run,
+                   double const ns_per_iteration,
+                   double const allocations_per_iteration,
+                   double const bytes_allocated_per_iteration) {
+    std::string const& name = run.benchmark_name;
+    std::string::size_type const slash = name.find('/');
+    std::ostringstream record;
+    record.precision(17);
+    record << "{\"benchmark\": " << JSONString(name)
+           << ", \"name\": " << JSONString(name.substr(0, slash))
+           << ", \"parameters\": [";
+    if (slash != std::string::npos) {
+      std::istringstream parameters(name.substr(slash + 1));
+      std::string parameter;
+      bool first = true;
+      while (std::getline(parameters, parameter, '/')) {
+        record << (first ? "" : ", ") << JSONString(parameter);
+        first = false;
+      }
+    }
+    record << "], \"iterations\": " << run.iterations
+           << ", \"ns_per_iteration\": " << ns_per_iteration
+           << ", \"items_per_second\": " << run.items_per_second
+           << ", \"bytes_per_second\": " << run.bytes_per_second
+           << ", \"allocations_per_iteration\": " << allocations_per_iteration
+           << ", \"bytes_allocated_per_iteration\": "
+           << bytes_allocated_per_iteration
+           << ", \"label\": " << JSONString(run.report_label) << "}";
+    json_output_ << record.str() << std::endl;
+  }
+
+  double const regression_threshold_;
+  std::ofstream json_output_;
+  AllocationCounts last_allocations_;
+  // The smallest times per iteration, in ns, keyed by benchmark.
+  std::map<std::string, double> times_;
+  std::map<std::string, double> baseline_times_;
+};
+
+// If |argument| is |--flag=value|, sets |*value| and returns true.
+bool ParseFlag(std::string const& argument,
+               std::string const& flag,
+               not_null<std::string*> const value) {
+  std::string const prefix = "--" + flag + "=";
+  if (argument.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  *value = argument.substr(prefix.size());
+  return true;
+}
+
+}  // namespace
+
+}  // namespace benchmarks
+}  // namespace principia
+
 int main(int argc, char const* argv[]) {
-  benchmark::Initialize(&argc, argv);
-  benchmark::RunSpecifiedBenchmarks();
+  // Our flags are removed before the benchmark library parses the others.
+  std::string json_output;
+  std::string baseline;
+  std::string regression_threshold = "1.1";
+  std::string performance_counters = "false";
+  int benchmark_argc = 0;
+  for (int i = 0; i < argc; ++i) {
+    std::string const argument = argv[i];
+    if (i == 0 ||
+        !(principia::benchmarks::ParseFlag(
+              argument, "json_output", &json_output) ||
+          principia::benchmarks::ParseFlag(argument, "baseline", &baseline) ||
+          principia::benchmarks::ParseFlag(
+              argument, "regression_threshold", &regression_threshold) ||
+          principia::benchmarks::ParseFlag(
+              argument, "performance_counters", &performance_counters))) {
+      argv[benchmark_argc++] = argv[i];
+    }
+  }
+  if (performance_counters == "true") {
+    PerformanceCounters::Enable();
+  }
+  benchmark::Initialize(&benchmark_argc, argv);
+  principia::benchmarks::RecordingReporter reporter(
+      json_output,
+      baseline,
+      std::strtod(regression_threshold.c_str(), nullptr));
+  benchmark::RunSpecifiedBenchmarks(&reporter);
+  bool const no_overhead = reporter.CheckOverhead();
+  bool const no_regression = reporter.CheckBaseline();
+  return no_overhead && no_regression ? 0 : 1;
 }
@@ -19,21 +19,68 @@
 // BM_SolarSystemAllBodiesAndOblateness        56853646016 56503562200          1                                 +1.00027592630012310e+00 ua  // NOLINT(whitespace/line_length)
 // BM_SolarSystemAllBodiesAndOblateness_mean   57251095748 56732363667          1                                 +1.00027592630012310e+00 ua  // NOLINT(whitespace/line_length)
 // BM_SolarSystemAllBodiesAndOblateness_stddev   296283293   323574137          0                                 +1.00027592630012310e+00 ua  // NOLINT(whitespace/line_length)
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 
+#include "base/allocation_tracker.hpp"
 #include "base/not_null.hpp"
+#include "base/thread_pool.hpp"
 #include "benchmarks/n_body_system.hpp"
+#include "benchmarks/performance_counters.hpp"
+#include "geometry/grassmann.hpp"
+#include "geometry/named_quantities.hpp"
+#include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "physics/degrees_of_freedom.hpp"
+#include "physics/massive_body.hpp"
+#include "physics/massless_body.hpp"
+#include "physics/trajectory.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/numbers.hpp"
 #include "quantities/quantities.hpp"
 #include "quantities/si.hpp"
 
 // Must come last to avoid conflicts when defining the CHECK macros.
 #include "benchmark/benchmark.h"
 
+using principia::base::AllocationCounts;
+using principia::base::make_not_null_unique;
 using principia::base::not_null;
+using principia::base::ScopedAllocationCounter;
+using principia::base::ThreadPool;
+using principia::geometry::Instant;
+using principia::geometry::Position;
+using principia::geometry::Vector;
+using principia::geometry::Velocity;
+using principia::integrators::SPRKIntegrator;
+using principia::physics::DegreesOfFreedom;
+using principia::physics::MassiveBody;
+using principia::physics::MasslessBody;
 using principia::physics::NBodySystem;
+using principia::physics::Trajectory;
+using principia::quantities::Angle;
+using principia::quantities::Cos;
 using principia::quantities::DebugString;
+using principia::quantities::GravitationalParameter;
+using principia::quantities::Length;
+using principia::quantities::Pow;
+using principia::quantities::Sin;
+using principia::quantities::Speed;
+using principia::quantities::Sqrt;
+using principia::quantities::Time;
 using principia::si::AstronomicalUnit;
+using principia::si::Metre;
+using principia::si::Minute;
+using principia::si::Radian;
+using principia::si::Second;
 using principia::testing_utilities::ICRFJ2000Ecliptic;
 
 namespace principia {
@@ -41,47 +88,327 @@ namespace benchmarks {
 
 namespace {
 
+// Describes the |allocations| made by |integrations| integrations.
+std::string DescribeAllocations(AllocationCounts const& allocations,
+                                std::int64_t const integrations) {
+  std::ostringstream description;
+  description << static_cast<double>(allocations.allocations) / integrations
+              << " allocations, "
+              << static_cast<double>(allocations.bytes) / integrations
+              << " bytes per integration";
+  return description.str();
+}
+
 void SolarSystemBenchmark(SolarSystem::Accuracy const accuracy,
+                          double const oblateness_accuracy,
                           not_null<benchmark::State*> const state) {
-  std::vector<quantities::Momentum> output;
+  PerformanceCounters counters;
+  AllocationCounts allocations;
+  std::int64_t integrations = 0;
+  std::int64_t force_evaluations = 0;
+  std::int64_t steps = 0;
+  std::string label;
   while (state->KeepRunning()) {
     state->PauseTiming();
     not_null<std::unique_ptr<SolarSystem>> const solar_system =
         SolarSystem::AtСпутник1Launch(accuracy);
+    Instant const t_initial =
+        solar_system->trajectories().front()->last().time();
+    state->ResumeTiming();
+    {
+      ScopedAllocationCounter const counter(&allocations);
+      counters.Start();
+      force_evaluations +=
+          SimulateSolarSystem(solar_system.get(), oblateness_accuracy);
+      counters.Stop();
+    }
+    ++integrations;
+    state->PauseTiming();
+    steps += std::llround(
+        (solar_system->trajectories().front()->last().time() - t_initial) /
+        kSolarSystemΔt);
+    label = DebugString(
+                (solar_system->trajectories()[SolarSystem::kSun]->
+                     last().degrees_of_freedom().position() -
+                 solar_system->trajectories()[SolarSystem::kEarth]->
+                     last().degrees_of_freedom().position()).Norm() /
+                AstronomicalUnit) + " ua";
     state->ResumeTiming();
-    SimulateSolarSystem(solar_system.get());
+  }
+  state->SetItemsProcessed(force_evaluations);
+  label += "; " + DescribeAllocations(allocations, integrations);
+  std::string const counts = counters.Describe(force_evaluations, steps);
+  state->SetLabel(counts.empty() ? label : label + "; " + counts);
+}
+
+// A hierarchical system made of a star, planets, moons around random planets,
+// and test particles around random massive bodies, all on nearly circular
+// orbits with small inclinations.  The satellites of a body orbit between
+// 0.1 and 0.5 of its Hill radius.  The system is generated from a fixed seed,
+// so it only depends on the numbers of bodies.
+class SyntheticSystem {
+ public:
+  // About a quarter of the |number_of_massive_bodies| - 1 bodies other than
+  // the star are planets, at least one, and the others are moons.
+  SyntheticSystem(int const number_of_massive_bodies,
+                  int const number_of_massless_bodies);
+
+  // The trajectories of the massive bodies, in order of creation, followed by
+  // those of the massless ones.  Each has a single point at |kEpoch|.
+  NBodySystem<ICRFJ2000Ecliptic>::Trajectories trajectories() const;
+
+  // Maps each planet to the star and each moon to its planet, for the
+  // hierarchical force model.
+  std::map<MassiveBody const*, MassiveBody const*> const& parents() const;
+
+ private:
+  // Appends a body on a circular orbit around the massive body of index
+  // |parent|, at a distance drawn between 0.1 and 0.5 of the Hill radius of
+  // the parent.  The body is massless if |gravitational_parameter| is zero.
+  void AddSatellite(
+      int const parent,
+      GravitationalParameter const& gravitational_parameter);
+
+  // Returns a number uniformly distributed in [min, max[ on a logarithmic
+  // scale.
+  double LogUniform(double const min, double const max);
+
+  static Instant const kEpoch;
+
+  std::mt19937_64 random_;
+  std::vector<not_null<std::unique_ptr<MassiveBody const>>> massive_bodies_;
+  std::vector<not_null<std::unique_ptr<MasslessBody const>>> massless_bodies_;
+  // The Hill radii of the |massive_bodies_|.  That of the star bounds the
+  // orbits of the planets.
+  std::vector<Length> hill_radii_;
+  std::vector<not_null<std::unique_ptr<Trajectory<ICRFJ2000Ecliptic>>>>
+      trajectories_;
+  std::map<MassiveBody const*, MassiveBody const*> parents_;
+};
+
+Instant const SyntheticSystem::kEpoch;
+
+SyntheticSystem::SyntheticSystem(int const number_of_massive_bodies,
+                                 int const number_of_massless_bodies)
+    : random_(42) {
+  CHECK_LE(2, number_of_massive_bodies);
+  massive_bodies_.push_back(make_not_null_unique<MassiveBody>(
+      1.32712440018E20 * Pow<3>(Metre) / Pow<2>(Second)));
+  // The planets orbit between 0.3 and 30 ua, and 0.1 to 0.5 of this pseudo
+  // Hill radius.
+  hill_radii_.push_back(60 * AstronomicalUnit);
+  trajectories_.push_back(
+      make_not_null_unique<Trajectory<ICRFJ2000Ecliptic>>(
+          massive_bodies_.back().get()));
+  trajectories_.back()->Append(
+      kEpoch,
+      DegreesOfFreedom<ICRFJ2000Ecliptic>(ICRFJ2000Ecliptic::origin,
+                                          Velocity<ICRFJ2000Ecliptic>()));
+  int const number_of_planets =
+      std::max(1, (number_of_massive_bodies - 1) / 4);
+  for (int i = 0; i < number_of_planets; ++i) {
+    AddSatellite(0 /*parent*/,
+                 LogUniform(1E13, 1E17) * Pow<3>(Metre) / Pow<2>(Second));
+  }
+  std::uniform_int_distribution<int> planet(1, number_of_planets);
+  for (int i = 1 + number_of_planets; i < number_of_massive_bodies; ++i) {
+    int const parent = planet(random_);
+    AddSatellite(parent,
+                 LogUniform(1E-8, 1E-3) *
+                     massive_bodies_[parent]->gravitational_parameter());
+  }
+  std::uniform_int_distribution<int> massive_body(
+      0, number_of_massive_bodies - 1);
+  for (int i = 0; i < number_of_massless_bodies; ++i) {
+    AddSatellite(massive_body(random_), GravitationalParameter());
+  }
+}
+
+NBodySystem<ICRFJ2000Ecliptic>::Trajectories
+SyntheticSystem::trajectories() const {
+  NBodySystem<ICRFJ2000Ecliptic>::Trajectories result;
+  result.reserve(trajectories_.size());
+  for (auto const& trajectory : trajectories_) {
+    result.push_back(trajectory.get());
+  }
+  return result;
+}
+
+std::map<MassiveBody const*, MassiveBody const*> const&
+SyntheticSystem::parents() const {
+  return parents_;
+}
+
+void SyntheticSystem::AddSatellite(
+    int const parent,
+    GravitationalParameter const& gravitational_parameter) {
+  MassiveBody const& parent_body = *massive_bodies_[parent];
+  GravitationalParameter const parent_μ = parent_body.gravitational_parameter();
+  Length const r = LogUniform(0.1, 0.5) * hill_radii_[parent];
+  std::uniform_real_distribution<double> uniform(0, 1);
+  Angle const longitude = 2 * π * uniform(random_) * Radian;
+  Angle const inclination = 0.1 * (2 * uniform(random_) - 1) * Radian;
+  Vector<double, ICRFJ2000Ecliptic> const radial(
+      {Cos(longitude) * Cos(inclination),
+       Sin(longitude) * Cos(inclination),
+       Sin(inclination)});
+  Vector<double, ICRFJ2000Ecliptic> const tangential(
+      {-Sin(longitude), Cos(longitude), 0});
+  DegreesOfFreedom<ICRFJ2000Ecliptic> const& parent_degrees_of_freedom =
+      trajectories_[parent]->last().degrees_of_freedom();
+  Speed const v = Sqrt((parent_μ + gravitational_parameter) / r);
+  std::unique_ptr<Trajectory<ICRFJ2000Ecliptic>> trajectory;
+  if (gravitational_parameter == GravitationalParameter()) {
+    massless_bodies_.push_back(make_not_null_unique<MasslessBody>());
+    trajectory = std::make_unique<Trajectory<ICRFJ2000Ecliptic>>(
+        massless_bodies_.back().get());
+  } else {
+    massive_bodies_.push_back(
+        make_not_null_unique<MassiveBody>(gravitational_parameter));
+    // The Hill radius of a body on a circular orbit.
+    hill_radii_.push_back(
+        r * std::cbrt(gravitational_parameter / (3 * parent_μ)));
+    parents_[massive_bodies_.back().get()] = &parent_body;
+    trajectory = std::make_unique<Trajectory<ICRFJ2000Ecliptic>>(
+        massive_bodies_.back().get());
+  }
+  trajectory->Append(
+      kEpoch,
+      DegreesOfFreedom<ICRFJ2000Ecliptic>(
+          parent_degrees_of_freedom.position() + r * radial,
+          parent_degrees_of_freedom.velocity() + v * tangential));
+  trajectories_.push_back(std::move(trajectory));
+}
+
+double SyntheticSystem::LogUniform(double const min, double const max) {
+  std::uniform_real_distribution<double> exponent(std::log(min),
+                                                  std::log(max));
+  return std::exp(exponent(random_));
+}
+
+// Integrates a |SyntheticSystem| with the given numbers of bodies for 100
+// steps of 1 min, with the hierarchical force model if |tolerance| is
+// positive, and on all the hardware threads if |parallel| is true.  An item is
+// an evaluation of the forces on all the bodies.
+void SyntheticSystemBenchmark(int const number_of_massive_bodies,
+                              int const number_of_massless_bodies,
+                              double const tolerance,
+                              bool const parallel,
+                              not_null<benchmark::State*> const state) {
+  int const kSteps = 100;
+  Time const kΔt = 1 * Minute;
+  SPRKIntegrator<Length, Speed> integrator;
+  integrator.Initialize(integrator.Order5Optimal());
+  std::unique_ptr<ThreadPool> thread_pool;
+  if (parallel) {
+    thread_pool = std::make_unique<ThreadPool>(
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+  }
+  AllocationCounts allocations;
+  std::int64_t integrations = 0;
+  std::int64_t force_evaluations = 0;
+  while (state->KeepRunning()) {
     state->PauseTiming();
-    state->SetLabel(
-        DebugString(
-            (solar_system->trajectories()[SolarSystem::kSun]->
-                 last().degrees_of_freedom().position() -
-             solar_system->trajectories()[SolarSystem::kEarth]->
-                 last().degrees_of_freedom().position()).Norm() /
-             AstronomicalUnit) + " ua");
+    SyntheticSystem const system(number_of_massive_bodies,
+                                 number_of_massless_bodies);
+    NBodySystem<ICRFJ2000Ecliptic> n_body_system;
+    n_body_system.set_thread_pool(thread_pool.get());
+    if (tolerance > 0) {
+      n_body_system.SetHierarchicalForceModel(system.parents(),
+                                              tolerance,
+                                              false /*use_quadrupole*/);
+    }
+    NBodySystem<ICRFJ2000Ecliptic>::Trajectories const trajectories =
+        system.trajectories();
+    Instant const tmax = trajectories.front()->last().time() + kSteps * kΔt;
     state->ResumeTiming();
+    {
+      ScopedAllocationCounter const counter(&allocations);
+      n_body_system.Integrate(integrator,
+                              tmax,
+                              kΔt,
+                              0,     // sampling_period
+                              true,  // tmax_is_exact
+                              trajectories);
+    }
+    ++integrations;
+    force_evaluations += n_body_system.statistics().force_evaluations;
   }
+  state->SetItemsProcessed(force_evaluations);
+  state->SetLabel(DescribeAllocations(allocations, integrations));
 }
 
 }  // namespace
 
 void BM_SolarSystemMajorBodiesOnly(
     benchmark::State& state) {  // NOLINT(runtime/references)
-  SolarSystemBenchmark(SolarSystem::Accuracy::kMajorBodiesOnly, &state);
+  SolarSystemBenchmark(SolarSystem::Accuracy::kMajorBodiesOnly,
+                       0,  // oblateness_accuracy
+                       &state);
 }
 
 void BM_SolarSystemMinorAndMajorBodies(
     benchmark::State& state) {  // NOLINT(runtime/references)
-  SolarSystemBenchmark(SolarSystem::Accuracy::kMinorAndMajorBodies, &state);
+  SolarSystemBenchmark(SolarSystem::Accuracy::kMinorAndMajorBodies,
+                       0,  // oblateness_accuracy
+                       &state);
 }
 
 void BM_SolarSystemAllBodiesAndOblateness(
     benchmark::State& state) {  // NOLINT(runtime/references)
-  SolarSystemBenchmark(SolarSystem::Accuracy::kAllBodiesAndOblateness, &state);
+  SolarSystemBenchmark(SolarSystem::Accuracy::kAllBodiesAndOblateness,
+                       0,  // oblateness_accuracy
+                       &state);
+}
+
+void BM_SolarSystemAllBodiesAndOblatenessWithCutoff(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SolarSystemBenchmark(SolarSystem::Accuracy::kAllBodiesAndOblateness,
+                       1E-9,  // oblateness_accuracy
+                       &state);
+}
+
+// The first argument is the number of massive bodies, the second the number of
+// massless bodies.
+void BM_SyntheticSystem(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SyntheticSystemBenchmark(state.range_x(), state.range_y(),
+                           0,      // tolerance
+                           false,  // parallel
+                           &state);
+}
+
+void BM_SyntheticSystemHierarchical(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SyntheticSystemBenchmark(state.range_x(), state.range_y(),
+                           1E-6,   // tolerance
+                           false,  // parallel
+                           &state);
+}
+
+void BM_SyntheticSystemParallel(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SyntheticSystemBenchmark(state.range_x(), state.range_y(),
+                           0,     // tolerance
+                           true,  // parallel
+                           &state);
 }
 
 BENCHMARK(BM_SolarSystemMajorBodiesOnly);
 BENCHMARK(BM_SolarSystemMinorAndMajorBodies);
 BENCHMARK(BM_SolarSystemAllBodiesAndOblateness);
+BENCHMARK(BM_SolarSystemAllBodiesAndOblatenessWithCutoff);
+BENCHMARK(BM_SyntheticSystem)
+    ->ArgPair(10, 0)->ArgPair(10, 100)->ArgPair(10, 10000)
+    ->ArgPair(50, 0)->ArgPair(50, 100)->ArgPair(50, 10000)
+    ->ArgPair(200, 0)->ArgPair(200, 100)->ArgPair(200, 10000)
+    ->ArgPair(64, 0)->ArgPair(100, 0)->ArgPair(400, 0)->ArgPair(1000, 0);
+BENCHMARK(BM_SyntheticSystemHierarchical)
+    ->ArgPair(10, 100)->ArgPair(10, 10000)
+    ->ArgPair(50, 100)->ArgPair(50, 10000)
+    ->ArgPair(200, 100)->ArgPair(200, 10000);
+BENCHMARK(BM_SyntheticSystemParallel)
+    ->ArgPair(10, 10000)->ArgPair(50, 10000)->ArgPair(200, 10000);
 
 }  // namespace benchmarks
 }  // namespace principia
@@ -1,20 +1,31 @@
 ﻿#pragma once
 
+#include <cstdint>
 #include <memory>
 
 #include "base/not_null.hpp"
 #include "physics/n_body_system.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
 #include "testing_utilities/solar_system.hpp"
 
 using principia::base::not_null;
 using principia::physics::NBodySystem;
+using principia::quantities::Time;
 using principia::testing_utilities::SolarSystem;
 
 namespace principia {
 namespace benchmarks {
 
-// Simulates the given |solar_system| for 100 years with a 45 min time step.
-void SimulateSolarSystem(not_null<SolarSystem*> const solar_system);
+// The time step of |SimulateSolarSystem|.
+Time const kSolarSystemΔt = 45 * si::Minute;
+
+// Simulates the given |solar_system| for 100 years with a |kSolarSystemΔt|
+// time step.
+// |oblateness_accuracy| is passed to |NBodySystem::set_oblateness_accuracy|.
+// Returns the number of evaluations of the forces.
+std::int64_t SimulateSolarSystem(not_null<SolarSystem*> const solar_system,
+                                 double const oblateness_accuracy = 0);
 
 }  // namespace benchmarks
 }  // namespace principia
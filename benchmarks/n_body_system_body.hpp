@@ -13,25 +13,27 @@ using principia::integrators::SPRKIntegrator;
 using principia::physics::NBodySystem;
 using principia::quantities::Length;
 using principia::quantities::Speed;
-using principia::si::Minute;
 using principia::testing_utilities::ICRFJ2000Ecliptic;
 using principia::testing_utilities::SolarSystem;
 
 namespace principia {
 namespace benchmarks {
 
-void SimulateSolarSystem(not_null<SolarSystem*> const solar_system) {
+std::int64_t SimulateSolarSystem(not_null<SolarSystem*> const solar_system,
+                                 double const oblateness_accuracy) {
   auto const n_body_system = std::make_unique<NBodySystem<ICRFJ2000Ecliptic>>();
+  n_body_system->set_oblateness_accuracy(oblateness_accuracy);
   auto const trajectories = solar_system->trajectories();
   SPRKIntegrator<Length, Speed> integrator;
   integrator.Initialize(integrator.Order5Optimal());
   n_body_system->Integrate(integrator,
                            trajectories.front()->last().time() +
                                100 * JulianYear,              // t_max
-                           45 * Minute,                       // Δt
+                           kSolarSystemΔt,                    // Δt
                            0,                                 // sampling_period
                            false,                             // tmax_is_exact
                            trajectories);
+  return n_body_system->statistics().force_evaluations;
 }
 
 }  // namespace benchmarks
@@ -0,0 +1,174 @@
+﻿#include "benchmarks/performance_counters.hpp"
+
+#include "base/macros.hpp"
+
+#if OS_WIN
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif OS_LINUX
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+#include <sstream>
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace benchmarks {
+
+namespace {
+
+char const* const kCounterNames[] = {
+    "cycles", "instructions", "cache misses", "branch misses"};
+
+std::int64_t* Field(int const index,
+                    PerformanceCounters::Counts* const counts) {
+  std::int64_t* const fields[] = {&counts->cycles,
+                                  &counts->instructions,
+                                  &counts->cache_misses,
+                                  &counts->branch_misses};
+  return fields[index];
+}
+
+#if OS_LINUX
+// Returns the file descriptor of a disabled counter of the calling thread
+// which excludes the kernel, or -1 if it cannot be opened.
+int OpenCounter(std::uint32_t const type, std::uint64_t const config) {
+  perf_event_attr attributes;
+  std::memset(&attributes, 0, sizeof(attributes));
+  attributes.size = sizeof(attributes);
+  attributes.type = type;
+  attributes.config = config;
+  attributes.disabled = 1;
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+  return static_cast<int>(syscall(__NR_perf_event_open,
+                                  &attributes,
+                                  /*pid=*/0,
+                                  /*cpu=*/-1,
+                                  /*group_fd=*/-1,
+                                  /*flags=*/0));
+}
+#endif
+
+}  // namespace
+
+bool PerformanceCounters::enabled_ = false;
+
+void PerformanceCounters::Enable() {
+  enabled_ = true;
+}
+
+PerformanceCounters::PerformanceCounters() {
+  for (int i = 0; i < 4; ++i) {
+    descriptors_[i] = -1;
+  }
+  if (!enabled_) {
+    return;
+  }
+#if OS_WIN
+  counts_.cycles = 0;
+#elif OS_LINUX
+  std::uint64_t const configs[] = {PERF_COUNT_HW_CPU_CYCLES,
+                                   PERF_COUNT_HW_INSTRUCTIONS,
+                                   PERF_COUNT_HW_CACHE_MISSES,
+                                   PERF_COUNT_HW_BRANCH_MISSES};
+  for (int i = 0; i < 4; ++i) {
+    descriptors_[i] = OpenCounter(PERF_TYPE_HARDWARE, configs[i]);
+    if (descriptors_[i] >= 0) {
+      *Field(i, &counts_) = 0;
+    } else {
+      LOG(WARNING) << "Cannot open the " << kCounterNames[i]
+                   << " counter, see /proc/sys/kernel/perf_event_paranoid";
+    }
+  }
+#endif
+}
+
+PerformanceCounters::~PerformanceCounters() {
+#if OS_LINUX
+  for (int const descriptor : descriptors_) {
+    if (descriptor >= 0) {
+      close(descriptor);
+    }
+  }
+#endif
+}
+
+void PerformanceCounters::Start() {
+  if (!enabled_) {
+    return;
+  }
+#if OS_WIN
+  ULONG64 cycle_time;
+  CHECK(QueryThreadCycleTime(GetCurrentThread(), &cycle_time));
+  start_cycle_time_ = cycle_time;
+#elif OS_LINUX
+  for (int const descriptor : descriptors_) {
+    if (descriptor >= 0) {
+      ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+}
+
+void PerformanceCounters::Stop() {
+  if (!enabled_) {
+    return;
+  }
+#if OS_WIN
+  ULONG64 cycle_time;
+  CHECK(QueryThreadCycleTime(GetCurrentThread(), &cycle_time));
+  counts_.cycles += cycle_time - start_cycle_time_;
+#elif OS_LINUX
+  // The counters accumulate while they are enabled, so we just read the
+  // totals.
+  for (int i = 0; i < 4; ++i) {
+    if (descriptors_[i] >= 0) {
+      ioctl(descriptors_[i], PERF_EVENT_IOC_DISABLE, 0);
+      std::uint64_t value;
+      CHECK_EQ(sizeof(value), read(descriptors_[i], &value, sizeof(value)));
+      *Field(i, &counts_) = static_cast<std::int64_t>(value);
+    }
+  }
+#endif
+}
+
+PerformanceCounters::Counts const& PerformanceCounters::counts() const {
+  return counts_;
+}
+
+std::string PerformanceCounters::Describe(
+    std::int64_t const force_evaluations,
+    std::int64_t const steps) const {
+  Counts counts = counts_;
+  std::ostringstream result;
+  result.precision(4);
+  bool first = true;
+  std::int64_t const divisors[] = {force_evaluations, steps};
+  char const* const units[] = {"evaluation", "step"};
+  for (int d = 0; d < 2; ++d) {
+    if (divisors[d] <= 0) {
+      continue;
+    }
+    for (int i = 0; i < 4; ++i) {
+      std::int64_t const count = *Field(i, &counts);
+      if (count < 0) {
+        continue;
+      }
+      result << (first ? "" : ", ")
+             << static_cast<double>(count) / divisors[d] << " "
+             << kCounterNames[i] << "/" << units[d];
+      first = false;
+    }
+  }
+  return result.str();
+}
+
+}  // namespace benchmarks
+}  // namespace principia
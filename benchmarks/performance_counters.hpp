@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace principia {
+namespace benchmarks {
+
+// The hardware performance counters of the calling thread, accumulated over
+// the intervals between calls to |Start| and |Stop|.  They are read with
+// perf_event on Linux; on Windows only the cycles are available, through
+// |QueryThreadCycleTime|.  The counters are only opened if |Enable| was called
+// before the construction, e.g., by the --performance_counters flag of the
+// benchmarks; otherwise, or if the platform or the permissions don't provide
+// them, they are unavailable and have negative values.  The work done by other
+// threads is not counted.
+class PerformanceCounters {
+ public:
+  struct Counts {
+    std::int64_t cycles = -1;
+    std::int64_t instructions = -1;
+    std::int64_t cache_misses = -1;
+    std::int64_t branch_misses = -1;
+  };
+
+  static void Enable();
+
+  PerformanceCounters();
+  ~PerformanceCounters();
+
+  PerformanceCounters(PerformanceCounters const&) = delete;
+  PerformanceCounters& operator=(PerformanceCounters const&) = delete;
+
+  void Start();
+  void Stop();
+
+  Counts const& counts() const;
+
+  // Returns a description of the available counts divided by the given
+  // numbers of evaluations of the forces and of steps, suitable for a
+  // benchmark label.  Either number may be 0, in which case the corresponding
+  // ratios are omitted.  Returns the empty string if no counter is available.
+  std::string Describe(std::int64_t const force_evaluations,
+                       std::int64_t const steps) const;
+
+ private:
+  static bool enabled_;
+
+  // The file descriptors of the perf_event counters, in the order of the
+  // fields of |Counts|, or -1 for the unavailable ones.
+  int descriptors_[4];
+  // The cycle time of the thread at the last call to |Start|.
+  std::uint64_t start_cycle_time_ = 0;
+  Counts counts_;
+};
+
+}  // namespace benchmarks
+}  // namespace principia
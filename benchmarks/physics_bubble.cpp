@@ -0,0 +1,202 @@
+// .\Release\benchmarks.exe --benchmark_filter=PhysicsBubble
+// Each iteration is one frame of the game at 1x warp, as far as the physics
+// bubble is concerned: the parts of all the vessels are added to the next
+// bubble, which is prepared, and the corrections are computed.  The first
+// argument is the number of vessels, the second the total number of parts,
+// which are spread evenly over the vessels.  The set of parts either doesn't
+// change from frame to frame, or one part per vessel is replaced (which shifts
+// the centre of mass), or all the parts are replaced (which restarts the
+// trajectory of the centre of mass).
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/not_null.hpp"
+#include "geometry/grassmann.hpp"
+#include "geometry/named_quantities.hpp"
+#include "geometry/rotation.hpp"
+#include "ksp_plugin/celestial.hpp"
+#include "ksp_plugin/frames.hpp"
+#include "ksp_plugin/part.hpp"
+#include "ksp_plugin/physics_bubble.hpp"
+#include "ksp_plugin/vessel.hpp"
+#include "physics/degrees_of_freedom.hpp"
+#include "physics/massive_body.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+
+// Must come last to avoid conflicts when defining the CHECK macros.
+#include "benchmark/benchmark.h"
+
+using principia::base::make_not_null_unique;
+using principia::base::not_null;
+using principia::geometry::Bivector;
+using principia::geometry::Displacement;
+using principia::geometry::Instant;
+using principia::geometry::Position;
+using principia::geometry::Vector;
+using principia::geometry::Velocity;
+using principia::ksp_plugin::Barycentric;
+using principia::ksp_plugin::Celestial;
+using principia::ksp_plugin::IdAndOwnedPart;
+using principia::ksp_plugin::Part;
+using principia::ksp_plugin::PartId;
+using principia::ksp_plugin::PhysicsBubble;
+using principia::ksp_plugin::Vessel;
+using principia::ksp_plugin::World;
+using principia::physics::DegreesOfFreedom;
+using principia::physics::MassiveBody;
+using principia::quantities::Acceleration;
+using principia::quantities::Time;
+using principia::si::Degree;
+using principia::si::Kilo;
+using principia::si::Kilogram;
+using principia::si::Metre;
+using principia::si::Second;
+
+namespace principia {
+namespace benchmarks {
+
+namespace {
+
+// The duration of a frame of the game at 1x warp.
+Time const kFrameDuration = 0.02 * Second;
+
+// How the set of parts changes from one frame to the next.
+enum class PartChanges {
+  kNone,
+  kOnePerVessel,
+  kAll,
+};
+
+// The parts of the vessel with index |vessel| in the given |frame|.  The
+// identifiers of the parts are unique across vessels.  Depending on |changes|,
+// none, the first, or all of them alternate between two values from one frame
+// to the next.
+std::vector<IdAndOwnedPart> VesselParts(int const vessel,
+                                        int const parts_per_vessel,
+                                        int const number_of_parts,
+                                        int const frame,
+                                        PartChanges const changes) {
+  std::vector<IdAndOwnedPart> parts;
+  for (int i = 0; i < parts_per_vessel; ++i) {
+    PartId id = vessel * parts_per_vessel + i;
+    if (changes == PartChanges::kAll) {
+      id += (frame % 2) * number_of_parts;
+    } else if (changes == PartChanges::kOnePerVessel && i == 0) {
+      id = (1 + frame % 2) * number_of_parts + vessel;
+    }
+    parts.emplace_back(
+        id,
+        make_not_null_unique<Part<World>>(
+            DegreesOfFreedom<World>(
+                World::origin +
+                    Displacement<World>({vessel * 100 * Metre,
+                                         i * Metre,
+                                         frame * 1e-3 * Metre}),
+                Velocity<World>({0 * Metre / Second,
+                                 0 * Metre / Second,
+                                 0.05 * Metre / Second})),
+            (1000 + i) * Kilogram,
+            Vector<Acceleration, World>()));
+  }
+  return parts;
+}
+
+void PhysicsBubbleBenchmark(int const number_of_vessels,
+                            int const number_of_parts,
+                            PartChanges const changes,
+                            not_null<benchmark::State*> const state) {
+  int const parts_per_vessel = number_of_parts / number_of_vessels;
+  PhysicsBubble::PlanetariumRotation const planetarium_rotation(
+      30 * Degree, Bivector<double, Barycentric>({0, 0, 1}));
+  Instant t;
+  Celestial celestial(make_not_null_unique<MassiveBody>(
+      5.97e24 * Kilogram));
+  celestial.CreateHistoryAndForkProlongation(
+      t,
+      DegreesOfFreedom<Barycentric>(
+          Barycentric::origin,
+          Velocity<Barycentric>({0 * Metre / Second,
+                                 0 * Metre / Second,
+                                 0 * Metre / Second})));
+  std::vector<std::unique_ptr<Vessel>> vessels;
+  for (int i = 0; i < number_of_vessels; ++i) {
+    vessels.push_back(std::make_unique<Vessel>(&celestial));
+    vessels.back()->CreateProlongation(
+        t,
+        DegreesOfFreedom<Barycentric>(
+            Barycentric::origin +
+                Displacement<Barycentric>({7000 * Kilo(Metre),
+                                           i * 100 * Metre,
+                                           0 * Metre}),
+            Velocity<Barycentric>({0 * Metre / Second,
+                                   7.5 * Kilo(Metre) / Second,
+                                   0 * Metre / Second})));
+  }
+
+  PhysicsBubble bubble;
+  int frame = 0;
+  while (state->KeepRunning()) {
+    for (int i = 0; i < number_of_vessels; ++i) {
+      bubble.AddVesselToNext(vessels[i].get(),
+                             VesselParts(i,
+                                         parts_per_vessel,
+                                         number_of_parts,
+                                         frame,
+                                         changes));
+    }
+    bubble.Prepare(planetarium_rotation, t, t + kFrameDuration);
+    benchmark::DoNotOptimize(
+        bubble.DisplacementCorrection(planetarium_rotation,
+                                      celestial,
+                                      World::origin));
+    benchmark::DoNotOptimize(
+        bubble.VelocityCorrection(planetarium_rotation, celestial));
+    t += kFrameDuration;
+    ++frame;
+  }
+}
+
+}  // namespace
+
+void BM_PhysicsBubbleSameParts(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  PhysicsBubbleBenchmark(state.range_x(),
+                         state.range_y(),
+                         PartChanges::kNone,
+                         &state);
+}
+
+void BM_PhysicsBubbleShiftedParts(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  PhysicsBubbleBenchmark(state.range_x(),
+                         state.range_y(),
+                         PartChanges::kOnePerVessel,
+                         &state);
+}
+
+void BM_PhysicsBubbleDisjointParts(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  PhysicsBubbleBenchmark(state.range_x(),
+                         state.range_y(),
+                         PartChanges::kAll,
+                         &state);
+}
+
+BENCHMARK(BM_PhysicsBubbleSameParts)
+    ->ArgPair(1, 10)->ArgPair(1, 100)->ArgPair(1, 2000)
+    ->ArgPair(5, 100)->ArgPair(5, 2000)
+    ->ArgPair(20, 100)->ArgPair(20, 2000);
+BENCHMARK(BM_PhysicsBubbleShiftedParts)
+    ->ArgPair(1, 10)->ArgPair(1, 100)->ArgPair(1, 2000)
+    ->ArgPair(5, 100)->ArgPair(5, 2000)
+    ->ArgPair(20, 100)->ArgPair(20, 2000);
+BENCHMARK(BM_PhysicsBubbleDisjointParts)
+    ->ArgPair(1, 10)->ArgPair(1, 100)->ArgPair(1, 2000)
+    ->ArgPair(5, 100)->ArgPair(5, 2000)
+    ->ArgPair(20, 100)->ArgPair(20, 2000);
+
+}  // namespace benchmarks
+}  // namespace principia
@@ -0,0 +1,223 @@
+
+// .\Release\benchmarks.exe --benchmark_filter=PluginFrame
+// Each iteration is one frame of the game: all the vessels are kept, the
+// vessels in the physics bubble (only at 1x warp) are given their parts, the
+// plugin advances time, the state of each vessel is queried, and the
+// trajectory of the active vessel is rendered.  The label reports the median
+// and the 99th percentile of the wall-clock duration of a frame.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/not_null.hpp"
+#include "geometry/grassmann.hpp"
+#include "geometry/named_quantities.hpp"
+#include "geometry/permutation.hpp"
+#include "ksp_plugin/frames.hpp"
+#include "ksp_plugin/part.hpp"
+#include "ksp_plugin/plugin.hpp"
+#include "physics/degrees_of_freedom.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/numbers.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+#include "testing_utilities/solar_system.hpp"
+
+// Must come last to avoid conflicts when defining the CHECK macros.
+#include "benchmark/benchmark.h"
+
+using principia::base::make_not_null_unique;
+using principia::base::not_null;
+using principia::geometry::Displacement;
+using principia::geometry::Instant;
+using principia::geometry::Permutation;
+using principia::geometry::Position;
+using principia::geometry::Vector;
+using principia::geometry::Velocity;
+using principia::ksp_plugin::AliceSun;
+using principia::ksp_plugin::GUID;
+using principia::ksp_plugin::IdAndOwnedPart;
+using principia::ksp_plugin::Index;
+using principia::ksp_plugin::Part;
+using principia::ksp_plugin::PartId;
+using principia::ksp_plugin::Plugin;
+using principia::ksp_plugin::World;
+using principia::physics::DegreesOfFreedom;
+using principia::physics::RelativeDegreesOfFreedom;
+using principia::quantities::Acceleration;
+using principia::quantities::Angle;
+using principia::quantities::Cos;
+using principia::quantities::Length;
+using principia::quantities::Sin;
+using principia::quantities::Speed;
+using principia::quantities::Sqrt;
+using principia::quantities::Time;
+using principia::si::Kilo;
+using principia::si::Kilogram;
+using principia::si::Metre;
+using principia::si::Radian;
+using principia::si::Second;
+using principia::testing_utilities::ICRFJ2000Ecliptic;
+using principia::testing_utilities::SolarSystem;
+
+namespace principia {
+namespace benchmarks {
+
+namespace {
+
+// The duration of a frame of the game at 1x warp.
+Time const kFrameDuration = 0.02 * Second;
+
+// The number of vessels in the physics bubble at 1x warp.
+int const kBubbleSize = 3;
+
+GUID VesselGUID(int const i) {
+  return "Vessel " + std::to_string(i);
+}
+
+// Returns a plugin for the major bodies of the solar system at the launch of
+// Спутник-1, with |number_of_vessels| vessels in circular orbits around the
+// Earth.  The orbits have radii between 7000 and 27000 km and inclinations
+// spread over a full turn.
+not_null<std::unique_ptr<Plugin>> NewPlugin(int const number_of_vessels) {
+  Permutation<ICRFJ2000Ecliptic, AliceSun> const looking_glass(
+      Permutation<ICRFJ2000Ecliptic, AliceSun>::XZY);
+  not_null<std::unique_ptr<SolarSystem>> const solar_system =
+      SolarSystem::AtСпутник1Launch(SolarSystem::Accuracy::kMajorBodiesOnly);
+  SolarSystem::Bodies const bodies = solar_system->massive_bodies();
+  auto plugin = make_not_null_unique<Plugin>(
+      solar_system->trajectories().front()->last().time(),
+      SolarSystem::kSun,
+      bodies[SolarSystem::kSun]->gravitational_parameter(),
+      1 * Radian);  // planetarium_rotation
+  for (std::size_t index = SolarSystem::kSun + 1;
+       index < bodies.size();
+       ++index) {
+    Index const parent_index = SolarSystem::parent(index);
+    plugin->InsertCelestial(
+        index,
+        bodies[index]->gravitational_parameter(),
+        parent_index,
+        looking_glass(solar_system->trajectories()[index]->
+                          last().degrees_of_freedom() -
+                      solar_system->trajectories()[parent_index]->
+                          last().degrees_of_freedom()));
+  }
+  plugin->EndInitialization();
+
+  for (int i = 0; i < number_of_vessels; ++i) {
+    GUID const guid = VesselGUID(i);
+    plugin->InsertOrKeepVessel(guid, SolarSystem::kEarth);
+    Length const r = 7000 * Kilo(Metre) +
+                     20000 * Kilo(Metre) * i / number_of_vessels;
+    Speed const v =
+        Sqrt(bodies[SolarSystem::kEarth]->gravitational_parameter() / r);
+    Angle const inclination = 2 * π * Radian * i / number_of_vessels;
+    plugin->SetVesselStateOffset(
+        guid,
+        RelativeDegreesOfFreedom<AliceSun>(
+            Displacement<AliceSun>({r, 0 * Metre, 0 * Metre}),
+            Velocity<AliceSun>({0 * Metre / Second,
+                                v * Cos(inclination),
+                                v * Sin(inclination)})));
+  }
+  return plugin;
+}
+
+// The parts of the |i|th vessel in the physics bubble.
+std::vector<IdAndOwnedPart> BubbleParts(int const i) {
+  std::vector<IdAndOwnedPart> parts;
+  parts.emplace_back(
+      PartId(i),
+      make_not_null_unique<Part<World>>(
+          DegreesOfFreedom<World>(
+              World::origin +
+                  Displacement<World>({i * Metre, 0 * Metre, 0 * Metre}),
+              Velocity<World>({0 * Metre / Second,
+                               0 * Metre / Second,
+                               0 * Metre / Second})),
+          1000 * Kilogram,
+          Vector<Acceleration, World>()));
+  return parts;
+}
+
+void PluginFrameBenchmark(int const number_of_vessels,
+                          int const warp,
+                          not_null<benchmark::State*> const state) {
+  not_null<std::unique_ptr<Plugin>> const plugin =
+      NewPlugin(number_of_vessels);
+  Angle const planetarium_rotation = 1 * Radian;
+  GUID const active_vessel = VesselGUID(0);
+  auto const transforms =
+      plugin->NewBodyCentredNonRotatingTransforms(SolarSystem::kEarth);
+  bool const has_bubble = warp == 1;
+  Instant const initial_time = plugin->current_time();
+  Instant t = initial_time;
+  // For the counts of allocations.
+  plugin->SetProfiling(true);
+
+  std::vector<double> frame_milliseconds;
+  while (state->KeepRunning()) {
+    auto const frame_start = std::chrono::high_resolution_clock::now();
+    t += warp * kFrameDuration;
+    for (int i = 0; i < number_of_vessels; ++i) {
+      plugin->InsertOrKeepVessel(VesselGUID(i), SolarSystem::kEarth);
+    }
+    if (has_bubble) {
+      for (int i = 0; i < std::min(kBubbleSize, number_of_vessels); ++i) {
+        plugin->AddVesselToNextPhysicsBubble(VesselGUID(i), BubbleParts(i));
+      }
+      plugin->BubbleDisplacementCorrection(World::origin);
+      plugin->BubbleVelocityCorrection(SolarSystem::kEarth);
+    }
+    plugin->AdvanceTime(t, planetarium_rotation);
+    for (int i = 0; i < number_of_vessels; ++i) {
+      benchmark::DoNotOptimize(plugin->VesselFromParent(VesselGUID(i)));
+    }
+    benchmark::DoNotOptimize(
+        plugin->RenderedVesselTrajectory(active_vessel,
+                                         transforms.get(),
+                                         World::origin,
+                                         Length(),
+                                         initial_time).size());
+    auto const frame_end = std::chrono::high_resolution_clock::now();
+    frame_milliseconds.push_back(
+        std::chrono::duration<double, std::milli>(
+            frame_end - frame_start).count());
+  }
+
+  std::sort(frame_milliseconds.begin(), frame_milliseconds.end());
+  std::size_t const size = frame_milliseconds.size();
+  Plugin::Profile const profile = plugin->profile();
+  state->SetLabel(
+      "median " + std::to_string(frame_milliseconds[size / 2]) + " ms, p99 " +
+      std::to_string(frame_milliseconds[std::min(size - 1, size * 99 / 100)]) +
+      " ms, " +
+      std::to_string(profile.advance_time_allocations.allocations /
+                     profile.advance_time_calls) +
+      " allocations per AdvanceTime, " +
+      std::to_string(profile.render_allocations.allocations /
+                     profile.render_calls) +
+      " allocations per render");
+}
+
+}  // namespace
+
+// The first argument is the number of vessels, the second the warp factor.
+void BM_PluginFrame(benchmark::State& state) {  // NOLINT(runtime/references)
+  PluginFrameBenchmark(state.range_x(), state.range_y(), &state);
+}
+
+BENCHMARK(BM_PluginFrame)
+    ->ArgPair(10, 1)->ArgPair(10, 100)->ArgPair(10, 10000)
+    ->ArgPair(100, 1)->ArgPair(100, 100)->ArgPair(100, 10000)
+    ->ArgPair(1000, 1)->ArgPair(1000, 100)->ArgPair(1000, 10000)
+    ->ArgPair(2000, 1)->ArgPair(2000, 100)->ArgPair(2000, 10000);
+
+}  // namespace benchmarks
+}  // namespace principia
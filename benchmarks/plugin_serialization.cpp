@@ -0,0 +1,267 @@
+// .\Release\benchmarks.exe --benchmark_filter=PluginSerialization
+// The first argument is the number of vessels, the second the number of points
+// appended to the histories, which are integrated before the benchmark starts;
+// since the histories are downsampled, fewer points are serialized.  The
+// write benchmark measures |Plugin::WriteToMessage| followed by
+// |SerializeToString|, the read benchmark |ParseFromString| followed by
+// |Plugin::ReadFromMessage|.  The bytes processed are those of the serialized
+// plugin.  The label reports the size of the serialized plugin, the time per
+// point of the trajectories for the Principia objects and for protobuf, and
+// the peak of the memory allocated during an iteration, over that allocated
+// before it.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "base/allocation_tracker.hpp"
+#include "base/not_null.hpp"
+#include "geometry/grassmann.hpp"
+#include "geometry/named_quantities.hpp"
+#include "geometry/permutation.hpp"
+#include "ksp_plugin/frames.hpp"
+#include "ksp_plugin/plugin.hpp"
+#include "physics/degrees_of_freedom.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/numbers.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+#include "serialization/ksp_plugin.pb.h"
+#include "serialization/physics.pb.h"
+#include "testing_utilities/solar_system.hpp"
+
+// Must come last to avoid conflicts when defining the CHECK macros.
+#include "benchmark/benchmark.h"
+
+using principia::base::AllocationTracker;
+using principia::base::make_not_null_unique;
+using principia::base::not_null;
+using principia::geometry::Displacement;
+using principia::geometry::Permutation;
+using principia::geometry::Velocity;
+using principia::ksp_plugin::AliceSun;
+using principia::ksp_plugin::GUID;
+using principia::ksp_plugin::Index;
+using principia::ksp_plugin::Plugin;
+using principia::physics::RelativeDegreesOfFreedom;
+using principia::quantities::Angle;
+using principia::quantities::Cos;
+using principia::quantities::Length;
+using principia::quantities::Sin;
+using principia::quantities::Speed;
+using principia::quantities::Sqrt;
+using principia::si::Kilo;
+using principia::si::Metre;
+using principia::si::Radian;
+using principia::si::Second;
+using principia::testing_utilities::ICRFJ2000Ecliptic;
+using principia::testing_utilities::SolarSystem;
+
+namespace principia {
+namespace benchmarks {
+
+namespace {
+
+// Returns a plugin for the major bodies of the solar system at the launch of
+// Спутник-1, with |number_of_vessels| vessels in circular orbits around the
+// Earth, to whose histories |history_points| points have been appended.
+not_null<std::unique_ptr<Plugin>> NewPlugin(int const number_of_vessels,
+                                            int const history_points) {
+  Permutation<ICRFJ2000Ecliptic, AliceSun> const looking_glass(
+      Permutation<ICRFJ2000Ecliptic, AliceSun>::XZY);
+  not_null<std::unique_ptr<SolarSystem>> const solar_system =
+      SolarSystem::AtСпутник1Launch(SolarSystem::Accuracy::kMajorBodiesOnly);
+  SolarSystem::Bodies const bodies = solar_system->massive_bodies();
+  Angle const planetarium_rotation = 1 * Radian;
+  auto plugin = make_not_null_unique<Plugin>(
+      solar_system->trajectories().front()->last().time(),
+      SolarSystem::kSun,
+      bodies[SolarSystem::kSun]->gravitational_parameter(),
+      planetarium_rotation);
+  for (std::size_t index = SolarSystem::kSun + 1;
+       index < bodies.size();
+       ++index) {
+    Index const parent_index = SolarSystem::parent(index);
+    plugin->InsertCelestial(
+        index,
+        bodies[index]->gravitational_parameter(),
+        parent_index,
+        looking_glass(solar_system->trajectories()[index]->
+                          last().degrees_of_freedom() -
+                      solar_system->trajectories()[parent_index]->
+                          last().degrees_of_freedom()));
+  }
+  plugin->EndInitialization();
+
+  for (int i = 0; i < number_of_vessels; ++i) {
+    GUID const guid = "Vessel " + std::to_string(i);
+    plugin->InsertOrKeepVessel(guid, SolarSystem::kEarth);
+    Length const r = 7000 * Kilo(Metre) +
+                     20000 * Kilo(Metre) * i / number_of_vessels;
+    Speed const v =
+        Sqrt(bodies[SolarSystem::kEarth]->gravitational_parameter() / r);
+    Angle const inclination = 2 * π * Radian * i / number_of_vessels;
+    plugin->SetVesselStateOffset(
+        guid,
+        RelativeDegreesOfFreedom<AliceSun>(
+            Displacement<AliceSun>({r, 0 * Metre, 0 * Metre}),
+            Velocity<AliceSun>({0 * Metre / Second,
+                                v * Cos(inclination),
+                                v * Sin(inclination)})));
+  }
+  // Each call to |AdvanceTime| that evolves the histories appends a single
+  // point to them, whatever the number of steps, so the time is advanced by
+  // twice the default step of the histories; the first call synchronizes the
+  // vessels.  The vessels that are not kept are removed by |AdvanceTime|, so
+  // they must be kept before each call.
+  for (int i = 0; i < history_points; ++i) {
+    for (int j = 0; j < number_of_vessels; ++j) {
+      plugin->InsertOrKeepVessel("Vessel " + std::to_string(j),
+                                 SolarSystem::kEarth);
+    }
+    plugin->AdvanceTime(plugin->current_time() + 20 * Second,
+                        planetarium_rotation);
+  }
+  return plugin;
+}
+
+// Returns the number of points of |trajectory| and of its descendants.
+std::int64_t NumberOfPoints(serialization::Trajectory const& trajectory) {
+  std::int64_t points = trajectory.timeline_size();
+  if (trajectory.has_columns()) {
+    points += trajectory.columns().t_size();
+  }
+  if (trajectory.has_compressed_columns()) {
+    points += trajectory.compressed_columns().size();
+  }
+  for (auto const& litter : trajectory.children()) {
+    for (serialization::Trajectory const& child : litter.trajectories()) {
+      points += NumberOfPoints(child);
+    }
+  }
+  return points;
+}
+
+// Returns the number of points of the trajectories of the celestials and of
+// the vessels of |message|.
+std::int64_t NumberOfPoints(serialization::Plugin const& message) {
+  std::int64_t points = 0;
+  for (auto const& celestial : message.celestial()) {
+    points += NumberOfPoints(
+        celestial.celestial().history_and_prolongation().history());
+  }
+  for (auto const& vessel : message.vessel()) {
+    if (vessel.vessel().has_history_and_prolongation()) {
+      points += NumberOfPoints(
+          vessel.vessel().history_and_prolongation().history());
+    } else {
+      points += NumberOfPoints(vessel.vessel().owned_prolongation());
+    }
+  }
+  return points;
+}
+
+double Seconds(std::chrono::steady_clock::duration const& duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+// The durations of the two phases of the serialization, and the peak of the
+// memory allocated over all iterations.
+struct Phases {
+  std::chrono::steady_clock::duration principia =
+      std::chrono::steady_clock::duration::zero();
+  std::chrono::steady_clock::duration protobuf =
+      std::chrono::steady_clock::duration::zero();
+  std::int64_t peak_bytes = 0;
+};
+
+void SetLabel(std::int64_t const serialized_bytes,
+              std::int64_t const points,
+              Phases const& phases,
+              not_null<benchmark::State*> const state) {
+  double const iterations_and_points =
+      static_cast<double>(state->iterations()) * points;
+  state->SetBytesProcessed(state->iterations() * serialized_bytes);
+  state->SetLabel(
+      std::to_string(serialized_bytes / 1e6) + " MB, " +
+      std::to_string(points) + " points, Principia " +
+      std::to_string(Seconds(phases.principia) * 1e9 / iterations_and_points) +
+      " ns/point, protobuf " +
+      std::to_string(Seconds(phases.protobuf) * 1e9 / iterations_and_points) +
+      " ns/point, peak " + std::to_string(phases.peak_bytes / 1e6) + " MB");
+}
+
+}  // namespace
+
+void BM_PluginSerializationWrite(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  not_null<std::unique_ptr<Plugin>> const plugin =
+      NewPlugin(state.range_x(), state.range_y());
+  std::int64_t serialized_bytes = 0;
+  std::int64_t points = 0;
+  Phases phases;
+  while (state.KeepRunning()) {
+    std::int64_t const live_bytes = AllocationTracker::LiveBytes();
+    AllocationTracker::ResetPeakBytes();
+    auto const start = std::chrono::steady_clock::now();
+    serialization::Plugin message;
+    plugin->WriteToMessage(&message);
+    auto const written = std::chrono::steady_clock::now();
+    std::string serialized;
+    message.SerializeToString(&serialized);
+    auto const end = std::chrono::steady_clock::now();
+    phases.principia += written - start;
+    phases.protobuf += end - written;
+    phases.peak_bytes = std::max(phases.peak_bytes,
+                                 AllocationTracker::PeakBytes() - live_bytes);
+    serialized_bytes = serialized.size();
+    if (points == 0) {
+      points = NumberOfPoints(message);
+    }
+  }
+  SetLabel(serialized_bytes, points, phases, &state);
+}
+
+void BM_PluginSerializationRead(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::string serialized;
+  std::int64_t points = 0;
+  {
+    not_null<std::unique_ptr<Plugin>> const plugin =
+        NewPlugin(state.range_x(), state.range_y());
+    serialization::Plugin message;
+    plugin->WriteToMessage(&message);
+    message.SerializeToString(&serialized);
+    points = NumberOfPoints(message);
+  }
+  Phases phases;
+  while (state.KeepRunning()) {
+    std::int64_t const live_bytes = AllocationTracker::LiveBytes();
+    AllocationTracker::ResetPeakBytes();
+    auto const start = std::chrono::steady_clock::now();
+    serialization::Plugin message;
+    message.ParseFromString(serialized);
+    auto const parsed = std::chrono::steady_clock::now();
+    std::unique_ptr<Plugin> const plugin = Plugin::ReadFromMessage(message);
+    auto const end = std::chrono::steady_clock::now();
+    phases.protobuf += parsed - start;
+    phases.principia += end - parsed;
+    phases.peak_bytes = std::max(phases.peak_bytes,
+                                 AllocationTracker::PeakBytes() - live_bytes);
+  }
+  SetLabel(serialized.size(), points, phases, &state);
+}
+
+BENCHMARK(BM_PluginSerializationWrite)
+    ->ArgPair(10, 100)->ArgPair(10, 1000)->ArgPair(10, 10000)
+    ->ArgPair(100, 100)->ArgPair(100, 1000)
+    ->ArgPair(1000, 100);
+BENCHMARK(BM_PluginSerializationRead)
+    ->ArgPair(10, 100)->ArgPair(10, 1000)->ArgPair(10, 10000)
+    ->ArgPair(100, 100)->ArgPair(100, 1000)
+    ->ArgPair(1000, 100);
+
+}  // namespace benchmarks
+}  // namespace principia
@@ -1,14 +1,248 @@
 
+// .\Release\benchmarks.exe --benchmark_filter=Dimensionful\|Double
+// The benchmarks named |BM_Dimensionful<Operation>| and |BM_Double<Operation>|
+// come in pairs which run the same code on quantities and on doubles.  The
+// benchmark executable fails if a dimensionful benchmark is significantly
+// slower than its double counterpart, see main.cpp.
+
 #include "benchmarks/quantities.hpp"
 
-#include<vector>
+#include <vector>
+
+#include "geometry/frame.hpp"
+#include "geometry/grassmann.hpp"
+#include "geometry/r3_element.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+#include "serialization/geometry.pb.h"
 
 // Must come last to avoid conflicts when defining the CHECK macros.
 #include "benchmark/benchmark.h"
 
+using principia::geometry::Frame;
+using principia::geometry::R3Element;
+using principia::geometry::Vector;
+using principia::quantities::Length;
+using principia::quantities::Pow;
+using principia::quantities::SIUnit;
+using principia::quantities::Sqrt;
+using principia::quantities::Time;
+
 namespace principia {
 namespace benchmarks {
 
+namespace {
+
+using World = Frame<serialization::Frame::TestTag,
+                    serialization::Frame::TEST, true>;
+
+// The representation of the quantities must be exactly that of a double, or
+// none of the benchmarks below make sense.
+static_assert(sizeof(Length) == sizeof(double), "Quantity is not a double");
+static_assert(sizeof(R3Element<Length>) == 3 * sizeof(double),
+              "R3Element has padding");
+static_assert(sizeof(Vector<Length, World>) == 3 * sizeof(double),
+              "Multivector has padding");
+
+// The number of elements of the inputs of the zero-overhead benchmarks.
+int const kSize = 1000;
+
+// Returns an object of type |T| whose coordinates are derived from |x|.
+template<typename T>
+struct Generator {
+  static T Make(double const x) {
+    return x * SIUnit<T>();
+  }
+};
+
+template<typename Scalar>
+struct Generator<R3Element<Scalar>> {
+  static R3Element<Scalar> Make(double const x) {
+    return R3Element<Scalar>(Generator<Scalar>::Make(x),
+                             Generator<Scalar>::Make(x + 1),
+                             Generator<Scalar>::Make(x + 2));
+  }
+};
+
+template<typename Scalar>
+struct Generator<Vector<Scalar, World>> {
+  static Vector<Scalar, World> Make(double const x) {
+    return Vector<Scalar, World>(Generator<R3Element<Scalar>>::Make(x));
+  }
+};
+
+template<typename T>
+std::vector<T> Inputs(double const offset) {
+  std::vector<T> inputs;
+  inputs.reserve(kSize);
+  for (int i = 0; i < kSize; ++i) {
+    inputs.push_back(Generator<T>::Make(offset + i));
+  }
+  return inputs;
+}
+
+// Applies |operation| to the elements of two inputs of types |Left| and
+// |Right| and stores the results in |result|, which is resized as needed.
+template<typename Left, typename Right, typename Result, typename Operation>
+void BenchmarkBinary(
+    Operation const& operation,
+    not_null<std::vector<Result>*> const result,
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<Left> const left = Inputs<Left>(1);
+  std::vector<Right> const right = Inputs<Right>(2);
+  result->resize(kSize);
+  while (state.KeepRunning()) {
+    for (int i = 0; i < kSize; ++i) {
+      (*result)[i] = operation(left[i], right[i]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+// Same as above for an operation with one argument of type |Argument|.
+template<typename Argument, typename Result, typename Operation>
+void BenchmarkUnary(
+    Operation const& operation,
+    not_null<std::vector<Result>*> const result,
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<Argument> const argument = Inputs<Argument>(1);
+  result->resize(kSize);
+  while (state.KeepRunning()) {
+    for (int i = 0; i < kSize; ++i) {
+      (*result)[i] = operation(argument[i]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+// The operations, instantiated with quantities and with doubles.
+
+template<typename L, typename T>
+void BenchmarkAdd(benchmark::State& state) {  // NOLINT(runtime/references)
+  using Result = L;
+  std::vector<Result> result;
+  BenchmarkBinary<L, L, Result>(
+      [](L const& l, L const& r) { return l + r; }, &result, state);
+}
+
+template<typename L, typename T>
+void BenchmarkSubtract(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  using Result = L;
+  std::vector<Result> result;
+  BenchmarkBinary<L, L, Result>(
+      [](L const& l, L const& r) { return l - r; }, &result, state);
+}
+
+template<typename L, typename T>
+void BenchmarkMultiply(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  using Result = decltype(L() * T());
+  std::vector<Result> result;
+  BenchmarkBinary<L, T, Result>(
+      [](L const& l, T const& t) { return l * t; }, &result, state);
+}
+
+template<typename L, typename T>
+void BenchmarkDivide(benchmark::State& state) {  // NOLINT(runtime/references)
+  using Result = decltype(L() / T());
+  std::vector<Result> result;
+  BenchmarkBinary<L, T, Result>(
+      [](L const& l, T const& t) { return l / t; }, &result, state);
+}
+
+// The argument is an area, since lengths don't have a square root.
+template<typename L, typename T>
+void BenchmarkSqrt(benchmark::State& state) {  // NOLINT(runtime/references)
+  using A = decltype(L() * L());
+  using Result = decltype(Sqrt(A()));
+  std::vector<Result> result;
+  BenchmarkUnary<A, Result>(
+      [](A const& a) { return Sqrt(a); }, &result, state);
+}
+
+template<typename L, typename T>
+void BenchmarkPow(benchmark::State& state) {  // NOLINT(runtime/references)
+  using Result = decltype(Pow<3>(L()));
+  std::vector<Result> result;
+  BenchmarkUnary<L, Result>(
+      [](L const& l) { return Pow<3>(l); }, &result, state);
+}
+
+template<typename L, typename T>
+void BenchmarkR3ElementAdd(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  using R3 = R3Element<L>;
+  using Result = R3;
+  std::vector<Result> result;
+  BenchmarkBinary<R3, R3, Result>(
+      [](R3 const& l, R3 const& r) { return l + r; }, &result, state);
+}
+
+template<typename L, typename T>
+void BenchmarkR3ElementScale(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  using R3 = R3Element<L>;
+  using Result = decltype(R3() / T());
+  std::vector<Result> result;
+  BenchmarkBinary<R3, T, Result>(
+      [](R3 const& l, T const& t) { return l / t; }, &result, state);
+}
+
+template<typename L, typename T>
+void BenchmarkR3ElementDot(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  using R3 = R3Element<L>;
+  using Result = decltype(Dot(R3(), R3()));
+  std::vector<Result> result;
+  BenchmarkBinary<R3, R3, Result>(
+      [](R3 const& l, R3 const& r) { return Dot(l, r); }, &result, state);
+}
+
+template<typename L, typename T>
+void BenchmarkR3ElementCross(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  using R3 = R3Element<L>;
+  using Result = decltype(Cross(R3(), R3()));
+  std::vector<Result> result;
+  BenchmarkBinary<R3, R3, Result>(
+      [](R3 const& l, R3 const& r) { return Cross(l, r); }, &result, state);
+}
+
+template<typename L, typename T>
+void BenchmarkVectorAdd(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  using V = Vector<L, World>;
+  using Result = V;
+  std::vector<Result> result;
+  BenchmarkBinary<V, V, Result>(
+      [](V const& l, V const& r) { return l + r; }, &result, state);
+}
+
+template<typename L, typename T>
+void BenchmarkVectorInnerProduct(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  using V = Vector<L, World>;
+  using Result = decltype(InnerProduct(V(), V()));
+  std::vector<Result> result;
+  BenchmarkBinary<V, V, Result>(
+      [](V const& l, V const& r) { return InnerProduct(l, r); },
+      &result, state);
+}
+
+template<typename L, typename T>
+void BenchmarkVectorWedge(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  using V = Vector<L, World>;
+  using Result = decltype(Wedge(V(), V()));
+  std::vector<Result> result;
+  BenchmarkBinary<V, V, Result>(
+      [](V const& l, V const& r) { return Wedge(l, r); }, &result, state);
+}
+
+}  // namespace
+
 void BM_DimensionfulDiscreteCosineTransform(
     benchmark::State& state) {  // NOLINT(runtime/references)>
   std::vector<quantities::Momentum> output;
@@ -27,5 +261,44 @@ void BM_DoubleDiscreteCosineTransform(
 }
 BENCHMARK(BM_DoubleDiscreteCosineTransform);
 
+void BM_BatchedDiscreteCosineTransform(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  std::vector<quantities::Momentum> output;
+  while (state.KeepRunning()) {
+    BatchedDiscreteCosineTransform(&output);
+  }
+}
+BENCHMARK(BM_BatchedDiscreteCosineTransform);
+
+// Defines and registers the benchmarks |BM_Dimensionful<operation>| and
+// |BM_Double<operation>|.
+#define PRINCIPIA_ZERO_OVERHEAD_BENCHMARK(operation)             \
+  void BM_Dimensionful##operation(                                \
+      benchmark::State& state) { /* NOLINT(runtime/references) */ \
+    Benchmark##operation<Length, Time>(state);                    \
+  }                                                               \
+  BENCHMARK(BM_Dimensionful##operation);                          \
+  void BM_Double##operation(                                      \
+      benchmark::State& state) { /* NOLINT(runtime/references) */ \
+    Benchmark##operation<double, double>(state);                  \
+  }                                                               \
+  BENCHMARK(BM_Double##operation)
+
+PRINCIPIA_ZERO_OVERHEAD_BENCHMARK(Add);
+PRINCIPIA_ZERO_OVERHEAD_BENCHMARK(Subtract);
+PRINCIPIA_ZERO_OVERHEAD_BENCHMARK(Multiply);
+PRINCIPIA_ZERO_OVERHEAD_BENCHMARK(Divide);
+PRINCIPIA_ZERO_OVERHEAD_BENCHMARK(Sqrt);
+PRINCIPIA_ZERO_OVERHEAD_BENCHMARK(Pow);
+PRINCIPIA_ZERO_OVERHEAD_BENCHMARK(R3ElementAdd);
+PRINCIPIA_ZERO_OVERHEAD_BENCHMARK(R3ElementScale);
+PRINCIPIA_ZERO_OVERHEAD_BENCHMARK(R3ElementDot);
+PRINCIPIA_ZERO_OVERHEAD_BENCHMARK(R3ElementCross);
+PRINCIPIA_ZERO_OVERHEAD_BENCHMARK(VectorAdd);
+PRINCIPIA_ZERO_OVERHEAD_BENCHMARK(VectorInnerProduct);
+PRINCIPIA_ZERO_OVERHEAD_BENCHMARK(VectorWedge);
+
+#undef PRINCIPIA_ZERO_OVERHEAD_BENCHMARK
+
 }  // namespace benchmarks
 }  // namespace principia
@@ -16,6 +16,11 @@ inline void DimensionfulDiscreteCosineTransform(
 inline void DoubleDiscreteCosineTransform(
     not_null<std::vector<double>*> const result);
 
+// Same as |DimensionfulDiscreteCosineTransform|, but evaluates the cosines of
+// each row with the batched |Cos|.
+inline void BatchedDiscreteCosineTransform(
+    not_null<std::vector<quantities::Momentum>*> const result);
+
 }  // namespace benchmarks
 }  // namespace principia
 
@@ -70,5 +70,38 @@ inline void DoubleDiscreteCosineTransform(
   }
 }
 
+inline void BatchedDiscreteCosineTransform(
+    not_null<std::vector<quantities::Momentum>*> const result) {
+  using quantities::Angle;
+  using quantities::Cos;
+  using quantities::Momentum;
+  using quantities::SIUnit;
+  using si::Radian;
+  std::vector<Momentum> input(kDimension);
+  for (std::size_t i = 0; i < kDimension; ++i) {
+    input[i] = i * SIUnit<Momentum>();
+  }
+  result->resize(kDimension);
+  std::vector<Angle> angles(kDimension - 2);
+  std::vector<double> cosines;
+  double sign = 1;
+  Momentum sum;
+  for (std::size_t k = 0; k < kDimension; ++k, sign *= -1) {
+    for (std::size_t n = 1; n < kDimension - 1; ++n) {
+      angles[n - 1] = π * Radian / (kDimension - 1) * n * k;
+    }
+    Cos(angles, &cosines);
+    sum = Momentum();
+    for (std::size_t n = 1; n < kDimension - 1; ++n) {
+      sum += input[n] * cosines[n - 1];
+    }
+#ifdef TRIGGER_DEAD_CODE_ELIMINATION
+    (*result)[k] = 0.5 * (input[0] + sign * input[kDimension - 1]);
+#else
+    (*result)[k] = 0.5 * (input[0] + sign * input[kDimension - 1]) + sum;
+#endif
+  }
+}
+
 }  // namespace benchmarks
 }  // namespace principia
@@ -0,0 +1,235 @@
+// .\Release\benchmarks.exe --benchmark_filter=Rendering
+// Each iteration renders the history of a vessel in a low orbit around the
+// Earth through |Plugin::RenderedVesselTrajectory|, without simplification.
+// The argument is the number of points appended to the history, which is
+// integrated before the benchmark starts; since the history is downsampled,
+// fewer points are rendered.  In the cold benchmarks the transforms are created
+// for each iteration, so that the cache of their first transform is empty; in
+// the warm benchmarks they are reused, and their cache is large enough to hold
+// the entire history.  The items processed are the rendered
+// points; the label reports their number, the time per point and the
+// allocations per rendering.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "base/not_null.hpp"
+#include "geometry/grassmann.hpp"
+#include "geometry/named_quantities.hpp"
+#include "geometry/permutation.hpp"
+#include "ksp_plugin/frames.hpp"
+#include "ksp_plugin/plugin.hpp"
+#include "physics/degrees_of_freedom.hpp"
+#include "physics/transforms.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+#include "testing_utilities/solar_system.hpp"
+
+// Must come last to avoid conflicts when defining the CHECK macros.
+#include "benchmark/benchmark.h"
+
+using principia::base::make_not_null_unique;
+using principia::base::not_null;
+using principia::geometry::Displacement;
+using principia::geometry::Instant;
+using principia::geometry::Permutation;
+using principia::geometry::Velocity;
+using principia::ksp_plugin::AliceSun;
+using principia::ksp_plugin::Barycentric;
+using principia::ksp_plugin::GUID;
+using principia::ksp_plugin::Index;
+using principia::ksp_plugin::Plugin;
+using principia::ksp_plugin::Rendering;
+using principia::ksp_plugin::World;
+using principia::physics::RelativeDegreesOfFreedom;
+using principia::physics::Transforms;
+using principia::quantities::Angle;
+using principia::quantities::Length;
+using principia::quantities::Speed;
+using principia::quantities::Sqrt;
+using principia::quantities::Time;
+using principia::si::Kilo;
+using principia::si::Metre;
+using principia::si::Radian;
+using principia::si::Second;
+using principia::testing_utilities::ICRFJ2000Ecliptic;
+using principia::testing_utilities::SolarSystem;
+
+namespace principia {
+namespace benchmarks {
+
+namespace {
+
+GUID const kVessel = "Vessel";
+
+// Twice the default step of the histories, so that each call to
+// |AdvanceTime| evolves them.
+Time const kHistoryPointSpacing = 20 * Second;
+
+// The frames in which the history is rendered.
+enum class RenderingFrame {
+  kBodyCentredNonRotating,
+  kBarycentricRotating,
+};
+
+// Returns a plugin for the Sun, the Earth and the Moon at the launch of
+// Спутник-1, with a vessel in a circular orbit around the Earth, to whose
+// history |history_points| points have been appended.  The other bodies are
+// omitted so that the histories of the celestials, which grow with that of the
+// vessel, fit in memory.
+not_null<std::unique_ptr<Plugin>> NewPlugin(int const history_points) {
+  Permutation<ICRFJ2000Ecliptic, AliceSun> const looking_glass(
+      Permutation<ICRFJ2000Ecliptic, AliceSun>::XZY);
+  not_null<std::unique_ptr<SolarSystem>> const solar_system =
+      SolarSystem::AtСпутник1Launch(SolarSystem::Accuracy::kMajorBodiesOnly);
+  SolarSystem::Bodies const bodies = solar_system->massive_bodies();
+  Angle const planetarium_rotation = 1 * Radian;
+  auto plugin = make_not_null_unique<Plugin>(
+      solar_system->trajectories().front()->last().time(),
+      SolarSystem::kSun,
+      bodies[SolarSystem::kSun]->gravitational_parameter(),
+      planetarium_rotation);
+  for (Index const index : {SolarSystem::kEarth, SolarSystem::kMoon}) {
+    Index const parent_index = SolarSystem::parent(index);
+    plugin->InsertCelestial(
+        index,
+        bodies[index]->gravitational_parameter(),
+        parent_index,
+        looking_glass(solar_system->trajectories()[index]->
+                          last().degrees_of_freedom() -
+                      solar_system->trajectories()[parent_index]->
+                          last().degrees_of_freedom()));
+  }
+  plugin->EndInitialization();
+
+  plugin->InsertOrKeepVessel(kVessel, SolarSystem::kEarth);
+  Length const r = 7000 * Kilo(Metre);
+  Speed const v =
+      Sqrt(bodies[SolarSystem::kEarth]->gravitational_parameter() / r);
+  plugin->SetVesselStateOffset(
+      kVessel,
+      RelativeDegreesOfFreedom<AliceSun>(
+          Displacement<AliceSun>({r, 0 * Metre, 0 * Metre}),
+          Velocity<AliceSun>({0 * Metre / Second, v, 0 * Metre / Second})));
+  // Each call to |AdvanceTime| that evolves the histories appends a single
+  // point to them, whatever the number of steps; the first one synchronizes
+  // the vessel.  The vessel is removed by |AdvanceTime| if it is not kept
+  // before each call.
+  for (int i = 0; i < history_points; ++i) {
+    plugin->InsertOrKeepVessel(kVessel, SolarSystem::kEarth);
+    plugin->AdvanceTime(plugin->current_time() + kHistoryPointSpacing,
+                        planetarium_rotation);
+  }
+  return plugin;
+}
+
+not_null<std::unique_ptr<Transforms<Barycentric, Rendering, Barycentric>>>
+NewTransforms(Plugin const& plugin, RenderingFrame const frame) {
+  if (frame == RenderingFrame::kBodyCentredNonRotating) {
+    return plugin.NewBodyCentredNonRotatingTransforms(SolarSystem::kEarth);
+  } else {
+    return plugin.NewBarycentricRotatingTransforms(SolarSystem::kEarth,
+                                                   SolarSystem::kMoon);
+  }
+}
+
+void RenderingBenchmark(RenderingFrame const frame,
+                        bool const warm,
+                        not_null<benchmark::State*> const state) {
+  int const history_points = state->range_x();
+  not_null<std::unique_ptr<Plugin>> const plugin = NewPlugin(history_points);
+  // The rendering starts with the first point of the history.
+  Instant const begin =
+      plugin->current_time() - (history_points + 1) * kHistoryPointSpacing;
+  not_null<std::unique_ptr<Transforms<Barycentric, Rendering, Barycentric>>>
+      transforms = NewTransforms(*plugin, frame);
+  std::int64_t points = 0;
+  if (warm) {
+    transforms->set_first_cache_capacity(
+        std::max(transforms->first_cache_capacity(),
+                 static_cast<std::size_t>(history_points)));
+    plugin->RenderedVesselTrajectory(kVessel,
+                                     transforms.get(),
+                                     World::origin,
+                                     Length(),
+                                     begin);
+  }
+  // For the counts of allocations.
+  plugin->SetProfiling(true);
+
+  std::chrono::steady_clock::duration rendering =
+      std::chrono::steady_clock::duration::zero();
+  while (state->KeepRunning()) {
+    auto const start = std::chrono::steady_clock::now();
+    if (!warm) {
+      transforms = NewTransforms(*plugin, frame);
+    }
+    points = plugin->RenderedVesselTrajectory(kVessel,
+                                              transforms.get(),
+                                              World::origin,
+                                              Length(),
+                                              begin).size() + 1;
+    rendering += std::chrono::steady_clock::now() - start;
+  }
+
+  Plugin::Profile const profile = plugin->profile();
+  double const iterations_and_points =
+      static_cast<double>(state->iterations()) * points;
+  state->SetItemsProcessed(state->iterations() * points);
+  state->SetLabel(
+      std::to_string(points) + " points, " +
+      std::to_string(
+          std::chrono::duration<double, std::nano>(rendering).count() /
+          iterations_and_points) +
+      " ns/point, " +
+      std::to_string(profile.render_allocations.allocations /
+                     profile.render_calls) +
+      " allocations per render");
+}
+
+}  // namespace
+
+void BM_RenderingBodyCentredNonRotatingCold(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  RenderingBenchmark(RenderingFrame::kBodyCentredNonRotating,
+                     false,  // warm
+                     &state);
+}
+
+void BM_RenderingBodyCentredNonRotatingWarm(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  RenderingBenchmark(RenderingFrame::kBodyCentredNonRotating,
+                     true,  // warm
+                     &state);
+}
+
+void BM_RenderingBarycentricRotatingCold(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  RenderingBenchmark(RenderingFrame::kBarycentricRotating,
+                     false,  // warm
+                     &state);
+}
+
+void BM_RenderingBarycentricRotatingWarm(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  RenderingBenchmark(RenderingFrame::kBarycentricRotating,
+                     true,  // warm
+                     &state);
+}
+
+BENCHMARK(BM_RenderingBodyCentredNonRotatingCold)
+    ->Arg(1000)->Arg(10000)->Arg(100000)->Arg(1000000);
+BENCHMARK(BM_RenderingBodyCentredNonRotatingWarm)
+    ->Arg(1000)->Arg(10000)->Arg(100000)->Arg(1000000);
+BENCHMARK(BM_RenderingBarycentricRotatingCold)
+    ->Arg(1000)->Arg(10000)->Arg(100000)->Arg(1000000);
+BENCHMARK(BM_RenderingBarycentricRotatingWarm)
+    ->Arg(1000)->Arg(10000)->Arg(100000)->Arg(1000000);
+
+}  // namespace benchmarks
+}  // namespace principia
@@ -16,9 +16,12 @@
 
 #define GLOG_NO_ABBREVIATED_SEVERITIES
 #include <algorithm>
+#include <cstdint>
+#include <string>
 #include <vector>
 
 #include "base/not_null.hpp"
+#include "benchmarks/performance_counters.hpp"
 #include "quantities/elementary_functions.hpp"
 #include "quantities/named_quantities.hpp"
 
@@ -26,6 +29,7 @@
 #include "benchmark/benchmark.h"
 
 using principia::integrators::SPRKIntegrator;
+using principia::integrators::SPRKScheme;
 using principia::quantities::Abs;
 using principia::quantities::AngularFrequency;
 using principia::quantities::Cos;
@@ -36,14 +40,21 @@ namespace principia {
 namespace benchmarks {
 
 void SolveHarmonicOscillatorAndComputeError(
+    SPRKScheme const scheme,
     not_null<benchmark::State*> const state,
+    not_null<PerformanceCounters*> const counters,
+    not_null<std::int64_t*> const steps,
     not_null<Length*> const q_error,
     not_null<Momentum*> const p_error) {
   std::vector<SPRKIntegrator<Length, Momentum>::SystemState> solution;
 
-  SolveHarmonicOscillator(&solution);
+  counters->Start();
+  SolveHarmonicOscillator(scheme, &solution);
+  counters->Stop();
 
   state->PauseTiming();
+  // The solution has one state per step.
+  *steps += solution.size();
   *q_error = Length();
   *p_error = Momentum();
   for (std::size_t i = 0; i < solution.size(); ++i) {
@@ -61,18 +72,99 @@ void SolveHarmonicOscillatorAndComputeError(
   state->ResumeTiming();
 }
 
-void BM_SolveHarmonicOscillator(
-    benchmark::State& state) {  // NOLINT(runtime/references)
+void SolveHarmonicOscillatorBenchmark(
+    SPRKScheme const scheme,
+    not_null<benchmark::State*> const state) {
+  PerformanceCounters counters;
+  std::int64_t steps = 0;
   Length   q_error;
   Momentum p_error;
-  while (state.KeepRunning()) {
-    SolveHarmonicOscillatorAndComputeError(&state, &q_error, &p_error);
+  while (state->KeepRunning()) {
+    SolveHarmonicOscillatorAndComputeError(
+        scheme, state, &counters, &steps, &q_error, &p_error);
   }
   std::stringstream ss;
   ss << q_error << ", " << p_error;
-  state.SetLabel(ss.str());
+  // The number of evaluations of the force depends on the scheme, so the
+  // counts are only given per step.
+  std::string const counts = counters.Describe(0, steps);
+  if (!counts.empty()) {
+    ss << "; " << counts;
+  }
+  state->SetLabel(ss.str());
+}
+
+void BM_SolveHarmonicOscillator(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SolveHarmonicOscillatorBenchmark(
+      SPRKScheme::kMcLachlanAtela1992Order5Optimal, &state);
+}
+
+void BM_SolveHarmonicOscillatorLeapfrog(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SolveHarmonicOscillatorBenchmark(SPRKScheme::kLeapfrog, &state);
+}
+
+void BM_SolveHarmonicOscillatorMcLachlanAtela1992Order2Optimal(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SolveHarmonicOscillatorBenchmark(
+      SPRKScheme::kMcLachlanAtela1992Order2Optimal, &state);
+}
+
+void BM_SolveHarmonicOscillatorRuth1983(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SolveHarmonicOscillatorBenchmark(SPRKScheme::kRuth1983, &state);
+}
+
+void BM_SolveHarmonicOscillatorMcLachlanAtela1992Order3Optimal(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SolveHarmonicOscillatorBenchmark(
+      SPRKScheme::kMcLachlanAtela1992Order3Optimal, &state);
 }
+
+void BM_SolveHarmonicOscillatorCandyRozmus1991ForestRuth1990(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SolveHarmonicOscillatorBenchmark(
+      SPRKScheme::kCandyRozmus1991ForestRuth1990, &state);
+}
+
+void BM_SolveHarmonicOscillatorMcLachlanAtela1992Order4Optimal(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SolveHarmonicOscillatorBenchmark(
+      SPRKScheme::kMcLachlanAtela1992Order4Optimal, &state);
+}
+
+void BM_SolveHarmonicOscillatorBlanesMoan2002SRKN6B(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SolveHarmonicOscillatorBenchmark(SPRKScheme::kBlanesMoan2002SRKN6B, &state);
+}
+
+void BM_SolveHarmonicOscillatorYoshida1990Order6A(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SolveHarmonicOscillatorBenchmark(SPRKScheme::kYoshida1990Order6A, &state);
+}
+
+void BM_SolveHarmonicOscillatorBlanesMoan2002SRKN11B(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SolveHarmonicOscillatorBenchmark(SPRKScheme::kBlanesMoan2002SRKN11B, &state);
+}
+
+void BM_SolveHarmonicOscillatorYoshida1990Order8D(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  SolveHarmonicOscillatorBenchmark(SPRKScheme::kYoshida1990Order8D, &state);
+}
+
 BENCHMARK(BM_SolveHarmonicOscillator);
+BENCHMARK(BM_SolveHarmonicOscillatorLeapfrog);
+BENCHMARK(BM_SolveHarmonicOscillatorMcLachlanAtela1992Order2Optimal);
+BENCHMARK(BM_SolveHarmonicOscillatorRuth1983);
+BENCHMARK(BM_SolveHarmonicOscillatorMcLachlanAtela1992Order3Optimal);
+BENCHMARK(BM_SolveHarmonicOscillatorCandyRozmus1991ForestRuth1990);
+BENCHMARK(BM_SolveHarmonicOscillatorMcLachlanAtela1992Order4Optimal);
+BENCHMARK(BM_SolveHarmonicOscillatorBlanesMoan2002SRKN6B);
+BENCHMARK(BM_SolveHarmonicOscillatorYoshida1990Order6A);
+BENCHMARK(BM_SolveHarmonicOscillatorBlanesMoan2002SRKN11B);
+BENCHMARK(BM_SolveHarmonicOscillatorYoshida1990Order8D);
 
 }  // namespace benchmarks
 }  // namespace principia
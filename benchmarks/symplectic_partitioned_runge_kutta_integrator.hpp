@@ -10,13 +10,16 @@
 
 using principia::base::not_null;
 using principia::integrators::SPRKIntegrator;
+using principia::integrators::SPRKScheme;
 using principia::quantities::Length;
 using principia::quantities::Momentum;
 
 namespace principia {
 namespace benchmarks {
 
+// Solves the harmonic oscillator with the given |scheme|.
 inline void SolveHarmonicOscillator(
+    SPRKScheme const scheme,
     not_null<std::vector<
         SPRKIntegrator<Length, Momentum>::SystemState>*> const solution);
 
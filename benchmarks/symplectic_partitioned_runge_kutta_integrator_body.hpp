@@ -10,6 +10,7 @@
 
 using principia::base::not_null;
 using principia::integrators::SPRKIntegrator;
+using principia::integrators::SPRKScheme;
 using principia::quantities::Length;
 using principia::quantities::Momentum;
 using principia::quantities::SIUnit;
@@ -18,6 +19,7 @@ namespace principia {
 namespace benchmarks {
 
 inline void SolveHarmonicOscillator(
+    SPRKScheme const scheme,
     not_null<std::vector<
         SPRKIntegrator<Length, Momentum>::SystemState>*> const solution) {
   using principia::testing_utilities::ComputeHarmonicOscillatorForce;
@@ -25,7 +27,7 @@ inline void SolveHarmonicOscillator(
   SPRKIntegrator<Length, Momentum> integrator;
   SPRKIntegrator<Length, Momentum>::Parameters parameters;
 
-  integrator.Initialize(integrator.Order5Optimal());
+  integrator.Initialize(integrator.CoefficientsOf(scheme));
 
   parameters.initial.positions.emplace_back(SIUnit<Length>());
   parameters.initial.momenta.emplace_back(Momentum());
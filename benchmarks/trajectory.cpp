@@ -0,0 +1,276 @@
+
+// .\Release\benchmarks.exe --benchmark_filter=Trajectory
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+
+#include "base/not_null.hpp"
+#include "geometry/frame.hpp"
+#include "geometry/grassmann.hpp"
+#include "geometry/named_quantities.hpp"
+#include "physics/degrees_of_freedom.hpp"
+#include "physics/massless_body.hpp"
+#include "physics/trajectory.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+#include "serialization/physics.pb.h"
+
+// Must come last to avoid conflicts when defining the CHECK macros.
+#include "benchmark/benchmark.h"
+
+using principia::base::not_null;
+using principia::geometry::Frame;
+using principia::geometry::Instant;
+using principia::geometry::Position;
+using principia::geometry::Vector;
+using principia::geometry::Velocity;
+using principia::physics::DegreesOfFreedom;
+using principia::physics::MasslessBody;
+using principia::physics::Trajectory;
+using principia::quantities::Length;
+using principia::si::Metre;
+using principia::si::Second;
+
+namespace principia {
+namespace benchmarks {
+
+namespace {
+
+using World = Frame<serialization::Frame::TestTag,
+                    serialization::Frame::TEST, true>;
+
+// The number of points of the histories used by the benchmarks that are not
+// parameterized by the length of the trajectory.
+int const kDefaultLength = 100000;
+
+// The time of the |i|th point appended by |Fill|.
+Instant TimeOfPoint(int const i) {
+  return Instant(i * Second);
+}
+
+// Appends |length| points to |trajectory|, which must be empty, at the times
+// |TimeOfPoint(0)| to |TimeOfPoint(length - 1)|.
+void Fill(int const length, not_null<Trajectory<World>*> const trajectory) {
+  for (int i = 0; i < length; ++i) {
+    Length const x = i * Metre;
+    trajectory->Append(
+        TimeOfPoint(i),
+        DegreesOfFreedom<World>(
+            World::origin + Vector<Length, World>({x, 2 * x, 3 * x}),
+            Velocity<World>({1 * Metre / Second,
+                             2 * Metre / Second,
+                             3 * Metre / Second})));
+  }
+}
+
+// Forks |depth| times, each fork being a child of the previous one, at times
+// evenly spread over the |length| points of |root|.  Returns the deepest fork,
+// or |root| if |depth| is 0.
+not_null<Trajectory<World>*> ForkChain(
+    int const length,
+    int const depth,
+    not_null<Trajectory<World>*> const root) {
+  not_null<Trajectory<World>*> fork = root;
+  for (int d = 1; d <= depth; ++d) {
+    fork = fork->NewFork(TimeOfPoint(d * (length - 1) / (depth + 1)));
+  }
+  return fork;
+}
+
+}  // namespace
+
+void BM_TrajectoryAppend(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  int const length = state.range_x();
+  MasslessBody body;
+  while (state.KeepRunning()) {
+    Trajectory<World> trajectory(&body);
+    Fill(length, &trajectory);
+  }
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations()) * length);
+}
+
+void BM_TrajectoryFirst(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  int const depth = state.range_x();
+  MasslessBody body;
+  Trajectory<World> root(&body);
+  Fill(kDefaultLength, &root);
+  not_null<Trajectory<World>*> const fork =
+      ForkChain(kDefaultLength, depth, &root);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(fork->first().time());
+  }
+}
+
+void BM_TrajectoryOnOrAfter(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  int const depth = state.range_x();
+  MasslessBody body;
+  Trajectory<World> root(&body);
+  Fill(kDefaultLength, &root);
+  not_null<Trajectory<World>*> const fork =
+      ForkChain(kDefaultLength, depth, &root);
+  // A time in the middle of the timeline of the deepest fork, i.e., not in
+  // the root if there is at least one fork.
+  Instant const time = TimeOfPoint(
+      (depth * (kDefaultLength - 1) / (depth + 1) + kDefaultLength - 1) / 2);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(fork->on_or_after(time).time());
+  }
+}
+
+void BM_TrajectoryLast(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  int const depth = state.range_x();
+  MasslessBody body;
+  Trajectory<World> root(&body);
+  Fill(kDefaultLength, &root);
+  not_null<Trajectory<World>*> const fork =
+      ForkChain(kDefaultLength, depth, &root);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(fork->last().time());
+  }
+}
+
+// A fork in the middle of the trajectory copies half of its points.
+void BM_TrajectoryNewAndDeleteFork(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  int const length = state.range_x();
+  MasslessBody body;
+  Trajectory<World> root(&body);
+  Fill(length, &root);
+  while (state.KeepRunning()) {
+    Trajectory<World>* fork = root.NewFork(TimeOfPoint(length / 2));
+    root.DeleteFork(&fork);
+  }
+}
+
+// Forgets the first half of a trajectory.
+void BM_TrajectoryForgetBefore(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  int const length = state.range_x();
+  MasslessBody body;
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    Trajectory<World> trajectory(&body);
+    Fill(length, &trajectory);
+    state.ResumeTiming();
+    trajectory.ForgetBefore(TimeOfPoint(length / 2));
+  }
+}
+
+void BM_TrajectoryPositions(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  int const length = state.range_x();
+  MasslessBody body;
+  Trajectory<World> trajectory(&body);
+  Fill(length, &trajectory);
+  while (state.KeepRunning()) {
+    std::map<Instant, Position<World>> const positions =
+        trajectory.Positions();
+    benchmark::DoNotOptimize(positions.size());
+  }
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations()) * length);
+}
+
+void BM_TrajectoryVelocities(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  int const length = state.range_x();
+  MasslessBody body;
+  Trajectory<World> trajectory(&body);
+  Fill(length, &trajectory);
+  while (state.KeepRunning()) {
+    std::map<Instant, Velocity<World>> const velocities =
+        trajectory.Velocities();
+    benchmark::DoNotOptimize(velocities.size());
+  }
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations()) * length);
+}
+
+void BM_TrajectoryTimes(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  int const length = state.range_x();
+  MasslessBody body;
+  Trajectory<World> trajectory(&body);
+  Fill(length, &trajectory);
+  while (state.KeepRunning()) {
+    std::list<Instant> const times = trajectory.Times();
+    benchmark::DoNotOptimize(times.size());
+  }
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations()) * length);
+}
+
+// Iterates over the positions of a trajectory without copying them.
+void BM_TrajectoryPositionsView(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  int const length = state.range_x();
+  MasslessBody body;
+  Trajectory<World> trajectory(&body);
+  Fill(length, &trajectory);
+  while (state.KeepRunning()) {
+    Length sum_x;
+    for (Position<World> const& position : trajectory.positions()) {
+      sum_x += (position - World::origin).coordinates().x;
+    }
+    benchmark::DoNotOptimize(sum_x);
+  }
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations()) * length);
+}
+
+void BM_TrajectoryWriteToMessage(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  int const length = state.range_x();
+  MasslessBody body;
+  Trajectory<World> trajectory(&body);
+  Fill(length, &trajectory);
+  while (state.KeepRunning()) {
+    serialization::Trajectory message;
+    trajectory.WriteToMessage(&message);
+    benchmark::DoNotOptimize(message.columns().t_size());
+  }
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations()) * length);
+}
+
+void BM_TrajectoryReadFromMessage(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  int const length = state.range_x();
+  MasslessBody body;
+  serialization::Trajectory message;
+  {
+    Trajectory<World> trajectory(&body);
+    Fill(length, &trajectory);
+    trajectory.WriteToMessage(&message);
+  }
+  while (state.KeepRunning()) {
+    std::unique_ptr<Trajectory<World>> const trajectory =
+        Trajectory<World>::ReadFromMessage(message, &body);
+    benchmark::DoNotOptimize(trajectory.get());
+  }
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations()) * length);
+}
+
+BENCHMARK(BM_TrajectoryAppend)->Arg(100000)->Arg(1000000);
+BENCHMARK(BM_TrajectoryFirst)->Arg(0)->Arg(1)->Arg(4)->Arg(16);
+BENCHMARK(BM_TrajectoryOnOrAfter)->Arg(0)->Arg(1)->Arg(4)->Arg(16);
+BENCHMARK(BM_TrajectoryLast)->Arg(0)->Arg(1)->Arg(4)->Arg(16);
+BENCHMARK(BM_TrajectoryNewAndDeleteFork)->Arg(100000)->Arg(1000000);
+BENCHMARK(BM_TrajectoryForgetBefore)->Arg(100000)->Arg(1000000);
+BENCHMARK(BM_TrajectoryPositions)->Arg(100000)->Arg(1000000);
+BENCHMARK(BM_TrajectoryVelocities)->Arg(100000)->Arg(1000000);
+BENCHMARK(BM_TrajectoryTimes)->Arg(100000)->Arg(1000000);
+BENCHMARK(BM_TrajectoryPositionsView)->Arg(100000)->Arg(1000000);
+BENCHMARK(BM_TrajectoryWriteToMessage)->Arg(100000)->Arg(1000000);
+BENCHMARK(BM_TrajectoryReadFromMessage)->Arg(100000)->Arg(1000000);
+
+}  // namespace benchmarks
+}  // namespace principia
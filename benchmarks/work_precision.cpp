@@ -0,0 +1,505 @@
+
+// .\Release\benchmarks.exe --benchmark_filter=WorkPrecision --json_output=<file>  // NOLINT(whitespace/line_length)
+// The work-precision benchmarks integrate a problem with an integrator over a
+// sweep of step sizes, or of tolerances for the adaptive integrator, and label
+// each run with a line of CSV:
+//   problem,integrator,step,error,force evaluations,seconds
+// where |step| is the step in seconds, or the tolerance relative to the scale
+// of the problem for the adaptive integrator, |error| is the relative error at
+// the end of the integration and |seconds| is the wall time of an integration.
+// The JSON records written with --json_output have the same label.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/not_null.hpp"
+#include "geometry/named_quantities.hpp"
+#include "glog/logging.h"
+#include "integrators/embedded_explicit_runge_kutta_nystrom_integrator.hpp"
+#include "integrators/gauss_jackson_integrator.hpp"
+#include "integrators/symmetric_linear_multistep_integrator.hpp"
+#include "integrators/symplectic_integrator.hpp"
+#include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "integrators/wisdom_holman_integrator.hpp"
+#include "physics/massive_body.hpp"
+#include "physics/n_body_system.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/numbers.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+#include "testing_utilities/solar_system.hpp"
+
+// Must come last to avoid conflicts when defining the CHECK macros.
+#include "benchmark/benchmark.h"
+
+using principia::base::not_null;
+using principia::geometry::Instant;
+using principia::geometry::Position;
+using principia::integrators::DoublePrecision;
+using principia::integrators::DoublePrecisionVector;
+using principia::integrators::EmbeddedExplicitRungeKuttaNyströmIntegrator;
+using principia::integrators::GaussJacksonIntegrator;
+using principia::integrators::SPRKIntegrator;
+using principia::integrators::SPRKScheme;
+using principia::integrators::SymmetricLinearMultistepIntegrator;
+using principia::integrators::SymplecticIntegrator;
+using principia::integrators::WisdomHolmanIntegrator;
+using principia::physics::MassiveBody;
+using principia::physics::NBodySystem;
+using principia::quantities::Acceleration;
+using principia::quantities::GravitationalParameter;
+using principia::quantities::Length;
+using principia::quantities::Pow;
+using principia::quantities::SIUnit;
+using principia::quantities::Speed;
+using principia::quantities::Sqrt;
+using principia::quantities::Time;
+using principia::si::Day;
+using principia::si::Hour;
+using principia::si::Kilo;
+using principia::si::Metre;
+using principia::si::Second;
+using principia::testing_utilities::ICRFJ2000Ecliptic;
+using principia::testing_utilities::SolarSystem;
+
+namespace principia {
+namespace benchmarks {
+
+namespace {
+
+// The integrators.  The first ones are the |SPRKIntegrator|s for the
+// |SPRKScheme| with the same value.
+int const kNumberOfSPRKSchemes =
+    static_cast<int>(SPRKScheme::kYoshida1990Order8D) + 1;
+int const kQuinlanTremaine1990Order8 = kNumberOfSPRKSchemes;
+int const kGaussJacksonOrder8 = kNumberOfSPRKSchemes + 1;
+int const kWisdomHolmanLeapfrog = kNumberOfSPRKSchemes + 2;
+int const kWisdomHolmanMcLachlanAtela1992Order5Optimal =
+    kNumberOfSPRKSchemes + 3;
+int const kEmbeddedRungeKuttaNyström = kNumberOfSPRKSchemes + 4;
+
+// The number of points of each sweep.  The step is halved, or the tolerance
+// divided by 10, from one point to the next.
+int const kSweepLength = 10;
+
+// The tolerance of the point |k| of a sweep, relative to the scale of the
+// problem.
+double Tolerance(int const k) {
+  return std::pow(10.0, -2 - k);
+}
+
+std::string IntegratorName(int const integrator) {
+  static char const* const sprk_names[kNumberOfSPRKSchemes] = {
+      "Leapfrog",
+      "McLachlanAtela1992Order2Optimal",
+      "Ruth1983",
+      "McLachlanAtela1992Order3Optimal",
+      "CandyRozmus1991ForestRuth1990",
+      "McLachlanAtela1992Order4Optimal",
+      "BlanesMoan2002SRKN6B",
+      "McLachlanAtela1992Order5Optimal",
+      "Yoshida1990Order6A",
+      "BlanesMoan2002SRKN11B",
+      "Yoshida1990Order8D"};
+  if (integrator < kNumberOfSPRKSchemes) {
+    return sprk_names[integrator];
+  } else if (integrator == kQuinlanTremaine1990Order8) {
+    return "QuinlanTremaine1990Order8";
+  } else if (integrator == kGaussJacksonOrder8) {
+    return "GaussJacksonOrder8";
+  } else if (integrator == kWisdomHolmanLeapfrog) {
+    return "WisdomHolmanLeapfrog";
+  } else if (integrator == kWisdomHolmanMcLachlanAtela1992Order5Optimal) {
+    return "WisdomHolmanMcLachlanAtela1992Order5Optimal";
+  } else if (integrator == kEmbeddedRungeKuttaNyström) {
+    return "EmbeddedRungeKuttaNystrom";
+  }
+  LOG(FATAL) << "Unknown integrator " << integrator;
+  base::noreturn();
+}
+
+// The outcome of one integration.
+struct Measurement {
+  double error;
+  std::int64_t force_evaluations;
+  double seconds;
+};
+
+using Parameters = SymplecticIntegrator<Length, Speed>::Parameters;
+using RKN = EmbeddedExplicitRungeKuttaNyströmIntegrator<Length>;
+
+// Integrates with the fixed step |integrator|, which must be an
+// |SPRKIntegrator|, a |SymmetricLinearMultistepIntegrator| or a
+// |GaussJacksonIntegrator|, and returns the final state in |*q| and |*v|.
+template<typename Integrator, typename ComputeAcceleration>
+void SolveWithFixedStep(Integrator const& integrator,
+                        ComputeAcceleration const& compute_acceleration,
+                        Parameters const& parameters,
+                        not_null<std::vector<Length>*> const q,
+                        not_null<std::vector<Speed>*> const v) {
+  typename Integrator::Workspace workspace;
+  integrator.SolveWithSink(
+      compute_acceleration,
+      parameters,
+      [q, v](DoublePrecision<Time> const& time,
+             DoublePrecisionVector<Length> const& positions,
+             DoublePrecisionVector<Speed> const& velocities) {
+        *q = positions.values;
+        *v = velocities.values;
+      },
+      &workspace);
+}
+
+// Integrates from |parameters.initial| to |parameters.tmax| with the
+// |integrator|, which may not be a Wisdom-Holman integrator, and returns the
+// final state in |*q| and |*v|.  For the adaptive integrator, the tolerances
+// are |tolerance| times |length_scale| and |length_scale| / |time_scale|.  The
+// wall time is added to |measurement->seconds|.
+template<typename ComputeAcceleration>
+void Solve(int const integrator,
+           double const tolerance,
+           Length const& length_scale,
+           Time const& time_scale,
+           ComputeAcceleration const& compute_acceleration,
+           Parameters const& parameters,
+           not_null<std::vector<Length>*> const q,
+           not_null<std::vector<Speed>*> const v,
+           not_null<Measurement*> const measurement) {
+  auto const start = std::chrono::high_resolution_clock::now();
+  if (integrator < kNumberOfSPRKSchemes) {
+    SPRKIntegrator<Length, Speed> sprk;
+    sprk.Initialize(static_cast<SPRKScheme>(integrator));
+    SolveWithFixedStep(sprk, compute_acceleration, parameters, q, v);
+  } else if (integrator == kQuinlanTremaine1990Order8) {
+    SymmetricLinearMultistepIntegrator<Length, Speed> multistep;
+    multistep.Initialize(multistep.QuinlanTremaine1990Order8());
+    SolveWithFixedStep(multistep, compute_acceleration, parameters, q, v);
+  } else if (integrator == kGaussJacksonOrder8) {
+    GaussJacksonIntegrator<Length, Speed> gauss_jackson;
+    gauss_jackson.Initialize(gauss_jackson.Order8());
+    SolveWithFixedStep(gauss_jackson, compute_acceleration, parameters, q, v);
+  } else {
+    CHECK_EQ(kEmbeddedRungeKuttaNyström, integrator);
+    RKN rkn;
+    RKN::Parameters rkn_parameters;
+    for (auto const& position : parameters.initial.positions) {
+      rkn_parameters.initial.positions.emplace_back(position.value);
+    }
+    for (auto const& velocity : parameters.initial.momenta) {
+      rkn_parameters.initial.velocities.emplace_back(velocity.value);
+    }
+    rkn_parameters.initial.time = parameters.initial.time;
+    rkn_parameters.tmax = parameters.tmax;
+    rkn_parameters.first_time_step = time_scale;
+    rkn_parameters.length_integration_tolerance = tolerance * length_scale;
+    rkn_parameters.speed_integration_tolerance =
+        tolerance * length_scale / time_scale;
+    RKN::SystemState final_state;
+    RKN::Workspace workspace;
+    rkn.Solve(compute_acceleration, rkn_parameters, &final_state, &workspace);
+    q->clear();
+    v->clear();
+    for (auto const& position : final_state.positions) {
+      q->push_back(position.value);
+    }
+    for (auto const& velocity : final_state.velocities) {
+      v->push_back(velocity.value);
+    }
+  }
+  auto const end = std::chrono::high_resolution_clock::now();
+  measurement->seconds += std::chrono::duration<double>(end - start).count();
+}
+
+// A harmonic oscillator of unit amplitude and angular frequency, integrated
+// over 100 s with a step of 2⁻ᵏ s.  The error is the distance to the exact
+// solution in phase space.
+Measurement SolveHarmonicOscillator(int const integrator, int const k) {
+  Length const amplitude = SIUnit<Length>();
+  // The inverse of the angular frequency.
+  Time const time_scale = SIUnit<Time>();
+  Measurement measurement = {0, 0, 0};
+  auto const compute_acceleration =
+      [&measurement, time_scale](
+          Time const& t,
+          std::vector<Length> const& q,
+          not_null<std::vector<Acceleration>*> const result) {
+    ++measurement.force_evaluations;
+    (*result)[0] = -q[0] / (time_scale * time_scale);
+  };
+  Parameters parameters;
+  parameters.initial.positions.emplace_back(amplitude);
+  parameters.initial.momenta.emplace_back(Speed());
+  parameters.initial.time = Time();
+  parameters.tmax = 100 * time_scale;
+  parameters.Δt = time_scale / (1 << k);
+  parameters.sampling_period = 0;
+  parameters.tmax_is_exact = true;
+
+  std::vector<Length> q;
+  std::vector<Speed> v;
+  Solve(integrator, Tolerance(k), amplitude, time_scale, compute_acceleration,
+        parameters, &q, &v, &measurement);
+  double const phase = parameters.tmax / time_scale;
+  measurement.error =
+      Sqrt(Pow<2>(q[0] - amplitude * std::cos(phase)) +
+           Pow<2>(v[0] * time_scale + amplitude * std::sin(phase))) /
+      amplitude;
+  return measurement;
+}
+
+// A Kepler orbit of unit semimajor axis and gravitational parameter with an
+// eccentricity of 0.5, integrated over 10 periods from the pericentre with
+// 2ᵏ⁺⁴ steps per period.  The error is the distance to the pericentre at the
+// end, relative to the semimajor axis.
+Measurement SolveKeplerProblem(int const integrator, int const k) {
+  Length const a = SIUnit<Length>();
+  GravitationalParameter const μ = SIUnit<GravitationalParameter>();
+  double const eccentricity = 0.5;
+  Time const period = 2 * π * Sqrt(Pow<3>(a) / μ);
+  Measurement measurement = {0, 0, 0};
+  auto const compute_acceleration =
+      [&measurement, μ](Time const& t,
+                        std::vector<Length> const& q,
+                        not_null<std::vector<Acceleration>*> const result) {
+    ++measurement.force_evaluations;
+    Length const r = Sqrt(q[0] * q[0] + q[1] * q[1]);
+    auto const μ_over_r³ = μ / (r * r * r);
+    (*result)[0] = -μ_over_r³ * q[0];
+    (*result)[1] = -μ_over_r³ * q[1];
+  };
+  Parameters parameters;
+  parameters.initial.positions.emplace_back(a * (1 - eccentricity));
+  parameters.initial.positions.emplace_back(Length());
+  parameters.initial.momenta.emplace_back(Speed());
+  parameters.initial.momenta.emplace_back(
+      Sqrt(μ * (1 + eccentricity) / (a * (1 - eccentricity))));
+  parameters.initial.time = Time();
+  parameters.tmax = 10 * period;
+  parameters.Δt = period / (1 << (k + 4));
+  parameters.sampling_period = 0;
+  parameters.tmax_is_exact = true;
+
+  std::vector<Length> q;
+  std::vector<Speed> v;
+  Solve(integrator, Tolerance(k), a, period / (2 * π), compute_acceleration,
+        parameters, &q, &v, &measurement);
+  measurement.error =
+      Sqrt(Pow<2>(q[0] - a * (1 - eccentricity)) + Pow<2>(q[1])) / a;
+  return measurement;
+}
+
+// The duration of the integrations of the solar system.
+Time const kSolarSystemDuration = 100 * Day;
+// The largest step of the sweeps on the solar system.
+Time const kSolarSystemLargestStep = 12 * Hour;
+
+// Integrates the major bodies of the solar system over
+// |kSolarSystemDuration| with the |integrator| and a step of
+// |kSolarSystemLargestStep| / 2ᵏ, and returns the final positions.
+std::vector<Position<ICRFJ2000Ecliptic>> SolarSystemFinalPositions(
+    int const integrator,
+    int const k,
+    not_null<Measurement*> const measurement) {
+  not_null<std::unique_ptr<SolarSystem>> const solar_system =
+      SolarSystem::AtСпутник1Launch(SolarSystem::Accuracy::kMajorBodiesOnly);
+  NBodySystem<ICRFJ2000Ecliptic>::Trajectories const trajectories =
+      solar_system->trajectories();
+  Instant const tmax =
+      trajectories.front()->last().time() + kSolarSystemDuration;
+  Time const Δt = kSolarSystemLargestStep / (1 << k);
+  NBodySystem<ICRFJ2000Ecliptic> n_body_system;
+
+  auto const start = std::chrono::high_resolution_clock::now();
+  if (integrator < kNumberOfSPRKSchemes) {
+    SPRKIntegrator<Length, Speed> sprk;
+    sprk.Initialize(static_cast<SPRKScheme>(integrator));
+    n_body_system.Integrate(sprk,
+                            tmax,
+                            Δt,
+                            0,     // sampling_period
+                            true,  // tmax_is_exact
+                            trajectories);
+  } else if (integrator == kQuinlanTremaine1990Order8) {
+    SymmetricLinearMultistepIntegrator<Length, Speed> multistep;
+    multistep.Initialize(multistep.QuinlanTremaine1990Order8());
+    n_body_system.Integrate(multistep,
+                            tmax,
+                            Δt,
+                            0,     // sampling_period
+                            true,  // tmax_is_exact
+                            trajectories);
+  } else if (integrator == kWisdomHolmanLeapfrog ||
+             integrator == kWisdomHolmanMcLachlanAtela1992Order5Optimal) {
+    std::map<MassiveBody const*, MassiveBody const*> parents;
+    for (std::size_t i = SolarSystem::kSun + 1; i < trajectories.size(); ++i) {
+      parents.emplace(
+          trajectories[i]->body<MassiveBody>(),
+          trajectories[SolarSystem::parent(i)]->body<MassiveBody>());
+    }
+    SPRKIntegrator<Length, Speed> sprk;
+    WisdomHolmanIntegrator<Length, Speed> wisdom_holman;
+    wisdom_holman.Initialize(sprk.CoefficientsOf(
+        integrator == kWisdomHolmanLeapfrog
+            ? SPRKScheme::kLeapfrog
+            : SPRKScheme::kMcLachlanAtela1992Order5Optimal));
+    n_body_system.IntegrateWisdomHolman(wisdom_holman,
+                                        parents,
+                                        tmax,
+                                        Δt,
+                                        0,     // sampling_period
+                                        true,  // tmax_is_exact
+                                        trajectories);
+  } else {
+    CHECK_EQ(kEmbeddedRungeKuttaNyström, integrator);
+    Length const length_scale = 1000 * Kilo(Metre);
+    n_body_system.IntegrateAdaptively(RKN(),
+                                      tmax,
+                                      kSolarSystemLargestStep,
+                                      Tolerance(k) * length_scale,
+                                      Tolerance(k) * length_scale / Day,
+                                      trajectories);
+  }
+  auto const end = std::chrono::high_resolution_clock::now();
+  measurement->seconds += std::chrono::duration<double>(end - start).count();
+  measurement->force_evaluations +=
+      n_body_system.statistics().force_evaluations;
+
+  std::vector<Position<ICRFJ2000Ecliptic>> positions;
+  for (auto const& trajectory : trajectories) {
+    positions.push_back(trajectory->last().degrees_of_freedom().position());
+  }
+  return positions;
+}
+
+// The final positions of |SolarSystemFinalPositions| with an order 6 method
+// and a step 2¹⁰ times smaller than the largest one of the sweep.
+std::vector<Position<ICRFJ2000Ecliptic>> const& SolarSystemReference() {
+  static std::vector<Position<ICRFJ2000Ecliptic>> const reference = []() {
+    Measurement measurement = {0, 0, 0};
+    return SolarSystemFinalPositions(
+        static_cast<int>(SPRKScheme::kBlanesMoan2002SRKN11B),
+        kSweepLength,
+        &measurement);
+  }();
+  return reference;
+}
+
+// The error is the largest error on the position of a body other than the Sun,
+// relative to its distance to its parent.
+Measurement IntegrateSolarSystem(int const integrator, int const k) {
+  std::vector<Position<ICRFJ2000Ecliptic>> const& reference =
+      SolarSystemReference();
+  Measurement measurement = {0, 0, 0};
+  std::vector<Position<ICRFJ2000Ecliptic>> const positions =
+      SolarSystemFinalPositions(integrator, k, &measurement);
+  for (std::size_t i = SolarSystem::kSun + 1; i < positions.size(); ++i) {
+    measurement.error = std::max(
+        measurement.error,
+        (positions[i] - reference[i]).Norm() /
+            (reference[i] - reference[SolarSystem::parent(i)]).Norm());
+  }
+  return measurement;
+}
+
+void WorkPrecisionBenchmark(std::string const& problem,
+                            Measurement (*solve)(int const integrator,
+                                                 int const k),
+                            not_null<benchmark::State*> const state) {
+  int const integrator = state->range_x();
+  int const k = state->range_y();
+  Measurement total = {0, 0, 0};
+  std::int64_t integrations = 0;
+  while (state->KeepRunning()) {
+    Measurement const measurement = solve(integrator, k);
+    total.error = measurement.error;
+    total.force_evaluations += measurement.force_evaluations;
+    total.seconds += measurement.seconds;
+    ++integrations;
+  }
+  state->SetItemsProcessed(total.force_evaluations);
+
+  // The step for the fixed step integrators, the relative tolerance for the
+  // adaptive one.
+  double step;
+  if (integrator == kEmbeddedRungeKuttaNyström) {
+    step = Tolerance(k);
+  } else if (problem == "HarmonicOscillator") {
+    step = 1.0 / (1 << k);
+  } else if (problem == "KeplerProblem") {
+    step = 2 * π / (1 << (k + 4));
+  } else {
+    step = kSolarSystemLargestStep / (1 << k) / Second;
+  }
+  std::ostringstream label;
+  label.precision(6);
+  label << problem << "," << IntegratorName(integrator) << "," << step << ","
+        << total.error << ","
+        << total.force_evaluations / integrations << ","
+        << total.seconds / integrations;
+  state->SetLabel(label.str());
+}
+
+// The integrators are those of the problems which may be written as
+// q" = f(q, t); the Wisdom-Holman integrators need a splitting of the
+// Hamiltonian.
+void HarmonicOscillatorAndKeplerProblemArguments(
+    benchmark::internal::Benchmark* const benchmark) {
+  for (int integrator = 0; integrator <= kEmbeddedRungeKuttaNyström;
+       ++integrator) {
+    if (integrator == kWisdomHolmanLeapfrog ||
+        integrator == kWisdomHolmanMcLachlanAtela1992Order5Optimal) {
+      continue;
+    }
+    for (int k = 0; k < kSweepLength; ++k) {
+      benchmark->ArgPair(integrator, k);
+    }
+  }
+}
+
+// The Gauss-Jackson integrator is only used by |NBodySystem| for the massless
+// bodies.
+void SolarSystemArguments(benchmark::internal::Benchmark* const benchmark) {
+  for (int integrator = 0; integrator <= kEmbeddedRungeKuttaNyström;
+       ++integrator) {
+    if (integrator == kGaussJacksonOrder8) {
+      continue;
+    }
+    for (int k = 0; k < kSweepLength; ++k) {
+      benchmark->ArgPair(integrator, k);
+    }
+  }
+}
+
+}  // namespace
+
+void BM_WorkPrecisionHarmonicOscillator(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  WorkPrecisionBenchmark(
+      "HarmonicOscillator", &SolveHarmonicOscillator, &state);
+}
+
+void BM_WorkPrecisionKeplerProblem(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  WorkPrecisionBenchmark("KeplerProblem", &SolveKeplerProblem, &state);
+}
+
+void BM_WorkPrecisionSolarSystem(
+    benchmark::State& state) {  // NOLINT(runtime/references)
+  WorkPrecisionBenchmark("SolarSystem", &IntegrateSolarSystem, &state);
+}
+
+BENCHMARK(BM_WorkPrecisionHarmonicOscillator)
+    ->Apply(HarmonicOscillatorAndKeplerProblemArguments);
+BENCHMARK(BM_WorkPrecisionKeplerProblem)
+    ->Apply(HarmonicOscillatorAndKeplerProblemArguments);
+BENCHMARK(BM_WorkPrecisionSolarSystem)->Apply(SolarSystemArguments);
+
+}  // namespace benchmarks
+}  // namespace principia
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "geometry/point.hpp"
 #include "geometry/grassmann.hpp"
 #include "serialization/geometry.pb.h"
@@ -20,6 +22,10 @@ class AffineMap {
 
   AffineMap<ToFrame, FromFrame, Scalar, LinearMap> Inverse() const;
   Point<ToVector> operator()(Point<FromVector> const& point) const;
+  // Applies this map to all the |points|.  Uses the corresponding operator of
+  // |LinearMap|, which must exist.
+  std::vector<Point<ToVector>> operator()(
+      std::vector<Point<FromVector>> const& points) const;
 
   static AffineMap Identity();
 
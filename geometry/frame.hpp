@@ -22,6 +22,11 @@ class Frame {
 
   // Checks that the |message| matches the current type.
   static void ReadFromMessage(serialization::Frame const& message);
+
+ private:
+  // The fingerprint of the full name of |Tag|.  It is computed on the first
+  // call and cached, since it is needed for each point of a trajectory.
+  static std::uint32_t TagTypeFingerprint();
 };
 
 // Extracts enough information from the |message| to contruct a |Frame| type.
@@ -2,6 +2,7 @@
 
 #include "geometry/frame.hpp"
 
+#include <map>
 #include <string>
 
 #include "base/fingerprint2011.hpp"
@@ -20,15 +21,31 @@ inline uint32_t Fingerprint(std::string const& s) {
   return Fingerprint2011(s.c_str(), s.size()) & 0xFFFFFFFF;
 }
 
+// Returns a map from the fingerprints of the enumeration types nested in
+// |serialization::Frame| to their descriptors.
+inline not_null<std::map<std::uint32_t,
+                         google::protobuf::EnumDescriptor const*> const*>
+NewFingerprintToEnumType() {
+  auto* const fingerprint_to_enum_type =
+      new std::map<std::uint32_t, google::protobuf::EnumDescriptor const*>;
+  const google::protobuf::Descriptor* frame_descriptor =
+      serialization::Frame::descriptor();
+  for (int i = 0; i < frame_descriptor->enum_type_count() ; ++i) {
+    const google::protobuf::EnumDescriptor* enum_type_descriptor =
+        frame_descriptor->enum_type(i);
+    fingerprint_to_enum_type->emplace(
+        Fingerprint(enum_type_descriptor->full_name()),
+        enum_type_descriptor);
+  }
+  return fingerprint_to_enum_type;
+}
+
 }  // namespace
 
 template<typename Tag, Tag tag, bool frame_is_inertial>
 void Frame<Tag, tag, frame_is_inertial>::WriteToMessage(
     not_null<serialization::Frame*> const message) {
-  std::string const& tag_type_full_name =
-      google::protobuf::GetEnumDescriptor<Tag>()->full_name();
-
-  message->set_tag_type_fingerprint(Fingerprint(tag_type_full_name));
+  message->set_tag_type_fingerprint(TagTypeFingerprint());
   message->set_tag(tag);
   message->set_is_inertial(frame_is_inertial);
 }
@@ -36,15 +53,19 @@ void Frame<Tag, tag, frame_is_inertial>::WriteToMessage(
 template<typename Tag, Tag tag, bool frame_is_inertial>
 void Frame<Tag, tag, frame_is_inertial>::ReadFromMessage(
     serialization::Frame const& message) {
-  std::string const& tag_type_full_name =
-      google::protobuf::GetEnumDescriptor<Tag>()->full_name();
-
-  CHECK_EQ(Fingerprint(tag_type_full_name), message.tag_type_fingerprint())
-      << tag_type_full_name;
+  CHECK_EQ(TagTypeFingerprint(), message.tag_type_fingerprint())
+      << google::protobuf::GetEnumDescriptor<Tag>()->full_name();
   CHECK_EQ(tag, message.tag());
   CHECK_EQ(frame_is_inertial, message.is_inertial());
 }
 
+template<typename Tag, Tag tag, bool frame_is_inertial>
+std::uint32_t Frame<Tag, tag, frame_is_inertial>::TagTypeFingerprint() {
+  static std::uint32_t const tag_type_fingerprint =
+      Fingerprint(google::protobuf::GetEnumDescriptor<Tag>()->full_name());
+  return tag_type_fingerprint;
+}
+
 // Default-initialized to {0, 0, 0}.
 template<typename Tag, Tag tag, bool frame_is_inertial>
 Position<Frame<Tag, tag, frame_is_inertial>> const
@@ -57,18 +78,12 @@ inline void ReadFrameFromMessage(
     not_null<bool*> const is_inertial) {
   // Look at the enumeration types nested in serialization::Frame for one that
   // matches our fingerprint.
-  const google::protobuf::Descriptor* frame_descriptor =
-      serialization::Frame::descriptor();
+  static auto const fingerprint_to_enum_type = NewFingerprintToEnumType();
   *enum_value_descriptor = nullptr;
-  for (int i = 0; i < frame_descriptor->enum_type_count() ; ++i) {
-    const google::protobuf::EnumDescriptor* enum_type_descriptor =
-        frame_descriptor->enum_type(i);
-    std::string const& enum_type_full_name = enum_type_descriptor->full_name();
-    if (Fingerprint(enum_type_full_name) == message.tag_type_fingerprint()) {
-      *enum_value_descriptor =
-          enum_type_descriptor->FindValueByNumber(message.tag());
-      break;
-    }
+  auto const it =
+      fingerprint_to_enum_type->find(message.tag_type_fingerprint());
+  if (it != fingerprint_to_enum_type->end()) {
+    *enum_value_descriptor = it->second->FindValueByNumber(message.tag());
   }
   CHECK_NOTNULL(*enum_value_descriptor);
   *is_inertial = message.is_inertial();
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "geometry/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::quantities::Length;
+
+namespace principia {
+namespace geometry {
+
+// A uniform grid of cubic cells indexing values by their positions, so that the
+// values near a position are found in time proportional to the number of cells
+// near that position rather than to the number of values.  Only the nonempty
+// cells are stored, in a hash table, so the grid may be unbounded and sparse.
+// If a query would visit more cells than there are nonempty cells, e.g.,
+// because the values are very far apart, it scans the nonempty cells instead,
+// so that a query is never worse than a linear search.
+template<typename Frame, typename Value>
+class HashGrid {
+ public:
+  // A value and its distance to the position of a query.
+  using ValueAndDistance = std::pair<Value, Length>;
+
+  explicit HashGrid(Length const& cell_size);
+
+  void Clear();
+  void Insert(Position<Frame> const& position, Value const& value);
+  std::int64_t size() const;
+
+  // Returns the values whose positions are within |radius| of |centre|, in
+  // increasing order of distance.
+  std::vector<ValueAndDistance> WithinRadius(Position<Frame> const& centre,
+                                             Length const& radius) const;
+
+  // Returns the |count| values whose positions are closest to |centre|, or all
+  // the values if there are fewer, in increasing order of distance.
+  std::vector<ValueAndDistance> Nearest(Position<Frame> const& centre,
+                                        int const count) const;
+
+ private:
+  struct Cell {
+    std::int64_t x;
+    std::int64_t y;
+    std::int64_t z;
+
+    bool operator==(Cell const& right) const;
+  };
+
+  struct CellHash {
+    std::size_t operator()(Cell const& cell) const;
+  };
+
+  struct Entry {
+    Position<Frame> position;
+    Value value;
+  };
+
+  using Cells = std::unordered_map<Cell, std::vector<Entry>, CellHash>;
+
+  Cell CellOf(Position<Frame> const& position) const;
+
+  // Appends to |result| the values in |entries| within |radius| of |centre|.
+  static void AppendWithinRadius(std::vector<Entry> const& entries,
+                                 Position<Frame> const& centre,
+                                 Length const& radius,
+                                 std::vector<ValueAndDistance>* const result);
+
+  // Sorts |result| by increasing distance.
+  static void SortByDistance(std::vector<ValueAndDistance>* const result);
+
+  Length const cell_size_;
+  Cells cells_;
+  std::int64_t size_ = 0;
+};
+
+}  // namespace geometry
+}  // namespace principia
+
+#include "geometry/hash_grid_body.hpp"
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "geometry/r3_element.hpp"
+#include "glog/logging.h"
+
+namespace principia {
+namespace geometry {
+
+template<typename Frame, typename Value>
+bool HashGrid<Frame, Value>::Cell::operator==(Cell const& right) const {
+  return x == right.x && y == right.y && z == right.z;
+}
+
+template<typename Frame, typename Value>
+std::size_t HashGrid<Frame, Value>::CellHash::operator()(
+    Cell const& cell) const {
+  // The multipliers are large primes, so that nearby cells don't collide.
+  return static_cast<std::size_t>(cell.x * 73856093 ^
+                                  cell.y * 19349663 ^
+                                  cell.z * 83492791);
+}
+
+template<typename Frame, typename Value>
+HashGrid<Frame, Value>::HashGrid(Length const& cell_size)
+    : cell_size_(cell_size) {
+  CHECK_LT(Length(), cell_size_);
+}
+
+template<typename Frame, typename Value>
+void HashGrid<Frame, Value>::Clear() {
+  cells_.clear();
+  size_ = 0;
+}
+
+template<typename Frame, typename Value>
+void HashGrid<Frame, Value>::Insert(Position<Frame> const& position,
+                                    Value const& value) {
+  cells_[CellOf(position)].push_back({position, value});
+  ++size_;
+}
+
+template<typename Frame, typename Value>
+std::int64_t HashGrid<Frame, Value>::size() const {
+  return size_;
+}
+
+template<typename Frame, typename Value>
+std::vector<typename HashGrid<Frame, Value>::ValueAndDistance>
+HashGrid<Frame, Value>::WithinRadius(Position<Frame> const& centre,
+                                     Length const& radius) const {
+  std::vector<ValueAndDistance> result;
+  Cell const min = CellOf(centre - Displacement<Frame>({radius,
+                                                        radius,
+                                                        radius}));
+  Cell const max = CellOf(centre + Displacement<Frame>({radius,
+                                                        radius,
+                                                        radius}));
+  // The number of cells covered by the query, as a double to avoid overflows.
+  double const covered_cells = static_cast<double>(max.x - min.x + 1) *
+                               static_cast<double>(max.y - min.y + 1) *
+                               static_cast<double>(max.z - min.z + 1);
+  if (covered_cells > cells_.size()) {
+    for (auto const& pair : cells_) {
+      AppendWithinRadius(pair.second, centre, radius, &result);
+    }
+  } else {
+    Cell cell;
+    for (cell.x = min.x; cell.x <= max.x; ++cell.x) {
+      for (cell.y = min.y; cell.y <= max.y; ++cell.y) {
+        for (cell.z = min.z; cell.z <= max.z; ++cell.z) {
+          auto const it = cells_.find(cell);
+          if (it != cells_.end()) {
+            AppendWithinRadius(it->second, centre, radius, &result);
+          }
+        }
+      }
+    }
+  }
+  SortByDistance(&result);
+  return result;
+}
+
+template<typename Frame, typename Value>
+std::vector<typename HashGrid<Frame, Value>::ValueAndDistance>
+HashGrid<Frame, Value>::Nearest(Position<Frame> const& centre,
+                                int const count) const {
+  CHECK_LE(0, count);
+  std::vector<ValueAndDistance> result;
+  if (count == 0) {
+    return result;
+  }
+  // The cells are visited in shells of increasing Chebyshev distance |k| to
+  // the cell of |centre|.  The values that have not been visited after the
+  // shell |k| are farther than |k * cell_size_| from |centre|.
+  Cell const centre_cell = CellOf(centre);
+  std::int64_t visited = 0;
+  for (std::int64_t k = 0;; ++k) {
+    double const shell_cells =
+        k == 0 ? 1 : std::pow(2.0 * k + 1, 3) - std::pow(2.0 * k - 1, 3);
+    if (shell_cells > cells_.size()) {
+      // Too sparse: it's cheaper to look at all the values.
+      result.clear();
+      for (auto const& pair : cells_) {
+        for (Entry const& entry : pair.second) {
+          result.emplace_back(entry.value, (entry.position - centre).Norm());
+        }
+      }
+      break;
+    }
+    Cell cell;
+    for (cell.x = centre_cell.x - k; cell.x <= centre_cell.x + k; ++cell.x) {
+      for (cell.y = centre_cell.y - k; cell.y <= centre_cell.y + k; ++cell.y) {
+        bool const on_shell_xy = std::abs(cell.x - centre_cell.x) == k ||
+                                 std::abs(cell.y - centre_cell.y) == k;
+        // Within the shell in x and y, only the faces orthogonal to z are
+        // visited.  Note that |on_shell_xy| is true if |k| is 0.
+        std::int64_t const z_step = on_shell_xy ? 1 : 2 * k;
+        for (cell.z = centre_cell.z - k;
+             cell.z <= centre_cell.z + k;
+             cell.z += z_step) {
+          auto const it = cells_.find(cell);
+          if (it != cells_.end()) {
+            for (Entry const& entry : it->second) {
+              result.emplace_back(entry.value,
+                                  (entry.position - centre).Norm());
+            }
+            visited += it->second.size();
+          }
+        }
+      }
+    }
+    if (visited == size_) {
+      break;
+    }
+    if (static_cast<int>(result.size()) >= count) {
+      std::nth_element(result.begin(),
+                       result.begin() + (count - 1),
+                       result.end(),
+                       [](ValueAndDistance const& left,
+                          ValueAndDistance const& right) {
+                         return left.second < right.second;
+                       });
+      if (result[count - 1].second <= k * cell_size_) {
+        break;
+      }
+    }
+  }
+  SortByDistance(&result);
+  if (static_cast<int>(result.size()) > count) {
+    result.resize(count);
+  }
+  return result;
+}
+
+template<typename Frame, typename Value>
+typename HashGrid<Frame, Value>::Cell HashGrid<Frame, Value>::CellOf(
+    Position<Frame> const& position) const {
+  R3Element<double> const coordinates =
+      (position - Frame::origin).coordinates() / cell_size_;
+  return {static_cast<std::int64_t>(std::floor(coordinates.x)),
+          static_cast<std::int64_t>(std::floor(coordinates.y)),
+          static_cast<std::int64_t>(std::floor(coordinates.z))};
+}
+
+template<typename Frame, typename Value>
+void HashGrid<Frame, Value>::AppendWithinRadius(
+    std::vector<Entry> const& entries,
+    Position<Frame> const& centre,
+    Length const& radius,
+    std::vector<ValueAndDistance>* const result) {
+  for (Entry const& entry : entries) {
+    Length const distance = (entry.position - centre).Norm();
+    if (distance <= radius) {
+      result->emplace_back(entry.value, distance);
+    }
+  }
+}
+
+template<typename Frame, typename Value>
+void HashGrid<Frame, Value>::SortByDistance(
+    std::vector<ValueAndDistance>* const result) {
+  std::stable_sort(result->begin(),
+                   result->end(),
+                   [](ValueAndDistance const& left,
+                      ValueAndDistance const& right) {
+                     return left.second < right.second;
+                   });
+}
+
+}  // namespace geometry
+}  // namespace principia
@@ -0,0 +1,125 @@
+#include "geometry/hash_grid.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "geometry/frame.hpp"
+#include "geometry/grassmann.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "quantities/si.hpp"
+
+using principia::si::Metre;
+using testing::ElementsAre;
+using testing::Eq;
+using testing::IsEmpty;
+
+namespace principia {
+namespace geometry {
+
+class HashGridTest : public testing::Test {
+ protected:
+  using World = Frame<serialization::Frame::TestTag,
+                      serialization::Frame::TEST, true>;
+  using Grid = HashGrid<World, int>;
+
+  HashGridTest() {
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<> coordinate(-1000, 1000);
+    for (int i = 0; i < 1000; ++i) {
+      positions_.push_back(World::origin +
+                           Displacement<World>({coordinate(random) * Metre,
+                                                coordinate(random) * Metre,
+                                                coordinate(random) * Metre}));
+    }
+  }
+
+  // The result of a linear search for the values within |radius| of |centre|.
+  std::vector<Grid::ValueAndDistance> LinearSearch(
+      Position<World> const& centre,
+      Length const& radius) const {
+    std::vector<Grid::ValueAndDistance> result;
+    for (int i = 0; i < static_cast<int>(positions_.size()); ++i) {
+      Length const distance = (positions_[i] - centre).Norm();
+      if (distance <= radius) {
+        result.emplace_back(i, distance);
+      }
+    }
+    std::stable_sort(result.begin(),
+                     result.end(),
+                     [](Grid::ValueAndDistance const& left,
+                        Grid::ValueAndDistance const& right) {
+                       return left.second < right.second;
+                     });
+    return result;
+  }
+
+  void Fill(not_null<Grid*> const grid) const {
+    for (int i = 0; i < static_cast<int>(positions_.size()); ++i) {
+      grid->Insert(positions_[i], i);
+    }
+  }
+
+  std::vector<Position<World>> positions_;
+};
+
+TEST_F(HashGridTest, Empty) {
+  Grid grid(1 * Metre);
+  EXPECT_THAT(grid.size(), Eq(0));
+  EXPECT_THAT(grid.WithinRadius(World::origin, 1 * Metre), IsEmpty());
+  EXPECT_THAT(grid.Nearest(World::origin, 3), IsEmpty());
+}
+
+TEST_F(HashGridTest, Clear) {
+  Grid grid(1 * Metre);
+  grid.Insert(World::origin, 1);
+  EXPECT_THAT(grid.size(), Eq(1));
+  grid.Clear();
+  EXPECT_THAT(grid.size(), Eq(0));
+  EXPECT_THAT(grid.Nearest(World::origin, 1), IsEmpty());
+  grid.Insert(World::origin, 2);
+  EXPECT_THAT(grid.Nearest(World::origin, 1),
+              ElementsAre(Grid::ValueAndDistance(2, 0 * Metre)));
+}
+
+// The queries give the same results as a linear search, whether the cells are
+// small or large compared to the queries and to the distances between the
+// values.
+TEST_F(HashGridTest, LinearSearch) {
+  for (Length const cell_size : {1 * Metre, 50 * Metre, 1E4 * Metre}) {
+    Grid grid(cell_size);
+    Fill(&grid);
+    EXPECT_THAT(grid.size(), Eq(positions_.size()));
+    for (int i = 0; i < 10; ++i) {
+      Position<World> const& centre = positions_[i * 97];
+      for (Length const radius : {0 * Metre, 100 * Metre, 5000 * Metre}) {
+        EXPECT_THAT(grid.WithinRadius(centre, radius),
+                    Eq(LinearSearch(centre, radius)))
+            << cell_size << " " << radius;
+      }
+      for (int const count : {1, 5, 2000}) {
+        std::vector<Grid::ValueAndDistance> expected =
+            LinearSearch(centre, 1E4 * Metre);
+        expected.resize(std::min(count, static_cast<int>(expected.size())));
+        EXPECT_THAT(grid.Nearest(centre, count), Eq(expected))
+            << cell_size << " " << count;
+      }
+    }
+  }
+}
+
+// A query far from all the values.
+TEST_F(HashGridTest, Far) {
+  Grid grid(1 * Metre);
+  Fill(&grid);
+  Position<World> const centre =
+      World::origin + Displacement<World>({1E9 * Metre, 0 * Metre, 0 * Metre});
+  EXPECT_THAT(grid.WithinRadius(centre, 1E3 * Metre), IsEmpty());
+  std::vector<Grid::ValueAndDistance> const nearest = grid.Nearest(centre, 1);
+  ASSERT_THAT(nearest.size(), Eq(1));
+  EXPECT_THAT(nearest.front(), Eq(LinearSearch(centre, 2E9 * Metre).front()));
+}
+
+}  // namespace geometry
+}  // namespace principia
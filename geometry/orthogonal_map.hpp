@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "base/mappable.hpp"
 #include "geometry/grassmann.hpp"
 #include "geometry/linear_map.hpp"
@@ -38,6 +40,12 @@ class OrthogonalMap : public LinearMap<FromFrame, ToFrame> {
   template<typename T>
   typename base::Mappable<OrthogonalMap, T>::type operator()(T const& t) const;
 
+  // Applies this map to all the |vectors|, see the corresponding operator of
+  // |Rotation|.
+  template<typename Scalar>
+  std::vector<Vector<Scalar, ToFrame>> operator()(
+      std::vector<Vector<Scalar, FromFrame>> const& vectors) const;
+
   static OrthogonalMap Identity();
 
   void WriteToMessage(not_null<serialization::LinearMap*> const message) const;
@@ -66,6 +74,14 @@ class OrthogonalMap : public LinearMap<FromFrame, ToFrame> {
   friend OrthogonalMap<From, To> operator*(
       OrthogonalMap<Through, To> const& left,
       OrthogonalMap<From, Through> const& right);
+  template<typename From, typename Through, typename To>
+  friend OrthogonalMap<From, To> operator*(
+      geometry::Identity<Through, To> const& left,
+      OrthogonalMap<From, Through> const& right);
+  template<typename From, typename Through, typename To>
+  friend OrthogonalMap<From, To> operator*(
+      OrthogonalMap<Through, To> const& left,
+      geometry::Identity<From, Through> const& right);
 
   friend class OrthogonalMapTest;
 };
@@ -75,6 +91,17 @@ OrthogonalMap<FromFrame, ToFrame> operator*(
     OrthogonalMap<ThroughFrame, ToFrame> const& left,
     OrthogonalMap<FromFrame, ThroughFrame> const& right);
 
+// As for |Rotation|, the compositions with an |Identity| only change the
+// frames.
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+OrthogonalMap<FromFrame, ToFrame> operator*(
+    Identity<ThroughFrame, ToFrame> const& left,
+    OrthogonalMap<FromFrame, ThroughFrame> const& right);
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+OrthogonalMap<FromFrame, ToFrame> operator*(
+    OrthogonalMap<ThroughFrame, ToFrame> const& left,
+    Identity<FromFrame, ThroughFrame> const& right);
+
 }  // namespace geometry
 }  // namespace principia
 
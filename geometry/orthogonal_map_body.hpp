@@ -48,6 +48,20 @@ OrthogonalMap<FromFrame, ToFrame>::operator()(T const& t) const {
   return base::Mappable<OrthogonalMap, T>::Do(*this, t);
 }
 
+template<typename FromFrame, typename ToFrame>
+template<typename Scalar>
+std::vector<Vector<Scalar, ToFrame>>
+OrthogonalMap<FromFrame, ToFrame>::operator()(
+    std::vector<Vector<Scalar, FromFrame>> const& vectors) const {
+  std::vector<Vector<Scalar, ToFrame>> result = rotation_(vectors);
+  if (determinant_.Negative()) {
+    for (auto& vector : result) {
+      vector = -vector;
+    }
+  }
+  return result;
+}
+
 template<typename FromFrame, typename ToFrame>
 OrthogonalMap<FromFrame, ToFrame>
 OrthogonalMap<FromFrame, ToFrame>::Identity() {
@@ -104,5 +118,21 @@ OrthogonalMap<FromFrame, ToFrame> operator*(
              left.rotation_ * right.rotation_);
 }
 
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+OrthogonalMap<FromFrame, ToFrame> operator*(
+    Identity<ThroughFrame, ToFrame> const& left,
+    OrthogonalMap<FromFrame, ThroughFrame> const& right) {
+  return OrthogonalMap<FromFrame, ToFrame>(right.determinant_,
+                                           left * right.rotation_);
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+OrthogonalMap<FromFrame, ToFrame> operator*(
+    OrthogonalMap<ThroughFrame, ToFrame> const& left,
+    Identity<FromFrame, ThroughFrame> const& right) {
+  return OrthogonalMap<FromFrame, ToFrame>(left.determinant_,
+                                           left.rotation_ * right);
+}
+
 }  // namespace geometry
 }  // namespace principia
@@ -125,6 +125,14 @@ TEST_F(OrthogonalMapTest, Composition) {
   EXPECT_TRUE((orthogonal_b_ * orthogonal_c_).Determinant().Negative());
 }
 
+TEST_F(OrthogonalMapTest, CompositionWithIdentity) {
+  Identity<World, World> const identity;
+  EXPECT_EQ(orthogonal_a_(vector_), (identity * orthogonal_a_)(vector_));
+  EXPECT_EQ(orthogonal_a_(bivector_), (orthogonal_a_ * identity)(bivector_));
+  EXPECT_TRUE((identity * orthogonal_a_).Determinant().Negative());
+  EXPECT_TRUE((orthogonal_a_ * identity).Determinant().Negative());
+}
+
 TEST_F(OrthogonalMapDeathTest, SerializationError) {
   Identity<World, World> id;
   EXPECT_DEATH({
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 #include "base/mappable.hpp"
 #include "geometry/grassmann.hpp"
 #include "geometry/linear_map.hpp"
@@ -12,6 +16,8 @@
 namespace principia {
 namespace geometry {
 
+template<typename FromFrame, typename ToFrame>
+class Identity;
 template<typename FromFrame, typename ToFrame>
 class OrthogonalMap;
 
@@ -51,6 +57,14 @@ class Rotation : public LinearMap<FromFrame, ToFrame> {
   template<typename T>
   typename base::Mappable<Rotation, T>::type operator()(T const& t) const;
 
+  // Applies this rotation to all the |vectors|.  This is faster than applying
+  // it to each of them, as the matrix of the rotation is computed on the first
+  // call and cached, and the products are vectorized.  The results may differ
+  // from those of the single-vector operator in the last bits.
+  template<typename Scalar>
+  std::vector<Vector<Scalar, ToFrame>> operator()(
+      std::vector<Vector<Scalar, FromFrame>> const& vectors) const;
+
   OrthogonalMap<FromFrame, ToFrame> Forget() const;
 
   static Rotation Identity();
@@ -65,7 +79,21 @@ class Rotation : public LinearMap<FromFrame, ToFrame> {
   template<typename Scalar>
   R3Element<Scalar> operator()(R3Element<Scalar> const& r3_element) const;
 
+  // Applies this rotation to the |size| triples of coordinates starting at
+  // |from|, and stores the results at |to|.  The arrays must not overlap.
+  void RotateCoordinates(double const* const from,
+                         std::int64_t const size,
+                         double* const to) const;
+
+  // Returns the matrix of this rotation, computing it if it is not yet in
+  // |matrix_|.
+  std::shared_ptr<R3x3Matrix const> Matrix() const;
+
   Quaternion quaternion_;
+  // The matrix of the rotation, computed lazily from |quaternion_| by the batch
+  // operations and shared by the copies of this object.  Accessed with the
+  // atomic functions for |shared_ptr| as it is set in const functions.
+  mutable std::shared_ptr<R3x3Matrix const> matrix_;
 
   // For constructing a rotation using a quaternion.
   template<typename From, typename To>
@@ -74,6 +102,14 @@ class Rotation : public LinearMap<FromFrame, ToFrame> {
   template<typename From, typename Through, typename To>
   friend Rotation<From, To> operator*(Rotation<Through, To> const& left,
                                       Rotation<From, Through> const& right);
+  template<typename From, typename Through, typename To>
+  friend Rotation<From, To> operator*(
+      geometry::Identity<Through, To> const& left,
+      Rotation<From, Through> const& right);
+  template<typename From, typename Through, typename To>
+  friend Rotation<From, To> operator*(
+      Rotation<Through, To> const& left,
+      geometry::Identity<From, Through> const& right);
 
   friend std::ostream& operator<<<>(std::ostream& out,  // NOLINT
                                     Rotation const& rotation);
@@ -85,6 +121,19 @@ Rotation<FromFrame, ToFrame> operator*(
     Rotation<ThroughFrame, ToFrame> const& left,
     Rotation<FromFrame, ThroughFrame> const& right);
 
+// The compositions with an |Identity| only change the frames: the quaternion,
+// and the matrix if it has been computed, are those of the rotation, so
+// composing is free and applying the result costs as much as applying the
+// rotation.
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+Rotation<FromFrame, ToFrame> operator*(
+    Identity<ThroughFrame, ToFrame> const& left,
+    Rotation<FromFrame, ThroughFrame> const& right);
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+Rotation<FromFrame, ToFrame> operator*(
+    Rotation<ThroughFrame, ToFrame> const& left,
+    Identity<FromFrame, ThroughFrame> const& right);
+
 }  // namespace geometry
 }  // namespace principia
 
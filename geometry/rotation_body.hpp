@@ -1,7 +1,11 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
+#include <vector>
 
+#include "base/cpu_features.hpp"
+#include "base/macros.hpp"
 #include "geometry/grassmann.hpp"
 #include "geometry/linear_map.hpp"
 #include "geometry/quaternion.hpp"
@@ -9,6 +13,10 @@
 #include "geometry/sign.hpp"
 #include "quantities/elementary_functions.hpp"
 
+#if PRINCIPIA_HAS_AVX_KERNELS
+#include <immintrin.h>
+#endif
+
 namespace principia {
 namespace geometry {
 
@@ -56,6 +64,40 @@ inline Quaternion ToQuaternion(R3x3Matrix const& matrix) {
   return Quaternion(real_part, imaginary_part);
 }
 
+#if PRINCIPIA_HAS_AVX_KERNELS
+// Applies the matrix with the given columns to the |size| vectors at |from|.
+// Each vector is computed in one register, as the linear combination of the
+// columns of the matrix; the fourth lane is unused and not stored.
+PRINCIPIA_TARGET_AVX
+inline void RotateCoordinatesAVX(double const m00,
+                                 double const m01,
+                                 double const m02,
+                                 double const m10,
+                                 double const m11,
+                                 double const m12,
+                                 double const m20,
+                                 double const m21,
+                                 double const m22,
+                                 double const* const from,
+                                 std::int64_t const size,
+                                 double* const to) {
+  __m256d const column_x = _mm256_setr_pd(m00, m10, m20, 0);
+  __m256d const column_y = _mm256_setr_pd(m01, m11, m21, 0);
+  __m256d const column_z = _mm256_setr_pd(m02, m12, m22, 0);
+  __m256i const mask = _mm256_setr_epi64x(-1, -1, -1, 0);
+  for (std::int64_t i = 0; i < 3 * size; i += 3) {
+    __m256d const x = _mm256_broadcast_sd(&from[i]);
+    __m256d const y = _mm256_broadcast_sd(&from[i + 1]);
+    __m256d const z = _mm256_broadcast_sd(&from[i + 2]);
+    __m256d const result =
+        _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(column_x, x),
+                                    _mm256_mul_pd(column_y, y)),
+                      _mm256_mul_pd(column_z, z));
+    _mm256_maskstore_pd(&to[i], mask, result);
+  }
+}
+#endif
+
 }  // namespace
 
 template<typename FromFrame, typename ToFrame>
@@ -119,6 +161,22 @@ Rotation<FromFrame, ToFrame>::operator()(T const& t) const {
   return base::Mappable<Rotation, T>::Do(*this, t);
 }
 
+template<typename FromFrame, typename ToFrame>
+template<typename Scalar>
+std::vector<Vector<Scalar, ToFrame>> Rotation<FromFrame, ToFrame>::operator()(
+    std::vector<Vector<Scalar, FromFrame>> const& vectors) const {
+  // The vectors are processed as arrays of coordinates, which requires that a
+  // vector be exactly three doubles.
+  static_assert(sizeof(Vector<Scalar, FromFrame>) == 3 * sizeof(double) &&
+                    sizeof(Vector<Scalar, ToFrame>) == 3 * sizeof(double),
+                "Vector is not three doubles");
+  std::vector<Vector<Scalar, ToFrame>> result(vectors.size());
+  RotateCoordinates(reinterpret_cast<double const*>(vectors.data()),
+                    vectors.size(),
+                    reinterpret_cast<double*>(result.data()));
+  return result;
+}
+
 template<typename FromFrame, typename ToFrame>
 OrthogonalMap<FromFrame, ToFrame> Rotation<FromFrame, ToFrame>::Forget() const {
   return OrthogonalMap<FromFrame, ToFrame>(Sign(1), *this);
@@ -168,6 +226,65 @@ R3Element<Scalar> Rotation<FromFrame, ToFrame>::operator()(
                                     real_part * r3_element);
 }
 
+template<typename FromFrame, typename ToFrame>
+void Rotation<FromFrame, ToFrame>::RotateCoordinates(double const* const from,
+                                                     std::int64_t const size,
+                                                     double* const to) const {
+  R3x3Matrix const& matrix = *Matrix();
+  double const m00 = matrix[{0, 0}];
+  double const m01 = matrix[{0, 1}];
+  double const m02 = matrix[{0, 2}];
+  double const m10 = matrix[{1, 0}];
+  double const m11 = matrix[{1, 1}];
+  double const m12 = matrix[{1, 2}];
+  double const m20 = matrix[{2, 0}];
+  double const m21 = matrix[{2, 1}];
+  double const m22 = matrix[{2, 2}];
+#if PRINCIPIA_HAS_AVX_KERNELS
+  if (base::UseAVX()) {
+    RotateCoordinatesAVX(m00, m01, m02, m10, m11, m12, m20, m21, m22,
+                         from, size, to);
+    return;
+  }
+#endif
+  for (std::int64_t i = 0; i < 3 * size; i += 3) {
+    double const x = from[i];
+    double const y = from[i + 1];
+    double const z = from[i + 2];
+    to[i] = m00 * x + m01 * y + m02 * z;
+    to[i + 1] = m10 * x + m11 * y + m12 * z;
+    to[i + 2] = m20 * x + m21 * y + m22 * z;
+  }
+}
+
+template<typename FromFrame, typename ToFrame>
+std::shared_ptr<R3x3Matrix const> Rotation<FromFrame, ToFrame>::Matrix() const {
+  std::shared_ptr<R3x3Matrix const> matrix = std::atomic_load(&matrix_);
+  if (matrix == nullptr) {
+    // The matrix of the rotation by the unit quaternion w + v, which is
+    // (w² - v²) I + 2 v vᵀ + 2 w [v]×.
+    double const w = quaternion_.real_part();
+    R3Element<double> const& v = quaternion_.imaginary_part();
+    auto computed_matrix = std::make_shared<R3x3Matrix const>(
+        R3Element<double>(1 - 2 * (v.y * v.y + v.z * v.z),
+                          2 * (v.x * v.y - w * v.z),
+                          2 * (v.x * v.z + w * v.y)),
+        R3Element<double>(2 * (v.x * v.y + w * v.z),
+                          1 - 2 * (v.x * v.x + v.z * v.z),
+                          2 * (v.y * v.z - w * v.x)),
+        R3Element<double>(2 * (v.x * v.z - w * v.y),
+                          2 * (v.y * v.z + w * v.x),
+                          1 - 2 * (v.x * v.x + v.y * v.y)));
+    // If another thread got there first, use its matrix, which is the same.
+    if (std::atomic_compare_exchange_strong(&matrix_,
+                                            &matrix,
+                                            computed_matrix)) {
+      matrix = std::move(computed_matrix);
+    }
+  }
+  return matrix;
+}
+
 template<typename FromFrame, typename ThroughFrame, typename ToFrame>
 Rotation<FromFrame, ToFrame> operator*(
     Rotation<ThroughFrame, ToFrame> const& left,
@@ -175,6 +292,24 @@ Rotation<FromFrame, ToFrame> operator*(
   return Rotation<FromFrame, ToFrame>(left.quaternion_ * right.quaternion_);
 }
 
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+Rotation<FromFrame, ToFrame> operator*(
+    Identity<ThroughFrame, ToFrame> const& left,
+    Rotation<FromFrame, ThroughFrame> const& right) {
+  Rotation<FromFrame, ToFrame> result(right.quaternion_);
+  result.matrix_ = std::atomic_load(&right.matrix_);
+  return result;
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+Rotation<FromFrame, ToFrame> operator*(
+    Rotation<ThroughFrame, ToFrame> const& left,
+    Identity<FromFrame, ThroughFrame> const& right) {
+  Rotation<FromFrame, ToFrame> result(left.quaternion_);
+  result.matrix_ = std::atomic_load(&left.matrix_);
+  return result;
+}
+
 template<typename FromFrame, typename ToFrame>
 std::ostream& operator<<(std::ostream& out,
                          Rotation<FromFrame, ToFrame> const& rotation) {
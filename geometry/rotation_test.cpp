@@ -1,5 +1,7 @@
 #include "geometry/rotation.hpp"
 
+#include <vector>
+
 #include "geometry/frame.hpp"
 #include "geometry/grassmann.hpp"
 #include "geometry/identity.hpp"
@@ -80,6 +82,35 @@ TEST_F(RotationTest, AppliedToVector) {
                                                 3.0 * Metre)), 0));
 }
 
+TEST_F(RotationTest, AppliedToVectors) {
+  std::vector<Vector<quantities::Length, World>> const vectors =
+      {vector_, 2 * vector_, -vector_, Vector<quantities::Length, World>()};
+  for (Rot const& rotation : {rotation_a_, rotation_b_, rotation_c_}) {
+    std::vector<Vector<quantities::Length, World>> const rotated_vectors =
+        rotation(vectors);
+    ASSERT_THAT(rotated_vectors.size(), Eq(vectors.size()));
+    for (std::size_t i = 0; i < vectors.size() - 1; ++i) {
+      EXPECT_THAT(rotated_vectors[i],
+                  AlmostEquals(rotation(vectors[i]), 0, 4)) << i;
+    }
+    EXPECT_THAT(rotated_vectors.back(),
+                Eq(Vector<quantities::Length, World>()));
+  }
+}
+
+// The matrix computed by the first batch application is reused by the
+// subsequent ones and by the copies of the rotation.
+TEST_F(RotationTest, CachedMatrix) {
+  std::vector<Vector<quantities::Length, World>> const vectors =
+      {vector_, 2 * vector_};
+  std::vector<Vector<quantities::Length, World>> const rotated_vectors =
+      rotation_a_(vectors);
+  Rot const copy = rotation_a_;
+  EXPECT_THAT(rotation_a_(vectors), Eq(rotated_vectors));
+  EXPECT_THAT(copy(vectors), Eq(rotated_vectors));
+  EXPECT_THAT(rotated_vectors[0], AlmostEquals(rotation_a_(vector_), 0, 4));
+}
+
 TEST_F(RotationTest, AppliedToBivector) {
   EXPECT_THAT(rotation_a_(bivector_),
               AlmostEquals(Bivector<quantities::Length, World>(
@@ -143,6 +174,19 @@ TEST_F(RotationTest, Composition) {
                                                 -3.0 * Metre)), 4));
 }
 
+// Checks that the compositions with an |Identity| give the same results as
+// the rotation, including for the batch operator, whose matrix is shared.
+TEST_F(RotationTest, CompositionWithIdentity) {
+  Identity<World, World> const identity;
+  EXPECT_EQ(rotation_a_(vector_), (identity * rotation_a_)(vector_));
+  EXPECT_EQ(rotation_a_(bivector_), (rotation_a_ * identity)(bivector_));
+  std::vector<Vector<quantities::Length, World>> const vectors = {vector_};
+  std::vector<Vector<quantities::Length, World>> const rotated =
+      rotation_a_(vectors);
+  EXPECT_EQ(rotated, (identity * rotation_a_)(vectors));
+  EXPECT_EQ(rotated, (rotation_a_ * identity)(vectors));
+}
+
 TEST_F(RotationTest, Forget) {
   Orth const orthogonal_a = rotation_a_.Forget();
   EXPECT_THAT(orthogonal_a(vector_),
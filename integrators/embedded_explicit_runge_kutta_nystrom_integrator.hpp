@@ -0,0 +1,110 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "base/not_null.hpp"
+#include "integrators/symplectic_integrator.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::base::not_null;
+using principia::quantities::Quotient;
+using principia::quantities::Time;
+
+namespace principia {
+namespace integrators {
+
+// An embedded explicit Runge-Kutta-Nyström method with step size control for
+// the second-order equation q" = f(t, q).  The step size is adjusted so that
+// the error estimated by the embedded lower-order method stays within the
+// tolerances.  Unlike |SPRKIntegrator|, this integrator is not symplectic, so
+// it is not suitable for long-term integration, but it can take much larger
+// steps where the acceleration varies slowly.
+// The coefficients are those of Dormand, El-Mikkawy and Prince (1986),
+// Families of Runge-Kutta-Nyström formulae, table 3 (RKN4(3)4FM).  The
+// propagated solution is of order 4, the error estimate is obtained from an
+// embedded method of order 3.  The last stage of a step is the first stage of
+// the next one (first same as last), so an accepted step costs 4 evaluations
+// of the acceleration.
+template<typename Position>
+class EmbeddedExplicitRungeKuttaNyströmIntegrator {
+ public:
+  using Velocity = Quotient<Position, Time>;
+  using Acceleration = Quotient<Velocity, Time>;
+
+  // The entire state of the system at a given time.  The vectors are indexed by
+  // dimension.
+  struct SystemState {
+    std::vector<DoublePrecision<Position>> positions;
+    std::vector<DoublePrecision<Velocity>> velocities;
+    DoublePrecision<Time> time;
+  };
+
+  struct Parameters {
+    // The initial state of the system.
+    SystemState initial;
+    // The ending time of the resolution.  It is reached exactly.
+    Time tmax;
+    // The size of the first step attempted; it is reduced if it doesn't meet
+    // the tolerances.  Must be positive.
+    Time first_time_step;
+    // The factor by which the step size suggested by the error estimate is
+    // multiplied, to reduce the number of rejected steps.  Must be in ]0, 1[.
+    double safety_factor = 0.9;
+    // The tolerances on the absolute errors on each component of the
+    // positions and velocities over one step.  Must be positive.
+    Position length_integration_tolerance;
+    Velocity speed_integration_tolerance;
+  };
+
+  // The scratch storage used by |Solve|.  Passing the same |Workspace| to
+  // successive calls avoids reallocating the intermediate vectors once they
+  // have reached their steady-state size.  A |Workspace| must not be shared by
+  // concurrent calls to |Solve|.
+  class Workspace {
+   public:
+    Workspace() = default;
+
+   private:
+    std::vector<DoublePrecision<Position>> q_;
+    std::vector<DoublePrecision<Velocity>> v_;
+    std::vector<Position> q_stage_;
+    std::vector<Position> Δq_;
+    std::vector<Velocity> Δv_;
+    // The accelerations at each stage.
+    std::vector<std::vector<Acceleration>> g_;
+
+    friend class EmbeddedExplicitRungeKuttaNyströmIntegrator;
+  };
+
+  EmbeddedExplicitRungeKuttaNyströmIntegrator();
+
+  // Integrates from |parameters.initial| to |parameters.tmax| and stores the
+  // final state in |*final_state|.  |compute_acceleration| is called as:
+  //   compute_acceleration(Time const& t,
+  //                        std::vector<Position> const& q,
+  //                        not_null<std::vector<Acceleration>*> const result);
+  template<typename RightHandSideComputation>
+  void Solve(RightHandSideComputation compute_acceleration,
+             Parameters const& parameters,
+             not_null<SystemState*> const final_state,
+             not_null<Workspace*> const workspace) const;
+
+ private:
+  int const stages_;
+  // The order of the embedded method used for the error estimate.
+  int const lower_order_;
+  std::vector<double> c_;
+  // Strictly lower triangular.
+  std::vector<std::vector<double>> a_;
+  // The weights of the propagated method, for the positions and velocities.
+  std::vector<double> b_hat_;
+  std::vector<double> b_prime_hat_;
+  // The weights of the embedded method, for the positions and velocities.
+  std::vector<double> b_;
+  std::vector<double> b_prime_;
+};
+
+}  // namespace integrators
+}  // namespace principia
+
+#include "integrators/embedded_explicit_runge_kutta_nystrom_integrator_body.hpp"
@@ -0,0 +1,162 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "glog/logging.h"
+#include "quantities/quantities.hpp"
+
+using principia::quantities::Abs;
+
+namespace principia {
+namespace integrators {
+
+template<typename Position>
+EmbeddedExplicitRungeKuttaNyströmIntegrator<Position>::
+EmbeddedExplicitRungeKuttaNyströmIntegrator()
+    : stages_(4),
+      lower_order_(3),
+      c_({0.0, 1.0 / 4.0, 7.0 / 10.0, 1.0}),
+      a_({{},
+          {1.0 / 32.0},
+          {7.0 / 1000.0, 119.0 / 500.0},
+          {1.0 / 14.0, 8.0 / 27.0, 25.0 / 189.0}}),
+      b_hat_({1.0 / 14.0, 8.0 / 27.0, 25.0 / 189.0, 0.0}),
+      b_prime_hat_({1.0 / 14.0, 32.0 / 81.0, 250.0 / 567.0, 5.0 / 54.0}),
+      b_({-7.0 / 150.0, 67.0 / 150.0, 3.0 / 20.0, -1.0 / 20.0}),
+      b_prime_({13.0 / 21.0, -20.0 / 27.0, 275.0 / 189.0, -1.0 / 3.0}) {}
+
+template<typename Position>
+template<typename RightHandSideComputation>
+void EmbeddedExplicitRungeKuttaNyströmIntegrator<Position>::Solve(
+    RightHandSideComputation compute_acceleration,
+    Parameters const& parameters,
+    not_null<SystemState*> const final_state,
+    not_null<Workspace*> const workspace) const {
+  int const dimension = parameters.initial.positions.size();
+  CHECK_EQ(dimension, parameters.initial.velocities.size());
+  CHECK_LT(Time(), parameters.first_time_step);
+  CHECK_LT(0.0, parameters.safety_factor);
+  CHECK_GT(1.0, parameters.safety_factor);
+  CHECK_LT(Position(), parameters.length_integration_tolerance);
+  CHECK_LT(Velocity(), parameters.speed_integration_tolerance);
+
+  std::vector<DoublePrecision<Position>>& q = workspace->q_;
+  std::vector<DoublePrecision<Velocity>>& v = workspace->v_;
+  std::vector<Position>& q_stage = workspace->q_stage_;
+  std::vector<Position>& Δq = workspace->Δq_;
+  std::vector<Velocity>& Δv = workspace->Δv_;
+  std::vector<std::vector<Acceleration>>& g = workspace->g_;
+  q.assign(parameters.initial.positions.begin(),
+           parameters.initial.positions.end());
+  v.assign(parameters.initial.velocities.begin(),
+           parameters.initial.velocities.end());
+  q_stage.resize(dimension);
+  Δq.resize(dimension);
+  Δv.resize(dimension);
+  g.resize(stages_);
+  for (auto& g_stage : g) {
+    g_stage.resize(dimension);
+  }
+
+  // The exponent used to compute a new step size from the ratio of the
+  // tolerance to the error: the local error of the embedded method is
+  // O(h^(lower_order_ + 1)).
+  double const exponent = 1.0 / (lower_order_ + 1);
+
+  // |t| is computed using compensated summation to make sure that we don't
+  // have drifts.
+  DoublePrecision<Time> t = parameters.initial.time;
+  Time h = parameters.first_time_step;
+
+  bool at_end = parameters.tmax <= t.value;
+  if (!at_end) {
+    for (int k = 0; k < dimension; ++k) {
+      q_stage[k] = q[k].value;
+    }
+    compute_acceleration(t.value + t.error, q_stage, &g[0]);
+  }
+  while (!at_end) {
+    double tolerance_to_error_ratio;
+    do {
+      // If the step would reach or overshoot |tmax|, make it end exactly at
+      // |tmax|.
+      at_end = parameters.tmax - t.value <= h;
+      if (at_end) {
+        h = (parameters.tmax - t.value) - t.error;
+      }
+
+      // The first stage is the acceleration at the beginning of the step,
+      // computed at the end of the previous step.
+      for (int i = 1; i < stages_; ++i) {
+        for (int k = 0; k < dimension; ++k) {
+          Acceleration Σj_a_ij_g_jk;
+          for (int j = 0; j < i; ++j) {
+            Σj_a_ij_g_jk += a_[i][j] * g[j][k];
+          }
+          q_stage[k] =
+              q[k].value + h * (c_[i] * v[k].value + h * Σj_a_ij_g_jk);
+        }
+        compute_acceleration(t.value + (t.error + c_[i] * h), q_stage, &g[i]);
+      }
+
+      // Compute the increments and the error estimate.  The error is the
+      // largest, over all the components, of the difference between the
+      // propagated and the embedded method relative to the tolerance.
+      double error_to_tolerance_ratio = 0.0;
+      for (int k = 0; k < dimension; ++k) {
+        Acceleration Σi_b_hat_i_g_ik;
+        Acceleration Σi_b_i_g_ik;
+        Acceleration Σi_b_prime_hat_i_g_ik;
+        Acceleration Σi_b_prime_i_g_ik;
+        for (int i = 0; i < stages_; ++i) {
+          Σi_b_hat_i_g_ik += b_hat_[i] * g[i][k];
+          Σi_b_i_g_ik += b_[i] * g[i][k];
+          Σi_b_prime_hat_i_g_ik += b_prime_hat_[i] * g[i][k];
+          Σi_b_prime_i_g_ik += b_prime_[i] * g[i][k];
+        }
+        Δq[k] = h * (v[k].value + h * Σi_b_hat_i_g_ik);
+        Δv[k] = h * Σi_b_prime_hat_i_g_ik;
+        Position const q_error = h * h * (Σi_b_hat_i_g_ik - Σi_b_i_g_ik);
+        Velocity const v_error =
+            h * (Σi_b_prime_hat_i_g_ik - Σi_b_prime_i_g_ik);
+        error_to_tolerance_ratio =
+            std::max({error_to_tolerance_ratio,
+                      Abs(q_error) / parameters.length_integration_tolerance,
+                      Abs(v_error) / parameters.speed_integration_tolerance});
+      }
+      tolerance_to_error_ratio = 1.0 / error_to_tolerance_ratio;
+
+      // The next step size, whether this step is accepted or rejected.  If the
+      // error is 0 this is infinite, and the next step ends at |tmax|.
+      Time const previous_h = h;
+      h *= parameters.safety_factor *
+           std::pow(tolerance_to_error_ratio, exponent);
+      if (tolerance_to_error_ratio >= 1.0) {
+        // Accept the step.  Compensated summation from "'SymplecticPartitioned
+        // RungeKutta' Method for NDSolve", algorithm 2.
+        for (int k = 0; k < dimension; ++k) {
+          q[k].Increment(Δq[k]);
+          v[k].Increment(Δv[k]);
+        }
+        t.Increment(previous_h);
+      }
+    } while (tolerance_to_error_ratio < 1.0);
+
+    if (!at_end) {
+      // The first stage of the next step.
+      for (int k = 0; k < dimension; ++k) {
+        q_stage[k] = q[k].value;
+      }
+      compute_acceleration(t.value + t.error, q_stage, &g[0]);
+    }
+  }
+
+  final_state->time = t;
+  final_state->positions.assign(q.begin(), q.end());
+  final_state->velocities.assign(v.begin(), v.end());
+}
+
+}  // namespace integrators
+}  // namespace principia
@@ -0,0 +1,162 @@
+﻿#include "integrators/embedded_explicit_runge_kutta_nystrom_integrator.hpp"
+
+#include <vector>
+
+#include "glog/logging.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::quantities::Abs;
+using principia::quantities::Acceleration;
+using principia::quantities::AngularFrequency;
+using principia::quantities::Cos;
+using principia::quantities::Length;
+using principia::quantities::Mass;
+using principia::quantities::SIUnit;
+using principia::quantities::Sin;
+using principia::quantities::Speed;
+using principia::quantities::Stiffness;
+using principia::quantities::Time;
+using testing::Eq;
+using testing::Gt;
+using testing::Lt;
+
+namespace principia {
+namespace integrators {
+
+namespace {
+
+// q" = -q.
+void ComputeHarmonicOscillatorAcceleration(
+    Time const& t,
+    std::vector<Length> const& q,
+    not_null<std::vector<Acceleration>*> const result) {
+  (*result)[0] = -q[0] * SIUnit<Stiffness>() / SIUnit<Mass>();
+}
+
+}  // namespace
+
+class EmbeddedExplicitRungeKuttaNyströmIntegratorTest : public testing::Test {
+ public:
+  static void SetUpTestCase() {
+    google::LogToStderr();
+  }
+
+ protected:
+  void SetUp() override {
+    parameters_.initial.positions.emplace_back(SIUnit<Length>());
+    parameters_.initial.velocities.emplace_back(Speed());
+    parameters_.initial.time = Time();
+    parameters_.tmax = 1000.0 * SIUnit<Time>();
+    parameters_.first_time_step = parameters_.tmax;
+    parameters_.length_integration_tolerance = 1.0E-6 * SIUnit<Length>();
+    parameters_.speed_integration_tolerance = 1.0E-6 * SIUnit<Speed>();
+  }
+
+  // Solves |parameters_| and returns the number of evaluations of the
+  // acceleration.
+  int Solve() {
+    int evaluations = 0;
+    integrator_.Solve(
+        [&evaluations](Time const& t,
+                       std::vector<Length> const& q,
+                       not_null<std::vector<Acceleration>*> const result) {
+          ++evaluations;
+          ComputeHarmonicOscillatorAcceleration(t, q, result);
+        },
+        parameters_,
+        &final_state_,
+        &workspace_);
+    return evaluations;
+  }
+
+  Length PositionError() const {
+    return Abs(final_state_.positions[0].value -
+               SIUnit<Length>() *
+                   Cos(final_state_.time.value * SIUnit<AngularFrequency>()));
+  }
+
+  Speed VelocityError() const {
+    return Abs(final_state_.velocities[0].value +
+               SIUnit<Speed>() *
+                   Sin(final_state_.time.value * SIUnit<AngularFrequency>()));
+  }
+
+  EmbeddedExplicitRungeKuttaNyströmIntegrator<Length> integrator_;
+  EmbeddedExplicitRungeKuttaNyströmIntegrator<Length>::Parameters parameters_;
+  EmbeddedExplicitRungeKuttaNyströmIntegrator<Length>::SystemState
+      final_state_;
+  EmbeddedExplicitRungeKuttaNyströmIntegrator<Length>::Workspace workspace_;
+};
+
+TEST_F(EmbeddedExplicitRungeKuttaNyströmIntegratorTest, HarmonicOscillator) {
+  int const evaluations = Solve();
+  LOG(INFO) << "Evaluations    : " << evaluations;
+  LOG(INFO) << "Position error : " << PositionError();
+  LOG(INFO) << "Velocity error : " << VelocityError();
+  EXPECT_THAT(final_state_.time.value, Eq(parameters_.tmax));
+  EXPECT_THAT(final_state_.time.error, Eq(Time()));
+  // The error is not controlled globally, but it should stay commensurate with
+  // the tolerance times the number of steps.
+  EXPECT_THAT(PositionError(), Lt(1.0E-3 * SIUnit<Length>()));
+  EXPECT_THAT(VelocityError(), Lt(1.0E-3 * SIUnit<Speed>()));
+  // Steps of about 85 ms.
+  EXPECT_THAT(evaluations, Lt(50000));
+}
+
+// The step size, and therefore the accuracy, is driven by the tolerance.
+TEST_F(EmbeddedExplicitRungeKuttaNyströmIntegratorTest, Tolerance) {
+  parameters_.tmax = 10.0 * SIUnit<Time>();
+  Length previous_position_error = SIUnit<Length>();
+  int previous_evaluations = 0;
+  for (double tolerance = 1.0E-2; tolerance > 1.0E-10; tolerance /= 100.0) {
+    parameters_.length_integration_tolerance = tolerance * SIUnit<Length>();
+    parameters_.speed_integration_tolerance = tolerance * SIUnit<Speed>();
+    int const evaluations = Solve();
+    LOG(INFO) << "Tolerance : " << tolerance << "\tevaluations : "
+              << evaluations << "\tposition error : " << PositionError();
+    EXPECT_THAT(final_state_.time.value, Eq(parameters_.tmax));
+    EXPECT_THAT(PositionError(), Lt(previous_position_error));
+    EXPECT_THAT(evaluations, Gt(previous_evaluations));
+    previous_position_error = PositionError();
+    previous_evaluations = evaluations;
+  }
+}
+
+// Without acceleration the embedded methods agree and the whole interval is
+// covered in one step.
+TEST_F(EmbeddedExplicitRungeKuttaNyströmIntegratorTest, FreeMotion) {
+  parameters_.initial.velocities[0] = SIUnit<Speed>();
+  int evaluations = 0;
+  integrator_.Solve(
+      [&evaluations](Time const& t,
+                     std::vector<Length> const& q,
+                     not_null<std::vector<Acceleration>*> const result) {
+        ++evaluations;
+        (*result)[0] = Acceleration();
+      },
+      parameters_,
+      &final_state_,
+      &workspace_);
+  EXPECT_THAT(evaluations, Eq(4));
+  EXPECT_THAT(final_state_.time.value, Eq(parameters_.tmax));
+  EXPECT_THAT(final_state_.positions[0].value,
+              Eq(SIUnit<Length>() + parameters_.tmax * SIUnit<Speed>()));
+  EXPECT_THAT(final_state_.velocities[0].value, Eq(SIUnit<Speed>()));
+}
+
+// If |tmax| is the initial time, the final state is the initial state and the
+// acceleration is never evaluated.
+TEST_F(EmbeddedExplicitRungeKuttaNyströmIntegratorTest, NoStep) {
+  parameters_.tmax = parameters_.initial.time.value;
+  EXPECT_THAT(Solve(), Eq(0));
+  EXPECT_THAT(final_state_.time.value, Eq(parameters_.tmax));
+  EXPECT_THAT(final_state_.positions[0].value, Eq(SIUnit<Length>()));
+  EXPECT_THAT(final_state_.velocities[0].value, Eq(Speed()));
+}
+
+}  // namespace integrators
+}  // namespace principia
@@ -0,0 +1,132 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "base/not_null.hpp"
+#include "integrators/symplectic_integrator.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::base::not_null;
+using principia::quantities::Exponentiation;
+using principia::quantities::Quotient;
+
+namespace principia {
+namespace integrators {
+
+// The coefficient sets known to |ForceGradientIntegrator|.  The comments give
+// the order of the method, its number of stages, and the number of the
+// evaluations of the forces of a step, after the first, that are modified.
+enum class ForceGradientScheme {
+  kChin1997Order4A,  // Order 4, 3 stages, FSAL, 1 modified.
+  kOrder6,           // Order 6, 5 stages, FSAL, 3 modified.
+};
+
+// A symplectic integrator for a separable Hamiltonian whose kinetic energy is
+// p²/2, so that the velocities are the momenta, whose kicks use the gradient of
+// the forces in addition to the forces.  The kick of a stage with a nonzero
+// gradient weight gᵢ uses the modified forces f + gᵢ h² (∇f) f, where ∇f is the
+// Jacobian of the forces with respect to the positions and h the step, i.e.,
+// the forces derived from the potential V - (gᵢ h² / 2) |∇V|².  These kicks
+// cancel some of the error terms of a splitting in kinetic and potential
+// energies, so that a given order is reached with fewer stages, see Chin
+// (1997), Symplectic integrators from composite operator factorizations, and
+// Omelyan, Mryglod and Folk (2003), Symplectic analytically integrable
+// decomposition algorithms.  They pay off when the product (∇f) f is cheap
+// compared to the forces, e.g., when it is computed in the same pass over the
+// pairs of bodies.
+template<typename Position, typename Momentum>
+class ForceGradientIntegrator
+    : public SymplecticIntegrator<Position, Momentum> {
+ public:
+  using Coefficients = typename SymplecticIntegrator<Position,
+                                                     Momentum>::Coefficients;
+  using Parameters = typename SymplecticIntegrator<Position,
+                                                   Momentum>::Parameters;
+  using SystemState = typename SymplecticIntegrator<Position,
+                                                    Momentum>::SystemState;
+
+  ForceGradientIntegrator();
+  ~ForceGradientIntegrator() override = default;
+
+  // Returns the coefficients of |scheme|, suitable for |Initialize|.
+  Coefficients const& CoefficientsOf(ForceGradientScheme const scheme) const;
+
+  // Returns the order of convergence of |scheme|.
+  static int OrderOf(ForceGradientScheme const scheme);
+
+  // The |coefficients| are the position weights, the momentum weights and the
+  // gradient weights, in this order.  As with |SPRKIntegrator|, each stage is a
+  // kick followed by a drift, and the method is first-same-as-last if the last
+  // position weight is 0 and the last momentum weight isn't.  The last gradient
+  // weight must then be equal to the first, so that the forces at the end of a
+  // step are those of the first kick of the next.
+  void Initialize(Coefficients const& coefficients) override;
+
+  // Initializes with |CoefficientsOf(scheme)|.
+  void Initialize(ForceGradientScheme const scheme);
+
+  // The scratch storage used by |SolveWithSink|, see
+  // |SPRKIntegrator::Workspace|.
+  class Workspace {
+   public:
+    Workspace() = default;
+
+   private:
+    DoublePrecisionVector<Position> q_last_;
+    DoublePrecisionVector<Momentum> p_last_;
+    std::vector<Position> q_stage_;
+    std::vector<Momentum> p_stage_;
+    std::vector<Position> Δq_;
+    std::vector<Momentum> Δp_;
+    std::vector<Quotient<Momentum, Time>> f_;  // Current forces.
+
+    friend class ForceGradientIntegrator;
+  };
+
+  // Integrates the system described by |parameters|, and passes each sampled
+  // state to |sink| as |SPRKIntegrator::SolveWithSink| does.  The forces are
+  // computed by |compute_force|, called as:
+  //   compute_force(Time const& t,
+  //                 std::vector<Position> const& positions,
+  //                 Exponentiation<Time, 2> const& c,
+  //                 not_null<std::vector<Quotient<Momentum, Time>>*> const
+  //                     forces);
+  // which must set |*forces| to f + c (∇f) f.  |c| is exactly 0 for the kicks
+  // whose gradient weight is 0, in which case the gradient need not be
+  // computed.
+  template<typename ForceComputation, typename Sink>
+  void SolveWithSink(ForceComputation compute_force,
+                     Parameters const& parameters,
+                     Sink sink,
+                     not_null<Workspace*> const workspace) const;
+
+ private:
+  // Advances |workspace->q_last_| and |workspace->p_last_| by a step of length
+  // |h| starting at |tn|.  If |forces_are_current| is true, |workspace->f_|
+  // holds the forces of the first kick of the step.
+  template<typename ForceComputation>
+  void Step(ForceComputation& compute_force,
+            DoublePrecision<Time> const& tn,
+            Time const& h,
+            bool const forces_are_current,
+            not_null<Workspace*> const workspace) const;
+
+  int stages_;
+
+  // True if the last position weight is 0 and the last momentum weight isn't,
+  // see |SPRKIntegrator|.
+  bool first_same_as_last_;
+
+  // The position, momentum and gradient weights.
+  std::vector<double> a_;
+  std::vector<double> b_;
+  std::vector<double> g_;
+
+  // The times of the stages, as fractions of the step.
+  std::vector<double> c_;
+};
+
+}  // namespace integrators
+}  // namespace principia
+
+#include "integrators/force_gradient_integrator_body.hpp"
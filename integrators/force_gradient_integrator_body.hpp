@@ -0,0 +1,216 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "base/macros.hpp"
+#include "base/tracer.hpp"
+#include "quantities/quantities.hpp"
+
+// Mixed assemblies are not supported by Unity/Mono.
+#include "glog/logging.h"
+
+using principia::base::ScopedTraceEvent;
+
+namespace principia {
+namespace integrators {
+
+template<typename Position, typename Momentum>
+inline ForceGradientIntegrator<Position, Momentum>::ForceGradientIntegrator()
+    : stages_(0),
+      first_same_as_last_(false) {}
+
+template<typename Position, typename Momentum>
+inline
+typename ForceGradientIntegrator<Position, Momentum>::Coefficients const&
+ForceGradientIntegrator<Position, Momentum>::CoefficientsOf(
+    ForceGradientScheme const scheme) const {
+  // The position weights come first, the momentum weights second, the gradient
+  // weights third.  In each stage the momenta are updated before the positions.
+  switch (scheme) {
+    case ForceGradientScheme::kChin1997Order4A: {
+      // The only modified kick is the middle one, with the potential
+      // V - (h² / 48) |∇V|².
+      static Coefficients const chin_1997_order_4a = {
+          {1.0 / 2.0,
+           1.0 / 2.0,
+           0.0},
+          {1.0 / 6.0,
+           2.0 / 3.0,
+           1.0 / 6.0},
+          {0.0,
+           1.0 / 24.0,
+           0.0}};
+      return chin_1997_order_4a;
+    }
+    case ForceGradientScheme::kOrder6: {
+      // A symmetric method whose weights are a solution of the order
+      // conditions for the Hamiltonians of the form p²/2 + V(q), obtained by
+      // Newton's method.  The outer kicks are not modified.
+      static Coefficients const order_6 = {
+          { 1.0798524263824305,
+           -0.5798524263824305,
+           -0.5798524263824305,
+            1.0798524263824305,
+            0.0},
+          { 0.3599508087941435,
+           -0.14371472730265406,
+            0.5675278370170211,
+           -0.14371472730265406,
+            0.3599508087941435},
+          { 0.0,
+            0.19434687712733761,
+           -0.13830873773040514,
+            0.19434687712733761,
+            0.0}};
+      return order_6;
+    }
+  }
+  LOG(FATAL) << "Unknown scheme " << static_cast<int>(scheme);
+  base::noreturn();
+}
+
+template<typename Position, typename Momentum>
+inline int ForceGradientIntegrator<Position, Momentum>::OrderOf(
+    ForceGradientScheme const scheme) {
+  switch (scheme) {
+    case ForceGradientScheme::kChin1997Order4A:
+      return 4;
+    case ForceGradientScheme::kOrder6:
+      return 6;
+  }
+  LOG(FATAL) << "Unknown scheme " << static_cast<int>(scheme);
+  base::noreturn();
+}
+
+template<typename Position, typename Momentum>
+inline void ForceGradientIntegrator<Position, Momentum>::Initialize(
+    Coefficients const& coefficients) {
+  CHECK_EQ(3, coefficients.size());
+  a_ = coefficients[0];
+  b_ = coefficients[1];
+  g_ = coefficients[2];
+  stages_ = b_.size();
+  CHECK_EQ(stages_, a_.size());
+  CHECK_EQ(stages_, g_.size());
+  first_same_as_last_ = stages_ > 1 && a_.back() == 0.0 && b_.back() != 0.0;
+  if (first_same_as_last_) {
+    CHECK_EQ(g_.front(), g_.back());
+  }
+
+  c_.resize(stages_);
+  c_[0] = 0.0;
+  for (int j = 1; j < stages_; ++j) {
+    c_[j] = c_[j - 1] + a_[j - 1];
+  }
+}
+
+template<typename Position, typename Momentum>
+inline void ForceGradientIntegrator<Position, Momentum>::Initialize(
+    ForceGradientScheme const scheme) {
+  Initialize(CoefficientsOf(scheme));
+}
+
+template<typename Position, typename Momentum>
+template<typename ForceComputation, typename Sink>
+void ForceGradientIntegrator<Position, Momentum>::SolveWithSink(
+    ForceComputation compute_force,
+    Parameters const& parameters,
+    Sink sink,
+    not_null<Workspace*> const workspace) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK_LT(0, stages_) << "Not initialized";
+  int const dimension = parameters.initial.positions.size();
+
+  DoublePrecisionVector<Position>& q_last = workspace->q_last_;
+  DoublePrecisionVector<Momentum>& p_last = workspace->p_last_;
+  q_last.Assign(parameters.initial.positions);
+  p_last.Assign(parameters.initial.momenta);
+  int sampling_phase = 0;
+
+  workspace->q_stage_.resize(dimension);
+  workspace->p_stage_.resize(dimension);
+  workspace->Δq_.resize(dimension);
+  workspace->Δp_.resize(dimension);
+  workspace->f_.resize(dimension);
+
+  // The steps are chosen as in |SPRKIntegrator::SolveWithSink|.
+  Time h = parameters.Δt;
+  DoublePrecision<Time> tn = parameters.initial.time;
+  bool at_end = !parameters.tmax_is_exact && parameters.tmax < tn.value + h;
+  bool forces_are_current = false;
+  while (!at_end) {
+    if (parameters.tmax_is_exact) {
+      if (parameters.tmax <= tn.value + 3 * h / 2) {
+        at_end = true;
+        Time const last_h = (parameters.tmax - tn.value) - tn.error;
+        // The modified forces of the first kick depend on the step, so they
+        // must be recomputed if it changes.
+        if (last_h != h && g_.front() != 0.0) {
+          forces_are_current = false;
+        }
+        h = last_h;
+      }
+    } else if (parameters.tmax < tn.value + 2 * h) {
+      at_end = true;
+    }
+
+    Step(compute_force, tn, h, forces_are_current, workspace);
+    forces_are_current = first_same_as_last_;
+    tn.Increment(h);
+
+    if (parameters.sampling_period != 0) {
+      if (sampling_phase % parameters.sampling_period == 0) {
+        sink(tn, q_last, p_last);
+      }
+      ++sampling_phase;
+    }
+  }
+  if (parameters.sampling_period == 0) {
+    sink(tn, q_last, p_last);
+  }
+}
+
+template<typename Position, typename Momentum>
+template<typename ForceComputation>
+void ForceGradientIntegrator<Position, Momentum>::Step(
+    ForceComputation& compute_force,
+    DoublePrecision<Time> const& tn,
+    Time const& h,
+    bool const forces_are_current,
+    not_null<Workspace*> const workspace) const {
+  int const dimension = workspace->q_stage_.size();
+  std::vector<Position>& q_stage = workspace->q_stage_;
+  std::vector<Momentum>& p_stage = workspace->p_stage_;
+  std::vector<Quotient<Momentum, Time>>& f = workspace->f_;
+  q_stage = workspace->q_last_.values;
+  p_stage = workspace->p_last_.values;
+  for (int i = 0; i < stages_; ++i) {
+    if (b_[i] != 0.0) {
+      if (i > 0 || !forces_are_current) {
+        Time const t_stage = tn.value + (tn.error + c_[i] * h);
+        compute_force(t_stage, q_stage, g_[i] * h * h, &f);
+      }
+      Time const kick = b_[i] * h;
+      for (int k = 0; k < dimension; ++k) {
+        p_stage[k] += kick * f[k];
+      }
+    }
+    if (a_[i] != 0.0) {
+      Time const drift = a_[i] * h;
+      for (int k = 0; k < dimension; ++k) {
+        q_stage[k] += drift * p_stage[k];
+      }
+    }
+  }
+  // The increments over the step are accumulated with compensated summation,
+  // as in |SPRKIntegrator|.
+  for (int k = 0; k < dimension; ++k) {
+    workspace->Δq_[k] = q_stage[k] - workspace->q_last_.values[k];
+    workspace->Δp_[k] = p_stage[k] - workspace->p_last_.values[k];
+  }
+  workspace->q_last_.Increment(workspace->Δq_);
+  workspace->p_last_.Increment(workspace->Δp_);
+}
+
+}  // namespace integrators
+}  // namespace principia
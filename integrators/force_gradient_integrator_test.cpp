@@ -0,0 +1,154 @@
+﻿#include "integrators/force_gradient_integrator.hpp"
+
+#include <cmath>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+
+using principia::quantities::Acceleration;
+using principia::quantities::Exponentiation;
+using principia::quantities::Length;
+using principia::quantities::Speed;
+using principia::quantities::Sqrt;
+using principia::quantities::Time;
+using principia::si::Metre;
+using principia::si::Second;
+using testing::Eq;
+using testing::Gt;
+
+namespace principia {
+namespace integrators {
+
+// A Kepler orbit of eccentricity |kEccentricity| for μ = 1 m³/s², in the plane,
+// starting at the periapsis.
+class ForceGradientIntegratorTest : public testing::Test {
+ protected:
+  ForceGradientIntegratorTest()
+      : modified_evaluations_(0),
+        unmodified_evaluations_(0) {
+    double const e = kEccentricity;
+    parameters_.initial.positions.emplace_back((1 - e) * Metre);
+    parameters_.initial.positions.emplace_back(0 * Metre);
+    parameters_.initial.momenta.emplace_back(0 * Metre / Second);
+    parameters_.initial.momenta.emplace_back(
+        std::sqrt((1 + e) / (1 - e)) * Metre / Second);
+    parameters_.initial.time = Time();
+    parameters_.tmax = 10 * Second;
+    parameters_.sampling_period = 0;
+    parameters_.tmax_is_exact = true;
+  }
+
+  // Returns the error on the position at |parameters_.tmax|.
+  Length FinalError() {
+    Length error;
+    integrator_.SolveWithSink(
+        [this](Time const& t,
+               std::vector<Length> const& q,
+               Exponentiation<Time, 2> const& c,
+               not_null<std::vector<Acceleration>*> const result) {
+          ComputeAcceleration(q, c, result);
+        },
+        parameters_,
+        [this, &error](DoublePrecision<Time> const& t,
+                       DoublePrecisionVector<Length> const& q,
+                       DoublePrecisionVector<Speed> const& p) {
+          EXPECT_THAT(t.value, Eq(parameters_.tmax));
+          // The solution of Kepler's equation by Newton's method.
+          double const e = kEccentricity;
+          double const mean_anomaly = t.value / Second;
+          double E = mean_anomaly;
+          for (int i = 0; i < 100; ++i) {
+            E -= (E - e * std::sin(E) - mean_anomaly) / (1 - e * std::cos(E));
+          }
+          Length const Δx = q.values[0] - (std::cos(E) - e) * Metre;
+          Length const Δy =
+              q.values[1] - std::sqrt(1 - e * e) * std::sin(E) * Metre;
+          error = Sqrt(Δx * Δx + Δy * Δy);
+        },
+        &workspace_);
+    return error;
+  }
+
+  // Sets |*result| to a + c (∇a) a, where a = -q / |q|³, and
+  // ∇a = (3 q̂ q̂ᵀ - 1) / |q|³.
+  void ComputeAcceleration(
+      std::vector<Length> const& q,
+      Exponentiation<Time, 2> const& c,
+      not_null<std::vector<Acceleration>*> const result) {
+    double const x = q[0] / Metre;
+    double const y = q[1] / Metre;
+    double const r_squared = x * x + y * y;
+    double const one_over_r_cubed = 1 / (r_squared * std::sqrt(r_squared));
+    double ax = -x * one_over_r_cubed;
+    double ay = -y * one_over_r_cubed;
+    if (c == Exponentiation<Time, 2>()) {
+      ++unmodified_evaluations_;
+    } else {
+      ++modified_evaluations_;
+      double const three_q_dot_a_over_r_squared =
+          3 * (x * ax + y * ay) / r_squared;
+      double const gx =
+          (x * three_q_dot_a_over_r_squared - ax) * one_over_r_cubed;
+      double const gy =
+          (y * three_q_dot_a_over_r_squared - ay) * one_over_r_cubed;
+      double const c_in_seconds_squared = c / (Second * Second);
+      ax += c_in_seconds_squared * gx;
+      ay += c_in_seconds_squared * gy;
+    }
+    (*result)[0] = ax * Metre / (Second * Second);
+    (*result)[1] = ay * Metre / (Second * Second);
+  }
+
+  static double const kEccentricity;
+
+  ForceGradientIntegrator<Length, Speed> integrator_;
+  ForceGradientIntegrator<Length, Speed>::Parameters parameters_;
+  ForceGradientIntegrator<Length, Speed>::Workspace workspace_;
+  int modified_evaluations_;
+  int unmodified_evaluations_;
+};
+
+double const ForceGradientIntegratorTest::kEccentricity = 0.5;
+
+TEST_F(ForceGradientIntegratorTest, Convergence) {
+  for (ForceGradientScheme const scheme :
+           {ForceGradientScheme::kChin1997Order4A,
+            ForceGradientScheme::kOrder6}) {
+    integrator_.Initialize(scheme);
+    parameters_.Δt = 0.05 * Second;
+    Length const error1 = FinalError();
+    parameters_.Δt = 0.025 * Second;
+    Length const error2 = FinalError();
+    double const order = std::log2(error1 / error2);
+    LOG(INFO) << "Scheme " << static_cast<int>(scheme) << ": order " << order
+              << ", error " << error2;
+    EXPECT_THAT(order, Gt(integrator_.OrderOf(scheme) - 0.2));
+  }
+}
+
+// The first kick of a step reuses the forces of the last kick of the previous
+// one, and only the kicks with a nonzero gradient weight are modified.
+TEST_F(ForceGradientIntegratorTest, Evaluations) {
+  parameters_.Δt = 1 * Second;
+
+  integrator_.Initialize(ForceGradientScheme::kChin1997Order4A);
+  FinalError();
+  EXPECT_THAT(unmodified_evaluations_, Eq(1 + 10));
+  EXPECT_THAT(modified_evaluations_, Eq(10));
+
+  unmodified_evaluations_ = 0;
+  modified_evaluations_ = 0;
+  integrator_.Initialize(ForceGradientScheme::kOrder6);
+  FinalError();
+  EXPECT_THAT(unmodified_evaluations_, Eq(1 + 10));
+  EXPECT_THAT(modified_evaluations_, Eq(3 * 10));
+}
+
+}  // namespace integrators
+}  // namespace principia
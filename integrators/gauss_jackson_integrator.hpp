@@ -0,0 +1,166 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "base/not_null.hpp"
+#include "integrators/symplectic_integrator.hpp"
+#include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::base::not_null;
+using principia::quantities::Quotient;
+
+namespace principia {
+namespace integrators {
+
+// The Gauss-Jackson summed predictor-corrector for q″ = f(t, q), in the
+// ordinate form of Berry and Healy (2004), Implementation of Gauss-Jackson
+// integration for orbit propagation.  A method of order N keeps the forces at
+// the last N + 1 points of a uniform grid, as well as their first and second
+// sums sₙ and Sₙ, defined by
+//   sₙ₊₁ = sₙ + (fₙ + fₙ₊₁) / 2,  Sₙ₊₁ = Sₙ + sₙ + fₙ / 2,
+// and computes the positions and velocities from
+//   qₙ = Δt² (Sₙ + Σ aₙⱼ fⱼ),  pₙ = Δt (sₙ + Σ bₙⱼ fⱼ),
+// where the ordinate coefficients aₙⱼ and bₙⱼ depend on the position of n in
+// the window of the forces.  Since the sums are updated once per step and
+// the positions are not accumulated, each step costs one evaluation of the
+// forces for the predictor, and optionally another one for the corrected
+// positions.  Like all the multistep methods, it is only stable if |Δt| is
+// small compared to the time scales of the motion.  This is not a symplectic
+// integrator, but it implements the same interface so that it may be used
+// wherever one is expected.  The momenta must be the velocities, and the
+// forces must not depend on them.
+template<typename Position, typename Momentum>
+class GaussJacksonIntegrator : public SymplecticIntegrator<Position, Momentum> {
+ public:
+  using Coefficients = typename SymplecticIntegrator<Position,
+                                                     Momentum>::Coefficients;
+  using Parameters = typename SymplecticIntegrator<Position,
+                                                   Momentum>::Parameters;
+  using SystemState = typename SymplecticIntegrator<Position,
+                                                    Momentum>::SystemState;
+
+  GaussJacksonIntegrator();
+  ~GaussJacksonIntegrator() override = default;
+
+  // The method of order 8.
+  Coefficients const& Order8() const;
+
+  // The |coefficients| of a method of order N are N + 2 rows of ordinate
+  // coefficients for the positions, followed by N + 1 rows for the velocities,
+  // each of size N + 1.  Row n gives the aₙⱼ (respectively bₙⱼ) for the point
+  // n of a window of N + 1 consecutive points, 0 ≤ j ≤ N; the last row for the
+  // positions, n = N + 1, is the predictor.  If |evaluate_corrected| is true,
+  // the forces are evaluated again at the corrected positions (PECE mode), at
+  // the cost of a second evaluation per step; otherwise, the forces at the
+  // predicted positions are kept (PEC mode), which is only stable for much
+  // shorter steps.  The first overload uses the PECE mode.
+  void Initialize(Coefficients const& coefficients) override;
+  void Initialize(Coefficients const& coefficients,
+                  bool const evaluate_corrected);
+
+  // The scratch storage used by |SolveWithSink|, see
+  // |SPRKIntegrator::Workspace|.
+  class Workspace {
+   public:
+    Workspace() = default;
+
+   private:
+    DoublePrecisionVector<Position> q_last_;
+    DoublePrecisionVector<Momentum> p_last_;
+    // The initial state and the states at the first N points of the grid after
+    // it, used by |Startup|.
+    DoublePrecisionVector<Position> q_initial_;
+    DoublePrecisionVector<Momentum> p_initial_;
+    std::vector<DoublePrecisionVector<Position>> q_startup_;
+    std::vector<DoublePrecisionVector<Momentum>> p_startup_;
+    // The forces at the last N + 1 points of the grid, oldest first.
+    std::vector<std::vector<Quotient<Momentum, Time>>> forces_;
+    // The first and second sums at the newest point of the grid.
+    DoublePrecisionVector<Quotient<Momentum, Time>> first_sums_;
+    DoublePrecisionVector<Quotient<Momentum, Time>> second_sums_;
+    std::vector<Quotient<Momentum, Time>> increments_;
+    std::vector<Position> Δq_;
+    std::vector<Momentum> Δp_;
+    Parameters startup_parameters_;
+    typename SPRKIntegrator<Position, Momentum>::Workspace startup_workspace_;
+
+    friend class GaussJacksonIntegrator;
+  };
+
+  // Integrates the system described by |parameters|, and passes each sampled
+  // state to |sink| as the overload of |SPRKIntegrator::SolveWithSink| for a
+  // kinetic energy p²/2 does.  The steps are chosen as by that function.  The
+  // first N points of the grid are computed by |Startup|; if the integration
+  // is too short for that, it is entirely made by |startup_integrator_|.  If
+  // |parameters.tmax_is_exact| is true, the last step, which is shorter or
+  // longer than |parameters.Δt|, is made by dense output from the last window
+  // of forces, so that the forces are never evaluated after
+  // |parameters.tmax|.
+  template<typename RightHandSideComputation, typename Sink>
+  void SolveWithSink(RightHandSideComputation compute_force,
+                     Parameters const& parameters,
+                     Sink sink,
+                     not_null<Workspace*> const workspace) const;
+
+ private:
+  // Computes the forces and sums for the first N + 1 points of the grid, and
+  // sets |workspace->q_last_| and |workspace->p_last_| to the state at the
+  // last of them, and |*tn| to its time.  The forces are first evaluated along
+  // N steps of |startup_integrator_|, and the positions are then corrected by
+  // the ordinate formulæ until they converge, so that the startup has the
+  // order of the method.  Calls |sink| for the N points of the grid after the
+  // initial one.
+  template<typename RightHandSideComputation, typename Sink>
+  void Startup(RightHandSideComputation& compute_force,
+               Parameters const& parameters,
+               Sink& sink,
+               not_null<DoublePrecision<Time>*> const tn,
+               not_null<int*> const sampling_phase,
+               not_null<Workspace*> const workspace) const;
+
+  // Sets |workspace->q_last_| (respectively |workspace->p_last_|) to the
+  // positions (velocities) at the point |n| of the window from the current
+  // sums and forces, using the row |n| of the ordinate coefficients.
+  void ComputePositions(Time const& h,
+                        int const n,
+                        not_null<Workspace*> const workspace) const;
+  void ComputeVelocities(Time const& h,
+                         int const n,
+                         not_null<Workspace*> const workspace) const;
+
+  // Increments the second sums by sₙ + fₙ / 2, and the first sums by
+  // (fₙ + fₙ₊₁) / 2, where fₙ and fₙ₊₁ are the forces at the points |j| and
+  // |j| + 1 of the window.
+  void IncrementSecondSums(int const j,
+                           not_null<Workspace*> const workspace) const;
+  void IncrementFirstSums(int const j,
+                          not_null<Workspace*> const workspace) const;
+
+  // Advances |workspace->q_last_| and |workspace->p_last_| by |θ| steps of
+  // length |h| from the newest point of the window, by integrating the
+  // polynomial that interpolates the forces of the window.
+  void DenseOutput(Time const& h,
+                   double const θ,
+                   not_null<Workspace*> const workspace) const;
+
+  // The order N.
+  int order_;
+  bool evaluate_corrected_;
+
+  // The ordinate coefficients, in the format described in |Initialize|.
+  std::vector<std::vector<double>> a_;
+  std::vector<std::vector<double>> b_;
+  // The coefficients of the Lagrange polynomials that interpolate the forces
+  // on the nodes -N, ..., 0, the newest point of the window being at 0.
+  // |lagrange_[j][i]| is the coefficient of τⁱ in the polynomial that is 1 at
+  // the node j - N.
+  std::vector<std::vector<double>> lagrange_;
+
+  SPRKIntegrator<Position, Momentum> startup_integrator_;
+};
+
+}  // namespace integrators
+}  // namespace principia
+
+#include "integrators/gauss_jackson_integrator_body.hpp"
@@ -0,0 +1,459 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "base/tracer.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/quantities.hpp"
+
+// Mixed assemblies are not supported by Unity/Mono.
+#include "glog/logging.h"
+
+using principia::base::ScopedTraceEvent;
+using principia::quantities::Abs;
+
+namespace principia {
+namespace integrators {
+
+namespace {
+
+// The startup corrects the positions until none of them changes by more than
+// this fraction of its magnitude, or at most this number of times.
+double const kStartupRelativeTolerance = 1E-14;
+int const kMaxStartupIterations = 10;
+
+}  // namespace
+
+template<typename Position, typename Momentum>
+inline GaussJacksonIntegrator<Position, Momentum>::GaussJacksonIntegrator()
+    : order_(0),
+      evaluate_corrected_(true) {
+  startup_integrator_.Initialize(startup_integrator_.Order5Optimal());
+}
+
+template<typename Position, typename Momentum>
+inline typename GaussJacksonIntegrator<Position, Momentum>::Coefficients const&
+GaussJacksonIntegrator<Position, Momentum>::Order8() const {
+  // The ordinate coefficients for a window of 9 points, derived from the
+  // expansions of Störmer-Cowell for the positions and of Euler-Maclaurin for
+  // the velocities.  They are those of Berry and Healy (2004), with the window
+  // starting at the initial point instead of being centred on it.
+  static double const a = 159667200.0;
+  static double const b = 7257600.0;
+  static Coefficients const order_8 = {
+      // The positions.
+      {9751299 / a, 16036748 / a, -34806724 / a, 48315732 / a, -45851950 / a,
+       29482676 / a, -12309348 / a, 3017324 / a, -330157 / a},
+      {-330157 / a, 12722712 / a, 4151096 / a, -7073536 / a, 6715950 / a,
+       -4252168 / a, 1749488 / a, -423696 / a, 45911 / a},
+      {45911 / a, -743356 / a, 14375508 / a, 294572 / a, -1288750 / a,
+       931164 / a, -395644 / a, 96692 / a, -10497 / a},
+      {-10497 / a, 140384 / a, -1121248 / a, 15257256 / a, -1028050 / a,
+       33872 / a, 49416 / a, -17752 / a, 2219 / a},
+      {2219 / a, -30468 / a, 220268 / a, -1307644 / a, 15536850 / a,
+       -1307644 / a, 220268 / a, -30468 / a, 2219 / a},
+      {2219 / a, -17752 / a, 49416 / a, 33872 / a, -1028050 / a, 15257256 / a,
+       -1121248 / a, 140384 / a, -10497 / a},
+      {-10497 / a, 96692 / a, -395644 / a, 931164 / a, -1288750 / a, 294572 / a,
+       14375508 / a, -743356 / a, 45911 / a},
+      {45911 / a, -423696 / a, 1749488 / a, -4252168 / a, 6715950 / a,
+       -7073536 / a, 4151096 / a, 12722712 / a, -330157 / a},
+      {-330157 / a, 3017324 / a, -12309348 / a, 29482676 / a, -45851950 / a,
+       48315732 / a, -34806724 / a, 16036748 / a, 9751299 / a},
+      {9751299 / a, -88091848 / a, 354064088 / a, -831418464 / a,
+       1258146350 / a, -1274515624 / a, 867424848 / a, -385853488 / a,
+       103798439 / a},
+      // The velocities.
+      {1546047 / b, -4274870 / b, 6996434 / b, -9005886 / b, 8277760 / b,
+       -5232322 / b, 2161710 / b, -526154 / b, 57281 / b},
+      {57281 / b, 1030518 / b, -2212754 / b, 2184830 / b, -1788480 / b,
+       1060354 / b, -420718 / b, 99594 / b, -10625 / b},
+      {-10625 / b, 152906 / b, 648018 / b, -1320254 / b, 846080 / b,
+       -449730 / b, 167854 / b, -38218 / b, 3969 / b},
+      {3969 / b, -46346 / b, 295790 / b, 314622 / b, -820160 / b, 345986 / b,
+       -116334 / b, 24970 / b, -2497 / b},
+      {-2497 / b, 26442 / b, -136238 / b, 505538 / b, 0 / b, -505538 / b,
+       136238 / b, -26442 / b, 2497 / b},
+      {2497 / b, -24970 / b, 116334 / b, -345986 / b, 820160 / b, -314622 / b,
+       -295790 / b, 46346 / b, -3969 / b},
+      {-3969 / b, 38218 / b, -167854 / b, 449730 / b, -846080 / b, 1320254 / b,
+       -648018 / b, -152906 / b, 10625 / b},
+      {10625 / b, -99594 / b, 420718 / b, -1060354 / b, 1788480 / b,
+       -2184830 / b, 2212754 / b, -1030518 / b, -57281 / b},
+      {-57281 / b, 526154 / b, -2161710 / b, 5232322 / b, -8277760 / b,
+       9005886 / b, -6996434 / b, 4274870 / b, -1546047 / b}};
+
+  return order_8;
+}
+
+template<typename Position, typename Momentum>
+inline void GaussJacksonIntegrator<Position, Momentum>::Initialize(
+    Coefficients const& coefficients) {
+  Initialize(coefficients, true /*evaluate_corrected*/);
+}
+
+template<typename Position, typename Momentum>
+inline void GaussJacksonIntegrator<Position, Momentum>::Initialize(
+    Coefficients const& coefficients,
+    bool const evaluate_corrected) {
+  CHECK_EQ(1, coefficients.size() % 2);
+  order_ = static_cast<int>(coefficients.size() - 3) / 2;
+  CHECK_LE(1, order_);
+  evaluate_corrected_ = evaluate_corrected;
+  a_.assign(coefficients.begin(), coefficients.begin() + order_ + 2);
+  b_.assign(coefficients.begin() + order_ + 2, coefficients.end());
+  for (auto const& row : coefficients) {
+    CHECK_EQ(order_ + 1, row.size());
+  }
+  lagrange_.resize(order_ + 1);
+  for (int j = 0; j <= order_; ++j) {
+    std::vector<double>& polynomial = lagrange_[j];
+    polynomial.assign(order_ + 1, 0.0);
+    polynomial[0] = 1.0;
+    int degree = 0;
+    for (int m = 0; m <= order_; ++m) {
+      if (m == j) {
+        continue;
+      }
+      // Multiply by (τ - (m - N)) / (j - m).
+      double const node = m - order_;
+      double const scale = 1.0 / (j - m);
+      ++degree;
+      for (int i = degree; i >= 0; --i) {
+        polynomial[i] = ((i > 0 ? polynomial[i - 1] : 0.0) -
+                         node * polynomial[i]) * scale;
+      }
+    }
+  }
+}
+
+template<typename Position, typename Momentum>
+template<typename RightHandSideComputation, typename Sink>
+void GaussJacksonIntegrator<Position, Momentum>::SolveWithSink(
+    RightHandSideComputation compute_force,
+    Parameters const& parameters,
+    Sink sink,
+    not_null<Workspace*> const workspace) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK_LT(0, order_) << "Not initialized";
+  Time const h = parameters.Δt;
+  Time const t0 = parameters.initial.time.value;
+  // The startup makes |order_| steps of length |h|, so it must not go past
+  // |parameters.tmax|, and if the end is exact, it must leave a last step
+  // longer than h / 2, as |SPRKIntegrator::SolveWithSink| would.
+  bool const can_start = parameters.tmax_is_exact
+                             ? parameters.tmax > t0 + (order_ + 0.5) * h
+                             : parameters.tmax >= t0 + order_ * h;
+  if (!can_start) {
+    startup_integrator_.SolveWithSink(compute_force,
+                                      parameters,
+                                      sink,
+                                      &workspace->startup_workspace_);
+    return;
+  }
+
+  DoublePrecisionVector<Position>& q_last = workspace->q_last_;
+  DoublePrecisionVector<Momentum>& p_last = workspace->p_last_;
+  std::vector<std::vector<Quotient<Momentum, Time>>>& forces =
+      workspace->forces_;
+  DoublePrecision<Time> tn = parameters.initial.time;
+  int sampling_phase = 0;
+  Startup(compute_force, parameters, sink, &tn, &sampling_phase, workspace);
+
+  // The steps are chosen as in |SPRKIntegrator::SolveWithSink|.
+  bool at_end = !parameters.tmax_is_exact && parameters.tmax < tn.value + h;
+  while (!at_end) {
+    if (parameters.tmax_is_exact &&
+        parameters.tmax <= tn.value + 3 * h / 2) {
+      at_end = true;
+      Time const last_h = (parameters.tmax - tn.value) - tn.error;
+      DenseOutput(h, last_h / h, workspace);
+      tn.Increment(last_h);
+    } else {
+      if (!parameters.tmax_is_exact && parameters.tmax < tn.value + 2 * h) {
+        at_end = true;
+      }
+      // Predict.
+      IncrementSecondSums(order_, workspace);
+      ComputePositions(h, order_ + 1, workspace);
+      tn.Increment(h);
+      // Evaluate, reusing the storage of the oldest forces.
+      std::rotate(forces.begin(), forces.begin() + 1, forces.end());
+      compute_force(tn.value, q_last.values, &forces.back());
+      // Correct, and evaluate again if requested.
+      ComputePositions(h, order_, workspace);
+      if (evaluate_corrected_) {
+        compute_force(tn.value, q_last.values, &forces.back());
+      }
+      IncrementFirstSums(order_ - 1, workspace);
+      ComputeVelocities(h, order_, workspace);
+    }
+
+    if (parameters.sampling_period != 0) {
+      if (sampling_phase % parameters.sampling_period == 0) {
+        sink(tn, q_last, p_last);
+      }
+      ++sampling_phase;
+    }
+  }
+  if (parameters.sampling_period == 0) {
+    sink(tn, q_last, p_last);
+  }
+}
+
+template<typename Position, typename Momentum>
+template<typename RightHandSideComputation, typename Sink>
+void GaussJacksonIntegrator<Position, Momentum>::Startup(
+    RightHandSideComputation& compute_force,
+    Parameters const& parameters,
+    Sink& sink,
+    not_null<DoublePrecision<Time>*> const tn,
+    not_null<int*> const sampling_phase,
+    not_null<Workspace*> const workspace) const {
+  int const dimension = parameters.initial.positions.size();
+  Time const h = parameters.Δt;
+  std::vector<std::vector<Quotient<Momentum, Time>>>& forces =
+      workspace->forces_;
+  std::vector<DoublePrecisionVector<Position>>& q_startup =
+      workspace->q_startup_;
+  std::vector<DoublePrecisionVector<Momentum>>& p_startup =
+      workspace->p_startup_;
+  forces.resize(order_ + 1);
+  q_startup.resize(order_);
+  p_startup.resize(order_);
+  for (int n = 0; n <= order_; ++n) {
+    forces[n].resize(dimension);
+  }
+  workspace->increments_.resize(dimension);
+  workspace->Δq_.resize(dimension);
+  workspace->Δp_.resize(dimension);
+  workspace->q_initial_.Assign(parameters.initial.positions);
+  workspace->p_initial_.Assign(parameters.initial.momenta);
+
+  // The first guess is made of the states after each step of
+  // |startup_integrator_|.  The steps end at the points of the grid since the
+  // end of this integration is not exact.
+  Parameters& startup_parameters = workspace->startup_parameters_;
+  startup_parameters.initial = parameters.initial;
+  startup_parameters.tmax =
+      parameters.initial.time.value + (order_ + 0.5) * h;
+  startup_parameters.Δt = h;
+  startup_parameters.sampling_period = 1;
+  startup_parameters.tmax_is_exact = false;
+  int steps = 0;
+  startup_integrator_.SolveWithSink(
+      compute_force,
+      startup_parameters,
+      [&q_startup, &p_startup, &steps](
+          DoublePrecision<Time> const& time,
+          DoublePrecisionVector<Position> const& positions,
+          DoublePrecisionVector<Momentum> const& momenta) {
+        q_startup[steps] = positions;
+        p_startup[steps] = momenta;
+        ++steps;
+      },
+      &workspace->startup_workspace_);
+  CHECK_EQ(order_, steps);
+
+  // The forces at the points of the grid are evaluated at the current guess,
+  // from which the ordinate formulæ give the next guess, until it converges.
+  // The sums are those at the last point of the grid, and are consistent with
+  // the last forces.
+  std::vector<DoublePrecision<Time>> times(order_ + 1, parameters.initial.time);
+  for (int n = 1; n <= order_; ++n) {
+    times[n] = times[n - 1];
+    times[n].Increment(h);
+  }
+  compute_force(times[0].value, workspace->q_initial_.values, &forces[0]);
+  DoublePrecisionVector<Quotient<Momentum, Time>>& first_sums =
+      workspace->first_sums_;
+  DoublePrecisionVector<Quotient<Momentum, Time>>& second_sums =
+      workspace->second_sums_;
+  std::vector<Quotient<Momentum, Time>>& increments = workspace->increments_;
+  for (int iteration = 0; iteration < kMaxStartupIterations; ++iteration) {
+    for (int n = 1; n <= order_; ++n) {
+      compute_force(times[n].value, q_startup[n - 1].values, &forces[n]);
+    }
+    // The sums at the initial point are such that the ordinate formulæ give
+    // the initial state.
+    first_sums.values.assign(dimension, Quotient<Momentum, Time>());
+    first_sums.errors.assign(dimension, Quotient<Momentum, Time>());
+    second_sums.values.assign(dimension, Quotient<Momentum, Time>());
+    second_sums.errors.assign(dimension, Quotient<Momentum, Time>());
+    for (int k = 0; k < dimension; ++k) {
+      Quotient<Momentum, Time> bf = b_[0][0] * forces[0][k];
+      for (int j = 1; j <= order_; ++j) {
+        bf += b_[0][j] * forces[j][k];
+      }
+      first_sums.values[k] = workspace->p_initial_.values[k] / h;
+      increments[k] = workspace->p_initial_.errors[k] / h - bf;
+    }
+    first_sums.Increment(increments);
+    for (int k = 0; k < dimension; ++k) {
+      Quotient<Momentum, Time> af = a_[0][0] * forces[0][k];
+      for (int j = 1; j <= order_; ++j) {
+        af += a_[0][j] * forces[j][k];
+      }
+      second_sums.values[k] = workspace->q_initial_.values[k] / (h * h);
+      increments[k] = workspace->q_initial_.errors[k] / (h * h) - af;
+    }
+    second_sums.Increment(increments);
+
+    bool converged = true;
+    for (int n = 1; n <= order_; ++n) {
+      IncrementSecondSums(n - 1, workspace);
+      IncrementFirstSums(n - 1, workspace);
+      ComputePositions(h, n, workspace);
+      ComputeVelocities(h, n, workspace);
+      for (int k = 0; k < dimension && converged; ++k) {
+        Position const& q = workspace->q_last_.values[k];
+        converged = Abs(q - q_startup[n - 1].values[k]) <=
+                    kStartupRelativeTolerance * Abs(q);
+      }
+      q_startup[n - 1] = workspace->q_last_;
+      p_startup[n - 1] = workspace->p_last_;
+    }
+    if (converged) {
+      break;
+    }
+  }
+
+  for (int n = 1; n <= order_; ++n) {
+    *tn = times[n];
+    if (parameters.sampling_period != 0) {
+      if (*sampling_phase % parameters.sampling_period == 0) {
+        sink(*tn, q_startup[n - 1], p_startup[n - 1]);
+      }
+      ++*sampling_phase;
+    }
+  }
+}
+
+template<typename Position, typename Momentum>
+void GaussJacksonIntegrator<Position, Momentum>::ComputePositions(
+    Time const& h,
+    int const n,
+    not_null<Workspace*> const workspace) const {
+  std::vector<std::vector<Quotient<Momentum, Time>>> const& f =
+      workspace->forces_;
+  DoublePrecisionVector<Quotient<Momentum, Time>> const& S =
+      workspace->second_sums_;
+  DoublePrecisionVector<Position>& q = workspace->q_last_;
+  std::vector<Position>& Δq = workspace->Δq_;
+  std::vector<double> const& a = a_[n];
+  int const dimension = Δq.size();
+  q.values.resize(dimension);
+  q.errors.assign(dimension, Position());
+  for (int k = 0; k < dimension; ++k) {
+    Quotient<Momentum, Time> af = a[0] * f[0][k];
+    for (int j = 1; j <= order_; ++j) {
+      af += a[j] * f[j][k];
+    }
+    q.values[k] = h * (h * S.values[k]);
+    Δq[k] = h * (h * (S.errors[k] + af));
+  }
+  q.Increment(Δq);
+}
+
+template<typename Position, typename Momentum>
+void GaussJacksonIntegrator<Position, Momentum>::ComputeVelocities(
+    Time const& h,
+    int const n,
+    not_null<Workspace*> const workspace) const {
+  std::vector<std::vector<Quotient<Momentum, Time>>> const& f =
+      workspace->forces_;
+  DoublePrecisionVector<Quotient<Momentum, Time>> const& s =
+      workspace->first_sums_;
+  DoublePrecisionVector<Momentum>& p = workspace->p_last_;
+  std::vector<Momentum>& Δp = workspace->Δp_;
+  std::vector<double> const& b = b_[n];
+  int const dimension = Δp.size();
+  p.values.resize(dimension);
+  p.errors.assign(dimension, Momentum());
+  for (int k = 0; k < dimension; ++k) {
+    Quotient<Momentum, Time> bf = b[0] * f[0][k];
+    for (int j = 1; j <= order_; ++j) {
+      bf += b[j] * f[j][k];
+    }
+    p.values[k] = h * s.values[k];
+    Δp[k] = h * (s.errors[k] + bf);
+  }
+  p.Increment(Δp);
+}
+
+template<typename Position, typename Momentum>
+void GaussJacksonIntegrator<Position, Momentum>::IncrementSecondSums(
+    int const j,
+    not_null<Workspace*> const workspace) const {
+  std::vector<Quotient<Momentum, Time>> const& f = workspace->forces_[j];
+  DoublePrecisionVector<Quotient<Momentum, Time>> const& s =
+      workspace->first_sums_;
+  std::vector<Quotient<Momentum, Time>>& increments = workspace->increments_;
+  int const dimension = increments.size();
+  for (int k = 0; k < dimension; ++k) {
+    increments[k] = s.values[k] + (s.errors[k] + 0.5 * f[k]);
+  }
+  workspace->second_sums_.Increment(increments);
+}
+
+template<typename Position, typename Momentum>
+void GaussJacksonIntegrator<Position, Momentum>::IncrementFirstSums(
+    int const j,
+    not_null<Workspace*> const workspace) const {
+  std::vector<Quotient<Momentum, Time>> const& f = workspace->forces_[j];
+  std::vector<Quotient<Momentum, Time>> const& f_next =
+      workspace->forces_[j + 1];
+  std::vector<Quotient<Momentum, Time>>& increments = workspace->increments_;
+  int const dimension = increments.size();
+  for (int k = 0; k < dimension; ++k) {
+    increments[k] = 0.5 * (f[k] + f_next[k]);
+  }
+  workspace->first_sums_.Increment(increments);
+}
+
+template<typename Position, typename Momentum>
+void GaussJacksonIntegrator<Position, Momentum>::DenseOutput(
+    Time const& h,
+    double const θ,
+    not_null<Workspace*> const workspace) const {
+  // The weights of the forces in the increments of the velocities and
+  // positions, i.e., the integrals from 0 to θ of the Lagrange polynomials
+  // and of their products by θ - τ.
+  std::vector<double> velocity_weights(order_ + 1);
+  std::vector<double> position_weights(order_ + 1);
+  for (int j = 0; j <= order_; ++j) {
+    double velocity_weight = 0.0;
+    double position_weight = 0.0;
+    double θ_power = θ;
+    for (int i = 0; i <= order_; ++i) {
+      velocity_weight += lagrange_[j][i] * θ_power / (i + 1);
+      θ_power *= θ;
+      position_weight += lagrange_[j][i] * θ_power / ((i + 1) * (i + 2));
+    }
+    velocity_weights[j] = velocity_weight;
+    position_weights[j] = position_weight;
+  }
+  std::vector<std::vector<Quotient<Momentum, Time>>> const& f =
+      workspace->forces_;
+  DoublePrecisionVector<Position>& q = workspace->q_last_;
+  DoublePrecisionVector<Momentum>& p = workspace->p_last_;
+  std::vector<Position>& Δq = workspace->Δq_;
+  std::vector<Momentum>& Δp = workspace->Δp_;
+  int const dimension = Δq.size();
+  for (int k = 0; k < dimension; ++k) {
+    Quotient<Momentum, Time> vf = velocity_weights[0] * f[0][k];
+    Quotient<Momentum, Time> pf = position_weights[0] * f[0][k];
+    for (int j = 1; j <= order_; ++j) {
+      vf += velocity_weights[j] * f[j][k];
+      pf += position_weights[j] * f[j][k];
+    }
+    Δq[k] = θ * h * p.values[k] + h * (h * pf);
+    Δp[k] = h * vf;
+  }
+  q.Increment(Δq);
+  p.Increment(Δp);
+}
+
+}  // namespace integrators
+}  // namespace principia
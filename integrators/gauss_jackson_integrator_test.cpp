@@ -0,0 +1,191 @@
+﻿#include "integrators/gauss_jackson_integrator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+
+using principia::quantities::Abs;
+using principia::quantities::Acceleration;
+using principia::quantities::AngularFrequency;
+using principia::quantities::Cos;
+using principia::quantities::Length;
+using principia::quantities::Sin;
+using principia::quantities::Speed;
+using principia::quantities::Time;
+using principia::si::Metre;
+using principia::si::Radian;
+using principia::si::Second;
+using testing::AllOf;
+using testing::Gt;
+using testing::Lt;
+
+namespace principia {
+namespace integrators {
+
+// The harmonic oscillator q″ = -ω² q.
+class GaussJacksonIntegratorTest : public testing::Test {
+ protected:
+  GaussJacksonIntegratorTest()
+      : ω_(1 * Radian / Second),
+        evaluations_(0) {
+    integrator_.Initialize(integrator_.Order8());
+    parameters_.initial.positions.emplace_back(1 * Metre);
+    parameters_.initial.momenta.emplace_back(0 * Metre / Second);
+    parameters_.initial.time = Time();
+    parameters_.tmax = 1000 * Second;
+    parameters_.sampling_period = 1;
+  }
+
+  // Integrates with the step |Δt| and sets |position_error_| and
+  // |velocity_error_| to the largest errors over the integration.
+  void Integrate(Time const& Δt) {
+    parameters_.Δt = Δt;
+    AngularFrequency const ω = ω_;
+    position_error_ = Length();
+    velocity_error_ = Speed();
+    integrator_.SolveWithSink(
+        [this, ω](Time const& t,
+                  std::vector<Length> const& q,
+                  not_null<std::vector<Acceleration>*> const result) {
+          ++evaluations_;
+          (*result)[0] = -ω * ω * q[0] / (Radian * Radian);
+        },
+        parameters_,
+        [this, ω](DoublePrecision<Time> const& t,
+                  DoublePrecisionVector<Length> const& q,
+                  DoublePrecisionVector<Speed> const& p) {
+          position_error_ = std::max(
+              position_error_, Abs(q.values[0] - 1 * Metre * Cos(ω * t.value)));
+          velocity_error_ = std::max(
+              velocity_error_,
+              Abs(p.values[0] +
+                  1 * Metre * ω * Sin(ω * t.value) / Radian));
+        },
+        &workspace_);
+  }
+
+  AngularFrequency const ω_;
+  GaussJacksonIntegrator<Length, Speed> integrator_;
+  GaussJacksonIntegrator<Length, Speed>::Parameters parameters_;
+  GaussJacksonIntegrator<Length, Speed>::Workspace workspace_;
+  int evaluations_;
+  Length position_error_;
+  Speed velocity_error_;
+};
+
+// The errors on the positions and velocities decrease faster than Δt⁸, and
+// are much smaller than those of the SPRK used for the startup with the same
+// number of evaluations of the forces.
+TEST_F(GaussJacksonIntegratorTest, Convergence) {
+  Integrate(0.2 * Second);
+  Length const position_error = position_error_;
+  Speed const velocity_error = velocity_error_;
+  EXPECT_THAT(position_error, AllOf(Gt(1E-9 * Metre), Lt(1E-7 * Metre)));
+  EXPECT_THAT(velocity_error,
+              AllOf(Gt(1E-9 * Metre / Second), Lt(1E-7 * Metre / Second)));
+  Integrate(0.1 * Second);
+  EXPECT_THAT(position_error / position_error_, AllOf(Gt(1000.0), Lt(4000.0)));
+  EXPECT_THAT(velocity_error / velocity_error_, AllOf(Gt(1000.0), Lt(4000.0)));
+
+  // The order 5 optimal SPRK, which has 6 stages, with the same number of
+  // evaluations of the forces as the PECE mode.
+  SPRKIntegrator<Length, Speed> sprk;
+  SPRKIntegrator<Length, Speed>::Workspace sprk_workspace;
+  sprk.Initialize(sprk.Order5Optimal());
+  parameters_.Δt = 0.6 * Second;
+  AngularFrequency const ω = ω_;
+  Length sprk_error;
+  sprk.SolveWithSink(
+      [ω](Time const& t,
+          std::vector<Length> const& q,
+          not_null<std::vector<Acceleration>*> const result) {
+        (*result)[0] = -ω * ω * q[0] / (Radian * Radian);
+      },
+      parameters_,
+      [ω, &sprk_error](DoublePrecision<Time> const& t,
+                       DoublePrecisionVector<Length> const& q,
+                       DoublePrecisionVector<Speed> const& p) {
+        sprk_error = std::max(
+            sprk_error, Abs(q.values[0] - 1 * Metre * Cos(ω * t.value)));
+      },
+      &sprk_workspace);
+  EXPECT_THAT(sprk_error, Gt(100 * position_error));
+}
+
+// The PEC mode is less accurate for a given step, and it is unstable for
+// steps with which the PECE mode is fine.
+TEST_F(GaussJacksonIntegratorTest, PEC) {
+  integrator_.Initialize(integrator_.Order8(), false /*evaluate_corrected*/);
+  Integrate(0.1 * Second);
+  EXPECT_THAT(position_error_, AllOf(Gt(1E-10 * Metre), Lt(1E-9 * Metre)));
+  Integrate(0.2 * Second);
+  EXPECT_THAT(position_error_, Gt(1 * Metre));
+}
+
+// After the startup, there are two evaluations of the forces per step in the
+// PECE mode, and one in the PEC mode.
+TEST_F(GaussJacksonIntegratorTest, Evaluations) {
+  parameters_.tmax = 100 * Second;
+  Integrate(0.125 * Second);
+  // The initial evaluation, the 8 steps of the startup integrator, which has
+  // 6 stages, the 6 iterations of the startup, each evaluating the forces at
+  // 8 points, and the 792 steps of the method.
+  EXPECT_EQ(1 + 8 * 6 + 6 * 8 + 792 * 2, evaluations_);
+  integrator_.Initialize(integrator_.Order8(), false /*evaluate_corrected*/);
+  evaluations_ = 0;
+  Integrate(0.125 * Second);
+  EXPECT_EQ(1 + 8 * 6 + 6 * 8 + 792, evaluations_);
+}
+
+// The last step is made by dense output, and the forces are not evaluated
+// after |tmax|.
+TEST_F(GaussJacksonIntegratorTest, ExactTMax) {
+  parameters_.tmax = 10 * Second;
+  parameters_.tmax_is_exact = true;
+  parameters_.sampling_period = 0;
+  Time last_time;
+  Time last_evaluation;
+  int calls = 0;
+  parameters_.Δt = (1.0 / 30.000001) * Second;
+  integrator_.SolveWithSink(
+      [&last_evaluation](Time const& t,
+                         std::vector<Length> const& q,
+                         not_null<std::vector<Acceleration>*> const result) {
+        last_evaluation = std::max(last_evaluation, t);
+        (*result)[0] = -q[0] / (Second * Second);
+      },
+      parameters_,
+      [&last_time, &calls, this](DoublePrecision<Time> const& t,
+                                 DoublePrecisionVector<Length> const& q,
+                                 DoublePrecisionVector<Speed> const& p) {
+        last_time = t.value;
+        position_error_ =
+            Abs(q.values[0] - 1 * Metre * Cos(t.value * Radian / Second));
+        ++calls;
+      },
+      &workspace_);
+  EXPECT_EQ(1, calls);
+  EXPECT_EQ(parameters_.tmax, last_time);
+  EXPECT_THAT(last_evaluation, Lt(parameters_.tmax));
+  EXPECT_THAT(position_error_, Lt(1E-13 * Metre));
+}
+
+// An integration too short for the startup is made by the startup integrator.
+TEST_F(GaussJacksonIntegratorTest, ShortIntegration) {
+  parameters_.tmax = 0.75 * Second;
+  Integrate(0.1 * Second);
+  // 7 steps of the startup integrator.
+  EXPECT_EQ(7 * 6, evaluations_);
+  EXPECT_THAT(position_error_, AllOf(Gt(1E-11 * Metre), Lt(1E-8 * Metre)));
+}
+
+}  // namespace integrators
+}  // namespace principia
@@ -0,0 +1,164 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "base/not_null.hpp"
+#include "base/thread_pool.hpp"
+#include "integrators/symplectic_integrator.hpp"
+#include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::base::not_null;
+using principia::base::ThreadPool;
+
+namespace principia {
+namespace integrators {
+
+// The Parareal method of Lions, Maday and Turinici (2001), A "parareal" in time
+// discretization of PDE's, which parallelizes a long integration in time.  The
+// interval of integration is split into slices, and the states Uᵢ at the
+// beginnings of the slices are iterated as
+//   Uᵢ₊₁ ← F(Uᵢ) + G(Uᵢ) - G(Uᵢ)ₚᵣₑᵥᵢₒᵤₛ,
+// where F is the fine propagator, an |SPRKIntegrator| with the steps of the
+// integration, and G is the coarse propagator, a cheap |SPRKIntegrator| with
+// much longer steps.  The fine propagations of all the slices are independent
+// and run concurrently on a |ThreadPool|, while the coarse propagations are
+// serial.  After k iterations the first k slices are exactly those of a serial
+// integration, so that the method never needs more iterations than there are
+// slices; it only pays off if the coarse propagator is good enough for the
+// iterations to converge much sooner.  The momenta must be the velocities.
+template<typename Position, typename Momentum>
+class PararealIntegrator : public SymplecticIntegrator<Position, Momentum> {
+ public:
+  using Coefficients = typename SymplecticIntegrator<Position,
+                                                     Momentum>::Coefficients;
+  using Parameters = typename SymplecticIntegrator<Position,
+                                                   Momentum>::Parameters;
+  using SystemState = typename SymplecticIntegrator<Position,
+                                                    Momentum>::SystemState;
+
+  // The coarse propagator defaults to the leapfrog with steps 16 times longer
+  // than the fine ones, the integration is split into 8 slices, the iterations
+  // continue until the result is that of a serial integration, and the fine
+  // propagations are serial.
+  PararealIntegrator();
+  ~PararealIntegrator() override = default;
+
+  // The |coefficients| of the fine propagator, in the format of
+  // |SPRKIntegrator::Initialize|.
+  void Initialize(Coefficients const& coefficients) override;
+
+  // The |coefficients| of the coarse propagator, whose steps are |step_ratio|
+  // times longer than those of the integration.
+  void InitializeCoarse(Coefficients const& coefficients,
+                        int const step_ratio);
+
+  // The integration is split into |slices| slices made of whole steps, which
+  // must be positive.  The iterations stop when no state at the end of a slice
+  // changed by more than |tolerance| times the largest magnitude of a
+  // coordinate of that state, separately for the positions and the momenta, or
+  // after |max_iterations| iterations.
+  void SetSlicing(int const slices,
+                  double const tolerance,
+                  int const max_iterations);
+
+  // The fine propagations run on |thread_pool| if it is not null, and serially
+  // otherwise.
+  void set_thread_pool(ThreadPool* const thread_pool);
+
+  // The scratch storage used by |SolveWithSink|, see
+  // |SPRKIntegrator::Workspace|.
+  class Workspace {
+   public:
+    Workspace() = default;
+
+    // The number of iterations made by the last call to |SolveWithSink| with
+    // this workspace, 0 if the integration was not sliced.
+    int iterations() const;
+
+   private:
+    struct State {
+      DoublePrecision<Time> time;
+      DoublePrecisionVector<Position> positions;
+      DoublePrecisionVector<Momentum> momenta;
+    };
+
+    // Indexed by slice.  The coarse propagation of the last slice is never
+    // needed.
+    std::vector<State> starts_;
+    std::vector<State> coarse_ends_;
+    std::vector<State> fine_ends_;
+    // The states of the last fine propagation of each slice that are passed
+    // to the sink.
+    std::vector<std::vector<State>> samples_;
+    std::vector<Parameters> fine_parameters_;
+    std::vector<typename SPRKIntegrator<Position, Momentum>::Workspace>
+        fine_workspaces_;
+
+    Parameters coarse_parameters_;
+    State coarse_end_;
+    State corrected_;
+    typename SPRKIntegrator<Position, Momentum>::Workspace coarse_workspace_;
+    std::vector<Position> Δq_;
+    std::vector<Momentum> Δp_;
+
+    int iterations_ = 0;
+
+    friend class PararealIntegrator;
+  };
+
+  // Integrates the system described by |parameters|, and passes each sampled
+  // state to |sink| as the overload of |SPRKIntegrator::SolveWithSink| for a
+  // kinetic energy p²/2 does, once the iterations have stopped.  The steps are
+  // chosen as by that function.  |compute_force| is copied for each
+  // propagation, and the copies of the fine propagations may be called
+  // concurrently, so they must not share mutable state.  If the integration
+  // has fewer than 2 steps per slice, it is entirely made by the fine
+  // propagator.
+  template<typename RightHandSideComputation, typename Sink>
+  void SolveWithSink(RightHandSideComputation compute_force,
+                     Parameters const& parameters,
+                     Sink sink,
+                     not_null<Workspace*> const workspace) const;
+
+ private:
+  using State = typename Workspace::State;
+
+  // Propagates |start| up to |tmax| with |integrator| and steps of length
+  // |Δt|, and sets |*end| to the final state.  If |samples| is not null, the
+  // states that an integration with a nonzero |sampling_period| would pass to
+  // its sink are appended to it, |start| being the state after |first_step|
+  // steps of that integration.
+  template<typename RightHandSideComputation>
+  static void Propagate(
+      SPRKIntegrator<Position, Momentum> const& integrator,
+      RightHandSideComputation const& compute_force,
+      State const& start,
+      Time const& tmax,
+      bool const tmax_is_exact,
+      Time const& Δt,
+      std::int64_t const first_step,
+      int const sampling_period,
+      not_null<Parameters*> const parameters,
+      not_null<typename SPRKIntegrator<Position, Momentum>::Workspace*> const
+          workspace,
+      not_null<State*> const end,
+      std::vector<State>* const samples);
+
+  // Returns true if |state| differs from |previous| by more than |tolerance_|
+  // in the sense of |SetSlicing|.
+  bool HasChanged(State const& state, State const& previous) const;
+
+  SPRKIntegrator<Position, Momentum> fine_integrator_;
+  SPRKIntegrator<Position, Momentum> coarse_integrator_;
+  int coarse_step_ratio_;
+  int slices_;
+  double tolerance_;
+  int max_iterations_;
+  ThreadPool* thread_pool_;  // Not owned.
+};
+
+}  // namespace integrators
+}  // namespace principia
+
+#include "integrators/parareal_integrator_body.hpp"
@@ -0,0 +1,303 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "base/tracer.hpp"
+#include "quantities/quantities.hpp"
+
+// Mixed assemblies are not supported by Unity/Mono.
+#include "glog/logging.h"
+
+using principia::base::ScopedTraceEvent;
+using principia::quantities::Abs;
+
+namespace principia {
+namespace integrators {
+
+template<typename Position, typename Momentum>
+inline int PararealIntegrator<Position, Momentum>::Workspace::
+iterations() const {
+  return iterations_;
+}
+
+template<typename Position, typename Momentum>
+inline PararealIntegrator<Position, Momentum>::PararealIntegrator()
+    : coarse_step_ratio_(16),
+      slices_(8),
+      tolerance_(0),
+      max_iterations_(8),
+      thread_pool_(nullptr) {
+  coarse_integrator_.Initialize(
+      coarse_integrator_.CoefficientsOf(SPRKScheme::kLeapfrog));
+}
+
+template<typename Position, typename Momentum>
+inline void PararealIntegrator<Position, Momentum>::Initialize(
+    Coefficients const& coefficients) {
+  fine_integrator_.Initialize(coefficients);
+}
+
+template<typename Position, typename Momentum>
+inline void PararealIntegrator<Position, Momentum>::InitializeCoarse(
+    Coefficients const& coefficients,
+    int const step_ratio) {
+  CHECK_LT(0, step_ratio);
+  coarse_integrator_.Initialize(coefficients);
+  coarse_step_ratio_ = step_ratio;
+}
+
+template<typename Position, typename Momentum>
+inline void PararealIntegrator<Position, Momentum>::SetSlicing(
+    int const slices,
+    double const tolerance,
+    int const max_iterations) {
+  CHECK_LT(0, slices);
+  CHECK_LE(0, tolerance);
+  CHECK_LT(0, max_iterations);
+  slices_ = slices;
+  tolerance_ = tolerance;
+  max_iterations_ = max_iterations;
+}
+
+template<typename Position, typename Momentum>
+inline void PararealIntegrator<Position, Momentum>::set_thread_pool(
+    ThreadPool* const thread_pool) {
+  thread_pool_ = thread_pool;
+}
+
+template<typename Position, typename Momentum>
+template<typename RightHandSideComputation, typename Sink>
+void PararealIntegrator<Position, Momentum>::SolveWithSink(
+    RightHandSideComputation compute_force,
+    Parameters const& parameters,
+    Sink sink,
+    not_null<Workspace*> const workspace) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  int const slices = slices_;
+  workspace->fine_workspaces_.resize(slices);
+  workspace->iterations_ = 0;
+
+  // The number of whole steps of the integration.
+  Time const& h = parameters.Δt;
+  double const steps =
+      std::floor((parameters.tmax - parameters.initial.time.value) / h);
+  if (steps < 2 * slices) {
+    fine_integrator_.SolveWithSink(compute_force,
+                                   parameters,
+                                   sink,
+                                   &workspace->fine_workspaces_[0]);
+    return;
+  }
+  std::int64_t const steps_per_slice =
+      static_cast<std::int64_t>(steps) / slices;
+  int const sampling_period = parameters.sampling_period;
+
+  std::vector<State>& starts = workspace->starts_;
+  std::vector<State>& coarse_ends = workspace->coarse_ends_;
+  std::vector<State>& fine_ends = workspace->fine_ends_;
+  std::vector<std::vector<State>>& samples = workspace->samples_;
+  starts.resize(slices);
+  coarse_ends.resize(slices);
+  fine_ends.resize(slices);
+  samples.resize(slices);
+  workspace->fine_parameters_.resize(slices);
+
+  // The slices begin on the grid of the serial integration, and their times
+  // are accumulated as it does.
+  DoublePrecision<Time> t = parameters.initial.time;
+  for (int i = 0; i < slices; ++i) {
+    starts[i].time = t;
+    for (std::int64_t j = 0; j < steps_per_slice; ++j) {
+      t.Increment(h);
+    }
+  }
+  starts[0].positions.Assign(parameters.initial.positions);
+  starts[0].momenta.Assign(parameters.initial.momenta);
+
+  // The initial guess is the coarse propagation of the entire integration.
+  Time const coarse_Δt = coarse_step_ratio_ * h;
+  for (int i = 0; i < slices - 1; ++i) {
+    Propagate(coarse_integrator_,
+              compute_force,
+              starts[i],
+              starts[i + 1].time.value,
+              true,  // tmax_is_exact
+              coarse_Δt,
+              0,  // first_step
+              0,  // sampling_period
+              &workspace->coarse_parameters_,
+              &workspace->coarse_workspace_,
+              &coarse_ends[i],
+              nullptr);  // samples
+    starts[i + 1].positions = coarse_ends[i].positions;
+    starts[i + 1].momenta = coarse_ends[i].momenta;
+  }
+
+  // The slices before |first| have been propagated from the states of the
+  // serial integration, and need not be propagated again.
+  int first = 0;
+  bool changed = true;
+  while (changed && first < slices &&
+         workspace->iterations_ < max_iterations_) {
+    ++workspace->iterations_;
+    auto const fine_propagation =
+        [this, &compute_force, &parameters, workspace, slices,
+         steps_per_slice, sampling_period, first](int const j) {
+      int const i = first + j;
+      bool const last = i == slices - 1;
+      Propagate(fine_integrator_,
+                compute_force,
+                workspace->starts_[i],
+                last ? parameters.tmax : workspace->starts_[i + 1].time.value,
+                last ? parameters.tmax_is_exact : true,
+                parameters.Δt,
+                i * steps_per_slice,  // first_step
+                sampling_period,
+                &workspace->fine_parameters_[i],
+                &workspace->fine_workspaces_[i],
+                &workspace->fine_ends_[i],
+                sampling_period == 0 ? nullptr : &workspace->samples_[i]);
+    };
+    if (thread_pool_ == nullptr) {
+      for (int j = 0; j < slices - first; ++j) {
+        fine_propagation(j);
+      }
+    } else {
+      thread_pool_->ParallelFor(slices - first, fine_propagation);
+    }
+
+    // The serial correction of the starts of the slices that follow |first|.
+    // The start of |first| was not changed by the last correction, so its
+    // coarse propagation need not be redone.
+    changed = false;
+    State& corrected = workspace->corrected_;
+    for (int i = first; i < slices - 1; ++i) {
+      corrected.positions = fine_ends[i].positions;
+      corrected.momenta = fine_ends[i].momenta;
+      if (i > first) {
+        State& coarse_end = workspace->coarse_end_;
+        Propagate(coarse_integrator_,
+                  compute_force,
+                  starts[i],
+                  starts[i + 1].time.value,
+                  true,  // tmax_is_exact
+                  coarse_Δt,
+                  0,  // first_step
+                  0,  // sampling_period
+                  &workspace->coarse_parameters_,
+                  &workspace->coarse_workspace_,
+                  &coarse_end,
+                  nullptr);  // samples
+        std::vector<Position>& Δq = workspace->Δq_;
+        std::vector<Momentum>& Δp = workspace->Δp_;
+        int const dimension = corrected.positions.values.size();
+        Δq.resize(dimension);
+        Δp.resize(dimension);
+        for (int k = 0; k < dimension; ++k) {
+          Δq[k] = (coarse_end.positions.values[k] -
+                   coarse_ends[i].positions.values[k]) +
+                  (coarse_end.positions.errors[k] -
+                   coarse_ends[i].positions.errors[k]);
+          Δp[k] = (coarse_end.momenta.values[k] -
+                   coarse_ends[i].momenta.values[k]) +
+                  (coarse_end.momenta.errors[k] -
+                   coarse_ends[i].momenta.errors[k]);
+        }
+        corrected.positions.Increment(Δq);
+        corrected.momenta.Increment(Δp);
+        std::swap(coarse_end, coarse_ends[i]);
+      }
+      changed |= HasChanged(corrected, starts[i + 1]);
+      starts[i + 1].positions.values.swap(corrected.positions.values);
+      starts[i + 1].positions.errors.swap(corrected.positions.errors);
+      starts[i + 1].momenta.values.swap(corrected.momenta.values);
+      starts[i + 1].momenta.errors.swap(corrected.momenta.errors);
+    }
+    ++first;
+  }
+
+  for (int i = 0; i < slices; ++i) {
+    for (State const& sample : samples[i]) {
+      sink(sample.time, sample.positions, sample.momenta);
+    }
+  }
+  if (sampling_period == 0) {
+    State const& end = fine_ends.back();
+    sink(end.time, end.positions, end.momenta);
+  }
+}
+
+template<typename Position, typename Momentum>
+template<typename RightHandSideComputation>
+void PararealIntegrator<Position, Momentum>::Propagate(
+    SPRKIntegrator<Position, Momentum> const& integrator,
+    RightHandSideComputation const& compute_force,
+    State const& start,
+    Time const& tmax,
+    bool const tmax_is_exact,
+    Time const& Δt,
+    std::int64_t const first_step,
+    int const sampling_period,
+    not_null<Parameters*> const parameters,
+    not_null<typename SPRKIntegrator<Position, Momentum>::Workspace*> const
+        workspace,
+    not_null<State*> const end,
+    std::vector<State>* const samples) {
+  parameters->initial.time = start.time;
+  start.positions.Extract(&parameters->initial.positions);
+  start.momenta.Extract(&parameters->initial.momenta);
+  parameters->tmax = tmax;
+  parameters->Δt = Δt;
+  parameters->tmax_is_exact = tmax_is_exact;
+  // Without samples only the final state is needed.
+  parameters->sampling_period = samples == nullptr ? 0 : 1;
+  if (samples != nullptr) {
+    samples->clear();
+  }
+  std::int64_t step = first_step;
+  integrator.SolveWithSink(
+      compute_force,
+      *parameters,
+      [end, samples, sampling_period, &step](
+          DoublePrecision<Time> const& time,
+          DoublePrecisionVector<Position> const& positions,
+          DoublePrecisionVector<Momentum> const& momenta) {
+        end->time = time;
+        end->positions = positions;
+        end->momenta = momenta;
+        if (samples != nullptr && step % sampling_period == 0) {
+          samples->push_back(*end);
+        }
+        ++step;
+      },
+      workspace);
+}
+
+template<typename Position, typename Momentum>
+bool PararealIntegrator<Position, Momentum>::HasChanged(
+    State const& state,
+    State const& previous) const {
+  Position q_magnitude = Position();
+  Position q_change = Position();
+  Momentum p_magnitude = Momentum();
+  Momentum p_change = Momentum();
+  int const dimension = state.positions.values.size();
+  for (int k = 0; k < dimension; ++k) {
+    q_magnitude = std::max(q_magnitude, Abs(state.positions.values[k]));
+    q_change = std::max(q_change,
+                        Abs(state.positions.values[k] -
+                            previous.positions.values[k]));
+    p_magnitude = std::max(p_magnitude, Abs(state.momenta.values[k]));
+    p_change = std::max(p_change,
+                        Abs(state.momenta.values[k] -
+                            previous.momenta.values[k]));
+  }
+  return q_change > tolerance_ * q_magnitude ||
+         p_change > tolerance_ * p_magnitude;
+}
+
+}  // namespace integrators
+}  // namespace principia
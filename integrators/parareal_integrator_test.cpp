@@ -0,0 +1,157 @@
+﻿#include "integrators/parareal_integrator.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "base/thread_pool.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+
+using principia::base::ThreadPool;
+using principia::quantities::Abs;
+using principia::quantities::Acceleration;
+using principia::quantities::Length;
+using principia::quantities::Speed;
+using principia::quantities::Time;
+using principia::si::Metre;
+using principia::si::Second;
+using testing::Lt;
+
+namespace principia {
+namespace integrators {
+
+// The harmonic oscillator q″ = -q, integrated over about 160 periods.
+class PararealIntegratorTest : public testing::Test {
+ protected:
+  struct Sample {
+    Time time;
+    Length position;
+    Speed velocity;
+  };
+
+  PararealIntegratorTest() {
+    sprk_.Initialize(sprk_.Order5Optimal());
+    integrator_.Initialize(sprk_.Order5Optimal());
+    parameters_.initial.positions.emplace_back(1 * Metre);
+    parameters_.initial.momenta.emplace_back(0 * Metre / Second);
+    parameters_.initial.time = Time();
+    parameters_.tmax = 1000 * Second;
+    parameters_.Δt = 0.1 * Second;
+    parameters_.sampling_period = 1;
+  }
+
+  template<typename Integrator>
+  std::vector<Sample> Solve(
+      Integrator const& integrator,
+      not_null<typename Integrator::Workspace*> const workspace) {
+    std::vector<Sample> samples;
+    integrator.SolveWithSink(
+        [](Time const& t,
+           std::vector<Length> const& q,
+           not_null<std::vector<Acceleration>*> const result) {
+          (*result)[0] = -q[0] / (Second * Second);
+        },
+        parameters_,
+        [&samples](DoublePrecision<Time> const& t,
+                   DoublePrecisionVector<Length> const& q,
+                   DoublePrecisionVector<Speed> const& p) {
+          samples.push_back({t.value, q.values[0], p.values[0]});
+        },
+        workspace);
+    return samples;
+  }
+
+  // Returns the largest difference between the positions of |samples1| and
+  // |samples2|, which must be at the same times.
+  Length MaxDifference(std::vector<Sample> const& samples1,
+                       std::vector<Sample> const& samples2) {
+    EXPECT_EQ(samples1.size(), samples2.size());
+    Length difference;
+    for (std::size_t i = 0; i < std::min(samples1.size(), samples2.size());
+         ++i) {
+      EXPECT_THAT(Abs(samples1[i].time - samples2[i].time),
+                  Lt(1E-12 * Second));
+      difference = std::max(
+          difference, Abs(samples1[i].position - samples2[i].position));
+    }
+    return difference;
+  }
+
+  SPRKIntegrator<Length, Speed> sprk_;
+  SPRKIntegrator<Length, Speed>::Workspace sprk_workspace_;
+  PararealIntegrator<Length, Speed> integrator_;
+  PararealIntegrator<Length, Speed>::Workspace workspace_;
+  PararealIntegrator<Length, Speed>::Parameters parameters_;
+};
+
+// With a zero tolerance, the iterations continue until all the slices have
+// been propagated from the states of the serial integration.
+TEST_F(PararealIntegratorTest, Exact) {
+  std::vector<Sample> const serial = Solve(sprk_, &sprk_workspace_);
+  std::vector<Sample> const parareal = Solve(integrator_, &workspace_);
+  EXPECT_EQ(8, workspace_.iterations());
+  EXPECT_THAT(MaxDifference(serial, parareal), Lt(1E-12 * Metre));
+}
+
+// With a coarse propagator of order 4 and steps 5 times longer than the fine
+// ones, the iterations converge long before the last slice.
+TEST_F(PararealIntegratorTest, Convergence) {
+  std::vector<Sample> const serial = Solve(sprk_, &sprk_workspace_);
+  integrator_.InitializeCoarse(
+      sprk_.CoefficientsOf(SPRKScheme::kMcLachlanAtela1992Order4Optimal),
+      5);
+  integrator_.SetSlicing(16, 1E-10, 16);
+  std::vector<Sample> const parareal = Solve(integrator_, &workspace_);
+  EXPECT_THAT(workspace_.iterations(), Lt(6));
+  EXPECT_THAT(MaxDifference(serial, parareal), Lt(1E-9 * Metre));
+}
+
+// The fine propagations on a thread pool give the same results as serial
+// ones.
+TEST_F(PararealIntegratorTest, ThreadPool) {
+  integrator_.SetSlicing(16, 1E-10, 16);
+  std::vector<Sample> const serial = Solve(integrator_, &workspace_);
+  int const serial_iterations = workspace_.iterations();
+  ThreadPool thread_pool(4);
+  integrator_.set_thread_pool(&thread_pool);
+  std::vector<Sample> const parallel = Solve(integrator_, &workspace_);
+  EXPECT_EQ(serial_iterations, workspace_.iterations());
+  ASSERT_EQ(serial.size(), parallel.size());
+  for (std::size_t i = 0; i < serial.size(); ++i) {
+    EXPECT_EQ(serial[i].time, parallel[i].time);
+    EXPECT_EQ(serial[i].position, parallel[i].position);
+    EXPECT_EQ(serial[i].velocity, parallel[i].velocity);
+  }
+}
+
+// The samples are those of the serial integration for any sampling period,
+// and for an exact |tmax|.
+TEST_F(PararealIntegratorTest, Sampling) {
+  for (int const sampling_period : {0, 7}) {
+    for (bool const tmax_is_exact : {false, true}) {
+      parameters_.sampling_period = sampling_period;
+      parameters_.tmax = 1000.05 * Second;
+      parameters_.tmax_is_exact = tmax_is_exact;
+      std::vector<Sample> const serial = Solve(sprk_, &sprk_workspace_);
+      std::vector<Sample> const parareal = Solve(integrator_, &workspace_);
+      EXPECT_THAT(MaxDifference(serial, parareal), Lt(1E-12 * Metre));
+    }
+  }
+}
+
+// An integration with fewer than 2 steps per slice is made by the fine
+// propagator.
+TEST_F(PararealIntegratorTest, ShortIntegration) {
+  parameters_.tmax = 1.5 * Second;
+  std::vector<Sample> const serial = Solve(sprk_, &sprk_workspace_);
+  std::vector<Sample> const parareal = Solve(integrator_, &workspace_);
+  EXPECT_EQ(0, workspace_.iterations());
+  EXPECT_EQ(0 * Metre, MaxDifference(serial, parareal));
+}
+
+}  // namespace integrators
+}  // namespace principia
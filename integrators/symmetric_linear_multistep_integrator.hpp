@@ -0,0 +1,116 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "base/not_null.hpp"
+#include "integrators/symplectic_integrator.hpp"
+#include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::base::not_null;
+using principia::quantities::Quotient;
+
+namespace principia {
+namespace integrators {
+
+// A symmetric linear multistep integrator for q″ = f(t, q), after Quinlan and
+// Tremaine (1990).  A k-step method computes the positions on a uniform grid
+// from
+//   Σ αⱼ qₙ₊ⱼ = Δt² Σ βⱼ fₙ₊ⱼ,  0 ≤ j ≤ k,
+// where the α and the β are symmetric and β₀ = βₖ = 0, so that each step makes
+// exactly one evaluation of the forces.  Like the symplectic integrators, these
+// methods have no secular drift of the energy for a conservative system, but
+// they are only stable if |Δt| is small compared to the time scales of the
+// motion.  The first k - 1 steps, as well as the last step if it is shorter
+// than |Δt|, are made by an |SPRKIntegrator|.  The momenta must be the
+// velocities; they are computed from the positions and the forces and do not
+// affect the positions.
+template<typename Position, typename Momentum>
+class SymmetricLinearMultistepIntegrator
+    : public SymplecticIntegrator<Position, Momentum> {
+ public:
+  using Coefficients = typename SymplecticIntegrator<Position,
+                                                     Momentum>::Coefficients;
+  using Parameters = typename SymplecticIntegrator<Position,
+                                                   Momentum>::Parameters;
+  using SystemState = typename SymplecticIntegrator<Position,
+                                                    Momentum>::SystemState;
+
+  SymmetricLinearMultistepIntegrator();
+  ~SymmetricLinearMultistepIntegrator() override = default;
+
+  // The 8-step method of order 8 of Quinlan and Tremaine (1990).
+  Coefficients const& QuinlanTremaine1990Order8() const;
+
+  // The |coefficients| are the α first and the β second, each of size k + 1.
+  // The steps of the startup are made with the order 5 optimal method of
+  // McLachlan and Atela.
+  void Initialize(Coefficients const& coefficients) override;
+
+  // The scratch storage used by |SolveWithSink|, see
+  // |SPRKIntegrator::Workspace|.
+  class Workspace {
+   public:
+    Workspace() = default;
+
+   private:
+    DoublePrecisionVector<Position> q_last_;
+    DoublePrecisionVector<Momentum> p_last_;
+    DoublePrecisionVector<Position> q_start_;  // Used by |StartupStep|.
+    // The differences between successive positions and the forces at the last
+    // k - 1 points of the grid, oldest first.
+    std::vector<std::vector<Position>> differences_;
+    std::vector<std::vector<Quotient<Momentum, Time>>> forces_;
+    std::vector<Position> Δq_;
+    std::vector<Quotient<Momentum, Time>> f_;
+    Parameters startup_parameters_;
+    typename SPRKIntegrator<Position, Momentum>::Workspace startup_workspace_;
+
+    friend class SymmetricLinearMultistepIntegrator;
+  };
+
+  // Integrates the system described by |parameters|, and passes each sampled
+  // state to |sink| as the overload of |SPRKIntegrator::SolveWithSink| for a
+  // kinetic energy p²/2 does.  The steps are chosen as by that function.
+  template<typename RightHandSideComputation, typename Sink>
+  void SolveWithSink(RightHandSideComputation compute_force,
+                     Parameters const& parameters,
+                     Sink sink,
+                     not_null<Workspace*> const workspace) const;
+
+ private:
+  // Advances |workspace->q_last_| and |workspace->p_last_| by a step of length
+  // |h| starting at |tn| with |startup_integrator_|, and leaves the increment
+  // of the positions in |workspace->Δq_|.
+  template<typename RightHandSideComputation>
+  void StartupStep(RightHandSideComputation& compute_force,
+                   DoublePrecision<Time> const& tn,
+                   Time const& h,
+                   not_null<Workspace*> const workspace) const;
+
+  // Advances |workspace->q_last_| by a step of length |h| of the multistep
+  // method, using the last k - 1 differences and forces, and leaves the
+  // increment of the positions in |workspace->Δq_|.
+  void MultistepStep(Time const& h, not_null<Workspace*> const workspace) const;
+
+  // Sets |workspace->p_last_| to the velocities at the last point of the grid,
+  // computed from the last 4 differences and forces with an error O(h⁸).
+  void ComputeVelocities(Time const& h,
+                         not_null<Workspace*> const workspace) const;
+
+  // The number of steps k.
+  int steps_;
+
+  // The β, and the sums γᵢ = -Σ αⱼ, 0 ≤ j ≤ i, with which the relation between
+  // the positions is written on their differences:
+  //   Σ γᵢ (qₙ₊ᵢ₊₁ - qₙ₊ᵢ) = Δt² Σ βⱼ fₙ₊ⱼ,  0 ≤ i < k.
+  std::vector<double> β_;
+  std::vector<double> γ_;
+
+  SPRKIntegrator<Position, Momentum> startup_integrator_;
+};
+
+}  // namespace integrators
+}  // namespace principia
+
+#include "integrators/symmetric_linear_multistep_integrator_body.hpp"
@@ -0,0 +1,257 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "base/tracer.hpp"
+#include "quantities/quantities.hpp"
+
+// Mixed assemblies are not supported by Unity/Mono.
+#include "glog/logging.h"
+
+using principia::base::ScopedTraceEvent;
+
+namespace principia {
+namespace integrators {
+
+template<typename Position, typename Momentum>
+inline SymmetricLinearMultistepIntegrator<Position, Momentum>::
+SymmetricLinearMultistepIntegrator()
+    : steps_(0) {
+  startup_integrator_.Initialize(startup_integrator_.Order5Optimal());
+}
+
+template<typename Position, typename Momentum>
+inline typename SymmetricLinearMultistepIntegrator<
+    Position, Momentum>::Coefficients const&
+SymmetricLinearMultistepIntegrator<Position, Momentum>::
+QuinlanTremaine1990Order8() const {
+  static Coefficients const quinlan_tremaine_1990_order_8 = {
+      {1.0, -2.0, 2.0, -1.0, 0.0, -1.0, 2.0, -2.0, 1.0},
+      {0.0,
+       17671.0 / 12096.0,
+       -23622.0 / 12096.0,
+       61449.0 / 12096.0,
+       -50516.0 / 12096.0,
+       61449.0 / 12096.0,
+       -23622.0 / 12096.0,
+       17671.0 / 12096.0,
+       0.0}};
+  return quinlan_tremaine_1990_order_8;
+}
+
+template<typename Position, typename Momentum>
+inline void SymmetricLinearMultistepIntegrator<Position, Momentum>::Initialize(
+    Coefficients const& coefficients) {
+  CHECK_EQ(2, coefficients.size());
+  std::vector<double> const& α = coefficients[0];
+  β_ = coefficients[1];
+  steps_ = static_cast<int>(α.size()) - 1;
+  CHECK_EQ(steps_ + 1, β_.size());
+  // The velocities are computed from the last 4 points of the grid.
+  CHECK_LE(5, steps_);
+  CHECK_EQ(1.0, α.back());
+  CHECK_EQ(0.0, β_.front());
+  CHECK_EQ(0.0, β_.back());
+  for (int j = 0; j <= steps_; ++j) {
+    CHECK_EQ(α[j], α[steps_ - j]);
+    CHECK_EQ(β_[j], β_[steps_ - j]);
+  }
+  γ_.resize(steps_);
+  double sum = 0.0;
+  for (int i = 0; i < steps_; ++i) {
+    sum += α[i];
+    γ_[i] = -sum;
+  }
+  CHECK_EQ(1.0, γ_.back());
+}
+
+template<typename Position, typename Momentum>
+template<typename RightHandSideComputation, typename Sink>
+void SymmetricLinearMultistepIntegrator<Position, Momentum>::SolveWithSink(
+    RightHandSideComputation compute_force,
+    Parameters const& parameters,
+    Sink sink,
+    not_null<Workspace*> const workspace) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK_LT(0, steps_) << "Not initialized";
+  int const dimension = parameters.initial.positions.size();
+
+  DoublePrecisionVector<Position>& q_last = workspace->q_last_;
+  DoublePrecisionVector<Momentum>& p_last = workspace->p_last_;
+  q_last.Assign(parameters.initial.positions);
+  p_last.Assign(parameters.initial.momenta);
+  int sampling_phase = 0;
+
+  std::vector<std::vector<Position>>& differences = workspace->differences_;
+  std::vector<std::vector<Quotient<Momentum, Time>>>& forces =
+      workspace->forces_;
+  differences.resize(steps_ - 1);
+  forces.resize(steps_ - 1);
+  for (int i = 0; i < steps_ - 1; ++i) {
+    differences[i].resize(dimension);
+    forces[i].resize(dimension);
+  }
+  workspace->Δq_.resize(dimension);
+  workspace->f_.resize(dimension);
+
+  // The steps are chosen as in |SPRKIntegrator::SolveWithSink|.
+  Time h = parameters.Δt;
+  DoublePrecision<Time> tn = parameters.initial.time;
+  bool at_end = !parameters.tmax_is_exact && parameters.tmax < tn.value + h;
+  // The number of points of the grid before the current one, i.e., of
+  // consecutive steps of length |parameters.Δt| that ended at the current
+  // state.  The newest element of |forces| is at the current state.
+  int grid_steps = 0;
+  if (!at_end) {
+    compute_force(tn.value, q_last.values, &workspace->f_);
+    std::rotate(forces.begin(), forces.begin() + 1, forces.end());
+    forces.back().swap(workspace->f_);
+  }
+  while (!at_end) {
+    if (parameters.tmax_is_exact) {
+      if (parameters.tmax <= tn.value + 3 * h / 2) {
+        at_end = true;
+        h = (parameters.tmax - tn.value) - tn.error;
+      }
+    } else if (parameters.tmax < tn.value + 2 * h) {
+      at_end = true;
+    }
+
+    bool const on_grid = h == parameters.Δt;
+    bool const multistep = on_grid && grid_steps >= steps_ - 1;
+    if (multistep) {
+      MultistepStep(h, workspace);
+    } else {
+      StartupStep(compute_force, tn, h, workspace);
+    }
+    tn.Increment(h);
+
+    if (on_grid) {
+      ++grid_steps;
+      std::rotate(differences.begin(),
+                  differences.begin() + 1,
+                  differences.end());
+      differences.back().swap(workspace->Δq_);
+      // The forces at the end of the last step are only needed for the
+      // velocities of the multistep method.
+      if (multistep || !at_end) {
+        compute_force(tn.value, q_last.values, &workspace->f_);
+        std::rotate(forces.begin(), forces.begin() + 1, forces.end());
+        forces.back().swap(workspace->f_);
+      }
+      if (multistep) {
+        ComputeVelocities(h, workspace);
+      }
+    }
+
+    if (parameters.sampling_period != 0) {
+      if (sampling_phase % parameters.sampling_period == 0) {
+        sink(tn, q_last, p_last);
+      }
+      ++sampling_phase;
+    }
+  }
+  if (parameters.sampling_period == 0) {
+    sink(tn, q_last, p_last);
+  }
+}
+
+template<typename Position, typename Momentum>
+template<typename RightHandSideComputation>
+void SymmetricLinearMultistepIntegrator<Position, Momentum>::StartupStep(
+    RightHandSideComputation& compute_force,
+    DoublePrecision<Time> const& tn,
+    Time const& h,
+    not_null<Workspace*> const workspace) const {
+  Parameters& parameters = workspace->startup_parameters_;
+  workspace->q_last_.Extract(&parameters.initial.positions);
+  workspace->p_last_.Extract(&parameters.initial.momenta);
+  parameters.initial.time = tn;
+  // A single step of length |h|: with an inexact |tmax| the integration ends
+  // when the next step would go past |tmax|.
+  parameters.tmax = tn.value + h;
+  parameters.Δt = h;
+  parameters.sampling_period = 0;
+  parameters.tmax_is_exact = false;
+  DoublePrecisionVector<Position>& q_start = workspace->q_start_;
+  q_start = workspace->q_last_;
+  startup_integrator_.SolveWithSink(
+      compute_force,
+      parameters,
+      [workspace](DoublePrecision<Time> const& time,
+                  DoublePrecisionVector<Position> const& positions,
+                  DoublePrecisionVector<Momentum> const& momenta) {
+        workspace->q_last_ = positions;
+        workspace->p_last_ = momenta;
+      },
+      &workspace->startup_workspace_);
+  int const dimension = workspace->Δq_.size();
+  for (int k = 0; k < dimension; ++k) {
+    workspace->Δq_[k] =
+        (workspace->q_last_.values[k] - q_start.values[k]) +
+        (workspace->q_last_.errors[k] - q_start.errors[k]);
+  }
+}
+
+template<typename Position, typename Momentum>
+void SymmetricLinearMultistepIntegrator<Position, Momentum>::MultistepStep(
+    Time const& h,
+    not_null<Workspace*> const workspace) const {
+  std::vector<std::vector<Position>> const& d = workspace->differences_;
+  std::vector<std::vector<Quotient<Momentum, Time>>> const& f =
+      workspace->forces_;
+  std::vector<Position>& Δq = workspace->Δq_;
+  int const dimension = Δq.size();
+  // |d[i]| is the difference dₙ₊ᵢ = qₙ₊ᵢ₊₁ - qₙ₊ᵢ and |f[j - 1]| is fₙ₊ⱼ.
+  for (int k = 0; k < dimension; ++k) {
+    Quotient<Momentum, Time> βf = β_[1] * f[0][k];
+    for (int j = 2; j < steps_; ++j) {
+      βf += β_[j] * f[j - 1][k];
+    }
+    Position γd = γ_[0] * d[0][k];
+    for (int i = 1; i < steps_ - 1; ++i) {
+      γd += γ_[i] * d[i][k];
+    }
+    Δq[k] = h * (h * βf) - γd;
+  }
+  // The increments are accumulated with compensated summation, as in
+  // |SPRKIntegrator|.
+  workspace->q_last_.Increment(Δq);
+}
+
+template<typename Position, typename Momentum>
+void SymmetricLinearMultistepIntegrator<Position, Momentum>::ComputeVelocities(
+    Time const& h,
+    not_null<Workspace*> const workspace) const {
+  // The weights of the differences qₙ₋ᵢ - qₙ₋ᵢ₋₁ and of the forces fₙ₋ᵢ in
+  // the velocity at tₙ, for i = 0, 1, 2, 3.  The formula is exact for the
+  // polynomials of degree at most 8.
+  static double const η[] = {7043.0 / 1932.0,
+                             131.0 / 1932.0,
+                             -5053.0 / 1932.0,
+                             -9.0 / 92.0};
+  static double const ε[] = {2.0 / 35.0,
+                             -1728.0 / 805.0,
+                             -2052.0 / 805.0,
+                             -256.0 / 805.0};
+  std::vector<std::vector<Position>> const& d = workspace->differences_;
+  std::vector<std::vector<Quotient<Momentum, Time>>> const& f =
+      workspace->forces_;
+  DoublePrecisionVector<Momentum>& p = workspace->p_last_;
+  int const newest = steps_ - 2;
+  int const dimension = p.values.size();
+  for (int k = 0; k < dimension; ++k) {
+    Position ηd = η[0] * d[newest][k];
+    Quotient<Momentum, Time> εf = ε[0] * f[newest][k];
+    for (int i = 1; i < 4; ++i) {
+      ηd += η[i] * d[newest - i][k];
+      εf += ε[i] * f[newest - i][k];
+    }
+    p.values[k] = ηd / h + h * εf;
+    p.errors[k] = Momentum();
+  }
+}
+
+}  // namespace integrators
+}  // namespace principia
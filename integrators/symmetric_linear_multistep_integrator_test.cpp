@@ -0,0 +1,159 @@
+﻿#include "integrators/symmetric_linear_multistep_integrator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+
+using principia::quantities::Abs;
+using principia::quantities::Acceleration;
+using principia::quantities::AngularFrequency;
+using principia::quantities::Cos;
+using principia::quantities::Length;
+using principia::quantities::Sin;
+using principia::quantities::Speed;
+using principia::quantities::Time;
+using principia::si::Metre;
+using principia::si::Radian;
+using principia::si::Second;
+using testing::AllOf;
+using testing::Gt;
+using testing::Lt;
+
+namespace principia {
+namespace integrators {
+
+// The harmonic oscillator q″ = -ω² q.
+class SymmetricLinearMultistepIntegratorTest : public testing::Test {
+ protected:
+  SymmetricLinearMultistepIntegratorTest()
+      : ω_(1 * Radian / Second),
+        evaluations_(0) {
+    integrator_.Initialize(integrator_.QuinlanTremaine1990Order8());
+    parameters_.initial.positions.emplace_back(1 * Metre);
+    parameters_.initial.momenta.emplace_back(0 * Metre / Second);
+    parameters_.initial.time = Time();
+    parameters_.tmax = 1000 * Second;
+    parameters_.sampling_period = 1;
+  }
+
+  // Integrates with the step |Δt| and sets |position_error_| and
+  // |velocity_error_| to the largest errors over the integration.
+  void Integrate(Time const& Δt) {
+    parameters_.Δt = Δt;
+    AngularFrequency const ω = ω_;
+    position_error_ = Length();
+    velocity_error_ = Speed();
+    integrator_.SolveWithSink(
+        [this, ω](Time const& t,
+                  std::vector<Length> const& q,
+                  not_null<std::vector<Acceleration>*> const result) {
+          ++evaluations_;
+          (*result)[0] = -ω * ω * q[0] / (Radian * Radian);
+        },
+        parameters_,
+        [this, ω](DoublePrecision<Time> const& t,
+                  DoublePrecisionVector<Length> const& q,
+                  DoublePrecisionVector<Speed> const& p) {
+          position_error_ = std::max(
+              position_error_, Abs(q.values[0] - 1 * Metre * Cos(ω * t.value)));
+          velocity_error_ = std::max(
+              velocity_error_,
+              Abs(p.values[0] +
+                  1 * Metre * ω * Sin(ω * t.value) / Radian));
+        },
+        &workspace_);
+  }
+
+  AngularFrequency const ω_;
+  SymmetricLinearMultistepIntegrator<Length, Speed> integrator_;
+  SymmetricLinearMultistepIntegrator<Length, Speed>::Parameters parameters_;
+  SymmetricLinearMultistepIntegrator<Length, Speed>::Workspace workspace_;
+  int evaluations_;
+  Length position_error_;
+  Speed velocity_error_;
+};
+
+// The errors on the positions and velocities are proportional to Δt⁸, and
+// much smaller than those of the SPRK used for the startup with the same
+// number of evaluations of the forces.
+TEST_F(SymmetricLinearMultistepIntegratorTest, Convergence) {
+  Integrate(0.1 * Second);
+  Length const position_error = position_error_;
+  Speed const velocity_error = velocity_error_;
+  EXPECT_THAT(position_error, AllOf(Gt(1E-8 * Metre), Lt(1E-7 * Metre)));
+  EXPECT_THAT(velocity_error,
+              AllOf(Gt(1E-8 * Metre / Second), Lt(1E-7 * Metre / Second)));
+  Integrate(0.05 * Second);
+  EXPECT_THAT(position_error / position_error_, AllOf(Gt(250.0), Lt(400.0)));
+  EXPECT_THAT(velocity_error / velocity_error_, AllOf(Gt(250.0), Lt(400.0)));
+
+  // The order 5 optimal SPRK with the same number of evaluations of the
+  // forces.
+  SPRKIntegrator<Length, Speed> sprk;
+  SPRKIntegrator<Length, Speed>::Workspace sprk_workspace;
+  sprk.Initialize(sprk.Order5Optimal());
+  parameters_.Δt = 0.6 * Second;
+  AngularFrequency const ω = ω_;
+  Length sprk_error;
+  sprk.SolveWithSink(
+      [ω](Time const& t,
+          std::vector<Length> const& q,
+          not_null<std::vector<Acceleration>*> const result) {
+        (*result)[0] = -ω * ω * q[0] / (Radian * Radian);
+      },
+      parameters_,
+      [ω, &sprk_error](DoublePrecision<Time> const& t,
+                       DoublePrecisionVector<Length> const& q,
+                       DoublePrecisionVector<Speed> const& p) {
+        sprk_error = std::max(
+            sprk_error, Abs(q.values[0] - 1 * Metre * Cos(ω * t.value)));
+      },
+      &sprk_workspace);
+  EXPECT_THAT(sprk_error, Gt(100 * position_error));
+}
+
+// After the startup, there is one evaluation of the forces per step.
+TEST_F(SymmetricLinearMultistepIntegratorTest, Evaluations) {
+  parameters_.tmax = 100 * Second;
+  Integrate(0.125 * Second);
+  // The initial evaluation, the 7 steps of the startup, which has 6 stages,
+  // each followed by an evaluation at the end of the step, and the 793 steps
+  // of the multistep method.
+  EXPECT_EQ(1 + 7 * (6 + 1) + 793, evaluations_);
+}
+
+TEST_F(SymmetricLinearMultistepIntegratorTest, ExactTMax) {
+  parameters_.tmax = 10 * Second;
+  parameters_.tmax_is_exact = true;
+  parameters_.sampling_period = 0;
+  Time last_time;
+  int calls = 0;
+  parameters_.Δt = (1.0 / 30.000001) * Second;
+  integrator_.SolveWithSink(
+      [](Time const& t,
+         std::vector<Length> const& q,
+         not_null<std::vector<Acceleration>*> const result) {
+        (*result)[0] = -q[0] / (Second * Second);
+      },
+      parameters_,
+      [&last_time, &calls](DoublePrecision<Time> const& t,
+                           DoublePrecisionVector<Length> const& q,
+                           DoublePrecisionVector<Speed> const& p) {
+        last_time = t.value;
+        ++calls;
+      },
+      &workspace_);
+  EXPECT_EQ(1, calls);
+  EXPECT_EQ(parameters_.tmax, last_time);
+}
+
+}  // namespace integrators
+}  // namespace principia
@@ -2,8 +2,10 @@
 
 #include <vector>
 
+#include "base/not_null.hpp"
 #include "quantities/quantities.hpp"
 
+using principia::base::not_null;
 using principia::quantities::Time;
 
 namespace principia {
@@ -23,6 +25,28 @@ struct DoublePrecision {
   Scalar error;
 };
 
+// A vector of |DoublePrecision| stored as two arrays, the values and the
+// errors.  The compensated summation of all the elements is a single loop over
+// contiguous scalars, which the compiler may vectorize, and the values may be
+// read without touching the errors.
+template<typename Scalar>
+struct DoublePrecisionVector {
+  // Sets |*this| to the elements of |elements|.
+  void Assign(std::vector<DoublePrecision<Scalar>> const& elements);
+
+  // Sets |*elements| to the elements of |*this|.
+  void Extract(
+      not_null<std::vector<DoublePrecision<Scalar>>*> const elements) const;
+
+  // Increments each element of |*this| by the corresponding element of
+  // |increments|, which must have the same size.  The result is bitwise
+  // identical to that of |DoublePrecision::Increment| on each element.
+  void Increment(std::vector<Scalar> const& increments);
+
+  std::vector<Scalar> values;
+  std::vector<Scalar> errors;
+};
+
 template<typename Position, typename Momentum>
 class SymplecticIntegrator {
  public:
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <vector>
+
+#include "base/macros.hpp"
+#include "glog/logging.h"
+
 namespace principia {
 namespace integrators {
 
@@ -17,5 +22,43 @@ __forceinline void DoublePrecision<Scalar>::Increment(Scalar const& increment) {
   error = (temp - value) + y;
 }
 
+template<typename Scalar>
+void DoublePrecisionVector<Scalar>::Assign(
+    std::vector<DoublePrecision<Scalar>> const& elements) {
+  values.resize(elements.size());
+  errors.resize(elements.size());
+  for (std::size_t i = 0; i < elements.size(); ++i) {
+    values[i] = elements[i].value;
+    errors[i] = elements[i].error;
+  }
+}
+
+template<typename Scalar>
+void DoublePrecisionVector<Scalar>::Extract(
+    not_null<std::vector<DoublePrecision<Scalar>>*> const elements) const {
+  elements->resize(values.size());
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    (*elements)[i].value = values[i];
+    (*elements)[i].error = errors[i];
+  }
+}
+
+template<typename Scalar>
+__forceinline void DoublePrecisionVector<Scalar>::Increment(
+    std::vector<Scalar> const& increments) {
+  DEBUG_CHECK_EQ(values.size(), increments.size());
+  int const size = static_cast<int>(values.size());
+  Scalar* const value = values.data();
+  Scalar* const error = errors.data();
+  Scalar const* const increment = increments.data();
+  // Same as |DoublePrecision::Increment|, on the contiguous arrays.
+  for (int i = 0; i < size; ++i) {
+    Scalar const temp = value[i];
+    Scalar const y = increment[i] + error[i];
+    value[i] = temp + y;
+    error[i] = (temp - value[i]) + y;
+  }
+}
+
 }  // namespace integrators
 }  // namespace principia
@@ -1,15 +1,72 @@
 ﻿#pragma once
 
+#include <functional>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "base/macros.hpp"
 #include "base/not_null.hpp"
 #include "integrators/symplectic_integrator.hpp"
+#include "quantities/quantities.hpp"
 
 using principia::base::not_null;
+using principia::quantities::Quotient;
 
 namespace principia {
 namespace integrators {
 
+// The coefficient sets known to |SPRKIntegrator|.  The comments give the order
+// of the method and its number of stages.  The methods whose last position
+// weight is 0 are first-same-as-last (FSAL): after the first step, they make
+// one fewer evaluation of the forces per step than they have stages.  The SRKN
+// methods of Blanes and Moan only have their nominal order when the forces
+// don't depend on the momenta, which is always the case here.
+// The processed methods conjugate a kernel by a processor: n steps are
+// χ∘Kⁿ∘χ⁻¹, where K is a step of the kernel and χ the processor.  The kernel
+// is cheap, but its steps have a high effective order once conjugated.  Since
+// the processor is only applied to the initial state and to the states passed
+// to the sink, these methods are advantageous when few states are sampled,
+// e.g., with a |sampling_period| of 0.  The stages of the comments are those
+// of the kernel.
+enum class SPRKScheme {
+  kLeapfrog,                         // Order 2, 2 stages, FSAL.
+  kMcLachlanAtela1992Order2Optimal,  // Order 2, 2 stages.
+  kRuth1983,                         // Order 3, 3 stages.
+  kMcLachlanAtela1992Order3Optimal,  // Order 3, 3 stages.
+  kCandyRozmus1991ForestRuth1990,    // Order 4, 4 stages, FSAL.
+  kMcLachlanAtela1992Order4Optimal,  // Order 4, 4 stages.
+  kBlanesMoan2002SRKN6B,             // Order 4, 7 stages, FSAL.
+  kMcLachlanAtela1992Order5Optimal,  // Order 5, 6 stages.
+  kYoshida1990Order6A,               // Order 6, 8 stages, FSAL.
+  kBlanesMoan2002SRKN11B,            // Order 6, 12 stages, FSAL.
+  kYoshida1990Order8D,               // Order 8, 16 stages, FSAL.
+  kProcessedOrder6,                  // Effective order 6, 5 stages, FSAL,
+                                     // processed.
+};
+
+// The coefficients of some of the |SPRKScheme|s as compile-time functions of
+// the index of the stage, for the unrolled steps of |SPRKIntegrator|.  |a| is
+// the position weight and |b| the momentum weight, as in
+// |SPRKIntegrator::CoefficientsOf|, which is computed from these functions for
+// the schemes that have a tableau.
+template<SPRKScheme scheme>
+struct SPRKTableau;
+
+template<>
+struct SPRKTableau<SPRKScheme::kLeapfrog> {
+  static int const kStages = 2;
+  static CONSTEXPR double a(int const i);
+  static CONSTEXPR double b(int const i);
+};
+
+template<>
+struct SPRKTableau<SPRKScheme::kMcLachlanAtela1992Order5Optimal> {
+  static int const kStages = 6;
+  static CONSTEXPR double a(int const i);
+  static CONSTEXPR double b(int const i);
+};
+
 template<typename Position, typename Momentum>
 class SPRKIntegrator : public SymplecticIntegrator<Position, Momentum> {
  public:
@@ -25,8 +82,109 @@ class SPRKIntegrator : public SymplecticIntegrator<Position, Momentum> {
 
   std::vector<std::vector<double>> const& Order5Optimal() const;
 
+  // Returns the coefficients of |scheme|, suitable for |Initialize|.
+  Coefficients const& CoefficientsOf(SPRKScheme const scheme) const;
+
+  // Returns the order of convergence of |scheme|.  For a processed |scheme|,
+  // this is the effective order.
+  static int OrderOf(SPRKScheme const scheme);
+
+  // True if |scheme| is a processed method, in which case |CoefficientsOf|
+  // returns the coefficients of its kernel.
+  static bool IsProcessed(SPRKScheme const scheme);
+
+  // Returns the coefficients of the processor of |scheme|, which must be
+  // processed, suitable for the second overload of |Initialize|.
+  Coefficients const& ProcessorOf(SPRKScheme const scheme) const;
+
+  // Initializes an unprocessed method.
   void Initialize(Coefficients const& coefficients) override;
 
+  // Initializes a method whose kernel has the given |coefficients|, processed
+  // by a processor whose stages have the form of those of a step, i.e., a
+  // kick followed by a drift, with the position weights first and the
+  // momentum weights second.  The sums of the weights of the |processor| must
+  // be 0.  χ is the sequence of these stages for a step of length |h|, and χ⁻¹
+  // its inverse, which performs them in the reverse order with negated
+  // weights.  The integration applies χ⁻¹ to the initial state, then steps
+  // with the kernel, and applies χ to a copy of the state that it passes to
+  // the sink.  Events are not supported.
+  void Initialize(Coefficients const& coefficients,
+                  Coefficients const& processor);
+
+  // Initializes with the coefficients of |scheme|.  If the |scheme| has an
+  // |SPRKTableau|, the loop over the stages of a step is unrolled at compile
+  // time and the coefficients are constants; the results are bitwise identical
+  // to those obtained with |Initialize(CoefficientsOf(scheme))|.  This helps
+  // the small systems, where the loop and the loads of the coefficients are not
+  // negligible compared to the evaluation of the forces.
+  void Initialize(SPRKScheme const scheme);
+
+  // An event is a zero crossing of a function of the state of the system.
+  // |function| is called as:
+  //   double function(Time const& time,
+  //                   std::vector<Position> const& positions,
+  //                   std::vector<Momentum> const& momenta);
+  // For instance, the periapsides of an orbit are the increasing crossings of
+  // the radial velocity, and a collision is a decreasing crossing of the
+  // distance minus the radius.  If |terminal| is true, the integration stops
+  // at the first occurrence of the event.
+  struct Event {
+    enum class Crossing {
+      kAny,
+      kIncreasing,
+      kDecreasing,
+    };
+
+    std::function<double(Time const& time,
+                         std::vector<Position> const& positions,
+                         std::vector<Momentum> const& momenta)> function;
+    Crossing crossing = Crossing::kAny;
+    bool terminal = false;
+  };
+
+  // The scratch storage used by |Solve|.  Passing the same |Workspace| to
+  // successive calls avoids reallocating the intermediate vectors once they
+  // have reached their steady-state size.  A |Workspace| must not be shared by
+  // concurrent calls to |Solve|.
+  class Workspace {
+   public:
+    Workspace() = default;
+
+   private:
+    std::vector<Position> Δqstage0_;
+    std::vector<Position> Δqstage1_;
+    std::vector<Momentum> Δpstage0_;
+    std::vector<Momentum> Δpstage1_;
+    DoublePrecisionVector<Position> q_last_;
+    DoublePrecisionVector<Momentum> p_last_;
+    std::vector<Position> q_stage_;
+    std::vector<Momentum> p_stage_;
+    std::vector<Quotient<Momentum, Time>> f_;  // Current forces.
+    std::vector<Quotient<Position, Time>> v_;  // Current velocities.
+
+    // Used by |SolveWithEvents| only.
+    DoublePrecisionVector<Position> q_step_start_;
+    DoublePrecisionVector<Momentum> p_step_start_;
+    DoublePrecisionVector<Position> q_step_end_;
+    DoublePrecisionVector<Momentum> p_step_end_;
+    std::vector<double> event_values_;
+    // The crossings of the current step, as offsets from its beginning and
+    // indices in the events.
+    std::vector<std::pair<Time, int>> crossings_;
+
+    // Used by the processed methods only.  The processed state passed to the
+    // sink, and the forces and increments of the stages of the processor.
+    DoublePrecisionVector<Position> q_processed_;
+    DoublePrecisionVector<Momentum> p_processed_;
+    std::vector<Quotient<Momentum, Time>> f_processor_;
+    std::vector<Position> Δq_processor_;
+    std::vector<Momentum> Δp_processor_;
+
+    friend class SPRKIntegrator;
+  };
+
+  // Same as the overload below, with a fresh |Workspace|.
   template<typename AutonomousRightHandSideComputation,
            typename RightHandSideComputation>
   void Solve(RightHandSideComputation compute_force,
@@ -34,15 +192,267 @@ class SPRKIntegrator : public SymplecticIntegrator<Position, Momentum> {
              Parameters const& parameters,
              not_null<std::vector<SystemState>*> const solution) const;
 
+  // The elements of |*solution| are reused, so that a caller that reuses the
+  // |solution| and the |workspace| across calls doesn't allocate memory once
+  // they have reached their steady-state size.
+  template<typename AutonomousRightHandSideComputation,
+           typename RightHandSideComputation>
+  void Solve(RightHandSideComputation compute_force,
+             AutonomousRightHandSideComputation compute_velocity,
+             Parameters const& parameters,
+             not_null<std::vector<SystemState>*> const solution,
+             not_null<Workspace*> const workspace) const;
+
+  // Same as |Solve|, but instead of being stored in a vector, each sampled
+  // state is passed to |sink|, which is called as:
+  //   sink(DoublePrecision<Time> const& time,
+  //        DoublePrecisionVector<Position> const& positions,
+  //        DoublePrecisionVector<Momentum> const& momenta);
+  // The vectors are views into |*workspace| and are only valid for the
+  // duration of the call.  The memory used is independent of the number of
+  // steps.  A |sink| that doesn't need the errors of the compensated summation
+  // should only read the |values| of the vectors.
+  template<typename AutonomousRightHandSideComputation,
+           typename RightHandSideComputation,
+           typename Sink>
+  void SolveWithSink(RightHandSideComputation compute_force,
+                     AutonomousRightHandSideComputation compute_velocity,
+                     Parameters const& parameters,
+                     Sink sink,
+                     not_null<Workspace*> const workspace) const;
+
+  // Same as above, for a separable Hamiltonian whose kinetic energy is p²/2, so
+  // that the velocities are the momenta.  There is no |compute_velocity|, the
+  // momenta are used directly, and the positions and momenta of each stage are
+  // updated in a single pass.  The results are bitwise identical to those of
+  // the overload above with a |compute_velocity| that copies the momenta.
+  template<typename RightHandSideComputation, typename Sink>
+  void SolveWithSink(RightHandSideComputation compute_force,
+                     Parameters const& parameters,
+                     Sink sink,
+                     not_null<Workspace*> const workspace) const;
+
+  // Same as the first overload of |SolveWithSink|, but the |events| are
+  // evaluated at the end of each step.  When the function of an event crosses
+  // zero during a step, the crossing is located to within |time_tolerance| by
+  // bisection, redoing the step from its beginning with shorter lengths, and
+  // |event_sink| is called as:
+  //   event_sink(int const index,
+  //              DoublePrecision<Time> const& time,
+  //              DoublePrecisionVector<Position> const& positions,
+  //              DoublePrecisionVector<Momentum> const& momenta);
+  // with the first state past the crossing, where |index| is the index of the
+  // event in |events|.  The events of a step are reported in chronological
+  // order.  A terminal event ends the integration: the state at its crossing
+  // is the last one passed to |sink|, and the later events of the step are not
+  // reported.  An event whose function crosses zero several times during a
+  // step may be missed, so |Δt| must be small compared to the time scale of
+  // the |events|.  The method must not be processed.
+  template<typename AutonomousRightHandSideComputation,
+           typename RightHandSideComputation,
+           typename Sink,
+           typename EventSink>
+  void SolveWithEvents(RightHandSideComputation compute_force,
+                       AutonomousRightHandSideComputation compute_velocity,
+                       Parameters const& parameters,
+                       std::vector<Event> const& events,
+                       Time const& time_tolerance,
+                       Sink sink,
+                       EventSink event_sink,
+                       not_null<Workspace*> const workspace) const;
+
  private:
+  // Stands for the |compute_velocity| of a Hamiltonian whose kinetic energy is
+  // p²/2.
+  struct MomentumIsVelocity {};
+
+  // The |event_sink| of a |SolveWithSink| without events.
+  struct NoEventSink {
+    void operator()(int const index,
+                    DoublePrecision<Time> const& time,
+                    DoublePrecisionVector<Position> const& positions,
+                    DoublePrecisionVector<Momentum> const& momenta) const {}
+  };
+
+  // The implementation of |SolveWithSink| and |SolveWithEvents|;
+  // |compute_velocity| may be a |MomentumIsVelocity|.
+  template<typename AutonomousRightHandSideComputation,
+           typename RightHandSideComputation,
+           typename Sink,
+           typename EventSink>
+  void SolveWithSinkImplementation(
+      RightHandSideComputation compute_force,
+      AutonomousRightHandSideComputation compute_velocity,
+      Parameters const& parameters,
+      std::vector<Event> const& events,
+      Time const& time_tolerance,
+      Sink sink,
+      EventSink event_sink,
+      not_null<Workspace*> const workspace) const;
+
+  // Advances |workspace->q_last_| and |workspace->p_last_| by a step of length
+  // |h| starting at |tn|.  If |forces_are_current| is true, |workspace->f_|
+  // holds the forces at the beginning of the step.
+  template<typename AutonomousRightHandSideComputation,
+           typename RightHandSideComputation>
+  void Step(RightHandSideComputation& compute_force,
+            AutonomousRightHandSideComputation& compute_velocity,
+            DoublePrecision<Time> const& tn,
+            Time const& h,
+            bool const forces_are_current,
+            not_null<Workspace*> const workspace) const;
+
+  // Called after a step of length |h| that started at |t_step_start| from the
+  // state saved in |workspace->q_step_start_| and |workspace->p_step_start_|.
+  // Reports the events that occurred during the step to |event_sink|.  If one
+  // of them is terminal, leaves the state at its crossing in |*tn|,
+  // |workspace->q_last_| and |workspace->p_last_| and returns true.
+  // Otherwise, leaves the state at the end of the step and returns false.
+  // Clears |*forces_are_current| if the forces were recomputed.
+  template<typename AutonomousRightHandSideComputation,
+           typename RightHandSideComputation,
+           typename EventSink>
+  bool ProcessEvents(RightHandSideComputation& compute_force,
+                     AutonomousRightHandSideComputation& compute_velocity,
+                     std::vector<Event> const& events,
+                     Time const& time_tolerance,
+                     EventSink& event_sink,
+                     DoublePrecision<Time> const& t_step_start,
+                     Time const& h,
+                     not_null<DoublePrecision<Time>*> const tn,
+                     not_null<bool*> const forces_are_current,
+                     not_null<Workspace*> const workspace) const;
+
+  // Applies the processor χ of a step of length |h| to the state |*q|, |*p|
+  // at time |t|, or χ⁻¹ if |inverse| is true.  The stages of χ are at the
+  // times obtained by drifting |t| with the positions, and their forces are
+  // computed in |workspace->f_processor_|, so that |workspace->f_| is
+  // preserved.
+  template<typename AutonomousRightHandSideComputation,
+           typename RightHandSideComputation>
+  void Process(RightHandSideComputation& compute_force,
+               AutonomousRightHandSideComputation& compute_velocity,
+               DoublePrecision<Time> const& t,
+               Time const& h,
+               bool const inverse,
+               not_null<DoublePrecisionVector<Position>*> const q,
+               not_null<DoublePrecisionVector<Momentum>*> const p,
+               not_null<Workspace*> const workspace) const;
+
+  // Sets |*v| to the velocities for the momenta |p|.
+  template<typename AutonomousRightHandSideComputation>
+  static void ComputeVelocities(
+      AutonomousRightHandSideComputation& compute_velocity,
+      std::vector<Momentum> const& p,
+      not_null<std::vector<Quotient<Position, Time>>*> const v);
+  static void ComputeVelocities(
+      MomentumIsVelocity& compute_velocity,
+      std::vector<Momentum> const& p,
+      not_null<std::vector<Quotient<Position, Time>>*> const v);
+
+  // True if the change of the function of an event from |previous_value| to
+  // |value| is a crossing in the direction of |crossing|.
+  static bool Crosses(typename Event::Crossing const crossing,
+                      double const previous_value,
+                      double const value);
+
+  // Performs the stages [i, Tableau::kStages[ of a |Step|, the loop over the
+  // stages being unrolled at compile time.  The last argument is true if there
+  // are no such stages.
+  template<typename Tableau,
+           int i,
+           typename AutonomousRightHandSideComputation,
+           typename RightHandSideComputation>
+  void UnrolledStages(RightHandSideComputation& compute_force,
+                      AutonomousRightHandSideComputation& compute_velocity,
+                      DoublePrecision<Time> const& tn,
+                      Time const& h,
+                      bool const forces_are_current,
+                      std::vector<Position>*& Δqstage_current,
+                      std::vector<Position>*& Δqstage_previous,
+                      std::vector<Momentum>*& Δpstage_current,
+                      std::vector<Momentum>*& Δpstage_previous,
+                      not_null<Workspace*> const workspace,
+                      std::false_type) const;
+  template<typename Tableau,
+           int i,
+           typename AutonomousRightHandSideComputation,
+           typename RightHandSideComputation>
+  void UnrolledStages(RightHandSideComputation& compute_force,
+                      AutonomousRightHandSideComputation& compute_velocity,
+                      DoublePrecision<Time> const& tn,
+                      Time const& h,
+                      bool const forces_are_current,
+                      std::vector<Position>*& Δqstage_current,
+                      std::vector<Position>*& Δqstage_previous,
+                      std::vector<Momentum>*& Δpstage_current,
+                      std::vector<Momentum>*& Δpstage_previous,
+                      not_null<Workspace*> const workspace,
+                      std::true_type) const;
+
+  // The time of the stage |i| of |Tableau|, as a fraction of the step.
+  template<typename Tableau>
+  static CONSTEXPR double UnrolledStageTime(int const i);
+
+  // The coefficients of |Tableau| in the form expected by |Initialize|.
+  template<typename Tableau>
+  static Coefficients MakeCoefficients();
+
+  // Computes the increments of a stage with position weight |a| and momentum
+  // weight |b| of a step of length |h|, given the forces |workspace->f_| at
+  // the positions of the stage.  Reads the increments
+  // of the previous stage from |Δqstage_previous| and |Δpstage_previous|, and
+  // writes the new increments to |*Δqstage_current| and |*Δpstage_current|
+  // and the new stage state to |workspace->q_stage_| and
+  // |workspace->p_stage_|.
+  template<typename AutonomousRightHandSideComputation>
+  void ComputeStage(
+      AutonomousRightHandSideComputation& compute_velocity,
+      double const a,
+      double const b,
+      Time const& h,
+      std::vector<Position> const& Δqstage_previous,
+      std::vector<Momentum> const& Δpstage_previous,
+      not_null<std::vector<Position>*> const Δqstage_current,
+      not_null<std::vector<Momentum>*> const Δpstage_current,
+      not_null<Workspace*> const workspace) const;
+
+  // Same as above, without calling a |compute_velocity|, in a single pass.
+  void ComputeStage(
+      MomentumIsVelocity& compute_velocity,
+      double const a,
+      double const b,
+      Time const& h,
+      std::vector<Position> const& Δqstage_previous,
+      std::vector<Momentum> const& Δpstage_previous,
+      not_null<std::vector<Position>*> const Δqstage_current,
+      not_null<std::vector<Momentum>*> const Δpstage_current,
+      not_null<Workspace*> const workspace) const;
+
   int stages_;
 
+  // True if the last position weight is 0 and the last momentum weight isn't.
+  // The forces at the last stage of a step are then those at the first stage
+  // of the next step, and are not recomputed.
+  bool first_same_as_last_;
+
   // The position and momentum nodes.
   std::vector<double> a_;
   std::vector<double> b_;
 
   // The weights.
   std::vector<double> c_;
+
+  // The position and momentum weights of the processor, and the times of its
+  // stages, as fractions of the step.  Empty if the method is not processed.
+  std::vector<double> processor_a_;
+  std::vector<double> processor_b_;
+  std::vector<double> processor_c_;
+
+  // The scheme whose tableau is used by |UnrolledStages|, if |unrolled_| is
+  // true.
+  bool unrolled_;
+  SPRKScheme unrolled_scheme_;
 };
 
 }  // namespace integrators
@@ -3,40 +3,323 @@
 #include <algorithm>
 #include <cmath>
 #include <ctime>
+#include <type_traits>
 #include <vector>
 
+#include "base/macros.hpp"
+#include "base/tracer.hpp"
 #include "quantities/quantities.hpp"
 
 // Mixed assemblies are not supported by Unity/Mono.
 #include "glog/logging.h"
 
+using principia::base::ScopedTraceEvent;
 using principia::quantities::Quotient;
 
 namespace principia {
 namespace integrators {
 
+// Kick-drift-kick.
+inline CONSTEXPR double SPRKTableau<SPRKScheme::kLeapfrog>::a(int const i) {
+  return i == 0 ? 1.0 : 0.0;
+}
+
+inline CONSTEXPR double SPRKTableau<SPRKScheme::kLeapfrog>::b(int const i) {
+  return 0.5;
+}
+
+inline CONSTEXPR double
+SPRKTableau<SPRKScheme::kMcLachlanAtela1992Order5Optimal>::a(int const i) {
+  return i == 0 ?  0.339839625839110000 :
+         i == 1 ? -0.088601336903027329 :
+         i == 2 ?  0.5858564768259621188 :
+         i == 3 ? -0.603039356536491888 :
+         i == 4 ?  0.3235807965546976394 :
+                   0.4423637942197494587;
+}
+
+inline CONSTEXPR double
+SPRKTableau<SPRKScheme::kMcLachlanAtela1992Order5Optimal>::b(int const i) {
+  return i == 0 ?  0.1193900292875672758 :
+         i == 1 ?  0.6989273703824752308 :
+         i == 2 ? -0.1713123582716007754 :
+         i == 3 ?  0.4012695022513534480 :
+         i == 4 ?  0.0107050818482359840 :
+                  -0.0589796254980311632;
+}
+
 template<typename Position, typename Momentum>
-inline SPRKIntegrator<Position, Momentum>::SPRKIntegrator() : stages_(0) {}
+inline SPRKIntegrator<Position, Momentum>::SPRKIntegrator()
+    : stages_(0),
+      first_same_as_last_(false),
+      unrolled_(false),
+      unrolled_scheme_(SPRKScheme::kLeapfrog) {}
 
 template<typename Position, typename Momentum>
 inline std::vector<std::vector<double>> const&
 SPRKIntegrator<Position, Momentum>::Order5Optimal() const {
-  static std::vector<std::vector<double>> const order_5_optimal = {
-      { 0.339839625839110000,
-       -0.088601336903027329,
-        0.5858564768259621188,
-       -0.603039356536491888,
-        0.3235807965546976394,
-        0.4423637942197494587},
-      { 0.1193900292875672758,
-        0.6989273703824752308,
-       -0.1713123582716007754,
-        0.4012695022513534480,
-        0.0107050818482359840,
-       -0.0589796254980311632}};
+  static std::vector<std::vector<double>> const order_5_optimal =
+      MakeCoefficients<
+          SPRKTableau<SPRKScheme::kMcLachlanAtela1992Order5Optimal>>();
   return order_5_optimal;
 }
 
+template<typename Position, typename Momentum>
+inline typename SPRKIntegrator<Position, Momentum>::Coefficients const&
+SPRKIntegrator<Position, Momentum>::CoefficientsOf(
+    SPRKScheme const scheme) const {
+  // The position weights come first, the momentum weights second.  In each
+  // stage the momenta are updated before the positions, so the schemes that
+  // are usually written drift first are given here in their kick first form.
+  switch (scheme) {
+    case SPRKScheme::kLeapfrog: {
+      static Coefficients const leapfrog =
+          MakeCoefficients<SPRKTableau<SPRKScheme::kLeapfrog>>();
+      return leapfrog;
+    }
+    case SPRKScheme::kMcLachlanAtela1992Order2Optimal: {
+      static Coefficients const mc_lachlan_atela_1992_order_2_optimal = {
+          {0.7071067811865475244,
+           0.2928932188134524756},
+          {0.2928932188134524756,
+           0.7071067811865475244}};
+      return mc_lachlan_atela_1992_order_2_optimal;
+    }
+    case SPRKScheme::kRuth1983: {
+      static Coefficients const ruth_1983 = {
+          {-1.0 / 24.0,
+            3.0 / 4.0,
+            7.0 / 24.0},
+          { 1.0,
+           -2.0 / 3.0,
+            2.0 / 3.0}};
+      return ruth_1983;
+    }
+    case SPRKScheme::kMcLachlanAtela1992Order3Optimal: {
+      static Coefficients const mc_lachlan_atela_1992_order_3_optimal = {
+          { 0.919661523017399857,
+           -0.187991618799799700,
+            0.268330095782399843},
+          { 0.268330095782399843,
+           -0.187991618799799700,
+            0.919661523017399857}};
+      return mc_lachlan_atela_1992_order_3_optimal;
+    }
+    case SPRKScheme::kCandyRozmus1991ForestRuth1990: {
+      // The composition of three leapfrog steps of lengths θ, 1 - 2θ, θ,
+      // where θ = 1 / (2 - ∛2).
+      static Coefficients const candy_rozmus_1991_forest_ruth_1990 = {
+          { 1.351207191959657634,
+           -1.702414383919315268,
+            1.351207191959657634,
+            0.0},
+          { 0.6756035959798288170,
+           -0.1756035959798288170,
+           -0.1756035959798288170,
+            0.6756035959798288170}};
+      return candy_rozmus_1991_forest_ruth_1990;
+    }
+    case SPRKScheme::kMcLachlanAtela1992Order4Optimal: {
+      static Coefficients const mc_lachlan_atela_1992_order_4_optimal = {
+          { 0.5153528374311229364,
+           -0.085782019412973646,
+            0.4415830236164665242,
+            0.1288461583653841854},
+          { 0.1344961992774310892,
+           -0.2248198030794208058,
+            0.7563200005156682911,
+            0.3340036032863214255}};
+      return mc_lachlan_atela_1992_order_4_optimal;
+    }
+    case SPRKScheme::kBlanesMoan2002SRKN6B: {
+      static Coefficients const blanes_moan_2002_srkn_6b = {
+          { 0.209515106613362,
+           -0.143851773179818,
+            0.434336666566456,
+            0.434336666566456,
+           -0.143851773179818,
+            0.209515106613362,
+            0.0},
+          { 0.0792036964311957,
+            0.353172906049774,
+           -0.0420650803577195,
+            0.2193769557534996,
+           -0.0420650803577195,
+            0.353172906049774,
+            0.0792036964311957}};
+      return blanes_moan_2002_srkn_6b;
+    }
+    case SPRKScheme::kMcLachlanAtela1992Order5Optimal: {
+      return Order5Optimal();
+    }
+    case SPRKScheme::kYoshida1990Order6A: {
+      // The composition of seven leapfrog steps with Yoshida's solution A.
+      static Coefficients const yoshida_1990_order_6a = {
+          { 0.784513610477560,
+            0.235573213359357,
+           -1.17767998417887,
+            1.315186320683906,
+           -1.17767998417887,
+            0.235573213359357,
+            0.784513610477560,
+            0.0},
+          { 0.392256805238780,
+            0.5100434119184585,
+           -0.4710533854097565,
+            0.068753168252518,
+            0.068753168252518,
+           -0.4710533854097565,
+            0.5100434119184585,
+            0.392256805238780}};
+      return yoshida_1990_order_6a;
+    }
+    case SPRKScheme::kBlanesMoan2002SRKN11B: {
+      static Coefficients const blanes_moan_2002_srkn_11b = {
+          { 0.123229775946271,
+            0.290553797799558,
+           -0.127049212625417,
+           -0.246331761062075,
+            0.357208872795928,
+            0.204777054291470,
+            0.357208872795928,
+           -0.246331761062075,
+           -0.127049212625417,
+            0.290553797799558,
+            0.123229775946271,
+            0.0},
+          { 0.0414649985182624,
+            0.198128671918067,
+           -0.0400061921041533,
+            0.0752539843015807,
+           -0.0115113874206879,
+            0.2366699247869311,
+            0.2366699247869311,
+           -0.0115113874206879,
+            0.0752539843015807,
+           -0.0400061921041533,
+            0.198128671918067,
+            0.0414649985182624}};
+      return blanes_moan_2002_srkn_11b;
+    }
+    case SPRKScheme::kYoshida1990Order8D: {
+      // The composition of fifteen leapfrog steps with Yoshida's solution D.
+      static Coefficients const yoshida_1990_order_8d = {
+          { 0.914844246229740,
+            0.253693336566229,
+           -1.44485223686048,
+           -0.158240635368243,
+            1.93813913762276,
+           -1.96061023297549,
+            0.102799849391985,
+            1.708453070786998,
+            0.102799849391985,
+           -1.96061023297549,
+            1.93813913762276,
+           -0.158240635368243,
+           -1.44485223686048,
+            0.253693336566229,
+            0.914844246229740,
+            0.0},
+          { 0.457422123114870,
+            0.5842687913979845,
+           -0.5955794501471255,
+           -0.8015464361143615,
+            0.8899492511272585,
+           -0.011235547676365,
+           -0.9289051917917525,
+            0.9056264600894915,
+            0.9056264600894915,
+           -0.9289051917917525,
+           -0.011235547676365,
+            0.8899492511272585,
+           -0.8015464361143615,
+           -0.5955794501471255,
+            0.5842687913979845,
+            0.457422123114870}};
+      return yoshida_1990_order_8d;
+    }
+    case SPRKScheme::kProcessedOrder6: {
+      // A symmetric kernel of order 2 whose error terms of order 3 and 5 can
+      // be cancelled by a processor when the forces don't depend on the
+      // momenta.  The coefficients were obtained by solving these conditions
+      // numerically with the Baker-Campbell-Hausdorff formula.
+      static Coefficients const processed_order_6 = {
+          {-0.6659279171311346,
+            1.1659279171311346,
+            1.1659279171311346,
+           -0.6659279171311346,
+            0.0},
+          { 0.09624991474146673,
+           -0.06499510742686752,
+            0.9374903853708016,
+           -0.06499510742686752,
+            0.09624991474146673}};
+      return processed_order_6;
+    }
+  }
+  LOG(FATAL) << "Unknown scheme " << static_cast<int>(scheme);
+  base::noreturn();
+}
+
+template<typename Position, typename Momentum>
+inline typename SPRKIntegrator<Position, Momentum>::Coefficients const&
+SPRKIntegrator<Position, Momentum>::ProcessorOf(
+    SPRKScheme const scheme) const {
+  CHECK(IsProcessed(scheme)) << static_cast<int>(scheme);
+  // The processor of |kProcessedOrder6|, which cancels the terms of order 2
+  // to 5 of the error of the conjugated kernel.  Obtained in the same way as
+  // the kernel.
+  static Coefficients const processed_order_6 = {
+      { 0.21583173579558446,
+       -0.5113295420687399,
+        0.565691513490294,
+        0.21055737179176323,
+       -0.8117872485425398,
+       -0.12366838665711587,
+        0.4547045561907539},
+      { 0.0,
+        0.05684996801666599,
+       -0.11698899725062768,
+       -0.15925112116866985,
+        0.1744518355208068,
+        0.3130317455128819,
+       -0.2680934306310571}};
+  return processed_order_6;
+}
+
+template<typename Position, typename Momentum>
+inline int SPRKIntegrator<Position, Momentum>::OrderOf(
+    SPRKScheme const scheme) {
+  switch (scheme) {
+    case SPRKScheme::kLeapfrog:
+    case SPRKScheme::kMcLachlanAtela1992Order2Optimal:
+      return 2;
+    case SPRKScheme::kRuth1983:
+    case SPRKScheme::kMcLachlanAtela1992Order3Optimal:
+      return 3;
+    case SPRKScheme::kCandyRozmus1991ForestRuth1990:
+    case SPRKScheme::kMcLachlanAtela1992Order4Optimal:
+    case SPRKScheme::kBlanesMoan2002SRKN6B:
+      return 4;
+    case SPRKScheme::kMcLachlanAtela1992Order5Optimal:
+      return 5;
+    case SPRKScheme::kYoshida1990Order6A:
+    case SPRKScheme::kBlanesMoan2002SRKN11B:
+    case SPRKScheme::kProcessedOrder6:
+      return 6;
+    case SPRKScheme::kYoshida1990Order8D:
+      return 8;
+  }
+  LOG(FATAL) << "Unknown scheme " << static_cast<int>(scheme);
+  base::noreturn();
+}
+
+template<typename Position, typename Momentum>
+inline bool SPRKIntegrator<Position, Momentum>::IsProcessed(
+    SPRKScheme const scheme) {
+  return scheme == SPRKScheme::kProcessedOrder6;
+}
+
 template<typename Position, typename Momentum>
 inline void SPRKIntegrator<Position, Momentum>::Initialize(
     Coefficients const& coefficients) {
@@ -45,12 +328,54 @@ inline void SPRKIntegrator<Position, Momentum>::Initialize(
   b_ = coefficients[1];
   stages_ = b_.size();
   CHECK_EQ(stages_, a_.size());
+  first_same_as_last_ = stages_ > 1 && a_.back() == 0.0 && b_.back() != 0.0;
+  unrolled_ = false;
+  processor_a_.clear();
+  processor_b_.clear();
+  processor_c_.clear();
 
   // Runge-Kutta time weights.
   c_.resize(stages_);
   c_[0] = 0.0;
   for (int j = 1; j < stages_; ++j) {
-    c_[j] = c_[j - 1] + b_[j - 1];
+    c_[j] = c_[j - 1] + a_[j - 1];
+  }
+}
+
+template<typename Position, typename Momentum>
+inline void SPRKIntegrator<Position, Momentum>::Initialize(
+    Coefficients const& coefficients,
+    Coefficients const& processor) {
+  Initialize(coefficients);
+  CHECK_EQ(2, processor.size());
+  processor_a_ = processor[0];
+  processor_b_ = processor[1];
+  int const processor_stages = processor_b_.size();
+  CHECK_LT(0, processor_stages);
+  CHECK_EQ(processor_stages, processor_a_.size());
+  processor_c_.resize(processor_stages);
+  processor_c_[0] = 0.0;
+  for (int j = 1; j < processor_stages; ++j) {
+    processor_c_[j] = processor_c_[j - 1] + processor_a_[j - 1];
+  }
+}
+
+template<typename Position, typename Momentum>
+inline void SPRKIntegrator<Position, Momentum>::Initialize(
+    SPRKScheme const scheme) {
+  if (IsProcessed(scheme)) {
+    Initialize(CoefficientsOf(scheme), ProcessorOf(scheme));
+    return;
+  }
+  Initialize(CoefficientsOf(scheme));
+  switch (scheme) {
+    case SPRKScheme::kLeapfrog:
+    case SPRKScheme::kMcLachlanAtela1992Order5Optimal:
+      unrolled_ = true;
+      unrolled_scheme_ = scheme;
+      break;
+    default:
+      break;
   }
 }
 
@@ -62,17 +387,19 @@ void SPRKIntegrator<Position, Momentum>::Solve(
       AutonomousRightHandSideComputation compute_velocity,
       Parameters const& parameters,
       not_null<std::vector<SystemState>*> const solution) const {
-  int const dimension = parameters.initial.positions.size();
-
-  std::vector<Position> Δqstage0(dimension);
-  std::vector<Position> Δqstage1(dimension);
-  std::vector<Momentum> Δpstage0(dimension);
-  std::vector<Momentum> Δpstage1(dimension);
-  std::vector<Position>* Δqstage_current = &Δqstage1;
-  std::vector<Position>* Δqstage_previous = &Δqstage0;
-  std::vector<Momentum>* Δpstage_current = &Δpstage1;
-  std::vector<Momentum>* Δpstage_previous = &Δpstage0;
+  Workspace workspace;
+  Solve(compute_force, compute_velocity, parameters, solution, &workspace);
+}
 
+template<typename Position, typename Momentum>
+template<typename AutonomousRightHandSideComputation,
+         typename RightHandSideComputation>
+void SPRKIntegrator<Position, Momentum>::Solve(
+      RightHandSideComputation compute_force,
+      AutonomousRightHandSideComputation compute_velocity,
+      Parameters const& parameters,
+      not_null<std::vector<SystemState>*> const solution,
+      not_null<Workspace*> const workspace) const {
   // Dimension the result.
   int const capacity = parameters.sampling_period == 0 ?
     1 :
@@ -80,17 +407,132 @@ void SPRKIntegrator<Position, Momentum>::Solve(
         ceil((((parameters.tmax - parameters.initial.time.value) /
                     parameters.Δt) + 1) /
                 parameters.sampling_period)) + 1;
-  solution->clear();
   solution->reserve(capacity);
+  // The number of elements of |*solution| that have been filled by this call.
+  // The elements past that index are left over from a previous call and are
+  // overwritten, rather than reallocated, when we sample.
+  int solution_size = 0;
+
+  // Appends the current state to |*solution|, reusing an existing element if
+  // there is one.
+  auto const sink =
+      [&solution, &solution_size](
+          DoublePrecision<Time> const& time,
+          DoublePrecisionVector<Position> const& positions,
+          DoublePrecisionVector<Momentum> const& momenta) {
+    if (solution_size == static_cast<int>(solution->size())) {
+      solution->emplace_back();
+    }
+    SystemState* state = &(*solution)[solution_size];
+    ++solution_size;
+    state->time = time;
+    positions.Extract(&state->positions);
+    momenta.Extract(&state->momenta);
+  };
+  SolveWithSink(compute_force, compute_velocity, parameters, sink, workspace);
+  solution->resize(solution_size);
+}
+
+template<typename Position, typename Momentum>
+template<typename AutonomousRightHandSideComputation,
+         typename RightHandSideComputation,
+         typename Sink>
+void SPRKIntegrator<Position, Momentum>::SolveWithSink(
+      RightHandSideComputation compute_force,
+      AutonomousRightHandSideComputation compute_velocity,
+      Parameters const& parameters,
+      Sink sink,
+      not_null<Workspace*> const workspace) const {
+  SolveWithSinkImplementation(compute_force,
+                              compute_velocity,
+                              parameters,
+                              std::vector<Event>(),
+                              Time(),
+                              sink,
+                              NoEventSink(),
+                              workspace);
+}
+
+template<typename Position, typename Momentum>
+template<typename RightHandSideComputation, typename Sink>
+void SPRKIntegrator<Position, Momentum>::SolveWithSink(
+      RightHandSideComputation compute_force,
+      Parameters const& parameters,
+      Sink sink,
+      not_null<Workspace*> const workspace) const {
+  static_assert(
+      std::is_same<Quotient<Position, Time>, Momentum>::value,
+      "The momenta must have the dimensions of velocities");
+  SolveWithSinkImplementation(compute_force,
+                              MomentumIsVelocity(),
+                              parameters,
+                              std::vector<Event>(),
+                              Time(),
+                              sink,
+                              NoEventSink(),
+                              workspace);
+}
+
+template<typename Position, typename Momentum>
+template<typename AutonomousRightHandSideComputation,
+         typename RightHandSideComputation,
+         typename Sink,
+         typename EventSink>
+void SPRKIntegrator<Position, Momentum>::SolveWithEvents(
+      RightHandSideComputation compute_force,
+      AutonomousRightHandSideComputation compute_velocity,
+      Parameters const& parameters,
+      std::vector<Event> const& events,
+      Time const& time_tolerance,
+      Sink sink,
+      EventSink event_sink,
+      not_null<Workspace*> const workspace) const {
+  CHECK_LT(Time(), time_tolerance);
+  CHECK(processor_b_.empty()) << "Events with a processed method";
+  SolveWithSinkImplementation(compute_force,
+                              compute_velocity,
+                              parameters,
+                              events,
+                              time_tolerance,
+                              sink,
+                              event_sink,
+                              workspace);
+}
+
+template<typename Position, typename Momentum>
+template<typename AutonomousRightHandSideComputation,
+         typename RightHandSideComputation,
+         typename Sink,
+         typename EventSink>
+void SPRKIntegrator<Position, Momentum>::SolveWithSinkImplementation(
+      RightHandSideComputation compute_force,
+      AutonomousRightHandSideComputation compute_velocity,
+      Parameters const& parameters,
+      std::vector<Event> const& events,
+      Time const& time_tolerance,
+      Sink sink,
+      EventSink event_sink,
+      not_null<Workspace*> const workspace) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  int const dimension = parameters.initial.positions.size();
 
-  std::vector<DoublePrecision<Position>> q_last(parameters.initial.positions);
-  std::vector<DoublePrecision<Momentum>> p_last(parameters.initial.momenta);
+  // The contents of the stage increments are reset at the beginning of each
+  // step, so there is no need to clear them here.
+  workspace->Δqstage0_.resize(dimension);
+  workspace->Δqstage1_.resize(dimension);
+  workspace->Δpstage0_.resize(dimension);
+  workspace->Δpstage1_.resize(dimension);
+
+  DoublePrecisionVector<Position>& q_last = workspace->q_last_;
+  DoublePrecisionVector<Momentum>& p_last = workspace->p_last_;
+  q_last.Assign(parameters.initial.positions);
+  p_last.Assign(parameters.initial.momenta);
   int sampling_phase = 0;
 
-  std::vector<Position> q_stage(dimension);
-  std::vector<Momentum> p_stage(dimension);
-  std::vector<Quotient<Momentum, Time>> f(dimension);  // Current forces.
-  std::vector<Quotient<Position, Time>> v(dimension);  // Current velocities.
+  workspace->q_stage_.resize(dimension);
+  workspace->p_stage_.resize(dimension);
+  workspace->f_.resize(dimension);
+  workspace->v_.resize(dimension);
 
   // The following quantity is generally equal to |Δt|, but during the last
   // iteration, if |tmax_is_exact|, it may differ significantly from |Δt|.
@@ -101,6 +543,42 @@ void SPRKIntegrator<Position, Momentum>::Solve(
   // sure that we don't have drifts.
   DoublePrecision<Time> tn = parameters.initial.time;
 
+  // For a processed method, |q_last| and |p_last| hold the state of the
+  // kernel, and the sink receives the processed state.
+  bool const processed = !processor_b_.empty();
+  if (processed) {
+    workspace->f_processor_.resize(dimension);
+    workspace->Δq_processor_.resize(dimension);
+    workspace->Δp_processor_.resize(dimension);
+    Process(compute_force, compute_velocity, tn, h, true /*inverse*/,
+            &q_last, &p_last, workspace);
+  }
+  auto const output = [this, &compute_force, &compute_velocity, &sink,
+                       processed, &q_last, &p_last, workspace](
+      DoublePrecision<Time> const& t, Time const& step) {
+    if (processed) {
+      DoublePrecisionVector<Position>& q_processed = workspace->q_processed_;
+      DoublePrecisionVector<Momentum>& p_processed = workspace->p_processed_;
+      q_processed = q_last;
+      p_processed = p_last;
+      Process(compute_force, compute_velocity, t, step, false /*inverse*/,
+              &q_processed, &p_processed, workspace);
+      sink(t, q_processed, p_processed);
+    } else {
+      sink(t, q_last, p_last);
+    }
+  };
+
+  bool const has_events = !events.empty();
+  if (has_events) {
+    std::vector<double>& event_values = workspace->event_values_;
+    event_values.resize(events.size());
+    for (std::size_t j = 0; j < events.size(); ++j) {
+      event_values[j] =
+          events[j].function(tn.value, q_last.values, p_last.values);
+    }
+  }
+
 #ifdef TRACE_SYMPLECTIC_PARTITIONED_RUNGE_KUTTA_INTEGRATOR
   int percentage = 0;
   // Initialize |running_time| so that, when we reach the end of the iteration
@@ -112,6 +590,10 @@ void SPRKIntegrator<Position, Momentum>::Solve(
   // Integration.  For details see Wolfram Reference,
   // http://reference.wolfram.com/mathematica/tutorial/NDSolveSPRK.html#74387056
   bool at_end = !parameters.tmax_is_exact && parameters.tmax < tn.value + h;
+  // True if |f| holds the forces at the positions of the last stage of the
+  // previous step, which are, up to rounding, the positions at the beginning of
+  // the current step.
+  bool forces_are_current = false;
   while (!at_end) {
     // Check if this is the last interval and if so process it appropriately.
     if (parameters.tmax_is_exact) {
@@ -126,6 +608,15 @@ void SPRKIntegrator<Position, Momentum>::Solve(
       if (parameters.tmax <= tn.value + 3 * h / 2) {
         at_end = true;
         h = (parameters.tmax - tn.value) - tn.error;
+        // The state of the kernel depends on the step, so it is converted to
+        // that of the new step.
+        if (processed && h != parameters.Δt) {
+          Process(compute_force, compute_velocity, tn, parameters.Δt,
+                  false /*inverse*/, &q_last, &p_last, workspace);
+          Process(compute_force, compute_velocity, tn, h, true /*inverse*/,
+                  &q_last, &p_last, workspace);
+          forces_are_current = false;
+        }
       }
     } else if (parameters.tmax < tn.value + 2 * h) {
       // If the next interval would overshoot, make this the last interval but
@@ -135,56 +626,35 @@ void SPRKIntegrator<Position, Momentum>::Solve(
     // Here |h| is the length of the current time interval and |tn| is its
     // start.
 
-    // Increment SPRK step from "'SymplecticPartitionedRungeKutta' Method
-    // for NDSolve", algorithm 3.
-    for (int k = 0; k < dimension; ++k) {
-      (*Δqstage_current)[k] = Position();
-      (*Δpstage_current)[k] = Momentum();
-      q_stage[k] = q_last[k].value;
+    if (has_events) {
+      workspace->q_step_start_ = q_last;
+      workspace->p_step_start_ = p_last;
     }
-    for (int i = 0; i < stages_; ++i) {
-      std::swap(Δqstage_current, Δqstage_previous);
-      std::swap(Δpstage_current, Δpstage_previous);
-
-      // By using |tn.error| below we get a time value which is possibly a wee
-      // bit more precise.
-      compute_force(tn.value + (tn.error + c_[i] * h), q_stage, &f);
+    DoublePrecision<Time> const t_step_start = tn;
+    Step(compute_force, compute_velocity, tn, h, forces_are_current, workspace);
+    forces_are_current = first_same_as_last_;
+    tn.Increment(h);
 
-      // Beware, the p/q order matters here, the two computations depend on one
-      // another.
-      for (int k = 0; k < dimension; ++k) {
-        Momentum const Δp = (*Δpstage_previous)[k] + h * b_[i] * f[k];
-        p_stage[k] = p_last[k].value + Δp;
-        (*Δpstage_current)[k] = Δp;
-      }
-      compute_velocity(p_stage, &v);
-      for (int k = 0; k < dimension; ++k) {
-        Position const Δq = (*Δqstage_previous)[k] + h * a_[i] * v[k];
-        q_stage[k] = q_last[k].value + Δq;
-        (*Δqstage_current)[k] = Δq;
-      }
-    }
-    // Compensated summation from "'SymplecticPartitionedRungeKutta' Method
-    // for NDSolve", algorithm 2.
-    for (int k = 0; k < dimension; ++k) {
-      q_last[k].Increment((*Δqstage_current)[k]);
-      p_last[k].Increment((*Δpstage_current)[k]);
-      q_stage[k] = q_last[k].value;
-      p_stage[k] = p_last[k].value;
+    bool stopped = false;
+    if (has_events) {
+      stopped = ProcessEvents(compute_force,
+                              compute_velocity,
+                              events,
+                              time_tolerance,
+                              event_sink,
+                              t_step_start,
+                              h,
+                              &tn,
+                              &forces_are_current,
+                              workspace);
+      at_end |= stopped;
     }
-    tn.Increment(h);
 
     if (parameters.sampling_period != 0) {
-      if (sampling_phase % parameters.sampling_period == 0) {
-        solution->emplace_back();
-        SystemState* state = &solution->back();
-        state->time = tn;
-        state->positions.reserve(dimension);
-        state->momenta.reserve(dimension);
-        for (int k = 0; k < dimension; ++k) {
-          state->positions.emplace_back(q_last[k]);
-          state->momenta.emplace_back(p_last[k]);
-        }
+      // The state at a terminal event is always sampled, since it is the last
+      // one.
+      if (stopped || sampling_phase % parameters.sampling_period == 0) {
+        output(tn, h);
       }
       ++sampling_phase;
     }
@@ -203,15 +673,7 @@ void SPRKIntegrator<Position, Momentum>::Solve(
 #endif
   }
   if (parameters.sampling_period == 0) {
-    solution->emplace_back();
-    SystemState* state = &solution->back();
-    state->time = tn;
-    state->positions.reserve(dimension);
-    state->momenta.reserve(dimension);
-    for (int k = 0; k < dimension; ++k) {
-      state->positions.emplace_back(q_last[k]);
-      state->momenta.emplace_back(p_last[k]);
-    }
+    output(tn, h);
   }
 
 #ifdef TRACE_SYMPLECTIC_PARTITIONED_RUNGE_KUTTA_INTEGRATOR
@@ -221,5 +683,422 @@ void SPRKIntegrator<Position, Momentum>::Solve(
 #endif
 }
 
+template<typename Position, typename Momentum>
+template<typename AutonomousRightHandSideComputation,
+         typename RightHandSideComputation>
+void SPRKIntegrator<Position, Momentum>::Step(
+    RightHandSideComputation& compute_force,
+    AutonomousRightHandSideComputation& compute_velocity,
+    DoublePrecision<Time> const& tn,
+    Time const& h,
+    bool const forces_are_current,
+    not_null<Workspace*> const workspace) const {
+  int const dimension = workspace->q_stage_.size();
+  std::vector<Position>* Δqstage_current = &workspace->Δqstage1_;
+  std::vector<Position>* Δqstage_previous = &workspace->Δqstage0_;
+  std::vector<Momentum>* Δpstage_current = &workspace->Δpstage1_;
+  std::vector<Momentum>* Δpstage_previous = &workspace->Δpstage0_;
+  std::vector<Position>& q_stage = workspace->q_stage_;
+  std::vector<Quotient<Momentum, Time>>& f = workspace->f_;
+
+  // Increment SPRK step from "'SymplecticPartitionedRungeKutta' Method
+  // for NDSolve", algorithm 3.
+  for (int k = 0; k < dimension; ++k) {
+    (*Δqstage_current)[k] = Position();
+    (*Δpstage_current)[k] = Momentum();
+    q_stage[k] = workspace->q_last_.values[k];
+  }
+  if (unrolled_ && unrolled_scheme_ == SPRKScheme::kLeapfrog) {
+    UnrolledStages<SPRKTableau<SPRKScheme::kLeapfrog>, 0>(
+        compute_force, compute_velocity, tn, h, forces_are_current,
+        Δqstage_current, Δqstage_previous, Δpstage_current, Δpstage_previous,
+        workspace, std::false_type());
+  } else if (unrolled_ &&
+             unrolled_scheme_ == SPRKScheme::kMcLachlanAtela1992Order5Optimal) {
+    UnrolledStages<SPRKTableau<SPRKScheme::kMcLachlanAtela1992Order5Optimal>,
+                   0>(
+        compute_force, compute_velocity, tn, h, forces_are_current,
+        Δqstage_current, Δqstage_previous, Δpstage_current, Δpstage_previous,
+        workspace, std::false_type());
+  } else {
+    for (int i = 0; i < stages_; ++i) {
+      std::swap(Δqstage_current, Δqstage_previous);
+      std::swap(Δpstage_current, Δpstage_previous);
+
+      // The forces are not needed at the stages whose momentum weight is 0,
+      // e.g., the first stage of a method written drift first.  By using
+      // |tn.error| below we get a time value which is possibly a wee bit more
+      // precise.
+      if (b_[i] != 0.0 && (i > 0 || !forces_are_current)) {
+        compute_force(tn.value + (tn.error + c_[i] * h), q_stage, &f);
+      }
+      ComputeStage(compute_velocity,
+                   a_[i],
+                   b_[i],
+                   h,
+                   *Δqstage_previous,
+                   *Δpstage_previous,
+                   Δqstage_current,
+                   Δpstage_current,
+                   workspace);
+    }
+  }
+  // Compensated summation from "'SymplecticPartitionedRungeKutta' Method
+  // for NDSolve", algorithm 2.  The stage states need not be updated here:
+  // the positions are reset at the beginning of the next step, and the
+  // momenta are recomputed by every stage.
+  workspace->q_last_.Increment(*Δqstage_current);
+  workspace->p_last_.Increment(*Δpstage_current);
+}
+
+template<typename Position, typename Momentum>
+template<typename Tableau,
+         int i,
+         typename AutonomousRightHandSideComputation,
+         typename RightHandSideComputation>
+inline void SPRKIntegrator<Position, Momentum>::UnrolledStages(
+    RightHandSideComputation& compute_force,
+    AutonomousRightHandSideComputation& compute_velocity,
+    DoublePrecision<Time> const& tn,
+    Time const& h,
+    bool const forces_are_current,
+    std::vector<Position>*& Δqstage_current,
+    std::vector<Position>*& Δqstage_previous,
+    std::vector<Momentum>*& Δpstage_current,
+    std::vector<Momentum>*& Δpstage_previous,
+    not_null<Workspace*> const workspace,
+    std::false_type) const {
+  std::swap(Δqstage_current, Δqstage_previous);
+  std::swap(Δpstage_current, Δpstage_previous);
+
+  // Same as the loop in |Step|, with constant coefficients.
+  if (Tableau::b(i) != 0.0 && (i > 0 || !forces_are_current)) {
+    compute_force(tn.value + (tn.error + UnrolledStageTime<Tableau>(i) * h),
+                  workspace->q_stage_,
+                  &workspace->f_);
+  }
+  ComputeStage(compute_velocity,
+               Tableau::a(i),
+               Tableau::b(i),
+               h,
+               *Δqstage_previous,
+               *Δpstage_previous,
+               Δqstage_current,
+               Δpstage_current,
+               workspace);
+  UnrolledStages<Tableau, i + 1>(
+      compute_force, compute_velocity, tn, h, forces_are_current,
+      Δqstage_current, Δqstage_previous, Δpstage_current, Δpstage_previous,
+      workspace, std::integral_constant<bool, i + 1 == Tableau::kStages>());
+}
+
+template<typename Position, typename Momentum>
+template<typename Tableau,
+         int i,
+         typename AutonomousRightHandSideComputation,
+         typename RightHandSideComputation>
+inline void SPRKIntegrator<Position, Momentum>::UnrolledStages(
+    RightHandSideComputation& compute_force,
+    AutonomousRightHandSideComputation& compute_velocity,
+    DoublePrecision<Time> const& tn,
+    Time const& h,
+    bool const forces_are_current,
+    std::vector<Position>*& Δqstage_current,
+    std::vector<Position>*& Δqstage_previous,
+    std::vector<Momentum>*& Δpstage_current,
+    std::vector<Momentum>*& Δpstage_previous,
+    not_null<Workspace*> const workspace,
+    std::true_type) const {}
+
+template<typename Position, typename Momentum>
+template<typename Tableau>
+inline CONSTEXPR double
+SPRKIntegrator<Position, Momentum>::UnrolledStageTime(int const i) {
+  // Same summation order as the computation of |c_| in |Initialize|.
+  return i == 0 ? 0.0 : UnrolledStageTime<Tableau>(i - 1) + Tableau::a(i - 1);
+}
+
+template<typename Position, typename Momentum>
+template<typename Tableau>
+typename SPRKIntegrator<Position, Momentum>::Coefficients
+SPRKIntegrator<Position, Momentum>::MakeCoefficients() {
+  Coefficients coefficients(2);
+  for (int i = 0; i < Tableau::kStages; ++i) {
+    coefficients[0].push_back(Tableau::a(i));
+    coefficients[1].push_back(Tableau::b(i));
+  }
+  return coefficients;
+}
+
+template<typename Position, typename Momentum>
+template<typename AutonomousRightHandSideComputation,
+         typename RightHandSideComputation,
+         typename EventSink>
+bool SPRKIntegrator<Position, Momentum>::ProcessEvents(
+    RightHandSideComputation& compute_force,
+    AutonomousRightHandSideComputation& compute_velocity,
+    std::vector<Event> const& events,
+    Time const& time_tolerance,
+    EventSink& event_sink,
+    DoublePrecision<Time> const& t_step_start,
+    Time const& h,
+    not_null<DoublePrecision<Time>*> const tn,
+    not_null<bool*> const forces_are_current,
+    not_null<Workspace*> const workspace) const {
+  DoublePrecisionVector<Position>& q_last = workspace->q_last_;
+  DoublePrecisionVector<Momentum>& p_last = workspace->p_last_;
+  std::vector<double>& event_values = workspace->event_values_;
+  std::vector<std::pair<Time, int>>& crossings = workspace->crossings_;
+
+  // Detect the crossings at the end of the step.  The values at the beginning
+  // of the step are kept in |event_values| until the crossings are located.
+  crossings.clear();
+  for (std::size_t j = 0; j < events.size(); ++j) {
+    double const value = events[j].function(tn->value,
+                                            q_last.values,
+                                            p_last.values);
+    if (Crosses(events[j].crossing, event_values[j], value)) {
+      crossings.emplace_back(h, static_cast<int>(j));
+    } else {
+      event_values[j] = value;
+    }
+  }
+  if (crossings.empty()) {
+    return false;
+  }
+
+  // Redoes the step from its beginning with a length of |Δt|.  The forces at
+  // the beginning of the step are not known, since |workspace->f_| is
+  // clobbered by the partial steps.
+  auto const partial_step = [this, &compute_force, &compute_velocity,
+                             &t_step_start, &q_last, &p_last, workspace](
+                                Time const& Δt) {
+    q_last = workspace->q_step_start_;
+    p_last = workspace->p_step_start_;
+    Step(compute_force, compute_velocity, t_step_start, Δt, false, workspace);
+  };
+
+  workspace->q_step_end_ = q_last;
+  workspace->p_step_end_ = p_last;
+  *forces_are_current = false;
+
+  // Locate each crossing by bisection.  |upper| is always past the crossing
+  // and |lower| before it.
+  for (auto& crossing : crossings) {
+    Event const& event = events[crossing.second];
+    double const previous_value = event_values[crossing.second];
+    Time lower;
+    Time upper = h;
+    while (upper - lower > time_tolerance) {
+      Time const middle = lower + 0.5 * (upper - lower);
+      if (middle <= lower || middle >= upper) {
+        break;
+      }
+      partial_step(middle);
+      double const value = event.function(
+          t_step_start.value + (t_step_start.error + middle),
+          q_last.values,
+          p_last.values);
+      if (Crosses(event.crossing, previous_value, value)) {
+        upper = middle;
+      } else {
+        lower = middle;
+      }
+    }
+    crossing.first = upper;
+  }
+  std::stable_sort(crossings.begin(), crossings.end(),
+                   [](std::pair<Time, int> const& left,
+                      std::pair<Time, int> const& right) {
+                     return left.first < right.first;
+                   });
+
+  // Report the crossings in chronological order, stopping at the first
+  // terminal one.
+  for (auto const& crossing : crossings) {
+    if (crossing.first == h) {
+      q_last = workspace->q_step_end_;
+      p_last = workspace->p_step_end_;
+    } else {
+      partial_step(crossing.first);
+    }
+    DoublePrecision<Time> t = t_step_start;
+    t.Increment(crossing.first);
+    event_sink(crossing.second, t, q_last, p_last);
+    if (events[crossing.second].terminal) {
+      *tn = t;
+      return true;
+    }
+  }
+
+  // No terminal event, restore the end of the step and record the values of
+  // the functions there.
+  q_last = workspace->q_step_end_;
+  p_last = workspace->p_step_end_;
+  for (auto const& crossing : crossings) {
+    event_values[crossing.second] = events[crossing.second].function(
+        tn->value, q_last.values, p_last.values);
+  }
+  return false;
+}
+
+template<typename Position, typename Momentum>
+bool SPRKIntegrator<Position, Momentum>::Crosses(
+    typename Event::Crossing const crossing,
+    double const previous_value,
+    double const value) {
+  bool const increasing = previous_value < 0 && value >= 0;
+  bool const decreasing = previous_value > 0 && value <= 0;
+  switch (crossing) {
+    case Event::Crossing::kAny:
+      return increasing || decreasing;
+    case Event::Crossing::kIncreasing:
+      return increasing;
+    case Event::Crossing::kDecreasing:
+      return decreasing;
+  }
+  LOG(FATAL) << "Unexpected crossing " << static_cast<int>(crossing);
+  base::noreturn();
+}
+
+template<typename Position, typename Momentum>
+template<typename AutonomousRightHandSideComputation,
+         typename RightHandSideComputation>
+void SPRKIntegrator<Position, Momentum>::Process(
+    RightHandSideComputation& compute_force,
+    AutonomousRightHandSideComputation& compute_velocity,
+    DoublePrecision<Time> const& t,
+    Time const& h,
+    bool const inverse,
+    not_null<DoublePrecisionVector<Position>*> const q,
+    not_null<DoublePrecisionVector<Momentum>*> const p,
+    not_null<Workspace*> const workspace) const {
+  int const dimension = q->values.size();
+  int const processor_stages = processor_b_.size();
+  std::vector<Quotient<Momentum, Time>>& f = workspace->f_processor_;
+  std::vector<Quotient<Position, Time>>& v = workspace->v_;
+  std::vector<Position>& Δq = workspace->Δq_processor_;
+  std::vector<Momentum>& Δp = workspace->Δp_processor_;
+  // χ⁻¹ drifts backwards to the time of each stage, so the kicks are at the
+  // same times in both directions.
+  double const sign = inverse ? -1.0 : 1.0;
+  auto const kick = [&compute_force, &t, &h, &f, &Δp, dimension, sign, p, q,
+                     this](int const i) {
+    if (processor_b_[i] == 0.0) {
+      return;
+    }
+    compute_force(t.value + (t.error + processor_c_[i] * h), q->values, &f);
+    for (int k = 0; k < dimension; ++k) {
+      Δp[k] = h * (sign * processor_b_[i]) * f[k];
+    }
+    p->Increment(Δp);
+  };
+  auto const drift = [&compute_velocity, &h, &v, &Δq, dimension, sign, p, q,
+                      this](int const i) {
+    if (processor_a_[i] == 0.0) {
+      return;
+    }
+    ComputeVelocities(compute_velocity, p->values, &v);
+    for (int k = 0; k < dimension; ++k) {
+      Δq[k] = h * (sign * processor_a_[i]) * v[k];
+    }
+    q->Increment(Δq);
+  };
+  if (inverse) {
+    for (int i = processor_stages - 1; i >= 0; --i) {
+      drift(i);
+      kick(i);
+    }
+  } else {
+    for (int i = 0; i < processor_stages; ++i) {
+      kick(i);
+      drift(i);
+    }
+  }
+}
+
+template<typename Position, typename Momentum>
+template<typename AutonomousRightHandSideComputation>
+inline void SPRKIntegrator<Position, Momentum>::ComputeVelocities(
+    AutonomousRightHandSideComputation& compute_velocity,
+    std::vector<Momentum> const& p,
+    not_null<std::vector<Quotient<Position, Time>>*> const v) {
+  compute_velocity(p, v);
+}
+
+template<typename Position, typename Momentum>
+inline void SPRKIntegrator<Position, Momentum>::ComputeVelocities(
+    MomentumIsVelocity& compute_velocity,
+    std::vector<Momentum> const& p,
+    not_null<std::vector<Quotient<Position, Time>>*> const v) {
+  *v = p;
+}
+
+template<typename Position, typename Momentum>
+template<typename AutonomousRightHandSideComputation>
+inline void SPRKIntegrator<Position, Momentum>::ComputeStage(
+    AutonomousRightHandSideComputation& compute_velocity,
+    double const a,
+    double const b,
+    Time const& h,
+    std::vector<Position> const& Δqstage_previous,
+    std::vector<Momentum> const& Δpstage_previous,
+    not_null<std::vector<Position>*> const Δqstage_current,
+    not_null<std::vector<Momentum>*> const Δpstage_current,
+    not_null<Workspace*> const workspace) const {
+  int const dimension = workspace->q_stage_.size();
+  std::vector<Position> const& q_last = workspace->q_last_.values;
+  std::vector<Momentum> const& p_last = workspace->p_last_.values;
+  std::vector<Position>& q_stage = workspace->q_stage_;
+  std::vector<Momentum>& p_stage = workspace->p_stage_;
+  std::vector<Quotient<Momentum, Time>> const& f = workspace->f_;
+  std::vector<Quotient<Position, Time>>& v = workspace->v_;
+
+  // Beware, the p/q order matters here, the two computations depend on one
+  // another.
+  for (int k = 0; k < dimension; ++k) {
+    Momentum const Δp = Δpstage_previous[k] + h * b * f[k];
+    p_stage[k] = p_last[k] + Δp;
+    (*Δpstage_current)[k] = Δp;
+  }
+  compute_velocity(p_stage, &v);
+  for (int k = 0; k < dimension; ++k) {
+    Position const Δq = Δqstage_previous[k] + h * a * v[k];
+    q_stage[k] = q_last[k] + Δq;
+    (*Δqstage_current)[k] = Δq;
+  }
+}
+
+template<typename Position, typename Momentum>
+inline void SPRKIntegrator<Position, Momentum>::ComputeStage(
+    MomentumIsVelocity& compute_velocity,
+    double const a,
+    double const b,
+    Time const& h,
+    std::vector<Position> const& Δqstage_previous,
+    std::vector<Momentum> const& Δpstage_previous,
+    not_null<std::vector<Position>*> const Δqstage_current,
+    not_null<std::vector<Momentum>*> const Δpstage_current,
+    not_null<Workspace*> const workspace) const {
+  int const dimension = workspace->q_stage_.size();
+  std::vector<Position> const& q_last = workspace->q_last_.values;
+  std::vector<Momentum> const& p_last = workspace->p_last_.values;
+  std::vector<Position>& q_stage = workspace->q_stage_;
+  std::vector<Momentum>& p_stage = workspace->p_stage_;
+  std::vector<Quotient<Momentum, Time>> const& f = workspace->f_;
+
+  // The position increment of a coordinate only depends on the new momentum of
+  // that coordinate, so both may be computed in the same pass.
+  for (int k = 0; k < dimension; ++k) {
+    Momentum const Δp = Δpstage_previous[k] + h * b * f[k];
+    Momentum const p = p_last[k] + Δp;
+    p_stage[k] = p;
+    (*Δpstage_current)[k] = Δp;
+    Position const Δq = Δqstage_previous[k] + h * a * p;
+    q_stage[k] = q_last[k] + Δq;
+    (*Δqstage_current)[k] = Δq;
+  }
+}
+
 }  // namespace integrators
 }  // namespace principia
@@ -4,6 +4,7 @@
 #include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <string>
 #include <vector>
 
@@ -11,13 +12,16 @@
 #include "glog/logging.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "quantities/elementary_functions.hpp"
 #include "quantities/quantities.hpp"
 #include "quantities/named_quantities.hpp"
+#include "quantities/numbers.hpp"
 #include "testing_utilities/numerical_analysis.hpp"
 #include "testing_utilities/numerics.hpp"
 #include "testing_utilities/statistics.hpp"
 
 using principia::quantities::Abs;
+using principia::quantities::Acceleration;
 using principia::quantities::AngularFrequency;
 using principia::quantities::Energy;
 using principia::quantities::Force;
@@ -28,6 +32,7 @@ using principia::quantities::Pow;
 using principia::quantities::Power;
 using principia::quantities::SIUnit;
 using principia::quantities::Speed;
+using principia::quantities::Sqrt;
 using principia::quantities::Stiffness;
 using principia::quantities::Time;
 using principia::testing_utilities::BidimensionalDatasetMathematicaInput;
@@ -36,6 +41,7 @@ using principia::testing_utilities::ComputeHarmonicOscillatorVelocity;
 using principia::testing_utilities::PearsonProductMomentCorrelationCoefficient;
 using principia::testing_utilities::Slope;
 using testing::AllOf;
+using testing::ElementsAre;
 using testing::Eq;
 using testing::Gt;
 using testing::Lt;
@@ -256,5 +262,641 @@ TEST_F(SPRKTest, Symplecticity) {
                                       Lt(1E-3 * SIUnit<Energy>())));
 }
 
+TEST_F(SPRKTest, Workspace) {
+  parameters_.initial.positions.emplace_back(SIUnit<Length>());
+  parameters_.initial.momenta.emplace_back(Momentum());
+  parameters_.initial.time = Time();
+  parameters_.tmax = 10.0 * SIUnit<Time>();
+  parameters_.Δt = 1.0E-3 * SIUnit<Time>();
+  parameters_.sampling_period = 7;
+  integrator_.Solve(&ComputeHarmonicOscillatorForce,
+                    &ComputeHarmonicOscillatorVelocity,
+                    parameters_, &solution_);
+  std::vector<SPRKIntegrator<Length, Momentum>::SystemState> const expected =
+      solution_;
+
+  // Solve a longer problem first, so that the workspace and the solution are
+  // larger than needed and must be trimmed.
+  SPRKIntegrator<Length, Momentum>::Workspace workspace;
+  std::vector<SPRKIntegrator<Length, Momentum>::SystemState> solution;
+  SPRKIntegrator<Length, Momentum>::Parameters parameters = parameters_;
+  parameters.initial.positions.emplace_back(2.0 * SIUnit<Length>());
+  parameters.initial.momenta.emplace_back(Momentum());
+  parameters.tmax = 20.0 * SIUnit<Time>();
+  integrator_.Solve(&ComputeHarmonicOscillatorForce,
+                    &ComputeHarmonicOscillatorVelocity,
+                    parameters, &solution, &workspace);
+  EXPECT_LT(expected.size(), solution.size());
+
+  for (int i = 0; i < 2; ++i) {
+    integrator_.Solve(&ComputeHarmonicOscillatorForce,
+                      &ComputeHarmonicOscillatorVelocity,
+                      parameters_, &solution, &workspace);
+    ASSERT_EQ(expected.size(), solution.size());
+    for (std::size_t j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(expected[j].time.value, solution[j].time.value);
+      EXPECT_EQ(expected[j].time.error, solution[j].time.error);
+      ASSERT_EQ(1, solution[j].positions.size());
+      ASSERT_EQ(1, solution[j].momenta.size());
+      EXPECT_EQ(expected[j].positions[0].value,
+                solution[j].positions[0].value);
+      EXPECT_EQ(expected[j].positions[0].error,
+                solution[j].positions[0].error);
+      EXPECT_EQ(expected[j].momenta[0].value, solution[j].momenta[0].value);
+      EXPECT_EQ(expected[j].momenta[0].error, solution[j].momenta[0].error);
+    }
+  }
+}
+
+TEST_F(SPRKTest, Sink) {
+  parameters_.initial.positions.emplace_back(SIUnit<Length>());
+  parameters_.initial.momenta.emplace_back(Momentum());
+  parameters_.initial.time = Time();
+  parameters_.tmax = 10.0 * SIUnit<Time>();
+  parameters_.Δt = 1.0E-3 * SIUnit<Time>();
+  parameters_.sampling_period = 7;
+  integrator_.Solve(&ComputeHarmonicOscillatorForce,
+                    &ComputeHarmonicOscillatorVelocity,
+                    parameters_, &solution_);
+
+  SPRKIntegrator<Length, Momentum>::Workspace workspace;
+  std::size_t j = 0;
+  integrator_.SolveWithSink(
+      &ComputeHarmonicOscillatorForce,
+      &ComputeHarmonicOscillatorVelocity,
+      parameters_,
+      [this, &j](DoublePrecision<Time> const& time,
+                 DoublePrecisionVector<Length> const& positions,
+                 DoublePrecisionVector<Momentum> const& momenta) {
+        ASSERT_LT(j, solution_.size());
+        EXPECT_EQ(solution_[j].time.value, time.value);
+        EXPECT_EQ(solution_[j].time.error, time.error);
+        ASSERT_EQ(1, positions.values.size());
+        ASSERT_EQ(1, momenta.values.size());
+        EXPECT_EQ(solution_[j].positions[0].value, positions.values[0]);
+        EXPECT_EQ(solution_[j].positions[0].error, positions.errors[0]);
+        EXPECT_EQ(solution_[j].momenta[0].value, momenta.values[0]);
+        EXPECT_EQ(solution_[j].momenta[0].error, momenta.errors[0]);
+        ++j;
+      },
+      &workspace);
+  EXPECT_EQ(solution_.size(), j);
+}
+
+// Each scheme of the catalogue has its nominal order on a Kepler problem.  The
+// error is measured against a solution computed with a much smaller step.
+TEST_F(SPRKTest, Catalogue) {
+  SPRKIntegrator<Length, Speed> integrator;
+  SPRKIntegrator<Length, Speed>::Parameters parameters;
+  // An orbit of eccentricity 0.3 for μ = 1 m³/s², starting at the periapsis.
+  double const e = 0.3;
+  parameters.initial.positions.emplace_back((1 - e) * SIUnit<Length>());
+  parameters.initial.positions.emplace_back(Length());
+  parameters.initial.momenta.emplace_back(Speed());
+  parameters.initial.momenta.emplace_back(
+      std::sqrt((1 + e) / (1 - e)) * SIUnit<Speed>());
+  parameters.initial.time = Time();
+  parameters.tmax = 4 * SIUnit<Time>();
+  parameters.sampling_period = 0;
+  parameters.tmax_is_exact = true;
+  auto const compute_acceleration =
+      [](Time const& t,
+         std::vector<Length> const& q,
+         not_null<std::vector<Acceleration>*> const result) {
+    double const x = q[0] / SIUnit<Length>();
+    double const y = q[1] / SIUnit<Length>();
+    double const r_squared = x * x + y * y;
+    double const one_over_r_cubed = 1 / (r_squared * std::sqrt(r_squared));
+    (*result)[0] = -x * one_over_r_cubed * SIUnit<Acceleration>();
+    (*result)[1] = -y * one_over_r_cubed * SIUnit<Acceleration>();
+  };
+  auto const compute_velocity =
+      [](std::vector<Speed> const& p,
+         not_null<std::vector<Speed>*> const result) {
+    *result = p;
+  };
+  std::vector<SPRKIntegrator<Length, Speed>::SystemState> solution;
+  auto const final_position_error =
+      [&compute_acceleration, &compute_velocity, &integrator, &parameters,
+       &solution](SPRKIntegrator<Length, Speed>::SystemState const& expected) {
+    integrator.Solve(compute_acceleration,
+                     compute_velocity,
+                     parameters,
+                     &solution);
+    EXPECT_EQ(parameters.tmax, solution.back().time.value);
+    Length const Δx = solution.back().positions[0].value -
+                      expected.positions[0].value;
+    Length const Δy = solution.back().positions[1].value -
+                      expected.positions[1].value;
+    return Sqrt(Δx * Δx + Δy * Δy);
+  };
+
+  integrator.Initialize(
+      integrator.CoefficientsOf(SPRKScheme::kYoshida1990Order8D));
+  parameters.Δt = 0.1 / 32 * SIUnit<Time>();
+  integrator.Solve(compute_acceleration,
+                   compute_velocity,
+                   parameters,
+                   &solution);
+  SPRKIntegrator<Length, Speed>::SystemState const reference = solution.back();
+
+  for (SPRKScheme const scheme :
+           {SPRKScheme::kLeapfrog,
+            SPRKScheme::kMcLachlanAtela1992Order2Optimal,
+            SPRKScheme::kRuth1983,
+            SPRKScheme::kMcLachlanAtela1992Order3Optimal,
+            SPRKScheme::kCandyRozmus1991ForestRuth1990,
+            SPRKScheme::kMcLachlanAtela1992Order4Optimal,
+            SPRKScheme::kBlanesMoan2002SRKN6B,
+            SPRKScheme::kMcLachlanAtela1992Order5Optimal,
+            SPRKScheme::kYoshida1990Order6A,
+            SPRKScheme::kBlanesMoan2002SRKN11B,
+            SPRKScheme::kYoshida1990Order8D}) {
+    SPRKIntegrator<Length, Speed>::Coefficients const& coefficients =
+        integrator.CoefficientsOf(scheme);
+    ASSERT_EQ(2, coefficients.size());
+    ASSERT_EQ(coefficients[0].size(), coefficients[1].size());
+    double a_sum = 0;
+    double b_sum = 0;
+    for (std::size_t i = 0; i < coefficients[0].size(); ++i) {
+      a_sum += coefficients[0][i];
+      b_sum += coefficients[1][i];
+    }
+    EXPECT_THAT(std::abs(a_sum - 1), Lt(1E-14)) << static_cast<int>(scheme);
+    EXPECT_THAT(std::abs(b_sum - 1), Lt(1E-14)) << static_cast<int>(scheme);
+
+    integrator.Initialize(coefficients);
+    parameters.Δt = 0.1 * SIUnit<Time>();
+    Length const error1 = final_position_error(reference);
+    parameters.Δt = 0.05 * SIUnit<Time>();
+    Length const error2 = final_position_error(reference);
+    double const order = std::log2(error1 / error2);
+    LOG(INFO) << "Scheme " << static_cast<int>(scheme) << ": order " << order
+              << ", error " << error2;
+    EXPECT_THAT(order,
+                Gt(SPRKIntegrator<Length, Speed>::OrderOf(scheme) - 0.2))
+        << static_cast<int>(scheme);
+  }
+}
+
+// The processed scheme has its effective order, while its kernel alone only has
+// order 2.
+TEST_F(SPRKTest, Processed) {
+  SPRKIntegrator<Length, Speed> integrator;
+  SPRKIntegrator<Length, Speed>::Parameters parameters;
+  // An orbit of eccentricity 0.3 for μ = 1 m³/s², starting at the periapsis.
+  double const e = 0.3;
+  parameters.initial.positions.emplace_back((1 - e) * SIUnit<Length>());
+  parameters.initial.positions.emplace_back(Length());
+  parameters.initial.momenta.emplace_back(Speed());
+  parameters.initial.momenta.emplace_back(
+      std::sqrt((1 + e) / (1 - e)) * SIUnit<Speed>());
+  parameters.initial.time = Time();
+  parameters.tmax = 4 * SIUnit<Time>();
+  parameters.sampling_period = 0;
+  parameters.tmax_is_exact = true;
+  auto const compute_acceleration =
+      [](Time const& t,
+         std::vector<Length> const& q,
+         not_null<std::vector<Acceleration>*> const result) {
+    double const x = q[0] / SIUnit<Length>();
+    double const y = q[1] / SIUnit<Length>();
+    double const r_squared = x * x + y * y;
+    double const one_over_r_cubed = 1 / (r_squared * std::sqrt(r_squared));
+    (*result)[0] = -x * one_over_r_cubed * SIUnit<Acceleration>();
+    (*result)[1] = -y * one_over_r_cubed * SIUnit<Acceleration>();
+  };
+  auto const compute_velocity =
+      [](std::vector<Speed> const& p,
+         not_null<std::vector<Speed>*> const result) {
+    *result = p;
+  };
+  std::vector<SPRKIntegrator<Length, Speed>::SystemState> solution;
+  auto const final_position_error =
+      [&compute_acceleration, &compute_velocity, &integrator, &parameters,
+       &solution](SPRKIntegrator<Length, Speed>::SystemState const& expected) {
+    integrator.Solve(compute_acceleration,
+                     compute_velocity,
+                     parameters,
+                     &solution);
+    EXPECT_EQ(parameters.tmax, solution.back().time.value);
+    Length const Δx = solution.back().positions[0].value -
+                      expected.positions[0].value;
+    Length const Δy = solution.back().positions[1].value -
+                      expected.positions[1].value;
+    return Sqrt(Δx * Δx + Δy * Δy);
+  };
+
+  integrator.Initialize(
+      integrator.CoefficientsOf(SPRKScheme::kYoshida1990Order8D));
+  parameters.Δt = 0.1 / 32 * SIUnit<Time>();
+  integrator.Solve(compute_acceleration,
+                   compute_velocity,
+                   parameters,
+                   &solution);
+  SPRKIntegrator<Length, Speed>::SystemState const reference = solution.back();
+
+  SPRKScheme const scheme = SPRKScheme::kProcessedOrder6;
+  EXPECT_TRUE(integrator.IsProcessed(scheme));
+  EXPECT_FALSE(integrator.IsProcessed(
+      SPRKScheme::kMcLachlanAtela1992Order5Optimal));
+  SPRKIntegrator<Length, Speed>::Coefficients const& processor =
+      integrator.ProcessorOf(scheme);
+  ASSERT_EQ(2, processor.size());
+  ASSERT_EQ(processor[0].size(), processor[1].size());
+  double a_sum = 0;
+  double b_sum = 0;
+  for (std::size_t i = 0; i < processor[0].size(); ++i) {
+    a_sum += processor[0][i];
+    b_sum += processor[1][i];
+  }
+  EXPECT_THAT(std::abs(a_sum), Lt(1E-15));
+  EXPECT_THAT(std::abs(b_sum), Lt(1E-15));
+
+  integrator.Initialize(scheme);
+  parameters.Δt = 0.1 * SIUnit<Time>();
+  Length const error1 = final_position_error(reference);
+  parameters.Δt = 0.05 * SIUnit<Time>();
+  Length const error2 = final_position_error(reference);
+  double const order = std::log2(error1 / error2);
+  LOG(INFO) << "Processed: order " << order << ", error " << error2;
+  EXPECT_THAT(order,
+              Gt(SPRKIntegrator<Length, Speed>::OrderOf(scheme) - 0.2));
+
+  integrator.Initialize(integrator.CoefficientsOf(scheme));
+  parameters.Δt = 0.1 * SIUnit<Time>();
+  Length const kernel_error1 = final_position_error(reference);
+  parameters.Δt = 0.05 * SIUnit<Time>();
+  Length const kernel_error2 = final_position_error(reference);
+  double const kernel_order = std::log2(kernel_error1 / kernel_error2);
+  LOG(INFO) << "Kernel: order " << kernel_order << ", error "
+            << kernel_error2;
+  EXPECT_THAT(kernel_order, Lt(2.2));
+  EXPECT_THAT(kernel_error2, Gt(100 * error2));
+}
+
+// The processor is applied once to the initial state, and once to each state
+// passed to the sink.
+TEST_F(SPRKTest, ProcessedEvaluations) {
+  SPRKIntegrator<Length, Momentum> integrator;
+  parameters_.initial.positions.emplace_back(SIUnit<Length>());
+  parameters_.initial.momenta.emplace_back(Momentum());
+  parameters_.initial.time = Time();
+  parameters_.tmax = 10.0 * SIUnit<Time>();
+  parameters_.Δt = 1.0 * SIUnit<Time>();
+  parameters_.tmax_is_exact = true;
+  int evaluations = 0;
+  auto const compute_force =
+      [&evaluations](Time const& t,
+                     std::vector<Length> const& q,
+                     not_null<std::vector<Force>*> const result) {
+    ++evaluations;
+    ComputeHarmonicOscillatorForce(t, q, result);
+  };
+
+  // The kernel evaluates the forces 5 times in the first step and 4 times in
+  // the subsequent ones, the processor and its inverse 6 times each.
+  integrator.Initialize(SPRKScheme::kProcessedOrder6);
+  parameters_.sampling_period = 0;
+  integrator.Solve(compute_force,
+                   &ComputeHarmonicOscillatorVelocity,
+                   parameters_,
+                   &solution_);
+  ASSERT_EQ(1, solution_.size());
+  EXPECT_EQ(5 + 9 * 4 + 6 + 6, evaluations);
+  SPRKIntegrator<Length, Momentum>::SystemState const last = solution_.back();
+
+  evaluations = 0;
+  parameters_.sampling_period = 1;
+  integrator.Solve(compute_force,
+                   &ComputeHarmonicOscillatorVelocity,
+                   parameters_,
+                   &solution_);
+  ASSERT_EQ(10, solution_.size());
+  EXPECT_EQ(5 + 9 * 4 + 6 + 10 * 6, evaluations);
+  for (auto const& state : solution_) {
+    EXPECT_THAT(
+        Abs(state.positions[0].value -
+            SIUnit<Length>() *
+                Cos(state.time.value * SIUnit<AngularFrequency>())),
+        Lt(1E-2 * SIUnit<Length>()));
+  }
+  // Processing the sampled states doesn't affect the state of the kernel.
+  EXPECT_EQ(last.positions[0].value, solution_.back().positions[0].value);
+  EXPECT_EQ(last.momenta[0].value, solution_.back().momenta[0].value);
+}
+
+// The first-same-as-last schemes evaluate the forces once per stage in the
+// first step, and one fewer time in the subsequent steps.
+TEST_F(SPRKTest, FirstSameAsLast) {
+  SPRKIntegrator<Length, Momentum> integrator;
+  parameters_.initial.positions.emplace_back(SIUnit<Length>());
+  parameters_.initial.momenta.emplace_back(Momentum());
+  parameters_.initial.time = Time();
+  parameters_.tmax = 10.0 * SIUnit<Time>();
+  parameters_.Δt = 1.0 * SIUnit<Time>();
+  parameters_.sampling_period = 1;
+  parameters_.tmax_is_exact = true;
+  int evaluations = 0;
+  auto const compute_force =
+      [&evaluations](Time const& t,
+                     std::vector<Length> const& q,
+                     not_null<std::vector<Force>*> const result) {
+    ++evaluations;
+    ComputeHarmonicOscillatorForce(t, q, result);
+  };
+
+  integrator.Initialize(
+      integrator.CoefficientsOf(SPRKScheme::kLeapfrog));
+  integrator.Solve(compute_force,
+                   &ComputeHarmonicOscillatorVelocity,
+                   parameters_,
+                   &solution_);
+  EXPECT_EQ(10, solution_.size());
+  EXPECT_EQ(10 + 1, evaluations);
+
+  evaluations = 0;
+  integrator.Initialize(
+      integrator.CoefficientsOf(SPRKScheme::kMcLachlanAtela1992Order2Optimal));
+  integrator.Solve(compute_force,
+                   &ComputeHarmonicOscillatorVelocity,
+                   parameters_,
+                   &solution_);
+  EXPECT_EQ(10, solution_.size());
+  EXPECT_EQ(10 * 2, evaluations);
+}
+
+// The forces are not evaluated at the stages whose momentum weight is 0, so
+// the drift-kick-drift form of the leapfrog evaluates them once per step.
+TEST_F(SPRKTest, ZeroMomentumWeight) {
+  SPRKIntegrator<Length, Momentum> integrator;
+  parameters_.initial.positions.emplace_back(SIUnit<Length>());
+  parameters_.initial.momenta.emplace_back(Momentum());
+  parameters_.initial.time = Time();
+  parameters_.tmax = 10.0 * SIUnit<Time>();
+  parameters_.Δt = 0.1 * SIUnit<Time>();
+  parameters_.sampling_period = 0;
+  parameters_.tmax_is_exact = true;
+  int evaluations = 0;
+  auto const compute_force =
+      [&evaluations](Time const& t,
+                     std::vector<Length> const& q,
+                     not_null<std::vector<Force>*> const result) {
+    ++evaluations;
+    ComputeHarmonicOscillatorForce(t, q, result);
+  };
+
+  integrator.Initialize({{0.5, 0.5}, {0.0, 1.0}});
+  integrator.Solve(compute_force,
+                   &ComputeHarmonicOscillatorVelocity,
+                   parameters_,
+                   &solution_);
+  EXPECT_EQ(100, evaluations);
+  ASSERT_EQ(1, solution_.size());
+  EXPECT_THAT(
+      Abs(solution_[0].positions[0].value -
+          SIUnit<Length>() *
+              Cos(solution_[0].time.value * SIUnit<AngularFrequency>())),
+      Lt(1E-2 * SIUnit<Length>()));
+}
+
+// When the velocities are the momenta, omitting the computation of the
+// velocities yields the same results as copying the momenta.
+TEST_F(SPRKTest, MomentumIsVelocity) {
+  SPRKIntegrator<Length, Speed> integrator;
+  integrator.Initialize(integrator.Order5Optimal());
+  SPRKIntegrator<Length, Speed>::Parameters parameters;
+  parameters.initial.positions.emplace_back(SIUnit<Length>());
+  parameters.initial.positions.emplace_back(-2.0 * SIUnit<Length>());
+  parameters.initial.momenta.emplace_back(Speed());
+  parameters.initial.momenta.emplace_back(0.5 * SIUnit<Speed>());
+  parameters.initial.time = Time();
+  parameters.tmax = 10.0 * SIUnit<Time>();
+  parameters.Δt = 1.0E-3 * SIUnit<Time>();
+  parameters.sampling_period = 7;
+  auto const compute_acceleration =
+      [](Time const& t,
+         std::vector<Length> const& q,
+         not_null<std::vector<Acceleration>*> const result) {
+    for (std::size_t k = 0; k < q.size(); ++k) {
+      (*result)[k] = -q[k] / (SIUnit<Time>() * SIUnit<Time>());
+    }
+  };
+  auto const compute_velocity =
+      [](std::vector<Speed> const& p,
+         not_null<std::vector<Speed>*> const result) {
+    *result = p;
+  };
+
+  std::vector<SPRKIntegrator<Length, Speed>::SystemState> expected;
+  SPRKIntegrator<Length, Speed>::Workspace workspace;
+  integrator.Solve(compute_acceleration,
+                   compute_velocity,
+                   parameters,
+                   &expected,
+                   &workspace);
+
+  std::size_t j = 0;
+  integrator.SolveWithSink(
+      compute_acceleration,
+      parameters,
+      [&expected, &j](DoublePrecision<Time> const& time,
+                      DoublePrecisionVector<Length> const& positions,
+                      DoublePrecisionVector<Speed> const& momenta) {
+        ASSERT_LT(j, expected.size());
+        EXPECT_EQ(expected[j].time.value, time.value);
+        EXPECT_EQ(expected[j].time.error, time.error);
+        ASSERT_EQ(2, positions.values.size());
+        ASSERT_EQ(2, momenta.values.size());
+        for (int k = 0; k < 2; ++k) {
+          EXPECT_EQ(expected[j].positions[k].value, positions.values[k]);
+          EXPECT_EQ(expected[j].positions[k].error, positions.errors[k]);
+          EXPECT_EQ(expected[j].momenta[k].value, momenta.values[k]);
+          EXPECT_EQ(expected[j].momenta[k].error, momenta.errors[k]);
+        }
+        ++j;
+      },
+      &workspace);
+  EXPECT_EQ(expected.size(), j);
+}
+
+// The unrolled steps yield the same results, and evaluate the forces at the
+// same times, as the loop over the coefficients.
+TEST_F(SPRKTest, Unrolled) {
+  parameters_.initial.positions.emplace_back(SIUnit<Length>());
+  parameters_.initial.momenta.emplace_back(Momentum());
+  parameters_.initial.time = Time();
+  parameters_.tmax = 10.0 * SIUnit<Time>();
+  parameters_.Δt = 1.0E-2 * SIUnit<Time>();
+  parameters_.sampling_period = 3;
+  parameters_.tmax_is_exact = true;
+  std::vector<Time> times;
+  auto const compute_force =
+      [&times](Time const& t,
+               std::vector<Length> const& q,
+               not_null<std::vector<Force>*> const result) {
+    times.push_back(t);
+    ComputeHarmonicOscillatorForce(t, q, result);
+  };
+
+  for (SPRKScheme const scheme :
+           {SPRKScheme::kLeapfrog,
+            SPRKScheme::kMcLachlanAtela1992Order5Optimal}) {
+    SPRKIntegrator<Length, Momentum> integrator;
+    std::vector<SPRKIntegrator<Length, Momentum>::SystemState> expected;
+    integrator.Initialize(integrator.CoefficientsOf(scheme));
+    integrator.Solve(compute_force,
+                     &ComputeHarmonicOscillatorVelocity,
+                     parameters_,
+                     &expected);
+    std::vector<Time> const expected_times = times;
+    times.clear();
+
+    integrator.Initialize(scheme);
+    integrator.Solve(compute_force,
+                     &ComputeHarmonicOscillatorVelocity,
+                     parameters_,
+                     &solution_);
+    EXPECT_EQ(expected_times, times);
+    times.clear();
+    ASSERT_EQ(expected.size(), solution_.size());
+    for (std::size_t j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(expected[j].time.value, solution_[j].time.value);
+      EXPECT_EQ(expected[j].positions[0].value,
+                solution_[j].positions[0].value);
+      EXPECT_EQ(expected[j].positions[0].error,
+                solution_[j].positions[0].error);
+      EXPECT_EQ(expected[j].momenta[0].value, solution_[j].momenta[0].value);
+      EXPECT_EQ(expected[j].momenta[0].error, solution_[j].momenta[0].error);
+    }
+  }
+}
+
+// In free motion the positions passed to the force computation are those of
+// the uniform motion at the time at which the force is evaluated.
+TEST_F(SPRKTest, StageTimes) {
+  parameters_.initial.positions.emplace_back(SIUnit<Length>());
+  parameters_.initial.momenta.emplace_back(SIUnit<Momentum>());
+  parameters_.initial.time = Time();
+  parameters_.tmax = 1.0 * SIUnit<Time>();
+  parameters_.Δt = 0.1 * SIUnit<Time>();
+  parameters_.sampling_period = 0;
+  Length max_error;
+  integrator_.Solve(
+      [&max_error](Time const& t,
+                   std::vector<Length> const& q,
+                   not_null<std::vector<Force>*> const result) {
+        max_error = std::max(
+            max_error,
+            Abs(q[0] - (SIUnit<Length>() + t * SIUnit<Speed>())));
+        (*result)[0] = Force();
+      },
+      &ComputeHarmonicOscillatorVelocity,
+      parameters_, &solution_);
+  EXPECT_THAT(max_error, Lt(1E-14 * SIUnit<Length>()));
+}
+
+// The zeros of the position of a harmonic oscillator are located to within the
+// error of the integration, and a terminal event stops the integration.
+TEST_F(SPRKTest, Events) {
+  using Event = SPRKIntegrator<Length, Momentum>::Event;
+  parameters_.initial.positions.emplace_back(SIUnit<Length>());
+  parameters_.initial.momenta.emplace_back(Momentum());
+  parameters_.initial.time = Time();
+  parameters_.tmax = 10.0 * SIUnit<Time>();
+  parameters_.Δt = 0.1 * SIUnit<Time>();
+  parameters_.sampling_period = 1;
+  Time const tolerance = 1E-9 * SIUnit<Time>();
+  std::vector<Event> events(2);
+  events[0].function = [](Time const& t,
+                          std::vector<Length> const& q,
+                          std::vector<Momentum> const& p) {
+    return q[0] / SIUnit<Length>();
+  };
+  events[0].crossing = Event::Crossing::kDecreasing;
+  events[1].function = events[0].function;
+  events[1].crossing = Event::Crossing::kIncreasing;
+
+  SPRKIntegrator<Length, Momentum>::Workspace workspace;
+  std::vector<int> indices;
+  std::vector<Time> times;
+  auto const event_sink = [&indices, &times](
+                              int const index,
+                              DoublePrecision<Time> const& time,
+                              DoublePrecisionVector<Length> const& positions,
+                              DoublePrecisionVector<Momentum> const& momenta) {
+    indices.push_back(index);
+    times.push_back(time.value);
+    EXPECT_THAT(Abs(positions.values[0]), Lt(1E-8 * SIUnit<Length>()));
+  };
+  DoublePrecision<Time> last_time;
+  auto const sink = [&last_time](
+                        DoublePrecision<Time> const& time,
+                        DoublePrecisionVector<Length> const& positions,
+                        DoublePrecisionVector<Momentum> const& momenta) {
+    last_time = time;
+  };
+
+  integrator_.SolveWithEvents(&ComputeHarmonicOscillatorForce,
+                              &ComputeHarmonicOscillatorVelocity,
+                              parameters_,
+                              events,
+                              tolerance,
+                              sink,
+                              event_sink,
+                              &workspace);
+  EXPECT_THAT(indices, ElementsAre(0, 1, 0));
+  ASSERT_EQ(3, times.size());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_THAT(Abs(times[i] - (i + 0.5) * π * SIUnit<Time>()),
+                Lt(1E-8 * SIUnit<Time>()));
+  }
+  EXPECT_THAT(last_time.value, Gt(9.8 * SIUnit<Time>()));
+
+  indices.clear();
+  times.clear();
+  events[1].terminal = true;
+  integrator_.SolveWithEvents(&ComputeHarmonicOscillatorForce,
+                              &ComputeHarmonicOscillatorVelocity,
+                              parameters_,
+                              events,
+                              tolerance,
+                              sink,
+                              event_sink,
+                              &workspace);
+  EXPECT_THAT(indices, ElementsAre(0, 1));
+  ASSERT_EQ(2, times.size());
+  EXPECT_EQ(times[1], last_time.value);
+}
+
+// The compensated summation of a |DoublePrecisionVector| is bitwise identical
+// to that of its elements taken individually.
+TEST_F(SPRKTest, DoublePrecisionVector) {
+  std::vector<DoublePrecision<Length>> elements;
+  for (int k = 0; k < 5; ++k) {
+    elements.emplace_back((k + 1) * 1E10 * SIUnit<Length>());
+  }
+  DoublePrecisionVector<Length> vector;
+  vector.Assign(elements);
+  std::vector<Length> increments(elements.size());
+  for (int step = 0; step < 1000; ++step) {
+    for (std::size_t k = 0; k < elements.size(); ++k) {
+      increments[k] = std::sin(step + k) * 1E-3 * SIUnit<Length>();
+      elements[k].Increment(increments[k]);
+    }
+    vector.Increment(increments);
+  }
+  std::vector<DoublePrecision<Length>> extracted;
+  vector.Extract(&extracted);
+  ASSERT_EQ(elements.size(), extracted.size());
+  for (std::size_t k = 0; k < elements.size(); ++k) {
+    EXPECT_EQ(elements[k].value, vector.values[k]);
+    EXPECT_EQ(elements[k].error, vector.errors[k]);
+    EXPECT_NE(Length(), vector.errors[k]);
+    EXPECT_EQ(elements[k].value, extracted[k].value);
+    EXPECT_EQ(elements[k].error, extracted[k].error);
+  }
+}
+
 }  // namespace integrators
 }  // namespace principia
@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "base/not_null.hpp"
+#include "integrators/symplectic_integrator.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::base::not_null;
+using principia::quantities::Quotient;
+
+namespace principia {
+namespace integrators {
+
+// A mixed-variable symplectic integrator, after Wisdom and Holman (1991), for a
+// Hamiltonian H = H₀ + H₁ where the flow of H₀, e.g., the Keplerian motions of
+// the bodies of a hierarchical system around their primaries, is known exactly,
+// and H₁, e.g., the interactions between the bodies, only depends on the
+// positions and is small compared to H₀.  A step is a composition of the exact
+// flow of H₀ (the drifts) and of the effect of H₁ on the momenta (the kicks).
+// With the composition of the leapfrog the error is O(ε Δt²), where ε is the
+// ratio of H₁ to H₀, instead of O(Δt²) for a splitting in kinetic and
+// potential energies, which permits much larger steps for the same accuracy.
+template<typename Position, typename Momentum>
+class WisdomHolmanIntegrator : public SymplecticIntegrator<Position, Momentum> {
+ public:
+  using Coefficients = typename SymplecticIntegrator<Position,
+                                                     Momentum>::Coefficients;
+  using Parameters = typename SymplecticIntegrator<Position,
+                                                   Momentum>::Parameters;
+  using SystemState = typename SymplecticIntegrator<Position,
+                                                    Momentum>::SystemState;
+
+  WisdomHolmanIntegrator();
+  ~WisdomHolmanIntegrator() override = default;
+
+  // The |coefficients| have the same form as those of |SPRKIntegrator|: the
+  // drift weights first, the kick weights second, and in each stage the kick
+  // comes before the drift.  The schemes of |SPRKScheme| keep their order for
+  // this splitting, except those of Blanes and Moan, which assume that the
+  // kinetic energy is quadratic in the momenta.
+  void Initialize(Coefficients const& coefficients) override;
+
+  // The scratch storage used by |SolveWithSink|, see
+  // |SPRKIntegrator::Workspace|.
+  class Workspace {
+   public:
+    Workspace() = default;
+
+   private:
+    DoublePrecisionVector<Position> q_last_;
+    DoublePrecisionVector<Momentum> p_last_;
+    std::vector<Position> q_stage_;
+    std::vector<Momentum> p_stage_;
+    std::vector<Position> Δq_;
+    std::vector<Momentum> Δp_;
+    std::vector<Quotient<Momentum, Time>> f_;  // Current forces.
+
+    friend class WisdomHolmanIntegrator;
+  };
+
+  // Integrates the system described by |parameters|, and passes each sampled
+  // state to |sink| as |SPRKIntegrator::SolveWithSink| does.  The forces
+  // derived from H₁ are computed by |compute_interaction|, called as:
+  //   compute_interaction(Time const& t,
+  //                       std::vector<Position> const& positions,
+  //                       not_null<std::vector<Quotient<Momentum, Time>>*>
+  //                           const forces);
+  // The flow of H₀ is computed by |advance_unperturbed|, called as:
+  //   advance_unperturbed(Time const& t,
+  //                       Time const& h,
+  //                       not_null<std::vector<Position>*> const positions,
+  //                       not_null<std::vector<Momentum>*> const momenta);
+  // which must replace the state at time |t| in |*positions| and |*momenta| by
+  // the state at time |t| + |h|, where |h| may be negative.
+  template<typename InteractionComputation,
+           typename UnperturbedFlow,
+           typename Sink>
+  void SolveWithSink(InteractionComputation compute_interaction,
+                     UnperturbedFlow advance_unperturbed,
+                     Parameters const& parameters,
+                     Sink sink,
+                     not_null<Workspace*> const workspace) const;
+
+ private:
+  // Advances |workspace->q_last_| and |workspace->p_last_| by a step of length
+  // |h| starting at |tn|.  If |forces_are_current| is true, |workspace->f_|
+  // holds the forces at the beginning of the step.
+  template<typename InteractionComputation, typename UnperturbedFlow>
+  void Step(InteractionComputation& compute_interaction,
+            UnperturbedFlow& advance_unperturbed,
+            DoublePrecision<Time> const& tn,
+            Time const& h,
+            bool const forces_are_current,
+            not_null<Workspace*> const workspace) const;
+
+  int stages_;
+
+  // True if the last drift weight is 0 and the last kick weight isn't, see
+  // |SPRKIntegrator|.
+  bool first_same_as_last_;
+
+  // The drift and kick weights.
+  std::vector<double> a_;
+  std::vector<double> b_;
+
+  // The times of the stages, as fractions of the step.
+  std::vector<double> c_;
+};
+
+}  // namespace integrators
+}  // namespace principia
+
+#include "integrators/wisdom_holman_integrator_body.hpp"
@@ -0,0 +1,141 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "base/tracer.hpp"
+#include "quantities/quantities.hpp"
+
+// Mixed assemblies are not supported by Unity/Mono.
+#include "glog/logging.h"
+
+using principia::base::ScopedTraceEvent;
+
+namespace principia {
+namespace integrators {
+
+template<typename Position, typename Momentum>
+inline WisdomHolmanIntegrator<Position, Momentum>::WisdomHolmanIntegrator()
+    : stages_(0),
+      first_same_as_last_(false) {}
+
+template<typename Position, typename Momentum>
+inline void WisdomHolmanIntegrator<Position, Momentum>::Initialize(
+    Coefficients const& coefficients) {
+  CHECK_EQ(2, coefficients.size());
+  a_ = coefficients[0];
+  b_ = coefficients[1];
+  stages_ = b_.size();
+  CHECK_EQ(stages_, a_.size());
+  first_same_as_last_ = stages_ > 1 && a_.back() == 0.0 && b_.back() != 0.0;
+
+  c_.resize(stages_);
+  c_[0] = 0.0;
+  for (int j = 1; j < stages_; ++j) {
+    c_[j] = c_[j - 1] + a_[j - 1];
+  }
+}
+
+template<typename Position, typename Momentum>
+template<typename InteractionComputation,
+         typename UnperturbedFlow,
+         typename Sink>
+void WisdomHolmanIntegrator<Position, Momentum>::SolveWithSink(
+    InteractionComputation compute_interaction,
+    UnperturbedFlow advance_unperturbed,
+    Parameters const& parameters,
+    Sink sink,
+    not_null<Workspace*> const workspace) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK_LT(0, stages_) << "Not initialized";
+  int const dimension = parameters.initial.positions.size();
+
+  DoublePrecisionVector<Position>& q_last = workspace->q_last_;
+  DoublePrecisionVector<Momentum>& p_last = workspace->p_last_;
+  q_last.Assign(parameters.initial.positions);
+  p_last.Assign(parameters.initial.momenta);
+  int sampling_phase = 0;
+
+  workspace->q_stage_.resize(dimension);
+  workspace->p_stage_.resize(dimension);
+  workspace->Δq_.resize(dimension);
+  workspace->Δp_.resize(dimension);
+  workspace->f_.resize(dimension);
+
+  // The steps are chosen as in |SPRKIntegrator::SolveWithSink|.
+  Time h = parameters.Δt;
+  DoublePrecision<Time> tn = parameters.initial.time;
+  bool at_end = !parameters.tmax_is_exact && parameters.tmax < tn.value + h;
+  bool forces_are_current = false;
+  while (!at_end) {
+    if (parameters.tmax_is_exact) {
+      if (parameters.tmax <= tn.value + 3 * h / 2) {
+        at_end = true;
+        h = (parameters.tmax - tn.value) - tn.error;
+      }
+    } else if (parameters.tmax < tn.value + 2 * h) {
+      at_end = true;
+    }
+
+    Step(compute_interaction,
+         advance_unperturbed,
+         tn,
+         h,
+         forces_are_current,
+         workspace);
+    forces_are_current = first_same_as_last_;
+    tn.Increment(h);
+
+    if (parameters.sampling_period != 0) {
+      if (sampling_phase % parameters.sampling_period == 0) {
+        sink(tn, q_last, p_last);
+      }
+      ++sampling_phase;
+    }
+  }
+  if (parameters.sampling_period == 0) {
+    sink(tn, q_last, p_last);
+  }
+}
+
+template<typename Position, typename Momentum>
+template<typename InteractionComputation, typename UnperturbedFlow>
+void WisdomHolmanIntegrator<Position, Momentum>::Step(
+    InteractionComputation& compute_interaction,
+    UnperturbedFlow& advance_unperturbed,
+    DoublePrecision<Time> const& tn,
+    Time const& h,
+    bool const forces_are_current,
+    not_null<Workspace*> const workspace) const {
+  int const dimension = workspace->q_stage_.size();
+  std::vector<Position>& q_stage = workspace->q_stage_;
+  std::vector<Momentum>& p_stage = workspace->p_stage_;
+  std::vector<Quotient<Momentum, Time>>& f = workspace->f_;
+  q_stage = workspace->q_last_.values;
+  p_stage = workspace->p_last_.values;
+  for (int i = 0; i < stages_; ++i) {
+    Time const t_stage = tn.value + (tn.error + c_[i] * h);
+    if (b_[i] != 0.0) {
+      if (i > 0 || !forces_are_current) {
+        compute_interaction(t_stage, q_stage, &f);
+      }
+      Time const kick = b_[i] * h;
+      for (int k = 0; k < dimension; ++k) {
+        p_stage[k] += kick * f[k];
+      }
+    }
+    if (a_[i] != 0.0) {
+      advance_unperturbed(t_stage, a_[i] * h, &q_stage, &p_stage);
+    }
+  }
+  // The increments over the step are accumulated with compensated summation,
+  // as in |SPRKIntegrator|.
+  for (int k = 0; k < dimension; ++k) {
+    workspace->Δq_[k] = q_stage[k] - workspace->q_last_.values[k];
+    workspace->Δp_[k] = p_stage[k] - workspace->p_last_.values[k];
+  }
+  workspace->q_last_.Increment(workspace->Δq_);
+  workspace->p_last_.Increment(workspace->Δp_);
+}
+
+}  // namespace integrators
+}  // namespace principia
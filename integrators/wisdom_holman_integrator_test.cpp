@@ -0,0 +1,173 @@
+﻿#include "integrators/wisdom_holman_integrator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+
+using principia::quantities::Abs;
+using principia::quantities::Acceleration;
+using principia::quantities::AngularFrequency;
+using principia::quantities::Cos;
+using principia::quantities::Length;
+using principia::quantities::Sin;
+using principia::quantities::Speed;
+using principia::quantities::Time;
+using principia::si::Metre;
+using principia::si::Radian;
+using principia::si::Second;
+using testing::AllOf;
+using testing::Gt;
+using testing::Lt;
+
+namespace principia {
+namespace integrators {
+
+// The harmonic oscillator with H₀ = p² / 2 + ω² q² / 2 and H₁ = ε ω² q² / 2,
+// whose frequency is ω √(1 + ε).
+class WisdomHolmanIntegratorTest : public testing::Test {
+ protected:
+  WisdomHolmanIntegratorTest() : ω_(1 * Radian / Second) {
+    parameters_.initial.positions.emplace_back(1 * Metre);
+    parameters_.initial.momenta.emplace_back(0 * Metre / Second);
+    parameters_.initial.time = Time();
+    parameters_.tmax = 1000 * Second;
+    parameters_.sampling_period = 1;
+  }
+
+  // Returns the largest error on the position over the integration, with the
+  // given |scheme|, step |Δt| and ratio |ε|.
+  Length MaximumError(SPRKScheme const scheme,
+                      Time const& Δt,
+                      double const ε) {
+    integrator_.Initialize(sprk_.CoefficientsOf(scheme));
+    parameters_.Δt = Δt;
+    AngularFrequency const ω = ω_;
+    AngularFrequency const Ω = ω_ * std::sqrt(1 + ε);
+    Length error;
+    integrator_.SolveWithSink(
+        [ω, ε](Time const& t,
+               std::vector<Length> const& q,
+               not_null<std::vector<Acceleration>*> const result) {
+          (*result)[0] = -ε * ω * ω * q[0] / (Radian * Radian);
+        },
+        [ω](Time const& t,
+            Time const& h,
+            not_null<std::vector<Length>*> const q,
+            not_null<std::vector<Speed>*> const p) {
+          Length const q0 = (*q)[0];
+          Speed const p0 = (*p)[0];
+          (*q)[0] = q0 * Cos(ω * h) + p0 * Sin(ω * h) * Radian / ω;
+          (*p)[0] = p0 * Cos(ω * h) - q0 * Sin(ω * h) * ω / Radian;
+        },
+        parameters_,
+        [Ω, &error](DoublePrecision<Time> const& t,
+                    DoublePrecisionVector<Length> const& q,
+                    DoublePrecisionVector<Speed> const& p) {
+          error = std::max(error,
+                           Abs(q.values[0] - 1 * Metre * Cos(Ω * t.value)));
+        },
+        &workspace_);
+    return error;
+  }
+
+  AngularFrequency const ω_;
+  SPRKIntegrator<Length, Speed> sprk_;
+  WisdomHolmanIntegrator<Length, Speed> integrator_;
+  WisdomHolmanIntegrator<Length, Speed>::Parameters parameters_;
+  WisdomHolmanIntegrator<Length, Speed>::Workspace workspace_;
+};
+
+// Without perturbation the drifts are exact, whatever the step.
+TEST_F(WisdomHolmanIntegratorTest, Unperturbed) {
+  EXPECT_THAT(MaximumError(SPRKScheme::kLeapfrog, 2 * Second, 0),
+              Lt(1E-12 * Metre));
+}
+
+// The error decreases at least as fast as ε, and is proportional to Δt² with
+// the leapfrog and to Δt⁴ with the order 4 scheme.  It is much smaller than
+// that of the leapfrog applied to the splitting in kinetic and potential
+// energies.
+TEST_F(WisdomHolmanIntegratorTest, Convergence) {
+  Length const leapfrog =
+      MaximumError(SPRKScheme::kLeapfrog, 0.1 * Second, 1E-3);
+  EXPECT_THAT(leapfrog, AllOf(Gt(1E-10 * Metre), Lt(1E-6 * Metre)));
+  EXPECT_THAT(
+      leapfrog /
+          MaximumError(SPRKScheme::kLeapfrog, 0.1 * Second, 1E-4),
+      Gt(9.0));
+  EXPECT_THAT(
+      leapfrog /
+          MaximumError(SPRKScheme::kLeapfrog, 0.05 * Second, 1E-3),
+      AllOf(Gt(3.9), Lt(4.1)));
+  Length const order_4 = MaximumError(
+      SPRKScheme::kCandyRozmus1991ForestRuth1990, 0.2 * Second, 1E-3);
+  EXPECT_THAT(
+      order_4 /
+          MaximumError(
+              SPRKScheme::kCandyRozmus1991ForestRuth1990, 0.1 * Second, 1E-3),
+      AllOf(Gt(15.0), Lt(17.0)));
+
+  AngularFrequency const Ω = ω_ * std::sqrt(1 + 1E-3);
+  SPRKIntegrator<Length, Speed>::Workspace sprk_workspace;
+  sprk_.Initialize(sprk_.CoefficientsOf(SPRKScheme::kLeapfrog));
+  parameters_.Δt = 0.1 * Second;
+  Length sprk_error;
+  sprk_.SolveWithSink(
+      [Ω](Time const& t,
+          std::vector<Length> const& q,
+          not_null<std::vector<Acceleration>*> const result) {
+        (*result)[0] = -Ω * Ω * q[0] / (Radian * Radian);
+      },
+      parameters_,
+      [Ω, &sprk_error](DoublePrecision<Time> const& t,
+                       DoublePrecisionVector<Length> const& q,
+                       DoublePrecisionVector<Speed> const& p) {
+        sprk_error = std::max(
+            sprk_error, Abs(q.values[0] - 1 * Metre * Cos(Ω * t.value)));
+      },
+      &sprk_workspace);
+  EXPECT_THAT(sprk_error, Gt(1000 * leapfrog));
+}
+
+TEST_F(WisdomHolmanIntegratorTest, ExactTMax) {
+  parameters_.tmax = 10 * Second;
+  parameters_.tmax_is_exact = true;
+  integrator_.Initialize(sprk_.CoefficientsOf(SPRKScheme::kLeapfrog));
+  parameters_.Δt = (1.0 / 3.000001) * Second;
+  parameters_.sampling_period = 0;
+  Time last_time;
+  int calls = 0;
+  integrator_.SolveWithSink(
+      [](Time const& t,
+         std::vector<Length> const& q,
+         not_null<std::vector<Acceleration>*> const result) {
+        (*result)[0] = Acceleration();
+      },
+      [](Time const& t,
+         Time const& h,
+         not_null<std::vector<Length>*> const q,
+         not_null<std::vector<Speed>*> const p) {
+        (*q)[0] += h * (*p)[0];
+      },
+      parameters_,
+      [&last_time, &calls](DoublePrecision<Time> const& t,
+                           DoublePrecisionVector<Length> const& q,
+                           DoublePrecisionVector<Speed> const& p) {
+        last_time = t.value;
+        ++calls;
+      },
+      &workspace_);
+  EXPECT_EQ(1, calls);
+  EXPECT_EQ(parameters_.tmax, last_time);
+}
+
+}  // namespace integrators
+}  // namespace principia
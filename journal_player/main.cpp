@@ -0,0 +1,57 @@
+// .\Release\journal_player.exe <journal>
+// Replays a journal written by |principia__StartJournaling| and prints the
+// duration of the calls to each function of the C interface.  This makes it
+// possible to profile a session outside of the game, e.g., under a sampling
+// profiler.  The files read by the journal, e.g., by
+// |principia__ReadPluginFromFile|, must be available at the same paths.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+
+#include "glog/logging.h"
+#include "ksp_plugin/journal.hpp"
+
+using principia::ksp_plugin::Player;
+
+namespace {
+
+double Milliseconds(Player::Clock::duration const& duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}  // namespace
+
+int main(int argc, char const* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  if (argc != 2) {
+    std::fprintf(stderr, "Usage: %s <journal>\n", argv[0]);
+    return 1;
+  }
+  std::int64_t entries = 0;
+  Player::Clock::duration total = Player::Clock::duration::zero();
+  {
+    Player player(argv[1]);
+    while (player.Play()) {
+      ++entries;
+    }
+    std::printf("%-40s %10s %14s %14s %14s\n",
+                "Function", "Calls", "Total (ms)", "Mean (ms)", "Max (ms)");
+    for (auto const& pair : player.statistics()) {
+      Player::Statistics const& statistics = pair.second;
+      std::printf("%-40s %10lld %14.3f %14.6f %14.6f\n",
+                  pair.first.c_str(),
+                  static_cast<long long>(statistics.calls),  // NOLINT
+                  Milliseconds(statistics.total),
+                  Milliseconds(statistics.total) / statistics.calls,
+                  Milliseconds(statistics.maximum));
+      total += statistics.total;
+    }
+  }
+  std::printf("%lld entries replayed in %.3f ms\n",
+              static_cast<long long>(entries),  // NOLINT
+              Milliseconds(total));
+  return 0;
+}
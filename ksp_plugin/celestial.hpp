@@ -1,11 +1,13 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 
 #include "base/not_null.hpp"
 #include "ksp_plugin/frames.hpp"
 #include "physics/body.hpp"
 #include "physics/degrees_of_freedom.hpp"
+#include "physics/ephemeris_file.hpp"
 #include "physics/massive_body.hpp"
 #include "physics/trajectory.hpp"
 #include "quantities/named_quantities.hpp"
@@ -14,6 +16,7 @@
 using principia::base::not_null;
 using principia::physics::Body;
 using principia::physics::DegreesOfFreedom;
+using principia::physics::EphemerisFile;
 using principia::physics::MassiveBody;
 using principia::physics::Trajectory;
 using principia::quantities::GravitationalParameter;
@@ -32,6 +35,10 @@ class Celestial {
   // True if, and only if, |history_| is not null.
   bool is_initialized() const;
 
+  // Returns an estimate of the memory used by this celestial, its body, its
+  // history and its prolongation, in bytes.
+  std::int64_t MemoryUsage() const;
+
   MassiveBody const& body() const;
   bool has_parent() const;
   Celestial const& parent() const;
@@ -52,11 +59,27 @@ class Celestial {
       Instant const& time,
       DegreesOfFreedom<Barycentric> const& degrees_of_freedom);
 
-  // Deletes the |prolongation_| and forks a new one at |time|.
+  // Makes the |prolongation_| a fork of the history at |time|, reusing it, see
+  // |Trajectory::ResetFork|.
   void ResetProlongation(Instant const& time);
 
+  // From now on, the history is evaluated before its first point from the body
+  // |index| of |*ephemeris_file|, which must outlive this object, so that it
+  // only needs to keep its recent points; see
+  // |Trajectory::set_past_evaluator|.  A null |ephemeris_file| restores the
+  // default behaviour.  Requires |is_initialized()|.
+  void set_ephemeris_file(
+      EphemerisFile<Barycentric> const* const ephemeris_file,
+      std::size_t const index);
+
   // The celestial must satisfy |is_initialized()|.
   void WriteToMessage(not_null<serialization::Celestial*> const message) const;
+  // Same as |WriteToMessage|, except that the history is written as an
+  // increment over its points at or before |since|, see
+  // |Trajectory::WriteIncrementToMessage|.
+  void WriteIncrementToMessage(
+      Instant const& since,
+      not_null<serialization::Celestial*> const message) const;
   // NOTE(egg): This should return a |not_null|, but we can't do that until
   // |not_null<std::unique_ptr<T>>| is convertible to |std::unique_ptr<T>|, and
   // that requires a VS 2015 feature (rvalue references for |*this|).
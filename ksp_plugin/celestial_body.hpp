@@ -18,6 +18,16 @@ inline bool Celestial::is_initialized() const {
   return initialized;
 }
 
+inline std::int64_t Celestial::MemoryUsage() const {
+  // The body may be oblate, in which case this slightly underestimates its
+  // size.
+  std::int64_t usage = sizeof(Celestial) + sizeof(MassiveBody);
+  if (history_ != nullptr) {
+    usage += history_->MemoryUsage();
+  }
+  return usage;
+}
+
 inline MassiveBody const& Celestial::body() const {
   return *body_;
 }
@@ -63,8 +73,22 @@ inline void Celestial::CreateHistoryAndForkProlongation(
 }
 
 inline void Celestial::ResetProlongation(Instant const& time) {
-  history_->DeleteFork(&prolongation_);
-  prolongation_ = history_->NewFork(time);
+  history_->ResetFork(prolongation_, time);
+}
+
+inline void Celestial::set_ephemeris_file(
+    EphemerisFile<Barycentric> const* const ephemeris_file,
+    std::size_t const index) {
+  CHECK(is_initialized());
+  if (ephemeris_file == nullptr) {
+    history_->set_past_evaluator(nullptr);
+  } else {
+    history_->set_past_evaluator([ephemeris_file, index](Instant const& time) {
+      return DegreesOfFreedom<Barycentric>(
+          ephemeris_file->EvaluatePosition(index, time),
+          ephemeris_file->EvaluateVelocity(index, time));
+    });
+  }
 }
 
 inline void Celestial::WriteToMessage(
@@ -77,6 +101,18 @@ inline void Celestial::WriteToMessage(
       message->mutable_history_and_prolongation()->mutable_prolongation());
 }
 
+inline void Celestial::WriteIncrementToMessage(
+    Instant const& since,
+    not_null<serialization::Celestial*> const message) const {
+  CHECK(is_initialized());
+  body_->WriteToMessage(message->mutable_body());
+  history_->WriteIncrementToMessage(
+      since,
+      message->mutable_history_and_prolongation()->mutable_history());
+  prolongation_->WritePointerToMessage(
+      message->mutable_history_and_prolongation()->mutable_prolongation());
+}
+
 inline std::unique_ptr<Celestial> Celestial::ReadFromMessage(
     serialization::Celestial const& message) {
   auto celestial =
@@ -0,0 +1,81 @@
+#include "ksp_plugin/command_queue.hpp"
+
+#include <utility>
+
+#include "base/tracer.hpp"
+#include "glog/logging.h"
+
+using principia::base::ScopedTraceEvent;
+
+namespace principia {
+namespace ksp_plugin {
+
+CommandQueue::CommandQueue(not_null<Plugin*> const plugin,
+                           std::int64_t const capacity)
+    : plugin_(plugin),
+      capacity_(capacity),
+      commands_(capacity) {
+  simulation_ = std::thread(&CommandQueue::ExecuteCommands, this);
+}
+
+CommandQueue::~CommandQueue() {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    shutdown_ = true;
+    has_commands_.notify_one();
+  }
+  simulation_.join();
+}
+
+void CommandQueue::Enqueue(Command command) {
+  std::int64_t const pushed = commands_.pushed();
+  {
+    // Wait until there is room for |command|.  Fewer than |capacity_| commands
+    // are pending once they have been executed, hence popped.
+    std::unique_lock<std::mutex> l(lock_);
+    executed_changed_.wait(l, [this, pushed]() {
+      return pushed - executed_ < capacity_;
+    });
+  }
+  CHECK(commands_.TryPush(std::move(command)));
+  // Notifying under the lock ensures that the simulation thread either sees
+  // the command before it waits, or is waiting and gets the notification.
+  std::lock_guard<std::mutex> l(lock_);
+  has_commands_.notify_one();
+}
+
+void CommandQueue::Drain() {
+  std::int64_t const pushed = commands_.pushed();
+  std::unique_lock<std::mutex> l(lock_);
+  executed_changed_.wait(l, [this, pushed]() { return executed_ >= pushed; });
+}
+
+void CommandQueue::ExecuteCommands() {
+  Command command;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> l(lock_);
+      has_commands_.wait(l, [this]() {
+        return shutdown_ || commands_.popped() < commands_.pushed();
+      });
+      // The pending commands are executed before shutting down.
+      if (commands_.popped() == commands_.pushed()) {
+        return;
+      }
+    }
+    CHECK(commands_.TryPop(&command));
+    {
+      ScopedTraceEvent const trace_event("CommandQueue::Command");
+      command(plugin_);
+    }
+    command = nullptr;
+    {
+      std::lock_guard<std::mutex> l(lock_);
+      ++executed_;
+    }
+    executed_changed_.notify_all();
+  }
+}
+
+}  // namespace ksp_plugin
+}  // namespace principia
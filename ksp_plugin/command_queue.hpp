@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "base/not_null.hpp"
+#include "base/spsc_queue.hpp"
+#include "ksp_plugin/plugin.hpp"
+
+using principia::base::not_null;
+using principia::base::SPSCQueue;
+
+namespace principia {
+namespace ksp_plugin {
+
+// Executes commands on a |Plugin| on a dedicated simulation thread, so that
+// the game thread only pays for an enqueue, e.g., for |AdvanceTime|.  While
+// commands are pending the simulation thread has exclusive use of the plugin:
+// the game thread must call |Drain| before it uses the plugin directly.  The
+// commands are passed through an |SPSCQueue|; |lock_| is only taken to put
+// the simulation thread to sleep when there is nothing to execute, and to
+// wake up the game thread when it waits.  All the public functions must be
+// called from the same thread, the game thread.  The plugin is not owned.
+class CommandQueue {
+ public:
+  using Command = std::function<void(not_null<Plugin*> const plugin)>;
+
+  // |capacity| is the number of commands that may be pending; |Enqueue| waits
+  // if there are more.
+  CommandQueue(not_null<Plugin*> const plugin, std::int64_t const capacity);
+
+  // Executes the pending commands and joins the simulation thread.
+  ~CommandQueue();
+
+  CommandQueue(CommandQueue const&) = delete;
+  CommandQueue& operator=(CommandQueue const&) = delete;
+
+  // Enqueues |command| for execution on the simulation thread, after the
+  // commands enqueued before it.
+  void Enqueue(Command command);
+
+  // Returns once the commands enqueued so far have been executed.
+  void Drain();
+
+ private:
+  // The body of the simulation thread.
+  void ExecuteCommands();
+
+  not_null<Plugin*> const plugin_;
+  std::int64_t const capacity_;
+  SPSCQueue<Command> commands_;
+
+  std::mutex lock_;
+  // Notified by the game thread when it enqueues a command or shuts down.
+  std::condition_variable has_commands_;
+  // Notified by the simulation thread when |executed_| changes.
+  std::condition_variable executed_changed_;
+  // The number of commands whose execution is complete.  Guarded by |lock_|.
+  std::int64_t executed_ = 0;
+  // Guarded by |lock_|.
+  bool shutdown_ = false;
+
+  std::thread simulation_;
+};
+
+}  // namespace ksp_plugin
+}  // namespace principia
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "base/not_null.hpp"
+#include "geometry/named_quantities.hpp"
+#include "ksp_plugin/frames.hpp"
+#include "physics/degrees_of_freedom.hpp"
+#include "physics/ephemeris.hpp"
+#include "physics/massless_body.hpp"
+#include "physics/n_body_system.hpp"
+#include "physics/trajectory.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::base::not_null;
+using principia::geometry::Instant;
+using principia::geometry::Vector;
+using principia::integrators::SymplecticIntegrator;
+using principia::physics::DegreesOfFreedom;
+using principia::physics::Ephemeris;
+using principia::physics::MasslessBody;
+using principia::physics::NBodySystem;
+using principia::physics::Trajectory;
+using principia::quantities::Acceleration;
+using principia::quantities::Length;
+using principia::quantities::Quotient;
+using principia::quantities::Speed;
+using principia::quantities::Time;
+
+namespace principia {
+namespace ksp_plugin {
+
+// A planned manoeuvre: an intrinsic acceleration which is an affine function
+// of time, from |initial_time| to |initial_time + duration|.
+struct Burn {
+  Instant initial_time;
+  Time duration;
+  // The acceleration at |initial_time|, and its derivative, e.g., to account
+  // for the decreasing mass of the vessel.
+  Vector<Acceleration, Barycentric> acceleration;
+  Vector<Quotient<Acceleration, Time>, Barycentric> jerk;
+};
+
+// The planned trajectory of a vessel from a given state, made of an ordered
+// list of burns separated by coasts.  Each coast and each burn is a segment,
+// which is a fork of the previous segment at its last point, so that the
+// segments 2 i and 2 i + 1 are the coast before the burn i and that burn, and
+// the last segment is the coast after the last burn, up to the final time.
+// The segments are integrated as soon as the flight plan is edited, and only
+// the segments that follow the edited burn are integrated again: the earlier
+// ones are kept.  This makes it possible to edit a burn at each frame.
+class FlightPlan {
+ public:
+  // Creates a flight plan without burns from the |initial_degrees_of_freedom|
+  // at |initial_time| to |final_time|.  The vessel is integrated in the field
+  // of the |ephemeris|, which must cover |initial_time|, with the |integrator|
+  // and the step |Δt|.  The |integrator| must outlive this object.
+  FlightPlan(Instant const& initial_time,
+             DegreesOfFreedom<Barycentric> const& initial_degrees_of_freedom,
+             Instant const& final_time,
+             not_null<std::unique_ptr<Ephemeris<Barycentric>>> ephemeris,
+             SymplecticIntegrator<Length, Speed> const& integrator,
+             Time const& Δt);
+  ~FlightPlan() = default;
+
+  FlightPlan(FlightPlan const&) = delete;
+  FlightPlan& operator=(FlightPlan const&) = delete;
+
+  Instant const& initial_time() const;
+  Instant const& final_time() const;
+
+  int number_of_burns() const;
+  // |index| must be in [0, number_of_burns()[.
+  Burn const& burn(int const index) const;
+
+  // Appends a |burn|, which must start after the end of the last burn, or at
+  // or after |initial_time()|, and end at or before |final_time()|.  Only the
+  // last coast is integrated again.
+  void AppendBurn(Burn const& burn);
+  // Replaces the burn at |index| with |burn|, which must start at or after the
+  // end of the previous burn, or at or after |initial_time()|, and end at or
+  // before the start of the next burn, or at or before |final_time()|.  If the
+  // initial time of the burn is unchanged, e.g., because only its acceleration
+  // was edited, the segments from the burn onward are integrated again;
+  // otherwise, the segments from the coast before it.
+  void ReplaceBurn(int const index, Burn const& burn);
+  // There must be at least one burn.
+  void RemoveLastBurn();
+  // |final_time| must be at or after the end of the last burn, or after
+  // |initial_time()|.  Only the last coast is integrated again.
+  void SetFinalTime(Instant const& final_time);
+
+  // The number of segments is |2 * number_of_burns() + 1|.  |index| must be
+  // in [0, number_of_segments()[.
+  int number_of_segments() const;
+  Trajectory<Barycentric> const& segment(int const index) const;
+
+  // Detaches the observers of the segments, see
+  // |Trajectory::PrepareForReclaim|.
+  void PrepareForReclaim();
+
+ private:
+  // The time at which the segment |index| ends.
+  Instant SegmentFinalTime(int const index) const;
+
+  // Deletes the segments from |index| onward.
+  void DeleteSegmentsFrom(int const index);
+
+  // Forks and integrates the missing segments.
+  void IntegrateSegments();
+
+  Instant const initial_time_;
+  Instant final_time_;
+  std::vector<Burn> burns_;
+
+  not_null<std::unique_ptr<Ephemeris<Barycentric>>> const ephemeris_;
+  SymplecticIntegrator<Length, Speed> const& integrator_;
+  Time const Δt_;
+  NBodySystem<Barycentric> n_body_system_;
+
+  MasslessBody const body_;
+  // A single point, the initial state, from which the first segment is forked.
+  Trajectory<Barycentric> root_;
+  // Owned by their parents, the previous segment or |root_|.
+  std::vector<not_null<Trajectory<Barycentric>*>> segments_;
+};
+
+}  // namespace ksp_plugin
+}  // namespace principia
+
+#include "ksp_plugin/flight_plan_body.hpp"
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "ksp_plugin/flight_plan.hpp"
+
+namespace principia {
+namespace ksp_plugin {
+
+inline FlightPlan::FlightPlan(
+    Instant const& initial_time,
+    DegreesOfFreedom<Barycentric> const& initial_degrees_of_freedom,
+    Instant const& final_time,
+    not_null<std::unique_ptr<Ephemeris<Barycentric>>> ephemeris,
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    Time const& Δt)
+    : initial_time_(initial_time),
+      final_time_(final_time),
+      ephemeris_(std::move(ephemeris)),
+      integrator_(integrator),
+      Δt_(Δt),
+      body_(),
+      root_(&body_) {
+  CHECK_LT(initial_time_, final_time_);
+  CHECK_LE(ephemeris_->t_min(), initial_time_);
+  root_.Append(initial_time_, initial_degrees_of_freedom);
+  IntegrateSegments();
+}
+
+inline Instant const& FlightPlan::initial_time() const {
+  return initial_time_;
+}
+
+inline Instant const& FlightPlan::final_time() const {
+  return final_time_;
+}
+
+inline int FlightPlan::number_of_burns() const {
+  return static_cast<int>(burns_.size());
+}
+
+inline Burn const& FlightPlan::burn(int const index) const {
+  CHECK_LE(0, index);
+  CHECK_LT(index, number_of_burns());
+  return burns_[index];
+}
+
+inline void FlightPlan::AppendBurn(Burn const& burn) {
+  CHECK_LE(burns_.empty() ? initial_time_
+                          : burns_.back().initial_time +
+                                burns_.back().duration,
+           burn.initial_time);
+  CHECK_LE(burn.initial_time + burn.duration, final_time_);
+  DeleteSegmentsFrom(2 * number_of_burns());
+  burns_.push_back(burn);
+  IntegrateSegments();
+}
+
+inline void FlightPlan::ReplaceBurn(int const index, Burn const& burn) {
+  CHECK_LE(0, index);
+  CHECK_LT(index, number_of_burns());
+  CHECK_LE(index == 0 ? initial_time_
+                      : burns_[index - 1].initial_time +
+                            burns_[index - 1].duration,
+           burn.initial_time);
+  CHECK_LE(burn.initial_time + burn.duration,
+           index == number_of_burns() - 1 ? final_time_
+                                          : burns_[index + 1].initial_time);
+  // The coast before the burn ends where the burn starts.
+  DeleteSegmentsFrom(burn.initial_time == burns_[index].initial_time
+                         ? 2 * index + 1
+                         : 2 * index);
+  burns_[index] = burn;
+  IntegrateSegments();
+}
+
+inline void FlightPlan::RemoveLastBurn() {
+  CHECK(!burns_.empty());
+  DeleteSegmentsFrom(2 * number_of_burns() - 2);
+  burns_.pop_back();
+  IntegrateSegments();
+}
+
+inline void FlightPlan::SetFinalTime(Instant const& final_time) {
+  if (burns_.empty()) {
+    CHECK_LT(initial_time_, final_time);
+  } else {
+    CHECK_LE(burns_.back().initial_time + burns_.back().duration, final_time);
+  }
+  DeleteSegmentsFrom(2 * number_of_burns());
+  final_time_ = final_time;
+  IntegrateSegments();
+}
+
+inline int FlightPlan::number_of_segments() const {
+  return static_cast<int>(segments_.size());
+}
+
+inline Trajectory<Barycentric> const& FlightPlan::segment(
+    int const index) const {
+  CHECK_LE(0, index);
+  CHECK_LT(index, number_of_segments());
+  return *segments_[index];
+}
+
+inline void FlightPlan::PrepareForReclaim() {
+  root_.PrepareForReclaim();
+}
+
+inline Instant FlightPlan::SegmentFinalTime(int const index) const {
+  int const burn_index = index / 2;
+  if (index % 2 == 1) {
+    return burns_[burn_index].initial_time + burns_[burn_index].duration;
+  } else if (burn_index < number_of_burns()) {
+    return burns_[burn_index].initial_time;
+  } else {
+    return final_time_;
+  }
+}
+
+inline void FlightPlan::DeleteSegmentsFrom(int const index) {
+  if (index >= number_of_segments()) {
+    return;
+  }
+  // Deleting a fork deletes its descendants.
+  Trajectory<Barycentric>* segment = segments_[index];
+  if (index == 0) {
+    root_.DeleteFork(&segment);
+  } else {
+    segments_[index - 1]->DeleteFork(&segment);
+  }
+  segments_.erase(segments_.begin() + index, segments_.end());
+}
+
+inline void FlightPlan::IntegrateSegments() {
+  for (int index = number_of_segments();
+       index < 2 * number_of_burns() + 1;
+       ++index) {
+    Trajectory<Barycentric>& parent =
+        index == 0 ? root_ : *segments_[index - 1];
+    not_null<Trajectory<Barycentric>*> const segment =
+        parent.NewFork(parent.last().time());
+    segments_.push_back(segment);
+    if (index % 2 == 1) {
+      Burn const& burn = burns_[index / 2];
+      segment->set_intrinsic_acceleration(
+          Trajectory<Barycentric>::AffineIntrinsicAcceleration{
+              burn.initial_time, burn.acceleration, burn.jerk});
+    }
+    // A segment of zero duration, e.g., the coast between consecutive burns,
+    // is just the fork point.
+    Instant const tmax = SegmentFinalTime(index);
+    if (tmax > segment->last().time()) {
+      n_body_system_.IntegrateMasslessBodies(integrator_,
+                                             ephemeris_.get(),
+                                             tmax,
+                                             Δt_,
+                                             1,     // sampling_period
+                                             true,  // tmax_is_exact
+                                             {segment});
+    }
+  }
+}
+
+}  // namespace ksp_plugin
+}  // namespace principia
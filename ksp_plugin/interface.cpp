@@ -1,23 +1,69 @@
 #include "ksp_plugin/interface.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "base/async_logger.hpp"
+#include "base/call_statistics.hpp"
+#include "base/cpu_features.hpp"
 #include "base/macros.hpp"
 #include "base/not_null.hpp"
+#include "base/thread_pool.hpp"
+#include "base/tracer.hpp"
 #include "base/version.hpp"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "ksp_plugin/command_queue.hpp"
+#include "ksp_plugin/journal.hpp"
+#include "ksp_plugin/kernel_tuning.hpp"
 #include "ksp_plugin/part.hpp"
 
+#if PRINCIPIA_TRACK_ALLOCATIONS
+#include "base/allocation_hooks.hpp"
+#endif
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::io::IstreamInputStream;
+using google::protobuf::io::OstreamOutputStream;
+using principia::base::AsyncLogger;
+using principia::base::CallStatistics;
+using principia::base::CPUFeatures;
+using principia::base::DetectedCPUFeatures;
 using principia::base::make_not_null_unique;
+using principia::base::ScopedCallTimer;
+using principia::base::ThreadPool;
+using principia::base::Tracer;
+using principia::base::VectorInstructionSet;
 using principia::geometry::Displacement;
 using principia::ksp_plugin::AliceSun;
+using principia::ksp_plugin::CommandQueue;
+using principia::ksp_plugin::GUID;
+using principia::ksp_plugin::Index;
+using principia::ksp_plugin::Journal;
+using principia::ksp_plugin::KernelConfiguration;
 using principia::ksp_plugin::LineSegment;
 using principia::ksp_plugin::Part;
 using principia::ksp_plugin::PartId;
+using principia::ksp_plugin::ReadOrTuneKernelConfiguration;
 using principia::ksp_plugin::RenderedTrajectory;
+using principia::ksp_plugin::SerializeKSPPart;
+using principia::ksp_plugin::SerializePointer;
+using principia::ksp_plugin::SerializeQP;
+using principia::ksp_plugin::SerializeXYZ;
 using principia::ksp_plugin::World;
 using principia::quantities::Pow;
+using principia::serialization::JournalEntry;
+using principia::serialization::PluginRecord;
 using principia::si::Degree;
 using principia::si::Metre;
 using principia::si::Second;
@@ -25,6 +71,39 @@ using principia::si::Tonne;
 
 namespace {
 
+// The size in bytes of the ring buffer of each asynchronous logger.
+std::int64_t const kAsyncLoggerCapacity = 1 << 20;
+
+// The loggers installed by |principia__SetAsynchronousLogging|, indexed by
+// severity, or null.  They are not destroyed at exit because joining threads
+// while the DLL is being unloaded may deadlock.
+AsyncLogger* async_loggers[google::NUM_SEVERITIES] = {};
+
+// The number of calls that may be pending in a command queue.
+std::int64_t const kCommandQueueCapacity = 16;
+
+// The command queues of the plugins for which
+// |principia__SetAsynchronousAdvanceTime| is enabled.  Only used by the game
+// thread.
+std::map<Plugin const*, std::unique_ptr<CommandQueue>> command_queues;
+
+// Returns the command queue of |plugin|, or null if its calls are executed
+// synchronously.
+CommandQueue* FindCommandQueue(Plugin const* const plugin) {
+  auto const it = command_queues.find(plugin);
+  return it == command_queues.end() ? nullptr : it->second.get();
+}
+
+// Returns once the calls enqueued so far have been executed.  Called by the
+// functions that use a plugin, or the transforms, which observe the
+// trajectories of a plugin, except those that enqueue their calls.  Cheap when
+// no command queue exists.
+void DrainCommandQueues() {
+  for (auto const& pair : command_queues) {
+    pair.second->Drain();
+  }
+}
+
 // Takes ownership of |**pointer| and returns it to the caller.  Nulls
 // |*pointer|.  |pointer| must not be null.  No transfer of ownership of
 // |*pointer|.
@@ -44,9 +123,136 @@ XYZ ToXYZ(R3Element<double> const& r3_element) {
   return {r3_element.x, r3_element.y, r3_element.z};
 }
 
+QP ToQP(RelativeDegreesOfFreedom<AliceSun> const& relative) {
+  return {ToXYZ(relative.displacement().coordinates() / Metre),
+          ToXYZ(relative.velocity().coordinates() / (Metre / Second))};
+}
+
+XYZSegment ToXYZSegment(LineSegment<World> const& line_segment) {
+  return {ToXYZ((line_segment.begin - World::origin).coordinates() / Metre),
+          ToXYZ((line_segment.end - World::origin).coordinates() / Metre)};
+}
+
+using RecordSink = std::function<void(not_null<PluginRecord*> const record)>;
+using RecordSource = std::function<bool(not_null<PluginRecord*> const record)>;
+
+// Overwrites the file |filename| with the records passed by |write_records| to
+// its argument, as a sequence of length-delimited records.
+void WriteRecordsToFile(
+    std::string const& filename,
+    std::function<void(RecordSink const& sink)> const& write_records) {
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  CHECK(file.good()) << filename;
+  {
+    OstreamOutputStream output_stream(&file);
+    CodedOutputStream coded_output_stream(&output_stream);
+    write_records(
+        [&coded_output_stream](not_null<PluginRecord*> const record) {
+          coded_output_stream.WriteVarint32(record->ByteSize());
+          record->SerializeWithCachedSizes(&coded_output_stream);
+        });
+    CHECK(!coded_output_stream.HadError()) << filename;
+  }
+  file.close();
+  CHECK(file.good()) << filename;
+}
+
+// Calls |read_records| with a source of the records of the file |filename|
+// written by |WriteRecordsToFile|.  The source fills its argument with the
+// next record and returns true, or returns false at the end of the file.
+void ReadRecordsFromFile(
+    std::string const& filename,
+    std::function<void(RecordSource const& source)> const& read_records) {
+  std::ifstream file(filename, std::ios::binary);
+  CHECK(file.good()) << filename;
+  IstreamInputStream input_stream(&file);
+  read_records(
+      [&input_stream, &filename](not_null<PluginRecord*> const record) {
+        // A fresh |CodedInputStream| for each record, so that its total bytes
+        // limit applies to one record, not to the entire file.
+        CodedInputStream coded_input_stream(&input_stream);
+        std::uint32_t size;
+        if (!coded_input_stream.ReadVarint32(&size)) {
+          return false;
+        }
+        CodedInputStream::Limit const limit =
+            coded_input_stream.PushLimit(size);
+        CHECK(record->ParseFromCodedStream(&coded_input_stream) &&
+              coded_input_stream.ConsumedEntireMessage()) << filename;
+        coded_input_stream.PopLimit(limit);
+        return true;
+      });
+}
+
+// Returns all the records of the file |filename|.
+std::vector<PluginRecord> ReadAllRecordsFromFile(std::string const& filename) {
+  std::vector<PluginRecord> records;
+  ReadRecordsFromFile(
+      filename,
+      [&records](RecordSource const& source) {
+        PluginRecord record;
+        while (source(&record)) {
+          records.emplace_back();
+          records.back().Swap(&record);
+        }
+      });
+  return records;
+}
+
+// Compresses the |records|, which were written by
+// |Plugin::WriteToUncompressedRecords|, and overwrites the file |filename| with
+// them in the format of |WriteRecordsToFile|.  The records are independent
+// blocks, so they are compressed and encoded in parallel, and each one is
+// written as soon as it and its predecessors are ready.  The records are
+// cleared as they are encoded.
+void WriteUncompressedRecordsToFile(std::string const& filename,
+                                    std::vector<PluginRecord>& records) {
+  std::vector<std::string> blocks(records.size());
+  // Declared after |blocks|, so that it is destroyed, and its tasks completed,
+  // first.
+  ThreadPool thread_pool(
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+  std::vector<std::future<void>> encoded;
+  encoded.reserve(records.size());
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    PluginRecord* const record = &records[i];
+    std::string* const block = &blocks[i];
+    encoded.push_back(thread_pool.Add([record, block]() {
+      Plugin::CompressRecord(record);
+      CHECK(record->SerializeToString(block));
+      // Release the memory as we go, the record is not needed anymore.
+      record->Clear();
+    }));
+  }
+
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  CHECK(file.good()) << filename;
+  {
+    OstreamOutputStream output_stream(&file);
+    CodedOutputStream coded_output_stream(&output_stream);
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+      encoded[i].get();
+      coded_output_stream.WriteVarint32(blocks[i].size());
+      coded_output_stream.WriteString(blocks[i]);
+      std::string().swap(blocks[i]);
+    }
+    CHECK(!coded_output_stream.HadError()) << filename;
+  }
+  file.close();
+  CHECK(file.good()) << filename;
+}
+
+// Compresses the |records| of |plugin_save| and writes them to its file.  Runs
+// on the background thread of |plugin_save|.
+void WritePluginSave(not_null<PluginSave*> const plugin_save) {
+  WriteUncompressedRecordsToFile(plugin_save->filename, plugin_save->records);
+  LOG(INFO) << "Plugin written to " << plugin_save->filename;
+}
+
 }  // namespace
 
 void principia__InitGoogleLogging() {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   if (google::IsGoogleLoggingInitialized()) {
     LOG(INFO) << "Google logging was already initialized, no action taken";
   } else {
@@ -68,71 +274,150 @@ void principia__InitGoogleLogging() {
               << " version " << principia::base::kCompilerVersion
               << " for " << principia::base::kOperatingSystem
               << " " << principia::base::kArchitecture;
+    CPUFeatures const& features = DetectedCPUFeatures();
+    LOG(INFO) << "Processor supports AVX: " << features.avx
+              << ", AVX-512F: " << features.avx512f;
   }
 }
 
 void principia__SetBufferedLogging(int const max_severity) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   FLAGS_logbuflevel = max_severity;
 }
 
 int principia__GetBufferedLogging() {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   return FLAGS_logbuflevel;
 }
 
 void principia__SetBufferDuration(int const seconds) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   FLAGS_logbufsecs = seconds;
 }
 
 int principia__GetBufferDuration() {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   return FLAGS_logbufsecs;
 }
 
 void principia__SetSuppressedLogging(int const min_severity) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   FLAGS_minloglevel = min_severity;
 }
 
 int principia__GetSuppressedLogging() {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   return FLAGS_minloglevel;
 }
 
 void principia__SetVerboseLogging(int const level) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   FLAGS_v = level;
 }
 
 int principia__GetVerboseLogging() {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   return FLAGS_v;
 }
 
 void principia__SetStderrLogging(int const min_severity) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   // NOTE(egg): We could use |FLAGS_stderrthreshold| instead, the difference
   // seems to be a mutex.
   google::SetStderrLogging(min_severity);
 }
 
 int principia__GetStderrLogging() {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   return FLAGS_stderrthreshold;
 }
 
+void principia__SetAsynchronousLogging(bool const enabled) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  for (int severity = 0; severity < google::NUM_SEVERITIES; ++severity) {
+    AsyncLogger*& async_logger = async_loggers[severity];
+    if (enabled && async_logger == nullptr) {
+      async_logger = new AsyncLogger(google::base::GetLogger(severity),
+                                     kAsyncLoggerCapacity);
+      google::base::SetLogger(severity, async_logger);
+    } else if (!enabled && async_logger != nullptr) {
+      // Once |SetLogger| returns glog no longer calls |async_logger|, and
+      // deleting it writes its pending messages.
+      google::base::SetLogger(severity, async_logger->wrapped());
+      delete async_logger;
+      async_logger = nullptr;
+    }
+  }
+}
+
+bool principia__GetAsynchronousLogging() {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  return async_loggers[google::INFO] != nullptr;
+}
+
 void principia__LogInfo(char const* message) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   LOG(INFO) << message;
 }
 
 void principia__LogWarning(char const* message) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   LOG(WARNING) << message;
 }
 
 void principia__LogError(char const* message) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   LOG(ERROR) << message;
 }
 
 void principia__LogFatal(char const* message) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   LOG(FATAL) << message;
 }
 
+void principia__StartTracing(char const* filename) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  CHECK_NOTNULL(filename);
+  LOG(INFO) << "Tracing to " << filename;
+  Tracer::Global()->Start(filename);
+}
+
+void principia__StopTracing() {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  Tracer::Global()->Stop();
+}
+
+void principia__StartJournaling(char const* filename) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  CHECK_NOTNULL(filename);
+  LOG(INFO) << "Journaling to " << filename;
+  Journal::Global()->Start(filename);
+}
+
+void principia__StopJournaling() {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  Journal::Global()->Stop();
+}
+
+void principia__StartInterfaceStatistics() {
+  LOG(INFO) << "Starting interface statistics";
+  CallStatistics::Global()->Start();
+}
+
+void principia__StopInterfaceStatistics() {
+  CallStatistics::Global()->Stop();
+}
+
+void principia__DumpInterfaceStatistics() {
+  LOG(INFO) << "Interface statistics:\n"
+            << CallStatistics::Global()->Summary();
+}
+
 Plugin* principia__NewPlugin(double const initial_time,
                              int const sun_index,
                              double const sun_gravitational_parameter,
                              double const planetarium_rotation_in_degrees) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   LOG(INFO) << "Constructing Principia plugin";
   not_null<std::unique_ptr<Plugin>> result = make_not_null_unique<Plugin>(
       Instant(initial_time * Second),
@@ -140,15 +425,35 @@ Plugin* principia__NewPlugin(double const initial_time,
       sun_gravitational_parameter * SIUnit<GravitationalParameter>(),
       planetarium_rotation_in_degrees * Degree);
   LOG(INFO) << "Plugin constructed";
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_new_plugin();
+    message->set_initial_time(initial_time);
+    message->set_sun_index(sun_index);
+    message->set_sun_gravitational_parameter(sun_gravitational_parameter);
+    message->set_planetarium_rotation_in_degrees(
+        planetarium_rotation_in_degrees);
+    message->set_result(SerializePointer(result.get()));
+    Journal::Global()->Write(entry);
+  }
   return result.release();
 }
 
 void principia__DeletePlugin(Plugin const** const plugin) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   LOG(INFO) << "Destroying Principia plugin";
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    entry.mutable_delete_plugin()->set_plugin(
+        SerializePointer(*CHECK_NOTNULL(plugin)));
+    Journal::Global()->Write(entry);
+  }
   // We want to log before and after destroying the plugin since it is a pretty
   // significant event, so we take ownership inside a block.
   {
-    TakeOwnership(plugin);
+    std::unique_ptr<Plugin const> const owned_plugin = TakeOwnership(plugin);
+    // Destroying the command queue executes the pending calls.
+    command_queues.erase(owned_plugin.get());
   }
   LOG(INFO) << "Plugin destroyed";
 }
@@ -161,6 +466,8 @@ void principia__InsertCelestial(Plugin* const plugin,
                                 double const gravitational_parameter,
                                 int const parent_index,
                                 QP const from_parent) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
   CHECK_NOTNULL(plugin)->InsertCelestial(
       celestial_index,
       gravitational_parameter * SIUnit<GravitationalParameter>(),
@@ -168,76 +475,557 @@ void principia__InsertCelestial(Plugin* const plugin,
       RelativeDegreesOfFreedom<AliceSun>(
           Displacement<AliceSun>(ToR3Element(from_parent.q) * Metre),
           Velocity<AliceSun>(ToR3Element(from_parent.p) * (Metre / Second))));
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_insert_celestial();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_celestial_index(celestial_index);
+    message->set_gravitational_parameter(gravitational_parameter);
+    message->set_parent_index(parent_index);
+    SerializeQP(from_parent, message->mutable_from_parent());
+    Journal::Global()->Write(entry);
+  }
+}
+
+void principia__InsertCelestials(
+    Plugin* const plugin,
+    int const* const celestial_indices,
+    double const* const gravitational_parameters,
+    int const* const parent_indices,
+    QP const* const from_parents,
+    int const count) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin);
+  CHECK_LE(0, count);
+  if (count > 0) {
+    CHECK_NOTNULL(celestial_indices);
+    CHECK_NOTNULL(gravitational_parameters);
+    CHECK_NOTNULL(parent_indices);
+    CHECK_NOTNULL(from_parents);
+  }
+  std::vector<Plugin::CelestialDescription> celestials;
+  celestials.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    QP const& from_parent = from_parents[i];
+    celestials.push_back(
+        {celestial_indices[i],
+         gravitational_parameters[i] * SIUnit<GravitationalParameter>(),
+         parent_indices[i],
+         RelativeDegreesOfFreedom<AliceSun>(
+             Displacement<AliceSun>(ToR3Element(from_parent.q) * Metre),
+             Velocity<AliceSun>(ToR3Element(from_parent.p) *
+                                    (Metre / Second)))});
+  }
+  plugin->InsertCelestials(celestials);
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_insert_celestials();
+    message->set_plugin(SerializePointer(plugin));
+    for (int i = 0; i < count; ++i) {
+      message->add_celestial_index(celestial_indices[i]);
+      message->add_gravitational_parameter(gravitational_parameters[i]);
+      message->add_parent_index(parent_indices[i]);
+      SerializeQP(from_parents[i], message->add_from_parent());
+    }
+    Journal::Global()->Write(entry);
+  }
 }
 
 void principia__UpdateCelestialHierarchy(Plugin const* const plugin,
                                          int const celestial_index,
                                          int const parent_index) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
   CHECK_NOTNULL(plugin)->UpdateCelestialHierarchy(celestial_index,
                                                   parent_index);
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_update_celestial_hierarchy();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_celestial_index(celestial_index);
+    message->set_parent_index(parent_index);
+    Journal::Global()->Write(entry);
+  }
 }
 
 void principia__EndInitialization(Plugin* const plugin) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
   CHECK_NOTNULL(plugin)->EndInitialization();
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    entry.mutable_end_initialization()->set_plugin(SerializePointer(plugin));
+    Journal::Global()->Write(entry);
+  }
+}
+
+bool principia__LoadEphemerisFile(Plugin* const plugin,
+                                  char const* filename) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(filename);
+  bool const result = CHECK_NOTNULL(plugin)->LoadEphemerisFile(filename);
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_load_ephemeris_file();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_filename(filename);
+    message->set_result(result);
+    Journal::Global()->Write(entry);
+  }
+  return result;
+}
+
+void principia__WriteEphemerisFile(Plugin* const plugin,
+                                   char const* filename,
+                                   double const t_max,
+                                   int const steps_per_series,
+                                   int const degree) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(filename);
+  LOG(INFO) << "Writing ephemeris to " << filename;
+  CHECK_NOTNULL(plugin)->WriteEphemerisFile(filename,
+                                            Instant(t_max * Second),
+                                            steps_per_series,
+                                            degree);
+  LOG(INFO) << "Ephemeris written";
+}
+
+void principia__WriteTrajectoryFile(Plugin const* const plugin,
+                                    char const* filename) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(filename);
+  LOG(INFO) << "Writing trajectories to " << filename;
+  CHECK_NOTNULL(plugin)->WriteTrajectoryFile(filename);
+  LOG(INFO) << "Trajectories written";
 }
 
 bool principia__InsertOrKeepVessel(Plugin* const plugin,
                                    char const* vessel_guid,
                                    int const parent_index) {
-  return CHECK_NOTNULL(plugin)->InsertOrKeepVessel(vessel_guid, parent_index);
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  bool const result =
+      CHECK_NOTNULL(plugin)->InsertOrKeepVessel(vessel_guid, parent_index);
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_insert_or_keep_vessel();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_vessel_guid(vessel_guid);
+    message->set_parent_index(parent_index);
+    Journal::Global()->Write(entry);
+  }
+  return result;
 }
 
 void principia__SetVesselStateOffset(Plugin* const plugin,
                                      char const* vessel_guid,
                                      QP const from_parent) {
-  CHECK_NOTNULL(plugin)->SetVesselStateOffset(
-      vessel_guid,
-      RelativeDegreesOfFreedom<AliceSun>(
-          Displacement<AliceSun>(ToR3Element(from_parent.q) * Metre),
-          Velocity<AliceSun>(ToR3Element(from_parent.p) * (Metre / Second))));
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  CHECK_NOTNULL(plugin);
+  GUID const guid = vessel_guid;
+  RelativeDegreesOfFreedom<AliceSun> const relative(
+      Displacement<AliceSun>(ToR3Element(from_parent.q) * Metre),
+      Velocity<AliceSun>(ToR3Element(from_parent.p) * (Metre / Second)));
+  CommandQueue* const command_queue = FindCommandQueue(plugin);
+  if (command_queue == nullptr) {
+    plugin->SetVesselStateOffset(guid, relative);
+  } else {
+    command_queue->Enqueue(
+        [guid, relative](not_null<Plugin*> const plugin) {
+          plugin->SetVesselStateOffset(guid, relative);
+        });
+  }
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_set_vessel_state_offset();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_vessel_guid(vessel_guid);
+    SerializeQP(from_parent, message->mutable_from_parent());
+    Journal::Global()->Write(entry);
+  }
 }
 
 void principia__AdvanceTime(Plugin* const plugin,
                             double const t,
                             double const planetarium_rotation) {
-  CHECK_NOTNULL(plugin)->AdvanceTime(Instant(t * Second),
-                                     planetarium_rotation * Degree);
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  CHECK_NOTNULL(plugin);
+  CommandQueue* const command_queue = FindCommandQueue(plugin);
+  if (command_queue == nullptr) {
+    plugin->AdvanceTime(Instant(t * Second), planetarium_rotation * Degree);
+  } else {
+    command_queue->Enqueue(
+        [t, planetarium_rotation](not_null<Plugin*> const plugin) {
+          plugin->AdvanceTime(Instant(t * Second),
+                              planetarium_rotation * Degree);
+        });
+  }
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_advance_time();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_t(t);
+    message->set_planetarium_rotation(planetarium_rotation);
+    Journal::Global()->Write(entry);
+  }
+}
+
+void principia__SetAsynchronousAdvanceTime(Plugin* const plugin,
+                                           bool const enabled) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  CHECK_NOTNULL(plugin);
+  if (enabled && FindCommandQueue(plugin) == nullptr) {
+    command_queues.emplace(
+        plugin,
+        std::make_unique<CommandQueue>(plugin, kCommandQueueCapacity));
+  } else if (!enabled) {
+    // Destroying the command queue executes the pending calls.
+    command_queues.erase(plugin);
+  }
+}
+
+bool principia__GetAsynchronousAdvanceTime(Plugin const* const plugin) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  return FindCommandQueue(CHECK_NOTNULL(plugin)) != nullptr;
+}
+
+void principia__FastForward(Plugin* const plugin,
+                            double const t,
+                            double const planetarium_rotation) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin)->FastForward(
+      Instant(t * Second),
+      planetarium_rotation * Degree,
+      std::function<void(Instant const& history_time)>());
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_fast_forward();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_t(t);
+    message->set_planetarium_rotation(planetarium_rotation);
+    Journal::Global()->Write(entry);
+  }
+}
+
+VesselHandle principia__VesselHandle(Plugin const* const plugin,
+                                     char const* vessel_guid) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  VesselHandle const result = CHECK_NOTNULL(plugin)->vessel_handle(vessel_guid);
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_vessel_handle();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_vessel_guid(vessel_guid);
+    message->set_result(result);
+    Journal::Global()->Write(entry);
+  }
+  return result;
+}
+
+void principia__InsertVessels(Plugin* const plugin,
+                              char const* const* const vessel_guids,
+                              int const* const parent_indices,
+                              QP const* const from_parents,
+                              int const count,
+                              VesselHandle* const vessel_handles) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin);
+  CHECK_LE(0, count);
+  if (count > 0) {
+    CHECK_NOTNULL(vessel_guids);
+    CHECK_NOTNULL(parent_indices);
+    CHECK_NOTNULL(from_parents);
+    CHECK_NOTNULL(vessel_handles);
+  }
+  std::vector<GUID> guids;
+  std::vector<Index> indices;
+  std::vector<RelativeDegreesOfFreedom<AliceSun>> relative_degrees_of_freedom;
+  guids.reserve(count);
+  indices.reserve(count);
+  relative_degrees_of_freedom.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    guids.emplace_back(CHECK_NOTNULL(vessel_guids[i]));
+    indices.push_back(parent_indices[i]);
+    relative_degrees_of_freedom.emplace_back(
+        Displacement<AliceSun>(ToR3Element(from_parents[i].q) * Metre),
+        Velocity<AliceSun>(ToR3Element(from_parents[i].p) *
+                           (Metre / Second)));
+  }
+  std::vector<VesselHandle> const handles =
+      plugin->InsertVessels(guids, indices, relative_degrees_of_freedom);
+  std::copy(handles.begin(), handles.end(), vessel_handles);
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_insert_vessels();
+    message->set_plugin(SerializePointer(plugin));
+    for (int i = 0; i < count; ++i) {
+      message->add_vessel_guid(vessel_guids[i]);
+      message->add_parent_index(parent_indices[i]);
+      SerializeQP(from_parents[i], message->add_from_parent());
+      message->add_result(vessel_handles[i]);
+    }
+    Journal::Global()->Write(entry);
+  }
+}
+
+void principia__KeepVessels(Plugin* const plugin,
+                            VesselHandle const* const vessel_handles,
+                            int const count) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin);
+  CHECK_LE(0, count);
+  if (count > 0) {
+    CHECK_NOTNULL(vessel_handles);
+  }
+  plugin->KeepVessels(
+      std::vector<VesselHandle>(vessel_handles, vessel_handles + count));
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_keep_vessels();
+    message->set_plugin(SerializePointer(plugin));
+    for (int i = 0; i < count; ++i) {
+      message->add_vessel_handle(vessel_handles[i]);
+    }
+    Journal::Global()->Write(entry);
+  }
+}
+
+void principia__RemoveVessel(Plugin* const plugin, char const* vessel_guid) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin)->RemoveVessel(vessel_guid);
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_remove_vessel();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_vessel_guid(vessel_guid);
+    Journal::Global()->Write(entry);
+  }
 }
 
 QP principia__VesselFromParent(Plugin const* const plugin,
                                char const* vessel_guid) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
   RelativeDegreesOfFreedom<AliceSun> const result =
       CHECK_NOTNULL(plugin)->VesselFromParent(vessel_guid);
-  return {ToXYZ(result.displacement().coordinates() / Metre),
-          ToXYZ(result.velocity().coordinates() / (Metre / Second))};
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_vessel_from_parent();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_vessel_guid(vessel_guid);
+    Journal::Global()->Write(entry);
+  }
+  return ToQP(result);
+}
+
+QP principia__VesselFromParentByHandle(Plugin const* const plugin,
+                                       VesselHandle const vessel_handle) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  RelativeDegreesOfFreedom<AliceSun> const result =
+      CHECK_NOTNULL(plugin)->VesselFromParent(vessel_handle);
+  return ToQP(result);
+}
+
+void principia__VesselsFromParent(Plugin const* const plugin,
+                                  char const* const* const vessel_guids,
+                                  int const count,
+                                  QP* const from_parents) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin);
+  CHECK_LE(0, count);
+  if (count > 0) {
+    CHECK_NOTNULL(vessel_guids);
+    CHECK_NOTNULL(from_parents);
+  }
+  for (int i = 0; i < count; ++i) {
+    from_parents[i] = principia__VesselFromParent(plugin, vessel_guids[i]);
+  }
+}
+
+void principia__VesselsFromParentByHandle(
+    Plugin const* const plugin,
+    VesselHandle const* const vessel_handles,
+    int const count,
+    QP* const from_parents) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin);
+  CHECK_LE(0, count);
+  if (count > 0) {
+    CHECK_NOTNULL(vessel_handles);
+    CHECK_NOTNULL(from_parents);
+  }
+  for (int i = 0; i < count; ++i) {
+    from_parents[i] = ToQP(plugin->VesselFromParent(vessel_handles[i]));
+  }
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_vessels_from_parent_by_handle();
+    message->set_plugin(SerializePointer(plugin));
+    for (int i = 0; i < count; ++i) {
+      message->add_vessel_handle(vessel_handles[i]);
+    }
+    Journal::Global()->Write(entry);
+  }
 }
 
 QP principia__CelestialFromParent(Plugin const* const plugin,
                                    int const celestial_index) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
   RelativeDegreesOfFreedom<AliceSun> const result =
       CHECK_NOTNULL(plugin)->CelestialFromParent(celestial_index);
-  return {ToXYZ(result.displacement().coordinates() / Metre),
-          ToXYZ(result.velocity().coordinates() / (Metre / Second))};
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_celestial_from_parent();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_celestial_index(celestial_index);
+    Journal::Global()->Write(entry);
+  }
+  return ToQP(result);
+}
+
+QP principia__VesselFromParentAt(Plugin const* const plugin,
+                                 VesselHandle const vessel_handle,
+                                 double const t) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  return ToQP(CHECK_NOTNULL(plugin)->VesselFromParentAt(vessel_handle,
+                                                        Instant(t * Second)));
+}
+
+QP principia__CelestialFromParentAt(Plugin const* const plugin,
+                                    int const celestial_index,
+                                    double const t) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  return ToQP(CHECK_NOTNULL(plugin)->CelestialFromParentAt(
+      celestial_index,
+      Instant(t * Second)));
+}
+
+void principia__AllCelestialsFromParent(Plugin const* const plugin,
+                                        int const count,
+                                        QP* const from_parents) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  std::vector<RelativeDegreesOfFreedom<AliceSun>> const result =
+      CHECK_NOTNULL(plugin)->AllCelestialsFromParent();
+  CHECK_EQ(static_cast<int>(result.size()), count);
+  if (count > 0) {
+    CHECK_NOTNULL(from_parents);
+  }
+  for (int i = 0; i < count; ++i) {
+    from_parents[i] = ToQP(result[i]);
+  }
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_all_celestials_from_parent();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_count(count);
+    Journal::Global()->Write(entry);
+  }
 }
 
 Transforms<Barycentric, Rendering, Barycentric>*
 principia__NewBodyCentredNonRotatingTransforms(Plugin const* const plugin,
                                                int const reference_body_index) {
-  return CHECK_NOTNULL(plugin)->
-      NewBodyCentredNonRotatingTransforms(reference_body_index).release();
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  Transforms<Barycentric, Rendering, Barycentric>* const result =
+      CHECK_NOTNULL(plugin)->
+          NewBodyCentredNonRotatingTransforms(reference_body_index).release();
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message =
+        entry.mutable_new_body_centred_non_rotating_transforms();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_reference_body_index(reference_body_index);
+    message->set_result(SerializePointer(result));
+    Journal::Global()->Write(entry);
+  }
+  return result;
 }
 
 Transforms<Barycentric, Rendering, Barycentric>*
 principia__NewBarycentricRotatingTransforms(Plugin const* const plugin,
                                             int const primary_index,
                                             int const secondary_index) {
-  return CHECK_NOTNULL(plugin)->
-      NewBarycentricRotatingTransforms(
-          primary_index, secondary_index).release();
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  Transforms<Barycentric, Rendering, Barycentric>* const result =
+      CHECK_NOTNULL(plugin)->
+          NewBarycentricRotatingTransforms(
+              primary_index, secondary_index).release();
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_new_barycentric_rotating_transforms();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_primary_index(primary_index);
+    message->set_secondary_index(secondary_index);
+    message->set_result(SerializePointer(result));
+    Journal::Global()->Write(entry);
+  }
+  return result;
+}
+
+Transforms<Barycentric, Rendering, Barycentric>*
+principia__BodyCentredNonRotatingTransforms(Plugin* const plugin,
+                                            int const reference_body_index) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  Transforms<Barycentric, Rendering, Barycentric>* const result =
+      CHECK_NOTNULL(plugin)->
+          BodyCentredNonRotatingTransforms(reference_body_index);
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_body_centred_non_rotating_transforms();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_reference_body_index(reference_body_index);
+    message->set_result(SerializePointer(result));
+    Journal::Global()->Write(entry);
+  }
+  return result;
+}
+
+Transforms<Barycentric, Rendering, Barycentric>*
+principia__BarycentricRotatingTransforms(Plugin* const plugin,
+                                         int const primary_index,
+                                         int const secondary_index) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  Transforms<Barycentric, Rendering, Barycentric>* const result =
+      CHECK_NOTNULL(plugin)->
+          BarycentricRotatingTransforms(primary_index, secondary_index);
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_barycentric_rotating_transforms();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_primary_index(primary_index);
+    message->set_secondary_index(secondary_index);
+    message->set_result(SerializePointer(result));
+    Journal::Global()->Write(entry);
+  }
+  return result;
 }
 
 void principia__DeleteTransforms(
     Transforms<Barycentric, Rendering, Barycentric>** const transforms) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    entry.mutable_delete_transforms()->set_transforms(
+        SerializePointer(*CHECK_NOTNULL(transforms)));
+    Journal::Global()->Write(entry);
+  }
   TakeOwnership(transforms);
 }
 
@@ -245,50 +1033,207 @@ LineAndIterator* principia__RenderedVesselTrajectory(
     Plugin const* const plugin,
     char const* vessel_guid,
     Transforms<Barycentric, Rendering, Barycentric>* const transforms,
-    XYZ const sun_world_position) {
+    XYZ const sun_world_position,
+    double const tolerance,
+    double const begin_time) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
   RenderedTrajectory<World> rendered_trajectory = CHECK_NOTNULL(plugin)->
       RenderedVesselTrajectory(
           vessel_guid,
           transforms,
           World::origin + Displacement<World>(
-                              ToR3Element(sun_world_position) * Metre));
+                              ToR3Element(sun_world_position) * Metre),
+          tolerance * Metre,
+          Instant(begin_time * Second));
   not_null<std::unique_ptr<LineAndIterator>> result =
       make_not_null_unique<LineAndIterator>(std::move(rendered_trajectory));
   result->it = result->rendered_trajectory.begin();
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_rendered_vessel_trajectory();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_vessel_guid(vessel_guid);
+    message->set_transforms(SerializePointer(transforms));
+    SerializeXYZ(sun_world_position, message->mutable_sun_world_position());
+    message->set_tolerance(tolerance);
+    message->set_begin_time(begin_time);
+    message->set_result(SerializePointer(result.get()));
+    Journal::Global()->Write(entry);
+  }
   return result.release();
 }
 
+void principia__RenderedVesselTrajectories(
+    Plugin const* const plugin,
+    char const* const* const vessel_guids,
+    int const count,
+    Transforms<Barycentric, Rendering, Barycentric>* const transforms,
+    XYZ const sun_world_position,
+    double const tolerance,
+    double const begin_time,
+    LineAndIterator** const line_and_iterators) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin);
+  CHECK_LE(0, count);
+  if (count > 0) {
+    CHECK_NOTNULL(vessel_guids);
+    CHECK_NOTNULL(line_and_iterators);
+  }
+  std::vector<GUID> const guids(vessel_guids, vessel_guids + count);
+  std::vector<RenderedTrajectory<World>> rendered_trajectories =
+      plugin->RenderedVesselTrajectories(
+          guids,
+          transforms,
+          World::origin + Displacement<World>(
+                              ToR3Element(sun_world_position) * Metre),
+          tolerance * Metre,
+          Instant(begin_time * Second));
+  for (int i = 0; i < count; ++i) {
+    not_null<std::unique_ptr<LineAndIterator>> result =
+        make_not_null_unique<LineAndIterator>(
+            std::move(rendered_trajectories[i]));
+    result->it = result->rendered_trajectory.begin();
+    line_and_iterators[i] = result.release();
+  }
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_rendered_vessel_trajectories();
+    message->set_plugin(SerializePointer(plugin));
+    for (int i = 0; i < count; ++i) {
+      message->add_vessel_guid(vessel_guids[i]);
+      message->add_line_and_iterator(SerializePointer(line_and_iterators[i]));
+    }
+    message->set_transforms(SerializePointer(transforms));
+    SerializeXYZ(sun_world_position, message->mutable_sun_world_position());
+    message->set_tolerance(tolerance);
+    message->set_begin_time(begin_time);
+    Journal::Global()->Write(entry);
+  }
+}
+
 int principia__NumberOfSegments(LineAndIterator const* line_and_iterator) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   return CHECK_NOTNULL(line_and_iterator)->rendered_trajectory.size();
 }
 
 XYZSegment principia__FetchAndIncrement(
     LineAndIterator* const line_and_iterator) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   CHECK_NOTNULL(line_and_iterator);
   CHECK(line_and_iterator->it != line_and_iterator->rendered_trajectory.end());
   LineSegment<World> const result = *line_and_iterator->it;
   ++line_and_iterator->it;
-  return {ToXYZ((result.begin - World::origin).coordinates() / Metre),
-          ToXYZ((result.end - World::origin).coordinates() / Metre)};
+  return ToXYZSegment(result);
+}
+
+int principia__FetchSegments(LineAndIterator* const line_and_iterator,
+                             int const max_segments,
+                             XYZSegment* const segments) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  CHECK_NOTNULL(line_and_iterator);
+  CHECK_LE(0, max_segments);
+  CHECK(max_segments == 0 || segments != nullptr);
+  int n = 0;
+  for (; n < max_segments &&
+             line_and_iterator->it !=
+                 line_and_iterator->rendered_trajectory.end();
+       ++n, ++line_and_iterator->it) {
+    segments[n] = ToXYZSegment(*line_and_iterator->it);
+  }
+  return n;
+}
+
+int principia__NumberOfVertices(
+    LineAndIterator const* const line_and_iterator) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  CHECK_NOTNULL(line_and_iterator);
+  RenderedTrajectory<World> const& rendered_trajectory =
+      line_and_iterator->rendered_trajectory;
+  int n = 0;
+  for (std::size_t i = 0; i < rendered_trajectory.size(); ++i) {
+    if (i == 0 ||
+        rendered_trajectory[i].begin != rendered_trajectory[i - 1].end) {
+      ++n;
+    }
+    ++n;
+  }
+  return n;
+}
+
+void principia__FetchVertices(LineAndIterator const* const line_and_iterator,
+                              XYZ const origin,
+                              float* const vertices,
+                              int* const indices) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  CHECK_NOTNULL(line_and_iterator);
+  RenderedTrajectory<World> const& rendered_trajectory =
+      line_and_iterator->rendered_trajectory;
+  if (rendered_trajectory.empty()) {
+    return;
+  }
+  CHECK_NOTNULL(vertices);
+  CHECK_NOTNULL(indices);
+  Position<World> const origin_position =
+      World::origin + Displacement<World>(ToR3Element(origin) * Metre);
+  int n = 0;
+  auto const add_vertex = [vertices, &n, &origin_position](
+      Position<World> const& position) {
+    R3Element<double> const coordinates =
+        (position - origin_position).coordinates() / Metre;
+    vertices[3 * n] = static_cast<float>(coordinates.x);
+    vertices[3 * n + 1] = static_cast<float>(coordinates.y);
+    vertices[3 * n + 2] = static_cast<float>(coordinates.z);
+    return n++;
+  };
+  for (std::size_t i = 0; i < rendered_trajectory.size(); ++i) {
+    if (i == 0 ||
+        rendered_trajectory[i].begin != rendered_trajectory[i - 1].end) {
+      indices[2 * i] = add_vertex(rendered_trajectory[i].begin);
+    } else {
+      indices[2 * i] = indices[2 * i - 1];
+    }
+    indices[2 * i + 1] = add_vertex(rendered_trajectory[i].end);
+  }
 }
 
 bool principia__AtEnd(LineAndIterator* const line_and_iterator) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   CHECK_NOTNULL(line_and_iterator);
   return line_and_iterator->it == line_and_iterator->rendered_trajectory.end();
 }
 
 void principia__DeleteLineAndIterator(
     LineAndIterator** const line_and_iterator) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    entry.mutable_delete_line_and_iterator()->set_line_and_iterator(
+        SerializePointer(*CHECK_NOTNULL(line_and_iterator)));
+    Journal::Global()->Write(entry);
+  }
   TakeOwnership(line_and_iterator);
 }
 
 XYZ principia__VesselWorldPosition(Plugin const* const plugin,
                                    char const* vessel_guid,
                                    XYZ const parent_world_position) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
   Position<World> const result = CHECK_NOTNULL(plugin)->VesselWorldPosition(
       vessel_guid,
       World::origin + Displacement<World>(
                           ToR3Element(parent_world_position) * Metre));
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_vessel_world_position();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_vessel_guid(vessel_guid);
+    SerializeXYZ(parent_world_position,
+                 message->mutable_parent_world_position());
+    Journal::Global()->Write(entry);
+  }
   return ToXYZ((result - World::origin).coordinates() / Metre);
 }
 
@@ -296,17 +1241,200 @@ XYZ principia__VesselWorldVelocity(Plugin const* const plugin,
                                    char const* vessel_guid,
                                    XYZ const parent_world_velocity,
                                    double const parent_rotation_period) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
   Velocity<World> const result = CHECK_NOTNULL(plugin)->VesselWorldVelocity(
       vessel_guid,
       Velocity<World>(ToR3Element(parent_world_velocity) * (Metre / Second)),
       parent_rotation_period * Second);
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_vessel_world_velocity();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_vessel_guid(vessel_guid);
+    SerializeXYZ(parent_world_velocity,
+                 message->mutable_parent_world_velocity());
+    message->set_parent_rotation_period(parent_rotation_period);
+    Journal::Global()->Write(entry);
+  }
   return ToXYZ(result.coordinates() / (Metre / Second));
 }
 
+XYZ principia__VesselWorldPositionByHandle(Plugin const* const plugin,
+                                           VesselHandle const vessel_handle,
+                                           XYZ const parent_world_position) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  Position<World> const result = CHECK_NOTNULL(plugin)->VesselWorldPosition(
+      vessel_handle,
+      World::origin + Displacement<World>(
+                          ToR3Element(parent_world_position) * Metre));
+  return ToXYZ((result - World::origin).coordinates() / Metre);
+}
+
+XYZ principia__VesselWorldPositionAt(Plugin const* const plugin,
+                                     VesselHandle const vessel_handle,
+                                     XYZ const parent_world_position,
+                                     double const t) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  Position<World> const result = CHECK_NOTNULL(plugin)->VesselWorldPositionAt(
+      vessel_handle,
+      World::origin + Displacement<World>(
+                          ToR3Element(parent_world_position) * Metre),
+      Instant(t * Second));
+  return ToXYZ((result - World::origin).coordinates() / Metre);
+}
+
+XYZ principia__VesselWorldVelocityByHandle(
+    Plugin const* const plugin,
+    VesselHandle const vessel_handle,
+    XYZ const parent_world_velocity,
+    double const parent_rotation_period) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  Velocity<World> const result = CHECK_NOTNULL(plugin)->VesselWorldVelocity(
+      vessel_handle,
+      Velocity<World>(ToR3Element(parent_world_velocity) * (Metre / Second)),
+      parent_rotation_period * Second);
+  return ToXYZ(result.coordinates() / (Metre / Second));
+}
+
+void principia__VesselsWorldPositions(
+    Plugin const* const plugin,
+    char const* const* const vessel_guids,
+    int const count,
+    XYZ const* const parent_world_positions,
+    XYZ* const world_positions) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin);
+  CHECK_LE(0, count);
+  if (count > 0) {
+    CHECK_NOTNULL(vessel_guids);
+    CHECK_NOTNULL(parent_world_positions);
+    CHECK_NOTNULL(world_positions);
+  }
+  for (int i = 0; i < count; ++i) {
+    world_positions[i] =
+        principia__VesselWorldPosition(plugin,
+                                       vessel_guids[i],
+                                       parent_world_positions[i]);
+  }
+}
+
+void principia__VesselsWorldVelocities(
+    Plugin const* const plugin,
+    char const* const* const vessel_guids,
+    int const count,
+    XYZ const* const parent_world_velocities,
+    double const* const parent_rotation_periods,
+    XYZ* const world_velocities) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin);
+  CHECK_LE(0, count);
+  if (count > 0) {
+    CHECK_NOTNULL(vessel_guids);
+    CHECK_NOTNULL(parent_world_velocities);
+    CHECK_NOTNULL(parent_rotation_periods);
+    CHECK_NOTNULL(world_velocities);
+  }
+  for (int i = 0; i < count; ++i) {
+    world_velocities[i] =
+        principia__VesselWorldVelocity(plugin,
+                                       vessel_guids[i],
+                                       parent_world_velocities[i],
+                                       parent_rotation_periods[i]);
+  }
+}
+
+int principia__VesselsWithinRadius(Plugin const* const plugin,
+                                   char const* vessel_guid,
+                                   double const radius,
+                                   int const max_vessels,
+                                   VesselHandle* const vessel_handles) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_LE(0, max_vessels);
+  std::vector<VesselHandle> const result =
+      CHECK_NOTNULL(plugin)->VesselsWithinRadius(vessel_guid, radius * Metre);
+  int const n = std::min(max_vessels, static_cast<int>(result.size()));
+  if (n > 0) {
+    CHECK_NOTNULL(vessel_handles);
+  }
+  std::copy(result.begin(), result.begin() + n, vessel_handles);
+  return n;
+}
+
+bool principia__ClosestVessel(Plugin const* const plugin,
+                              char const* vessel_guid,
+                              VesselHandle* const closest,
+                              double* const distance) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  Length distance_to_closest;
+  bool const found = CHECK_NOTNULL(plugin)->ClosestVessel(
+      vessel_guid, CHECK_NOTNULL(closest), &distance_to_closest);
+  if (found) {
+    *CHECK_NOTNULL(distance) = distance_to_closest / Metre;
+  }
+  return found;
+}
+
+void principia__DominantBodies(Plugin const* const plugin,
+                               char const* const* const vessel_guids,
+                               int const count,
+                               int* const parent_indices) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin);
+  CHECK_LE(0, count);
+  if (count == 0) {
+    return;
+  }
+  CHECK_NOTNULL(vessel_guids);
+  CHECK_NOTNULL(parent_indices);
+  std::vector<Index> const result = plugin->DominantBodies(
+      std::vector<GUID>(vessel_guids, vessel_guids + count));
+  std::copy(result.begin(), result.end(), parent_indices);
+}
+
+void principia__PorkchopPlot(Plugin const* const plugin,
+                             int const departure_index,
+                             int const arrival_index,
+                             double const departure_min,
+                             double const departure_max,
+                             int const departure_points,
+                             double const arrival_min,
+                             double const arrival_max,
+                             int const arrival_points,
+                             double const step,
+                             double* const delta_v) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(delta_v);
+  std::vector<Speed> const result = CHECK_NOTNULL(plugin)->PorkchopPlot(
+      departure_index,
+      arrival_index,
+      Instant(departure_min * Second),
+      Instant(departure_max * Second),
+      departure_points,
+      Instant(arrival_min * Second),
+      Instant(arrival_max * Second),
+      arrival_points,
+      step * Second);
+  for (std::size_t i = 0; i < result.size(); ++i) {
+    delta_v[i] = result[i] / (Metre / Second);
+  }
+}
+
 void principia__AddVesselToNextPhysicsBubble(Plugin* const plugin,
                                              char const* vessel_guid,
                                              KSPPart const* const parts,
                                              int count) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
   VLOG(1) << __FUNCTION__ << '\n' << NAMED(count);
   std::vector<principia::ksp_plugin::IdAndOwnedPart> vessel_parts;
   vessel_parts.reserve(count);
@@ -329,32 +1457,392 @@ void principia__AddVesselToNextPhysicsBubble(Plugin* const plugin,
   }
   CHECK_NOTNULL(plugin)->AddVesselToNextPhysicsBubble(vessel_guid,
                                                       std::move(vessel_parts));
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_add_vessel_to_next_physics_bubble();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_vessel_guid(vessel_guid);
+    for (KSPPart const* part = parts; part < parts + count; ++part) {
+      SerializeKSPPart(*part, message->add_part());
+    }
+    Journal::Global()->Write(entry);
+  }
+}
+
+void principia__AddVesselsToNextPhysicsBubble(
+    Plugin* const plugin,
+    char const* const* const vessel_guids,
+    int const* const part_counts,
+    int const vessel_count,
+    KSPPart const* const parts) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(vessel_count);
+  CHECK_NOTNULL(plugin);
+  CHECK_LE(0, vessel_count);
+  if (vessel_count > 0) {
+    CHECK_NOTNULL(vessel_guids);
+    CHECK_NOTNULL(part_counts);
+    CHECK_NOTNULL(parts);
+  }
+  KSPPart const* vessel_parts = parts;
+  for (int i = 0; i < vessel_count; ++i) {
+    CHECK_LE(0, part_counts[i]);
+    principia__AddVesselToNextPhysicsBubble(plugin,
+                                            vessel_guids[i],
+                                            vessel_parts,
+                                            part_counts[i]);
+    vessel_parts += part_counts[i];
+  }
 }
 
 bool principia__PhysicsBubbleIsEmpty(Plugin const* const plugin) {
-  return CHECK_NOTNULL(plugin)->PhysicsBubbleIsEmpty();
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  bool const result = CHECK_NOTNULL(plugin)->PhysicsBubbleIsEmpty();
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    entry.mutable_physics_bubble_is_empty()->set_plugin(
+        SerializePointer(plugin));
+    Journal::Global()->Write(entry);
+  }
+  return result;
 }
 
 XYZ principia__BubbleDisplacementCorrection(Plugin const* const plugin,
                                             XYZ const sun_position) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
   Displacement<World> const result =
       CHECK_NOTNULL(plugin)->BubbleDisplacementCorrection(
           World::origin + Displacement<World>(
                               ToR3Element(sun_position) * Metre));
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_bubble_displacement_correction();
+    message->set_plugin(SerializePointer(plugin));
+    SerializeXYZ(sun_position, message->mutable_sun_position());
+    Journal::Global()->Write(entry);
+  }
   return ToXYZ(result.coordinates() / Metre);
 }
 
 XYZ principia__BubbleVelocityCorrection(Plugin const* const plugin,
                                         int const reference_body_index) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
   Velocity<World> const result =
       CHECK_NOTNULL(plugin)->BubbleVelocityCorrection(reference_body_index);
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_bubble_velocity_correction();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_reference_body_index(reference_body_index);
+    Journal::Global()->Write(entry);
+  }
   return ToXYZ(result.coordinates() / (Metre / Second));
 }
 
 double principia__current_time(Plugin const* const plugin) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
   return (CHECK_NOTNULL(plugin)->current_time() - Instant()) / Second;
 }
 
+StateTable const* principia__StateTable(Plugin const* const plugin) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  return &CHECK_NOTNULL(plugin)->state_table();
+}
+
+void principia__SetHistoryRetention(Plugin* const plugin,
+                                    double const maximum_age,
+                                    int64_t const maximum_points) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin)->SetHistoryRetention(maximum_age * Second,
+                                             maximum_points);
+}
+
+void principia__SetCelestialHistoryCheckpoints(
+    Plugin* const plugin,
+    int const steps_between_checkpoints,
+    int const cached_segments) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin)->SetCelestialHistoryCheckpoints(
+      steps_between_checkpoints,
+      cached_segments);
+}
+
+void principia__SetNumberOfThreads(Plugin* const plugin,
+                                   int const number_of_threads) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin)->SetNumberOfThreads(number_of_threads);
+}
+
+void principia__TuneKernels(Plugin* const plugin,
+                            char const* const filename) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin)->SetKernelConfiguration(
+      ReadOrTuneKernelConfiguration(CHECK_NOTNULL(filename)));
+}
+
+void principia__SetKernelConfiguration(
+    Plugin* const plugin,
+    int const number_of_threads,
+    int const massless_chunks_per_thread,
+    int const maximum_vector_instruction_set) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_LE(static_cast<int>(VectorInstructionSet::kNone),
+           maximum_vector_instruction_set);
+  CHECK_GE(static_cast<int>(VectorInstructionSet::kAVX512F),
+           maximum_vector_instruction_set);
+  KernelConfiguration configuration;
+  configuration.number_of_threads = number_of_threads;
+  configuration.massless_chunks_per_thread = massless_chunks_per_thread;
+  configuration.maximum_vector_instruction_set =
+      static_cast<VectorInstructionSet>(maximum_vector_instruction_set);
+  CHECK_NOTNULL(plugin)->SetKernelConfiguration(configuration);
+}
+
+void principia__SetProfiling(Plugin* const plugin, bool const enabled) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin)->SetProfiling(enabled);
+}
+
+AdvanceTimeProfile principia__GetProfile(Plugin const* const plugin) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  Plugin::Profile const profile = CHECK_NOTNULL(plugin)->profile();
+  return {profile.advance_time_calls,
+          profile.clean_up_vessels / Second,
+          profile.prepare_bubble / Second,
+          profile.evolve_histories / Second,
+          profile.synchronization / Second,
+          profile.reset_prolongations / Second,
+          profile.evolve_prolongations_and_bubble / Second,
+          profile.force_evaluations,
+          profile.history_steps,
+          profile.points_appended,
+          profile.advance_time_allocations.allocations,
+          profile.advance_time_allocations.bytes,
+          profile.render_calls,
+          profile.render_allocations.allocations,
+          profile.render_allocations.bytes};
+}
+
+void principia__SetConservationMonitoring(Plugin* const plugin,
+                                          int const period) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin)->SetConservationMonitoring(period);
+}
+
+ConservationDrift principia__GetConservationDrift(Plugin const* const plugin) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  Plugin::ConservationDrift const drift =
+      CHECK_NOTNULL(plugin)->conservation_drift();
+  return {drift.samples,
+          drift.energy,
+          drift.angular_momentum,
+          drift.maximum_energy,
+          drift.maximum_angular_momentum};
+}
+
+MemoryUsage principia__GetMemoryUsage(Plugin const* const plugin) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  Plugin::MemoryUsage const usage = CHECK_NOTNULL(plugin)->memory_usage();
+  return {usage.celestials, usage.vessels, usage.bubble};
+}
+
+int64_t principia__VesselMemoryUsage(Plugin const* const plugin,
+                                     char const* vessel_guid) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  return CHECK_NOTNULL(plugin)->VesselMemoryUsage(vessel_guid);
+}
+
+int64_t principia__CelestialMemoryUsage(Plugin const* const plugin,
+                                        int const celestial_index) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  return CHECK_NOTNULL(plugin)->CelestialMemoryUsage(celestial_index);
+}
+
+int64_t principia__TransformsMemoryUsage(
+    Transforms<Barycentric, Rendering, Barycentric> const* const transforms) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  return CHECK_NOTNULL(transforms)->MemoryUsage();
+}
+
+void principia__WritePluginToFile(Plugin const* const plugin,
+                                  char const* filename) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin);
+  CHECK_NOTNULL(filename);
+  LOG(INFO) << "Writing plugin to " << filename;
+  std::vector<PluginRecord> records;
+  plugin->WriteToUncompressedRecords(
+      [&records](not_null<PluginRecord*> const record) {
+        records.emplace_back();
+        records.back().Swap(record);
+      });
+  WriteUncompressedRecordsToFile(filename, records);
+  LOG(INFO) << "Plugin written";
+}
+
+void principia__WritePluginIncrementToFile(Plugin const* const plugin,
+                                           char const* filename,
+                                           char const* base_filename) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin);
+  CHECK_NOTNULL(filename);
+  CHECK_NOTNULL(base_filename);
+  // Only the header of the base is read.
+  PluginRecord base_header;
+  ReadRecordsFromFile(base_filename,
+                      [&base_header, base_filename](
+                          RecordSource const& source) {
+                        CHECK(source(&base_header)) << base_filename;
+                      });
+  CHECK(base_header.has_header()) << base_filename;
+  CHECK(base_header.header().has_history_time())
+      << base_filename << " was written by an older version of Principia";
+  Instant const since =
+      Instant::ReadFromMessage(base_header.header().history_time());
+  LOG(INFO) << "Writing plugin increment over " << base_filename << " to "
+            << filename;
+  WriteRecordsToFile(filename,
+                     [plugin, &since](RecordSink const& sink) {
+                       plugin->WriteIncrementToRecords(since, sink);
+                     });
+  LOG(INFO) << "Plugin increment written";
+}
+
+void principia__CompactPluginFiles(char const* base_filename,
+                                   char const* increment_filename,
+                                   char const* filename) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  CHECK_NOTNULL(base_filename);
+  CHECK_NOTNULL(increment_filename);
+  CHECK_NOTNULL(filename);
+  LOG(INFO) << "Compacting " << base_filename << " and " << increment_filename
+            << " to " << filename;
+  std::vector<PluginRecord> records =
+      Plugin::CompactRecords(ReadAllRecordsFromFile(base_filename),
+                             ReadAllRecordsFromFile(increment_filename));
+  WriteRecordsToFile(filename,
+                     [&records](RecordSink const& sink) {
+                       for (auto& record : records) {
+                         sink(&record);
+                       }
+                     });
+  LOG(INFO) << "Plugin files compacted";
+}
+
+PluginSave* principia__StartWritingPluginToFile(Plugin const* const plugin,
+                                                char const* filename) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  CHECK_NOTNULL(plugin);
+  CHECK_NOTNULL(filename);
+  LOG(INFO) << "Starting to write plugin to " << filename;
+  not_null<std::unique_ptr<PluginSave>> plugin_save =
+      make_not_null_unique<PluginSave>(filename);
+  std::vector<PluginRecord>& records = plugin_save->records;
+  plugin->WriteToUncompressedRecords(
+      [&records](not_null<PluginRecord*> const record) {
+        records.emplace_back();
+        records.back().Swap(record);
+      });
+  plugin_save->written = std::async(std::launch::async,
+                                    WritePluginSave,
+                                    plugin_save.get());
+  return plugin_save.release();
+}
+
+bool principia__PluginSaveCompleted(PluginSave const* const plugin_save) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  return CHECK_NOTNULL(plugin_save)->written.wait_for(
+             std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void principia__DeletePluginSave(PluginSave** const plugin_save) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  std::unique_ptr<PluginSave> const owned_plugin_save =
+      TakeOwnership(plugin_save);
+  CHECK_NOTNULL(owned_plugin_save.get())->written.get();
+}
+
+Plugin* principia__ReadPluginFromFile(char const* filename) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  CHECK_NOTNULL(filename);
+  LOG(INFO) << "Reading plugin from " << filename;
+  std::unique_ptr<Plugin> plugin;
+  ReadRecordsFromFile(filename,
+                      [&plugin](RecordSource const& source) {
+                        plugin = Plugin::ReadFromRecords(source);
+                      });
+  LOG(INFO) << "Plugin read";
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_read_plugin_from_file();
+    message->set_filename(filename);
+    message->set_result(SerializePointer(plugin.get()));
+    Journal::Global()->Write(entry);
+  }
+  return plugin.release();
+}
+
+int64_t principia__SaveCheckpoint(Plugin* const plugin) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  int64_t const result = CHECK_NOTNULL(plugin)->SaveCheckpoint();
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_save_checkpoint();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_result(result);
+    Journal::Global()->Write(entry);
+  }
+  return result;
+}
+
+bool principia__HasCheckpoint(Plugin const* const plugin,
+                              int64_t const checkpoint_id) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  return CHECK_NOTNULL(plugin)->HasCheckpoint(checkpoint_id);
+}
+
+Plugin* principia__RestoreCheckpoint(Plugin const* const plugin,
+                                     int64_t const checkpoint_id) {
+  ScopedCallTimer const call_timer(__FUNCTION__);
+  DrainCommandQueues();
+  std::unique_ptr<Plugin> result =
+      CHECK_NOTNULL(plugin)->RestoreCheckpoint(checkpoint_id);
+  if (Journal::Global()->enabled()) {
+    JournalEntry entry;
+    auto* const message = entry.mutable_restore_checkpoint();
+    message->set_plugin(SerializePointer(plugin));
+    message->set_checkpoint_id(checkpoint_id);
+    message->set_result(SerializePointer(result.get()));
+    Journal::Global()->Write(entry);
+  }
+  return result.release();
+}
+
 char const* principia__SayHello() {
+  ScopedCallTimer const call_timer(__FUNCTION__);
   return "Hello from native C++!";
 }
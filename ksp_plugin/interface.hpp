@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <future>
+#include <string>
 #include <type_traits>
+#include <vector>
 
 #include "base/macros.hpp"
 #include "ksp_plugin/plugin.hpp"
@@ -16,13 +20,29 @@ struct LineAndIterator {
   RenderedTrajectory<World>::const_iterator it;
 };
 
+// A plugin being written to a file on a background thread, see
+// |principia__StartWritingPluginToFile|.
+struct PluginSave {
+  explicit PluginSave(std::string const& filename) : filename(filename) {}
+  std::string const filename;
+  // The records of the plugin, with uncompressed trajectories, see
+  // |Plugin::WriteToUncompressedRecords|.  Only accessed by the background
+  // thread once it is started.
+  std::vector<serialization::PluginRecord> records;
+  // Declared last, so that it is destroyed, and the background thread joined,
+  // before the records.
+  std::future<void> written;
+};
+
 }  // namespace ksp_plugin
 }  // namespace principia
 
 using principia::ksp_plugin::Barycentric;
 using principia::ksp_plugin::LineAndIterator;
 using principia::ksp_plugin::Plugin;
+using principia::ksp_plugin::PluginSave;
 using principia::ksp_plugin::Rendering;
+using principia::ksp_plugin::VesselHandle;
 using principia::physics::Transforms;
 
 extern "C"
@@ -61,6 +81,62 @@ struct KSPPart {
 static_assert(std::is_standard_layout<KSPPart>::value,
               "KSPPart is used for interfacing");
 
+// See |Plugin::Profile|.  The durations are in seconds.
+extern "C"
+struct AdvanceTimeProfile {
+  int advance_time_calls;
+  double clean_up_vessels;
+  double prepare_bubble;
+  double evolve_histories;
+  double synchronization;
+  double reset_prolongations;
+  double evolve_prolongations_and_bubble;
+  int64_t force_evaluations;
+  int64_t history_steps;
+  int64_t points_appended;
+  int64_t advance_time_allocations;
+  int64_t advance_time_allocated_bytes;
+  int render_calls;
+  int64_t render_allocations;
+  int64_t render_allocated_bytes;
+};
+
+static_assert(std::is_standard_layout<AdvanceTimeProfile>::value,
+              "AdvanceTimeProfile is used for interfacing");
+
+// See |Plugin::ConservationDrift|.
+extern "C"
+struct ConservationDrift {
+  int samples;
+  double energy;
+  double angular_momentum;
+  double maximum_energy;
+  double maximum_angular_momentum;
+};
+
+static_assert(std::is_standard_layout<ConservationDrift>::value,
+              "ConservationDrift is used for interfacing");
+
+// See |Plugin::MemoryUsage|.  In bytes.
+extern "C"
+struct MemoryUsage {
+  int64_t celestials;
+  int64_t vessels;
+  int64_t bubble;
+};
+
+static_assert(std::is_standard_layout<MemoryUsage>::value,
+              "MemoryUsage is used for interfacing");
+
+// See |Plugin::StateTable|.
+using PublishedState = Plugin::PublishedState;
+using StateTable = Plugin::StateTable;
+
+static_assert(std::is_standard_layout<PublishedState>::value,
+              "PublishedState is used for interfacing");
+static_assert(std::is_standard_layout<StateTable>::value,
+              "StateTable is used for interfacing");
+
 // Sets stderr to log INFO, and redirects stderr, which Unity does not log, to
 // "<KSP directory>/stderr.log".  This provides an easily accessible file
 // containing a sufficiently verbose log of the latest session, instead of
@@ -99,6 +175,16 @@ extern "C" DLLEXPORT
 void CDECL principia__SetStderrLogging(int const min_severity);
 extern "C" DLLEXPORT
 int CDECL principia__GetStderrLogging();
+// If |enabled|, the log files are written by background threads, so that
+// verbose logging doesn't stall the caller on file I/O.  The messages that are
+// not buffered, see |principia__SetBufferedLogging|, are still on disk when
+// the call that logs them returns.  The messages logged to stderr are written
+// synchronously.  Asynchronous logging should be disabled before unloading the
+// plugin, otherwise the pending messages may be lost.
+extern "C" DLLEXPORT
+void CDECL principia__SetAsynchronousLogging(bool const enabled);
+extern "C" DLLEXPORT
+bool CDECL principia__GetAsynchronousLogging();
 
 // Exports |LOG(SEVERITY) << message| for fast logging from the C# adapter.
 // This will always evaluate its argument even if the corresponding log severity
@@ -113,6 +199,42 @@ void CDECL principia__LogError(char const* message);
 extern "C" DLLEXPORT
 void CDECL principia__LogFatal(char const* message);
 
+// Starts recording a timeline of the native calls to the file |filename|, in
+// the Chrome trace event format, which can be loaded in chrome://tracing or
+// Perfetto.  The file is overwritten.  Tracing must not already be started.
+extern "C" DLLEXPORT
+void CDECL principia__StartTracing(char const* filename);
+// Stops recording the timeline and closes the file.  Does nothing if tracing
+// is not started.
+extern "C" DLLEXPORT
+void CDECL principia__StopTracing();
+
+// Starts recording a journal of the calls to the functions of this interface
+// which change the state of the plugin or which compute something for the
+// game, to the file |filename|, see serialization/journal.proto.  The file is
+// overwritten.  The journal must not already be started.  The journal can only
+// be replayed if it is started before the plugin is constructed or read.
+extern "C" DLLEXPORT
+void CDECL principia__StartJournaling(char const* filename);
+// Stops recording the journal and closes the file.  Does nothing if the
+// journal is not started.
+extern "C" DLLEXPORT
+void CDECL principia__StopJournaling();
+
+// Starts counting the calls to each function of this interface and recording
+// the histograms of their durations, see |base::CallStatistics|.  Clears the
+// previous statistics.
+extern "C" DLLEXPORT
+void CDECL principia__StartInterfaceStatistics();
+// Stops counting the calls; the statistics are kept.
+extern "C" DLLEXPORT
+void CDECL principia__StopInterfaceStatistics();
+// Logs the statistics of the calls to the functions of this interface since
+// the last call to |principia__StartInterfaceStatistics|, by decreasing total
+// duration.
+extern "C" DLLEXPORT
+void CDECL principia__DumpInterfaceStatistics();
+
 // Returns a pointer to a plugin constructed with the arguments given.
 // The caller takes ownership of the result.
 extern "C" DLLEXPORT
@@ -137,6 +259,20 @@ void CDECL principia__InsertCelestial(Plugin* const plugin,
                                       int const parent_index,
                                       QP const from_parent);
 
+// Calls |plugin->InsertCelestials| with the |count| celestials whose arguments
+// for |principia__InsertCelestial| are given by the elements of
+// |celestial_indices|, |gravitational_parameters|, |parent_indices| and
+// |from_parents|.  The parents need not precede their children.
+// |plugin| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+void CDECL principia__InsertCelestials(
+    Plugin* const plugin,
+    int const* const celestial_indices,
+    double const* const gravitational_parameters,
+    int const* const parent_indices,
+    QP const* const from_parents,
+    int const count);
+
 // Calls |plugin->UpdateCelestialHierarchy| with the arguments given.
 // |plugin| must not be null.  No transfer of ownership.
 extern "C" DLLEXPORT
@@ -149,6 +285,27 @@ void CDECL principia__UpdateCelestialHierarchy(Plugin const* const plugin,
 extern "C" DLLEXPORT
 void CDECL principia__EndInitialization(Plugin* const plugin);
 
+// Returns |plugin->LoadEphemerisFile(filename)|.  |plugin| and |filename| must
+// not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+bool CDECL principia__LoadEphemerisFile(Plugin* const plugin,
+                                        char const* filename);
+
+// Calls |plugin->WriteEphemerisFile| with the arguments given.  |plugin| and
+// |filename| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+void CDECL principia__WriteEphemerisFile(Plugin* const plugin,
+                                         char const* filename,
+                                         double const t_max,
+                                         int const steps_per_series,
+                                         int const degree);
+
+// Calls |plugin->WriteTrajectoryFile| with the arguments given.  |plugin| and
+// |filename| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+void CDECL principia__WriteTrajectoryFile(Plugin const* const plugin,
+                                          char const* filename);
+
 // Calls |plugin->InsertOrKeepVessel| with the arguments given.
 // |plugin| must not be null.  No transfer of ownership.
 extern "C" DLLEXPORT
@@ -156,30 +313,131 @@ bool CDECL principia__InsertOrKeepVessel(Plugin* const plugin,
                                          char const* vessel_guid,
                                          int const parent_index);
 
-// Calls |plugin->SetVesselStateOffset| with the arguments given.
+// Calls |plugin->SetVesselStateOffset| with the arguments given, on the
+// simulation thread if |principia__SetAsynchronousAdvanceTime| is enabled.
 // |plugin| must not be null.  No transfer of ownership.
 extern "C" DLLEXPORT
 void CDECL principia__SetVesselStateOffset(Plugin* const plugin,
                                            char const* vessel_guid,
                                            QP const from_parent);
 
+// Calls |plugin->AdvanceTime| with the arguments given, on the simulation
+// thread if |principia__SetAsynchronousAdvanceTime| is enabled.  |plugin| must
+// not be null.
 extern "C" DLLEXPORT
 void CDECL principia__AdvanceTime(Plugin* const plugin,
                                   double const t,
                                   double const planetarium_rotation);
 
+// If |enabled|, |principia__AdvanceTime| and |principia__SetVesselStateOffset|
+// enqueue their calls for execution on a simulation thread and return without
+// waiting for them; the other functions that use |plugin|, or the transforms,
+// first wait until the enqueued calls have been executed.  Otherwise, and by
+// default, all the calls are executed on the calling thread.  Disabling waits
+// for the enqueued calls.  |plugin| must not be null.
+extern "C" DLLEXPORT
+void CDECL principia__SetAsynchronousAdvanceTime(Plugin* const plugin,
+                                                 bool const enabled);
+
+extern "C" DLLEXPORT
+bool CDECL principia__GetAsynchronousAdvanceTime(Plugin const* const plugin);
+
+// Calls |plugin->FastForward| with the arguments given, without reporting the
+// progress.  |plugin| must not be null.
+extern "C" DLLEXPORT
+void CDECL principia__FastForward(Plugin* const plugin,
+                                  double const t,
+                                  double const planetarium_rotation);
+
+// Returns |plugin->vessel_handle(vessel_guid)|.  The functions whose names end
+// in |ByHandle| take a handle returned by this function instead of a GUID.
+// |plugin| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+VesselHandle CDECL principia__VesselHandle(Plugin const* const plugin,
+                                           char const* vessel_guid);
+
+// Calls |plugin->InsertVessels| with the |count| elements of |vessel_guids|,
+// |parent_indices| and |from_parents|, and stores the resulting handles in
+// |vessel_handles|.  The arrays must have at least |count| elements if |count|
+// is positive.  |plugin| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+void CDECL principia__InsertVessels(Plugin* const plugin,
+                                    char const* const* const vessel_guids,
+                                    int const* const parent_indices,
+                                    QP const* const from_parents,
+                                    int const count,
+                                    VesselHandle* const vessel_handles);
+
+// Calls |plugin->KeepVessels| with the |count| handles in |vessel_handles|,
+// which must point to an array of at least |count| elements if |count| is
+// positive.  |plugin| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+void CDECL principia__KeepVessels(Plugin* const plugin,
+                                  VesselHandle const* const vessel_handles,
+                                  int const count);
+
+// Calls |plugin->RemoveVessel| with the arguments given.
+// |plugin| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+void CDECL principia__RemoveVessel(Plugin* const plugin,
+                                   char const* vessel_guid);
+
 // Calls |plugin->VesselFromParent| with the arguments given.
 // |plugin| must not be null.  No transfer of ownership.
 extern "C" DLLEXPORT
 QP CDECL principia__VesselFromParent(Plugin const* const plugin,
                                      char const* vessel_guid);
 
+extern "C" DLLEXPORT
+QP CDECL principia__VesselFromParentByHandle(Plugin const* const plugin,
+                                             VesselHandle const vessel_handle);
+
+// Calls |plugin->VesselFromParent| for each of the |count| GUIDs in
+// |vessel_guids| and stores the results in the corresponding elements of
+// |from_parents|.  This does all the queries of a frame in a single call.
+// |plugin| must not be null.  |vessel_guids| and |from_parents| must point to
+// arrays of at least |count| elements.  No transfer of ownership.
+extern "C" DLLEXPORT
+void CDECL principia__VesselsFromParent(Plugin const* const plugin,
+                                        char const* const* const vessel_guids,
+                                        int const count,
+                                        QP* const from_parents);
+
+extern "C" DLLEXPORT
+void CDECL principia__VesselsFromParentByHandle(
+    Plugin const* const plugin,
+    VesselHandle const* const vessel_handles,
+    int const count,
+    QP* const from_parents);
+
 // Calls |plugin->CelestialFromParent| with the arguments given.
 // |plugin| must not be null.  No transfer of ownership.
 extern "C" DLLEXPORT
 QP CDECL principia__CelestialFromParent(Plugin const* const plugin,
                                         int const celestial_index);
 
+// Call |plugin->VesselFromParentAt| and |plugin->CelestialFromParentAt| with
+// the arguments given, |t| being the time in seconds.
+// |plugin| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+QP CDECL principia__VesselFromParentAt(Plugin const* const plugin,
+                                       VesselHandle const vessel_handle,
+                                       double const t);
+
+extern "C" DLLEXPORT
+QP CDECL principia__CelestialFromParentAt(Plugin const* const plugin,
+                                          int const celestial_index,
+                                          double const t);
+
+// Calls |plugin->AllCelestialsFromParent| and stores its result in
+// |from_parents|, which must have room for |count| elements.  |count| must be
+// the number of celestials other than the sun.
+// |plugin| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+void CDECL principia__AllCelestialsFromParent(Plugin const* const plugin,
+                                              int const count,
+                                              QP* const from_parents);
+
 // Calls |plugin->NewBodyCentredNonRotatingFrame| with the arguments given.
 // |plugin| must not be null.  The caller gets ownership of the returned object.
 extern "C" DLLEXPORT
@@ -195,6 +453,23 @@ principia__NewBarycentricRotatingTransforms(Plugin const* const plugin,
                                             int const primary_index,
                                             int const secondary_index);
 
+// Returns |plugin->BodyCentredNonRotatingTransforms(reference_body_index)|.
+// |plugin| must not be null.  No transfer of ownership: the result is owned by
+// |plugin| and must not be deleted with |principia__DeleteTransforms|.
+extern "C" DLLEXPORT
+Transforms<Barycentric, Rendering, Barycentric>* CDECL
+principia__BodyCentredNonRotatingTransforms(Plugin* const plugin,
+                                            int const reference_body_index);
+
+// Returns |plugin->BarycentricRotatingTransforms(primary_index,
+// secondary_index)|.  |plugin| must not be null.  No transfer of ownership, as
+// above.
+extern "C" DLLEXPORT
+Transforms<Barycentric, Rendering, Barycentric>* CDECL
+principia__BarycentricRotatingTransforms(Plugin* const plugin,
+                                         int const primary_index,
+                                         int const secondary_index);
+
 // Deletes and nulls |*transforms|.
 // |transforms| must not be null.  No transfer of ownership of |*transforms|,
 // takes ownership of |**transforms|.
@@ -203,7 +478,9 @@ void CDECL principia__DeleteTransforms(
     Transforms<Barycentric, Rendering, Barycentric>** const transforms);
 
 // Returns the result of |plugin->RenderedVesselTrajectory| called with the
-// arguments given, together with an iterator to its beginning.
+// arguments given, together with an iterator to its beginning.  |tolerance| is
+// in metres, 0 means that the trajectory is not simplified.  |begin_time| is in
+// seconds, on the same scale as the argument of |principia__AdvanceTime|.
 // |plugin| must not be null.  No transfer of ownership of |plugin|.  The caller
 // gets ownership of the result.  |frame| must not be null.  No transfer of
 // ownership of |frame|.
@@ -212,7 +489,28 @@ LineAndIterator* CDECL principia__RenderedVesselTrajectory(
     Plugin const* const plugin,
     char const* vessel_guid,
     Transforms<Barycentric, Rendering, Barycentric>* const transforms,
-    XYZ const sun_world_position);
+    XYZ const sun_world_position,
+    double const tolerance,
+    double const begin_time);
+
+// Calls |plugin->RenderedVesselTrajectories| for the |count| GUIDs in
+// |vessel_guids| and stores the results, together with iterators to their
+// beginnings, in the corresponding elements of |line_and_iterators|.  The other
+// arguments are the same as for |principia__RenderedVesselTrajectory|.
+// |plugin| must not be null.  |vessel_guids| and |line_and_iterators| must
+// point to arrays of at least |count| elements.  No transfer of ownership of
+// |plugin| and |frame|.  The caller gets ownership of the elements of
+// |line_and_iterators|.
+extern "C" DLLEXPORT
+void CDECL principia__RenderedVesselTrajectories(
+    Plugin const* const plugin,
+    char const* const* const vessel_guids,
+    int const count,
+    Transforms<Barycentric, Rendering, Barycentric>* const transforms,
+    XYZ const sun_world_position,
+    double const tolerance,
+    double const begin_time,
+    LineAndIterator** const line_and_iterators);
 
 // Returns |line_and_iterator->rendered_trajectory.size()|.
 // |line_and_iterator| must not be null.  No transfer of ownership.
@@ -228,6 +526,44 @@ extern "C" DLLEXPORT
 XYZSegment CDECL principia__FetchAndIncrement(
     LineAndIterator* const line_and_iterator);
 
+// Fills |segments[0 .. n[| with the |XYZSegment|s corresponding to the
+// |LineSegment|s starting at |*line_and_iterator->it|, where |n| is the
+// smaller of |max_segments| and of the number of segments left, then advances
+// |line_and_iterator->it| by |n| and returns |n|.  This fetches many segments
+// in a single call, where |principia__FetchAndIncrement| fetches one.
+// |line_and_iterator| must not be null.  |segments| must point to an array of
+// at least |max_segments| elements.  No transfer of ownership.
+extern "C" DLLEXPORT
+int CDECL principia__FetchSegments(LineAndIterator* const line_and_iterator,
+                                   int const max_segments,
+                                   XYZSegment* const segments);
+
+// Returns the number of vertices of the polyline
+// |line_and_iterator->rendered_trajectory|, where the end of a segment and the
+// beginning of the next one are a single vertex if they are equal.
+// |line_and_iterator| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+int CDECL principia__NumberOfVertices(
+    LineAndIterator const* const line_and_iterator);
+
+// Fills |vertices[0 .. 3 * n[|, where |n| is the result of
+// |principia__NumberOfVertices|, with the coordinates in metres of the
+// vertices of |line_and_iterator->rendered_trajectory| relative to |origin|, as
+// single-precision floats.  Fills |indices[0 .. 2 * m[|, where |m| is the
+// result of |principia__NumberOfSegments|, with the indices of the vertices of
+// each segment.  The buffers may be used directly as the vertices and indices
+// of a mesh made of lines.  The coordinates are precise if |origin| is near the
+// trajectory, e.g., at the camera.  |line_and_iterator->it| is neither used
+// nor changed.
+// |line_and_iterator| must not be null.  |vertices| and |indices| must point to
+// arrays of at least |3 * n| and |2 * m| elements.  No transfer of ownership.
+extern "C" DLLEXPORT
+void CDECL principia__FetchVertices(
+    LineAndIterator const* const line_and_iterator,
+    XYZ const origin,
+    float* const vertices,
+    int* const indices);
+
 // Returns |true| if and only if |line_and_iterator->it| is the end of
 // |line_and_iterator->rendered_trajectory|.
 // |line_and_iterator| must not be null.  No transfer of ownership.
@@ -252,12 +588,114 @@ XYZ CDECL principia__VesselWorldVelocity(Plugin const* const plugin,
                                          XYZ const parent_world_velocity,
                                          double const parent_rotation_period);
 
+extern "C" DLLEXPORT
+XYZ CDECL principia__VesselWorldPositionByHandle(
+    Plugin const* const plugin,
+    VesselHandle const vessel_handle,
+    XYZ const parent_world_position);
+
+// Calls |plugin->VesselWorldPositionAt| with the arguments given, |t| being
+// the time in seconds.
+// |plugin| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+XYZ CDECL principia__VesselWorldPositionAt(Plugin const* const plugin,
+                                           VesselHandle const vessel_handle,
+                                           XYZ const parent_world_position,
+                                           double const t);
+
+extern "C" DLLEXPORT
+XYZ CDECL principia__VesselWorldVelocityByHandle(
+    Plugin const* const plugin,
+    VesselHandle const vessel_handle,
+    XYZ const parent_world_velocity,
+    double const parent_rotation_period);
+
+// Batched versions of |principia__VesselWorldPosition| and
+// |principia__VesselWorldVelocity|: the arguments and results for the |i|th
+// vessel are the |i|th elements of the arrays.  |plugin| must not be null.  All
+// the arrays must have at least |count| elements.  No transfer of ownership.
+extern "C" DLLEXPORT
+void CDECL principia__VesselsWorldPositions(
+    Plugin const* const plugin,
+    char const* const* const vessel_guids,
+    int const count,
+    XYZ const* const parent_world_positions,
+    XYZ* const world_positions);
+
+extern "C" DLLEXPORT
+void CDECL principia__VesselsWorldVelocities(
+    Plugin const* const plugin,
+    char const* const* const vessel_guids,
+    int const count,
+    XYZ const* const parent_world_velocities,
+    double const* const parent_rotation_periods,
+    XYZ* const world_velocities);
+
+// Fills |vessel_handles[0 .. n[| with the first elements of the result of
+// |plugin->VesselsWithinRadius(vessel_guid, radius)|, where |n| is the smaller
+// of |max_vessels| and of the size of that result, and returns |n|.  |radius|
+// is in metres.  |plugin| must not be null.  |vessel_handles| must point to an
+// array of at least |max_vessels| elements.  No transfer of ownership.
+extern "C" DLLEXPORT
+int CDECL principia__VesselsWithinRadius(Plugin const* const plugin,
+                                         char const* vessel_guid,
+                                         double const radius,
+                                         int const max_vessels,
+                                         VesselHandle* const vessel_handles);
+
+// Calls |plugin->ClosestVessel| with the arguments given, with |*distance| in
+// metres.  |plugin|, |closest| and |distance| must not be null.  No transfer of
+// ownership.
+extern "C" DLLEXPORT
+bool CDECL principia__ClosestVessel(Plugin const* const plugin,
+                                    char const* vessel_guid,
+                                    VesselHandle* const closest,
+                                    double* const distance);
+
+// Calls |plugin->DominantBodies| for the |count| GUIDs in |vessel_guids| and
+// stores the results in the corresponding elements of |parent_indices|.
+// |plugin| must not be null.  |vessel_guids| and |parent_indices| must point to
+// arrays of at least |count| elements.  No transfer of ownership.
+extern "C" DLLEXPORT
+void CDECL principia__DominantBodies(Plugin const* const plugin,
+                                     char const* const* const vessel_guids,
+                                     int const count,
+                                     int* const parent_indices);
+
+// Fills |delta_v[0 .. departure_points * arrival_points[| with the result of
+// |plugin->PorkchopPlot| in m/s.  The times are in seconds.  |plugin| and
+// |delta_v| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+void CDECL principia__PorkchopPlot(Plugin const* const plugin,
+                                   int const departure_index,
+                                   int const arrival_index,
+                                   double const departure_min,
+                                   double const departure_max,
+                                   int const departure_points,
+                                   double const arrival_min,
+                                   double const arrival_max,
+                                   int const arrival_points,
+                                   double const step,
+                                   double* const delta_v);
+
 extern "C" DLLEXPORT
 void CDECL principia__AddVesselToNextPhysicsBubble(Plugin* const plugin,
                                                    char const* vessel_guid,
                                                    KSPPart const* const parts,
                                                    int count);
 
+// Same as |principia__AddVesselToNextPhysicsBubble| for |vessel_count|
+// vessels.  The parts of all the vessels are in the single array |parts|: those
+// of |vessel_guids[i]| follow those of |vessel_guids[i - 1]|, and there are
+// |part_counts[i]| of them.
+extern "C" DLLEXPORT
+void CDECL principia__AddVesselsToNextPhysicsBubble(
+    Plugin* const plugin,
+    char const* const* const vessel_guids,
+    int const* const part_counts,
+    int const vessel_count,
+    KSPPart const* const parts);
+
 extern "C" DLLEXPORT
 bool CDECL principia__PhysicsBubbleIsEmpty(Plugin const* const plugin);
 
@@ -272,6 +710,178 @@ XYZ CDECL principia__BubbleVelocityCorrection(Plugin const* const plugin,
 extern "C" DLLEXPORT
 double CDECL principia__current_time(Plugin const* const plugin);
 
+// Returns |&plugin->state_table()|.  The result is valid for the lifetime of
+// |plugin|, and is updated in place by each |principia__AdvanceTime|, so the
+// adapter only needs to fetch it once.  It must only be read on the thread that
+// calls |principia__AdvanceTime|.  If |principia__SetAsynchronousAdvanceTime|
+// is enabled, it must also only be read after a function that waits for the
+// enqueued calls, e.g., this one, has been called since the last
+// |principia__AdvanceTime|.  |plugin| must not be null.
+extern "C" DLLEXPORT
+StateTable const* CDECL principia__StateTable(Plugin const* const plugin);
+
+// Calls |plugin->SetHistoryRetention| with the given arguments, where
+// |maximum_age| is in seconds.  |plugin| must not be null.
+extern "C" DLLEXPORT
+void CDECL principia__SetHistoryRetention(Plugin* const plugin,
+                                          double const maximum_age,
+                                          int64_t const maximum_points);
+
+// Calls |plugin->SetCelestialHistoryCheckpoints| with the given arguments.
+// |plugin| must not be null.
+extern "C" DLLEXPORT
+void CDECL principia__SetCelestialHistoryCheckpoints(
+    Plugin* const plugin,
+    int const steps_between_checkpoints,
+    int const cached_segments);
+
+// Calls |plugin->SetNumberOfThreads(number_of_threads)|.  |plugin| must not be
+// null.
+extern "C" DLLEXPORT
+void CDECL principia__SetNumberOfThreads(Plugin* const plugin,
+                                         int const number_of_threads);
+
+// Calls |plugin->SetKernelConfiguration| with the result of
+// |ReadOrTuneKernelConfiguration(filename)|: the configuration is read from
+// |filename| if it was tuned for this processor, otherwise the kernels are
+// tuned, which takes a fraction of a second, and the result is written to
+// |filename|.  Must not be called while the plugin is integrating on another
+// thread.  |plugin| and |filename| must not be null.
+extern "C" DLLEXPORT
+void CDECL principia__TuneKernels(Plugin* const plugin,
+                                  char const* const filename);
+
+// Calls |plugin->SetKernelConfiguration| with the given parameters, overriding
+// the result of |principia__TuneKernels|.  |maximum_vector_instruction_set| is
+// 0 for none, 1 for AVX, 2 for AVX-512F.  |plugin| must not be null.
+extern "C" DLLEXPORT
+void CDECL principia__SetKernelConfiguration(
+    Plugin* const plugin,
+    int const number_of_threads,
+    int const massless_chunks_per_thread,
+    int const maximum_vector_instruction_set);
+
+// Calls |plugin->SetProfiling(enabled)|.  |plugin| must not be null.
+extern "C" DLLEXPORT
+void CDECL principia__SetProfiling(Plugin* const plugin, bool const enabled);
+
+// Returns |plugin->profile()|.  |plugin| must not be null.
+extern "C" DLLEXPORT
+AdvanceTimeProfile CDECL principia__GetProfile(Plugin const* const plugin);
+
+// Calls |plugin->SetConservationMonitoring(period)|.  |plugin| must not be
+// null.
+extern "C" DLLEXPORT
+void CDECL principia__SetConservationMonitoring(Plugin* const plugin,
+                                                int const period);
+
+// Returns |plugin->conservation_drift()|.  |plugin| must not be null.
+extern "C" DLLEXPORT
+ConservationDrift CDECL principia__GetConservationDrift(
+    Plugin const* const plugin);
+
+// Returns |plugin->memory_usage()|.  |plugin| must not be null.
+extern "C" DLLEXPORT
+MemoryUsage CDECL principia__GetMemoryUsage(Plugin const* const plugin);
+
+// Returns |plugin->VesselMemoryUsage(vessel_guid)|.  |plugin| must not be
+// null.
+extern "C" DLLEXPORT
+int64_t CDECL principia__VesselMemoryUsage(Plugin const* const plugin,
+                                           char const* vessel_guid);
+
+// Returns |plugin->CelestialMemoryUsage(celestial_index)|.  |plugin| must not
+// be null.
+extern "C" DLLEXPORT
+int64_t CDECL principia__CelestialMemoryUsage(Plugin const* const plugin,
+                                              int const celestial_index);
+
+// Returns |transforms->MemoryUsage()|, the memory used by the caches of
+// |transforms|.  |transforms| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+int64_t CDECL principia__TransformsMemoryUsage(
+    Transforms<Barycentric, Rendering, Barycentric> const* const transforms);
+
+// Writes |plugin| to the file |filename| as a sequence of length-delimited
+// |serialization::PluginRecord|s, see |Plugin::WriteToRecords|.  The records
+// are compressed and encoded in parallel, one per thread.  The file is
+// overwritten.  |plugin| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+void CDECL principia__WritePluginToFile(Plugin const* const plugin,
+                                        char const* filename);
+
+// Writes to the file |filename| an increment of |plugin| over the file
+// |base_filename|, which must have been written for |plugin|, or for the
+// plugin from which it was read, by |principia__WritePluginToFile|,
+// |principia__StartWritingPluginToFile| or |principia__CompactPluginFiles|.
+// Only the points of the histories appended since |base_filename| was written
+// are written, see |Plugin::WriteIncrementToRecords|.  The file is
+// overwritten.  |plugin| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+void CDECL principia__WritePluginIncrementToFile(Plugin const* const plugin,
+                                                 char const* filename,
+                                                 char const* base_filename);
+
+// Combines the file |base_filename|, written by |principia__WritePluginToFile|
+// or by this function, with the file |increment_filename|, written by
+// |principia__WritePluginIncrementToFile| over |base_filename|, into the file
+// |filename|, which may be read by |principia__ReadPluginFromFile| or used as
+// the base of the next increment.  See |Plugin::CompactRecords|.  The file
+// |filename| is overwritten.
+extern "C" DLLEXPORT
+void CDECL principia__CompactPluginFiles(char const* base_filename,
+                                         char const* increment_filename,
+                                         char const* filename);
+
+// Same as |principia__WritePluginToFile|, except that only the copy of the
+// state of |plugin| is done by the calling thread, see
+// |Plugin::WriteToUncompressedRecords|.  The compression of the trajectories,
+// the encoding and the writing of the file are done on a background thread,
+// the compression and the encoding of the records in parallel;
+// the caller may modify or delete |plugin| as soon as this function returns,
+// and should poll |principia__PluginSaveCompleted|.  |plugin| must not be
+// null.  No transfer of ownership of |plugin|.  The caller takes ownership of
+// the result.
+extern "C" DLLEXPORT
+PluginSave* CDECL principia__StartWritingPluginToFile(
+    Plugin const* const plugin,
+    char const* filename);
+
+// Returns true if the file of |plugin_save| has been completely written.  Does
+// not block.  |plugin_save| must not be null.  No transfer of ownership.
+extern "C" DLLEXPORT
+bool CDECL principia__PluginSaveCompleted(PluginSave const* const plugin_save);
+
+// Waits until the file of |*plugin_save| has been completely written, then
+// deletes and nulls |*plugin_save|.  |plugin_save| must not be null.  No
+// transfer of ownership of |*plugin_save|, takes ownership of |**plugin_save|.
+extern "C" DLLEXPORT
+void CDECL principia__DeletePluginSave(PluginSave** const plugin_save);
+
+// Returns a pointer to a plugin read from the file |filename| written by
+// |principia__WritePluginToFile|.  The caller takes ownership of the result.
+extern "C" DLLEXPORT
+Plugin* CDECL principia__ReadPluginFromFile(char const* filename);
+
+// Returns |plugin->SaveCheckpoint()|.  |plugin| must not be null.  No transfer
+// of ownership.
+extern "C" DLLEXPORT
+int64_t CDECL principia__SaveCheckpoint(Plugin* const plugin);
+
+// Returns |plugin->HasCheckpoint(checkpoint_id)|.  |plugin| must not be null.
+// No transfer of ownership.
+extern "C" DLLEXPORT
+bool CDECL principia__HasCheckpoint(Plugin const* const plugin,
+                                    int64_t const checkpoint_id);
+
+// Returns a pointer to a plugin restored from the checkpoint |checkpoint_id|
+// of |plugin|, see |Plugin::RestoreCheckpoint|.  The caller takes ownership of
+// the result, and typically deletes |plugin| with |principia__DeletePlugin|.
+// |plugin| must not be null.  No transfer of ownership of |plugin|.
+extern "C" DLLEXPORT
+Plugin* CDECL principia__RestoreCheckpoint(Plugin const* const plugin,
+                                           int64_t const checkpoint_id);
+
 // Says hello, convenient for checking that calls to the DLL work.
 extern "C" DLLEXPORT
 char const* CDECL principia__SayHello();
@@ -0,0 +1,647 @@
+#include "ksp_plugin/journal.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "google/protobuf/io/coded_stream.h"
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::io::IstreamInputStream;
+using google::protobuf::io::OstreamOutputStream;
+
+namespace principia {
+namespace ksp_plugin {
+
+namespace {
+
+// Returns the object of |objects| recorded as |key| in the journal.
+template<typename T>
+T FindOrDie(std::map<std::uint64_t, T> const& objects,
+            std::uint64_t const key) {
+  auto const it = objects.find(key);
+  CHECK(it != objects.end()) << "Unknown object " << key;
+  return it->second;
+}
+
+// Removes the object recorded as |key| from |objects| and returns it.
+template<typename T>
+T RemoveOrDie(std::map<std::uint64_t, T>* const objects,
+              std::uint64_t const key) {
+  T const result = FindOrDie(*objects, key);
+  objects->erase(key);
+  return result;
+}
+
+// Inserts the object |value| recorded as |key| in |objects|.  The key of an
+// object may be reused by the journal once the object has been deleted.
+template<typename T>
+void InsertOrDie(std::map<std::uint64_t, T>* const objects,
+                 std::uint64_t const key,
+                 T const value) {
+  CHECK(objects->emplace(key, value).second) << "Duplicate object " << key;
+}
+
+}  // namespace
+
+Journal::Journal() : enabled_(false) {}
+
+Journal::~Journal() {
+  Stop();
+}
+
+void Journal::Start(std::string const& filename) {
+  std::lock_guard<std::mutex> l(lock_);
+  CHECK(!enabled_) << "Journal already started";
+  file_.open(filename, std::ios::binary | std::ios::trunc);
+  CHECK(file_.good()) << filename;
+  output_stream_ = std::make_unique<OstreamOutputStream>(&file_);
+  enabled_ = true;
+}
+
+void Journal::Stop() {
+  std::lock_guard<std::mutex> l(lock_);
+  if (!enabled_) {
+    return;
+  }
+  enabled_ = false;
+  // Destroying the stream writes its buffer to the file.
+  output_stream_.reset();
+  file_.close();
+  CHECK(file_.good());
+}
+
+bool Journal::enabled() const {
+  return enabled_;
+}
+
+void Journal::Write(serialization::JournalEntry const& entry) {
+  std::lock_guard<std::mutex> l(lock_);
+  if (!enabled_) {
+    return;
+  }
+  CodedOutputStream coded_output_stream(output_stream_.get());
+  coded_output_stream.WriteVarint32(entry.ByteSize());
+  entry.SerializeWithCachedSizes(&coded_output_stream);
+  CHECK(!coded_output_stream.HadError());
+}
+
+not_null<Journal*> Journal::Global() {
+  static Journal* const journal = new Journal;
+  return journal;
+}
+
+Player::Player(std::string const& filename)
+    : file_(filename, std::ios::binary) {
+  CHECK(file_.good()) << filename;
+  input_stream_ = std::make_unique<IstreamInputStream>(&file_);
+}
+
+Player::~Player() {
+  for (auto& pair : line_and_iterators_) {
+    principia__DeleteLineAndIterator(&pair.second);
+  }
+  for (auto& pair : transforms_) {
+    principia__DeleteTransforms(&pair.second);
+  }
+  for (auto const& pair : plugins_) {
+    Plugin const* plugin = pair.second;
+    principia__DeletePlugin(&plugin);
+  }
+}
+
+bool Player::Play() {
+  serialization::JournalEntry entry;
+  {
+    // A fresh |CodedInputStream| for each entry, so that its total bytes limit
+    // applies to one entry, not to the entire journal.
+    CodedInputStream coded_input_stream(input_stream_.get());
+    std::uint32_t size;
+    if (!coded_input_stream.ReadVarint32(&size)) {
+      return false;
+    }
+    CodedInputStream::Limit const limit = coded_input_stream.PushLimit(size);
+    CHECK(entry.ParseFromCodedStream(&coded_input_stream) &&
+          coded_input_stream.ConsumedEntireMessage());
+    coded_input_stream.PopLimit(limit);
+  }
+  Run(entry);
+  return true;
+}
+
+std::map<std::string, Player::Statistics> const& Player::statistics() const {
+  return statistics_;
+}
+
+template<typename Call>
+void Player::Time(std::string const& function, Call const& call) {
+  Clock::time_point const begin = Clock::now();
+  call();
+  Clock::duration const duration = Clock::now() - begin;
+  Statistics& statistics = statistics_[function];
+  ++statistics.calls;
+  statistics.total += duration;
+  statistics.maximum = std::max(statistics.maximum, duration);
+}
+
+Transforms<Barycentric, Rendering, Barycentric>* Player::FindTransformsOrDie(
+    std::uint64_t const key) const {
+  auto const it = transforms_.find(key);
+  if (it != transforms_.end()) {
+    return it->second;
+  }
+  return FindOrDie(plugin_transforms_, key);
+}
+
+void Player::Run(serialization::JournalEntry const& entry) {
+  CHECK_NE(serialization::JournalEntry::METHOD_NOT_SET, entry.method_case());
+  // The name of the message of the method, which is that of the function.
+  std::string const& function =
+      entry.GetDescriptor()->FindFieldByNumber(entry.method_case())->
+          message_type()->name();
+  switch (entry.method_case()) {
+    case serialization::JournalEntry::kNewPlugin: {
+      auto const& m = entry.new_plugin();
+      Plugin* plugin;
+      Time(function, [&m, &plugin]() {
+        plugin = principia__NewPlugin(m.initial_time(),
+                                      m.sun_index(),
+                                      m.sun_gravitational_parameter(),
+                                      m.planetarium_rotation_in_degrees());
+      });
+      InsertOrDie(&plugins_, m.result(), plugin);
+      break;
+    }
+    case serialization::JournalEntry::kDeletePlugin: {
+      Plugin const* plugin =
+          RemoveOrDie(&plugins_, entry.delete_plugin().plugin());
+      Time(function, [&plugin]() {
+        principia__DeletePlugin(&plugin);
+      });
+      break;
+    }
+    case serialization::JournalEntry::kReadPluginFromFile: {
+      auto const& m = entry.read_plugin_from_file();
+      Plugin* plugin;
+      Time(function, [&m, &plugin]() {
+        plugin = principia__ReadPluginFromFile(m.filename().c_str());
+      });
+      InsertOrDie(&plugins_, m.result(), plugin);
+      break;
+    }
+    case serialization::JournalEntry::kSaveCheckpoint: {
+      auto const& m = entry.save_checkpoint();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      int64_t checkpoint_id;
+      Time(function, [plugin, &checkpoint_id]() {
+        checkpoint_id = principia__SaveCheckpoint(plugin);
+      });
+      CHECK_EQ(m.result(), checkpoint_id);
+      break;
+    }
+    case serialization::JournalEntry::kRestoreCheckpoint: {
+      auto const& m = entry.restore_checkpoint();
+      Plugin const* const plugin = FindOrDie(plugins_, m.plugin());
+      Plugin* restored;
+      Time(function, [&m, plugin, &restored]() {
+        restored = principia__RestoreCheckpoint(plugin, m.checkpoint_id());
+      });
+      InsertOrDie(&plugins_, m.result(), restored);
+      break;
+    }
+    case serialization::JournalEntry::kInsertCelestial: {
+      auto const& m = entry.insert_celestial();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      QP const from_parent = DeserializeQP(m.from_parent());
+      Time(function, [&m, plugin, &from_parent]() {
+        principia__InsertCelestial(plugin,
+                                   m.celestial_index(),
+                                   m.gravitational_parameter(),
+                                   m.parent_index(),
+                                   from_parent);
+      });
+      break;
+    }
+    case serialization::JournalEntry::kInsertCelestials: {
+      auto const& m = entry.insert_celestials();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      CHECK_EQ(m.celestial_index_size(), m.gravitational_parameter_size());
+      CHECK_EQ(m.celestial_index_size(), m.parent_index_size());
+      CHECK_EQ(m.celestial_index_size(), m.from_parent_size());
+      std::vector<QP> from_parents;
+      for (auto const& from_parent : m.from_parent()) {
+        from_parents.push_back(DeserializeQP(from_parent));
+      }
+      Time(function, [&m, plugin, &from_parents]() {
+        principia__InsertCelestials(plugin,
+                                    m.celestial_index().data(),
+                                    m.gravitational_parameter().data(),
+                                    m.parent_index().data(),
+                                    from_parents.data(),
+                                    m.celestial_index_size());
+      });
+      break;
+    }
+    case serialization::JournalEntry::kUpdateCelestialHierarchy: {
+      auto const& m = entry.update_celestial_hierarchy();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      Time(function, [&m, plugin]() {
+        principia__UpdateCelestialHierarchy(plugin,
+                                            m.celestial_index(),
+                                            m.parent_index());
+      });
+      break;
+    }
+    case serialization::JournalEntry::kEndInitialization: {
+      Plugin* const plugin =
+          FindOrDie(plugins_, entry.end_initialization().plugin());
+      Time(function, [plugin]() {
+        principia__EndInitialization(plugin);
+      });
+      break;
+    }
+    case serialization::JournalEntry::kLoadEphemerisFile: {
+      auto const& m = entry.load_ephemeris_file();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      bool loaded;
+      Time(function, [&m, plugin, &loaded]() {
+        loaded = principia__LoadEphemerisFile(plugin, m.filename().c_str());
+      });
+      CHECK_EQ(m.result(), loaded);
+      break;
+    }
+    case serialization::JournalEntry::kInsertOrKeepVessel: {
+      auto const& m = entry.insert_or_keep_vessel();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      Time(function, [&m, plugin]() {
+        principia__InsertOrKeepVessel(plugin,
+                                      m.vessel_guid().c_str(),
+                                      m.parent_index());
+      });
+      break;
+    }
+    case serialization::JournalEntry::kSetVesselStateOffset: {
+      auto const& m = entry.set_vessel_state_offset();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      QP const from_parent = DeserializeQP(m.from_parent());
+      Time(function, [&m, plugin, &from_parent]() {
+        principia__SetVesselStateOffset(plugin,
+                                        m.vessel_guid().c_str(),
+                                        from_parent);
+      });
+      break;
+    }
+    case serialization::JournalEntry::kAdvanceTime: {
+      auto const& m = entry.advance_time();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      Time(function, [&m, plugin]() {
+        principia__AdvanceTime(plugin, m.t(), m.planetarium_rotation());
+      });
+      break;
+    }
+    case serialization::JournalEntry::kFastForward: {
+      auto const& m = entry.fast_forward();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      Time(function, [&m, plugin]() {
+        principia__FastForward(plugin, m.t(), m.planetarium_rotation());
+      });
+      break;
+    }
+    case serialization::JournalEntry::kVesselHandle: {
+      auto const& m = entry.vessel_handle();
+      Plugin const* const plugin = FindOrDie(plugins_, m.plugin());
+      VesselHandle vessel_handle;
+      Time(function, [&m, plugin, &vessel_handle]() {
+        vessel_handle =
+            principia__VesselHandle(plugin, m.vessel_guid().c_str());
+      });
+      vessel_handles_[m.result()] = vessel_handle;
+      break;
+    }
+    case serialization::JournalEntry::kInsertVessels: {
+      auto const& m = entry.insert_vessels();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      CHECK_EQ(m.vessel_guid_size(), m.parent_index_size());
+      CHECK_EQ(m.vessel_guid_size(), m.from_parent_size());
+      CHECK_EQ(m.vessel_guid_size(), m.result_size());
+      std::vector<char const*> vessel_guids;
+      std::vector<QP> from_parents;
+      for (int i = 0; i < m.vessel_guid_size(); ++i) {
+        vessel_guids.push_back(m.vessel_guid(i).c_str());
+        from_parents.push_back(DeserializeQP(m.from_parent(i)));
+      }
+      std::vector<VesselHandle> vessel_handles(vessel_guids.size());
+      Time(function,
+           [&m, plugin, &vessel_guids, &from_parents, &vessel_handles]() {
+        principia__InsertVessels(plugin,
+                                 vessel_guids.data(),
+                                 m.parent_index().data(),
+                                 from_parents.data(),
+                                 vessel_guids.size(),
+                                 vessel_handles.data());
+      });
+      for (int i = 0; i < m.result_size(); ++i) {
+        vessel_handles_[m.result(i)] = vessel_handles[i];
+      }
+      break;
+    }
+    case serialization::JournalEntry::kKeepVessels: {
+      auto const& m = entry.keep_vessels();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      std::vector<VesselHandle> vessel_handles;
+      for (VesselHandle const vessel_handle : m.vessel_handle()) {
+        auto const it = vessel_handles_.find(vessel_handle);
+        CHECK(it != vessel_handles_.end())
+            << "Unknown vessel handle " << vessel_handle;
+        vessel_handles.push_back(it->second);
+      }
+      Time(function, [plugin, &vessel_handles]() {
+        principia__KeepVessels(plugin,
+                               vessel_handles.data(),
+                               vessel_handles.size());
+      });
+      break;
+    }
+    case serialization::JournalEntry::kRemoveVessel: {
+      auto const& m = entry.remove_vessel();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      Time(function, [&m, plugin]() {
+        principia__RemoveVessel(plugin, m.vessel_guid().c_str());
+      });
+      break;
+    }
+    case serialization::JournalEntry::kVesselFromParent: {
+      auto const& m = entry.vessel_from_parent();
+      Plugin const* const plugin = FindOrDie(plugins_, m.plugin());
+      Time(function, [&m, plugin]() {
+        principia__VesselFromParent(plugin, m.vessel_guid().c_str());
+      });
+      break;
+    }
+    case serialization::JournalEntry::kVesselsFromParentByHandle: {
+      auto const& m = entry.vessels_from_parent_by_handle();
+      Plugin const* const plugin = FindOrDie(plugins_, m.plugin());
+      std::vector<VesselHandle> vessel_handles;
+      for (VesselHandle const vessel_handle : m.vessel_handle()) {
+        auto const it = vessel_handles_.find(vessel_handle);
+        CHECK(it != vessel_handles_.end())
+            << "Unknown vessel handle " << vessel_handle;
+        vessel_handles.push_back(it->second);
+      }
+      std::vector<QP> from_parents(vessel_handles.size());
+      Time(function, [plugin, &vessel_handles, &from_parents]() {
+        principia__VesselsFromParentByHandle(plugin,
+                                             vessel_handles.data(),
+                                             vessel_handles.size(),
+                                             from_parents.data());
+      });
+      break;
+    }
+    case serialization::JournalEntry::kCelestialFromParent: {
+      auto const& m = entry.celestial_from_parent();
+      Plugin const* const plugin = FindOrDie(plugins_, m.plugin());
+      Time(function, [&m, plugin]() {
+        principia__CelestialFromParent(plugin, m.celestial_index());
+      });
+      break;
+    }
+    case serialization::JournalEntry::kAllCelestialsFromParent: {
+      auto const& m = entry.all_celestials_from_parent();
+      Plugin const* const plugin = FindOrDie(plugins_, m.plugin());
+      std::vector<QP> from_parents(m.count());
+      Time(function, [&m, plugin, &from_parents]() {
+        principia__AllCelestialsFromParent(plugin,
+                                           m.count(),
+                                           from_parents.data());
+      });
+      break;
+    }
+    case serialization::JournalEntry::kNewBodyCentredNonRotatingTransforms: {
+      auto const& m = entry.new_body_centred_non_rotating_transforms();
+      Plugin const* const plugin = FindOrDie(plugins_, m.plugin());
+      Transforms<Barycentric, Rendering, Barycentric>* transforms;
+      Time(function, [&m, plugin, &transforms]() {
+        transforms = principia__NewBodyCentredNonRotatingTransforms(
+                         plugin, m.reference_body_index());
+      });
+      InsertOrDie(&transforms_, m.result(), transforms);
+      break;
+    }
+    case serialization::JournalEntry::kNewBarycentricRotatingTransforms: {
+      auto const& m = entry.new_barycentric_rotating_transforms();
+      Plugin const* const plugin = FindOrDie(plugins_, m.plugin());
+      Transforms<Barycentric, Rendering, Barycentric>* transforms;
+      Time(function, [&m, plugin, &transforms]() {
+        transforms = principia__NewBarycentricRotatingTransforms(
+                         plugin, m.primary_index(), m.secondary_index());
+      });
+      InsertOrDie(&transforms_, m.result(), transforms);
+      break;
+    }
+    case serialization::JournalEntry::kBodyCentredNonRotatingTransforms: {
+      auto const& m = entry.body_centred_non_rotating_transforms();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      Transforms<Barycentric, Rendering, Barycentric>* transforms;
+      Time(function, [&m, plugin, &transforms]() {
+        transforms = principia__BodyCentredNonRotatingTransforms(
+                         plugin, m.reference_body_index());
+      });
+      plugin_transforms_[m.result()] = transforms;
+      break;
+    }
+    case serialization::JournalEntry::kBarycentricRotatingTransforms: {
+      auto const& m = entry.barycentric_rotating_transforms();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      Transforms<Barycentric, Rendering, Barycentric>* transforms;
+      Time(function, [&m, plugin, &transforms]() {
+        transforms = principia__BarycentricRotatingTransforms(
+                         plugin, m.primary_index(), m.secondary_index());
+      });
+      plugin_transforms_[m.result()] = transforms;
+      break;
+    }
+    case serialization::JournalEntry::kDeleteTransforms: {
+      Transforms<Barycentric, Rendering, Barycentric>* transforms =
+          RemoveOrDie(&transforms_, entry.delete_transforms().transforms());
+      Time(function, [&transforms]() {
+        principia__DeleteTransforms(&transforms);
+      });
+      break;
+    }
+    case serialization::JournalEntry::kRenderedVesselTrajectory: {
+      auto const& m = entry.rendered_vessel_trajectory();
+      Plugin const* const plugin = FindOrDie(plugins_, m.plugin());
+      Transforms<Barycentric, Rendering, Barycentric>* const transforms =
+          FindTransformsOrDie(m.transforms());
+      XYZ const sun_world_position = DeserializeXYZ(m.sun_world_position());
+      LineAndIterator* line_and_iterator;
+      Time(function,
+           [&m, plugin, transforms, &sun_world_position, &line_and_iterator]() {
+        line_and_iterator =
+            principia__RenderedVesselTrajectory(plugin,
+                                                m.vessel_guid().c_str(),
+                                                transforms,
+                                                sun_world_position,
+                                                m.tolerance(),
+                                                m.begin_time());
+      });
+      InsertOrDie(&line_and_iterators_, m.result(), line_and_iterator);
+      break;
+    }
+    case serialization::JournalEntry::kRenderedVesselTrajectories: {
+      auto const& m = entry.rendered_vessel_trajectories();
+      CHECK_EQ(m.vessel_guid_size(), m.line_and_iterator_size());
+      Plugin const* const plugin = FindOrDie(plugins_, m.plugin());
+      Transforms<Barycentric, Rendering, Barycentric>* const transforms =
+          FindTransformsOrDie(m.transforms());
+      XYZ const sun_world_position = DeserializeXYZ(m.sun_world_position());
+      std::vector<char const*> vessel_guids;
+      for (std::string const& vessel_guid : m.vessel_guid()) {
+        vessel_guids.push_back(vessel_guid.c_str());
+      }
+      std::vector<LineAndIterator*> line_and_iterators(vessel_guids.size());
+      Time(function, [&m, plugin, transforms, &sun_world_position,
+                      &vessel_guids, &line_and_iterators]() {
+        principia__RenderedVesselTrajectories(plugin,
+                                              vessel_guids.data(),
+                                              vessel_guids.size(),
+                                              transforms,
+                                              sun_world_position,
+                                              m.tolerance(),
+                                              m.begin_time(),
+                                              line_and_iterators.data());
+      });
+      for (int i = 0; i < m.line_and_iterator_size(); ++i) {
+        InsertOrDie(&line_and_iterators_,
+                    m.line_and_iterator(i),
+                    line_and_iterators[i]);
+      }
+      break;
+    }
+    case serialization::JournalEntry::kDeleteLineAndIterator: {
+      LineAndIterator* line_and_iterator =
+          RemoveOrDie(&line_and_iterators_,
+                      entry.delete_line_and_iterator().line_and_iterator());
+      Time(function, [&line_and_iterator]() {
+        principia__DeleteLineAndIterator(&line_and_iterator);
+      });
+      break;
+    }
+    case serialization::JournalEntry::kVesselWorldPosition: {
+      auto const& m = entry.vessel_world_position();
+      Plugin const* const plugin = FindOrDie(plugins_, m.plugin());
+      XYZ const parent_world_position =
+          DeserializeXYZ(m.parent_world_position());
+      Time(function, [&m, plugin, &parent_world_position]() {
+        principia__VesselWorldPosition(plugin,
+                                       m.vessel_guid().c_str(),
+                                       parent_world_position);
+      });
+      break;
+    }
+    case serialization::JournalEntry::kVesselWorldVelocity: {
+      auto const& m = entry.vessel_world_velocity();
+      Plugin const* const plugin = FindOrDie(plugins_, m.plugin());
+      XYZ const parent_world_velocity =
+          DeserializeXYZ(m.parent_world_velocity());
+      Time(function, [&m, plugin, &parent_world_velocity]() {
+        principia__VesselWorldVelocity(plugin,
+                                       m.vessel_guid().c_str(),
+                                       parent_world_velocity,
+                                       m.parent_rotation_period());
+      });
+      break;
+    }
+    case serialization::JournalEntry::kAddVesselToNextPhysicsBubble: {
+      auto const& m = entry.add_vessel_to_next_physics_bubble();
+      Plugin* const plugin = FindOrDie(plugins_, m.plugin());
+      std::vector<KSPPart> parts;
+      for (serialization::KSPPart const& part : m.part()) {
+        parts.push_back(DeserializeKSPPart(part));
+      }
+      Time(function, [&m, plugin, &parts]() {
+        principia__AddVesselToNextPhysicsBubble(plugin,
+                                                m.vessel_guid().c_str(),
+                                                parts.data(),
+                                                parts.size());
+      });
+      break;
+    }
+    case serialization::JournalEntry::kPhysicsBubbleIsEmpty: {
+      Plugin const* const plugin =
+          FindOrDie(plugins_, entry.physics_bubble_is_empty().plugin());
+      Time(function, [plugin]() {
+        principia__PhysicsBubbleIsEmpty(plugin);
+      });
+      break;
+    }
+    case serialization::JournalEntry::kBubbleDisplacementCorrection: {
+      auto const& m = entry.bubble_displacement_correction();
+      Plugin const* const plugin = FindOrDie(plugins_, m.plugin());
+      XYZ const sun_position = DeserializeXYZ(m.sun_position());
+      Time(function, [plugin, &sun_position]() {
+        principia__BubbleDisplacementCorrection(plugin, sun_position);
+      });
+      break;
+    }
+    case serialization::JournalEntry::kBubbleVelocityCorrection: {
+      auto const& m = entry.bubble_velocity_correction();
+      Plugin const* const plugin = FindOrDie(plugins_, m.plugin());
+      Time(function, [&m, plugin]() {
+        principia__BubbleVelocityCorrection(plugin, m.reference_body_index());
+      });
+      break;
+    }
+    case serialization::JournalEntry::METHOD_NOT_SET:
+      LOG(FATAL) << "Empty journal entry";
+  }
+}
+
+std::uint64_t SerializePointer(void const* const pointer) {
+  return reinterpret_cast<std::uintptr_t>(pointer);
+}
+
+void SerializeXYZ(XYZ const& xyz, not_null<serialization::XYZ*> const message) {
+  message->set_x(xyz.x);
+  message->set_y(xyz.y);
+  message->set_z(xyz.z);
+}
+
+void SerializeQP(QP const& qp, not_null<serialization::QP*> const message) {
+  SerializeXYZ(qp.q, message->mutable_q());
+  SerializeXYZ(qp.p, message->mutable_p());
+}
+
+void SerializeKSPPart(KSPPart const& ksp_part,
+                      not_null<serialization::KSPPart*> const message) {
+  SerializeXYZ(ksp_part.world_position, message->mutable_world_position());
+  SerializeXYZ(ksp_part.world_velocity, message->mutable_world_velocity());
+  message->set_mass(ksp_part.mass);
+  SerializeXYZ(
+      ksp_part.gravitational_acceleration_to_be_applied_by_ksp,
+      message->mutable_gravitational_acceleration_to_be_applied_by_ksp());
+  message->set_id(ksp_part.id);
+}
+
+XYZ DeserializeXYZ(serialization::XYZ const& message) {
+  return {message.x(), message.y(), message.z()};
+}
+
+QP DeserializeQP(serialization::QP const& message) {
+  return {DeserializeXYZ(message.q()), DeserializeXYZ(message.p())};
+}
+
+KSPPart DeserializeKSPPart(serialization::KSPPart const& message) {
+  return {DeserializeXYZ(message.world_position()),
+          DeserializeXYZ(message.world_velocity()),
+          message.mass(),
+          DeserializeXYZ(
+              message.gravitational_acceleration_to_be_applied_by_ksp()),
+          message.id()};
+}
+
+}  // namespace ksp_plugin
+}  // namespace principia
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "base/not_null.hpp"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "ksp_plugin/interface.hpp"
+#include "serialization/journal.pb.h"
+
+using principia::base::not_null;
+
+namespace principia {
+namespace ksp_plugin {
+
+// A journal of the calls to the C interface, written to a file as a sequence of
+// length-delimited |serialization::JournalEntry|s.  The journal of a session
+// may be replayed by a |Player| outside of the game, e.g., to profile it.
+class Journal {
+ public:
+  // The journal is initially disabled.
+  Journal();
+
+  // Stops the journal if it is enabled.
+  ~Journal();
+
+  Journal(Journal const&) = delete;
+  Journal& operator=(Journal const&) = delete;
+
+  // Enables the journal and starts writing the entries to the file |filename|,
+  // which is overwritten.  The journal must be disabled.
+  void Start(std::string const& filename);
+
+  // Disables the journal, writes the pending entries and closes the file.  Does
+  // nothing if the journal is disabled.
+  void Stop();
+
+  // An atomic load, so that the journaled functions may check it on every call.
+  bool enabled() const;
+
+  // Appends |entry| to the journal.  Does nothing if the journal is disabled.
+  void Write(serialization::JournalEntry const& entry);
+
+  // The journal written by the functions of the C interface.
+  static not_null<Journal*> Global();
+
+ private:
+  std::atomic<bool> enabled_;
+
+  std::mutex lock_;
+  std::ofstream file_;  // Guarded by |lock_|.
+  // Null if the journal is disabled.
+  std::unique_ptr<google::protobuf::io::OstreamOutputStream>
+      output_stream_;  // Guarded by |lock_|.
+};
+
+// Replays a journal written by |Journal| by calling the same functions of the
+// C interface with the same arguments, and measures the duration of each call.
+// The results of the calls are not compared to the ones in the journal.
+class Player {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // The durations of the calls to one function of the C interface.
+  struct Statistics {
+    std::int64_t calls = 0;
+    Clock::duration total = Clock::duration::zero();
+    Clock::duration maximum = Clock::duration::zero();
+  };
+
+  // Opens the journal |filename|, which must exist.
+  explicit Player(std::string const& filename);
+
+  // Deletes the objects created by the journal and not deleted by it, e.g.,
+  // because the game was quit without destroying the plugin.
+  ~Player();
+
+  Player(Player const&) = delete;
+  Player& operator=(Player const&) = delete;
+
+  // Replays the next entry of the journal.  Returns false, without doing
+  // anything, if the journal is exhausted.
+  bool Play();
+
+  // The statistics of the calls replayed so far, keyed by the name of the
+  // function without the |principia__| prefix.
+  std::map<std::string, Statistics> const& statistics() const;
+
+ private:
+  // Executes the call recorded in |entry|.
+  void Run(serialization::JournalEntry const& entry);
+
+  // Calls |call| and records its duration in the statistics of |function|.
+  template<typename Call>
+  void Time(std::string const& function, Call const& call);
+
+  // Returns the transforms recorded as |key|, whether they are owned by the
+  // caller or by a plugin.
+  Transforms<Barycentric, Rendering, Barycentric>* FindTransformsOrDie(
+      std::uint64_t const key) const;
+
+  std::ifstream file_;
+  std::unique_ptr<google::protobuf::io::IstreamInputStream> input_stream_;
+
+  // The objects created by the replayed calls, keyed by the values recorded in
+  // the journal.
+  std::map<std::uint64_t, Plugin*> plugins_;
+  std::map<std::uint64_t, Transforms<Barycentric, Rendering, Barycentric>*>
+      transforms_;
+  // The transforms owned by the plugins, which are not deleted by the player.
+  // A key may be recorded several times, and is reused if the plugin is
+  // deleted.
+  std::map<std::uint64_t, Transforms<Barycentric, Rendering, Barycentric>*>
+      plugin_transforms_;
+  std::map<std::uint64_t, LineAndIterator*> line_and_iterators_;
+  std::map<VesselHandle, VesselHandle> vessel_handles_;
+
+  std::map<std::string, Statistics> statistics_;
+};
+
+// Conversions between the structs of the C interface and their serialized
+// form in the journal.
+std::uint64_t SerializePointer(void const* const pointer);
+void SerializeXYZ(XYZ const& xyz, not_null<serialization::XYZ*> const message);
+void SerializeQP(QP const& qp, not_null<serialization::QP*> const message);
+void SerializeKSPPart(KSPPart const& ksp_part,
+                      not_null<serialization::KSPPart*> const message);
+XYZ DeserializeXYZ(serialization::XYZ const& message);
+QP DeserializeQP(serialization::QP const& message);
+KSPPart DeserializeKSPPart(serialization::KSPPart const& message);
+
+}  // namespace ksp_plugin
+}  // namespace principia
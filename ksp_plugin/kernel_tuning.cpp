@@ -0,0 +1,363 @@
+#include "ksp_plugin/kernel_tuning.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "base/macros.hpp"
+#include "base/thread_pool.hpp"
+#include "geometry/grassmann.hpp"
+#include "geometry/named_quantities.hpp"
+#include "glog/logging.h"
+#include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "ksp_plugin/frames.hpp"
+#include "physics/massive_body.hpp"
+#include "physics/massless_body.hpp"
+#include "physics/n_body_system.hpp"
+#include "physics/trajectory.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/si.hpp"
+
+using principia::base::CPUFeatures;
+using principia::base::DetectedCPUFeatures;
+using principia::base::MaximumVectorInstructionSet;
+using principia::base::SetMaximumVectorInstructionSet;
+using principia::base::ThreadPool;
+using principia::geometry::Displacement;
+using principia::geometry::Velocity;
+using principia::integrators::SPRKIntegrator;
+using principia::physics::MassiveBody;
+using principia::physics::MasslessBody;
+using principia::physics::NBodySystem;
+using principia::physics::Trajectory;
+using principia::quantities::Angle;
+using principia::quantities::Cos;
+using principia::quantities::GravitationalParameter;
+using principia::quantities::Length;
+using principia::quantities::Pow;
+using principia::quantities::Sin;
+using principia::quantities::Speed;
+using principia::quantities::Sqrt;
+using principia::si::Metre;
+using principia::si::Radian;
+using principia::si::Second;
+
+namespace principia {
+namespace ksp_plugin {
+
+namespace {
+
+// The synthetic system of |BenchmarkGravitationalAccelerations|.  The bodies
+// are on circular orbits around the star, in its plane of reference.
+int const kPlanets = 8;
+int const kMasslessBodies = 256;
+int const kSteps = 100;
+int const kRepetitions = 3;
+Time const kΔt = 10 * Second;
+
+// A candidate that comes later in the lists of |TuneKernels|, i.e., that uses
+// more threads or wider vectors, must be faster by this factor to be chosen.
+// This avoids taking resources from the game for a gain within the noise of
+// the measurements.
+double const kMinimumSpeedup = 1.05;
+
+serialization::KernelConfiguration::VectorInstructionSet
+ToMessage(VectorInstructionSet const instruction_set) {
+  switch (instruction_set) {
+    case VectorInstructionSet::kNone:
+      return serialization::KernelConfiguration::NONE;
+    case VectorInstructionSet::kAVX:
+      return serialization::KernelConfiguration::AVX;
+    case VectorInstructionSet::kAVX512F:
+      return serialization::KernelConfiguration::AVX512F;
+    default:
+      LOG(FATAL) << "Unexpected instruction set "
+                 << static_cast<int>(instruction_set);
+      base::noreturn();
+  }
+}
+
+VectorInstructionSet FromMessage(
+    serialization::KernelConfiguration::VectorInstructionSet const
+        instruction_set) {
+  switch (instruction_set) {
+    case serialization::KernelConfiguration::NONE:
+      return VectorInstructionSet::kNone;
+    case serialization::KernelConfiguration::AVX:
+      return VectorInstructionSet::kAVX;
+    case serialization::KernelConfiguration::AVX512F:
+      return VectorInstructionSet::kAVX512F;
+    default:
+      LOG(FATAL) << "Unexpected instruction set " << instruction_set;
+      base::noreturn();
+  }
+}
+
+int HardwareConcurrency() {
+  return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+// Returns the first of the |candidates| unless a later one is faster by
+// |kMinimumSpeedup| than all the earlier ones.
+KernelConfiguration Fastest(
+    std::vector<KernelConfiguration> const& candidates,
+    KernelBenchmark const& benchmark) {
+  CHECK(!candidates.empty());
+  KernelConfiguration fastest = candidates.front();
+  Time fastest_time = std::numeric_limits<double>::infinity() * Second;
+  for (KernelConfiguration const& candidate : candidates) {
+    Time const time = benchmark(candidate);
+    LOG(INFO) << candidate << ": " << time;
+    if (time * kMinimumSpeedup < fastest_time) {
+      fastest = candidate;
+      fastest_time = time;
+    }
+  }
+  return fastest;
+}
+
+}  // namespace
+
+void KernelConfiguration::WriteToMessage(
+    not_null<serialization::KernelConfiguration*> const message) const {
+  message->set_number_of_threads(number_of_threads);
+  message->set_massless_chunks_per_thread(massless_chunks_per_thread);
+  message->set_maximum_vector_instruction_set(
+      ToMessage(maximum_vector_instruction_set));
+  CPUFeatures const& features = DetectedCPUFeatures();
+  message->set_hardware_concurrency(HardwareConcurrency());
+  message->set_avx(features.avx);
+  message->set_avx512f(features.avx512f);
+}
+
+KernelConfiguration KernelConfiguration::ReadFromMessage(
+    serialization::KernelConfiguration const& message) {
+  KernelConfiguration configuration;
+  configuration.number_of_threads = message.number_of_threads();
+  configuration.massless_chunks_per_thread =
+      message.massless_chunks_per_thread();
+  configuration.maximum_vector_instruction_set =
+      FromMessage(message.maximum_vector_instruction_set());
+  return configuration;
+}
+
+bool operator==(KernelConfiguration const& left,
+                KernelConfiguration const& right) {
+  return left.number_of_threads == right.number_of_threads &&
+         left.massless_chunks_per_thread ==
+             right.massless_chunks_per_thread &&
+         left.maximum_vector_instruction_set ==
+             right.maximum_vector_instruction_set;
+}
+
+bool operator!=(KernelConfiguration const& left,
+                KernelConfiguration const& right) {
+  return !(left == right);
+}
+
+std::ostream& operator<<(std::ostream& out,
+                         KernelConfiguration const& configuration) {
+  return out << "{threads: " << configuration.number_of_threads
+             << ", chunks per thread: "
+             << configuration.massless_chunks_per_thread
+             << ", vector instruction set: "
+             << serialization::KernelConfiguration::VectorInstructionSet_Name(
+                    ToMessage(configuration.maximum_vector_instruction_set))
+             << "}";
+}
+
+Time BenchmarkGravitationalAccelerations(
+    KernelConfiguration const& configuration) {
+  GravitationalParameter const star_gravitational_parameter =
+      1.1723328E18 * Pow<3>(Metre) / Pow<2>(Second);
+  GravitationalParameter const planet_gravitational_parameter =
+      3.5316E12 * Pow<3>(Metre) / Pow<2>(Second);
+  Length const planet_spacing = 5E9 * Metre;
+  Length const innermost_massless_radius = 1E9 * Metre;
+  Length const massless_spacing = 1E7 * Metre;
+
+  MassiveBody const star(star_gravitational_parameter);
+  std::vector<std::unique_ptr<MassiveBody>> planets;
+  for (int i = 0; i < kPlanets; ++i) {
+    planets.emplace_back(
+        std::make_unique<MassiveBody>(planet_gravitational_parameter));
+  }
+  std::vector<std::unique_ptr<MasslessBody>> massless_bodies;
+  for (int i = 0; i < kMasslessBodies; ++i) {
+    massless_bodies.emplace_back(std::make_unique<MasslessBody>());
+  }
+
+  std::unique_ptr<ThreadPool> thread_pool;
+  if (configuration.number_of_threads > 1) {
+    thread_pool =
+        std::make_unique<ThreadPool>(configuration.number_of_threads);
+  }
+  NBodySystem<Barycentric> n_body_system(
+      NBodySystem<Barycentric>::Layout::kStructureOfArrays);
+  n_body_system.set_thread_pool(thread_pool.get());
+  n_body_system.set_massless_chunks_per_thread(
+      configuration.massless_chunks_per_thread);
+  SPRKIntegrator<Length, Speed> integrator;
+  integrator.Initialize(integrator.Order5Optimal());
+
+  VectorInstructionSet const previous_instruction_set =
+      MaximumVectorInstructionSet();
+  SetMaximumVectorInstructionSet(
+      configuration.maximum_vector_instruction_set);
+  Time shortest = std::numeric_limits<double>::infinity() * Second;
+  for (int repetition = 0; repetition < kRepetitions; ++repetition) {
+    std::vector<std::unique_ptr<Trajectory<Barycentric>>> trajectories;
+    NBodySystem<Barycentric>::Trajectories trajectory_pointers;
+    auto const add_on_circular_orbit = [&trajectories, &trajectory_pointers,
+                                        star_gravitational_parameter](
+        not_null<physics::Body const*> const body,
+        Length const& radius,
+        Angle const& phase) {
+      Speed const speed = Sqrt(star_gravitational_parameter / radius);
+      trajectories.emplace_back(
+          std::make_unique<Trajectory<Barycentric>>(body));
+      trajectories.back()->Append(
+          kUniversalTimeEpoch,
+          {Position<Barycentric>() +
+               Displacement<Barycentric>({radius * Cos(phase),
+                                          radius * Sin(phase),
+                                          0 * Metre}),
+           Velocity<Barycentric>({-speed * Sin(phase),
+                                  speed * Cos(phase),
+                                  0 * Metre / Second})});
+      trajectory_pointers.push_back(trajectories.back().get());
+    };
+    trajectories.emplace_back(std::make_unique<Trajectory<Barycentric>>(&star));
+    trajectories.back()->Append(
+        kUniversalTimeEpoch,
+        {Position<Barycentric>(), Velocity<Barycentric>()});
+    trajectory_pointers.push_back(trajectories.back().get());
+    for (int i = 0; i < kPlanets; ++i) {
+      add_on_circular_orbit(planets[i].get(),
+                            (i + 1) * planet_spacing,
+                            i * Radian);
+    }
+    for (int i = 0; i < kMasslessBodies; ++i) {
+      add_on_circular_orbit(massless_bodies[i].get(),
+                            innermost_massless_radius + i * massless_spacing,
+                            0.1 * i * Radian);
+    }
+
+    auto const start = std::chrono::steady_clock::now();
+    n_body_system.Integrate(integrator,
+                            kUniversalTimeEpoch + kSteps * kΔt,  // tmax
+                            kΔt,
+                            0,  // sampling_period
+                            true,  // tmax_is_exact
+                            trajectory_pointers);
+    Time const time = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start).count() *
+                      Second;
+    shortest = std::min(shortest, time);
+  }
+  SetMaximumVectorInstructionSet(previous_instruction_set);
+  return shortest;
+}
+
+KernelConfiguration TuneKernels(KernelBenchmark const& benchmark) {
+  LOG(INFO) << "Tuning the kernels";
+  CPUFeatures const& features = DetectedCPUFeatures();
+
+  // The vector instruction set, on a single thread.
+  std::vector<KernelConfiguration> candidates(1);
+  candidates.back().maximum_vector_instruction_set =
+      VectorInstructionSet::kNone;
+  if (features.avx) {
+    candidates.emplace_back();
+    candidates.back().maximum_vector_instruction_set =
+        VectorInstructionSet::kAVX;
+  }
+  if (features.avx512f) {
+    candidates.emplace_back();
+    candidates.back().maximum_vector_instruction_set =
+        VectorInstructionSet::kAVX512F;
+  }
+  KernelConfiguration fastest = Fastest(candidates, benchmark);
+
+  // The number of threads, by powers of 2, leaving a hardware thread to the
+  // game.
+  int const maximum_number_of_threads = std::max(1, HardwareConcurrency() - 1);
+  candidates.clear();
+  for (int number_of_threads = 1;; number_of_threads *= 2) {
+    candidates.push_back(fastest);
+    candidates.back().number_of_threads =
+        std::min(number_of_threads, maximum_number_of_threads);
+    if (number_of_threads >= maximum_number_of_threads) {
+      break;
+    }
+  }
+  fastest = Fastest(candidates, benchmark);
+
+  // The number of chunks per thread, which doesn't matter without a pool.
+  if (fastest.number_of_threads > 1) {
+    candidates.clear();
+    for (int const chunks_per_thread : {1, 2, 4, 8}) {
+      candidates.push_back(fastest);
+      candidates.back().massless_chunks_per_thread = chunks_per_thread;
+    }
+    fastest = Fastest(candidates, benchmark);
+  }
+
+  LOG(INFO) << "Tuned the kernels: " << fastest;
+  return fastest;
+}
+
+bool ReadKernelConfiguration(
+    std::string const& filename,
+    not_null<KernelConfiguration*> const configuration) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.good()) {
+    return false;
+  }
+  serialization::KernelConfiguration message;
+  if (!message.ParseFromIstream(&file)) {
+    LOG(WARNING) << "Invalid kernel configuration in " << filename;
+    return false;
+  }
+  CPUFeatures const& features = DetectedCPUFeatures();
+  if (message.hardware_concurrency() != HardwareConcurrency() ||
+      message.avx() != features.avx ||
+      message.avx512f() != features.avx512f) {
+    LOG(INFO) << "The kernel configuration in " << filename
+              << " is for another processor";
+    return false;
+  }
+  *configuration = KernelConfiguration::ReadFromMessage(message);
+  return true;
+}
+
+void WriteKernelConfiguration(std::string const& filename,
+                              KernelConfiguration const& configuration) {
+  serialization::KernelConfiguration message;
+  configuration.WriteToMessage(&message);
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  CHECK(file.good()) << filename;
+  CHECK(message.SerializeToOstream(&file)) << filename;
+}
+
+KernelConfiguration ReadOrTuneKernelConfiguration(
+    std::string const& filename,
+    KernelBenchmark const& benchmark) {
+  KernelConfiguration configuration;
+  if (ReadKernelConfiguration(filename, &configuration)) {
+    LOG(INFO) << "Read the kernel configuration " << configuration << " from "
+              << filename;
+  } else {
+    configuration = TuneKernels(benchmark);
+    WriteKernelConfiguration(filename, configuration);
+  }
+  return configuration;
+}
+
+}  // namespace ksp_plugin
+}  // namespace principia
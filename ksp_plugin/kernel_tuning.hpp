@@ -0,0 +1,86 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+
+#include "base/cpu_features.hpp"
+#include "base/not_null.hpp"
+#include "quantities/quantities.hpp"
+#include "serialization/ksp_plugin.pb.h"
+
+using principia::base::not_null;
+using principia::base::VectorInstructionSet;
+using principia::quantities::Time;
+
+namespace principia {
+namespace ksp_plugin {
+
+// The parameters of the computation of the gravitational accelerations that
+// affect its speed but not its results.  The best values depend on the
+// processor.
+struct KernelConfiguration {
+  // See |Plugin::SetNumberOfThreads|.
+  int number_of_threads = 1;
+  // See |NBodySystem::set_massless_chunks_per_thread|.
+  int massless_chunks_per_thread = 1;
+  // See |base::SetMaximumVectorInstructionSet|.
+  VectorInstructionSet maximum_vector_instruction_set =
+      VectorInstructionSet::kAVX512F;
+
+  // The characteristics of the processor are written too, so that
+  // |ReadKernelConfiguration| may tell whether the configuration applies.
+  void WriteToMessage(
+      not_null<serialization::KernelConfiguration*> const message) const;
+  static KernelConfiguration ReadFromMessage(
+      serialization::KernelConfiguration const& message);
+};
+
+bool operator==(KernelConfiguration const& left,
+                KernelConfiguration const& right);
+bool operator!=(KernelConfiguration const& left,
+                KernelConfiguration const& right);
+
+std::ostream& operator<<(std::ostream& out,
+                         KernelConfiguration const& configuration);
+
+// Returns the wall-clock time taken by some computation with the given
+// configuration.
+using KernelBenchmark =
+    std::function<Time(KernelConfiguration const& configuration)>;
+
+// Times the integration by |NBodySystem| of a synthetic system made of a star,
+// a few planets, and a few hundred massless bodies, with the given
+// |configuration|, and returns the shortest of a few runs.  Takes a few tens
+// of milliseconds.  Changes |base::MaximumVectorInstructionSet| and restores
+// it, so it must not run concurrently with other integrations.
+Time BenchmarkGravitationalAccelerations(
+    KernelConfiguration const& configuration);
+
+// Returns the configuration for which |benchmark| is the fastest, determined
+// one parameter at a time: the vector instruction set among those supported
+// by the processor on a single thread, then the number of threads up to one
+// less than the number of hardware threads, then the number of chunks per
+// thread.
+KernelConfiguration TuneKernels(
+    KernelBenchmark const& benchmark = &BenchmarkGravitationalAccelerations);
+
+// Returns true and sets |configuration| if |filename| contains a
+// configuration tuned for this processor, i.e., one with the same number of
+// hardware threads and the same vector instruction sets.  Returns false if the
+// file doesn't exist or is for another processor.
+bool ReadKernelConfiguration(
+    std::string const& filename,
+    not_null<KernelConfiguration*> const configuration);
+
+void WriteKernelConfiguration(std::string const& filename,
+                              KernelConfiguration const& configuration);
+
+// Reads the configuration from |filename| if it is tuned for this processor,
+// otherwise runs |TuneKernels| and writes the result to |filename|.
+KernelConfiguration ReadOrTuneKernelConfiguration(
+    std::string const& filename,
+    KernelBenchmark const& benchmark = &BenchmarkGravitationalAccelerations);
+
+}  // namespace ksp_plugin
+}  // namespace principia
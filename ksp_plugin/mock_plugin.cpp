@@ -32,6 +32,13 @@ MockPlugin::NewBarycentricRotatingTransforms(
   return std::move(transforms);
 }
 
+std::unique_ptr<Plugin> MockPlugin::RestoreCheckpoint(
+    std::int64_t const checkpoint_id) const {
+  std::unique_ptr<Plugin> plugin;
+  FillRestoredCheckpoint(checkpoint_id, &plugin);
+  return plugin;
+}
+
 void MockPlugin::AddVesselToNextPhysicsBubble(
     GUID const& vessel_guid,
     std::vector<IdAndOwnedPart> parts) {
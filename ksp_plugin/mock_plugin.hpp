@@ -24,9 +24,23 @@ class MockPlugin : public Plugin {
                     Index const parent_index,
                     RelativeDegreesOfFreedom<AliceSun> const& from_parent));
 
+  MOCK_METHOD1(InsertCelestials,
+               void(std::vector<CelestialDescription> const& celestials));
+
   MOCK_METHOD0(EndInitialization,
                void());
 
+  MOCK_METHOD1(LoadEphemerisFile,
+               bool(std::string const& filename));
+
+  MOCK_METHOD4(WriteEphemerisFile,
+               void(std::string const& filename,
+                    Instant const& t_max,
+                    int const steps_per_series,
+                    int const degree));
+
+  MOCK_CONST_METHOD1(WriteTrajectoryFile, void(std::string const& filename));
+
   MOCK_CONST_METHOD2(UpdateCelestialHierarchy,
                      void(Index const celestial_index,
                           Index const parent_index));
@@ -34,6 +48,21 @@ class MockPlugin : public Plugin {
   MOCK_METHOD2(InsertOrKeepVessel,
                bool(GUID const& vessel_guid, Index const parent_index));
 
+  MOCK_CONST_METHOD1(vessel_handle,
+                     VesselHandle(GUID const& vessel_guid));
+
+  MOCK_METHOD3(InsertVessels,
+               std::vector<VesselHandle>(
+                   std::vector<GUID> const& vessel_guids,
+                   std::vector<Index> const& parent_indices,
+                   std::vector<RelativeDegreesOfFreedom<AliceSun>> const&
+                       from_parents));
+
+  MOCK_METHOD1(KeepVessels,
+               void(std::vector<VesselHandle> const& vessel_handles));
+
+  MOCK_METHOD1(RemoveVessel, void(GUID const& vessel_guid));
+
   MOCK_METHOD2(SetVesselStateOffset,
                void(GUID const& vessel_guid,
                     RelativeDegreesOfFreedom<AliceSun> const& from_parent));
@@ -41,21 +70,121 @@ class MockPlugin : public Plugin {
   MOCK_METHOD2(AdvanceTime,
                void(Instant const& t, Angle const& planetarium_rotation));
 
+  MOCK_METHOD3(FastForward,
+               void(Instant const& t,
+                    Angle const& planetarium_rotation,
+                    std::function<void(Instant const& history_time)> const&
+                        progress));
+
+  MOCK_METHOD1(SetNumberOfThreads, void(int const number_of_threads));
+
+  MOCK_METHOD1(SetKernelConfiguration,
+               void(KernelConfiguration const& configuration));
+
+  MOCK_METHOD1(SetPipelinedHistories, void(bool const pipelined));
+
+  MOCK_METHOD1(SetKeplerianPerturbationThreshold, void(double const threshold));
+  MOCK_METHOD1(SetClusterTolerance, void(Length const& tolerance));
+
+  MOCK_METHOD1(SetHistoryLookAhead, void(Time const& look_ahead));
+  MOCK_METHOD1(SetHistoryStepBudget, void(int const steps));
+  MOCK_METHOD3(SetHistoryStepPolicy,
+               void(int const steps_per_orbit,
+                    Time const& minimum_step,
+                    Time const& maximum_step));
+  MOCK_METHOD2(SetHistoryRetention,
+               void(Time const& maximum_age,
+                    std::int64_t const maximum_points));
+  MOCK_METHOD2(SetCelestialHistoryCheckpoints,
+               void(int const steps_between_checkpoints,
+                    int const cached_segments));
+
+  MOCK_METHOD2(SetHierarchicalForceModel,
+               void(double const tolerance, bool const use_quadrupole));
+  MOCK_METHOD1(SetCloseEncounterTimescaleFraction,
+               void(double const timescale_fraction));
+
+  MOCK_METHOD2(SetSymplecticIntegrators,
+               void(SPRKScheme const history_scheme,
+                    SPRKScheme const prolongation_scheme));
+  MOCK_METHOD1(SetWisdomHolmanHistories, void(bool const enabled));
+  MOCK_METHOD1(SetMultistepHistories, void(bool const enabled));
+  MOCK_METHOD1(SetPredictionIntegrator,
+               void(SPRKScheme const prediction_scheme));
+  MOCK_METHOD1(SetGaussJacksonPredictions, void(bool const enabled));
+  MOCK_METHOD1(SetPararealPredictions, void(bool const enabled));
+
+  MOCK_METHOD1(SetNumberOfVesselGroups, void(int const number_of_groups));
+
+  MOCK_METHOD1(SetProfiling, void(bool const enabled));
+
+  MOCK_CONST_METHOD0(profile, Profile());
+  MOCK_METHOD1(SetConservationMonitoring, void(int const period));
+  MOCK_CONST_METHOD0(conservation_drift, ConservationDrift());
+  MOCK_CONST_METHOD0(memory_usage, MemoryUsage());
+  MOCK_CONST_METHOD1(VesselMemoryUsage,
+                     std::int64_t(GUID const& vessel_guid));
+  MOCK_CONST_METHOD1(CelestialMemoryUsage,
+                     std::int64_t(Index const celestial_index));
+
+  MOCK_CONST_METHOD1(
+      WriteToRecords,
+      void(std::function<void(
+               not_null<serialization::PluginRecord*> const record)> const&
+               sink));
+  MOCK_CONST_METHOD2(
+      WriteIncrementToRecords,
+      void(Instant const& since,
+           std::function<void(
+               not_null<serialization::PluginRecord*> const record)> const&
+               sink));
+  MOCK_CONST_METHOD1(
+      WriteToUncompressedRecords,
+      void(std::function<void(
+               not_null<serialization::PluginRecord*> const record)> const&
+               sink));
+
   MOCK_CONST_METHOD1(VesselFromParent,
                      RelativeDegreesOfFreedom<AliceSun>(
                          GUID const& vessel_guid));
+  MOCK_CONST_METHOD1(VesselFromParent,
+                     RelativeDegreesOfFreedom<AliceSun>(
+                         VesselHandle const vessel_handle));
 
   MOCK_CONST_METHOD1(CelestialFromParent,
                      RelativeDegreesOfFreedom<AliceSun>(
                          Index const celestial_index));
 
-  MOCK_CONST_METHOD3(RenderedVesselTrajectory,
+  MOCK_CONST_METHOD2(VesselFromParentAt,
+                     RelativeDegreesOfFreedom<AliceSun>(
+                         VesselHandle const vessel_handle,
+                         Instant const& time));
+  MOCK_CONST_METHOD2(CelestialFromParentAt,
+                     RelativeDegreesOfFreedom<AliceSun>(
+                         Index const celestial_index,
+                         Instant const& time));
+
+  MOCK_CONST_METHOD0(AllCelestialsFromParent,
+                     std::vector<RelativeDegreesOfFreedom<AliceSun>>());
+
+  MOCK_CONST_METHOD5(RenderedVesselTrajectory,
                      RenderedTrajectory<World>(
                          GUID const& vessel_guid,
                          not_null<Transforms<
                              Barycentric, Rendering, Barycentric>*> const
                              transforms,
-                         Position<World> const& sun_world_position));
+                         Position<World> const& sun_world_position,
+                         Length const& tolerance,
+                         Instant const& begin));
+  MOCK_CONST_METHOD5(RenderedVesselTrajectories,
+                     std::vector<RenderedTrajectory<World>>(
+                         std::vector<GUID> const& vessel_guids,
+                         not_null<Transforms<
+                             Barycentric, Rendering, Barycentric>*> const
+                             transforms,
+                         Position<World> const& sun_world_position,
+                         Length const& tolerance,
+                         Instant const& begin));
 
   // NOTE(phl): gMock 1.7.0 doesn't support returning a std::unique_ptr<>.  So
   // we override the function of the Plugin class with bona fide functions which
@@ -82,16 +211,60 @@ class MockPlugin : public Plugin {
                               Transforms<Barycentric, Rendering, Barycentric>>*
                                   transforms));
 
+  MOCK_METHOD1(BodyCentredNonRotatingTransforms,
+               not_null<Transforms<Barycentric, Rendering, Barycentric>*>(
+                   Index const reference_body_index));
+  MOCK_METHOD2(BarycentricRotatingTransforms,
+               not_null<Transforms<Barycentric, Rendering, Barycentric>*>(
+                   Index const primary_index,
+                   Index const secondary_index));
+
+  MOCK_CONST_METHOD2(VesselsWithinRadius,
+                     std::vector<VesselHandle>(GUID const& vessel_guid,
+                                               Length const& radius));
+  MOCK_CONST_METHOD3(ClosestVessel,
+                     bool(GUID const& vessel_guid,
+                          not_null<VesselHandle*> const closest,
+                          not_null<Length*> const distance));
+
+  MOCK_CONST_METHOD1(DominantBodies,
+                     std::vector<Index>(std::vector<GUID> const& vessel_guids));
+
+  MOCK_CONST_METHOD9(PorkchopPlot,
+                     std::vector<Speed>(Index const departure_index,
+                                        Index const arrival_index,
+                                        Instant const& departure_min,
+                                        Instant const& departure_max,
+                                        int const departure_points,
+                                        Instant const& arrival_min,
+                                        Instant const& arrival_max,
+                                        int const arrival_points,
+                                        Time const& Δt));
+
   MOCK_CONST_METHOD2(VesselWorldPosition,
                      Position<World>(
                          GUID const& vessel_guid,
                          Position<World> const& parent_world_position));
+  MOCK_CONST_METHOD2(VesselWorldPosition,
+                     Position<World>(
+                         VesselHandle const vessel_handle,
+                         Position<World> const& parent_world_position));
+  MOCK_CONST_METHOD3(VesselWorldPositionAt,
+                     Position<World>(
+                         VesselHandle const vessel_handle,
+                         Position<World> const& parent_world_position,
+                         Instant const& time));
 
   MOCK_CONST_METHOD3(VesselWorldVelocity,
                      Velocity<World>(
                          GUID const& vessel_guid,
                          Velocity<World> const& parent_world_velocity,
                          Time const& parent_rotation_period));
+  MOCK_CONST_METHOD3(VesselWorldVelocity,
+                     Velocity<World>(
+                         VesselHandle const vessel_handle,
+                         Velocity<World> const& parent_world_velocity,
+                         Time const& parent_rotation_period));
 
   // NOTE(phl): Another wrapper needed because gMock 1.7.0 wants to copy the
   // vector of unique_ptr<>.
@@ -113,6 +286,20 @@ class MockPlugin : public Plugin {
                          Index const reference_body_index));
 
   MOCK_CONST_METHOD0(current_time, Instant());
+
+  MOCK_CONST_METHOD0(state_table, StateTable const&());
+
+  MOCK_METHOD0(SaveCheckpoint, std::int64_t());
+
+  MOCK_CONST_METHOD1(HasCheckpoint, bool(std::int64_t const checkpoint_id));
+
+  // See the NOTE above.
+  std::unique_ptr<Plugin> RestoreCheckpoint(
+      std::int64_t const checkpoint_id) const override;
+
+  MOCK_CONST_METHOD2(FillRestoredCheckpoint,
+                     void(std::int64_t const checkpoint_id,
+                          std::unique_ptr<Plugin>* plugin));
 };
 
 }  // namespace ksp_plugin
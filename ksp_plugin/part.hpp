@@ -1,8 +1,11 @@
 #pragma once
 
+#include <functional>
 #include <map>
 #include <memory>
+#include <utility>
 
+#include "base/pool_allocator.hpp"
 #include "ksp_plugin/frames.hpp"
 #include "geometry/grassmann.hpp"
 #include "geometry/named_quantities.hpp"
@@ -34,6 +37,11 @@ class Part {
        Vector<Acceleration, Frame> const&
            gravitational_acceleration_to_be_applied_by_ksp);
 
+  // The parts are recreated by the adapter for each frame, so their memory is
+  // recycled by the pool.
+  static void* operator new(std::size_t const size);
+  static void operator delete(void* const part, std::size_t const size);
+
   DegreesOfFreedom<Frame> const& degrees_of_freedom() const;
   Mass const& mass() const;
   Vector<Acceleration, Frame> const&
@@ -54,8 +62,14 @@ class Part {
 template<typename Frame>
 std::ostream& operator<<(std::ostream& out, Part<Frame> const& part);
 
-using PartIdToOwnedPart = std::map<PartId,
-                                   not_null<std::unique_ptr<Part<World>>>>;
+// The nodes of the map are allocated by the pool, like the parts themselves.
+using PartIdToOwnedPart =
+    std::map<PartId,
+             not_null<std::unique_ptr<Part<World>>>,
+             std::less<PartId>,
+             base::PoolAllocator<
+                 std::pair<PartId const,
+                           not_null<std::unique_ptr<Part<World>>>>>>;
 using IdAndOwnedPart = PartIdToOwnedPart::value_type;
 
 }  // namespace ksp_plugin
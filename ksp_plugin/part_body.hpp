@@ -16,6 +16,16 @@ Part<Frame>::Part(
       gravitational_acceleration_to_be_applied_by_ksp_(
           gravitational_acceleration_to_be_applied_by_ksp) {}
 
+template<typename Frame>
+void* Part<Frame>::operator new(std::size_t const size) {
+  return base::Pool::Allocate(size);
+}
+
+template<typename Frame>
+void Part<Frame>::operator delete(void* const part, std::size_t const size) {
+  base::Pool::Deallocate(part, size);
+}
+
 template<typename Frame>
 DegreesOfFreedom<Frame> const& Part<Frame>::degrees_of_freedom() const {
   return degrees_of_freedom_;
@@ -1,11 +1,15 @@
 ﻿#include "ksp_plugin/physics_bubble.hpp"
 
+#include <algorithm>
+#include <deque>
 #include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "base/macros.hpp"
+#include "base/memory_usage.hpp"
+#include "base/tracer.hpp"
 #include "base/unique_ptr_logging.hpp"
 #include "geometry/barycentre_calculator.hpp"
 #include "geometry/identity.hpp"
@@ -14,8 +18,13 @@
 #include "physics/degrees_of_freedom.hpp"
 #include "quantities/quantities.hpp"
 
+using principia::base::ScopedTraceEvent;
+using principia::base::TreeMemoryUsage;
+using principia::base::VectorMemoryUsage;
 using principia::geometry::BarycentreCalculator;
 using principia::geometry::Identity;
+using principia::physics::GroupBarycentres;
+using principia::quantities::Quotient;
 using principia::quantities::Time;
 
 namespace principia {
@@ -53,20 +62,21 @@ void PhysicsBubble::Prepare(PlanetariumRotation const& planetarium_rotation,
                             Instant const& next_time) {
   VLOG(1) << __FUNCTION__ << '\n'
           << NAMED(current_time) << '\n' << NAMED(next_time);
+  ScopedTraceEvent const trace_event(__FUNCTION__);
   std::unique_ptr<FullState> next;
   if (next_ != nullptr) {
     next = std::make_unique<FullState>(std::move(*next_));
     next_.reset();
-    ComputeNextCentreOfMassWorldDegreesOfFreedom(next.get());
-    ComputeNextVesselOffsets(planetarium_rotation, next.get());
+    ComputeNextCentreOfMassAndVesselOffsets(planetarium_rotation, next.get());
     if (current_ == nullptr) {
       // There was no physics bubble.
       RestartNext(current_time, next.get());
     } else {
+      bool const same_parts = HasSameParts(*next);
       // The IDs of the parts that are both in the current and in the next
       // physics bubble.
       std::vector<PartCorrespondence> const common_parts =
-          ComputeCommonParts(*next);
+          ComputeCommonParts(*next, same_parts);
       if (common_parts.empty()) {
         // The current and next set of parts are disjoint, i.e., the next
         // physics bubble is unrelated to the current one.
@@ -74,13 +84,12 @@ void PhysicsBubble::Prepare(PlanetariumRotation const& planetarium_rotation,
       } else {
         Vector<Acceleration, World> const intrinsic_acceleration =
             IntrinsicAcceleration(current_time, next_time, common_parts);
-        if (common_parts.size() == next->parts.size() &&
-            common_parts.size() == current_->parts.size()) {
-          // The set of parts has not changed.
+        if (same_parts) {
+          // The set of parts has not changed.  The history of the trajectory
+          // is not needed, so it does not grow.
           next->centre_of_mass_trajectory =
               std::move(current_->centre_of_mass_trajectory);
-          // TODO(egg): we end up dragging some history along here, we probably
-          // should not.
+          TrimCentreOfMassTrajectory(next->centre_of_mass_trajectory.get());
         } else {
           // Parts appeared or were removed from the physics bubble, but the
           // intersection is nonempty.  We fix the degrees of freedom of the
@@ -90,19 +99,31 @@ void PhysicsBubble::Prepare(PlanetariumRotation const& planetarium_rotation,
         }
         // Correct since |World| is currently nonrotating.
         Vector<Acceleration, Barycentric> barycentric_intrinsic_acceleration =
-            planetarium_rotation.Inverse()(
-                Identity<World, WorldSun>()(intrinsic_acceleration));
+            (planetarium_rotation.Inverse() * Identity<World, WorldSun>())(
+                intrinsic_acceleration);
         VLOG(1) << NAMED(barycentric_intrinsic_acceleration);
         if (next->centre_of_mass_trajectory->has_intrinsic_acceleration()) {
           next->centre_of_mass_trajectory->clear_intrinsic_acceleration();
         }
-        // TODO(egg): this makes the intrinsic acceleration a step function.
-        // Might something smoother be better?  We need to be careful not to be
-        // one step or half a step in the past though.
+        // If the set of parts has not changed, the intrinsic acceleration is
+        // extrapolated linearly from the last two measurements, so that it is
+        // not a step function.  Otherwise it is constant.
+        // TODO(egg): We need to be careful not to be one step or half a step
+        // in the past though.
+        Vector<Quotient<Acceleration, Time>, Barycentric> jerk;
+        if (same_parts &&
+            current_->intrinsic_acceleration != nullptr &&
+            current_->intrinsic_acceleration->epoch < current_time) {
+          jerk = (barycentric_intrinsic_acceleration -
+                  current_->intrinsic_acceleration->acceleration) /
+                 (current_time - current_->intrinsic_acceleration->epoch);
+        }
+        next->intrinsic_acceleration = std::make_unique<
+            Trajectory<Barycentric>::AffineIntrinsicAcceleration>(
+                Trajectory<Barycentric>::AffineIntrinsicAcceleration{
+                    current_time, barycentric_intrinsic_acceleration, jerk});
         next->centre_of_mass_trajectory->set_intrinsic_acceleration(
-            [barycentric_intrinsic_acceleration](Instant const& t) {
-              return barycentric_intrinsic_acceleration;
-            });
+            *next->intrinsic_acceleration);
       }
     }
   }
@@ -125,11 +146,11 @@ Displacement<World> PhysicsBubble::DisplacementCorrection(
   if (current_->displacement_correction == nullptr) {
     current_->displacement_correction =
         std::make_unique<Displacement<World>>(
-          Identity<WorldSun, World>()(planetarium_rotation(
+          (Identity<WorldSun, World>() * planetarium_rotation)(
               current_->centre_of_mass_trajectory->
                   last().degrees_of_freedom().position() -
               reference_celestial.prolongation().
-                  last().degrees_of_freedom().position())) +
+                  last().degrees_of_freedom().position()) +
           reference_celestial_world_position -
               current_->centre_of_mass->position());
   }
@@ -144,11 +165,11 @@ Velocity<World> PhysicsBubble::VelocityCorrection(
   if (current_->velocity_correction == nullptr) {
     current_->velocity_correction =
         std::make_unique<Velocity<World>>(
-            Identity<WorldSun, World>()(planetarium_rotation(
+            (Identity<WorldSun, World>() * planetarium_rotation)(
                 current_->centre_of_mass_trajectory->
                     last().degrees_of_freedom().velocity() -
                 reference_celestial.prolongation().
-                    last().degrees_of_freedom().velocity())) -
+                    last().degrees_of_freedom().velocity()) -
             current_->centre_of_mass->velocity());
   }
   VLOG_AND_RETURN(1, *current_->velocity_correction);
@@ -170,11 +191,60 @@ std::size_t PhysicsBubble::number_of_vessels() const {
   }
 }
 
+std::int64_t PhysicsBubble::MemoryUsage() const {
+  auto const preliminary_state_usage = [](PreliminaryState const& state) {
+    std::int64_t usage =
+        TreeMemoryUsage(state.vessels) + TreeMemoryUsage(state.parts) +
+        state.parts.size() * sizeof(Part<World>);
+    for (auto const& pair : state.vessels) {
+      usage += VectorMemoryUsage(pair.second);
+    }
+    return usage;
+  };
+  std::int64_t usage = sizeof(PhysicsBubble);
+  if (current_ != nullptr) {
+    usage += sizeof(FullState) + preliminary_state_usage(*current_);
+    if (current_->centre_of_mass != nullptr) {
+      usage += sizeof(DegreesOfFreedom<World>);
+    }
+    if (current_->centre_of_mass_trajectory != nullptr) {
+      usage += current_->centre_of_mass_trajectory->MemoryUsage();
+    }
+    if (current_->from_centre_of_mass != nullptr) {
+      usage += sizeof(*current_->from_centre_of_mass) +
+               TreeMemoryUsage(*current_->from_centre_of_mass);
+    }
+    usage += VectorMemoryUsage(current_->vessel_masses);
+    if (current_->displacement_correction != nullptr) {
+      usage += sizeof(Displacement<World>);
+    }
+    if (current_->velocity_correction != nullptr) {
+      usage += sizeof(Velocity<World>);
+    }
+    if (current_->intrinsic_acceleration != nullptr) {
+      usage += sizeof(Trajectory<Barycentric>::AffineIntrinsicAcceleration);
+    }
+  }
+  if (next_ != nullptr) {
+    usage += sizeof(PreliminaryState) + preliminary_state_usage(*next_);
+  }
+  return usage;
+}
+
 bool PhysicsBubble::contains(not_null<Vessel*> const vessel) const {
   return !empty() &&
          current_->vessels.find(vessel) != current_->vessels.end();
 }
 
+bool PhysicsBubble::will_contain(not_null<Vessel*> const vessel) const {
+  return !will_be_empty() &&
+         next_->vessels.find(vessel) != next_->vessels.end();
+}
+
+bool PhysicsBubble::will_be_empty() const {
+  return next_ == nullptr;
+}
+
 std::vector<not_null<Vessel*>> PhysicsBubble::vessels() const {
   CHECK(!empty()) << "Empty bubble";
   std::vector<not_null<Vessel*>> vessels;
@@ -325,59 +395,64 @@ PhysicsBubble::FullState::FullState(
   vessels = std::move(preliminary_state.vessels);
 }
 
-void PhysicsBubble::ComputeNextCentreOfMassWorldDegreesOfFreedom(
+void PhysicsBubble::ComputeNextCentreOfMassAndVesselOffsets(
+    PlanetariumRotation const& planetarium_rotation,
     not_null<FullState*> const next) {
   VLOG(1) << __FUNCTION__;
-  DegreesOfFreedom<World>::BarycentreCalculator<Mass> centre_of_mass_calculator;
-  for (auto const& id_part : next->parts) {
-    not_null<std::unique_ptr<Part<World>>> const& part = id_part.second;
-    centre_of_mass_calculator.Add(part->degrees_of_freedom(), part->mass());
+  VLOG(1) << NAMED(next->vessels.size());
+  // The parts are laid out contiguously, grouped by vessel.
+  std::vector<DegreesOfFreedom<World>> part_degrees_of_freedom;
+  std::vector<Mass> part_masses;
+  std::vector<std::size_t> vessel_ends;
+  part_degrees_of_freedom.reserve(next->parts.size());
+  part_masses.reserve(next->parts.size());
+  vessel_ends.reserve(next->vessels.size());
+  for (auto const& vessel_parts : next->vessels) {
+    std::vector<not_null<Part<World>*> const> const& parts =
+        vessel_parts.second;
+    VLOG(1) << NAMED(vessel_parts.first) << ", " << NAMED(parts.size());
+    for (auto const part : parts) {
+      part_degrees_of_freedom.push_back(part->degrees_of_freedom());
+      part_masses.push_back(part->mass());
+    }
+    vessel_ends.push_back(part_degrees_of_freedom.size());
   }
+  CHECK_EQ(next->parts.size(), part_degrees_of_freedom.size());
+  std::vector<DegreesOfFreedom<World>> vessel_degrees_of_freedom;
   next->centre_of_mass = std::make_unique<DegreesOfFreedom<World>>(
-                             centre_of_mass_calculator.Get());
+      GroupBarycentres<World, Mass>(part_degrees_of_freedom,
+                                    part_masses,
+                                    vessel_ends,
+                                    &vessel_degrees_of_freedom,
+                                    &next->vessel_masses));
   VLOG(1) << NAMED(*next->centre_of_mass);
-}
 
-void PhysicsBubble::ComputeNextVesselOffsets(
-    PlanetariumRotation const& planetarium_rotation,
-    not_null<FullState*> const next) {
-  VLOG(1) << __FUNCTION__;
   next->from_centre_of_mass =
       std::make_unique<std::map<not_null<Vessel const*> const,
                                 RelativeDegreesOfFreedom<Barycentric>>>();
-  VLOG(1) << NAMED(next->vessels.size());
+  auto const from_world =
+      planetarium_rotation.Inverse() * Identity<World, WorldSun>();
+  std::size_t v = 0;
   for (auto const& vessel_parts : next->vessels) {
-    not_null<Vessel const*> const vessel = vessel_parts.first;
-    std::vector<not_null<Part<World>*> const> const& parts =
-        vessel_parts.second;
-    VLOG(1) << NAMED(vessel) << ", " << NAMED(parts.size());
-    DegreesOfFreedom<World>::BarycentreCalculator<Mass> vessel_calculator;
-    for (auto const part : parts) {
-      vessel_calculator.Add(part->degrees_of_freedom(), part->mass());
-    }
-    DegreesOfFreedom<World> const vessel_degrees_of_freedom =
-        vessel_calculator.Get();
     auto const from_centre_of_mass =
-        planetarium_rotation.Inverse()(
-            Identity<World, WorldSun>()(
-                vessel_degrees_of_freedom - *next->centre_of_mass));
+        from_world(vessel_degrees_of_freedom[v] - *next->centre_of_mass);
     VLOG(1) << NAMED(from_centre_of_mass);
-    next->from_centre_of_mass->emplace(vessel, from_centre_of_mass);
+    next->from_centre_of_mass->emplace(vessel_parts.first, from_centre_of_mass);
+    ++v;
   }
 }
 
 void PhysicsBubble::RestartNext(Instant const& current_time,
                                 not_null<FullState*> const next) {
   VLOG(1) << __FUNCTION__<< '\n' << NAMED(current_time);
+  CHECK_EQ(next->vessels.size(), next->vessel_masses.size());
   DegreesOfFreedom<Barycentric>::BarycentreCalculator<Mass> bubble_calculator;
+  std::size_t v = 0;
   for (auto const& vessel_parts : next->vessels) {
     not_null<Vessel const*> vessel = vessel_parts.first;
-    std::vector<not_null<Part<World>*> const> const& parts =
-        vessel_parts.second;
-    for (not_null<Part<World> const*> const part : parts) {
-      bubble_calculator.Add(vessel->prolongation().last().degrees_of_freedom(),
-                            part->mass());
-    }
+    bubble_calculator.Add(vessel->prolongation().last().degrees_of_freedom(),
+                          next->vessel_masses[v]);
+    ++v;
   }
   next->centre_of_mass_trajectory =
       std::make_unique<Trajectory<Barycentric>>(&body_);
@@ -385,12 +460,34 @@ void PhysicsBubble::RestartNext(Instant const& current_time,
                                           bubble_calculator.Get());
 }
 
+bool PhysicsBubble::HasSameParts(FullState const& next) const {
+  return current_->parts.size() == next.parts.size() &&
+         std::equal(current_->parts.cbegin(),
+                    current_->parts.cend(),
+                    next.parts.cbegin(),
+                    [](IdAndOwnedPart const& current_id_part,
+                       IdAndOwnedPart const& next_id_part) {
+                      return current_id_part.first == next_id_part.first;
+                    });
+}
+
 std::vector<PhysicsBubble::PartCorrespondence>
-PhysicsBubble::ComputeCommonParts(FullState const& next) {
+PhysicsBubble::ComputeCommonParts(FullState const& next,
+                                  bool const same_parts) {
   VLOG(1) << __FUNCTION__;
   std::vector<PartCorrespondence> common_parts;
   // Most of the time no parts explode.  We reserve accordingly.
   common_parts.reserve(current_->parts.size());
+  if (same_parts) {
+    // The maps have the same keys in the same order.
+    auto it_in_next_parts = next.parts.cbegin();
+    for (auto const& current_id_part : current_->parts) {
+      common_parts.emplace_back(current_id_part.second.get(),
+                                it_in_next_parts->second.get());
+      ++it_in_next_parts;
+    }
+    VLOG_AND_RETURN(1, common_parts);
+  }
   for (auto it_in_current_parts = current_->parts.cbegin(),
             it_in_next_parts = next.parts.cbegin();
        it_in_current_parts != current_->parts.end() &&
@@ -439,6 +536,22 @@ Vector<Acceleration, World> PhysicsBubble::IntrinsicAcceleration(
   VLOG_AND_RETURN(1, acceleration_calculator.Get());
 }
 
+void PhysicsBubble::TrimCentreOfMassTrajectory(
+    not_null<Trajectory<Barycentric>*> const trajectory) {
+  // The times of the last |kCentreOfMassTrajectoryPoints| + 1 points.
+  std::deque<Instant> last_times;
+  for (auto it = trajectory->first(); !it.at_end(); ++it) {
+    last_times.push_back(it.time());
+    if (static_cast<int>(last_times.size()) >
+            kCentreOfMassTrajectoryPoints + 1) {
+      last_times.pop_front();
+    }
+  }
+  if (static_cast<int>(last_times.size()) > kCentreOfMassTrajectoryPoints) {
+    trajectory->ForgetBefore(last_times.front());
+  }
+}
+
 void PhysicsBubble::Shift(PlanetariumRotation const& planetarium_rotation,
                           Instant const& current_time,
                           std::vector<PartCorrespondence> const& common_parts,
@@ -472,8 +585,9 @@ void PhysicsBubble::Shift(PlanetariumRotation const& planetarium_rotation,
   // it is stationary with respect to |WorldSun|.
   next->centre_of_mass_trajectory->Append(
       current_time,
-      current_centre_of_mass + planetarium_rotation.Inverse()(
-                                   Identity<World, WorldSun>()(change)));
+      current_centre_of_mass +
+          (planetarium_rotation.Inverse() * Identity<World, WorldSun>())(
+              change));
 }
 
 }  // namespace ksp_plugin
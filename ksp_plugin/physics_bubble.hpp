@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
@@ -39,6 +40,8 @@ class PhysicsBubble {
   // (including intrinsic acceleration) of |*next_|. Moves |next_| into
   // |current_|.  The trajectory of the centre of mass is reset to a single
   // point at |current_time| if the composition of the bubble changes.
+  // Otherwise it is trimmed to its last |kCentreOfMassTrajectoryPoints|
+  // points.
   // TODO(phl): Document the parameters!
   void Prepare(PlanetariumRotation const& planetarium_rotation,
                Instant const& current_time,
@@ -59,6 +62,10 @@ class PhysicsBubble {
       PlanetariumRotation const& planetarium_rotation,
       Celestial const& reference_celestial) const;
 
+  // The number of points of the trajectory of the centre of mass that are kept
+  // from frame to frame.  Only the last one is used for integration.
+  static int const kCentreOfMassTrajectoryPoints = 4;
+
   // Returns |current_ == nullptr|.
   bool empty() const;
 
@@ -68,10 +75,23 @@ class PhysicsBubble {
   // Returns |current_->vessels.size()|, or 0 if |empty()|.
   std::size_t number_of_vessels() const;
 
+  // Returns an estimate of the memory used by this object, its current and next
+  // states, their parts, and the trajectory of the centre of mass, in bytes.
+  std::int64_t MemoryUsage() const;
+
   // Returns true if, and only if, |vessel| is in |current_->vessels|.
   // |current_| may be null, in that case, returns false.
   bool contains(not_null<Vessel*> const vessel) const;
 
+  // Returns true if, and only if, |vessel| is in |next_->vessels|, i.e., if it
+  // will be in the physics bubble after the next call to |Prepare|.  |next_|
+  // may be null, in that case, returns false.
+  bool will_contain(not_null<Vessel*> const vessel) const;
+
+  // Returns |next_ == nullptr|, i.e., whether the physics bubble will be empty
+  // after the next call to |Prepare|.
+  bool will_be_empty() const;
+
   // Selectors for the data in |current_|.
   std::vector<not_null<Vessel*>> vessels() const;
   RelativeDegreesOfFreedom<Barycentric> const& from_centre_of_mass(
@@ -108,32 +128,45 @@ class PhysicsBubble {
     std::unique_ptr<std::map<not_null<Vessel const*> const,
                              RelativeDegreesOfFreedom<Barycentric>>>
         from_centre_of_mass;
+    // The masses of the vessels, in the order of |vessels|.  Computed with
+    // |from_centre_of_mass|.  Not serialized.
+    std::vector<Mass> vessel_masses;
     std::unique_ptr<Displacement<World>> displacement_correction;
     std::unique_ptr<Velocity<World>> velocity_correction;
+    // The intrinsic acceleration of |centre_of_mass_trajectory|, whose
+    // |acceleration| is the one measured at its |epoch|.  Null if none was
+    // measured.  Not serialized.
+    std::unique_ptr<Trajectory<Barycentric>::AffineIntrinsicAcceleration>
+        intrinsic_acceleration;
   };
 
-  // Computes the world degrees of freedom of the centre of mass of
-  // |next| using the contents of |next->parts|.
-  void ComputeNextCentreOfMassWorldDegreesOfFreedom(
-      not_null<FullState*> const next);
-
-  // Computes |next->displacements_from_centre_of_mass| and
-  // |next->velocities_from_centre_of_mass|.
-  void ComputeNextVesselOffsets(
+  // Computes |next->centre_of_mass|, the world degrees of freedom of the
+  // centre of mass of the parts of |next|, |next->from_centre_of_mass| and
+  // |next->vessel_masses|, with a single pass over the parts of the vessels of
+  // |next->vessels|, see |GroupBarycentres|.
+  void ComputeNextCentreOfMassAndVesselOffsets(
       PlanetariumRotation const& planetarium_rotation,
       not_null<FullState*> const next);
 
   // Creates |next->centre_of_mass_trajectory| and appends to it the barycentre
-  // of the degrees of freedom of the vessels in |next->vessels|.  There is no
-  // intrinsic acceleration.
+  // of the degrees of freedom of the vessels in |next->vessels|, weighted by
+  // |next->vessel_masses|.  There is no intrinsic acceleration.
   void RestartNext(Instant const& current_time,
                    not_null<FullState*> const next);
 
+  // Returns true if, and only if, |current_| and |next| have the same part
+  // ids.  This is the case of most frames, and it is cheaper to check than to
+  // compute the intersection of the sets of parts.
+  bool HasSameParts(FullState const& next) const;
+
   // Returns the parts common to |current_| and |next|.  The returned vector
   // contains pair of pointers to parts (current_part, next_part) for all parts
-  // common to the two bubbles
+  // common to the two bubbles.  |same_parts| must be the result of
+  // |HasSameParts(next)|; if it is true the parts are matched without
+  // comparing their ids.
   std::vector<PhysicsBubble::PartCorrespondence> ComputeCommonParts(
-      FullState const& next);
+      FullState const& next,
+      bool const same_parts);
 
   // Returns the intrinsic acceleration measured on the parts that are common to
   // the current and next bubbles.
@@ -142,6 +175,11 @@ class PhysicsBubble {
       Instant const& next_time,
       std::vector<PartCorrespondence>const& common_parts);
 
+  // Removes the points of |trajectory| before its last
+  // |kCentreOfMassTrajectoryPoints| points.
+  static void TrimCentreOfMassTrajectory(
+      not_null<Trajectory<Barycentric>*> const trajectory);
+
   // Given the vector of common parts, constructs
   // |next->centre_of_mass_trajectory| and appends degrees of freedom at
   // |current_time| that conserve the degrees of freedom of the centre of mass
@@ -1,14 +1,21 @@
 ﻿#include "ksp_plugin/plugin.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <future>
+#include <limits>
+#include <list>
 #include <map>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 #include <set>
 
+#include "base/cpu_features.hpp"
 #include "base/not_null.hpp"
+#include "base/tracer.hpp"
 #include "base/unique_ptr_logging.hpp"
 #include "geometry/affine_map.hpp"
 #include "geometry/barycentre_calculator.hpp"
@@ -17,18 +24,37 @@
 #include "geometry/permutation.hpp"
 #include "glog/logging.h"
 #include "glog/stl_logging.h"
+#include "google/protobuf/arena.h"
+#include "physics/ephemeris.hpp"
+#include "physics/trajectory_compression.hpp"
 
 namespace principia {
 namespace ksp_plugin {
 
+using base::check_not_null;
+using base::DetectedCPUFeatures;
 using base::make_not_null_unique;
+using base::ScopedAllocationCounter;
+using base::ScopedTraceEvent;
 using geometry::AffineMap;
 using geometry::AngularVelocity;
 using geometry::BarycentreCalculator;
 using geometry::Bivector;
 using geometry::Identity;
+using geometry::InnerProduct;
+using geometry::Normalize;
 using geometry::Permutation;
+using geometry::R3Element;
+using geometry::Vector;
+using geometry::Wedge;
+using physics::CompressColumns;
+using physics::Ephemeris;
+using physics::LambertTransfer;
+using quantities::Acceleration;
 using quantities::Force;
+using quantities::Pow;
+using quantities::SpecificEnergy;
+using quantities::Sqrt;
 using si::Radian;
 
 namespace {
@@ -41,34 +67,198 @@ Permutation<World, AliceWorld> const kWorldLookingGlass(
 Permutation<WorldSun, AliceSun> const kSunLookingGlass(
     Permutation<WorldSun, AliceSun>::CoordinatePermutation::XZY);
 
+// The coarse propagator of the Parareal predictions makes steps this many times
+// longer than the fine one, and the iterations stop when the states at the
+// ends of the slices change by less than this fraction of their magnitude.
+int const kPararealCoarseStepRatio = 8;
+double const kPararealTolerance = 1E-10;
+
+// |FastForward| integrates the histories in chunks of at most this many steps,
+// between which it forgets old history points and reports its progress.
+int const kFastForwardChunkSteps = 1000;
+
+Rotation<Barycentric, WorldSun> BarycentricToWorldSun(
+    Angle const& planetarium_rotation) {
+  return Rotation<Barycentric, WorldSun>(
+      planetarium_rotation,
+      Bivector<double, Barycentric>({0, 1, 0}));
+}
+
+// Adds the wall-clock time elapsed during its lifetime to |*duration|, unless
+// |duration| is null.
+class PhaseTimer {
+ public:
+  explicit PhaseTimer(Time* const duration)
+      : duration_(duration),
+        start_(duration == nullptr ? std::chrono::steady_clock::time_point()
+                                   : std::chrono::steady_clock::now()) {}
+
+  ~PhaseTimer() {
+    if (duration_ != nullptr) {
+      *duration_ += std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start_).count() *
+                    Second;
+    }
+  }
+
+ private:
+  Time* const duration_;
+  std::chrono::steady_clock::time_point const start_;
+};
+
+// A record allocated on its own arena: the many small sub-messages of its
+// trajectories are allocated in a few large blocks, and freed all at once when
+// the |ArenaRecord| is destroyed.
+class ArenaRecord {
+ public:
+  ArenaRecord()
+      : record_(google::protobuf::Arena::CreateMessage<
+                    serialization::PluginRecord>(&arena_)) {}
+
+  not_null<serialization::PluginRecord*> get() const {
+    return record_;
+  }
+
+ private:
+  google::protobuf::Arena arena_;
+  not_null<serialization::PluginRecord*> const record_;
+};
+
+// Returns the distance from |point| to the segment [|begin|, |end|].
+Length DistanceToSegment(Position<World> const& point,
+                         Position<World> const& begin,
+                         Position<World> const& end) {
+  Displacement<World> const segment = end - begin;
+  Displacement<World> const from_begin = point - begin;
+  auto const segment_squared = InnerProduct(segment, segment);
+  if (segment_squared == decltype(segment_squared)()) {
+    return from_begin.Norm();
+  }
+  double const t = std::min(
+      1.0,
+      std::max(0.0, InnerProduct(from_begin, segment) / segment_squared));
+  return (from_begin - t * segment).Norm();
+}
+
+// Simplifies the polygon |*positions| with the Douglas-Peucker algorithm: the
+// points that are removed are within |tolerance| of the segment between the
+// nearest points that are kept on either side.  The first and last points are
+// always kept.
+void Simplify(Length const& tolerance,
+              not_null<std::vector<Position<World>>*> const positions) {
+  if (positions->size() <= 2) {
+    return;
+  }
+  std::vector<bool> kept(positions->size(), false);
+  kept.front() = true;
+  kept.back() = true;
+  // The ranges [first, last] of indices that remain to be simplified.  A stack
+  // is used rather than recursion, since the polygons may have tens of
+  // thousands of points.
+  std::vector<std::pair<std::size_t, std::size_t>> ranges;
+  ranges.emplace_back(0, positions->size() - 1);
+  while (!ranges.empty()) {
+    std::size_t const first = ranges.back().first;
+    std::size_t const last = ranges.back().second;
+    ranges.pop_back();
+    Length farthest_distance;
+    std::size_t farthest = first;
+    for (std::size_t i = first + 1; i < last; ++i) {
+      Length const distance = DistanceToSegment((*positions)[i],
+                                                (*positions)[first],
+                                                (*positions)[last]);
+      if (distance > farthest_distance) {
+        farthest_distance = distance;
+        farthest = i;
+      }
+    }
+    if (farthest_distance > tolerance) {
+      kept[farthest] = true;
+      ranges.emplace_back(first, farthest);
+      ranges.emplace_back(farthest, last);
+    }
+  }
+  std::size_t size = 0;
+  for (std::size_t i = 0; i < positions->size(); ++i) {
+    if (kept[i]) {
+      (*positions)[size] = (*positions)[i];
+      ++size;
+    }
+  }
+  positions->resize(size);
+}
+
 }  // namespace
 
+int const Plugin::kSerializationVersion;
+std::int64_t const Plugin::kForgottenPointsPerAdvanceTime;
+int const Plugin::kMaximumCelestialHistorySegmentSteps;
+
 Plugin::Plugin(GUIDToOwnedVessel vessels,
                IndexToOwnedCelestial celestials,
-               std::set<not_null<Vessel*> const> dirty_vessels,
+               std::set<GUID> const& dirty_vessels,
                not_null<std::unique_ptr<PhysicsBubble>> bubble,
                Angle planetarium_rotation,
                Instant current_time,
                Index sun_index)
     : vessels_(std::move(vessels)),
       celestials_(std::move(celestials)),
-      dirty_vessels_(std::move(dirty_vessels)),
       bubble_(std::move(bubble)),
-      n_body_system_(make_not_null_unique<NBodySystem<Barycentric>>()),
+      n_body_system_(make_not_null_unique<NBodySystem<Barycentric>>(
+          NBodySystem<Barycentric>::Layout::kStructureOfArrays)),
       planetarium_rotation_(planetarium_rotation),
+      barycentric_to_world_sun_(BarycentricToWorldSun(planetarium_rotation)),
+      barycentric_to_world_(Identity<WorldSun, World>() *
+                            barycentric_to_world_sun_),
       current_time_(current_time),
+      previous_time_(current_time),
       // TODO(egg): don't use |find|, use |FindOrDie|.
-      sun_(celestials_.find(sun_index)->second.get()) {
-  for (auto const& guid_vessel : vessels_) {
-    auto const& vessel = guid_vessel.second;
-    if (!vessel->is_synchronized()) {
-      unsynchronized_vessels_.emplace(vessel.get());
+      sun_(celestials_.find(sun_index)->second.get()),
+      background_n_body_system_(make_not_null_unique<NBodySystem<Barycentric>>(
+          NBodySystem<Barycentric>::Layout::kStructureOfArrays)),
+      celestial_history_n_body_system_(
+          make_not_null_unique<NBodySystem<Barycentric>>(
+              NBodySystem<Barycentric>::Layout::kStructureOfArrays)) {
+  // Detect the features of the processor before the vectorized kernels are
+  // used concurrently.
+  DetectedCPUFeatures();
+  for (auto const& index_celestial : celestials_) {
+    index_celestial.second->mutable_history()->set_downsampling(
+        history_downsampling_);
+  }
+  for (auto it = vessels_.cbegin(); it != vessels_.cend(); ++it) {
+    auto const& vessel = it->second;
+    if (vessel->is_synchronized()) {
+      vessel->set_history_downsampling(history_downsampling_);
+    } else {
+      ++number_of_unsynchronized_vessels_;
+    }
+    VesselSlot& slot = vessel_slots_[vessel_slot_index(
+                                         AllocateVesselHandle(it))];
+    if (dirty_vessels.count(it->first) > 0) {
+      slot.dirty = true;
+      ++number_of_dirty_vessels_;
     }
   }
-  history_integrator_.Initialize(history_integrator_.Order5Optimal());
+  history_integrator_.Initialize(SPRKScheme::kMcLachlanAtela1992Order5Optimal);
+  wisdom_holman_integrator_.Initialize(history_integrator_.Order5Optimal());
+  multistep_history_integrator_.Initialize(
+      multistep_history_integrator_.QuinlanTremaine1990Order8());
   // NOTE(egg): perhaps a lower order would be appropriate.
-  prolongation_integrator_.Initialize(history_integrator_.Order5Optimal());
+  prolongation_integrator_.Initialize(
+      SPRKScheme::kMcLachlanAtela1992Order5Optimal);
+  prediction_integrator_.Initialize(
+      SPRKScheme::kMcLachlanAtela1992Order5Optimal);
+  gauss_jackson_prediction_integrator_.Initialize(
+      gauss_jackson_prediction_integrator_.Order8());
+  parareal_prediction_integrator_.Initialize(
+      history_integrator_.Order5Optimal());
+  parareal_prediction_integrator_.InitializeCoarse(
+      history_integrator_.CoefficientsOf(
+          SPRKScheme::kMcLachlanAtela1992Order4Optimal),
+      kPararealCoarseStepRatio);
   EndInitialization();
+  UpdateVesselGrid();
 }
 
 not_null<std::unique_ptr<Vessel>> const& Plugin::find_vessel_by_guid_or_die(
@@ -79,124 +269,694 @@ not_null<std::unique_ptr<Vessel>> const& Plugin::find_vessel_by_guid_or_die(
   VLOG_AND_RETURN(1, it->second);
 }
 
+Plugin::VesselSlot const& Plugin::find_vessel_slot_or_die(
+    VesselHandle const vessel_handle) const {
+  return vessel_slots_[vessel_slot_index(vessel_handle)];
+}
+
+std::uint32_t Plugin::vessel_slot_index(
+    VesselHandle const vessel_handle) const {
+  std::uint32_t const index =
+      static_cast<std::uint32_t>(vessel_handle & 0xFFFFFFFF);
+  std::uint32_t const generation =
+      static_cast<std::uint32_t>(vessel_handle >> 32);
+  CHECK_LE(0, vessel_handle) << "Invalid vessel handle " << vessel_handle;
+  CHECK_LT(index, vessel_slots_.size())
+      << "Invalid vessel handle " << vessel_handle;
+  VesselSlot const& slot = vessel_slots_[index];
+  CHECK(slot.guid != nullptr && slot.generation == generation)
+      << "Stale vessel handle " << vessel_handle;
+  return index;
+}
+
+VesselHandle Plugin::AllocateVesselHandle(
+    GUIDToOwnedVessel::const_iterator const it) {
+  std::uint32_t index;
+  if (free_vessel_slots_.empty()) {
+    index = static_cast<std::uint32_t>(vessel_slots_.size());
+    vessel_slots_.emplace_back();
+  } else {
+    index = free_vessel_slots_.back();
+    free_vessel_slots_.pop_back();
+  }
+  VesselSlot& slot = vessel_slots_[index];
+  slot.guid = &it->first;
+  slot.vessel = it->second.get();
+  VesselHandle const handle =
+      (static_cast<VesselHandle>(slot.generation) << 32) | index;
+  auto const inserted = vessel_handles_.emplace(it->first, handle);
+  CHECK(inserted.second) << "Vessel with GUID " << it->first
+                         << " already has a handle";
+  return handle;
+}
+
+void Plugin::FreeVesselHandle(GUID const& vessel_guid) {
+  auto const it = vessel_handles_.find(vessel_guid);
+  CHECK(it != vessel_handles_.end())
+      << "No handle for vessel with GUID " << vessel_guid;
+  std::uint32_t const index =
+      static_cast<std::uint32_t>(it->second & 0xFFFFFFFF);
+  VesselSlot& slot = vessel_slots_[index];
+  std::uint32_t const generation = slot.generation;
+  slot = VesselSlot();
+  slot.generation = generation + 1;
+  free_vessel_slots_.push_back(index);
+  vessel_handles_.erase(it);
+}
+
 Instant Plugin::current_time() const {
   return current_time_;
 }
 
+Plugin::StateTable const& Plugin::state_table() const {
+  return state_table_;
+}
+
 bool Plugin::has_dirty_vessels() const {
-  return !dirty_vessels_.empty();
+  return number_of_dirty_vessels_ > 0;
 }
 
 bool Plugin::has_unsynchronized_vessels() const {
-  return !unsynchronized_vessels_.empty();
+  return number_of_unsynchronized_vessels_ > 0;
 }
 
-bool Plugin::is_dirty(not_null<Vessel*> const vessel) const {
-  return dirty_vessels_.count(vessel) > 0;
+bool Plugin::is_dirty(GUID const& vessel_guid) const {
+  return find_vessel_slot_or_die(vessel_handle(vessel_guid)).dirty;
 }
 
 // The map between the vector spaces of |Barycentric| and |WorldSun| at
 // |current_time_|.
-Rotation<Barycentric, WorldSun> Plugin::PlanetariumRotation() const {
-  return Rotation<Barycentric, WorldSun>(
-      planetarium_rotation_,
-      Bivector<double, Barycentric>({0, 1, 0}));
+Rotation<Barycentric, WorldSun> const& Plugin::PlanetariumRotation() const {
+  return barycentric_to_world_sun_;
 }
 
-void Plugin::CheckVesselInvariants(
-    GUIDToOwnedVessel::const_iterator const it) const {
-  not_null<std::unique_ptr<Vessel>> const& vessel = it->second;
-  CHECK(vessel->is_initialized()) << "Vessel with GUID " << it->first
+void Plugin::SetPlanetariumRotation(Angle const& planetarium_rotation) {
+  planetarium_rotation_ = planetarium_rotation;
+  barycentric_to_world_sun_ = BarycentricToWorldSun(planetarium_rotation);
+  barycentric_to_world_ =
+      Identity<WorldSun, World>() * barycentric_to_world_sun_;
+}
+
+void Plugin::CheckVesselInvariants(VesselSlot const& slot) const {
+  not_null<Vessel const*> const vessel = slot.vessel;
+  CHECK(vessel->is_initialized()) << "Vessel with GUID " << *slot.guid
                                   << " was not given an initial state";
   // TODO(egg): At the moment, if a vessel is inserted when
   // |current_time_ == HistoryTime()| (that only happens before the first call
   // to |AdvanceTime|) its first step is unsynchronized. This is convenient to
   // test code paths, but it means the invariant is GE, rather than GT.
   CHECK_GE(vessel->prolongation().last().time(), HistoryTime());
-  if (unsynchronized_vessels_.count(vessel.get()) > 0) {
-    CHECK(!vessel->is_synchronized());
-  } else {
-    CHECK(vessel->is_synchronized());
+  // The history of a vessel in the bubble ends before its bubble histories,
+  // which are not materialized here.
+  if (vessel->is_synchronized() && !vessel->has_bubble_histories()) {
     CHECK_EQ(vessel->history().last().time(), HistoryTime());
   }
 }
 
 void Plugin::CleanUpVessels() {
   VLOG(1) <<  __FUNCTION__;
+  ScopedTraceEvent const trace_event(__FUNCTION__);
   // Remove the vessels which were not updated since last time.
-  for (auto it = vessels_.cbegin(); it != vessels_.cend();) {
+  for (auto& slot : vessel_slots_) {
+    if (slot.vessel == nullptr) {
+      continue;
+    }
     // While we're going over the vessels, check invariants.
-    CheckVesselInvariants(it);
-    not_null<Vessel*> const vessel = it->second.get();
+    CheckVesselInvariants(slot);
     // Now do the cleanup.
-    if (kept_vessels_.erase(vessel)) {
-      ++it;
+    if (slot.kept) {
+      slot.kept = false;
     } else {
-      LOG(INFO) << "Removing vessel with GUID " << it->first;
-      // Since we are going to delete the vessel, we must remove it from
-      // |new_vessels| if it's there.
-      if (unsynchronized_vessels_.erase(vessel)) {
+      GUID const vessel_guid = *slot.guid;
+      LOG(INFO) << "Removing vessel with GUID " << vessel_guid;
+      if (!slot.vessel->is_synchronized()) {
         LOG(INFO) << "Vessel had not been synchronized";
+        --number_of_unsynchronized_vessels_;
       }
-      if (dirty_vessels_.erase(vessel)) {
+      if (slot.dirty) {
         LOG(INFO) << "Vessel was dirty";
+        --number_of_dirty_vessels_;
+      }
+      // This resets |slot|.
+      FreeVesselHandle(vessel_guid);
+      prediction_scheduler_.Remove(vessel_guid);
+      auto const prediction_it = scheduled_predictions_.find(vessel_guid);
+      if (prediction_it != scheduled_predictions_.end()) {
+        prediction_it->second->PrepareForReclaim();
+        reclaimer_.Reclaim(std::unique_ptr<Trajectory<Barycentric>>(
+            prediction_it->second.release()));
+        scheduled_predictions_.erase(prediction_it);
       }
-      // |std::map::erase| invalidates its parameter so we post-increment.
-      vessels_.erase(it++);
+      // The vessel is unlinked here, and destroyed with its history in the
+      // background.  Its trajectories may be observed by the transforms used
+      // for rendering, which must be notified here, on this thread.
+      auto const it = vessels_.find(vessel_guid);
+      it->second->PrepareForReclaim();
+      reclaimer_.Reclaim(std::unique_ptr<Vessel>(it->second.release()));
+      vessels_.erase(it);
     }
   }
 }
 
-void Plugin::EvolveHistories(Instant const& t) {
+void Plugin::MarkVesselsInBubble() {
+  VLOG(1) <<  __FUNCTION__;
+  for (auto& slot : vessel_slots_) {
+    slot.in_bubble =
+        slot.vessel != nullptr && bubble_->will_contain(slot.vessel);
+  }
+}
+
+void Plugin::EvolveHistories(
+    Instant const& t,
+    not_null<NBodySystem<Barycentric>::MassiveBodiesSteps*> const
+        celestial_steps) {
   VLOG(1) << __FUNCTION__ << '\n' << NAMED(t);
+  ScopedTraceEvent const trace_event(__FUNCTION__);
   // Integration with a constant step.
   NBodySystem<Barycentric>::Trajectories trajectories;
   // NOTE(egg): This may be too large, vessels that are not new and in the
   // physics bubble or dirty will not be added.
-  trajectories.reserve(vessels_.size() - unsynchronized_vessels_.size() +
+  trajectories.reserve(vessels_.size() - number_of_unsynchronized_vessels_ +
                        celestials_.size());
   for (auto const& pair : celestials_) {
     not_null<std::unique_ptr<Celestial>> const& celestial = pair.second;
     trajectories.push_back(celestial->mutable_history());
   }
-  for (auto const& pair : vessels_) {
-    not_null<Vessel*> const vessel = pair.second.get();
-    if (vessel->is_synchronized() &&
-        !bubble_->contains(vessel) &&
-        !is_dirty(vessel)) {
-      trajectories.push_back(vessel->mutable_history());
+  // The vessels which are propagated analytically around their parent, and
+  // their orbits.  The states of the celestials at the start of the
+  // integration are retained in case some of these vessels need to be
+  // integrated after all.
+  std::vector<not_null<Vessel*>> keplerian_vessels;
+  std::vector<KeplerOrbit<Barycentric>> keplerian_orbits;
+  std::vector<DegreesOfFreedom<Barycentric>> initial_celestial_states;
+  // The clusters whose references are integrated numerically.
+  std::vector<VesselCluster> clusters;
+  if (keplerian_perturbation_threshold_ > 0 || cluster_tolerance_ > Length()) {
+    initial_celestial_states.reserve(celestials_.size());
+    for (auto const& pair : celestials_) {
+      initial_celestial_states.push_back(
+          pair.second->history().last().degrees_of_freedom());
+    }
+  }
+  Instant const start_time = HistoryTime();
+  for (auto const& slot : vessel_slots_) {
+    if (slot.vessel != nullptr &&
+        slot.vessel->is_synchronized() &&
+        !slot.in_bubble &&
+        !slot.dirty) {
+      not_null<Vessel*> const vessel = slot.vessel;
+      DegreesOfFreedom<Barycentric> const& vessel_state =
+          vessel->history().last().degrees_of_freedom();
+      if (keplerian_perturbation_threshold_ > 0 &&
+          PerturbationRatio(vessel->parent(), vessel_state.position()) <
+              keplerian_perturbation_threshold_) {
+        keplerian_vessels.push_back(vessel);
+        keplerian_orbits.emplace_back(
+            vessel->parent().body().gravitational_parameter(),
+            vessel_state -
+                vessel->parent().history().last().degrees_of_freedom(),
+            start_time);
+      } else if (cluster_tolerance_ > Length()) {
+        AddToCluster(vessel, &clusters);
+      } else {
+        trajectories.push_back(vessel->mutable_history());
+      }
     }
   }
+  for (auto const& cluster : clusters) {
+    trajectories.push_back(cluster.reference->mutable_history());
+  }
   VLOG(1) << "Starting the evolution of the histories" << '\n'
           << "from : " << HistoryTime();
-  n_body_system_->Integrate(history_integrator_,  // integrator
-                            t,                    // tmax
+  Instant const history_time = HistoryTime();
+  std::size_t const number_of_vessel_histories =
+      trajectories.size() - celestials_.size();
+  if (UsesEphemerisFile(t)) {
+    // The celestials are not integrated, so the vessels are not grouped.
+    IntegrateHistories(*n_body_system_, CelestialParents(), t, trajectories);
+  } else if (number_of_vessel_groups_ > 1 &&
+             thread_pool_ != nullptr &&
+             number_of_vessel_histories > 1) {
+    EvolveHistoriesInGroups(
+        std::vector<not_null<Trajectory<Barycentric>*>>(
+            trajectories.begin() + celestials_.size(), trajectories.end()),
+        t,
+        celestial_steps);
+  } else {
+    if (wisdom_holman_histories_) {
+      IntegrateHistories(*n_body_system_,
+                         CelestialParents(),
+                         t,
+                         trajectories,
+                         celestial_steps);
+    } else {
+      n_body_system_->UpdatePlan(trajectories, &history_plan_);
+      n_body_system_->IntegratePlan(HistoryIntegrator(),  // integrator
+                                    t,                    // tmax
+                                    Δt_,                  // Δt
+                                    0,                    // sampling_period
+                                    false,                // tmax_is_exact
+                                    &history_plan_,       // plan
+                                    celestial_steps);     // massive_steps
+    }
+  }
+  if (profiling_) {
+    profile_.history_steps +=
+        static_cast<std::int64_t>(
+            std::round((HistoryTime() - history_time) / Δt_));
+  }
+  if (!keplerian_vessels.empty()) {
+    EvolveKeplerianHistories(keplerian_vessels,
+                             keplerian_orbits,
+                             initial_celestial_states,
+                             t);
+  }
+  if (!clusters.empty()) {
+    EvolveClusterHistories(clusters, initial_celestial_states, t);
+  }
+  VLOG(1) << "Evolved the histories" << '\n'
+          << "to   : " << HistoryTime();
+}
+
+void Plugin::EvolveKeplerianHistories(
+    std::vector<not_null<Vessel*>> const& vessels,
+    std::vector<KeplerOrbit<Barycentric>> const& orbits,
+    std::vector<DegreesOfFreedom<Barycentric>> const& initial_celestial_states,
+    Instant const& t) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(vessels.size());
+  // The vessels which were perturbed at the end of the step, and must be
+  // integrated numerically.
+  NBodySystem<Barycentric>::Trajectories perturbed;
+  for (std::size_t i = 0; i < vessels.size(); ++i) {
+    not_null<Vessel*> const vessel = vessels[i];
+    DegreesOfFreedom<Barycentric> const final_state =
+        vessel->parent().history().last().degrees_of_freedom() +
+        orbits[i].RelativeDegreesOfFreedomAt(HistoryTime());
+    if (PerturbationRatio(vessel->parent(), final_state.position()) <
+            keplerian_perturbation_threshold_) {
+      vessel->mutable_history()->Append(HistoryTime(), final_state);
+    } else {
+      perturbed.push_back(vessel->mutable_history());
+    }
+  }
+  VLOG(1) << vessels.size() - perturbed.size()
+          << " vessels were propagated analytically";
+  if (!perturbed.empty()) {
+    IntegratePerturbedHistories(perturbed, initial_celestial_states, t);
+  }
+}
+
+Plugin::VesselCluster::VesselCluster(
+    not_null<Vessel*> const reference,
+    KeplerOrbit<Barycentric> const& reference_orbit)
+    : reference(reference),
+      reference_orbit(reference_orbit) {}
+
+void Plugin::AddToCluster(
+    not_null<Vessel*> const vessel,
+    not_null<std::vector<VesselCluster>*> const clusters) const {
+  DegreesOfFreedom<Barycentric> const& vessel_state =
+      vessel->history().last().degrees_of_freedom();
+  for (auto& cluster : *clusters) {
+    if (&cluster.reference->parent() != &vessel->parent()) {
+      continue;
+    }
+    RelativeDegreesOfFreedom<Barycentric> const offset =
+        vessel_state -
+        cluster.reference->history().last().degrees_of_freedom();
+    if (offset.displacement().Norm() <= cluster_tolerance_) {
+      cluster.members.push_back(vessel);
+      cluster.offsets.push_back(offset);
+      return;
+    }
+  }
+  Celestial const& parent = vessel->parent();
+  clusters->emplace_back(
+      vessel,
+      KeplerOrbit<Barycentric>(
+          parent.body().gravitational_parameter(),
+          vessel_state - parent.history().last().degrees_of_freedom(),
+          HistoryTime()));
+}
+
+void Plugin::EvolveClusterHistories(
+    std::vector<VesselCluster> const& clusters,
+    std::vector<DegreesOfFreedom<Barycentric>> const& initial_celestial_states,
+    Instant const& t) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(clusters.size());
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  Instant const end_time = HistoryTime();
+  // The vessels which drifted away from their reference during the step, and
+  // must be integrated numerically.
+  NBodySystem<Barycentric>::Trajectories perturbed;
+  std::int64_t propagated = 0;
+  for (auto const& cluster : clusters) {
+    if (cluster.members.empty()) {
+      continue;
+    }
+    Instant const start_time = cluster.members.front()->history().last().time();
+    int const steps = std::max(
+        1, static_cast<int>(std::round((end_time - start_time) / Δt_)));
+    Time const h = (end_time - start_time) / steps;
+    // The position of the reference relative to the parent, and the
+    // coefficient μ / r³ of the linearised equations, at each step.
+    GravitationalParameter const& μ =
+        cluster.reference->parent().body().gravitational_parameter();
+    std::vector<Vector<double, Barycentric>> directions;
+    std::vector<quantities::Quotient<Acceleration, Length>> coefficients;
+    directions.reserve(steps + 1);
+    coefficients.reserve(steps + 1);
+    for (int k = 0; k <= steps; ++k) {
+      Displacement<Barycentric> const r =
+          cluster.reference_orbit.RelativeDegreesOfFreedomAt(
+              start_time + k * h).displacement();
+      Length const r_norm = r.Norm();
+      directions.push_back(r / r_norm);
+      coefficients.push_back(μ / Pow<3>(r_norm));
+    }
+    // The linearisation of the acceleration caused by the parent at the
+    // offset |δr| from the reference at step |k|.
+    auto const tidal_acceleration =
+        [&directions, &coefficients](
+            int const k,
+            Displacement<Barycentric> const& δr) ->
+                Vector<Acceleration, Barycentric> {
+      return coefficients[k] *
+             (3 * InnerProduct(directions[k], δr) * directions[k] - δr);
+    };
+    DegreesOfFreedom<Barycentric> const& reference_state =
+        cluster.reference->history().last().degrees_of_freedom();
+    for (std::size_t i = 0; i < cluster.members.size(); ++i) {
+      // Velocity Verlet, which is symplectic, in the frame of the reference.
+      Displacement<Barycentric> δr = cluster.offsets[i].displacement();
+      Velocity<Barycentric> δv = cluster.offsets[i].velocity();
+      Vector<Acceleration, Barycentric> δa = tidal_acceleration(0, δr);
+      for (int k = 1; k <= steps; ++k) {
+        δv += 0.5 * h * δa;
+        δr += h * δv;
+        δa = tidal_acceleration(k, δr);
+        δv += 0.5 * h * δa;
+      }
+      not_null<Vessel*> const member = cluster.members[i];
+      if (δr.Norm() <= cluster_tolerance_) {
+        member->mutable_history()->Append(
+            end_time,
+            reference_state + RelativeDegreesOfFreedom<Barycentric>(δr, δv));
+        ++propagated;
+      } else {
+        perturbed.push_back(member->mutable_history());
+      }
+    }
+  }
+  VLOG(1) << propagated << " vessels were propagated relative to their "
+          << "cluster";
+  if (profiling_) {
+    profile_.cluster_propagations += propagated;
+    profile_.cluster_promotions += perturbed.size();
+  }
+  if (!perturbed.empty()) {
+    IntegratePerturbedHistories(perturbed, initial_celestial_states, t);
+  }
+}
+
+void Plugin::IntegratePerturbedHistories(
+    NBodySystem<Barycentric>::Trajectories perturbed,
+    std::vector<DegreesOfFreedom<Barycentric>> const& initial_celestial_states,
+    Instant const& t) {
+  // Integrate the perturbed vessels from the start with copies of the
+  // celestials, which evolve exactly as in |EvolveHistories|.
+  std::vector<not_null<std::unique_ptr<Trajectory<Barycentric>>>>
+      celestial_trajectories;
+  celestial_trajectories.reserve(celestials_.size());
+  Instant const start_time = perturbed.front()->last().time();
+  auto initial_state_it = initial_celestial_states.cbegin();
+  for (auto const& pair : celestials_) {
+    celestial_trajectories.push_back(
+        make_not_null_unique<Trajectory<Barycentric>>(&pair.second->body()));
+    celestial_trajectories.back()->Append(start_time, *initial_state_it);
+    perturbed.push_back(celestial_trajectories.back().get());
+    ++initial_state_it;
+  }
+  IntegrateHistories(*n_body_system_, CelestialParents(), t, perturbed);
+}
+
+void Plugin::EvolveHistoriesInGroups(
+    std::vector<not_null<Trajectory<Barycentric>*>> const& vessel_histories,
+    Instant const& t,
+    not_null<NBodySystem<Barycentric>::MassiveBodiesSteps*> const
+        celestial_steps) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(vessel_histories.size());
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  int const number_of_groups =
+      std::min(number_of_vessel_groups_,
+               static_cast<int>(vessel_histories.size()));
+  // Each group gets copies of the celestials at the start of the step, taken
+  // before the celestials are integrated below.
+  Instant const start_time = HistoryTime();
+  std::vector<std::vector<not_null<std::unique_ptr<Trajectory<Barycentric>>>>>
+      group_celestial_histories(number_of_groups);
+  std::vector<NBodySystem<Barycentric>::Trajectories> group_trajectories(
+      number_of_groups);
+  for (int g = 0; g < number_of_groups; ++g) {
+    std::size_t const begin = g * vessel_histories.size() / number_of_groups;
+    std::size_t const end =
+        (g + 1) * vessel_histories.size() / number_of_groups;
+    group_trajectories[g].reserve(celestials_.size() + end - begin);
+    for (auto const& pair : celestials_) {
+      Celestial const& celestial = *pair.second;
+      group_celestial_histories[g].push_back(
+          make_not_null_unique<Trajectory<Barycentric>>(&celestial.body()));
+      group_celestial_histories[g].back()->Append(
+          start_time,
+          celestial.history().last().degrees_of_freedom());
+      group_trajectories[g].push_back(
+          group_celestial_histories[g].back().get());
+    }
+    group_trajectories[g].insert(group_trajectories[g].end(),
+                                 vessel_histories.begin() + begin,
+                                 vessel_histories.begin() + end);
+  }
+
+  NBodySystem<Barycentric>::Trajectories celestial_histories;
+  celestial_histories.reserve(celestials_.size());
+  for (auto const& pair : celestials_) {
+    celestial_histories.push_back(pair.second->mutable_history());
+  }
+  std::map<MassiveBody const*, MassiveBody const*> const parents =
+      CelestialParents();
+  IntegrateHistories(
+      *n_body_system_, parents, t, celestial_histories, celestial_steps);
+
+  // The groups don't share any trajectory, so they may append to them
+  // concurrently.  Their |NBodySystem|s own their workspaces and have no thread
+  // pool, since they run on the threads of |thread_pool_|.
+  std::vector<NBodySystem<Barycentric>::Statistics> group_statistics(
+      number_of_groups);
+  thread_pool_->ParallelFor(
+      number_of_groups,
+      [this, &group_trajectories, &group_statistics, &parents, t](
+          int const g) {
+        NBodySystem<Barycentric> n_body_system(
+            NBodySystem<Barycentric>::Layout::kStructureOfArrays);
+        n_body_system.SetHierarchicalForceModel(parents,
+                                                hierarchical_tolerance_,
+                                                use_quadrupole_);
+        n_body_system.set_close_encounter_timescale_fraction(
+            close_encounter_timescale_fraction_);
+        IntegrateHistories(n_body_system, parents, t, group_trajectories[g]);
+        group_statistics[g] = n_body_system.statistics();
+      });
+  if (profiling_) {
+    for (auto const& statistics : group_statistics) {
+      profile_.force_evaluations += statistics.force_evaluations;
+      profile_.points_appended += statistics.points_appended;
+    }
+  }
+}
+
+std::map<MassiveBody const*, MassiveBody const*>
+Plugin::CelestialParents() const {
+  std::map<MassiveBody const*, MassiveBody const*> parents;
+  for (auto const& index_celestial : celestials_) {
+    Celestial const& celestial = *index_celestial.second;
+    if (celestial.has_parent()) {
+      parents.emplace(&celestial.body(), &celestial.parent().body());
+    }
+  }
+  return parents;
+}
+
+SymplecticIntegrator<Length, Speed> const& Plugin::HistoryIntegrator() const {
+  if (multistep_histories_) {
+    return multistep_history_integrator_;
+  } else {
+    return history_integrator_;
+  }
+}
+
+void Plugin::IntegrateHistories(
+    NBodySystem<Barycentric> const& n_body_system,
+    std::map<MassiveBody const*, MassiveBody const*> const& parents,
+    Instant const& tmax,
+    NBodySystem<Barycentric>::Trajectories const& trajectories) const {
+  if (UsesEphemerisFile(tmax)) {
+    EvaluateHistoriesFromEphemerisFile(n_body_system, tmax, trajectories);
+  } else if (wisdom_holman_histories_) {
+    n_body_system.IntegrateWisdomHolman(
+        wisdom_holman_integrator_,  // integrator
+        parents,                    // parents
+        tmax,                       // tmax
+        Δt_,                        // Δt
+        0,                          // sampling_period
+        false,                      // tmax_is_exact
+        trajectories);              // trajectories
+  } else {
+    n_body_system.Integrate(HistoryIntegrator(),  // integrator
+                            tmax,                 // tmax
                             Δt_,                  // Δt
                             0,                    // sampling_period
                             false,                // tmax_is_exact
                             trajectories);        // trajectories
-  CHECK_GE(HistoryTime(), current_time_);
-  VLOG(1) << "Evolved the histories" << '\n'
-          << "to   : " << HistoryTime();
+  }
 }
 
-void Plugin::SynchronizeNewVesselsAndCleanDirtyVessels() {
-  VLOG(1) << __FUNCTION__;
-  NBodySystem<Barycentric>::Trajectories trajectories;
-  trajectories.reserve(celestials_.size() + unsynchronized_vessels_.size() +
-                       bubble_->size());
-  for (auto const& pair : celestials_) {
-    not_null<std::unique_ptr<Celestial>> const& celestial = pair.second;
-    trajectories.push_back(celestial->mutable_prolongation());
+void Plugin::IntegrateHistories(
+    NBodySystem<Barycentric> const& n_body_system,
+    std::map<MassiveBody const*, MassiveBody const*> const& parents,
+    Instant const& tmax,
+    NBodySystem<Barycentric>::Trajectories const& trajectories,
+    not_null<NBodySystem<Barycentric>::MassiveBodiesSteps*> const
+        celestial_steps) const {
+  if (wisdom_holman_histories_) {
+    n_body_system.IntegrateWisdomHolman(
+        wisdom_holman_integrator_,  // integrator
+        parents,                    // parents
+        tmax,                       // tmax
+        Δt_,                        // Δt
+        0,                          // sampling_period
+        false,                      // tmax_is_exact
+        trajectories,               // trajectories
+        celestial_steps);           // massive_steps
+  } else {
+    n_body_system.Integrate(HistoryIntegrator(),  // integrator
+                            tmax,                 // tmax
+                            Δt_,                  // Δt
+                            0,                    // sampling_period
+                            false,                // tmax_is_exact
+                            trajectories,         // trajectories
+                            celestial_steps);     // massive_steps
+  }
+}
+
+bool Plugin::UsesEphemerisFile(Instant const& tmax) const {
+  return ephemeris_file_ != nullptr && tmax <= ephemeris_file_->t_max();
+}
+
+void Plugin::EvaluateHistoriesFromEphemerisFile(
+    NBodySystem<Barycentric> const& n_body_system,
+    Instant const& tmax,
+    NBodySystem<Barycentric>::Trajectories const& trajectories) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK(!trajectories.empty());
+  Instant const start_time = trajectories.front()->last().time();
+  // The steps that an integration with a non-exact |tmax| would take.
+  std::int64_t const steps =
+      static_cast<std::int64_t>(std::floor((tmax - start_time) / Δt_));
+  if (steps <= 0) {
+    return;
+  }
+  NBodySystem<Barycentric>::Trajectories celestial_histories;
+  std::vector<not_null<std::unique_ptr<Trajectory<Barycentric>>>>
+      celestial_steps;
+  NBodySystem<Barycentric>::ReadonlyTrajectories celestial_trajectories;
+  NBodySystem<Barycentric>::Trajectories vessel_trajectories;
+  for (auto const& trajectory : trajectories) {
+    if (trajectory->body<Body>()->is_massless()) {
+      vessel_trajectories.push_back(trajectory);
+      continue;
+    }
+    not_null<MassiveBody const*> const body = trajectory->body<MassiveBody>();
+    std::size_t const index = ephemeris_file_indices_.at(body);
+    celestial_histories.push_back(trajectory);
+    celestial_steps.push_back(
+        make_not_null_unique<Trajectory<Barycentric>>(body));
+    Trajectory<Barycentric>& steps_trajectory = *celestial_steps.back();
+    steps_trajectory.Append(start_time,
+                            trajectory->last().degrees_of_freedom());
+    for (std::int64_t i = 1; i <= steps; ++i) {
+      Instant const time = start_time + i * Δt_;
+      steps_trajectory.Append(
+          time,
+          DegreesOfFreedom<Barycentric>(
+              ephemeris_file_->EvaluatePosition(index, time),
+              ephemeris_file_->EvaluateVelocity(index, time)));
+    }
+    celestial_trajectories.push_back(&steps_trajectory);
+  }
+  CHECK(!celestial_steps.empty());
+  Instant const history_tmax = celestial_steps.front()->last().time();
+  if (!vessel_trajectories.empty()) {
+    n_body_system.IntegrateMassless(HistoryIntegrator(),     // integrator
+                                    celestial_trajectories,  // massive
+                                    history_tmax,            // tmax
+                                    Δt_,                     // Δt
+                                    0,                       // sampling_period
+                                    true,                    // tmax_is_exact
+                                    vessel_trajectories);    // trajectories
   }
-  for (not_null<Vessel*> const vessel : unsynchronized_vessels_) {
-    if (!bubble_->contains(vessel)) {
-      trajectories.push_back(vessel->mutable_prolongation());
+  for (std::size_t i = 0; i < celestial_histories.size(); ++i) {
+    for (auto it = celestial_steps[i]->first(); !it.at_end(); ++it) {
+      if (it.time() > start_time) {
+        celestial_histories[i]->Append(it.time(), it.degrees_of_freedom());
+      }
+    }
+  }
+}
+
+double Plugin::PerturbationRatio(Celestial const& parent,
+                                 Position<Barycentric> const& position) const {
+  Position<Barycentric> const& parent_position =
+      parent.history().last().degrees_of_freedom().position();
+  Displacement<Barycentric> const from_parent = position - parent_position;
+  Length const distance_to_parent = from_parent.Norm();
+  Acceleration const parent_acceleration =
+      parent.body().gravitational_parameter() /
+      (distance_to_parent * distance_to_parent);
+  // The difference between the accelerations of the vessel and of its parent
+  // caused by the other celestials.
+  Vector<Acceleration, Barycentric> tidal_acceleration;
+  for (auto const& pair : celestials_) {
+    Celestial const& celestial = *pair.second;
+    if (&celestial == &parent) {
+      continue;
     }
+    Position<Barycentric> const& celestial_position =
+        celestial.history().last().degrees_of_freedom().position();
+    Displacement<Barycentric> const to_vessel = position - celestial_position;
+    Displacement<Barycentric> const to_parent =
+        parent_position - celestial_position;
+    GravitationalParameter const& μ =
+        celestial.body().gravitational_parameter();
+    tidal_acceleration +=
+        μ * (to_parent / Pow<3>(to_parent.Norm()) -
+             to_vessel / Pow<3>(to_vessel.Norm()));
   }
-  for (not_null<Vessel*> const vessel : dirty_vessels_) {
-    if (!bubble_->contains(vessel) && vessel->is_synchronized()) {
-      trajectories.push_back(vessel->mutable_prolongation());
+  return tidal_acceleration.Norm() / parent_acceleration;
+}
+
+void Plugin::SynchronizeNewVesselsAndCleanDirtyVessels(
+    NBodySystem<Barycentric>::MassiveBodiesSteps const& celestial_steps) {
+  VLOG(1) << __FUNCTION__;
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  NBodySystem<Barycentric>::Trajectories trajectories;
+  trajectories.reserve(number_of_unsynchronized_vessels_ +
+                       number_of_dirty_vessels_ +
+                       bubble_->size());
+  for (auto const& slot : vessel_slots_) {
+    if (slot.vessel != nullptr &&
+        !slot.in_bubble &&
+        (!slot.vessel->is_synchronized() || slot.dirty)) {
+      trajectories.push_back(slot.vessel->mutable_prolongation());
     }
   }
   if (!bubble_->empty()) {
@@ -204,57 +964,137 @@ void Plugin::SynchronizeNewVesselsAndCleanDirtyVessels() {
   }
   VLOG(1) << "Starting the synchronization of the new vessels"
           << (bubble_->empty() ? "" : " and of the bubble");
-  n_body_system_->Integrate(prolongation_integrator_,  // integrator
-                            HistoryTime(),             // tmax
-                            Δt_,                       // Δt
-                            0,                         // sampling_period
-                            true,                      // tmax_is_exact
-                            trajectories);             // trajectories
+  // The prolongations of the celestials are about to be reset, so instead of
+  // integrating them again the vessels use their recorded history steps.  The
+  // prolongations end at the previous |current_time_|, which may be
+  // |HistoryTime()|, in which case there is nothing to integrate.
+  if (!trajectories.empty() &&
+      trajectories.front()->last().time() < HistoryTime() &&
+      ephemeris_file_ != nullptr) {
+    NBodySystem<Barycentric>::ReadonlyTrajectories celestial_histories;
+    celestial_histories.reserve(celestials_.size());
+    for (auto const& pair : celestials_) {
+      celestial_histories.push_back(&pair.second->history());
+    }
+    n_body_system_->IntegrateMassless(
+        prolongation_integrator_,  // integrator
+        celestial_histories,       // massive_trajectories
+        HistoryTime(),             // tmax
+        Δt_,                       // Δt
+        0,                         // sampling_period
+        true,                      // tmax_is_exact
+        trajectories);             // trajectories
+  } else if (!trajectories.empty() &&
+             trajectories.front()->last().time() < HistoryTime()) {
+    n_body_system_->IntegrateMasslessBodiesInSteps(
+        prolongation_integrator_,  // integrator
+        celestial_steps,           // massive_steps
+        HistoryTime(),             // tmax
+        Δt_,                       // Δt
+        0,                         // sampling_period
+        true,                      // tmax_is_exact
+        trajectories);             // trajectories
+  }
   if (!bubble_->empty()) {
     SynchronizeBubbleHistories();
   }
-  for (not_null<Vessel*> const vessel : unsynchronized_vessels_) {
-    CHECK(!bubble_->contains(vessel));
-    vessel->CreateHistoryAndForkProlongation(
-        HistoryTime(),
-        vessel->prolongation().last().degrees_of_freedom());
-    dirty_vessels_.erase(vessel);
-  }
-  unsynchronized_vessels_.clear();
-  for (not_null<Vessel*> const vessel : dirty_vessels_) {
-    CHECK(!bubble_->contains(vessel));
-    vessel->mutable_history()->Append(
-        HistoryTime(),
-        vessel->prolongation().last().degrees_of_freedom());
-  }
-  dirty_vessels_.clear();
+  // The histories of the vessels in the bubble have been prolonged above, those
+  // of the other new and dirty vessels are prolonged using their
+  // prolongations.
+  for (auto& slot : vessel_slots_) {
+    if (slot.vessel == nullptr) {
+      continue;
+    }
+    not_null<Vessel*> const vessel = slot.vessel;
+    if (slot.in_bubble) {
+      CHECK(slot.dirty);
+    } else if (!vessel->is_synchronized()) {
+      vessel->CreateHistoryAndForkProlongation(
+          HistoryTime(),
+          vessel->prolongation().last().degrees_of_freedom());
+      vessel->mutable_history()->set_downsampling(history_downsampling_);
+      vessel->mutable_history()->set_levels_of_detail(
+          history_levels_of_detail_);
+      --number_of_unsynchronized_vessels_;
+    } else if (slot.dirty) {
+      if (vessel->has_bubble_histories()) {
+        // The vessel has left the bubble.
+        vessel->ClearBubbleHistories();
+      }
+      vessel->mutable_history()->Append(
+          HistoryTime(),
+          vessel->prolongation().last().degrees_of_freedom());
+    }
+    slot.dirty = false;
+  }
+  CHECK_EQ(0, number_of_unsynchronized_vessels_);
+  number_of_dirty_vessels_ = 0;
+  if (bubble_->empty()) {
+    bubble_histories_.reset();
+    bubble_history_vessels_.clear();
+  }
   VLOG(1) << "Synchronized the new vessels"
           << (bubble_->empty() ? "" : " and the bubble");
 }
 
 void Plugin::SynchronizeBubbleHistories() {
   VLOG(1) << __FUNCTION__;
+  std::vector<not_null<Vessel*>> const vessels = bubble_->vessels();
+  if (bubble_histories_ == nullptr || vessels != bubble_history_vessels_) {
+    // The vessels that continue in the new bubble materialize the old bubble
+    // histories when they switch to the new ones.
+    bubble_histories_ = std::make_shared<SynchronizedHistories<Barycentric>>(
+        static_cast<int>(vessels.size()) + 1);
+    bubble_history_vessels_ = vessels;
+  } else if (!bubble_histories_->empty() &&
+             bubble_histories_->first_time() <
+                 HistoryTime() -
+                     history_downsampling_.full_resolution_duration) {
+    // The old rows are materialized in the histories of the vessels, where
+    // they are downsampled, and forgotten.
+    for (not_null<Vessel*> const vessel : vessels) {
+      vessel->MaterializeBubbleHistory();
+    }
+    bubble_histories_->ForgetBefore(bubble_histories_->last_time());
+  }
   DegreesOfFreedom<Barycentric> const& centre_of_mass =
       bubble_->centre_of_mass_trajectory().last().degrees_of_freedom();
-  for (not_null<Vessel*> const vessel : bubble_->vessels()) {
+  DegreesOfFreedom<Barycentric> const origin(Barycentric::origin,
+                                             Velocity<Barycentric>());
+  bubble_histories_->Append(
+      HistoryTime(),
+      [this, &centre_of_mass, &origin, &vessels](
+          int const b) -> DegreesOfFreedom<Barycentric> {
+        if (b == 0) {
+          return centre_of_mass;
+        } else {
+          return origin + bubble_->from_centre_of_mass(vessels[b - 1]);
+        }
+      });
+  for (std::size_t i = 0; i < vessels.size(); ++i) {
+    not_null<Vessel*> const vessel = vessels[i];
     RelativeDegreesOfFreedom<Barycentric> const& from_centre_of_mass =
         bubble_->from_centre_of_mass(vessel);
     if (vessel->is_synchronized()) {
-      vessel->mutable_history()->Append(
-          HistoryTime(),
-          centre_of_mass + from_centre_of_mass);
+      vessel->SetBubbleHistories(bubble_histories_, static_cast<int>(i) + 1);
     } else {
       vessel->CreateHistoryAndForkProlongation(
           HistoryTime(),
           centre_of_mass + from_centre_of_mass);
-      CHECK(unsynchronized_vessels_.erase(vessel));
+      vessel->mutable_history()->set_downsampling(history_downsampling_);
+      vessel->mutable_history()->set_levels_of_detail(
+          history_levels_of_detail_);
+      --number_of_unsynchronized_vessels_;
     }
-    CHECK(dirty_vessels_.erase(vessel));
   }
 }
 
 void Plugin::ResetProlongations() {
   VLOG(1) << __FUNCTION__;
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  // The prolongations are extended from their last point as long as the
+  // histories do not advance, so this is only needed when they do.
+  CHECK_LT(*sun_->prolongation().fork_time(), HistoryTime());
   for (auto const& pair : vessels_) {
     not_null<std::unique_ptr<Vessel>> const& vessel = pair.second;
     vessel->ResetProlongation(HistoryTime());
@@ -266,8 +1106,181 @@ void Plugin::ResetProlongations() {
   VLOG(1) << "Prolongations have been reset";
 }
 
+void Plugin::StartHistoryIntegration(Instant const& tmax) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(tmax);
+  CHECK(history_integration_ == nullptr);
+  CHECK(!has_unsynchronized_vessels());
+  CHECK(!has_dirty_vessels());
+  CHECK(bubble_->empty());
+  history_integration_ = std::make_unique<HistoryIntegration>();
+  HistoryIntegration& integration = *history_integration_;
+  integration.histories.reserve(celestials_.size() + vessels_.size());
+  integration.vessel_handles.reserve(vessels_.size());
+  integration.vessel_bodies.reserve(vessels_.size());
+  // The worker integrates copies of the last points of the histories, so that
+  // it shares no trajectory with the main thread.
+  for (auto const& pair : celestials_) {
+    Trajectory<Barycentric> const& history = pair.second->history();
+    integration.histories.push_back(
+        make_not_null_unique<Trajectory<Barycentric>>(&pair.second->body()));
+    integration.histories.back()->Append(
+        history.last().time(),
+        history.last().degrees_of_freedom());
+  }
+  for (auto const& slot : vessel_slots_) {
+    if (slot.vessel == nullptr) {
+      continue;
+    }
+    Trajectory<Barycentric> const& history = slot.vessel->history();
+    integration.vessel_handles.push_back(vessel_handle(*slot.guid));
+    integration.vessel_bodies.push_back(
+        make_not_null_unique<MasslessBody const>());
+    integration.histories.push_back(
+        make_not_null_unique<Trajectory<Barycentric>>(
+            integration.vessel_bodies.back().get()));
+    integration.histories.back()->Append(
+        history.last().time(),
+        history.last().degrees_of_freedom());
+  }
+  LaunchHistoryIntegration(tmax);
+}
+
+void Plugin::LaunchHistoryIntegration(Instant const& tmax) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(tmax);
+  CHECK(history_integration_ != nullptr);
+  NBodySystem<Barycentric>::Trajectories trajectories;
+  trajectories.reserve(history_integration_->histories.size());
+  for (auto const& history : history_integration_->histories) {
+    trajectories.push_back(history.get());
+  }
+  VLOG(1) << "Starting the evolution of the histories on a worker thread"
+          << '\n' << "from : " << trajectories.front()->last().time();
+  // The parents are computed here since the worker must not touch the
+  // |Celestial|s.
+  std::map<MassiveBody const*, MassiveBody const*> const parents =
+      CelestialParents();
+  history_integration_->done = std::async(
+      std::launch::async,
+      [this, parents, tmax, trajectories]() {
+        IntegrateHistories(
+            *background_n_body_system_, parents, tmax, trajectories);
+      });
+}
+
+void Plugin::CommitHistoryIntegration(Instant const& t) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(t);
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK(history_integration_ != nullptr);
+  // The histories of the celestials and vessels have not changed since the
+  // last commit: no synchronization takes place while an integration exists.
+  Instant const start_time = HistoryTime();
+  auto histories_it = history_integration_->histories.cbegin();
+  auto const append = [start_time, t](Trajectory<Barycentric> const& from,
+                                      not_null<Trajectory<Barycentric>*> to) {
+    for (auto it = from.on_or_after(start_time);
+         !it.at_end() && it.time() <= t;
+         ++it) {
+      if (it.time() > start_time) {
+        to->Append(it.time(), it.degrees_of_freedom());
+      }
+    }
+  };
+  for (auto const& pair : celestials_) {
+    append(**histories_it, pair.second->mutable_history());
+    ++histories_it;
+  }
+  for (VesselHandle const handle : history_integration_->vessel_handles) {
+    VesselSlot const& slot =
+        vessel_slots_[static_cast<std::uint32_t>(handle & 0xFFFFFFFF)];
+    // Skip the vessels that have been removed since the start of the
+    // integration.
+    if (slot.guid != nullptr &&
+        slot.generation == static_cast<std::uint32_t>(handle >> 32)) {
+      append(**histories_it, slot.vessel->mutable_history());
+    }
+    ++histories_it;
+  }
+  // Drop the points committed by the previous call.
+  if (HistoryTime() > start_time) {
+    for (auto const& history : history_integration_->histories) {
+      history->ForgetBefore(start_time);
+    }
+  }
+  VLOG(1) << "Committed the histories" << '\n'
+          << "from : " << start_time << '\n'
+          << "to   : " << HistoryTime();
+}
+
+void Plugin::FinishHistoryIntegration() {
+  VLOG(1) << __FUNCTION__;
+  CHECK(history_integration_ != nullptr);
+  if (history_integration_->done.valid()) {
+    history_integration_->done.get();
+  }
+  CommitHistoryIntegration(current_time_);
+  // The points after |current_time_| are speculative and are discarded.
+  history_integration_.reset();
+  ResetProlongationsToCurrentTime();
+}
+
+void Plugin::CatchUpHistories() {
+  VLOG(1) << __FUNCTION__;
+  CHECK(history_integration_ == nullptr);
+  // The histories only lag behind after a pipelined integration, during which
+  // the physics bubble was empty, so the dirty vessels have only been in free
+  // fall and all the synchronized vessels may be advanced together.
+  NBodySystem<Barycentric>::Trajectories trajectories;
+  trajectories.reserve(celestials_.size() + vessels_.size());
+  for (auto const& pair : celestials_) {
+    trajectories.push_back(pair.second->mutable_history());
+  }
+  for (auto const& slot : vessel_slots_) {
+    if (slot.vessel != nullptr && slot.vessel->is_synchronized()) {
+      trajectories.push_back(slot.vessel->mutable_history());
+    }
+  }
+  IntegrateHistories(
+      *n_body_system_, CelestialParents(), current_time_, trajectories);
+  VLOG(1) << "Caught up the histories" << '\n'
+          << "to   : " << HistoryTime();
+  ResetProlongationsToCurrentTime();
+}
+
+void Plugin::ResetProlongationsToCurrentTime() {
+  VLOG(1) << __FUNCTION__;
+  if (*sun_->prolongation().fork_time() == HistoryTime()) {
+    // The histories have not advanced, so the prolongations are still forked
+    // at |HistoryTime()| and end at |current_time_|.  Keep them rather than
+    // integrating them again.
+    VLOG(1) << "Prolongations are up to date";
+    return;
+  }
+  NBodySystem<Barycentric>::Trajectories trajectories;
+  trajectories.reserve(celestials_.size() + vessels_.size());
+  for (auto const& pair : celestials_) {
+    pair.second->ResetProlongation(HistoryTime());
+    trajectories.push_back(pair.second->mutable_prolongation());
+  }
+  for (auto const& slot : vessel_slots_) {
+    if (slot.vessel != nullptr && slot.vessel->is_synchronized()) {
+      slot.vessel->ResetProlongation(HistoryTime());
+      trajectories.push_back(slot.vessel->mutable_prolongation());
+    }
+  }
+  if (HistoryTime() < current_time_) {
+    n_body_system_->IntegrateAdaptively(
+        adaptive_prolongation_integrator_,  // integrator
+        current_time_,                      // tmax
+        Δt_,                                // first_time_step
+        prolongation_length_tolerance_,     // length_integration_tolerance
+        prolongation_speed_tolerance_,      // speed_integration_tolerance
+        trajectories);                      // trajectories
+  }
+}
+
 void Plugin::EvolveProlongationsAndBubble(Instant const& t) {
   VLOG(1) << __FUNCTION__ << '\n' << NAMED(t);
+  ScopedTraceEvent const trace_event(__FUNCTION__);
   NBodySystem<Barycentric>::Trajectories trajectories;
   trajectories.reserve(vessels_.size() + celestials_.size() -
                        bubble_->number_of_vessels() + bubble_->size());
@@ -275,10 +1288,9 @@ void Plugin::EvolveProlongationsAndBubble(Instant const& t) {
     not_null<std::unique_ptr<Celestial>> const& celestial = pair.second;
     trajectories.push_back(celestial->mutable_prolongation());
   }
-  for (auto const& pair : vessels_) {
-    not_null<Vessel*> const vessel = pair.second.get();
-    if (!bubble_->contains(vessel)) {
-      trajectories.push_back(vessel->mutable_prolongation());
+  for (auto const& slot : vessel_slots_) {
+    if (slot.vessel != nullptr && !slot.in_bubble) {
+      trajectories.push_back(slot.vessel->mutable_prolongation());
     }
   }
   if (!bubble_->empty()) {
@@ -288,12 +1300,13 @@ void Plugin::EvolveProlongationsAndBubble(Instant const& t) {
           << (bubble_->empty() ? "" : " and bubble") << '\n'
           << "from : " << trajectories.front()->last().time() << '\n'
           << "to   : " << t;
-  n_body_system_->Integrate(prolongation_integrator_,  // integrator
-                            t,                         // tmax
-                            Δt_,                       // Δt
-                            0,                         // sampling_period
-                            true,                      // tmax_is_exact
-                            trajectories);             // trajectories
+  n_body_system_->IntegrateAdaptively(
+      adaptive_prolongation_integrator_,  // integrator
+      t,                                  // tmax
+      Δt_,                                // first_time_step
+      prolongation_length_tolerance_,     // length_integration_tolerance
+      prolongation_speed_tolerance_,      // speed_integration_tolerance
+      trajectories);                      // trajectories
   if (!bubble_->empty()) {
     DegreesOfFreedom<Barycentric> const& centre_of_mass =
         bubble_->centre_of_mass_trajectory().last().degrees_of_freedom();
@@ -307,61 +1320,584 @@ void Plugin::EvolveProlongationsAndBubble(Instant const& t) {
   }
 }
 
-Instant const& Plugin::HistoryTime() const {
-  return sun_->history().last().time();
+void Plugin::ForgetCelestialHistoryPoints() {
+  if (ephemeris_file_ == nullptr) {
+    return;
+  }
+  for (auto const& pair : celestials_) {
+    not_null<Trajectory<Barycentric>*> const history =
+        pair.second->mutable_history();
+    // The first point to keep is the last one that the file covers, or the
+    // last point, which is the fork point of the prolongation.
+    Instant const limit =
+        std::min(history->last().time(), ephemeris_file_->t_max());
+    auto it = history->first();
+    if (it.time() > limit) {
+      continue;
+    }
+    Instant keep_time = it.time();
+    Instant forget_time;
+    bool has_forgettable_points = false;
+    for (++it; !it.at_end() && it.time() <= limit; ++it) {
+      forget_time = keep_time;
+      keep_time = it.time();
+      has_forgettable_points = true;
+    }
+    if (has_forgettable_points) {
+      history->ForgetBefore(forget_time);
+    }
+  }
 }
 
-Plugin::Plugin(Instant const& initial_time,
-               Index const sun_index,
-               GravitationalParameter const& sun_gravitational_parameter,
-               Angle const& planetarium_rotation)
-    : bubble_(make_not_null_unique<PhysicsBubble>()),
-      n_body_system_(make_not_null_unique<NBodySystem<Barycentric>>()),
-      planetarium_rotation_(planetarium_rotation),
-      current_time_(initial_time),
-      sun_(celestials_.emplace(sun_index,
-                               make_not_null_unique<Celestial>(
-                                   make_not_null_unique<MassiveBody>(
-                                       sun_gravitational_parameter))).
-               first->second.get()) {
-  sun_->CreateHistoryAndForkProlongation(
-      current_time_,
-      {Position<Barycentric>(), Velocity<Barycentric>()});
-  history_integrator_.Initialize(history_integrator_.Order5Optimal());
-  // NOTE(egg): perhaps a lower order would be appropriate.
-  prolongation_integrator_.Initialize(history_integrator_.Order5Optimal());
+void Plugin::CheckpointCelestialHistories() {
+  // The points appended since the last call were integrated with the current
+  // step and integrator.
+  Time const step = steps_between_celestial_history_checkpoints_ == 0 ||
+                            multistep_histories_ ||
+                            wisdom_holman_histories_ ||
+                            ephemeris_file_ != nullptr
+                        ? Time()
+                        : Δt_;
+  if ((celestial_history_runs_.empty() && step != Time()) ||
+      (!celestial_history_runs_.empty() &&
+       celestial_history_runs_.rbegin()->second != step)) {
+    celestial_history_runs_[celestial_history_checkpointed_until_] = step;
+    last_celestial_history_checkpoint_ = celestial_history_checkpointed_until_;
+  }
+  celestial_history_checkpointed_until_ = HistoryTime();
+  if (step == Time()) {
+    return;
+  }
+  for (;;) {
+    // The half step absorbs the rounding of the times of the steps.
+    auto const it = sun_->history().on_or_after(
+        last_celestial_history_checkpoint_ +
+        (steps_between_celestial_history_checkpoints_ - 0.5) * step);
+    if (it.at_end()) {
+      break;
+    }
+    Instant const checkpoint = it.time();
+    for (auto const& pair : celestials_) {
+      pair.second->mutable_history()->ForgetBetween(
+          last_celestial_history_checkpoint_, checkpoint);
+    }
+    last_celestial_history_checkpoint_ = checkpoint;
+  }
 }
 
-void Plugin::InsertCelestial(
-    Index const celestial_index,
-    GravitationalParameter const& gravitational_parameter,
-    Index const parent_index,
-    RelativeDegreesOfFreedom<AliceSun> const& from_parent) {
-  CHECK(initializing_) << "Celestial bodies should be inserted before the end "
-                       << "of initialization";
-  auto const it = celestials_.find(parent_index);
-  CHECK(it != celestials_.end()) << "No body at index " << parent_index;
-  not_null<Celestial const*> parent = it->second.get();
-  auto const inserted = celestials_.emplace(
-      celestial_index,
-      make_not_null_unique<Celestial>(
-          make_not_null_unique<MassiveBody>(gravitational_parameter)));
-  CHECK(inserted.second) << "Body already exists at index " << celestial_index;
+bool Plugin::EvaluateCelestialHistoryGap(
+    std::size_t const column,
+    Instant const& left_time,
+    Instant const& right_time,
+    Instant const& time,
+    not_null<DegreesOfFreedom<Barycentric>*> const degrees_of_freedom) const {
+  std::lock_guard<std::mutex> l(celestial_history_segments_lock_);
+  auto const segment_it = celestial_history_segments_.find(left_time);
+  CelestialHistorySegment* segment =
+      segment_it == celestial_history_segments_.end() ? nullptr
+                                                      : &segment_it->second;
+  if (segment == nullptr || segment->histories->last_time() != right_time) {
+    // Find the run of |left_time|, which must extend to |right_time|.
+    auto run_it = celestial_history_runs_.upper_bound(left_time);
+    if (run_it == celestial_history_runs_.begin() ||
+        (run_it != celestial_history_runs_.end() &&
+         right_time > run_it->first)) {
+      return false;
+    }
+    --run_it;
+    Time const& step = run_it->second;
+    // Consecutive steps are interpolated as if all the points were kept.
+    if (step == Time() ||
+        right_time - left_time < 1.5 * step ||
+        right_time - left_time >
+            (kMaximumCelestialHistorySegmentSteps + 0.5) * step) {
+      return false;
+    }
+    NBodySystem<Barycentric>::Trajectories trajectories;
+    std::vector<not_null<std::unique_ptr<Trajectory<Barycentric>>>>
+        initial_states;
+    trajectories.reserve(celestials_.size());
+    initial_states.reserve(celestials_.size());
+    for (auto const& pair : celestials_) {
+      initial_states.push_back(
+          make_not_null_unique<Trajectory<Barycentric>>(&pair.second->body()));
+      initial_states.back()->Append(
+          left_time,
+          pair.second->history().EvaluateDegreesOfFreedom(left_time));
+      trajectories.push_back(initial_states.back().get());
+    }
+    auto histories = std::make_unique<SynchronizedHistories<Barycentric>>(
+        static_cast<int>(celestials_.size()));
+    celestial_history_n_body_system_->Integrate(
+        history_integrator_,  // integrator
+        right_time,           // tmax
+        step,                 // Δt
+        1,                    // sampling_period
+        true,                 // tmax_is_exact
+        trajectories,         // trajectories
+        histories.get());     // histories
+    if (segment != nullptr) {
+      celestial_history_segments_.erase(segment_it);
+    }
+    while (celestial_history_segments_.size() >=
+           static_cast<std::size_t>(cached_celestial_history_segments_)) {
+      auto least_recently_used = celestial_history_segments_.begin();
+      for (auto it = celestial_history_segments_.begin();
+           it != celestial_history_segments_.end();
+           ++it) {
+        if (it->second.last_use < least_recently_used->second.last_use) {
+          least_recently_used = it;
+        }
+      }
+      celestial_history_segments_.erase(least_recently_used);
+    }
+    segment = &celestial_history_segments_[left_time];
+    segment->histories = std::move(histories);
+    if (profiling_) {
+      ++profile_.celestial_history_segments;
+    }
+  }
+  segment->last_use = ++celestial_history_segments_clock_;
+  *degrees_of_freedom =
+      segment->histories->EvaluateDegreesOfFreedom(time, column);
+  return true;
+}
+
+DegreesOfFreedom<Barycentric> Plugin::EvaluateInLastStep(
+    Trajectory<Barycentric> const& trajectory,
+    Instant const& time) const {
+  CHECK_LE(previous_time_, time);
+  CHECK_LE(time, current_time_);
+  auto const first = trajectory.first();
+  if (time < first.time()) {
+    return first.degrees_of_freedom();
+  }
+  return trajectory.EvaluateDegreesOfFreedom(time);
+}
+
+void Plugin::ForgetOldHistoryPoints(Instant const& t) {
+  ForgetCelestialHistoryPoints();
+  CheckpointCelestialHistories();
+  if (history_maximum_age_ == Time() && history_maximum_points_ == 0) {
+    return;
+  }
+  std::vector<not_null<Trajectory<Barycentric>*>> histories;
+  for (auto const& pair : celestials_) {
+    histories.push_back(pair.second->mutable_history());
+  }
+  for (auto const& pair : vessels_) {
+    not_null<Vessel*> const vessel = pair.second.get();
+    // The histories of the vessels in the bubble don't grow until they are
+    // materialized.
+    if (vessel->is_synchronized() &&
+        !vessel->has_deferred_history() &&
+        !vessel->has_bubble_histories()) {
+      histories.push_back(vessel->mutable_history());
+    }
+  }
+  std::int64_t budget = kForgottenPointsPerAdvanceTime;
+  for (std::size_t i = 0; i < histories.size() && budget > 0; ++i) {
+    history_retention_cursor_ %= histories.size();
+    not_null<Trajectory<Barycentric>*> const history =
+        histories[history_retention_cursor_];
+    std::int64_t const excess_points =
+        history_maximum_points_ == 0
+            ? 0
+            : static_cast<std::int64_t>(history->size()) -
+                  history_maximum_points_;
+    Instant const last_time = history->last().time();
+    // The points are visited from the oldest, and the last one to forget is
+    // remembered, since |ForgetBefore| requires the time of a point.
+    std::int64_t forgotten_points = 0;
+    Instant forgotten_time;
+    for (auto it = history->first(); it.time() < last_time; ++it) {
+      if (forgotten_points >= excess_points &&
+          (history_maximum_age_ == Time() ||
+           it.time() >= t - history_maximum_age_)) {
+        break;
+      }
+      forgotten_time = it.time();
+      ++forgotten_points;
+      if (forgotten_points == budget) {
+        break;
+      }
+    }
+    if (forgotten_points > 0) {
+      history->ForgetBefore(forgotten_time);
+      budget -= forgotten_points;
+    }
+    // If the budget is exhausted this history may not be done, so the next
+    // call resumes with it.
+    if (budget > 0) {
+      ++history_retention_cursor_;
+    }
+  }
+}
+
+void Plugin::MonitorConservation() {
+  if (conservation_monitoring_period_ == 0 ||
+      (conservation_drift_.samples > 0 &&
+       HistoryTime() <
+           last_conservation_sample_ + conservation_monitoring_period_ * Δt_)) {
+    return;
+  }
+  last_conservation_sample_ = HistoryTime();
+  Product<GravitationalParameter, SpecificEnergy> energy;
+  Bivector<Product<GravitationalParameter, Product<Length, Speed>>,
+           Barycentric> angular_momentum;
+  std::vector<GravitationalParameter> gravitational_parameters;
+  std::vector<Position<Barycentric>> positions;
+  gravitational_parameters.reserve(celestials_.size());
+  positions.reserve(celestials_.size());
+  for (auto const& pair : celestials_) {
+    Celestial const& celestial = *pair.second;
+    GravitationalParameter const& μ =
+        celestial.body().gravitational_parameter();
+    DegreesOfFreedom<Barycentric> const& degrees_of_freedom =
+        celestial.history().last().degrees_of_freedom();
+    Velocity<Barycentric> const& velocity = degrees_of_freedom.velocity();
+    energy += 0.5 * μ * InnerProduct(velocity, velocity);
+    angular_momentum +=
+        μ * Wedge(degrees_of_freedom.position() - Barycentric::origin,
+                  velocity);
+    gravitational_parameters.push_back(μ);
+    positions.push_back(degrees_of_freedom.position());
+  }
+  for (std::size_t i = 0; i < positions.size(); ++i) {
+    for (std::size_t j = i + 1; j < positions.size(); ++j) {
+      energy -= gravitational_parameters[i] * gravitational_parameters[j] /
+                (positions[i] - positions[j]).Norm();
+    }
+  }
+  if (conservation_drift_.samples == 0) {
+    initial_energy_ = energy;
+    initial_angular_momentum_ = angular_momentum;
+  }
+  ++conservation_drift_.samples;
+  conservation_drift_.energy =
+      Abs((energy - initial_energy_) / initial_energy_);
+  conservation_drift_.angular_momentum =
+      (angular_momentum - initial_angular_momentum_).Norm() /
+      initial_angular_momentum_.Norm();
+  conservation_drift_.maximum_energy =
+      std::max(conservation_drift_.maximum_energy, conservation_drift_.energy);
+  conservation_drift_.maximum_angular_momentum =
+      std::max(conservation_drift_.maximum_angular_momentum,
+               conservation_drift_.angular_momentum);
+}
+
+void Plugin::UpdateHistoryStep() {
+  CHECK(history_integration_ == nullptr);
+  CheckpointCelestialHistories();
+  if (history_steps_per_orbit_ == 0) {
+    Δt_ = default_Δt_;
+    return;
+  }
+  Time shortest_period = maximum_history_step_ * history_steps_per_orbit_;
+  // Updates |shortest_period| with the period of the osculating orbit of a body
+  // of gravitational parameter |μ| with respect to |parent|, if it is bound.
+  auto const update_shortest_period = [&shortest_period](
+      Celestial const& parent,
+      GravitationalParameter const& μ,
+      DegreesOfFreedom<Barycentric> const& degrees_of_freedom) {
+    GravitationalParameter const total_μ =
+        parent.body().gravitational_parameter() + μ;
+    RelativeDegreesOfFreedom<Barycentric> const relative =
+        degrees_of_freedom -
+        parent.prolongation().last().degrees_of_freedom();
+    SpecificEnergy const specific_energy =
+        0.5 * InnerProduct(relative.velocity(), relative.velocity()) -
+        total_μ / relative.displacement().Norm();
+    if (specific_energy < SpecificEnergy()) {
+      Length const semimajor_axis = -total_μ / (2 * specific_energy);
+      shortest_period =
+          std::min(shortest_period,
+                   2 * π * Sqrt(Pow<3>(semimajor_axis) / total_μ));
+    }
+  };
+  for (auto const& pair : celestials_) {
+    Celestial const& celestial = *pair.second;
+    if (celestial.has_parent()) {
+      update_shortest_period(
+          celestial.parent(),
+          celestial.body().gravitational_parameter(),
+          celestial.prolongation().last().degrees_of_freedom());
+    }
+  }
+  for (auto const& pair : vessels_) {
+    Vessel const& vessel = *pair.second;
+    if (vessel.is_initialized()) {
+      update_shortest_period(
+          vessel.parent(),
+          GravitationalParameter(),
+          vessel.prolongation().last().degrees_of_freedom());
+    }
+  }
+  Δt_ = std::max(minimum_history_step_,
+                 std::min(maximum_history_step_,
+                          shortest_period / history_steps_per_orbit_));
+}
+
+Instant const& Plugin::HistoryTime() const {
+  return sun_->history().last().time();
+}
+
+Plugin::Plugin(Instant const& initial_time,
+               Index const sun_index,
+               GravitationalParameter const& sun_gravitational_parameter,
+               Angle const& planetarium_rotation)
+    : bubble_(make_not_null_unique<PhysicsBubble>()),
+      n_body_system_(make_not_null_unique<NBodySystem<Barycentric>>(
+          NBodySystem<Barycentric>::Layout::kStructureOfArrays)),
+      planetarium_rotation_(planetarium_rotation),
+      barycentric_to_world_sun_(BarycentricToWorldSun(planetarium_rotation)),
+      barycentric_to_world_(Identity<WorldSun, World>() *
+                            barycentric_to_world_sun_),
+      current_time_(initial_time),
+      previous_time_(initial_time),
+      sun_(celestials_.emplace(sun_index,
+                               make_not_null_unique<Celestial>(
+                                   make_not_null_unique<MassiveBody>(
+                                       sun_gravitational_parameter))).
+               first->second.get()),
+      background_n_body_system_(make_not_null_unique<NBodySystem<Barycentric>>(
+          NBodySystem<Barycentric>::Layout::kStructureOfArrays)),
+      celestial_history_n_body_system_(
+          make_not_null_unique<NBodySystem<Barycentric>>(
+              NBodySystem<Barycentric>::Layout::kStructureOfArrays)) {
+  DetectedCPUFeatures();
+  sun_->CreateHistoryAndForkProlongation(
+      current_time_,
+      {Position<Barycentric>(), Velocity<Barycentric>()});
+  sun_->mutable_history()->set_downsampling(history_downsampling_);
+  history_integrator_.Initialize(SPRKScheme::kMcLachlanAtela1992Order5Optimal);
+  wisdom_holman_integrator_.Initialize(history_integrator_.Order5Optimal());
+  multistep_history_integrator_.Initialize(
+      multistep_history_integrator_.QuinlanTremaine1990Order8());
+  // NOTE(egg): perhaps a lower order would be appropriate.
+  prolongation_integrator_.Initialize(
+      SPRKScheme::kMcLachlanAtela1992Order5Optimal);
+  prediction_integrator_.Initialize(
+      SPRKScheme::kMcLachlanAtela1992Order5Optimal);
+  gauss_jackson_prediction_integrator_.Initialize(
+      gauss_jackson_prediction_integrator_.Order8());
+  parareal_prediction_integrator_.Initialize(
+      history_integrator_.Order5Optimal());
+  parareal_prediction_integrator_.InitializeCoarse(
+      history_integrator_.CoefficientsOf(
+          SPRKScheme::kMcLachlanAtela1992Order4Optimal),
+      kPararealCoarseStepRatio);
+}
+
+void Plugin::InsertCelestial(
+    Index const celestial_index,
+    GravitationalParameter const& gravitational_parameter,
+    Index const parent_index,
+    RelativeDegreesOfFreedom<AliceSun> const& from_parent) {
+  CHECK(initializing_) << "Celestial bodies should be inserted before the end "
+                       << "of initialization";
+  auto const it = celestials_.find(parent_index);
+  CHECK(it != celestials_.end()) << "No body at index " << parent_index;
+  not_null<Celestial const*> parent = it->second.get();
   LOG(INFO) << "Initial |{orbit.pos, orbit.vel}| for celestial at index "
             << celestial_index << ": " << from_parent;
   auto const relative =
       PlanetariumRotation().Inverse()(
           kSunLookingGlass.Inverse()(from_parent));
   LOG(INFO) << "In barycentric coordinates: " << relative;
+  AddCelestial(celestial_index, gravitational_parameter, parent, relative);
+}
+
+void Plugin::InsertCelestials(
+    std::vector<CelestialDescription> const& celestials) {
+  CHECK(initializing_) << "Celestial bodies should be inserted before the end "
+                       << "of initialization";
+  LOG(INFO) << "Inserting " << celestials.size() << " celestials";
+  std::map<Index, CelestialDescription const*> pending;
+  for (auto const& description : celestials) {
+    CHECK(celestials_.find(description.celestial_index) == celestials_.end() &&
+          pending.emplace(description.celestial_index, &description).second)
+        << "Body already exists at index " << description.celestial_index;
+  }
+  Rotation<WorldSun, Barycentric> const world_sun_to_barycentric =
+      PlanetariumRotation().Inverse();
+  // The chain of pending ancestors of the celestial being inserted, innermost
+  // last.
+  std::vector<CelestialDescription const*> ancestors;
+  for (auto const& description : celestials) {
+    if (pending.find(description.celestial_index) == pending.end()) {
+      // Already inserted as the ancestor of a preceding celestial.
+      continue;
+    }
+    ancestors.push_back(&description);
+    for (;;) {
+      Index const parent_index = ancestors.back()->parent_index;
+      auto const it = pending.find(parent_index);
+      if (it == pending.end()) {
+        break;
+      }
+      CHECK_LE(ancestors.size(), pending.size())
+          << "Cycle in the hierarchy at index " << parent_index;
+      ancestors.push_back(it->second);
+    }
+    // Insert from the outermost ancestor, whose parent is already inserted.
+    for (; !ancestors.empty(); ancestors.pop_back()) {
+      CelestialDescription const& ancestor = *ancestors.back();
+      auto const it = celestials_.find(ancestor.parent_index);
+      CHECK(it != celestials_.end())
+          << "No body at index " << ancestor.parent_index;
+      AddCelestial(ancestor.celestial_index,
+                   ancestor.gravitational_parameter,
+                   it->second.get(),
+                   world_sun_to_barycentric(
+                       kSunLookingGlass.Inverse()(ancestor.from_parent)));
+      pending.erase(ancestor.celestial_index);
+    }
+  }
+}
+
+void Plugin::EndInitialization() {
+  initializing_.Flop();
+}
+
+bool Plugin::LoadEphemerisFile(std::string const& filename) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(filename);
+  CHECK(!initializing_);
+  // The worker of a pipelined integration reads |ephemeris_file_|.
+  if (history_integration_ != nullptr) {
+    FinishHistoryIntegration();
+  }
+  auto file = std::make_unique<EphemerisFile<Barycentric> const>(filename);
+  if (file->number_of_bodies() != celestials_.size()) {
+    LOG(WARNING) << filename << " has " << file->number_of_bodies()
+                 << " bodies, the plugin has " << celestials_.size()
+                 << " celestials";
+    return false;
+  }
+  std::map<std::int64_t, std::size_t> file_indices;
+  for (std::size_t i = 0; i < file->number_of_bodies(); ++i) {
+    file_indices[file->identifier(i)] = i;
+  }
+  std::map<MassiveBody const*, std::size_t> indices;
+  for (auto const& pair : celestials_) {
+    Index const celestial_index = pair.first;
+    Celestial const& celestial = *pair.second;
+    auto const it = file_indices.find(celestial_index);
+    if (it == file_indices.end()) {
+      LOG(WARNING) << filename << " has no body " << celestial_index;
+      return false;
+    }
+    std::size_t const index = it->second;
+    if (file->gravitational_parameter(index) !=
+            celestial.body().gravitational_parameter()) {
+      LOG(WARNING) << filename << " has a gravitational parameter of "
+                   << file->gravitational_parameter(index) << " for body "
+                   << celestial_index << ", the plugin has "
+                   << celestial.body().gravitational_parameter();
+      return false;
+    }
+    // The file replaces the history before its first point, and the
+    // integration after its last point if it covers it.
+    Trajectory<Barycentric> const& history = celestial.history();
+    if (history.first().time() < file->t_min() ||
+        history.first().time() > file->t_max()) {
+      LOG(WARNING) << filename << " covers [" << file->t_min() << ", "
+                   << file->t_max() << "], not " << history.first().time();
+      return false;
+    }
+    for (auto const& it : {history.first(), history.last()}) {
+      if (it.time() > file->t_max()) {
+        continue;
+      }
+      DegreesOfFreedom<Barycentric> const& state = it.degrees_of_freedom();
+      Length const position_error =
+          (file->EvaluatePosition(index, it.time()) -
+               state.position()).Norm();
+      Speed const velocity_error =
+          (file->EvaluateVelocity(index, it.time()) -
+               state.velocity()).Norm();
+      if (position_error > ephemeris_file_length_tolerance_ ||
+          velocity_error > ephemeris_file_speed_tolerance_) {
+        LOG(WARNING) << filename << " doesn't match the state of body "
+                     << celestial_index << " at " << it.time() << ": "
+                     << NAMED(position_error) << ", "
+                     << NAMED(velocity_error);
+        return false;
+      }
+    }
+    indices.emplace(&celestial.body(), index);
+  }
+  LOG(INFO) << "Evaluating the celestials from " << filename << " up to "
+            << file->t_max();
+  // The evaluators are replaced before the previous file, if any, is unmapped.
+  for (auto const& pair : celestials_) {
+    pair.second->set_ephemeris_file(file.get(),
+                                    indices.at(&pair.second->body()));
+  }
+  CheckpointCelestialHistories();
+  ephemeris_file_ = std::move(file);
+  ephemeris_file_indices_ = std::move(indices);
+  ephemeris_filename_ = filename;
+  ForgetCelestialHistoryPoints();
+  return true;
+}
+
+void Plugin::WriteEphemerisFile(std::string const& filename,
+                                Instant const& t_max,
+                                int const steps_per_series,
+                                int const degree) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(filename) << '\n'
+          << NAMED(t_max) << '\n' << NAMED(steps_per_series) << '\n'
+          << NAMED(degree);
+  CHECK(!initializing_);
+  CHECK_LT(HistoryTime(), t_max);
+  NBodySystem<Barycentric>::Trajectories celestial_trajectories;
+  std::map<MassiveBody const*, Index> celestial_indices;
+  for (auto const& pair : celestials_) {
+    celestial_trajectories.push_back(pair.second->mutable_history());
+    celestial_indices.emplace(&pair.second->body(), pair.first);
+  }
+  // The ephemeris only copies the last points of the histories, which are not
+  // modified.
+  Ephemeris<Barycentric> ephemeris(celestial_trajectories,
+                                   HistoryIntegrator(),
+                                   Δt_,
+                                   steps_per_series,
+                                   degree);
+  std::vector<std::int64_t> identifiers;
+  identifiers.reserve(ephemeris.number_of_bodies());
+  for (MassiveBody const* const body : ephemeris.bodies()) {
+    identifiers.push_back(celestial_indices.at(body));
+  }
+  EphemerisFile<Barycentric>::Write(identifiers, t_max, &ephemeris, filename);
+}
+
+void Plugin::WriteTrajectoryFile(std::string const& filename) const {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(filename);
+  CHECK(!initializing_);
+  TrajectoryFileWriter<Barycentric> writer(filename);
+  for (auto const& pair : celestials_) {
+    writer.Append(pair.first, pair.second->history());
+  }
+  writer.Close();
+}
+
+void Plugin::AddCelestial(
+    Index const celestial_index,
+    GravitationalParameter const& gravitational_parameter,
+    not_null<Celestial const*> const parent,
+    RelativeDegreesOfFreedom<Barycentric> const& relative) {
+  auto const inserted = celestials_.emplace(
+      celestial_index,
+      make_not_null_unique<Celestial>(
+          make_not_null_unique<MassiveBody>(gravitational_parameter)));
+  CHECK(inserted.second) << "Body already exists at index " << celestial_index;
   not_null<Celestial*> const celestial = inserted.first->second.get();
   celestial->set_parent(parent);
   celestial->CreateHistoryAndForkProlongation(
       current_time_,
       parent->history().last().degrees_of_freedom() + relative);
-}
-
-void Plugin::EndInitialization() {
-  initializing_.Flop();
+  celestial->mutable_history()->set_downsampling(history_downsampling_);
 }
 
 void Plugin::UpdateCelestialHierarchy(Index const celestial_index,
@@ -387,7 +1923,10 @@ bool Plugin::InsertOrKeepVessel(GUID const& vessel_guid,
   auto inserted = vessels_.emplace(vessel_guid,
                                    make_not_null_unique<Vessel>(parent));
   not_null<Vessel*> const vessel = inserted.first->second.get();
-  kept_vessels_.emplace(vessel);
+  VesselHandle const handle = inserted.second
+                                  ? AllocateVesselHandle(inserted.first)
+                                  : vessel_handle(vessel_guid);
+  vessel_slots_[vessel_slot_index(handle)].kept = true;
   vessel->set_parent(parent);
   LOG_IF(INFO, inserted.second) << "Inserted vessel with GUID " << vessel_guid
                                 << " at " << vessel;
@@ -396,149 +1935,1352 @@ bool Plugin::InsertOrKeepVessel(GUID const& vessel_guid,
   return inserted.second;
 }
 
-void Plugin::SetVesselStateOffset(
-    GUID const& vessel_guid,
-    RelativeDegreesOfFreedom<AliceSun> const& from_parent) {
+VesselHandle Plugin::vessel_handle(GUID const& vessel_guid) const {
+  auto const it = vessel_handles_.find(vessel_guid);
+  CHECK(it != vessel_handles_.end()) << "No vessel with GUID " << vessel_guid;
+  return it->second;
+}
+
+void Plugin::KeepVessels(std::vector<VesselHandle> const& vessel_handles) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(vessel_handles.size());
+  CHECK(!initializing_);
+  for (VesselHandle const vessel_handle : vessel_handles) {
+    vessel_slots_[vessel_slot_index(vessel_handle)].kept = true;
+  }
+}
+
+void Plugin::RemoveVessel(GUID const& vessel_guid) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(vessel_guid);
+  CHECK(!initializing_);
+  vessel_slots_[vessel_slot_index(vessel_handle(vessel_guid))].kept = false;
+}
+
+void Plugin::SetVesselStateOffset(
+    GUID const& vessel_guid,
+    RelativeDegreesOfFreedom<AliceSun> const& from_parent) {
+  VLOG(1) << __FUNCTION__ << '\n'
+          << NAMED(vessel_guid) << '\n' << NAMED(from_parent);
+  CHECK(!initializing_);
+  not_null<std::unique_ptr<Vessel>> const& vessel =
+      find_vessel_by_guid_or_die(vessel_guid);
+  CHECK(!vessel->is_initialized())
+      << "Vessel with GUID " << vessel_guid << " already has a trajectory";
+  LOG(INFO) << "Initial |{orbit.pos, orbit.vel}| for vessel with GUID "
+            << vessel_guid << ": " << from_parent;
+  RelativeDegreesOfFreedom<Barycentric> const relative =
+      PlanetariumRotation().Inverse()(
+          kSunLookingGlass.Inverse()(from_parent));
+  LOG(INFO) << "In barycentric coordinates: " << relative;
+  vessel->CreateProlongation(
+      current_time_,
+      vessel->parent().prolongation().last().degrees_of_freedom() + relative);
+  ++number_of_unsynchronized_vessels_;
+}
+
+std::vector<VesselHandle> Plugin::InsertVessels(
+    std::vector<GUID> const& vessel_guids,
+    std::vector<Index> const& parent_indices,
+    std::vector<RelativeDegreesOfFreedom<AliceSun>> const& from_parents) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(vessel_guids.size());
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK(!initializing_);
+  CHECK_EQ(vessel_guids.size(), parent_indices.size());
+  CHECK_EQ(vessel_guids.size(), from_parents.size());
+  // Applied in the same order as in |SetVesselStateOffset|, so that the
+  // results are the same.
+  Rotation<WorldSun, Barycentric> const from_world_sun =
+      PlanetariumRotation().Inverse();
+  Permutation<AliceSun, WorldSun> const from_alice_sun =
+      kSunLookingGlass.Inverse();
+  // The parents and their degrees of freedom at |current_time_|, looked up
+  // once per parent.
+  std::map<Index, std::pair<not_null<Celestial const*>,
+                            DegreesOfFreedom<Barycentric>>> parents;
+  std::vector<VesselHandle> vessel_handles;
+  vessel_handles.reserve(vessel_guids.size());
+  int inserted_vessels = 0;
+  for (std::size_t i = 0; i < vessel_guids.size(); ++i) {
+    GUID const& vessel_guid = vessel_guids[i];
+    Index const parent_index = parent_indices[i];
+    auto parent_it = parents.find(parent_index);
+    if (parent_it == parents.end()) {
+      auto const it = celestials_.find(parent_index);
+      CHECK(it != celestials_.end()) << "No body at index " << parent_index;
+      not_null<Celestial const*> const parent = it->second.get();
+      parent_it = parents.emplace(
+          parent_index,
+          std::make_pair(
+              parent,
+              parent->prolongation().last().degrees_of_freedom())).first;
+    }
+    not_null<Celestial const*> const parent = parent_it->second.first;
+    auto const inserted =
+        vessels_.emplace(vessel_guid, make_not_null_unique<Vessel>(parent));
+    not_null<Vessel*> const vessel = inserted.first->second.get();
+    VesselHandle handle;
+    if (inserted.second) {
+      handle = AllocateVesselHandle(inserted.first);
+      RelativeDegreesOfFreedom<Barycentric> const relative =
+          from_world_sun(from_alice_sun(from_parents[i]));
+      VLOG(1) << "Inserted vessel with GUID " << vessel_guid << " at "
+              << vessel << " with " << NAMED(relative);
+      vessel->CreateProlongation(current_time_,
+                                 parent_it->second.second + relative);
+      ++number_of_unsynchronized_vessels_;
+      ++inserted_vessels;
+    } else {
+      handle = vessel_handle(vessel_guid);
+      vessel->set_parent(parent);
+    }
+    vessel_slots_[vessel_slot_index(handle)].kept = true;
+    vessel_handles.push_back(handle);
+  }
+  LOG(INFO) << "Inserted " << inserted_vessels << " vessels out of "
+            << vessel_guids.size();
+  return vessel_handles;
+}
+
+void Plugin::AdvanceTime(Instant const& t, Angle const& planetarium_rotation) {
+  VLOG(1) << __FUNCTION__ << '\n'
+          << NAMED(t) << '\n' << NAMED(planetarium_rotation);
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  ScopedAllocationCounter const allocation_counter(
+      profiling_ ? &profile_.advance_time_allocations : nullptr);
+  CHECK(!initializing_);
+  CHECK_GT(t, current_time_);
+  // The unsynchronized and dirty vessels, and thus the physics bubble, require
+  // the synchronous integration.
+  bool const may_pipeline = pipelined_histories_ &&
+                            !has_unsynchronized_vessels() &&
+                            !has_dirty_vessels();
+  // Likewise for the evolution of the histories within the budget, which may
+  // leave them behind |current_time_|.
+  bool const may_budget = history_step_budget_ > 0 &&
+                          !has_unsynchronized_vessels() &&
+                          !has_dirty_vessels();
+  if (history_integration_ != nullptr && !may_pipeline) {
+    FinishHistoryIntegration();
+  }
+  if (history_integration_ == nullptr) {
+    UpdateHistoryStep();
+  }
+  if (history_integration_ == nullptr &&
+      !may_pipeline &&
+      !may_budget &&
+      HistoryTime() + Δt_ < current_time_) {
+    // The synchronization requires the histories to be within |Δt_| of
+    // |current_time_|.
+    CatchUpHistories();
+  }
+  {
+    PhaseTimer const timer(profiling_ ? &profile_.clean_up_vessels : nullptr);
+    CleanUpVessels();
+  }
+  MarkVesselsInBubble();
+  bool const bubble_will_be_empty = bubble_->will_be_empty();
+  if (history_integration_ == nullptr &&
+      may_budget &&
+      !bubble_will_be_empty &&
+      HistoryTime() + Δt_ < current_time_) {
+    // The budget doesn't apply when there is a bubble to synchronize.
+    CatchUpHistories();
+  }
+  bool const evolve_histories = history_integration_ == nullptr &&
+                                !(may_pipeline && bubble_will_be_empty) &&
+                                HistoryTime() + Δt_ < t;
+  // Preparing the bubble only reads the parts and the prolongations of the
+  // vessels of the next bubble, which |EvolveHistories| doesn't touch, so the
+  // two run concurrently if there is a thread pool.  The preparation is joined
+  // before anything reads the bubble.
+  std::function<void()> const prepare_bubble = [this, t]() {
+    PhaseTimer const timer(profiling_ ? &profile_.prepare_bubble : nullptr);
+    bubble_->Prepare(PlanetariumRotation(), current_time_, t);
+  };
+  std::future<void> bubble_prepared;
+  if (evolve_histories && thread_pool_ != nullptr) {
+    bubble_prepared = thread_pool_->Add(prepare_bubble);
+  } else {
+    prepare_bubble();
+  }
+  if (history_integration_ != nullptr) {
+    // If the worker is still busy only the prolongations are evolved.
+    // Otherwise the points that it has computed up to |t| are committed, and
+    // it is restarted if fewer than half of |history_look_ahead_| remain.
+    std::future<void>& done = history_integration_->done;
+    if (!done.valid() ||
+        done.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      if (done.valid()) {
+        done.get();
+      }
+      Instant const history_time = HistoryTime();
+      CommitHistoryIntegration(t);
+      if (HistoryTime() > history_time) {
+        PhaseTimer const timer(
+            profiling_ ? &profile_.reset_prolongations : nullptr);
+        ResetProlongations();
+      }
+      Instant const last =
+          history_integration_->histories.front()->last().time();
+      if (last < t + history_look_ahead_ / 2 &&
+          last + Δt_ < t + history_look_ahead_) {
+        LaunchHistoryIntegration(t + history_look_ahead_);
+      }
+    }
+  } else if (may_pipeline && bubble_will_be_empty && HistoryTime() + Δt_ < t) {
+    StartHistoryIntegration(t + history_look_ahead_);
+  } else if (evolve_histories) {
+    // The histories are far enough behind that we can advance them at least one
+    // step and reset the prolongations.  The celestials are integrated once,
+    // with the histories, and their steps are reused for the synchronization.
+    // With a budget and an empty bubble, the histories are evolved by at most
+    // |history_step_budget_| steps; there is no synchronization then.
+    Instant history_tmax = t;
+    if (may_budget && bubble_will_be_empty) {
+      history_tmax = std::min(
+          t, HistoryTime() + (history_step_budget_ + 0.5) * Δt_);
+    }
+    NBodySystem<Barycentric>::MassiveBodiesSteps celestial_steps;
+    {
+      PhaseTimer const timer(
+          profiling_ ? &profile_.evolve_histories : nullptr);
+      EvolveHistories(history_tmax, &celestial_steps);
+    }
+    CHECK(history_tmax < t || HistoryTime() >= current_time_);
+    if (bubble_prepared.valid()) {
+      bubble_prepared.get();
+    }
+    // TODO(egg): I think |!bubble_->empty()| => |has_dirty_vessels()|.
+    if (has_unsynchronized_vessels() ||
+        has_dirty_vessels() ||
+        !bubble_->empty()) {
+      PhaseTimer const timer(profiling_ ? &profile_.synchronization : nullptr);
+      SynchronizeNewVesselsAndCleanDirtyVessels(celestial_steps);
+    }
+    // If the histories are still behind |current_time_|, the prolongations are
+    // kept and extended from their last point, rather than integrated again
+    // from |HistoryTime()|.
+    if (HistoryTime() >= current_time_) {
+      PhaseTimer const timer(
+          profiling_ ? &profile_.reset_prolongations : nullptr);
+      ResetProlongations();
+    }
+  }
+  CompleteAdvanceTime(t, planetarium_rotation);
+}
+
+void Plugin::FastForward(
+    Instant const& t,
+    Angle const& planetarium_rotation,
+    std::function<void(Instant const& history_time)> const& progress) {
+  VLOG(1) << __FUNCTION__ << '\n'
+          << NAMED(t) << '\n' << NAMED(planetarium_rotation);
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK(!initializing_);
+  CHECK_GT(t, current_time_);
+  if (history_integration_ != nullptr) {
+    FinishHistoryIntegration();
+  }
+  UpdateHistoryStep();
+  if (t < current_time_ + Δt_) {
+    // Not even one step of the histories is gained.
+    AdvanceTime(t, planetarium_rotation);
+    return;
+  }
+  if (HistoryTime() + Δt_ < current_time_) {
+    CatchUpHistories();
+  }
+  CleanUpVessels();
+  MarkVesselsInBubble();
+  CHECK(bubble_->will_be_empty())
+      << "Cannot fast-forward with vessels in the physics bubble";
+  // This empties the bubble, and the vessels that were in it become dirty.
+  bubble_->Prepare(PlanetariumRotation(), current_time_, t);
+  // Since |HistoryTime() + Δt_ >= current_time_| and |t >= current_time_ +
+  // Δt_|, the first chunk takes the histories past |current_time_|, where the
+  // unsynchronized and dirty vessels are synchronized.
+  bool synchronized = false;
+  while (HistoryTime() + Δt_ < t) {
+    NBodySystem<Barycentric>::MassiveBodiesSteps celestial_steps;
+    {
+      PhaseTimer const timer(
+          profiling_ ? &profile_.evolve_histories : nullptr);
+      EvolveHistories(
+          std::min(t, HistoryTime() + kFastForwardChunkSteps * Δt_),
+          &celestial_steps);
+    }
+    if (!synchronized) {
+      CHECK_GE(HistoryTime(), current_time_);
+      if (has_unsynchronized_vessels() || has_dirty_vessels()) {
+        PhaseTimer const timer(
+            profiling_ ? &profile_.synchronization : nullptr);
+        SynchronizeNewVesselsAndCleanDirtyVessels(celestial_steps);
+      }
+      synchronized = true;
+    }
+    ForgetOldHistoryPoints(HistoryTime());
+    if (progress) {
+      progress(HistoryTime());
+    }
+  }
+  {
+    PhaseTimer const timer(
+        profiling_ ? &profile_.reset_prolongations : nullptr);
+    ResetProlongations();
+  }
+  CompleteAdvanceTime(t, planetarium_rotation);
+}
+
+void Plugin::CompleteAdvanceTime(Instant const& t,
+                                 Angle const& planetarium_rotation) {
+  {
+    PhaseTimer const timer(
+        profiling_ ? &profile_.evolve_prolongations_and_bubble : nullptr);
+    EvolveProlongationsAndBubble(t);
+  }
+  ForgetOldHistoryPoints(t);
+  MonitorConservation();
+  if (profiling_) {
+    ++profile_.advance_time_calls;
+    NBodySystem<Barycentric>::Statistics const& statistics =
+        n_body_system_->statistics();
+    profile_.force_evaluations += statistics.force_evaluations;
+    profile_.points_appended += statistics.points_appended;
+  }
+  n_body_system_->reset_statistics();
+  VLOG(1) << "Time has been advanced" << '\n'
+          << "from : " << current_time_ << '\n'
+          << "to   : " << t;
+  previous_time_ = current_time_;
+  current_time_ = t;
+  SetPlanetariumRotation(planetarium_rotation);
+  UpdateVesselGrid();
+  PublishStateTable();
+}
+
+void Plugin::UpdateVesselGrid() {
+  vessel_grid_.Clear();
+  for (std::uint32_t index = 0; index < vessel_slots_.size(); ++index) {
+    VesselSlot const& slot = vessel_slots_[index];
+    if (slot.guid != nullptr && slot.vessel->is_initialized()) {
+      vessel_grid_.Insert(
+          slot.vessel->prolongation().last().degrees_of_freedom().position(),
+          (static_cast<VesselHandle>(slot.generation) << 32) | index);
+    }
+  }
+}
+
+void Plugin::PublishStateTable() {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  Rotation<Barycentric, WorldSun> const& planetarium_rotation =
+      PlanetariumRotation();
+  auto const publish = [this, &planetarium_rotation](
+      std::int64_t const handle,
+      RelativeDegreesOfFreedom<Barycentric> const& relative,
+      PublishedState& state) {
+    RelativeDegreesOfFreedom<AliceSun> const from_parent =
+        kSunLookingGlass(planetarium_rotation(relative));
+    R3Element<double> const q =
+        from_parent.displacement().coordinates() / Metre;
+    R3Element<double> const p =
+        from_parent.velocity().coordinates() / (Metre / Second);
+    R3Element<double> const world_q =
+        barycentric_to_world_(relative.displacement()).coordinates() / Metre;
+    R3Element<double> const world_p =
+        barycentric_to_world_(relative.velocity()).coordinates() /
+        (Metre / Second);
+    state.handle = handle;
+    for (int i = 0; i < 3; ++i) {
+      state.from_parent[i] = q[i];
+      state.from_parent[3 + i] = p[i];
+      state.world_displacement[i] = world_q[i];
+      state.world_velocity[i] = world_p[i];
+    }
+  };
+
+  published_vessels_.resize(vessel_slots_.size());
+  for (std::uint32_t index = 0; index < vessel_slots_.size(); ++index) {
+    VesselSlot const& slot = vessel_slots_[index];
+    PublishedState& state = published_vessels_[index];
+    if (slot.guid == nullptr || !slot.vessel->is_initialized()) {
+      state.handle = -1;
+      continue;
+    }
+    publish((static_cast<VesselHandle>(slot.generation) << 32) | index,
+            slot.vessel->prolongation().last().degrees_of_freedom() -
+                slot.vessel->parent().prolongation().last().
+                    degrees_of_freedom(),
+            state);
+  }
+
+  published_celestials_.resize(celestials_.rbegin()->first + 1);
+  for (auto& state : published_celestials_) {
+    state.handle = -1;
+  }
+  for (auto const& index_celestial : celestials_) {
+    Celestial const& celestial = *index_celestial.second;
+    DegreesOfFreedom<Barycentric> const degrees_of_freedom =
+        celestial.prolongation().last().degrees_of_freedom();
+    publish(index_celestial.first,
+            celestial.has_parent()
+                ? degrees_of_freedom -
+                      celestial.parent().prolongation().last().
+                          degrees_of_freedom()
+                : degrees_of_freedom - degrees_of_freedom,
+            published_celestials_[index_celestial.first]);
+  }
+
+  R3Element<double> const world_rotation_axis =
+      barycentric_to_world_(Vector<double, Barycentric>({0, 1, 0})).
+          coordinates();
+  state_table_.time = (current_time_ - Instant()) / Second;
+  for (int i = 0; i < 3; ++i) {
+    state_table_.world_rotation_axis[i] = world_rotation_axis[i];
+  }
+  state_table_.number_of_vessels =
+      static_cast<std::int32_t>(published_vessels_.size());
+  state_table_.number_of_celestials =
+      static_cast<std::int32_t>(published_celestials_.size());
+  state_table_.vessels = published_vessels_.data();
+  state_table_.celestials = published_celestials_.data();
+  ++state_table_.version;
+}
+
+void Plugin::SetNumberOfThreads(int const number_of_threads) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(number_of_threads);
+  CHECK_LT(0, number_of_threads);
+  if (history_integration_ != nullptr) {
+    FinishHistoryIntegration();
+  }
+  n_body_system_->set_thread_pool(nullptr);
+  background_n_body_system_->set_thread_pool(nullptr);
+  if (number_of_threads == 1) {
+    thread_pool_.reset();
+  } else {
+    thread_pool_ = std::make_unique<ThreadPool>(number_of_threads);
+  }
+  n_body_system_->set_thread_pool(thread_pool_.get());
+  background_n_body_system_->set_thread_pool(thread_pool_.get());
+}
+
+void Plugin::SetKernelConfiguration(KernelConfiguration const& configuration) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(configuration);
+  SetNumberOfThreads(configuration.number_of_threads);
+  n_body_system_->set_massless_chunks_per_thread(
+      configuration.massless_chunks_per_thread);
+  background_n_body_system_->set_massless_chunks_per_thread(
+      configuration.massless_chunks_per_thread);
+  base::SetMaximumVectorInstructionSet(
+      configuration.maximum_vector_instruction_set);
+}
+
+void Plugin::SetNumberOfVesselGroups(int const number_of_groups) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(number_of_groups);
+  CHECK_LT(0, number_of_groups);
+  number_of_vessel_groups_ = number_of_groups;
+}
+
+void Plugin::SetProfiling(bool const enabled) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(enabled);
+  if (enabled) {
+    profile_ = Profile();
+    n_body_system_->reset_statistics();
+  }
+  profiling_ = enabled;
+}
+
+Plugin::Profile Plugin::profile() const {
+  return profile_;
+}
+
+void Plugin::SetConservationMonitoring(int const period) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(period);
+  CHECK_LE(0, period);
+  conservation_monitoring_period_ = period;
+  conservation_drift_ = ConservationDrift();
+}
+
+Plugin::ConservationDrift Plugin::conservation_drift() const {
+  return conservation_drift_;
+}
+
+Plugin::MemoryUsage Plugin::memory_usage() const {
+  VLOG(1) << __FUNCTION__;
+  MemoryUsage usage;
+  for (auto const& pair : celestials_) {
+    usage.celestials += pair.second->MemoryUsage();
+  }
+  {
+    std::lock_guard<std::mutex> l(celestial_history_segments_lock_);
+    for (auto const& pair : celestial_history_segments_) {
+      usage.celestials += pair.second.histories->MemoryUsage();
+    }
+  }
+  for (auto const& pair : vessels_) {
+    usage.vessels += pair.second->MemoryUsage();
+  }
+  usage.bubble = bubble_->MemoryUsage();
+  if (bubble_histories_ != nullptr) {
+    usage.bubble += bubble_histories_->MemoryUsage();
+  }
+  return usage;
+}
+
+std::int64_t Plugin::VesselMemoryUsage(GUID const& vessel_guid) const {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(vessel_guid);
+  VLOG_AND_RETURN(1, find_vessel_by_guid_or_die(vessel_guid)->MemoryUsage());
+}
+
+std::int64_t Plugin::CelestialMemoryUsage(Index const celestial_index) const {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(celestial_index);
+  auto const it = celestials_.find(celestial_index);
+  CHECK(it != celestials_.end()) << "No body at index " << celestial_index;
+  VLOG_AND_RETURN(1, it->second->MemoryUsage());
+}
+
+void Plugin::SetPipelinedHistories(bool const pipelined) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(pipelined);
+  if (!pipelined && history_integration_ != nullptr) {
+    FinishHistoryIntegration();
+  }
+  pipelined_histories_ = pipelined;
+}
+
+void Plugin::SetKeplerianPerturbationThreshold(double const threshold) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(threshold);
+  CHECK_LE(0, threshold);
+  keplerian_perturbation_threshold_ = threshold;
+}
+
+void Plugin::SetClusterTolerance(Length const& tolerance) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(tolerance);
+  CHECK_LE(Length(), tolerance);
+  cluster_tolerance_ = tolerance;
+}
+
+void Plugin::SetHistoryLookAhead(Time const& look_ahead) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(look_ahead);
+  CHECK_LE(Time(), look_ahead);
+  history_look_ahead_ = look_ahead;
+}
+
+void Plugin::SetHistoryStepBudget(int const steps) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(steps);
+  CHECK_LE(0, steps);
+  history_step_budget_ = steps;
+}
+
+void Plugin::SetHistoryRetention(Time const& maximum_age,
+                                 std::int64_t const maximum_points) {
+  VLOG(1) << __FUNCTION__ << '\n'
+          << NAMED(maximum_age) << '\n' << NAMED(maximum_points);
+  CHECK_LE(Time(), maximum_age);
+  CHECK_LE(0, maximum_points);
+  history_maximum_age_ = maximum_age;
+  history_maximum_points_ = maximum_points;
+}
+
+void Plugin::SetHistoryStepPolicy(int const steps_per_orbit,
+                                  Time const& minimum_step,
+                                  Time const& maximum_step) {
+  VLOG(1) << __FUNCTION__ << '\n'
+          << NAMED(steps_per_orbit) << '\n'
+          << NAMED(minimum_step) << '\n' << NAMED(maximum_step);
+  CHECK_LE(0, steps_per_orbit);
+  CHECK_LT(Time(), minimum_step);
+  CHECK_LE(minimum_step, maximum_step);
+  history_steps_per_orbit_ = steps_per_orbit;
+  minimum_history_step_ = minimum_step;
+  maximum_history_step_ = maximum_step;
+}
+
+void Plugin::SetCelestialHistoryGapEvaluators() {
+  std::size_t column = 0;
+  for (auto const& pair : celestials_) {
+    pair.second->mutable_history()->set_gap_evaluator(
+        [this, column](
+            Instant const& left_time,
+            Instant const& right_time,
+            Instant const& time,
+            not_null<DegreesOfFreedom<Barycentric>*> const degrees_of_freedom) {
+          return EvaluateCelestialHistoryGap(
+              column, left_time, right_time, time, degrees_of_freedom);
+        });
+    ++column;
+  }
+}
+
+void Plugin::SetCelestialHistoryCheckpoints(
+    int const steps_between_checkpoints,
+    int const cached_segments) {
+  VLOG(1) << __FUNCTION__ << '\n'
+          << NAMED(steps_between_checkpoints) << '\n'
+          << NAMED(cached_segments);
+  CHECK(!initializing_);
+  CHECK_LE(0, steps_between_checkpoints);
+  CHECK_LE(steps_between_checkpoints, kMaximumCelestialHistorySegmentSteps);
+  CHECK_LT(0, cached_segments);
+  // The points appended so far belong to the runs of the previous policy.
+  CheckpointCelestialHistories();
+  if (steps_between_checkpoints == 0 &&
+      steps_between_celestial_history_checkpoints_ != 0) {
+    for (auto const& pair : celestials_) {
+      pair.second->mutable_history()->set_downsampling(history_downsampling_);
+    }
+  } else if (steps_between_checkpoints != 0 &&
+             steps_between_celestial_history_checkpoints_ == 0) {
+    for (auto const& pair : celestials_) {
+      pair.second->mutable_history()->clear_downsampling();
+    }
+    SetCelestialHistoryGapEvaluators();
+  }
+  steps_between_celestial_history_checkpoints_ = steps_between_checkpoints;
+  std::lock_guard<std::mutex> l(celestial_history_segments_lock_);
+  cached_celestial_history_segments_ = cached_segments;
+}
+
+void Plugin::SetHierarchicalForceModel(double const tolerance,
+                                       bool const use_quadrupole) {
+  VLOG(1) << __FUNCTION__ << '\n'
+          << NAMED(tolerance) << '\n' << NAMED(use_quadrupole);
+  CHECK(!initializing_);
+  // The worker reads the parameters of |background_n_body_system_|.
+  if (history_integration_ != nullptr) {
+    FinishHistoryIntegration();
+  }
+  hierarchical_tolerance_ = tolerance;
+  use_quadrupole_ = use_quadrupole;
+  std::map<MassiveBody const*, MassiveBody const*> const parents =
+      CelestialParents();
+  n_body_system_->SetHierarchicalForceModel(parents,
+                                            tolerance,
+                                            use_quadrupole);
+  background_n_body_system_->SetHierarchicalForceModel(parents,
+                                                       tolerance,
+                                                       use_quadrupole);
+  std::lock_guard<std::mutex> l(celestial_history_segments_lock_);
+  celestial_history_n_body_system_->SetHierarchicalForceModel(parents,
+                                                              tolerance,
+                                                              use_quadrupole);
+}
+
+void Plugin::SetCloseEncounterTimescaleFraction(
+    double const timescale_fraction) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(timescale_fraction);
+  CHECK(!initializing_);
+  // The worker reads the parameters of |background_n_body_system_|.
+  if (history_integration_ != nullptr) {
+    FinishHistoryIntegration();
+  }
+  close_encounter_timescale_fraction_ = timescale_fraction;
+  n_body_system_->set_close_encounter_timescale_fraction(timescale_fraction);
+  background_n_body_system_->set_close_encounter_timescale_fraction(
+      timescale_fraction);
+  std::lock_guard<std::mutex> l(celestial_history_segments_lock_);
+  celestial_history_n_body_system_->set_close_encounter_timescale_fraction(
+      timescale_fraction);
+}
+
+void Plugin::SetSymplecticIntegrators(SPRKScheme const history_scheme,
+                                      SPRKScheme const prolongation_scheme) {
+  VLOG(1) << __FUNCTION__ << '\n'
+          << NAMED(static_cast<int>(history_scheme)) << '\n'
+          << NAMED(static_cast<int>(prolongation_scheme));
+  CHECK(!initializing_);
+  // The worker uses the integrators.
+  if (history_integration_ != nullptr) {
+    FinishHistoryIntegration();
+  }
+  history_integrator_.Initialize(history_scheme);
+  if (!history_integrator_.IsProcessed(history_scheme)) {
+    wisdom_holman_integrator_.Initialize(
+        history_integrator_.CoefficientsOf(history_scheme));
+  }
+  prolongation_integrator_.Initialize(prolongation_scheme);
+}
+
+void Plugin::SetWisdomHolmanHistories(bool const enabled) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(enabled);
+  CHECK(!initializing_);
+  // The worker reads the flag.
+  if (history_integration_ != nullptr) {
+    FinishHistoryIntegration();
+  }
+  CheckpointCelestialHistories();
+  wisdom_holman_histories_ = enabled;
+}
+
+void Plugin::SetMultistepHistories(bool const enabled) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(enabled);
+  CHECK(!initializing_);
+  // The worker reads the flag.
+  if (history_integration_ != nullptr) {
+    FinishHistoryIntegration();
+  }
+  CheckpointCelestialHistories();
+  multistep_histories_ = enabled;
+}
+
+void Plugin::SetPredictionIntegrator(SPRKScheme const prediction_scheme) {
+  VLOG(1) << __FUNCTION__ << '\n'
+          << NAMED(static_cast<int>(prediction_scheme));
+  CHECK(!initializing_);
+  prediction_integrator_.Initialize(prediction_scheme);
+  parareal_prediction_integrator_.Initialize(
+      prediction_integrator_.CoefficientsOf(prediction_scheme));
+}
+
+void Plugin::SetGaussJacksonPredictions(bool const enabled) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(enabled);
+  CHECK(!initializing_);
+  gauss_jackson_predictions_ = enabled;
+}
+
+void Plugin::SetPararealPredictions(bool const enabled) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(enabled);
+  CHECK(!initializing_);
+  parareal_predictions_ = enabled;
+}
+
+RelativeDegreesOfFreedom<AliceSun> Plugin::VesselFromParent(
+    GUID const& vessel_guid) const {
+  CHECK(!initializing_);
+  return VesselFromParent(vessel_handle(vessel_guid));
+}
+
+RelativeDegreesOfFreedom<AliceSun> Plugin::VesselFromParent(
+    VesselHandle const vessel_handle) const {
+  CHECK(!initializing_);
+  VesselSlot const& slot = find_vessel_slot_or_die(vessel_handle);
+  GUID const& vessel_guid = *slot.guid;
+  not_null<Vessel const*> const vessel = slot.vessel;
+  CHECK(vessel->is_initialized()) << "Vessel with GUID " << vessel_guid
+                                  << " was not given an initial state";
+  RelativeDegreesOfFreedom<Barycentric> const barycentric_result =
+      vessel->prolongation().last().degrees_of_freedom() -
+      vessel->parent().prolongation().last().degrees_of_freedom();
+  RelativeDegreesOfFreedom<AliceSun> const result =
+      kSunLookingGlass(PlanetariumRotation()(barycentric_result));
+  VLOG(1) << "Vessel with GUID " << vessel_guid
+          << " is at parent degrees of freedom + " << barycentric_result
+          << " Barycentre (" << result << " AliceSun)";
+  return result;
+}
+
+RelativeDegreesOfFreedom<AliceSun> Plugin::CelestialFromParent(
+    Index const celestial_index) const {
+  CHECK(!initializing_);
+  auto const it = celestials_.find(celestial_index);
+  CHECK(it != celestials_.end()) << "No body at index " << celestial_index;
+  Celestial const& celestial = *it->second;
+  CHECK(celestial.has_parent())
+      << "Body at index " << celestial_index << " is the sun";
+  RelativeDegreesOfFreedom<Barycentric> const barycentric_result =
+      celestial.prolongation().last().degrees_of_freedom() -
+      celestial.parent().prolongation().last().degrees_of_freedom();
+  RelativeDegreesOfFreedom<AliceSun> const result =
+      kSunLookingGlass(PlanetariumRotation()(barycentric_result));
+  VLOG(1) << "Celestial at index " << celestial_index
+          << " is at parent degrees of freedom + " << barycentric_result
+          << " Barycentre (" << result << " AliceSun)";
+  return result;
+}
+
+RelativeDegreesOfFreedom<AliceSun> Plugin::VesselFromParentAt(
+    VesselHandle const vessel_handle,
+    Instant const& time) const {
+  CHECK(!initializing_);
+  VesselSlot const& slot = find_vessel_slot_or_die(vessel_handle);
+  not_null<Vessel const*> const vessel = slot.vessel;
+  CHECK(vessel->is_initialized()) << "Vessel with GUID " << *slot.guid
+                                  << " was not given an initial state";
+  // The prolongation of a vessel in the bubble skips its bubble histories.
+  vessel->MaterializeBubbleHistory();
+  RelativeDegreesOfFreedom<Barycentric> const barycentric_result =
+      EvaluateInLastStep(vessel->prolongation(), time) -
+      EvaluateInLastStep(vessel->parent().prolongation(), time);
+  return kSunLookingGlass(PlanetariumRotation()(barycentric_result));
+}
+
+RelativeDegreesOfFreedom<AliceSun> Plugin::CelestialFromParentAt(
+    Index const celestial_index,
+    Instant const& time) const {
+  CHECK(!initializing_);
+  auto const it = celestials_.find(celestial_index);
+  CHECK(it != celestials_.end()) << "No body at index " << celestial_index;
+  Celestial const& celestial = *it->second;
+  CHECK(celestial.has_parent())
+      << "Body at index " << celestial_index << " is the sun";
+  RelativeDegreesOfFreedom<Barycentric> const barycentric_result =
+      EvaluateInLastStep(celestial.prolongation(), time) -
+      EvaluateInLastStep(celestial.parent().prolongation(), time);
+  return kSunLookingGlass(PlanetariumRotation()(barycentric_result));
+}
+
+std::vector<RelativeDegreesOfFreedom<AliceSun>>
+Plugin::AllCelestialsFromParent() const {
+  CHECK(!initializing_);
+  Rotation<Barycentric, WorldSun> const& planetarium_rotation =
+      PlanetariumRotation();
+  std::vector<RelativeDegreesOfFreedom<AliceSun>> result;
+  result.reserve(celestials_.size() - 1);
+  for (auto const& index_celestial : celestials_) {
+    Celestial const& celestial = *index_celestial.second;
+    if (!celestial.has_parent()) {
+      continue;
+    }
+    result.push_back(kSunLookingGlass(planetarium_rotation(
+        celestial.prolongation().last().degrees_of_freedom() -
+        celestial.parent().prolongation().last().degrees_of_freedom())));
+  }
+  return result;
+}
+
+std::vector<not_null<Trajectory<Barycentric>*>> Plugin::PredictVessels(
+    std::vector<GUID> const& vessel_guids,
+    Instant const& tmax,
+    Time const& Δt) {
+  VLOG(1) << __FUNCTION__ << '\n'
+          << NAMED(vessel_guids) << '\n' << NAMED(tmax) << '\n' << NAMED(Δt);
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK(!initializing_);
+  CHECK_LT(current_time_, tmax);
+  NBodySystem<Barycentric>::Trajectories celestial_trajectories;
+  celestial_trajectories.reserve(celestials_.size());
+  for (auto const& pair : celestials_) {
+    not_null<std::unique_ptr<Celestial>> const& celestial = pair.second;
+    celestial_trajectories.push_back(celestial->mutable_prolongation());
+  }
+  // The celestials are not affected by the vessels: integrate them once for
+  // all the predictions.
+  Ephemeris<Barycentric> ephemeris(celestial_trajectories,
+                                   prediction_integrator_,
+                                   Δt_,
+                                   prediction_steps_per_series_,
+                                   prediction_series_degree_);
+  // The vessels are integrated relative to their parents, which are
+  // identified by their indices in the ephemeris.
+  std::map<MassiveBody const*, std::size_t> ephemeris_indices;
+  for (std::size_t i = 0; i < ephemeris.bodies().size(); ++i) {
+    ephemeris_indices[ephemeris.bodies()[i]] = i;
+  }
+  NBodySystem<Barycentric>::Trajectories predictions;
+  std::vector<std::size_t> parents;
+  predictions.reserve(vessel_guids.size());
+  parents.reserve(vessel_guids.size());
+  for (GUID const& vessel_guid : vessel_guids) {
+    not_null<std::unique_ptr<Vessel>> const& vessel =
+        find_vessel_by_guid_or_die(vessel_guid);
+    CHECK(vessel->is_initialized()) << "Vessel with GUID " << vessel_guid
+                                    << " was not given an initial state";
+    CHECK_EQ(current_time_, vessel->prolongation().last().time());
+    predictions.push_back(
+        vessel->mutable_prolongation()->NewFork(current_time_));
+    parents.push_back(ephemeris_indices.at(&vessel->parent().body()));
+  }
+  // The number of threads may have changed since the last prediction.
+  int const parareal_slices =
+      2 * (thread_pool_ == nullptr ? 1 : thread_pool_->number_of_threads());
+  parareal_prediction_integrator_.SetSlicing(parareal_slices,
+                                             kPararealTolerance,
+                                             parareal_slices);
+  parareal_prediction_integrator_.set_thread_pool(thread_pool_.get());
+  SymplecticIntegrator<Length, Speed> const& vessel_integrator =
+      gauss_jackson_predictions_
+          ? static_cast<SymplecticIntegrator<Length, Speed> const&>(
+                gauss_jackson_prediction_integrator_)
+          : parareal_predictions_
+                ? static_cast<SymplecticIntegrator<Length, Speed> const&>(
+                      parareal_prediction_integrator_)
+                : prediction_integrator_;
+  n_body_system_->IntegrateMasslessBodiesRelativeToParents(
+      vessel_integrator,
+      &ephemeris,
+      parents,
+      tmax,
+      Δt,
+      1,     // sampling_period
+      true,  // tmax_is_exact
+      predictions);
+  return predictions;
+}
+
+void Plugin::DeletePrediction(
+    GUID const& vessel_guid,
+    not_null<Trajectory<Barycentric>**> const prediction) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(vessel_guid);
+  not_null<std::unique_ptr<Vessel>> const& vessel =
+      find_vessel_by_guid_or_die(vessel_guid);
+  not_null<std::unique_ptr<Trajectory<Barycentric>>> detached =
+      vessel->mutable_prolongation()->DetachFork(prediction);
+  detached->PrepareForReclaim();
+  reclaimer_.Reclaim(
+      std::unique_ptr<Trajectory<Barycentric>>(detached.release()));
+}
+
+void Plugin::SetPredictionPriority(GUID const& vessel_guid,
+                                   PredictionPriority const priority) {
+  VLOG(1) << __FUNCTION__ << '\n'
+          << NAMED(vessel_guid) << '\n' << NAMED(static_cast<int>(priority));
+  find_vessel_by_guid_or_die(vessel_guid);
+  prediction_scheduler_.SetPriority(vessel_guid, priority);
+}
+
+void Plugin::SetBackgroundPredictionsPerFrame(int const count) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(count);
+  prediction_scheduler_.set_background_budget(count);
+}
+
+void Plugin::UpdatePredictions(Time const& length, Time const& Δt) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(length) << '\n' << NAMED(Δt);
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK(!initializing_);
+  // The keys of |vessels_| are sorted, as required by the scheduler.
+  std::vector<GUID> initialized_vessel_guids;
+  initialized_vessel_guids.reserve(vessels_.size());
+  for (auto const& pair : vessels_) {
+    if (pair.second->is_initialized()) {
+      initialized_vessel_guids.push_back(pair.first);
+    }
+  }
+  std::vector<GUID> const vessel_guids =
+      prediction_scheduler_.Schedule(initialized_vessel_guids);
+  if (vessel_guids.empty()) {
+    return;
+  }
+  std::vector<not_null<Trajectory<Barycentric>*>> const forks =
+      PredictVessels(vessel_guids, current_time_ + length, Δt);
+  for (std::size_t i = 0; i < vessel_guids.size(); ++i) {
+    GUID const& vessel_guid = vessel_guids[i];
+    Trajectory<Barycentric>* fork = forks[i];
+    auto prediction = make_not_null_unique<Trajectory<Barycentric>>(
+        fork->body<MasslessBody>());
+    for (auto it = fork->on_or_after(current_time_); !it.at_end(); ++it) {
+      prediction->Append(it.time(), it.degrees_of_freedom());
+    }
+    DeletePrediction(vessel_guid, &fork);
+    auto const it = scheduled_predictions_.find(vessel_guid);
+    if (it == scheduled_predictions_.end()) {
+      scheduled_predictions_.emplace(vessel_guid, std::move(prediction));
+    } else {
+      it->second->PrepareForReclaim();
+      reclaimer_.Reclaim(
+          std::unique_ptr<Trajectory<Barycentric>>(it->second.release()));
+      it->second = std::move(prediction);
+    }
+  }
+}
+
+Trajectory<Barycentric> const* Plugin::ScheduledPrediction(
+    GUID const& vessel_guid) const {
+  auto const it = scheduled_predictions_.find(vessel_guid);
+  if (it == scheduled_predictions_.end()) {
+    return nullptr;
+  }
+  return it->second.get();
+}
+
+void Plugin::CreateFlightPlan(GUID const& vessel_guid,
+                              Instant const& final_time,
+                              Time const& Δt) {
   VLOG(1) << __FUNCTION__ << '\n'
-          << NAMED(vessel_guid) << '\n' << NAMED(from_parent);
+          << NAMED(vessel_guid) << '\n' << NAMED(final_time) << '\n'
+          << NAMED(Δt);
   CHECK(!initializing_);
   not_null<std::unique_ptr<Vessel>> const& vessel =
       find_vessel_by_guid_or_die(vessel_guid);
-  CHECK(!vessel->is_initialized())
-      << "Vessel with GUID " << vessel_guid << " already has a trajectory";
-  LOG(INFO) << "Initial |{orbit.pos, orbit.vel}| for vessel with GUID "
-            << vessel_guid << ": " << from_parent;
-  RelativeDegreesOfFreedom<Barycentric> const relative =
-      PlanetariumRotation().Inverse()(
-          kSunLookingGlass.Inverse()(from_parent));
-  LOG(INFO) << "In barycentric coordinates: " << relative;
-  vessel->CreateProlongation(
-      current_time_,
-      vessel->parent().prolongation().last().degrees_of_freedom() + relative);
-  auto const inserted = unsynchronized_vessels_.emplace(vessel.get());
-  CHECK(inserted.second);
+  CHECK(vessel->is_initialized()) << "Vessel with GUID " << vessel_guid
+                                  << " was not given an initial state";
+  CHECK_EQ(current_time_, vessel->prolongation().last().time());
+  NBodySystem<Barycentric>::Trajectories celestial_trajectories;
+  celestial_trajectories.reserve(celestials_.size());
+  for (auto const& pair : celestials_) {
+    not_null<std::unique_ptr<Celestial>> const& celestial = pair.second;
+    celestial_trajectories.push_back(celestial->mutable_prolongation());
+  }
+  vessel->CreateFlightPlan(
+      final_time,
+      make_not_null_unique<Ephemeris<Barycentric>>(
+          celestial_trajectories,
+          prediction_integrator_,
+          Δt_,
+          prediction_steps_per_series_,
+          prediction_series_degree_),
+      prediction_integrator_,
+      Δt);
 }
 
-void Plugin::AdvanceTime(Instant const& t, Angle const& planetarium_rotation) {
+void Plugin::DeleteFlightPlan(GUID const& vessel_guid) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(vessel_guid);
+  std::unique_ptr<FlightPlan> flight_plan =
+      find_vessel_by_guid_or_die(vessel_guid)->DetachFlightPlan();
+  if (flight_plan != nullptr) {
+    flight_plan->PrepareForReclaim();
+  }
+  reclaimer_.Reclaim(std::move(flight_plan));
+}
+
+bool Plugin::HasFlightPlan(GUID const& vessel_guid) const {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(vessel_guid);
+  return find_vessel_by_guid_or_die(vessel_guid)->has_flight_plan();
+}
+
+not_null<FlightPlan*> Plugin::GetFlightPlan(GUID const& vessel_guid) const {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(vessel_guid);
+  return find_vessel_by_guid_or_die(vessel_guid)->mutable_flight_plan();
+}
+
+std::vector<VesselHandle> Plugin::VesselsWithinRadius(
+    GUID const& vessel_guid,
+    Length const& radius) const {
   VLOG(1) << __FUNCTION__ << '\n'
-          << NAMED(t) << '\n' << NAMED(planetarium_rotation);
-  CHECK(!initializing_);
-  CHECK_GT(t, current_time_);
-  CleanUpVessels();
-  bubble_->Prepare(PlanetariumRotation(), current_time_, t);
-  if (HistoryTime() + Δt_ < t) {
-    // The histories are far enough behind that we can advance them at least one
-    // step and reset the prolongations.
-    EvolveHistories(t);
-    // TODO(egg): I think |!bubble_->empty()| => |has_dirty_vessels()|.
-    if (has_unsynchronized_vessels() ||
-        has_dirty_vessels() ||
-        !bubble_->empty()) {
-      SynchronizeNewVesselsAndCleanDirtyVessels();
+          << NAMED(vessel_guid) << '\n' << NAMED(radius);
+  not_null<std::unique_ptr<Vessel>> const& vessel =
+      find_vessel_by_guid_or_die(vessel_guid);
+  CHECK(vessel->is_initialized()) << "Vessel with GUID " << vessel_guid
+                                  << " was not given an initial state";
+  VesselHandle const handle = vessel_handle(vessel_guid);
+  std::vector<VesselHandle> result;
+  for (auto const& value_and_distance : vessel_grid_.WithinRadius(
+           vessel->prolongation().last().degrees_of_freedom().position(),
+           radius)) {
+    if (value_and_distance.first != handle) {
+      result.push_back(value_and_distance.first);
     }
-    ResetProlongations();
   }
-  EvolveProlongationsAndBubble(t);
-  VLOG(1) << "Time has been advanced" << '\n'
-          << "from : " << current_time_ << '\n'
-          << "to   : " << t;
-  current_time_ = t;
-  planetarium_rotation_ = planetarium_rotation;
+  return result;
 }
 
-RelativeDegreesOfFreedom<AliceSun> Plugin::VesselFromParent(
-    GUID const& vessel_guid) const {
-  CHECK(!initializing_);
+bool Plugin::ClosestVessel(GUID const& vessel_guid,
+                           not_null<VesselHandle*> const closest,
+                           not_null<Length*> const distance) const {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(vessel_guid);
   not_null<std::unique_ptr<Vessel>> const& vessel =
       find_vessel_by_guid_or_die(vessel_guid);
   CHECK(vessel->is_initialized()) << "Vessel with GUID " << vessel_guid
                                   << " was not given an initial state";
-  RelativeDegreesOfFreedom<Barycentric> const barycentric_result =
-      vessel->prolongation().last().degrees_of_freedom() -
-      vessel->parent().prolongation().last().degrees_of_freedom();
-  RelativeDegreesOfFreedom<AliceSun> const result =
-      kSunLookingGlass(PlanetariumRotation()(barycentric_result));
-  VLOG(1) << "Vessel with GUID " << vessel_guid
-          << " is at parent degrees of freedom + " << barycentric_result
-          << " Barycentre (" << result << " AliceSun)";
+  VesselHandle const handle = vessel_handle(vessel_guid);
+  // The vessel itself is one of the two nearest, unless it was inserted after
+  // the grid was built.
+  for (auto const& value_and_distance : vessel_grid_.Nearest(
+           vessel->prolongation().last().degrees_of_freedom().position(),
+           2)) {
+    if (value_and_distance.first != handle) {
+      *closest = value_and_distance.first;
+      *distance = value_and_distance.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<Index> Plugin::DominantBodies(
+    std::vector<GUID> const& vessel_guids) const {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(vessel_guids);
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK(!initializing_);
+  // The children of each celestial, with the radii of their spheres of
+  // influence and their positions at the current time.
+  struct Child {
+    Index index;
+    Length sphere_of_influence_radius;
+    Position<Barycentric> position;
+  };
+  std::map<Celestial const*, std::vector<Child>> children;
+  std::map<Celestial const*, Index> indices;
+  for (auto const& pair : celestials_) {
+    Celestial const& celestial = *pair.second;
+    indices[&celestial] = pair.first;
+    if (!celestial.has_parent()) {
+      continue;
+    }
+    Celestial const& parent = celestial.parent();
+    DegreesOfFreedom<Barycentric> const degrees_of_freedom =
+        celestial.prolongation().last().degrees_of_freedom();
+    RelativeDegreesOfFreedom<Barycentric> const relative =
+        degrees_of_freedom -
+        parent.prolongation().last().degrees_of_freedom();
+    GravitationalParameter const μ = celestial.body().gravitational_parameter();
+    GravitationalParameter const μ_parent =
+        parent.body().gravitational_parameter();
+    // The vis-viva equation.
+    Length const semimajor_axis =
+        1 / (2 / relative.displacement().Norm() -
+             InnerProduct(relative.velocity(), relative.velocity()) /
+                 (μ + μ_parent));
+    // For a hyperbolic orbit, the sphere of influence is unbounded.
+    Length const sphere_of_influence_radius =
+        semimajor_axis < Length()
+            ? std::numeric_limits<double>::infinity() * Metre
+            : semimajor_axis * std::pow(μ / μ_parent, 0.4);
+    children[&parent].push_back({pair.first,
+                                 sphere_of_influence_radius,
+                                 degrees_of_freedom.position()});
+  }
+
+  std::vector<Index> result;
+  result.reserve(vessel_guids.size());
+  for (GUID const& vessel_guid : vessel_guids) {
+    not_null<std::unique_ptr<Vessel>> const& vessel =
+        find_vessel_by_guid_or_die(vessel_guid);
+    CHECK(vessel->is_initialized()) << "Vessel with GUID " << vessel_guid
+                                    << " was not given an initial state";
+    Position<Barycentric> const position =
+        vessel->prolongation().last().degrees_of_freedom().position();
+    Celestial const* dominant = sun_;
+    Index dominant_index = indices.at(dominant);
+    for (;;) {
+      auto const it = children.find(dominant);
+      if (it == children.end()) {
+        break;
+      }
+      // The spheres of influence of siblings may overlap; prefer the child
+      // with the smallest one, which is the most specific.
+      Child const* next = nullptr;
+      for (Child const& child : it->second) {
+        if ((position - child.position).Norm() <
+                child.sphere_of_influence_radius &&
+            (next == nullptr || child.sphere_of_influence_radius <
+                                    next->sphere_of_influence_radius)) {
+          next = &child;
+        }
+      }
+      if (next == nullptr) {
+        break;
+      }
+      dominant_index = next->index;
+      dominant = celestials_.at(dominant_index).get();
+    }
+    result.push_back(dominant_index);
+  }
   return result;
 }
 
-RelativeDegreesOfFreedom<AliceSun> Plugin::CelestialFromParent(
-    Index const celestial_index) const {
+std::vector<Speed> Plugin::PorkchopPlot(Index const departure_index,
+                                        Index const arrival_index,
+                                        Instant const& departure_min,
+                                        Instant const& departure_max,
+                                        int const departure_points,
+                                        Instant const& arrival_min,
+                                        Instant const& arrival_max,
+                                        int const arrival_points,
+                                        Time const& Δt) const {
+  VLOG(1) << __FUNCTION__ << '\n'
+          << NAMED(departure_index) << '\n' << NAMED(arrival_index) << '\n'
+          << NAMED(departure_min) << '\n' << NAMED(departure_max) << '\n'
+          << NAMED(departure_points) << '\n' << NAMED(arrival_min) << '\n'
+          << NAMED(arrival_max) << '\n' << NAMED(arrival_points) << '\n'
+          << NAMED(Δt);
+  ScopedTraceEvent const trace_event(__FUNCTION__);
   CHECK(!initializing_);
-  auto const it = celestials_.find(celestial_index);
-  CHECK(it != celestials_.end()) << "No body at index " << celestial_index;
-  Celestial const& celestial = *it->second;
-  CHECK(celestial.has_parent())
-      << "Body at index " << celestial_index << " is the sun";
-  RelativeDegreesOfFreedom<Barycentric> const barycentric_result =
-      celestial.prolongation().last().degrees_of_freedom() -
-      celestial.parent().prolongation().last().degrees_of_freedom();
-  RelativeDegreesOfFreedom<AliceSun> const result =
-      kSunLookingGlass(PlanetariumRotation()(barycentric_result));
-  VLOG(1) << "Celestial at index " << celestial_index
-          << " is at parent degrees of freedom + " << barycentric_result
-          << " Barycentre (" << result << " AliceSun)";
+  CHECK_LE(current_time_, departure_min);
+  CHECK_LE(departure_min, departure_max);
+  CHECK_LT(departure_max, arrival_min);
+  CHECK_LE(arrival_min, arrival_max);
+  CHECK_LT(0, departure_points);
+  CHECK_LT(0, arrival_points);
+  auto const departure_it = celestials_.find(departure_index);
+  CHECK(departure_it != celestials_.end())
+      << "No body at index " << departure_index;
+  auto const arrival_it = celestials_.find(arrival_index);
+  CHECK(arrival_it != celestials_.end())
+      << "No body at index " << arrival_index;
+  Celestial const& departure = *departure_it->second;
+  Celestial const& arrival = *arrival_it->second;
+  CHECK(departure.has_parent());
+  CHECK_EQ(&departure.parent(), &arrival.parent());
+
+  NBodySystem<Barycentric>::Trajectories celestial_trajectories;
+  celestial_trajectories.reserve(celestials_.size());
+  for (auto const& pair : celestials_) {
+    not_null<std::unique_ptr<Celestial>> const& celestial = pair.second;
+    celestial_trajectories.push_back(celestial->mutable_prolongation());
+  }
+  Ephemeris<Barycentric> ephemeris(celestial_trajectories,
+                                   prediction_integrator_,
+                                   Δt,
+                                   prediction_steps_per_series_,
+                                   prediction_series_degree_);
+  ephemeris.Prolong(arrival_max);
+  std::size_t parent_ephemeris_index = 0;
+  std::size_t departure_ephemeris_index = 0;
+  std::size_t arrival_ephemeris_index = 0;
+  for (std::size_t i = 0; i < ephemeris.bodies().size(); ++i) {
+    MassiveBody const* const body = ephemeris.bodies()[i];
+    if (body == &departure.parent().body()) {
+      parent_ephemeris_index = i;
+    }
+    if (body == &departure.body()) {
+      departure_ephemeris_index = i;
+    }
+    if (body == &arrival.body()) {
+      arrival_ephemeris_index = i;
+    }
+  }
+  // The states of the celestials relative to the parent at the given time.
+  auto const relative_degrees_of_freedom =
+      [&ephemeris, parent_ephemeris_index](std::size_t const index,
+                                           Instant const& t) {
+    return RelativeDegreesOfFreedom<Barycentric>(
+        ephemeris.EvaluatePosition(index, t) -
+            ephemeris.EvaluatePosition(parent_ephemeris_index, t),
+        ephemeris.EvaluateVelocity(index, t) -
+            ephemeris.EvaluateVelocity(parent_ephemeris_index, t));
+  };
+  auto const grid_time = [](Instant const& min,
+                            Instant const& max,
+                            int const points,
+                            int const i) {
+    return points == 1 ? min : min + (max - min) * i / (points - 1);
+  };
+
+  // Each task computes a row, so that the states at departure are computed
+  // once per row.
+  LambertSolver<Barycentric> const solver(
+      departure.parent().body().gravitational_parameter());
+  std::vector<Speed> result(departure_points * arrival_points);
+  auto const compute_row = [&](int const i) {
+    Instant const departure_time =
+        grid_time(departure_min, departure_max, departure_points, i);
+    RelativeDegreesOfFreedom<Barycentric> const departure_state =
+        relative_degrees_of_freedom(departure_ephemeris_index, departure_time);
+    Bivector<double, Barycentric> const orientation = Normalize(
+        Wedge(departure_state.displacement(), departure_state.velocity()));
+    for (int j = 0; j < arrival_points; ++j) {
+      Instant const arrival_time =
+          grid_time(arrival_min, arrival_max, arrival_points, j);
+      RelativeDegreesOfFreedom<Barycentric> const arrival_state =
+          relative_degrees_of_freedom(arrival_ephemeris_index, arrival_time);
+      LambertTransfer<Barycentric> const transfer =
+          solver.Solve(departure_state.displacement(),
+                       arrival_state.displacement(),
+                       arrival_time - departure_time,
+                       orientation);
+      result[i * arrival_points + j] =
+          (transfer.initial_velocity - departure_state.velocity()).Norm() +
+          (transfer.final_velocity - arrival_state.velocity()).Norm();
+    }
+  };
+  if (thread_pool_ != nullptr && departure_points > 1) {
+    thread_pool_->ParallelFor(departure_points, compute_row);
+  } else {
+    for (int i = 0; i < departure_points; ++i) {
+      compute_row(i);
+    }
+  }
   return result;
 }
 
 RenderedTrajectory<World> Plugin::RenderedVesselTrajectory(
     GUID const& vessel_guid,
     not_null<Transforms<Barycentric, Rendering, Barycentric>*> const transforms,
-    Position<World> const& sun_world_position) const {
+    Position<World> const& sun_world_position,
+    Length const& tolerance,
+    Instant const& begin) const {
+  return std::move(RenderedVesselTrajectories({vessel_guid},
+                                              transforms,
+                                              sun_world_position,
+                                              tolerance,
+                                              begin).front());
+}
+
+std::vector<RenderedTrajectory<World>> Plugin::RenderedVesselTrajectories(
+    std::vector<GUID> const& vessel_guids,
+    not_null<Transforms<Barycentric, Rendering, Barycentric>*> const transforms,
+    Position<World> const& sun_world_position,
+    Length const& tolerance,
+    Instant const& begin) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  ScopedAllocationCounter const allocation_counter(
+      profiling_ ? &profile_.render_allocations : nullptr);
+  if (profiling_) {
+    ++profile_.render_calls;
+  }
   CHECK(!initializing_);
   auto const to_world =
       AffineMap<Barycentric, World, Length, Rotation>(
           sun_->prolongation().last().degrees_of_freedom().position(),
           sun_world_position,
-          Rotation<WorldSun, World>::Identity() * PlanetariumRotation());
+          barycentric_to_world_);
+
+  // The apparent histories are computed sequentially, since the first
+  // transform updates the cache of |transforms|.  The second transform is
+  // evaluated once for all the vessels.
+  std::vector<std::vector<Position<Barycentric>>> barycentric_positions;
+  barycentric_positions.reserve(vessel_guids.size());
+  transforms->BeginSecondPass();
+  for (GUID const& vessel_guid : vessel_guids) {
+    barycentric_positions.push_back(
+        ApparentHistory(vessel_guid, transforms, tolerance, begin));
+  }
+  transforms->EndSecondPass();
+
+  // The mapping to |World| and the simplification of the different vessels
+  // are independent.
+  std::vector<RenderedTrajectory<World>> result(vessel_guids.size());
+  auto const render = [&barycentric_positions, &result, &to_world, tolerance](
+      int const i) {
+    std::vector<Position<World>> world_positions =
+        to_world(barycentric_positions[i]);
+    if (tolerance > Length()) {
+      Simplify(tolerance, &world_positions);
+    }
+    for (std::size_t j = 1; j < world_positions.size(); ++j) {
+      result[i].emplace_back(world_positions[j - 1], world_positions[j]);
+    }
+    VLOG(1) << "Returning a " << result[i].size() << "-segment trajectory";
+  };
+  int const size = static_cast<int>(vessel_guids.size());
+  if (thread_pool_ != nullptr && size > 1) {
+    thread_pool_->ParallelFor(size, render);
+  } else {
+    for (int i = 0; i < size; ++i) {
+      render(i);
+    }
+  }
+  return result;
+}
+
+std::vector<Position<Barycentric>> Plugin::ApparentHistory(
+    GUID const& vessel_guid,
+    not_null<Transforms<Barycentric, Rendering, Barycentric>*> const transforms,
+    Length const& tolerance,
+    Instant const& begin) const {
   not_null<std::unique_ptr<Vessel>> const& vessel =
       find_vessel_by_guid_or_die(vessel_guid);
   CHECK(vessel->is_initialized());
   VLOG(1) << "Rendering a trajectory for the vessel with GUID " << vessel_guid;
-  RenderedTrajectory<World> result;
+  std::vector<Position<Barycentric>> barycentric_positions;
   if (!vessel->is_synchronized()) {
     // TODO(egg): We render neither unsynchronized histories nor prolongations
     // at the moment.
     VLOG(1) << "Returning an empty trajectory";
-    return result;
+    return barycentric_positions;
   }
 
-  // Compute the apparent trajectory using the given |transforms|.
-  Trajectory<Barycentric> const& actual_trajectory = vessel->history();
-
-  // First build the trajectory resulting from the first transform.
-  Trajectory<Rendering> intermediate_trajectory(actual_trajectory.body<Body>());
-  for (auto actual_it = transforms->first(actual_trajectory);
-       !actual_it.at_end();
-       ++actual_it) {
-    intermediate_trajectory.Append(actual_it.time(),
-                                   actual_it.degrees_of_freedom());
-  }
-
-  // Then build the apparent trajectory using the second transform.
-  auto apparent_trajectory = make_not_null_unique<Trajectory<Barycentric>>(
-                                 actual_trajectory.body<Body>());
-  for (auto intermediate_it = transforms->second(intermediate_trajectory);
-       !intermediate_it.at_end();
-       ++intermediate_it) {
-    apparent_trajectory->Append(intermediate_it.time(),
-                                intermediate_it.degrees_of_freedom());
+  // Compute the apparent trajectory using the given |transforms|.  The first
+  // transform is cached by |transforms|, so only the points appended to the
+  // history since the last call are actually transformed.  Both transforms are
+  // applied in a single pass without building intermediate trajectories.  When
+  // the history has a level of detail within |tolerance|, the coarsest such
+  // level is rendered instead of the full history.  Its tolerance holds in
+  // |Barycentric|, but the transforms are nearly affine over the span of a
+  // segment.
+  auto const sink = [&barycentric_positions](
+      Instant const& time,
+      DegreesOfFreedom<Barycentric> const& degrees_of_freedom) {
+    barycentric_positions.push_back(degrees_of_freedom.position());
+  };
+  Trajectory<Barycentric> const& history = vessel->history();
+  int level = history.number_of_levels_of_detail() - 1;
+  while (level >= 0 && history.level_of_detail_tolerance(level) > tolerance) {
+    --level;
   }
-
-  // Finally use the apparent trajectory to build the result.
-  auto initial_it = apparent_trajectory->first();
-  if (!initial_it.at_end()) {
-    for (auto final_it = initial_it;
-         ++final_it, !final_it.at_end();
-         initial_it = final_it) {
-      result.emplace_back(to_world(initial_it.degrees_of_freedom().position()),
-                          to_world(final_it.degrees_of_freedom().position()));
-    }
+  if (level >= 0) {
+    transforms->Apply(history, level, begin, sink);
+  } else {
+    transforms->Apply(history, begin, sink);
   }
-  VLOG(1) << "Returning a " << result.size() << "-segment trajectory";
-  return result;
+  return barycentric_positions;
 }
 
 not_null<std::unique_ptr<Transforms<Barycentric, Rendering, Barycentric>>>
@@ -577,11 +3319,52 @@ Plugin::NewBarycentricRotatingTransforms(Index const primary_index,
              secondary_prolongation);
 }
 
+not_null<Transforms<Barycentric, Rendering, Barycentric>*>
+Plugin::BodyCentredNonRotatingTransforms(Index const reference_body_index) {
+  VLOG(1) << __FUNCTION__ << '\n' << NAMED(reference_body_index);
+  TransformsKey const key(TransformsKind::kBodyCentredNonRotating,
+                          reference_body_index,
+                          reference_body_index);
+  auto it = owned_transforms_.find(key);
+  if (it == owned_transforms_.end()) {
+    it = owned_transforms_.emplace(
+             key,
+             NewBodyCentredNonRotatingTransforms(reference_body_index)).first;
+  }
+  return it->second.get();
+}
+
+not_null<Transforms<Barycentric, Rendering, Barycentric>*>
+Plugin::BarycentricRotatingTransforms(Index const primary_index,
+                                      Index const secondary_index) {
+  VLOG(1) << __FUNCTION__ << '\n'
+          << NAMED(primary_index) << '\n' << NAMED(secondary_index);
+  TransformsKey const key(TransformsKind::kBarycentricRotating,
+                          primary_index,
+                          secondary_index);
+  auto it = owned_transforms_.find(key);
+  if (it == owned_transforms_.end()) {
+    it = owned_transforms_.emplace(
+             key,
+             NewBarycentricRotatingTransforms(primary_index,
+                                              secondary_index)).first;
+  }
+  return it->second.get();
+}
+
 Position<World> Plugin::VesselWorldPosition(
     GUID const& vessel_guid,
     Position<World> const& parent_world_position) const {
-  not_null<std::unique_ptr<Vessel>> const& vessel =
-      find_vessel_by_guid_or_die(vessel_guid);
+  return VesselWorldPosition(vessel_handle(vessel_guid),
+                             parent_world_position);
+}
+
+Position<World> Plugin::VesselWorldPosition(
+    VesselHandle const vessel_handle,
+    Position<World> const& parent_world_position) const {
+  VesselSlot const& slot = find_vessel_slot_or_die(vessel_handle);
+  GUID const& vessel_guid = *slot.guid;
+  not_null<Vessel const*> const vessel = slot.vessel;
   CHECK(vessel->is_initialized()) << "Vessel with GUID " << vessel_guid
                                  << " was not given an initial state";
   auto const to_world =
@@ -589,21 +3372,47 @@ Position<World> Plugin::VesselWorldPosition(
           vessel->parent().
               prolongation().last().degrees_of_freedom().position(),
           parent_world_position,
-          Rotation<WorldSun, World>::Identity() * PlanetariumRotation());
+          barycentric_to_world_);
   return to_world(
       vessel->prolongation().last().degrees_of_freedom().position());
 }
 
+Position<World> Plugin::VesselWorldPositionAt(
+    VesselHandle const vessel_handle,
+    Position<World> const& parent_world_position,
+    Instant const& time) const {
+  VesselSlot const& slot = find_vessel_slot_or_die(vessel_handle);
+  not_null<Vessel const*> const vessel = slot.vessel;
+  CHECK(vessel->is_initialized()) << "Vessel with GUID " << *slot.guid
+                                 << " was not given an initial state";
+  vessel->MaterializeBubbleHistory();
+  auto const to_world =
+      AffineMap<Barycentric, World, Length, Rotation>(
+          EvaluateInLastStep(vessel->parent().prolongation(), time).position(),
+          parent_world_position,
+          barycentric_to_world_);
+  return to_world(EvaluateInLastStep(vessel->prolongation(), time).position());
+}
+
 Velocity<World> Plugin::VesselWorldVelocity(
       GUID const& vessel_guid,
       Velocity<World> const& parent_world_velocity,
       Time const& parent_rotation_period) const {
-  not_null<std::unique_ptr<Vessel>> const& vessel =
-      find_vessel_by_guid_or_die(vessel_guid);
+  return VesselWorldVelocity(vessel_handle(vessel_guid),
+                             parent_world_velocity,
+                             parent_rotation_period);
+}
+
+Velocity<World> Plugin::VesselWorldVelocity(
+      VesselHandle const vessel_handle,
+      Velocity<World> const& parent_world_velocity,
+      Time const& parent_rotation_period) const {
+  VesselSlot const& slot = find_vessel_slot_or_die(vessel_handle);
+  GUID const& vessel_guid = *slot.guid;
+  not_null<Vessel const*> const vessel = slot.vessel;
   CHECK(vessel->is_initialized()) << "Vessel with GUID " << vessel_guid
                                   << " was not given an initial state";
-  Rotation<Barycentric, World> to_world =
-      Rotation<WorldSun, World>::Identity() * PlanetariumRotation();
+  Rotation<Barycentric, World> const& to_world = barycentric_to_world_;
   RelativeDegreesOfFreedom<Barycentric> const relative_to_parent =
       vessel->prolongation().last().degrees_of_freedom() -
       vessel->parent().prolongation().last().degrees_of_freedom();
@@ -621,10 +3430,13 @@ void Plugin::AddVesselToNextPhysicsBubble(
     GUID const& vessel_guid,
     std::vector<IdAndOwnedPart> parts) {
   VLOG(1) << __FUNCTION__ << '\n' << NAMED(vessel_guid) << '\n' << NAMED(parts);
-  not_null<std::unique_ptr<Vessel>> const& vessel =
-      find_vessel_by_guid_or_die(vessel_guid);
-  dirty_vessels_.insert(vessel.get());
-  bubble_->AddVesselToNext(vessel.get(), std::move(parts));
+  VesselSlot& slot = vessel_slots_[vessel_slot_index(
+                                       vessel_handle(vessel_guid))];
+  if (!slot.dirty) {
+    slot.dirty = true;
+    ++number_of_dirty_vessels_;
+  }
+  bubble_->AddVesselToNext(slot.vessel, std::move(parts));
 }
 
 Displacement<World> Plugin::BubbleDisplacementCorrection(
@@ -652,107 +3464,617 @@ Velocity<World> Plugin::BubbleVelocityCorrection(
 
 void Plugin::WriteToMessage(
     not_null<serialization::Plugin*> const message) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  WriteToRecords(
+      [message](not_null<serialization::PluginRecord*> const record) {
+        switch (record->record_case()) {
+          case serialization::PluginRecord::kHeader: {
+            auto* const header = record->mutable_header();
+            message->mutable_planetarium_rotation()->Swap(
+                header->mutable_planetarium_rotation());
+            message->mutable_current_time()->Swap(
+                header->mutable_current_time());
+            message->set_sun_index(header->sun_index());
+            message->set_version(header->version());
+            if (header->has_ephemeris_file()) {
+              message->set_ephemeris_file(header->ephemeris_file());
+            }
+            if (header->has_celestial_history_checkpoints()) {
+              message->mutable_celestial_history_checkpoints()->Swap(
+                  header->mutable_celestial_history_checkpoints());
+            }
+            break;
+          }
+          case serialization::PluginRecord::kCelestial:
+            message->add_celestial()->Swap(record->mutable_celestial());
+            break;
+          case serialization::PluginRecord::kVessel:
+            message->add_vessel()->Swap(record->mutable_vessel());
+            break;
+          case serialization::PluginRecord::kBubble:
+            message->mutable_bubble()->Swap(record->mutable_bubble());
+            break;
+          default:
+            LOG(FATAL) << "Unexpected record " << record->record_case();
+        }
+      });
+}
+
+std::unique_ptr<Plugin> Plugin::ReadFromMessage(
+    serialization::Plugin const& message) {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  // Present |message| as the sequence of records written by
+  // |WriteToRecords|: the header, the celestials, the vessels and the bubble.
+  int next_record = 0;
+  return ReadFromRecords(
+      [&message, &next_record](
+          not_null<serialization::PluginRecord*> const record) {
+        int const celestials = message.celestial_size();
+        int const vessels = message.vessel_size();
+        int const i = next_record++;
+        record->Clear();
+        if (i == 0) {
+          auto* const header = record->mutable_header();
+          *header->mutable_planetarium_rotation() =
+              message.planetarium_rotation();
+          *header->mutable_current_time() = message.current_time();
+          header->set_sun_index(message.sun_index());
+          header->set_version(message.version());
+          if (message.has_ephemeris_file()) {
+            header->set_ephemeris_file(message.ephemeris_file());
+          }
+          if (message.has_celestial_history_checkpoints()) {
+            *header->mutable_celestial_history_checkpoints() =
+                message.celestial_history_checkpoints();
+          }
+        } else if (i <= celestials) {
+          *record->mutable_celestial() = message.celestial(i - 1);
+        } else if (i <= celestials + vessels) {
+          *record->mutable_vessel() = message.vessel(i - 1 - celestials);
+        } else if (i == celestials + vessels + 1) {
+          *record->mutable_bubble() = message.bubble();
+        } else {
+          return false;
+        }
+        return true;
+      });
+}
+
+void Plugin::WriteToRecords(
+    std::function<void(not_null<serialization::PluginRecord*> const record)>
+        const& sink) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  WriteRecords(nullptr /*since*/, true /*compress*/, sink);
+}
+
+void Plugin::WriteToUncompressedRecords(
+    std::function<void(not_null<serialization::PluginRecord*> const record)>
+        const& sink) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  WriteRecords(nullptr /*since*/, false /*compress*/, sink);
+}
+
+void Plugin::WriteIncrementToRecords(
+    Instant const& since,
+    std::function<void(not_null<serialization::PluginRecord*> const record)>
+        const& sink) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  WriteRecords(&since, true /*compress*/, sink);
+}
+
+void Plugin::WriteRecords(
+    Instant const* const since,
+    bool const compress,
+    std::function<void(not_null<serialization::PluginRecord*> const record)>
+        const& sink) const {
   CHECK(!initializing_);
+  if (since != nullptr) {
+    CHECK_LE(*since, HistoryTime());
+  }
   std::map<not_null<Celestial const*>, Index const> celestial_to_index;
   for (auto const& index_celestial : celestials_) {
     celestial_to_index.emplace(index_celestial.second.get(),
                                index_celestial.first);
   }
+  auto const emit = [compress, &sink](
+      not_null<serialization::PluginRecord*> const record) {
+    if (compress) {
+      CompressRecord(record);
+    }
+    sink(record);
+  };
+  // Each record is built on its own arena, which is freed once the record has
+  // been passed to |sink|.
+  {
+    ArenaRecord const record;
+    auto* const header = record.get()->mutable_header();
+    planetarium_rotation_.WriteToMessage(
+        header->mutable_planetarium_rotation());
+    current_time_.WriteToMessage(header->mutable_current_time());
+    auto const sun_it = celestial_to_index.find(sun_);
+    CHECK(sun_it != celestial_to_index.end());
+    Index const sun_index = sun_it->second;
+    header->set_sun_index(sun_index);
+    header->set_version(kSerializationVersion);
+    HistoryTime().WriteToMessage(header->mutable_history_time());
+    if (since != nullptr) {
+      since->WriteToMessage(header->mutable_increment_since());
+    }
+    if (ephemeris_file_ != nullptr) {
+      header->set_ephemeris_file(ephemeris_filename_);
+    }
+    if (steps_between_celestial_history_checkpoints_ != 0 ||
+        !celestial_history_runs_.empty()) {
+      auto* const checkpoints =
+          header->mutable_celestial_history_checkpoints();
+      checkpoints->set_steps_between_checkpoints(
+          steps_between_celestial_history_checkpoints_);
+      {
+        std::lock_guard<std::mutex> l(celestial_history_segments_lock_);
+        checkpoints->set_cached_segments(cached_celestial_history_segments_);
+      }
+      for (auto const& pair : celestial_history_runs_) {
+        auto* const run = checkpoints->add_run();
+        pair.first.WriteToMessage(run->mutable_first_time());
+        pair.second.WriteToMessage(run->mutable_step());
+      }
+      last_celestial_history_checkpoint_.WriteToMessage(
+          checkpoints->mutable_last_checkpoint());
+      celestial_history_checkpointed_until_.WriteToMessage(
+          checkpoints->mutable_checkpointed_until());
+    }
+    emit(record.get());
+  }
+
   for (auto const& index_celestial : celestials_) {
     Index const index = index_celestial.first;
     not_null<Celestial const*> const celestial = index_celestial.second.get();
-    auto const celestial_message = message->add_celestial();
+    ArenaRecord const record;
+    auto const celestial_message = record.get()->mutable_celestial();
     celestial_message->set_index(index);
-    celestial->WriteToMessage(celestial_message->mutable_celestial());
+    if (since == nullptr) {
+      celestial->WriteToMessage(celestial_message->mutable_celestial());
+    } else {
+      celestial->WriteIncrementToMessage(
+          *since,
+          celestial_message->mutable_celestial());
+    }
     if (celestial->has_parent()) {
       auto const it = celestial_to_index.find(&celestial->parent());
       CHECK(it != celestial_to_index.end());
       Index const parent_index = it->second;
       celestial_message->set_parent_index(parent_index);
     }
+    emit(record.get());
   }
+
+  // The records of the vessels are independent, so they are built, and
+  // compressed, in parallel if there is a thread pool, and passed to |sink| in
+  // the order of |vessels_|.
   std::map<not_null<Vessel const*>, GUID const> vessel_to_guid;
+  std::vector<std::pair<GUID const*, not_null<Vessel const*>>> guids_vessels;
   for (auto const& guid_vessel : vessels_) {
-    std::string const& guid = guid_vessel.first;
-    not_null<Vessel*> const vessel = guid_vessel.second.get();
-    vessel_to_guid.emplace(vessel, guid);
-    auto* const vessel_message = message->add_vessel();
+    vessel_to_guid.emplace(guid_vessel.second.get(), guid_vessel.first);
+    guids_vessels.emplace_back(&guid_vessel.first, guid_vessel.second.get());
+  }
+  auto const write_vessel = [since, compress, &celestial_to_index, this](
+      GUID const& guid,
+      not_null<Vessel const*> const vessel,
+      not_null<serialization::PluginRecord*> const record) {
+    auto* const vessel_message = record->mutable_vessel();
     vessel_message->set_guid(guid);
-    vessel->WriteToMessage(vessel_message->mutable_vessel());
+    if (since == nullptr) {
+      vessel->WriteToMessage(vessel_message->mutable_vessel());
+    } else {
+      vessel->WriteIncrementToMessage(*since,
+                                      vessel_message->mutable_vessel());
+    }
     auto const it = celestial_to_index.find(&vessel->parent());
     CHECK(it != celestial_to_index.end());
     Index const parent_index = it->second;
     vessel_message->set_parent_index(parent_index);
-    vessel_message->set_dirty(is_dirty(vessel));
+    vessel_message->set_dirty(is_dirty(guid));
+    if (compress) {
+      CompressRecord(record);
+    }
+  };
+  int const number_of_vessels = guids_vessels.size();
+  int const batch_size =
+      thread_pool_ == nullptr ? 1 : 2 * thread_pool_->number_of_threads();
+  for (int first = 0; first < number_of_vessels; first += batch_size) {
+    int const size = std::min(batch_size, number_of_vessels - first);
+    if (size == 1) {
+      ArenaRecord const record;
+      write_vessel(*guids_vessels[first].first,
+                   guids_vessels[first].second,
+                   record.get());
+      sink(record.get());
+      continue;
+    }
+    // Materializing the bubble histories splices trajectories, which notifies
+    // their observers, e.g., the |Transforms|, which are shared by the
+    // vessels.  It is done here so that the parallel writes only read.
+    for (int i = first; i < first + size; ++i) {
+      guids_vessels[i].second->MaterializeBubbleHistory();
+    }
+    std::vector<std::unique_ptr<ArenaRecord const>> records(size);
+    thread_pool_->ParallelFor(
+        size,
+        [first, &guids_vessels, &records, &write_vessel](int const i) {
+          records[i] = std::make_unique<ArenaRecord const>();
+          write_vessel(*guids_vessels[first + i].first,
+                       guids_vessels[first + i].second,
+                       records[i]->get());
+        });
+    for (auto& record : records) {
+      sink(record->get());
+      record.reset();
+    }
   }
 
+  ArenaRecord const record;
+  auto* const bubble_message = record.get()->mutable_bubble();
   bubble_->WriteToMessage(
       [&vessel_to_guid](not_null<Vessel const*> const vessel) -> GUID {
         auto const it = vessel_to_guid.find(vessel);
         CHECK(it != vessel_to_guid.end());
         return it->second;
       },
-      message->mutable_bubble());
+      bubble_message);
+  emit(record.get());
+}
 
-  planetarium_rotation_.WriteToMessage(message->mutable_planetarium_rotation());
-  current_time_.WriteToMessage(message->mutable_current_time());
-  auto const it = celestial_to_index.find(sun_);
-  CHECK(it != celestial_to_index.end());
-  Index const sun_index = it->second;
-  message->set_sun_index(sun_index);
+void Plugin::CompressRecord(
+    not_null<serialization::PluginRecord*> const record) {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  // The timelines of the trajectories are compressed, see
+  // |kSerializationVersion|.
+  switch (record->record_case()) {
+    case serialization::PluginRecord::kHeader:
+      break;
+    case serialization::PluginRecord::kCelestial:
+      CompressColumns(record->mutable_celestial()->mutable_celestial()->
+                          mutable_history_and_prolongation()->
+                              mutable_history());
+      break;
+    case serialization::PluginRecord::kVessel: {
+      auto* const vessel_message = record->mutable_vessel()->mutable_vessel();
+      if (vessel_message->has_history_and_prolongation()) {
+        CompressColumns(vessel_message->mutable_history_and_prolongation()->
+                            mutable_history());
+      } else {
+        CompressColumns(vessel_message->mutable_owned_prolongation());
+      }
+      break;
+    }
+    case serialization::PluginRecord::kBubble:
+      if (record->bubble().has_current()) {
+        CompressColumns(record->mutable_bubble()->mutable_current()->
+                            mutable_centre_of_mass_trajectory());
+      }
+      break;
+    default:
+      LOG(FATAL) << "Unexpected record " << record->record_case();
+  }
 }
 
-std::unique_ptr<Plugin> Plugin::ReadFromMessage(
-    serialization::Plugin const& message) {
-  IndexToOwnedCelestial celestials;
-  for (auto const& celestial_message : message.celestial()) {
-    celestials.emplace(
-        celestial_message.index(),
-        Celestial::ReadFromMessage(celestial_message.celestial()));
-  }
-  for (auto const& celestial_message : message.celestial()) {
-    if (celestial_message.has_parent_index()) {
-      auto const it = celestials.find(celestial_message.index());
-      CHECK(it != celestials.end());
-      not_null<std::unique_ptr<Celestial>> const& celestial = it->second;
-      auto const parent_it = celestials.find(celestial_message.parent_index());
-      CHECK(parent_it != celestials.end());
-      not_null<Celestial const*> const parent = parent_it->second.get();
-      celestial->set_parent(parent);
+std::vector<serialization::PluginRecord> Plugin::CompactRecords(
+    std::vector<serialization::PluginRecord> const& base,
+    std::vector<serialization::PluginRecord> const& increment) {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK(!base.empty() && base.front().has_header()) << "No base header";
+  CHECK(!increment.empty() && increment.front().has_header())
+      << "No increment header";
+  auto const& base_header = base.front().header();
+  auto const& increment_header = increment.front().header();
+  CHECK(!base_header.has_increment_since())
+      << "The base must be compacted first";
+  CHECK(increment_header.has_increment_since()) << "Not an increment";
+  CHECK(base_header.has_history_time())
+      << "Base written by an older version of Principia";
+  CHECK_EQ(Instant::ReadFromMessage(base_header.history_time()),
+           Instant::ReadFromMessage(increment_header.increment_since()))
+      << "Increment of another base";
+
+  std::map<Index, serialization::Trajectory const*> base_celestial_histories;
+  std::map<GUID, serialization::Trajectory const*> base_vessel_histories;
+  for (auto const& record : base) {
+    if (record.has_celestial()) {
+      base_celestial_histories.emplace(
+          record.celestial().index(),
+          &record.celestial().celestial().history_and_prolongation().
+              history());
+    } else if (record.has_vessel() &&
+               record.vessel().vessel().has_history_and_prolongation()) {
+      base_vessel_histories.emplace(
+          record.vessel().guid(),
+          &record.vessel().vessel().history_and_prolongation().history());
+    }
+  }
+
+  // The structure, and all the state except the beginnings of the histories,
+  // come from |increment|.
+  std::vector<serialization::PluginRecord> result = increment;
+  result.front().mutable_header()->clear_increment_since();
+  for (auto& record : result) {
+    serialization::Trajectory* history = nullptr;
+    serialization::Trajectory const* base_history = nullptr;
+    if (record.has_celestial()) {
+      history = record.mutable_celestial()->mutable_celestial()->
+                    mutable_history_and_prolongation()->mutable_history();
+      auto const it = base_celestial_histories.find(record.celestial().index());
+      CHECK(it != base_celestial_histories.end())
+          << "No celestial " << record.celestial().index() << " in the base";
+      base_history = it->second;
+    } else if (record.has_vessel() &&
+               record.vessel().vessel().has_history_and_prolongation() &&
+               record.vessel().vessel().history_and_prolongation().history().
+                   has_increment_since()) {
+      history = record.mutable_vessel()->mutable_vessel()->
+                    mutable_history_and_prolongation()->mutable_history();
+      auto const it = base_vessel_histories.find(record.vessel().guid());
+      CHECK(it != base_vessel_histories.end())
+          << "No history for vessel " << record.vessel().guid()
+          << " in the base";
+      base_history = it->second;
+    } else {
+      continue;
     }
+    serialization::Trajectory compacted_history = *base_history;
+    Trajectory<Barycentric>::AppendIncrementToMessage(*history,
+                                                      &compacted_history);
+    history->Swap(&compacted_history);
+    CompressRecord(&record);
   }
+  return result;
+}
+
+std::unique_ptr<Plugin> Plugin::ReadFromRecords(
+    std::function<bool(not_null<serialization::PluginRecord*> const record)>
+        const& source) {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  serialization::PluginRecord record;
+  CHECK(source(&record)) << "No header record";
+  CHECK(record.has_header()) << "Unexpected record " << record.record_case();
+  serialization::PluginRecord::Header const header = record.header();
+  // The trajectories are self-describing, so all the versions up to the
+  // current one can be read.
+  CHECK_LE(header.version(), kSerializationVersion)
+      << "Save written by a more recent version of Principia";
+  CHECK(!header.has_increment_since())
+      << "An increment must be compacted with its base, see |CompactRecords|";
+
+  // The trajectories are decoded on a thread pool while the next records are
+  // read.  Each task fills its own element of |decoded_celestials| or
+  // |decoded_vessels|; the elements of a list are not moved by |push_back|.
+  // The celestials are all decoded before the first vessel, since a vessel
+  // points to its parent, and the vessels before the bubble.  The maps are
+  // built, and the parents linked, on the calling thread.
+  struct DecodedCelestial {
+    Index index;
+    std::unique_ptr<Index> parent_index;
+    std::unique_ptr<Celestial> celestial;
+  };
+  struct DecodedVessel {
+    GUID guid;
+    std::unique_ptr<Vessel> vessel;
+  };
+  std::list<DecodedCelestial> decoded_celestials;
+  std::list<DecodedVessel> decoded_vessels;
+  // Declared after the lists, so that it is destroyed, and its tasks
+  // completed, first.
+  ThreadPool thread_pool(
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+  std::vector<std::future<void>> celestials_decoded;
+  std::vector<std::future<void>> vessels_decoded;
+  bool celestials_complete = false;
+  bool vessels_complete = false;
+
+  IndexToOwnedCelestial celestials;
+  std::map<Index, Index> parent_indices;
   GUIDToOwnedVessel vessels;
-  std::set<not_null<Vessel*> const> dirty_vessels;
-  for (auto const& vessel_message : message.vessel()) {
-    auto const parent_it = celestials.find(vessel_message.parent_index());
+  std::set<GUID> dirty_vessels;
+  std::unique_ptr<PhysicsBubble> bubble;
+
+  auto const complete_celestials = [&celestials,
+                                    &celestials_complete,
+                                    &celestials_decoded,
+                                    &decoded_celestials,
+                                    &parent_indices]() {
+    if (celestials_complete) {
+      return;
+    }
+    celestials_complete = true;
+    for (auto& decoded : celestials_decoded) {
+      decoded.get();
+    }
+    for (auto& decoded : decoded_celestials) {
+      auto const inserted = celestials.emplace(
+          decoded.index, check_not_null(std::move(decoded.celestial)));
+      CHECK(inserted.second);
+      if (decoded.parent_index != nullptr) {
+        parent_indices.emplace(decoded.index, *decoded.parent_index);
+      }
+    }
+  };
+  auto const complete_vessels = [&vessels,
+                                 &vessels_complete,
+                                 &vessels_decoded,
+                                 &decoded_vessels]() {
+    if (vessels_complete) {
+      return;
+    }
+    vessels_complete = true;
+    for (auto& decoded : vessels_decoded) {
+      decoded.get();
+    }
+    for (auto& decoded : decoded_vessels) {
+      auto const inserted = vessels.emplace(
+          decoded.guid, check_not_null(std::move(decoded.vessel)));
+      CHECK(inserted.second);
+    }
+  };
+
+  for (;;) {
+    // Each record is parsed on its own arena, which is owned by the task that
+    // decodes it and freed when the task completes.
+    auto const arena_record = std::make_shared<ArenaRecord const>();
+    not_null<serialization::PluginRecord*> const owned_record =
+        arena_record->get();
+    if (!source(owned_record)) {
+      break;
+    }
+    switch (owned_record->record_case()) {
+      case serialization::PluginRecord::kCelestial: {
+        CHECK(!celestials_complete) << "Misplaced celestial";
+        auto const& celestial_message = owned_record->celestial();
+        decoded_celestials.push_back({celestial_message.index()});
+        if (celestial_message.has_parent_index()) {
+          decoded_celestials.back().parent_index =
+              std::make_unique<Index>(celestial_message.parent_index());
+        }
+        DecodedCelestial* const decoded = &decoded_celestials.back();
+        celestials_decoded.push_back(thread_pool.Add(
+            [decoded, arena_record]() {
+              decoded->celestial = Celestial::ReadFromMessage(
+                  arena_record->get()->celestial().celestial());
+            }));
+        break;
+      }
+      case serialization::PluginRecord::kVessel: {
+        CHECK(!vessels_complete) << "Misplaced vessel";
+        complete_celestials();
+        auto const& vessel_message = owned_record->vessel();
+        auto const parent_it = celestials.find(vessel_message.parent_index());
+        CHECK(parent_it != celestials.end());
+        not_null<Celestial const*> const parent = parent_it->second.get();
+        if (vessel_message.dirty()) {
+          dirty_vessels.emplace(vessel_message.guid());
+        }
+        decoded_vessels.push_back({vessel_message.guid()});
+        DecodedVessel* const decoded = &decoded_vessels.back();
+        vessels_decoded.push_back(thread_pool.Add(
+            [decoded, arena_record, parent]() {
+              decoded->vessel = Vessel::ReadFromMessage(
+                  arena_record->get()->vessel().vessel(), parent);
+            }));
+        break;
+      }
+      case serialization::PluginRecord::kBubble: {
+        CHECK(bubble == nullptr) << "Duplicate bubble";
+        complete_celestials();
+        complete_vessels();
+        bubble = PhysicsBubble::ReadFromMessage(
+            [&vessels](GUID guid) -> not_null<Vessel*> {
+              auto const it = vessels.find(guid);
+              CHECK(it != vessels.end());
+              return it->second.get();
+            },
+            owned_record->bubble());
+        break;
+      }
+      default:
+        LOG(FATAL) << "Unexpected record " << owned_record->record_case();
+    }
+  }
+  CHECK(bubble != nullptr) << "No bubble record";
+
+  for (auto const& index_parent_index : parent_indices) {
+    auto const it = celestials.find(index_parent_index.first);
+    CHECK(it != celestials.end());
+    not_null<std::unique_ptr<Celestial>> const& celestial = it->second;
+    auto const parent_it = celestials.find(index_parent_index.second);
     CHECK(parent_it != celestials.end());
     not_null<Celestial const*> const parent = parent_it->second.get();
-    not_null<std::unique_ptr<Vessel>> vessel =
-        Vessel::ReadFromMessage(vessel_message.vessel(), parent);
-    if (vessel_message.dirty()) {
-      dirty_vessels.emplace(vessel.get());
-    }
-    auto const inserted =
-        vessels.emplace(vessel_message.guid(), std::move(vessel));
-    CHECK(inserted.second);
-  }
-  not_null<std::unique_ptr<PhysicsBubble>> bubble =
-      PhysicsBubble::ReadFromMessage(
-          [&vessels](GUID guid) -> not_null<Vessel*> {
-            auto const it = vessels.find(guid);
-            CHECK(it != vessels.end());
-            return it->second.get();
-          },
-          message.bubble());
+    celestial->set_parent(parent);
+  }
   // Can't use |make_unique| here without implementation-dependent friendships.
-  return std::unique_ptr<Plugin>(
+  std::unique_ptr<Plugin> plugin(
       new Plugin(std::move(vessels),
                  std::move(celestials),
-                 std::move(dirty_vessels),
-                 std::move(bubble),
-                 Angle::ReadFromMessage(message.planetarium_rotation()),
-                 Instant::ReadFromMessage(message.current_time()),
-                 message.sun_index()));
+                 dirty_vessels,
+                 check_not_null(std::move(bubble)),
+                 Angle::ReadFromMessage(header.planetarium_rotation()),
+                 Instant::ReadFromMessage(header.current_time()),
+                 header.sun_index()));
+  // The histories of the celestials don't have the points that the file
+  // covers, it is required to evaluate their past.
+  if (header.has_ephemeris_file()) {
+    CHECK(plugin->LoadEphemerisFile(header.ephemeris_file()))
+        << "The celestials of this save are evaluated from "
+        << header.ephemeris_file() << ", which doesn't match them";
+  }
+  // The points between the checkpoints have not been serialized.
+  if (header.has_celestial_history_checkpoints()) {
+    auto const& checkpoints = header.celestial_history_checkpoints();
+    plugin->SetCelestialHistoryCheckpoints(
+        checkpoints.steps_between_checkpoints(),
+        checkpoints.cached_segments());
+    for (auto const& run : checkpoints.run()) {
+      plugin->celestial_history_runs_.emplace(
+          Instant::ReadFromMessage(run.first_time()),
+          Time::ReadFromMessage(run.step()));
+    }
+    plugin->last_celestial_history_checkpoint_ =
+        Instant::ReadFromMessage(checkpoints.last_checkpoint());
+    plugin->celestial_history_checkpointed_until_ =
+        Instant::ReadFromMessage(checkpoints.checkpointed_until());
+    plugin->SetCelestialHistoryGapEvaluators();
+  }
+  return plugin;
+}
+
+std::int64_t Plugin::SaveCheckpoint() {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  Checkpoint checkpoint;
+  checkpoint.id = checkpoints_->next_id++;
+  WriteToUncompressedRecords(
+      [&checkpoint](not_null<serialization::PluginRecord*> const record) {
+        checkpoint.records.emplace_back();
+        checkpoint.records.back().Swap(record);
+      });
+  std::deque<Checkpoint>& checkpoints = checkpoints_->checkpoints;
+  checkpoints.push_back(std::move(checkpoint));
+  if (static_cast<int>(checkpoints.size()) > kMaxCheckpoints) {
+    checkpoints.pop_front();
+  }
+  LOG(INFO) << "Saved checkpoint " << checkpoints.back().id << " at "
+            << current_time_;
+  return checkpoints.back().id;
+}
+
+bool Plugin::HasCheckpoint(std::int64_t const checkpoint_id) const {
+  for (auto const& checkpoint : checkpoints_->checkpoints) {
+    if (checkpoint.id == checkpoint_id) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::unique_ptr<Plugin> Plugin::RestoreCheckpoint(
+    std::int64_t const checkpoint_id) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  for (auto const& checkpoint : checkpoints_->checkpoints) {
+    if (checkpoint.id == checkpoint_id) {
+      // The records are copied since the checkpoint may be restored again.
+      auto it = checkpoint.records.cbegin();
+      std::unique_ptr<Plugin> plugin = ReadFromRecords(
+          [&checkpoint, &it](
+              not_null<serialization::PluginRecord*> const record) {
+            if (it == checkpoint.records.cend()) {
+              return false;
+            }
+            *record = *it++;
+            return true;
+          });
+      plugin->checkpoints_ = checkpoints_;
+      LOG(INFO) << "Restored checkpoint " << checkpoint_id;
+      return plugin;
+    }
+  }
+  LOG(FATAL) << "No checkpoint " << checkpoint_id;
+  base::noreturn();
 }
 
 }  // namespace ksp_plugin
@@ -1,21 +1,38 @@
 ﻿#pragma once
 
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include "base/allocation_tracker.hpp"
+#include "base/reclaimer.hpp"
+#include "base/thread_pool.hpp"
+#include "geometry/hash_grid.hpp"
 #include "geometry/named_quantities.hpp"
 #include "geometry/point.hpp"
 #include "gtest/gtest.h"
 #include "ksp_plugin/celestial.hpp"
 #include "ksp_plugin/frames.hpp"
+#include "ksp_plugin/kernel_tuning.hpp"
 #include "ksp_plugin/monostable.hpp"
 #include "ksp_plugin/physics_bubble.hpp"
+#include "ksp_plugin/prediction_scheduler.hpp"
 #include "ksp_plugin/vessel.hpp"
 #include "physics/body.hpp"
+#include "physics/ephemeris_file.hpp"
+#include "physics/trajectory_file.hpp"
+#include "physics/kepler_orbit.hpp"
+#include "physics/lambert_solver.hpp"
+#include "physics/massless_body.hpp"
 #include "physics/n_body_system.hpp"
 #include "physics/trajectory.hpp"
 #include "physics/transforms.hpp"
@@ -27,21 +44,48 @@
 namespace principia {
 namespace ksp_plugin {
 
+using base::AllocationCounts;
+using base::Reclaimer;
+using base::ThreadPool;
 using geometry::Displacement;
+using geometry::HashGrid;
 using geometry::Instant;
 using geometry::Point;
 using geometry::Rotation;
+using integrators::EmbeddedExplicitRungeKuttaNyströmIntegrator;
+using integrators::GaussJacksonIntegrator;
+using integrators::PararealIntegrator;
 using integrators::SPRKIntegrator;
+using integrators::SPRKScheme;
+using integrators::SymmetricLinearMultistepIntegrator;
+using integrators::SymplecticIntegrator;
+using integrators::WisdomHolmanIntegrator;
 using physics::Body;
+using physics::EphemerisFile;
+using physics::KeplerOrbit;
+using physics::LambertSolver;
+using physics::MasslessBody;
 using physics::NBodySystem;
+using physics::SynchronizedHistories;
 using physics::Trajectory;
+using physics::TrajectoryFile;
+using physics::TrajectoryFileWriter;
 using physics::Transforms;
 using quantities::Angle;
+using si::Day;
+using si::Kilo;
+using si::Metre;
+using si::Milli;
 using si::Second;
 
 // The GUID of a vessel, obtained by |v.id.ToString()| in C#. We use this as a
 // key in an |std::map|.
 using GUID = std::string;
+// A dense identifier of a vessel, which avoids the lookup of its |GUID|.  The
+// low 32 bits are the index of a slot in a table of vessels, the high 32 bits
+// are the number of times the slot has been reused, so that the use of the
+// handle of a vessel that has been removed is detected.
+using VesselHandle = std::int64_t;
 // The index of a body in |FlightGlobals.Bodies|, obtained by
 // |b.flightGlobalsIndex| in C#. We use this as a key in an |std::map|.
 using Index = int;
@@ -105,9 +149,57 @@ class Plugin {
     Index const parent_index,
     RelativeDegreesOfFreedom<AliceSun> const& from_parent);
 
+  // The arguments of |InsertCelestial| for one celestial body.
+  struct CelestialDescription {
+    Index celestial_index;
+    GravitationalParameter gravitational_parameter;
+    Index parent_index;
+    RelativeDegreesOfFreedom<AliceSun> from_parent;
+  };
+
+  // Inserts all the |celestials| in one pass, as if by |InsertCelestial|.  The
+  // parent of each celestial must either have been inserted or be in
+  // |celestials|; parents need not precede their children.  Must only be
+  // called during initialization.
+  virtual void InsertCelestials(
+      std::vector<CelestialDescription> const& celestials);
+
   // Ends initialization.
   virtual void EndInitialization();
 
+  // Maps the precomputed ephemeris of the celestials in the file |filename|,
+  // which must have been written by |WriteEphemerisFile|, e.g., for the stock
+  // system.  Returns true if the file describes the celestials of this plugin:
+  // it must have the same celestial indices and gravitational parameters, it
+  // must cover the first point of the histories of the celestials, and their
+  // states at that point and at |HistoryTime()|, if covered, must match it.
+  // From then on the histories of the celestials are evaluated from the file
+  // instead of being integrated, and the vessels are integrated in their
+  // field, for as long as the file covers the histories.  The points of the
+  // histories of the celestials that the file covers are not stored, their
+  // past is evaluated from the file, and the file is reloaded when the plugin
+  // is deserialized.  Returns false, and keeps the previous file, if any, or
+  // integrating the celestials, otherwise.  Must be called after
+  // initialization.
+  virtual bool LoadEphemerisFile(std::string const& filename);
+
+  // Integrates the celestials from |HistoryTime()| to |t_max| and writes their
+  // ephemeris to the file |filename|, as Chebyshev series of degree |degree|
+  // each fitted to |steps_per_series| steps of the histories, for
+  // |LoadEphemerisFile|.  The state of the plugin is not modified.  Must be
+  // called after initialization.
+  virtual void WriteEphemerisFile(std::string const& filename,
+                                  Instant const& t_max,
+                                  int const steps_per_series,
+                                  int const degree);
+
+  // Writes the points of the histories of the celestials to the file
+  // |filename|, see |TrajectoryFileWriter|, for offline analysis.  The bodies
+  // are identified by their celestial indices, and written in increasing
+  // order of the indices.  The points that are evaluated from the ephemeris
+  // file, if any, are not written.  Must be called after initialization.
+  virtual void WriteTrajectoryFile(std::string const& filename) const;
+
   // Sets the parent of the celestial body with index |celestial_index| to the
   // one with index |parent_index|. Both bodies must already have been
   // inserted. Must be called after initialization.
@@ -131,6 +223,23 @@ class Plugin {
   virtual bool InsertOrKeepVessel(GUID const& vessel_guid,
                                   Index const parent_index);
 
+  // Returns the handle of the vessel with GUID |vessel_guid|, which must have
+  // been inserted.  The handle may be passed instead of the GUID to the
+  // functions below that accept it until the vessel is removed by
+  // |AdvanceTime|.  Handles are not serialized.
+  virtual VesselHandle vessel_handle(GUID const& vessel_guid) const;
+
+  // Keeps the vessels denoted by |vessel_handles| during the next call to
+  // |AdvanceTime|, like |InsertOrKeepVessel| but without changing their
+  // parents, so that a frame in which no vessel is inserted and no parent
+  // changes needs a single call.  The handles must not be stale.
+  virtual void KeepVessels(std::vector<VesselHandle> const& vessel_handles);
+
+  // The vessel with GUID |vessel_guid|, which must have been inserted, is not
+  // kept anymore: it is removed by the next call to |AdvanceTime| unless it is
+  // kept again before that call.
+  virtual void RemoveVessel(GUID const& vessel_guid);
+
   // Set the position and velocity of the vessel with GUID |vessel_guid|
   // relative to its parent at current time. |SetVesselStateOffset| must only
   // be called once per vessel. Must be called after initialization.
@@ -141,6 +250,20 @@ class Plugin {
       GUID const& vessel_guid,
       RelativeDegreesOfFreedom<AliceSun> const& from_parent);
 
+  // Equivalent to calling |InsertOrKeepVessel| for each element of
+  // |vessel_guids| and |parent_indices|, followed, if the vessel was inserted,
+  // by |SetVesselStateOffset| with the corresponding element of
+  // |from_parents|; the offsets of the vessels that already exist are ignored.
+  // The three vectors must have the same size, and the GUIDs must be distinct.
+  // The parents are looked up once each, and the change of frame of the
+  // offsets is computed once.  The new vessels are synchronized together by
+  // the next call to |AdvanceTime|.  Returns the handles of the vessels, in
+  // the order of |vessel_guids|.  Must be called after initialization.
+  virtual std::vector<VesselHandle> InsertVessels(
+      std::vector<GUID> const& vessel_guids,
+      std::vector<Index> const& parent_indices,
+      std::vector<RelativeDegreesOfFreedom<AliceSun>> const& from_parents);
+
   // Simulates the system until instant |t|. All vessels that have not been
   // refreshed by calling |InsertOrKeepVessel| since the last call to
   // |AdvanceTime| will be removed.  Sets |current_time_| to |t|.
@@ -156,6 +279,316 @@ class Plugin {
   // degrees.
   virtual void AdvanceTime(Instant const& t, Angle const& planetarium_rotation);
 
+  // Same as |AdvanceTime|, but for a |t| far in the future, e.g., for a warp
+  // to the next manœuvre: the histories are integrated straight to |t|, in
+  // large chunks, and the prolongations are only reset and integrated once, at
+  // the end.  The physics bubble must be empty, i.e.,
+  // |AddVesselToNextPhysicsBubble| must not have been called since the last
+  // call to |AdvanceTime|.  If |progress| is not empty, it is called with the
+  // time reached by the histories after each chunk.
+  virtual void FastForward(
+      Instant const& t,
+      Angle const& planetarium_rotation,
+      std::function<void(Instant const& history_time)> const& progress);
+
+  // Uses a pool of |number_of_threads| threads for all the parallel
+  // computations of the plugin: the gravitational accelerations of the vessels
+  // and the vessel groups in |AdvanceTime|, the preparation of the bubble, the
+  // Parareal predictions, the porkchop plots and the rendering.  The pool is
+  // shared, so that these computations don't compete for the processors with
+  // each other, nor with the threads of the game, beyond |number_of_threads|.
+  // |number_of_threads| must be positive; 1, the default, means that the
+  // computations are serial.  The results do not depend on
+  // |number_of_threads|.
+  virtual void SetNumberOfThreads(int const number_of_threads);
+
+  // Applies the parameters of |configuration|, typically obtained from
+  // |ReadOrTuneKernelConfiguration|: calls |SetNumberOfThreads|, sets the
+  // chunking of the massless bodies of the integrations, and restricts the
+  // vector instruction sets of the kernels, for all the plugins of this
+  // process.  The results do not depend on |configuration|.
+  virtual void SetKernelConfiguration(
+      KernelConfiguration const& configuration);
+
+  // If |pipelined| is true, |AdvanceTime| integrates the histories on a worker
+  // thread: it starts the integration up to its argument |t| and returns after
+  // evolving the prolongations, and a later call to |AdvanceTime| commits the
+  // histories once the integration has completed.  In the meantime the states
+  // of the vessels and celestials come from their prolongations, which are
+  // then longer than |Δt_|.  The integration is pipelined only when there are
+  // no unsynchronized or dirty vessels and the physics bubble is empty, as is
+  // the case during time warp; otherwise |AdvanceTime| waits for the worker
+  // and proceeds synchronously.  The default is false.
+  virtual void SetPipelinedHistories(bool const pipelined);
+
+  // If |number_of_groups| is greater than 1 and there are several threads (see
+  // |SetNumberOfThreads|), the histories of the vessels that are integrated
+  // synchronously are split into |number_of_groups| groups of consecutive
+  // vessels, which are integrated concurrently on the threads.  Each group is
+  // integrated by its own |NBodySystem| with its own copies of the celestials,
+  // which thus are integrated once more per group.  Since the vessels affect
+  // neither the celestials nor one another, the results are bitwise identical
+  // to those of a single integration.  |number_of_groups| must be positive;
+  // 1, the default, means that all the vessels are integrated together.
+  virtual void SetNumberOfVesselGroups(int const number_of_groups);
+
+  // If |threshold| is positive, the histories of the vessels are propagated
+  // analytically as Kepler orbits around their |parent()| when the ratio of
+  // the tidal acceleration caused by the other celestials to the acceleration
+  // caused by the parent is below |threshold|, both at the beginning and at the
+  // end of the step.  The other vessels are integrated numerically.  A
+  // |threshold| of 0, the default, disables the analytical propagation.
+  virtual void SetKeplerianPerturbationThreshold(double const threshold);
+
+  // If |tolerance| is positive, the vessels that would be integrated
+  // numerically and that are within |tolerance| of one another and have the
+  // same |parent()|, e.g., the debris of a breakup, are grouped in clusters.
+  // Only the first vessel of each cluster, its reference, is integrated; the
+  // histories of the others are propagated by the linearised equations of
+  // their motion relative to the reference in the field of their parent.  A
+  // vessel that is farther than |tolerance| from the reference at the end of
+  // the step is instead integrated numerically from the beginning of the
+  // step.  The clusters are formed anew at each step.  A |tolerance| of 0, the
+  // default, disables the clusters.
+  virtual void SetClusterTolerance(Length const& tolerance);
+
+  // In pipelined mode, the worker integrates the histories up to
+  // |look_ahead| beyond the |t| given to |AdvanceTime|.  The points are
+  // committed to the histories as |AdvanceTime| reaches them, and the worker
+  // is restarted when less than half of |look_ahead| remains.  The points that
+  // have not been committed are discarded when |AdvanceTime| must proceed
+  // synchronously.  |look_ahead| must not be negative.  The default is 0.
+  virtual void SetHistoryLookAhead(Time const& look_ahead);
+
+  // If |steps| is positive, |AdvanceTime| evolves the histories by at most
+  // |steps| steps of |Δt_| when there are no unsynchronized or dirty vessels
+  // and the physics bubble is empty, as is the case during time warp, so that
+  // the cost of a call is bounded.  The histories may then lag behind the
+  // current time, and catch up in the subsequent calls; in the meantime the
+  // states of the vessels and celestials come from their prolongations, which
+  // are extended from their last point.  When the histories must be
+  // synchronous, they catch up in a single call.  |steps| must not be
+  // negative.  The default, 0, means that the histories are not limited.
+  virtual void SetHistoryStepBudget(int const steps);
+
+  // Limits the histories of the celestials and of the synchronized vessels to
+  // the points that are less than |maximum_age| older than the current time,
+  // if |maximum_age| is positive, and to their last |maximum_points| points, if
+  // |maximum_points| is positive.  |AdvanceTime| forgets the older points
+  // incrementally, at most |kForgottenPointsPerAdvanceTime| per call, so the
+  // histories may transiently exceed the limits.  The last point of a history,
+  // where its prolongation is forked, is never forgotten, and neither are the
+  // histories of the vessels that are deferred, until they are deserialized.
+  // The points forgotten since a save are kept by |CompactRecords|.  Neither
+  // argument may be negative; 0, the default for both, means no limit.
+  virtual void SetHistoryRetention(Time const& maximum_age,
+                                   std::int64_t const maximum_points);
+
+  // If |steps_between_checkpoints| is positive, from now on the histories of
+  // the celestials are not downsampled; instead, while they are integrated by
+  // the symplectic integrator with a constant step, only one of their points
+  // every |steps_between_checkpoints| steps or more is retained, as a
+  // checkpoint.  The evaluations between two points integrate the celestials
+  // again from the earlier one, with the current integrator and force model,
+  // so they are exact up to rounding unless these have changed; the
+  // |cached_segments| segments most recently integrated again are kept.  The
+  // gaps of more than |kMaximumCelestialHistorySegmentSteps| steps, e.g.,
+  // after a large time warp, are interpolated as before.  0 downsamples the
+  // histories again from now on; the existing checkpoints remain usable.
+  // |steps_between_checkpoints| must be between 0 and
+  // |kMaximumCelestialHistorySegmentSteps|, |cached_segments| must be
+  // positive.
+  virtual void SetCelestialHistoryCheckpoints(
+      int const steps_between_checkpoints,
+      int const cached_segments);
+
+  // If |tolerance| is positive, the accelerations of the vessels are computed
+  // with the hierarchical force model of |NBodySystem|, where the tree of the
+  // celestials is given by their |parent()|: the moons of a distant planet act
+  // through the barycentre of its system, with its quadrupole moment if
+  // |use_quadrupole| is true, as long as the estimated relative error does not
+  // exceed |tolerance|.  |tolerance| must be in [0, 1[; 0, the default, means
+  // that the forces are summed directly.  The celestials are unaffected.  Must
+  // be called after initialization.
+  virtual void SetHierarchicalForceModel(double const tolerance,
+                                         bool const use_quadrupole);
+
+  // If |timescale_fraction| is positive, the vessels whose free-fall time
+  // scale with respect to some celestial is shorter than the step of an
+  // integration divided by |timescale_fraction| are integrated with the
+  // regularised integrator of
+  // |NBodySystem::set_close_encounter_timescale_fraction| instead of the
+  // symplectic integrator, so that close flybys remain accurate with long
+  // steps.  |timescale_fraction| must not be negative; 0, the default, disables
+  // the regularisation.  Must be called after initialization.
+  virtual void SetCloseEncounterTimescaleFraction(
+      double const timescale_fraction);
+
+  // If |steps_per_orbit| is positive, the step of the histories is the
+  // shortest period of the osculating orbits of the celestials and vessels
+  // around their parents, divided by |steps_per_orbit| and clamped to
+  // [|minimum_step|, |maximum_step|]; the unbound orbits are ignored.
+  // Otherwise it is 10 s, the default.  The step is recomputed by
+  // |AdvanceTime| only when no integration of the histories is in progress on
+  // the worker, at which point all the histories end at |HistoryTime()|, so
+  // that each integration uses a constant step.  |steps_per_orbit| must not
+  // be negative, and |minimum_step| must be positive and not greater than
+  // |maximum_step|.
+  virtual void SetHistoryStepPolicy(int const steps_per_orbit,
+                                    Time const& minimum_step,
+                                    Time const& maximum_step);
+
+  // Selects the symplectic integrators used for the histories and for the
+  // prolongations of the vessels that are synchronized with the histories.  A
+  // lower order with fewer stages makes each step cheaper, at the expense of
+  // the accuracy.  The default is
+  // |SPRKScheme::kMcLachlanAtela1992Order5Optimal| for both.  A processed
+  // scheme only pays for its processor when a state is output, so it is
+  // cheapest for the integrations that only output their last state; the
+  // Wisdom-Holman integrator doesn't process, and keeps its scheme if
+  // |history_scheme| is processed.  Must be called after initialization.
+  virtual void SetSymplecticIntegrators(SPRKScheme const history_scheme,
+                                        SPRKScheme const prolongation_scheme);
+
+  // If |enabled| is true, the histories are integrated by the Wisdom-Holman
+  // integrator of |NBodySystem::IntegrateWisdomHolman|, with the scheme of the
+  // histories set by |SetSymplecticIntegrators|: the celestials are advanced
+  // along Kepler orbits in the Jacobi coordinates of the hierarchy given by
+  // their parents and only the interactions are integrated numerically, which
+  // is much more accurate for a given step.  The vessels move in straight
+  // lines between the kicks, so their accuracy is that of the leapfrog.  False
+  // by default.  Must be called after initialization.
+  virtual void SetWisdomHolmanHistories(bool const enabled);
+
+  // If |enabled| is true, the histories are integrated by the symmetric linear
+  // multistep method of order 8 of Quinlan and Tremaine, which makes a single
+  // evaluation of the forces per step instead of one per stage of the scheme
+  // set by |SetSymplecticIntegrators|.  Each integration starts with 7 steps
+  // of the order 5 optimal SPRK, so this only pays off for integrations that
+  // are much longer than 7 steps, e.g., when catching up or at high time
+  // warp.  Ignored if the Wisdom-Holman histories are enabled.  False by
+  // default.  Must be called after initialization.
+  virtual void SetMultistepHistories(bool const enabled);
+
+  // Selects the symplectic integrator used by |PredictVessels|, both for the
+  // celestials and for the vessels.  The predictions start from the states of
+  // the prolongations and are only used for rendering, so a low order, e.g.,
+  // |SPRKScheme::kMcLachlanAtela1992Order2Optimal|, may be used to predict far
+  // ahead cheaply without affecting the histories.  The default is
+  // |SPRKScheme::kMcLachlanAtela1992Order5Optimal|.  Must be called after
+  // initialization.
+  virtual void SetPredictionIntegrator(SPRKScheme const prediction_scheme);
+
+  // If |enabled| is true, |PredictVessels| integrates the vessels with the
+  // Gauss-Jackson method of order 8, which evaluates the forces twice per step
+  // instead of once per stage of the scheme set by |SetPredictionIntegrator|;
+  // the celestials are still integrated with that scheme.  Each prediction
+  // starts with 8 steps of the order 5 optimal SPRK, so this pays off for
+  // predictions over many steps, e.g., over several orbits.  False by default.
+  // Must be called after initialization.
+  virtual void SetGaussJacksonPredictions(bool const enabled);
+
+  // If |enabled| is true, |PredictVessels| integrates the vessels with the
+  // Parareal method, using the scheme set by |SetPredictionIntegrator| as the
+  // fine propagator and running its propagations on the threads set by
+  // |SetNumberOfThreads|.  The predictions are split into twice as many slices
+  // as there are threads, so this only pays off with several threads, and for
+  // predictions over many steps.  Ignored if the Gauss-Jackson predictions are
+  // enabled.  False by default.  Must be called after initialization.
+  virtual void SetPararealPredictions(bool const enabled);
+
+  // The wall-clock durations of the phases of |AdvanceTime|, and counters of
+  // the work done by its synchronous integrations, accumulated over the calls
+  // made while profiling is enabled.  The work done by the worker thread in
+  // pipelined mode is not counted.  The allocations are only counted if the
+  // plugin is built with |PRINCIPIA_TRACK_ALLOCATIONS|; they include those of
+  // all the threads, including the worker thread, during the calls.
+  struct Profile {
+    int advance_time_calls = 0;
+    Time clean_up_vessels;
+    Time prepare_bubble;
+    Time evolve_histories;
+    Time synchronization;
+    Time reset_prolongations;
+    Time evolve_prolongations_and_bubble;
+    // The evaluations of the forces on all the integrated bodies.
+    std::int64_t force_evaluations = 0;
+    // The steps of |Δt_| of the histories integrated by |EvolveHistories|.
+    std::int64_t history_steps = 0;
+    // The points appended to the trajectories by the integrations.
+    std::int64_t points_appended = 0;
+    // The segments of the histories of the celestials integrated again, see
+    // |SetCelestialHistoryCheckpoints|.
+    std::int64_t celestial_history_segments = 0;
+    // The histories propagated relative to the reference of their cluster, and
+    // those that had to be integrated instead, see |SetClusterTolerance|.
+    std::int64_t cluster_propagations = 0;
+    std::int64_t cluster_promotions = 0;
+    AllocationCounts advance_time_allocations;
+    // The calls to |RenderedVesselTrajectories|, and their allocations.
+    int render_calls = 0;
+    AllocationCounts render_allocations;
+  };
+
+  // Enables or disables the profiling of |AdvanceTime| and of the rendering.
+  // Enabling it resets the |profile()|.  When disabled, the default, the
+  // profiling costs nothing; when enabled, it costs a few reads of the clock
+  // per call.
+  virtual void SetProfiling(bool const enabled);
+
+  // Returns the profile accumulated since profiling was last enabled.
+  virtual Profile profile() const;
+
+  // The relative drifts of the total energy and of the total angular momentum
+  // of the celestials, with respect to their values at the first sample, over
+  // the samples taken while conservation monitoring is enabled.
+  struct ConservationDrift {
+    int samples = 0;
+    // At the last sample.
+    double energy = 0;
+    double angular_momentum = 0;
+    // The maxima over the samples.
+    double maximum_energy = 0;
+    double maximum_angular_momentum = 0;
+  };
+
+  // If |period| is positive, |AdvanceTime| samples the total energy and angular
+  // momentum of the celestials at the last points of their histories whenever
+  // the histories have advanced by at least |period| steps of |Δt_| since the
+  // previous sample.  This measures the error of the integration of the
+  // histories, see |SetSymplecticIntegrators|.  A sample costs O(n²) for n
+  // celestials, which is small compared to a step of the integration.
+  // Enabling or disabling the monitoring resets the |conservation_drift()|.
+  // |period| must not be negative; 0, the default, disables the monitoring.
+  virtual void SetConservationMonitoring(int const period);
+
+  // Returns the drift measured since conservation monitoring was last enabled.
+  virtual ConservationDrift conservation_drift() const;
+
+  // An estimate of the heap and object memory, in bytes, used by the plugin.
+  // The trajectories are counted with their forks, recursively.  The histories
+  // being integrated by the worker thread in pipelined mode are not counted, as
+  // the worker owns them; neither are the |Transforms|, including those owned
+  // by the plugin, see |Transforms::MemoryUsage|.
+  struct MemoryUsage {
+    std::int64_t celestials = 0;
+    std::int64_t vessels = 0;
+    std::int64_t bubble = 0;
+  };
+
+  // Returns the memory used by all the celestials, all the vessels and the
+  // physics bubble.  The segments cached by |SetCelestialHistoryCheckpoints|
+  // are counted with the celestials.
+  virtual MemoryUsage memory_usage() const;
+
+  // Returns the memory used by the vessel with GUID |vessel_guid|, which must
+  // be known.
+  virtual std::int64_t VesselMemoryUsage(GUID const& vessel_guid) const;
+
+  // Returns the memory used by the celestial with index |celestial_index|,
+  // which must be known.
+  virtual std::int64_t CelestialMemoryUsage(Index const celestial_index) const;
+
   // Returns the displacement and velocity of the vessel with GUID |vessel_guid|
   // relative to its parent at current time. For a KSP |Vessel| |v|, the
   // argument corresponds to  |v.id.ToString()|, the return value to
@@ -164,6 +597,8 @@ class Plugin {
   // be called after initialization.
   virtual RelativeDegreesOfFreedom<AliceSun> VesselFromParent(
       GUID const& vessel_guid) const;
+  virtual RelativeDegreesOfFreedom<AliceSun> VesselFromParent(
+      VesselHandle const vessel_handle) const;
 
   // Returns the displacement and velocity of the celestial at index
   // |celestial_index| relative to its parent at current time. For a KSP
@@ -174,16 +609,216 @@ class Plugin {
   virtual RelativeDegreesOfFreedom<AliceSun> CelestialFromParent(
       Index const celestial_index) const;
 
+  // Same as |VesselFromParent| and |CelestialFromParent|, but at |time|, which
+  // must be between the times before and after the last call to
+  // |AdvanceTime|, e.g., for rendering frames more often than |AdvanceTime| is
+  // called.  The degrees of freedom are obtained by cubic Hermite interpolation
+  // of the prolongations, without integrating.  A vessel whose prolongation
+  // starts after |time| is at the first point of its prolongation.  The
+  // current planetarium rotation is used.
+  virtual RelativeDegreesOfFreedom<AliceSun> VesselFromParentAt(
+      VesselHandle const vessel_handle,
+      Instant const& time) const;
+  virtual RelativeDegreesOfFreedom<AliceSun> CelestialFromParentAt(
+      Index const celestial_index,
+      Instant const& time) const;
+
+  // Returns the result of |CelestialFromParent| for all the celestials other
+  // than the sun, in increasing order of index, computed in a single pass.
+  // Must be called after initialization.
+  virtual std::vector<RelativeDegreesOfFreedom<AliceSun>>
+  AllCelestialsFromParent() const;
+
+  // The state of a vessel or of a celestial in the |StateTable|, in SI units.
+  // The layout is standard, and mirrored by the adapter, which reads it
+  // directly from native memory.
+  struct PublishedState {
+    // For a vessel, its handle; for a celestial, its index.  -1 if there is no
+    // vessel or celestial with this entry, in which case the other fields are
+    // unspecified.
+    std::int64_t handle;
+    // The displacement and velocity relative to the parent, as returned by
+    // |VesselFromParent| and |CelestialFromParent|.  Zero for the sun.
+    double from_parent[6];
+    // The same in |World| axes: the world position is the world position of
+    // the parent plus |world_displacement|, as computed by
+    // |VesselWorldPosition|.  The world velocity is the world velocity of the
+    // parent plus |world_velocity| plus the cross product of the angular
+    // velocity of the parent around |StateTable::world_rotation_axis| with
+    // |world_displacement|, as computed by |VesselWorldVelocity|.
+    double world_displacement[3];
+    double world_velocity[3];
+  };
+
+  // The states of the vessels and celestials, published by |AdvanceTime| for
+  // the adapter to read without calling into the plugin.  The table stays at
+  // the same address for the lifetime of the plugin, but its arrays may move
+  // when it is published, so the pointers must be read anew each time.  The
+  // table is written without synchronization: it must only be read on the
+  // thread that calls |AdvanceTime|, between calls.
+  struct StateTable {
+    // Incremented by each publication, 0 until the first one, so that the
+    // reader can tell whether the states changed.
+    std::int64_t version;
+    // |current_time()| in seconds since |Instant()|.
+    double time;
+    // The |World| direction of the axis of rotation of the celestials.
+    double world_rotation_axis[3];
+    // The vessels are indexed by the low 32 bits of their handles, the
+    // celestials by their indices.
+    std::int32_t number_of_vessels;
+    std::int32_t number_of_celestials;
+    PublishedState const* vessels;
+    PublishedState const* celestials;
+  };
+
+  // Returns the table of the states published by the last |AdvanceTime|.
+  virtual StateTable const& state_table() const;
+
   // Returns a polygon in |World| space depicting the trajectory of the vessel
   // with the given |GUID| in |frame|.  |sun_world_position| is the current
   // position of the sun in |World| space as returned by
   // |Planetarium.fetch.Sun.position|.  It is used to define the relation
-  // between |WorldSun| and |World|.  No transfer of ownership.
+  // between |WorldSun| and |World|.  If |tolerance| is positive, the polygon is
+  // simplified by removing vertices that are within |tolerance| of the
+  // polygon that remains.  Only the part of the history on or after |begin| is
+  // rendered; the cost of finding it is logarithmic in the length of the
+  // history.  No transfer of ownership.
   virtual RenderedTrajectory<World> RenderedVesselTrajectory(
       GUID const& vessel_guid,
       not_null<
           Transforms<Barycentric, Rendering, Barycentric>*> const transforms,
-      Position<World> const& sun_world_position) const;
+      Position<World> const& sun_world_position,
+      Length const& tolerance,
+      Instant const& begin) const;
+
+  // Same as |RenderedVesselTrajectory| for each of the |vessel_guids|, in the
+  // same order.  The state of the second transform of |transforms| and the
+  // mapping to |World| are computed once for all the vessels, and the vessels
+  // are mapped to |World| and simplified concurrently if there is a thread
+  // pool.  A pass of |transforms| must not be in progress.
+  virtual std::vector<RenderedTrajectory<World>> RenderedVesselTrajectories(
+      std::vector<GUID> const& vessel_guids,
+      not_null<
+          Transforms<Barycentric, Rendering, Barycentric>*> const transforms,
+      Position<World> const& sun_world_position,
+      Length const& tolerance,
+      Instant const& begin) const;
+
+  // Predicts the trajectories of the vessels with the given GUIDs up to
+  // exactly |tmax| with the time step |Δt|.  The celestials are integrated
+  // once, and the vessels are integrated together in their field.  Returns, in
+  // the order of |vessel_guids|, a fork of the prolongation of each vessel at
+  // the current time which holds its prediction.  The vessels must be
+  // initialized and distinct.  The predictions must be deleted with
+  // |DeletePrediction|; they are invalidated by |AdvanceTime|.
+  virtual std::vector<not_null<Trajectory<Barycentric>*>> PredictVessels(
+      std::vector<GUID> const& vessel_guids,
+      Instant const& tmax,
+      Time const& Δt);
+
+  // Deletes a |*prediction| returned by |PredictVessels| for the vessel with
+  // the given GUID and nulls it.
+  virtual void DeletePrediction(
+      GUID const& vessel_guid,
+      not_null<Trajectory<Barycentric>**> const prediction);
+
+  // Sets the priority with which the prediction of the vessel with the given
+  // GUID is refreshed by |UpdatePredictions|.  The vessels are in the
+  // background until they are given another priority.
+  virtual void SetPredictionPriority(GUID const& vessel_guid,
+                                     PredictionPriority const priority);
+
+  // Sets the number of background vessels whose predictions are refreshed by
+  // each call to |UpdatePredictions|, see |PredictionScheduler|.
+  virtual void SetBackgroundPredictionsPerFrame(int const count);
+
+  // To be called once per frame.  Refreshes, up to |current_time_ + length|
+  // with the time step |Δt|, the predictions of the initialized vessels
+  // chosen by the prediction scheduler: all those of priority |kActive| and
+  // |kTargetedOrVisible|, and a few background ones in turn.  The vessels are
+  // predicted together by a single call to |PredictVessels|, and their
+  // predictions are kept until they are refreshed again, so that they
+  // survive |AdvanceTime|.
+  virtual void UpdatePredictions(Time const& length, Time const& Δt);
+
+  // Returns the prediction of the vessel with the given GUID computed by the
+  // last call to |UpdatePredictions| which refreshed it, or null if there is
+  // none.  The result is invalidated by the next call to |UpdatePredictions|
+  // and by the removal of the vessel.
+  virtual Trajectory<Barycentric> const* ScheduledPrediction(
+      GUID const& vessel_guid) const;
+
+  // Creates a flight plan for the vessel with the given GUID, from its state
+  // at the current time to |final_time|, with the time step |Δt|, replacing
+  // any existing one.  The flight plan is integrated with the prediction
+  // integrator in the field of an ephemeris of the celestials which it owns,
+  // so that editing it does not integrate the celestials again.  The vessel
+  // must be initialized.
+  virtual void CreateFlightPlan(GUID const& vessel_guid,
+                                Instant const& final_time,
+                                Time const& Δt);
+
+  virtual void DeleteFlightPlan(GUID const& vessel_guid);
+
+  virtual bool HasFlightPlan(GUID const& vessel_guid) const;
+
+  // The vessel with the given GUID must have a flight plan.  The result is
+  // invalidated by |DeleteFlightPlan| and |CreateFlightPlan|.
+  virtual not_null<FlightPlan*> GetFlightPlan(GUID const& vessel_guid) const;
+
+  // Returns the Δv of the transfers from the celestial with index
+  // |departure_index| to the celestial with index |arrival_index|, which must
+  // have the same parent, for |departure_points| departure times evenly spaced
+  // in [departure_min, departure_max] and |arrival_points| arrival times evenly
+  // spaced in [arrival_min, arrival_max].  The result has a row of
+  // |arrival_points| elements per departure time.  The Δv of a transfer is the
+  // sum of the norms of the velocities of the transfer orbit relative to the
+  // celestials at both ends.  The transfer orbit is the Keplerian orbit around
+  // the parent given by |LambertSolver|, prograde with respect to the orbit of
+  // the departure celestial.  The celestials are integrated from the current
+  // time with the time step |Δt|, which may be much longer than the step of
+  // the histories.  The departure times must not be before the current time
+  // and must be before the arrival times.  The transfers are computed on the
+  // thread pool.
+  virtual std::vector<Speed> PorkchopPlot(Index const departure_index,
+                                          Index const arrival_index,
+                                          Instant const& departure_min,
+                                          Instant const& departure_max,
+                                          int const departure_points,
+                                          Instant const& arrival_min,
+                                          Instant const& arrival_max,
+                                          int const arrival_points,
+                                          Time const& Δt) const;
+
+  // Returns the handles of the vessels other than the vessel with GUID
+  // |vessel_guid| which are within |radius| of it, in increasing order of
+  // distance.  The positions are those at the time of the last call to
+  // |AdvanceTime|; vessels inserted since are not found.  The vessel with GUID
+  // |vessel_guid| must be initialized.  This takes time proportional to the
+  // number of vessels near that vessel rather than to the number of vessels.
+  virtual std::vector<VesselHandle> VesselsWithinRadius(
+      GUID const& vessel_guid,
+      Length const& radius) const;
+
+  // Returns false if there is no other vessel than the vessel with GUID
+  // |vessel_guid| (with the same restrictions as |VesselsWithinRadius|);
+  // otherwise returns true and sets |*closest| to the handle of the vessel
+  // closest to it and |*distance| to its distance.
+  virtual bool ClosestVessel(GUID const& vessel_guid,
+                             not_null<VesselHandle*> const closest,
+                             not_null<Length*> const distance) const;
+
+  // Returns, in the order of |vessel_guids|, the indices of the dominant
+  // bodies of the given vessels at the current time, which may be passed to
+  // |InsertOrKeepVessel|.  The dominant body of a vessel is found by descending
+  // the hierarchy of the celestials from the sun, going to a child whenever the
+  // vessel is within its sphere of influence.  The radius of the sphere of
+  // influence of a celestial is a (μ / μ_parent)^(2/5), where a is the
+  // semimajor axis of its osculating orbit around its parent, as in KSP.  The
+  // radii are computed once per call.  The vessels must be initialized.
+  virtual std::vector<Index> DominantBodies(
+      std::vector<GUID> const& vessel_guids) const;
 
   virtual not_null<std::unique_ptr<
       Transforms<Barycentric, Rendering, Barycentric>>>
@@ -194,19 +829,45 @@ class Plugin {
   NewBarycentricRotatingTransforms(Index const primary_index,
                                    Index const secondary_index) const;
 
+  // Same as |NewBodyCentredNonRotatingTransforms| and
+  // |NewBarycentricRotatingTransforms|, but the transforms are owned by the
+  // plugin and created by the first call with given arguments; the later calls
+  // return the same object, so that its cache of the first transform persists
+  // from one frame to the next instead of being rebuilt whenever the rendering
+  // frame is selected again.  The result remains valid as long as the plugin.
+  virtual not_null<Transforms<Barycentric, Rendering, Barycentric>*>
+  BodyCentredNonRotatingTransforms(Index const reference_body_index);
+  virtual not_null<Transforms<Barycentric, Rendering, Barycentric>*>
+  BarycentricRotatingTransforms(Index const primary_index,
+                                Index const secondary_index);
+
   virtual Position<World> VesselWorldPosition(
       GUID const& vessel_guid,
       Position<World> const& parent_world_position) const;
+  virtual Position<World> VesselWorldPosition(
+      VesselHandle const vessel_handle,
+      Position<World> const& parent_world_position) const;
+  // Same as above, but at |time|, which is interpreted as for
+  // |VesselFromParentAt|.  |parent_world_position| is the position of the
+  // parent at |time|.
+  virtual Position<World> VesselWorldPositionAt(
+      VesselHandle const vessel_handle,
+      Position<World> const& parent_world_position,
+      Instant const& time) const;
 
   virtual Velocity<World> VesselWorldVelocity(
       GUID const& vessel_guid,
       Velocity<World> const& parent_world_velocity,
       Time const& parent_rotation_period) const;
+  virtual Velocity<World> VesselWorldVelocity(
+      VesselHandle const vessel_handle,
+      Velocity<World> const& parent_world_velocity,
+      Time const& parent_rotation_period) const;
 
   // Creates |next_physics_bubble_| if it is null.  Adds the vessel with GUID
   // |vessel_guid| to |next_physics_bubble_->vessels| with a list of pointers to
   // the |Part|s in |parts|.  Merges |parts| into |next_physics_bubble_->parts|.
-  // Adds the vessel to |dirty_vessels_|.
+  // Marks the vessel as dirty.
   // A vessel with GUID |vessel_guid| must have been inserted and kept.  The
   // vessel with GUID |vessel_guid| must not already be in
   // |next_physics_bubble_->vessels|.  |parts| must not contain a |PartId|
@@ -230,7 +891,8 @@ class Plugin {
 
   virtual Instant current_time() const;
 
-  // Must be called after initialization.
+  // Must be called after initialization.  Writes the current version of the
+  // format, see |kSerializationVersion|.
   void WriteToMessage(not_null<serialization::Plugin*> const message) const;
   // NOTE(egg): This should return a |not_null|, but we can't do that until
   // |not_null<std::unique_ptr<T>>| is convertible to |std::unique_ptr<T>|, and
@@ -238,6 +900,87 @@ class Plugin {
   static std::unique_ptr<Plugin> ReadFromMessage(
       serialization::Plugin const& message);
 
+  // A chunked form of the serialization, which holds few records in memory.
+  // |WriteToRecords| passes the records to |sink| one at a time, in the order
+  // of |ReadFromRecords|; |sink| may modify them.  If there is a thread pool,
+  // see |SetNumberOfThreads|, the records of the vessels are built and
+  // compressed in parallel, by batches of twice the number of threads, and
+  // passed to |sink| in the same order as in the serial case, so the output
+  // does not depend on the number of threads.  Must be called after
+  // initialization.
+  virtual void WriteToRecords(
+      std::function<void(not_null<serialization::PluginRecord*> const record)>
+          const& sink) const;
+  // Same as |WriteToRecords|, except that the timelines of the trajectories
+  // are not compressed.  This is essentially a flat copy of the state of the
+  // plugin, much cheaper than |WriteToRecords|: the expensive part of the
+  // serialization may then be done by |CompressRecord| on another thread, while
+  // the plugin is modified.  Must be called after initialization.
+  virtual void WriteToUncompressedRecords(
+      std::function<void(not_null<serialization::PluginRecord*> const record)>
+          const& sink) const;
+  // Compresses the timelines of the trajectories of |record|, which was passed
+  // to the sink of |WriteToUncompressedRecords|.  |record| is then the same as
+  // the one passed to the sink of |WriteToRecords|.  Does not access any
+  // plugin, so may be called on any thread.
+  static void CompressRecord(
+      not_null<serialization::PluginRecord*> const record);
+  // Same as |WriteToRecords|, except that the histories of the celestials and
+  // of the vessels are written as increments over their points at or before
+  // |since|, see |Celestial::WriteIncrementToMessage| and
+  // |Vessel::WriteIncrementToMessage|, so that the cost is proportional to the
+  // activity since |since| rather than to the length of the histories.  The
+  // rest of the state, including the prolongations and the bubble, is written
+  // in full, and the vessels removed since are absent.  |since| must be the
+  // |history_time| in the header of the records of a previous save of this
+  // plugin, or of the save from which it was read, with which the increment
+  // must be combined by |CompactRecords|.
+  virtual void WriteIncrementToRecords(
+      Instant const& since,
+      std::function<void(not_null<serialization::PluginRecord*> const record)>
+          const& sink) const;
+  // Combines the records of a save, |base|, with the records of an
+  // |increment| over |base| written by |WriteIncrementToRecords|.  Returns
+  // the records that |WriteToRecords| would have written at the time of
+  // |increment|, except that the histories keep the points of |base| that the
+  // downsampling has removed since.  The result may be read by
+  // |ReadFromRecords| or used as the base of the next increment.  Does not
+  // access any plugin.
+  static std::vector<serialization::PluginRecord> CompactRecords(
+      std::vector<serialization::PluginRecord> const& base,
+      std::vector<serialization::PluginRecord> const& increment);
+  // Reads the records produced by |WriteToRecords|.  |source| fills its
+  // argument with the next record and returns true, or returns false at the
+  // end of the sequence.
+  static std::unique_ptr<Plugin> ReadFromRecords(
+      std::function<bool(not_null<serialization::PluginRecord*> const record)>
+          const& source);
+
+  // Keeps in memory a copy of the current state of the plugin, from which
+  // |RestoreCheckpoint| rebuilds a plugin, e.g., for a revert or a quickload,
+  // much faster than by reading a save: the trajectories are neither
+  // compressed nor decompressed, there is no file, and the histories of the
+  // vessels are only decoded when first used.  Returns the identifier of the
+  // checkpoint.  Only the |kMaxCheckpoints| most recent checkpoints are kept.
+  // Must be called after initialization.
+  virtual std::int64_t SaveCheckpoint();
+  // Returns true if the checkpoint |checkpoint_id| is kept.
+  virtual bool HasCheckpoint(std::int64_t const checkpoint_id) const;
+  // Returns a plugin in the state of the checkpoint |checkpoint_id|, which must
+  // be kept.  As for a plugin read from a save, the settings which are not
+  // serialized, e.g., the number of threads, have their default values.  The
+  // result shares the checkpoints of this plugin, so that it may be reverted
+  // in turn.
+  virtual std::unique_ptr<Plugin> RestoreCheckpoint(
+      std::int64_t const checkpoint_id) const;
+
+  static int const kMaxCheckpoints = 4;
+
+  // The version of the serialization format written by |WriteToMessage|.
+  // Version 0 has uncompressed trajectories; version 1 compresses their
+  // timelines, see physics/trajectory_compression.hpp.
+  static int const kSerializationVersion = 1;
+
  private:
   using GUIDToOwnedVessel = std::map<GUID, not_null<std::unique_ptr<Vessel>>>;
   using GUIDToUnownedVessel = std::map<GUID, not_null<Vessel*> const>;
@@ -245,106 +988,593 @@ class Plugin {
       std::map<Index, not_null<std::unique_ptr<Celestial>>>;
 
   // This constructor should only be used during deserialization.
-  // |unsynchronized_vessels_| is initialized consistently.  The resulting
-  // plugin is not |initializing_|.
+  // The vessels with GUIDs in |dirty_vessels| are marked as dirty, the count of
+  // unsynchronized vessels is initialized consistently.  The resulting plugin
+  // is not |initializing_|.
   Plugin(GUIDToOwnedVessel vessels,
          IndexToOwnedCelestial celestials,
-         std::set<not_null<Vessel*> const> dirty_vessels,
+         std::set<GUID> const& dirty_vessels,
          not_null<std::unique_ptr<PhysicsBubble>> bubble,
          Angle planetarium_rotation,
          Instant current_time,
          Index sun_index);
 
+  // Inserts the celestial with index |celestial_index| as a child of |parent|,
+  // with the given state relative to |parent| at the current time.
+  void AddCelestial(Index const celestial_index,
+                    GravitationalParameter const& gravitational_parameter,
+                    not_null<Celestial const*> const parent,
+                    RelativeDegreesOfFreedom<Barycentric> const& relative);
+
+  // An entry of |vessel_slots_|.
+  struct VesselSlot {
+    // Null if the slot is free.  Not owning.
+    GUID const* guid = nullptr;
+    Vessel* vessel = nullptr;
+    std::uint32_t generation = 0;
+    // The vessel will be kept during the next call to |AdvanceTime|.
+    bool kept = false;
+    // The vessel has been added to the physics bubble after |HistoryTime()|.
+    // Its prolongation contains information that may not be discarded, and its
+    // history will be advanced using the prolongation.
+    bool dirty = false;
+    // The vessel is in the physics bubble being prepared.  Only meaningful
+    // during |AdvanceTime|, after |MarkVesselsInBubble|.
+    bool in_bubble = false;
+  };
+
+  // A cluster of vessels with the same parent, see |SetClusterTolerance|.
+  struct VesselCluster {
+    VesselCluster(not_null<Vessel*> const reference,
+                  KeplerOrbit<Barycentric> const& reference_orbit);
+
+    // The vessel that is integrated numerically.
+    not_null<Vessel*> reference;
+    // The orbit of the |reference| around the parent at the start of the
+    // step, which approximates its motion in the linearised equations.
+    KeplerOrbit<Barycentric> reference_orbit;
+    // The other vessels, and their degrees of freedom relative to the
+    // |reference| at the start of the step.
+    std::vector<not_null<Vessel*>> members;
+    std::vector<RelativeDegreesOfFreedom<Barycentric>> offsets;
+  };
+
   not_null<std::unique_ptr<Vessel>> const& find_vessel_by_guid_or_die(
       GUID const& vessel_guid) const;
+  VesselSlot const& find_vessel_slot_or_die(
+      VesselHandle const vessel_handle) const;
+  // The index in |vessel_slots_| of the slot denoted by |vessel_handle|, which
+  // must not be stale.
+  std::uint32_t vessel_slot_index(VesselHandle const vessel_handle) const;
 
-  // Returns |!dirty_vessels_.empty()|.
+  // Assigns a slot, and thus a handle, to the vessel denoted by |it|, and
+  // returns that handle.
+  VesselHandle AllocateVesselHandle(GUIDToOwnedVessel::const_iterator const it);
+  // Frees the slot of the vessel with GUID |vessel_guid|, which must have one.
+  void FreeVesselHandle(GUID const& vessel_guid);
+
+  // Returns |number_of_dirty_vessels_ > 0|.
   bool has_dirty_vessels() const;
-  // Returns |!unsynchronized_vessels_.empty()|.
+
+  // The positions of the part of the history of the vessel with GUID
+  // |vessel_guid| on or after |begin|, transformed by |transforms|, in
+  // increasing time order.  A level of detail of the history is used if one is
+  // within |tolerance|.  Empty if the vessel is not synchronized.
+  std::vector<Position<Barycentric>> ApparentHistory(
+      GUID const& vessel_guid,
+      not_null<
+          Transforms<Barycentric, Rendering, Barycentric>*> const transforms,
+      Length const& tolerance,
+      Instant const& begin) const;
+  // Returns |number_of_unsynchronized_vessels_ > 0|.
   bool has_unsynchronized_vessels() const;
-  // Returns |dirty_vessels_.count(vessel) > 0|.
-  bool is_dirty(not_null<Vessel*> const vessel) const;
+  // Whether the vessel with GUID |vessel_guid| is dirty.
+  bool is_dirty(GUID const& vessel_guid) const;
 
   // The common last time of the histories of synchronized vessels and
   // celestials.
   Instant const& HistoryTime() const;
 
+  // Implements |WriteToRecords| and |WriteToUncompressedRecords| if |since| is
+  // null, and |WriteIncrementToRecords| otherwise.  The records are passed to
+  // |CompressRecord| before |sink| if |compress| is true.
+  void WriteRecords(
+      Instant const* const since,
+      bool const compress,
+      std::function<void(not_null<serialization::PluginRecord*> const record)>
+          const& sink) const;
+
   // The rotation between the |World| basis at |current_time_| and the
   // |Barycentric| axes. Since |WorldSun| is not a rotating reference frame,
   // this change of basis is all that's required to convert relative velocities
   // or displacements between simultaneous events.
-  Rotation<Barycentric, WorldSun> PlanetariumRotation() const;
+  Rotation<Barycentric, WorldSun> const& PlanetariumRotation() const;
+
+  // Sets |planetarium_rotation_| and recomputes the rotations derived from it.
+  void SetPlanetariumRotation(Angle const& planetarium_rotation);
 
   // Utilities for |AdvanceTime|.
 
-  // Remove vessels not in |kept_vessels_|, and clears |kept_vessels_|.
+  // Remove vessels whose slots are not |kept|, and clears the |kept| flags.
   void CleanUpVessels();
-  // Given an iterator to an element of |vessels_|, check that the corresponding
-  // |Vessel| |is_initialized()|, and that it is not in
-  // |unsynchronized_vessels_| if, and only if, it |is_synchronized()|.
-  // Also checks that its |prolongation().last().time()| is at least
+  // Given a used slot of |vessel_slots_|, check that the corresponding |Vessel|
+  // |is_initialized()|, that its |prolongation().last().time()| is at least
   // |HistoryTime()|, and that if it |is_synchronized()|, its
   // |history().last().time()| is exactly |HistoryTime()|.
-  void CheckVesselInvariants(GUIDToOwnedVessel::const_iterator const it) const;
+  void CheckVesselInvariants(VesselSlot const& slot) const;
+  // Sets the |in_bubble| flags of the slots from the physics bubble as it will
+  // be after |bubble_->Prepare|.  Must be called before |bubble_->Prepare|.
+  void MarkVesselsInBubble();
   // Evolves the histories of the |celestials_| and of the synchronized vessels
   // up to at most |t|. |t| must be large enough that at least one step of
-  // size |Δt_| can fit between |current_time_| and |t|.
-  void EvolveHistories(Instant const& t);
-  // Synchronizes the |unsynchronized_vessels_|, clears
-  // |unsynchronized_vessels_|.  Prolongs the histories of the vessels in the
-  // physics bubble by evolving the trajectory of the |current_physics_bubble_|
-  // if there is one, prolongs the histories of the remaining |dirty_vessels_|
-  // using their prolongations, clears |dirty_vessels_|.
-  void SynchronizeNewVesselsAndCleanDirtyVessels();
+  // size |Δt_| can fit between |current_time_| and |t|.  The states of the
+  // celestials at each step are recorded in |*celestial_steps|.
+  void EvolveHistories(
+      Instant const& t,
+      not_null<NBodySystem<Barycentric>::MassiveBodiesSteps*> const
+          celestial_steps);
+  // Called from |EvolveHistories|, appends to the histories of the |vessels|
+  // their states on the |orbits| at |HistoryTime()|, which has been advanced
+  // from the start of the step.  The vessels that are perturbed beyond the
+  // threshold at the end of the step are instead integrated numerically from
+  // the start of the step, with the celestials starting from
+  // |initial_celestial_states|, up to |t|.
+  void EvolveKeplerianHistories(
+      std::vector<not_null<Vessel*>> const& vessels,
+      std::vector<KeplerOrbit<Barycentric>> const& orbits,
+      std::vector<DegreesOfFreedom<Barycentric>> const&
+          initial_celestial_states,
+      Instant const& t);
+  // Adds the |vessel| to the first of the |*clusters| that has the same parent
+  // and whose reference is within |cluster_tolerance_|, or to a new cluster of
+  // which it is the reference, starting at |HistoryTime()|.
+  void AddToCluster(not_null<Vessel*> const vessel,
+                    not_null<std::vector<VesselCluster>*> const clusters) const;
+  // Called from |EvolveHistories| once the references of the |clusters| have
+  // been integrated, appends to the histories of the other vessels of the
+  // |clusters| their states at |HistoryTime()|, see |SetClusterTolerance|.
+  // The vessels that are beyond |cluster_tolerance_| from their reference at
+  // the end of the step are integrated as in |EvolveKeplerianHistories|.
+  void EvolveClusterHistories(
+      std::vector<VesselCluster> const& clusters,
+      std::vector<DegreesOfFreedom<Barycentric>> const&
+          initial_celestial_states,
+      Instant const& t);
+  // Integrates numerically from the start of the step up to |t| the
+  // |perturbed| vessel histories, which end at the start of the step, with
+  // copies of the celestials starting from |initial_celestial_states|.
+  void IntegratePerturbedHistories(
+      NBodySystem<Barycentric>::Trajectories perturbed,
+      std::vector<DegreesOfFreedom<Barycentric>> const&
+          initial_celestial_states,
+      Instant const& t);
+  // Called from |EvolveHistories| when the vessels are integrated in groups,
+  // appends to the histories of the |celestials_| and of the |vessels| their
+  // states up to at most |t|.  The groups are integrated on |thread_pool_|.
+  // The states of the celestials at each step are recorded in
+  // |*celestial_steps|.
+  void EvolveHistoriesInGroups(
+      std::vector<not_null<Trajectory<Barycentric>*>> const& vessel_histories,
+      Instant const& t,
+      not_null<NBodySystem<Barycentric>::MassiveBodiesSteps*> const
+          celestial_steps);
+  // The parent of each celestial that has one, for the hierarchical force
+  // model.
+  std::map<MassiveBody const*, MassiveBody const*> CelestialParents() const;
+  // The integrator of the histories other than the Wisdom-Holman one:
+  // |multistep_history_integrator_| if |multistep_histories_| is true,
+  // |history_integrator_| otherwise.
+  SymplecticIntegrator<Length, Speed> const& HistoryIntegrator() const;
+  // Integrates the |trajectories| up to |tmax| with |n_body_system|, with the
+  // Wisdom-Holman integrator and the celestial |parents| if
+  // |wisdom_holman_histories_| is true, with |HistoryIntegrator()| otherwise.
+  // If |UsesEphemerisFile(tmax)|, the celestials are instead evaluated from
+  // |ephemeris_file_| by |EvaluateHistoriesFromEphemerisFile|.
+  void IntegrateHistories(
+      NBodySystem<Barycentric> const& n_body_system,
+      std::map<MassiveBody const*, MassiveBody const*> const& parents,
+      Instant const& tmax,
+      NBodySystem<Barycentric>::Trajectories const& trajectories) const;
+  // Same as above, but also records the states of the celestials in
+  // |*celestial_steps|.
+  void IntegrateHistories(
+      NBodySystem<Barycentric> const& n_body_system,
+      std::map<MassiveBody const*, MassiveBody const*> const& parents,
+      Instant const& tmax,
+      NBodySystem<Barycentric>::Trajectories const& trajectories,
+      not_null<NBodySystem<Barycentric>::MassiveBodiesSteps*> const
+          celestial_steps) const;
+  // True if the histories up to |tmax| may be evaluated from
+  // |ephemeris_file_|.
+  bool UsesEphemerisFile(Instant const& tmax) const;
+  // Appends to the massive |trajectories|, which must be those of celestials,
+  // their states from |ephemeris_file_| at the steps of |Δt_| up to at most
+  // |tmax|, and integrates the massless |trajectories| in their field with
+  // |HistoryIntegrator()|.  The steps are evaluated in trajectories that are
+  // not downsampled, so that the interpolation of the celestials between the
+  // steps is as accurate as in |NBodySystem::IntegrateMasslessBodiesInSteps|.
+  void EvaluateHistoriesFromEphemerisFile(
+      NBodySystem<Barycentric> const& n_body_system,
+      Instant const& tmax,
+      NBodySystem<Barycentric>::Trajectories const& trajectories) const;
+  // The ratio of the norm of the tidal acceleration caused by the celestials
+  // other than |parent| at |position| to the norm of the acceleration caused by
+  // |parent|, using the last points of the histories of the celestials.
+  double PerturbationRatio(Celestial const& parent,
+                           Position<Barycentric> const& position) const;
+  // Synchronizes the unsynchronized vessels.  Prolongs the histories of the
+  // vessels in the physics bubble by evolving the trajectory of the
+  // |current_physics_bubble_| if there is one, prolongs the histories of the
+  // remaining dirty vessels using their prolongations, clears the |dirty|
+  // flags.  The vessels and the bubble are integrated in the field of the
+  // |celestial_steps| recorded by |EvolveHistories|, so that the celestials
+  // are not integrated again.  If there is an |ephemeris_file_|, they are
+  // integrated in the field of the histories of the celestials instead, since
+  // |EvolveHistories| may not have recorded the steps.
+  void SynchronizeNewVesselsAndCleanDirtyVessels(
+      NBodySystem<Barycentric>::MassiveBodiesSteps const& celestial_steps);
   // Called from |SynchronizeNewVesselsAndCleanDirtyVessels()|, prolongs the
   // histories of the vessels in the physics bubble (the integration must
-  // already have been done).  Any new vessels in the physics bubble are
-  // synchronized and removed from |unsynchronized_vessels_|.
+  // already have been done) by appending a row to |bubble_histories_|.  Any
+  // new vessels in the physics bubble are synchronized.
   void SynchronizeBubbleHistories();
   // Resets the prolongations of all vessels and celestials to |HistoryTime()|.
-  // All vessels must satisfy |is_synchronized()|.
+  // All vessels must satisfy |is_synchronized()|.  The histories must have
+  // advanced since the prolongations were forked.
   void ResetProlongations();
+
+  // Utilities for the pipelined mode of |AdvanceTime|.
+
+  // Creates the |history_integration_| and launches it up to at most |tmax|.
+  // There must be no unsynchronized or dirty vessels, the physics bubble must
+  // be empty, and there must be no |history_integration_|.
+  void StartHistoryIntegration(Instant const& tmax);
+  // Continues the integration of the |history_integration_| up to at most
+  // |tmax| on a worker thread.  The worker must be idle.
+  void LaunchHistoryIntegration(Instant const& tmax);
+  // Appends the points of the |history_integration_| up to |t| to the
+  // histories of the |celestials_| and of the vessels that still exist.  The
+  // worker must be idle.
+  void CommitHistoryIntegration(Instant const& t);
+  // Waits for the |history_integration_|, commits it up to |current_time_|,
+  // and deletes it.  Then calls |ResetProlongationsToCurrentTime()|.
+  void FinishHistoryIntegration();
+  // Integrates the histories of the |celestials_| and of the synchronized
+  // vessels up to at most |current_time_|, then calls
+  // |ResetProlongationsToCurrentTime()|.  This restores the invariant of the
+  // synchronous mode that the histories are within |Δt_| of |current_time_|.
+  // There must be no |history_integration_| in progress.
+  void CatchUpHistories();
+  // Resets the prolongations of the |celestials_| and of the synchronized
+  // vessels to |HistoryTime()| and evolves them up to exactly |current_time_|,
+  // where the prolongations of the unsynchronized vessels end.  Does nothing if
+  // the histories have not advanced since the prolongations were forked.
+  void ResetProlongationsToCurrentTime();
   // Evolves the prolongations of all celestials and vessels up to exactly
   // instant |t|.  Also evolves the trajectory/ of the |current_physics_bubble_|
   // if there is one.
   void EvolveProlongationsAndBubble(Instant const& t);
+  // The end of |AdvanceTime| and |FastForward|, once the histories have been
+  // evolved: evolves the prolongations and the bubble to |t|, and makes |t|
+  // the current time.
+  void CompleteAdvanceTime(Instant const& t,
+                           Angle const& planetarium_rotation);
+  // Forgets the points of the histories of the celestials covered by
+  // |ephemeris_file_|, except the last one, since their past is evaluated
+  // from the file.
+  void ForgetCelestialHistoryPoints();
+  // Records the run of the histories of the celestials to which the points
+  // appended since the last call belong, and forgets those that are not
+  // checkpoints, see |SetCelestialHistoryCheckpoints|.  Must be called before
+  // a change of |Δt_| or of the integration of the histories.
+  void CheckpointCelestialHistories();
+  // Makes the histories of the celestials use |EvaluateCelestialHistoryGap|.
+  void SetCelestialHistoryGapEvaluators();
+  // The |Trajectory::GapEvaluator| of the history of the celestial at
+  // position |column| in |celestials_|: integrates again the histories of all
+  // the celestials from |left_time| to |right_time|, unless that segment is
+  // cached, and evaluates the result at |time|.  Returns false if these
+  // points are not in the same run, or too far apart.
+  bool EvaluateCelestialHistoryGap(
+      std::size_t const column,
+      Instant const& left_time,
+      Instant const& right_time,
+      Instant const& time,
+      not_null<DegreesOfFreedom<Barycentric>*> const degrees_of_freedom) const;
+  // Returns the degrees of freedom of |trajectory|, a prolongation or one of
+  // its ancestors, at |time|, which must be in [|previous_time_|,
+  // |current_time_|], or at its first point if it starts after |time|.
+  DegreesOfFreedom<Barycentric> EvaluateInLastStep(
+      Trajectory<Barycentric> const& trajectory,
+      Instant const& time) const;
+  // Forgets at most |kForgottenPointsPerAdvanceTime| points of the histories
+  // that exceed the limits set by |SetHistoryRetention| at time |t|, resuming
+  // with the history at |history_retention_cursor_|.
+  void ForgetOldHistoryPoints(Instant const& t);
+  // Samples the energy and angular momentum of the celestials if required by
+  // |SetConservationMonitoring|.
+  void MonitorConservation();
+  // Sets |Δt_| according to the policy set by |SetHistoryStepPolicy|, using
+  // the prolongations, which end at |current_time_|.  No integration of the
+  // histories may be in progress.
+  void UpdateHistoryStep();
+  // Rebuilds |vessel_grid_| from the prolongations, which end at
+  // |current_time_|.
+  void UpdateVesselGrid();
+  // Fills |state_table_| from the prolongations, which end at |current_time_|.
+  void PublishStateTable();
+
+  static std::int64_t const kForgottenPointsPerAdvanceTime = 1000;
+  static int const kMaximumCelestialHistorySegmentSteps = 1 << 12;
 
-  // TODO(egg): Constant time step for now.
-  Time const Δt_ = 10 * Second;
+  // The step of the histories, see |SetHistoryStepPolicy|.
+  Time const default_Δt_ = 10 * Second;
+  Time Δt_ = default_Δt_;
+  int history_steps_per_orbit_ = 0;
+  Time minimum_history_step_;
+  Time maximum_history_step_;
+  // The tolerances on the errors over one step of the integration of the
+  // prolongations by |EvolveProlongationsAndBubble|.
+  Length const prolongation_length_tolerance_ = 1 * Milli(Metre);
+  Speed const prolongation_speed_tolerance_ = 1 * Milli(Metre) / Second;
+  // The downsampling of the histories of the vessels and of the celestials.
+  Trajectory<Barycentric>::Downsampling const history_downsampling_ =
+      {1 * Day, 10 * Metre};
+  // The tolerances of the levels of detail of the histories of the vessels,
+  // from which they are rendered when zoomed out.
+  std::vector<Length> const history_levels_of_detail_ =
+      {1 * Kilo(Metre), 10 * Kilo(Metre), 100 * Kilo(Metre),
+       1000 * Kilo(Metre)};
+  // The parameters of the Chebyshev series of the ephemeris of the celestials
+  // used by |PredictVessels|.
+  int const prediction_steps_per_series_ = 8;
+  int const prediction_series_degree_ = 12;
+  // The positions of the initialized vessels at |current_time_|, rebuilt by
+  // |AdvanceTime|, for the proximity queries.  The cells are about the size of
+  // the physics range of KSP.
+  HashGrid<Barycentric, VesselHandle> vessel_grid_ =
+      HashGrid<Barycentric, VesselHandle>(2.5 * Kilo(Metre));
 
   GUIDToOwnedVessel vessels_;
   IndexToOwnedCelestial celestials_;
 
-  // The vessels which have been inserted after |HistoryTime()|.  These are the
-  // vessels which do not satisfy |is_synchronized()|, i.e., they do not have a
-  // history.  The pointers are not owning.
-  std::set<not_null<Vessel*> const> unsynchronized_vessels_;
-  // The vessels that have been added to the physics bubble after
-  // |HistoryTime()|.  For these vessels, the prolongation contains information
-  // that may not be discarded, and the history will be advanced using the
-  // prolongation.  The pointers are not owning.
-  std::set<not_null<Vessel*> const> dirty_vessels_;
+  // Destroys the removed vessels, the deleted predictions and the deleted
+  // flight plans in the background, since they may own millions of points.
+  // Declared after |vessels_| and |celestials_| so that the pending objects
+  // are destroyed first when the plugin is.
+  Reclaimer reclaimer_;
 
-  // The vessels that will be kept during the next call to |AdvanceTime|.
-  std::set<not_null<Vessel const*> const> kept_vessels_;
+  // The handles of the vessels in |vessels_|, and the slots that they denote.
+  // The free slots are reused, most recently freed first, so that the table
+  // remains dense.
+  std::map<GUID, VesselHandle> vessel_handles_;
+  std::vector<VesselSlot> vessel_slots_;
+  std::vector<std::uint32_t> free_vessel_slots_;
+
+  // The number of vessels which have been inserted after |HistoryTime()|.
+  // These are the vessels which do not satisfy |is_synchronized()|, i.e., they
+  // do not have a history.
+  int number_of_unsynchronized_vessels_ = 0;
+  // The number of slots of |vessel_slots_| that are |dirty|.
+  int number_of_dirty_vessels_ = 0;
 
   not_null<std::unique_ptr<PhysicsBubble>> const bubble_;
+  // The histories shared by the vessels of the bubble, see
+  // |Vessel::SetBubbleHistories|, with one column per vessel of
+  // |bubble_history_vessels_|, in that order, after that of the centre of
+  // mass.  Replaced when the composition of the bubble changes, null if it is
+  // empty.  Not serialized: the vessels materialize their histories when they
+  // are.
+  std::shared_ptr<SynchronizedHistories<Barycentric>> bubble_histories_;
+  std::vector<not_null<Vessel*>> bubble_history_vessels_;
 
+  // Null if the computations are serial.  Declared before |n_body_system_|,
+  // which uses it, so that it outlives it.
+  std::unique_ptr<ThreadPool> thread_pool_;
   not_null<std::unique_ptr<NBodySystem<Barycentric>>> n_body_system_;
+  // The plan of the integration of the histories by |n_body_system_| in
+  // |EvolveHistories|, whose trajectories are mostly the same from one call to
+  // the next.  The plan may hold the histories of vessels that have since been
+  // removed; their addresses may only be reused by the histories of other
+  // vessels, which are massless too.
+  NBodySystem<Barycentric>::Plan history_plan_;
   // The symplectic integrator computing the synchronized histories.
   SPRKIntegrator<Length, Speed> history_integrator_;
-  // The integrator computing the prolongations.
+  // Used instead of |history_integrator_| if |wisdom_holman_histories_| is
+  // true, with the same coefficients.
+  WisdomHolmanIntegrator<Length, Speed> wisdom_holman_integrator_;
+  // Used instead of |history_integrator_| if |multistep_histories_| is true.
+  SymmetricLinearMultistepIntegrator<Length, Speed>
+      multistep_history_integrator_;
+  // The integrator computing the prolongations of the new vessels when they
+  // are synchronized.
   SPRKIntegrator<Length, Speed> prolongation_integrator_;
+  // The integrator computing the predictions in |PredictVessels|.
+  SPRKIntegrator<Length, Speed> prediction_integrator_;
+  // Used instead of |prediction_integrator_| for the vessels if
+  // |gauss_jackson_predictions_| is true.
+  GaussJacksonIntegrator<Length, Speed> gauss_jackson_prediction_integrator_;
+  // Used instead of |prediction_integrator_| for the vessels if
+  // |parareal_predictions_| is true, with the same coefficients for its fine
+  // propagator.
+  PararealIntegrator<Length, Speed> parareal_prediction_integrator_;
+  // The integrator computing the prolongations in
+  // |EvolveProlongationsAndBubble|.  Prolongations are not symplectic anyway,
+  // so the step size is adapted to the dynamics.
+  EmbeddedExplicitRungeKuttaNyströmIntegrator<Length>
+      adaptive_prolongation_integrator_;
+
+  // Chooses the vessels whose predictions are refreshed by
+  // |UpdatePredictions|, which stores them in |scheduled_predictions_|.  The
+  // predictions are root trajectories owned by the plugin rather than forks of
+  // the prolongations, so that they survive |AdvanceTime|.  The entries of the
+  // removed vessels are erased by |CleanUpVessels|.
+  PredictionScheduler prediction_scheduler_;
+  std::map<GUID, not_null<std::unique_ptr<Trajectory<Barycentric>>>>
+      scheduled_predictions_;
+
+  // The transforms returned by |BodyCentredNonRotatingTransforms| and
+  // |BarycentricRotatingTransforms|, keyed by the kind of frame and the
+  // indices of the celestials which define it; the second index is that of
+  // the reference body for a body-centred frame.  Declared after |vessels_|
+  // and |celestials_| so that they stop observing the trajectories before
+  // these are destroyed.
+  enum class TransformsKind {
+    kBodyCentredNonRotating,
+    kBarycentricRotating,
+  };
+  using TransformsKey = std::tuple<TransformsKind, Index, Index>;
+  std::map<TransformsKey,
+           not_null<std::unique_ptr<
+               Transforms<Barycentric, Rendering, Barycentric>>>>
+      owned_transforms_;
 
   // Whether initialization is ongoing.
   Monostable initializing_;
 
   Angle planetarium_rotation_;
+  // The rotations derived from |planetarium_rotation_|, which are constant
+  // between calls to |AdvanceTime| and are used by most queries.  Updated
+  // only by |SetPlanetariumRotation|.
+  Rotation<Barycentric, WorldSun> barycentric_to_world_sun_;
+  Rotation<Barycentric, World> barycentric_to_world_;
   // The current in-game universal time.
   Instant current_time_;
+  // The value of |current_time_| before the last call to |AdvanceTime|, which
+  // starts the interval of the sub-frame queries, e.g., |VesselFromParentAt|.
+  // Not serialized: it is |current_time_| after deserialization.
+  Instant previous_time_;
 
   not_null<Celestial*> const sun_;  // Not owning.
 
+  // A history integration started by |AdvanceTime| in pipelined mode.  While
+  // |done| is valid and not ready the worker thread owns the |histories| and
+  // |background_n_body_system_|, and the main thread must not touch them.  The
+  // worker thread never touches the |Vessel|s, |Celestial|s or their
+  // trajectories, so the main thread may use, insert and remove those freely
+  // while the integration is in progress.
+  struct HistoryIntegration {
+    // The handles of the vessels whose histories are integrated, in the order
+    // in which they follow the celestials in |histories|.
+    std::vector<VesselHandle> vessel_handles;
+    // The bodies of the vessel |histories|.  The vessels may be removed during
+    // the integration, so their bodies are not used.
+    std::vector<not_null<std::unique_ptr<MasslessBody const>>> vessel_bodies;
+    // Root trajectories starting at |HistoryTime()|, for the |celestials_| in
+    // order, followed by those for the vessels in |vessel_handles|.
+    std::vector<not_null<std::unique_ptr<Trajectory<Barycentric>>>> histories;
+    // Invalid if the worker is idle.
+    std::future<void> done;
+  };
+
+  bool pipelined_histories_ = false;
+  int history_step_budget_ = 0;
+  double keplerian_perturbation_threshold_ = 0;
+  Length cluster_tolerance_;
+  bool wisdom_holman_histories_ = false;
+  bool multistep_histories_ = false;
+  bool gauss_jackson_predictions_ = false;
+  bool parareal_predictions_ = false;
+  int number_of_vessel_groups_ = 1;
+  // The parameters of the hierarchical force model, applied to the
+  // |NBodySystem|s of the vessel groups.
+  double hierarchical_tolerance_ = 0;
+  bool use_quadrupole_ = false;
+  double close_encounter_timescale_fraction_ = 0;
+  Time history_look_ahead_;
+  // The limits set by |SetHistoryRetention|.
+  Time history_maximum_age_;
+  std::int64_t history_maximum_points_ = 0;
+  // The index, among the histories enumerated by |ForgetOldHistoryPoints|, of
+  // the next one to truncate.
+  std::size_t history_retention_cursor_ = 0;
+  // The parameters of |SetCelestialHistoryCheckpoints|.
+  int steps_between_celestial_history_checkpoints_ = 0;
+  int cached_celestial_history_segments_ = 1;
+  // The runs of the histories of the celestials, keyed by the time of their
+  // first point: from there until the next run the histories were integrated
+  // by |history_integrator_| with the constant step given by the value, or
+  // they cannot be integrated again if it is zero.  Empty until checkpoints
+  // are first enabled.
+  std::map<Instant, Time> celestial_history_runs_;
+  // The last checkpoint of the last run, and the end of the histories at the
+  // last call to |CheckpointCelestialHistories|.
+  Instant last_celestial_history_checkpoint_;
+  Instant celestial_history_checkpointed_until_;
+  // A segment of the histories of the celestials integrated again by
+  // |EvaluateCelestialHistoryGap|, with one body per celestial in the order
+  // of |celestials_|.
+  struct CelestialHistorySegment {
+    std::unique_ptr<SynchronizedHistories<Barycentric>> histories;
+    std::int64_t last_use = 0;
+  };
+  // The segments, keyed by their first time.  The least recently used one is
+  // evicted when there are more than |cached_celestial_history_segments_|.
+  // Mutable since the evaluations of the histories are const, and locked
+  // since they may be concurrent.
+  mutable std::map<Instant, CelestialHistorySegment>
+      celestial_history_segments_;
+  mutable std::int64_t celestial_history_segments_clock_ = 0;
+  mutable std::mutex celestial_history_segments_lock_;
+  bool profiling_ = false;
+  // Mutable because the rendering, which is const, is profiled.
+  mutable Profile profile_;
+
+  // The checkpoints of |SaveCheckpoint|, shared by the plugins restored from
+  // them.
+  struct Checkpoint {
+    std::int64_t id;
+    // As written by |WriteToUncompressedRecords|.
+    std::vector<serialization::PluginRecord> records;
+  };
+  struct Checkpoints {
+    std::int64_t next_id = 0;
+    // Oldest first.
+    std::deque<Checkpoint> checkpoints;
+  };
+  std::shared_ptr<Checkpoints> checkpoints_ = std::make_shared<Checkpoints>();
+
+  // Set by |LoadEphemerisFile|, null if the celestials are integrated.  Also
+  // read by the worker of a pipelined integration of the histories, which
+  // |LoadEphemerisFile| therefore finishes first.
+  std::unique_ptr<EphemerisFile<Barycentric> const> ephemeris_file_;
+  // The name of the |ephemeris_file_|, written by the serialization.
+  std::string ephemeris_filename_;
+  // The index in |ephemeris_file_| of the body of each celestial.
+  std::map<MassiveBody const*, std::size_t> ephemeris_file_indices_;
+  // The tolerances on the differences between the states of the celestials
+  // and those of the |ephemeris_file_| checked by |LoadEphemerisFile|.
+  Length const ephemeris_file_length_tolerance_ = 1 * Metre;
+  Speed const ephemeris_file_speed_tolerance_ = 1 * Milli(Metre) / Second;
+
+  // See |state_table()|.  The arrays own the entries of |state_table_|.
+  StateTable state_table_ = StateTable();
+  std::vector<PublishedState> published_vessels_;
+  std::vector<PublishedState> published_celestials_;
+
+  // The state of the monitoring set by |SetConservationMonitoring|.  Since
+  // only the gravitational parameters of the celestials are known, the energy
+  // and angular momentum are multiplied by the gravitational constant.
+  int conservation_monitoring_period_ = 0;
+  ConservationDrift conservation_drift_;
+  Instant last_conservation_sample_;
+  quantities::Product<GravitationalParameter, quantities::SpecificEnergy>
+      initial_energy_;
+  geometry::Bivector<
+      quantities::Product<GravitationalParameter,
+                          quantities::Product<quantities::Length,
+                                              quantities::Speed>>,
+      Barycentric> initial_angular_momentum_;
+  // Used only by the worker thread, see |HistoryIntegration|.
+  not_null<std::unique_ptr<NBodySystem<Barycentric>>> background_n_body_system_;
+  // Used only by |EvaluateCelestialHistoryGap|, under
+  // |celestial_history_segments_lock_|.
+  not_null<std::unique_ptr<NBodySystem<Barycentric>>>
+      celestial_history_n_body_system_;
+  // Null if no integration is in progress.  Declared last so that it is
+  // destroyed, and thus waited for, before the objects that it uses.
+  std::unique_ptr<HistoryIntegration> history_integration_;
+
   friend class TestablePlugin;
 };
 
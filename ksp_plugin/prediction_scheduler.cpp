@@ -0,0 +1,92 @@
+#include "ksp_plugin/prediction_scheduler.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace ksp_plugin {
+
+void PredictionScheduler::SetPriority(std::string const& vessel_guid,
+                                      PredictionPriority const priority) {
+  if (priority == PredictionPriority::kBackground) {
+    priorities_.erase(vessel_guid);
+  } else {
+    priorities_[vessel_guid] = priority;
+  }
+}
+
+PredictionPriority PredictionScheduler::priority(
+    std::string const& vessel_guid) const {
+  auto const it = priorities_.find(vessel_guid);
+  return it == priorities_.end() ? PredictionPriority::kBackground
+                                 : it->second;
+}
+
+void PredictionScheduler::Remove(std::string const& vessel_guid) {
+  priorities_.erase(vessel_guid);
+}
+
+void PredictionScheduler::set_background_budget(int const background_budget) {
+  CHECK_LE(0, background_budget);
+  background_budget_ = background_budget;
+}
+
+int PredictionScheduler::background_budget() const {
+  return background_budget_;
+}
+
+std::vector<std::string> PredictionScheduler::Schedule(
+    std::vector<std::string> const& vessel_guids) {
+  std::vector<std::string> active;
+  std::vector<std::string> targeted_or_visible;
+  std::vector<std::string> background;
+  for (std::string const& vessel_guid : vessel_guids) {
+    switch (priority(vessel_guid)) {
+      case PredictionPriority::kActive:
+        active.push_back(vessel_guid);
+        break;
+      case PredictionPriority::kTargetedOrVisible:
+        targeted_or_visible.push_back(vessel_guid);
+        break;
+      case PredictionPriority::kBackground:
+        background.push_back(vessel_guid);
+        break;
+    }
+  }
+  DCHECK(std::is_sorted(background.begin(), background.end()));
+
+  std::vector<std::string> result;
+  result.reserve(vessel_guids.size());
+  result.insert(result.end(), active.begin(), active.end());
+  result.insert(result.end(),
+                targeted_or_visible.begin(),
+                targeted_or_visible.end());
+
+  // Resume the round-robin after the last background vessel, which may have
+  // been removed or given a higher priority since.
+  int const count =
+      std::min(background_budget_, static_cast<int>(background.size()));
+  std::size_t next = 0;
+  if (has_last_background_guid_) {
+    next = std::upper_bound(background.begin(),
+                            background.end(),
+                            last_background_guid_) - background.begin();
+  }
+  for (int i = 0; i < count; ++i, ++next) {
+    if (next == background.size()) {
+      next = 0;
+    }
+    result.push_back(background[next]);
+  }
+  if (count > 0) {
+    last_background_guid_ = result.back();
+    has_last_background_guid_ = true;
+  }
+  return result;
+}
+
+}  // namespace ksp_plugin
+}  // namespace principia
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace principia {
+namespace ksp_plugin {
+
+// The order in which the predictions of the vessels are refreshed.
+enum class PredictionPriority {
+  kActive,             // The active vessel.
+  kTargetedOrVisible,  // The target, and the vessels visible in map view.
+  kBackground,         // All the other vessels.
+};
+
+// Chooses, once per frame, the vessels whose predictions are refreshed, so
+// that the cost of the predictions is bounded when the number of vessels
+// grows.  The vessels of priority |kActive| or |kTargetedOrVisible| are
+// refreshed every frame; at most |background_budget()| vessels of priority
+// |kBackground| are refreshed per frame, in turn, so that each one is
+// refreshed every few frames.  The vessels are identified by their GUIDs, see
+// |Plugin|; those that have not been given a priority are in the background.
+class PredictionScheduler {
+ public:
+  PredictionScheduler() = default;
+  ~PredictionScheduler() = default;
+
+  PredictionScheduler(PredictionScheduler const&) = delete;
+  PredictionScheduler(PredictionScheduler&&) = delete;
+  PredictionScheduler& operator=(PredictionScheduler const&) = delete;
+  PredictionScheduler& operator=(PredictionScheduler&&) = delete;
+
+  void SetPriority(std::string const& vessel_guid,
+                   PredictionPriority const priority);
+  PredictionPriority priority(std::string const& vessel_guid) const;
+
+  // Forgets the priority of a vessel which has been removed.
+  void Remove(std::string const& vessel_guid);
+
+  // The number of background vessels refreshed per frame.  Must be
+  // nonnegative; 0 stops the background predictions.
+  void set_background_budget(int const background_budget);
+  int background_budget() const;
+
+  // Returns the vessels to refresh in this frame among |vessel_guids|, which
+  // must be sorted and distinct: those of priority |kActive|, then those of
+  // priority |kTargetedOrVisible|, then the next |background_budget()|
+  // background vessels in the order of their GUIDs, cyclically, after the
+  // last one returned by the previous call.  The order within a priority is
+  // that of |vessel_guids|.
+  std::vector<std::string> Schedule(
+      std::vector<std::string> const& vessel_guids);
+
+ private:
+  // The vessels that have a priority other than |kBackground|.
+  std::map<std::string, PredictionPriority> priorities_;
+  int background_budget_ = 1;
+  // The last background vessel returned by |Schedule|, if
+  // |has_last_background_guid_|.  It need not be one of the current vessels.
+  std::string last_background_guid_;
+  bool has_last_background_guid_ = false;
+};
+
+}  // namespace ksp_plugin
+}  // namespace principia
@@ -1,18 +1,31 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
+#include "geometry/epoch.hpp"
+#include "geometry/named_quantities.hpp"
 #include "ksp_plugin/celestial.hpp"
+#include "ksp_plugin/flight_plan.hpp"
 #include "ksp_plugin/vessel.hpp"
 #include "ksp_plugin/part.hpp"
 #include "physics/massless_body.hpp"
+#include "physics/synchronized_histories.hpp"
 #include "physics/trajectory.hpp"
+#include "physics/trajectory_compression.hpp"
 #include "quantities/named_quantities.hpp"
+#include "quantities/si.hpp"
 #include "serialization/ksp_plugin.pb.h"
 
+using principia::geometry::kJ2000;
+using principia::geometry::Velocity;
+using principia::physics::DecompressColumn;
 using principia::physics::MasslessBody;
+using principia::physics::SynchronizedHistories;
 using principia::physics::Trajectory;
 using principia::quantities::GravitationalParameter;
+using principia::si::Second;
 
 namespace principia {
 namespace ksp_plugin {
@@ -31,12 +44,21 @@ class Vessel {
   // ownership.
   explicit Vessel(not_null<Celestial const*> const parent);
 
-  // True if, and only if, |history_| is not null.
+  // True if, and only if, |history_| is not null or the history is deferred.
   bool is_synchronized() const;
   // True if, and only if, |prolongation_| is not null, i.e., if either
   // |CreateProlongation| or |CreateHistoryAndForkProlongation| was called at
-  // some point.
+  // some point, or the history is deferred.
   bool is_initialized() const;
+  // True if the history and prolongation read by |ReadFromMessage| have not
+  // been deserialized yet.  They are deserialized by the first call to one of
+  // the accessors below or to |ResetProlongation|.
+  bool has_deferred_history() const;
+
+  // Returns an estimate of the memory used by this vessel, its history and
+  // its forks, e.g., the prolongation and the predictions, or its deferred
+  // history, in bytes.  Does not deserialize the deferred history.
+  std::int64_t MemoryUsage() const;
 
   Celestial const& parent() const;
   void set_parent(not_null<Celestial const*> const parent);
@@ -45,6 +67,12 @@ class Vessel {
   Trajectory<Barycentric> const& history() const;
   not_null<Trajectory<Barycentric>*> mutable_history();
 
+  // Enables the downsampling of the history, see
+  // |Trajectory::set_downsampling|.  Requires |is_synchronized()|.  A deferred
+  // history is not deserialized, the downsampling is enabled when it is.
+  void set_history_downsampling(
+      Trajectory<Barycentric>::Downsampling const& downsampling);
+
   // Both accessors require |is_initialized()|.
   Trajectory<Barycentric> const& prolongation() const;
   not_null<Trajectory<Barycentric>*> mutable_prolongation();
@@ -68,13 +96,72 @@ class Vessel {
       Instant const& time,
       DegreesOfFreedom<Barycentric> const& degrees_of_freedom);
 
-  // Deletes the |prolongation_| and forks a new one at |time|.
+  // Creates a flight plan from the last point of the prolongation to
+  // |final_time|, replacing any existing one.  The other parameters are as for
+  // the constructor of |FlightPlan|.  The vessel must satisfy
+  // |is_initialized()|.  The flight plan is not serialized.
+  void CreateFlightPlan(
+      Instant const& final_time,
+      not_null<std::unique_ptr<Ephemeris<Barycentric>>> ephemeris,
+      SymplecticIntegrator<Length, Speed> const& integrator,
+      Time const& Δt);
+  // Returns the flight plan, or null if there is none, and leaves the vessel
+  // without one.  The caller decides when and where to destroy it.
+  std::unique_ptr<FlightPlan> DetachFlightPlan();
+  bool has_flight_plan() const;
+  // Both accessors require |has_flight_plan()|.
+  FlightPlan const& flight_plan() const;
+  not_null<FlightPlan*> mutable_flight_plan();
+
+  // Detaches the observers of the history, of the prolongation and of the
+  // flight plan, see |Trajectory::PrepareForReclaim|.  Must be called before
+  // the vessel is destroyed on a thread other than that of the observers.
+  void PrepareForReclaim();
+
+  // Makes the |prolongation_| a fork of the history at |time|, reusing it, see
+  // |Trajectory::ResetFork|.  If the vessel has bubble histories, the
+  // prolongation is instead forked at the last point of |history_| and starts
+  // with the last row of the bubble histories, which must be at |time|.
   // The vessel must satisfy |is_synchronized()| and |is_initialized()|,
   // |owned_prolongation_| must be null.
   void ResetProlongation(Instant const& time);
 
-  // The vessel must satisfy |is_initialized()|.
+  // While the vessel is in the physics bubble, the points of its history are
+  // not appended to |history_|, but kept in |*bubble_histories|, which is
+  // shared by the vessels of the bubble: column 0 holds the degrees of freedom
+  // of the centre of mass of the bubble, and |column| the offsets of this
+  // vessel from it, stored as degrees of freedom relative to
+  // |Barycentric::origin| at rest.  The rows at or before the last point of
+  // |history_| are ignored.  The vessel must satisfy |is_synchronized()|.  If
+  // the vessel already had other bubble histories they are materialized
+  // first.
+  void SetBubbleHistories(
+      std::shared_ptr<SynchronizedHistories<Barycentric> const> const&
+          bubble_histories,
+      int const column);
+  // Materializes the bubble histories, if any, and stops using them, e.g.,
+  // when the vessel leaves the bubble.
+  void ClearBubbleHistories();
+  bool has_bubble_histories() const;
+  // Appends to |history_| the points of the bubble histories that are before
+  // the first point of the prolongation, and the first point of the
+  // prolongation if it is one of them, see |Trajectory::SpliceFork|; the
+  // children of the prolongation are kept.  Called by the accessors of the
+  // history and by the serialization, it is also needed before evaluating the
+  // prolongation between its fork point and its first point.  Does nothing if
+  // there are no bubble histories.
+  void MaterializeBubbleHistory() const;
+
+  // The vessel must satisfy |is_initialized()|.  A deferred history is copied
+  // to |message| without being deserialized.
   void WriteToMessage(not_null<serialization::Vessel*> const message) const;
+  // Same as |WriteToMessage|, except that if the history starts before |since|
+  // it is written as an increment over its points at or before |since|, see
+  // |Trajectory::WriteIncrementToMessage|.  A deferred history, which has not
+  // changed since it was read, is written as an increment without points.
+  void WriteIncrementToMessage(
+      Instant const& since,
+      not_null<serialization::Vessel*> const message) const;
   // NOTE(egg): This should return a |not_null|, but we can't do that until
   // |not_null<std::unique_ptr<T>>| is convertible to |std::unique_ptr<T>|, and
   // that requires a VS 2015 feature (rvalue references for |*this|).
@@ -83,23 +170,55 @@ class Vessel {
       not_null<Celestial const*> const parent);
 
  private:
+  // Deserializes |deferred_history_and_prolongation_| into |history_| and
+  // |prolongation_| if it is not null, and nulls it.
+  void DeserializeDeferredHistory() const;
+  // The time of the last point of the timeline of the history in
+  // |deferred_history_and_prolongation_|, which must not be null, without
+  // deserializing it.  The timeline must not be empty.
+  Instant DeferredHistoryLastTime() const;
+  // The degrees of freedom of this vessel at the time of row |index| of
+  // |bubble_histories_|, which must not be null.
+  DegreesOfFreedom<Barycentric> BubbleDegreesOfFreedom(
+      std::size_t const index) const;
+
   MasslessBody const body_;
   // The parent body for the 2-body approximation. Not owning.
   not_null<Celestial const*> parent_;
   // The past and present trajectory of the body. It ends at |HistoryTime()|
   // unless |*this| was created after |HistoryTime()|, in which case it ends
   // at |current_time_|.  It is advanced with a constant time step.
-  std::unique_ptr<Trajectory<Barycentric>> history_;
+  // Mutable because it is deserialized lazily by the const accessors.
+  mutable std::unique_ptr<Trajectory<Barycentric>> history_;
   // Most of the time, this is a child trajectory of |*history_|. It is forked
   // at |history_->last_time()| and continues until |current_time_|. It is
   // computed with a non-constant timestep, which breaks symplecticity.
   // If |history_| is null, this points to |owned_prolongation_| instead.
   // Not owning.
-  Trajectory<Barycentric>* prolongation_ = nullptr;
+  mutable Trajectory<Barycentric>* prolongation_ = nullptr;
   // When the vessel is added, before it is synchonized with the other vessels
   // and celestials, there is no |history_|.  The prolongation is directly owned
   // during that time.  Null if, and only if, |history_| is not null.
   std::unique_ptr<Trajectory<Barycentric>> owned_prolongation_;
+  // The history and prolongation of a synchronized vessel read by
+  // |ReadFromMessage|, kept serialized until they are first used: rebuilding a
+  // trajectory inserts each of its points in a map, which is wasted for the
+  // many vessels that are never rendered before the next save.  If not null,
+  // |history_| and |prolongation_| are null.
+  mutable std::unique_ptr<serialization::HistoryAndProlongation>
+      deferred_history_and_prolongation_;
+  // The downsampling to enable when the deferred history is deserialized, or
+  // null.
+  mutable std::unique_ptr<Trajectory<Barycentric>::Downsampling>
+      deferred_downsampling_;
+  // Null unless the vessel is in the physics bubble, see
+  // |SetBubbleHistories|.  While it is not null, |history_| is not null and
+  // |prolongation_| is forked at its last point.
+  std::shared_ptr<SynchronizedHistories<Barycentric> const> bubble_histories_;
+  int bubble_column_ = 0;
+  // Independent from the other trajectories, since it starts from its own
+  // copy of the state of the vessel.
+  std::unique_ptr<FlightPlan> flight_plan_;
 };
 
 }  // namespace ksp_plugin
@@ -10,7 +10,8 @@ inline Vessel::Vessel(not_null<Celestial const*> const parent)
       parent_(parent) {}
 
 inline bool Vessel::is_synchronized() const {
-  bool const synchronized = history_ != nullptr;
+  bool const synchronized =
+      history_ != nullptr || deferred_history_and_prolongation_ != nullptr;
   if (synchronized) {
     CHECK(owned_prolongation_ == nullptr);
   }
@@ -18,13 +19,35 @@ inline bool Vessel::is_synchronized() const {
 }
 
 inline bool Vessel::is_initialized() const {
-  bool const initialized = prolongation_ != nullptr;
+  bool const initialized =
+      prolongation_ != nullptr || deferred_history_and_prolongation_ != nullptr;
   if (!initialized) {
     CHECK(owned_prolongation_ == nullptr);
   }
   return initialized;
 }
 
+inline bool Vessel::has_deferred_history() const {
+  return deferred_history_and_prolongation_ != nullptr;
+}
+
+inline std::int64_t Vessel::MemoryUsage() const {
+  std::int64_t usage = sizeof(Vessel);
+  if (history_ != nullptr) {
+    usage += history_->MemoryUsage();
+  }
+  if (owned_prolongation_ != nullptr) {
+    usage += owned_prolongation_->MemoryUsage();
+  }
+  if (deferred_history_and_prolongation_ != nullptr) {
+    usage += deferred_history_and_prolongation_->SpaceUsed();
+  }
+  if (deferred_downsampling_ != nullptr) {
+    usage += sizeof(Trajectory<Barycentric>::Downsampling);
+  }
+  return usage;
+}
+
 inline Celestial const& Vessel::parent() const {
   return *parent_;
 }
@@ -35,21 +58,39 @@ inline void Vessel::set_parent(not_null<Celestial const*> const parent) {
 
 inline Trajectory<Barycentric> const& Vessel::history() const {
   CHECK(is_synchronized());
+  DeserializeDeferredHistory();
+  MaterializeBubbleHistory();
   return *history_;
 }
 
 inline not_null<Trajectory<Barycentric>*> Vessel::mutable_history() {
   CHECK(is_synchronized());
+  DeserializeDeferredHistory();
+  MaterializeBubbleHistory();
   return history_.get();
 }
 
+inline void Vessel::set_history_downsampling(
+    Trajectory<Barycentric>::Downsampling const& downsampling) {
+  CHECK(is_synchronized());
+  if (deferred_history_and_prolongation_ == nullptr) {
+    history_->set_downsampling(downsampling);
+  } else {
+    CHECK(deferred_downsampling_ == nullptr);
+    deferred_downsampling_ =
+        std::make_unique<Trajectory<Barycentric>::Downsampling>(downsampling);
+  }
+}
+
 inline Trajectory<Barycentric> const& Vessel::prolongation() const {
   CHECK(is_initialized());
+  DeserializeDeferredHistory();
   return *prolongation_;
 }
 
 inline not_null<Trajectory<Barycentric>*> Vessel::mutable_prolongation() {
   CHECK(is_initialized());
+  DeserializeDeferredHistory();
   return prolongation_;
 }
 
@@ -74,19 +115,140 @@ inline void Vessel::CreateHistoryAndForkProlongation(
   owned_prolongation_.reset();
 }
 
+inline void Vessel::CreateFlightPlan(
+    Instant const& final_time,
+    not_null<std::unique_ptr<Ephemeris<Barycentric>>> ephemeris,
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    Time const& Δt) {
+  CHECK(is_initialized());
+  Trajectory<Barycentric> const& prolongation = this->prolongation();
+  flight_plan_ = std::make_unique<FlightPlan>(
+      prolongation.last().time(),
+      prolongation.last().degrees_of_freedom(),
+      final_time,
+      std::move(ephemeris),
+      integrator,
+      Δt);
+}
+
+inline std::unique_ptr<FlightPlan> Vessel::DetachFlightPlan() {
+  return std::move(flight_plan_);
+}
+
+inline bool Vessel::has_flight_plan() const {
+  return flight_plan_ != nullptr;
+}
+
+inline FlightPlan const& Vessel::flight_plan() const {
+  CHECK(has_flight_plan());
+  return *flight_plan_;
+}
+
+inline not_null<FlightPlan*> Vessel::mutable_flight_plan() {
+  CHECK(has_flight_plan());
+  return flight_plan_.get();
+}
+
+inline void Vessel::PrepareForReclaim() {
+  // A deferred history has no observers.
+  if (history_ != nullptr) {
+    history_->PrepareForReclaim();
+  }
+  if (owned_prolongation_ != nullptr) {
+    owned_prolongation_->PrepareForReclaim();
+  }
+  if (flight_plan_ != nullptr) {
+    flight_plan_->PrepareForReclaim();
+  }
+}
+
 inline void Vessel::ResetProlongation(Instant const& time) {
   CHECK(is_initialized());
   CHECK(is_synchronized());
   CHECK(owned_prolongation_ == nullptr);
-  history_->DeleteFork(&prolongation_);
-  prolongation_ = history_->NewFork(time);
+  DeserializeDeferredHistory();
+  if (bubble_histories_ == nullptr) {
+    history_->ResetFork(prolongation_, time);
+  } else {
+    CHECK_EQ(bubble_histories_->last_time(), time);
+    history_->ResetFork(prolongation_, history_->last().time());
+    prolongation_->Append(
+        time,
+        BubbleDegreesOfFreedom(bubble_histories_->size() - 1));
+  }
+}
+
+inline void Vessel::SetBubbleHistories(
+    std::shared_ptr<SynchronizedHistories<Barycentric> const> const&
+        bubble_histories,
+    int const column) {
+  CHECK(is_synchronized());
+  CHECK_NOTNULL(bubble_histories.get());
+  CHECK_LT(0, column);
+  CHECK_LT(column, bubble_histories->number_of_bodies());
+  if (bubble_histories == bubble_histories_) {
+    CHECK_EQ(column, bubble_column_);
+    return;
+  }
+  DeserializeDeferredHistory();
+  MaterializeBubbleHistory();
+  bubble_histories_ = bubble_histories;
+  bubble_column_ = column;
+}
+
+inline void Vessel::ClearBubbleHistories() {
+  MaterializeBubbleHistory();
+  bubble_histories_.reset();
+}
+
+inline bool Vessel::has_bubble_histories() const {
+  return bubble_histories_ != nullptr;
+}
+
+inline void Vessel::MaterializeBubbleHistory() const {
+  if (bubble_histories_ == nullptr) {
+    return;
+  }
+  SynchronizedHistories<Barycentric> const& bubble_histories =
+      *bubble_histories_;
+  Instant const last_time = history_->last().time();
+  // The first point of the prolongation after its fork point.
+  auto first = prolongation_->on_or_after(last_time);
+  ++first;
+  if (first.at_end()) {
+    return;
+  }
+  std::size_t index = bubble_histories.LowerBound(last_time);
+  if (index < bubble_histories.size() &&
+      bubble_histories.time(index) == last_time) {
+    ++index;
+  }
+  Trajectory<Barycentric>::Points gap;
+  for (; index < bubble_histories.size() &&
+         bubble_histories.time(index) < first.time();
+       ++index) {
+    gap.emplace_back(bubble_histories.time(index),
+                     BubbleDegreesOfFreedom(index));
+  }
+  // The first point of the prolongation is one of the rows after
+  // |ResetProlongation|, but not if it was materialized since.
+  if (index < bubble_histories.size() &&
+      bubble_histories.time(index) == first.time()) {
+    history_->SpliceFork(prolongation_, gap, first.time());
+  } else {
+    CHECK(gap.empty());
+  }
 }
 
 inline void Vessel::WriteToMessage(
     not_null<serialization::Vessel*> const message) const {
   CHECK(is_initialized());
+  MaterializeBubbleHistory();
   body_.WriteToMessage(message->mutable_body());
-  if (is_synchronized()) {
+  if (deferred_history_and_prolongation_ != nullptr) {
+    *message->mutable_history_and_prolongation() =
+        *deferred_history_and_prolongation_;
+  } else if (is_synchronized()) {
     history_->WriteToMessage(
         message->mutable_history_and_prolongation()->mutable_history());
     prolongation_->WritePointerToMessage(
@@ -96,6 +258,36 @@ inline void Vessel::WriteToMessage(
   }
 }
 
+inline void Vessel::WriteIncrementToMessage(
+    Instant const& since,
+    not_null<serialization::Vessel*> const message) const {
+  CHECK(is_initialized());
+  MaterializeBubbleHistory();
+  if (deferred_history_and_prolongation_ != nullptr &&
+      DeferredHistoryLastTime() <= since) {
+    body_.WriteToMessage(message->mutable_body());
+    auto* const history_and_prolongation =
+        message->mutable_history_and_prolongation();
+    *history_and_prolongation = *deferred_history_and_prolongation_;
+    auto* const history = history_and_prolongation->mutable_history();
+    history->clear_columns();
+    history->clear_compressed_columns();
+    history->clear_timeline();
+    since.WriteToMessage(history->mutable_increment_since());
+  } else if (deferred_history_and_prolongation_ == nullptr &&
+             is_synchronized() &&
+             history_->first().time() < since) {
+    body_.WriteToMessage(message->mutable_body());
+    history_->WriteIncrementToMessage(
+        since,
+        message->mutable_history_and_prolongation()->mutable_history());
+    prolongation_->WritePointerToMessage(
+        message->mutable_history_and_prolongation()->mutable_prolongation());
+  } else {
+    WriteToMessage(message);
+  }
+}
+
 inline std::unique_ptr<Vessel> Vessel::ReadFromMessage(
     serialization::Vessel const& message,
     not_null<Celestial const*> const parent) {
@@ -103,13 +295,11 @@ inline std::unique_ptr<Vessel> Vessel::ReadFromMessage(
   // NOTE(egg): for now we do not read the |MasslessBody| as it can contain no
   // information.
   if (message.has_history_and_prolongation()) {
-    vessel->history_ =
-        Trajectory<Barycentric>::ReadFromMessage(
-            message.history_and_prolongation().history(), &vessel->body_);
-    vessel->prolongation_ =
-        Trajectory<Barycentric>::ReadPointerFromMessage(
-            message.history_and_prolongation().prolongation(),
-            vessel->history_.get());
+    // Copying the message is cheap compared to rebuilding the trajectories,
+    // especially when their timelines are compressed.
+    vessel->deferred_history_and_prolongation_ =
+        std::make_unique<serialization::HistoryAndProlongation>(
+            message.history_and_prolongation());
   } else if (message.has_owned_prolongation()) {
     vessel->owned_prolongation_ =
         Trajectory<Barycentric>::ReadFromMessage(message.owned_prolongation(),
@@ -122,5 +312,54 @@ inline std::unique_ptr<Vessel> Vessel::ReadFromMessage(
   return vessel;
 }
 
+inline void Vessel::DeserializeDeferredHistory() const {
+  if (deferred_history_and_prolongation_ == nullptr) {
+    return;
+  }
+  history_ = Trajectory<Barycentric>::ReadFromMessage(
+                 deferred_history_and_prolongation_->history(), &body_);
+  prolongation_ = Trajectory<Barycentric>::ReadPointerFromMessage(
+                      deferred_history_and_prolongation_->prolongation(),
+                      history_.get());
+  deferred_history_and_prolongation_.reset();
+  if (deferred_downsampling_ != nullptr) {
+    history_->set_downsampling(*deferred_downsampling_);
+    deferred_downsampling_.reset();
+  }
+}
+
+inline Instant Vessel::DeferredHistoryLastTime() const {
+  CHECK_NOTNULL(deferred_history_and_prolongation_.get());
+  serialization::Trajectory const& history =
+      deferred_history_and_prolongation_->history();
+  double t;
+  if (history.has_columns()) {
+    CHECK_LT(0, history.columns().t_size());
+    t = history.columns().t(history.columns().t_size() - 1);
+  } else if (history.has_compressed_columns()) {
+    // Only the time column is decompressed.
+    google::protobuf::RepeatedField<double> times;
+    CHECK_LT(0, history.compressed_columns().size());
+    DecompressColumn(history.compressed_columns().t(),
+                     history.compressed_columns().size(),
+                     &times);
+    t = times.Get(times.size() - 1);
+  } else {
+    CHECK_LT(0, history.timeline_size());
+    return Instant::ReadFromMessage(
+        history.timeline(history.timeline_size() - 1).instant());
+  }
+  return kJ2000 + t * Second;
+}
+
+inline DegreesOfFreedom<Barycentric> Vessel::BubbleDegreesOfFreedom(
+    std::size_t const index) const {
+  DegreesOfFreedom<Barycentric> const origin(Barycentric::origin,
+                                             Velocity<Barycentric>());
+  return bubble_histories_->degrees_of_freedom(index, 0) +
+         (bubble_histories_->degrees_of_freedom(index, bubble_column_) -
+          origin);
+}
+
 }  // namespace ksp_plugin
 }  // namespace principia
@@ -24,14 +24,41 @@ public partial class PluginAdapter : UnityEngine.MonoBehaviour {
   // render as 10 segments from the actual data, with extra overhead for
   // the evaluation of the cubic).
   private const int kLinePoints = 10000;
+  // The angle, as seen from the map camera, by which the rendered trajectory
+  // may deviate from the history, in radians.  Roughly a pixel.
+  private const double kRenderingAngularTolerance = 1e-3;
+  // The number of orbital periods of the active vessel over which its history
+  // is rendered.  The whole history is rendered if the orbit is not closed.
+  private const double kRenderedOrbits = 2;
 
   private const int kGUIQueueSpot = 3;
 
+  private const String kPluginSaveFilename = "principia_plugin.bin";
+  private const String kKernelConfigurationFilename = "principia_kernels.bin";
+
   private UnityEngine.Rect main_window_rectangle_;
   private IntPtr plugin_ = IntPtr.Zero;
   // TODO(egg): rendering only one trajectory at the moment.
   private VectorLine rendered_trajectory_;
+  // A buffer for the segments fetched from the native code, reused from frame
+  // to frame.
+  private LineSegment[] rendered_segments_;
+  // The handles of the vessels in |plugin_|, which avoid passing their GUIDs
+  // at every frame.  Invalidated when a vessel is removed from the plugin, so
+  // refreshed whenever a vessel is (re)inserted.
+  private Dictionary<Guid, Int64> vessel_handles_ =
+      new Dictionary<Guid, Int64>();
+  // The rendering transforms, owned by |plugin_|, which returns the same
+  // object whenever a frame is selected again.
   private IntPtr transforms_ = IntPtr.Zero;
+  // The save of |plugin_| in progress, if any.  The file is written on a
+  // background thread; we poll for its completion in |FixedUpdate|.
+  private IntPtr plugin_save_ = IntPtr.Zero;
+  // The vessels in the physics bubble and their parts, reused from frame to
+  // frame.
+  private List<String> bubble_vessel_guids_ = new List<String>();
+  private List<int> bubble_part_counts_ = new List<int>();
+  private List<KSPPart> bubble_parts_ = new List<KSPPart>();
   private int first_selected_celestial_ = 0;
   private int second_selected_celestial_ = 0;
 
@@ -103,11 +130,34 @@ where is_in_physics_bubble(vessel)
     }
   }
 
-  private void UpdateBody(CelestialBody body, double universal_time) {
-    UpdateCelestialHierarchy(plugin_,
-                             body.flightGlobalsIndex,
-                             body.orbit.referenceBody.flightGlobalsIndex);
-    QP from_parent = CelestialFromParent(plugin_, body.flightGlobalsIndex);
+  // Updates all the bodies from the plugin.  The states of all the bodies are
+  // fetched in a single call, once the hierarchy is up to date.
+  private void UpdateBodies(double universal_time) {
+    ApplyToBodyTree(body => UpdateCelestialHierarchy(
+                                plugin_,
+                                body.flightGlobalsIndex,
+                                body.orbit.referenceBody.flightGlobalsIndex));
+    // The plugin returns the states in increasing order of index, but the
+    // bodies are updated in tree order, parents first.
+    int[] indices = (from body in FlightGlobals.Bodies
+                     where body != Planetarium.fetch.Sun
+                     orderby body.flightGlobalsIndex
+                     select body.flightGlobalsIndex).ToArray();
+    QP[] from_parents = new QP[indices.Length];
+    AllCelestialsFromParent(plugin_, indices.Length, from_parents);
+    Dictionary<int, QP> index_to_from_parent = new Dictionary<int, QP>();
+    for (int i = 0; i < indices.Length; ++i) {
+      index_to_from_parent.Add(indices[i], from_parents[i]);
+    }
+    ApplyToBodyTree(body => UpdateBody(
+                                body,
+                                index_to_from_parent[body.flightGlobalsIndex],
+                                universal_time));
+  }
+
+  private void UpdateBody(CelestialBody body,
+                          QP from_parent,
+                          double universal_time) {
     // TODO(egg): Some of this might be be superfluous and redundant.
     Orbit original = body.orbit;
     Orbit copy = new Orbit(original.inclination, original.eccentricity,
@@ -136,7 +186,7 @@ where is_in_physics_bubble(vessel)
                                       universal_time);
   }
 
-  private void UpdateVessel(Vessel vessel, double universal_time) {
+  private void KeepVessel(Vessel vessel) {
     bool inserted = InsertOrKeepVessel(
         plugin_,
         vessel.id.ToString(),
@@ -147,18 +197,36 @@ where is_in_physics_bubble(vessel)
                            from_parent : new QP{q = (XYZ)vessel.orbit.pos,
                                                 p = (XYZ)vessel.orbit.vel});
     }
-    QP from_parent = VesselFromParent(plugin_, vessel.id.ToString());
-    // NOTE(egg): Here we work around a KSP bug: |Orbit.pos| for a vessel
-    // corresponds to the position one timestep in the future.  This is not
-    // the case for celestial bodies.
-    vessel.orbit.UpdateFromStateVectors(
-        pos     : (Vector3d)from_parent.q +
-                  (Vector3d)from_parent.p * UnityEngine.Time.deltaTime,
-        vel     : (Vector3d)from_parent.p,
-        refBody : vessel.orbit.referenceBody,
-        UT      : universal_time);
+    if (inserted || !vessel_handles_.ContainsKey(vessel.id)) {
+      vessel_handles_[vessel.id] = VesselHandle(plugin_, vessel.id.ToString());
+    }
   }
 
+  // Updates the orbits of all the |vessels|, which must have been kept, with a
+  // single query to the plugin.
+  private void UpdateVessels(List<Vessel> vessels, double universal_time) {
+    Int64[] handles =
+        (from vessel in vessels select vessel_handles_[vessel.id]).ToArray();
+    QP[] from_parents = new QP[vessels.Count];
+    VesselsFromParentByHandle(plugin_, handles, vessels.Count, from_parents);
+    for (int i = 0; i < vessels.Count; ++i) {
+      Vessel vessel = vessels[i];
+      QP from_parent = from_parents[i];
+      // NOTE(egg): Here we work around a KSP bug: |Orbit.pos| for a vessel
+      // corresponds to the position one timestep in the future.  This is not
+      // the case for celestial bodies.
+      vessel.orbit.UpdateFromStateVectors(
+          pos     : (Vector3d)from_parent.q +
+                    (Vector3d)from_parent.p * UnityEngine.Time.deltaTime,
+          vel     : (Vector3d)from_parent.p,
+          refBody : vessel.orbit.referenceBody,
+          UT      : universal_time);
+    }
+  }
+
+  // Collects the parts of |vessel| in |bubble_vessel_guids_|,
+  // |bubble_part_counts_| and |bubble_parts_|, which are passed to the plugin
+  // in a single call by |AddVesselsToPhysicsBubble|.
   private void AddToPhysicsBubble(Vessel vessel) {
     Vector3d gravity =
         FlightGlobals.getGeeForceAtPosition(vessel.findWorldCenterOfMass());
@@ -187,13 +255,25 @@ where is_in_physics_bubble(vessel)
                              from_parent : new QP{q = (XYZ)vessel.orbit.pos,
                                                   p = (XYZ)vessel.orbit.vel});
       }
-      AddVesselToNextPhysicsBubble(plugin      : plugin_,
-                                   vessel_guid : vessel.id.ToString(),
-                                   parts       : parts,
-                                   count       : parts.Count());
+      bubble_vessel_guids_.Add(vessel.id.ToString());
+      bubble_part_counts_.Add(parts.Length);
+      bubble_parts_.AddRange(parts);
     }
   }
 
+  private void AddVesselsToPhysicsBubble() {
+    bubble_vessel_guids_.Clear();
+    bubble_part_counts_.Clear();
+    bubble_parts_.Clear();
+    ApplyToVesselsInPhysicsBubble(AddToPhysicsBubble);
+    AddVesselsToNextPhysicsBubble(
+        plugin       : plugin_,
+        vessel_guids : bubble_vessel_guids_.ToArray(),
+        part_counts  : bubble_part_counts_.ToArray(),
+        vessel_count : bubble_vessel_guids_.Count,
+        parts        : bubble_parts_.ToArray());
+  }
+
   private bool is_in_space(Vessel vessel) {
     return vessel.state != Vessel.State.DEAD &&
            (vessel.situation == Vessel.Situations.SUB_ORBITAL ||
@@ -255,6 +335,10 @@ where is_in_physics_bubble(vessel)
   }
 
   private void FixedUpdate() {
+    if (plugin_save_ != IntPtr.Zero && PluginSaveCompleted(plugin_save_)) {
+      DeletePluginSave(ref plugin_save_);
+      Log.Info("Plugin saved to " + kPluginSaveFilename);
+    }
     if (PluginRunning()) {
       double universal_time = Planetarium.GetUniversalTime();
       double plugin_time = current_time(plugin_);
@@ -266,12 +350,16 @@ where is_in_physics_bubble(vessel)
       }
       time_is_advancing_ = true;
       if (has_inertial_physics_bubble_in_space()) {
-        ApplyToVesselsInPhysicsBubble(AddToPhysicsBubble);
+        AddVesselsToPhysicsBubble();
       }
       AdvanceTime(plugin_, universal_time, Planetarium.InverseRotAngle);
-      ApplyToBodyTree(body => UpdateBody(body, universal_time));
-      ApplyToVesselsOnRailsOrInInertialPhysicsBubbleInSpace(
-          vessel => UpdateVessel(vessel, universal_time));
+      UpdateBodies(universal_time);
+      List<Vessel> vessels_to_update = new List<Vessel>();
+      ApplyToVesselsOnRailsOrInInertialPhysicsBubbleInSpace(vessel => {
+        KeepVessel(vessel);
+        vessels_to_update.Add(vessel);
+      });
+      UpdateVessels(vessels_to_update, universal_time);
       Vessel active_vessel = FlightGlobals.ActiveVessel;
       if (!PhysicsBubbleIsEmpty(plugin_)) {
         Vector3d displacement_offset =
@@ -307,34 +395,48 @@ where is_in_physics_bubble(vessel)
         }
         IntPtr trajectory_iterator = IntPtr.Zero;
         try {
+          double camera_distance =
+              (ScaledSpace.ScaledToLocalSpace(
+                   PlanetariumCamera.Camera.transform.position) -
+               active_vessel.GetWorldPos3D()).magnitude;
+          double period = active_vessel.orbit.period;
+          double begin_time =
+              double.IsNaN(period) || double.IsInfinity(period)
+                  ? double.NegativeInfinity
+                  : current_time(plugin_) - kRenderedOrbits * period;
           trajectory_iterator = RenderedVesselTrajectory(
               plugin_,
               active_vessel.id.ToString(),
               transforms_,
-              (XYZ)Planetarium.fetch.Sun.position);
-
-          LineSegment segment;
-          int index_in_line_points = kLinePoints -
-              NumberOfSegments(trajectory_iterator) * 2;
-          while (index_in_line_points < 0) {
-            FetchAndIncrement(trajectory_iterator);
-            index_in_line_points += 2;
+              (XYZ)Planetarium.fetch.Sun.position,
+              kRenderingAngularTolerance * camera_distance,
+              begin_time);
+
+          int number_of_segments = NumberOfSegments(trajectory_iterator);
+          if (rendered_segments_ == null ||
+              rendered_segments_.Length < number_of_segments) {
+            rendered_segments_ = new LineSegment[number_of_segments];
           }
+          // The segments are fetched in a single call, the blittable array is
+          // pinned and filled in place by the native code.
+          int fetched = FetchSegments(trajectory_iterator,
+                                      number_of_segments,
+                                      rendered_segments_);
+          int first_segment = Math.Max(0, fetched - kLinePoints / 2);
+          int index_in_line_points =
+              kLinePoints - (fetched - first_segment) * 2;
           if (rendered_trajectory_ == null) {
             ResetRenderedTrajectory();
           }
-          while (!AtEnd(trajectory_iterator)) {
-            segment = FetchAndIncrement(trajectory_iterator);
+          for (int i = first_segment; i < fetched; ++i) {
             // TODO(egg): should we do the |LocalToScaledSpace| conversion in
             // native code?
-            // TODO(egg): could we directly assign to
-            // |rendered_trajectory_.points3| from C++ using unsafe code and
-            // something like the following?
-            // |fixed (UnityEngine.Vector3* pts = rendered_trajectory_.points3)|
             rendered_trajectory_.points3[index_in_line_points++] =
-                ScaledSpace.LocalToScaledSpace((Vector3d)segment.begin);
+                ScaledSpace.LocalToScaledSpace(
+                    (Vector3d)rendered_segments_[i].begin);
             rendered_trajectory_.points3[index_in_line_points++] =
-                ScaledSpace.LocalToScaledSpace((Vector3d)segment.end);
+                ScaledSpace.LocalToScaledSpace(
+                    (Vector3d)rendered_segments_[i].end);
           }
         } finally {
           DeleteLineAndIterator(ref trajectory_iterator);
@@ -375,8 +477,14 @@ where is_in_physics_bubble(vessel)
   }
 
   private void Cleanup() {
+    if (plugin_save_ != IntPtr.Zero) {
+      // Waits for the file to be written.
+      DeletePluginSave(ref plugin_save_);
+    }
     DeletePlugin(ref plugin_);
-    DeleteTransforms(ref transforms_);
+    vessel_handles_.Clear();
+    // Deleted with |plugin_|.
+    transforms_ = IntPtr.Zero;
     DestroyRenderedTrajectory();
   }
 
@@ -393,6 +501,15 @@ where is_in_physics_bubble(vessel)
       if (UnityEngine.GUILayout.Button(text : "Stop Plugin")) {
         Cleanup();
       }
+      if (plugin_save_ == IntPtr.Zero) {
+        if (UnityEngine.GUILayout.Button(text : "Save Plugin")) {
+          // Only the copy of the state of the plugin is done here, the rest of
+          // the save happens in the background.
+          plugin_save_ = StartWritingPluginToFile(plugin_, kPluginSaveFilename);
+        }
+      } else {
+        UnityEngine.GUILayout.TextArea(text : "Saving plugin...");
+      }
     } else {
       if (UnityEngine.GUILayout.Button(text : "Start Plugin")) {
         ResetPlugin();
@@ -577,6 +694,13 @@ where is_in_physics_bubble(vessel)
       Log.SetBufferedLogging(Math.Min(Log.GetBufferedLogging() + 1, 3));
     }
     UnityEngine.GUILayout.EndHorizontal();
+    bool asynchronous_logging = Log.GetAsynchronousLogging();
+    if (UnityEngine.GUILayout.Toggle(
+            value : asynchronous_logging,
+            text  : "Write the log files on a background thread") !=
+        asynchronous_logging) {
+      Log.SetAsynchronousLogging(!asynchronous_logging);
+    }
   }
 
   private void ShrinkMainWindow() {
@@ -585,13 +709,12 @@ where is_in_physics_bubble(vessel)
   }
 
   private void UpdateRenderingFrame() {
-    DeleteTransforms(ref transforms_);
     if (first_selected_celestial_ == second_selected_celestial_) {
-      transforms_ = NewBodyCentredNonRotatingTransforms(
+      transforms_ = BodyCentredNonRotatingTransforms(
                         plugin_,
                         first_selected_celestial_);
     } else {
-      transforms_ = NewBarycentricRotatingTransforms(
+      transforms_ = BarycentricRotatingTransforms(
                         plugin_,
                         first_selected_celestial_,
                         second_selected_celestial_);
@@ -608,33 +731,52 @@ where is_in_physics_bubble(vessel)
                         Planetarium.fetch.Sun.flightGlobalsIndex,
                         Planetarium.fetch.Sun.gravParameter,
                         Planetarium.InverseRotAngle);
+    List<int> celestial_indices = new List<int>();
+    List<double> gravitational_parameters = new List<double>();
+    List<int> parent_indices = new List<int>();
+    List<QP> from_parents = new List<QP>();
     BodyProcessor insert_body = body => {
       Log.Info("Inserting " + body.name + "...");
-      InsertCelestial(plugin_,
-                      body.flightGlobalsIndex,
-                      body.gravParameter,
-                      body.orbit.referenceBody.flightGlobalsIndex,
-                      new QP{q = (XYZ)body.orbit.pos, p = (XYZ)body.orbit.vel});
+      celestial_indices.Add(body.flightGlobalsIndex);
+      gravitational_parameters.Add(body.gravParameter);
+      parent_indices.Add(body.orbit.referenceBody.flightGlobalsIndex);
+      from_parents.Add(
+          new QP{q = (XYZ)body.orbit.pos, p = (XYZ)body.orbit.vel});
     };
     ApplyToBodyTree(insert_body);
+    InsertCelestials(plugin_,
+                     celestial_indices.ToArray(),
+                     gravitational_parameters.ToArray(),
+                     parent_indices.ToArray(),
+                     from_parents.ToArray(),
+                     celestial_indices.Count);
     EndInitialization(plugin_);
+    TuneKernels(plugin_, kKernelConfigurationFilename);
     UpdateRenderingFrame();
+    // The vessels are inserted with a single call.
+    List<Vessel> vessels = new List<Vessel>();
+    List<String> vessel_guids = new List<String>();
+    List<int> vessel_parent_indices = new List<int>();
+    List<QP> vessel_from_parents = new List<QP>();
     VesselProcessor insert_vessel = vessel => {
       Log.Info("Inserting " + vessel.name + "...");
-      bool inserted =
-          InsertOrKeepVessel(plugin_,
-                             vessel.id.ToString(),
-                             vessel.orbit.referenceBody.flightGlobalsIndex);
-      if (!inserted) {
-        Log.Fatal("Plugin initialization: vessel not inserted");
-      } else {
-        SetVesselStateOffset(plugin_,
-                             vessel.id.ToString(),
-                             new QP{q = (XYZ)vessel.orbit.pos,
-                                    p = (XYZ)vessel.orbit.vel});
-      }
+      vessels.Add(vessel);
+      vessel_guids.Add(vessel.id.ToString());
+      vessel_parent_indices.Add(vessel.orbit.referenceBody.flightGlobalsIndex);
+      vessel_from_parents.Add(
+          new QP{q = (XYZ)vessel.orbit.pos, p = (XYZ)vessel.orbit.vel});
     };
     ApplyToVesselsOnRailsOrInInertialPhysicsBubbleInSpace(insert_vessel);
+    Int64[] handles = new Int64[vessels.Count];
+    InsertVessels(plugin_,
+                  vessel_guids.ToArray(),
+                  vessel_parent_indices.ToArray(),
+                  vessel_from_parents.ToArray(),
+                  vessels.Count,
+                  handles);
+    for (int i = 0; i < vessels.Count; ++i) {
+      vessel_handles_[vessels[i].id] = handles[i];
+    }
   }
 }
 
@@ -39,6 +39,60 @@ struct KSPPart {
     public uint id;
   };
 
+  [StructLayout(LayoutKind.Sequential)]
+  private struct AdvanceTimeProfile {
+    public int advance_time_calls;
+    public double clean_up_vessels;
+    public double prepare_bubble;
+    public double evolve_histories;
+    public double synchronization;
+    public double reset_prolongations;
+    public double evolve_prolongations_and_bubble;
+    public long force_evaluations;
+    public long history_steps;
+    public long points_appended;
+    public long advance_time_allocations;
+    public long advance_time_allocated_bytes;
+    public int render_calls;
+    public long render_allocations;
+    public long render_allocated_bytes;
+  };
+
+  [StructLayout(LayoutKind.Sequential)]
+  private struct ConservationDrift {
+    public int samples;
+    public double energy;
+    public double angular_momentum;
+    public double maximum_energy;
+    public double maximum_angular_momentum;
+  };
+
+  [StructLayout(LayoutKind.Sequential)]
+  private struct MemoryUsage {
+    public long celestials;
+    public long vessels;
+    public long bubble;
+  };
+
+  [StructLayout(LayoutKind.Sequential)]
+  private struct PublishedState {
+    public long handle;
+    public QP from_parent;
+    public XYZ world_displacement;
+    public XYZ world_velocity;
+  };
+
+  [StructLayout(LayoutKind.Sequential)]
+  private struct StateTable {
+    public long version;
+    public double time;
+    public XYZ world_rotation_axis;
+    public int number_of_vessels;
+    public int number_of_celestials;
+    public IntPtr vessels;
+    public IntPtr celestials;
+  };
+
   // Plugin interface.
 
   [DllImport(dllName           : kDllPath,
@@ -70,11 +124,46 @@ struct KSPPart {
       int parent_index,
       QP from_parent);
 
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__InsertCelestials",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void InsertCelestials(
+      IntPtr plugin,
+      int[] celestial_indices,
+      double[] gravitational_parameters,
+      int[] parent_indices,
+      QP[] from_parents,
+      int count);
+
   [DllImport(dllName           : kDllPath,
              EntryPoint        = "principia__EndInitialization",
              CallingConvention = CallingConvention.Cdecl)]
   private static extern void EndInitialization(IntPtr plugin);
 
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__LoadEphemerisFile",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern bool LoadEphemerisFile(
+      IntPtr plugin,
+      [MarshalAs(UnmanagedType.LPStr)] String filename);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__WriteEphemerisFile",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void WriteEphemerisFile(
+      IntPtr plugin,
+      [MarshalAs(UnmanagedType.LPStr)] String filename,
+      double t_max,
+      int steps_per_series,
+      int degree);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__WriteTrajectoryFile",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void WriteTrajectoryFile(
+      IntPtr plugin,
+      [MarshalAs(UnmanagedType.LPStr)] String filename);
+
   [DllImport(dllName           : kDllPath,
              EntryPoint        = "principia__UpdateCelestialHierarchy",
              CallingConvention = CallingConvention.Cdecl)]
@@ -91,6 +180,33 @@ struct KSPPart {
       [MarshalAs(UnmanagedType.LPStr)] String vessel_guid,
       int parent_index);
 
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__InsertVessels",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void InsertVessels(
+      IntPtr plugin,
+      [In, MarshalAs(UnmanagedType.LPArray,
+                     ArraySubType = UnmanagedType.LPStr)]
+      String[] vessel_guids,
+      int[] parent_indices,
+      QP[] from_parents,
+      int count,
+      [Out] Int64[] vessel_handles);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__KeepVessels",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void KeepVessels(IntPtr plugin,
+                                         Int64[] vessel_handles,
+                                         int count);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__RemoveVessel",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void RemoveVessel(
+      IntPtr plugin,
+      [MarshalAs(UnmanagedType.LPStr)] String vessel_guid);
+
   [DllImport(dllName           : kDllPath,
              EntryPoint        = "principia__SetVesselStateOffset",
              CallingConvention = CallingConvention.Cdecl)]
@@ -107,6 +223,14 @@ struct KSPPart {
       double t,
       double planetarium_rotation);
 
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__FastForward",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void FastForward(
+      IntPtr plugin,
+      double t,
+      double planetarium_rotation);
+
   [DllImport(dllName           : kDllPath,
              EntryPoint        = "principia__VesselFromParent",
              CallingConvention = CallingConvention.Cdecl)]
@@ -114,6 +238,33 @@ struct KSPPart {
       IntPtr plugin,
       [MarshalAs(UnmanagedType.LPStr)] String vessel_guid);
 
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__VesselHandle",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern Int64 VesselHandle(
+      IntPtr plugin,
+      [MarshalAs(UnmanagedType.LPStr)] String vessel_guid);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__VesselsFromParentByHandle",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void VesselsFromParentByHandle(
+      IntPtr plugin,
+      Int64[] vessel_handles,
+      int count,
+      [Out] QP[] from_parents);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__VesselsFromParent",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void VesselsFromParent(
+      IntPtr plugin,
+      [In, MarshalAs(UnmanagedType.LPArray,
+                     ArraySubType = UnmanagedType.LPStr)]
+      String[] vessel_guids,
+      int count,
+      [Out] QP[] from_parents);
+
   [DllImport(dllName           : kDllPath,
              EntryPoint        = "principia__CelestialFromParent",
              CallingConvention = CallingConvention.Cdecl)]
@@ -121,6 +272,14 @@ struct KSPPart {
       IntPtr plugin,
       int celestial_index);
 
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__AllCelestialsFromParent",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void AllCelestialsFromParent(
+      IntPtr plugin,
+      int count,
+      [Out] QP[] from_parents);
+
   [DllImport(dllName           : kDllPath,
              EntryPoint        =
                  "principia__NewBodyCentredNonRotatingTransforms",
@@ -137,6 +296,21 @@ struct KSPPart {
       int primary_index,
       int secondary_index);
 
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__BodyCentredNonRotatingTransforms",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern IntPtr BodyCentredNonRotatingTransforms(
+      IntPtr plugin,
+      int reference_body_index);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__BarycentricRotatingTransforms",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern IntPtr BarycentricRotatingTransforms(
+      IntPtr plugin,
+      int primary_index,
+      int secondary_index);
+
   [DllImport(dllName           : kDllPath,
              EntryPoint        = "principia__DeleteTransforms",
              CallingConvention = CallingConvention.Cdecl)]
@@ -149,7 +323,24 @@ struct KSPPart {
       IntPtr plugin,
       [MarshalAs(UnmanagedType.LPStr)] String vessel_guid,
       IntPtr transforms,
-      XYZ sun_world_position);
+      XYZ sun_world_position,
+      double tolerance,
+      double begin_time);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__RenderedVesselTrajectories",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void RenderedVesselTrajectories(
+      IntPtr plugin,
+      [In, MarshalAs(UnmanagedType.LPArray,
+                     ArraySubType = UnmanagedType.LPStr)]
+      String[] vessel_guids,
+      int count,
+      IntPtr transforms,
+      XYZ sun_world_position,
+      double tolerance,
+      double begin_time,
+      [Out] IntPtr[] line_and_iterators);
 
   [DllImport(dllName           : kDllPath,
              EntryPoint        = "principia__NumberOfSegments",
@@ -161,6 +352,27 @@ struct KSPPart {
              CallingConvention = CallingConvention.Cdecl)]
   private static extern LineSegment FetchAndIncrement(IntPtr line);
 
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__FetchSegments",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern int FetchSegments(
+      IntPtr line,
+      int max_segments,
+      [Out] LineSegment[] segments);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__NumberOfVertices",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern int NumberOfVertices(IntPtr line);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__FetchVertices",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void FetchVertices(IntPtr line,
+                                           XYZ origin,
+                                           [Out] float[] vertices,
+                                           [Out] int[] indices);
+
   [DllImport(dllName           : kDllPath,
              EntryPoint        = "principia__AtEnd",
              CallingConvention = CallingConvention.Cdecl)]
@@ -188,6 +400,31 @@ struct KSPPart {
       XYZ parent_world_velocity,
       double parent_rotation_period);
 
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__VesselsWorldPositions",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void VesselsWorldPositions(
+      IntPtr plugin,
+      [In, MarshalAs(UnmanagedType.LPArray,
+                     ArraySubType = UnmanagedType.LPStr)]
+      String[] vessel_guids,
+      int count,
+      XYZ[] parent_world_positions,
+      [Out] XYZ[] world_positions);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__VesselsWorldVelocities",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void VesselsWorldVelocities(
+      IntPtr plugin,
+      [In, MarshalAs(UnmanagedType.LPArray,
+                     ArraySubType = UnmanagedType.LPStr)]
+      String[] vessel_guids,
+      int count,
+      XYZ[] parent_world_velocities,
+      double[] parent_rotation_periods,
+      [Out] XYZ[] world_velocities);
+
   [DllImport(dllName           : kDllPath,
              EntryPoint        = "principia__AddVesselToNextPhysicsBubble",
              CallingConvention = CallingConvention.Cdecl)]
@@ -197,6 +434,18 @@ struct KSPPart {
       KSPPart[] parts,
       int count);
 
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__AddVesselsToNextPhysicsBubble",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void AddVesselsToNextPhysicsBubble(
+      IntPtr plugin,
+      [In, MarshalAs(UnmanagedType.LPArray,
+                     ArraySubType = UnmanagedType.LPStr)]
+      String[] vessel_guids,
+      int[] part_counts,
+      int vessel_count,
+      KSPPart[] parts);
+
   [DllImport(dllName           : kDllPath,
              EntryPoint        = "principia__PhysicsBubbleIsEmpty",
              CallingConvention = CallingConvention.Cdecl)]
@@ -219,6 +468,193 @@ struct KSPPart {
              CallingConvention = CallingConvention.Cdecl)]
   private static extern double current_time(IntPtr plugin);
 
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__StateTable",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern IntPtr GetStateTable(IntPtr plugin);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__SetHistoryRetention",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void SetHistoryRetention(IntPtr plugin,
+                                                 double maximum_age,
+                                                 Int64 maximum_points);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__SetCelestialHistoryCheckpoints",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void SetCelestialHistoryCheckpoints(
+      IntPtr plugin,
+      int steps_between_checkpoints,
+      int cached_segments);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__SetNumberOfThreads",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void SetNumberOfThreads(IntPtr plugin,
+                                                int number_of_threads);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__TuneKernels",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void TuneKernels(
+      IntPtr plugin,
+      [MarshalAs(UnmanagedType.LPStr)] String filename);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__SetKernelConfiguration",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void SetKernelConfiguration(
+      IntPtr plugin,
+      int number_of_threads,
+      int massless_chunks_per_thread,
+      int maximum_vector_instruction_set);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__SetProfiling",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void SetProfiling(
+      IntPtr plugin,
+      [MarshalAs(UnmanagedType.I1)] bool enabled);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__GetProfile",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern AdvanceTimeProfile GetProfile(IntPtr plugin);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__SetConservationMonitoring",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void SetConservationMonitoring(IntPtr plugin,
+                                                       int period);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__GetConservationDrift",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern ConservationDrift GetConservationDrift(IntPtr plugin);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__GetMemoryUsage",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern MemoryUsage GetMemoryUsage(IntPtr plugin);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__VesselMemoryUsage",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern long VesselMemoryUsage(
+      IntPtr plugin,
+      [MarshalAs(UnmanagedType.LPStr)] String vessel_guid);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__CelestialMemoryUsage",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern long CelestialMemoryUsage(IntPtr plugin,
+                                                  int celestial_index);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__TransformsMemoryUsage",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern long TransformsMemoryUsage(IntPtr transforms);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__WritePluginToFile",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void WritePluginToFile(
+      IntPtr plugin,
+      [MarshalAs(UnmanagedType.LPStr)] String filename);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__WritePluginIncrementToFile",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void WritePluginIncrementToFile(
+      IntPtr plugin,
+      [MarshalAs(UnmanagedType.LPStr)] String filename,
+      [MarshalAs(UnmanagedType.LPStr)] String base_filename);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__CompactPluginFiles",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void CompactPluginFiles(
+      [MarshalAs(UnmanagedType.LPStr)] String base_filename,
+      [MarshalAs(UnmanagedType.LPStr)] String increment_filename,
+      [MarshalAs(UnmanagedType.LPStr)] String filename);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__StartWritingPluginToFile",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern IntPtr StartWritingPluginToFile(
+      IntPtr plugin,
+      [MarshalAs(UnmanagedType.LPStr)] String filename);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__PluginSaveCompleted",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern bool PluginSaveCompleted(IntPtr plugin_save);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__DeletePluginSave",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void DeletePluginSave(ref IntPtr plugin_save);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__ReadPluginFromFile",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern IntPtr ReadPluginFromFile(
+      [MarshalAs(UnmanagedType.LPStr)] String filename);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__SaveCheckpoint",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern long SaveCheckpoint(IntPtr plugin);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__HasCheckpoint",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern bool HasCheckpoint(IntPtr plugin, long checkpoint_id);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__RestoreCheckpoint",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern IntPtr RestoreCheckpoint(IntPtr plugin,
+                                                 long checkpoint_id);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__StartTracing",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void StartTracing(
+      [MarshalAs(UnmanagedType.LPStr)] String filename);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__StopTracing",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void StopTracing();
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__StartJournaling",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void StartJournaling(
+      [MarshalAs(UnmanagedType.LPStr)] String filename);
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__StopJournaling",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void StopJournaling();
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__StartInterfaceStatistics",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void StartInterfaceStatistics();
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__StopInterfaceStatistics",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void StopInterfaceStatistics();
+
+  [DllImport(dllName           : kDllPath,
+             EntryPoint        = "principia__DumpInterfaceStatistics",
+             CallingConvention = CallingConvention.Cdecl)]
+  private static extern void DumpInterfaceStatistics();
+
 }
 
 }  // namespace ksp_plugin_adapter
@@ -64,6 +64,18 @@ internal static class Log {
              CallingConvention = CallingConvention.Cdecl)]
   internal static extern int GetStderrLogging();
 
+  [DllImport(dllName           : PluginAdapter.kDllPath,
+             EntryPoint        = "principia__SetAsynchronousLogging",
+             CallingConvention = CallingConvention.Cdecl)]
+  internal static extern void SetAsynchronousLogging(
+      [MarshalAs(UnmanagedType.I1)] bool enabled);
+
+  [DllImport(dllName           : PluginAdapter.kDllPath,
+             EntryPoint        = "principia__GetAsynchronousLogging",
+             CallingConvention = CallingConvention.Cdecl)]
+  [return : MarshalAs(UnmanagedType.I1)]
+  internal static extern bool GetAsynchronousLogging();
+
   [DllImport(dllName           : PluginAdapter.kDllPath,
              EntryPoint        = "principia__LogInfo",
              CallingConvention = CallingConvention.Cdecl)]
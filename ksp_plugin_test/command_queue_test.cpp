@@ -0,0 +1,56 @@
+#include "ksp_plugin/command_queue.hpp"
+
+#include "geometry/epoch.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "ksp_plugin/mock_plugin.hpp"
+#include "quantities/si.hpp"
+
+using principia::geometry::kUnixEpoch;
+using principia::si::Degree;
+using principia::si::Second;
+using testing::InSequence;
+using testing::StrictMock;
+
+namespace principia {
+namespace ksp_plugin {
+
+class CommandQueueTest : public testing::Test {
+ protected:
+  StrictMock<MockPlugin> plugin_;
+};
+
+// Checks that the commands are executed in order, including when the queue is
+// full, and that they have been executed when |Drain| returns.
+TEST_F(CommandQueueTest, Drain) {
+  {
+    InSequence s;
+    for (int i = 1; i <= 10; ++i) {
+      EXPECT_CALL(plugin_, AdvanceTime(kUnixEpoch + i * Second, i * Degree));
+    }
+  }
+  CommandQueue command_queue(&plugin_, 3 /*capacity*/);
+  for (int i = 1; i <= 10; ++i) {
+    command_queue.Enqueue([i](not_null<Plugin*> const plugin) {
+      plugin->AdvanceTime(kUnixEpoch + i * Second, i * Degree);
+    });
+  }
+  command_queue.Drain();
+  testing::Mock::VerifyAndClearExpectations(&plugin_);
+
+  // Draining an empty queue returns immediately.
+  command_queue.Drain();
+}
+
+// Checks that the destructor executes the pending commands.
+TEST_F(CommandQueueTest, Destruction) {
+  EXPECT_CALL(plugin_, SetProfiling(true)).Times(10);
+  CommandQueue command_queue(&plugin_, 3 /*capacity*/);
+  for (int i = 0; i < 10; ++i) {
+    command_queue.Enqueue(
+        [](not_null<Plugin*> const plugin) { plugin->SetProfiling(true); });
+  }
+}
+
+}  // namespace ksp_plugin
+}  // namespace principia
@@ -0,0 +1,161 @@
+#include "ksp_plugin/flight_plan.hpp"
+
+#include <memory>
+#include <vector>
+
+#include "geometry/epoch.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "physics/massive_body.hpp"
+#include "quantities/si.hpp"
+
+using principia::base::make_not_null_unique;
+using principia::geometry::Displacement;
+using principia::geometry::Velocity;
+using principia::integrators::SPRKIntegrator;
+using principia::physics::MassiveBody;
+using principia::quantities::Pow;
+using principia::quantities::Sqrt;
+using principia::si::AstronomicalUnit;
+using principia::si::Day;
+using principia::si::Metre;
+using principia::si::Second;
+using testing::Eq;
+using testing::Ne;
+
+namespace principia {
+namespace ksp_plugin {
+
+class FlightPlanTest : public testing::Test {
+ protected:
+  FlightPlanTest()
+      : sun_(1.32712440018E20 * (Pow<3>(Metre) / Pow<2>(Second))),
+        sun_trajectory_(&sun_),
+        // A circular orbit at 1 AU.
+        initial_degrees_of_freedom_(
+            Barycentric::origin +
+                Displacement<Barycentric>(
+                    {1 * AstronomicalUnit, 0 * Metre, 0 * Metre}),
+            Velocity<Barycentric>(
+                {0 * Metre / Second,
+                 Sqrt(sun_.gravitational_parameter() / AstronomicalUnit),
+                 0 * Metre / Second})) {
+    integrator_.Initialize(integrator_.Order5Optimal());
+    sun_trajectory_.Append(
+        t0_,
+        DegreesOfFreedom<Barycentric>(Barycentric::origin,
+                                      Velocity<Barycentric>()));
+    burn_ = {t0_ + 10 * Day,
+             1 * Day,
+             Vector<Acceleration, Barycentric>(
+                 {0 * Metre / Pow<2>(Second),
+                  1E-3 * Metre / Pow<2>(Second),
+                  0 * Metre / Pow<2>(Second)}),
+             Vector<Quotient<Acceleration, Time>, Barycentric>()};
+  }
+
+  not_null<std::unique_ptr<FlightPlan>> NewFlightPlan() {
+    return make_not_null_unique<FlightPlan>(
+        t0_,
+        initial_degrees_of_freedom_,
+        t0_ + 100 * Day,
+        make_not_null_unique<Ephemeris<Barycentric>>(
+            std::vector<not_null<Trajectory<Barycentric>*>>{&sun_trajectory_},
+            integrator_,
+            1 * Day,
+            8,    // steps_per_series
+            12),  // degree
+        integrator_,
+        1 * Day / 4);
+  }
+
+  Instant const t0_ = kUniversalTimeEpoch;
+  MassiveBody sun_;
+  Trajectory<Barycentric> sun_trajectory_;
+  DegreesOfFreedom<Barycentric> const initial_degrees_of_freedom_;
+  SPRKIntegrator<Length, Speed> integrator_;
+  Burn burn_;
+};
+
+using FlightPlanDeathTest = FlightPlanTest;
+
+TEST_F(FlightPlanDeathTest, OverlappingBurns) {
+  EXPECT_DEATH({
+    not_null<std::unique_ptr<FlightPlan>> flight_plan = NewFlightPlan();
+    flight_plan->AppendBurn(burn_);
+    burn_.initial_time += burn_.duration / 2;
+    flight_plan->AppendBurn(burn_);
+  }, "Check failed");
+}
+
+TEST_F(FlightPlanTest, Segments) {
+  not_null<std::unique_ptr<FlightPlan>> flight_plan = NewFlightPlan();
+  EXPECT_THAT(flight_plan->number_of_segments(), Eq(1));
+  EXPECT_THAT(flight_plan->segment(0).last().time(), Eq(t0_ + 100 * Day));
+  flight_plan->AppendBurn(burn_);
+  burn_.initial_time += 20 * Day;
+  flight_plan->AppendBurn(burn_);
+  EXPECT_THAT(flight_plan->number_of_burns(), Eq(2));
+  EXPECT_THAT(flight_plan->number_of_segments(), Eq(5));
+  EXPECT_THAT(flight_plan->segment(0).last().time(), Eq(t0_ + 10 * Day));
+  EXPECT_THAT(flight_plan->segment(1).last().time(), Eq(t0_ + 11 * Day));
+  EXPECT_THAT(flight_plan->segment(2).last().time(), Eq(t0_ + 30 * Day));
+  EXPECT_THAT(flight_plan->segment(3).last().time(), Eq(t0_ + 31 * Day));
+  EXPECT_THAT(flight_plan->segment(4).last().time(), Eq(t0_ + 100 * Day));
+  flight_plan->RemoveLastBurn();
+  EXPECT_THAT(flight_plan->number_of_segments(), Eq(3));
+  EXPECT_THAT(flight_plan->segment(2).last().time(), Eq(t0_ + 100 * Day));
+  flight_plan->SetFinalTime(t0_ + 50 * Day);
+  EXPECT_THAT(flight_plan->segment(2).last().time(), Eq(t0_ + 50 * Day));
+}
+
+// Editing a burn keeps the segments before it, and gives the same result as
+// integrating the edited flight plan from scratch.
+TEST_F(FlightPlanTest, IncrementalEdition) {
+  not_null<std::unique_ptr<FlightPlan>> flight_plan = NewFlightPlan();
+  Burn first_burn = burn_;
+  flight_plan->AppendBurn(first_burn);
+  Burn second_burn = burn_;
+  second_burn.initial_time += 20 * Day;
+  flight_plan->AppendBurn(second_burn);
+  DegreesOfFreedom<Barycentric> const unedited_final_degrees_of_freedom =
+      flight_plan->segment(4).last().degrees_of_freedom();
+  std::vector<Trajectory<Barycentric> const*> segments;
+  for (int i = 0; i < flight_plan->number_of_segments(); ++i) {
+    segments.push_back(&flight_plan->segment(i));
+  }
+
+  second_burn.acceleration *= 2;
+  second_burn.jerk = Vector<Quotient<Acceleration, Time>, Barycentric>(
+      {1E-8 * Metre / Pow<3>(Second),
+       0 * Metre / Pow<3>(Second),
+       0 * Metre / Pow<3>(Second)});
+  flight_plan->ReplaceBurn(1, second_burn);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_THAT(&flight_plan->segment(i), Eq(segments[i])) << i;
+  }
+  DegreesOfFreedom<Barycentric> const edited_final_degrees_of_freedom =
+      flight_plan->segment(4).last().degrees_of_freedom();
+  EXPECT_THAT(edited_final_degrees_of_freedom.position(),
+              Ne(unedited_final_degrees_of_freedom.position()));
+
+  not_null<std::unique_ptr<FlightPlan>> fresh_flight_plan = NewFlightPlan();
+  fresh_flight_plan->AppendBurn(first_burn);
+  fresh_flight_plan->AppendBurn(second_burn);
+  DegreesOfFreedom<Barycentric> const fresh_final_degrees_of_freedom =
+      fresh_flight_plan->segment(4).last().degrees_of_freedom();
+  EXPECT_THAT(edited_final_degrees_of_freedom.position(),
+              Eq(fresh_final_degrees_of_freedom.position()));
+  EXPECT_THAT(edited_final_degrees_of_freedom.velocity(),
+              Eq(fresh_final_degrees_of_freedom.velocity()));
+
+  // Moving the first burn invalidates everything.
+  first_burn.initial_time += 1 * Day;
+  flight_plan->ReplaceBurn(0, first_burn);
+  EXPECT_THAT(flight_plan->segment(0).last().time(), Eq(t0_ + 11 * Day));
+  EXPECT_THAT(flight_plan->segment(4).last().time(), Eq(t0_ + 100 * Day));
+}
+
+}  // namespace ksp_plugin
+}  // namespace principia
@@ -1,32 +1,48 @@
 #include "ksp_plugin/interface.hpp"
 
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/call_statistics.hpp"
 #include "base/not_null.hpp"
 #include "geometry/epoch.hpp"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "quantities/si.hpp"
+#include "ksp_plugin/kernel_tuning.hpp"
 #include "ksp_plugin/mock_plugin.hpp"
 
+using principia::base::CallStatistics;
 using principia::base::check_not_null;
 using principia::geometry::Displacement;
 using principia::geometry::kUnixEpoch;
 using principia::ksp_plugin::AliceSun;
 using principia::ksp_plugin::Index;
+using principia::ksp_plugin::KernelConfiguration;
 using principia::ksp_plugin::LineSegment;
 using principia::ksp_plugin::MockPlugin;
 using principia::ksp_plugin::Part;
 using principia::ksp_plugin::RenderedTrajectory;
 using principia::ksp_plugin::World;
+using principia::ksp_plugin::WriteKernelConfiguration;
 using principia::si::Degree;
 using principia::si::Second;
 using principia::si::Tonne;
+using testing::AllOf;
+using testing::DoAll;
 using testing::Eq;
 using testing::ElementsAre;
+using testing::Field;
+using testing::HasSubstr;
 using testing::IsNull;
 using testing::Pointee;
 using testing::Property;
 using testing::Ref;
 using testing::Return;
+using testing::ReturnRef;
+using testing::SetArgPointee;
 using testing::StrictMock;
 using testing::_;
 
@@ -123,6 +139,24 @@ TEST_F(InterfaceTest, Log) {
   principia__LogError("An error");
 }
 
+TEST_F(InterfaceTest, AsynchronousLogging) {
+  EXPECT_FALSE(principia__GetAsynchronousLogging());
+  principia__SetAsynchronousLogging(true);
+  EXPECT_TRUE(principia__GetAsynchronousLogging());
+  principia__LogInfo("An asynchronous info");
+  principia__LogError("An asynchronous error");
+  principia__SetAsynchronousLogging(true);
+  principia__SetAsynchronousLogging(false);
+  EXPECT_FALSE(principia__GetAsynchronousLogging());
+}
+
+TEST_F(InterfaceTest, Tracing) {
+  principia__StartTracing("interface_test_trace.json");
+  principia__StopTracing();
+  // Stopping twice is harmless.
+  principia__StopTracing();
+}
+
 TEST_F(InterfaceTest, NewPlugin) {
   std::unique_ptr<Plugin> plugin(principia__NewPlugin(
                                      kTime,
@@ -160,6 +194,37 @@ TEST_F(InterfaceTest, InsertCelestial) {
                              kParentRelativeDegreesOfFreedom);
 }
 
+TEST_F(InterfaceTest, InsertCelestials) {
+  int const celestial_indices[] = {kCelestialIndex};
+  double const gravitational_parameters[] = {kGravitationalParameter};
+  int const parent_indices[] = {kParentIndex};
+  QP const from_parents[] = {kParentRelativeDegreesOfFreedom};
+  EXPECT_CALL(
+      *plugin_,
+      InsertCelestials(ElementsAre(AllOf(
+          Field(&Plugin::CelestialDescription::celestial_index,
+                kCelestialIndex),
+          Field(&Plugin::CelestialDescription::gravitational_parameter,
+                kGravitationalParameter * SIUnit<GravitationalParameter>()),
+          Field(&Plugin::CelestialDescription::parent_index, kParentIndex),
+          Field(&Plugin::CelestialDescription::from_parent,
+                RelativeDegreesOfFreedom<AliceSun>(
+                    Displacement<AliceSun>(
+                        {kParentPosition.x * SIUnit<Length>(),
+                         kParentPosition.y * SIUnit<Length>(),
+                         kParentPosition.z * SIUnit<Length>()}),
+                    Velocity<AliceSun>(
+                        {kParentVelocity.x * SIUnit<Speed>(),
+                         kParentVelocity.y * SIUnit<Speed>(),
+                         kParentVelocity.z * SIUnit<Speed>()})))))));
+  principia__InsertCelestials(plugin_.get(),
+                              celestial_indices,
+                              gravitational_parameters,
+                              parent_indices,
+                              from_parents,
+                              1 /*count*/);
+}
+
 TEST_F(InterfaceTest, UpdateCelestialHierarchy) {
   EXPECT_CALL(*plugin_,
               UpdateCelestialHierarchy(kCelestialIndex, kParentIndex));
@@ -198,6 +263,33 @@ TEST_F(InterfaceTest, SetVesselStateOffset) {
                                   kParentRelativeDegreesOfFreedom);
 }
 
+TEST_F(InterfaceTest, InsertVessels) {
+  RelativeDegreesOfFreedom<AliceSun> const from_parent(
+      Displacement<AliceSun>({kParentPosition.x * SIUnit<Length>(),
+                              kParentPosition.y * SIUnit<Length>(),
+                              kParentPosition.z * SIUnit<Length>()}),
+      Velocity<AliceSun>({kParentVelocity.x * SIUnit<Speed>(),
+                          kParentVelocity.y * SIUnit<Speed>(),
+                          kParentVelocity.z * SIUnit<Speed>()}));
+  char const* const vessel_guids[] = {kVesselGUID, "NCC-1701-E"};
+  int const parent_indices[] = {kParentIndex, kCelestialIndex};
+  QP const from_parents[] = {kParentRelativeDegreesOfFreedom,
+                             kParentRelativeDegreesOfFreedom};
+  VesselHandle vessel_handles[2];
+  EXPECT_CALL(*plugin_,
+              InsertVessels(ElementsAre(kVesselGUID, "NCC-1701-E"),
+                            ElementsAre(kParentIndex, kCelestialIndex),
+                            ElementsAre(from_parent, from_parent)))
+      .WillOnce(Return(std::vector<VesselHandle>({7, (1LL << 32) | 2})));
+  principia__InsertVessels(plugin_.get(),
+                           vessel_guids,
+                           parent_indices,
+                           from_parents,
+                           2,
+                           vessel_handles);
+  EXPECT_THAT(vessel_handles, ElementsAre(7, (1LL << 32) | 2));
+}
+
 TEST_F(InterfaceTest, AdvanceTime) {
   EXPECT_CALL(*plugin_,
               AdvanceTime(Instant(kTime * SIUnit<Time>()),
@@ -205,6 +297,70 @@ TEST_F(InterfaceTest, AdvanceTime) {
   principia__AdvanceTime(plugin_.get(), kTime, kPlanetariumRotation);
 }
 
+// The enqueued calls are executed, in order, before the synchronous ones.
+TEST_F(InterfaceTest, AsynchronousAdvanceTime) {
+  {
+    testing::InSequence s;
+    EXPECT_CALL(*plugin_,
+                AdvanceTime(Instant(kTime * SIUnit<Time>()),
+                            kPlanetariumRotation * Degree));
+    EXPECT_CALL(*plugin_,
+                SetVesselStateOffset(
+                    kVesselGUID,
+                    RelativeDegreesOfFreedom<AliceSun>(
+                        Displacement<AliceSun>(
+                            {kParentPosition.x * SIUnit<Length>(),
+                             kParentPosition.y * SIUnit<Length>(),
+                             kParentPosition.z * SIUnit<Length>()}),
+                        Velocity<AliceSun>(
+                            {kParentVelocity.x * SIUnit<Speed>(),
+                             kParentVelocity.y * SIUnit<Speed>(),
+                             kParentVelocity.z * SIUnit<Speed>()}))));
+    EXPECT_CALL(*plugin_, current_time()).WillOnce(Return(kUnixEpoch));
+    EXPECT_CALL(*plugin_,
+                AdvanceTime(Instant(2 * kTime * SIUnit<Time>()),
+                            kPlanetariumRotation * Degree));
+  }
+  EXPECT_FALSE(principia__GetAsynchronousAdvanceTime(plugin_.get()));
+  principia__SetAsynchronousAdvanceTime(plugin_.get(), true);
+  EXPECT_TRUE(principia__GetAsynchronousAdvanceTime(plugin_.get()));
+  principia__AdvanceTime(plugin_.get(), kTime, kPlanetariumRotation);
+  principia__SetVesselStateOffset(plugin_.get(),
+                                  kVesselGUID,
+                                  kParentRelativeDegreesOfFreedom);
+  EXPECT_THAT(Instant(principia__current_time(plugin_.get()) * Second),
+              Eq(kUnixEpoch));
+  principia__AdvanceTime(plugin_.get(), 2 * kTime, kPlanetariumRotation);
+  // Disabling executes the pending calls.
+  principia__SetAsynchronousAdvanceTime(plugin_.get(), false);
+  EXPECT_FALSE(principia__GetAsynchronousAdvanceTime(plugin_.get()));
+}
+
+TEST_F(InterfaceTest, EphemerisFile) {
+  EXPECT_CALL(*plugin_, LoadEphemerisFile("kerbol.bin"))
+      .WillOnce(Return(true));
+  EXPECT_TRUE(principia__LoadEphemerisFile(plugin_.get(), "kerbol.bin"));
+  EXPECT_CALL(*plugin_,
+              WriteEphemerisFile("kerbol.bin",
+                                 Instant(kTime * SIUnit<Time>()),
+                                 8,
+                                 12));
+  principia__WriteEphemerisFile(plugin_.get(), "kerbol.bin", kTime, 8, 12);
+}
+
+TEST_F(InterfaceTest, TrajectoryFile) {
+  EXPECT_CALL(*plugin_, WriteTrajectoryFile("histories.bin"));
+  principia__WriteTrajectoryFile(plugin_.get(), "histories.bin");
+}
+
+TEST_F(InterfaceTest, FastForward) {
+  EXPECT_CALL(*plugin_,
+              FastForward(Instant(kTime * SIUnit<Time>()),
+                          kPlanetariumRotation * Degree,
+                          _));
+  principia__FastForward(plugin_.get(), kTime, kPlanetariumRotation);
+}
+
 TEST_F(InterfaceTest, VesselFromParent) {
   EXPECT_CALL(*plugin_,
               VesselFromParent(kVesselGUID))
@@ -222,6 +378,224 @@ TEST_F(InterfaceTest, VesselFromParent) {
   EXPECT_THAT(result, Eq(kParentRelativeDegreesOfFreedom));
 }
 
+TEST_F(InterfaceTest, VesselsFromParent) {
+  char const* const vessel_guids[] = {kVesselGUID, "NCC-1701-E"};
+  EXPECT_CALL(*plugin_,
+              VesselFromParent(kVesselGUID))
+      .WillOnce(Return(RelativeDegreesOfFreedom<AliceSun>(
+                           Displacement<AliceSun>(
+                               {kParentPosition.x * SIUnit<Length>(),
+                                kParentPosition.y * SIUnit<Length>(),
+                                kParentPosition.z * SIUnit<Length>()}),
+                           Velocity<AliceSun>(
+                               {kParentVelocity.x * SIUnit<Speed>(),
+                                kParentVelocity.y * SIUnit<Speed>(),
+                                kParentVelocity.z * SIUnit<Speed>()}))));
+  EXPECT_CALL(*plugin_,
+              VesselFromParent("NCC-1701-E"))
+      .WillOnce(Return(RelativeDegreesOfFreedom<AliceSun>(
+                           Displacement<AliceSun>(
+                               {kParentVelocity.x * SIUnit<Length>(),
+                                kParentVelocity.y * SIUnit<Length>(),
+                                kParentVelocity.z * SIUnit<Length>()}),
+                           Velocity<AliceSun>(
+                               {kParentPosition.x * SIUnit<Speed>(),
+                                kParentPosition.y * SIUnit<Speed>(),
+                                kParentPosition.z * SIUnit<Speed>()}))));
+  QP from_parents[2];
+  principia__VesselsFromParent(plugin_.get(), vessel_guids, 2, from_parents);
+  EXPECT_THAT(from_parents[0], Eq(kParentRelativeDegreesOfFreedom));
+  EXPECT_THAT(from_parents[1], Eq(QP{kParentVelocity, kParentPosition}));
+  principia__VesselsFromParent(plugin_.get(), nullptr, 0, nullptr);
+}
+
+TEST_F(InterfaceTest, VesselsFromParentByHandle) {
+  VesselHandle const kVesselHandle = 42;
+  EXPECT_CALL(*plugin_, vessel_handle(kVesselGUID))
+      .WillOnce(Return(kVesselHandle));
+  EXPECT_CALL(*plugin_,
+              VesselFromParent(kVesselHandle))
+      .Times(2)
+      .WillRepeatedly(Return(RelativeDegreesOfFreedom<AliceSun>(
+                                 Displacement<AliceSun>(
+                                     {kParentPosition.x * SIUnit<Length>(),
+                                      kParentPosition.y * SIUnit<Length>(),
+                                      kParentPosition.z * SIUnit<Length>()}),
+                                 Velocity<AliceSun>(
+                                     {kParentVelocity.x * SIUnit<Speed>(),
+                                      kParentVelocity.y * SIUnit<Speed>(),
+                                      kParentVelocity.z * SIUnit<Speed>()}))));
+  VesselHandle const vessel_handle =
+      principia__VesselHandle(plugin_.get(), kVesselGUID);
+  EXPECT_EQ(kVesselHandle, vessel_handle);
+  EXPECT_THAT(principia__VesselFromParentByHandle(plugin_.get(),
+                                                  vessel_handle),
+              Eq(kParentRelativeDegreesOfFreedom));
+  QP from_parents[1];
+  principia__VesselsFromParentByHandle(plugin_.get(),
+                                       &vessel_handle,
+                                       1,
+                                       from_parents);
+  EXPECT_THAT(from_parents[0], Eq(kParentRelativeDegreesOfFreedom));
+}
+
+TEST_F(InterfaceTest, VesselsWorldPositionsAndVelocities) {
+  char const* const vessel_guids[] = {kVesselGUID};
+  XYZ const parent_world_positions[] = {kParentPosition};
+  XYZ const parent_world_velocities[] = {kParentVelocity};
+  double const parent_rotation_periods[] = {kTime};
+  EXPECT_CALL(*plugin_,
+              VesselWorldPosition(
+                  kVesselGUID,
+                  World::origin + Displacement<World>(
+                                      {kParentPosition.x * SIUnit<Length>(),
+                                       kParentPosition.y * SIUnit<Length>(),
+                                       kParentPosition.z * SIUnit<Length>()})))
+      .WillOnce(Return(World::origin + Displacement<World>(
+                                           {1 * SIUnit<Length>(),
+                                            2 * SIUnit<Length>(),
+                                            3 * SIUnit<Length>()})));
+  EXPECT_CALL(*plugin_,
+              VesselWorldVelocity(
+                  kVesselGUID,
+                  Velocity<World>({kParentVelocity.x * SIUnit<Speed>(),
+                                   kParentVelocity.y * SIUnit<Speed>(),
+                                   kParentVelocity.z * SIUnit<Speed>()}),
+                  kTime * SIUnit<Time>()))
+      .WillOnce(Return(Velocity<World>({4 * SIUnit<Speed>(),
+                                        5 * SIUnit<Speed>(),
+                                        6 * SIUnit<Speed>()})));
+  XYZ world_positions[1];
+  XYZ world_velocities[1];
+  principia__VesselsWorldPositions(plugin_.get(),
+                                   vessel_guids,
+                                   1,
+                                   parent_world_positions,
+                                   world_positions);
+  principia__VesselsWorldVelocities(plugin_.get(),
+                                    vessel_guids,
+                                    1,
+                                    parent_world_velocities,
+                                    parent_rotation_periods,
+                                    world_velocities);
+  EXPECT_THAT(world_positions[0], Eq(XYZ{1, 2, 3}));
+  EXPECT_THAT(world_velocities[0], Eq(XYZ{4, 5, 6}));
+}
+
+TEST_F(InterfaceTest, SubFrameQueries) {
+  VesselHandle const kVesselHandle = 42;
+  RelativeDegreesOfFreedom<AliceSun> const from_parent(
+      Displacement<AliceSun>({kParentPosition.x * SIUnit<Length>(),
+                              kParentPosition.y * SIUnit<Length>(),
+                              kParentPosition.z * SIUnit<Length>()}),
+      Velocity<AliceSun>({kParentVelocity.x * SIUnit<Speed>(),
+                          kParentVelocity.y * SIUnit<Speed>(),
+                          kParentVelocity.z * SIUnit<Speed>()}));
+  EXPECT_CALL(*plugin_,
+              VesselFromParentAt(kVesselHandle,
+                                 Instant(kTime * SIUnit<Time>())))
+      .WillOnce(Return(from_parent));
+  EXPECT_CALL(*plugin_,
+              CelestialFromParentAt(kCelestialIndex,
+                                    Instant(kTime * SIUnit<Time>())))
+      .WillOnce(Return(from_parent));
+  EXPECT_CALL(*plugin_,
+              VesselWorldPositionAt(
+                  kVesselHandle,
+                  World::origin + Displacement<World>(
+                                      {kParentPosition.x * SIUnit<Length>(),
+                                       kParentPosition.y * SIUnit<Length>(),
+                                       kParentPosition.z * SIUnit<Length>()}),
+                  Instant(kTime * SIUnit<Time>())))
+      .WillOnce(Return(World::origin + Displacement<World>(
+                                           {1 * SIUnit<Length>(),
+                                            2 * SIUnit<Length>(),
+                                            3 * SIUnit<Length>()})));
+  EXPECT_THAT(principia__VesselFromParentAt(plugin_.get(),
+                                            kVesselHandle,
+                                            kTime),
+              Eq(kParentRelativeDegreesOfFreedom));
+  EXPECT_THAT(principia__CelestialFromParentAt(plugin_.get(),
+                                               kCelestialIndex,
+                                               kTime),
+              Eq(kParentRelativeDegreesOfFreedom));
+  EXPECT_THAT(principia__VesselWorldPositionAt(plugin_.get(),
+                                               kVesselHandle,
+                                               kParentPosition,
+                                               kTime),
+              Eq(XYZ{1, 2, 3}));
+}
+
+TEST_F(InterfaceTest, ProximityQueries) {
+  EXPECT_CALL(*plugin_, VesselsWithinRadius(kVesselGUID, 10 * SIUnit<Length>()))
+      .WillRepeatedly(Return(std::vector<VesselHandle>{3, 1, 2}));
+  VesselHandle vessel_handles[2];
+  EXPECT_THAT(principia__VesselsWithinRadius(plugin_.get(),
+                                             kVesselGUID,
+                                             10,
+                                             2,
+                                             vessel_handles),
+              Eq(2));
+  EXPECT_THAT(vessel_handles, ElementsAre(3, 1));
+  EXPECT_THAT(principia__VesselsWithinRadius(plugin_.get(),
+                                             kVesselGUID,
+                                             10,
+                                             0,
+                                             nullptr),
+              Eq(0));
+
+  EXPECT_CALL(*plugin_, ClosestVessel(kVesselGUID, _, _))
+      .WillOnce(DoAll(SetArgPointee<1>(7),
+                      SetArgPointee<2>(42 * SIUnit<Length>()),
+                      Return(true)));
+  VesselHandle closest;
+  double distance;
+  EXPECT_TRUE(principia__ClosestVessel(plugin_.get(),
+                                       kVesselGUID,
+                                       &closest,
+                                       &distance));
+  EXPECT_THAT(closest, Eq(7));
+  EXPECT_THAT(distance, Eq(42));
+}
+
+TEST_F(InterfaceTest, DominantBodies) {
+  char const* const vessel_guids[] = {kVesselGUID, "NCC-1701-E"};
+  EXPECT_CALL(*plugin_,
+              DominantBodies(ElementsAre(kVesselGUID, "NCC-1701-E")))
+      .WillOnce(Return(std::vector<Index>{kCelestialIndex, kParentIndex}));
+  int parent_indices[2];
+  principia__DominantBodies(plugin_.get(), vessel_guids, 2, parent_indices);
+  EXPECT_THAT(parent_indices, ElementsAre(kCelestialIndex, kParentIndex));
+}
+
+TEST_F(InterfaceTest, PorkchopPlot) {
+  EXPECT_CALL(*plugin_,
+              PorkchopPlot(kCelestialIndex,
+                           kParentIndex,
+                           Instant(1 * Second),
+                           Instant(2 * Second),
+                           2,
+                           Instant(3 * Second),
+                           Instant(5 * Second),
+                           3,
+                           10 * Second))
+      .WillOnce(Return(std::vector<Speed>{1 * SIUnit<Speed>(),
+                                          2 * SIUnit<Speed>(),
+                                          3 * SIUnit<Speed>(),
+                                          4 * SIUnit<Speed>(),
+                                          5 * SIUnit<Speed>(),
+                                          6 * SIUnit<Speed>()}));
+  double delta_v[6];
+  principia__PorkchopPlot(plugin_.get(),
+                          kCelestialIndex,
+                          kParentIndex,
+                          1, 2, 2,
+                          3, 5, 3,
+                          10,
+                          delta_v);
+  EXPECT_THAT(delta_v, ElementsAre(1, 2, 3, 4, 5, 6));
+}
+
 TEST_F(InterfaceTest, CelestialFromParent) {
   EXPECT_CALL(*plugin_,
               CelestialFromParent(kCelestialIndex))
@@ -239,6 +613,23 @@ TEST_F(InterfaceTest, CelestialFromParent) {
   EXPECT_THAT(result, Eq(kParentRelativeDegreesOfFreedom));
 }
 
+TEST_F(InterfaceTest, AllCelestialsFromParent) {
+  EXPECT_CALL(*plugin_, AllCelestialsFromParent())
+      .WillOnce(Return(std::vector<RelativeDegreesOfFreedom<AliceSun>>{
+          RelativeDegreesOfFreedom<AliceSun>(
+              Displacement<AliceSun>(
+                  {kParentPosition.x * SIUnit<Length>(),
+                   kParentPosition.y * SIUnit<Length>(),
+                   kParentPosition.z * SIUnit<Length>()}),
+              Velocity<AliceSun>(
+                  {kParentVelocity.x * SIUnit<Speed>(),
+                   kParentVelocity.y * SIUnit<Speed>(),
+                   kParentVelocity.z * SIUnit<Speed>()}))}));
+  QP from_parents[1];
+  principia__AllCelestialsFromParent(plugin_.get(), 1 /*count*/, from_parents);
+  EXPECT_THAT(from_parents[0], Eq(kParentRelativeDegreesOfFreedom));
+}
+
 TEST_F(InterfaceTest, NewBodyCentredNonRotatingTransforms) {
   auto dummy_transforms = Transforms<Barycentric, Rendering, Barycentric>::
                               DummyForTesting().release();
@@ -251,6 +642,19 @@ TEST_F(InterfaceTest, NewBodyCentredNonRotatingTransforms) {
   EXPECT_EQ(dummy_transforms, transforms.get());
 }
 
+TEST_F(InterfaceTest, Checkpoints) {
+  EXPECT_CALL(*plugin_, SaveCheckpoint()).WillOnce(Return(3));
+  EXPECT_EQ(3, principia__SaveCheckpoint(plugin_.get()));
+  EXPECT_CALL(*plugin_, HasCheckpoint(3)).WillOnce(Return(true));
+  EXPECT_TRUE(principia__HasCheckpoint(plugin_.get(), 3));
+  Plugin* const restored = new StrictMock<MockPlugin>;
+  EXPECT_CALL(*plugin_, FillRestoredCheckpoint(3, _))
+      .WillOnce(FillUniquePtr<1>(restored));
+  Plugin const* result = principia__RestoreCheckpoint(plugin_.get(), 3);
+  EXPECT_EQ(restored, result);
+  principia__DeletePlugin(&result);
+}
+
 TEST_F(InterfaceTest, NewBarycentricRotatingTransforms) {
   auto dummy_transforms = Transforms<Barycentric, Rendering, Barycentric>::
                               DummyForTesting().release();
@@ -283,6 +687,23 @@ TEST_F(InterfaceTest, DeleteTransforms) {
   EXPECT_THAT(transforms, IsNull());
 }
 
+TEST_F(InterfaceTest, PluginOwnedTransforms) {
+  auto const dummy_transforms =
+      Transforms<Barycentric, Rendering, Barycentric>::DummyForTesting();
+  EXPECT_CALL(*plugin_, BodyCentredNonRotatingTransforms(kCelestialIndex))
+      .WillOnce(Return(dummy_transforms.get()));
+  EXPECT_EQ(dummy_transforms.get(),
+            principia__BodyCentredNonRotatingTransforms(plugin_.get(),
+                                                        kCelestialIndex));
+  EXPECT_CALL(*plugin_,
+              BarycentricRotatingTransforms(kCelestialIndex, kParentIndex))
+      .WillOnce(Return(dummy_transforms.get()));
+  EXPECT_EQ(dummy_transforms.get(),
+            principia__BarycentricRotatingTransforms(plugin_.get(),
+                                                     kCelestialIndex,
+                                                     kParentIndex));
+}
+
 TEST_F(InterfaceTest, LineAndIterator) {
   auto dummy_transforms = Transforms<Barycentric, Rendering, Barycentric>::
                               DummyForTesting().release();
@@ -321,13 +742,17 @@ TEST_F(InterfaceTest, LineAndIterator) {
                   World::origin + Displacement<World>(
                                       {kParentPosition.x * SIUnit<Length>(),
                                        kParentPosition.y * SIUnit<Length>(),
-                                       kParentPosition.z * SIUnit<Length>()})))
+                                       kParentPosition.z * SIUnit<Length>()}),
+                  5 * SIUnit<Length>(),
+                  Instant(kTime * SIUnit<Time>())))
       .WillOnce(Return(rendered_trajectory));
   LineAndIterator* line_and_iterator =
       principia__RenderedVesselTrajectory(plugin_.get(),
                                           kVesselGUID,
                                           transforms,
-                                          kParentPosition);
+                                          kParentPosition,
+                                          5,
+                                          kTime);
   EXPECT_EQ(kTrajectorySize, line_and_iterator->rendered_trajectory.size());
   EXPECT_EQ(kTrajectorySize, principia__NumberOfSegments(line_and_iterator));
 
@@ -344,12 +769,104 @@ TEST_F(InterfaceTest, LineAndIterator) {
   }
   EXPECT_TRUE(principia__AtEnd(line_and_iterator));
 
+  // Traverse it again in bulk.
+  line_and_iterator->it = line_and_iterator->rendered_trajectory.begin();
+  std::vector<XYZSegment> segments(kTrajectorySize + 1);
+  EXPECT_EQ(0, principia__FetchSegments(line_and_iterator, 0, nullptr));
+  EXPECT_EQ(1, principia__FetchSegments(line_and_iterator, 1, &segments[0]));
+  EXPECT_EQ(kTrajectorySize - 1,
+            principia__FetchSegments(line_and_iterator,
+                                     kTrajectorySize,
+                                     &segments[1]));
+  EXPECT_TRUE(principia__AtEnd(line_and_iterator));
+  EXPECT_EQ(0, principia__FetchSegments(line_and_iterator,
+                                        kTrajectorySize,
+                                        &segments[0]));
+  for (int i = 0; i < kTrajectorySize; ++i) {
+    EXPECT_EQ(1 + 10 * i, segments[i].begin.x);
+    EXPECT_EQ(2 + 20 * i, segments[i].begin.y);
+    EXPECT_EQ(3 + 30 * i, segments[i].begin.z);
+    EXPECT_EQ(11 + 10 * i, segments[i].end.x);
+    EXPECT_EQ(22 + 20 * i, segments[i].end.y);
+    EXPECT_EQ(33 + 30 * i, segments[i].end.z);
+  }
+
   // Delete it.
   EXPECT_THAT(line_and_iterator, Not(IsNull()));
   principia__DeleteLineAndIterator(&line_and_iterator);
   EXPECT_THAT(line_and_iterator, IsNull());
 }
 
+TEST_F(InterfaceTest, RenderedVesselTrajectories) {
+  auto const transforms = Transforms<Barycentric, Rendering, Barycentric>::
+                              DummyForTesting();
+  char const* const vessel_guids[] = {kVesselGUID, "NCC-1701-E"};
+  Position<World> const position =
+      World::origin + Displacement<World>({1 * SIUnit<Length>(),
+                                           2 * SIUnit<Length>(),
+                                           3 * SIUnit<Length>()});
+  std::vector<RenderedTrajectory<World>> rendered_trajectories(2);
+  rendered_trajectories[1].emplace_back(position, World::origin);
+  EXPECT_CALL(*plugin_,
+              RenderedVesselTrajectories(
+                  ElementsAre(kVesselGUID, "NCC-1701-E"),
+                  transforms.get(),
+                  World::origin + Displacement<World>(
+                                      {kParentPosition.x * SIUnit<Length>(),
+                                       kParentPosition.y * SIUnit<Length>(),
+                                       kParentPosition.z * SIUnit<Length>()}),
+                  5 * SIUnit<Length>(),
+                  Instant(kTime * SIUnit<Time>())))
+      .WillOnce(Return(rendered_trajectories));
+  LineAndIterator* line_and_iterators[2];
+  principia__RenderedVesselTrajectories(plugin_.get(),
+                                        vessel_guids,
+                                        2,
+                                        transforms.get(),
+                                        kParentPosition,
+                                        5,
+                                        kTime,
+                                        line_and_iterators);
+  EXPECT_EQ(0, principia__NumberOfSegments(line_and_iterators[0]));
+  EXPECT_TRUE(principia__AtEnd(line_and_iterators[0]));
+  EXPECT_EQ(1, principia__NumberOfSegments(line_and_iterators[1]));
+  XYZSegment const segment =
+      principia__FetchAndIncrement(line_and_iterators[1]);
+  EXPECT_EQ(1, segment.begin.x);
+  EXPECT_EQ(0, segment.end.x);
+  EXPECT_TRUE(principia__AtEnd(line_and_iterators[1]));
+  principia__DeleteLineAndIterator(&line_and_iterators[0]);
+  principia__DeleteLineAndIterator(&line_and_iterators[1]);
+}
+
+TEST_F(InterfaceTest, FetchVertices) {
+  auto const position = [](double const x) {
+    return World::origin + Displacement<World>({x * SIUnit<Length>(),
+                                                2 * x * SIUnit<Length>(),
+                                                1E9 * SIUnit<Length>()});
+  };
+  // Two polylines, the first with two segments, the second with one.
+  RenderedTrajectory<World> rendered_trajectory;
+  rendered_trajectory.emplace_back(position(1), position(2));
+  rendered_trajectory.emplace_back(position(2), position(3));
+  rendered_trajectory.emplace_back(position(5), position(8));
+  LineAndIterator line_and_iterator(rendered_trajectory);
+  line_and_iterator.it = line_and_iterator.rendered_trajectory.begin();
+  EXPECT_EQ(5, principia__NumberOfVertices(&line_and_iterator));
+
+  float vertices[15];
+  int indices[6];
+  principia__FetchVertices(&line_and_iterator, {0, 0, 1E9}, vertices, indices);
+  EXPECT_THAT(indices, ElementsAre(0, 1, 1, 2, 3, 4));
+  EXPECT_THAT(vertices, ElementsAre(1, 2, 0,
+                                    2, 4, 0,
+                                    3, 6, 0,
+                                    5, 10, 0,
+                                    8, 16, 0));
+  EXPECT_TRUE(line_and_iterator.it ==
+              line_and_iterator.rendered_trajectory.begin());
+}
+
 TEST_F(InterfaceTest, PhysicsBubble) {
   KSPPart parts[3] = {{{1, 2, 3}, {10, 20, 30}, 300.0, {0, 0, 0}, 1},
                       {{4, 5, 6}, {40, 50, 60}, 600.0, {3, 3, 3}, 4},
@@ -369,6 +886,31 @@ TEST_F(InterfaceTest, PhysicsBubble) {
                                           &parts[0],
                                           3);
 
+  char const* const vessel_guids[2] = {kVesselGUID, "Batch"};
+  int const part_counts[2] = {1, 2};
+  {
+    testing::InSequence s;
+    EXPECT_CALL(*plugin_,
+                AddVesselToNextPhysicsBubbleConstRef(
+                    kVesselGUID,
+                    ElementsAre(
+                        testing::Pair(1, Pointee(Property(&Part<World>::mass,
+                                                          300.0 * Tonne))))));
+    EXPECT_CALL(*plugin_,
+                AddVesselToNextPhysicsBubbleConstRef(
+                    "Batch",
+                    ElementsAre(
+                        testing::Pair(4, Pointee(Property(&Part<World>::mass,
+                                                          600.0 * Tonne))),
+                        testing::Pair(7, Pointee(Property(&Part<World>::mass,
+                                                          900.0 * Tonne))))));
+  }
+  principia__AddVesselsToNextPhysicsBubble(plugin_.get(),
+                                           vessel_guids,
+                                           part_counts,
+                                           2,
+                                           &parts[0]);
+
   EXPECT_CALL(*plugin_,
               BubbleDisplacementCorrection(
                   World::origin + Displacement<World>(
@@ -401,4 +943,198 @@ TEST_F(InterfaceTest, CurrentTime) {
   EXPECT_THAT(Instant(current_time * Second), Eq(kUnixEpoch));
 }
 
+TEST_F(InterfaceTest, StateTable) {
+  StateTable const table = StateTable();
+  EXPECT_CALL(*plugin_, state_table()).WillOnce(ReturnRef(table));
+  EXPECT_EQ(&table, principia__StateTable(plugin_.get()));
+}
+
+TEST_F(InterfaceTest, SetHistoryRetention) {
+  EXPECT_CALL(*plugin_, SetHistoryRetention(3600 * Second, 1000));
+  principia__SetHistoryRetention(plugin_.get(), 3600 /*maximum_age*/, 1000);
+}
+
+TEST_F(InterfaceTest, SetCelestialHistoryCheckpoints) {
+  EXPECT_CALL(*plugin_, SetCelestialHistoryCheckpoints(100, 4));
+  principia__SetCelestialHistoryCheckpoints(plugin_.get(),
+                                            100 /*steps_between_checkpoints*/,
+                                            4 /*cached_segments*/);
+}
+
+TEST_F(InterfaceTest, KeepAndRemoveVessels) {
+  VesselHandle const vessel_handles[] = {3, (1LL << 32) | 5};
+  EXPECT_CALL(*plugin_, KeepVessels(ElementsAre(3, (1LL << 32) | 5)));
+  principia__KeepVessels(plugin_.get(), vessel_handles, 2);
+  EXPECT_CALL(*plugin_, KeepVessels(ElementsAre()));
+  principia__KeepVessels(plugin_.get(), nullptr, 0);
+  EXPECT_CALL(*plugin_, RemoveVessel(kVesselGUID));
+  principia__RemoveVessel(plugin_.get(), kVesselGUID);
+}
+
+TEST_F(InterfaceTest, SetNumberOfThreads) {
+  EXPECT_CALL(*plugin_, SetNumberOfThreads(3));
+  principia__SetNumberOfThreads(plugin_.get(), 3);
+}
+
+TEST_F(InterfaceTest, InterfaceStatistics) {
+  EXPECT_CALL(*plugin_, SetNumberOfThreads(3)).Times(3);
+  principia__SetNumberOfThreads(plugin_.get(), 3);
+  principia__StartInterfaceStatistics();
+  principia__SetNumberOfThreads(plugin_.get(), 3);
+  principia__SetNumberOfThreads(plugin_.get(), 3);
+  principia__StopInterfaceStatistics();
+  principia__DumpInterfaceStatistics();
+  EXPECT_THAT(CallStatistics::Global()->Summary(),
+              HasSubstr("principia__SetNumberOfThreads 2 "));
+}
+
+TEST_F(InterfaceTest, SetKernelConfiguration) {
+  KernelConfiguration configuration;
+  configuration.number_of_threads = 3;
+  configuration.massless_chunks_per_thread = 2;
+  configuration.maximum_vector_instruction_set = VectorInstructionSet::kAVX;
+  EXPECT_CALL(*plugin_, SetKernelConfiguration(configuration));
+  principia__SetKernelConfiguration(plugin_.get(),
+                                    3 /*number_of_threads*/,
+                                    2 /*massless_chunks_per_thread*/,
+                                    1 /*maximum_vector_instruction_set*/);
+}
+
+TEST_F(InterfaceTest, TuneKernels) {
+  std::string const filename = "interface_test_kernels.bin";
+  KernelConfiguration configuration;
+  configuration.number_of_threads = 3;
+  configuration.massless_chunks_per_thread = 2;
+  configuration.maximum_vector_instruction_set = VectorInstructionSet::kNone;
+  WriteKernelConfiguration(filename, configuration);
+  EXPECT_CALL(*plugin_, SetKernelConfiguration(configuration));
+  principia__TuneKernels(plugin_.get(), filename.c_str());
+  std::remove(filename.c_str());
+}
+
+TEST_F(InterfaceTest, Profiling) {
+  EXPECT_CALL(*plugin_, SetProfiling(true));
+  principia__SetProfiling(plugin_.get(), true);
+
+  Plugin::Profile profile;
+  profile.advance_time_calls = 3;
+  profile.evolve_histories = 2 * Second;
+  profile.evolve_prolongations_and_bubble = 0.5 * Second;
+  profile.force_evaluations = 600;
+  profile.history_steps = 100;
+  profile.points_appended = 200;
+  profile.advance_time_allocations.allocations = 40;
+  profile.advance_time_allocations.bytes = 4000;
+  profile.render_calls = 2;
+  profile.render_allocations.allocations = 10;
+  profile.render_allocations.bytes = 1000;
+  EXPECT_CALL(*plugin_, profile()).WillOnce(Return(profile));
+  AdvanceTimeProfile const result = principia__GetProfile(plugin_.get());
+  EXPECT_EQ(3, result.advance_time_calls);
+  EXPECT_EQ(0, result.clean_up_vessels);
+  EXPECT_EQ(2, result.evolve_histories);
+  EXPECT_EQ(0.5, result.evolve_prolongations_and_bubble);
+  EXPECT_EQ(600, result.force_evaluations);
+  EXPECT_EQ(100, result.history_steps);
+  EXPECT_EQ(200, result.points_appended);
+  EXPECT_EQ(40, result.advance_time_allocations);
+  EXPECT_EQ(4000, result.advance_time_allocated_bytes);
+  EXPECT_EQ(2, result.render_calls);
+  EXPECT_EQ(10, result.render_allocations);
+  EXPECT_EQ(1000, result.render_allocated_bytes);
+}
+
+TEST_F(InterfaceTest, ConservationMonitoring) {
+  EXPECT_CALL(*plugin_, SetConservationMonitoring(10));
+  principia__SetConservationMonitoring(plugin_.get(), 10);
+
+  Plugin::ConservationDrift drift;
+  drift.samples = 4;
+  drift.energy = 1E-12;
+  drift.angular_momentum = 2E-13;
+  drift.maximum_energy = 3E-12;
+  drift.maximum_angular_momentum = 4E-13;
+  EXPECT_CALL(*plugin_, conservation_drift()).WillOnce(Return(drift));
+  ConservationDrift const result =
+      principia__GetConservationDrift(plugin_.get());
+  EXPECT_EQ(4, result.samples);
+  EXPECT_EQ(1E-12, result.energy);
+  EXPECT_EQ(2E-13, result.angular_momentum);
+  EXPECT_EQ(3E-12, result.maximum_energy);
+  EXPECT_EQ(4E-13, result.maximum_angular_momentum);
+}
+
+TEST_F(InterfaceTest, MemoryUsage) {
+  Plugin::MemoryUsage usage;
+  usage.celestials = 1000;
+  usage.vessels = 200;
+  usage.bubble = 30;
+  EXPECT_CALL(*plugin_, memory_usage()).WillOnce(Return(usage));
+  MemoryUsage const result = principia__GetMemoryUsage(plugin_.get());
+  EXPECT_EQ(1000, result.celestials);
+  EXPECT_EQ(200, result.vessels);
+  EXPECT_EQ(30, result.bubble);
+
+  EXPECT_CALL(*plugin_, VesselMemoryUsage(kVesselGUID)).WillOnce(Return(42));
+  EXPECT_EQ(42, principia__VesselMemoryUsage(plugin_.get(), kVesselGUID));
+  EXPECT_CALL(*plugin_, CelestialMemoryUsage(kCelestialIndex))
+      .WillOnce(Return(43));
+  EXPECT_EQ(43,
+            principia__CelestialMemoryUsage(plugin_.get(), kCelestialIndex));
+}
+
+TEST_F(InterfaceTest, PluginFile) {
+  std::unique_ptr<Plugin> plugin(principia__NewPlugin(
+                                     kTime,
+                                     kParentIndex /*sun_index*/,
+                                     kGravitationalParameter,
+                                     kPlanetariumRotation));
+  principia__EndInitialization(plugin.get());
+  principia__WritePluginToFile(plugin.get(), "interface_test_plugin.bin");
+  std::unique_ptr<Plugin> const read_plugin(
+      principia__ReadPluginFromFile("interface_test_plugin.bin"));
+  EXPECT_EQ(kTime, principia__current_time(read_plugin.get()));
+}
+
+TEST_F(InterfaceTest, PluginIncrement) {
+  std::unique_ptr<Plugin> plugin(principia__NewPlugin(
+                                     kTime,
+                                     kParentIndex /*sun_index*/,
+                                     kGravitationalParameter,
+                                     kPlanetariumRotation));
+  principia__EndInitialization(plugin.get());
+  principia__WritePluginToFile(plugin.get(), "interface_test_base.bin");
+  principia__AdvanceTime(plugin.get(), kTime + 100, kPlanetariumRotation);
+  principia__WritePluginIncrementToFile(plugin.get(),
+                                        "interface_test_increment.bin",
+                                        "interface_test_base.bin");
+  principia__CompactPluginFiles("interface_test_base.bin",
+                                "interface_test_increment.bin",
+                                "interface_test_compacted.bin");
+  std::unique_ptr<Plugin> const read_plugin(
+      principia__ReadPluginFromFile("interface_test_compacted.bin"));
+  EXPECT_EQ(kTime + 100, principia__current_time(read_plugin.get()));
+}
+
+TEST_F(InterfaceTest, PluginSave) {
+  std::unique_ptr<Plugin> plugin(principia__NewPlugin(
+                                     kTime,
+                                     kParentIndex /*sun_index*/,
+                                     kGravitationalParameter,
+                                     kPlanetariumRotation));
+  principia__EndInitialization(plugin.get());
+  PluginSave* plugin_save = principia__StartWritingPluginToFile(
+                                plugin.get(), "interface_test_plugin_save.bin");
+  // The plugin may be destroyed while its file is being written.
+  plugin.reset();
+  while (!principia__PluginSaveCompleted(plugin_save)) {
+    std::this_thread::yield();
+  }
+  principia__DeletePluginSave(&plugin_save);
+  EXPECT_THAT(plugin_save, IsNull());
+  std::unique_ptr<Plugin> const read_plugin(
+      principia__ReadPluginFromFile("interface_test_plugin_save.bin"));
+  EXPECT_EQ(kTime, principia__current_time(read_plugin.get()));
+}
+
 }  // namespace
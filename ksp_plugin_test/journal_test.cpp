@@ -0,0 +1,126 @@
+#include "ksp_plugin/journal.hpp"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "ksp_plugin/interface.hpp"
+
+using principia::ksp_plugin::Journal;
+using principia::ksp_plugin::Player;
+using testing::Contains;
+using testing::ElementsAre;
+using testing::Field;
+using testing::Key;
+using testing::Not;
+
+namespace {
+
+char const kVesselGUID[] = "NCC-1701-D";
+
+int const kSunIndex = 0;
+int const kPlanetIndex = 1;
+
+double const kSunGravitationalParameter = 1.32712440018E20;
+double const kPlanetGravitationalParameter = 3.986004418E14;
+
+QP const kPlanetFromSun = {{1.5E11, 0, 0}, {0, 3E4, 0}};
+QP const kVesselFromPlanet = {{7E6, 0, 0}, {0, 7.5E3, 0}};
+
+}  // namespace
+
+class JournalTest : public testing::Test {
+ protected:
+  // Calls the journaled functions of the C interface for a short session with
+  // a sun, a planet and a vessel.  If |delete_plugin| is false, the deletion of
+  // the plugin is not journaled and the caller takes ownership of the result,
+  // otherwise the result is null.
+  std::unique_ptr<Plugin> RunSession(std::string const& filename,
+                                     bool const delete_plugin) {
+    principia__StartJournaling(filename.c_str());
+    Plugin* plugin = principia__NewPlugin(0 /*initial_time*/,
+                                          kSunIndex,
+                                          kSunGravitationalParameter,
+                                          0 /*planetarium_rotation*/);
+    principia__InsertCelestial(plugin,
+                               kPlanetIndex,
+                               kPlanetGravitationalParameter,
+                               kSunIndex,
+                               kPlanetFromSun);
+    principia__EndInitialization(plugin);
+    principia__InsertOrKeepVessel(plugin, kVesselGUID, kPlanetIndex);
+    principia__SetVesselStateOffset(plugin, kVesselGUID, kVesselFromPlanet);
+    principia__AdvanceTime(plugin, 10 /*t*/, 0 /*planetarium_rotation*/);
+    principia__VesselFromParent(plugin, kVesselGUID);
+    principia__AdvanceTime(plugin, 20 /*t*/, 0 /*planetarium_rotation*/);
+    if (delete_plugin) {
+      Plugin const* const_plugin = plugin;
+      principia__DeletePlugin(&const_plugin);
+      plugin = nullptr;
+    }
+    principia__StopJournaling();
+    return std::unique_ptr<Plugin>(plugin);
+  }
+};
+
+TEST_F(JournalTest, Replay) {
+  RunSession("journal_test_replay.journal", true /*delete_plugin*/);
+  Player player("journal_test_replay.journal");
+  int entries = 0;
+  while (player.Play()) {
+    ++entries;
+  }
+  EXPECT_EQ(9, entries);
+  // Playing past the end is harmless.
+  EXPECT_FALSE(player.Play());
+  EXPECT_THAT(
+      player.statistics(),
+      ElementsAre(
+          testing::Pair("AdvanceTime", Field(&Player::Statistics::calls, 2)),
+          testing::Pair("DeletePlugin", Field(&Player::Statistics::calls, 1)),
+          testing::Pair("EndInitialization",
+                        Field(&Player::Statistics::calls, 1)),
+          testing::Pair("InsertCelestial",
+                        Field(&Player::Statistics::calls, 1)),
+          testing::Pair("InsertOrKeepVessel",
+                        Field(&Player::Statistics::calls, 1)),
+          testing::Pair("NewPlugin", Field(&Player::Statistics::calls, 1)),
+          testing::Pair("SetVesselStateOffset",
+                        Field(&Player::Statistics::calls, 1)),
+          testing::Pair("VesselFromParent",
+                        Field(&Player::Statistics::calls, 1))));
+  for (auto const& pair : player.statistics()) {
+    EXPECT_LE(pair.second.maximum, pair.second.total) << pair.first;
+  }
+}
+
+TEST_F(JournalTest, Disabled) {
+  EXPECT_FALSE(Journal::Global()->enabled());
+  RunSession("journal_test_disabled.journal", true /*delete_plugin*/);
+  EXPECT_FALSE(Journal::Global()->enabled());
+  // Stopping twice is harmless.
+  principia__StopJournaling();
+  // The calls made while the journal is disabled are not recorded.
+  Plugin* plugin = principia__NewPlugin(0 /*initial_time*/,
+                                        kSunIndex,
+                                        kSunGravitationalParameter,
+                                        0 /*planetarium_rotation*/);
+  Plugin const* const_plugin = plugin;
+  principia__DeletePlugin(&const_plugin);
+  Player player("journal_test_disabled.journal");
+  int entries = 0;
+  while (player.Play()) {
+    ++entries;
+  }
+  EXPECT_EQ(9, entries);
+}
+
+TEST_F(JournalTest, LeakedPlugin) {
+  std::unique_ptr<Plugin> const plugin =
+      RunSession("journal_test_leaked.journal", false /*delete_plugin*/);
+  // The player deletes the plugin when it is destroyed.
+  Player player("journal_test_leaked.journal");
+  while (player.Play()) {}
+  EXPECT_THAT(player.statistics(), Not(Contains(Key("DeletePlugin"))));
+}
@@ -0,0 +1,126 @@
+#include "ksp_plugin/kernel_tuning.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/cpu_features.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "quantities/si.hpp"
+
+using principia::base::DetectedCPUFeatures;
+using principia::base::MaximumVectorInstructionSet;
+using principia::si::Second;
+using testing::Eq;
+using testing::Gt;
+
+namespace principia {
+namespace ksp_plugin {
+
+class KernelTuningTest : public testing::Test {
+ protected:
+  KernelTuningTest() : filename_("kernel_tuning_test_configuration.bin") {
+    std::remove(filename_.c_str());
+  }
+
+  ~KernelTuningTest() override {
+    std::remove(filename_.c_str());
+  }
+
+  std::string const filename_;
+};
+
+// Checks that each parameter is chosen in turn, and that a later candidate
+// must be significantly faster to be chosen.
+TEST_F(KernelTuningTest, Search) {
+  std::vector<KernelConfiguration> benchmarked;
+  // The time is inversely proportional to the number of threads, each chunk
+  // per thread beyond 1 saves 0.5%, and AVX saves 50%.
+  KernelBenchmark const benchmark =
+      [&benchmarked](KernelConfiguration const& configuration) {
+        benchmarked.push_back(configuration);
+        double const vector_factor =
+            configuration.maximum_vector_instruction_set ==
+                    VectorInstructionSet::kNone
+                ? 1.0
+                : 0.5;
+        return vector_factor *
+               (1 - 0.005 * (configuration.massless_chunks_per_thread - 1)) /
+               configuration.number_of_threads * Second;
+      };
+  KernelConfiguration const configuration = TuneKernels(benchmark);
+
+  int const maximum_number_of_threads = std::max(
+      1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+  EXPECT_THAT(configuration.number_of_threads,
+              Eq(maximum_number_of_threads));
+  EXPECT_THAT(configuration.massless_chunks_per_thread, Eq(1));
+  if (DetectedCPUFeatures().avx) {
+    // AVX-512F is not significantly faster than AVX.
+    EXPECT_THAT(configuration.maximum_vector_instruction_set,
+                Eq(VectorInstructionSet::kAVX));
+  } else {
+    EXPECT_THAT(configuration.maximum_vector_instruction_set,
+                Eq(VectorInstructionSet::kNone));
+  }
+  EXPECT_THAT(benchmarked.front().number_of_threads, Eq(1));
+  EXPECT_THAT(benchmarked.front().maximum_vector_instruction_set,
+              Eq(VectorInstructionSet::kNone));
+}
+
+TEST_F(KernelTuningTest, ReadAndWrite) {
+  KernelConfiguration configuration;
+  EXPECT_FALSE(ReadKernelConfiguration(filename_, &configuration));
+
+  KernelConfiguration written;
+  written.number_of_threads = 3;
+  written.massless_chunks_per_thread = 4;
+  written.maximum_vector_instruction_set = VectorInstructionSet::kNone;
+  WriteKernelConfiguration(filename_, written);
+  EXPECT_TRUE(ReadKernelConfiguration(filename_, &configuration));
+  EXPECT_THAT(configuration, Eq(written));
+
+  // A configuration tuned for a processor with other instruction sets.
+  serialization::KernelConfiguration message;
+  written.WriteToMessage(&message);
+  message.set_avx(!message.avx());
+  {
+    std::ofstream file(filename_, std::ios::binary);
+    ASSERT_TRUE(message.SerializeToOstream(&file));
+  }
+  EXPECT_FALSE(ReadKernelConfiguration(filename_, &configuration));
+}
+
+// Checks that the configuration is only tuned if the file is missing.
+TEST_F(KernelTuningTest, ReadOrTune) {
+  int calls = 0;
+  KernelBenchmark const benchmark =
+      [&calls](KernelConfiguration const& configuration) {
+        ++calls;
+        return 1 * Second;
+      };
+  KernelConfiguration const tuned =
+      ReadOrTuneKernelConfiguration(filename_, benchmark);
+  EXPECT_THAT(calls, Gt(0));
+  calls = 0;
+  EXPECT_THAT(ReadOrTuneKernelConfiguration(filename_, benchmark), Eq(tuned));
+  EXPECT_THAT(calls, Eq(0));
+}
+
+TEST_F(KernelTuningTest, Benchmark) {
+  KernelConfiguration configuration;
+  configuration.number_of_threads = 2;
+  configuration.massless_chunks_per_thread = 2;
+  configuration.maximum_vector_instruction_set = VectorInstructionSet::kNone;
+  EXPECT_THAT(BenchmarkGravitationalAccelerations(configuration),
+              Gt(0 * Second));
+  EXPECT_THAT(MaximumVectorInstructionSet(),
+              Eq(VectorInstructionSet::kAVX512F));
+}
+
+}  // namespace ksp_plugin
+}  // namespace principia
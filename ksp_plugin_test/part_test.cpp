@@ -1,6 +1,8 @@
 
 #include "ksp_plugin/part.hpp"
 
+#include <memory>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -78,5 +80,21 @@ TEST_F(PartTest, Serialization) {
             p.gravitational_acceleration_to_be_applied_by_ksp());
 }
 
+// The memory of a destroyed part is reused for the next one.
+TEST_F(PartTest, Pool) {
+  Part<Barycentric>* const part =
+      new Part<Barycentric>(degrees_of_freedom_,
+                            mass_,
+                            gravitational_acceleration_to_be_applied_by_ksp_);
+  delete part;
+  std::unique_ptr<Part<Barycentric>> const recycled_part =
+      std::make_unique<Part<Barycentric>>(
+          part_.degrees_of_freedom(),
+          part_.mass(),
+          part_.gravitational_acceleration_to_be_applied_by_ksp());
+  EXPECT_EQ(part, recycled_part.get());
+  EXPECT_EQ(mass_, recycled_part->mass());
+}
+
 }  // namespace ksp_plugin
 }  // namespace principia
@@ -372,6 +372,31 @@ TEST_F(PhysicsBubbleTest, OneVesselTwoSteps) {
   CheckOneVesselDegreesOfFreedom(bubble_);
 }
 
+// When the set of parts doesn't change, the trajectory of the centre of mass
+// keeps only its last points.
+TEST_F(PhysicsBubbleTest, OneVesselManySteps) {
+  std::vector<IdAndOwnedPart> parts;
+  std::vector<Instant> times;
+  for (int i = 0; i < 10; ++i) {
+    Instant const current_time = t1_ + i * SIUnit<Time>();
+    Instant const next_time = current_time + 1 * SIUnit<Time>();
+    CreateParts();
+    parts.push_back({11, std::move(p1a_)});
+    parts.push_back({12, std::move(p1b_)});
+    bubble_.AddVesselToNext(&vessel1_, std::move(parts));
+    parts.clear();
+    bubble_.Prepare(rotation_, current_time, next_time);
+    bubble_.VelocityCorrection(rotation_, celestial_);
+    // Simulate the integration of the bubble.
+    bubble_.mutable_centre_of_mass_trajectory()->Append(
+        next_time,
+        bubble_.centre_of_mass_trajectory().last().degrees_of_freedom());
+    times.push_back(next_time);
+  }
+  EXPECT_THAT(bubble_.centre_of_mass_trajectory().Times(),
+              ElementsAre(times[5], times[6], times[7], times[8], times[9]));
+}
+
 TEST_F(PhysicsBubbleTest, OneVesselPartRemoved) {
   std::vector<IdAndOwnedPart> parts;
   CreateParts();
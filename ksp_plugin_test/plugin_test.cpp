@@ -3,9 +3,12 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <limits>
 #include <map>
 #include <memory>
+#include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -30,6 +33,7 @@ using principia::si::Hour;
 using principia::si::Minute;
 using principia::si::Radian;
 using principia::si::AstronomicalUnit;
+using principia::si::Centi;
 using principia::testing_utilities::AbsoluteError;
 using principia::testing_utilities::AlmostEquals;
 using principia::testing_utilities::Componentwise;
@@ -38,12 +42,15 @@ using principia::testing_utilities::RelativeError;
 using principia::testing_utilities::SolarSystem;
 using testing::AllOf;
 using testing::Contains;
+using testing::ElementsAre;
 using testing::Eq;
 using testing::Ge;
 using testing::Gt;
 using testing::InSequence;
+using testing::IsEmpty;
 using testing::Le;
 using testing::Lt;
+using testing::Ne;
 using testing::Ref;
 using testing::SizeIs;
 using testing::StrictMock;
@@ -69,6 +76,26 @@ ACTION_TEMPLATE(AppendTimeToTrajectories,
   }
 }
 
+// Appends to each |Trajectory| of the plan in the |k|th parameter of the
+// expected call a |Point| at |time| with the degrees of freedom of its last
+// point.  This parameter must be a |not_null<NBodySystem<Barycentric>::Plan*>|,
+// |time| must be an |Instant|.
+ACTION_TEMPLATE(AppendTimeToPlannedTrajectories,
+                HAS_1_TEMPLATE_PARAMS(int, k),
+                AND_1_VALUE_PARAMS(time)) {
+  for (auto trajectory : std::tr1::get<k>(args)->trajectories()) {
+    trajectory->Append(time, trajectory->last().degrees_of_freedom());
+  }
+}
+
+// Matches a |not_null<NBodySystem<Barycentric>::Plan*>| whose trajectories
+// match |matcher|.
+MATCHER_P(HasPlannedTrajectories, matcher, "") {
+  return testing::ExplainMatchResult(matcher,
+                                     arg->trajectories(),
+                                     result_listener);
+}
+
 MATCHER_P(HasNonvanishingIntrinsicAccelerationAt, t, "") {
   if (arg->has_intrinsic_acceleration()) {
     if (arg->evaluate_intrinsic_acceleration(t) ==
@@ -111,9 +138,33 @@ class TestablePlugin : public Plugin {
     return prolongation_integrator_;
   }
 
+  EmbeddedExplicitRungeKuttaNyströmIntegrator<Length> const&
+  adaptive_prolongation_integrator() const {
+    return adaptive_prolongation_integrator_;
+  }
+
   SPRKIntegrator<Length, Speed> const& history_integrator() const {
     return history_integrator_;
   }
+
+  SPRKIntegrator<Length, Speed> const& prediction_integrator() const {
+    return prediction_integrator_;
+  }
+
+  static Trajectory<Barycentric> const& celestial_history(
+      Plugin const& plugin,
+      Index const celestial_index) {
+    return plugin.celestials_.at(celestial_index)->history();
+  }
+
+  static Time const& history_step(Plugin const& plugin) {
+    return plugin.Δt_;
+  }
+
+  static Trajectory<Barycentric> const& vessel_history(Plugin const& plugin,
+                                                       GUID const& guid) {
+    return plugin.vessels_.at(guid)->history();
+  }
 };
 
 class PluginTest : public testing::Test {
@@ -153,6 +204,10 @@ class PluginTest : public testing::Test {
   }
 
   void InsertAllSolarSystemBodies() {
+    InsertAllSolarSystemBodies(plugin_.get());
+  }
+
+  void InsertAllSolarSystemBodies(not_null<Plugin*> const plugin) {
     for (std::size_t index = SolarSystem::kSun + 1;
          index < bodies_.size();
          ++index) {
@@ -162,10 +217,10 @@ class PluginTest : public testing::Test {
               last().degrees_of_freedom() -
           solar_system_->trajectories()[parent_index]->
               last().degrees_of_freedom());
-      plugin_->InsertCelestial(index,
-                               bodies_[index]->gravitational_parameter(),
-                               parent_index,
-                               from_parent);
+      plugin->InsertCelestial(index,
+                              bodies_[index]->gravitational_parameter(),
+                              parent_index,
+                              from_parent);
     }
   }
 
@@ -269,6 +324,251 @@ TEST_F(PluginTest, Serialization) {
   EXPECT_EQ(1, message.vessel_size());
   EXPECT_EQ(SolarSystem::kEarth, message.vessel(0).parent_index());
   EXPECT_FALSE(message.bubble().has_current());
+  EXPECT_EQ(Plugin::kSerializationVersion, message.version());
+  EXPECT_TRUE(message.celestial(0).celestial().history_and_prolongation().
+                  history().has_compressed_columns());
+  EXPECT_TRUE(message.vessel(0).vessel().owned_prolongation().
+                  has_compressed_columns());
+}
+
+TEST_F(PluginTest, Records) {
+  GUID const satellite = "satellite";
+  auto plugin = make_not_null_unique<Plugin>(
+                    initial_time_,
+                    SolarSystem::kSun,
+                    sun_gravitational_parameter_,
+                    planetarium_rotation_);
+  for (std::size_t index = SolarSystem::kSun + 1;
+       index < bodies_.size();
+       ++index) {
+    Index const parent_index = SolarSystem::parent(index);
+    RelativeDegreesOfFreedom<AliceSun> const from_parent = looking_glass_(
+        solar_system_->trajectories()[index]->
+            last().degrees_of_freedom() -
+        solar_system_->trajectories()[parent_index]->
+            last().degrees_of_freedom());
+    plugin->InsertCelestial(index,
+                            bodies_[index]->gravitational_parameter(),
+                            parent_index,
+                            from_parent);
+  }
+  plugin->EndInitialization();
+  plugin->InsertOrKeepVessel(satellite, SolarSystem::kEarth);
+  plugin->SetVesselStateOffset(satellite,
+                               RelativeDegreesOfFreedom<AliceSun>(
+                                   satellite_initial_displacement_,
+                                   satellite_initial_velocity_));
+  std::vector<serialization::PluginRecord> records;
+  plugin->WriteToRecords(
+      [&records](not_null<serialization::PluginRecord*> const record) {
+        records.push_back(*record);
+      });
+  // A header, the celestials, the vessel and the bubble.
+  ASSERT_EQ(bodies_.size() + 3, records.size());
+  EXPECT_TRUE(records.front().has_header());
+  EXPECT_EQ(Plugin::kSerializationVersion, records.front().header().version());
+  EXPECT_TRUE(records[1].has_celestial());
+  EXPECT_TRUE(records[bodies_.size() + 1].has_vessel());
+  EXPECT_TRUE(records.back().has_bubble());
+
+  // Compressing the uncompressed records yields the same records.
+  std::size_t uncompressed = 0;
+  plugin->WriteToUncompressedRecords(
+      [&records, &uncompressed](
+          not_null<serialization::PluginRecord*> const record) {
+        ASSERT_LT(uncompressed, records.size());
+        Plugin::CompressRecord(record);
+        EXPECT_EQ(records[uncompressed].SerializeAsString(),
+                  record->SerializeAsString());
+        ++uncompressed;
+      });
+  EXPECT_EQ(records.size(), uncompressed);
+
+  std::size_t next = 0;
+  std::unique_ptr<Plugin> const read_plugin = Plugin::ReadFromRecords(
+      [&records, &next](not_null<serialization::PluginRecord*> const record) {
+        if (next == records.size()) {
+          return false;
+        }
+        *record = records[next];
+        ++next;
+        return true;
+      });
+  serialization::Plugin message;
+  serialization::Plugin read_message;
+  plugin->WriteToMessage(&message);
+  read_plugin->WriteToMessage(&read_message);
+  EXPECT_EQ(message.SerializeAsString(), read_message.SerializeAsString());
+}
+
+// Checks that the records written in parallel are those written serially, in
+// the same order.
+TEST_F(PluginTest, ParallelRecords) {
+  InsertAllSolarSystemBodies();
+  plugin_->EndInitialization();
+  for (int i = 0; i < 11; ++i) {
+    GUID const guid = "V" + std::to_string(i);
+    EXPECT_TRUE(plugin_->InsertOrKeepVessel(guid, SolarSystem::kEarth));
+    plugin_->SetVesselStateOffset(guid,
+                                  RelativeDegreesOfFreedom<AliceSun>(
+                                      (i + 1) * satellite_initial_displacement_,
+                                      satellite_initial_velocity_));
+  }
+  std::vector<std::string> serial_records;
+  plugin_->WriteToRecords(
+      [&serial_records](not_null<serialization::PluginRecord*> const record) {
+        serial_records.push_back(record->SerializeAsString());
+      });
+  serialization::Plugin serial_message;
+  plugin_->WriteToMessage(&serial_message);
+
+  plugin_->SetNumberOfThreads(3);
+  std::vector<std::string> parallel_records;
+  plugin_->WriteToRecords(
+      [&parallel_records](not_null<serialization::PluginRecord*> const record) {
+        parallel_records.push_back(record->SerializeAsString());
+      });
+  EXPECT_EQ(serial_records, parallel_records);
+  serialization::Plugin parallel_message;
+  plugin_->WriteToMessage(&parallel_message);
+  EXPECT_EQ(serial_message.SerializeAsString(),
+            parallel_message.SerializeAsString());
+  EXPECT_EQ(11, parallel_message.vessel_size());
+}
+
+TEST_F(PluginTest, IncrementalRecords) {
+  GUID const satellite = "satellite";
+  GUID const new_satellite = "new satellite";
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  plugin.InsertOrKeepVessel(satellite, SolarSystem::kEarth);
+  plugin.SetVesselStateOffset(satellite,
+                              RelativeDegreesOfFreedom<AliceSun>(
+                                  satellite_initial_displacement_,
+                                  satellite_initial_velocity_));
+  Instant t = initial_time_;
+  for (Instant const t_end = t + 1 * Minute; t < t_end;) {
+    t += 7 * Second;
+    plugin.InsertOrKeepVessel(satellite, SolarSystem::kEarth);
+    plugin.AdvanceTime(t, planetarium_rotation_);
+  }
+  std::vector<serialization::PluginRecord> base;
+  plugin.WriteToRecords(
+      [&base](not_null<serialization::PluginRecord*> const record) {
+        base.push_back(*record);
+      });
+  ASSERT_TRUE(base.front().header().has_history_time());
+  Instant const since =
+      Instant::ReadFromMessage(base.front().header().history_time());
+
+  // A vessel is inserted after the base, and is written in full.
+  plugin.InsertOrKeepVessel(new_satellite, SolarSystem::kEarth);
+  plugin.SetVesselStateOffset(new_satellite,
+                              RelativeDegreesOfFreedom<AliceSun>(
+                                  2 * satellite_initial_displacement_,
+                                  satellite_initial_velocity_));
+  for (Instant const t_end = t + 1 * Minute; t < t_end;) {
+    t += 7 * Second;
+    plugin.InsertOrKeepVessel(satellite, SolarSystem::kEarth);
+    plugin.InsertOrKeepVessel(new_satellite, SolarSystem::kEarth);
+    plugin.AdvanceTime(t, planetarium_rotation_);
+  }
+  std::vector<serialization::PluginRecord> increment;
+  plugin.WriteIncrementToRecords(
+      since,
+      [&increment](not_null<serialization::PluginRecord*> const record) {
+        increment.push_back(*record);
+      });
+  std::vector<serialization::PluginRecord> reference;
+  plugin.WriteToRecords(
+      [&reference](not_null<serialization::PluginRecord*> const record) {
+        reference.push_back(*record);
+      });
+
+  // A header, the celestials, the vessels and the bubble.
+  ASSERT_EQ(bodies_.size() + 4, increment.size());
+  EXPECT_TRUE(increment.front().header().has_increment_since());
+  for (std::size_t i = 1; i <= bodies_.size(); ++i) {
+    serialization::Trajectory const& history =
+        increment[i].celestial().celestial().history_and_prolongation().
+            history();
+    serialization::Trajectory const& reference_history =
+        reference[i].celestial().celestial().history_and_prolongation().
+            history();
+    EXPECT_TRUE(history.has_increment_since());
+    // Only the points after the base are written.
+    EXPECT_EQ(reference_history.compressed_columns().size() -
+                  base[i].celestial().celestial().history_and_prolongation().
+                      history().compressed_columns().size(),
+              history.compressed_columns().size());
+  }
+  ASSERT_EQ(new_satellite, increment[bodies_.size() + 1].vessel().guid());
+  EXPECT_FALSE(increment[bodies_.size() + 1].vessel().vessel().
+                   history_and_prolongation().history().
+                       has_increment_since());
+  ASSERT_EQ(satellite, increment[bodies_.size() + 2].vessel().guid());
+  EXPECT_TRUE(increment[bodies_.size() + 2].vessel().vessel().
+                  history_and_prolongation().history().
+                      has_increment_since());
+
+  std::vector<serialization::PluginRecord> const compacted =
+      Plugin::CompactRecords(base, increment);
+  ASSERT_EQ(reference.size(), compacted.size());
+  for (std::size_t i = 0; i < reference.size(); ++i) {
+    EXPECT_EQ(reference[i].SerializeAsString(),
+              compacted[i].SerializeAsString()) << i;
+  }
+}
+
+TEST_F(PluginDeathTest, IncrementalRecordsError) {
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  std::vector<serialization::PluginRecord> base;
+  plugin.WriteToRecords(
+      [&base](not_null<serialization::PluginRecord*> const record) {
+        base.push_back(*record);
+      });
+  std::vector<serialization::PluginRecord> increment;
+  plugin.WriteIncrementToRecords(
+      initial_time_,
+      [&increment](not_null<serialization::PluginRecord*> const record) {
+        increment.push_back(*record);
+      });
+  EXPECT_DEATH({
+    Plugin::CompactRecords(increment, increment);
+  }, "compacted first");
+  EXPECT_DEATH({
+    std::size_t next = 0;
+    Plugin::ReadFromRecords(
+        [&increment, &next](
+            not_null<serialization::PluginRecord*> const record) {
+          if (next == increment.size()) {
+            return false;
+          }
+          *record = increment[next++];
+          return true;
+        });
+  }, "must be compacted");
+  EXPECT_DEATH({
+    base.front().mutable_header()->clear_history_time();
+    Plugin::CompactRecords(base, increment);
+  }, "older version");
+}
+
+TEST_F(PluginDeathTest, SerializationVersionError) {
+  EXPECT_DEATH({
+    serialization::Plugin message;
+    message.set_version(Plugin::kSerializationVersion + 1);
+    Plugin::ReadFromMessage(message);
+  }, "more recent version");
 }
 
 TEST_F(PluginTest, Initialization) {
@@ -294,6 +594,61 @@ TEST_F(PluginTest, Initialization) {
   }
 }
 
+TEST_F(PluginTest, InsertCelestials) {
+  InsertAllSolarSystemBodies();
+  plugin_->EndInitialization();
+  // The children are listed before their parents.
+  std::vector<Plugin::CelestialDescription> celestials;
+  for (std::size_t index = bodies_.size() - 1;
+       index > SolarSystem::kSun;
+       --index) {
+    Index const parent_index = SolarSystem::parent(index);
+    celestials.push_back(
+        {static_cast<Index>(index),
+         bodies_[index]->gravitational_parameter(),
+         parent_index,
+         looking_glass_(solar_system_->trajectories()[index]->
+                            last().degrees_of_freedom() -
+                        solar_system_->trajectories()[parent_index]->
+                            last().degrees_of_freedom())});
+  }
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  plugin.InsertCelestials(celestials);
+  plugin.EndInitialization();
+  for (std::size_t index = SolarSystem::kSun + 1;
+       index < bodies_.size();
+       ++index) {
+    EXPECT_EQ(plugin_->CelestialFromParent(index),
+              plugin.CelestialFromParent(index));
+  }
+}
+
+TEST_F(PluginDeathTest, InsertCelestialsError) {
+  RelativeDegreesOfFreedom<AliceSun> const from_parent = looking_glass_(
+      solar_system_->trajectories().front()->last().degrees_of_freedom() -
+      solar_system_->trajectories().front()->last().degrees_of_freedom());
+  GravitationalParameter const gravitational_parameter =
+      bodies_.front()->gravitational_parameter();
+  EXPECT_DEATH({
+    plugin_->InsertCelestials(
+        {{42, gravitational_parameter, 43, from_parent},
+         {43, gravitational_parameter, kNotABody, from_parent}});
+  }, "No body at index");
+  EXPECT_DEATH({
+    plugin_->InsertCelestials(
+        {{42, gravitational_parameter, 43, from_parent},
+         {43, gravitational_parameter, 42, from_parent}});
+  }, "Cycle");
+  EXPECT_DEATH({
+    plugin_->InsertCelestials(
+        {{42, gravitational_parameter, SolarSystem::kSun, from_parent},
+         {42, gravitational_parameter, SolarSystem::kSun, from_parent}});
+  }, "Body already exists");
+}
+
 TEST_F(PluginDeathTest, InsertCelestialError) {
   RelativeDegreesOfFreedom<AliceSun> const from_parent = looking_glass_(
       solar_system_->trajectories().front()->last().degrees_of_freedom() -
@@ -352,6 +707,12 @@ TEST_F(PluginDeathTest, InsertOrKeepVesselError) {
   }, "No body at index");
 }
 
+TEST_F(PluginDeathTest, SetNumberOfThreadsError) {
+  EXPECT_DEATH({
+    plugin_->SetNumberOfThreads(0);
+  }, "Check failed: 0 < number_of_threads");
+}
+
 TEST_F(PluginDeathTest, SetVesselStateOffsetError) {
   GUID const guid = "Test Satellite";
   EXPECT_DEATH({
@@ -410,6 +771,40 @@ TEST_F(PluginDeathTest, VesselFromParentError) {
   }, "not given an initial state");
 }
 
+TEST_F(PluginDeathTest, VesselHandleError) {
+  GUID const guid = "Test Satellite";
+  EXPECT_DEATH({
+    InsertAllSolarSystemBodies();
+    plugin_->EndInitialization();
+    plugin_->vessel_handle(guid);
+  }, "No vessel with GUID");
+  EXPECT_DEATH({
+    InsertAllSolarSystemBodies();
+    plugin_->EndInitialization();
+    plugin_->InsertOrKeepVessel(guid, SolarSystem::kSun);
+    plugin_->VesselFromParent(VesselHandle(42));
+  }, "Invalid vessel handle");
+  EXPECT_DEATH({
+    InsertAllSolarSystemBodies();
+    plugin_->EndInitialization();
+    plugin_->InsertOrKeepVessel(guid, SolarSystem::kSun);
+    plugin_->VesselFromParent(plugin_->vessel_handle(guid) + (1LL << 32));
+  }, "Stale vessel handle");
+}
+
+TEST_F(PluginTest, AllCelestialsFromParent) {
+  InsertAllSolarSystemBodies();
+  plugin_->EndInitialization();
+  std::vector<RelativeDegreesOfFreedom<AliceSun>> const from_parents =
+      plugin_->AllCelestialsFromParent();
+  ASSERT_EQ(bodies_.size() - 1, from_parents.size());
+  for (std::size_t index = SolarSystem::kSun + 1;
+       index < bodies_.size();
+       ++index) {
+    EXPECT_EQ(plugin_->CelestialFromParent(index), from_parents[index - 1]);
+  }
+}
+
 TEST_F(PluginDeathTest, CelestialFromParentError) {
   EXPECT_DEATH({
     InsertAllSolarSystemBodies();
@@ -442,6 +837,175 @@ TEST_F(PluginTest, VesselInsertionAtInitialization) {
               Componentwise(
                   AlmostEquals(satellite_initial_displacement_, 7460),
                   AlmostEquals(satellite_initial_velocity_, 3)));
+
+  // The handles of distinct vessels are distinct, and the vessel may be
+  // accessed through its handle.
+  GUID const other_guid = "Other Satellite";
+  EXPECT_TRUE(plugin_->InsertOrKeepVessel(other_guid, SolarSystem::kEarth));
+  VesselHandle const handle = plugin_->vessel_handle(guid);
+  EXPECT_NE(handle, plugin_->vessel_handle(other_guid));
+  EXPECT_FALSE(plugin_->InsertOrKeepVessel(guid, SolarSystem::kEarth));
+  EXPECT_EQ(handle, plugin_->vessel_handle(guid));
+  EXPECT_THAT(plugin_->VesselFromParent(handle),
+              Componentwise(
+                  AlmostEquals(satellite_initial_displacement_, 7460),
+                  AlmostEquals(satellite_initial_velocity_, 3)));
+  Position<World> const parent_world_position =
+      World::origin + Displacement<World>({1 * Metre, 2 * Metre, 3 * Metre});
+  EXPECT_EQ(plugin_->VesselWorldPosition(guid, parent_world_position),
+            plugin_->VesselWorldPosition(handle, parent_world_position));
+}
+
+// Checks that the vessels inserted in bulk are in the same state as those
+// inserted one by one, and that the existing vessels are only kept.
+TEST_F(PluginTest, InsertVessels) {
+  InsertAllSolarSystemBodies();
+  plugin_->EndInitialization();
+  RelativeDegreesOfFreedom<AliceSun> const from_parent(
+      satellite_initial_displacement_,
+      satellite_initial_velocity_);
+  EXPECT_TRUE(plugin_->InsertOrKeepVessel("V0", SolarSystem::kEarth));
+  plugin_->SetVesselStateOffset("V0", from_parent);
+  EXPECT_TRUE(plugin_->InsertOrKeepVessel("Reference", SolarSystem::kMoon));
+  plugin_->SetVesselStateOffset("Reference", from_parent);
+  VesselHandle const v0 = plugin_->vessel_handle("V0");
+
+  std::vector<VesselHandle> const handles = plugin_->InsertVessels(
+      {"V1", "V0", "V2"},
+      {SolarSystem::kMoon, SolarSystem::kEarth, SolarSystem::kEarth},
+      {from_parent,
+       RelativeDegreesOfFreedom<AliceSun>(2 * satellite_initial_displacement_,
+                                          satellite_initial_velocity_),
+       from_parent});
+  ASSERT_EQ(3, handles.size());
+  EXPECT_EQ(plugin_->vessel_handle("V1"), handles[0]);
+  EXPECT_EQ(v0, handles[1]);
+  EXPECT_EQ(plugin_->vessel_handle("V2"), handles[2]);
+  EXPECT_NE(handles[0], handles[2]);
+  EXPECT_EQ(plugin_->VesselFromParent("Reference"),
+            plugin_->VesselFromParent("V1"));
+  EXPECT_EQ(plugin_->VesselFromParent("V0"),
+            plugin_->VesselFromParent("V2"));
+  EXPECT_FALSE(plugin_->InsertOrKeepVessel("V2", SolarSystem::kEarth));
+}
+
+// Checks that the vessels kept in bulk survive |AdvanceTime|, and that the
+// removed ones don't.
+TEST_F(PluginTest, KeepAndRemoveVessels) {
+  InsertAllSolarSystemBodies();
+  plugin_->EndInitialization();
+  Angle const planetarium_rotation = 42 * Radian;
+  std::vector<VesselHandle> handles;
+  for (GUID const guid : {"V0", "V1", "V2"}) {
+    EXPECT_TRUE(plugin_->InsertOrKeepVessel(guid, SolarSystem::kEarth));
+    plugin_->SetVesselStateOffset(guid,
+                                  RelativeDegreesOfFreedom<AliceSun>(
+                                      satellite_initial_displacement_,
+                                      satellite_initial_velocity_));
+    handles.push_back(plugin_->vessel_handle(guid));
+  }
+  plugin_->AdvanceTime(initial_time_ + 1 * Second, planetarium_rotation);
+  plugin_->KeepVessels(handles);
+  plugin_->AdvanceTime(initial_time_ + 2 * Second, planetarium_rotation);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(handles[i], plugin_->vessel_handle("V" + std::to_string(i)));
+  }
+  // Removing a vessel overrides keeping it, and vice versa.
+  plugin_->KeepVessels(handles);
+  plugin_->RemoveVessel("V1");
+  plugin_->RemoveVessel("V2");
+  plugin_->KeepVessels({handles[2]});
+  plugin_->AdvanceTime(initial_time_ + 3 * Second, planetarium_rotation);
+  EXPECT_FALSE(plugin_->InsertOrKeepVessel("V0", SolarSystem::kEarth));
+  EXPECT_TRUE(plugin_->InsertOrKeepVessel("V1", SolarSystem::kEarth));
+  EXPECT_FALSE(plugin_->InsertOrKeepVessel("V2", SolarSystem::kEarth));
+}
+
+// Checks that the state table published by |AdvanceTime| agrees with the
+// queries.
+TEST_F(PluginTest, StateTable) {
+  InsertAllSolarSystemBodies();
+  plugin_->EndInitialization();
+  Plugin::StateTable const& table = plugin_->state_table();
+  EXPECT_EQ(0, table.version);
+  Angle const planetarium_rotation = 42 * Radian;
+  for (GUID const guid : {"V0", "V1"}) {
+    EXPECT_TRUE(plugin_->InsertOrKeepVessel(guid, SolarSystem::kEarth));
+    plugin_->SetVesselStateOffset(guid,
+                                  RelativeDegreesOfFreedom<AliceSun>(
+                                      satellite_initial_displacement_,
+                                      satellite_initial_velocity_));
+  }
+  Instant const t = initial_time_ + 1 * Second;
+  plugin_->AdvanceTime(t, planetarium_rotation);
+  EXPECT_EQ(1, table.version);
+  EXPECT_EQ((t - Instant()) / Second, table.time);
+
+  auto const from_parent = [](Plugin::PublishedState const& state) {
+    return RelativeDegreesOfFreedom<AliceSun>(
+        Displacement<AliceSun>({state.from_parent[0] * Metre,
+                                state.from_parent[1] * Metre,
+                                state.from_parent[2] * Metre}),
+        Velocity<AliceSun>({state.from_parent[3] * Metre / Second,
+                            state.from_parent[4] * Metre / Second,
+                            state.from_parent[5] * Metre / Second}));
+  };
+  Position<World> const parent_world_position =
+      World::origin + Displacement<World>({1 * Metre, 2 * Metre, 3 * Metre});
+  Velocity<World> const parent_world_velocity(
+      {4 * Metre / Second, 5 * Metre / Second, 6 * Metre / Second});
+  Time const parent_rotation_period = 1 * Day;
+  Bivector<double, World> const axis({table.world_rotation_axis[0],
+                                      table.world_rotation_axis[1],
+                                      table.world_rotation_axis[2]});
+  for (GUID const guid : {"V0", "V1"}) {
+    VesselHandle const handle = plugin_->vessel_handle(guid);
+    ASSERT_LT(handle & 0xFFFFFFFF, table.number_of_vessels);
+    Plugin::PublishedState const& state = table.vessels[handle & 0xFFFFFFFF];
+    EXPECT_EQ(handle, state.handle);
+    EXPECT_EQ(plugin_->VesselFromParent(guid), from_parent(state));
+    Displacement<World> const world_displacement(
+        {state.world_displacement[0] * Metre,
+         state.world_displacement[1] * Metre,
+         state.world_displacement[2] * Metre});
+    Velocity<World> const world_velocity(
+        {state.world_velocity[0] * Metre / Second,
+         state.world_velocity[1] * Metre / Second,
+         state.world_velocity[2] * Metre / Second});
+    EXPECT_THAT(parent_world_position + world_displacement - World::origin,
+                AlmostEquals(plugin_->VesselWorldPosition(
+                                 guid, parent_world_position) - World::origin,
+                             0, 1));
+    EXPECT_THAT(parent_world_velocity + world_velocity +
+                    2 * π / parent_rotation_period *
+                        (axis * world_displacement),
+                AlmostEquals(plugin_->VesselWorldVelocity(
+                                 guid,
+                                 parent_world_velocity,
+                                 parent_rotation_period), 0, 4));
+  }
+
+  ASSERT_EQ(bodies_.size(), table.number_of_celestials);
+  for (Index index = 0; index < table.number_of_celestials; ++index) {
+    Plugin::PublishedState const& state = table.celestials[index];
+    EXPECT_EQ(index, state.handle);
+    if (index == SolarSystem::kSun) {
+      EXPECT_EQ(RelativeDegreesOfFreedom<AliceSun>(
+                    Displacement<AliceSun>(), Velocity<AliceSun>()),
+                from_parent(state));
+    } else {
+      EXPECT_EQ(plugin_->CelestialFromParent(index), from_parent(state));
+    }
+  }
+
+  // The entry of a vessel that was not kept is cleared.
+  VesselHandle const handle = plugin_->vessel_handle("V1");
+  EXPECT_FALSE(plugin_->InsertOrKeepVessel("V0", SolarSystem::kEarth));
+  plugin_->AdvanceTime(t + 1 * Second, planetarium_rotation);
+  EXPECT_EQ(2, table.version);
+  EXPECT_EQ(-1, table.vessels[handle & 0xFFFFFFFF].handle);
+  EXPECT_EQ(plugin_->vessel_handle("V0"),
+            table.vessels[plugin_->vessel_handle("V0") & 0xFFFFFFFF].handle);
 }
 
 // Checks that the plugin correctly uses its 10-second-step history even when
@@ -457,24 +1021,28 @@ TEST_F(PluginTest, AdvanceTimeWithCelestialsOnly) {
          t += δt) {
       // Called to compute the prolongations.
       EXPECT_CALL(*n_body_system_,
-                  Integrate(Ref(plugin_->prolongation_integrator()), t,
-                            plugin_->Δt(), 0, true, SizeIs(bodies_.size())))
+                  IntegrateAdaptively(
+                      Ref(plugin_->adaptive_prolongation_integrator()),
+                      t, plugin_->Δt(), _, _,
+                      SizeIs(bodies_.size())))
           .RetiresOnSaturation();
       plugin_->AdvanceTime(t, planetarium_rotation);
     }
     // Called to advance the synchronized histories.
     EXPECT_CALL(*n_body_system_,
-                Integrate(Ref(plugin_->history_integrator()),
-                          HistoryTime(step + 1) + δt,
-                          plugin_->Δt(), 0, false,
-                          SizeIs(bodies_.size())))
-        .WillOnce(AppendTimeToTrajectories<5>(HistoryTime(step + 1)))
+                IntegratePlan(Ref(plugin_->history_integrator()),
+                              HistoryTime(step + 1) + δt,
+                              plugin_->Δt(), 0, false,
+                              HasPlannedTrajectories(SizeIs(bodies_.size())),
+                              _))
+        .WillOnce(AppendTimeToPlannedTrajectories<5>(HistoryTime(step + 1)))
         .RetiresOnSaturation();
     // Called to compute the prolongations.
     EXPECT_CALL(*n_body_system_,
-                Integrate(Ref(plugin_->prolongation_integrator()),
-                          HistoryTime(step + 1) + δt, plugin_->Δt(), 0, true,
-                          SizeIs(bodies_.size())))
+                IntegrateAdaptively(
+                    Ref(plugin_->adaptive_prolongation_integrator()),
+                    HistoryTime(step + 1) + δt, plugin_->Δt(), _, _,
+                    SizeIs(bodies_.size())))
         .RetiresOnSaturation();
     plugin_->AdvanceTime(HistoryTime(step + 1) + δt, planetarium_rotation);
   }
@@ -538,11 +1106,12 @@ TEST_F(PluginTest, AdvanceTimeWithVessels) {
       // Called to compute the prolongations and advance the unsynchronized
       // histories.
       EXPECT_CALL(*n_body_system_,
-                  Integrate(Ref(plugin_->prolongation_integrator()), t,
-                            plugin_->Δt(), 0, true,
-                            SizeIs(bodies_.size() +
-                                       expected_number_of_old_vessels +
-                                       expected_number_of_new_vessels)))
+                  IntegrateAdaptively(
+                      Ref(plugin_->adaptive_prolongation_integrator()),
+                      t, plugin_->Δt(), _, _,
+                      SizeIs(bodies_.size() +
+                                 expected_number_of_old_vessels +
+                                 expected_number_of_new_vessels)))
           .RetiresOnSaturation();
       plugin_->AdvanceTime(t, planetarium_rotation);
       if (AbsoluteError(t - HistoryTime(0), a_while) < ε_δt) {
@@ -565,32 +1134,36 @@ TEST_F(PluginTest, AdvanceTimeWithVessels) {
     }
     // Called to advance the synchronized histories.
     EXPECT_CALL(*n_body_system_,
-                Integrate(Ref(plugin_->history_integrator()),
-                          HistoryTime(step + 1) + δt,
-                          plugin_->Δt(), 0, false,
-                          SizeIs(bodies_.size() +
-                                     expected_number_of_old_vessels)))
-        .WillOnce(AppendTimeToTrajectories<5>(HistoryTime(step + 1)))
+                IntegratePlan(Ref(plugin_->history_integrator()),
+                              HistoryTime(step + 1) + δt,
+                              plugin_->Δt(), 0, false,
+                              HasPlannedTrajectories(
+                                  SizeIs(bodies_.size() +
+                                         expected_number_of_old_vessels)),
+                              _))
+        .WillOnce(AppendTimeToPlannedTrajectories<5>(HistoryTime(step + 1)))
         .RetiresOnSaturation();
     if (expected_number_of_new_vessels > 0) {
-      // Called to synchronize the new histories.
+      // Called to synchronize the new histories in the field of the recorded
+      // steps of the celestials.
       EXPECT_CALL(*n_body_system_,
-                  Integrate(Ref(plugin_->prolongation_integrator()),
-                            HistoryTime(step + 1),
-                            plugin_->Δt(), 0, true,
-                            SizeIs(bodies_.size() +
-                                       expected_number_of_new_vessels)))
-          .WillOnce(AppendTimeToTrajectories<5>(HistoryTime(step + 1)))
+                  IntegrateMasslessBodiesInSteps(
+                      Ref(plugin_->prolongation_integrator()), _,
+                      HistoryTime(step + 1),
+                      plugin_->Δt(), 0, true,
+                      SizeIs(expected_number_of_new_vessels)))
+          .WillOnce(AppendTimeToTrajectories<6>(HistoryTime(step + 1)))
           .RetiresOnSaturation();
     }
     expected_number_of_old_vessels += expected_number_of_new_vessels;
     expected_number_of_new_vessels = 0;
     // Called to compute the prolongations.
     EXPECT_CALL(*n_body_system_,
-                Integrate(Ref(plugin_->prolongation_integrator()),
-                          HistoryTime(step + 1) + δt, plugin_->Δt(), 0, true,
-                          SizeIs(bodies_.size() +
-                                     expected_number_of_old_vessels)))
+                IntegrateAdaptively(
+                    Ref(plugin_->adaptive_prolongation_integrator()),
+                    HistoryTime(step + 1) + δt, plugin_->Δt(), _, _,
+                    SizeIs(bodies_.size() +
+                               expected_number_of_old_vessels)))
         .RetiresOnSaturation();
     plugin_->AdvanceTime(HistoryTime(step + 1) + δt, planetarium_rotation);
     if (step == 2) {
@@ -737,26 +1310,28 @@ TEST_F(PluginTest, PhysicsBubble) {
       if (expect_intrinsic_acceleration) {
         EXPECT_CALL(
             *n_body_system_,
-            Integrate(Ref(plugin_->prolongation_integrator()), t,
-                      plugin_->Δt(), 0, true,
-                      AllOf(
-                          SizeIs(bodies_.size() +
-                                 expected_number_of_clean_old_vessels +
-                                 expected_number_of_new_off_rails_vessels +
-                                 expected_number_of_dirty_old_on_rails_vessels +
-                                 (expect_to_have_physics_bubble ? 1 : 0)),
-                          Contains(HasNonvanishingIntrinsicAccelerationAt(t)))))
+            IntegrateAdaptively(
+                Ref(plugin_->adaptive_prolongation_integrator()),
+                t, plugin_->Δt(), _, _,
+                AllOf(
+                    SizeIs(bodies_.size() +
+                           expected_number_of_clean_old_vessels +
+                           expected_number_of_new_off_rails_vessels +
+                           expected_number_of_dirty_old_on_rails_vessels +
+                           (expect_to_have_physics_bubble ? 1 : 0)),
+                    Contains(HasNonvanishingIntrinsicAccelerationAt(t)))))
             .RetiresOnSaturation();
       } else {
         EXPECT_CALL(
             *n_body_system_,
-            Integrate(Ref(plugin_->prolongation_integrator()), t,
-                      plugin_->Δt(), 0, true,
-                      SizeIs(bodies_.size() +
-                             expected_number_of_clean_old_vessels +
-                             expected_number_of_new_off_rails_vessels +
-                             expected_number_of_dirty_old_on_rails_vessels +
-                             (expect_to_have_physics_bubble ? 1 : 0))))
+            IntegrateAdaptively(
+                Ref(plugin_->adaptive_prolongation_integrator()),
+                t, plugin_->Δt(), _, _,
+                SizeIs(bodies_.size() +
+                       expected_number_of_clean_old_vessels +
+                       expected_number_of_new_off_rails_vessels +
+                       expected_number_of_dirty_old_on_rails_vessels +
+                       (expect_to_have_physics_bubble ? 1 : 0))))
             .RetiresOnSaturation();
       }
       plugin_->AdvanceTime(t, planetarium_rotation);
@@ -791,27 +1366,30 @@ TEST_F(PluginTest, PhysicsBubble) {
     // Called to advance the synchronized histories.
     EXPECT_CALL(
         *n_body_system_,
-        Integrate(Ref(plugin_->history_integrator()),
+        IntegratePlan(Ref(plugin_->history_integrator()),
                       HistoryTime(step + 1) + δt,
                       plugin_->Δt(), 0, false,
-                      SizeIs(bodies_.size() +
-                             expected_number_of_clean_old_vessels)))
-        .WillOnce(AppendTimeToTrajectories<5>(HistoryTime(step + 1)))
+                      HasPlannedTrajectories(
+                          SizeIs(bodies_.size() +
+                                 expected_number_of_clean_old_vessels)),
+                      _))
+        .WillOnce(AppendTimeToPlannedTrajectories<5>(HistoryTime(step + 1)))
         .RetiresOnSaturation();
     if (expected_number_of_new_off_rails_vessels > 0 ||
         expected_number_of_dirty_old_on_rails_vessels > 0 ||
         expect_to_have_physics_bubble) {
-      // Called to synchronize the new histories.
+      // Called to synchronize the new histories in the field of the recorded
+      // steps of the celestials.
       EXPECT_CALL(
           *n_body_system_,
-          Integrate(Ref(plugin_->prolongation_integrator()),
-                        HistoryTime(step + 1),
-                        plugin_->Δt(), 0, true,
-                        SizeIs(bodies_.size() +
-                               expected_number_of_new_off_rails_vessels +
-                               expected_number_of_dirty_old_on_rails_vessels +
-                               (expect_to_have_physics_bubble ? 1 : 0))))
-          .WillOnce(AppendTimeToTrajectories<5>(HistoryTime(step + 1)))
+          IntegrateMasslessBodiesInSteps(
+              Ref(plugin_->prolongation_integrator()), _,
+              HistoryTime(step + 1),
+              plugin_->Δt(), 0, true,
+              SizeIs(expected_number_of_new_off_rails_vessels +
+                     expected_number_of_dirty_old_on_rails_vessels +
+                     (expect_to_have_physics_bubble ? 1 : 0))))
+          .WillOnce(AppendTimeToTrajectories<6>(HistoryTime(step + 1)))
           .RetiresOnSaturation();
     }
     expected_number_of_clean_old_vessels +=
@@ -821,11 +1399,12 @@ TEST_F(PluginTest, PhysicsBubble) {
     expected_number_of_dirty_old_on_rails_vessels = 0;
     // Called to compute the prolongations.
     EXPECT_CALL(*n_body_system_,
-                Integrate(Ref(plugin_->prolongation_integrator()),
-                          HistoryTime(step + 1) + δt, plugin_->Δt(), 0, true,
-                          SizeIs(bodies_.size() +
-                                     expected_number_of_clean_old_vessels +
-                                     (expect_to_have_physics_bubble ? 1 : 0))))
+                IntegrateAdaptively(
+                    Ref(plugin_->adaptive_prolongation_integrator()),
+                    HistoryTime(step + 1) + δt, plugin_->Δt(), _, _,
+                    SizeIs(bodies_.size() +
+                               expected_number_of_clean_old_vessels +
+                               (expect_to_have_physics_bubble ? 1 : 0))))
         .RetiresOnSaturation();
     plugin_->AdvanceTime(HistoryTime(step + 1) + δt, planetarium_rotation);
     if (expect_to_have_physics_bubble) {
@@ -835,6 +1414,121 @@ TEST_F(PluginTest, PhysicsBubble) {
   }
 }
 
+TEST_F(PluginTest, PredictVessels) {
+  GUID const enterprise = "NCC-1701";
+  GUID const enterprise_d = "NCC-1701-D";
+  InsertAllSolarSystemBodies();
+  plugin_->EndInitialization();
+  std::size_t number_of_new_vessels = 0;
+  InsertVessel(enterprise, &number_of_new_vessels);
+  InsertVessel(enterprise_d, &number_of_new_vessels);
+  Instant const t = initial_time_ + 1 * Second;
+  KeepVessel(enterprise);
+  KeepVessel(enterprise_d);
+  EXPECT_CALL(*n_body_system_,
+              IntegrateAdaptively(
+                  Ref(plugin_->adaptive_prolongation_integrator()),
+                  t, plugin_->Δt(), _, _,
+                  SizeIs(bodies_.size() + number_of_new_vessels)))
+      .WillOnce(AppendTimeToTrajectories<5>(t));
+  plugin_->AdvanceTime(t, planetarium_rotation_);
+
+  Instant const tmax = t + 1 * Hour;
+  EXPECT_CALL(*n_body_system_,
+              IntegrateMasslessBodiesRelativeToParents(
+                  Ref(plugin_->prediction_integrator()),
+                  _, SizeIs(2), tmax, 1 * Minute, 1, true, SizeIs(2)))
+      .WillOnce(AppendTimeToTrajectories<7>(tmax));
+  std::vector<not_null<Trajectory<Barycentric>*>> const predictions =
+      plugin_->PredictVessels({enterprise_d, enterprise}, tmax, 1 * Minute);
+  ASSERT_THAT(predictions, SizeIs(2));
+  for (auto const prediction : predictions) {
+    ASSERT_THAT(prediction->fork_time(), Ne(nullptr));
+    EXPECT_THAT(*prediction->fork_time(), Eq(t));
+    EXPECT_THAT(prediction->last().time(), Eq(tmax));
+  }
+  EXPECT_THAT(predictions[0]->body<Body>(),
+              Ne(predictions[1]->body<Body>()));
+
+  Trajectory<Barycentric>* prediction = predictions[0];
+  plugin_->DeletePrediction(enterprise_d, &prediction);
+  EXPECT_THAT(prediction, Eq(nullptr));
+  prediction = predictions[1];
+  plugin_->DeletePrediction(enterprise, &prediction);
+  EXPECT_THAT(prediction, Eq(nullptr));
+}
+
+// The active vessel is predicted every frame, the background vessels one per
+// frame in turn.
+TEST_F(PluginTest, UpdatePredictions) {
+  GUID const enterprise = "NCC-1701";
+  GUID const enterprise_d = "NCC-1701-D";
+  GUID const enterprise_e = "NCC-1701-E";
+  InsertAllSolarSystemBodies();
+  plugin_->EndInitialization();
+  std::size_t number_of_new_vessels = 0;
+  InsertVessel(enterprise, &number_of_new_vessels);
+  InsertVessel(enterprise_d, &number_of_new_vessels);
+  InsertVessel(enterprise_e, &number_of_new_vessels);
+  Instant const t = initial_time_ + 1 * Second;
+  KeepVessel(enterprise);
+  KeepVessel(enterprise_d);
+  KeepVessel(enterprise_e);
+  EXPECT_CALL(*n_body_system_,
+              IntegrateAdaptively(
+                  Ref(plugin_->adaptive_prolongation_integrator()),
+                  t, plugin_->Δt(), _, _,
+                  SizeIs(bodies_.size() + number_of_new_vessels)))
+      .WillOnce(AppendTimeToTrajectories<5>(t));
+  plugin_->AdvanceTime(t, planetarium_rotation_);
+
+  plugin_->SetPredictionPriority(enterprise_e, PredictionPriority::kActive);
+  Instant const tmax = t + 1 * Hour;
+  EXPECT_CALL(*n_body_system_,
+              IntegrateMasslessBodiesRelativeToParents(
+                  Ref(plugin_->prediction_integrator()),
+                  _, SizeIs(2), tmax, 1 * Minute, 1, true, SizeIs(2)))
+      .Times(2)
+      .WillRepeatedly(AppendTimeToTrajectories<7>(tmax));
+  plugin_->UpdatePredictions(1 * Hour, 1 * Minute);
+  ASSERT_THAT(plugin_->ScheduledPrediction(enterprise_e), Ne(nullptr));
+  EXPECT_THAT(plugin_->ScheduledPrediction(enterprise_e)->last().time(),
+              Eq(tmax));
+  EXPECT_THAT(plugin_->ScheduledPrediction(enterprise), Ne(nullptr));
+  EXPECT_THAT(plugin_->ScheduledPrediction(enterprise_d), Eq(nullptr));
+
+  plugin_->UpdatePredictions(1 * Hour, 1 * Minute);
+  ASSERT_THAT(plugin_->ScheduledPrediction(enterprise_d), Ne(nullptr));
+  EXPECT_THAT(plugin_->ScheduledPrediction(enterprise_d)->fork_time(),
+              Eq(nullptr));
+  EXPECT_THAT(plugin_->ScheduledPrediction(enterprise_d)->first().time(),
+              Eq(t));
+  EXPECT_THAT(plugin_->ScheduledPrediction(enterprise), Ne(nullptr));
+}
+
+// The plugin returns the same transforms whenever a frame is selected again.
+TEST_F(PluginTest, OwnedTransforms) {
+  InsertAllSolarSystemBodies();
+  plugin_->EndInitialization();
+  not_null<Transforms<Barycentric, Rendering, Barycentric>*> const
+      geocentric = plugin_->BodyCentredNonRotatingTransforms(
+                       SolarSystem::kEarth);
+  not_null<Transforms<Barycentric, Rendering, Barycentric>*> const
+      earth_moon = plugin_->BarycentricRotatingTransforms(SolarSystem::kEarth,
+                                                          SolarSystem::kMoon);
+  EXPECT_THAT(geocentric, Ne(earth_moon));
+  EXPECT_THAT(plugin_->BodyCentredNonRotatingTransforms(SolarSystem::kMoon),
+              Ne(geocentric));
+  EXPECT_THAT(plugin_->BarycentricRotatingTransforms(SolarSystem::kMoon,
+                                                     SolarSystem::kEarth),
+              Ne(earth_moon));
+  EXPECT_THAT(plugin_->BodyCentredNonRotatingTransforms(SolarSystem::kEarth),
+              Eq(geocentric));
+  EXPECT_THAT(plugin_->BarycentricRotatingTransforms(SolarSystem::kEarth,
+                                                     SolarSystem::kMoon),
+              Eq(earth_moon));
+}
+
 TEST_F(PluginTest, UpdateCelestialHierarchy) {
   InsertAllSolarSystemBodies();
   plugin_->EndInitialization();
@@ -928,7 +1622,9 @@ TEST_F(PluginTest, BodyCentredNonrotatingRenderingIntegration) {
     RenderedTrajectory<World> const rendered_trajectory =
         plugin.RenderedVesselTrajectory(satellite,
                                         geocentric.get(),
-                                        sun_world_position);
+                                        sun_world_position,
+                                        0 * Metre,
+                                        initial_time_);
     Position<World> const earth_world_position =
         sun_world_position + alice_sun_to_world(
             plugin.CelestialFromParent(SolarSystem::kEarth).displacement());
@@ -948,7 +1644,98 @@ TEST_F(PluginTest, BodyCentredNonrotatingRenderingIntegration) {
                   Eq(rendered_trajectory[i + 1].begin));
     }
     EXPECT_THAT(Abs(apogee - perigee), Lt(1.1 * Metre));
+
+    // The simplified trajectory has fewer segments, its vertices are vertices
+    // of the full one, and the full one stays within the tolerance of it.
+    Length const tolerance = 10 * Kilo(Metre);
+    RenderedTrajectory<World> const simplified_trajectory =
+        plugin.RenderedVesselTrajectory(satellite,
+                                        geocentric.get(),
+                                        sun_world_position,
+                                        tolerance,
+                                        initial_time_);
+    ASSERT_FALSE(simplified_trajectory.empty());
+    EXPECT_THAT(simplified_trajectory.front().begin,
+                Eq(rendered_trajectory.front().begin));
+    EXPECT_THAT(simplified_trajectory.back().end,
+                Eq(rendered_trajectory.back().end));
+    auto const distance_to_segment = [](Position<World> const& point,
+                                        LineSegment<World> const& segment) {
+      Displacement<World> const d = segment.end - segment.begin;
+      Displacement<World> const from_begin = point - segment.begin;
+      double const t = InnerProduct(from_begin, d) / InnerProduct(d, d);
+      return (from_begin - std::min(1.0, std::max(0.0, t)) * d).Norm();
+    };
+    std::size_t j = 0;
+    for (auto const& segment : rendered_trajectory) {
+      ASSERT_LT(j, simplified_trajectory.size());
+      EXPECT_THAT(distance_to_segment(segment.end, simplified_trajectory[j]),
+                  Lt(tolerance));
+      if (segment.end == simplified_trajectory[j].end) {
+        ++j;
+      }
+    }
+    EXPECT_EQ(simplified_trajectory.size(), j);
+    if (rendered_trajectory.size() > 10) {
+      EXPECT_THAT(simplified_trajectory.size(),
+                  Lt(rendered_trajectory.size()));
+    }
+  }
+}
+
+// A vessel whose trajectories are observed by transforms owned by the plugin
+// is removed: the transforms must stop observing them before the vessel is
+// handed over to the reclaimer.
+TEST_F(PluginTest, RemoveRenderedVessel) {
+  GUID const enterprise = "NCC-1701";
+  GUID const satellite = "satellite";
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  for (GUID const& guid : {enterprise, satellite}) {
+    plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth);
+    plugin.SetVesselStateOffset(guid,
+                                RelativeDegreesOfFreedom<AliceSun>(
+                                    satellite_initial_displacement_,
+                                    satellite_initial_velocity_));
+  }
+  not_null<Transforms<Barycentric, Rendering, Barycentric>*> const
+      geocentric = plugin.BodyCentredNonRotatingTransforms(SolarSystem::kEarth);
+  Instant t = initial_time_;
+  for (int i = 0; i < 10; ++i) {
+    t += 10 * Minute;
+    plugin.AdvanceTime(t, 0 * Radian);
+    for (GUID const& guid : {enterprise, satellite}) {
+      plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth);
+      plugin.RenderedVesselTrajectory(guid,
+                                      geocentric,
+                                      World::origin,
+                                      0 * Metre,
+                                      initial_time_);
+    }
+  }
+  std::size_t const size_with_enterprise = geocentric->first_cache_size();
+
+  // The enterprise is no longer kept, and is removed by the second
+  // |AdvanceTime|.  Its points must have been forgotten by the transforms by
+  // the time it returns.
+  for (int i = 0; i < 2; ++i) {
+    t += 10 * Minute;
+    plugin.AdvanceTime(t, 0 * Radian);
+    plugin.InsertOrKeepVessel(satellite, SolarSystem::kEarth);
   }
+  EXPECT_THAT(geocentric->first_cache_size(), Lt(size_with_enterprise));
+
+  // The transforms are still usable for the remaining vessel, and are
+  // destroyed with the plugin without touching the reclaimed trajectories.
+  EXPECT_FALSE(plugin.RenderedVesselTrajectory(satellite,
+                                               geocentric,
+                                               World::origin,
+                                               0 * Metre,
+                                               initial_time_).empty());
 }
 
 TEST_F(PluginTest, BarycentricRotatingRenderingIntegration) {
@@ -1036,7 +1823,9 @@ TEST_F(PluginTest, BarycentricRotatingRenderingIntegration) {
   RenderedTrajectory<World> const rendered_trajectory =
       plugin.RenderedVesselTrajectory(satellite,
                                       earth_moon_barycentric.get(),
-                                      sun_world_position);
+                                      sun_world_position,
+                                      0 * Metre,
+                                      initial_time_);
   Position<World> const earth_world_position =
       sun_world_position + alice_sun_to_world(
           plugin.CelestialFromParent(SolarSystem::kEarth).displacement());
@@ -1072,6 +1861,1225 @@ TEST_F(PluginTest, BarycentricRotatingRenderingIntegration) {
                  rendered_trajectory[i + 1].end).Norm()) / 1.5)) << i;
   }
 #endif
+
+  // Rendering several vessels at once gives the same results.
+  std::vector<RenderedTrajectory<World>> const rendered_trajectories =
+      plugin.RenderedVesselTrajectories({satellite, satellite},
+                                        earth_moon_barycentric.get(),
+                                        sun_world_position,
+                                        0 * Metre,
+                                        initial_time_);
+  ASSERT_THAT(rendered_trajectories.size(), Eq(2));
+  for (auto const& trajectory : rendered_trajectories) {
+    ASSERT_THAT(trajectory.size(), Eq(rendered_trajectory.size()));
+    for (std::size_t i = 0; i < trajectory.size(); ++i) {
+      EXPECT_THAT(trajectory[i].begin, Eq(rendered_trajectory[i].begin));
+      EXPECT_THAT(trajectory[i].end, Eq(rendered_trajectory[i].end));
+    }
+  }
+}
+
+// Checks that the evolution of the vessels doesn't depend on the number of
+// threads used to compute their accelerations, nor on the other parameters of
+// the kernels.
+TEST_F(PluginTest, KernelConfiguration) {
+  int const kNumberOfVessels = 20;
+  Angle const planetarium_rotation = 42 * Radian;
+  std::vector<KernelConfiguration> configurations(3);
+  configurations[1].number_of_threads = 4;
+  configurations[2].number_of_threads = 4;
+  configurations[2].massless_chunks_per_thread = 4;
+  configurations[2].maximum_vector_instruction_set =
+      VectorInstructionSet::kNone;
+  std::vector<RelativeDegreesOfFreedom<AliceSun>> serial;
+  for (KernelConfiguration const& configuration : configurations) {
+    Plugin plugin(initial_time_,
+                  SolarSystem::kSun,
+                  sun_gravitational_parameter_,
+                  planetarium_rotation_);
+    plugin.SetKernelConfiguration(configuration);
+    InsertAllSolarSystemBodies(&plugin);
+    plugin.EndInitialization();
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      GUID const guid = std::to_string(i);
+      EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+      plugin.SetVesselStateOffset(guid,
+                                  RelativeDegreesOfFreedom<AliceSun>(
+                                      (1 + 0.01 * i) *
+                                          satellite_initial_displacement_,
+                                      satellite_initial_velocity_));
+    }
+    for (Instant t = initial_time_ + 7 * Second;
+         t < initial_time_ + 1 * Minute;
+         t += 7 * Second) {
+      for (int i = 0; i < kNumberOfVessels; ++i) {
+        EXPECT_FALSE(plugin.InsertOrKeepVessel(std::to_string(i),
+                                               SolarSystem::kEarth));
+      }
+      plugin.AdvanceTime(t, planetarium_rotation);
+    }
+    std::vector<RelativeDegreesOfFreedom<AliceSun>> from_parent;
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      from_parent.push_back(plugin.VesselFromParent(std::to_string(i)));
+    }
+    if (serial.empty()) {
+      serial = from_parent;
+    } else {
+      for (int i = 0; i < kNumberOfVessels; ++i) {
+        EXPECT_THAT(from_parent[i].displacement(),
+                    Eq(serial[i].displacement())) << i;
+        EXPECT_THAT(from_parent[i].velocity(), Eq(serial[i].velocity())) << i;
+      }
+    }
+  }
+  base::SetMaximumVectorInstructionSet(VectorInstructionSet::kAVX512F);
+}
+
+// Checks that integrating the histories on a worker thread, with or without
+// look-ahead, yields the same evolution as the synchronous integration, up to
+// the tolerances of the prolongations, which start from different points.
+TEST_F(PluginTest, PipelinedHistories) {
+  int const kNumberOfVessels = 20;
+  Angle const planetarium_rotation = 42 * Radian;
+  std::vector<RelativeDegreesOfFreedom<AliceSun>> synchronous;
+  for (Time const look_ahead : {-1 * Second, 0 * Second, 1 * Minute}) {
+    // A negative |look_ahead| stands for the synchronous integration.
+    bool const pipelined = look_ahead >= 0 * Second;
+    Plugin plugin(initial_time_,
+                  SolarSystem::kSun,
+                  sun_gravitational_parameter_,
+                  planetarium_rotation_);
+    plugin.SetPipelinedHistories(pipelined);
+    if (pipelined) {
+      plugin.SetHistoryLookAhead(look_ahead);
+    }
+    InsertAllSolarSystemBodies(&plugin);
+    plugin.EndInitialization();
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      GUID const guid = std::to_string(i);
+      EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+      plugin.SetVesselStateOffset(guid,
+                                  RelativeDegreesOfFreedom<AliceSun>(
+                                      (1 + 0.01 * i) *
+                                          satellite_initial_displacement_,
+                                      satellite_initial_velocity_));
+    }
+    for (Instant t = initial_time_ + 7 * Second;
+         t < initial_time_ + 10 * Minute;
+         t += 7 * Second) {
+      for (int i = 0; i < kNumberOfVessels; ++i) {
+        EXPECT_FALSE(plugin.InsertOrKeepVessel(std::to_string(i),
+                                               SolarSystem::kEarth));
+      }
+      plugin.AdvanceTime(t, planetarium_rotation);
+    }
+    // Wait for the last integration.
+    plugin.SetPipelinedHistories(false);
+    std::vector<RelativeDegreesOfFreedom<AliceSun>> from_parent;
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      from_parent.push_back(plugin.VesselFromParent(std::to_string(i)));
+    }
+    if (!pipelined) {
+      synchronous = from_parent;
+    } else {
+      for (int i = 0; i < kNumberOfVessels; ++i) {
+        EXPECT_THAT(AbsoluteError(from_parent[i].displacement(),
+                                  synchronous[i].displacement()),
+                    Lt(1 * Metre)) << look_ahead << " " << i;
+        EXPECT_THAT(AbsoluteError(from_parent[i].velocity(),
+                                  synchronous[i].velocity()),
+                    Lt(1 * Milli(Metre) / Second)) << look_ahead << " " << i;
+      }
+    }
+  }
+}
+
+// Checks that limiting the steps of the histories in each call to
+// |AdvanceTime| bounds the work done by that call, and yields the same
+// evolution as the unlimited integration, up to the tolerances of the
+// prolongations, which are extended over the lag of the histories.
+TEST_F(PluginTest, HistoryStepBudget) {
+  int const kNumberOfVessels = 20;
+  int const kBudget = 2;
+  Angle const planetarium_rotation = 42 * Radian;
+  std::vector<RelativeDegreesOfFreedom<AliceSun>> unlimited;
+  for (int const budget : {0, kBudget}) {
+    Plugin plugin(initial_time_,
+                  SolarSystem::kSun,
+                  sun_gravitational_parameter_,
+                  planetarium_rotation_);
+    plugin.SetHistoryStepBudget(budget);
+    InsertAllSolarSystemBodies(&plugin);
+    plugin.EndInitialization();
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      GUID const guid = std::to_string(i);
+      EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+      plugin.SetVesselStateOffset(guid,
+                                  RelativeDegreesOfFreedom<AliceSun>(
+                                      (1 + 0.01 * i) *
+                                          satellite_initial_displacement_,
+                                      satellite_initial_velocity_));
+    }
+    // The first call synchronizes the new vessels.
+    plugin.AdvanceTime(initial_time_ + 1 * Minute, planetarium_rotation);
+    plugin.SetProfiling(true);
+    for (Instant t = initial_time_ + 2 * Minute;
+         t < initial_time_ + 10 * Minute;
+         t += 1 * Minute) {
+      for (int i = 0; i < kNumberOfVessels; ++i) {
+        EXPECT_FALSE(plugin.InsertOrKeepVessel(std::to_string(i),
+                                               SolarSystem::kEarth));
+      }
+      std::int64_t const history_steps = plugin.profile().history_steps;
+      plugin.AdvanceTime(t, planetarium_rotation);
+      if (budget > 0) {
+        EXPECT_EQ(budget, plugin.profile().history_steps - history_steps);
+      } else {
+        EXPECT_LE(5, plugin.profile().history_steps - history_steps);
+      }
+    }
+    std::vector<RelativeDegreesOfFreedom<AliceSun>> from_parent;
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      from_parent.push_back(plugin.VesselFromParent(std::to_string(i)));
+    }
+    if (budget == 0) {
+      unlimited = from_parent;
+    } else {
+      for (int i = 0; i < kNumberOfVessels; ++i) {
+        EXPECT_THAT(AbsoluteError(from_parent[i].displacement(),
+                                  unlimited[i].displacement()),
+                    Lt(1 * Metre)) << i;
+        EXPECT_THAT(AbsoluteError(from_parent[i].velocity(),
+                                  unlimited[i].velocity()),
+                    Lt(1 * Milli(Metre) / Second)) << i;
+      }
+    }
+  }
+}
+
+// Checks that |FastForward| agrees with |AdvanceTime|, that it synchronizes the
+// new vessels, and that it reports its progress after each chunk.
+TEST_F(PluginTest, FastForward) {
+  int const kNumberOfVessels = 5;
+  Angle const planetarium_rotation = 42 * Radian;
+  Instant const t = initial_time_ + 6 * Hour;
+  std::vector<RelativeDegreesOfFreedom<AliceSun>> advanced;
+  for (bool const fast_forward : {false, true}) {
+    Plugin plugin(initial_time_,
+                  SolarSystem::kSun,
+                  sun_gravitational_parameter_,
+                  planetarium_rotation_);
+    InsertAllSolarSystemBodies(&plugin);
+    plugin.EndInitialization();
+    auto const insert_or_keep_vessels = [this, &plugin](int const count) {
+      for (int i = 0; i < count; ++i) {
+        GUID const guid = std::to_string(i);
+        if (plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth)) {
+          plugin.SetVesselStateOffset(guid,
+                                      RelativeDegreesOfFreedom<AliceSun>(
+                                          (1 + 0.01 * i) *
+                                              satellite_initial_displacement_,
+                                          satellite_initial_velocity_));
+        }
+      }
+    };
+    insert_or_keep_vessels(kNumberOfVessels - 1);
+    plugin.AdvanceTime(initial_time_ + 1 * Minute, planetarium_rotation);
+    // The last vessel is not synchronized yet.
+    insert_or_keep_vessels(kNumberOfVessels);
+    if (fast_forward) {
+      std::vector<Instant> history_times;
+      plugin.FastForward(t,
+                         planetarium_rotation,
+                         [&history_times](Instant const& history_time) {
+                           history_times.push_back(history_time);
+                         });
+      ASSERT_THAT(history_times, SizeIs(3));
+      EXPECT_THAT(history_times[0], Gt(initial_time_ + 1 * Minute));
+      EXPECT_THAT(history_times[1], Gt(history_times[0]));
+      EXPECT_THAT(history_times[2], AllOf(Gt(history_times[1]), Le(t)));
+    } else {
+      plugin.AdvanceTime(t, planetarium_rotation);
+    }
+    EXPECT_EQ(t, plugin.current_time());
+    std::vector<RelativeDegreesOfFreedom<AliceSun>> from_parent;
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      from_parent.push_back(plugin.VesselFromParent(std::to_string(i)));
+    }
+    if (!fast_forward) {
+      advanced = from_parent;
+    } else {
+      for (int i = 0; i < kNumberOfVessels; ++i) {
+        EXPECT_THAT(AbsoluteError(from_parent[i].displacement(),
+                                  advanced[i].displacement()),
+                    Lt(1 * Metre)) << i;
+        EXPECT_THAT(AbsoluteError(from_parent[i].velocity(),
+                                  advanced[i].velocity()),
+                    Lt(1 * Milli(Metre) / Second)) << i;
+      }
+    }
+  }
+}
+
+// Checks that the celestials evaluated from an ephemeris file agree with their
+// integration, and that a file that doesn't match the plugin is rejected.
+TEST_F(PluginTest, EphemerisFile) {
+  char const filename[] = "plugin_test_ephemeris.bin";
+  int const kNumberOfVessels = 3;
+  Angle const planetarium_rotation = 42 * Radian;
+  Instant const t = initial_time_ + 3 * Hour;
+  std::vector<RelativeDegreesOfFreedom<AliceSun>> integrated;
+  for (bool const use_file : {false, true}) {
+    Plugin plugin(initial_time_,
+                  SolarSystem::kSun,
+                  sun_gravitational_parameter_,
+                  planetarium_rotation_);
+    InsertAllSolarSystemBodies(&plugin);
+    plugin.EndInitialization();
+    if (use_file) {
+      plugin.WriteEphemerisFile(filename,
+                                t + 1 * Hour,
+                                8,    // steps_per_series
+                                12);  // degree
+      EXPECT_TRUE(plugin.LoadEphemerisFile(filename));
+    }
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      GUID const guid = std::to_string(i);
+      EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+      plugin.SetVesselStateOffset(guid,
+                                  RelativeDegreesOfFreedom<AliceSun>(
+                                      (1 + 0.01 * i) *
+                                          satellite_initial_displacement_,
+                                      satellite_initial_velocity_));
+    }
+    for (Instant time = initial_time_ + 1 * Minute;
+         time <= t;
+         time += 17 * Minute) {
+      for (int i = 0; i < kNumberOfVessels; ++i) {
+        plugin.InsertOrKeepVessel(std::to_string(i), SolarSystem::kEarth);
+      }
+      plugin.AdvanceTime(time, planetarium_rotation);
+    }
+    std::vector<RelativeDegreesOfFreedom<AliceSun>> from_parent;
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      from_parent.push_back(plugin.VesselFromParent(std::to_string(i)));
+    }
+    from_parent.push_back(plugin.CelestialFromParent(SolarSystem::kMoon));
+    from_parent.push_back(plugin.CelestialFromParent(SolarSystem::kEarth));
+    if (!use_file) {
+      integrated = from_parent;
+    } else {
+      for (std::size_t i = 0; i < from_parent.size(); ++i) {
+        EXPECT_THAT(AbsoluteError(from_parent[i].displacement(),
+                                  integrated[i].displacement()),
+                    Lt(1 * Metre)) << i;
+        EXPECT_THAT(AbsoluteError(from_parent[i].velocity(),
+                                  integrated[i].velocity()),
+                    Lt(1 * Milli(Metre) / Second)) << i;
+      }
+    }
+  }
+  // The states of the celestials an hour later don't match the file.
+  Plugin plugin(initial_time_ + 1 * Hour,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  EXPECT_FALSE(plugin.LoadEphemerisFile(filename));
+  std::remove(filename);
+}
+
+// Checks that the points of the histories of the celestials covered by the
+// ephemeris file are forgotten, that their past is evaluated from the file,
+// and that the file is reloaded by the deserialization.
+TEST_F(PluginTest, EphemerisFileHistories) {
+  char const filename[] = "plugin_test_ephemeris_histories.bin";
+  Angle const planetarium_rotation = 42 * Radian;
+  Instant const t = initial_time_ + 3 * Hour;
+  auto plugin = make_not_null_unique<Plugin>(initial_time_,
+                                             SolarSystem::kSun,
+                                             sun_gravitational_parameter_,
+                                             planetarium_rotation_);
+  InsertAllSolarSystemBodies(plugin.get());
+  plugin->EndInitialization();
+  plugin->WriteEphemerisFile(filename,
+                             t + 1 * Hour,
+                             8,    // steps_per_series
+                             12);  // degree
+  EphemerisFile<Barycentric> const file(filename);
+  std::size_t earth_index = 0;
+  while (file.identifier(earth_index) != SolarSystem::kEarth) {
+    ++earth_index;
+  }
+  EXPECT_TRUE(plugin->LoadEphemerisFile(filename));
+  for (Instant time = initial_time_ + 1 * Minute;
+       time <= t;
+       time += 17 * Minute) {
+    plugin->AdvanceTime(time, planetarium_rotation);
+  }
+
+  auto const check_earth_history = [&file, earth_index, this](
+      Plugin const& plugin) {
+    Trajectory<Barycentric> const& earth_history =
+        TestablePlugin::celestial_history(plugin, SolarSystem::kEarth);
+    EXPECT_EQ(1, earth_history.size());
+    Instant const time = initial_time_ + 1 * Hour;
+    DegreesOfFreedom<Barycentric> const degrees_of_freedom =
+        earth_history.EvaluateDegreesOfFreedom(time);
+    EXPECT_EQ(file.EvaluatePosition(earth_index, time),
+              degrees_of_freedom.position());
+    EXPECT_EQ(file.EvaluateVelocity(earth_index, time),
+              degrees_of_freedom.velocity());
+  };
+  check_earth_history(*plugin);
+
+  serialization::Plugin message;
+  plugin->WriteToMessage(&message);
+  EXPECT_EQ(filename, message.ephemeris_file());
+  plugin = Plugin::ReadFromMessage(message);
+  check_earth_history(*plugin);
+  std::remove(filename);
+}
+
+// Checks that the trajectory file contains the histories of the celestials.
+TEST_F(PluginTest, TrajectoryFile) {
+  char const filename[] = "plugin_test_trajectories.bin";
+  Angle const planetarium_rotation = 42 * Radian;
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  for (Instant time = initial_time_ + 1 * Minute;
+       time <= initial_time_ + 1 * Hour;
+       time += 17 * Minute) {
+    plugin.AdvanceTime(time, planetarium_rotation);
+  }
+  plugin.WriteTrajectoryFile(filename);
+  {
+    TrajectoryFile<Barycentric> const file(filename);
+    std::int64_t row = 0;
+    for (Index index = SolarSystem::kSun; index < bodies_.size(); ++index) {
+      Trajectory<Barycentric> const& history =
+          TestablePlugin::celestial_history(plugin, index);
+      for (auto it = history.first(); !it.at_end(); ++it) {
+        ASSERT_LT(row, file.number_of_rows());
+        EXPECT_EQ(index, file.body(row));
+        EXPECT_EQ(it.time(), file.time(row));
+        EXPECT_EQ(it.degrees_of_freedom(), file.degrees_of_freedom(row));
+        ++row;
+      }
+    }
+    EXPECT_EQ(file.number_of_rows(), row);
+  }
+  std::remove(filename);
+}
+
+// Checks that a plugin restored from a checkpoint is in the state of the
+// checkpoint, and that the checkpoints are shared and bounded.
+TEST_F(PluginTest, Checkpoints) {
+  int const kNumberOfVessels = 3;
+  Angle const planetarium_rotation = 42 * Radian;
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  auto const keep_vessels = [this](not_null<Plugin*> const plugin) {
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      GUID const guid = std::to_string(i);
+      if (plugin->InsertOrKeepVessel(guid, SolarSystem::kEarth)) {
+        plugin->SetVesselStateOffset(guid,
+                                     RelativeDegreesOfFreedom<AliceSun>(
+                                         (1 + 0.01 * i) *
+                                             satellite_initial_displacement_,
+                                         satellite_initial_velocity_));
+      }
+    }
+  };
+  keep_vessels(&plugin);
+  plugin.AdvanceTime(initial_time_ + 1 * Minute, planetarium_rotation);
+  keep_vessels(&plugin);
+  plugin.AdvanceTime(initial_time_ + 2 * Minute, planetarium_rotation);
+  std::int64_t const checkpoint_id = plugin.SaveCheckpoint();
+  std::vector<RelativeDegreesOfFreedom<AliceSun>> saved;
+  for (int i = 0; i < kNumberOfVessels; ++i) {
+    saved.push_back(plugin.VesselFromParent(std::to_string(i)));
+  }
+  keep_vessels(&plugin);
+  plugin.AdvanceTime(initial_time_ + 3 * Minute, planetarium_rotation);
+
+  for (int restoration = 0; restoration < 2; ++restoration) {
+    std::unique_ptr<Plugin> const restored =
+        plugin.RestoreCheckpoint(checkpoint_id);
+    EXPECT_EQ(initial_time_ + 2 * Minute, restored->current_time());
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      EXPECT_EQ(saved[i], restored->VesselFromParent(std::to_string(i)));
+    }
+    keep_vessels(restored.get());
+    restored->AdvanceTime(initial_time_ + 3 * Minute, planetarium_rotation);
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      EXPECT_THAT(AbsoluteError(
+                      plugin.VesselFromParent(std::to_string(i)).
+                          displacement(),
+                      restored->VesselFromParent(std::to_string(i)).
+                          displacement()),
+                  Lt(1 * Metre)) << i;
+    }
+  }
+
+  // The restored plugins share the checkpoints, and only the last ones are
+  // kept.
+  std::unique_ptr<Plugin> const restored =
+      plugin.RestoreCheckpoint(checkpoint_id);
+  std::int64_t last_checkpoint_id = checkpoint_id;
+  for (int i = 0; i < Plugin::kMaxCheckpoints; ++i) {
+    std::int64_t const id = restored->SaveCheckpoint();
+    EXPECT_GT(id, last_checkpoint_id);
+    last_checkpoint_id = id;
+  }
+  EXPECT_FALSE(plugin.HasCheckpoint(checkpoint_id));
+  EXPECT_TRUE(plugin.HasCheckpoint(last_checkpoint_id));
+}
+
+// Checks that the analytical propagation of the histories of vessels in low
+// Earth orbit, where the tides of the Moon and of the Sun are small, agrees
+// with their numerical integration.
+TEST_F(PluginTest, KeplerianHistories) {
+  int const kNumberOfVessels = 20;
+  Angle const planetarium_rotation = 42 * Radian;
+  std::vector<RelativeDegreesOfFreedom<AliceSun>> integrated;
+  for (double const threshold : {0.0, 1E-4}) {
+    Plugin plugin(initial_time_,
+                  SolarSystem::kSun,
+                  sun_gravitational_parameter_,
+                  planetarium_rotation_);
+    plugin.SetKeplerianPerturbationThreshold(threshold);
+    InsertAllSolarSystemBodies(&plugin);
+    plugin.EndInitialization();
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      GUID const guid = std::to_string(i);
+      EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+      plugin.SetVesselStateOffset(guid,
+                                  RelativeDegreesOfFreedom<AliceSun>(
+                                      (1 + 0.01 * i) *
+                                          satellite_initial_displacement_,
+                                      satellite_initial_velocity_));
+    }
+    for (Instant t = initial_time_ + 7 * Second;
+         t < initial_time_ + 10 * Minute;
+         t += 7 * Second) {
+      for (int i = 0; i < kNumberOfVessels; ++i) {
+        EXPECT_FALSE(plugin.InsertOrKeepVessel(std::to_string(i),
+                                               SolarSystem::kEarth));
+      }
+      plugin.AdvanceTime(t, planetarium_rotation);
+    }
+    std::vector<RelativeDegreesOfFreedom<AliceSun>> from_parent;
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      from_parent.push_back(plugin.VesselFromParent(std::to_string(i)));
+    }
+    if (threshold == 0) {
+      integrated = from_parent;
+    } else {
+      for (int i = 0; i < kNumberOfVessels; ++i) {
+        EXPECT_THAT(AbsoluteError(from_parent[i].displacement(),
+                                  integrated[i].displacement()),
+                    Lt(1 * Metre)) << i;
+        EXPECT_THAT(AbsoluteError(from_parent[i].velocity(),
+                                  integrated[i].velocity()),
+                    Lt(1 * Centi(Metre) / Second)) << i;
+      }
+    }
+  }
+}
+
+// Checks that the propagation of the histories of the debris of a breakup in
+// low Earth orbit relative to the references of their clusters agrees with
+// their numerical integration, including for the debris that drift away from
+// their reference.
+TEST_F(PluginTest, ClusterHistories) {
+  int const kNumberOfVessels = 20;
+  Angle const planetarium_rotation = 42 * Radian;
+  Velocity<AliceSun> const drift({0 * Metre / Second,
+                                  0 * Metre / Second,
+                                  0.2 * Metre / Second});
+  std::vector<RelativeDegreesOfFreedom<AliceSun>> integrated;
+  for (Length const tolerance : {0 * Metre, 1 * Kilo(Metre)}) {
+    Plugin plugin(initial_time_,
+                  SolarSystem::kSun,
+                  sun_gravitational_parameter_,
+                  planetarium_rotation_);
+    plugin.SetClusterTolerance(tolerance);
+    InsertAllSolarSystemBodies(&plugin);
+    plugin.EndInitialization();
+    plugin.SetProfiling(true);
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      GUID const guid = std::to_string(i);
+      EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+      plugin.SetVesselStateOffset(guid,
+                                  RelativeDegreesOfFreedom<AliceSun>(
+                                      (1 + 1E-5 * i) *
+                                          satellite_initial_displacement_,
+                                      satellite_initial_velocity_ +
+                                          i * drift));
+    }
+    for (Instant t = initial_time_ + 7 * Second;
+         t < initial_time_ + 10 * Minute;
+         t += 7 * Second) {
+      for (int i = 0; i < kNumberOfVessels; ++i) {
+        EXPECT_FALSE(plugin.InsertOrKeepVessel(std::to_string(i),
+                                               SolarSystem::kEarth));
+      }
+      plugin.AdvanceTime(t, planetarium_rotation);
+    }
+    std::vector<RelativeDegreesOfFreedom<AliceSun>> from_parent;
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      from_parent.push_back(plugin.VesselFromParent(std::to_string(i)));
+    }
+    if (tolerance == 0 * Metre) {
+      EXPECT_EQ(0, plugin.profile().cluster_propagations);
+      integrated = from_parent;
+    } else {
+      EXPECT_LT(0, plugin.profile().cluster_propagations);
+      EXPECT_LT(0, plugin.profile().cluster_promotions);
+      for (int i = 0; i < kNumberOfVessels; ++i) {
+        EXPECT_THAT(AbsoluteError(from_parent[i].displacement(),
+                                  integrated[i].displacement()),
+                    Lt(1 * Metre)) << i;
+        EXPECT_THAT(AbsoluteError(from_parent[i].velocity(),
+                                  integrated[i].velocity()),
+                    Lt(1 * Centi(Metre) / Second)) << i;
+      }
+    }
+  }
+}
+
+// Checks that the histories integrated with the Wisdom-Holman integrator agree
+// with those integrated with the default integrator.
+TEST_F(PluginTest, WisdomHolmanHistories) {
+  int const kNumberOfVessels = 5;
+  Angle const planetarium_rotation = 42 * Radian;
+  // The vessels followed by the Moon.
+  std::vector<RelativeDegreesOfFreedom<AliceSun>> reference;
+  for (bool const wisdom_holman : {false, true}) {
+    Plugin plugin(initial_time_,
+                  SolarSystem::kSun,
+                  sun_gravitational_parameter_,
+                  planetarium_rotation_);
+    InsertAllSolarSystemBodies(&plugin);
+    plugin.EndInitialization();
+    plugin.SetWisdomHolmanHistories(wisdom_holman);
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      GUID const guid = std::to_string(i);
+      EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+      plugin.SetVesselStateOffset(guid,
+                                  RelativeDegreesOfFreedom<AliceSun>(
+                                      (1 + 0.01 * i) *
+                                          satellite_initial_displacement_,
+                                      satellite_initial_velocity_));
+    }
+    for (Instant t = initial_time_ + 7 * Second;
+         t < initial_time_ + 10 * Minute;
+         t += 7 * Second) {
+      for (int i = 0; i < kNumberOfVessels; ++i) {
+        EXPECT_FALSE(plugin.InsertOrKeepVessel(std::to_string(i),
+                                               SolarSystem::kEarth));
+      }
+      plugin.AdvanceTime(t, planetarium_rotation);
+    }
+    std::vector<RelativeDegreesOfFreedom<AliceSun>> from_parent;
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      from_parent.push_back(plugin.VesselFromParent(std::to_string(i)));
+    }
+    from_parent.push_back(plugin.CelestialFromParent(SolarSystem::kMoon));
+    if (!wisdom_holman) {
+      reference = from_parent;
+    } else {
+      for (int i = 0; i <= kNumberOfVessels; ++i) {
+        EXPECT_THAT(AbsoluteError(from_parent[i].displacement(),
+                                  reference[i].displacement()),
+                    Lt(1 * Metre)) << i;
+        EXPECT_THAT(AbsoluteError(from_parent[i].velocity(),
+                                  reference[i].velocity()),
+                    Lt(1 * Centi(Metre) / Second)) << i;
+      }
+    }
+  }
+}
+
+// Checks that the histories integrated by the multistep method in a long
+// integration agree with those of the default integrator.
+TEST_F(PluginTest, MultistepHistories) {
+  int const kNumberOfVessels = 5;
+  Angle const planetarium_rotation = 42 * Radian;
+  // The vessels followed by the Moon.
+  std::vector<RelativeDegreesOfFreedom<AliceSun>> reference;
+  for (bool const multistep : {false, true}) {
+    Plugin plugin(initial_time_,
+                  SolarSystem::kSun,
+                  sun_gravitational_parameter_,
+                  planetarium_rotation_);
+    InsertAllSolarSystemBodies(&plugin);
+    plugin.EndInitialization();
+    plugin.SetMultistepHistories(multistep);
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      GUID const guid = std::to_string(i);
+      EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+      plugin.SetVesselStateOffset(guid,
+                                  RelativeDegreesOfFreedom<AliceSun>(
+                                      (1 + 0.01 * i) *
+                                          satellite_initial_displacement_,
+                                      satellite_initial_velocity_));
+    }
+    // A single integration of many steps, as at high time warp.
+    for (Instant const& t : {initial_time_ + 7 * Second,
+                             initial_time_ + 6 * Hour}) {
+      for (int i = 0; i < kNumberOfVessels; ++i) {
+        EXPECT_FALSE(plugin.InsertOrKeepVessel(std::to_string(i),
+                                               SolarSystem::kEarth));
+      }
+      plugin.AdvanceTime(t, planetarium_rotation);
+    }
+    std::vector<RelativeDegreesOfFreedom<AliceSun>> from_parent;
+    for (int i = 0; i < kNumberOfVessels; ++i) {
+      from_parent.push_back(plugin.VesselFromParent(std::to_string(i)));
+    }
+    from_parent.push_back(plugin.CelestialFromParent(SolarSystem::kMoon));
+    if (!multistep) {
+      reference = from_parent;
+    } else {
+      for (int i = 0; i <= kNumberOfVessels; ++i) {
+        EXPECT_THAT(AbsoluteError(from_parent[i].displacement(),
+                                  reference[i].displacement()),
+                    Lt(1 * Centi(Metre))) << i;
+        EXPECT_THAT(AbsoluteError(from_parent[i].velocity(),
+                                  reference[i].velocity()),
+                    Lt(1 * Centi(Metre) / Second)) << i;
+      }
+    }
+  }
+}
+
+// Checks that the histories are truncated according to the retention policy,
+// first by age and then by number of points, and that the vessels remain
+// usable.
+TEST_F(PluginTest, HistoryRetention) {
+  GUID const guid = "Test Satellite";
+  Angle const planetarium_rotation = 42 * Radian;
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  plugin.SetHistoryRetention(1 * Minute, 0 /*maximum_points*/);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+  plugin.SetVesselStateOffset(guid,
+                              RelativeDegreesOfFreedom<AliceSun>(
+                                  satellite_initial_displacement_,
+                                  satellite_initial_velocity_));
+  Instant t = initial_time_;
+  for (int i = 0; i < 100; ++i) {
+    t += 7 * Second;
+    EXPECT_FALSE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+    plugin.AdvanceTime(t, planetarium_rotation);
+  }
+  Trajectory<Barycentric> const& vessel_history =
+      TestablePlugin::vessel_history(plugin, guid);
+  Trajectory<Barycentric> const& earth_history =
+      TestablePlugin::celestial_history(plugin, SolarSystem::kEarth);
+  EXPECT_LE(t - 1 * Minute, vessel_history.first().time());
+  EXPECT_LE(t - 1 * Minute, earth_history.first().time());
+  EXPECT_LT(3, vessel_history.size());
+
+  plugin.SetHistoryRetention(0 * Second, 3 /*maximum_points*/);
+  t += 7 * Second;
+  EXPECT_FALSE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+  plugin.AdvanceTime(t, planetarium_rotation);
+  EXPECT_EQ(3, vessel_history.size());
+  EXPECT_EQ(3, earth_history.size());
+  EXPECT_EQ(t, plugin.current_time());
+  plugin.VesselFromParent(guid);
+}
+
+// Checks that the queries between the times before and after the last call to
+// |AdvanceTime| agree with the queries at these times.
+TEST_F(PluginTest, SubFrameQueries) {
+  GUID const guid = "Test Satellite";
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+  plugin.SetVesselStateOffset(guid,
+                              RelativeDegreesOfFreedom<AliceSun>(
+                                  satellite_initial_displacement_,
+                                  satellite_initial_velocity_));
+  VesselHandle const handle = plugin.vessel_handle(guid);
+  Instant const t1 = initial_time_ + 1 * Minute;
+  plugin.AdvanceTime(t1, planetarium_rotation_);
+  RelativeDegreesOfFreedom<AliceSun> const from_parent1 =
+      plugin.VesselFromParent(handle);
+  Instant const t2 = t1 + 17 * Second;
+  EXPECT_FALSE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+  plugin.AdvanceTime(t2, planetarium_rotation_);
+  RelativeDegreesOfFreedom<AliceSun> const from_parent2 =
+      plugin.VesselFromParent(handle);
+
+  EXPECT_EQ(from_parent2, plugin.VesselFromParentAt(handle, t2));
+  EXPECT_EQ(plugin.CelestialFromParent(SolarSystem::kMoon),
+            plugin.CelestialFromParentAt(SolarSystem::kMoon, t2));
+  EXPECT_EQ(plugin.VesselWorldPosition(handle, World::origin),
+            plugin.VesselWorldPositionAt(handle, World::origin, t2));
+  // The point at |t1| may have been replaced by the histories.
+  EXPECT_THAT((plugin.VesselFromParentAt(handle, t1).displacement() -
+               from_parent1.displacement()).Norm(),
+              Lt(1 * Metre));
+  Displacement<AliceSun> const chord =
+      from_parent2.displacement() - from_parent1.displacement();
+  EXPECT_THAT((plugin.VesselFromParentAt(handle, t1 + 8.5 * Second).
+                   displacement() -
+               from_parent1.displacement() - 0.5 * chord).Norm(),
+              Lt(0.01 * chord.Norm()));
+}
+
+// Checks that only the checkpoints of the histories of the celestials are
+// retained, that the evaluations at the times of the forgotten points agree
+// with them, that the segments integrated again are cached, and that the
+// checkpoints survive serialization.
+TEST_F(PluginTest, CelestialHistoryCheckpoints) {
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  plugin.SetCelestialHistoryCheckpoints(10 /*steps_between_checkpoints*/,
+                                        2 /*cached_segments*/);
+  Trajectory<Barycentric> const& earth_history =
+      TestablePlugin::celestial_history(plugin, SolarSystem::kEarth);
+  // The points of the history of the Earth as they are appended, two steps
+  // apart.
+  std::vector<std::pair<Instant, DegreesOfFreedom<Barycentric>>> points;
+  Instant t = initial_time_;
+  for (int i = 0; i < 100; ++i) {
+    t += 20 * Second;
+    plugin.AdvanceTime(t, planetarium_rotation_);
+    if (points.empty() || earth_history.last().time() > points.back().first) {
+      points.emplace_back(earth_history.last().time(),
+                          earth_history.last().degrees_of_freedom());
+    }
+  }
+  EXPECT_LT(50, points.size());
+  EXPECT_GT(points.size() / 4, earth_history.size());
+
+  plugin.SetProfiling(true);
+  for (auto const& point : points) {
+    // A few ulps of the position of the Earth.
+    DegreesOfFreedom<Barycentric> const degrees_of_freedom =
+        earth_history.EvaluateDegreesOfFreedom(point.first);
+    EXPECT_THAT((degrees_of_freedom.position() -
+                 point.second.position()).Norm(),
+                Lt(0.1 * Milli(Metre)));
+    EXPECT_THAT((degrees_of_freedom.velocity() -
+                 point.second.velocity()).Norm(),
+                Lt(1 * Milli(Metre) / Second));
+  }
+  std::int64_t const segments = plugin.profile().celestial_history_segments;
+  EXPECT_LT(0, segments);
+  // The segments are integrated again once each, in order.
+  EXPECT_GT(static_cast<std::int64_t>(points.size()), segments);
+  earth_history.EvaluateDegreesOfFreedom(points[1].first);
+  EXPECT_EQ(segments + 1, plugin.profile().celestial_history_segments);
+  earth_history.EvaluateDegreesOfFreedom(points[2].first);
+  EXPECT_EQ(segments + 1, plugin.profile().celestial_history_segments);
+
+  serialization::Plugin message;
+  plugin.WriteToMessage(&message);
+  EXPECT_TRUE(message.has_celestial_history_checkpoints());
+  std::unique_ptr<Plugin> const read_plugin = Plugin::ReadFromMessage(message);
+  Trajectory<Barycentric> const& read_earth_history =
+      TestablePlugin::celestial_history(*read_plugin, SolarSystem::kEarth);
+  EXPECT_EQ(earth_history.size(), read_earth_history.size());
+  EXPECT_EQ(earth_history.EvaluateDegreesOfFreedom(points[1].first),
+            read_earth_history.EvaluateDegreesOfFreedom(points[1].first));
+}
+
+// Checks that a prediction computed with a low-order integrator agrees with
+// one computed with the default integrator, and that the choice of the
+// prediction integrator doesn't affect the state of the vessel.
+TEST_F(PluginTest, PredictionIntegrator) {
+  GUID const guid = "Test Satellite";
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+  plugin.SetVesselStateOffset(guid,
+                              RelativeDegreesOfFreedom<AliceSun>(
+                                  satellite_initial_displacement_,
+                                  satellite_initial_velocity_));
+  Instant const t = initial_time_ + 1 * Minute;
+  plugin.AdvanceTime(t, planetarium_rotation_);
+  RelativeDegreesOfFreedom<AliceSun> const from_parent =
+      plugin.VesselFromParent(guid);
+
+  std::vector<DegreesOfFreedom<Barycentric>> predicted;
+  for (SPRKScheme const scheme :
+           {SPRKScheme::kMcLachlanAtela1992Order5Optimal,
+            SPRKScheme::kMcLachlanAtela1992Order2Optimal}) {
+    plugin.SetPredictionIntegrator(scheme);
+    std::vector<not_null<Trajectory<Barycentric>*>> const predictions =
+        plugin.PredictVessels({guid}, t + 1 * Hour, 10 * Second);
+    ASSERT_THAT(predictions, SizeIs(1));
+    EXPECT_THAT(predictions.front()->last().time(), Eq(t + 1 * Hour));
+    predicted.push_back(predictions.front()->last().degrees_of_freedom());
+    Trajectory<Barycentric>* prediction = predictions.front();
+    plugin.DeletePrediction(guid, &prediction);
+  }
+  EXPECT_THAT((predicted[0].position() - predicted[1].position()).Norm(),
+              AllOf(Gt(0 * Metre), Lt(1 * Kilo(Metre))));
+  EXPECT_THAT(plugin.VesselFromParent(guid).displacement(),
+              Eq(from_parent.displacement()));
+}
+
+// Checks that a prediction over several orbits computed by the Gauss-Jackson
+// integrator with a long step agrees with one computed by the default
+// integrator with a short step, and better than one computed by the default
+// integrator with the same long step.
+TEST_F(PluginTest, GaussJacksonPredictions) {
+  GUID const guid = "Test Satellite";
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+  plugin.SetVesselStateOffset(guid,
+                              RelativeDegreesOfFreedom<AliceSun>(
+                                  satellite_initial_displacement_,
+                                  satellite_initial_velocity_));
+  Instant const t = initial_time_ + 1 * Minute;
+  plugin.AdvanceTime(t, planetarium_rotation_);
+
+  std::vector<DegreesOfFreedom<Barycentric>> predicted;
+  for (auto const& gauss_jackson_and_step :
+           {std::make_pair(false, 1 * Second),
+            std::make_pair(false, 60 * Second),
+            std::make_pair(true, 60 * Second)}) {
+    plugin.SetGaussJacksonPredictions(gauss_jackson_and_step.first);
+    std::vector<not_null<Trajectory<Barycentric>*>> const predictions =
+        plugin.PredictVessels({guid},
+                              t + 6 * Hour,
+                              gauss_jackson_and_step.second);
+    ASSERT_THAT(predictions, SizeIs(1));
+    EXPECT_THAT(predictions.front()->last().time(), Eq(t + 6 * Hour));
+    predicted.push_back(predictions.front()->last().degrees_of_freedom());
+    Trajectory<Barycentric>* prediction = predictions.front();
+    plugin.DeletePrediction(guid, &prediction);
+  }
+  EXPECT_THAT((predicted[0].position() - predicted[1].position()).Norm(),
+              Gt(10 * Centi(Metre)));
+  EXPECT_THAT((predicted[0].position() - predicted[2].position()).Norm(),
+              Lt(1 * Centi(Metre)));
+}
+
+// Checks that the Parareal predictions on several threads have the same points
+// as the serial ones, to within the tolerance of the iterations.
+TEST_F(PluginTest, PararealPredictions) {
+  GUID const guid = "Test Satellite";
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  plugin.SetNumberOfThreads(4);
+  EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+  plugin.SetVesselStateOffset(guid,
+                              RelativeDegreesOfFreedom<AliceSun>(
+                                  satellite_initial_displacement_,
+                                  satellite_initial_velocity_));
+  Instant const t = initial_time_ + 1 * Minute;
+  plugin.AdvanceTime(t, planetarium_rotation_);
+
+  std::vector<std::vector<DegreesOfFreedom<Barycentric>>> predicted;
+  for (bool const parareal : {false, true}) {
+    plugin.SetPararealPredictions(parareal);
+    std::vector<not_null<Trajectory<Barycentric>*>> const predictions =
+        plugin.PredictVessels({guid}, t + 6 * Hour, 10 * Second);
+    ASSERT_THAT(predictions, SizeIs(1));
+    EXPECT_THAT(predictions.front()->last().time(), Eq(t + 6 * Hour));
+    predicted.emplace_back();
+    for (auto it = predictions.front()->first(); !it.at_end(); ++it) {
+      predicted.back().push_back(it.degrees_of_freedom());
+    }
+    Trajectory<Barycentric>* prediction = predictions.front();
+    plugin.DeletePrediction(guid, &prediction);
+  }
+  ASSERT_EQ(predicted[0].size(), predicted[1].size());
+  for (std::size_t i = 0; i < predicted[0].size(); ++i) {
+    EXPECT_THAT(
+        (predicted[0][i].position() - predicted[1][i].position()).Norm(),
+        Lt(1 * Milli(Metre)));
+  }
+}
+
+// Checks that a flight plan without burns matches the prediction, up to the
+// round-off of the barycentric coordinates, since the prediction is integrated
+// relative to the parent.
+TEST_F(PluginTest, FlightPlan) {
+  GUID const guid = "Test Satellite";
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+  plugin.SetVesselStateOffset(guid,
+                              RelativeDegreesOfFreedom<AliceSun>(
+                                  satellite_initial_displacement_,
+                                  satellite_initial_velocity_));
+  Instant const t = initial_time_ + 1 * Minute;
+  plugin.AdvanceTime(t, planetarium_rotation_);
+
+  EXPECT_FALSE(plugin.HasFlightPlan(guid));
+  plugin.CreateFlightPlan(guid, t + 6 * Hour, 10 * Second);
+  EXPECT_TRUE(plugin.HasFlightPlan(guid));
+  not_null<FlightPlan*> const flight_plan = plugin.GetFlightPlan(guid);
+  ASSERT_THAT(flight_plan->number_of_segments(), Eq(1));
+  Trajectory<Barycentric> const& coast = flight_plan->segment(0);
+  EXPECT_THAT(coast.last().time(), Eq(t + 6 * Hour));
+
+  std::vector<not_null<Trajectory<Barycentric>*>> const predictions =
+      plugin.PredictVessels({guid}, t + 6 * Hour, 10 * Second);
+  ASSERT_THAT(predictions, SizeIs(1));
+  EXPECT_THAT((coast.last().degrees_of_freedom().position() -
+               predictions.front()->last().degrees_of_freedom().position())
+                  .Norm(),
+              Lt(1 * Metre));
+  Trajectory<Barycentric>* prediction = predictions.front();
+  plugin.DeletePrediction(guid, &prediction);
+
+  plugin.DeleteFlightPlan(guid);
+  EXPECT_FALSE(plugin.HasFlightPlan(guid));
+}
+
+TEST_F(PluginTest, ProximityQueries) {
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  // Vessels on parallel orbits, 1 km and 10 km from the first one.
+  std::vector<GUID> const guids = {"V0", "V1", "V2"};
+  std::vector<Length> const offsets = {0 * Metre,
+                                       1 * Kilo(Metre),
+                                       10 * Kilo(Metre)};
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(plugin.InsertOrKeepVessel(guids[i], SolarSystem::kEarth));
+    plugin.SetVesselStateOffset(
+        guids[i],
+        RelativeDegreesOfFreedom<AliceSun>(
+            satellite_initial_displacement_ +
+                Displacement<AliceSun>({0 * Metre, 0 * Metre, offsets[i]}),
+            satellite_initial_velocity_));
+  }
+  Instant const t = initial_time_ + 1 * Minute;
+  plugin.AdvanceTime(t, planetarium_rotation_);
+
+  EXPECT_THAT(plugin.VesselsWithinRadius("V0", 2 * Kilo(Metre)),
+              ElementsAre(plugin.vessel_handle("V1")));
+  EXPECT_THAT(plugin.VesselsWithinRadius("V2", 100 * Kilo(Metre)),
+              ElementsAre(plugin.vessel_handle("V1"),
+                          plugin.vessel_handle("V0")));
+  EXPECT_THAT(plugin.VesselsWithinRadius("V2", 1 * Kilo(Metre)), IsEmpty());
+  VesselHandle closest;
+  Length distance;
+  EXPECT_TRUE(plugin.ClosestVessel("V2", &closest, &distance));
+  EXPECT_THAT(closest, Eq(plugin.vessel_handle("V1")));
+  EXPECT_THAT(distance, AllOf(Gt(8.9 * Kilo(Metre)), Lt(9.1 * Kilo(Metre))));
+}
+
+TEST_F(PluginTest, DominantBodies) {
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  // A vessel in low Earth orbit, one in low lunar orbit, and one between the
+  // Earth and Mars.  The dominant bodies don't depend on the velocities.
+  Velocity<AliceSun> const no_velocity;
+  std::vector<std::tuple<GUID, Index, Displacement<AliceSun>>> const vessels =
+      {std::make_tuple("LEO",
+                       SolarSystem::kEarth,
+                       satellite_initial_displacement_),
+       std::make_tuple("LLO",
+                       SolarSystem::kMoon,
+                       Displacement<AliceSun>(
+                           {2000 * Kilo(Metre), 0 * Metre, 0 * Metre})),
+       std::make_tuple("Interplanetary",
+                       SolarSystem::kSun,
+                       Displacement<AliceSun>(
+                           {1.2 * AstronomicalUnit, 0 * Metre, 0 * Metre}))};
+  std::vector<GUID> guids;
+  for (auto const& vessel : vessels) {
+    GUID const& guid = std::get<0>(vessel);
+    guids.push_back(guid);
+    plugin.InsertOrKeepVessel(guid, std::get<1>(vessel));
+    plugin.SetVesselStateOffset(
+        guid,
+        RelativeDegreesOfFreedom<AliceSun>(std::get<2>(vessel), no_velocity));
+  }
+  EXPECT_THAT(plugin.DominantBodies(guids),
+              ElementsAre(SolarSystem::kEarth,
+                          SolarSystem::kMoon,
+                          SolarSystem::kSun));
+}
+
+// Checks that the porkchop plot of a transfer from the Earth to Mars has its
+// minimum at about the Δv of a Hohmann transfer, and that it doesn't depend on
+// the number of threads.
+TEST_F(PluginTest, PorkchopPlot) {
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  Instant const t = initial_time_ + 1 * Minute;
+  plugin.AdvanceTime(t, planetarium_rotation_);
+
+  // The launch window before the opposition of November 1958.
+  int const kPoints = 10;
+  std::vector<std::vector<Speed>> plots;
+  for (int const threads : {1, 4}) {
+    plugin.SetNumberOfThreads(threads);
+    plots.push_back(plugin.PorkchopPlot(SolarSystem::kEarth,
+                                        SolarSystem::kMars,
+                                        t + 250 * Day,
+                                        t + 400 * Day,
+                                        kPoints,
+                                        t + 450 * Day,
+                                        t + 750 * Day,
+                                        kPoints,
+                                        1 * Hour));
+  }
+  ASSERT_THAT(plots[0], SizeIs(kPoints * kPoints));
+  EXPECT_THAT(plots[1], Eq(plots[0]));
+  Speed const minimum = *std::min_element(plots[0].begin(), plots[0].end());
+  EXPECT_THAT(minimum, AllOf(Gt(5 * Kilo(Metre) / Second),
+                             Lt(7 * Kilo(Metre) / Second)));
+}
+
+// Checks that the monitoring of the conservation of the energy and angular
+// momentum of the celestials samples at the expected period and reports small
+// drifts.
+TEST_F(PluginTest, ConservationMonitoring) {
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  plugin.SetConservationMonitoring(6);
+  for (Instant t = initial_time_ + 10 * Second;
+       t <= initial_time_ + 10 * Minute;
+       t += 10 * Second) {
+    plugin.AdvanceTime(t, planetarium_rotation_);
+  }
+  Plugin::ConservationDrift const drift = plugin.conservation_drift();
+  EXPECT_THAT(drift.samples, AllOf(Ge(9), Le(11)));
+  EXPECT_THAT(drift.energy, AllOf(Gt(0), Lt(1E-10)));
+  EXPECT_THAT(drift.angular_momentum, Lt(1E-10));
+  EXPECT_LE(drift.energy, drift.maximum_energy);
+  EXPECT_LE(drift.angular_momentum, drift.maximum_angular_momentum);
+
+  plugin.SetConservationMonitoring(0);
+  plugin.AdvanceTime(initial_time_ + 11 * Minute, planetarium_rotation_);
+  EXPECT_EQ(0, plugin.conservation_drift().samples);
+}
+
+// Checks that the step of the histories follows the fastest orbit, first among
+// the celestials and then with a vessel in low Earth orbit.
+TEST_F(PluginTest, HistoryStepPolicy) {
+  GUID const guid = "Test Satellite";
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  plugin.SetHistoryStepPolicy(100 /*steps_per_orbit*/, 1 * Second, 1 * Hour);
+
+  Instant t = initial_time_ + 1 * Day;
+  plugin.AdvanceTime(t, planetarium_rotation_);
+  // The moons orbit in days.
+  EXPECT_THAT(TestablePlugin::history_step(plugin),
+              AllOf(Ge(10 * Minute), Le(1 * Hour)));
+
+  // The satellite orbits in about 89 minutes.
+  EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+  plugin.SetVesselStateOffset(guid,
+                              RelativeDegreesOfFreedom<AliceSun>(
+                                  satellite_initial_displacement_,
+                                  satellite_initial_velocity_));
+  t += 2 * Hour;
+  plugin.AdvanceTime(t, planetarium_rotation_);
+  EXPECT_THAT(TestablePlugin::history_step(plugin),
+              AllOf(Gt(50 * Second), Lt(56 * Second)));
+
+  plugin.SetHistoryStepPolicy(0 /*steps_per_orbit*/, 1 * Second, 1 * Hour);
+  t += 10 * Minute;
+  EXPECT_FALSE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+  plugin.AdvanceTime(t, planetarium_rotation_);
+  EXPECT_EQ(10 * Second, TestablePlugin::history_step(plugin));
+}
+
+TEST_F(PluginTest, MemoryUsage) {
+  GUID const guid = "Test Satellite";
+  Plugin plugin(initial_time_,
+                SolarSystem::kSun,
+                sun_gravitational_parameter_,
+                planetarium_rotation_);
+  InsertAllSolarSystemBodies(&plugin);
+  plugin.EndInitialization();
+  EXPECT_TRUE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+  plugin.SetVesselStateOffset(guid,
+                              RelativeDegreesOfFreedom<AliceSun>(
+                                  satellite_initial_displacement_,
+                                  satellite_initial_velocity_));
+  plugin.AdvanceTime(initial_time_ + 10 * Second, planetarium_rotation_);
+  Plugin::MemoryUsage const before = plugin.memory_usage();
+  EXPECT_LT(0, before.celestials);
+  EXPECT_LT(0, before.vessels);
+  EXPECT_LT(0, before.bubble);
+  EXPECT_EQ(before.vessels, plugin.VesselMemoryUsage(guid));
+  EXPECT_LT(plugin.CelestialMemoryUsage(SolarSystem::kEarth),
+            before.celestials);
+
+  // The histories grow as time advances.
+  for (Instant t = initial_time_ + 20 * Second;
+       t <= initial_time_ + 10 * Minute;
+       t += 10 * Second) {
+    EXPECT_FALSE(plugin.InsertOrKeepVessel(guid, SolarSystem::kEarth));
+    plugin.AdvanceTime(t, planetarium_rotation_);
+  }
+  Plugin::MemoryUsage const after = plugin.memory_usage();
+  EXPECT_LT(before.celestials, after.celestials);
+  EXPECT_LT(before.vessels, after.vessels);
 }
 
 }  // namespace ksp_plugin
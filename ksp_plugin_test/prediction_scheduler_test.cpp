@@ -0,0 +1,66 @@
+#include "ksp_plugin/prediction_scheduler.hpp"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::ElementsAre;
+using testing::Eq;
+using testing::IsEmpty;
+
+namespace principia {
+namespace ksp_plugin {
+
+class PredictionSchedulerTest : public testing::Test {
+ protected:
+  PredictionSchedulerTest()
+      : vessel_guids_({"a", "b", "c", "d", "e", "f"}) {}
+
+  PredictionScheduler scheduler_;
+  std::vector<std::string> vessel_guids_;
+};
+
+TEST_F(PredictionSchedulerTest, Priorities) {
+  EXPECT_THAT(scheduler_.priority("a"), Eq(PredictionPriority::kBackground));
+  scheduler_.SetPriority("e", PredictionPriority::kTargetedOrVisible);
+  scheduler_.SetPriority("c", PredictionPriority::kActive);
+  scheduler_.SetPriority("b", PredictionPriority::kTargetedOrVisible);
+  EXPECT_THAT(scheduler_.priority("c"), Eq(PredictionPriority::kActive));
+  scheduler_.set_background_budget(0);
+  EXPECT_THAT(scheduler_.Schedule(vessel_guids_), ElementsAre("c", "b", "e"));
+  scheduler_.SetPriority("e", PredictionPriority::kBackground);
+  scheduler_.Remove("c");
+  EXPECT_THAT(scheduler_.Schedule(vessel_guids_), ElementsAre("b"));
+}
+
+// The background vessels are refreshed in turn, and each frame refreshes the
+// high-priority vessels plus at most the budget.
+TEST_F(PredictionSchedulerTest, RoundRobin) {
+  scheduler_.SetPriority("b", PredictionPriority::kActive);
+  scheduler_.set_background_budget(2);
+  EXPECT_THAT(scheduler_.Schedule(vessel_guids_),
+              ElementsAre("b", "a", "c"));
+  EXPECT_THAT(scheduler_.Schedule(vessel_guids_),
+              ElementsAre("b", "d", "e"));
+  EXPECT_THAT(scheduler_.Schedule(vessel_guids_),
+              ElementsAre("b", "f", "a"));
+  // The round-robin resumes after a vessel that has been removed.
+  vessel_guids_ = {"b", "c", "d", "e", "f"};
+  EXPECT_THAT(scheduler_.Schedule(vessel_guids_),
+              ElementsAre("b", "c", "d"));
+  // And after one that has become visible.
+  scheduler_.SetPriority("d", PredictionPriority::kTargetedOrVisible);
+  EXPECT_THAT(scheduler_.Schedule(vessel_guids_),
+              ElementsAre("b", "d", "e", "f"));
+  // The budget is not exceeded when it is larger than the number of
+  // background vessels.
+  scheduler_.set_background_budget(10);
+  EXPECT_THAT(scheduler_.Schedule(vessel_guids_),
+              ElementsAre("b", "d", "c", "e", "f"));
+  EXPECT_THAT(scheduler_.Schedule({}), IsEmpty());
+}
+
+}  // namespace ksp_plugin
+}  // namespace principia
@@ -1,12 +1,15 @@
 
 #include "ksp_plugin/vessel.hpp"
 
+#include <memory>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 using principia::si::Kilogram;
 using principia::si::Metre;
 using principia::si::Second;
+using testing::ElementsAre;
 
 namespace principia {
 namespace ksp_plugin {
@@ -98,5 +101,82 @@ TEST_F(VesselTest, SerializationSuccess) {
   EXPECT_TRUE(vessel_->is_synchronized());
 }
 
+TEST_F(VesselTest, DeferredHistory) {
+  vessel_->CreateProlongation(t1_, d1_);
+  vessel_->CreateHistoryAndForkProlongation(t2_, d2_);
+  serialization::Vessel message;
+  vessel_->WriteToMessage(&message);
+  vessel_ = Vessel::ReadFromMessage(message, &parent_);
+  EXPECT_TRUE(vessel_->has_deferred_history());
+  vessel_->set_history_downsampling({10 * Second, 1 * Metre});
+
+  // Writing doesn't deserialize the history.
+  serialization::Vessel second_message;
+  vessel_->WriteToMessage(&second_message);
+  EXPECT_TRUE(vessel_->has_deferred_history());
+  EXPECT_EQ(message.SerializeAsString(), second_message.SerializeAsString());
+
+  EXPECT_EQ(t2_, vessel_->prolongation().last().time());
+  EXPECT_FALSE(vessel_->has_deferred_history());
+  EXPECT_EQ(d2_, vessel_->history().last().degrees_of_freedom());
+  second_message.Clear();
+  vessel_->WriteToMessage(&second_message);
+  EXPECT_EQ(message.SerializeAsString(), second_message.SerializeAsString());
+}
+
+TEST_F(VesselTest, BubbleHistories) {
+  vessel_->CreateProlongation(t1_, d1_);
+  vessel_->CreateHistoryAndForkProlongation(t2_, d2_);
+  auto const bubble_histories =
+      std::make_shared<SynchronizedHistories<Barycentric>>(2);
+  // The centre of mass is at |d1_| and the vessel is offset from it by |d2_|.
+  auto const append_row = [this, &bubble_histories](Instant const& time) {
+    bubble_histories->Append(time, [this](int const b) {
+      return b == 0 ? d1_ : d2_;
+    });
+  };
+  DegreesOfFreedom<Barycentric> const d12 =
+      d1_ + (d2_ - DegreesOfFreedom<Barycentric>(Barycentric::origin,
+                                                 Velocity<Barycentric>()));
+  Instant const t3 = t2_ + 10 * Second;
+  Instant const t4 = t2_ + 20 * Second;
+  Instant const t5 = t2_ + 30 * Second;
+  Instant const t6 = t2_ + 40 * Second;
+
+  append_row(t3);
+  vessel_->SetBubbleHistories(bubble_histories, 1);
+  EXPECT_TRUE(vessel_->has_bubble_histories());
+  vessel_->ResetProlongation(t3);
+  vessel_->mutable_prolongation()->Append(t3 + 5 * Second, d1_);
+  append_row(t4);
+  vessel_->ResetProlongation(t4);
+  append_row(t5);
+  vessel_->ResetProlongation(t5);
+
+  // The prolongation stays forked at the last point of the history, and starts
+  // with the last row.
+  EXPECT_EQ(t2_, *vessel_->prolongation().fork_time());
+  EXPECT_THAT(vessel_->prolongation().Times(), ElementsAre(t2_, t5));
+  EXPECT_EQ(d12, vessel_->prolongation().last().degrees_of_freedom());
+
+  // Reading the history materializes the rows.
+  EXPECT_THAT(vessel_->history().Times(), ElementsAre(t2_, t3, t4, t5));
+  EXPECT_EQ(d12, vessel_->history().last().degrees_of_freedom());
+  EXPECT_EQ(t5, *vessel_->prolongation().fork_time());
+  EXPECT_THAT(vessel_->prolongation().Times(), ElementsAre(t2_, t3, t4, t5));
+  EXPECT_TRUE(vessel_->has_bubble_histories());
+
+  append_row(t6);
+  vessel_->ResetProlongation(t6);
+  EXPECT_EQ(t5, *vessel_->prolongation().fork_time());
+  vessel_->ClearBubbleHistories();
+  EXPECT_FALSE(vessel_->has_bubble_histories());
+  EXPECT_THAT(vessel_->history().Times(), ElementsAre(t2_, t3, t4, t5, t6));
+  EXPECT_EQ(t6, *vessel_->prolongation().fork_time());
+  vessel_->ResetProlongation(t6);
+  EXPECT_THAT(vessel_->prolongation().Times(),
+              ElementsAre(t2_, t3, t4, t5, t6));
+}
+
 }  // namespace ksp_plugin
 }  // namespace principia
@@ -1,4 +1,4 @@
-#include "physics/body.hpp"
+﻿#include "physics/body.hpp"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -122,5 +122,43 @@ TEST_F(BodyTest, OblateSerializationSuccess) {
   EXPECT_EQ(oblate_body_.axis(), cast_oblate_body->axis());;
 }
 
+TEST_F(BodyTest, HigherOrderZonalHarmonicsSerializationSuccess) {
+  OblateBody<World> const higher_order_body(
+      17 * SIUnit<GravitationalParameter>(),
+      {1E-3, -2E-6, 3E-6},
+      1000 * SIUnit<Length>(),
+      axis_);
+  EXPECT_EQ(4, higher_order_body.zonal_degree());
+  EXPECT_EQ(-1E-3 * 17 * SIUnit<GravitationalParameter>() *
+                1000 * SIUnit<Length>() * 1000 * SIUnit<Length>(),
+            higher_order_body.j2());
+  EXPECT_EQ(2, oblate_body_.zonal_degree());
+  EXPECT_TRUE(oblate_body_.higher_zonal_harmonics().empty());
+
+  serialization::Body message;
+  higher_order_body.WriteToMessage(&message);
+  serialization::OblateBody const oblateness_information =
+      message.massive_body().GetExtension(
+          serialization::OblateBody::oblate_body);
+  EXPECT_EQ(2, oblateness_information.higher_zonal_harmonics_size());
+  EXPECT_EQ(-2E-6, oblateness_information.higher_zonal_harmonics(0));
+  EXPECT_EQ(3E-6, oblateness_information.higher_zonal_harmonics(1));
+  EXPECT_EQ(1000, oblateness_information.reference_radius().magnitude());
+
+  OblateBody<World> const oblate_body =
+      *OblateBody<World>::ReadFromMessage(message);
+  EXPECT_EQ(higher_order_body.j2(), oblate_body.j2());
+  EXPECT_EQ(higher_order_body.higher_zonal_harmonics(),
+            oblate_body.higher_zonal_harmonics());
+  EXPECT_EQ(higher_order_body.reference_radius(),
+            oblate_body.reference_radius());
+  EXPECT_EQ(higher_order_body.axis(), oblate_body.axis());
+
+  // A body serialized without higher harmonics only has a j2.
+  message.Clear();
+  oblate_body_.WriteToMessage(&message);
+  EXPECT_EQ(2, OblateBody<World>::ReadFromMessage(message)->zonal_degree());
+}
+
 }  // namespace physics
 }  // namespace principia
@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "geometry/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::geometry::Instant;
+using principia::quantities::Time;
+
+namespace principia {
+namespace physics {
+
+// A function of time expanded on the Chebyshev polynomials of the first kind
+// over the interval [t_min, t_max].  |Vector| may be a quantity or a vector of
+// a vector space, it must support addition and multiplication by a |double|.
+template<typename Vector>
+class ChebyshevSeries {
+ public:
+  using Derivative =
+      decltype(std::declval<Vector>() / std::declval<Time>());
+
+  // The |coefficients| are those of T₀, T₁, ..., in this order; there must be
+  // at least one.  |t_min| must be before |t_max|.
+  ChebyshevSeries(std::vector<Vector> const& coefficients,
+                  Instant const& t_min,
+                  Instant const& t_max);
+
+  Instant const& t_min() const;
+  Instant const& t_max() const;
+
+  // The value of the series and of its derivative at |t|, which must be in
+  // [t_min, t_max].  Both use Clenshaw's algorithm.
+  Vector Evaluate(Instant const& t) const;
+  Derivative EvaluateDerivative(Instant const& t) const;
+
+  // Returns the series of the given |degree| that best approximates, in the
+  // least-squares sense, the values |q| and the derivatives |v| at the given
+  // increasing |times|.  The derivatives are weighted by half the length of the
+  // interval, so that both kinds of conditions are commensurate.  The interval
+  // of the series spans from the first to the last of the |times|.  There must
+  // be at least as many conditions as coefficients, i.e., 2 |times.size()| ≥
+  // |degree| + 1.
+  static ChebyshevSeries FitValuesAndDerivatives(
+      int const degree,
+      std::vector<Instant> const& times,
+      std::vector<Vector> const& q,
+      std::vector<Derivative> const& v);
+
+ private:
+  std::vector<Vector> coefficients_;
+  Instant t_min_;
+  Instant t_max_;
+  // The affine map from [t_min, t_max] to [-1, 1] is
+  // s = (t - t_mean_) / half_duration_.
+  Instant t_mean_;
+  Time half_duration_;
+
+  template<typename Frame>
+  friend class EphemerisFile;
+};
+
+}  // namespace physics
+}  // namespace principia
+
+#include "physics/chebyshev_series_body.hpp"
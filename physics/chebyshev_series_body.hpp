@@ -0,0 +1,148 @@
+﻿#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace physics {
+
+template<typename Vector>
+ChebyshevSeries<Vector>::ChebyshevSeries(
+    std::vector<Vector> const& coefficients,
+    Instant const& t_min,
+    Instant const& t_max)
+    : coefficients_(coefficients),
+      t_min_(t_min),
+      t_max_(t_max),
+      t_mean_(t_min + (t_max - t_min) / 2),
+      half_duration_((t_max - t_min) / 2) {
+  CHECK(!coefficients_.empty());
+  CHECK_LT(t_min_, t_max_);
+}
+
+template<typename Vector>
+Instant const& ChebyshevSeries<Vector>::t_min() const {
+  return t_min_;
+}
+
+template<typename Vector>
+Instant const& ChebyshevSeries<Vector>::t_max() const {
+  return t_max_;
+}
+
+template<typename Vector>
+Vector ChebyshevSeries<Vector>::Evaluate(Instant const& t) const {
+  CHECK_LE(t_min_, t);
+  CHECK_LE(t, t_max_);
+  double const two_s = 2 * ((t - t_mean_) / half_duration_);
+  Vector b_kplus2;
+  Vector b_kplus1;
+  for (int k = static_cast<int>(coefficients_.size()) - 1; k >= 1; --k) {
+    Vector const b_k = coefficients_[k] + two_s * b_kplus1 - b_kplus2;
+    b_kplus2 = b_kplus1;
+    b_kplus1 = b_k;
+  }
+  return coefficients_[0] + (two_s / 2) * b_kplus1 - b_kplus2;
+}
+
+template<typename Vector>
+typename ChebyshevSeries<Vector>::Derivative
+ChebyshevSeries<Vector>::EvaluateDerivative(Instant const& t) const {
+  CHECK_LE(t_min_, t);
+  CHECK_LE(t, t_max_);
+  // T'ₖ = k Uₖ₋₁, and the Chebyshev polynomials of the second kind satisfy the
+  // same recurrence as those of the first kind, with U₀ = 1 and U₁ = 2 s.
+  double const two_s = 2 * ((t - t_mean_) / half_duration_);
+  Vector b_kplus2;
+  Vector b_kplus1;
+  for (int k = static_cast<int>(coefficients_.size()) - 1; k >= 1; --k) {
+    Vector const b_k = k * coefficients_[k] + two_s * b_kplus1 - b_kplus2;
+    b_kplus2 = b_kplus1;
+    b_kplus1 = b_k;
+  }
+  return b_kplus1 / half_duration_;
+}
+
+template<typename Vector>
+ChebyshevSeries<Vector> ChebyshevSeries<Vector>::FitValuesAndDerivatives(
+    int const degree,
+    std::vector<Instant> const& times,
+    std::vector<Vector> const& q,
+    std::vector<Derivative> const& v) {
+  CHECK_LE(0, degree);
+  CHECK_LE(2U, times.size());
+  CHECK_EQ(times.size(), q.size());
+  CHECK_EQ(times.size(), v.size());
+  CHECK_LE(static_cast<std::size_t>(degree + 1), 2 * times.size());
+  int const n = degree + 1;
+  Instant const& t_min = times.front();
+  Instant const& t_max = times.back();
+  Instant const t_mean = t_min + (t_max - t_min) / 2;
+  Time const half_duration = (t_max - t_min) / 2;
+
+  // Accumulate the normal equations |normal_matrix| c = |right_hand_side|.
+  // Each time contributes the condition on the value, with the coefficients
+  // Tⱼ(s), and the condition on the derivative with respect to s, with the
+  // coefficients T'ⱼ(s) = j Uⱼ₋₁(s).
+  std::vector<std::vector<double>> normal_matrix(n, std::vector<double>(n));
+  std::vector<Vector> right_hand_side(n);
+  std::vector<double> t_j(n);
+  std::vector<double> t_prime_j(n);
+  for (std::size_t i = 0; i < times.size(); ++i) {
+    double const s = (times[i] - t_mean) / half_duration;
+    // Here |u_jminus1| is Uⱼ₋₁(s), with U₋₁ = 0.
+    double u_jminus1 = 0;
+    double u_jminus2 = 0;
+    for (int j = 0; j < n; ++j) {
+      t_j[j] = j == 0 ? 1 : j == 1 ? s : 2 * s * t_j[j - 1] - t_j[j - 2];
+      t_prime_j[j] = j * u_jminus1;
+      double const u_j = j == 0 ? 1 : 2 * s * u_jminus1 - u_jminus2;
+      u_jminus2 = u_jminus1;
+      u_jminus1 = u_j;
+    }
+    Vector const scaled_v = v[i] * half_duration;
+    for (int j = 0; j < n; ++j) {
+      for (int k = 0; k <= j; ++k) {
+        normal_matrix[j][k] += t_j[j] * t_j[k] + t_prime_j[j] * t_prime_j[k];
+      }
+      right_hand_side[j] += t_j[j] * q[i] + t_prime_j[j] * scaled_v;
+    }
+  }
+
+  // The normal matrix is symmetric positive definite: solve using its Cholesky
+  // decomposition L Lᵀ, stored in the lower triangle.
+  for (int j = 0; j < n; ++j) {
+    for (int k = 0; k < j; ++k) {
+      normal_matrix[j][j] -= normal_matrix[j][k] * normal_matrix[j][k];
+    }
+    CHECK_LT(0, normal_matrix[j][j]);
+    normal_matrix[j][j] = std::sqrt(normal_matrix[j][j]);
+    for (int i = j + 1; i < n; ++i) {
+      for (int k = 0; k < j; ++k) {
+        normal_matrix[i][j] -= normal_matrix[i][k] * normal_matrix[j][k];
+      }
+      normal_matrix[i][j] /= normal_matrix[j][j];
+    }
+  }
+  std::vector<Vector> coefficients(n);
+  for (int j = 0; j < n; ++j) {
+    Vector y = right_hand_side[j];
+    for (int k = 0; k < j; ++k) {
+      y -= normal_matrix[j][k] * coefficients[k];
+    }
+    coefficients[j] = y / normal_matrix[j][j];
+  }
+  for (int j = n - 1; j >= 0; --j) {
+    Vector x = coefficients[j];
+    for (int k = j + 1; k < n; ++k) {
+      x -= normal_matrix[k][j] * coefficients[k];
+    }
+    coefficients[j] = x / normal_matrix[j][j];
+  }
+  return ChebyshevSeries(coefficients, t_min, t_max);
+}
+
+}  // namespace physics
+}  // namespace principia
@@ -0,0 +1,115 @@
+﻿#include "physics/chebyshev_series.hpp"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+#include "testing_utilities/almost_equals.hpp"
+
+using principia::quantities::Abs;
+using principia::quantities::AngularFrequency;
+using principia::quantities::Cos;
+using principia::quantities::Length;
+using principia::quantities::Sin;
+using principia::quantities::Speed;
+using principia::si::Metre;
+using principia::si::Radian;
+using principia::si::Second;
+using principia::testing_utilities::AlmostEquals;
+using testing::Eq;
+using testing::Lt;
+
+namespace principia {
+namespace physics {
+
+class ChebyshevSeriesTest : public testing::Test {
+ protected:
+  ChebyshevSeriesTest()
+      : t_min_(Instant() - 1 * Second),
+        t_max_(Instant() + 3 * Second) {}
+
+  Instant const t_min_;
+  Instant const t_max_;
+};
+
+// 1 + 2 T₁(s) + 3 T₂(s) = 6 s² + 2 s - 2, with s = (t - 1 s) / 2 s.
+TEST_F(ChebyshevSeriesTest, Evaluate) {
+  ChebyshevSeries<Length> const series({1 * Metre, 2 * Metre, 3 * Metre},
+                                       t_min_,
+                                       t_max_);
+  EXPECT_THAT(series.t_min(), Eq(t_min_));
+  EXPECT_THAT(series.t_max(), Eq(t_max_));
+  EXPECT_THAT(series.Evaluate(t_min_), AlmostEquals(2 * Metre, 0));
+  EXPECT_THAT(series.Evaluate(Instant() + 1 * Second),
+              AlmostEquals(-2 * Metre, 0));
+  EXPECT_THAT(series.Evaluate(Instant() + 2 * Second),
+              AlmostEquals(0.5 * Metre, 0));
+  EXPECT_THAT(series.Evaluate(t_max_), AlmostEquals(6 * Metre, 0));
+  // The derivative is (12 s + 2) / 2 s.
+  EXPECT_THAT(series.EvaluateDerivative(t_min_),
+              AlmostEquals(-5 * Metre / Second, 0));
+  EXPECT_THAT(series.EvaluateDerivative(Instant() + 1 * Second),
+              AlmostEquals(1 * Metre / Second, 0));
+  EXPECT_THAT(series.EvaluateDerivative(t_max_),
+              AlmostEquals(7 * Metre / Second, 0));
+}
+
+// A polynomial is fitted exactly by a series of at least its degree.
+TEST_F(ChebyshevSeriesTest, FitPolynomial) {
+  auto const q = [](Instant const& t) {
+    double const x = (t - Instant()) / Second;
+    return (((x - 2) * x + 0.5) * x + 3) * Metre;
+  };
+  auto const v = [](Instant const& t) {
+    double const x = (t - Instant()) / Second;
+    return ((3 * x - 4) * x + 0.5) * Metre / Second;
+  };
+  std::vector<Instant> times;
+  std::vector<Length> positions;
+  std::vector<Speed> velocities;
+  for (int i = 0; i <= 4; ++i) {
+    times.push_back(t_min_ + i * Second);
+    positions.push_back(q(times.back()));
+    velocities.push_back(v(times.back()));
+  }
+  ChebyshevSeries<Length> const series =
+      ChebyshevSeries<Length>::FitValuesAndDerivatives(
+          5, times, positions, velocities);
+  EXPECT_THAT(series.t_min(), Eq(t_min_));
+  EXPECT_THAT(series.t_max(), Eq(t_max_));
+  for (Instant t = t_min_; t <= t_max_; t += 0.125 * Second) {
+    EXPECT_THAT(Abs(series.Evaluate(t) - q(t)), Lt(1E-14 * Metre));
+    EXPECT_THAT(Abs(series.EvaluateDerivative(t) - v(t)),
+                Lt(1E-14 * Metre / Second));
+  }
+}
+
+// A smooth function is approximated accurately between the fitted points.
+TEST_F(ChebyshevSeriesTest, FitSine) {
+  AngularFrequency const ω = 1 * Radian / Second;
+  std::vector<Instant> times;
+  std::vector<Length> positions;
+  std::vector<Speed> velocities;
+  for (int i = 0; i <= 8; ++i) {
+    times.push_back(t_min_ + i * 0.5 * Second);
+    positions.push_back(Sin(ω * (times.back() - Instant())) * Metre);
+    velocities.push_back(Cos(ω * (times.back() - Instant())) * Metre / Second);
+  }
+  ChebyshevSeries<Length> const series =
+      ChebyshevSeries<Length>::FitValuesAndDerivatives(
+          12, times, positions, velocities);
+  for (Instant t = t_min_; t <= t_max_; t += 0.01 * Second) {
+    EXPECT_THAT(Abs(series.Evaluate(t) - Sin(ω * (t - Instant())) * Metre),
+                Lt(1E-9 * Metre));
+    EXPECT_THAT(Abs(series.EvaluateDerivative(t) -
+                    Cos(ω * (t - Instant())) * Metre / Second),
+                Lt(1E-8 * Metre / Second));
+  }
+}
+
+}  // namespace physics
+}  // namespace principia
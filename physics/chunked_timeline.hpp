@@ -0,0 +1,251 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/mapped_file.hpp"
+#include "base/not_null.hpp"
+#include "base/pool_allocator.hpp"
+#include "geometry/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::base::MappedFile;
+using principia::base::not_null;
+using principia::base::PoolAllocator;
+using principia::geometry::Instant;
+using principia::quantities::Time;
+
+namespace principia {
+namespace physics {
+
+// A time-ordered sequence of (Instant, Value) entries, optimized for appending
+// at the end and forgetting at either end.  The entries are stored in
+// contiguous chunks whose capacity grows geometrically up to a bound, so that
+// short timelines remain small and long ones cost one allocation per
+// |kMaxChunkCapacity| entries.  Lookups are binary searches, first among the
+// chunks and then within a chunk.
+// The entries are never moved once appended.  An iterator remains valid until
+// the entry it denotes is forgotten; in particular it is not invalidated by
+// |Append|, by |ForgetFrom| an entry after it, or by |ForgetBefore| an entry
+// at or before it.  The end iterator is never invalidated.
+// The old chunks may be moved to an |Archive|, see |set_archive|; this is
+// transparent to the iterators.
+template<typename Value>
+class ChunkedTimeline {
+ public:
+  using Entry = std::pair<Instant, Value>;
+
+  // A store for the old chunks of timelines, in a |MappedFile| divided in
+  // |number_of_slots| fixed-size records, each of which holds the entries of
+  // one chunk.  The resident memory used by the archived chunks is left to the
+  // operating system, which may page them out.  An archive may be shared by
+  // several timelines, which may be modified concurrently, and must outlive
+  // them.
+  class Archive {
+   public:
+    Archive(std::string const& filename, std::int64_t const number_of_slots);
+
+    Archive(Archive const&) = delete;
+    Archive& operator=(Archive const&) = delete;
+
+    std::int64_t number_of_slots() const;
+    std::int64_t number_of_free_slots() const;
+
+   private:
+    // Returns the address of a free slot, or null if there is none.
+    Entry* Allocate();
+    void Free(not_null<Entry*> const slot);
+
+    std::int64_t const number_of_slots_;
+    MappedFile file_;
+    mutable std::mutex lock_;
+    // Allocated from the back.
+    std::vector<not_null<Entry*>> free_slots_;  // Guarded by |lock_|.
+
+    friend class ChunkedTimeline;
+  };
+
+ private:
+  struct Chunk {
+    explicit Chunk(std::size_t const capacity);
+    // Releases the slot of |archive|, if any.
+    ~Chunk();
+
+    Chunk(Chunk const&) = delete;
+    Chunk& operator=(Chunk const&) = delete;
+
+    // The entries, in memory or in the archive.
+    Entry const* data() const;
+    std::size_t size() const;
+
+    // The entries before |begin| have been forgotten.  Their storage is only
+    // released with the chunk, so that the indices of the other entries don't
+    // change.  Never equal to |size()|: there are no empty chunks.
+    std::size_t begin;
+    // Never reallocated, since the capacity is reserved at construction.
+    // Empty if the chunk is archived.  The small chunks of the short-lived
+    // timelines, e.g., those of the prolongations, are recycled by the pool.
+    std::vector<Entry, PoolAllocator<Entry>> entries;
+    // If the chunk is archived, the archive, the slot holding its entries, and
+    // their number.  Null otherwise.
+    Archive* archive = nullptr;
+    Entry* archived_entries = nullptr;
+    std::size_t archived_size = 0;
+  };
+
+  // Keyed by the time of the first entry of the chunk in storage, which
+  // remains a lower bound of its times even after |ForgetBefore|.
+  using Chunks = std::map<Instant,
+                          Chunk,
+                          std::less<Instant>,
+                          PoolAllocator<std::pair<Instant const, Chunk>>>;
+
+ public:
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = Entry;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Entry const*;
+    using reference = Entry const&;
+
+    Iterator() = default;
+
+    Entry const& operator*() const;
+    Entry const* operator->() const;
+
+    Iterator& operator++();
+    Iterator& operator--();
+
+    bool operator==(Iterator const& right) const;
+    bool operator!=(Iterator const& right) const;
+
+   private:
+    // No transfer of ownership.
+    Iterator(not_null<Chunks const*> const chunks,
+             typename Chunks::const_iterator const chunk,
+             std::size_t const index);
+
+    Chunks const* chunks_ = nullptr;
+    typename Chunks::const_iterator chunk_;
+    // An index in |chunk_->second.entries|, 0 for the end iterator.
+    std::size_t index_ = 0;
+
+    friend class ChunkedTimeline;
+  };
+
+  ChunkedTimeline() = default;
+
+  ChunkedTimeline(ChunkedTimeline const&) = delete;
+  ChunkedTimeline(ChunkedTimeline&&) = delete;
+  ChunkedTimeline& operator=(ChunkedTimeline const&) = delete;
+  ChunkedTimeline& operator=(ChunkedTimeline&&) = delete;
+
+  bool empty() const;
+  std::size_t size() const;
+
+  // Returns an estimate of the memory used by the chunks, in bytes, including
+  // the storage of the forgotten entries that has not been released yet but
+  // excluding this object and the entries moved to the archive.  Complexity is
+  // linear in the number of chunks.
+  std::int64_t MemoryUsage() const;
+
+  Iterator begin() const;
+  Iterator end() const;
+
+  // |time| must be after the time of the last entry.
+  void Append(Instant const& time, Value const& value);
+
+  // Appends the |entries|, which must be in increasing time order and after the
+  // last entry.  The entries are copied into the chunks in contiguous blocks,
+  // and the chunks created for them are made large enough for the remaining
+  // entries, within the bounds of the geometric growth.
+  void AppendRange(std::vector<Entry> const& entries);
+
+  // Moves the entries of |*source| before |end|, an iterator of |*source|, to
+  // the end of this timeline.  They must be after the last entry.  The chunks
+  // of |*source| all of whose entries are moved are transferred along with
+  // their entries, which are neither copied nor reallocated, unless a chunk has
+  // forgotten entries that are not after the last entry; the other entries are
+  // copied.  The iterators of |*source| to the moved entries are invalidated,
+  // those to the other entries remain valid.
+  void Splice(not_null<ChunkedTimeline*> const source, Iterator const& end);
+
+  // From now on, when a chunk is complete and all its entries are more than
+  // |horizon| older than the last entry, it is moved to |*archive|.  Nothing is
+  // archived once |*archive| is full.  No transfer of ownership.
+  void set_archive(not_null<Archive*> const archive, Time const& horizon);
+
+  // Return the entry at |time|, or end if there is none.
+  Iterator Find(Instant const& time) const;
+  // Return the first entry at or after |time|, or end if there is none.
+  Iterator LowerBound(Instant const& time) const;
+  // Same as above, but |hint|, an iterator of this timeline, is the result of a
+  // previous lookup.  If |time| is on or after the time of |hint|, the result
+  // is searched forward from |hint| in its chunk and the next one, which is
+  // amortised constant time when the lookups are in increasing time order.
+  Iterator LowerBound(Iterator const& hint, Instant const& time) const;
+  // Return the first entry (strictly) after |time|, or end if there is none.
+  Iterator UpperBound(Instant const& time) const;
+
+  // Removes |it| and all the entries after it.
+  void ForgetFrom(Iterator const& it);
+  // Removes all the entries before |it|, but not |it| itself.
+  void ForgetBefore(Iterator const& it);
+
+  // Removes the entries in [first, last[ for which |forget(entry)| returns
+  // true.  |forget| is called on the entries in increasing time order.  The
+  // chunks containing these entries are compacted, so this invalidates all
+  // the iterators except end.
+  template<typename Predicate>
+  void ForgetIf(Iterator const& first,
+                Iterator const& last,
+                Predicate forget);
+
+ private:
+  // Returns the first of the entries in [first, last[, which are in increasing
+  // time order, whose time is at or after |time|, or strictly after |time| if
+  // |strictly_after| is true; |last| if there is none.  The entries are often
+  // equally spaced, e.g., those of the histories, which are sampled every
+  // step, so the position of |time| is estimated by linear interpolation
+  // between the first and last entries and verified against its neighbours,
+  // in constant time.  If the estimate is off by more than one entry, this
+  // falls back to a binary search.
+  static Entry const* Search(Entry const* const first,
+                             Entry const* const last,
+                             Instant const& time,
+                             bool const strictly_after);
+
+  // Returns the first entry of |chunk|, or end if |chunk| is at end.
+  Iterator FirstOf(typename Chunks::const_iterator const chunk) const;
+
+  // Moves to |archive_| the chunks, other than the last one, whose entries are
+  // all more than |horizon_| older than the last entry.
+  void ArchiveOldChunks();
+
+  // The number of entries that the hinted |LowerBound| examines one by one
+  // before resorting to |Search|.
+  static std::ptrdiff_t const kHintScan = 8;
+
+  // The capacities of the first and of the largest chunks.
+  static std::size_t const kMinChunkCapacity = 8;
+  static std::size_t const kMaxChunkCapacity = 1024;
+
+  Chunks chunks_;
+  std::size_t size_ = 0;
+
+  // Null if the chunks are not archived.  Not owning.
+  Archive* archive_ = nullptr;
+  Time horizon_;
+};
+
+}  // namespace physics
+}  // namespace principia
+
+#include "physics/chunked_timeline_body.hpp"
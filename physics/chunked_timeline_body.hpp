@@ -0,0 +1,593 @@
+﻿#pragma once
+
+#include "physics/chunked_timeline.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+
+#include "base/macros.hpp"
+#include "base/memory_usage.hpp"
+#include "glog/logging.h"
+
+using principia::base::TreeMemoryUsage;
+using principia::base::VectorMemoryUsage;
+
+namespace principia {
+namespace physics {
+
+template<typename Value>
+ChunkedTimeline<Value>::Archive::Archive(std::string const& filename,
+                                         std::int64_t const number_of_slots)
+    : number_of_slots_(number_of_slots),
+      file_(filename, number_of_slots * kMaxChunkCapacity * sizeof(Entry)) {
+  // The archived entries are never destroyed.
+  static_assert(std::is_trivially_destructible<Entry>::value,
+                "Entries must be trivially destructible");
+  Entry* const slots = reinterpret_cast<Entry*>(file_.data());
+  for (std::int64_t i = number_of_slots_ - 1; i >= 0; --i) {
+    free_slots_.push_back(slots + i * kMaxChunkCapacity);
+  }
+}
+
+template<typename Value>
+std::int64_t ChunkedTimeline<Value>::Archive::number_of_slots() const {
+  return number_of_slots_;
+}
+
+template<typename Value>
+std::int64_t ChunkedTimeline<Value>::Archive::number_of_free_slots() const {
+  std::lock_guard<std::mutex> l(lock_);
+  return free_slots_.size();
+}
+
+template<typename Value>
+typename ChunkedTimeline<Value>::Entry*
+ChunkedTimeline<Value>::Archive::Allocate() {
+  std::lock_guard<std::mutex> l(lock_);
+  if (free_slots_.empty()) {
+    return nullptr;
+  }
+  Entry* const slot = free_slots_.back();
+  free_slots_.pop_back();
+  return slot;
+}
+
+template<typename Value>
+void ChunkedTimeline<Value>::Archive::Free(not_null<Entry*> const slot) {
+  std::lock_guard<std::mutex> l(lock_);
+  free_slots_.push_back(slot);
+}
+
+template<typename Value>
+ChunkedTimeline<Value>::Chunk::Chunk(std::size_t const capacity)
+    : begin(0) {
+  entries.reserve(capacity);
+}
+
+template<typename Value>
+ChunkedTimeline<Value>::Chunk::~Chunk() {
+  if (archive != nullptr) {
+    archive->Free(archived_entries);
+  }
+}
+
+template<typename Value>
+typename ChunkedTimeline<Value>::Entry const*
+ChunkedTimeline<Value>::Chunk::data() const {
+  return archive == nullptr ? entries.data() : archived_entries;
+}
+
+template<typename Value>
+std::size_t ChunkedTimeline<Value>::Chunk::size() const {
+  return archive == nullptr ? entries.size() : archived_size;
+}
+
+template<typename Value>
+typename ChunkedTimeline<Value>::Entry const&
+ChunkedTimeline<Value>::Iterator::operator*() const {
+  return chunk_->second.data()[index_];
+}
+
+template<typename Value>
+typename ChunkedTimeline<Value>::Entry const*
+ChunkedTimeline<Value>::Iterator::operator->() const {
+  return &chunk_->second.data()[index_];
+}
+
+template<typename Value>
+typename ChunkedTimeline<Value>::Iterator&
+ChunkedTimeline<Value>::Iterator::operator++() {
+  DEBUG_CHECK(chunk_ != chunks_->end()) << "Incrementing the end iterator";
+  ++index_;
+  if (index_ == chunk_->second.size()) {
+    ++chunk_;
+    index_ = chunk_ == chunks_->end() ? 0 : chunk_->second.begin;
+  }
+  return *this;
+}
+
+template<typename Value>
+typename ChunkedTimeline<Value>::Iterator&
+ChunkedTimeline<Value>::Iterator::operator--() {
+  if (chunk_ == chunks_->end() || index_ == chunk_->second.begin) {
+    DEBUG_CHECK(chunk_ != chunks_->begin())
+        << "Decrementing the begin iterator";
+    --chunk_;
+    index_ = chunk_->second.size() - 1;
+  } else {
+    --index_;
+  }
+  return *this;
+}
+
+template<typename Value>
+bool ChunkedTimeline<Value>::Iterator::operator==(
+    Iterator const& right) const {
+  return chunk_ == right.chunk_ && index_ == right.index_;
+}
+
+template<typename Value>
+bool ChunkedTimeline<Value>::Iterator::operator!=(
+    Iterator const& right) const {
+  return !(*this == right);
+}
+
+template<typename Value>
+ChunkedTimeline<Value>::Iterator::Iterator(
+    not_null<Chunks const*> const chunks,
+    typename Chunks::const_iterator const chunk,
+    std::size_t const index)
+    : chunks_(chunks),
+      chunk_(chunk),
+      index_(index) {}
+
+template<typename Value>
+bool ChunkedTimeline<Value>::empty() const {
+  return chunks_.empty();
+}
+
+template<typename Value>
+std::size_t ChunkedTimeline<Value>::size() const {
+  return size_;
+}
+
+template<typename Value>
+std::int64_t ChunkedTimeline<Value>::MemoryUsage() const {
+  std::int64_t usage = TreeMemoryUsage(chunks_);
+  for (auto const& pair : chunks_) {
+    usage += VectorMemoryUsage(pair.second.entries);
+  }
+  return usage;
+}
+
+template<typename Value>
+typename ChunkedTimeline<Value>::Iterator
+ChunkedTimeline<Value>::begin() const {
+  return FirstOf(chunks_.begin());
+}
+
+template<typename Value>
+typename ChunkedTimeline<Value>::Iterator ChunkedTimeline<Value>::end() const {
+  return Iterator(&chunks_, chunks_.end(), 0);
+}
+
+template<typename Value>
+void ChunkedTimeline<Value>::Append(Instant const& time, Value const& value) {
+  DEBUG_CHECK(chunks_.empty() ||
+              chunks_.rbegin()->second.data()[
+                  chunks_.rbegin()->second.size() - 1].first < time)
+      << "Append out of order";
+  // The last chunk may be archived if |ForgetFrom| removed the chunks after
+  // it; it is then complete.
+  bool const new_chunk =
+      chunks_.empty() ||
+      chunks_.rbegin()->second.archive != nullptr ||
+      chunks_.rbegin()->second.entries.size() ==
+          chunks_.rbegin()->second.entries.capacity();
+  if (new_chunk) {
+    std::size_t capacity = kMinChunkCapacity;
+    if (!chunks_.empty()) {
+      capacity = chunks_.rbegin()->second.archive == nullptr
+                     ? 2 * chunks_.rbegin()->second.entries.capacity()
+                     : kMaxChunkCapacity;
+      if (capacity > kMaxChunkCapacity) {
+        capacity = kMaxChunkCapacity;
+      }
+    }
+    chunks_.emplace_hint(chunks_.end(),
+                         std::piecewise_construct,
+                         std::forward_as_tuple(time),
+                         std::forward_as_tuple(capacity));
+  }
+  chunks_.rbegin()->second.entries.emplace_back(time, value);
+  ++size_;
+  if (new_chunk) {
+    ArchiveOldChunks();
+  }
+}
+
+template<typename Value>
+void ChunkedTimeline<Value>::AppendRange(std::vector<Entry> const& entries) {
+  if (entries.empty()) {
+    return;
+  }
+  DEBUG_CHECK(chunks_.empty() ||
+              chunks_.rbegin()->second.data()[
+                  chunks_.rbegin()->second.size() - 1].first <
+                  entries.front().first)
+      << "Append out of order";
+  std::size_t appended = 0;
+  while (appended < entries.size()) {
+    std::size_t const remaining = entries.size() - appended;
+    bool const new_chunk =
+        chunks_.empty() ||
+        chunks_.rbegin()->second.archive != nullptr ||
+        chunks_.rbegin()->second.entries.size() ==
+            chunks_.rbegin()->second.entries.capacity();
+    if (new_chunk) {
+      std::size_t capacity = kMinChunkCapacity;
+      if (!chunks_.empty()) {
+        capacity = chunks_.rbegin()->second.archive == nullptr
+                       ? 2 * chunks_.rbegin()->second.entries.capacity()
+                       : kMaxChunkCapacity;
+      }
+      while (capacity < remaining && capacity < kMaxChunkCapacity) {
+        capacity *= 2;
+      }
+      if (capacity > kMaxChunkCapacity) {
+        capacity = kMaxChunkCapacity;
+      }
+      chunks_.emplace_hint(chunks_.end(),
+                           std::piecewise_construct,
+                           std::forward_as_tuple(entries[appended].first),
+                           std::forward_as_tuple(capacity));
+    }
+    auto& chunk_entries = chunks_.rbegin()->second.entries;
+    std::size_t const count =
+        std::min(remaining, chunk_entries.capacity() - chunk_entries.size());
+    chunk_entries.insert(chunk_entries.end(),
+                         entries.begin() + appended,
+                         entries.begin() + appended + count);
+    appended += count;
+    size_ += count;
+    if (new_chunk) {
+      ArchiveOldChunks();
+    }
+  }
+}
+
+template<typename Value>
+void ChunkedTimeline<Value>::Splice(not_null<ChunkedTimeline*> const source,
+                                    Iterator const& end) {
+  DEBUG_CHECK(end.chunks_ == &source->chunks_);
+  if (end == source->begin()) {
+    return;
+  }
+  DEBUG_CHECK(chunks_.empty() ||
+              chunks_.rbegin()->second.data()[
+                  chunks_.rbegin()->second.size() - 1].first <
+                  source->begin()->first)
+      << "Splice out of order";
+  auto const end_chunk = end == source->end()
+                             ? source->chunks_.end()
+                             : source->chunks_.find(end.chunk_->first);
+  for (auto chunk = source->chunks_.begin(); chunk != end_chunk;) {
+    Chunk& source_chunk = chunk->second;
+    std::size_t const count = source_chunk.size() - source_chunk.begin;
+    // The key of the chunk must remain after the entries of this timeline.
+    if (chunks_.empty() ||
+        chunks_.rbegin()->second.data()[
+            chunks_.rbegin()->second.size() - 1].first < chunk->first) {
+      Chunk& moved = chunks_.emplace_hint(chunks_.end(),
+                                          std::piecewise_construct,
+                                          std::forward_as_tuple(chunk->first),
+                                          std::forward_as_tuple(0))->second;
+      moved.begin = source_chunk.begin;
+      moved.entries.swap(source_chunk.entries);
+      // The slot of an archived chunk is transferred with it.
+      std::swap(moved.archive, source_chunk.archive);
+      std::swap(moved.archived_entries, source_chunk.archived_entries);
+      std::swap(moved.archived_size, source_chunk.archived_size);
+      size_ += count;
+    } else {
+      AppendRange(std::vector<Entry>(
+          source_chunk.data() + source_chunk.begin,
+          source_chunk.data() + source_chunk.size()));
+    }
+    source->size_ -= count;
+    chunk = source->chunks_.erase(chunk);
+  }
+  if (end_chunk != source->chunks_.end() &&
+      end.index_ != end_chunk->second.begin) {
+    Chunk const& source_chunk = end_chunk->second;
+    AppendRange(std::vector<Entry>(source_chunk.data() + source_chunk.begin,
+                                   source_chunk.data() + end.index_));
+    source->ForgetBefore(end);
+  }
+  ArchiveOldChunks();
+}
+
+template<typename Value>
+void ChunkedTimeline<Value>::set_archive(not_null<Archive*> const archive,
+                                         Time const& horizon) {
+  CHECK(archive_ == nullptr) << "Timeline already archived";
+  archive_ = archive;
+  horizon_ = horizon;
+  ArchiveOldChunks();
+}
+
+template<typename Value>
+typename ChunkedTimeline<Value>::Iterator ChunkedTimeline<Value>::Find(
+    Instant const& time) const {
+  Iterator const it = LowerBound(time);
+  if (it != end() && it->first == time) {
+    return it;
+  } else {
+    return end();
+  }
+}
+
+template<typename Value>
+typename ChunkedTimeline<Value>::Iterator ChunkedTimeline<Value>::LowerBound(
+    Instant const& time) const {
+  // The last chunk whose key is at or before |time|.  The entries of the
+  // preceding chunks are all before |time|.
+  auto chunk = chunks_.upper_bound(time);
+  if (chunk == chunks_.begin()) {
+    return begin();
+  }
+  --chunk;
+  Entry const* const entries = chunk->second.data();
+  Entry const* const entries_end = entries + chunk->second.size();
+  Entry const* const entry = Search(entries + chunk->second.begin,
+                                    entries_end,
+                                    time,
+                                    false /*strictly_after*/);
+  if (entry == entries_end) {
+    // All the entries of this chunk are before |time|, the result is the first
+    // entry of the next chunk.
+    return FirstOf(++chunk);
+  } else {
+    return Iterator(&chunks_, chunk, entry - entries);
+  }
+}
+
+template<typename Value>
+typename ChunkedTimeline<Value>::Iterator ChunkedTimeline<Value>::LowerBound(
+    Iterator const& hint,
+    Instant const& time) const {
+  DEBUG_CHECK(hint.chunks_ == &chunks_);
+  if (hint == end() || time < hint->first) {
+    return LowerBound(time);
+  }
+  auto chunk = hint.chunk_;
+  Entry const* entry = chunk->second.data() + hint.index_;
+  for (int i = 0; i < 2; ++i) {
+    Entry const* const entries = chunk->second.data();
+    Entry const* const entries_end = entries + chunk->second.size();
+    if (!((entries_end - 1)->first < time)) {
+      // The result is in this chunk, usually a few entries after |entry|.
+      Entry const* const scan_end =
+          entries_end - entry > kHintScan ? entry + kHintScan : entries_end;
+      while (entry != scan_end && entry->first < time) {
+        ++entry;
+      }
+      if (entry == scan_end) {
+        entry = Search(entry, entries_end, time, false /*strictly_after*/);
+      }
+      return Iterator(&chunks_, chunk, entry - entries);
+    }
+    if (++chunk == chunks_.end()) {
+      return end();
+    }
+    entry = chunk->second.data() + chunk->second.begin;
+  }
+  return LowerBound(time);
+}
+
+template<typename Value>
+typename ChunkedTimeline<Value>::Iterator ChunkedTimeline<Value>::UpperBound(
+    Instant const& time) const {
+  auto chunk = chunks_.upper_bound(time);
+  if (chunk == chunks_.begin()) {
+    return begin();
+  }
+  --chunk;
+  Entry const* const entries = chunk->second.data();
+  Entry const* const entries_end = entries + chunk->second.size();
+  Entry const* const entry = Search(entries + chunk->second.begin,
+                                    entries_end,
+                                    time,
+                                    true /*strictly_after*/);
+  if (entry == entries_end) {
+    return FirstOf(++chunk);
+  } else {
+    return Iterator(&chunks_, chunk, entry - entries);
+  }
+}
+
+template<typename Value>
+void ChunkedTimeline<Value>::ForgetFrom(Iterator const& it) {
+  if (it == end()) {
+    return;
+  }
+  auto chunk = chunks_.find(it.chunk_->first);
+  for (auto next = std::next(chunk); next != chunks_.end(); ++next) {
+    size_ -= next->second.size() - next->second.begin;
+  }
+  chunks_.erase(std::next(chunk), chunks_.end());
+  size_ -= chunk->second.size() - it.index_;
+  if (it.index_ == chunk->second.begin) {
+    chunks_.erase(chunk);
+  } else if (chunk->second.archive == nullptr) {
+    // Shrinking does not reallocate, so the capacity is retained.
+    auto& entries = chunk->second.entries;
+    entries.erase(entries.begin() + it.index_, entries.end());
+  } else {
+    chunk->second.archived_size = it.index_;
+  }
+}
+
+template<typename Value>
+void ChunkedTimeline<Value>::ForgetBefore(Iterator const& it) {
+  if (it == end()) {
+    chunks_.clear();
+    size_ = 0;
+    return;
+  }
+  auto const chunk = chunks_.find(it.chunk_->first);
+  // Erasing the archived chunks releases their slots.
+  for (auto previous = chunks_.begin(); previous != chunk; ++previous) {
+    size_ -= previous->second.size() - previous->second.begin;
+  }
+  chunks_.erase(chunks_.begin(), chunk);
+  size_ -= it.index_ - chunk->second.begin;
+  chunk->second.begin = it.index_;
+}
+
+template<typename Value>
+template<typename Predicate>
+void ChunkedTimeline<Value>::ForgetIf(Iterator const& first,
+                                      Iterator const& last,
+                                      Predicate forget) {
+  if (first == last) {
+    return;
+  }
+  // The chunks from |first_chunk| (included) to |last_chunk| (excluded) are
+  // rebuilt from the entries that remain.
+  auto const first_chunk = chunks_.find(first.chunk_->first);
+  auto const last_chunk = last == end()
+                              ? chunks_.end()
+                              : std::next(chunks_.find(last.chunk_->first));
+  std::vector<Entry> kept;
+  bool in_range = false;
+  for (auto chunk = first_chunk; chunk != last_chunk; ++chunk) {
+    Entry const* const entries = chunk->second.data();
+    for (std::size_t i = chunk->second.begin; i < chunk->second.size(); ++i) {
+      Iterator const it(&chunks_, chunk, i);
+      if (it == first) {
+        in_range = true;
+      } else if (it == last) {
+        in_range = false;
+      }
+      if (in_range && forget(entries[i])) {
+        --size_;
+      } else {
+        kept.push_back(entries[i]);
+      }
+    }
+  }
+  chunks_.erase(first_chunk, last_chunk);
+  for (std::size_t i = 0; i < kept.size(); i += kMaxChunkCapacity) {
+    std::size_t const capacity = kept.size() - i < kMaxChunkCapacity
+                                     ? kept.size() - i
+                                     : kMaxChunkCapacity;
+    auto const chunk =
+        chunks_.emplace_hint(last_chunk,
+                             std::piecewise_construct,
+                             std::forward_as_tuple(kept[i].first),
+                             std::forward_as_tuple(capacity));
+    chunk->second.entries.insert(chunk->second.entries.end(),
+                                 kept.begin() + i,
+                                 kept.begin() + i + capacity);
+  }
+}
+
+template<typename Value>
+typename ChunkedTimeline<Value>::Entry const* ChunkedTimeline<Value>::Search(
+    Entry const* const first,
+    Entry const* const last,
+    Instant const& time,
+    bool const strictly_after) {
+  // True if |entry| comes before the result.
+  auto const precedes = [&time, strictly_after](Entry const& entry) {
+    return strictly_after ? !(time < entry.first) : entry.first < time;
+  };
+  std::ptrdiff_t const size = last - first;
+  if (size == 0 || !precedes(*first)) {
+    return first;
+  }
+  if (precedes(*(last - 1))) {
+    return last;
+  }
+  // The result is in ]first, last - 1].  If the entries were equally spaced
+  // it would be at |index| or, because of rounding, next to it.
+  double const fraction = (time - first->first) /
+                          ((last - 1)->first - first->first);
+  std::ptrdiff_t index = static_cast<std::ptrdiff_t>(
+      std::ceil(fraction * static_cast<double>(size - 1)));
+  index = std::min(std::max(index, std::ptrdiff_t(1)), size - 1);
+  if (precedes(first[index])) {
+    ++index;
+  } else if (!precedes(first[index - 1])) {
+    --index;
+  }
+  if (index >= 1 && index <= size - 1 &&
+      precedes(first[index - 1]) && !precedes(first[index])) {
+    return first + index;
+  }
+  // Not equally spaced.
+  if (strictly_after) {
+    return std::upper_bound(first,
+                            last,
+                            time,
+                            [](Instant const& time, Entry const& entry) {
+                              return time < entry.first;
+                            });
+  } else {
+    return std::lower_bound(first,
+                            last,
+                            time,
+                            [](Entry const& entry, Instant const& time) {
+                              return entry.first < time;
+                            });
+  }
+}
+
+template<typename Value>
+typename ChunkedTimeline<Value>::Iterator ChunkedTimeline<Value>::FirstOf(
+    typename Chunks::const_iterator const chunk) const {
+  if (chunk == chunks_.end()) {
+    return end();
+  } else {
+    return Iterator(&chunks_, chunk, chunk->second.begin);
+  }
+}
+
+template<typename Value>
+void ChunkedTimeline<Value>::ArchiveOldChunks() {
+  if (archive_ == nullptr || chunks_.empty()) {
+    return;
+  }
+  auto const last_chunk = std::prev(chunks_.end());
+  Instant const& last_time =
+      last_chunk->second.data()[last_chunk->second.size() - 1].first;
+  for (auto chunk = chunks_.begin(); chunk != last_chunk; ++chunk) {
+    Chunk& c = chunk->second;
+    if (c.archive != nullptr) {
+      continue;
+    }
+    // The chunks are in time order, so the next ones are more recent.
+    if (last_time - c.entries.back().first <= horizon_) {
+      return;
+    }
+    Entry* const slot = archive_->Allocate();
+    if (slot == nullptr) {
+      LOG_FIRST_N(WARNING, 1) << "Timeline archive full";
+      return;
+    }
+    std::uninitialized_copy(c.entries.begin(), c.entries.end(), slot);
+    c.archive = archive_;
+    c.archived_entries = slot;
+    c.archived_size = c.entries.size();
+    // Releases the memory.
+    decltype(c.entries)().swap(c.entries);
+  }
+}
+
+}  // namespace physics
+}  // namespace principia
@@ -0,0 +1,338 @@
+﻿#include "physics/chunked_timeline.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "quantities/si.hpp"
+#include "testing_utilities/temporary_file.hpp"
+
+using principia::si::Second;
+using principia::testing_utilities::TemporaryFilename;
+using testing::Eq;
+
+namespace principia {
+namespace physics {
+
+class ChunkedTimelineTest : public testing::Test {
+ protected:
+  // Appends the entries (i s, i) for i in [first, last[.
+  void Append(int const first, int const last) {
+    for (int i = first; i < last; ++i) {
+      timeline_.Append(Time(i), i);
+    }
+  }
+
+  static Instant Time(int const i) {
+    return Instant() + i * Second;
+  }
+
+  // Removes the archive if the test didn't.
+  void TearDown() override {
+    std::remove(archive_filename_.c_str());
+  }
+
+  // The number of entries is chosen so that there are several chunks of the
+  // largest capacity.
+  int const length_ = 5000;
+  std::string const archive_filename_ = TemporaryFilename("archive.bin");
+  ChunkedTimeline<int> timeline_;
+};
+
+TEST_F(ChunkedTimelineTest, Empty) {
+  EXPECT_TRUE(timeline_.empty());
+  EXPECT_THAT(timeline_.size(), Eq(0));
+  EXPECT_TRUE(timeline_.begin() == timeline_.end());
+  EXPECT_TRUE(timeline_.Find(Time(0)) == timeline_.end());
+  EXPECT_TRUE(timeline_.LowerBound(Time(0)) == timeline_.end());
+  EXPECT_TRUE(timeline_.UpperBound(Time(0)) == timeline_.end());
+}
+
+TEST_F(ChunkedTimelineTest, Iteration) {
+  Append(0, length_);
+  EXPECT_FALSE(timeline_.empty());
+  EXPECT_THAT(timeline_.size(), Eq(length_));
+  EXPECT_THAT(std::distance(timeline_.begin(), timeline_.end()), Eq(length_));
+  int i = 0;
+  for (auto const& entry : timeline_) {
+    EXPECT_THAT(entry.first, Eq(Time(i)));
+    EXPECT_THAT(entry.second, Eq(i));
+    ++i;
+  }
+  auto it = timeline_.end();
+  for (int j = length_ - 1; j >= 0; --j) {
+    --it;
+    EXPECT_THAT(it->second, Eq(j));
+  }
+  EXPECT_TRUE(it == timeline_.begin());
+}
+
+TEST_F(ChunkedTimelineTest, AppendRange) {
+  Append(0, 5);
+  // Several batches, some spanning several chunks.
+  for (int first = 5; first < length_; first += 1500) {
+    std::vector<ChunkedTimeline<int>::Entry> entries;
+    for (int i = first; i < std::min(first + 1500, length_); ++i) {
+      entries.emplace_back(Time(i), i);
+    }
+    timeline_.AppendRange(entries);
+  }
+  timeline_.AppendRange({});
+  EXPECT_THAT(timeline_.size(), Eq(length_));
+  int i = 0;
+  for (auto const& entry : timeline_) {
+    EXPECT_THAT(entry.first, Eq(Time(i)));
+    EXPECT_THAT(entry.second, Eq(i));
+    ++i;
+  }
+  EXPECT_THAT(i, Eq(length_));
+  EXPECT_THAT(timeline_.Find(Time(2000))->second, Eq(2000));
+  EXPECT_THAT(timeline_.UpperBound(Time(length_ - 2))->second,
+              Eq(length_ - 1));
+  // The batches don't use more memory than appending one entry at a time.
+  ChunkedTimeline<int> reference;
+  for (int j = 0; j < length_; ++j) {
+    reference.Append(Time(j), j);
+  }
+  EXPECT_LE(timeline_.MemoryUsage(), reference.MemoryUsage());
+}
+
+TEST_F(ChunkedTimelineTest, Search) {
+  // Only the even times.
+  for (int i = 0; i < length_; ++i) {
+    timeline_.Append(Time(2 * i), 2 * i);
+  }
+  EXPECT_TRUE(timeline_.LowerBound(Time(-1)) == timeline_.begin());
+  EXPECT_TRUE(timeline_.UpperBound(Time(-1)) == timeline_.begin());
+  for (int i = 0; i < 2 * length_ - 2; ++i) {
+    int const upper = i % 2 == 0 ? i + 2 : i + 1;
+    int const lower = i % 2 == 0 ? i : i + 1;
+    EXPECT_THAT(timeline_.LowerBound(Time(i))->second, Eq(lower)) << i;
+    EXPECT_THAT(timeline_.UpperBound(Time(i))->second, Eq(upper)) << i;
+    if (i % 2 == 0) {
+      EXPECT_THAT(timeline_.Find(Time(i))->second, Eq(i)) << i;
+    } else {
+      EXPECT_TRUE(timeline_.Find(Time(i)) == timeline_.end()) << i;
+    }
+  }
+  EXPECT_TRUE(timeline_.UpperBound(Time(2 * length_ - 2)) == timeline_.end());
+  EXPECT_TRUE(timeline_.LowerBound(Time(2 * length_ - 1)) == timeline_.end());
+}
+
+// Same as above, but with unequally spaced entries, and with equally spaced
+// entries whose times are rounded, so that the estimates of the positions are
+// off.
+TEST_F(ChunkedTimelineTest, SearchUnequallySpaced) {
+  // The squares.
+  for (int i = 0; i < 100; ++i) {
+    timeline_.Append(Time(i * i), i * i);
+  }
+  for (int i = 0; i < 99 * 99; ++i) {
+    int const root = static_cast<int>(std::ceil(std::sqrt(i)));
+    int const lower = root * root;
+    int const upper = lower == i ? (root + 1) * (root + 1) : lower;
+    EXPECT_THAT(timeline_.LowerBound(Time(i))->second, Eq(lower)) << i;
+    EXPECT_THAT(timeline_.UpperBound(Time(i))->second, Eq(upper)) << i;
+  }
+
+  ChunkedTimeline<int> rounded;
+  Instant t;
+  std::vector<Instant> times;
+  for (int i = 0; i < length_; ++i) {
+    rounded.Append(t, i);
+    times.push_back(t);
+    t += 0.1 * Second;
+  }
+  for (int i = 0; i < length_; ++i) {
+    EXPECT_THAT(rounded.Find(times[i])->second, Eq(i)) << i;
+    EXPECT_THAT(rounded.LowerBound(times[i])->second, Eq(i)) << i;
+    if (i < length_ - 1) {
+      EXPECT_THAT(rounded.UpperBound(times[i])->second, Eq(i + 1)) << i;
+    }
+  }
+}
+
+// The lookups from a hint give the same results as those without, whether the
+// hint is before, at or after the result, in the same chunk or not.
+TEST_F(ChunkedTimelineTest, LowerBoundWithHint) {
+  // The squares, so that the scan from the hint is sometimes too short.
+  for (int i = 0; i < 100; ++i) {
+    timeline_.Append(Time(i * i), i * i);
+  }
+  auto hint = timeline_.begin();
+  for (int i = 0; i < 99 * 99 + 10; i += 7) {
+    auto const expected = timeline_.LowerBound(Time(i));
+    hint = timeline_.LowerBound(hint, Time(i));
+    EXPECT_TRUE(hint == expected) << i;
+  }
+  EXPECT_TRUE(hint == timeline_.end());
+  // Backwards, and from the end.
+  EXPECT_THAT(timeline_.LowerBound(hint, Time(50))->second, Eq(64));
+  hint = timeline_.Find(Time(81 * 81));
+  EXPECT_THAT(timeline_.LowerBound(hint, Time(10))->second, Eq(16));
+  // Far ahead.
+  hint = timeline_.begin();
+  EXPECT_THAT(timeline_.LowerBound(hint, Time(9000))->second, Eq(95 * 95));
+}
+
+TEST_F(ChunkedTimelineTest, Splice) {
+  Append(0, 10);
+  ChunkedTimeline<int> source;
+  for (int i = 10; i < length_; ++i) {
+    source.Append(Time(i), i);
+  }
+  auto const kept = source.Find(Time(4000));
+  ChunkedTimeline<int>::Entry const* const moved = &*source.Find(Time(100));
+  timeline_.Splice(&source, source.Find(Time(3000)));
+  EXPECT_THAT(timeline_.size(), Eq(3000));
+  EXPECT_THAT(source.size(), Eq(length_ - 3000));
+  EXPECT_THAT(source.begin()->second, Eq(3000));
+  EXPECT_THAT(kept->second, Eq(4000));
+  // The entries of the complete chunks are not copied.
+  EXPECT_THAT(&*timeline_.Find(Time(100)), Eq(moved));
+  EXPECT_THAT(timeline_.Find(Time(2999))->second, Eq(2999));
+  EXPECT_TRUE(timeline_.Find(Time(3000)) == timeline_.end());
+  Append(3000, 3010);
+  int i = 0;
+  for (auto const& entry : timeline_) {
+    EXPECT_THAT(entry.first, Eq(Time(i)));
+    EXPECT_THAT(entry.second, Eq(i));
+    ++i;
+  }
+  EXPECT_THAT(i, Eq(3010));
+
+  // Splicing the rest of a timeline after a gap.
+  timeline_.ForgetFrom(timeline_.Find(Time(3000)));
+  source.ForgetBefore(source.Find(Time(3500)));
+  timeline_.Splice(&source, source.end());
+  EXPECT_TRUE(source.empty());
+  EXPECT_THAT(timeline_.size(), Eq(3000 + length_ - 3500));
+  EXPECT_THAT(timeline_.LowerBound(Time(3000))->second, Eq(3500));
+  EXPECT_THAT((--timeline_.end())->second, Eq(length_ - 1));
+  EXPECT_THAT(std::distance(timeline_.begin(), timeline_.end()),
+              Eq(3000 + length_ - 3500));
+}
+
+TEST_F(ChunkedTimelineTest, ForgetFrom) {
+  Append(0, length_);
+  auto const kept = timeline_.Find(Time(1000));
+  timeline_.ForgetFrom(timeline_.Find(Time(3000)));
+  EXPECT_THAT(timeline_.size(), Eq(3000));
+  EXPECT_THAT((--timeline_.end())->second, Eq(2999));
+  EXPECT_THAT(kept->second, Eq(1000));
+  // Forgetting the first entry of a chunk and appending again.
+  timeline_.ForgetFrom(timeline_.Find(Time(8)));
+  EXPECT_THAT(timeline_.size(), Eq(8));
+  Append(8, length_);
+  EXPECT_THAT(timeline_.size(), Eq(length_));
+  EXPECT_THAT(std::distance(timeline_.begin(), timeline_.end()), Eq(length_));
+  EXPECT_THAT(timeline_.Find(Time(4321))->second, Eq(4321));
+  timeline_.ForgetFrom(timeline_.begin());
+  EXPECT_TRUE(timeline_.empty());
+  EXPECT_THAT(timeline_.size(), Eq(0));
+}
+
+TEST_F(ChunkedTimelineTest, ForgetBefore) {
+  Append(0, length_);
+  auto const kept = timeline_.Find(Time(4000));
+  auto const end = timeline_.end();
+  timeline_.ForgetBefore(timeline_.Find(Time(1234)));
+  EXPECT_THAT(timeline_.size(), Eq(length_ - 1234));
+  EXPECT_THAT(timeline_.begin()->second, Eq(1234));
+  EXPECT_THAT(kept->second, Eq(4000));
+  EXPECT_TRUE(timeline_.LowerBound(Time(0)) == timeline_.begin());
+  EXPECT_TRUE(timeline_.Find(Time(1233)) == timeline_.end());
+  Append(length_, 2 * length_);
+  EXPECT_THAT(timeline_.size(), Eq(2 * length_ - 1234));
+  EXPECT_TRUE(end == timeline_.end());
+  int i = 1234;
+  for (auto const& entry : timeline_) {
+    EXPECT_THAT(entry.second, Eq(i));
+    ++i;
+  }
+  EXPECT_THAT(i, Eq(2 * length_));
+  timeline_.ForgetBefore(timeline_.end());
+  EXPECT_TRUE(timeline_.empty());
+}
+
+TEST_F(ChunkedTimelineTest, ForgetIf) {
+  Append(0, length_);
+  timeline_.ForgetIf(timeline_.Find(Time(1000)),
+                     timeline_.Find(Time(4001)),
+                     [](std::pair<Instant, int> const& entry) {
+                       return entry.second % 2 == 1;
+                     });
+  EXPECT_THAT(timeline_.size(), Eq(length_ - 1500));
+  EXPECT_THAT(std::distance(timeline_.begin(), timeline_.end()),
+              Eq(length_ - 1500));
+  EXPECT_THAT(timeline_.UpperBound(Time(1000))->second, Eq(1002));
+  EXPECT_THAT(timeline_.LowerBound(Time(3999))->second, Eq(4000));
+  EXPECT_THAT(timeline_.Find(Time(999))->second, Eq(999));
+  EXPECT_THAT(timeline_.Find(Time(4001))->second, Eq(4001));
+  EXPECT_TRUE(timeline_.Find(Time(2001)) == timeline_.end());
+  Append(length_, length_ + 10);
+  EXPECT_THAT((--timeline_.end())->second, Eq(length_ + 9));
+  int previous = -1;
+  for (auto const& entry : timeline_) {
+    EXPECT_THAT(entry.first, Eq(Time(entry.second)));
+    EXPECT_LT(previous, entry.second);
+    previous = entry.second;
+  }
+}
+
+TEST_F(ChunkedTimelineTest, Archive) {
+  ChunkedTimeline<int>::Archive archive(archive_filename_,
+                                        /*number_of_slots=*/10);
+  EXPECT_THAT(archive.number_of_slots(), Eq(10));
+  timeline_.set_archive(&archive, /*horizon=*/2000 * Second);
+  Append(0, length_);
+  // The chunks end at 7, 23, 55, 119, 247, 503, 1015, 2039, 3063, 4087 and
+  // 4999.  Those that end more than 2000 s before 4088, when the last chunk
+  // was created, are archived.
+  EXPECT_THAT(archive.number_of_free_slots(), Eq(2));
+  EXPECT_THAT(timeline_.size(), Eq(length_));
+  int i = 0;
+  for (auto const& entry : timeline_) {
+    EXPECT_THAT(entry.first, Eq(Time(i)));
+    EXPECT_THAT(entry.second, Eq(i));
+    ++i;
+  }
+  EXPECT_THAT(timeline_.Find(Time(1234))->second, Eq(1234));
+  EXPECT_THAT(timeline_.UpperBound(Time(2039))->second, Eq(2040));
+  EXPECT_THAT((--timeline_.Find(Time(2040)))->second, Eq(2039));
+
+  // Forgetting releases the slots.
+  timeline_.ForgetBefore(timeline_.Find(Time(1234)));
+  EXPECT_THAT(archive.number_of_free_slots(), Eq(9));
+  EXPECT_THAT(timeline_.begin()->second, Eq(1234));
+
+  // Appending after an archived chunk.
+  timeline_.ForgetFrom(timeline_.Find(Time(1500)));
+  EXPECT_THAT(timeline_.size(), Eq(1500 - 1234));
+  EXPECT_THAT(archive.number_of_free_slots(), Eq(9));
+  Append(1500, 2 * length_);
+  EXPECT_THAT(timeline_.size(), Eq(2 * length_ - 1234));
+  i = 1234;
+  for (auto const& entry : timeline_) {
+    EXPECT_THAT(entry.second, Eq(i));
+    ++i;
+  }
+  EXPECT_THAT(i, Eq(2 * length_));
+  EXPECT_THAT(archive.number_of_free_slots(), Eq(3));
+
+  // The archive is full, the chunks remain in memory.
+  Append(2 * length_, 4 * length_);
+  EXPECT_THAT(archive.number_of_free_slots(), Eq(0));
+  EXPECT_THAT(timeline_.Find(Time(4 * length_ - 1))->second,
+              Eq(4 * length_ - 1));
+  timeline_.ForgetBefore(timeline_.end());
+  EXPECT_THAT(archive.number_of_free_slots(), Eq(10));
+}
+
+}  // namespace physics
+}  // namespace principia
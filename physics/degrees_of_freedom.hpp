@@ -1,13 +1,16 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 
+#include "base/not_null.hpp"
 #include "geometry/grassmann.hpp"
 #include "geometry/named_quantities.hpp"
 #include "geometry/pair.hpp"
 #include "geometry/point.hpp"
 #include "quantities/named_quantities.hpp"
 
+using principia::base::not_null;
 using principia::geometry::Displacement;
 using principia::geometry::Pair;
 using principia::geometry::Position;
@@ -63,6 +66,25 @@ DegreesOfFreedom<Frame> Barycentre(
     std::vector<DegreesOfFreedom<Frame>> const& degrees_of_freedom,
     std::vector<Weight> const& weights);
 
+// Computes in a single pass over |degrees_of_freedom| and |weights|, which
+// must have the same size, the barycentres of consecutive groups of elements
+// and the barycentre of all of them, which is returned.  The group g is made of
+// the elements with indices in [group_ends[g - 1], group_ends[g][, with
+// group_ends[-1] = 0; the groups must not be empty, and the last one must end
+// at the size of |degrees_of_freedom|.  Fills |*group_barycentres| and
+// |*group_weights| with the barycentre and the total weight of each group.
+// The sums are taken relative to the first position with compensated
+// summation, in arrays of doubles so that the components are accumulated
+// together, and the barycentre of all the elements is computed from those of
+// the groups without going over the elements again.
+template<typename Frame, typename Weight>
+DegreesOfFreedom<Frame> GroupBarycentres(
+    std::vector<DegreesOfFreedom<Frame>> const& degrees_of_freedom,
+    std::vector<Weight> const& weights,
+    std::vector<std::size_t> const& group_ends,
+    not_null<std::vector<DegreesOfFreedom<Frame>>*> const group_barycentres,
+    not_null<std::vector<Weight>*> const group_weights);
+
 template<typename Frame>
 std::ostream& operator<<(std::ostream& out,
                          DegreesOfFreedom<Frame> const& degrees_of_freedom);
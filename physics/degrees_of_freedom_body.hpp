@@ -3,10 +3,53 @@
 #include <vector>
 
 #include "physics/degrees_of_freedom.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::geometry::R3Element;
+using principia::quantities::Length;
+using principia::quantities::SIUnit;
+using principia::quantities::Speed;
 
 namespace principia {
 namespace physics {
 
+namespace {
+
+// The number of components accumulated by |GroupBarycentres|: the weighted
+// displacement, the weighted velocity and the weight.
+int const kBarycentreComponents = 7;
+
+// Adds |terms| to |sums| with Kahan's compensated summation, the errors being
+// accumulated in |compensations|.  The components are independent, so the
+// loop may be vectorized.
+inline void CompensatedAdd(double const* const terms,
+                           double* const sums,
+                           double* const compensations) {
+  for (int k = 0; k < kBarycentreComponents; ++k) {
+    double const corrected_term = terms[k] - compensations[k];
+    double const sum = sums[k] + corrected_term;
+    compensations[k] = (sum - sums[k]) - corrected_term;
+    sums[k] = sum;
+  }
+}
+
+// Returns the barycentre whose weighted displacement from |reference|,
+// weighted velocity and weight are given by the |sums|.
+template<typename Frame>
+DegreesOfFreedom<Frame> BarycentreFromSums(Position<Frame> const& reference,
+                                           double const* const sums) {
+  double const weight = sums[6];
+  return DegreesOfFreedom<Frame>(
+      reference + Displacement<Frame>({sums[0] / weight * SIUnit<Length>(),
+                                       sums[1] / weight * SIUnit<Length>(),
+                                       sums[2] / weight * SIUnit<Length>()}),
+      Velocity<Frame>({sums[3] / weight * SIUnit<Speed>(),
+                       sums[4] / weight * SIUnit<Speed>(),
+                       sums[5] / weight * SIUnit<Speed>()}));
+}
+
+}  // namespace
+
 template<typename Frame>
 DegreesOfFreedom<Frame>::DegreesOfFreedom(Position<Frame> const& position,
                                           Velocity<Frame> const& velocity)
@@ -72,6 +115,60 @@ DegreesOfFreedom<Frame> Barycentre(
   CHECK(!degrees_of_freedom.empty());
 }
 
+template<typename Frame, typename Weight>
+DegreesOfFreedom<Frame> GroupBarycentres(
+    std::vector<DegreesOfFreedom<Frame>> const& degrees_of_freedom,
+    std::vector<Weight> const& weights,
+    std::vector<std::size_t> const& group_ends,
+    not_null<std::vector<DegreesOfFreedom<Frame>>*> const group_barycentres,
+    not_null<std::vector<Weight>*> const group_weights) {
+  CHECK_EQ(degrees_of_freedom.size(), weights.size())
+      << "Degrees of freedom and weights of unequal sizes";
+  CHECK(!group_ends.empty()) << "No groups";
+  CHECK_EQ(degrees_of_freedom.size(), group_ends.back());
+  Position<Frame> const reference = degrees_of_freedom.front().position();
+  group_barycentres->clear();
+  group_barycentres->reserve(group_ends.size());
+  group_weights->clear();
+  group_weights->reserve(group_ends.size());
+
+  double total_sums[kBarycentreComponents] = {};
+  double total_compensations[kBarycentreComponents] = {};
+  std::size_t begin = 0;
+  for (std::size_t const end : group_ends) {
+    CHECK_LT(begin, end) << "Empty group";
+    double sums[kBarycentreComponents] = {};
+    double compensations[kBarycentreComponents] = {};
+    double terms[kBarycentreComponents];
+    for (std::size_t i = begin; i < end; ++i) {
+      R3Element<Length> const displacement =
+          (degrees_of_freedom[i].position() - reference).coordinates();
+      R3Element<Speed> const& velocity =
+          degrees_of_freedom[i].velocity().coordinates();
+      double const weight = weights[i] / SIUnit<Weight>();
+      terms[0] = weight * (displacement.x / SIUnit<Length>());
+      terms[1] = weight * (displacement.y / SIUnit<Length>());
+      terms[2] = weight * (displacement.z / SIUnit<Length>());
+      terms[3] = weight * (velocity.x / SIUnit<Speed>());
+      terms[4] = weight * (velocity.y / SIUnit<Speed>());
+      terms[5] = weight * (velocity.z / SIUnit<Speed>());
+      terms[6] = weight;
+      CompensatedAdd(terms, sums, compensations);
+    }
+    for (int k = 0; k < kBarycentreComponents; ++k) {
+      sums[k] -= compensations[k];
+    }
+    CompensatedAdd(sums, total_sums, total_compensations);
+    group_barycentres->push_back(BarycentreFromSums(reference, sums));
+    group_weights->push_back(sums[6] * SIUnit<Weight>());
+    begin = end;
+  }
+  for (int k = 0; k < kBarycentreComponents; ++k) {
+    total_sums[k] -= total_compensations[k];
+  }
+  return BarycentreFromSums(reference, total_sums);
+}
+
 template<typename Frame>
 std::ostream& operator<<(std::ostream& out,
                          DegreesOfFreedom<Frame> const& degrees_of_freedom) {
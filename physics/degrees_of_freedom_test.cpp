@@ -7,6 +7,7 @@
 #include "gtest/gtest.h"
 #include "quantities/named_quantities.hpp"
 #include "quantities/quantities.hpp"
+#include "testing_utilities/almost_equals.hpp"
 #include "testing_utilities/componentwise.hpp"
 
 using principia::geometry::Displacement;
@@ -16,7 +17,9 @@ using principia::quantities::Entropy;
 using principia::quantities::Length;
 using principia::quantities::Speed;
 using principia::quantities::SIUnit;
+using principia::testing_utilities::AlmostEquals;
 using principia::testing_utilities::Componentwise;
+using testing::ElementsAre;
 using testing::Eq;
 
 namespace principia {
@@ -120,5 +123,62 @@ TEST_F(DegreesOfFreedomTest, BarycentreCalculator) {
                                       -50.0 * SIUnit<Speed>()}))));
 }
 
+TEST_F(DegreesOfFreedomTest, GroupBarycentres) {
+  std::vector<DegreesOfFreedom<World>> const degrees_of_freedom =
+      {d1_, d2_, d3_, d1_};
+  std::vector<double> const weights = {3, 4, 5, 2};
+  std::vector<DegreesOfFreedom<World>> group_barycentres;
+  std::vector<double> group_weights;
+  DegreesOfFreedom<World> const barycentre =
+      GroupBarycentres<World, double>(degrees_of_freedom,
+                                      weights,
+                                      {2, 4},
+                                      &group_barycentres,
+                                      &group_weights);
+  // The results differ from those of |Barycentre| by a few ulps, since the
+  // positions are taken relative to the first one.
+  auto const expect_almost_equal = [this](
+      DegreesOfFreedom<World> const& actual,
+      DegreesOfFreedom<World> const& expected) {
+    EXPECT_THAT(actual.position() - origin_,
+                AlmostEquals(expected.position() - origin_, 0, 4));
+    EXPECT_THAT(actual.velocity(), AlmostEquals(expected.velocity(), 0, 4));
+  };
+  EXPECT_THAT(group_weights, ElementsAre(7, 7));
+  ASSERT_THAT(group_barycentres.size(), Eq(2));
+  expect_almost_equal(group_barycentres[0],
+                      Barycentre<World, double>({d1_, d2_}, {3, 4}));
+  expect_almost_equal(group_barycentres[1],
+                      Barycentre<World, double>({d3_, d1_}, {5, 2}));
+  expect_almost_equal(barycentre,
+                      Barycentre<World, double>(degrees_of_freedom, weights));
+
+  // The sums are relative to the first position, so that the barycentre of
+  // nearby points far from the origin is exact.
+  Displacement<World> const far_away({1e10 * SIUnit<Length>(),
+                                      0 * SIUnit<Length>(),
+                                      0 * SIUnit<Length>()});
+  std::vector<DegreesOfFreedom<World>> far_degrees_of_freedom;
+  std::vector<double> far_weights;
+  for (int i = 0; i < 1000; ++i) {
+    far_degrees_of_freedom.emplace_back(
+        origin_ + far_away + Displacement<World>({(i % 2) * SIUnit<Length>(),
+                                                  0 * SIUnit<Length>(),
+                                                  0 * SIUnit<Length>()}),
+        Velocity<World>());
+    far_weights.push_back(0.1);
+  }
+  DegreesOfFreedom<World> const far_barycentre =
+      GroupBarycentres<World, double>(far_degrees_of_freedom,
+                                      far_weights,
+                                      {1000},
+                                      &group_barycentres,
+                                      &group_weights);
+  EXPECT_THAT(far_barycentre.position() - origin_ - far_away,
+              Eq(Displacement<World>({0.5 * SIUnit<Length>(),
+                                      0 * SIUnit<Length>(),
+                                      0 * SIUnit<Length>()})));
+}
+
 }  // namespace physics
 }  // namespace principia
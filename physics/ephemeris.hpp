@@ -0,0 +1,108 @@
+﻿#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "base/not_null.hpp"
+#include "geometry/named_quantities.hpp"
+#include "integrators/symplectic_integrator.hpp"
+#include "physics/chebyshev_series.hpp"
+#include "physics/massive_body.hpp"
+#include "physics/n_body_system.hpp"
+#include "physics/trajectory.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::base::make_not_null_unique;
+using principia::base::not_null;
+using principia::geometry::Displacement;
+using principia::geometry::Instant;
+using principia::geometry::Position;
+using principia::geometry::Velocity;
+using principia::integrators::SymplecticIntegrator;
+using principia::quantities::Length;
+using principia::quantities::Speed;
+using principia::quantities::Time;
+
+namespace principia {
+namespace physics {
+
+// The motion of a set of massive bodies, integrated once and stored as
+// piecewise Chebyshev series.  Since the massive bodies are not affected by the
+// massless ones, the latter may then be integrated in the field of the former
+// (see |NBodySystem::IntegrateMasslessBodies|) without integrating the massive
+// bodies again.  The ephemeris is prolonged lazily, as later times are needed.
+template<typename Frame>
+class Ephemeris {
+ public:
+  using Trajectories = typename NBodySystem<Frame>::Trajectories;
+  using ReadonlyTrajectories = std::vector<not_null<Trajectory<Frame> const*>>;
+
+  // The last points of the |trajectories|, which must all be at the same time
+  // and for distinct massive bodies, are the initial state of the ephemeris.
+  // The |trajectories| are not retained, but their bodies must outlive this
+  // object, as must the |integrator|, which must already have been
+  // initialized.  The massive bodies are integrated with the step |Δt|, and
+  // each Chebyshev series, of degree |degree|, is fitted to the positions and
+  // velocities at |steps_per_series| + 1 consecutive steps.
+  Ephemeris(Trajectories const& trajectories,
+            SymplecticIntegrator<Length, Speed> const& integrator,
+            Time const& Δt,
+            int const steps_per_series,
+            int const degree);
+
+  // The interval covered by the ephemeris.
+  Instant const& t_min() const;
+  Instant const& t_max() const;
+
+  // Integrates the massive bodies, if needed, so that the ephemeris covers
+  // |t|.
+  void Prolong(Instant const& t);
+
+  // The massive bodies, oblate bodies first.  The indices used below are
+  // indices in this vector.
+  std::vector<not_null<MassiveBody const*>> const& bodies() const;
+  std::size_t number_of_bodies() const;
+
+  // |t| must be in [t_min(), t_max()].
+  Position<Frame> EvaluatePosition(std::size_t const index,
+                                   Instant const& t) const;
+  Velocity<Frame> EvaluateVelocity(std::size_t const index,
+                                   Instant const& t) const;
+
+  // The trajectories of the oblate and spherical bodies, in the order of
+  // |bodies()|.  They only hold the last state of the integration.
+  ReadonlyTrajectories const& massive_oblate_trajectories() const;
+  ReadonlyTrajectories const& massive_spherical_trajectories() const;
+
+ private:
+  // The series covering |t|.
+  ChebyshevSeries<Displacement<Frame>> const& FindSeries(
+      std::size_t const index,
+      Instant const& t) const;
+
+  SymplecticIntegrator<Length, Speed> const& integrator_;
+  Time const Δt_;
+  int const steps_per_series_;
+  int const degree_;
+  NBodySystem<Frame> n_body_system_;
+
+  std::vector<not_null<MassiveBody const*>> bodies_;
+  std::vector<not_null<std::unique_ptr<Trajectory<Frame>>>> trajectories_;
+  ReadonlyTrajectories massive_oblate_trajectories_;
+  ReadonlyTrajectories massive_spherical_trajectories_;
+
+  Instant t_min_;
+  // The series for successive intervals, indexed by interval, then by body.
+  // The interval |i| ends at |series_t_max_[i]|, and starts at the end of the
+  // previous interval or at |t_min_|.
+  std::vector<Instant> series_t_max_;
+  std::vector<std::vector<ChebyshevSeries<Displacement<Frame>>>> series_;
+
+  template<typename F>
+  friend class EphemerisFile;
+};
+
+}  // namespace physics
+}  // namespace principia
+
+#include "physics/ephemeris_body.hpp"
@@ -0,0 +1,158 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace physics {
+
+template<typename Frame>
+Ephemeris<Frame>::Ephemeris(
+    Trajectories const& trajectories,
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    Time const& Δt,
+    int const steps_per_series,
+    int const degree)
+    : integrator_(integrator),
+      Δt_(Δt),
+      steps_per_series_(steps_per_series),
+      degree_(degree) {
+  CHECK(!trajectories.empty());
+  CHECK_LT(Time(), Δt_);
+  CHECK_LE(1, steps_per_series_);
+  CHECK_LE(static_cast<std::size_t>(degree_ + 1),
+           2 * static_cast<std::size_t>(steps_per_series_ + 1));
+  std::set<not_null<Body const*>> bodies;
+  t_min_ = trajectories.front()->last().time();
+  // The oblate bodies come first, as in the state vectors of |NBodySystem|.
+  for (bool is_oblate : {true, false}) {
+    for (auto const& trajectory : trajectories) {
+      not_null<Body const*> const body = trajectory->template body<Body>();
+      CHECK(!body->is_massless()) << "Massless body in an ephemeris";
+      if (body->is_oblate() != is_oblate) {
+        continue;
+      }
+      CHECK(bodies.insert(body).second)
+          << "Multiple trajectories for the same body";
+      CHECK_EQ(t_min_, trajectory->last().time())
+          << "Inconsistent last time in trajectories";
+      not_null<MassiveBody const*> const massive_body =
+          trajectory->template body<MassiveBody>();
+      bodies_.push_back(massive_body);
+      trajectories_.push_back(
+          make_not_null_unique<Trajectory<Frame>>(massive_body));
+      trajectories_.back()->Append(trajectory->last().time(),
+                                   trajectory->last().degrees_of_freedom());
+      if (is_oblate) {
+        massive_oblate_trajectories_.push_back(trajectories_.back().get());
+      } else {
+        massive_spherical_trajectories_.push_back(trajectories_.back().get());
+      }
+    }
+  }
+}
+
+template<typename Frame>
+Instant const& Ephemeris<Frame>::t_min() const {
+  return t_min_;
+}
+
+template<typename Frame>
+Instant const& Ephemeris<Frame>::t_max() const {
+  return series_t_max_.empty() ? t_min_ : series_t_max_.back();
+}
+
+template<typename Frame>
+void Ephemeris<Frame>::Prolong(Instant const& t) {
+  Trajectories trajectories;
+  for (auto const& trajectory : trajectories_) {
+    trajectories.push_back(trajectory.get());
+  }
+  std::vector<Instant> times;
+  std::vector<Displacement<Frame>> positions;
+  std::vector<Velocity<Frame>> velocities;
+  // There must be at least one interval for the evaluation at |t_min_|.
+  while (series_.empty() || t_max() < t) {
+    n_body_system_.Integrate(integrator_,
+                             t_max() + steps_per_series_ * Δt_,  // tmax
+                             Δt_,
+                             1,     // sampling_period
+                             true,  // tmax_is_exact
+                             trajectories);
+    series_.emplace_back();
+    for (auto const& trajectory : trajectories_) {
+      times.clear();
+      positions.clear();
+      velocities.clear();
+      for (auto it = trajectory->first(); !it.at_end(); ++it) {
+        times.push_back(it.time());
+        positions.push_back(it.degrees_of_freedom().position() -
+                            Position<Frame>());
+        velocities.push_back(it.degrees_of_freedom().velocity());
+      }
+      CHECK_EQ(static_cast<std::size_t>(steps_per_series_ + 1), times.size());
+      series_.back().push_back(
+          ChebyshevSeries<Displacement<Frame>>::FitValuesAndDerivatives(
+              degree_, times, positions, velocities));
+      // Only keep the last point, which is the initial state of the next
+      // interval.
+      trajectory->ForgetBefore(times[times.size() - 2]);
+    }
+    series_t_max_.push_back(times.back());
+  }
+}
+
+template<typename Frame>
+std::vector<not_null<MassiveBody const*>> const&
+Ephemeris<Frame>::bodies() const {
+  return bodies_;
+}
+
+template<typename Frame>
+std::size_t Ephemeris<Frame>::number_of_bodies() const {
+  return bodies_.size();
+}
+
+template<typename Frame>
+Position<Frame> Ephemeris<Frame>::EvaluatePosition(std::size_t const index,
+                                                   Instant const& t) const {
+  return Position<Frame>() + FindSeries(index, t).Evaluate(t);
+}
+
+template<typename Frame>
+Velocity<Frame> Ephemeris<Frame>::EvaluateVelocity(std::size_t const index,
+                                                   Instant const& t) const {
+  return FindSeries(index, t).EvaluateDerivative(t);
+}
+
+template<typename Frame>
+typename Ephemeris<Frame>::ReadonlyTrajectories const&
+Ephemeris<Frame>::massive_oblate_trajectories() const {
+  return massive_oblate_trajectories_;
+}
+
+template<typename Frame>
+typename Ephemeris<Frame>::ReadonlyTrajectories const&
+Ephemeris<Frame>::massive_spherical_trajectories() const {
+  return massive_spherical_trajectories_;
+}
+
+template<typename Frame>
+ChebyshevSeries<Displacement<Frame>> const& Ephemeris<Frame>::FindSeries(
+    std::size_t const index,
+    Instant const& t) const {
+  CHECK_LT(index, bodies_.size());
+  CHECK_LE(t_min_, t);
+  CHECK_LE(t, t_max());
+  // The first interval whose end is at or after |t|.
+  std::size_t const interval =
+      std::lower_bound(series_t_max_.begin(), series_t_max_.end(), t) -
+      series_t_max_.begin();
+  return series_[interval][index];
+}
+
+}  // namespace physics
+}  // namespace principia
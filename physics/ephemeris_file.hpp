@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/mapped_file.hpp"
+#include "base/not_null.hpp"
+#include "geometry/grassmann.hpp"
+#include "geometry/named_quantities.hpp"
+#include "physics/chebyshev_series.hpp"
+#include "physics/ephemeris.hpp"
+#include "quantities/named_quantities.hpp"
+
+using principia::base::not_null;
+using principia::base::ReadOnlyMappedFile;
+using principia::geometry::Displacement;
+using principia::geometry::Instant;
+using principia::geometry::Position;
+using principia::geometry::Velocity;
+using principia::quantities::GravitationalParameter;
+
+namespace principia {
+namespace physics {
+
+// A precomputed ephemeris of a set of massive bodies, stored in a file as the
+// piecewise Chebyshev series of an |Ephemeris|.  The file is mapped in memory,
+// so opening it takes constant time whatever the interval it covers, and the
+// positions and velocities of the bodies are evaluated from the series without
+// any integration.  The bodies are identified by integers chosen by the writer,
+// and the file records their gravitational parameters, so that the reader may
+// check that it describes the expected system.  The file is in the native byte
+// order of the machine that wrote it.
+template<typename Frame>
+class EphemerisFile {
+ public:
+  // Maps the file |filename|, which must have been written by |Write|.
+  explicit EphemerisFile(std::string const& filename);
+
+  EphemerisFile(EphemerisFile const&) = delete;
+  EphemerisFile& operator=(EphemerisFile const&) = delete;
+
+  // Prolongs the |ephemeris| to |t_max| and writes its series to |filename|.
+  // |identifiers| gives the identifiers of the bodies, in the order of
+  // |ephemeris->bodies()|.
+  static void Write(std::vector<std::int64_t> const& identifiers,
+                    Instant const& t_max,
+                    not_null<Ephemeris<Frame>*> const ephemeris,
+                    std::string const& filename);
+
+  // The interval covered by the file.
+  Instant t_min() const;
+  Instant t_max() const;
+
+  // The indices used below are the indices of the bodies in the |ephemeris|
+  // passed to |Write|.
+  std::size_t number_of_bodies() const;
+  std::int64_t identifier(std::size_t const index) const;
+  GravitationalParameter gravitational_parameter(
+      std::size_t const index) const;
+
+  // |t| must be in [t_min(), t_max()].  The results are bitwise identical to
+  // those of the |Ephemeris| that was written.
+  Position<Frame> EvaluatePosition(std::size_t const index,
+                                   Instant const& t) const;
+  Velocity<Frame> EvaluateVelocity(std::size_t const index,
+                                   Instant const& t) const;
+
+ private:
+  // The layout of the file is a |Header|, followed by |number_of_bodies|
+  // |BodyRecord|s, followed by the |number_of_intervals| ends of the intervals
+  // (in seconds from |Instant()|), followed by the coefficients of the series
+  // (in metres), indexed by interval, then by body, then by degree, then by
+  // coordinate.  All the fields are 8 bytes long, so that they are aligned.
+  struct Header {
+    char magic[8];
+    std::int64_t number_of_bodies;
+    std::int64_t number_of_intervals;
+    std::int64_t degree;
+    double t_min;
+  };
+  struct BodyRecord {
+    std::int64_t identifier;
+    double gravitational_parameter;
+  };
+
+  static std::int64_t FileSize(Header const& header);
+
+  // The series covering |t|.
+  ChebyshevSeries<Displacement<Frame>> MakeSeries(std::size_t const index,
+                                                  Instant const& t) const;
+
+  ReadOnlyMappedFile const file_;
+  Header const* header_;
+  BodyRecord const* bodies_;
+  double const* intervals_t_max_;
+  double const* coefficients_;
+};
+
+}  // namespace physics
+}  // namespace principia
+
+#include "physics/ephemeris_file_body.hpp"
@@ -0,0 +1,184 @@
+﻿#pragma once
+
+#include "physics/ephemeris_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "geometry/r3_element.hpp"
+#include "glog/logging.h"
+#include "quantities/si.hpp"
+
+using principia::geometry::R3Element;
+using principia::quantities::Length;
+using principia::quantities::SIUnit;
+using principia::quantities::Time;
+
+namespace principia {
+namespace physics {
+
+namespace {
+
+// Identifies the format of the file, and its version.
+char const kEphemerisFileMagic[8] = {'P', 'R', 'I', 'N', 'E', 'P', 'H', '1'};
+
+}  // namespace
+
+template<typename Frame>
+EphemerisFile<Frame>::EphemerisFile(std::string const& filename)
+    : file_(filename) {
+  CHECK_LE(static_cast<std::int64_t>(sizeof(Header)), file_.size())
+      << filename << ": truncated ephemeris file";
+  header_ = reinterpret_cast<Header const*>(file_.data());
+  CHECK_EQ(0, std::memcmp(header_->magic,
+                          kEphemerisFileMagic,
+                          sizeof(kEphemerisFileMagic)))
+      << filename << ": not an ephemeris file";
+  CHECK_LT(0, header_->number_of_bodies) << filename;
+  CHECK_LT(0, header_->number_of_intervals) << filename;
+  CHECK_LE(0, header_->degree) << filename;
+  CHECK_EQ(FileSize(*header_), file_.size())
+      << filename << ": inconsistent ephemeris file";
+  bodies_ = reinterpret_cast<BodyRecord const*>(header_ + 1);
+  intervals_t_max_ =
+      reinterpret_cast<double const*>(bodies_ + header_->number_of_bodies);
+  coefficients_ = intervals_t_max_ + header_->number_of_intervals;
+}
+
+template<typename Frame>
+void EphemerisFile<Frame>::Write(std::vector<std::int64_t> const& identifiers,
+                                 Instant const& t_max,
+                                 not_null<Ephemeris<Frame>*> const ephemeris,
+                                 std::string const& filename) {
+  CHECK_EQ(ephemeris->number_of_bodies(), identifiers.size());
+  ephemeris->Prolong(t_max);
+  Header header;
+  std::memcpy(header.magic, kEphemerisFileMagic, sizeof(header.magic));
+  header.number_of_bodies = ephemeris->number_of_bodies();
+  header.number_of_intervals = ephemeris->series_.size();
+  header.degree = ephemeris->degree_;
+  header.t_min = (ephemeris->t_min() - Instant()) / SIUnit<Time>();
+
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  CHECK(file.good()) << filename;
+  file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+  for (std::size_t b = 0; b < ephemeris->number_of_bodies(); ++b) {
+    BodyRecord const body = {
+        identifiers[b],
+        ephemeris->bodies()[b]->gravitational_parameter() /
+            SIUnit<GravitationalParameter>()};
+    file.write(reinterpret_cast<char const*>(&body), sizeof(body));
+  }
+  for (Instant const& interval_t_max : ephemeris->series_t_max_) {
+    double const seconds = (interval_t_max - Instant()) / SIUnit<Time>();
+    file.write(reinterpret_cast<char const*>(&seconds), sizeof(seconds));
+  }
+  for (auto const& interval_series : ephemeris->series_) {
+    for (auto const& series : interval_series) {
+      CHECK_EQ(static_cast<std::size_t>(header.degree + 1),
+               series.coefficients_.size());
+      for (auto const& coefficient : series.coefficients_) {
+        R3Element<Length> const& coordinates = coefficient.coordinates();
+        double const metres[3] = {coordinates.x / SIUnit<Length>(),
+                                  coordinates.y / SIUnit<Length>(),
+                                  coordinates.z / SIUnit<Length>()};
+        file.write(reinterpret_cast<char const*>(metres), sizeof(metres));
+      }
+    }
+  }
+  file.close();
+  CHECK(file.good()) << filename;
+}
+
+template<typename Frame>
+Instant EphemerisFile<Frame>::t_min() const {
+  return Instant() + header_->t_min * SIUnit<Time>();
+}
+
+template<typename Frame>
+Instant EphemerisFile<Frame>::t_max() const {
+  return Instant() +
+         intervals_t_max_[header_->number_of_intervals - 1] * SIUnit<Time>();
+}
+
+template<typename Frame>
+std::size_t EphemerisFile<Frame>::number_of_bodies() const {
+  return header_->number_of_bodies;
+}
+
+template<typename Frame>
+std::int64_t EphemerisFile<Frame>::identifier(std::size_t const index) const {
+  CHECK_LT(index, number_of_bodies());
+  return bodies_[index].identifier;
+}
+
+template<typename Frame>
+GravitationalParameter EphemerisFile<Frame>::gravitational_parameter(
+    std::size_t const index) const {
+  CHECK_LT(index, number_of_bodies());
+  return bodies_[index].gravitational_parameter *
+         SIUnit<GravitationalParameter>();
+}
+
+template<typename Frame>
+Position<Frame> EphemerisFile<Frame>::EvaluatePosition(
+    std::size_t const index,
+    Instant const& t) const {
+  return Position<Frame>() + MakeSeries(index, t).Evaluate(t);
+}
+
+template<typename Frame>
+Velocity<Frame> EphemerisFile<Frame>::EvaluateVelocity(
+    std::size_t const index,
+    Instant const& t) const {
+  return MakeSeries(index, t).EvaluateDerivative(t);
+}
+
+template<typename Frame>
+std::int64_t EphemerisFile<Frame>::FileSize(Header const& header) {
+  return sizeof(Header) +
+         header.number_of_bodies * sizeof(BodyRecord) +
+         header.number_of_intervals * sizeof(double) +
+         header.number_of_intervals * header.number_of_bodies *
+             (header.degree + 1) * 3 * sizeof(double);
+}
+
+template<typename Frame>
+ChebyshevSeries<Displacement<Frame>> EphemerisFile<Frame>::MakeSeries(
+    std::size_t const index,
+    Instant const& t) const {
+  CHECK_LT(index, number_of_bodies());
+  CHECK_LE(t_min(), t);
+  CHECK_LE(t, t_max());
+  double const seconds = (t - Instant()) / SIUnit<Time>();
+  // The first interval whose end is at or after |t|.
+  std::int64_t const interval =
+      std::lower_bound(intervals_t_max_,
+                       intervals_t_max_ + header_->number_of_intervals,
+                       seconds) - intervals_t_max_;
+  Instant const interval_t_min =
+      interval == 0 ? t_min()
+                    : Instant() +
+                          intervals_t_max_[interval - 1] * SIUnit<Time>();
+  Instant const interval_t_max =
+      Instant() + intervals_t_max_[interval] * SIUnit<Time>();
+  std::int64_t const degree = header_->degree;
+  double const* const metres =
+      coefficients_ +
+      ((interval * header_->number_of_bodies + index) * (degree + 1)) * 3;
+  std::vector<Displacement<Frame>> coefficients;
+  coefficients.reserve(degree + 1);
+  for (std::int64_t i = 0; i <= degree; ++i) {
+    coefficients.emplace_back(
+        R3Element<Length>(metres[3 * i] * SIUnit<Length>(),
+                          metres[3 * i + 1] * SIUnit<Length>(),
+                          metres[3 * i + 2] * SIUnit<Length>()));
+  }
+  return ChebyshevSeries<Displacement<Frame>>(coefficients,
+                                              interval_t_min,
+                                              interval_t_max);
+}
+
+}  // namespace physics
+}  // namespace principia
@@ -0,0 +1,131 @@
+﻿#include "physics/ephemeris_file.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "geometry/frame.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "physics/massive_body.hpp"
+#include "physics/trajectory.hpp"
+#include "quantities/numbers.hpp"
+#include "quantities/si.hpp"
+
+using principia::base::make_not_null_unique;
+using principia::geometry::Frame;
+using principia::geometry::Vector;
+using principia::integrators::SPRKIntegrator;
+using principia::quantities::Length;
+using principia::quantities::Pow;
+using principia::quantities::Speed;
+using principia::quantities::Sqrt;
+using principia::quantities::Time;
+using principia::si::Kilogram;
+using principia::si::Metre;
+using principia::si::Second;
+using testing::Eq;
+using testing::Ge;
+
+namespace principia {
+namespace physics {
+
+class EphemerisFileTest : public testing::Test {
+ protected:
+  using EarthMoonOrbitPlane = Frame<serialization::Frame::TestTag,
+                                    serialization::Frame::TEST, true>;
+
+  EphemerisFileTest()
+      : earth_(6E24 * Kilogram),
+        moon_(7E22 * Kilogram),
+        earth_trajectory_(
+            make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&earth_)),
+        moon_trajectory_(
+            make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&moon_)) {
+    integrator_.Initialize(integrator_.Order5Optimal());
+
+    // The Earth-Moon system, roughly, with an eccentric orbit.
+    Length const semi_major_axis = 4E8 * Metre;
+    period_ = 2 * π * Sqrt(Pow<3>(semi_major_axis) /
+                               (earth_.gravitational_parameter() +
+                                moon_.gravitational_parameter()));
+    Speed const speed = 2 * π * semi_major_axis / period_;
+    earth_trajectory_->Append(
+        Instant(),
+        {Position<EarthMoonOrbitPlane>(),
+         Velocity<EarthMoonOrbitPlane>()});
+    moon_trajectory_->Append(
+        Instant(),
+        {Position<EarthMoonOrbitPlane>() +
+             Vector<Length, EarthMoonOrbitPlane>(
+                 {semi_major_axis, 0 * Metre, 0 * Metre}),
+         Velocity<EarthMoonOrbitPlane>({0 * Metre / Second,
+                                        0.9 * speed,
+                                        0.1 * speed})});
+  }
+
+  MassiveBody earth_;
+  MassiveBody moon_;
+  not_null<std::unique_ptr<Trajectory<EarthMoonOrbitPlane>>> earth_trajectory_;
+  not_null<std::unique_ptr<Trajectory<EarthMoonOrbitPlane>>> moon_trajectory_;
+  SPRKIntegrator<Length, Speed> integrator_;
+  Time period_;
+};
+
+// The file reproduces the ephemeris that was written exactly.
+TEST_F(EphemerisFileTest, WriteAndRead) {
+  char const filename[] = "ephemeris_file_test.bin";
+  Time const Δt = period_ / 1000;
+  Ephemeris<EarthMoonOrbitPlane> ephemeris(
+      {moon_trajectory_.get(), earth_trajectory_.get()},
+      integrator_,
+      Δt,
+      8,    // steps_per_series
+      12);  // degree
+  EphemerisFile<EarthMoonOrbitPlane>::Write({42, 3},
+                                            Instant() + 2 * period_,
+                                            &ephemeris,
+                                            filename);
+  {
+    EphemerisFile<EarthMoonOrbitPlane> const file(filename);
+    EXPECT_THAT(file.t_min(), Eq(ephemeris.t_min()));
+    EXPECT_THAT(file.t_max(), Eq(ephemeris.t_max()));
+    EXPECT_THAT(file.t_max(), Ge(Instant() + 2 * period_));
+    ASSERT_THAT(file.number_of_bodies(), Eq(2));
+    EXPECT_THAT(file.identifier(0), Eq(42));
+    EXPECT_THAT(file.identifier(1), Eq(3));
+    EXPECT_THAT(file.gravitational_parameter(0),
+                Eq(moon_.gravitational_parameter()));
+    EXPECT_THAT(file.gravitational_parameter(1),
+                Eq(earth_.gravitational_parameter()));
+    for (int i = 0; i <= 1000; ++i) {
+      Instant const t = file.t_min() + (file.t_max() - file.t_min()) * i / 1000;
+      for (std::size_t b = 0; b < 2; ++b) {
+        EXPECT_THAT(file.EvaluatePosition(b, t),
+                    Eq(ephemeris.EvaluatePosition(b, t)));
+        EXPECT_THAT(file.EvaluateVelocity(b, t),
+                    Eq(ephemeris.EvaluateVelocity(b, t)));
+      }
+    }
+  }
+  std::remove(filename);
+}
+
+using EphemerisFileDeathTest = EphemerisFileTest;
+
+TEST_F(EphemerisFileDeathTest, Error) {
+  char const filename[] = "ephemeris_file_death_test.bin";
+  {
+    std::ofstream file(filename, std::ios::binary);
+    file << "This is not an ephemeris file, but it is long enough.";
+  }
+  EXPECT_DEATH({
+    EphemerisFile<EarthMoonOrbitPlane> const file(filename);
+  }, "not an ephemeris file");
+  std::remove(filename);
+}
+
+}  // namespace physics
+}  // namespace principia
@@ -0,0 +1,180 @@
+﻿#include "physics/ephemeris.hpp"
+
+#include <memory>
+#include <vector>
+
+#include "geometry/frame.hpp"
+#include "geometry/grassmann.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "physics/massive_body.hpp"
+#include "physics/n_body_system.hpp"
+#include "physics/oblate_body.hpp"
+#include "physics/trajectory.hpp"
+#include "quantities/numbers.hpp"
+#include "quantities/si.hpp"
+#include "testing_utilities/numerics.hpp"
+
+using principia::base::make_not_null_unique;
+using principia::geometry::Frame;
+using principia::geometry::Vector;
+using principia::integrators::SPRKIntegrator;
+using principia::quantities::Mass;
+using principia::quantities::Pow;
+using principia::quantities::SIUnit;
+using principia::quantities::Sqrt;
+using principia::si::Kilogram;
+using principia::si::Metre;
+using principia::si::Second;
+using principia::testing_utilities::RelativeError;
+using testing::Eq;
+using testing::Ge;
+using testing::Le;
+using testing::Lt;
+
+namespace principia {
+namespace physics {
+
+class EphemerisTest : public testing::Test {
+ protected:
+  using EarthMoonOrbitPlane = Frame<serialization::Frame::TestTag,
+                                    serialization::Frame::TEST, true>;
+
+  EphemerisTest()
+      : earth_(6E24 * Kilogram),
+        moon_(7E22 * Kilogram),
+        earth_trajectory_(
+            make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&earth_)),
+        moon_trajectory_(
+            make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&moon_)) {
+    integrator_.Initialize(integrator_.Order5Optimal());
+
+    // The Earth-Moon system, roughly, with a circular orbit.
+    Length const semi_major_axis = 4E8 * Metre;
+    period_ = 2 * π * Sqrt(Pow<3>(semi_major_axis) /
+                               (earth_.gravitational_parameter() +
+                                moon_.gravitational_parameter()));
+    Mass const total_mass = earth_.mass() + moon_.mass();
+    Speed const speed = 2 * π * semi_major_axis / period_;
+    earth_trajectory_->Append(
+        Instant(),
+        {Position<EarthMoonOrbitPlane>() +
+             Vector<Length, EarthMoonOrbitPlane>(
+                 {-semi_major_axis * moon_.mass() / total_mass,
+                  0 * Metre,
+                  0 * Metre}),
+         Velocity<EarthMoonOrbitPlane>({0 * Metre / Second,
+                                        -speed * moon_.mass() / total_mass,
+                                        0 * Metre / Second})});
+    moon_trajectory_->Append(
+        Instant(),
+        {Position<EarthMoonOrbitPlane>() +
+             Vector<Length, EarthMoonOrbitPlane>(
+                 {semi_major_axis * earth_.mass() / total_mass,
+                  0 * Metre,
+                  0 * Metre}),
+         Velocity<EarthMoonOrbitPlane>({0 * Metre / Second,
+                                        speed * earth_.mass() / total_mass,
+                                        0 * Metre / Second})});
+  }
+
+  MassiveBody earth_;
+  MassiveBody moon_;
+  not_null<std::unique_ptr<Trajectory<EarthMoonOrbitPlane>>> earth_trajectory_;
+  not_null<std::unique_ptr<Trajectory<EarthMoonOrbitPlane>>> moon_trajectory_;
+  SPRKIntegrator<Length, Speed> integrator_;
+  Time period_;
+};
+
+using EphemerisDeathTest = EphemerisTest;
+
+TEST_F(EphemerisDeathTest, Error) {
+  EXPECT_DEATH({
+    Ephemeris<EarthMoonOrbitPlane> ephemeris(
+        {earth_trajectory_.get(), earth_trajectory_.get()},
+        integrator_,
+        period_ / 1000,
+        8,    // steps_per_series
+        12);  // degree
+  }, "Multiple trajectories");
+  EXPECT_DEATH({
+    Ephemeris<EarthMoonOrbitPlane> ephemeris({earth_trajectory_.get()},
+                                             integrator_,
+                                             period_ / 1000,
+                                             8,    // steps_per_series
+                                             12);  // degree
+    ephemeris.Prolong(Instant() + period_);
+    ephemeris.EvaluatePosition(0, Instant() + 2 * period_);
+  }, "Check failed");
+}
+
+// The ephemeris is prolonged lazily, one series at a time.
+TEST_F(EphemerisTest, Prolong) {
+  Time const Δt = period_ / 1000;
+  Ephemeris<EarthMoonOrbitPlane> ephemeris(
+      {moon_trajectory_.get(), earth_trajectory_.get()},
+      integrator_,
+      Δt,
+      8,    // steps_per_series
+      12);  // degree
+  EXPECT_THAT(ephemeris.number_of_bodies(), Eq(2));
+  EXPECT_THAT(ephemeris.t_min(), Eq(Instant()));
+  EXPECT_THAT(ephemeris.t_max(), Eq(Instant()));
+  ephemeris.Prolong(Instant());
+  EXPECT_THAT(ephemeris.t_max(), Eq(Instant() + 8 * Δt));
+  ephemeris.Prolong(Instant() + 8 * Δt);
+  EXPECT_THAT(ephemeris.t_max(), Eq(Instant() + 8 * Δt));
+  ephemeris.Prolong(Instant() + 20 * Δt);
+  EXPECT_THAT(ephemeris.t_max(), Ge(Instant() + 20 * Δt));
+  EXPECT_THAT(ephemeris.t_max(), Le(Instant() + 28 * Δt));
+  // The initial trajectories are not modified.
+  EXPECT_THAT(earth_trajectory_->Positions().size(), Eq(1));
+  EXPECT_THAT(moon_trajectory_->Positions().size(), Eq(1));
+}
+
+// The ephemeris agrees with an integration of the same bodies at the steps of
+// the integration.
+TEST_F(EphemerisTest, EarthMoon) {
+  Time const Δt = period_ / 1000;
+  Ephemeris<EarthMoonOrbitPlane> ephemeris(
+      {moon_trajectory_.get(), earth_trajectory_.get()},
+      integrator_,
+      Δt,
+      8,    // steps_per_series
+      12);  // degree
+  ephemeris.Prolong(Instant() + period_);
+  EXPECT_THAT(ephemeris.t_max(), Ge(Instant() + period_));
+  ASSERT_THAT(ephemeris.bodies()[0], Eq(&moon_));
+  ASSERT_THAT(ephemeris.bodies()[1], Eq(&earth_));
+
+  NBodySystem<EarthMoonOrbitPlane> system;
+  system.Integrate(integrator_,
+                   ephemeris.t_max(),
+                   Δt,
+                   1,     // sampling_period
+                   true,  // tmax_is_exact
+                   {earth_trajectory_.get(), moon_trajectory_.get()});
+  auto const earth_positions = earth_trajectory_->Positions();
+  auto const moon_velocities = moon_trajectory_->Velocities();
+  double max_position_error = 0;
+  double max_velocity_error = 0;
+  for (auto const& time_position : earth_positions) {
+    max_position_error = std::max(
+        max_position_error,
+        RelativeError(time_position.second - Position<EarthMoonOrbitPlane>(),
+                      ephemeris.EvaluatePosition(1, time_position.first) -
+                          Position<EarthMoonOrbitPlane>()));
+  }
+  for (auto const& time_velocity : moon_velocities) {
+    max_velocity_error = std::max(
+        max_velocity_error,
+        RelativeError(time_velocity.second,
+                      ephemeris.EvaluateVelocity(0, time_velocity.first)));
+  }
+  EXPECT_THAT(max_position_error, Lt(1E-12));
+  EXPECT_THAT(max_velocity_error, Lt(1E-12));
+}
+
+}  // namespace physics
+}  // namespace principia
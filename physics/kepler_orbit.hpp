@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include "geometry/named_quantities.hpp"
+#include "physics/degrees_of_freedom.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::geometry::Instant;
+using principia::quantities::GravitationalParameter;
+using principia::quantities::Length;
+using principia::quantities::Product;
+using principia::quantities::Speed;
+
+namespace principia {
+namespace physics {
+
+// The motion of a massless body relative to a single primary, computed
+// analytically with the universal variable formulation of Kepler's problem.
+// It is valid for elliptic, parabolic and hyperbolic orbits.
+template<typename Frame>
+class KeplerOrbit {
+ public:
+  // The body has the given |relative_degrees_of_freedom| with respect to a
+  // primary with the given |gravitational_parameter| at |epoch|.
+  KeplerOrbit(
+      GravitationalParameter const& gravitational_parameter,
+      RelativeDegreesOfFreedom<Frame> const& relative_degrees_of_freedom,
+      Instant const& epoch);
+
+  // Returns the degrees of freedom of the body relative to the primary at |t|,
+  // which may be before or after the epoch.
+  RelativeDegreesOfFreedom<Frame> RelativeDegreesOfFreedomAt(
+      Instant const& t) const;
+
+ private:
+  // The Stumpff functions c₂ and c₃.
+  static double C(double const z);
+  static double S(double const z);
+
+  GravitationalParameter const μ_;
+  Length const r0_;
+  Product<Length, Speed> const r0_dot_v0_;
+  // The reciprocal of the semimajor axis, negative for hyperbolic orbits.
+  Length::Inverse const α_;
+
+  RelativeDegreesOfFreedom<Frame> const initial_;
+  Instant const epoch_;
+};
+
+}  // namespace physics
+}  // namespace principia
+
+#include "physics/kepler_orbit_body.hpp"
@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include <cmath>
+
+#include "geometry/grassmann.hpp"
+#include "glog/logging.h"
+#include "quantities/elementary_functions.hpp"
+
+using principia::geometry::Displacement;
+using principia::geometry::InnerProduct;
+using principia::geometry::Velocity;
+using principia::quantities::Pow;
+using principia::quantities::Sqrt;
+using principia::quantities::Time;
+
+namespace principia {
+namespace physics {
+
+template<typename Frame>
+KeplerOrbit<Frame>::KeplerOrbit(
+    GravitationalParameter const& gravitational_parameter,
+    RelativeDegreesOfFreedom<Frame> const& relative_degrees_of_freedom,
+    Instant const& epoch)
+    : μ_(gravitational_parameter),
+      r0_(relative_degrees_of_freedom.displacement().Norm()),
+      r0_dot_v0_(InnerProduct(relative_degrees_of_freedom.displacement(),
+                              relative_degrees_of_freedom.velocity())),
+      α_(2 / r0_ -
+         InnerProduct(relative_degrees_of_freedom.velocity(),
+                      relative_degrees_of_freedom.velocity()) / μ_),
+      initial_(relative_degrees_of_freedom),
+      epoch_(epoch) {
+  CHECK_LT(GravitationalParameter(), μ_);
+  CHECK_LT(Length(), r0_);
+}
+
+template<typename Frame>
+RelativeDegreesOfFreedom<Frame> KeplerOrbit<Frame>::RelativeDegreesOfFreedomAt(
+    Instant const& t) const {
+  Time const Δt = t - epoch_;
+  if (Δt == Time()) {
+    return initial_;
+  }
+
+  // The universal anomaly χ has the dimension of the square root of a length,
+  // which is not a quantity, so the equations are written in terms of the
+  // dimensionless ψ = χ / √r₀, with the time scaled by n₀ = √(μ / r₀³).  The
+  // arithmetic below is on dimensionless doubles.
+  Time::Inverse const n0 = Sqrt(μ_ / Pow<3>(r0_));
+  double const τ = n0 * Δt;
+  double const σ0 = r0_dot_v0_ / Sqrt(μ_ * r0_);
+  double const α_r0 = α_ * r0_;
+  double const β = 1 - α_r0;
+
+  // Initial guess for the universal anomaly, see Vallado, Fundamentals of
+  // Astrodynamics and Applications, algorithm 8.  For hyperbolic orbits that
+  // guess is only good for large |Δt|, so the smaller of it and the guess for
+  // a straight line is used.
+  double ψ;
+  if (α_r0 > 0) {
+    ψ = τ * α_r0;
+  } else {
+    ψ = τ;
+    if (α_r0 < 0) {
+      // √(-a / r₀).
+      double const sqrt_minus_a_over_r0 = std::sqrt(-1 / α_r0);
+      double const sign = τ > 0 ? 1 : -1;
+      double const argument =
+          -2 * α_r0 * τ / (σ0 + sign * sqrt_minus_a_over_r0 * β);
+      if (argument > 0) {
+        double const hyperbolic_ψ =
+            sign * sqrt_minus_a_over_r0 * std::log(argument);
+        if (std::abs(hyperbolic_ψ) < std::abs(ψ)) {
+          ψ = hyperbolic_ψ;
+        }
+      }
+    }
+  }
+
+  // Newton's method on the universal Kepler equation.  The derivative of the
+  // equation with respect to ψ is the distance ratio ρ = r / r₀, which is
+  // positive.
+  double z;
+  double c;
+  double s;
+  double ρ;
+  int const kMaxIterations = 50;
+  int iteration = 0;
+  for (;; ++iteration) {
+    CHECK_LT(iteration, kMaxIterations)
+        << "Universal Kepler equation did not converge for Δt = " << Δt;
+    double const ψ_squared = ψ * ψ;
+    z = α_r0 * ψ_squared;
+    c = C(z);
+    s = S(z);
+    double const f = σ0 * ψ_squared * c + β * ψ_squared * ψ * s + ψ - τ;
+    ρ = σ0 * ψ * (1 - z * s) + β * ψ_squared * c + 1;
+    double const δψ = f / ρ;
+    ψ -= δψ;
+    if (std::abs(δψ) <= 1e-12 * std::abs(ψ)) {
+      break;
+    }
+  }
+  double const ψ_squared = ψ * ψ;
+  z = α_r0 * ψ_squared;
+  c = C(z);
+  s = S(z);
+  ρ = σ0 * ψ * (1 - z * s) + β * ψ_squared * c + 1;
+
+  // The Lagrange coefficients.
+  double const f = 1 - ψ_squared * c;
+  Time const g = Δt - ψ_squared * ψ * s / n0;
+  Time::Inverse const ḟ = n0 * ψ * (z * s - 1) / ρ;
+  double const ġ = 1 - ψ_squared * c / ρ;
+
+  Displacement<Frame> const& r0 = initial_.displacement();
+  Velocity<Frame> const& v0 = initial_.velocity();
+  return RelativeDegreesOfFreedom<Frame>(r0 * f + v0 * g, r0 * ḟ + v0 * ġ);
+}
+
+template<typename Frame>
+double KeplerOrbit<Frame>::C(double const z) {
+  if (std::abs(z) < 1e-2) {
+    // Series expansion, to avoid the cancellation in 1 - cos √z.
+    return 1.0 / 2 - z * (1.0 / 24 - z * (1.0 / 720 - z * (1.0 / 40320 -
+               z / 3628800)));
+  } else if (z > 0) {
+    return (1 - std::cos(std::sqrt(z))) / z;
+  } else {
+    return (std::cosh(std::sqrt(-z)) - 1) / -z;
+  }
+}
+
+template<typename Frame>
+double KeplerOrbit<Frame>::S(double const z) {
+  if (std::abs(z) < 1e-2) {
+    // Series expansion, to avoid the cancellation in √z - sin √z.
+    return 1.0 / 6 - z * (1.0 / 120 - z * (1.0 / 5040 - z * (1.0 / 362880 -
+               z / 39916800)));
+  } else if (z > 0) {
+    double const sqrt_z = std::sqrt(z);
+    return (sqrt_z - std::sin(sqrt_z)) / (z * sqrt_z);
+  } else {
+    double const sqrt_minus_z = std::sqrt(-z);
+    return (std::sinh(sqrt_minus_z) - sqrt_minus_z) / (-z * sqrt_minus_z);
+  }
+}
+
+}  // namespace physics
+}  // namespace principia
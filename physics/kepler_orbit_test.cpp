@@ -0,0 +1,116 @@
+﻿#include "physics/kepler_orbit.hpp"
+
+#include "geometry/frame.hpp"
+#include "geometry/grassmann.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/numbers.hpp"
+#include "quantities/si.hpp"
+#include "testing_utilities/numerics.hpp"
+
+using principia::geometry::Bivector;
+using principia::geometry::Frame;
+using principia::geometry::Vector;
+using principia::geometry::Wedge;
+using principia::quantities::Pow;
+using principia::quantities::Product;
+using principia::quantities::SpecificEnergy;
+using principia::quantities::Sqrt;
+using principia::si::Day;
+using principia::si::Metre;
+using principia::si::Second;
+using principia::testing_utilities::AbsoluteError;
+using principia::testing_utilities::RelativeError;
+using testing::Lt;
+
+namespace principia {
+namespace physics {
+
+class KeplerOrbitTest : public testing::Test {
+ protected:
+  using World = Frame<serialization::Frame::TestTag,
+                      serialization::Frame::TEST, true>;
+
+  KeplerOrbitTest()
+      : μ_(3.986004418E14 * Pow<3>(Metre) / Pow<2>(Second)),
+        r0_(Displacement<World>({7E6 * Metre, 0 * Metre, 0 * Metre})) {}
+
+  SpecificEnergy Energy(RelativeDegreesOfFreedom<World> const& dof) const {
+    return InnerProduct(dof.velocity(), dof.velocity()) / 2 -
+           μ_ / dof.displacement().Norm();
+  }
+
+  Bivector<Product<Length, Speed>, World> AngularMomentum(
+      RelativeDegreesOfFreedom<World> const& dof) const {
+    return Wedge(dof.displacement(), dof.velocity());
+  }
+
+  GravitationalParameter const μ_;
+  Displacement<World> const r0_;
+  Instant const epoch_;
+};
+
+// A circular orbit is back at its initial state after one period, and has
+// rotated by a quarter turn after a quarter period.
+TEST_F(KeplerOrbitTest, Circular) {
+  Speed const speed = Sqrt(μ_ / r0_.Norm());
+  Time const period = 2 * π * Sqrt(Pow<3>(r0_.Norm()) / μ_);
+  RelativeDegreesOfFreedom<World> const initial(
+      r0_, Velocity<World>({0 * Metre / Second, speed, 0 * Metre / Second}));
+  KeplerOrbit<World> const orbit(μ_, initial, epoch_);
+
+  RelativeDegreesOfFreedom<World> const one_period =
+      orbit.RelativeDegreesOfFreedomAt(epoch_ + period);
+  EXPECT_THAT(AbsoluteError(r0_, one_period.displacement()),
+              Lt(1E-6 * Metre));
+  EXPECT_THAT(AbsoluteError(initial.velocity(), one_period.velocity()),
+              Lt(1E-9 * Metre / Second));
+
+  RelativeDegreesOfFreedom<World> const quarter_period =
+      orbit.RelativeDegreesOfFreedomAt(epoch_ + period / 4);
+  EXPECT_THAT(
+      AbsoluteError(
+          Displacement<World>({0 * Metre, r0_.Norm(), 0 * Metre}),
+          quarter_period.displacement()),
+      Lt(1E-6 * Metre));
+  EXPECT_THAT(
+      AbsoluteError(
+          Velocity<World>({-speed, 0 * Metre / Second, 0 * Metre / Second}),
+          quarter_period.velocity()),
+      Lt(1E-9 * Metre / Second));
+}
+
+// The energy and angular momentum are conserved for elliptic, nearly
+// parabolic and hyperbolic orbits, forward and backward in time.
+TEST_F(KeplerOrbitTest, Conservation) {
+  for (Speed const speed : {7.546E3 * Metre / Second,
+                            9E3 * Metre / Second,
+                            10.672E3 * Metre / Second,
+                            15E3 * Metre / Second}) {
+    RelativeDegreesOfFreedom<World> const initial(
+        r0_,
+        Velocity<World>({0 * Metre / Second, speed, 1E3 * Metre / Second}));
+    KeplerOrbit<World> const orbit(μ_, initial, epoch_);
+    for (Time const Δt : {1 * Second, 10 * Second, 1000 * Second,
+                          -5000 * Second, 1 * Day}) {
+      RelativeDegreesOfFreedom<World> const final =
+          orbit.RelativeDegreesOfFreedomAt(epoch_ + Δt);
+      EXPECT_THAT(RelativeError(Energy(initial), Energy(final)), Lt(1E-12))
+          << speed << " " << Δt;
+      EXPECT_THAT(RelativeError(AngularMomentum(initial).Norm(),
+                                AngularMomentum(final).Norm()),
+                  Lt(1E-12)) << speed << " " << Δt;
+      // Going back to the epoch yields the initial state.
+      KeplerOrbit<World> const back(μ_, final, epoch_ + Δt);
+      RelativeDegreesOfFreedom<World> const initial_again =
+          back.RelativeDegreesOfFreedomAt(epoch_);
+      EXPECT_THAT(AbsoluteError(initial.displacement(),
+                                initial_again.displacement()),
+                  Lt(1E-3 * Metre)) << speed << " " << Δt;
+    }
+  }
+}
+
+}  // namespace physics
+}  // namespace principia
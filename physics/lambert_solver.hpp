@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include "geometry/grassmann.hpp"
+#include "geometry/named_quantities.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::geometry::Bivector;
+using principia::geometry::Displacement;
+using principia::geometry::Velocity;
+using principia::quantities::GravitationalParameter;
+using principia::quantities::Time;
+
+namespace principia {
+namespace physics {
+
+// The velocities at the ends of a Keplerian transfer orbit.
+template<typename Frame>
+struct LambertTransfer {
+  Velocity<Frame> initial_velocity;
+  Velocity<Frame> final_velocity;
+};
+
+// Solves Lambert's problem around a primary: finds the Keplerian orbit which
+// goes between two given displacements relative to the primary in a given
+// time.  This uses the algorithm of Izzo (2015), Revisiting Lambert's problem,
+// restricted to transfers of less than one revolution: the time of flight is
+// a function of a single parameter |x| whose root is found with Householder
+// iterations from an initial guess which is already accurate, so that a
+// solution typically takes 2 or 3 iterations.  A solver may be used
+// concurrently from multiple threads.
+template<typename Frame>
+class LambertSolver {
+ public:
+  explicit LambertSolver(GravitationalParameter const& gravitational_parameter);
+
+  // Returns the transfer from |initial_displacement| to |final_displacement| in
+  // |time_of_flight|, which must be positive.  The transfer is prograde with
+  // respect to |orientation|, i.e., its angular momentum has a positive inner
+  // product with |orientation|, so it goes the long way around if the short
+  // way is retrograde.  The displacements must not be collinear.
+  LambertTransfer<Frame> Solve(
+      Displacement<Frame> const& initial_displacement,
+      Displacement<Frame> const& final_displacement,
+      Time const& time_of_flight,
+      Bivector<double, Frame> const& orientation) const;
+
+ private:
+  // The nondimensional time of flight as a function of |x|, for the geometry
+  // parameter |λ|, which is in [-1, 1].
+  static double TimeOfFlight(double const x, double const λ);
+
+  // The following is in SI units.
+  double const μ_;
+};
+
+}  // namespace physics
+}  // namespace principia
+
+#include "physics/lambert_solver_body.hpp"
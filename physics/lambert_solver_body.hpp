@@ -0,0 +1,163 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "geometry/r3_element.hpp"
+#include "glog/logging.h"
+
+using principia::geometry::Cross;
+using principia::geometry::Dot;
+using principia::geometry::R3Element;
+using principia::quantities::Length;
+using principia::quantities::SIUnit;
+using principia::quantities::Speed;
+
+namespace principia {
+namespace physics {
+
+template<typename Frame>
+LambertSolver<Frame>::LambertSolver(
+    GravitationalParameter const& gravitational_parameter)
+    : μ_(gravitational_parameter / SIUnit<GravitationalParameter>()) {
+  CHECK_LT(0, μ_);
+}
+
+template<typename Frame>
+LambertTransfer<Frame> LambertSolver<Frame>::Solve(
+    Displacement<Frame> const& initial_displacement,
+    Displacement<Frame> const& final_displacement,
+    Time const& time_of_flight,
+    Bivector<double, Frame> const& orientation) const {
+  double const t = time_of_flight / SIUnit<Time>();
+  CHECK_LT(0, t);
+  R3Element<double> const r1 =
+      initial_displacement.coordinates() / SIUnit<Length>();
+  R3Element<double> const r2 =
+      final_displacement.coordinates() / SIUnit<Length>();
+  double const r1_norm = r1.Norm();
+  double const r2_norm = r2.Norm();
+  double const c = (r2 - r1).Norm();
+  // The semiperimeter of the triangle formed by the primary and the ends.
+  double const s = (r1_norm + r2_norm + c) / 2;
+  R3Element<double> const ir1 = r1 / r1_norm;
+  R3Element<double> const ir2 = r2 / r2_norm;
+  R3Element<double> ih = Cross(ir1, ir2);
+  double const ih_norm = ih.Norm();
+  CHECK_LT(0, ih_norm) << "Collinear displacements " << initial_displacement
+                       << " and " << final_displacement;
+  ih /= ih_norm;
+
+  // Izzo's λ is negative for a transfer angle greater than π.
+  double const λ² = std::max(0.0, 1 - c / s);
+  double λ = std::sqrt(λ²);
+  if (Dot(ih, orientation.coordinates()) < 0) {
+    λ = -λ;
+    ih = -ih;
+  }
+  R3Element<double> const it1 = Cross(ih, ir1);
+  R3Element<double> const it2 = Cross(ih, ir2);
+  double const λ³ = λ² * λ;
+  double const T = std::sqrt(2 * μ_ / (s * s * s)) * t;
+
+  // The initial guess, see Izzo, section 3.  |T0| and |T1| are the times of
+  // flight for x = 0 and for the parabola, x = 1.
+  double const T0 = std::acos(λ) + λ * std::sqrt(1 - λ²);
+  double const T1 = 2.0 / 3.0 * (1 - λ³);
+  double x;
+  if (T >= T0) {
+    x = -(T - T0) / (T - T0 + 4);
+  } else if (T <= T1) {
+    x = 5.0 / 2.0 * T1 * (T1 - T) / ((1 - λ³ * λ²) * T) + 1;
+  } else {
+    x = std::pow(T / T0, std::log(2.0) / std::log(T1 / T0)) - 1;
+  }
+
+  // Householder iterations, using the derivatives of the time of flight given
+  // by Izzo, equation (22).
+  int const kMaxIterations = 15;
+  for (int iteration = 0;; ++iteration) {
+    CHECK_LT(iteration, kMaxIterations)
+        << "Lambert solver did not converge for T = " << T << ", λ = " << λ;
+    double const Tx = TimeOfFlight(x, λ);
+    double const one_minus_x² = 1 - x * x;
+    double const y = std::sqrt(1 - λ² * one_minus_x²);
+    double const y³ = y * y * y;
+    double const dT = (3 * Tx * x - 2 + 2 * λ³ * x / y) / one_minus_x²;
+    double const d²T =
+        (3 * Tx + 5 * x * dT + 2 * (1 - λ²) * λ³ / y³) / one_minus_x²;
+    double const d³T =
+        (7 * x * d²T + 8 * dT - 6 * (1 - λ²) * λ² * λ³ * x / (y³ * y * y)) /
+        one_minus_x²;
+    double const δ = Tx - T;
+    double const dT² = dT * dT;
+    double const δx = δ * (dT² - δ * d²T / 2) /
+                      (dT * (dT² - δ * d²T) + d³T * δ * δ / 6);
+    x -= δx;
+    // The convergence is cubic, so the last step made |x| fully accurate.
+    if (std::abs(δx) <= 1e-7) {
+      break;
+    }
+  }
+
+  // The velocities, see Izzo, algorithm 1.
+  double const γ = std::sqrt(μ_ * s / 2);
+  double const ρ = (r1_norm - r2_norm) / c;
+  double const σ = std::sqrt(1 - ρ * ρ);
+  double const y = std::sqrt(1 - λ² + λ² * x * x);
+  double const vr1 = γ * ((λ * y - x) - ρ * (λ * y + x)) / r1_norm;
+  double const vr2 = -γ * ((λ * y - x) + ρ * (λ * y + x)) / r2_norm;
+  double const vt = γ * σ * (y + λ * x);
+  return {Velocity<Frame>((vr1 * ir1 + vt / r1_norm * it1) * SIUnit<Speed>()),
+          Velocity<Frame>((vr2 * ir2 + vt / r2_norm * it2) * SIUnit<Speed>())};
+}
+
+template<typename Frame>
+double LambertSolver<Frame>::TimeOfFlight(double const x, double const λ) {
+  double const distance_to_parabola = std::abs(x - 1);
+  if (distance_to_parabola > 1e-2 && distance_to_parabola < 0.2) {
+    // Lagrange's equation, which is accurate away from the parabola and from
+    // the rectilinear case.
+    double const a = 1 / (1 - x * x);
+    if (a > 0) {
+      double const α = 2 * std::acos(x);
+      double β = 2 * std::asin(std::sqrt(λ * λ / a));
+      if (λ < 0) {
+        β = -β;
+      }
+      return a * std::sqrt(a) * ((α - std::sin(α)) - (β - std::sin(β))) / 2;
+    } else {
+      double const α = 2 * std::acosh(x);
+      double β = 2 * std::asinh(std::sqrt(-λ * λ / a));
+      if (λ < 0) {
+        β = -β;
+      }
+      return -a * std::sqrt(-a) * ((β - std::sinh(β)) - (α - std::sinh(α))) /
+             2;
+    }
+  }
+  double const E = x * x - 1;
+  double const z = std::sqrt(1 + λ * λ * E);
+  if (distance_to_parabola <= 1e-2) {
+    // Battin's series, which is accurate near the parabola.
+    double const η = z - λ * x;
+    double const S1 = (1 - λ - x * η) / 2;
+    // The hypergeometric function ₂F₁(3, 1; 5/2; S1).
+    double F = 1;
+    double term = 1;
+    for (int j = 0; std::abs(term) > 1e-11; ++j) {
+      term *= (3 + j) * (1 + j) / (2.5 + j) * S1 / (j + 1);
+      F += term;
+    }
+    double const Q = 4.0 / 3.0 * F;
+    return (η * η * η * Q + 4 * λ * η) / 2;
+  }
+  // Lancaster's equation.
+  double const y = std::sqrt(std::abs(E));
+  double const g = x * z - λ * E;
+  double const d = E < 0 ? std::acos(g) : std::log(y * (z - λ * x) + g);
+  return (x - λ * z - d / y) / E;
+}
+
+}  // namespace physics
+}  // namespace principia
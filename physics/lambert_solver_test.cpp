@@ -0,0 +1,134 @@
+﻿#include "physics/lambert_solver.hpp"
+
+#include <vector>
+
+#include "geometry/frame.hpp"
+#include "geometry/grassmann.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "physics/kepler_orbit.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/numbers.hpp"
+#include "quantities/si.hpp"
+#include "testing_utilities/numerics.hpp"
+
+using principia::geometry::Frame;
+using principia::geometry::Normalize;
+using principia::geometry::Wedge;
+using principia::quantities::Pow;
+using principia::quantities::Speed;
+using principia::quantities::Sqrt;
+using principia::si::Metre;
+using principia::si::Second;
+using principia::testing_utilities::RelativeError;
+using testing::Lt;
+
+namespace principia {
+namespace physics {
+
+class LambertSolverTest : public testing::Test {
+ protected:
+  using World = Frame<serialization::Frame::TestTag,
+                      serialization::Frame::TEST, true>;
+
+  LambertSolverTest()
+      : μ_(3.986004418E14 * Pow<3>(Metre) / Pow<2>(Second)),
+        solver_(μ_),
+        r0_(Displacement<World>({7E6 * Metre, 0 * Metre, 0 * Metre})) {}
+
+  // Propagates the orbit with the given initial velocity at |r0_| for |t| and
+  // checks that the solver recovers the velocities at both ends.
+  void CheckTransfer(Velocity<World> const& v0, Time const& t) {
+    KeplerOrbit<World> const orbit(
+        μ_, RelativeDegreesOfFreedom<World>(r0_, v0), epoch_);
+    RelativeDegreesOfFreedom<World> const final =
+        orbit.RelativeDegreesOfFreedomAt(epoch_ + t);
+    LambertTransfer<World> const transfer = solver_.Solve(
+        r0_,
+        final.displacement(),
+        t,
+        Normalize(Wedge(r0_, v0)));
+    EXPECT_THAT(RelativeError(v0, transfer.initial_velocity), Lt(1E-9))
+        << v0 << " " << t;
+    EXPECT_THAT(RelativeError(final.velocity(), transfer.final_velocity),
+                Lt(1E-9))
+        << v0 << " " << t;
+  }
+
+  GravitationalParameter const μ_;
+  LambertSolver<World> const solver_;
+  Displacement<World> const r0_;
+  Instant const epoch_;
+};
+
+TEST_F(LambertSolverTest, Circular) {
+  Speed const speed = Sqrt(μ_ / r0_.Norm());
+  Time const period = 2 * π * Sqrt(Pow<3>(r0_.Norm()) / μ_);
+  Bivector<double, World> const prograde({0, 0, 1});
+  for (double const fraction : {0.1, 0.25, 0.5 - 1E-3, 0.5 + 1E-3, 0.9}) {
+    double const angle = 2 * π * fraction;
+    Displacement<World> const r1(
+        {r0_.Norm() * std::cos(angle),
+         r0_.Norm() * std::sin(angle),
+         0 * Metre});
+    LambertTransfer<World> const transfer =
+        solver_.Solve(r0_, r1, fraction * period, prograde);
+    EXPECT_THAT(RelativeError(Velocity<World>({0 * Metre / Second,
+                                               speed,
+                                               0 * Metre / Second}),
+                              transfer.initial_velocity),
+                Lt(1E-12))
+        << fraction;
+    EXPECT_THAT(RelativeError(Velocity<World>({-speed * std::sin(angle),
+                                               speed * std::cos(angle),
+                                               0 * Metre / Second}),
+                              transfer.final_velocity),
+                Lt(1E-12))
+        << fraction;
+  }
+}
+
+// The orientation selects the short or the long way around.
+TEST_F(LambertSolverTest, Orientation) {
+  Speed const speed = Sqrt(μ_ / r0_.Norm());
+  Time const period = 2 * π * Sqrt(Pow<3>(r0_.Norm()) / μ_);
+  Displacement<World> const r1({0 * Metre, r0_.Norm(), 0 * Metre});
+  // Clockwise around z, this is three quarters of a revolution.
+  LambertTransfer<World> const transfer = solver_.Solve(
+      r0_, r1, 0.75 * period, Bivector<double, World>({0, 0, -1}));
+  EXPECT_THAT(RelativeError(Velocity<World>({0 * Metre / Second,
+                                             -speed,
+                                             0 * Metre / Second}),
+                            transfer.initial_velocity),
+              Lt(1E-12));
+  EXPECT_THAT(RelativeError(Velocity<World>({speed,
+                                             0 * Metre / Second,
+                                             0 * Metre / Second}),
+                            transfer.final_velocity),
+              Lt(1E-12));
+}
+
+// Transfers on elliptic orbits of various eccentricities, near the parabola,
+// and on hyperbolic orbits, with transfer angles on both sides of π.
+TEST_F(LambertSolverTest, Conics) {
+  Speed const circular_speed = Sqrt(μ_ / r0_.Norm());
+  Time const period = 2 * π * Sqrt(Pow<3>(r0_.Norm()) / μ_);
+  for (double const speed_ratio :
+           {0.5, 0.8, 1.1, 1.3, 1.4, 1.414, 1.415, 1.5, 3.0}) {
+    Speed const speed = speed_ratio * circular_speed;
+    // Not in the plane of the axes, and not perpendicular to |r0_|.
+    Velocity<World> const v0({0.3 * speed, 0.8 * speed, 0.52 * speed});
+    for (double const fraction : {0.05, 0.2, 0.4, 0.6}) {
+      // For tightly bound orbits, stay within one revolution.
+      Time t = fraction * period;
+      if (speed < circular_speed) {
+        Length const a = 1 / (2 / r0_.Norm() - speed * speed / μ_);
+        t = fraction * 2 * π * Sqrt(Pow<3>(a) / μ_);
+      }
+      CheckTransfer(v0, t);
+    }
+  }
+}
+
+}  // namespace physics
+}  // namespace principia
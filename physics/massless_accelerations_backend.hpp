@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "base/not_null.hpp"
+
+using principia::base::not_null;
+
+namespace principia {
+namespace physics {
+
+// A device that computes the point-mass accelerations exerted by the massive
+// bodies on the massless bodies, e.g., a GPU driven by CUDA, OpenCL or Vulkan
+// compute.  With thousands of massless bodies, this is where |NBodySystem|
+// spends most of its time, and each massless body may be processed
+// independently.  The implementations that drive an actual device are
+// provided by the client, so that Principia doesn't depend on any GPU toolkit.
+class MasslessAccelerationsBackend {
+ public:
+  virtual ~MasslessAccelerationsBackend() = default;
+
+  // Sets |accelerations| to the accelerations of the massless bodies:
+  //   a[b2] = Σ μ[b1] (q[b1] - q[b2]) / |q[b1] - q[b2]|³
+  // where the sum is over the massive bodies, in the order of their indices.
+  // The gravitational parameters are in m³ s⁻², the positions in m and the
+  // accelerations in m s⁻², in double precision.  The positions and the
+  // accelerations are interleaved, i.e., the coordinates of body b are at
+  // indices 3 b, 3 b + 1 and 3 b + 2.  All the massless bodies of an
+  // evaluation of the forces are submitted in a single batch, so that there is
+  // one round trip to the device per stage of the integrator.  Returns false
+  // if the computation failed, e.g., because the device was lost, in which
+  // case the contents of |accelerations| are unspecified and the caller
+  // computes the accelerations on the processor.
+  virtual bool ComputeAccelerations(
+      std::vector<double> const& gravitational_parameters,
+      std::vector<double> const& massive_positions,
+      std::vector<double> const& massless_positions,
+      not_null<std::vector<double>*> const accelerations) = 0;
+};
+
+// A backend that runs on the processor.  It performs the operations of the
+// scalar loop of |NBodySystem| in the same order, so it is the reference
+// against which the results of the devices are checked.
+class CPUMasslessAccelerationsBackend : public MasslessAccelerationsBackend {
+ public:
+  // Always returns true.
+  bool ComputeAccelerations(
+      std::vector<double> const& gravitational_parameters,
+      std::vector<double> const& massive_positions,
+      std::vector<double> const& massless_positions,
+      not_null<std::vector<double>*> const accelerations) override;
+};
+
+}  // namespace physics
+}  // namespace principia
+
+#include "physics/massless_accelerations_backend_body.hpp"
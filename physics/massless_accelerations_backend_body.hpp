@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include "physics/massless_accelerations_backend.hpp"
+
+#include <cmath>
+#include <cstddef>
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace physics {
+
+inline bool CPUMasslessAccelerationsBackend::ComputeAccelerations(
+    std::vector<double> const& gravitational_parameters,
+    std::vector<double> const& massive_positions,
+    std::vector<double> const& massless_positions,
+    not_null<std::vector<double>*> const accelerations) {
+  std::size_t const number_of_massive_bodies = gravitational_parameters.size();
+  CHECK_EQ(3 * number_of_massive_bodies, massive_positions.size());
+  CHECK_EQ(0, massless_positions.size() % 3);
+  std::size_t const number_of_massless_bodies = massless_positions.size() / 3;
+  accelerations->resize(massless_positions.size());
+  for (std::size_t b2 = 0; b2 < number_of_massless_bodies; ++b2) {
+    double a0 = 0;
+    double a1 = 0;
+    double a2 = 0;
+    for (std::size_t b1 = 0; b1 < number_of_massive_bodies; ++b1) {
+      double const Δq0 = massive_positions[3 * b1] -
+                         massless_positions[3 * b2];
+      double const Δq1 = massive_positions[3 * b1 + 1] -
+                         massless_positions[3 * b2 + 1];
+      double const Δq2 = massive_positions[3 * b1 + 2] -
+                         massless_positions[3 * b2 + 2];
+      double const r_squared = Δq0 * Δq0 + Δq1 * Δq1 + Δq2 * Δq2;
+      double const one_over_r_cubed =
+          std::sqrt(r_squared) / (r_squared * r_squared);
+      double const μ1_over_r_cubed =
+          gravitational_parameters[b1] * one_over_r_cubed;
+      a0 += Δq0 * μ1_over_r_cubed;
+      a1 += Δq1 * μ1_over_r_cubed;
+      a2 += Δq2 * μ1_over_r_cubed;
+    }
+    (*accelerations)[3 * b2] = a0;
+    (*accelerations)[3 * b2 + 1] = a1;
+    (*accelerations)[3 * b2 + 2] = a2;
+  }
+  return true;
+}
+
+}  // namespace physics
+}  // namespace principia
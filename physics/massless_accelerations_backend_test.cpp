@@ -0,0 +1,58 @@
+﻿#include "physics/massless_accelerations_backend.hpp"
+
+#include <cmath>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "testing_utilities/almost_equals.hpp"
+
+using principia::testing_utilities::AlmostEquals;
+using testing::ElementsAre;
+using testing::Eq;
+
+namespace principia {
+namespace physics {
+
+class MasslessAccelerationsBackendTest : public testing::Test {
+ protected:
+  CPUMasslessAccelerationsBackend backend_;
+};
+
+TEST_F(MasslessAccelerationsBackendTest, NoMassiveBodies) {
+  std::vector<double> accelerations;
+  EXPECT_TRUE(backend_.ComputeAccelerations({} /*gravitational_parameters*/,
+                                            {} /*massive_positions*/,
+                                            {1, 2, 3, 4, 5, 6},
+                                            &accelerations));
+  EXPECT_THAT(accelerations, ElementsAre(0, 0, 0, 0, 0, 0));
+}
+
+// Two massive bodies on the x axis, and massless bodies on the y axis and
+// between the massive bodies.
+TEST_F(MasslessAccelerationsBackendTest, TwoMassiveBodies) {
+  std::vector<double> const gravitational_parameters = {4, 1};
+  std::vector<double> const massive_positions = {0, 0, 0,
+                                                 3, 0, 0};
+  std::vector<double> const massless_positions = {0, 2, 0,
+                                                  2, 0, 0};
+  std::vector<double> accelerations;
+  EXPECT_TRUE(backend_.ComputeAccelerations(gravitational_parameters,
+                                            massive_positions,
+                                            massless_positions,
+                                            &accelerations));
+  ASSERT_THAT(accelerations.size(), Eq(6));
+  // The first body contributes 4 / 2² along -y, the second 1 / 13 along the
+  // unit vector (3, -2, 0) / √13.
+  EXPECT_THAT(accelerations[0], AlmostEquals(3 / (13 * std::sqrt(13.0)), 1));
+  EXPECT_THAT(accelerations[1],
+              AlmostEquals(-1 - 2 / (13 * std::sqrt(13.0)), 0));
+  EXPECT_THAT(accelerations[2], Eq(0));
+  // The bodies pull in opposite directions with the same strength.
+  EXPECT_THAT(accelerations[3], Eq(0));
+  EXPECT_THAT(accelerations[4], Eq(0));
+  EXPECT_THAT(accelerations[5], Eq(0));
+}
+
+}  // namespace physics
+}  // namespace principia
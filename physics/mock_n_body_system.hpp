@@ -1,6 +1,8 @@
 ﻿
 #pragma once
 
+#include <map>
+
 #include "physics/n_body_system.hpp"
 
 #include "gmock/gmock.h"
@@ -11,6 +13,10 @@ namespace physics {
 template<typename InertialFrame>
 class MockNBodySystem : public NBodySystem<InertialFrame> {
  public:
+  // Because the commas of the template arguments don't go well with the
+  // macros.
+  using Parents = std::map<MassiveBody const*, MassiveBody const*>;
+
   MockNBodySystem() = default;
 
   MOCK_CONST_METHOD6_T(
@@ -22,6 +28,152 @@ class MockNBodySystem : public NBodySystem<InertialFrame> {
            bool const tmax_is_exact,
            typename NBodySystem<InertialFrame>::Trajectories const&
                trajectories));
+
+  MOCK_CONST_METHOD6_T(
+      Integrate,
+      void(SymplecticIntegrator<Length, Speed> const& integrator,
+           Instant const& tmax,
+           Time const& Δt,
+           typename NBodySystem<InertialFrame>::AdaptiveSampling const&
+               sampling,
+           bool const tmax_is_exact,
+           typename NBodySystem<InertialFrame>::Trajectories const&
+               trajectories));
+
+  MOCK_CONST_METHOD7_T(
+      Integrate,
+      void(SymplecticIntegrator<Length, Speed> const& integrator,
+           Instant const& tmax,
+           Time const& Δt,
+           int const sampling_period,
+           bool const tmax_is_exact,
+           typename NBodySystem<InertialFrame>::Trajectories const&
+               trajectories,
+           not_null<typename NBodySystem<InertialFrame>::MassiveBodiesSteps*>
+               const massive_steps));
+
+  MOCK_CONST_METHOD7_T(
+      Integrate,
+      void(SymplecticIntegrator<Length, Speed> const& integrator,
+           Instant const& tmax,
+           Time const& Δt,
+           int const sampling_period,
+           bool const tmax_is_exact,
+           typename NBodySystem<InertialFrame>::Trajectories const&
+               trajectories,
+           not_null<SynchronizedHistories<InertialFrame>*> const histories));
+
+  MOCK_CONST_METHOD6_T(
+      IntegratePlan,
+      void(SymplecticIntegrator<Length, Speed> const& integrator,
+           Instant const& tmax,
+           Time const& Δt,
+           int const sampling_period,
+           bool const tmax_is_exact,
+           not_null<typename NBodySystem<InertialFrame>::Plan*> const plan));
+
+  MOCK_CONST_METHOD7_T(
+      IntegratePlan,
+      void(SymplecticIntegrator<Length, Speed> const& integrator,
+           Instant const& tmax,
+           Time const& Δt,
+           int const sampling_period,
+           bool const tmax_is_exact,
+           not_null<typename NBodySystem<InertialFrame>::Plan*> const plan,
+           not_null<typename NBodySystem<InertialFrame>::MassiveBodiesSteps*>
+               const massive_steps));
+
+  MOCK_CONST_METHOD7_T(
+      IntegrateMasslessBodiesInSteps,
+      void(SymplecticIntegrator<Length, Speed> const& integrator,
+           typename NBodySystem<InertialFrame>::MassiveBodiesSteps const&
+               massive_steps,
+           Instant const& tmax,
+           Time const& Δt,
+           int const sampling_period,
+           bool const tmax_is_exact,
+           typename NBodySystem<InertialFrame>::Trajectories const&
+               trajectories));
+
+  MOCK_CONST_METHOD6_T(
+      IntegrateAdaptively,
+      void(EmbeddedExplicitRungeKuttaNyströmIntegrator<Length> const&
+               integrator,
+           Instant const& tmax,
+           Time const& first_time_step,
+           Length const& length_integration_tolerance,
+           Speed const& speed_integration_tolerance,
+           typename NBodySystem<InertialFrame>::Trajectories const&
+               trajectories));
+
+  MOCK_CONST_METHOD6_T(
+      IntegrateWithBlockTimeSteps,
+      void(SymplecticIntegrator<Length, Speed> const& integrator,
+           Instant const& tmax,
+           Time const& Δt,
+           double const timescale_fraction,
+           int const max_level,
+           typename NBodySystem<InertialFrame>::Trajectories const&
+               trajectories));
+
+  MOCK_CONST_METHOD7_T(
+      IntegrateMasslessBodies,
+      void(SymplecticIntegrator<Length, Speed> const& integrator,
+           not_null<Ephemeris<InertialFrame>*> const ephemeris,
+           Instant const& tmax,
+           Time const& Δt,
+           int const sampling_period,
+           bool const tmax_is_exact,
+           typename NBodySystem<InertialFrame>::Trajectories const&
+               trajectories));
+
+  MOCK_CONST_METHOD8_T(
+      IntegrateMasslessBodiesRelativeToParents,
+      void(SymplecticIntegrator<Length, Speed> const& integrator,
+           not_null<Ephemeris<InertialFrame>*> const ephemeris,
+           std::vector<std::size_t> const& parents,
+           Instant const& tmax,
+           Time const& Δt,
+           int const sampling_period,
+           bool const tmax_is_exact,
+           typename NBodySystem<InertialFrame>::Trajectories const&
+               trajectories));
+
+  MOCK_CONST_METHOD7_T(
+      IntegrateMassless,
+      void(SymplecticIntegrator<Length, Speed> const& integrator,
+           typename NBodySystem<InertialFrame>::ReadonlyTrajectories const&
+               massive_trajectories,
+           Instant const& tmax,
+           Time const& Δt,
+           int const sampling_period,
+           bool const tmax_is_exact,
+           typename NBodySystem<InertialFrame>::Trajectories const&
+               trajectories));
+
+  MOCK_CONST_METHOD7_T(
+      IntegrateWisdomHolman,
+      void(WisdomHolmanIntegrator<Length, Speed> const& integrator,
+           Parents const& parents,
+           Instant const& tmax,
+           Time const& Δt,
+           int const sampling_period,
+           bool const tmax_is_exact,
+           typename NBodySystem<InertialFrame>::Trajectories const&
+               trajectories));
+
+  MOCK_CONST_METHOD8_T(
+      IntegrateWisdomHolman,
+      void(WisdomHolmanIntegrator<Length, Speed> const& integrator,
+           Parents const& parents,
+           Instant const& tmax,
+           Time const& Δt,
+           int const sampling_period,
+           bool const tmax_is_exact,
+           typename NBodySystem<InertialFrame>::Trajectories const&
+               trajectories,
+           not_null<typename NBodySystem<InertialFrame>::MassiveBodiesSteps*>
+               const massive_steps));
 };
 
 }  // namespace physics
@@ -1,41 +1,103 @@
 ﻿#pragma once
 
+#include <array>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <set>
 #include <vector>
 
 #include "base/not_null.hpp"
+#include "base/thread_pool.hpp"
+#include "geometry/grassmann.hpp"
 #include "geometry/named_quantities.hpp"
+#include "geometry/r3_element.hpp"
+#include "integrators/embedded_explicit_runge_kutta_nystrom_integrator.hpp"
+#include "integrators/force_gradient_integrator.hpp"
+#include "integrators/gauss_jackson_integrator.hpp"
+#include "integrators/parareal_integrator.hpp"
+#include "integrators/symmetric_linear_multistep_integrator.hpp"
 #include "integrators/symplectic_integrator.hpp"
+#include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "integrators/wisdom_holman_integrator.hpp"
 #include "physics/body.hpp"
+#include "physics/degrees_of_freedom.hpp"
 #include "physics/massive_body.hpp"
+#include "physics/massless_accelerations_backend.hpp"
+#include "physics/massless_body.hpp"
+#include "physics/synchronized_histories.hpp"
 #include "physics/trajectory.hpp"
+#include "quantities/named_quantities.hpp"
 #include "quantities/quantities.hpp"
 
 using principia::base::not_null;
+using principia::base::ThreadPool;
 using principia::geometry::Instant;
+using principia::geometry::R3Element;
+using principia::geometry::Vector;
+using principia::integrators::DoublePrecision;
+using principia::integrators::DoublePrecisionVector;
+using principia::integrators::EmbeddedExplicitRungeKuttaNyströmIntegrator;
+using principia::integrators::ForceGradientIntegrator;
+using principia::integrators::GaussJacksonIntegrator;
+using principia::integrators::PararealIntegrator;
+using principia::integrators::SPRKIntegrator;
+using principia::integrators::SymmetricLinearMultistepIntegrator;
 using principia::integrators::SymplecticIntegrator;
+using principia::integrators::WisdomHolmanIntegrator;
 using principia::quantities::Acceleration;
+using principia::quantities::Angle;
+using principia::quantities::Exponentiation;
+using principia::quantities::GravitationalParameter;
 using principia::quantities::Length;
+using principia::quantities::Order2ZonalCoefficient;
+using principia::quantities::Product;
 using principia::quantities::Speed;
 using principia::quantities::Time;
 
 namespace principia {
 namespace physics {
 
+template<typename Frame>
+class Ephemeris;
+
 template<typename Frame>
 class NBodySystem {
   static_assert(Frame::is_inertial, "Frame must be inertial");
 
  public:
   using Trajectories = std::vector<not_null<Trajectory<Frame>*>>;  // Not owned.
+  using ReadonlyTrajectories = std::vector<not_null<Trajectory<Frame> const*>>;
+
+  // The layout of the state vectors passed to the integrator.
+  enum class Layout {
+    // x0, y0, z0, x1, y1, z1, ...
+    kInterleaved,
+    // x0, x1, ..., y0, y1, ..., z0, z1, ...  Each block of coordinates is
+    // padded to a multiple of |kCacheLineLength| elements, so that the blocks
+    // are at a multiple of a cache line from the start of the vector.  The
+    // state vectors are allocated by the integrators with the default
+    // allocator, so the blocks are not necessarily aligned on cache lines: two
+    // consecutive blocks may share at most one cache line.
+    kStructureOfArrays,
+  };
+
+  // The number of |double|s in a cache line.
+  static std::size_t const kCacheLineLength = 64 / sizeof(double);
 
-  NBodySystem() = default;
+  // Both layouts yield bitwise identical results.
+  explicit NBodySystem(Layout const layout = Layout::kInterleaved);
   virtual ~NBodySystem() = default;
 
-  // The |integrator| must already have been initialized.  All the
-  // |trajectories| must have the same |last_time()| and must be for distinct
-  // bodies.
+  // The |integrator| must already have been initialized.  It must be an
+  // |SPRKIntegrator|, a |SymmetricLinearMultistepIntegrator| or a
+  // |ForceGradientIntegrator|.  All the |trajectories| must have the same
+  // |last_time()| and must be for distinct bodies.  The scratch storage of the
+  // integrator is kept in this object and reused across calls, so this
+  // function and |IntegrateAdaptively| must not be called concurrently on the
+  // same object.  With a |ForceGradientIntegrator|, the modified accelerations
+  // are computed by |ComputeModifiedGravitationalAccelerations|, and the close
+  // encounters are not regularised.
   virtual void Integrate(SymplecticIntegrator<Length, Speed> const& integrator,
                          Instant const& tmax,
                          Time const& Δt,
@@ -43,39 +105,1194 @@ class NBodySystem {
                          bool const tmax_is_exact,
                          Trajectories const& trajectories) const;
 
+  // The choice of the states appended to the trajectories by the overload of
+  // |Integrate| below.
+  struct AdaptiveSampling {
+    // A state is appended when the velocity of one of the trajectories has
+    // turned by more than this angle since the last appended state.
+    Angle angular_tolerance;
+    // A state is also appended when this many steps have elapsed since the last
+    // appended state, e.g., for bodies in uniform motion.  Must be positive.
+    int maximum_sampling_period;
+  };
+
+  // Same as above, but the states appended to the |trajectories| are chosen by
+  // |sampling| instead of being every |sampling_period| steps, so that they
+  // are denser where the trajectories are curved and sparser where they are
+  // straight.  The state at the end of the integration is always appended.
+  // The angles are those of the velocities in |Frame|.
+  virtual void Integrate(SymplecticIntegrator<Length, Speed> const& integrator,
+                         Instant const& tmax,
+                         Time const& Δt,
+                         AdaptiveSampling const& sampling,
+                         bool const tmax_is_exact,
+                         Trajectories const& trajectories) const;
+
+  // Same as |Integrate|, but statically dispatched on the type of the
+  // |integrator|, e.g., |SPRKIntegrator<Length, Speed>|.  The computation of
+  // the forces may then be inlined in the integrator.  |workspace| is the
+  // scratch storage of the integrator, its contents on entry are irrelevant;
+  // reusing it across calls avoids reallocations.  The sampled states are
+  // appended to the |trajectories| as the integrator produces them.
+  // |Integrate| forwards to this function.
+  template<typename Integrator>
+  void IntegrateStatically(
+      Integrator const& integrator,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      Trajectories const& trajectories,
+      not_null<typename Integrator::Workspace*> const workspace) const;
+
+  // Same as the first |Integrate|, but the sampled states are appended to
+  // |*histories|, whose column |i| is the history of |trajectories[i]|: each
+  // sampled step appends one time to the shared axis and one row of states.
+  // Only the final state is appended to the |trajectories|, so that their last
+  // points are the initial state of the next integration, and the points
+  // before it may be forgotten.  If |*histories| is empty, the initial state is
+  // appended to it first, otherwise its last time must be the common last time
+  // of the |trajectories|.  The |integrator| must be an |SPRKIntegrator| or a
+  // |SymmetricLinearMultistepIntegrator|; the close encounters are not
+  // regularised.
+  virtual void Integrate(
+      SymplecticIntegrator<Length, Speed> const& integrator,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      Trajectories const& trajectories,
+      not_null<SynchronizedHistories<Frame>*> const histories) const;
+
+  // Integrates the |trajectories| up to exactly |tmax| with the adaptive step
+  // size |integrator|, starting with a step of |first_time_step|, and appends
+  // to each of them its state at |tmax|.  The tolerances are on the absolute
+  // error on each coordinate of the positions and velocities over one step.
+  // The requirements on the |trajectories| are the same as for |Integrate|.
+  virtual void IntegrateAdaptively(
+      EmbeddedExplicitRungeKuttaNyströmIntegrator<Length> const& integrator,
+      Instant const& tmax,
+      Time const& first_time_step,
+      Length const& length_integration_tolerance,
+      Speed const& speed_integration_tolerance,
+      Trajectories const& trajectories) const;
+
+  // Integrates the |trajectories| with hierarchical block time steps.  The
+  // massive bodies are integrated together with the step |Δt|.  Each massless
+  // body is then integrated with the step |Δt| / 2ⁿ, where n ≤ |max_level| is
+  // the smallest integer such that this step doesn't exceed
+  // |timescale_fraction| times the free-fall time scale of the body with
+  // respect to the massive bodies at the beginning of the integration.  At the
+  // intermediate steps the massive bodies are interpolated using cubic Hermite
+  // polynomials between their states at the steps of size |Δt|.  The last step
+  // is at or before |tmax|, as with |Integrate| with |tmax_is_exact| false;
+  // only the state at that time is appended to the |trajectories|.  There must
+  // be at least one massive body.  The massive bodies get the same results as
+  // with |Integrate|.
+  virtual void IntegrateWithBlockTimeSteps(
+      SymplecticIntegrator<Length, Speed> const& integrator,
+      Instant const& tmax,
+      Time const& Δt,
+      double const timescale_fraction,
+      int const max_level,
+      Trajectories const& trajectories) const;
+
+  // Integrates the massless |trajectories| in the gravitational field of the
+  // massive bodies of the |ephemeris|, which is prolonged as needed.  The
+  // parameters have the same meaning as for |Integrate|, except that the
+  // |integrator| must be an |SPRKIntegrator|, a |GaussJacksonIntegrator| or a
+  // |PararealIntegrator|; the second, with one or two evaluations of the forces
+  // per step, is much cheaper for long predictions, and the third spreads them
+  // over the threads of its pool.  The same holds for the other integrations of
+  // massless bodies in a field below.  The |trajectories| must not be for
+  // massive bodies, and their last time must be covered by the |ephemeris|.
+  virtual void IntegrateMasslessBodies(
+      SymplecticIntegrator<Length, Speed> const& integrator,
+      not_null<Ephemeris<Frame>*> const ephemeris,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      Trajectories const& trajectories) const;
+
+  // Same as |IntegrateMasslessBodies|, but with Encke's method: each of the
+  // |trajectories| is integrated as an offset from the massive body of the
+  // |ephemeris| whose index is the element of |parents| at the same position,
+  // and the acceleration of that body in the field of the others is subtracted
+  // from its own.  The offsets being much smaller than the positions, fewer
+  // bits are lost to round-off, which permits larger steps for the same
+  // accuracy.  With the hierarchical force model the subtracted accelerations
+  // are still computed directly.  If |parents| is empty, this is exactly
+  // |IntegrateMasslessBodies|.
+  virtual void IntegrateMasslessBodiesRelativeToParents(
+      SymplecticIntegrator<Length, Speed> const& integrator,
+      not_null<Ephemeris<Frame>*> const ephemeris,
+      std::vector<std::size_t> const& parents,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      Trajectories const& trajectories) const;
+
+  // The copies of a massless body returned by |IntegrateEnsemble|, and their
+  // trajectories, in the same order.  The trajectories are for the bodies.
+  struct Ensemble {
+    std::vector<not_null<std::unique_ptr<MasslessBody>>> bodies;
+    std::vector<not_null<std::unique_ptr<Trajectory<Frame>>>> trajectories;
+  };
+
+  // Integrates an ensemble of copies of a massless body whose states at |time|
+  // are |degrees_of_freedom| displaced by each of the |perturbations|, e.g.,
+  // for the dispersion of a burn, in the field of the |ephemeris| and relative
+  // to its body at index |parent|.  The copies are the massless bodies of a
+  // single integration: the massive bodies are evaluated once per step for the
+  // entire ensemble, and with |Layout::kStructureOfArrays| the copies are the
+  // lanes of the vectorized kernels that accumulate the acceleration due to
+  // each massive body.  This is much cheaper than integrating the copies one
+  // by one.  The other parameters are as for
+  // |IntegrateMasslessBodiesRelativeToParents|.
+  virtual Ensemble IntegrateEnsemble(
+      SymplecticIntegrator<Length, Speed> const& integrator,
+      not_null<Ephemeris<Frame>*> const ephemeris,
+      std::size_t const parent,
+      Instant const& time,
+      DegreesOfFreedom<Frame> const& degrees_of_freedom,
+      std::vector<RelativeDegreesOfFreedom<Frame>> const& perturbations,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact) const;
+
+  // The derivatives of the degrees of freedom of a massless body at |time|
+  // with respect to its degrees of freedom at the start of an integration,
+  // i.e., the state transition matrix, as returned by
+  // |IntegrateStateTransitionMatrices|.  To keep the units straight, the six
+  // columns of the matrix are stored as the perturbations at |time| caused by
+  // perturbations of 1 m of each coordinate of the initial position, followed
+  // by those caused by perturbations of 1 m/s of each coordinate of the
+  // initial velocity.
+  struct StateTransitionMatrix {
+    // Returns the first-order perturbation at |time| caused by the
+    // |perturbation| of the initial degrees of freedom.
+    RelativeDegreesOfFreedom<Frame> operator()(
+        RelativeDegreesOfFreedom<Frame> const& perturbation) const;
+
+    Instant time;
+    // The six columns.
+    std::vector<RelativeDegreesOfFreedom<Frame>> columns;
+  };
+
+  // Integrates the massless |trajectory| in the field of the |ephemeris| as
+  // |IntegrateMasslessBodies| with the |integrator|, together with its
+  // variational equations, whose gravity gradient is computed from the same
+  // positions of the massive bodies as the accelerations, so that the
+  // derivatives of the numerical solution come with a single integration,
+  // e.g., for the Newton iterations of the targeting of a manœuvre.  The state
+  // of the body at each of the |times|, which must be increasing and after the
+  // last time of |trajectory|, is appended to |trajectory|, and the state
+  // transition matrices from the last time of |trajectory| to the |times| are
+  // returned, in the same order.  The gradient is that of the point masses;
+  // the gradients of the zonal harmonics and of the intrinsic acceleration
+  // are neglected.
+  virtual std::vector<StateTransitionMatrix> IntegrateStateTransitionMatrices(
+      SPRKIntegrator<Length, Speed> const& integrator,
+      not_null<Ephemeris<Frame>*> const ephemeris,
+      std::vector<Instant> const& times,
+      Time const& Δt,
+      not_null<Trajectory<Frame>*> const trajectory) const;
+
+  // The states of the massive bodies at the steps of an integration, see below.
+  class MassiveBodiesSteps;
+
+  // The setup of the integration of a set of trajectories, see below.
+  class Plan;
+
+  // Makes |*plan| describe the integration of the |trajectories|, which must be
+  // for distinct bodies.  Only the trajectories that were not already in
+  // |*plan| are classified as massive oblate, massive spherical or massless,
+  // and the constants of the massive bodies are only extracted again if the
+  // massive trajectories, or the parameters set by
+  // |SetHierarchicalForceModel| or |set_oblateness_accuracy|, have changed.
+  // If nothing has changed since the last call, this only compares the
+  // |trajectories| to those of that call.  The body of a trajectory must not
+  // change while the trajectory is in |*plan|.  |*plan| must only be used with
+  // this object.
+  void UpdatePlan(Trajectories const& trajectories,
+                  not_null<Plan*> const plan) const;
+
+  // Same as the first |Integrate|, but for the trajectories of |*plan|, which
+  // must have been updated by |UpdatePlan| since this object last changed
+  // parameters.  The only setup is the extraction of the initial state, in
+  // buffers owned by |*plan|.  The results are bitwise identical to those of
+  // |Integrate|.
+  virtual void IntegratePlan(
+      SymplecticIntegrator<Length, Speed> const& integrator,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      not_null<Plan*> const plan) const;
+
+  // Same as the recording |Integrate|, but for the trajectories of |*plan|.
+  virtual void IntegratePlan(
+      SymplecticIntegrator<Length, Speed> const& integrator,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      not_null<Plan*> const plan,
+      not_null<MassiveBodiesSteps*> const massive_steps) const;
+
+  // Same as the first |Integrate|, but also records in |*massive_steps| the
+  // states of the massive bodies of the |trajectories| at the start of the
+  // integration and after each step, replacing its previous contents.  Massless
+  // bodies may then be integrated over the same interval by
+  // |IntegrateMasslessBodiesInSteps| without integrating the massive bodies
+  // again.  The results are the same as with the first |Integrate|.
+  virtual void Integrate(SymplecticIntegrator<Length, Speed> const& integrator,
+                         Instant const& tmax,
+                         Time const& Δt,
+                         int const sampling_period,
+                         bool const tmax_is_exact,
+                         Trajectories const& trajectories,
+                         not_null<MassiveBodiesSteps*> const massive_steps)
+      const;
+
+  // Integrates the massless |trajectories| in the gravitational field of the
+  // massive bodies recorded in |massive_steps|.  Between the recorded steps the
+  // positions of the massive bodies are obtained by cubic Hermite
+  // interpolation, as in |IntegrateWithBlockTimeSteps|.  The last time of the
+  // |trajectories| and |tmax| must be in the recorded interval, which must
+  // contain at least one step.  The other parameters have the same meaning as
+  // for |Integrate|.
+  virtual void IntegrateMasslessBodiesInSteps(
+      SymplecticIntegrator<Length, Speed> const& integrator,
+      MassiveBodiesSteps const& massive_steps,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      Trajectories const& trajectories) const;
+
+  // Integrates the massless |trajectories| in the gravitational field of the
+  // massive bodies of |massive_trajectories|, which are not integrated: their
+  // positions are evaluated from their existing points by
+  // |Trajectory::EvaluateDegreesOfFreedom|, i.e., by cubic Hermite
+  // interpolation.  Only the massless bodies are in the state of the
+  // integrator, so the work per evaluation of the forces is proportional to
+  // the number of massless bodies, and a single vessel may be integrated
+  // alone.  The |massive_trajectories| must cover the interval from the last
+  // time of the |trajectories| to |tmax| and must be for distinct massive
+  // bodies.  The other parameters have the same meaning as for |Integrate|.
+  virtual void IntegrateMassless(
+      SymplecticIntegrator<Length, Speed> const& integrator,
+      ReadonlyTrajectories const& massive_trajectories,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      Trajectories const& trajectories) const;
+
+  // Same as the first |Integrate|, but with the mixed-variable symplectic
+  // |integrator|, which must already have been initialized.  The massive
+  // bodies are integrated in hierarchical Jacobi coordinates, where the parent
+  // of a body is given by |parents| as for |SetHierarchicalForceModel|: each
+  // body, in order of increasing initial distance to its parent, is merged
+  // with the subsystem made of its parent and of the bodies already merged
+  // with it, and the position of the subsystem of the body relative to that
+  // subsystem follows a Keplerian orbit in the drifts.  Exactly one massive
+  // body must be a root.  The massless bodies drift in straight lines and
+  // feel all the forces in the kicks.  With a hierarchical system such as the
+  // solar system this allows steps much longer than with |Integrate| for the
+  // same accuracy on the massive bodies.
+  virtual void IntegrateWisdomHolman(
+      WisdomHolmanIntegrator<Length, Speed> const& integrator,
+      std::map<MassiveBody const*, MassiveBody const*> const& parents,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      Trajectories const& trajectories) const;
+
+  // Same as above, but also records in |*massive_steps| the states of the
+  // massive bodies, as the recording |Integrate|.
+  virtual void IntegrateWisdomHolman(
+      WisdomHolmanIntegrator<Length, Speed> const& integrator,
+      std::map<MassiveBody const*, MassiveBody const*> const& parents,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      Trajectories const& trajectories,
+      not_null<MassiveBodiesSteps*> const massive_steps) const;
+
+  Layout layout() const;
+
+  // If |thread_pool| is not null, the accelerations of the massless bodies are
+  // computed in parallel on its threads.  The results are bitwise identical to
+  // those of the serial computation.  No transfer of ownership.
+  void set_thread_pool(ThreadPool* const thread_pool);
+
+  // The massless bodies are split into |chunks_per_thread| chunks per thread
+  // of the pool.  More chunks balance the load better when some threads are
+  // preempted, e.g., by the threads of the game, at the cost of more
+  // scheduling.  Doesn't affect the results.  Must be positive; 1 by default.
+  void set_massless_chunks_per_thread(int const chunks_per_thread);
+
+  // If |backend| is not null, the point-mass accelerations of the massless
+  // bodies are computed by it, while those of the massive bodies, the
+  // intrinsic accelerations and the rest of the integration stay on the
+  // processor.  The backend is not used, and the accelerations are computed as
+  // usual, if there are massive oblate bodies, if the hierarchical force model
+  // or the interaction lists are enabled, or if |backend| fails.  The results
+  // may differ from those of the processor in the last bits, depending on the
+  // arithmetic of the device.  No transfer of ownership.
+  void set_massless_accelerations_backend(
+      MasslessAccelerationsBackend* const backend);
+
+  // If |tolerance| is positive, the accelerations of the massless bodies are
+  // computed with a hierarchical force model.  The massive bodies form a tree
+  // where the parent of a body is given by |parents|; the bodies that are not
+  // keys of |parents|, or whose parent is not integrated, are roots.  The
+  // subsystem made of a body and its descendants is replaced by a point mass at
+  // its barycentre, plus its quadrupole moment if |use_quadrupole| is true,
+  // when the massless body is far enough that the estimated relative error on
+  // the acceleration exerted by the subsystem, (R / d)² for the monopole and
+  // (R / d)³ with the quadrupole, does not exceed |tolerance|.  Here R is the
+  // largest distance of a member of the subsystem from its barycentre and d is
+  // the distance of the massless body from that barycentre; the criterion is
+  // checked at each evaluation of the forces.  Otherwise the subsystem is
+  // opened: its primary acts directly, including its oblateness, and the
+  // subsystems of its children are examined in turn.  The accelerations of the
+  // massive bodies are unaffected.  |tolerance| must be in [0, 1[; 0, the
+  // default, means that the forces are summed directly.  Cannot be combined
+  // with the interaction lists.  No transfer of ownership of the bodies.
+  void SetHierarchicalForceModel(
+      std::map<MassiveBody const*, MassiveBody const*> const& parents,
+      double const tolerance,
+      bool const use_quadrupole);
+
+  // If |oblateness_accuracy| is positive, the zonal harmonics of an oblate body
+  // are ignored beyond the distance where a bound on the acceleration that they
+  // exert falls below |oblateness_accuracy| times the acceleration exerted by
+  // the body as a point mass.  This distance is computed once per integration.
+  // |oblateness_accuracy| must be in [0, 1[; 0, the default, means that the
+  // zonal harmonics are always taken into account.
+  void set_oblateness_accuracy(double const oblateness_accuracy);
+
+  // If |tolerance| is positive, each massless body integrated together with
+  // the massive bodies by |Integrate|, |IntegrateAdaptively| or a |Plan| has an
+  // interaction list, recomputed at the first evaluation of the forces of an
+  // integration and then every |refresh_period| evaluations.  At that time the
+  // dominant body, which exerts the largest acceleration on the massless body,
+  // is found, and every other massive body whose tidal contribution, i.e., the
+  // difference between its accelerations on the massless body and on the
+  // dominant body, exceeds |tolerance| times the acceleration of the dominant
+  // body enters the list.  At each evaluation the dominant body and the bodies
+  // of the list act directly, including their oblateness, and the other bodies
+  // are accounted for by the acceleration that they exert on the dominant body,
+  // obtained from the total acceleration of the dominant body by subtracting
+  // the point-mass contributions of the bodies of the list.  The cost for a
+  // massless body is thus proportional to the length of its list instead of the
+  // number of massive bodies.  The sum of the tidal contributions left out,
+  // relative to the acceleration of the dominant body, is an estimate of the
+  // error, see |Statistics|.  The accelerations of the massive bodies are
+  // unaffected.  |tolerance| must be in [0, 1[; 0, the default, means that the
+  // forces are summed directly.  Cannot be combined with the hierarchical force
+  // model.
+  void SetInteractionLists(double const tolerance, int const refresh_period);
+
+  // If |recentring| is true, each integration is carried out relative to the
+  // centre of mass of the massive bodies being integrated, or to the centroid
+  // of the massless bodies if there are none, and to a time in the middle of
+  // the integration interval.  The initial positions relative to that centre
+  // carry the rounding error of their subtraction, so that the round-off does
+  // not grow with the distance to the origin of |Frame|; this may permit
+  // larger steps or cheaper integrators.  The bounds of the integration
+  // interval are preserved exactly, but the results are not bitwise identical
+  // to those obtained without recentring.  False by default.
+  void set_recentring(bool const recentring);
+
+  // If |timescale_fraction| is positive, the integrations by the first and the
+  // recording |Integrate| and by |IntegratePlan| treat separately the massless
+  // bodies in a close encounter, i.e., those for which |Δt| exceeds
+  // |timescale_fraction| times the free-fall time scale √(r³ / μ) with respect
+  // to a massive body at the beginning of the integration; equivalently, their
+  // distance r to that body is below ∛(μ (Δt / timescale_fraction)²).  The
+  // other bodies are integrated as usual, with the given integrator and step,
+  // and the states of the massive bodies are recorded.  Each body in a close
+  // encounter is then integrated in the interpolated field of the massive
+  // bodies, as by |IntegrateMasslessBodiesInSteps|, relative to the massive
+  // body with the shortest time scale, by the logarithmic Hamiltonian leapfrog
+  // of Mikkola and Tanikawa (1999) and Preto and Tremaine (1999).  The Sundman
+  // transformation dt = r ds / μ of that method makes the steps proportional
+  // to the distance, and the Keplerian motion around the massive body is
+  // followed exactly except for the error on the time, so close passes cost a
+  // few more steps for these bodies only.  Only the state of a body in a close
+  // encounter at the end of the integration is appended to its trajectory.
+  // 0, the default, means that all the bodies are integrated together.
+  void set_close_encounter_timescale_fraction(double const timescale_fraction);
+
+  // Counters of the work done by the integrations of this object since its
+  // construction or the last call to |reset_statistics|.
+  struct Statistics {
+    // The number of evaluations of the accelerations of all the integrated
+    // bodies.
+    std::int64_t force_evaluations = 0;
+    // The number of these evaluations for which the accelerations of the
+    // massless bodies were computed by the |MasslessAccelerationsBackend|.
+    std::int64_t backend_force_evaluations = 0;
+    // The number of these evaluations that were modified by the gravity
+    // gradient for a |ForceGradientIntegrator|.
+    std::int64_t gradient_evaluations = 0;
+    // The number of states appended to the trajectories.
+    std::int64_t points_appended = 0;
+    // The largest estimate of the relative error on the acceleration of a
+    // massless body due to the bodies left out of its interaction list, when
+    // the lists were computed, see |SetInteractionLists|.
+    double interaction_list_error = 0;
+  };
+
+  Statistics const& statistics() const;
+  void reset_statistics();
+
  private:
-  using ReadonlyTrajectories = std::vector<not_null<Trajectory<Frame> const*>>;
+  using QuadrupoleMoment =
+      Product<GravitationalParameter, Exponentiation<Length, 2>>;
+
+  // The aggregate of a massive body and its descendants in the hierarchical
+  // force model at one evaluation of the forces.  The positions are in the
+  // coordinates of the state vectors.
+  struct Subsystem {
+    GravitationalParameter gravitational_parameter;
+    R3Element<Length> barycentre;
+    // The largest distance of a member from the |barycentre|.
+    Length radius;
+    // The traceless quadrupole moment Σ μ (3 s ⊗ s - s² 1), where s is the
+    // displacement of a member from the |barycentre|, in the order xx, yy, zz,
+    // xy, xz, yz.  Only computed if the quadrupole is used.
+    std::array<QuadrupoleMoment, 6> quadrupole;
+  };
+
+  // The tree of the massive bodies of an integration for the hierarchical
+  // force model, in terms of their indices in the state vectors.
+  struct Hierarchy {
+    double tolerance;
+    bool use_quadrupole;
+    std::vector<std::size_t> roots;
+    // The children of each massive body.
+    std::vector<std::vector<std::size_t>> children;
+    // The members of the subsystem of each massive body: the body itself and
+    // all its descendants.
+    std::vector<std::vector<std::size_t>> members;
+    // Recomputed by |ComputeSubsystems| before the accelerations of the
+    // massless bodies.  Only meaningful for the bodies that have children.
+    mutable std::vector<Subsystem> subsystems;
+  };
+
+  // The interaction lists of the massless bodies of an integration, see
+  // |SetInteractionLists|.  The massive bodies are designated by their indices
+  // in the state vectors, the massless bodies by their indices in the
+  // |massless_trajectories|.
+  struct InteractionLists {
+    double tolerance;
+    int refresh_period;
+    // The number of evaluations of the forces since the beginning of the
+    // integration.  The lists are recomputed when it is a multiple of
+    // |refresh_period|.
+    mutable std::int64_t evaluations;
+    // The dominant body of each massless body.
+    mutable std::vector<std::size_t> dominant_bodies;
+    // The other massive bodies that act directly on each massless body.
+    mutable std::vector<std::vector<std::size_t>> lists;
+    // The estimated relative error on the acceleration of each massless body
+    // when its list was computed.
+    mutable std::vector<double> errors;
+  };
+
+  // The constants of the massive bodies of an integration that enter the
+  // computation of the forces, in the order of the state vectors: massive
+  // oblate bodies first, then massive spherical bodies.  They are extracted
+  // once per integration so that the force kernels read them from flat arrays
+  // instead of going through the trajectories and the bodies.
+  struct MassiveBodiesTable {
+    std::vector<GravitationalParameter> gravitational_parameters;
+    // Only for the oblate bodies.
+    std::vector<Order2ZonalCoefficient> j2s;
+    std::vector<Vector<double, Frame>> axes;
+    // The coefficients Jn μ Rⁿ for n ≥ 3, in SI units.  Empty for the bodies
+    // that only have a J2 coefficient.
+    std::vector<std::vector<double>> higher_zonal_coefficients;
+    // The squares of the distances beyond which the zonal harmonics are
+    // ignored, infinite if they are always taken into account.
+    std::vector<Exponentiation<Length, 2>> oblateness_cutoffs_squared;
+  };
+
+  // The trajectories of an integration, in the order of the state vectors
+  // passed to the integrator: massive oblate bodies first, then massive
+  // spherical bodies, then massless bodies.
+  struct IntegrationData {
+    Trajectories trajectories;
+    ReadonlyTrajectories massive_oblate_trajectories;
+    ReadonlyTrajectories massive_spherical_trajectories;
+    ReadonlyTrajectories massless_trajectories;
+    MassiveBodiesTable massive_bodies;
+    // The length of a block of coordinates, see |Index|.
+    std::size_t stride;
+    // The common |last().time()| of the trajectories.
+    Instant initial_time;
+    // In the integrator itself, all quantities are "vectors" relative to these
+    // references, which are the origin of |Frame| and |Instant()| unless
+    // |recentring_| is true.
+    Position<Frame> reference_position;
+    Instant reference_time;
+    // Null if the forces are summed directly.
+    std::unique_ptr<Hierarchy const> hierarchy;
+    // Null if the massless bodies don't use interaction lists.
+    std::unique_ptr<InteractionLists const> interaction_lists;
+    // If not null, the sampled states are appended to these histories instead
+    // of the trajectories, and column |i| of the histories is the trajectory
+    // of index |history_columns[i]| in |trajectories|.  Not owned.
+    SynchronizedHistories<Frame>* histories = nullptr;
+    std::vector<std::size_t> history_columns;
+  };
+
+  // The partition of the trajectories in |IntegrationData|.
+  enum class BodyKind {
+    kMassiveOblate,
+    kMassiveSpherical,
+    kMassless,
+  };
+
+  // Checks the consistency of the |trajectories|, fills |*data| and the
+  // initial state of the integration up to |tmax|, laid out according to
+  // |layout_|.
+  void PrepareIntegration(
+      Trajectories const& trajectories,
+      Instant const& tmax,
+      not_null<IntegrationData*> const data,
+      not_null<std::vector<DoublePrecision<Length>>*> const positions,
+      not_null<std::vector<DoublePrecision<Speed>>*> const velocities) const;
+
+  // Checks that the trajectories of |*data| have the same last time, fills
+  // the times, references and stride of |*data|, and the initial state of the
+  // integration up to |tmax|, laid out according to |layout_|.  The vectors
+  // keep their capacity.
+  void PrepareInitialState(
+      Instant const& tmax,
+      not_null<IntegrationData*> const data,
+      not_null<std::vector<DoublePrecision<Length>>*> const positions,
+      not_null<std::vector<DoublePrecision<Speed>>*> const velocities) const;
+
+  // Integrates the trajectories of |data|, prepared in |*parameters|, as the
+  // recording |Integrate|.
+  template<typename Integrator>
+  void IntegrateAndRecord(
+      Integrator const& integrator,
+      IntegrationData const& data,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      not_null<typename Integrator::Parameters*> const parameters,
+      not_null<MassiveBodiesSteps*> const massive_steps,
+      not_null<typename Integrator::Workspace*> const workspace) const;
+
+  // Appends to |*close_trajectories| the massless |trajectories| in a close
+  // encounter for the step |Δt|, see
+  // |set_close_encounter_timescale_fraction|, and the others to
+  // |*other_trajectories|.  Returns true if there is a close encounter.
+  bool FindCloseEncounters(
+      Trajectories const& trajectories,
+      Time const& Δt,
+      not_null<Trajectories*> const other_trajectories,
+      not_null<Trajectories*> const close_trajectories) const;
 
-  // Computes the acceleration due to one body, |body1| (with index |b1| in the
-  // |q| and |result| arrays) on the bodies with indices [b2_begin, b2_end[ in
-  // |body2_trajectories|.  The template parameters specify what we know about
-  // the bodies, and therefore what forces apply.
-  template<bool body1_is_oblate,
+  // Integrates the |other_trajectories| as the recording |Integrate|, in
+  // |*massive_steps| if it is not null, and then each of the
+  // |close_trajectories| by |IntegrateCloseEncounter|.
+  void IntegrateWithCloseEncounters(
+      SymplecticIntegrator<Length, Speed> const& integrator,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      Trajectories const& other_trajectories,
+      Trajectories const& close_trajectories,
+      MassiveBodiesSteps* const massive_steps) const;
+
+  // Integrates the massless |trajectory|, whose last time must be the first
+  // time of |massive_steps|, up to the last time of |massive_steps| with the
+  // regularized method of |set_close_encounter_timescale_fraction|, and
+  // appends its final state.
+  void IntegrateCloseEncounter(
+      MassiveBodiesSteps const& massive_steps,
+      not_null<Trajectory<Frame>*> const trajectory) const;
+
+  // Makes |*massive_steps| ready to record the states of the massive bodies of
+  // |data| by |RecordStep|, and discards its previous contents.
+  void StartRecording(IntegrationData const& data,
+                      not_null<MassiveBodiesSteps*> const massive_steps) const;
+
+  // Records in |*massive_steps| the states of the massive bodies in the given
+  // state, laid out according to |layout_| for |data|.
+  void RecordStep(IntegrationData const& data,
+                  Time const& time,
+                  std::vector<Length> const& positions,
+                  std::vector<Speed> const& velocities,
+                  not_null<MassiveBodiesSteps*> const massive_steps) const;
+
+  // The binary mergers that define the hierarchical Jacobi coordinates of the
+  // m massive bodies of an integration.  The nodes are the massive bodies,
+  // with their indices in the state vectors, and the subsystems made by the
+  // mergers, the one made by merger j having index m + j.  The mergers come
+  // after those that made their nodes.  Jacobi coordinate 0 is the barycentre
+  // of the whole system, and Jacobi coordinate j + 1 is the position of node
+  // |rights[j]| relative to node |lefts[j]|.
+  struct JacobiTree {
+    std::vector<std::size_t> lefts;
+    std::vector<std::size_t> rights;
+    // The gravitational parameters of the nodes.
+    std::vector<GravitationalParameter> gravitational_parameters;
+  };
+
+  // Returns the tree of the massive bodies of |data| for the given |parents|,
+  // whose mergers are ordered by the distances in the Cartesian |positions|.
+  JacobiTree MakeJacobiTree(
+      IntegrationData const& data,
+      std::map<MassiveBody const*, MassiveBody const*> const& parents,
+      std::vector<Length> const& positions) const;
+
+  // Adds to |*tree| the mergers of the subsystem of the body |b| whose
+  // children are given by |children|, and returns the index of its node.
+  static std::size_t AddJacobiMergers(
+      std::size_t const b,
+      std::vector<std::vector<std::size_t>> const& children,
+      not_null<JacobiTree*> const tree);
+
+  // Converts the |cartesian| positions, velocities or accelerations of the
+  // massive bodies, laid out according to |layout_| with blocks of length
+  // |stride|, to Jacobi coordinates in |*jacobi|, laid out in the same way.
+  // The other elements are copied.  |*nodes| is scratch storage.
+  template<typename Scalar>
+  void ToJacobi(JacobiTree const& tree,
+                std::size_t const stride,
+                std::vector<Scalar> const& cartesian,
+                not_null<std::vector<Scalar>*> const jacobi,
+                not_null<std::vector<R3Element<Scalar>>*> const nodes) const;
+
+  // The inverse of |ToJacobi|.
+  template<typename Scalar>
+  void FromJacobi(JacobiTree const& tree,
+                  std::size_t const stride,
+                  std::vector<Scalar> const& jacobi,
+                  not_null<std::vector<Scalar>*> const cartesian,
+                  not_null<std::vector<R3Element<Scalar>>*> const nodes) const;
+
+  // Integrates the trajectories of |data|, prepared in |*parameters|, with the
+  // Wisdom-Holman |integrator| as |IntegrateWisdomHolman|.  The sampled states
+  // are passed to |sink| in Cartesian coordinates, called as:
+  //   sink(Time const& time,
+  //        std::vector<Length> const& positions,
+  //        std::vector<Speed> const& velocities);
+  template<typename Sink>
+  void SolveWisdomHolman(
+      WisdomHolmanIntegrator<Length, Speed> const& integrator,
+      std::map<MassiveBody const*, MassiveBody const*> const& parents,
+      IntegrationData const& data,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      not_null<SymplecticIntegrator<Length, Speed>::Parameters*> const
+          parameters,
+      Sink sink) const;
+
+  // Integrates the trajectories of |data|, prepared in |*parameters|, as
+  // |IntegrateStatically|.
+  template<typename Integrator>
+  void SolveAndAppend(
+      Integrator const& integrator,
+      IntegrationData const& data,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      not_null<typename Integrator::Parameters*> const parameters,
+      not_null<typename Integrator::Workspace*> const workspace) const;
+  // Same as above, with the modified accelerations of the force gradient
+  // integrator.
+  void SolveAndAppend(
+      ForceGradientIntegrator<Length, Speed> const& integrator,
+      IntegrationData const& data,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      not_null<ForceGradientIntegrator<Length, Speed>::Parameters*> const
+          parameters,
+      not_null<ForceGradientIntegrator<Length, Speed>::Workspace*> const
+          workspace) const;
+
+  // The implementation of the |Integrate| that appends to |*histories|.
+  template<typename Integrator>
+  void IntegrateToHistories(
+      Integrator const& integrator,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      Trajectories const& trajectories,
+      not_null<SynchronizedHistories<Frame>*> const histories,
+      not_null<typename Integrator::Workspace*> const workspace) const;
+
+  MassiveBodiesTable MakeMassiveBodiesTable(
+      ReadonlyTrajectories const& massive_oblate_trajectories,
+      ReadonlyTrajectories const& massive_spherical_trajectories) const;
+
+  // Returns the tree of the given massive bodies, laid out as in the state
+  // vectors, for the hierarchical force model, or null if the forces are
+  // summed directly.
+  std::unique_ptr<Hierarchy const> MakeHierarchy(
+      ReadonlyTrajectories const& massive_oblate_trajectories,
+      ReadonlyTrajectories const& massive_spherical_trajectories) const;
+
+  // Returns empty interaction lists with the current parameters, or null if
+  // the massless bodies don't use interaction lists.  The lists are sized by
+  // |PrepareInitialState|.
+  std::unique_ptr<InteractionLists const> MakeInteractionLists() const;
+
+  // Same as the static function below, dispatched on |layout_|, using
+  // |thread_pool_| and |massless_chunks_per_thread_|, or
+  // |massless_accelerations_backend_| if it applies to |data|.
+  void ComputeGravitationalAccelerations(
+      IntegrationData const& data,
+      Time const& t,
+      std::vector<Length> const& q,
+      not_null<std::vector<Acceleration>*> const result) const;
+
+  // Sets |*result| to a + c (∇a) a, where a are the accelerations computed by
+  // |ComputeGravitationalAccelerations| and ∇a is the Jacobian of the
+  // accelerations of the point masses with respect to the positions, i.e.,
+  // the gravity gradient, so that the modified accelerations include the
+  // zonal harmonics and the intrinsic accelerations, but not their gradients.
+  // If |c| is 0, this is exactly |ComputeGravitationalAccelerations|.
+  void ComputeModifiedGravitationalAccelerations(
+      IntegrationData const& data,
+      Time const& t,
+      std::vector<Length> const& q,
+      Exponentiation<Time, 2> const& c,
+      not_null<std::vector<Acceleration>*> const result) const;
+
+  // Adds c (∇a) a to the accelerations a in |*result|, which must be those of
+  // the massive bodies of |massive_bodies| followed by |number_of_massless|
+  // massless bodies.  The product of the Jacobian and the accelerations is
+  // computed in a single pass over the pairs of bodies, without forming the
+  // Jacobian: the separation and the distance of each pair of massive bodies
+  // serve both bodies, since the gravity gradient of a pair is symmetric.  The
+  // products are accumulated in |*products|, whose contents on entry are
+  // irrelevant.
+  template<Layout layout>
+  static void AddGravityGradientProducts(
+      MassiveBodiesTable const& massive_bodies,
+      std::size_t const number_of_massless,
+      std::size_t const stride,
+      Exponentiation<Time, 2> const& c,
+      std::vector<Length> const& q,
+      not_null<std::vector<Acceleration>*> const products,
+      not_null<std::vector<Acceleration>*> const result);
+
+  // Computes the accelerations of the massive bodies of |data| on the
+  // processor and those of its massless bodies with
+  // |massless_accelerations_backend_|, which must not be null.  Returns false
+  // if the backend failed, in which case |result| must be recomputed.
+  template<Layout layout>
+  bool ComputeGravitationalAccelerationsOnBackend(
+      IntegrationData const& data,
+      Time const& t,
+      std::vector<Length> const& q,
+      not_null<std::vector<Acceleration>*> const result) const;
+
+  // Appends the given state, laid out according to |layout_|, to the
+  // trajectories of |data|, or to its histories if it has some.  The errors
+  // of the compensated summations are ignored.
+  void AppendToTrajectories(
+      IntegrationData const& data,
+      Time const& time,
+      std::vector<Length> const& positions,
+      std::vector<Speed> const& velocities) const;
+
+  // The states sampled by an integration, appended to its trajectories in
+  // batches by |Trajectory::AppendRange|.
+  struct PointsBuffer {
+    // One batch per trajectory, in the order of the trajectories of the
+    // |IntegrationData|.
+    std::vector<typename Trajectory<Frame>::Points> points;
+    // The number of states in a full batch, 0 if the states are appended to
+    // the trajectories directly.
+    std::size_t batch_size = 0;
+  };
+
+  // The maximum number of points, over all trajectories, held by a
+  // |PointsBuffer|.
+  static std::size_t const kMaximumBufferedPoints = 1 << 16;
+
+  // Returns a buffer for the states sampled every |sampling_period| steps of
+  // |Δt| by an integration of the trajectories of |data| up to |tmax|, whose
+  // storage is reserved for the expected number of states.  If
+  // |sampling_period| is 0, only the final state is appended, and the buffer is
+  // not used; nor is it if the states are appended to the histories of
+  // |data|.
+  PointsBuffer MakePointsBuffer(IntegrationData const& data,
+                                Instant const& tmax,
+                                Time const& Δt,
+                                int const sampling_period) const;
+
+  // Same as above, but the state is appended to |*buffer| if it is used, and
+  // the full batches are appended to the trajectories.
+  void AppendToTrajectories(
+      IntegrationData const& data,
+      Time const& time,
+      std::vector<Length> const& positions,
+      std::vector<Speed> const& velocities,
+      not_null<PointsBuffer*> const buffer) const;
+
+  // Appends the states of |*buffer| to the trajectories of |data| and empties
+  // it, retaining its storage.
+  void FlushPointsBuffer(IntegrationData const& data,
+                         not_null<PointsBuffer*> const buffer) const;
+
+  // Returns true if the velocity of one of the trajectories of |data| has
+  // turned by an angle whose cosine is less than |cos_angular_tolerance| from
+  // |previous_velocities| to |velocities|, laid out according to |layout_|.
+  // The bodies for which either velocity is zero are ignored.
+  bool VelocityTurned(IntegrationData const& data,
+                      double const cos_angular_tolerance,
+                      std::vector<Speed> const& previous_velocities,
+                      std::vector<Speed> const& velocities) const;
+
+  // Integrates the massless |trajectories| with |integrator| in the field of
+  // the massive bodies of |massive_oblate_trajectories| and
+  // |massive_spherical_trajectories|, whose positions at any time of the
+  // integration are given by |compute_massive_positions|, called as:
+  //   compute_massive_positions(IntegrationData const& data,
+  //                             Time const& t,
+  //                             std::size_t const stride,
+  //                             not_null<std::vector<Length>*> const q);
+  // It must set the coordinates of the massive bodies, oblate first, at time
+  // |t| relative to |data.reference_time|, to the elements of |*q| for the
+  // indices 0 to the number of massive bodies, with blocks of coordinates of
+  // length |stride|, relative to |data.reference_position|.  If |parents| is
+  // not empty, the massless bodies are integrated relative to the massive
+  // bodies whose indices it gives, as in
+  // |IntegrateMasslessBodiesRelativeToParents|, and the velocities of the
+  // massive bodies are given by |compute_massive_velocities|, called in the
+  // same way; otherwise, it is not called.  The other parameters have the same
+  // meaning as for |IntegrateMasslessBodies|.
+  template<typename MassivePositionsComputation,
+           typename MassiveVelocitiesComputation>
+  void IntegrateMasslessBodiesInField(
+      SymplecticIntegrator<Length, Speed> const& integrator,
+      ReadonlyTrajectories const& massive_oblate_trajectories,
+      ReadonlyTrajectories const& massive_spherical_trajectories,
+      MassivePositionsComputation compute_massive_positions,
+      MassiveVelocitiesComputation compute_massive_velocities,
+      std::vector<std::size_t> const& parents,
+      Instant const& tmax,
+      Time const& Δt,
+      int const sampling_period,
+      bool const tmax_is_exact,
+      Trajectories const& trajectories) const;
+
+  // The states of the massive bodies at each step of their integration by
+  // |IntegrateWithBlockTimeSteps| or by the recording |Integrate|, laid out as
+  // in the integrator.
+  struct MassiveBodiesHistory {
+    std::vector<Time> times;
+    std::vector<std::vector<Length>> positions;
+    std::vector<std::vector<Speed>> velocities;
+  };
+
+  // Sets the positions of the massive bodies of |massive_data| at time |t|,
+  // relative to |reference_position|, in |*q|, whose blocks of coordinates have
+  // length |stride|, by Hermite interpolation in |history|.  The other elements
+  // of |*q| are not modified.
+  void InterpolateMassivePositions(
+      IntegrationData const& massive_data,
+      MassiveBodiesHistory const& history,
+      Position<Frame> const& reference_position,
+      Time const& t,
+      std::size_t const stride,
+      not_null<std::vector<Length>*> const q) const;
+
+  // The length of a block of coordinates for |number_of_bodies| bodies with
+  // |layout_|.
+  std::size_t Stride(std::size_t const number_of_bodies) const;
+
+  // Same as |Index|, dispatched on |layout_|.
+  std::size_t IndexOf(std::size_t const b,
+                      int const k,
+                      std::size_t const stride) const;
+
+  // The index in the |q| and |result| arrays of the coordinate |k| (0 for x,
+  // 1 for y, 2 for z) of the body with index |b|.  |stride| is the length of a
+  // block of coordinates and is only meaningful for
+  // |Layout::kStructureOfArrays|.
+  template<Layout layout>
+  static std::size_t Index(std::size_t const b,
+                           int const k,
+                           std::size_t const stride);
+
+  // Computes the acceleration due to one body, with index |b1| in the |q| and
+  // |result| arrays, on the bodies with indices [b2_begin, b2_end[.  The
+  // constants of the massive bodies are read from |massive_bodies|.  The
+  // template parameters specify what we know about the bodies, and therefore
+  // what forces apply, and the layout of |q| and |result|.
+  template<Layout layout,
+           bool body1_is_oblate,
            bool body2_is_oblate,
            bool body2_is_massive>
   static void ComputeOneBodyGravitationalAcceleration(
-      MassiveBody const& body1,
+      MassiveBodiesTable const& massive_bodies,
       size_t const b1,
-      ReadonlyTrajectories const& body2_trajectories,
       size_t const b2_begin,
       size_t const b2_end,
+      std::size_t const stride,
+      std::vector<Length> const& q,
+      not_null<std::vector<Acceleration>*> const result);
+
+  // Sets the |subsystems| of |hierarchy| from the positions of the massive
+  // bodies in |q|.
+  template<Layout layout>
+  static void ComputeSubsystems(
+      Hierarchy const& hierarchy,
+      MassiveBodiesTable const& massive_bodies,
+      std::size_t const stride,
+      std::vector<Length> const& q);
+
+  // The number of massive bodies in a block of
+  // |ComputeTiledMutualAccelerations|.  The data of two blocks, 10 KiB, fit in
+  // the L1 cache.  The tiled kernel
+  // is used when there are more massive spherical bodies than this.
+  static std::size_t const kMassiveBlockSize = 64;
+
+  // Computes the mutual accelerations of the massive spherical bodies with
+  // indices [b_begin, b_end[ in the |q| and |result| arrays, block by block.
+  // The positions of a pair of blocks are copied to local buffers in
+  // structure-of-arrays form, the accelerations of both are accumulated in
+  // local buffers using the symmetry of the interactions, and then added to
+  // |result|.  This yields the same interactions as
+  // |ComputeOneBodyGravitationalAcceleration|, summed in a different order,
+  // with better locality, and vectorized irrespective of |layout|.
+  template<Layout layout>
+  static void ComputeTiledMutualAccelerations(
+      MassiveBodiesTable const& massive_bodies,
+      std::size_t const b_begin,
+      std::size_t const b_end,
+      std::size_t const stride,
+      std::vector<Length> const& q,
+      not_null<std::vector<Acceleration>*> const result);
+
+  // Computes the acceleration due to the massive body with index |b1|,
+  // including its oblateness, on the massless body with index |b2| in the |q|
+  // and |result| arrays.
+  template<Layout layout>
+  static void ComputeDirectGravitationalAcceleration(
+      MassiveBodiesTable const& massive_bodies,
+      std::size_t const b1,
+      std::size_t const b2,
+      std::size_t const stride,
+      std::vector<Length> const& q,
+      not_null<std::vector<Acceleration>*> const result);
+
+  // Recomputes the dominant body, the interaction list and the error estimate
+  // of the massless body with index |b2| in the |q| array.
+  template<Layout layout>
+  static void ComputeInteractionList(
+      InteractionLists const& interaction_lists,
+      MassiveBodiesTable const& massive_bodies,
+      std::size_t const b2,
+      std::size_t const stride,
+      std::vector<Length> const& q);
+
+  // Computes the acceleration on the massless body with index |b2| in the |q|
+  // and |result| arrays with its interaction list.  The accelerations of the
+  // massive bodies must have been computed in |result|.
+  template<Layout layout>
+  static void ComputeInteractionListGravitationalAcceleration(
+      InteractionLists const& interaction_lists,
+      MassiveBodiesTable const& massive_bodies,
+      std::size_t const b2,
+      std::size_t const stride,
+      std::vector<Length> const& q,
+      not_null<std::vector<Acceleration>*> const result);
+
+  // Computes the acceleration due to the massive body with index |b1| and to
+  // the subsystems of its descendants on the massless body with index |b2| in
+  // the |q| and |result| arrays, with the hierarchical force model.  The
+  // |subsystems| of |hierarchy| must have been computed for |q|.
+  template<Layout layout>
+  static void ComputeHierarchicalGravitationalAcceleration(
+      Hierarchy const& hierarchy,
+      MassiveBodiesTable const& massive_bodies,
+      std::size_t const b1,
+      std::size_t const b2,
+      std::size_t const stride,
+      std::vector<Length> const& q,
+      not_null<std::vector<Acceleration>*> const result);
+
+  // Adds their intrinsic accelerations to the accelerations of the massless
+  // bodies with indices [b2_begin, b2_end[ in the |result| array.
+  template<Layout layout>
+  static void AddIntrinsicAccelerations(
+      ReadonlyTrajectories const& massless_trajectories,
+      std::size_t const number_of_massive_trajectories,
+      Instant const& reference_time,
+      std::size_t const b2_begin,
+      std::size_t const b2_end,
+      std::size_t const stride,
+      Time const& t,
+      not_null<std::vector<Acceleration>*> const result);
+
+  // Computes the accelerations of the massless bodies with indices
+  // [b2_begin, b2_end[ in the |q| and |result| arrays, including their
+  // intrinsic accelerations.  Only writes to the corresponding elements of
+  // |result|.  If |hierarchy| is not null, its |subsystems| must have been
+  // computed for |q|.  If |interaction_lists| is not null, the accelerations
+  // of the massive bodies must have been computed in |result|, and the lists
+  // are recomputed if the number of |evaluations| is a multiple of the
+  // |refresh_period|.
+  template<Layout layout>
+  static void ComputeMasslessBodiesGravitationalAccelerations(
+      MassiveBodiesTable const& massive_bodies,
+      ReadonlyTrajectories const& massless_trajectories,
+      Hierarchy const* const hierarchy,
+      InteractionLists const* const interaction_lists,
+      Instant const& reference_time,
+      std::size_t const b2_begin,
+      std::size_t const b2_end,
+      std::size_t const stride,
+      Time const& t,
       std::vector<Length> const& q,
       not_null<std::vector<Acceleration>*> const result);
 
-  // No transfer of ownership.
+  // No transfer of ownership.  If |thread_pool| is not null, the accelerations
+  // of the massless bodies are computed on it, in |chunks_per_thread| chunks
+  // per thread.  If |hierarchy| is not null, the
+  // accelerations of the massless bodies use the hierarchical force model.  If
+  // |interaction_lists| is not null, they use the interaction lists.
+  template<Layout layout>
   static void ComputeGravitationalAccelerations(
-      ReadonlyTrajectories const& massive_oblate_trajectories,
-      ReadonlyTrajectories const& massive_spherical_trajectories,
+      MassiveBodiesTable const& massive_bodies,
       ReadonlyTrajectories const& massless_trajectories,
+      Hierarchy const* const hierarchy,
+      InteractionLists const* const interaction_lists,
       Instant const& reference_time,
+      std::size_t const stride,
+      ThreadPool* const thread_pool,
+      int const chunks_per_thread,
       Time const& t,
       std::vector<Length> const& q,
       not_null<std::vector<Acceleration>*> const result);
 
-  // No transfer of ownership.
-  static void ComputeGravitationalVelocities(
-      std::vector<Speed> const& p,
-      not_null<std::vector<Speed>*> const result);
+  Layout const layout_;
+  ThreadPool* thread_pool_ = nullptr;  // Not owned.
+  int massless_chunks_per_thread_ = 1;
+  // Not owned.
+  MasslessAccelerationsBackend* massless_accelerations_backend_ = nullptr;
+
+  // The parameters of the hierarchical force model.
+  std::map<MassiveBody const*, MassiveBody const*> parents_;
+  double hierarchical_tolerance_ = 0;
+  bool use_quadrupole_ = false;
+
+  // The parameters of the interaction lists.
+  double interaction_list_tolerance_ = 0;
+  int interaction_list_refresh_period_ = 1;
+
+  double oblateness_accuracy_ = 0;
+
+  // Incremented when the parameters that enter the |MassiveBodiesTable| or the
+  // |Hierarchy| change, so that the |Plan|s know to extract them again.
+  std::int64_t parameters_version_ = 0;
+
+  bool recentring_ = false;
+
+  double close_encounter_timescale_fraction_ = 0;
+
+  // Updated by the integrations, which are otherwise const.
+  mutable Statistics statistics_;
+
+  // The scratch storage used by |Integrate|, |IntegrateWisdomHolman| and
+  // |IntegrateAdaptively|.
+  mutable SPRKIntegrator<Length, Speed>::Workspace sprk_workspace_;
+  mutable SymmetricLinearMultistepIntegrator<Length, Speed>::Workspace
+      multistep_workspace_;
+  mutable GaussJacksonIntegrator<Length, Speed>::Workspace
+      gauss_jackson_workspace_;
+  mutable PararealIntegrator<Length, Speed>::Workspace parareal_workspace_;
+  mutable WisdomHolmanIntegrator<Length, Speed>::Workspace
+      wisdom_holman_workspace_;
+  mutable EmbeddedExplicitRungeKuttaNyströmIntegrator<Length>::Workspace
+      rkn_workspace_;
+  mutable ForceGradientIntegrator<Length, Speed>::Workspace
+      force_gradient_workspace_;
+  // The scratch storage of |AddGravityGradientProducts|.
+  mutable std::vector<Acceleration> gravity_gradient_products_;
+
+  // The buffers exchanged with |massless_accelerations_backend_|, in SI units,
+  // reused from one evaluation of the forces to the next.
+  struct BackendBuffers {
+    std::vector<double> gravitational_parameters;
+    std::vector<double> massive_positions;
+    std::vector<double> massless_positions;
+    std::vector<double> accelerations;
+  };
+  mutable BackendBuffers backend_buffers_;
+};
+
+// Filled by the recording |NBodySystem<Frame>::Integrate| and read by
+// |NBodySystem<Frame>::IntegrateMasslessBodiesInSteps|.  The bodies of the
+// recorded trajectories must outlive this object.
+template<typename Frame>
+class NBodySystem<Frame>::MassiveBodiesSteps {
+ public:
+  MassiveBodiesSteps() = default;
+
+ private:
+  // Only the massive trajectories, and the references, are meaningful.
+  IntegrationData data_;
+  MassiveBodiesHistory history_;
+
+  friend class NBodySystem<Frame>;
+};
+
+// Filled by |NBodySystem<Frame>::UpdatePlan| and used by
+// |NBodySystem<Frame>::IntegratePlan|.
+template<typename Frame>
+class NBodySystem<Frame>::Plan {
+ public:
+  Plan() = default;
+
+  // The trajectories of the plan, in the order of the state vectors: massive
+  // oblate bodies first, then massive spherical bodies, then massless bodies.
+  Trajectories const& trajectories() const;
+
+ private:
+  // The trajectories passed to the last call to |UpdatePlan|, in the order of
+  // that call.
+  Trajectories last_trajectories_;
+  // The kind of the body of each trajectory of the plan.
+  std::map<Trajectory<Frame> const*, BodyKind> kinds_;
+  // The |parameters_version_| of the |NBodySystem| for which the constants
+  // of the massive bodies were extracted, -1 if they never were.
+  std::int64_t parameters_version_ = -1;
+  IntegrationData data_;
+  // The initial state is prepared in these parameters, whose vectors are
+  // reused across integrations.
+  SPRKIntegrator<Length, Speed>::Parameters parameters_;
+
+  friend class NBodySystem<Frame>;
 };
 
 }  // namespace physics
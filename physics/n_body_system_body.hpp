@@ -1,383 +1,4377 @@
 ﻿#include "physics/n_body_system.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <functional>
+#include <limits>
+#include <map>
+#include <memory>
 #include <set>
 #include <vector>
 
+#include "base/cpu_features.hpp"
 #include "base/not_null.hpp"
 #include "base/macros.hpp"
+#include "base/tracer.hpp"
+
+#if PRINCIPIA_HAS_AVX_KERNELS || PRINCIPIA_HAS_AVX512F_KERNELS
+#include <immintrin.h>
+#endif
+#include "geometry/barycentre_calculator.hpp"
 #include "geometry/named_quantities.hpp"
 #include "geometry/r3_element.hpp"
 #include "glog/logging.h"
+#include "integrators/embedded_explicit_runge_kutta_nystrom_integrator.hpp"
 #include "integrators/symplectic_partitioned_runge_kutta_integrator.hpp"
+#include "physics/ephemeris.hpp"
+#include "physics/kepler_orbit.hpp"
 #include "physics/oblate_body.hpp"
+#include "quantities/elementary_functions.hpp"
 #include "quantities/quantities.hpp"
 
-using principia::geometry::InnerProduct;
-using principia::geometry::Instant;
-using principia::geometry::R3Element;
-using principia::integrators::SPRKIntegrator;
-using principia::integrators::SymplecticIntegrator;
-using principia::quantities::Acceleration;
-using principia::quantities::Exponentiation;
-using principia::quantities::GravitationalParameter;
-using principia::quantities::Length;
-using principia::quantities::Speed;
+using principia::base::make_not_null_unique;
+using principia::base::ScopedTraceEvent;
+using principia::base::UseAVX;
+using principia::base::UseAVX512F;
+using principia::geometry::BarycentreCalculator;
+using principia::geometry::Dot;
+using principia::geometry::InnerProduct;
+using principia::geometry::Instant;
+using principia::geometry::R3Element;
+using principia::integrators::DoublePrecision;
+using principia::integrators::DoublePrecisionVector;
+using principia::integrators::EmbeddedExplicitRungeKuttaNyströmIntegrator;
+using principia::integrators::ForceGradientIntegrator;
+using principia::integrators::SPRKIntegrator;
+using principia::integrators::SymmetricLinearMultistepIntegrator;
+using principia::integrators::SymplecticIntegrator;
+using principia::integrators::WisdomHolmanIntegrator;
+using principia::quantities::Acceleration;
+using principia::quantities::Cos;
+using principia::quantities::Exponentiation;
+using principia::quantities::GravitationalParameter;
+using principia::quantities::InverseSqrt;
+using principia::quantities::InverseSqrtPrecision;
+using principia::quantities::Length;
+using principia::quantities::Pow;
+using principia::quantities::Product;
+using principia::quantities::Quotient;
+using principia::quantities::SIUnit;
+using principia::quantities::SpecificEnergy;
+using principia::quantities::Speed;
+using principia::quantities::Sqrt;
+
+namespace principia {
+namespace physics {
+
+namespace {
+
+// The precision of the inverse square roots in the gravitational kernels.
+InverseSqrtPrecision const kGravitationalInverseSqrtPrecision =
+#if PRINCIPIA_USE_FAST_INVERSE_SQRT
+    InverseSqrtPrecision::kFast;
+#else
+    InverseSqrtPrecision::kExact;
+#endif
+
+// Returns 1 / |r|^3 given |r|^2.  The exact version does one square root and
+// one division, the fast one no division.
+template<InverseSqrtPrecision precision>
+FORCE_INLINE Exponentiation<Length, -3> OneOverRCubed(
+    Exponentiation<Length, 2> const& r_squared) {
+  if (precision == InverseSqrtPrecision::kFast) {
+    Exponentiation<Length, -1> const one_over_r =
+        InverseSqrt<precision>(r_squared);
+    return one_over_r * one_over_r * one_over_r;
+  } else {
+    return Sqrt(r_squared) / (r_squared * r_squared);
+  }
+}
+
+// If j is a unit vector along the axis of rotation, and r is the separation
+// between the bodies, the acceleration computed here is:
+//
+//   -(J2 / |r|^5) (3 j (r.j) + r (3 - 15 (r.j)^2 / |r|^2) / 2)
+//
+// Where |r| is the norm of r and r.j is the inner product.
+template<typename Frame>
+FORCE_INLINE Vector<Acceleration, Frame>
+    Order2ZonalAcceleration(
+        Order2ZonalCoefficient const& j2,
+        Vector<double, Frame> const& axis,
+        Vector<Length, Frame> const& r,
+        Exponentiation<Length, -2> const& one_over_r_squared,
+        Exponentiation<Length, -3> const& one_over_r_cubed) {
+  Length const r_axis_projection = InnerProduct(axis, r);
+  auto const j2_over_r_fifth =
+      j2 * one_over_r_cubed * one_over_r_squared;
+  Vector<Acceleration, Frame> const& axis_acceleration =
+      (-3 * j2_over_r_fifth * r_axis_projection) * axis;
+  Vector<Acceleration, Frame> const& radial_acceleration =
+      (j2_over_r_fifth *
+           (-1.5 +
+            7.5 * r_axis_projection *
+                  r_axis_projection * one_over_r_squared)) * r;
+  return axis_acceleration + radial_acceleration;
+}
+
+// The acceleration due to the zonal harmonics of degrees 3 to |degree| of a
+// body whose coefficients Jn μ Rⁿ, in SI units, are the elements of
+// |coefficients|, starting at degree 3.  |r| is the separation between the
+// bodies, as for |Order2ZonalAcceleration|.  If u is the sine of the latitude
+// of the accelerated body, r̂ the unit vector from the oblate body to the
+// accelerated body and Pn the Legendre polynomial of degree n, the
+// acceleration is:
+//
+//   Σ (Jn μ Rⁿ / |r|^(n + 2)) ((u Pn'(u) + (n + 1) Pn(u)) r̂ - Pn'(u) j)
+//
+// The polynomials and their derivatives are computed by recurrence.  The
+// |degree| is a template parameter so that the recurrence can be unrolled.
+template<typename Frame, int degree>
+FORCE_INLINE Vector<Acceleration, Frame>
+    HigherOrderZonalAcceleration(
+        double const* const coefficients,
+        Vector<double, Frame> const& axis,
+        Vector<Length, Frame> const& r) {
+  static_assert(degree >= 3, "Degree must be at least 3");
+  double const one_over_r_norm = SIUnit<Length>() / r.Norm();
+  Vector<double, Frame> const r_hat = r * (-one_over_r_norm / SIUnit<Length>());
+  double const u = InnerProduct(axis, r_hat);
+
+  // The values for degree 2.
+  double p_previous = u;
+  double p = (3 * u * u - 1) / 2;
+  double p_prime = 3 * u;
+  double one_over_r_to_the_n_plus_2 =
+      one_over_r_norm * one_over_r_norm * one_over_r_norm * one_over_r_norm;
+
+  double axial_factor = 0;
+  double radial_factor = 0;
+  for (int n = 3; n <= degree; ++n) {
+    double const p_next = ((2 * n - 1) * u * p - (n - 1) * p_previous) / n;
+    p_prime = u * p_prime + n * p;
+    p_previous = p;
+    p = p_next;
+    one_over_r_to_the_n_plus_2 *= one_over_r_norm;
+    double const coefficient_over_r_to_the_n_plus_2 =
+        coefficients[n - 3] * one_over_r_to_the_n_plus_2;
+    axial_factor += coefficient_over_r_to_the_n_plus_2 * p_prime;
+    radial_factor +=
+        coefficient_over_r_to_the_n_plus_2 * (u * p_prime + (n + 1) * p);
+  }
+  return SIUnit<Acceleration>() *
+         (radial_factor * r_hat - axial_factor * axis);
+}
+
+// Dispatches on the number of |coefficients|, which must not be empty.
+template<typename Frame>
+FORCE_INLINE Vector<Acceleration, Frame>
+    HigherOrderZonalAcceleration(
+        std::vector<double> const& coefficients,
+        Vector<double, Frame> const& axis,
+        Vector<Length, Frame> const& r) {
+  static_assert(OblateBody<Frame>::kMaxZonalDegree == 8,
+                "Update the cases below");
+  switch (coefficients.size() + 2) {
+    case 3:
+      return HigherOrderZonalAcceleration<Frame, 3>(coefficients.data(),
+                                                    axis, r);
+    case 4:
+      return HigherOrderZonalAcceleration<Frame, 4>(coefficients.data(),
+                                                    axis, r);
+    case 5:
+      return HigherOrderZonalAcceleration<Frame, 5>(coefficients.data(),
+                                                    axis, r);
+    case 6:
+      return HigherOrderZonalAcceleration<Frame, 6>(coefficients.data(),
+                                                    axis, r);
+    case 7:
+      return HigherOrderZonalAcceleration<Frame, 7>(coefficients.data(),
+                                                    axis, r);
+    case 8:
+      return HigherOrderZonalAcceleration<Frame, 8>(coefficients.data(),
+                                                    axis, r);
+    default:
+      LOG(FATAL) << "Unsupported number of zonal coefficients: "
+                 << coefficients.size();
+      base::noreturn();
+  }
+}
+
+// The functions below compute the accelerations exerted by a spherical massive
+// body on massless bodies whose coordinates are laid out in structure-of-arrays
+// form: |qx|, |qy| and |qz| (resp. |rx|, |ry| and |rz|) are the blocks of
+// coordinates of the positions (resp. accelerations), in SI units.  They
+// process vectors of bodies with indices in [b2_begin, b2_end[ and return the
+// index of the first body that was not processed; the remaining bodies (fewer
+// than one vector) are left to the caller.
+// Each lane performs exactly the operations of the scalar loop of
+// |NBodySystem::ComputeOneBodyGravitationalAcceleration|, in the same order.
+// These operations (subtraction, addition, multiplication, division and square
+// root) are correctly rounded, and we don't use fused multiply-adds, so the
+// results are bitwise identical to those of the scalar loop, irrespective of
+// the instruction set selected at run time.  In other words, the vectorized
+// kernels are always deterministic.
+
+#if PRINCIPIA_HAS_AVX512F_KERNELS
+PRINCIPIA_TARGET_AVX512F
+inline std::size_t AccumulateMasslessAccelerationsAVX512F(
+    double const μ1,
+    std::size_t const b1,
+    std::size_t const b2_begin,
+    std::size_t const b2_end,
+    double const* const qx,
+    double const* const qy,
+    double const* const qz,
+    double* const rx,
+    double* const ry,
+    double* const rz) {
+  __m512d const μ = _mm512_set1_pd(μ1);
+  __m512d const q1x = _mm512_set1_pd(qx[b1]);
+  __m512d const q1y = _mm512_set1_pd(qy[b1]);
+  __m512d const q1z = _mm512_set1_pd(qz[b1]);
+  std::size_t b2 = b2_begin;
+  for (; b2 + 8 <= b2_end; b2 += 8) {
+    __m512d const Δq0 = _mm512_sub_pd(q1x, _mm512_loadu_pd(&qx[b2]));
+    __m512d const Δq1 = _mm512_sub_pd(q1y, _mm512_loadu_pd(&qy[b2]));
+    __m512d const Δq2 = _mm512_sub_pd(q1z, _mm512_loadu_pd(&qz[b2]));
+    __m512d const r_squared =
+        _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(Δq0, Δq0),
+                                    _mm512_mul_pd(Δq1, Δq1)),
+                      _mm512_mul_pd(Δq2, Δq2));
+    __m512d const one_over_r_cubed =
+        _mm512_div_pd(_mm512_sqrt_pd(r_squared),
+                      _mm512_mul_pd(r_squared, r_squared));
+    __m512d const μ1_over_r_cubed = _mm512_mul_pd(μ, one_over_r_cubed);
+    _mm512_storeu_pd(&rx[b2],
+                     _mm512_add_pd(_mm512_loadu_pd(&rx[b2]),
+                                   _mm512_mul_pd(Δq0, μ1_over_r_cubed)));
+    _mm512_storeu_pd(&ry[b2],
+                     _mm512_add_pd(_mm512_loadu_pd(&ry[b2]),
+                                   _mm512_mul_pd(Δq1, μ1_over_r_cubed)));
+    _mm512_storeu_pd(&rz[b2],
+                     _mm512_add_pd(_mm512_loadu_pd(&rz[b2]),
+                                   _mm512_mul_pd(Δq2, μ1_over_r_cubed)));
+  }
+  return b2;
+}
+#endif
+
+#if PRINCIPIA_HAS_AVX_KERNELS
+PRINCIPIA_TARGET_AVX
+inline std::size_t AccumulateMasslessAccelerationsAVX(
+    double const μ1,
+    std::size_t const b1,
+    std::size_t const b2_begin,
+    std::size_t const b2_end,
+    double const* const qx,
+    double const* const qy,
+    double const* const qz,
+    double* const rx,
+    double* const ry,
+    double* const rz) {
+  __m256d const μ = _mm256_set1_pd(μ1);
+  __m256d const q1x = _mm256_set1_pd(qx[b1]);
+  __m256d const q1y = _mm256_set1_pd(qy[b1]);
+  __m256d const q1z = _mm256_set1_pd(qz[b1]);
+  std::size_t b2 = b2_begin;
+  for (; b2 + 4 <= b2_end; b2 += 4) {
+    __m256d const Δq0 = _mm256_sub_pd(q1x, _mm256_loadu_pd(&qx[b2]));
+    __m256d const Δq1 = _mm256_sub_pd(q1y, _mm256_loadu_pd(&qy[b2]));
+    __m256d const Δq2 = _mm256_sub_pd(q1z, _mm256_loadu_pd(&qz[b2]));
+    __m256d const r_squared =
+        _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(Δq0, Δq0),
+                                    _mm256_mul_pd(Δq1, Δq1)),
+                      _mm256_mul_pd(Δq2, Δq2));
+    __m256d const one_over_r_cubed =
+        _mm256_div_pd(_mm256_sqrt_pd(r_squared),
+                      _mm256_mul_pd(r_squared, r_squared));
+    __m256d const μ1_over_r_cubed = _mm256_mul_pd(μ, one_over_r_cubed);
+    _mm256_storeu_pd(&rx[b2],
+                     _mm256_add_pd(_mm256_loadu_pd(&rx[b2]),
+                                   _mm256_mul_pd(Δq0, μ1_over_r_cubed)));
+    _mm256_storeu_pd(&ry[b2],
+                     _mm256_add_pd(_mm256_loadu_pd(&ry[b2]),
+                                   _mm256_mul_pd(Δq1, μ1_over_r_cubed)));
+    _mm256_storeu_pd(&rz[b2],
+                     _mm256_add_pd(_mm256_loadu_pd(&rz[b2]),
+                                   _mm256_mul_pd(Δq2, μ1_over_r_cubed)));
+  }
+  return b2;
+}
+#endif
+
+// Dispatches to the widest vectorized kernel that the processor supports, and
+// then to narrower ones for the remainder.  Returns |b2_begin| if no vector
+// instructions are available, in which case the scalar loop does all the work.
+inline std::size_t AccumulateMasslessAccelerations(
+    GravitationalParameter const& body1_gravitational_parameter,
+    std::size_t const b1,
+    std::size_t const b2_begin,
+    std::size_t const b2_end,
+    std::size_t const stride,
+    std::vector<Length> const& q,
+    not_null<std::vector<Acceleration>*> const result) {
+  static_assert(sizeof(Length) == sizeof(double) &&
+                sizeof(Acceleration) == sizeof(double),
+                "Quantities must be represented as a single double");
+  std::size_t b2 = b2_begin;
+#if PRINCIPIA_HAS_AVX_KERNELS || PRINCIPIA_HAS_AVX512F_KERNELS
+  double const μ1 = body1_gravitational_parameter /
+                    SIUnit<GravitationalParameter>();
+  double const* const qx = reinterpret_cast<double const*>(q.data());
+  double const* const qy = qx + stride;
+  double const* const qz = qy + stride;
+  double* const rx = reinterpret_cast<double*>(result->data());
+  double* const ry = rx + stride;
+  double* const rz = ry + stride;
+#endif
+#if PRINCIPIA_HAS_AVX512F_KERNELS
+  if (UseAVX512F()) {
+    b2 = AccumulateMasslessAccelerationsAVX512F(μ1, b1, b2, b2_end,
+                                                qx, qy, qz, rx, ry, rz);
+  }
+#endif
+#if PRINCIPIA_HAS_AVX_KERNELS
+  if (UseAVX()) {
+    b2 = AccumulateMasslessAccelerationsAVX(μ1, b1, b2, b2_end,
+                                            qx, qy, qz, rx, ry, rz);
+  }
+#endif
+  return b2;
+}
+
+// The functions below compute the mutual accelerations of a massive body 1,
+// at (|x1|, |y1|, |z1|) with gravitational parameter |μ1|, and of the massive
+// bodies with indices [j_begin, j_end[ in the arrays |x2|, |y2|, |z2| and
+// |μ2|, in SI units, for |NBodySystem::ComputeTiledMutualAccelerations|.  The
+// accelerations of the bodies 2 are added to |ax2|, |ay2| and |az2|; the
+// contributions of the bodies 2 to the acceleration of the body 1, with the
+// opposite sign, are stored in |cx|, |cy| and |cz| so that the caller may sum
+// them in the order of the scalar loop.  As above, each lane performs exactly
+// the operations of the scalar loop, so the results don't depend on the
+// instruction set.  They return the index of the first body that was not
+// processed.
+
+#if PRINCIPIA_HAS_AVX512F_KERNELS
+PRINCIPIA_TARGET_AVX512F
+inline std::size_t AccumulateMutualAccelerationsAVX512F(
+    double const x1,
+    double const y1,
+    double const z1,
+    double const μ1,
+    std::size_t const j_begin,
+    std::size_t const j_end,
+    double const* const x2,
+    double const* const y2,
+    double const* const z2,
+    double const* const μ2,
+    double* const ax2,
+    double* const ay2,
+    double* const az2,
+    double* const cx,
+    double* const cy,
+    double* const cz) {
+  __m512d const μ = _mm512_set1_pd(μ1);
+  __m512d const q1x = _mm512_set1_pd(x1);
+  __m512d const q1y = _mm512_set1_pd(y1);
+  __m512d const q1z = _mm512_set1_pd(z1);
+  std::size_t j = j_begin;
+  for (; j + 8 <= j_end; j += 8) {
+    __m512d const Δq0 = _mm512_sub_pd(q1x, _mm512_loadu_pd(&x2[j]));
+    __m512d const Δq1 = _mm512_sub_pd(q1y, _mm512_loadu_pd(&y2[j]));
+    __m512d const Δq2 = _mm512_sub_pd(q1z, _mm512_loadu_pd(&z2[j]));
+    __m512d const r_squared =
+        _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(Δq0, Δq0),
+                                    _mm512_mul_pd(Δq1, Δq1)),
+                      _mm512_mul_pd(Δq2, Δq2));
+    __m512d const one_over_r_cubed =
+        _mm512_div_pd(_mm512_sqrt_pd(r_squared),
+                      _mm512_mul_pd(r_squared, r_squared));
+    __m512d const μ1_over_r_cubed = _mm512_mul_pd(μ, one_over_r_cubed);
+    _mm512_storeu_pd(&ax2[j],
+                     _mm512_add_pd(_mm512_loadu_pd(&ax2[j]),
+                                   _mm512_mul_pd(Δq0, μ1_over_r_cubed)));
+    _mm512_storeu_pd(&ay2[j],
+                     _mm512_add_pd(_mm512_loadu_pd(&ay2[j]),
+                                   _mm512_mul_pd(Δq1, μ1_over_r_cubed)));
+    _mm512_storeu_pd(&az2[j],
+                     _mm512_add_pd(_mm512_loadu_pd(&az2[j]),
+                                   _mm512_mul_pd(Δq2, μ1_over_r_cubed)));
+    __m512d const μ2_over_r_cubed =
+        _mm512_mul_pd(_mm512_loadu_pd(&μ2[j]), one_over_r_cubed);
+    _mm512_storeu_pd(&cx[j], _mm512_mul_pd(Δq0, μ2_over_r_cubed));
+    _mm512_storeu_pd(&cy[j], _mm512_mul_pd(Δq1, μ2_over_r_cubed));
+    _mm512_storeu_pd(&cz[j], _mm512_mul_pd(Δq2, μ2_over_r_cubed));
+  }
+  return j;
+}
+#endif
+
+#if PRINCIPIA_HAS_AVX_KERNELS
+PRINCIPIA_TARGET_AVX
+inline std::size_t AccumulateMutualAccelerationsAVX(
+    double const x1,
+    double const y1,
+    double const z1,
+    double const μ1,
+    std::size_t const j_begin,
+    std::size_t const j_end,
+    double const* const x2,
+    double const* const y2,
+    double const* const z2,
+    double const* const μ2,
+    double* const ax2,
+    double* const ay2,
+    double* const az2,
+    double* const cx,
+    double* const cy,
+    double* const cz) {
+  __m256d const μ = _mm256_set1_pd(μ1);
+  __m256d const q1x = _mm256_set1_pd(x1);
+  __m256d const q1y = _mm256_set1_pd(y1);
+  __m256d const q1z = _mm256_set1_pd(z1);
+  std::size_t j = j_begin;
+  for (; j + 4 <= j_end; j += 4) {
+    __m256d const Δq0 = _mm256_sub_pd(q1x, _mm256_loadu_pd(&x2[j]));
+    __m256d const Δq1 = _mm256_sub_pd(q1y, _mm256_loadu_pd(&y2[j]));
+    __m256d const Δq2 = _mm256_sub_pd(q1z, _mm256_loadu_pd(&z2[j]));
+    __m256d const r_squared =
+        _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(Δq0, Δq0),
+                                    _mm256_mul_pd(Δq1, Δq1)),
+                      _mm256_mul_pd(Δq2, Δq2));
+    __m256d const one_over_r_cubed =
+        _mm256_div_pd(_mm256_sqrt_pd(r_squared),
+                      _mm256_mul_pd(r_squared, r_squared));
+    __m256d const μ1_over_r_cubed = _mm256_mul_pd(μ, one_over_r_cubed);
+    _mm256_storeu_pd(&ax2[j],
+                     _mm256_add_pd(_mm256_loadu_pd(&ax2[j]),
+                                   _mm256_mul_pd(Δq0, μ1_over_r_cubed)));
+    _mm256_storeu_pd(&ay2[j],
+                     _mm256_add_pd(_mm256_loadu_pd(&ay2[j]),
+                                   _mm256_mul_pd(Δq1, μ1_over_r_cubed)));
+    _mm256_storeu_pd(&az2[j],
+                     _mm256_add_pd(_mm256_loadu_pd(&az2[j]),
+                                   _mm256_mul_pd(Δq2, μ1_over_r_cubed)));
+    __m256d const μ2_over_r_cubed =
+        _mm256_mul_pd(_mm256_loadu_pd(&μ2[j]), one_over_r_cubed);
+    _mm256_storeu_pd(&cx[j], _mm256_mul_pd(Δq0, μ2_over_r_cubed));
+    _mm256_storeu_pd(&cy[j], _mm256_mul_pd(Δq1, μ2_over_r_cubed));
+    _mm256_storeu_pd(&cz[j], _mm256_mul_pd(Δq2, μ2_over_r_cubed));
+  }
+  return j;
+}
+#endif
+
+// The difference |a - b|, with the exact error of the subtraction.
+inline DoublePrecision<Length> CompensatedDifference(Length const& a,
+                                                     Length const& b) {
+  // Knuth's TwoSum applied to |a| and |-b|.
+  DoublePrecision<Length> result;
+  result.value = a - b;
+  Length const minus_b_virtual = result.value - a;
+  Length const a_virtual = result.value - minus_b_virtual;
+  result.error = (a - a_virtual) - (b + minus_b_virtual);
+  return result;
+}
+
+// An instant in the middle of [t1, t2] whose differences with |t1| and |t2|
+// are exact, so that the bounds of an integration interval are recovered
+// exactly from the times relative to it: it is a multiple of the smaller of
+// the ulps of |t1| and |t2|, and the differences have at most 53 significant
+// bits.  If there is no such instant, e.g., because one of the bounds is very
+// close to |Instant()|, returns |Instant()|.
+inline Instant MiddleReferenceTime(Instant const& t1, Instant const& t2) {
+  double const s1 = (t1 - Instant()) / SIUnit<Time>();
+  double const s2 = (t2 - Instant()) / SIUnit<Time>();
+  double const infinity = std::numeric_limits<double>::infinity();
+  double const ulp =
+      std::min(std::nextafter(std::abs(s1), infinity) - std::abs(s1),
+               std::nextafter(std::abs(s2), infinity) - std::abs(s2));
+  if (!(std::abs(s2 - s1) < ulp * (1LL << 52))) {
+    return Instant();
+  }
+  return Instant(std::floor((s1 + s2) / (2 * ulp)) * ulp * SIUnit<Time>());
+}
+
+// The centre of mass of the last positions of the massive bodies of the
+// |trajectories|, or, if they are all massless, the centroid of their last
+// positions.
+template<typename Frame>
+Position<Frame> ReferencePosition(
+    std::vector<not_null<Trajectory<Frame>*>> const& trajectories) {
+  BarycentreCalculator<R3Element<Length>, GravitationalParameter>
+      massive_calculator;
+  BarycentreCalculator<R3Element<Length>, double> massless_calculator;
+  bool has_massive_bodies = false;
+  for (auto const& trajectory : trajectories) {
+    R3Element<Length> const position =
+        (trajectory->last().degrees_of_freedom().position() -
+         Position<Frame>()).coordinates();
+    not_null<Body const*> const body = trajectory->template body<Body>();
+    if (body->is_massless()) {
+      massless_calculator.Add(position, 1);
+    } else {
+      massive_calculator.Add(
+          position,
+          trajectory->template body<MassiveBody>()->gravitational_parameter());
+      has_massive_bodies = true;
+    }
+  }
+  return Position<Frame>() +
+         Vector<Length, Frame>(has_massive_bodies ? massive_calculator.Get()
+                                                  : massless_calculator.Get());
+}
+
+}  // namespace
+
+template<typename Frame>
+NBodySystem<Frame>::NBodySystem(Layout const layout) : layout_(layout) {}
+
+template<typename Frame>
+void NBodySystem<Frame>::Integrate(
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    Trajectories const& trajectories) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  auto const force_gradient_integrator =
+      dynamic_cast<ForceGradientIntegrator<Length, Speed> const*>(&integrator);
+  if (force_gradient_integrator != nullptr) {
+    IntegrateStatically(*force_gradient_integrator,
+                        tmax,
+                        Δt,
+                        sampling_period,
+                        tmax_is_exact,
+                        trajectories,
+                        &force_gradient_workspace_);
+    return;
+  }
+  Trajectories other_trajectories;
+  Trajectories close_trajectories;
+  if (close_encounter_timescale_fraction_ > 0 &&
+      FindCloseEncounters(trajectories,
+                          Δt,
+                          &other_trajectories,
+                          &close_trajectories)) {
+    IntegrateWithCloseEncounters(integrator,
+                                 tmax,
+                                 Δt,
+                                 sampling_period,
+                                 tmax_is_exact,
+                                 other_trajectories,
+                                 close_trajectories,
+                                 nullptr /*massive_steps*/);
+    return;
+  }
+  auto const sprk_integrator =
+      dynamic_cast<SPRKIntegrator<Length, Speed> const*>(&integrator);
+  if (sprk_integrator != nullptr) {
+    IntegrateStatically(*sprk_integrator,
+                        tmax,
+                        Δt,
+                        sampling_period,
+                        tmax_is_exact,
+                        trajectories,
+                        &sprk_workspace_);
+    return;
+  }
+  auto const multistep_integrator = dynamic_cast<
+      SymmetricLinearMultistepIntegrator<Length, Speed> const*>(&integrator);
+  IntegrateStatically(*CHECK_NOTNULL(multistep_integrator),
+                      tmax,
+                      Δt,
+                      sampling_period,
+                      tmax_is_exact,
+                      trajectories,
+                      &multistep_workspace_);
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::Integrate(
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    Instant const& tmax,
+    Time const& Δt,
+    AdaptiveSampling const& sampling,
+    bool const tmax_is_exact,
+    Trajectories const& trajectories) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK_LT(0, sampling.maximum_sampling_period);
+  auto const sprk_integrator =
+      dynamic_cast<SPRKIntegrator<Length, Speed> const*>(&integrator);
+  auto const multistep_integrator = dynamic_cast<
+      SymmetricLinearMultistepIntegrator<Length, Speed> const*>(&integrator);
+  CHECK(sprk_integrator != nullptr || multistep_integrator != nullptr);
+  IntegrationData data;
+  SPRKIntegrator<Length, Speed>::Parameters parameters;
+  PrepareIntegration(trajectories,
+                     tmax,
+                     &data,
+                     &parameters.initial.positions,
+                     &parameters.initial.momenta);
+  parameters.initial.time = data.initial_time - data.reference_time;
+  parameters.tmax = tmax - data.reference_time;
+  parameters.Δt = Δt;
+  parameters.sampling_period = 1;
+  parameters.tmax_is_exact = tmax_is_exact;
+
+  auto const compute_gravitational_accelerations =
+      [this, &data](Time const& t,
+                    std::vector<Length> const& q,
+                    not_null<std::vector<Acceleration>*> const result) {
+    ComputeGravitationalAccelerations(data, t, q, result);
+  };
+
+  double const cos_angular_tolerance = Cos(sampling.angular_tolerance);
+  // The velocities of the last appended state, initially the initial state,
+  // which is already in the trajectories.
+  std::vector<Speed> sampled_velocities;
+  sampled_velocities.reserve(parameters.initial.momenta.size());
+  for (auto const& velocity : parameters.initial.momenta) {
+    sampled_velocities.push_back(velocity.value);
+  }
+  int steps_since_sampled = 0;
+  // The state of the last step, if it was not appended.  It is appended at the
+  // end of the integration.
+  bool has_unsampled_state = false;
+  Time unsampled_time;
+  std::vector<Length> unsampled_positions;
+  std::vector<Speed> unsampled_velocities;
+  auto const append_to_trajectories_if_turned =
+      [this, &data, &sampling, cos_angular_tolerance, &sampled_velocities,
+       &steps_since_sampled, &has_unsampled_state, &unsampled_time,
+       &unsampled_positions, &unsampled_velocities](
+          DoublePrecision<Time> const& time,
+          DoublePrecisionVector<Length> const& positions,
+          DoublePrecisionVector<Speed> const& momenta) {
+    ++steps_since_sampled;
+    if (steps_since_sampled >= sampling.maximum_sampling_period ||
+        VelocityTurned(data,
+                       cos_angular_tolerance,
+                       sampled_velocities,
+                       momenta.values)) {
+      AppendToTrajectories(data, time.value, positions.values, momenta.values);
+      sampled_velocities = momenta.values;
+      steps_since_sampled = 0;
+      has_unsampled_state = false;
+    } else {
+      has_unsampled_state = true;
+      unsampled_time = time.value;
+      unsampled_positions = positions.values;
+      unsampled_velocities = momenta.values;
+    }
+  };
+  if (sprk_integrator != nullptr) {
+    sprk_integrator->SolveWithSink(compute_gravitational_accelerations,
+                                   parameters,
+                                   append_to_trajectories_if_turned,
+                                   &sprk_workspace_);
+  } else {
+    multistep_integrator->SolveWithSink(compute_gravitational_accelerations,
+                                        parameters,
+                                        append_to_trajectories_if_turned,
+                                        &multistep_workspace_);
+  }
+  if (has_unsampled_state) {
+    AppendToTrajectories(data,
+                         unsampled_time,
+                         unsampled_positions,
+                         unsampled_velocities);
+  }
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::Integrate(
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    Trajectories const& trajectories,
+    not_null<MassiveBodiesSteps*> const massive_steps) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK_LE(0, sampling_period);
+  Trajectories other_trajectories;
+  Trajectories close_trajectories;
+  if (close_encounter_timescale_fraction_ > 0 &&
+      FindCloseEncounters(trajectories,
+                          Δt,
+                          &other_trajectories,
+                          &close_trajectories)) {
+    IntegrateWithCloseEncounters(integrator,
+                                 tmax,
+                                 Δt,
+                                 sampling_period,
+                                 tmax_is_exact,
+                                 other_trajectories,
+                                 close_trajectories,
+                                 massive_steps);
+    return;
+  }
+  IntegrationData data;
+  SPRKIntegrator<Length, Speed>::Parameters parameters;
+  PrepareIntegration(trajectories,
+                     tmax,
+                     &data,
+                     &parameters.initial.positions,
+                     &parameters.initial.momenta);
+  auto const sprk_integrator =
+      dynamic_cast<SPRKIntegrator<Length, Speed> const*>(&integrator);
+  if (sprk_integrator != nullptr) {
+    IntegrateAndRecord(*sprk_integrator,
+                       data,
+                       tmax,
+                       Δt,
+                       sampling_period,
+                       tmax_is_exact,
+                       &parameters,
+                       massive_steps,
+                       &sprk_workspace_);
+    return;
+  }
+  auto const multistep_integrator = dynamic_cast<
+      SymmetricLinearMultistepIntegrator<Length, Speed> const*>(&integrator);
+  IntegrateAndRecord(*CHECK_NOTNULL(multistep_integrator),
+                     data,
+                     tmax,
+                     Δt,
+                     sampling_period,
+                     tmax_is_exact,
+                     &parameters,
+                     massive_steps,
+                     &multistep_workspace_);
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::UpdatePlan(Trajectories const& trajectories,
+                                    not_null<Plan*> const plan) const {
+  bool const parameters_changed =
+      plan->parameters_version_ != parameters_version_;
+  if (!parameters_changed && trajectories == plan->last_trajectories_) {
+    return;
+  }
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  IntegrationData& data = plan->data_;
+
+  // Partition the trajectories as in |PrepareIntegration|, reusing the kinds
+  // of the trajectories already in the plan.
+  std::map<Trajectory<Frame> const*, BodyKind> kinds;
+  std::set<Body const*> bodies_in_trajectories;
+  Trajectories massive_oblate_trajectories;
+  Trajectories massive_spherical_trajectories;
+  Trajectories massless_trajectories;
+  for (auto const& trajectory : trajectories) {
+    not_null<Body const*> const body = trajectory->template body<Body>();
+    auto const inserted = bodies_in_trajectories.emplace(body);
+    CHECK(inserted.second) << "Multiple trajectories for the same body";
+    BodyKind kind;
+    auto const it = plan->kinds_.find(trajectory);
+    if (it == plan->kinds_.end()) {
+      if (body->is_massless()) {
+        CHECK(!body->is_oblate());
+        kind = BodyKind::kMassless;
+      } else if (body->is_oblate()) {
+        kind = BodyKind::kMassiveOblate;
+      } else {
+        kind = BodyKind::kMassiveSpherical;
+      }
+    } else {
+      kind = it->second;
+    }
+    kinds.emplace(trajectory, kind);
+    switch (kind) {
+      case BodyKind::kMassiveOblate:
+        massive_oblate_trajectories.push_back(trajectory);
+        break;
+      case BodyKind::kMassiveSpherical:
+        massive_spherical_trajectories.push_back(trajectory);
+        break;
+      case BodyKind::kMassless:
+        massless_trajectories.push_back(trajectory);
+        break;
+    }
+  }
+
+  ReadonlyTrajectories const readonly_massive_oblate_trajectories(
+      massive_oblate_trajectories.begin(),
+      massive_oblate_trajectories.end());
+  ReadonlyTrajectories const readonly_massive_spherical_trajectories(
+      massive_spherical_trajectories.begin(),
+      massive_spherical_trajectories.end());
+  data.trajectories = massive_oblate_trajectories;
+  data.trajectories.insert(data.trajectories.end(),
+                           massive_spherical_trajectories.begin(),
+                           massive_spherical_trajectories.end());
+  data.trajectories.insert(data.trajectories.end(),
+                           massless_trajectories.begin(),
+                           massless_trajectories.end());
+  data.massless_trajectories.assign(massless_trajectories.begin(),
+                                    massless_trajectories.end());
+  if (parameters_changed ||
+      readonly_massive_oblate_trajectories !=
+          data.massive_oblate_trajectories ||
+      readonly_massive_spherical_trajectories !=
+          data.massive_spherical_trajectories) {
+    data.massive_oblate_trajectories = readonly_massive_oblate_trajectories;
+    data.massive_spherical_trajectories =
+        readonly_massive_spherical_trajectories;
+    data.massive_bodies =
+        MakeMassiveBodiesTable(data.massive_oblate_trajectories,
+                               data.massive_spherical_trajectories);
+    data.hierarchy = MakeHierarchy(data.massive_oblate_trajectories,
+                                   data.massive_spherical_trajectories);
+    data.interaction_lists = MakeInteractionLists();
+    plan->parameters_version_ = parameters_version_;
+  }
+  plan->kinds_.swap(kinds);
+  plan->last_trajectories_ = trajectories;
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::IntegratePlan(
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    not_null<Plan*> const plan) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK_EQ(parameters_version_, plan->parameters_version_)
+      << "The plan must be updated";
+  Trajectories other_trajectories;
+  Trajectories close_trajectories;
+  if (close_encounter_timescale_fraction_ > 0 &&
+      FindCloseEncounters(plan->last_trajectories_,
+                          Δt,
+                          &other_trajectories,
+                          &close_trajectories)) {
+    IntegrateWithCloseEncounters(integrator,
+                                 tmax,
+                                 Δt,
+                                 sampling_period,
+                                 tmax_is_exact,
+                                 other_trajectories,
+                                 close_trajectories,
+                                 nullptr /*massive_steps*/);
+    return;
+  }
+  PrepareInitialState(tmax,
+                      &plan->data_,
+                      &plan->parameters_.initial.positions,
+                      &plan->parameters_.initial.momenta);
+  auto const sprk_integrator =
+      dynamic_cast<SPRKIntegrator<Length, Speed> const*>(&integrator);
+  if (sprk_integrator != nullptr) {
+    SolveAndAppend(*sprk_integrator,
+                   plan->data_,
+                   tmax,
+                   Δt,
+                   sampling_period,
+                   tmax_is_exact,
+                   &plan->parameters_,
+                   &sprk_workspace_);
+    return;
+  }
+  auto const multistep_integrator = dynamic_cast<
+      SymmetricLinearMultistepIntegrator<Length, Speed> const*>(&integrator);
+  SolveAndAppend(*CHECK_NOTNULL(multistep_integrator),
+                 plan->data_,
+                 tmax,
+                 Δt,
+                 sampling_period,
+                 tmax_is_exact,
+                 &plan->parameters_,
+                 &multistep_workspace_);
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::IntegratePlan(
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    not_null<Plan*> const plan,
+    not_null<MassiveBodiesSteps*> const massive_steps) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK_LE(0, sampling_period);
+  CHECK_EQ(parameters_version_, plan->parameters_version_)
+      << "The plan must be updated";
+  Trajectories other_trajectories;
+  Trajectories close_trajectories;
+  if (close_encounter_timescale_fraction_ > 0 &&
+      FindCloseEncounters(plan->last_trajectories_,
+                          Δt,
+                          &other_trajectories,
+                          &close_trajectories)) {
+    IntegrateWithCloseEncounters(integrator,
+                                 tmax,
+                                 Δt,
+                                 sampling_period,
+                                 tmax_is_exact,
+                                 other_trajectories,
+                                 close_trajectories,
+                                 massive_steps);
+    return;
+  }
+  PrepareInitialState(tmax,
+                      &plan->data_,
+                      &plan->parameters_.initial.positions,
+                      &plan->parameters_.initial.momenta);
+  auto const sprk_integrator =
+      dynamic_cast<SPRKIntegrator<Length, Speed> const*>(&integrator);
+  if (sprk_integrator != nullptr) {
+    IntegrateAndRecord(*sprk_integrator,
+                       plan->data_,
+                       tmax,
+                       Δt,
+                       sampling_period,
+                       tmax_is_exact,
+                       &plan->parameters_,
+                       massive_steps,
+                       &sprk_workspace_);
+    return;
+  }
+  auto const multistep_integrator = dynamic_cast<
+      SymmetricLinearMultistepIntegrator<Length, Speed> const*>(&integrator);
+  IntegrateAndRecord(*CHECK_NOTNULL(multistep_integrator),
+                     plan->data_,
+                     tmax,
+                     Δt,
+                     sampling_period,
+                     tmax_is_exact,
+                     &plan->parameters_,
+                     massive_steps,
+                     &multistep_workspace_);
+}
+
+template<typename Frame>
+template<typename Integrator>
+void NBodySystem<Frame>::IntegrateAndRecord(
+    Integrator const& integrator,
+    IntegrationData const& data,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    not_null<typename Integrator::Parameters*> const parameters,
+    not_null<MassiveBodiesSteps*> const massive_steps,
+    not_null<typename Integrator::Workspace*> const workspace) const {
+  parameters->initial.time = data.initial_time - data.reference_time;
+  parameters->tmax = tmax - data.reference_time;
+  parameters->Δt = Δt;
+  // Every step is passed to the sink, which does the sampling itself.
+  parameters->sampling_period = 1;
+  parameters->tmax_is_exact = tmax_is_exact;
+
+  StartRecording(data, massive_steps);
+
+  // The last state, appended at the end of the integration if
+  // |sampling_period| is 0.  Initially the initial state, as in
+  // |SolveWithSink|.
+  Time last_time = parameters->initial.time.value;
+  DoublePrecisionVector<Length> last_positions;
+  DoublePrecisionVector<Speed> last_velocities;
+  last_positions.Assign(parameters->initial.positions);
+  last_velocities.Assign(parameters->initial.momenta);
+  RecordStep(data,
+             last_time,
+             last_positions.values,
+             last_velocities.values,
+             massive_steps);
+
+  auto const compute_gravitational_accelerations =
+      [this, &data](Time const& t,
+                    std::vector<Length> const& q,
+                    not_null<std::vector<Acceleration>*> const result) {
+    ComputeGravitationalAccelerations(data, t, q, result);
+  };
+  int sampling_phase = 0;
+  PointsBuffer buffer = MakePointsBuffer(data, tmax, Δt, sampling_period);
+  auto const record_and_append_to_trajectories =
+      [this, &data, massive_steps, sampling_period, &sampling_phase,
+       &last_time, &last_positions, &last_velocities, &buffer](
+          DoublePrecision<Time> const& time,
+          DoublePrecisionVector<Length> const& positions,
+          DoublePrecisionVector<Speed> const& momenta) {
+    RecordStep(
+        data, time.value, positions.values, momenta.values, massive_steps);
+    if (sampling_period == 0) {
+      last_time = time.value;
+      last_positions.values = positions.values;
+      last_velocities.values = momenta.values;
+    } else if (sampling_phase % sampling_period == 0) {
+      AppendToTrajectories(
+          data, time.value, positions.values, momenta.values, &buffer);
+    }
+    ++sampling_phase;
+  };
+  integrator.SolveWithSink(compute_gravitational_accelerations,
+                           *parameters,
+                           record_and_append_to_trajectories,
+                           workspace);
+  FlushPointsBuffer(data, &buffer);
+  if (sampling_period == 0) {
+    AppendToTrajectories(data,
+                         last_time,
+                         last_positions.values,
+                         last_velocities.values);
+  }
+}
+
+template<typename Frame>
+bool NBodySystem<Frame>::FindCloseEncounters(
+    Trajectories const& trajectories,
+    Time const& Δt,
+    not_null<Trajectories*> const other_trajectories,
+    not_null<Trajectories*> const close_trajectories) const {
+  ReadonlyTrajectories massive_trajectories;
+  for (auto const& trajectory : trajectories) {
+    if (!trajectory->template body<Body>()->is_massless()) {
+      massive_trajectories.push_back(trajectory);
+    }
+  }
+  // A body is in a close encounter if r³ < μ (Δt / timescale_fraction)².
+  Time const timescale = Δt / close_encounter_timescale_fraction_;
+  for (auto const& trajectory : trajectories) {
+    bool close = false;
+    if (trajectory->template body<Body>()->is_massless()) {
+      Position<Frame> const position =
+          trajectory->last().degrees_of_freedom().position();
+      for (auto const& massive_trajectory : massive_trajectories) {
+        Length const distance =
+            (position -
+             massive_trajectory->last().degrees_of_freedom().position()).
+                Norm();
+        if (Pow<3>(distance) <
+            massive_trajectory->template body<MassiveBody>()->
+                gravitational_parameter() * timescale * timescale) {
+          close = true;
+          break;
+        }
+      }
+    }
+    if (close) {
+      close_trajectories->push_back(trajectory);
+    } else {
+      other_trajectories->push_back(trajectory);
+    }
+  }
+  return !close_trajectories->empty();
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::IntegrateWithCloseEncounters(
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    Trajectories const& other_trajectories,
+    Trajectories const& close_trajectories,
+    MassiveBodiesSteps* const massive_steps) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  MassiveBodiesSteps own_massive_steps;
+  not_null<MassiveBodiesSteps*> const steps =
+      massive_steps == nullptr ? &own_massive_steps : massive_steps;
+  NBodySystem<Frame>::Integrate(integrator,
+                                tmax,
+                                Δt,
+                                sampling_period,
+                                tmax_is_exact,
+                                other_trajectories,
+                                steps);
+  for (auto const& trajectory : close_trajectories) {
+    IntegrateCloseEncounter(*steps, trajectory);
+  }
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::IntegrateCloseEncounter(
+    MassiveBodiesSteps const& massive_steps,
+    not_null<Trajectory<Frame>*> const trajectory) const {
+  IntegrationData const& massive_data = massive_steps.data_;
+  MassiveBodiesHistory const& history = massive_steps.history_;
+  if (history.times.size() < 2) {
+    // Not even one step.
+    return;
+  }
+  CHECK_EQ(massive_data.reference_time + history.times.front(),
+           trajectory->last().time())
+      << "Inconsistent last time in trajectories";
+  // Only the trajectories of |massive_data| are meaningful, the constants of
+  // the massive bodies are extracted as in |IntegrateMasslessBodiesInField|.
+  MassiveBodiesTable const massive_bodies =
+      MakeMassiveBodiesTable(massive_data.massive_oblate_trajectories,
+                             massive_data.massive_spherical_trajectories);
+  std::unique_ptr<Hierarchy const> const hierarchy =
+      MakeHierarchy(massive_data.massive_oblate_trajectories,
+                    massive_data.massive_spherical_trajectories);
+  std::size_t const number_of_massive_trajectories =
+      massive_bodies.gravitational_parameters.size();
+
+  // The massive body with the shortest free-fall time scale, i.e., the
+  // smallest r³ / μ, is the centre of the regularized motion.
+  DegreesOfFreedom<Frame> const& initial =
+      trajectory->last().degrees_of_freedom();
+  R3Element<Length> const initial_position =
+      (initial.position() - massive_data.reference_position).coordinates();
+  R3Element<Speed> const initial_velocity = initial.velocity().coordinates();
+  std::size_t centre = 0;
+  Exponentiation<Time, 2> shortest_timescale²;
+  R3Element<Length> r;
+  R3Element<Speed> w;
+  std::vector<Length> const& initial_positions = history.positions.front();
+  std::vector<Speed> const& initial_velocities = history.velocities.front();
+  for (std::size_t b = 0; b < number_of_massive_trajectories; ++b) {
+    R3Element<Length> relative_position;
+    for (int k = 0; k < 3; ++k) {
+      relative_position[k] =
+          initial_position[k] -
+          initial_positions[IndexOf(b, k, massive_data.stride)];
+    }
+    Exponentiation<Time, 2> const timescale² =
+        Pow<3>(relative_position.Norm()) /
+        massive_bodies.gravitational_parameters[b];
+    if (b == 0 || timescale² < shortest_timescale²) {
+      centre = b;
+      shortest_timescale² = timescale²;
+      r = relative_position;
+    }
+  }
+  for (int k = 0; k < 3; ++k) {
+    w[k] = initial_velocity[k] -
+           initial_velocities[IndexOf(centre, k, massive_data.stride)];
+  }
+  GravitationalParameter const& μ =
+      massive_bodies.gravitational_parameters[centre];
+
+  // The perturbation of the Keplerian motion around the centre: the
+  // acceleration of the body in the field of all the massive bodies, minus
+  // that of the centre, minus the Keplerian acceleration.
+  std::size_t const stride = Stride(number_of_massive_trajectories + 1);
+  std::size_t const b2 = number_of_massive_trajectories;
+  std::vector<Length> q_all(3 * stride);
+  std::vector<Acceleration> result_all(3 * stride);
+  std::vector<Acceleration> massive_accelerations_all(3 * stride);
+  ReadonlyTrajectories const massless_trajectories = {trajectory};
+  auto const compute_perturbation =
+      [this, &massive_data, &history, &massive_bodies, &hierarchy,
+       &massless_trajectories, centre, b2, stride, &μ, &q_all, &result_all,
+       &massive_accelerations_all](
+          Time const& t,
+          R3Element<Length> const& r) -> R3Element<Acceleration> {
+    ++statistics_.force_evaluations;
+    InterpolateMassivePositions(massive_data,
+                                history,
+                                massive_data.reference_position,
+                                t,
+                                stride,
+                                &q_all);
+    for (int k = 0; k < 3; ++k) {
+      q_all[IndexOf(b2, k, stride)] =
+          q_all[IndexOf(centre, k, stride)] + r[k];
+      result_all[IndexOf(b2, k, stride)] = Acceleration();
+    }
+    if (layout_ == Layout::kInterleaved) {
+      ComputeGravitationalAccelerations<Layout::kInterleaved>(
+          massive_bodies,
+          ReadonlyTrajectories(),
+          nullptr /*hierarchy*/,
+          nullptr /*interaction_lists*/,
+          massive_data.reference_time,
+          stride,
+          nullptr /*thread_pool*/,
+          1 /*chunks_per_thread*/,
+          t,
+          q_all,
+          &massive_accelerations_all);
+      if (hierarchy != nullptr) {
+        ComputeSubsystems<Layout::kInterleaved>(*hierarchy,
+                                                massive_bodies,
+                                                stride,
+                                                q_all);
+      }
+      ComputeMasslessBodiesGravitationalAccelerations<Layout::kInterleaved>(
+          massive_bodies,
+          massless_trajectories,
+          hierarchy.get(),
+          nullptr /*interaction_lists*/,
+          massive_data.reference_time,
+          b2 /*b2_begin*/,
+          b2 + 1 /*b2_end*/,
+          stride,
+          t,
+          q_all,
+          &result_all);
+    } else {
+      ComputeGravitationalAccelerations<Layout::kStructureOfArrays>(
+          massive_bodies,
+          ReadonlyTrajectories(),
+          nullptr /*hierarchy*/,
+          nullptr /*interaction_lists*/,
+          massive_data.reference_time,
+          stride,
+          nullptr /*thread_pool*/,
+          1 /*chunks_per_thread*/,
+          t,
+          q_all,
+          &massive_accelerations_all);
+      if (hierarchy != nullptr) {
+        ComputeSubsystems<Layout::kStructureOfArrays>(*hierarchy,
+                                                      massive_bodies,
+                                                      stride,
+                                                      q_all);
+      }
+      ComputeMasslessBodiesGravitationalAccelerations<
+          Layout::kStructureOfArrays>(
+          massive_bodies,
+          massless_trajectories,
+          hierarchy.get(),
+          nullptr /*interaction_lists*/,
+          massive_data.reference_time,
+          b2 /*b2_begin*/,
+          b2 + 1 /*b2_end*/,
+          stride,
+          t,
+          q_all,
+          &result_all);
+    }
+    R3Element<Acceleration> perturbation = μ * r / Pow<3>(r.Norm());
+    for (int k = 0; k < 3; ++k) {
+      perturbation[k] += result_all[IndexOf(b2, k, stride)] -
+                         massive_accelerations_all[IndexOf(centre, k, stride)];
+    }
+    return perturbation;
+  };
+
+  // The logarithmic Hamiltonian leapfrog, drift-kick-drift in the fictitious
+  // time s, where dt = ds / U with U = μ / r.  The drifts use the identity
+  // U = T + B, where T = w² / 2 and the binding energy B = U - T is integrated
+  // along with the state, so that they only depend on the velocity.  The step
+  // in s is chosen so that the first step is |timescale_fraction| times the
+  // free-fall time scale, like the steps at the threshold of the close
+  // encounters; the later steps are proportional to the distance.
+  Quotient<Exponentiation<Length, 2>, Time> const Δs =
+      close_encounter_timescale_fraction_ * Sqrt(μ * r.Norm());
+  Time t = history.times.front();
+  Time const t_final = history.times.back();
+  SpecificEnergy B = μ / r.Norm() - Dot(w, w) / 2;
+  for (;;) {
+    Time const t_start = t;
+    R3Element<Length> const r_start = r;
+    R3Element<Speed> const w_start = w;
+    SpecificEnergy const B_start = B;
+
+    Time δt = (Δs / 2) / (Dot(w, w) / 2 + B);
+    r += δt * w;
+    t += δt;
+    δt = Δs / (μ / r.Norm());
+    R3Element<Acceleration> const f = compute_perturbation(t, r);
+    R3Element<Speed> const w_kicked = w + δt * (f - μ * r / Pow<3>(r.Norm()));
+    B -= δt * Dot((w + w_kicked) / 2, f);
+    w = w_kicked;
+    δt = (Δs / 2) / (Dot(w, w) / 2 + B);
+    r += δt * w;
+    t += δt;
+
+    if (t > t_final) {
+      t = t_start;
+      r = r_start;
+      w = w_start;
+      B = B_start;
+      break;
+    }
+  }
+  // The remainder, shorter than a step of the regularized method, is covered
+  // by a drift-kick-drift leapfrog in t.
+  Time const h = t_final - t;
+  r += (h / 2) * w;
+  t += h / 2;
+  w += h * (compute_perturbation(t, r) - μ * r / Pow<3>(r.Norm()));
+  r += (h / 2) * w;
+
+  // The states of the centre at the ends of the interval are those recorded.
+  std::vector<Length> const& final_positions = history.positions.back();
+  std::vector<Speed> const& final_velocities = history.velocities.back();
+  R3Element<Length> q;
+  R3Element<Speed> v;
+  for (int k = 0; k < 3; ++k) {
+    std::size_t const index = IndexOf(centre, k, massive_data.stride);
+    q[k] = r[k] + final_positions[index];
+    v[k] = w[k] + final_velocities[index];
+  }
+  ++statistics_.points_appended;
+  trajectory->Append(
+      massive_data.reference_time + t_final,
+      DegreesOfFreedom<Frame>(
+          Displacement<Frame>(q) + massive_data.reference_position,
+          Velocity<Frame>(v)));
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::StartRecording(
+    IntegrationData const& data,
+    not_null<MassiveBodiesSteps*> const massive_steps) const {
+  // The massive bodies come first in the state vectors; their states are
+  // recorded with the stride of an integration of the massive bodies alone.
+  std::size_t const number_of_massive_trajectories =
+      data.massive_oblate_trajectories.size() +
+      data.massive_spherical_trajectories.size();
+  IntegrationData& massive_data = massive_steps->data_;
+  massive_data.trajectories.assign(
+      data.trajectories.begin(),
+      data.trajectories.begin() + number_of_massive_trajectories);
+  massive_data.massive_oblate_trajectories = data.massive_oblate_trajectories;
+  massive_data.massive_spherical_trajectories =
+      data.massive_spherical_trajectories;
+  massive_data.massless_trajectories.clear();
+  massive_data.stride = Stride(number_of_massive_trajectories);
+  massive_data.initial_time = data.initial_time;
+  massive_data.reference_position = data.reference_position;
+  massive_data.reference_time = data.reference_time;
+  massive_steps->history_ = MassiveBodiesHistory();
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::RecordStep(
+    IntegrationData const& data,
+    Time const& time,
+    std::vector<Length> const& positions,
+    std::vector<Speed> const& velocities,
+    not_null<MassiveBodiesSteps*> const massive_steps) const {
+  IntegrationData const& massive_data = massive_steps->data_;
+  MassiveBodiesHistory& history = massive_steps->history_;
+  history.times.push_back(time);
+  history.positions.emplace_back(3 * massive_data.stride);
+  history.velocities.emplace_back(3 * massive_data.stride);
+  for (std::size_t b = 0; b < massive_data.trajectories.size(); ++b) {
+    for (int k = 0; k < 3; ++k) {
+      std::size_t const from = IndexOf(b, k, data.stride);
+      std::size_t const to = IndexOf(b, k, massive_data.stride);
+      history.positions.back()[to] = positions[from];
+      history.velocities.back()[to] = velocities[from];
+    }
+  }
+}
+
+template<typename Frame>
+typename NBodySystem<Frame>::JacobiTree NBodySystem<Frame>::MakeJacobiTree(
+    IntegrationData const& data,
+    std::map<MassiveBody const*, MassiveBody const*> const& parents,
+    std::vector<Length> const& positions) const {
+  std::size_t const number_of_massive_trajectories =
+      data.massive_oblate_trajectories.size() +
+      data.massive_spherical_trajectories.size();
+  JacobiTree tree;
+  tree.gravitational_parameters =
+      data.massive_bodies.gravitational_parameters;
+  if (number_of_massive_trajectories == 0) {
+    return tree;
+  }
+  std::map<MassiveBody const*, std::size_t> indices;
+  std::vector<MassiveBody const*> bodies;
+  for (auto const& trajectories : {&data.massive_oblate_trajectories,
+                                   &data.massive_spherical_trajectories}) {
+    for (auto const& trajectory : *trajectories) {
+      MassiveBody const* const body =
+          trajectory->template body<MassiveBody>();
+      indices.emplace(body, bodies.size());
+      bodies.push_back(body);
+    }
+  }
+
+  std::vector<std::size_t> roots;
+  std::vector<std::vector<std::size_t>> children(
+      number_of_massive_trajectories);
+  for (std::size_t b = 0; b < number_of_massive_trajectories; ++b) {
+    auto const it = parents.find(bodies[b]);
+    auto const parent_it =
+        it == parents.end() ? indices.end() : indices.find(it->second);
+    if (parent_it == indices.end()) {
+      roots.push_back(b);
+    } else {
+      children[parent_it->second].push_back(b);
+    }
+  }
+  CHECK_EQ(1, roots.size()) << "The Jacobi coordinates need a single root";
+
+  // The closest children are merged first.
+  auto const distance_squared = [this, &data, &positions](
+                                    std::size_t const b1,
+                                    std::size_t const b2) {
+    Exponentiation<Length, 2> result;
+    for (int k = 0; k < 3; ++k) {
+      Length const δ = positions[IndexOf(b2, k, data.stride)] -
+                       positions[IndexOf(b1, k, data.stride)];
+      result += δ * δ;
+    }
+    return result;
+  };
+  for (std::size_t b = 0; b < number_of_massive_trajectories; ++b) {
+    std::sort(children[b].begin(),
+              children[b].end(),
+              [b, &distance_squared](std::size_t const left,
+                                     std::size_t const right) {
+                return distance_squared(b, left) < distance_squared(b, right);
+              });
+  }
+  AddJacobiMergers(roots.front(), children, &tree);
+  CHECK_EQ(number_of_massive_trajectories - 1, tree.lefts.size())
+      << "Cycle in the parents of the Jacobi coordinates";
+  return tree;
+}
+
+template<typename Frame>
+std::size_t NBodySystem<Frame>::AddJacobiMergers(
+    std::size_t const b,
+    std::vector<std::vector<std::size_t>> const& children,
+    not_null<JacobiTree*> const tree) {
+  std::size_t node = b;
+  for (std::size_t const child : children[b]) {
+    std::size_t const right = AddJacobiMergers(child, children, tree);
+    tree->lefts.push_back(node);
+    tree->rights.push_back(right);
+    tree->gravitational_parameters.push_back(
+        tree->gravitational_parameters[node] +
+        tree->gravitational_parameters[right]);
+    node = children.size() + tree->lefts.size() - 1;
+  }
+  return node;
+}
+
+template<typename Frame>
+template<typename Scalar>
+void NBodySystem<Frame>::ToJacobi(
+    JacobiTree const& tree,
+    std::size_t const stride,
+    std::vector<Scalar> const& cartesian,
+    not_null<std::vector<Scalar>*> const jacobi,
+    not_null<std::vector<R3Element<Scalar>>*> const nodes) const {
+  *jacobi = cartesian;
+  std::size_t const number_of_massive_bodies =
+      tree.gravitational_parameters.size() - tree.lefts.size();
+  if (number_of_massive_bodies == 0) {
+    return;
+  }
+  nodes->resize(tree.gravitational_parameters.size());
+  for (std::size_t b = 0; b < number_of_massive_bodies; ++b) {
+    (*nodes)[b] = R3Element<Scalar>(cartesian[IndexOf(b, 0, stride)],
+                                    cartesian[IndexOf(b, 1, stride)],
+                                    cartesian[IndexOf(b, 2, stride)]);
+  }
+  for (std::size_t j = 0; j < tree.lefts.size(); ++j) {
+    std::size_t const left = tree.lefts[j];
+    std::size_t const right = tree.rights[j];
+    std::size_t const centre = number_of_massive_bodies + j;
+    GravitationalParameter const& μ = tree.gravitational_parameters[centre];
+    (*nodes)[centre] =
+        (*nodes)[left] * (tree.gravitational_parameters[left] / μ) +
+        (*nodes)[right] * (tree.gravitational_parameters[right] / μ);
+    R3Element<Scalar> const relative = (*nodes)[right] - (*nodes)[left];
+    for (int k = 0; k < 3; ++k) {
+      (*jacobi)[IndexOf(j + 1, k, stride)] = relative[k];
+    }
+  }
+  for (int k = 0; k < 3; ++k) {
+    (*jacobi)[IndexOf(0, k, stride)] = nodes->back()[k];
+  }
+}
+
+template<typename Frame>
+template<typename Scalar>
+void NBodySystem<Frame>::FromJacobi(
+    JacobiTree const& tree,
+    std::size_t const stride,
+    std::vector<Scalar> const& jacobi,
+    not_null<std::vector<Scalar>*> const cartesian,
+    not_null<std::vector<R3Element<Scalar>>*> const nodes) const {
+  *cartesian = jacobi;
+  std::size_t const number_of_massive_bodies =
+      tree.gravitational_parameters.size() - tree.lefts.size();
+  if (number_of_massive_bodies == 0) {
+    return;
+  }
+  nodes->resize(tree.gravitational_parameters.size());
+  nodes->back() = R3Element<Scalar>(jacobi[IndexOf(0, 0, stride)],
+                                    jacobi[IndexOf(0, 1, stride)],
+                                    jacobi[IndexOf(0, 2, stride)]);
+  for (std::size_t j = tree.lefts.size(); j-- > 0;) {
+    std::size_t const left = tree.lefts[j];
+    std::size_t const right = tree.rights[j];
+    std::size_t const centre = number_of_massive_bodies + j;
+    GravitationalParameter const& μ = tree.gravitational_parameters[centre];
+    R3Element<Scalar> const relative(jacobi[IndexOf(j + 1, 0, stride)],
+                                     jacobi[IndexOf(j + 1, 1, stride)],
+                                     jacobi[IndexOf(j + 1, 2, stride)]);
+    (*nodes)[left] = (*nodes)[centre] -
+                     relative * (tree.gravitational_parameters[right] / μ);
+    (*nodes)[right] = (*nodes)[centre] +
+                      relative * (tree.gravitational_parameters[left] / μ);
+  }
+  for (std::size_t b = 0; b < number_of_massive_bodies; ++b) {
+    for (int k = 0; k < 3; ++k) {
+      (*cartesian)[IndexOf(b, k, stride)] = (*nodes)[b][k];
+    }
+  }
+}
+
+template<typename Frame>
+template<typename Sink>
+void NBodySystem<Frame>::SolveWisdomHolman(
+    WisdomHolmanIntegrator<Length, Speed> const& integrator,
+    std::map<MassiveBody const*, MassiveBody const*> const& parents,
+    IntegrationData const& data,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    not_null<SymplecticIntegrator<Length, Speed>::Parameters*> const
+        parameters,
+    Sink sink) const {
+  parameters->initial.time = data.initial_time - data.reference_time;
+  parameters->tmax = tmax - data.reference_time;
+  parameters->Δt = Δt;
+  parameters->sampling_period = sampling_period;
+  parameters->tmax_is_exact = tmax_is_exact;
+
+  std::size_t const number_of_massive_trajectories =
+      data.massive_oblate_trajectories.size() +
+      data.massive_spherical_trajectories.size();
+  std::size_t const dimension = parameters->initial.positions.size();
+
+  // The Cartesian state, and the scratch storage of the conversions, reused
+  // across steps.
+  std::vector<Length> positions(dimension);
+  std::vector<Speed> velocities(dimension);
+  std::vector<Acceleration> accelerations(dimension);
+  std::vector<R3Element<Length>> position_nodes;
+  std::vector<R3Element<Speed>> velocity_nodes;
+  std::vector<R3Element<Acceleration>> acceleration_nodes;
+  for (std::size_t i = 0; i < dimension; ++i) {
+    positions[i] = parameters->initial.positions[i].value;
+    velocities[i] = parameters->initial.momenta[i].value;
+  }
+  JacobiTree const tree = MakeJacobiTree(data, parents, positions);
+  {
+    std::vector<Length> jacobi_positions;
+    std::vector<Speed> jacobi_velocities;
+    ToJacobi<Length>(
+        tree, data.stride, positions, &jacobi_positions, &position_nodes);
+    ToJacobi<Speed>(
+        tree, data.stride, velocities, &jacobi_velocities, &velocity_nodes);
+    for (std::size_t i = 0; i < dimension; ++i) {
+      parameters->initial.positions[i] = jacobi_positions[i];
+      parameters->initial.momenta[i] = jacobi_velocities[i];
+    }
+  }
+
+  // The kicks: all the forces, less the Keplerian ones of the drifts.
+  auto const compute_interaction =
+      [this, &data, &tree, number_of_massive_trajectories, &positions,
+       &accelerations, &position_nodes, &acceleration_nodes](
+          Time const& t,
+          std::vector<Length> const& q,
+          not_null<std::vector<Acceleration>*> const result) {
+    FromJacobi<Length>(tree, data.stride, q, &positions, &position_nodes);
+    ComputeGravitationalAccelerations(data, t, positions, &accelerations);
+    ToJacobi<Acceleration>(
+        tree, data.stride, accelerations, result, &acceleration_nodes);
+    for (std::size_t j = 0; j < tree.lefts.size(); ++j) {
+      R3Element<Length> const r(q[IndexOf(j + 1, 0, data.stride)],
+                                q[IndexOf(j + 1, 1, data.stride)],
+                                q[IndexOf(j + 1, 2, data.stride)]);
+      Length const r_norm = r.Norm();
+      auto const μ_over_r³ =
+          tree.gravitational_parameters[number_of_massive_trajectories + j] /
+          (r_norm * r_norm * r_norm);
+      for (int k = 0; k < 3; ++k) {
+        (*result)[IndexOf(j + 1, k, data.stride)] += μ_over_r³ * r[k];
+      }
+    }
+  };
+
+  // The drifts: Keplerian orbits for the relative positions, straight lines
+  // for the barycentre and the massless bodies.
+  auto const advance_unperturbed =
+      [this, &data, &tree, number_of_massive_trajectories](
+          Time const& t,
+          Time const& h,
+          not_null<std::vector<Length>*> const q,
+          not_null<std::vector<Speed>*> const v) {
+    for (std::size_t b = 0; b < data.trajectories.size(); ++b) {
+      if (b == 0 || b >= number_of_massive_trajectories) {
+        for (int k = 0; k < 3; ++k) {
+          std::size_t const i = IndexOf(b, k, data.stride);
+          (*q)[i] += h * (*v)[i];
+        }
+        continue;
+      }
+      Displacement<Frame> const r(
+          R3Element<Length>((*q)[IndexOf(b, 0, data.stride)],
+                            (*q)[IndexOf(b, 1, data.stride)],
+                            (*q)[IndexOf(b, 2, data.stride)]));
+      Velocity<Frame> const ṙ(
+          R3Element<Speed>((*v)[IndexOf(b, 0, data.stride)],
+                           (*v)[IndexOf(b, 1, data.stride)],
+                           (*v)[IndexOf(b, 2, data.stride)]));
+      KeplerOrbit<Frame> const orbit(
+          tree.gravitational_parameters[number_of_massive_trajectories + b -
+                                        1],
+          RelativeDegreesOfFreedom<Frame>(r, ṙ),
+          Instant());
+      RelativeDegreesOfFreedom<Frame> const advanced =
+          orbit.RelativeDegreesOfFreedomAt(Instant() + h);
+      for (int k = 0; k < 3; ++k) {
+        std::size_t const i = IndexOf(b, k, data.stride);
+        (*q)[i] = advanced.displacement().coordinates()[k];
+        (*v)[i] = advanced.velocity().coordinates()[k];
+      }
+    }
+  };
+
+  auto const convert_and_sink =
+      [this, &data, &tree, &sink, &positions, &velocities, &position_nodes,
+       &velocity_nodes](DoublePrecision<Time> const& time,
+                        DoublePrecisionVector<Length> const& q,
+                        DoublePrecisionVector<Speed> const& v) {
+    FromJacobi<Length>(
+        tree, data.stride, q.values, &positions, &position_nodes);
+    FromJacobi<Speed>(
+        tree, data.stride, v.values, &velocities, &velocity_nodes);
+    sink(time.value, positions, velocities);
+  };
+  integrator.SolveWithSink(compute_interaction,
+                           advance_unperturbed,
+                           *parameters,
+                           convert_and_sink,
+                           &wisdom_holman_workspace_);
+}
+
+template<typename Frame>
+template<typename Integrator>
+void NBodySystem<Frame>::IntegrateStatically(
+    Integrator const& integrator,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    Trajectories const& trajectories,
+    not_null<typename Integrator::Workspace*> const workspace) const {
+  IntegrationData data;
+  typename Integrator::Parameters parameters;
+  PrepareIntegration(trajectories,
+                     tmax,
+                     &data,
+                     &parameters.initial.positions,
+                     &parameters.initial.momenta);
+  SolveAndAppend(integrator,
+                 data,
+                 tmax,
+                 Δt,
+                 sampling_period,
+                 tmax_is_exact,
+                 &parameters,
+                 workspace);
+}
+
+template<typename Frame>
+template<typename Integrator>
+void NBodySystem<Frame>::SolveAndAppend(
+    Integrator const& integrator,
+    IntegrationData const& data,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    not_null<typename Integrator::Parameters*> const parameters,
+    not_null<typename Integrator::Workspace*> const workspace) const {
+  parameters->initial.time = data.initial_time - data.reference_time;
+  parameters->tmax = tmax - data.reference_time;
+  parameters->Δt = Δt;
+  parameters->sampling_period = sampling_period;
+  parameters->tmax_is_exact = tmax_is_exact;
+
+  // The force computation is a lambda, not a |std::function|, so that it may
+  // be inlined in the stages of |Solve|.  It captures |data| by reference, it
+  // outlives the integration.
+  auto const compute_gravitational_accelerations =
+      [this, &data](Time const& t,
+                    std::vector<Length> const& q,
+                    not_null<std::vector<Acceleration>*> const result) {
+    ComputeGravitationalAccelerations(data, t, q, result);
+  };
+  // The sampled states are appended to the trajectories in batches.
+  PointsBuffer buffer = MakePointsBuffer(data, tmax, Δt, sampling_period);
+  auto const append_to_trajectories =
+      [this, &data, &buffer](DoublePrecision<Time> const& time,
+                             DoublePrecisionVector<Length> const& positions,
+                             DoublePrecisionVector<Speed> const& momenta) {
+    AppendToTrajectories(
+        data, time.value, positions.values, momenta.values, &buffer);
+  };
+  integrator.SolveWithSink(compute_gravitational_accelerations,
+                           *parameters,
+                           append_to_trajectories,
+                           workspace);
+  FlushPointsBuffer(data, &buffer);
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::SolveAndAppend(
+    ForceGradientIntegrator<Length, Speed> const& integrator,
+    IntegrationData const& data,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    not_null<ForceGradientIntegrator<Length, Speed>::Parameters*> const
+        parameters,
+    not_null<ForceGradientIntegrator<Length, Speed>::Workspace*> const
+        workspace) const {
+  parameters->initial.time = data.initial_time - data.reference_time;
+  parameters->tmax = tmax - data.reference_time;
+  parameters->Δt = Δt;
+  parameters->sampling_period = sampling_period;
+  parameters->tmax_is_exact = tmax_is_exact;
+
+  auto const compute_modified_gravitational_accelerations =
+      [this, &data](Time const& t,
+                    std::vector<Length> const& q,
+                    Exponentiation<Time, 2> const& c,
+                    not_null<std::vector<Acceleration>*> const result) {
+    ComputeModifiedGravitationalAccelerations(data, t, q, c, result);
+  };
+  PointsBuffer buffer = MakePointsBuffer(data, tmax, Δt, sampling_period);
+  auto const append_to_trajectories =
+      [this, &data, &buffer](DoublePrecision<Time> const& time,
+                             DoublePrecisionVector<Length> const& positions,
+                             DoublePrecisionVector<Speed> const& momenta) {
+    AppendToTrajectories(
+        data, time.value, positions.values, momenta.values, &buffer);
+  };
+  integrator.SolveWithSink(compute_modified_gravitational_accelerations,
+                           *parameters,
+                           append_to_trajectories,
+                           workspace);
+  FlushPointsBuffer(data, &buffer);
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::Integrate(
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    Trajectories const& trajectories,
+    not_null<SynchronizedHistories<Frame>*> const histories) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  auto const sprk_integrator =
+      dynamic_cast<SPRKIntegrator<Length, Speed> const*>(&integrator);
+  if (sprk_integrator != nullptr) {
+    IntegrateToHistories(*sprk_integrator,
+                         tmax,
+                         Δt,
+                         sampling_period,
+                         tmax_is_exact,
+                         trajectories,
+                         histories,
+                         &sprk_workspace_);
+    return;
+  }
+  auto const multistep_integrator = dynamic_cast<
+      SymmetricLinearMultistepIntegrator<Length, Speed> const*>(&integrator);
+  IntegrateToHistories(*CHECK_NOTNULL(multistep_integrator),
+                       tmax,
+                       Δt,
+                       sampling_period,
+                       tmax_is_exact,
+                       trajectories,
+                       histories,
+                       &multistep_workspace_);
+}
+
+template<typename Frame>
+template<typename Integrator>
+void NBodySystem<Frame>::IntegrateToHistories(
+    Integrator const& integrator,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    Trajectories const& trajectories,
+    not_null<SynchronizedHistories<Frame>*> const histories,
+    not_null<typename Integrator::Workspace*> const workspace) const {
+  CHECK_EQ(histories->number_of_bodies(), trajectories.size());
+  IntegrationData data;
+  typename Integrator::Parameters parameters;
+  PrepareIntegration(trajectories,
+                     tmax,
+                     &data,
+                     &parameters.initial.positions,
+                     &parameters.initial.momenta);
+  if (histories->empty()) {
+    histories->Append(data.initial_time,
+                      [&trajectories](int const i) {
+                        return trajectories[i]->last().degrees_of_freedom();
+                      });
+  } else {
+    CHECK_EQ(histories->last_time(), data.initial_time);
+  }
+  // |PrepareIntegration| sorts the trajectories by kind of body.
+  std::map<Trajectory<Frame> const*, std::size_t> indices;
+  for (std::size_t b = 0; b < data.trajectories.size(); ++b) {
+    indices.emplace(data.trajectories[b], b);
+  }
+  data.history_columns.reserve(trajectories.size());
+  for (auto const& trajectory : trajectories) {
+    data.history_columns.push_back(indices[trajectory]);
+  }
+  data.histories = histories;
+
+  SolveAndAppend(integrator,
+                 data,
+                 tmax,
+                 Δt,
+                 sampling_period,
+                 tmax_is_exact,
+                 &parameters,
+                 workspace);
+
+  if (data.initial_time < histories->last_time()) {
+    std::size_t const last = histories->size() - 1;
+    for (std::size_t i = 0; i < trajectories.size(); ++i) {
+      trajectories[i]->Append(histories->last_time(),
+                              histories->degrees_of_freedom(last, i));
+    }
+  }
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::IntegrateAdaptively(
+    EmbeddedExplicitRungeKuttaNyströmIntegrator<Length> const& integrator,
+    Instant const& tmax,
+    Time const& first_time_step,
+    Length const& length_integration_tolerance,
+    Speed const& speed_integration_tolerance,
+    Trajectories const& trajectories) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  IntegrationData data;
+  typename EmbeddedExplicitRungeKuttaNyströmIntegrator<Length>::Parameters
+      parameters;
+  PrepareIntegration(trajectories,
+                     tmax,
+                     &data,
+                     &parameters.initial.positions,
+                     &parameters.initial.velocities);
+  parameters.initial.time = data.initial_time - data.reference_time;
+  parameters.tmax = tmax - data.reference_time;
+  parameters.first_time_step = first_time_step;
+  parameters.length_integration_tolerance = length_integration_tolerance;
+  parameters.speed_integration_tolerance = speed_integration_tolerance;
+
+  auto const compute_gravitational_accelerations =
+      [this, &data](Time const& t,
+                    std::vector<Length> const& q,
+                    not_null<std::vector<Acceleration>*> const result) {
+    ComputeGravitationalAccelerations(data, t, q, result);
+  };
+  typename EmbeddedExplicitRungeKuttaNyströmIntegrator<Length>::SystemState
+      final_state;
+  integrator.Solve(compute_gravitational_accelerations,
+                   parameters,
+                   &final_state,
+                   &rkn_workspace_);
+  DoublePrecisionVector<Length> final_positions;
+  DoublePrecisionVector<Speed> final_velocities;
+  final_positions.Assign(final_state.positions);
+  final_velocities.Assign(final_state.velocities);
+  AppendToTrajectories(data,
+                       final_state.time.value,
+                       final_positions.values,
+                       final_velocities.values);
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::IntegrateWithBlockTimeSteps(
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    Instant const& tmax,
+    Time const& Δt,
+    double const timescale_fraction,
+    int const max_level,
+    Trajectories const& trajectories) const {
+  CHECK_LT(0.0, timescale_fraction);
+  CHECK_LE(0, max_level);
+  auto const sprk_integrator =
+      dynamic_cast<SPRKIntegrator<Length, Speed> const*>(&integrator);
+  CHECK_NOTNULL(sprk_integrator);
+
+  Trajectories massive_trajectories;
+  Trajectories massless_trajectories;
+  for (auto const& trajectory : trajectories) {
+    if (trajectory->template body<Body>()->is_massless()) {
+      massless_trajectories.push_back(trajectory);
+    } else {
+      massive_trajectories.push_back(trajectory);
+    }
+  }
+  CHECK(!massive_trajectories.empty()) << "No massive bodies";
+
+  // Assign the massless bodies to their levels based on their initial states.
+  std::vector<Trajectories> levels(max_level + 1);
+  for (auto const& massless_trajectory : massless_trajectories) {
+    CHECK_EQ(massive_trajectories.front()->last().time(),
+             massless_trajectory->last().time())
+        << "Inconsistent last time in trajectories";
+    Position<Frame> const position =
+        massless_trajectory->last().degrees_of_freedom().position();
+    Time timescale;
+    bool first = true;
+    for (auto const& massive_trajectory : massive_trajectories) {
+      Length const distance =
+          (position -
+           massive_trajectory->last().degrees_of_freedom().position()).Norm();
+      Time const body_timescale =
+          Sqrt(Pow<3>(distance) /
+               massive_trajectory->template body<MassiveBody>()->
+                   gravitational_parameter());
+      if (first || body_timescale < timescale) {
+        timescale = body_timescale;
+        first = false;
+      }
+    }
+    int level = 0;
+    Time h = Δt;
+    while (level < max_level && h > timescale_fraction * timescale) {
+      h /= 2;
+      ++level;
+    }
+    levels[level].push_back(massless_trajectory);
+  }
+
+  // Integrate the massive bodies with the base step, recording their states at
+  // each step.  They don't depend on the massless bodies.
+  IntegrationData massive_data;
+  SPRKIntegrator<Length, Speed>::Parameters parameters;
+  PrepareIntegration(massive_trajectories,
+                     tmax,
+                     &massive_data,
+                     &parameters.initial.positions,
+                     &parameters.initial.momenta);
+  parameters.initial.time = massive_data.initial_time -
+                            massive_data.reference_time;
+  parameters.tmax = tmax - massive_data.reference_time;
+  parameters.Δt = Δt;
+  parameters.sampling_period = 1;
+  parameters.tmax_is_exact = false;
+
+  MassiveBodiesHistory history;
+  auto const record =
+      [&history](DoublePrecision<Time> const& time,
+                 DoublePrecisionVector<Length> const& positions,
+                 DoublePrecisionVector<Speed> const& momenta) {
+    history.times.push_back(time.value);
+    history.positions.push_back(positions.values);
+    history.velocities.push_back(momenta.values);
+  };
+  {
+    DoublePrecisionVector<Length> initial_positions;
+    DoublePrecisionVector<Speed> initial_momenta;
+    initial_positions.Assign(parameters.initial.positions);
+    initial_momenta.Assign(parameters.initial.momenta);
+    record(parameters.initial.time, initial_positions, initial_momenta);
+  }
+  auto const compute_massive_accelerations =
+      [this, &massive_data](
+          Time const& t,
+          std::vector<Length> const& q,
+          not_null<std::vector<Acceleration>*> const result) {
+    ComputeGravitationalAccelerations(massive_data, t, q, result);
+  };
+  sprk_integrator->SolveWithSink(compute_massive_accelerations,
+                                 parameters,
+                                 record,
+                                 &sprk_workspace_);
+  if (history.times.size() == 1) {
+    // Not even one step.
+    return;
+  }
+  Time const final_time = history.times.back();
+  AppendToTrajectories(massive_data,
+                       final_time,
+                       history.positions.back(),
+                       history.velocities.back());
+
+  // Integrate each level with its step, up to the final time of the massive
+  // bodies.
+  for (int level = 0; level <= max_level; ++level) {
+    if (levels[level].empty()) {
+      continue;
+    }
+    IntegrateMasslessBodiesInField(
+        *sprk_integrator,
+        massive_data.massive_oblate_trajectories,
+        massive_data.massive_spherical_trajectories,
+        [this, &massive_data, &history](
+            IntegrationData const& data,
+            Time const& t,
+            std::size_t const stride,
+            not_null<std::vector<Length>*> const q) {
+          InterpolateMassivePositions(
+              massive_data,
+              history,
+              data.reference_position,
+              t + (data.reference_time - massive_data.reference_time),
+              stride,
+              q);
+        },
+        // Not called, since the massless bodies are not integrated relative
+        // to their parents.
+        [](IntegrationData const& data,
+           Time const& t,
+           std::size_t const stride,
+           not_null<std::vector<Speed>*> const v) {},
+        std::vector<std::size_t>(),  // parents
+        massive_data.reference_time + final_time,
+        Δt / (1 << level),
+        0,     // sampling_period
+        true,  // tmax_is_exact
+        levels[level]);
+  }
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::IntegrateMasslessBodies(
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    not_null<Ephemeris<Frame>*> const ephemeris,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    Trajectories const& trajectories) const {
+  NBodySystem<Frame>::IntegrateMasslessBodiesRelativeToParents(
+      integrator,
+      ephemeris,
+      std::vector<std::size_t>(),  // parents
+      tmax,
+      Δt,
+      sampling_period,
+      tmax_is_exact,
+      trajectories);
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::IntegrateMasslessBodiesRelativeToParents(
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    not_null<Ephemeris<Frame>*> const ephemeris,
+    std::vector<std::size_t> const& parents,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    Trajectories const& trajectories) const {
+  ephemeris->Prolong(tmax);
+  IntegrateMasslessBodiesInField(
+      integrator,
+      ephemeris->massive_oblate_trajectories(),
+      ephemeris->massive_spherical_trajectories(),
+      [this, ephemeris](IntegrationData const& data,
+                        Time const& t,
+                        std::size_t const stride,
+                        not_null<std::vector<Length>*> const q) {
+        for (std::size_t b = 0; b < ephemeris->number_of_bodies(); ++b) {
+          R3Element<Length> const position =
+              (ephemeris->EvaluatePosition(b, t + data.reference_time) -
+               data.reference_position).coordinates();
+          for (int k = 0; k < 3; ++k) {
+            (*q)[IndexOf(b, k, stride)] = position[k];
+          }
+        }
+      },
+      [this, ephemeris](IntegrationData const& data,
+                        Time const& t,
+                        std::size_t const stride,
+                        not_null<std::vector<Speed>*> const v) {
+        for (std::size_t b = 0; b < ephemeris->number_of_bodies(); ++b) {
+          R3Element<Speed> const velocity =
+              ephemeris->EvaluateVelocity(b, t + data.reference_time).
+                  coordinates();
+          for (int k = 0; k < 3; ++k) {
+            (*v)[IndexOf(b, k, stride)] = velocity[k];
+          }
+        }
+      },
+      parents,
+      tmax,
+      Δt,
+      sampling_period,
+      tmax_is_exact,
+      trajectories);
+}
+
+template<typename Frame>
+typename NBodySystem<Frame>::Ensemble NBodySystem<Frame>::IntegrateEnsemble(
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    not_null<Ephemeris<Frame>*> const ephemeris,
+    std::size_t const parent,
+    Instant const& time,
+    DegreesOfFreedom<Frame> const& degrees_of_freedom,
+    std::vector<RelativeDegreesOfFreedom<Frame>> const& perturbations,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK(!perturbations.empty()) << "Empty ensemble";
+  Ensemble ensemble;
+  Trajectories trajectories;
+  ensemble.bodies.reserve(perturbations.size());
+  ensemble.trajectories.reserve(perturbations.size());
+  trajectories.reserve(perturbations.size());
+  for (RelativeDegreesOfFreedom<Frame> const& perturbation : perturbations) {
+    // Each copy needs its own body, since the trajectories of an integration
+    // must be for distinct bodies.
+    ensemble.bodies.push_back(make_not_null_unique<MasslessBody>());
+    ensemble.trajectories.push_back(
+        make_not_null_unique<Trajectory<Frame>>(ensemble.bodies.back().get()));
+    ensemble.trajectories.back()->Append(time,
+                                         degrees_of_freedom + perturbation);
+    trajectories.push_back(ensemble.trajectories.back().get());
+  }
+  IntegrateMasslessBodiesRelativeToParents(
+      integrator,
+      ephemeris,
+      std::vector<std::size_t>(perturbations.size(), parent),
+      tmax,
+      Δt,
+      sampling_period,
+      tmax_is_exact,
+      trajectories);
+  return ensemble;
+}
+
+template<typename Frame>
+RelativeDegreesOfFreedom<Frame>
+NBodySystem<Frame>::StateTransitionMatrix::operator()(
+    RelativeDegreesOfFreedom<Frame> const& perturbation) const {
+  R3Element<Length> const δr = perturbation.displacement().coordinates();
+  R3Element<Speed> const δv = perturbation.velocity().coordinates();
+  RelativeDegreesOfFreedom<Frame> result = (δr[0] / SIUnit<Length>()) *
+                                           columns[0];
+  for (int k = 1; k < 3; ++k) {
+    result += (δr[k] / SIUnit<Length>()) * columns[k];
+  }
+  for (int k = 0; k < 3; ++k) {
+    result += (δv[k] / SIUnit<Speed>()) * columns[3 + k];
+  }
+  return result;
+}
+
+template<typename Frame>
+std::vector<typename NBodySystem<Frame>::StateTransitionMatrix>
+NBodySystem<Frame>::IntegrateStateTransitionMatrices(
+    SPRKIntegrator<Length, Speed> const& integrator,
+    not_null<Ephemeris<Frame>*> const ephemeris,
+    std::vector<Instant> const& times,
+    Time const& Δt,
+    not_null<Trajectory<Frame>*> const trajectory) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK(trajectory->template body<Body>()->is_massless())
+      << "Massive body given as a massless body";
+  CHECK(!times.empty()) << "No times";
+  Instant const& initial_time = trajectory->last().time();
+  CHECK_LT(initial_time, times.front());
+  for (std::size_t i = 1; i < times.size(); ++i) {
+    CHECK_LT(times[i - 1], times[i]);
+  }
+  ephemeris->Prolong(times.back());
+
+  // The massive bodies are laid out as in an integration, followed by the
+  // massless body, with |Layout::kInterleaved|.
+  MassiveBodiesTable const massive_bodies =
+      MakeMassiveBodiesTable(ephemeris->massive_oblate_trajectories(),
+                             ephemeris->massive_spherical_trajectories());
+  std::size_t const number_of_massive_bodies = ephemeris->number_of_bodies();
+  std::size_t const stride = number_of_massive_bodies + 1;
+  ReadonlyTrajectories const massless_trajectories = {trajectory};
+
+  // The state of the integrator is made of the degrees of freedom of the body,
+  // relative to its initial position, followed by the six columns of the
+  // state transition matrix.  The columns are solutions of the variational
+  // equations
+  //   δr'' = G δr,
+  // where G is the gravity gradient at the position of the body.  Since the
+  // columns are integrated together with the body by the same symplectic
+  // integrator, they are the derivatives of the numerical solution.
+  int const kColumns = 6;
+  int const dimension = 3 * (1 + kColumns);
+  Position<Frame> const reference_position =
+      trajectory->last().degrees_of_freedom().position();
+  R3Element<Speed> const initial_velocity =
+      trajectory->last().degrees_of_freedom().velocity().coordinates();
+  SPRKIntegrator<Length, Speed>::Parameters parameters;
+  parameters.initial.positions.resize(dimension);
+  parameters.initial.momenta.resize(dimension);
+  for (int k = 0; k < 3; ++k) {
+    parameters.initial.momenta[k] = initial_velocity[k];
+    parameters.initial.positions[3 * (1 + k) + k] = SIUnit<Length>();
+    parameters.initial.momenta[3 * (4 + k) + k] = SIUnit<Speed>();
+  }
+  parameters.initial.time = Time();
+  parameters.Δt = Δt;
+  parameters.sampling_period = 0;
+  parameters.tmax_is_exact = true;
+
+  std::vector<Length> q_all(3 * stride);
+  std::vector<Acceleration> result_all(3 * stride);
+  std::int64_t force_evaluations = 0;
+  auto const compute_acceleration =
+      [this, ephemeris, &massive_bodies, &massless_trajectories,
+       &reference_position, &initial_time, number_of_massive_bodies, stride,
+       kColumns, dimension, &q_all, &result_all, &force_evaluations](
+          Time const& t,
+          std::vector<Length> const& q,
+          not_null<std::vector<Acceleration>*> const result) {
+    ++force_evaluations;
+    Instant const time = initial_time + t;
+    for (std::size_t b = 0; b < number_of_massive_bodies; ++b) {
+      R3Element<Length> const position =
+          (ephemeris->EvaluatePosition(b, time) - reference_position).
+              coordinates();
+      for (int k = 0; k < 3; ++k) {
+        q_all[3 * b + k] = position[k];
+      }
+    }
+    std::size_t const body = number_of_massive_bodies;
+    for (int k = 0; k < 3; ++k) {
+      q_all[3 * body + k] = q[k];
+      result_all[3 * body + k] = Acceleration();
+    }
+    ComputeMasslessBodiesGravitationalAccelerations<Layout::kInterleaved>(
+        massive_bodies,
+        massless_trajectories,
+        nullptr /*hierarchy*/,
+        nullptr /*interaction_lists*/,
+        initial_time,
+        body /*b2_begin*/,
+        body + 1 /*b2_end*/,
+        stride,
+        t,
+        q_all,
+        &result_all);
+    for (int k = 0; k < 3; ++k) {
+      (*result)[k] = result_all[3 * body + k];
+    }
+
+    // The gravity gradient of the point masses,
+    //   G = Σ μ / r³ (3 r̂ r̂ᵀ - 1),
+    // applied to the columns.
+    for (int i = 3; i < dimension; ++i) {
+      (*result)[i] = Acceleration();
+    }
+    for (std::size_t b = 0; b < number_of_massive_bodies; ++b) {
+      R3Element<Length> const Δq(q[0] - q_all[3 * b + 0],
+                                 q[1] - q_all[3 * b + 1],
+                                 q[2] - q_all[3 * b + 2]);
+      Exponentiation<Length, 2> const r_squared = Dot(Δq, Δq);
+      auto const μ_over_r_cubed = massive_bodies.gravitational_parameters[b] /
+                                  (r_squared * Sqrt(r_squared));
+      auto const three_μ_over_r_fifth = 3 * μ_over_r_cubed / r_squared;
+      for (int c = 1; c <= kColumns; ++c) {
+        R3Element<Length> const δq(q[3 * c], q[3 * c + 1], q[3 * c + 2]);
+        R3Element<Acceleration> const δa =
+            Δq * (three_μ_over_r_fifth * Dot(Δq, δq)) - δq * μ_over_r_cubed;
+        for (int k = 0; k < 3; ++k) {
+          (*result)[3 * c + k] += δa[k];
+        }
+      }
+    }
+  };
+
+  std::vector<StateTransitionMatrix> matrices;
+  matrices.reserve(times.size());
+  for (Instant const& time : times) {
+    parameters.tmax = time - initial_time;
+    integrator.SolveWithSink(
+        compute_acceleration,
+        parameters,
+        [&parameters](DoublePrecision<Time> const& final_time,
+                      DoublePrecisionVector<Length> const& positions,
+                      DoublePrecisionVector<Speed> const& momenta) {
+          parameters.initial.time = final_time;
+          positions.Extract(&parameters.initial.positions);
+          momenta.Extract(&parameters.initial.momenta);
+        },
+        &sprk_workspace_);
+    std::vector<DoublePrecision<Length>> const& q =
+        parameters.initial.positions;
+    std::vector<DoublePrecision<Speed>> const& v =
+        parameters.initial.momenta;
+    trajectory->Append(
+        time,
+        DegreesOfFreedom<Frame>(
+            reference_position +
+                Displacement<Frame>({q[0].value, q[1].value, q[2].value}),
+            Velocity<Frame>({v[0].value, v[1].value, v[2].value})));
+    matrices.emplace_back();
+    StateTransitionMatrix& matrix = matrices.back();
+    matrix.time = time;
+    matrix.columns.reserve(kColumns);
+    for (int c = 1; c <= kColumns; ++c) {
+      matrix.columns.emplace_back(
+          Displacement<Frame>({q[3 * c].value,
+                               q[3 * c + 1].value,
+                               q[3 * c + 2].value}),
+          Velocity<Frame>({v[3 * c].value,
+                           v[3 * c + 1].value,
+                           v[3 * c + 2].value}));
+    }
+  }
+  statistics_.force_evaluations += force_evaluations;
+  return matrices;
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::IntegrateMasslessBodiesInSteps(
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    MassiveBodiesSteps const& massive_steps,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    Trajectories const& trajectories) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  IntegrationData const& massive_data = massive_steps.data_;
+  MassiveBodiesHistory const& history = massive_steps.history_;
+  CHECK_LE(2U, history.times.size()) << "No steps recorded";
+  CHECK_LE(tmax, massive_data.reference_time + history.times.back())
+      << "Integration beyond the recorded steps";
+  IntegrateMasslessBodiesInField(
+      integrator,
+      massive_data.massive_oblate_trajectories,
+      massive_data.massive_spherical_trajectories,
+      [this, &massive_data, &history](
+          IntegrationData const& data,
+          Time const& t,
+          std::size_t const stride,
+          not_null<std::vector<Length>*> const q) {
+        InterpolateMassivePositions(
+            massive_data,
+            history,
+            data.reference_position,
+            t + (data.reference_time - massive_data.reference_time),
+            stride,
+            q);
+      },
+      // Not called, since the massless bodies are not integrated relative to
+      // their parents.
+      [](IntegrationData const& data,
+         Time const& t,
+         std::size_t const stride,
+         not_null<std::vector<Speed>*> const v) {},
+      std::vector<std::size_t>(),  // parents
+      tmax,
+      Δt,
+      sampling_period,
+      tmax_is_exact,
+      trajectories);
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::IntegrateMassless(
+    SymplecticIntegrator<Length, Speed> const& integrator,
+    ReadonlyTrajectories const& massive_trajectories,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    Trajectories const& trajectories) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  // The massive bodies are laid out as in an integration, oblate bodies first.
+  ReadonlyTrajectories massive_oblate_trajectories;
+  ReadonlyTrajectories massive_spherical_trajectories;
+  for (auto const& trajectory : massive_trajectories) {
+    not_null<Body const*> const body = trajectory->template body<Body>();
+    CHECK(!body->is_massless()) << "Massless body given as a massive body";
+    if (body->is_oblate()) {
+      massive_oblate_trajectories.push_back(trajectory);
+    } else {
+      massive_spherical_trajectories.push_back(trajectory);
+    }
+  }
+  ReadonlyTrajectories ordered_massive_trajectories =
+      massive_oblate_trajectories;
+  ordered_massive_trajectories.insert(ordered_massive_trajectories.end(),
+                                      massive_spherical_trajectories.begin(),
+                                      massive_spherical_trajectories.end());
+  IntegrateMasslessBodiesInField(
+      integrator,
+      massive_oblate_trajectories,
+      massive_spherical_trajectories,
+      [this, &ordered_massive_trajectories](
+          IntegrationData const& data,
+          Time const& t,
+          std::size_t const stride,
+          not_null<std::vector<Length>*> const q) {
+        Instant const time = data.reference_time + t;
+        for (std::size_t b = 0; b < ordered_massive_trajectories.size(); ++b) {
+          R3Element<Length> const position =
+              (ordered_massive_trajectories[b]->
+                   EvaluateDegreesOfFreedom(time).position() -
+               data.reference_position).coordinates();
+          for (int k = 0; k < 3; ++k) {
+            (*q)[IndexOf(b, k, stride)] = position[k];
+          }
+        }
+      },
+      // Not called, since the massless bodies are not integrated relative to
+      // their parents.
+      [](IntegrationData const& data,
+         Time const& t,
+         std::size_t const stride,
+         not_null<std::vector<Speed>*> const v) {},
+      std::vector<std::size_t>(),  // parents
+      tmax,
+      Δt,
+      sampling_period,
+      tmax_is_exact,
+      trajectories);
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::IntegrateWisdomHolman(
+    WisdomHolmanIntegrator<Length, Speed> const& integrator,
+    std::map<MassiveBody const*, MassiveBody const*> const& parents,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    Trajectories const& trajectories) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  IntegrationData data;
+  SymplecticIntegrator<Length, Speed>::Parameters parameters;
+  PrepareIntegration(trajectories,
+                     tmax,
+                     &data,
+                     &parameters.initial.positions,
+                     &parameters.initial.momenta);
+  PointsBuffer buffer = MakePointsBuffer(data, tmax, Δt, sampling_period);
+  auto const append_to_trajectories =
+      [this, &data, &buffer](Time const& time,
+                             std::vector<Length> const& positions,
+                             std::vector<Speed> const& velocities) {
+    AppendToTrajectories(data, time, positions, velocities, &buffer);
+  };
+  SolveWisdomHolman(integrator,
+                    parents,
+                    data,
+                    tmax,
+                    Δt,
+                    sampling_period,
+                    tmax_is_exact,
+                    &parameters,
+                    append_to_trajectories);
+  FlushPointsBuffer(data, &buffer);
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::IntegrateWisdomHolman(
+    WisdomHolmanIntegrator<Length, Speed> const& integrator,
+    std::map<MassiveBody const*, MassiveBody const*> const& parents,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period,
+    bool const tmax_is_exact,
+    Trajectories const& trajectories,
+    not_null<MassiveBodiesSteps*> const massive_steps) const {
+  ScopedTraceEvent const trace_event(__FUNCTION__);
+  CHECK_LE(0, sampling_period);
+  IntegrationData data;
+  SymplecticIntegrator<Length, Speed>::Parameters parameters;
+  PrepareIntegration(trajectories,
+                     tmax,
+                     &data,
+                     &parameters.initial.positions,
+                     &parameters.initial.momenta);
+  StartRecording(data, massive_steps);
+
+  // The last state, appended at the end of the integration if
+  // |sampling_period| is 0, as in |IntegrateAndRecord|.
+  Time last_time = data.initial_time - data.reference_time;
+  std::vector<Length> last_positions;
+  std::vector<Speed> last_velocities;
+  for (auto const& position : parameters.initial.positions) {
+    last_positions.push_back(position.value);
+  }
+  for (auto const& velocity : parameters.initial.momenta) {
+    last_velocities.push_back(velocity.value);
+  }
+  RecordStep(data, last_time, last_positions, last_velocities, massive_steps);
+
+  int sampling_phase = 0;
+  PointsBuffer buffer = MakePointsBuffer(data, tmax, Δt, sampling_period);
+  auto const record_and_append_to_trajectories =
+      [this, &data, massive_steps, sampling_period, &sampling_phase,
+       &last_time, &last_positions, &last_velocities, &buffer](
+          Time const& time,
+          std::vector<Length> const& positions,
+          std::vector<Speed> const& velocities) {
+    RecordStep(data, time, positions, velocities, massive_steps);
+    if (sampling_period == 0) {
+      last_time = time;
+      last_positions = positions;
+      last_velocities = velocities;
+    } else if (sampling_phase % sampling_period == 0) {
+      AppendToTrajectories(data, time, positions, velocities, &buffer);
+    }
+    ++sampling_phase;
+  };
+  // Every step is passed to the sink, which does the sampling itself.
+  SolveWisdomHolman(integrator,
+                    parents,
+                    data,
+                    tmax,
+                    Δt,
+                    1,
+                    tmax_is_exact,
+                    &parameters,
+                    record_and_append_to_trajectories);
+  FlushPointsBuffer(data, &buffer);
+  if (sampling_period == 0) {
+    AppendToTrajectories(data, last_time, last_positions, last_velocities);
+  }
+}
+
+template<typename Frame>
+typename NBodySystem<Frame>::Layout NBodySystem<Frame>::layout() const {
+  return layout_;
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::set_thread_pool(ThreadPool* const thread_pool) {
+  thread_pool_ = thread_pool;
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::set_massless_chunks_per_thread(
+    int const chunks_per_thread) {
+  CHECK_LT(0, chunks_per_thread);
+  massless_chunks_per_thread_ = chunks_per_thread;
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::set_massless_accelerations_backend(
+    MasslessAccelerationsBackend* const backend) {
+  massless_accelerations_backend_ = backend;
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::SetHierarchicalForceModel(
+    std::map<MassiveBody const*, MassiveBody const*> const& parents,
+    double const tolerance,
+    bool const use_quadrupole) {
+  CHECK_LE(0.0, tolerance);
+  CHECK_GT(1.0, tolerance);
+  CHECK(tolerance == 0 || interaction_list_tolerance_ == 0)
+      << "The hierarchical force model and the interaction lists are exclusive";
+  parents_ = parents;
+  hierarchical_tolerance_ = tolerance;
+  use_quadrupole_ = use_quadrupole;
+  ++parameters_version_;
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::set_oblateness_accuracy(
+    double const oblateness_accuracy) {
+  CHECK_LE(0.0, oblateness_accuracy);
+  CHECK_GT(1.0, oblateness_accuracy);
+  oblateness_accuracy_ = oblateness_accuracy;
+  ++parameters_version_;
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::SetInteractionLists(double const tolerance,
+                                             int const refresh_period) {
+  CHECK_LE(0.0, tolerance);
+  CHECK_GT(1.0, tolerance);
+  CHECK_LE(1, refresh_period);
+  CHECK(tolerance == 0 || hierarchical_tolerance_ == 0)
+      << "The hierarchical force model and the interaction lists are exclusive";
+  interaction_list_tolerance_ = tolerance;
+  interaction_list_refresh_period_ = refresh_period;
+  ++parameters_version_;
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::set_recentring(bool const recentring) {
+  recentring_ = recentring;
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::set_close_encounter_timescale_fraction(
+    double const timescale_fraction) {
+  CHECK_LE(0.0, timescale_fraction);
+  close_encounter_timescale_fraction_ = timescale_fraction;
+}
+
+template<typename Frame>
+typename NBodySystem<Frame>::Statistics const&
+NBodySystem<Frame>::statistics() const {
+  return statistics_;
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::reset_statistics() {
+  statistics_ = Statistics();
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::PrepareIntegration(
+    Trajectories const& trajectories,
+    Instant const& tmax,
+    not_null<IntegrationData*> const data,
+    not_null<std::vector<DoublePrecision<Length>>*> const positions,
+    not_null<std::vector<DoublePrecision<Speed>>*> const velocities) const {
+  // This object is for checking the consistency of the parameters.
+  std::set<Body const*> bodies_in_trajectories;
+
+  // Prepare the initial state of the integrator.  For efficiently computing the
+  // accelerations, we need to separate the trajectories of oblate massive
+  // bodies from of spherical massive bodies and those of massless bodies.  They
+  // are put in this order in |data->trajectories|.
+  data->trajectories.clear();
+  data->massive_oblate_trajectories.clear();
+  data->massive_spherical_trajectories.clear();
+  data->massless_trajectories.clear();
+  // This loop ensures that the massive bodies precede the massless bodies in
+  // the vectors representing the initial data.
+  for (bool is_massless : {false, true}) {
+    for (bool is_oblate : {true, false}) {
+      for (auto const& trajectory : trajectories) {
+        // See if this trajectory should be processed in this iteration and
+        // update the appropriate vector.
+        not_null<Body const*> const body = trajectory->template body<Body>();
+        if (body->is_massless() != is_massless ||
+            body->is_oblate() != is_oblate) {
+          continue;
+        }
+        if (is_massless) {
+          CHECK(!is_oblate);
+          data->massless_trajectories.push_back(trajectory);
+        } else if (is_oblate) {
+          data->massive_oblate_trajectories.push_back(trajectory);
+        } else {
+          data->massive_spherical_trajectories.push_back(trajectory);
+        }
+        data->trajectories.push_back(trajectory);
+
+        // Check that all trajectories are for different bodies.
+        auto const inserted = bodies_in_trajectories.emplace(body);
+        CHECK(inserted.second) << "Multiple trajectories for the same body";
+      }
+    }
+  }
+  data->massive_bodies =
+      MakeMassiveBodiesTable(data->massive_oblate_trajectories,
+                             data->massive_spherical_trajectories);
+  data->hierarchy = MakeHierarchy(data->massive_oblate_trajectories,
+                                  data->massive_spherical_trajectories);
+  data->interaction_lists = MakeInteractionLists();
+  PrepareInitialState(tmax, data, positions, velocities);
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::PrepareInitialState(
+    Instant const& tmax,
+    not_null<IntegrationData*> const data,
+    not_null<std::vector<DoublePrecision<Length>>*> const positions,
+    not_null<std::vector<DoublePrecision<Speed>>*> const velocities) const {
+  CHECK(!data->trajectories.empty()) << "No trajectories to integrate";
+  // The final points of all trajectories must all be for the same time.
+  data->initial_time = data->trajectories.front()->last().time();
+  for (auto const& trajectory : data->trajectories) {
+    CHECK_EQ(data->initial_time, trajectory->last().time())
+        << "Inconsistent last time in trajectories";
+  }
+  if (recentring_) {
+    data->reference_position = ReferencePosition(data->trajectories);
+    data->reference_time = MiddleReferenceTime(data->initial_time, tmax);
+  } else {
+    data->reference_position = Position<Frame>();
+    data->reference_time = Instant();
+  }
+  if (data->interaction_lists != nullptr) {
+    // The lists are recomputed at the first evaluation of the forces.
+    InteractionLists const& interaction_lists = *data->interaction_lists;
+    std::size_t const number_of_massless_trajectories =
+        data->massless_trajectories.size();
+    interaction_lists.evaluations = 0;
+    interaction_lists.dominant_bodies.resize(number_of_massless_trajectories);
+    interaction_lists.lists.resize(number_of_massless_trajectories);
+    interaction_lists.errors.resize(number_of_massless_trajectories);
+  }
+
+  // With |Layout::kStructureOfArrays| the blocks of coordinates are padded
+  // with bodies at the origin, at rest.  Since the accelerations are only
+  // computed for actual bodies, the padding stays at rest.
+  std::size_t const number_of_trajectories = data->trajectories.size();
+  data->stride = Stride(number_of_trajectories);
+
+  // Fill the initial positions and velocities.
+  positions->assign(3 * data->stride, Length());
+  velocities->assign(3 * data->stride, Speed());
+  R3Element<Length> const reference_coordinates =
+      (data->reference_position - Position<Frame>()).coordinates();
+  for (std::size_t b = 0; b < number_of_trajectories; ++b) {
+    // NOTE(phl): Using |const&| below doesn't work, even though 12.2/5
+    // seems to indicate that it should.  A bug in Visual Studio 2013?
+    R3Element<Length> const position =
+        (data->trajectories[b]->last().degrees_of_freedom().position() -
+         Position<Frame>()).coordinates();
+    R3Element<Speed> const& velocity =
+        data->trajectories[b]->last().degrees_of_freedom().velocity().
+            coordinates();
+    for (int k = 0; k < 3; ++k) {
+      (*positions)[IndexOf(b, k, data->stride)] =
+          CompensatedDifference(position[k], reference_coordinates[k]);
+      (*velocities)[IndexOf(b, k, data->stride)] = velocity[k];
+    }
+  }
+}
+
+template<typename Frame>
+typename NBodySystem<Frame>::MassiveBodiesTable
+NBodySystem<Frame>::MakeMassiveBodiesTable(
+    ReadonlyTrajectories const& massive_oblate_trajectories,
+    ReadonlyTrajectories const& massive_spherical_trajectories) const {
+  MassiveBodiesTable table;
+  table.gravitational_parameters.reserve(
+      massive_oblate_trajectories.size() +
+      massive_spherical_trajectories.size());
+  table.j2s.reserve(massive_oblate_trajectories.size());
+  table.axes.reserve(massive_oblate_trajectories.size());
+  table.higher_zonal_coefficients.reserve(massive_oblate_trajectories.size());
+  table.oblateness_cutoffs_squared.reserve(massive_oblate_trajectories.size());
+  for (auto const& trajectory : massive_oblate_trajectories) {
+    OblateBody<Frame> const& body =
+        *trajectory->template body<OblateBody<Frame>>();
+    table.gravitational_parameters.push_back(body.gravitational_parameter());
+    table.j2s.push_back(body.j2());
+    table.axes.push_back(body.axis());
+    table.higher_zonal_coefficients.emplace_back();
+    std::vector<double>& coefficients = table.higher_zonal_coefficients.back();
+    double const μ = body.gravitational_parameter() /
+                     SIUnit<GravitationalParameter>();
+    double const reference_radius = body.reference_radius() / SIUnit<Length>();
+    double reference_radius_to_the_n = reference_radius * reference_radius;
+    for (double const jn : body.higher_zonal_harmonics()) {
+      reference_radius_to_the_n *= reference_radius;
+      coefficients.push_back(jn * μ * reference_radius_to_the_n);
+    }
+
+    // The acceleration due to J2 is at most 3 |j2| / r⁴, that is,
+    // 3 |j2| / (μ r²) times the central acceleration μ / r².  For the higher
+    // degrees, Bernstein's inequality bounds the tangential component of the
+    // gradient of Pn by n, so the acceleration is at most
+    // (2n + 1) |Jn μ Rⁿ| / rⁿ⁺², that is, (2n + 1) |Jn μ Rⁿ| / (μ rⁿ) times the
+    // central acceleration.  The cutoff is the largest distance at which one
+    // of these ratios reaches |oblateness_accuracy_|.
+    if (oblateness_accuracy_ == 0) {
+      table.oblateness_cutoffs_squared.push_back(
+          std::numeric_limits<double>::infinity() *
+          SIUnit<Exponentiation<Length, 2>>());
+    } else {
+      double cutoff_squared =
+          3 * std::abs(body.j2() / SIUnit<Order2ZonalCoefficient>()) /
+          (μ * oblateness_accuracy_);
+      for (std::size_t i = 0; i < coefficients.size(); ++i) {
+        int const n = static_cast<int>(i) + 3;
+        cutoff_squared = std::max(
+            cutoff_squared,
+            std::pow((2 * n + 1) * std::abs(coefficients[i]) /
+                         (μ * oblateness_accuracy_),
+                     2.0 / n));
+      }
+      table.oblateness_cutoffs_squared.push_back(
+          cutoff_squared * SIUnit<Exponentiation<Length, 2>>());
+    }
+  }
+  for (auto const& trajectory : massive_spherical_trajectories) {
+    table.gravitational_parameters.push_back(
+        trajectory->template body<MassiveBody>()->gravitational_parameter());
+  }
+  return table;
+}
+
+template<typename Frame>
+std::unique_ptr<typename NBodySystem<Frame>::Hierarchy const>
+NBodySystem<Frame>::MakeHierarchy(
+    ReadonlyTrajectories const& massive_oblate_trajectories,
+    ReadonlyTrajectories const& massive_spherical_trajectories) const {
+  if (hierarchical_tolerance_ == 0) {
+    return nullptr;
+  }
+  std::size_t const number_of_massive_trajectories =
+      massive_oblate_trajectories.size() +
+      massive_spherical_trajectories.size();
+  std::map<MassiveBody const*, std::size_t> indices;
+  std::vector<MassiveBody const*> bodies;
+  for (auto const& trajectories :
+       {&massive_oblate_trajectories, &massive_spherical_trajectories}) {
+    for (auto const& trajectory : *trajectories) {
+      MassiveBody const* const body =
+          trajectory->template body<MassiveBody>();
+      indices.emplace(body, bodies.size());
+      bodies.push_back(body);
+    }
+  }
+
+  auto hierarchy = std::make_unique<Hierarchy>();
+  hierarchy->tolerance = hierarchical_tolerance_;
+  hierarchy->use_quadrupole = use_quadrupole_;
+  hierarchy->children.resize(number_of_massive_trajectories);
+  hierarchy->members.resize(number_of_massive_trajectories);
+  hierarchy->subsystems.resize(number_of_massive_trajectories);
+  // The parent of each body, or |number_of_massive_trajectories| for a root.
+  std::vector<std::size_t> parents(number_of_massive_trajectories,
+                                   number_of_massive_trajectories);
+  for (std::size_t b = 0; b < number_of_massive_trajectories; ++b) {
+    auto const it = parents_.find(bodies[b]);
+    if (it == parents_.end()) {
+      hierarchy->roots.push_back(b);
+    } else {
+      auto const parent_it = indices.find(it->second);
+      if (parent_it == indices.end()) {
+        hierarchy->roots.push_back(b);
+      } else {
+        parents[b] = parent_it->second;
+        hierarchy->children[parent_it->second].push_back(b);
+      }
+    }
+  }
+  // Each body is a member of its own subsystem and of those of its ancestors.
+  for (std::size_t b = 0; b < number_of_massive_trajectories; ++b) {
+    std::size_t ancestor = b;
+    for (std::size_t depth = 0;
+         ancestor != number_of_massive_trajectories;
+         ++depth) {
+      CHECK_LT(depth, number_of_massive_trajectories)
+          << "Cycle in the parents of the hierarchical force model";
+      hierarchy->members[ancestor].push_back(b);
+      ancestor = parents[ancestor];
+    }
+  }
+  return std::move(hierarchy);
+}
+
+template<typename Frame>
+std::unique_ptr<typename NBodySystem<Frame>::InteractionLists const>
+NBodySystem<Frame>::MakeInteractionLists() const {
+  if (interaction_list_tolerance_ == 0) {
+    return nullptr;
+  }
+  auto interaction_lists = std::make_unique<InteractionLists>();
+  interaction_lists->tolerance = interaction_list_tolerance_;
+  interaction_lists->refresh_period = interaction_list_refresh_period_;
+  interaction_lists->evaluations = 0;
+  return std::move(interaction_lists);
+}
+
+template<typename Frame>
+FORCE_INLINE void NBodySystem<Frame>::ComputeGravitationalAccelerations(
+    IntegrationData const& data,
+    Time const& t,
+    std::vector<Length> const& q,
+    not_null<std::vector<Acceleration>*> const result) const {
+  ++statistics_.force_evaluations;
+  InteractionLists const* const interaction_lists =
+      data.interaction_lists.get();
+  // The backend only knows about point masses.
+  bool const use_backend = massless_accelerations_backend_ != nullptr &&
+                           !data.massless_trajectories.empty() &&
+                           data.massive_bodies.j2s.empty() &&
+                           data.hierarchy == nullptr &&
+                           interaction_lists == nullptr;
+  if (layout_ == Layout::kInterleaved) {
+    if (!use_backend ||
+        !ComputeGravitationalAccelerationsOnBackend<Layout::kInterleaved>(
+            data, t, q, result)) {
+      ComputeGravitationalAccelerations<Layout::kInterleaved>(
+          data.massive_bodies,
+          data.massless_trajectories,
+          data.hierarchy.get(),
+          interaction_lists,
+          data.reference_time,
+          data.stride,
+          thread_pool_,
+          massless_chunks_per_thread_,
+          t,
+          q,
+          result);
+    }
+  } else {
+    if (!use_backend ||
+        !ComputeGravitationalAccelerationsOnBackend<
+            Layout::kStructureOfArrays>(data, t, q, result)) {
+      ComputeGravitationalAccelerations<Layout::kStructureOfArrays>(
+          data.massive_bodies,
+          data.massless_trajectories,
+          data.hierarchy.get(),
+          interaction_lists,
+          data.reference_time,
+          data.stride,
+          thread_pool_,
+          massless_chunks_per_thread_,
+          t,
+          q,
+          result);
+    }
+  }
+  if (interaction_lists != nullptr) {
+    if (interaction_lists->evaluations %
+            interaction_lists->refresh_period == 0) {
+      for (double const error : interaction_lists->errors) {
+        statistics_.interaction_list_error =
+            std::max(statistics_.interaction_list_error, error);
+      }
+    }
+    ++interaction_lists->evaluations;
+  }
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::ComputeModifiedGravitationalAccelerations(
+    IntegrationData const& data,
+    Time const& t,
+    std::vector<Length> const& q,
+    Exponentiation<Time, 2> const& c,
+    not_null<std::vector<Acceleration>*> const result) const {
+  ComputeGravitationalAccelerations(data, t, q, result);
+  if (c == Exponentiation<Time, 2>()) {
+    return;
+  }
+  ++statistics_.gradient_evaluations;
+  if (layout_ == Layout::kInterleaved) {
+    AddGravityGradientProducts<Layout::kInterleaved>(
+        data.massive_bodies,
+        data.massless_trajectories.size(),
+        data.stride,
+        c,
+        q,
+        &gravity_gradient_products_,
+        result);
+  } else {
+    AddGravityGradientProducts<Layout::kStructureOfArrays>(
+        data.massive_bodies,
+        data.massless_trajectories.size(),
+        data.stride,
+        c,
+        q,
+        &gravity_gradient_products_,
+        result);
+  }
+}
+
+template<typename Frame>
+template<typename NBodySystem<Frame>::Layout layout>
+bool NBodySystem<Frame>::ComputeGravitationalAccelerationsOnBackend(
+    IntegrationData const& data,
+    Time const& t,
+    std::vector<Length> const& q,
+    not_null<std::vector<Acceleration>*> const result) const {
+  MassiveBodiesTable const& massive_bodies = data.massive_bodies;
+  std::size_t const stride = data.stride;
+  std::size_t const number_of_massive_trajectories =
+      massive_bodies.gravitational_parameters.size();
+  std::size_t const number_of_massless_trajectories =
+      data.massless_trajectories.size();
+
+  // The mutual accelerations of the massive bodies.  This also clears the
+  // accelerations of the massless bodies.
+  ComputeGravitationalAccelerations<layout>(massive_bodies,
+                                            ReadonlyTrajectories(),
+                                            nullptr /*hierarchy*/,
+                                            nullptr /*interaction_lists*/,
+                                            data.reference_time,
+                                            stride,
+                                            nullptr /*thread_pool*/,
+                                            1 /*chunks_per_thread*/,
+                                            t,
+                                            q,
+                                            result);
+
+  BackendBuffers& buffers = backend_buffers_;
+  buffers.gravitational_parameters.resize(number_of_massive_trajectories);
+  buffers.massive_positions.resize(3 * number_of_massive_trajectories);
+  buffers.massless_positions.resize(3 * number_of_massless_trajectories);
+  for (std::size_t b1 = 0; b1 < number_of_massive_trajectories; ++b1) {
+    buffers.gravitational_parameters[b1] =
+        massive_bodies.gravitational_parameters[b1] /
+        SIUnit<GravitationalParameter>();
+    for (int k = 0; k < 3; ++k) {
+      buffers.massive_positions[3 * b1 + k] =
+          q[Index<layout>(b1, k, stride)] / SIUnit<Length>();
+    }
+  }
+  for (std::size_t i = 0; i < number_of_massless_trajectories; ++i) {
+    std::size_t const b2 = number_of_massive_trajectories + i;
+    for (int k = 0; k < 3; ++k) {
+      buffers.massless_positions[3 * i + k] =
+          q[Index<layout>(b2, k, stride)] / SIUnit<Length>();
+    }
+  }
+  if (!massless_accelerations_backend_->ComputeAccelerations(
+          buffers.gravitational_parameters,
+          buffers.massive_positions,
+          buffers.massless_positions,
+          &buffers.accelerations)) {
+    LOG_FIRST_N(WARNING, 1)
+        << "The massless accelerations backend failed, falling back to the "
+        << "processor";
+    return false;
+  }
+  CHECK_EQ(buffers.massless_positions.size(), buffers.accelerations.size());
+
+  for (std::size_t i = 0; i < number_of_massless_trajectories; ++i) {
+    std::size_t const b2 = number_of_massive_trajectories + i;
+    for (int k = 0; k < 3; ++k) {
+      (*result)[Index<layout>(b2, k, stride)] =
+          buffers.accelerations[3 * i + k] * SIUnit<Acceleration>();
+    }
+  }
+  AddIntrinsicAccelerations<layout>(
+      data.massless_trajectories,
+      number_of_massive_trajectories,
+      data.reference_time,
+      number_of_massive_trajectories /*b2_begin*/,
+      number_of_massive_trajectories +
+          number_of_massless_trajectories /*b2_end*/,
+      stride,
+      t,
+      result);
+  ++statistics_.backend_force_evaluations;
+  return true;
+}
 
-namespace principia {
-namespace physics {
+template<typename Frame>
+void NBodySystem<Frame>::AppendToTrajectories(
+    IntegrationData const& data,
+    Time const& time,
+    std::vector<Length> const& positions,
+    std::vector<Speed> const& velocities) const {
+  DEBUG_CHECK_EQ(positions.size(), velocities.size());
+  statistics_.points_appended += data.trajectories.size();
+  if (data.histories != nullptr) {
+    data.histories->Append(
+        time + data.reference_time,
+        [this, &data, &positions, &velocities](int const i) {
+          std::size_t const b = data.history_columns[i];
+          Vector<Length, Frame> const position(
+              R3Element<Length>(positions[IndexOf(b, 0, data.stride)],
+                                positions[IndexOf(b, 1, data.stride)],
+                                positions[IndexOf(b, 2, data.stride)]));
+          Velocity<Frame> const velocity(
+              R3Element<Speed>(velocities[IndexOf(b, 0, data.stride)],
+                               velocities[IndexOf(b, 1, data.stride)],
+                               velocities[IndexOf(b, 2, data.stride)]));
+          return DegreesOfFreedom<Frame>(position + data.reference_position,
+                                         velocity);
+        });
+    return;
+  }
+  for (std::size_t b = 0; b < data.trajectories.size(); ++b) {
+    Vector<Length, Frame> const position(
+        R3Element<Length>(positions[IndexOf(b, 0, data.stride)],
+                          positions[IndexOf(b, 1, data.stride)],
+                          positions[IndexOf(b, 2, data.stride)]));
+    Velocity<Frame> const velocity(
+        R3Element<Speed>(velocities[IndexOf(b, 0, data.stride)],
+                         velocities[IndexOf(b, 1, data.stride)],
+                         velocities[IndexOf(b, 2, data.stride)]));
+    data.trajectories[b]->Append(
+        time + data.reference_time,
+        DegreesOfFreedom<Frame>(position + data.reference_position,
+                                velocity));
+  }
+}
 
-namespace {
+template<typename Frame>
+typename NBodySystem<Frame>::PointsBuffer NBodySystem<Frame>::MakePointsBuffer(
+    IntegrationData const& data,
+    Instant const& tmax,
+    Time const& Δt,
+    int const sampling_period) const {
+  PointsBuffer buffer;
+  if (sampling_period == 0 || data.histories != nullptr) {
+    return buffer;
+  }
+  // The number of states sampled, including the final one, bounded so that
+  // the buffer doesn't hold more than |kMaximumBufferedPoints| points.
+  double const expected_states =
+      std::floor((tmax - data.initial_time) / Δt) / sampling_period + 1;
+  double const maximum_batch_size = std::max(
+      1.0,
+      std::floor(static_cast<double>(kMaximumBufferedPoints) /
+                 data.trajectories.size()));
+  buffer.batch_size = static_cast<std::size_t>(
+      std::max(1.0, std::min(expected_states, maximum_batch_size)));
+  buffer.points.resize(data.trajectories.size());
+  for (auto& points : buffer.points) {
+    points.reserve(buffer.batch_size);
+  }
+  return buffer;
+}
 
-// If j is a unit vector along the axis of rotation, and r is the separation
-// between the bodies, the acceleration computed here is:
-//
-//   -(J2 / |r|^5) (3 j (r.j) + r (3 - 15 (r.j)^2 / |r|^2) / 2)
-//
-// Where |r| is the norm of r and r.j is the inner product.
 template<typename Frame>
-FORCE_INLINE Vector<Acceleration, Frame>
-    Order2ZonalAcceleration(
-        OblateBody<Frame> const& body,
-        Vector<Length, Frame> const& r,
-        Exponentiation<Length, -2> const& one_over_r_squared,
-        Exponentiation<Length, -3> const& one_over_r_cubed) {
-  Vector<double, Frame> const& axis = body.axis();
-  Length const r_axis_projection = InnerProduct(axis, r);
-  auto const j2_over_r_fifth =
-      body.j2() * one_over_r_cubed * one_over_r_squared;
-  Vector<Acceleration, Frame> const& axis_acceleration =
-      (-3 * j2_over_r_fifth * r_axis_projection) * axis;
-  Vector<Acceleration, Frame> const& radial_acceleration =
-      (j2_over_r_fifth *
-           (-1.5 +
-            7.5 * r_axis_projection *
-                  r_axis_projection * one_over_r_squared)) * r;
-  return axis_acceleration + radial_acceleration;
+void NBodySystem<Frame>::AppendToTrajectories(
+    IntegrationData const& data,
+    Time const& time,
+    std::vector<Length> const& positions,
+    std::vector<Speed> const& velocities,
+    not_null<PointsBuffer*> const buffer) const {
+  if (buffer->batch_size == 0) {
+    AppendToTrajectories(data, time, positions, velocities);
+    return;
+  }
+  DEBUG_CHECK_EQ(positions.size(), velocities.size());
+  statistics_.points_appended += data.trajectories.size();
+  for (std::size_t b = 0; b < data.trajectories.size(); ++b) {
+    Vector<Length, Frame> const position(
+        R3Element<Length>(positions[IndexOf(b, 0, data.stride)],
+                          positions[IndexOf(b, 1, data.stride)],
+                          positions[IndexOf(b, 2, data.stride)]));
+    Velocity<Frame> const velocity(
+        R3Element<Speed>(velocities[IndexOf(b, 0, data.stride)],
+                         velocities[IndexOf(b, 1, data.stride)],
+                         velocities[IndexOf(b, 2, data.stride)]));
+    buffer->points[b].emplace_back(
+        time + data.reference_time,
+        DegreesOfFreedom<Frame>(position + data.reference_position,
+                                velocity));
+  }
+  if (buffer->points.front().size() == buffer->batch_size) {
+    FlushPointsBuffer(data, buffer);
+  }
 }
 
-}  // namespace
+template<typename Frame>
+void NBodySystem<Frame>::FlushPointsBuffer(
+    IntegrationData const& data,
+    not_null<PointsBuffer*> const buffer) const {
+  for (std::size_t b = 0; b < buffer->points.size(); ++b) {
+    data.trajectories[b]->AppendRange(buffer->points[b]);
+    buffer->points[b].clear();
+  }
+}
 
 template<typename Frame>
-void NBodySystem<Frame>::Integrate(
+bool NBodySystem<Frame>::VelocityTurned(
+    IntegrationData const& data,
+    double const cos_angular_tolerance,
+    std::vector<Speed> const& previous_velocities,
+    std::vector<Speed> const& velocities) const {
+  for (std::size_t b = 0; b < data.trajectories.size(); ++b) {
+    R3Element<Speed> const previous_velocity(
+        previous_velocities[IndexOf(b, 0, data.stride)],
+        previous_velocities[IndexOf(b, 1, data.stride)],
+        previous_velocities[IndexOf(b, 2, data.stride)]);
+    R3Element<Speed> const velocity(velocities[IndexOf(b, 0, data.stride)],
+                                    velocities[IndexOf(b, 1, data.stride)],
+                                    velocities[IndexOf(b, 2, data.stride)]);
+    Exponentiation<Speed, 2> const previous_speed_squared =
+        Dot(previous_velocity, previous_velocity);
+    Exponentiation<Speed, 2> const speed_squared = Dot(velocity, velocity);
+    if (previous_speed_squared == Exponentiation<Speed, 2>() ||
+        speed_squared == Exponentiation<Speed, 2>()) {
+      continue;
+    }
+    // cos θ = v₀·v / (|v₀| |v|).
+    if (Dot(previous_velocity, velocity) <
+            cos_angular_tolerance *
+                Sqrt(previous_speed_squared * speed_squared)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template<typename Frame>
+template<typename MassivePositionsComputation,
+         typename MassiveVelocitiesComputation>
+void NBodySystem<Frame>::IntegrateMasslessBodiesInField(
     SymplecticIntegrator<Length, Speed> const& integrator,
+    ReadonlyTrajectories const& massive_oblate_trajectories,
+    ReadonlyTrajectories const& massive_spherical_trajectories,
+    MassivePositionsComputation compute_massive_positions,
+    MassiveVelocitiesComputation compute_massive_velocities,
+    std::vector<std::size_t> const& parents,
     Instant const& tmax,
     Time const& Δt,
     int const sampling_period,
     bool const tmax_is_exact,
     Trajectories const& trajectories) const {
+  IntegrationData data;
   SymplecticIntegrator<Length, Speed>::Parameters parameters;
-  std::vector<SymplecticIntegrator<Length, Speed>::SystemState> solution;
+  PrepareIntegration(trajectories,
+                     tmax,
+                     &data,
+                     &parameters.initial.positions,
+                     &parameters.initial.momenta);
+  CHECK(data.massive_oblate_trajectories.empty() &&
+        data.massive_spherical_trajectories.empty())
+      << "Massive bodies integrated in a field";
+  parameters.initial.time = data.initial_time - data.reference_time;
+  parameters.tmax = tmax - data.reference_time;
+  parameters.Δt = Δt;
+  parameters.sampling_period = sampling_period;
+  parameters.tmax_is_exact = tmax_is_exact;
 
-  // TODO(phl): Use a position based on the first mantissa bits of the
-  // centre-of-mass referential and a time in the middle of the integration
-  // interval.  In the integrator itself, all quantities are "vectors" relative
-  // to these references.
-  Position<Frame> const reference_position;
-  Instant const reference_time;
+  // The accelerations are computed in vectors where the massive bodies precede
+  // the massless bodies.
+  std::size_t const number_of_massive_trajectories =
+      massive_oblate_trajectories.size() +
+      massive_spherical_trajectories.size();
+  std::size_t const number_of_massless_trajectories = data.trajectories.size();
+  std::size_t const stride = Stride(number_of_massive_trajectories +
+                                    number_of_massless_trajectories);
+  std::vector<Length> q_all(3 * stride);
+  std::vector<Speed> v_all(3 * stride);
+  std::vector<Acceleration> result_all(3 * stride);
+  MassiveBodiesTable const massive_bodies =
+      MakeMassiveBodiesTable(massive_oblate_trajectories,
+                             massive_spherical_trajectories);
+  std::unique_ptr<Hierarchy const> const hierarchy =
+      MakeHierarchy(massive_oblate_trajectories,
+                    massive_spherical_trajectories);
 
-  // These objects are for checking the consistency of the parameters.
-  std::set<Instant> times_in_trajectories;
-  std::set<Body const*> bodies_in_trajectories;
+  // With Encke's method the state of the integrator is made of the positions
+  // and velocities of the massless bodies relative to their parents, and the
+  // accelerations of the parents are subtracted from theirs.
+  bool const relative_to_parents = !parents.empty();
+  std::vector<Acceleration> parent_accelerations_all;
+  if (relative_to_parents) {
+    CHECK_EQ(number_of_massless_trajectories, parents.size());
+    for (std::size_t const parent : parents) {
+      CHECK_LT(parent, number_of_massive_trajectories);
+    }
+    parent_accelerations_all.resize(3 * stride);
+    Time const& t0 = parameters.initial.time.value;
+    compute_massive_positions(data, t0, stride, &q_all);
+    compute_massive_velocities(data, t0, stride, &v_all);
+    for (std::size_t b = 0; b < number_of_massless_trajectories; ++b) {
+      for (int k = 0; k < 3; ++k) {
+        std::size_t const index = IndexOf(b, k, data.stride);
+        std::size_t const parent_index = IndexOf(parents[b], k, stride);
+        DoublePrecision<Length>& position = parameters.initial.positions[index];
+        Length const error = position.error;
+        position = CompensatedDifference(position.value, q_all[parent_index]);
+        position.error += error;
+        parameters.initial.momenta[index].value -= v_all[parent_index];
+      }
+    }
+  }
 
-  // Prepare the initial state of the integrator.  For efficiently computing the
-  // accelerations, we need to separate the trajectories of oblate massive
-  // bodies from of spherical massive bodies and those of massless bodies.  They
-  // are put in this order in |reordered_trajectories|.
-  Trajectories reordered_trajectories;
-  ReadonlyTrajectories massive_oblate_trajectories;
-  ReadonlyTrajectories massive_spherical_trajectories;
-  ReadonlyTrajectories massless_trajectories;
-  // This loop ensures that the massive bodies precede the massless bodies in
-  // the vectors representing the initial data.
-  for (bool is_massless : {false, true}) {
-    for (bool is_oblate : {true, false}) {
-      for (auto const& trajectory : trajectories) {
-        // See if this trajectory should be processed in this iteration and
-        // update the appropriate vector.
-        not_null<Body const*> const body = trajectory->template body<Body>();
-        if (body->is_massless() != is_massless ||
-            body->is_oblate() != is_oblate) {
-          continue;
-        }
-        if (is_massless) {
-          CHECK(!is_oblate);
-          massless_trajectories.push_back(trajectory);
-        } else if (is_oblate) {
-          massive_oblate_trajectories.push_back(trajectory);
-        } else {
-          massive_spherical_trajectories.push_back(trajectory);
-        }
-        reordered_trajectories.push_back(trajectory);
-
-        // Fill the initial position/velocity/time.
-        // NOTE(phl): Using |const&| below doesn't work, even though 12.2/5
-        // seems to indicate that it should.  A bug in Visual Studio 2013?
-        R3Element<Length> const position =
-            (trajectory->last().degrees_of_freedom().position() -
-             reference_position).coordinates();
-        R3Element<Speed> const& velocity =
-            trajectory->last().degrees_of_freedom().velocity().coordinates();
-        Instant const& time = trajectory->last().time();
-        for (int i = 0; i < 3; ++i) {
-          parameters.initial.positions.emplace_back(position[i]);
+  // Each copy of the lambda has its own scratch vectors and subsystems, so
+  // that the copies made by |PararealIntegrator| may be called concurrently.
+  bool const has_hierarchy = hierarchy != nullptr;
+  Hierarchy const hierarchy_scratch =
+      has_hierarchy ? *hierarchy : Hierarchy();
+  std::atomic<std::int64_t> force_evaluations(0);
+  auto compute_massless_accelerations =
+      [this, &massive_bodies, &compute_massive_positions, &data,
+       has_hierarchy, hierarchy_scratch, &parents, relative_to_parents,
+       number_of_massive_trajectories, number_of_massless_trajectories, stride,
+       q_all, result_all, parent_accelerations_all, &force_evaluations](
+          Time const& t,
+          std::vector<Length> const& q,
+          not_null<std::vector<Acceleration>*> const result) mutable {
+    ++force_evaluations;
+    Hierarchy const* const hierarchy =
+        has_hierarchy ? &hierarchy_scratch : nullptr;
+    compute_massive_positions(data, t, stride, &q_all);
+    if (relative_to_parents) {
+      // The accelerations of the massive bodies in the field of the others.
+      if (layout_ == Layout::kInterleaved) {
+        ComputeGravitationalAccelerations<Layout::kInterleaved>(
+            massive_bodies,
+            ReadonlyTrajectories(),
+            nullptr /*hierarchy*/,
+            nullptr /*interaction_lists*/,
+            data.reference_time,
+            stride,
+            nullptr /*thread_pool*/,
+            1 /*chunks_per_thread*/,
+            t,
+            q_all,
+            &parent_accelerations_all);
+      } else {
+        ComputeGravitationalAccelerations<Layout::kStructureOfArrays>(
+            massive_bodies,
+            ReadonlyTrajectories(),
+            nullptr /*hierarchy*/,
+            nullptr /*interaction_lists*/,
+            data.reference_time,
+            stride,
+            nullptr /*thread_pool*/,
+            1 /*chunks_per_thread*/,
+            t,
+            q_all,
+            &parent_accelerations_all);
+      }
+    }
+    for (std::size_t b = 0; b < number_of_massless_trajectories; ++b) {
+      for (int k = 0; k < 3; ++k) {
+        std::size_t const all_index =
+            IndexOf(number_of_massive_trajectories + b, k, stride);
+        q_all[all_index] = q[IndexOf(b, k, data.stride)];
+        if (relative_to_parents) {
+          q_all[all_index] += q_all[IndexOf(parents[b], k, stride)];
         }
-        for (int i = 0; i < 3; ++i) {
-          parameters.initial.momenta.emplace_back(velocity[i]);
+        result_all[all_index] = Acceleration();
+      }
+    }
+    if (layout_ == Layout::kInterleaved) {
+      if (hierarchy != nullptr) {
+        ComputeSubsystems<Layout::kInterleaved>(*hierarchy,
+                                                massive_bodies,
+                                                stride,
+                                                q_all);
+      }
+      ComputeMasslessBodiesGravitationalAccelerations<Layout::kInterleaved>(
+          massive_bodies,
+          data.massless_trajectories,
+          hierarchy,
+          nullptr /*interaction_lists*/,
+          data.reference_time,
+          number_of_massive_trajectories /*b2_begin*/,
+          number_of_massive_trajectories +
+              number_of_massless_trajectories /*b2_end*/,
+          stride,
+          t,
+          q_all,
+          &result_all);
+    } else {
+      if (hierarchy != nullptr) {
+        ComputeSubsystems<Layout::kStructureOfArrays>(*hierarchy,
+                                                      massive_bodies,
+                                                      stride,
+                                                      q_all);
+      }
+      ComputeMasslessBodiesGravitationalAccelerations<
+          Layout::kStructureOfArrays>(
+          massive_bodies,
+          data.massless_trajectories,
+          hierarchy,
+          nullptr /*interaction_lists*/,
+          data.reference_time,
+          number_of_massive_trajectories /*b2_begin*/,
+          number_of_massive_trajectories +
+              number_of_massless_trajectories /*b2_end*/,
+          stride,
+          t,
+          q_all,
+          &result_all);
+    }
+    for (std::size_t b = 0; b < number_of_massless_trajectories; ++b) {
+      for (int k = 0; k < 3; ++k) {
+        (*result)[IndexOf(b, k, data.stride)] =
+            result_all[IndexOf(number_of_massive_trajectories + b, k, stride)];
+        if (relative_to_parents) {
+          (*result)[IndexOf(b, k, data.stride)] -=
+              parent_accelerations_all[IndexOf(parents[b], k, stride)];
         }
-
-        // Check that all trajectories are for different bodies.
-        auto const inserted = bodies_in_trajectories.emplace(body);
-        CHECK(inserted.second) << "Multiple trajectories for the same body";
-        // The final points of all trajectories must all be for the same time.
-        times_in_trajectories.emplace(time);
-        CHECK_GE(1U, times_in_trajectories.size())
-            << "Inconsistent last time in trajectories";
       }
     }
-  }
-  {
-    // Beyond this point we must not use the |trajectories| parameter as it is
-    // in the wrong order with respect to the data passed to the integrator.  We
-    // use this block to hide it.
-    Trajectories const& trajectories = reordered_trajectories;
-
-    parameters.initial.time = *times_in_trajectories.cbegin() - reference_time;
-    parameters.tmax = tmax - reference_time;
-    parameters.Δt = Δt;
-    parameters.sampling_period = sampling_period;
-    parameters.tmax_is_exact = tmax_is_exact;
-    dynamic_cast<const SPRKIntegrator<Length, Speed>*>(&integrator)->Solve(
-        std::bind(&NBodySystem::ComputeGravitationalAccelerations,
-                  massive_oblate_trajectories,
-                  massive_spherical_trajectories,
-                  massless_trajectories,
-                  reference_time,
-                  std::placeholders::_1,
-                  std::placeholders::_2,
-                  std::placeholders::_3),
-        &ComputeGravitationalVelocities,
-        parameters, &solution);
-
-    // TODO(phl): Ignoring errors for now.
-    // Loop over the time steps.
-    for (std::size_t i = 0; i < solution.size(); ++i) {
-      SymplecticIntegrator<Length, Speed>::SystemState const& state =
-          solution[i];
-      Instant const time = state.time.value + reference_time;
-      CHECK_EQ(state.positions.size(), state.momenta.size());
-      // Loop over the dimensions.
-      for (std::size_t k = 0, t = 0; k < state.positions.size(); k += 3, ++t) {
-        Vector<Length, Frame> const position(
-            R3Element<Length>(state.positions[k].value,
-                              state.positions[k + 1].value,
-                              state.positions[k + 2].value));
-        Velocity<Frame> const velocity(
-            R3Element<Speed>(state.momenta[k].value,
-                             state.momenta[k + 1].value,
-                             state.momenta[k + 2].value));
-        trajectories[t]->Append(
-            time,
-            DegreesOfFreedom<Frame>(position + reference_position,
-                                            velocity));
+  };
+  // The states relative to the parents are translated back before being
+  // appended.
+  std::vector<Length> absolute_positions;
+  std::vector<Speed> absolute_velocities;
+  PointsBuffer buffer = MakePointsBuffer(data, tmax, Δt, sampling_period);
+  auto const append_to_trajectories =
+      [this, &compute_massive_positions, &compute_massive_velocities, &data,
+       &parents, relative_to_parents, stride, &q_all, &v_all,
+       &absolute_positions, &absolute_velocities, &buffer](
+          DoublePrecision<Time> const& time,
+          DoublePrecisionVector<Length> const& positions,
+          DoublePrecisionVector<Speed> const& momenta) {
+    if (!relative_to_parents) {
+      AppendToTrajectories(
+          data, time.value, positions.values, momenta.values, &buffer);
+      return;
+    }
+    compute_massive_positions(data, time.value, stride, &q_all);
+    compute_massive_velocities(data, time.value, stride, &v_all);
+    absolute_positions = positions.values;
+    absolute_velocities = momenta.values;
+    for (std::size_t b = 0; b < parents.size(); ++b) {
+      for (int k = 0; k < 3; ++k) {
+        std::size_t const index = IndexOf(b, k, data.stride);
+        std::size_t const parent_index = IndexOf(parents[b], k, stride);
+        absolute_positions[index] += q_all[parent_index];
+        absolute_velocities[index] += v_all[parent_index];
       }
     }
+    AppendToTrajectories(
+        data, time.value, absolute_positions, absolute_velocities, &buffer);
+  };
+  auto const sprk_integrator =
+      dynamic_cast<SPRKIntegrator<Length, Speed> const*>(&integrator);
+  auto const gauss_jackson_integrator =
+      dynamic_cast<GaussJacksonIntegrator<Length, Speed> const*>(&integrator);
+  if (sprk_integrator != nullptr) {
+    sprk_integrator->SolveWithSink(compute_massless_accelerations,
+                                   parameters,
+                                   append_to_trajectories,
+                                   &sprk_workspace_);
+  } else if (gauss_jackson_integrator != nullptr) {
+    gauss_jackson_integrator->SolveWithSink(compute_massless_accelerations,
+                                            parameters,
+                                            append_to_trajectories,
+                                            &gauss_jackson_workspace_);
+  } else {
+    auto const parareal_integrator =
+        dynamic_cast<PararealIntegrator<Length, Speed> const*>(&integrator);
+    CHECK_NOTNULL(parareal_integrator);
+    parareal_integrator->SolveWithSink(compute_massless_accelerations,
+                                       parameters,
+                                       append_to_trajectories,
+                                       &parareal_workspace_);
+  }
+  statistics_.force_evaluations += force_evaluations;
+  FlushPointsBuffer(data, &buffer);
+}
+
+template<typename Frame>
+void NBodySystem<Frame>::InterpolateMassivePositions(
+    IntegrationData const& massive_data,
+    MassiveBodiesHistory const& history,
+    Position<Frame> const& reference_position,
+    Time const& t,
+    std::size_t const stride,
+    not_null<std::vector<Length>*> const q) const {
+  CHECK_LE(2U, history.times.size());
+  // Find the interval [times[i], times[i + 1]] containing |t|.  The upper bound
+  // is never the first element, since |t| is not before the first step.
+  std::size_t const upper_bound =
+      std::upper_bound(history.times.begin(), history.times.end(), t) -
+      history.times.begin();
+  std::size_t const i =
+      std::min(std::max<std::size_t>(upper_bound, 1),
+               history.times.size() - 1) - 1;
+  Time const h = history.times[i + 1] - history.times[i];
+  double const s = (t - history.times[i]) / h;
+  double const s² = s * s;
+  double const s³ = s² * s;
+  double const h00 = 2 * s³ - 3 * s² + 1;
+  double const h10 = s³ - 2 * s² + s;
+  double const h01 = -2 * s³ + 3 * s²;
+  double const h11 = s³ - s²;
+  std::vector<Length> const& q0 = history.positions[i];
+  std::vector<Length> const& q1 = history.positions[i + 1];
+  std::vector<Speed> const& v0 = history.velocities[i];
+  std::vector<Speed> const& v1 = history.velocities[i + 1];
+  // Zero, and thus exact, unless the integrations are recentred.
+  R3Element<Length> const offset =
+      (massive_data.reference_position - reference_position).coordinates();
+  for (std::size_t b = 0; b < massive_data.trajectories.size(); ++b) {
+    for (int k = 0; k < 3; ++k) {
+      std::size_t const from = IndexOf(b, k, massive_data.stride);
+      (*q)[IndexOf(b, k, stride)] = h00 * q0[from] + h01 * q1[from] +
+                                    h * (h10 * v0[from] + h11 * v1[from]) +
+                                    offset[k];
+    }
   }
 }
 
 template<typename Frame>
-template<bool body1_is_oblate,
+std::size_t NBodySystem<Frame>::Stride(
+    std::size_t const number_of_bodies) const {
+  // With |Layout::kStructureOfArrays| the blocks of coordinates are padded
+  // to a multiple of a cache line; their alignment is that of the vector, see
+  // |Layout|.
+  return layout_ == Layout::kInterleaved
+             ? number_of_bodies
+             : ((number_of_bodies + kCacheLineLength - 1) /
+                    kCacheLineLength) * kCacheLineLength;
+}
+
+template<typename Frame>
+std::size_t NBodySystem<Frame>::IndexOf(std::size_t const b,
+                                        int const k,
+                                        std::size_t const stride) const {
+  return layout_ == Layout::kInterleaved
+             ? Index<Layout::kInterleaved>(b, k, stride)
+             : Index<Layout::kStructureOfArrays>(b, k, stride);
+}
+
+template<typename Frame>
+template<typename NBodySystem<Frame>::Layout layout>
+FORCE_INLINE std::size_t NBodySystem<Frame>::Index(std::size_t const b,
+                                                   int const k,
+                                                   std::size_t const stride) {
+  return layout == Layout::kInterleaved ? 3 * b + k : k * stride + b;
+}
+
+template<typename Frame>
+template<typename NBodySystem<Frame>::Layout layout,
+         bool body1_is_oblate,
          bool body2_is_oblate,
          bool body2_is_massive>
 inline void NBodySystem<Frame>::ComputeOneBodyGravitationalAcceleration(
-    MassiveBody const& body1,
+    MassiveBodiesTable const& massive_bodies,
     size_t const b1,
-    ReadonlyTrajectories const& body2_trajectories,
     size_t const b2_begin,
     size_t const b2_end,
+    std::size_t const stride,
     std::vector<Length> const& q,
     not_null<std::vector<Acceleration>*> const result) {
-  // NOTE(phl): Declaring variables for values like 3 * b1 + 1, 3 * b2 + 1, etc.
-  // in the code below brings no performance advantage as it seems that the
-  // compiler is smart enough to figure common subexpressions.
-  GravitationalParameter const& body1_gravitational_parameter =
-      body1.gravitational_parameter();
-  std::size_t const three_b1 = 3 * b1;
-  for (std::size_t b2 = std::max(b1 + 1, b2_begin); b2 < b2_end; ++b2) {
-    std::size_t const three_b2 = 3 * b2;
-    Length const Δq0 = q[three_b1] - q[three_b2];
-    Length const Δq1 = q[three_b1 + 1] - q[three_b2 + 1];
-    Length const Δq2 = q[three_b1 + 2] - q[three_b2 + 2];
+  GravitationalParameter const body1_gravitational_parameter =
+      massive_bodies.gravitational_parameters[b1];
+  std::size_t const b1_0 = Index<layout>(b1, 0, stride);
+  std::size_t const b1_1 = Index<layout>(b1, 1, stride);
+  std::size_t const b1_2 = Index<layout>(b1, 2, stride);
+  std::size_t b2 = std::max(b1 + 1, b2_begin);
+  if (layout == Layout::kStructureOfArrays &&
+      !body1_is_oblate && !body2_is_massive) {
+    // The coordinates of the massless bodies are contiguous, so we can compute
+    // their accelerations several at a time.
+    b2 = AccumulateMasslessAccelerations(body1_gravitational_parameter,
+                                         b1, b2, b2_end, stride, q, result);
+  }
+  for (; b2 < b2_end; ++b2) {
+    std::size_t const b2_0 = Index<layout>(b2, 0, stride);
+    std::size_t const b2_1 = Index<layout>(b2, 1, stride);
+    std::size_t const b2_2 = Index<layout>(b2, 2, stride);
+    Length const Δq0 = q[b1_0] - q[b2_0];
+    Length const Δq1 = q[b1_1] - q[b2_1];
+    Length const Δq2 = q[b1_2] - q[b2_2];
 
     Exponentiation<Length, 2> const r_squared =
         Δq0 * Δq0 + Δq1 * Δq1 + Δq2 * Δq2;
     // NOTE(phl): Don't try to compute one_over_r_squared here, it makes the
     // non-oblate path slower.
     Exponentiation<Length, -3> const one_over_r_cubed =
-        Sqrt(r_squared) / (r_squared * r_squared);
+        OneOverRCubed<kGravitationalInverseSqrtPrecision>(r_squared);
 
     auto const μ1_over_r_cubed =
         body1_gravitational_parameter * one_over_r_cubed;
-    (*result)[three_b2] += Δq0 * μ1_over_r_cubed;
-    (*result)[three_b2 + 1] += Δq1 * μ1_over_r_cubed;
-    (*result)[three_b2 + 2] += Δq2 * μ1_over_r_cubed;
+    (*result)[b2_0] += Δq0 * μ1_over_r_cubed;
+    (*result)[b2_1] += Δq1 * μ1_over_r_cubed;
+    (*result)[b2_2] += Δq2 * μ1_over_r_cubed;
 
-    MassiveBody const* body2 = nullptr;
     if (body2_is_massive) {
       // Lex. III. Actioni contrariam semper & æqualem esse reactionem:
       // sive corporum duorum actiones in se mutuo semper esse æquales &
       // in partes contrarias dirigi.
-      body2 = body2_trajectories[b2 - b2_begin]->template body<MassiveBody>();
       GravitationalParameter const& body2_gravitational_parameter =
-          body2->gravitational_parameter();
+          massive_bodies.gravitational_parameters[b2];
       auto const μ2_over_r_cubed =
           body2_gravitational_parameter * one_over_r_cubed;
-      (*result)[three_b1] -= Δq0 * μ2_over_r_cubed;
-      (*result)[three_b1 + 1] -= Δq1 * μ2_over_r_cubed;
-      (*result)[three_b1 + 2] -= Δq2 * μ2_over_r_cubed;
+      (*result)[b1_0] -= Δq0 * μ2_over_r_cubed;
+      (*result)[b1_1] -= Δq1 * μ2_over_r_cubed;
+      (*result)[b1_2] -= Δq2 * μ2_over_r_cubed;
     }
 
-    if (body1_is_oblate || body2_is_oblate) {
+    if ((body1_is_oblate &&
+         r_squared <= massive_bodies.oblateness_cutoffs_squared[b1]) ||
+        (body2_is_oblate &&
+         r_squared <= massive_bodies.oblateness_cutoffs_squared[b2])) {
       Exponentiation<Length, -2> const one_over_r_squared = 1 / r_squared;
       Vector<Length, Frame> const Δq({Δq0, Δq1, Δq2});
-      if (body1_is_oblate) {
+      if (body1_is_oblate &&
+          r_squared <= massive_bodies.oblateness_cutoffs_squared[b1]) {
         R3Element<Acceleration> const order_2_zonal_acceleration1 =
             Order2ZonalAcceleration<Frame>(
-                static_cast<OblateBody<Frame> const &>(body1),
+                massive_bodies.j2s[b1],
+                massive_bodies.axes[b1],
                 Δq,
                 one_over_r_squared,
                 one_over_r_cubed).coordinates();
-        (*result)[three_b2] += order_2_zonal_acceleration1.x;
-        (*result)[three_b2 + 1] += order_2_zonal_acceleration1.y;
-        (*result)[three_b2 + 2] += order_2_zonal_acceleration1.z;
+        (*result)[b2_0] += order_2_zonal_acceleration1.x;
+        (*result)[b2_1] += order_2_zonal_acceleration1.y;
+        (*result)[b2_2] += order_2_zonal_acceleration1.z;
+        std::vector<double> const& higher_zonal_coefficients1 =
+            massive_bodies.higher_zonal_coefficients[b1];
+        if (!higher_zonal_coefficients1.empty()) {
+          R3Element<Acceleration> const higher_order_zonal_acceleration1 =
+              HigherOrderZonalAcceleration<Frame>(
+                  higher_zonal_coefficients1,
+                  massive_bodies.axes[b1],
+                  Δq).coordinates();
+          (*result)[b2_0] += higher_order_zonal_acceleration1.x;
+          (*result)[b2_1] += higher_order_zonal_acceleration1.y;
+          (*result)[b2_2] += higher_order_zonal_acceleration1.z;
+        }
       }
-      if (body2_is_oblate) {
-        // |body2| was set in the |body2_is_massive| branch above.
+      if (body2_is_oblate &&
+          r_squared <= massive_bodies.oblateness_cutoffs_squared[b2]) {
         R3Element<Acceleration> const order_2_zonal_acceleration2 =
             Order2ZonalAcceleration<Frame>(
-                *CHECK_NOTNULL(static_cast<OblateBody<Frame> const*>(body2)),
+                massive_bodies.j2s[b2],
+                massive_bodies.axes[b2],
                 Δq,
                 one_over_r_squared,
                 one_over_r_cubed).coordinates();
-        (*result)[three_b1] -= order_2_zonal_acceleration2.x;
-        (*result)[three_b1 + 1] -= order_2_zonal_acceleration2.y;
-        (*result)[three_b1 + 2] -= order_2_zonal_acceleration2.z;
+        (*result)[b1_0] -= order_2_zonal_acceleration2.x;
+        (*result)[b1_1] -= order_2_zonal_acceleration2.y;
+        (*result)[b1_2] -= order_2_zonal_acceleration2.z;
+        // The odd harmonics are not symmetric, so the separation must be
+        // reversed here.
+        std::vector<double> const& higher_zonal_coefficients2 =
+            massive_bodies.higher_zonal_coefficients[b2];
+        if (!higher_zonal_coefficients2.empty()) {
+          R3Element<Acceleration> const higher_order_zonal_acceleration2 =
+              HigherOrderZonalAcceleration<Frame>(
+                  higher_zonal_coefficients2,
+                  massive_bodies.axes[b2],
+                  -Δq).coordinates();
+          (*result)[b1_0] += higher_order_zonal_acceleration2.x;
+          (*result)[b1_1] += higher_order_zonal_acceleration2.y;
+          (*result)[b1_2] += higher_order_zonal_acceleration2.z;
+        }
+      }
+    }
+  }
+}
+
+template<typename Frame>
+template<typename NBodySystem<Frame>::Layout layout>
+void NBodySystem<Frame>::ComputeSubsystems(
+    Hierarchy const& hierarchy,
+    MassiveBodiesTable const& massive_bodies,
+    std::size_t const stride,
+    std::vector<Length> const& q) {
+  auto const position = [stride, &q](std::size_t const b) {
+    return R3Element<Length>(q[Index<layout>(b, 0, stride)],
+                             q[Index<layout>(b, 1, stride)],
+                             q[Index<layout>(b, 2, stride)]);
+  };
+
+  for (std::size_t b = 0; b < hierarchy.members.size(); ++b) {
+    if (hierarchy.children[b].empty()) {
+      continue;
+    }
+    std::vector<std::size_t> const& members = hierarchy.members[b];
+    Subsystem& subsystem = hierarchy.subsystems[b];
+    BarycentreCalculator<R3Element<Length>, GravitationalParameter>
+        barycentre;
+    subsystem.gravitational_parameter = GravitationalParameter();
+    for (std::size_t const member : members) {
+      GravitationalParameter const& μ =
+          massive_bodies.gravitational_parameters[member];
+      barycentre.Add(position(member), μ);
+      subsystem.gravitational_parameter += μ;
+    }
+    subsystem.barycentre = barycentre.Get();
+    subsystem.radius = Length();
+    subsystem.quadrupole.fill(QuadrupoleMoment());
+    for (std::size_t const member : members) {
+      R3Element<Length> const s = position(member) - subsystem.barycentre;
+      Exponentiation<Length, 2> const s_squared = Dot(s, s);
+      subsystem.radius = std::max(subsystem.radius, Sqrt(s_squared));
+      if (hierarchy.use_quadrupole) {
+        GravitationalParameter const& μ =
+            massive_bodies.gravitational_parameters[member];
+        subsystem.quadrupole[0] += μ * (3 * s.x * s.x - s_squared);
+        subsystem.quadrupole[1] += μ * (3 * s.y * s.y - s_squared);
+        subsystem.quadrupole[2] += μ * (3 * s.z * s.z - s_squared);
+        subsystem.quadrupole[3] += μ * (3 * s.x * s.y);
+        subsystem.quadrupole[4] += μ * (3 * s.x * s.z);
+        subsystem.quadrupole[5] += μ * (3 * s.y * s.z);
+      }
+    }
+  }
+}
+
+template<typename Frame>
+template<typename NBodySystem<Frame>::Layout layout>
+void NBodySystem<Frame>::ComputeTiledMutualAccelerations(
+    MassiveBodiesTable const& massive_bodies,
+    std::size_t const b_begin,
+    std::size_t const b_end,
+    std::size_t const stride,
+    std::vector<Length> const& q,
+    not_null<std::vector<Acceleration>*> const result) {
+  static_assert(sizeof(Length) == sizeof(double) &&
+                sizeof(Acceleration) == sizeof(double) &&
+                sizeof(GravitationalParameter) == sizeof(double),
+                "Quantities must be represented as a single double");
+  // A block of bodies with their coordinates and accelerations in separate
+  // arrays, so that the interactions with the bodies of a block may be
+  // vectorized.
+  struct Block {
+    std::size_t begin;
+    std::size_t end;
+    std::array<Length, kMassiveBlockSize> x;
+    std::array<Length, kMassiveBlockSize> y;
+    std::array<Length, kMassiveBlockSize> z;
+    std::array<GravitationalParameter, kMassiveBlockSize> μ;
+    std::array<Acceleration, kMassiveBlockSize> ax;
+    std::array<Acceleration, kMassiveBlockSize> ay;
+    std::array<Acceleration, kMassiveBlockSize> az;
+    // The contributions of the bodies of this block to the acceleration of a
+    // body of the other block, filled by the vectorized kernels.
+    std::array<Acceleration, kMassiveBlockSize> cx;
+    std::array<Acceleration, kMassiveBlockSize> cy;
+    std::array<Acceleration, kMassiveBlockSize> cz;
+  };
+  auto const load = [&massive_bodies, stride, &q](std::size_t const begin,
+                                                  std::size_t const end,
+                                                  Block& block) {
+    block.begin = begin;
+    block.end = end;
+    for (std::size_t b = begin; b < end; ++b) {
+      std::size_t const i = b - begin;
+      block.x[i] = q[Index<layout>(b, 0, stride)];
+      block.y[i] = q[Index<layout>(b, 1, stride)];
+      block.z[i] = q[Index<layout>(b, 2, stride)];
+      block.μ[i] = massive_bodies.gravitational_parameters[b];
+      block.ax[i] = Acceleration();
+      block.ay[i] = Acceleration();
+      block.az[i] = Acceleration();
+    }
+  };
+  auto const store = [stride, result](Block const& block) {
+    for (std::size_t b = block.begin; b < block.end; ++b) {
+      std::size_t const i = b - block.begin;
+      (*result)[Index<layout>(b, 0, stride)] += block.ax[i];
+      (*result)[Index<layout>(b, 1, stride)] += block.ay[i];
+      (*result)[Index<layout>(b, 2, stride)] += block.az[i];
+    }
+  };
+  // The interactions of the body at index |i| of |block1| with the bodies at
+  // indices [j_begin, block2.end - block2.begin[ of |block2|, as in
+  // |ComputeOneBodyGravitationalAcceleration|.  The accelerations of the body
+  // |i| are accumulated in registers, in the order of the indices |j|.
+  auto const interact = [](std::size_t const i,
+                           Block& block1,
+                           std::size_t const j_begin,
+                           Block& block2) {
+    Length const x1 = block1.x[i];
+    Length const y1 = block1.y[i];
+    Length const z1 = block1.z[i];
+    GravitationalParameter const μ1 = block1.μ[i];
+    Acceleration ax1;
+    Acceleration ay1;
+    Acceleration az1;
+    std::size_t const j_end = block2.end - block2.begin;
+    std::size_t j = j_begin;
+#if PRINCIPIA_HAS_AVX_KERNELS || PRINCIPIA_HAS_AVX512F_KERNELS
+    double const x1_si = x1 / SIUnit<Length>();
+    double const y1_si = y1 / SIUnit<Length>();
+    double const z1_si = z1 / SIUnit<Length>();
+    double const μ1_si = μ1 / SIUnit<GravitationalParameter>();
+    double const* const x2 = reinterpret_cast<double const*>(block2.x.data());
+    double const* const y2 = reinterpret_cast<double const*>(block2.y.data());
+    double const* const z2 = reinterpret_cast<double const*>(block2.z.data());
+    double const* const μ2 = reinterpret_cast<double const*>(block2.μ.data());
+    double* const ax2 = reinterpret_cast<double*>(block2.ax.data());
+    double* const ay2 = reinterpret_cast<double*>(block2.ay.data());
+    double* const az2 = reinterpret_cast<double*>(block2.az.data());
+    double* const cx = reinterpret_cast<double*>(block2.cx.data());
+    double* const cy = reinterpret_cast<double*>(block2.cy.data());
+    double* const cz = reinterpret_cast<double*>(block2.cz.data());
+#endif
+#if PRINCIPIA_HAS_AVX512F_KERNELS
+    if (UseAVX512F()) {
+      j = AccumulateMutualAccelerationsAVX512F(x1_si, y1_si, z1_si, μ1_si,
+                                               j, j_end,
+                                               x2, y2, z2, μ2,
+                                               ax2, ay2, az2,
+                                               cx, cy, cz);
+    }
+#endif
+#if PRINCIPIA_HAS_AVX_KERNELS
+    if (UseAVX()) {
+      j = AccumulateMutualAccelerationsAVX(x1_si, y1_si, z1_si, μ1_si,
+                                           j, j_end,
+                                           x2, y2, z2, μ2,
+                                           ax2, ay2, az2,
+                                           cx, cy, cz);
+    }
+#endif
+    for (std::size_t k = j_begin; k < j; ++k) {
+      ax1 -= block2.cx[k];
+      ay1 -= block2.cy[k];
+      az1 -= block2.cz[k];
+    }
+    for (; j < j_end; ++j) {
+      Length const Δq0 = x1 - block2.x[j];
+      Length const Δq1 = y1 - block2.y[j];
+      Length const Δq2 = z1 - block2.z[j];
+      Exponentiation<Length, -3> const one_over_r_cubed =
+          OneOverRCubed<kGravitationalInverseSqrtPrecision>(
+              Δq0 * Δq0 + Δq1 * Δq1 + Δq2 * Δq2);
+      auto const μ1_over_r_cubed = μ1 * one_over_r_cubed;
+      block2.ax[j] += Δq0 * μ1_over_r_cubed;
+      block2.ay[j] += Δq1 * μ1_over_r_cubed;
+      block2.az[j] += Δq2 * μ1_over_r_cubed;
+      auto const μ2_over_r_cubed = block2.μ[j] * one_over_r_cubed;
+      ax1 -= Δq0 * μ2_over_r_cubed;
+      ay1 -= Δq1 * μ2_over_r_cubed;
+      az1 -= Δq2 * μ2_over_r_cubed;
+    }
+    block1.ax[i] += ax1;
+    block1.ay[i] += ay1;
+    block1.az[i] += az1;
+  };
+
+  Block block_i;
+  Block block_j;
+  for (std::size_t i_begin = b_begin;
+       i_begin < b_end;
+       i_begin += kMassiveBlockSize) {
+    load(i_begin, std::min(i_begin + kMassiveBlockSize, b_end), block_i);
+    std::size_t const i_size = block_i.end - block_i.begin;
+    // The pairs within the block |i|.  The accumulators of the body |i| are
+    // only added to |block_i| after the loop, so the aliasing is harmless.
+    for (std::size_t i = 0; i < i_size; ++i) {
+      interact(i, block_i, i + 1 /*j_begin*/, block_i);
+    }
+    // The pairs between the block |i| and the following ones.
+    for (std::size_t j_begin = block_i.end;
+         j_begin < b_end;
+         j_begin += kMassiveBlockSize) {
+      load(j_begin, std::min(j_begin + kMassiveBlockSize, b_end), block_j);
+      for (std::size_t i = 0; i < i_size; ++i) {
+        interact(i, block_i, 0 /*j_begin*/, block_j);
+      }
+      store(block_j);
+    }
+    store(block_i);
+  }
+}
+
+template<typename Frame>
+template<typename NBodySystem<Frame>::Layout layout>
+void NBodySystem<Frame>::ComputeDirectGravitationalAcceleration(
+    MassiveBodiesTable const& massive_bodies,
+    std::size_t const b1,
+    std::size_t const b2,
+    std::size_t const stride,
+    std::vector<Length> const& q,
+    not_null<std::vector<Acceleration>*> const result) {
+  if (b1 < massive_bodies.j2s.size()) {
+    ComputeOneBodyGravitationalAcceleration<layout,
+                                            true /*body1_is_oblate*/,
+                                            false /*body2_is_oblate*/,
+                                            false /*body2_is_massive*/>(
+        massive_bodies,
+        b1,
+        b2 /*b2_begin*/,
+        b2 + 1 /*b2_end*/,
+        stride,
+        q,
+        result);
+  } else {
+    ComputeOneBodyGravitationalAcceleration<layout,
+                                            false /*body1_is_oblate*/,
+                                            false /*body2_is_oblate*/,
+                                            false /*body2_is_massive*/>(
+        massive_bodies,
+        b1,
+        b2 /*b2_begin*/,
+        b2 + 1 /*b2_end*/,
+        stride,
+        q,
+        result);
+  }
+}
+
+template<typename Frame>
+template<typename NBodySystem<Frame>::Layout layout>
+void NBodySystem<Frame>::ComputeInteractionList(
+    InteractionLists const& interaction_lists,
+    MassiveBodiesTable const& massive_bodies,
+    std::size_t const b2,
+    std::size_t const stride,
+    std::vector<Length> const& q) {
+  std::vector<GravitationalParameter> const& gravitational_parameters =
+      massive_bodies.gravitational_parameters;
+  std::size_t const number_of_massive_trajectories =
+      gravitational_parameters.size();
+  std::size_t const massless_index = b2 - number_of_massive_trajectories;
+  auto const position = [stride, &q](std::size_t const b) {
+    return R3Element<Length>(q[Index<layout>(b, 0, stride)],
+                             q[Index<layout>(b, 1, stride)],
+                             q[Index<layout>(b, 2, stride)]);
+  };
+  // The acceleration exerted by the massive body |b1| at |q2|.
+  auto const acceleration = [&gravitational_parameters](
+      std::size_t const b1,
+      R3Element<Length> const& q1,
+      R3Element<Length> const& q2) {
+    R3Element<Length> const Δq = q1 - q2;
+    return Δq * (gravitational_parameters[b1] *
+                 OneOverRCubed<kGravitationalInverseSqrtPrecision>(
+                     Dot(Δq, Δq)));
+  };
+
+  R3Element<Length> const q2 = position(b2);
+  std::size_t dominant_body = 0;
+  Acceleration dominant_acceleration;
+  for (std::size_t b1 = 0; b1 < number_of_massive_trajectories; ++b1) {
+    Acceleration const norm = acceleration(b1, position(b1), q2).Norm();
+    if (norm > dominant_acceleration) {
+      dominant_body = b1;
+      dominant_acceleration = norm;
+    }
+  }
+
+  R3Element<Length> const q_dominant = position(dominant_body);
+  std::vector<std::size_t>& list = interaction_lists.lists[massless_index];
+  double error = 0;
+  list.clear();
+  for (std::size_t b1 = 0; b1 < number_of_massive_trajectories; ++b1) {
+    if (b1 == dominant_body) {
+      continue;
+    }
+    R3Element<Length> const q1 = position(b1);
+    double const tidal_ratio =
+        (acceleration(b1, q1, q2) - acceleration(b1, q1, q_dominant)).Norm() /
+        dominant_acceleration;
+    if (tidal_ratio > interaction_lists.tolerance) {
+      list.push_back(b1);
+    } else {
+      error += tidal_ratio;
+    }
+  }
+  interaction_lists.dominant_bodies[massless_index] = dominant_body;
+  interaction_lists.errors[massless_index] = error;
+}
+
+template<typename Frame>
+template<typename NBodySystem<Frame>::Layout layout>
+void NBodySystem<Frame>::ComputeInteractionListGravitationalAcceleration(
+    InteractionLists const& interaction_lists,
+    MassiveBodiesTable const& massive_bodies,
+    std::size_t const b2,
+    std::size_t const stride,
+    std::vector<Length> const& q,
+    not_null<std::vector<Acceleration>*> const result) {
+  std::size_t const massless_index =
+      b2 - massive_bodies.gravitational_parameters.size();
+  std::size_t const dominant_body =
+      interaction_lists.dominant_bodies[massless_index];
+  std::vector<std::size_t> const& list =
+      interaction_lists.lists[massless_index];
+
+  ComputeDirectGravitationalAcceleration<layout>(
+      massive_bodies, dominant_body /*b1*/, b2, stride, q, result);
+  for (std::size_t const b1 : list) {
+    ComputeDirectGravitationalAcceleration<layout>(
+        massive_bodies, b1, b2, stride, q, result);
+  }
+
+  // The bodies that are not in the list exert on the massless body the same
+  // acceleration as on the dominant body.  That is the total acceleration of
+  // the dominant body less the contributions of the bodies of the list, which
+  // are taken as point masses: the terms due to the oblateness of the dominant
+  // body and of the bodies of the list are left in, but they are many orders
+  // of magnitude below the tolerance.
+  std::size_t const d_0 = Index<layout>(dominant_body, 0, stride);
+  std::size_t const d_1 = Index<layout>(dominant_body, 1, stride);
+  std::size_t const d_2 = Index<layout>(dominant_body, 2, stride);
+  R3Element<Length> const q_dominant(q[d_0], q[d_1], q[d_2]);
+  R3Element<Acceleration> others((*result)[d_0],
+                                 (*result)[d_1],
+                                 (*result)[d_2]);
+  for (std::size_t const b1 : list) {
+    R3Element<Length> const Δq(q[Index<layout>(b1, 0, stride)] - q_dominant.x,
+                               q[Index<layout>(b1, 1, stride)] - q_dominant.y,
+                               q[Index<layout>(b1, 2, stride)] - q_dominant.z);
+    others -= Δq * (massive_bodies.gravitational_parameters[b1] *
+                    OneOverRCubed<kGravitationalInverseSqrtPrecision>(
+                        Dot(Δq, Δq)));
+  }
+  (*result)[Index<layout>(b2, 0, stride)] += others.x;
+  (*result)[Index<layout>(b2, 1, stride)] += others.y;
+  (*result)[Index<layout>(b2, 2, stride)] += others.z;
+}
+
+template<typename Frame>
+template<typename NBodySystem<Frame>::Layout layout>
+void NBodySystem<Frame>::ComputeHierarchicalGravitationalAcceleration(
+    Hierarchy const& hierarchy,
+    MassiveBodiesTable const& massive_bodies,
+    std::size_t const b1,
+    std::size_t const b2,
+    std::size_t const stride,
+    std::vector<Length> const& q,
+    not_null<std::vector<Acceleration>*> const result) {
+  ComputeDirectGravitationalAcceleration<layout>(
+      massive_bodies, b1, b2, stride, q, result);
+
+  std::size_t const b2_0 = Index<layout>(b2, 0, stride);
+  std::size_t const b2_1 = Index<layout>(b2, 1, stride);
+  std::size_t const b2_2 = Index<layout>(b2, 2, stride);
+  R3Element<Length> const q2(q[b2_0], q[b2_1], q[b2_2]);
+  for (std::size_t const child : hierarchy.children[b1]) {
+    // A body without children is its own subsystem and always acts directly,
+    // so that its oblateness is taken into account.
+    if (!hierarchy.children[child].empty()) {
+      Subsystem const& subsystem = hierarchy.subsystems[child];
+      R3Element<Length> const Δq = subsystem.barycentre - q2;
+      Exponentiation<Length, 2> const r_squared = Dot(Δq, Δq);
+      double const ratio_squared =
+          subsystem.radius * subsystem.radius / r_squared;
+      // The estimated relative error is the ratio squared for the monopole,
+      // and the ratio cubed with the quadrupole.
+      bool const is_distant =
+          hierarchy.use_quadrupole
+              ? ratio_squared * ratio_squared * ratio_squared <=
+                    hierarchy.tolerance * hierarchy.tolerance
+              : ratio_squared <= hierarchy.tolerance;
+      if (is_distant) {
+        Exponentiation<Length, -3> const one_over_r_cubed =
+            OneOverRCubed<kGravitationalInverseSqrtPrecision>(r_squared);
+        R3Element<Acceleration> acceleration =
+            Δq * (subsystem.gravitational_parameter * one_over_r_cubed);
+        if (hierarchy.use_quadrupole) {
+          // With the quadrupole moment Q, the potential is
+          //   -μ / |r| - r.Q.r / (2 |r|^5),
+          // where r = -Δq is the separation from the barycentre.
+          std::array<QuadrupoleMoment, 6> const& Q = subsystem.quadrupole;
+          R3Element<Product<QuadrupoleMoment, Length>> const Q_Δq(
+              Q[0] * Δq.x + Q[3] * Δq.y + Q[4] * Δq.z,
+              Q[3] * Δq.x + Q[1] * Δq.y + Q[5] * Δq.z,
+              Q[4] * Δq.x + Q[5] * Δq.y + Q[2] * Δq.z);
+          Exponentiation<Length, -2> const one_over_r_squared = 1 / r_squared;
+          auto const one_over_r_fifth = one_over_r_cubed * one_over_r_squared;
+          acceleration += Δq * (2.5 * Dot(Δq, Q_Δq) * one_over_r_fifth *
+                                one_over_r_squared) -
+                          Q_Δq * one_over_r_fifth;
+        }
+        (*result)[b2_0] += acceleration.x;
+        (*result)[b2_1] += acceleration.y;
+        (*result)[b2_2] += acceleration.z;
+        continue;
+      }
+    }
+    ComputeHierarchicalGravitationalAcceleration<layout>(
+        hierarchy,
+        massive_bodies,
+        child /*b1*/,
+        b2,
+        stride,
+        q,
+        result);
+  }
+}
+
+template<typename Frame>
+template<typename NBodySystem<Frame>::Layout layout>
+void NBodySystem<Frame>::ComputeMasslessBodiesGravitationalAccelerations(
+    MassiveBodiesTable const& massive_bodies,
+    ReadonlyTrajectories const& massless_trajectories,
+    Hierarchy const* const hierarchy,
+    InteractionLists const* const interaction_lists,
+    Instant const& reference_time,
+    std::size_t const b2_begin,
+    std::size_t const b2_end,
+    std::size_t const stride,
+    Time const& t,
+    std::vector<Length> const& q,
+    not_null<std::vector<Acceleration>*> const result) {
+  size_t const number_of_massive_oblate_trajectories =
+      massive_bodies.j2s.size();
+  size_t const number_of_massive_trajectories =
+      massive_bodies.gravitational_parameters.size();
+
+  if (hierarchy != nullptr) {
+    // Each massless body sees a different set of subsystems, so we iterate on
+    // the massless bodies first.
+    for (std::size_t b2 = b2_begin; b2 < b2_end; ++b2) {
+      for (std::size_t const root : hierarchy->roots) {
+        ComputeHierarchicalGravitationalAcceleration<layout>(
+            *hierarchy,
+            massive_bodies,
+            root /*b1*/,
+            b2,
+            stride,
+            q,
+            result);
       }
     }
+  } else if (interaction_lists != nullptr &&
+             number_of_massive_trajectories > 0) {
+    bool const refresh = interaction_lists->evaluations %
+                             interaction_lists->refresh_period == 0;
+    for (std::size_t b2 = b2_begin; b2 < b2_end; ++b2) {
+      if (refresh) {
+        ComputeInteractionList<layout>(
+            *interaction_lists, massive_bodies, b2, stride, q);
+      }
+      ComputeInteractionListGravitationalAcceleration<layout>(
+          *interaction_lists, massive_bodies, b2, stride, q, result);
+    }
+  } else {
+    for (std::size_t b1 = 0; b1 < number_of_massive_oblate_trajectories; ++b1) {
+      ComputeOneBodyGravitationalAcceleration<layout,
+                                              true /*body1_is_oblate*/,
+                                              false /*body2_is_oblate*/,
+                                              false /*body2_is_massive*/>(
+          massive_bodies, b1,
+          b2_begin,
+          b2_end,
+          stride,
+          q,
+          result);
+    }
+    for (std::size_t b1 = number_of_massive_oblate_trajectories;
+         b1 < number_of_massive_trajectories;
+         ++b1) {
+      ComputeOneBodyGravitationalAcceleration<layout,
+                                              false /*body1_is_oblate*/,
+                                              false /*body2_is_oblate*/,
+                                              false /*body2_is_massive*/>(
+          massive_bodies, b1,
+          b2_begin,
+          b2_end,
+          stride,
+          q,
+          result);
+    }
+  }
+  // Finally, take into account the intrinsic accelerations.
+  AddIntrinsicAccelerations<layout>(massless_trajectories,
+                                    number_of_massive_trajectories,
+                                    reference_time,
+                                    b2_begin,
+                                    b2_end,
+                                    stride,
+                                    t,
+                                    result);
+}
+
+template<typename Frame>
+template<typename NBodySystem<Frame>::Layout layout>
+void NBodySystem<Frame>::AddIntrinsicAccelerations(
+    ReadonlyTrajectories const& massless_trajectories,
+    std::size_t const number_of_massive_trajectories,
+    Instant const& reference_time,
+    std::size_t const b2_begin,
+    std::size_t const b2_end,
+    std::size_t const stride,
+    Time const& t,
+    not_null<std::vector<Acceleration>*> const result) {
+  for (size_t b2 = b2_begin; b2 < b2_end; ++b2) {
+    Trajectory<Frame> const* trajectory =
+        massless_trajectories[b2 - number_of_massive_trajectories];
+    if (trajectory->has_intrinsic_acceleration()) {
+      R3Element<Acceleration> const acceleration =
+          trajectory->evaluate_intrinsic_acceleration(
+              t + reference_time).coordinates();
+      (*result)[Index<layout>(b2, 0, stride)] += acceleration.x;
+      (*result)[Index<layout>(b2, 1, stride)] += acceleration.y;
+      (*result)[Index<layout>(b2, 2, stride)] += acceleration.z;
+    }
   }
 }
 
 template<typename Frame>
+template<typename NBodySystem<Frame>::Layout layout>
 void NBodySystem<Frame>::ComputeGravitationalAccelerations(
-    ReadonlyTrajectories const& massive_oblate_trajectories,
-    ReadonlyTrajectories const& massive_spherical_trajectories,
+    MassiveBodiesTable const& massive_bodies,
     ReadonlyTrajectories const& massless_trajectories,
+    Hierarchy const* const hierarchy,
+    InteractionLists const* const interaction_lists,
     Instant const& reference_time,
+    std::size_t const stride,
+    ThreadPool* const thread_pool,
+    int const chunks_per_thread,
     Time const& t,
     std::vector<Length> const& q,
     not_null<std::vector<Acceleration>*> const result) {
   result->assign(result->size(), Acceleration());
   size_t const number_of_massive_oblate_trajectories =
-      massive_oblate_trajectories.size();
-  size_t const number_of_massive_spherical_trajectories =
-      massive_spherical_trajectories.size();
+      massive_bodies.j2s.size();
+  size_t const number_of_massive_trajectories =
+      massive_bodies.gravitational_parameters.size();
   size_t const number_of_massless_trajectories = massless_trajectories.size();
 
+  // The interactions between massive bodies.
   for (std::size_t b1 = 0; b1 < number_of_massive_oblate_trajectories; ++b1) {
-    OblateBody<Frame> const& body1 =
-        *massive_oblate_trajectories[b1]->template body<OblateBody<Frame>>();
-    ComputeOneBodyGravitationalAcceleration<true /*body1_is_oblate*/,
+    ComputeOneBodyGravitationalAcceleration<layout,
+                                            true /*body1_is_oblate*/,
                                             true /*body2_is_oblate*/,
                                             true /*body2_is_massive*/>(
-        body1, b1,
-        massive_oblate_trajectories /*body2_trajectories*/,
+        massive_bodies, b1,
         0 /*b2_begin*/,
         number_of_massive_oblate_trajectories /*b2_end*/,
+        stride,
         q,
         result);
-    ComputeOneBodyGravitationalAcceleration<true /*body1_is_oblate*/,
+    ComputeOneBodyGravitationalAcceleration<layout,
+                                            true /*body1_is_oblate*/,
                                             false /*body2_is_oblate*/,
                                             true /*body2_is_massive*/>(
-        body1, b1,
-        massive_spherical_trajectories /*body2_trajectories*/,
+        massive_bodies, b1,
         number_of_massive_oblate_trajectories /*b2_begin*/,
-        number_of_massive_oblate_trajectories +
-            number_of_massive_spherical_trajectories /*b2_end*/,
-        q,
-        result);
-    ComputeOneBodyGravitationalAcceleration<true /*body1_is_oblate*/,
-                                            false /*body2_is_oblate*/,
-                                            false /*body2_is_massive*/>(
-        body1, b1,
-        massless_trajectories /*body2_trajectories*/,
-        number_of_massive_oblate_trajectories +
-            number_of_massive_spherical_trajectories /*b2_begin*/,
-        number_of_massive_oblate_trajectories +
-            number_of_massive_spherical_trajectories +
-            number_of_massless_trajectories /*b2_end*/,
+        number_of_massive_trajectories /*b2_end*/,
+        stride,
         q,
         result);
   }
-  for (std::size_t b1 = number_of_massive_oblate_trajectories;
-       b1 < number_of_massive_oblate_trajectories +
-            number_of_massive_spherical_trajectories;
-       ++b1) {
-    MassiveBody const& body1 =
-        *massive_spherical_trajectories[
-            b1 - number_of_massive_oblate_trajectories]->
-                template body<MassiveBody>();
-    ComputeOneBodyGravitationalAcceleration<false /*body1_is_oblate*/,
-                                            false /*body2_is_oblate*/,
-                                            true /*body2_is_massive*/>(
-        body1, b1,
-        massive_spherical_trajectories /*body2_trajectories*/,
-        number_of_massive_oblate_trajectories /*b2_begin*/,
-        number_of_massive_oblate_trajectories +
-            number_of_massive_spherical_trajectories /*b2_end*/,
+  if (number_of_massive_trajectories - number_of_massive_oblate_trajectories >
+      kMassiveBlockSize) {
+    ComputeTiledMutualAccelerations<layout>(
+        massive_bodies,
+        number_of_massive_oblate_trajectories /*b_begin*/,
+        number_of_massive_trajectories /*b_end*/,
+        stride,
         q,
         result);
-    ComputeOneBodyGravitationalAcceleration<false /*body1_is_oblate*/,
-                                            false /*body2_is_oblate*/,
-                                            false /*body2_is_massive*/>(
-        body1, b1,
-        massless_trajectories /*body2_trajectories*/,
-        number_of_massive_oblate_trajectories +
-            number_of_massive_spherical_trajectories /*b2_begin*/,
-        number_of_massive_oblate_trajectories +
-            number_of_massive_spherical_trajectories +
-            number_of_massless_trajectories /*b2_end*/,
+  } else {
+    for (std::size_t b1 = number_of_massive_oblate_trajectories;
+         b1 < number_of_massive_trajectories;
+         ++b1) {
+      ComputeOneBodyGravitationalAcceleration<layout,
+                                              false /*body1_is_oblate*/,
+                                              false /*body2_is_oblate*/,
+                                              true /*body2_is_massive*/>(
+          massive_bodies, b1,
+          number_of_massive_oblate_trajectories /*b2_begin*/,
+          number_of_massive_trajectories /*b2_end*/,
+          stride,
+          q,
+          result);
+    }
+  }
+
+  // The accelerations of the massless bodies.  They don't exert any force, so
+  // each chunk only writes to its own elements of |result|, and each element
+  // is computed by the same sequence of operations irrespective of the
+  // chunking.  This ensures that the results are deterministic.
+  std::size_t const massless_begin = number_of_massive_trajectories;
+  std::size_t const massless_end =
+      massless_begin + number_of_massless_trajectories;
+  if (hierarchy != nullptr && number_of_massless_trajectories > 0) {
+    ComputeSubsystems<layout>(*hierarchy, massive_bodies, stride, q);
+  }
+  if (thread_pool == nullptr || number_of_massless_trajectories == 0) {
+    ComputeMasslessBodiesGravitationalAccelerations<layout>(
+        massive_bodies,
+        massless_trajectories,
+        hierarchy,
+        interaction_lists,
+        reference_time,
+        massless_begin,
+        massless_end,
+        stride,
+        t,
         q,
         result);
+  } else {
+    // |chunks_per_thread| chunks per thread, rounded up to a multiple of a
+    // cache line to limit false sharing between threads.
+    std::size_t const number_of_chunks_wanted =
+        thread_pool->number_of_threads() * chunks_per_thread;
+    std::size_t const chunk_size =
+        ((number_of_massless_trajectories + number_of_chunks_wanted - 1) /
+             number_of_chunks_wanted + kCacheLineLength - 1) /
+        kCacheLineLength * kCacheLineLength;
+    int const number_of_chunks = static_cast<int>(
+        (number_of_massless_trajectories + chunk_size - 1) / chunk_size);
+    thread_pool->ParallelFor(
+        number_of_chunks,
+        [&massive_bodies,
+         &massless_trajectories,
+         hierarchy,
+         interaction_lists,
+         &reference_time,
+         massless_begin,
+         massless_end,
+         chunk_size,
+         stride,
+         &t,
+         &q,
+         result](int const chunk) {
+      std::size_t const b2_begin = massless_begin + chunk * chunk_size;
+      std::size_t const b2_end = std::min(b2_begin + chunk_size, massless_end);
+      ComputeMasslessBodiesGravitationalAccelerations<layout>(
+          massive_bodies,
+          massless_trajectories,
+          hierarchy,
+          interaction_lists,
+          reference_time,
+          b2_begin,
+          b2_end,
+          stride,
+          t,
+          q,
+          result);
+    });
   }
-  // Finally, take into account the intrinsic accelerations.
-  for (size_t b2 = number_of_massive_oblate_trajectories +
-                   number_of_massive_spherical_trajectories;
-       b2 < number_of_massive_oblate_trajectories +
-            number_of_massive_spherical_trajectories +
-            number_of_massless_trajectories;
-       ++b2) {
-    std::size_t const three_b2 = 3 * b2;
-    Trajectory<Frame> const* trajectory =
-        massless_trajectories[b2 - number_of_massive_oblate_trajectories -
-                                   number_of_massive_spherical_trajectories];
-    if (trajectory->has_intrinsic_acceleration()) {
-      R3Element<Acceleration> const acceleration =
-          trajectory->evaluate_intrinsic_acceleration(
-              t + reference_time).coordinates();
-      (*result)[three_b2] += acceleration.x;
-      (*result)[three_b2 + 1] += acceleration.y;
-      (*result)[three_b2 + 2] += acceleration.z;
+}
+
+template<typename Frame>
+template<typename NBodySystem<Frame>::Layout layout>
+void NBodySystem<Frame>::AddGravityGradientProducts(
+    MassiveBodiesTable const& massive_bodies,
+    std::size_t const number_of_massless,
+    std::size_t const stride,
+    Exponentiation<Time, 2> const& c,
+    std::vector<Length> const& q,
+    not_null<std::vector<Acceleration>*> const products,
+    not_null<std::vector<Acceleration>*> const result) {
+  products->assign(result->size(), Acceleration());
+  std::size_t const number_of_massive =
+      massive_bodies.gravitational_parameters.size();
+  std::size_t const number_of_bodies = number_of_massive + number_of_massless;
+  // The gravity gradient at body i is Σ μⱼ T(qᵢ - qⱼ), where
+  //   T(Δq) = (3 Δq Δqᵀ / |Δq|² - 1) / |Δq|³,
+  // and its product with the accelerations is Σ μⱼ T(qᵢ - qⱼ) (aᵢ - aⱼ), since
+  // the acceleration of body i depends on the position of body j through
+  // qᵢ - qⱼ.  T is even, so each pair contributes to both bodies with the same
+  // vector T(qᵢ - qⱼ) (aᵢ - aⱼ), with opposite signs.
+  for (std::size_t b1 = 0; b1 < number_of_massive; ++b1) {
+    GravitationalParameter const& μ1 =
+        massive_bodies.gravitational_parameters[b1];
+    std::size_t const b1_0 = Index<layout>(b1, 0, stride);
+    std::size_t const b1_1 = Index<layout>(b1, 1, stride);
+    std::size_t const b1_2 = Index<layout>(b1, 2, stride);
+    for (std::size_t b2 = b1 + 1; b2 < number_of_bodies; ++b2) {
+      std::size_t const b2_0 = Index<layout>(b2, 0, stride);
+      std::size_t const b2_1 = Index<layout>(b2, 1, stride);
+      std::size_t const b2_2 = Index<layout>(b2, 2, stride);
+      R3Element<Length> const Δq(q[b1_0] - q[b2_0],
+                                 q[b1_1] - q[b2_1],
+                                 q[b1_2] - q[b2_2]);
+      R3Element<Acceleration> const Δa((*result)[b1_0] - (*result)[b2_0],
+                                       (*result)[b1_1] - (*result)[b2_1],
+                                       (*result)[b1_2] - (*result)[b2_2]);
+      Exponentiation<Length, 2> const r_squared = Dot(Δq, Δq);
+      auto const c_over_r_cubed = c / (r_squared * Sqrt(r_squared));
+      auto const c_T_Δa =
+          (Δq * (3 * Dot(Δq, Δa) / r_squared) - Δa) * c_over_r_cubed;
+      (*products)[b2_0] -= μ1 * c_T_Δa.x;
+      (*products)[b2_1] -= μ1 * c_T_Δa.y;
+      (*products)[b2_2] -= μ1 * c_T_Δa.z;
+      if (b2 < number_of_massive) {
+        GravitationalParameter const& μ2 =
+            massive_bodies.gravitational_parameters[b2];
+        (*products)[b1_0] += μ2 * c_T_Δa.x;
+        (*products)[b1_1] += μ2 * c_T_Δa.y;
+        (*products)[b1_2] += μ2 * c_T_Δa.z;
+      }
     }
   }
+  for (std::size_t i = 0; i < result->size(); ++i) {
+    (*result)[i] += (*products)[i];
+  }
 }
 
 template<typename Frame>
-void NBodySystem<Frame>::ComputeGravitationalVelocities(
-    std::vector<Speed> const& p,
-    not_null<std::vector<Speed>*> const result) {
-  *result = p;
+typename NBodySystem<Frame>::Trajectories const&
+NBodySystem<Frame>::Plan::trajectories() const {
+  return data_.trajectories;
 }
 
 }  // namespace physics
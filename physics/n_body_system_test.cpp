@@ -1,19 +1,27 @@
 ﻿#include "physics/n_body_system.hpp"
 
+#include <algorithm>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/macros.hpp"
+#include "base/thread_pool.hpp"
 #include "geometry/grassmann.hpp"
 #include "geometry/named_quantities.hpp"
 #include "geometry/point.hpp"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "physics/body.hpp"
+#include "physics/ephemeris.hpp"
 #include "physics/massive_body.hpp"
+#include "physics/massless_accelerations_backend.hpp"
 #include "physics/massless_body.hpp"
+#include "physics/oblate_body.hpp"
+#include "physics/synchronized_histories.hpp"
 #include "physics/trajectory.hpp"
 #include "quantities/constants.hpp"
 #include "quantities/numbers.hpp"
@@ -23,23 +31,38 @@
 #include "testing_utilities/solar_system.hpp"
 
 using principia::base::make_not_null_unique;
+using principia::base::ThreadPool;
 using principia::constants::GravitationalConstant;
+using principia::geometry::Displacement;
 using principia::geometry::Instant;
 using principia::geometry::Point;
 using principia::geometry::Vector;
+using principia::integrators::EmbeddedExplicitRungeKuttaNyströmIntegrator;
+using principia::integrators::ForceGradientIntegrator;
+using principia::integrators::ForceGradientScheme;
+using principia::integrators::SPRKScheme;
+using principia::integrators::WisdomHolmanIntegrator;
 using principia::quantities::Angle;
 using principia::quantities::ArcTan;
 using principia::quantities::Area;
 using principia::quantities::Pow;
 using principia::quantities::SIUnit;
+using principia::quantities::SpecificEnergy;
 using principia::testing_utilities::AlmostEquals;
 using principia::testing_utilities::ICRFJ2000Ecliptic;
 using principia::testing_utilities::kSolarSystemBarycentre;
 using principia::testing_utilities::RelativeError;
 using principia::testing_utilities::SolarSystem;
+using principia::si::Day;
 using principia::si::Degree;
+using principia::si::Kilo;
+using principia::si::Metre;
 using principia::si::Minute;
+using principia::si::Radian;
+using principia::si::Second;
+using testing::ElementsAre;
 using testing::Eq;
+using testing::Ge;
 using testing::Gt;
 using testing::Lt;
 
@@ -48,6 +71,8 @@ namespace physics {
 
 class NBodySystemTest : public testing::Test {
  protected:
+  using Layout = NBodySystem<ICRFJ2000Ecliptic>::Layout;
+
   enum class Tag {
     kEarthMoonOrbitPlane,
   };
@@ -138,6 +163,87 @@ class NBodySystemTest : public testing::Test {
     return result;
   }
 
+  // Integrates the solar system with oblateness for one day, together with
+  // |kNumberOfProbes| massless probes in low orbits around the Earth, and
+  // returns the final degrees of freedom of all the bodies.  If
+  // |hierarchical_tolerance| is positive, the hierarchical force model is used
+  // with the tree given by |SolarSystem::parent|.  If
+  // |interaction_list_tolerance| is positive, the interaction lists are used
+  // and refreshed every 10 steps.  If |statistics| is not null, it receives
+  // the statistics of the integration.  |massless_chunks_per_thread| is passed
+  // to |NBodySystem::set_massless_chunks_per_thread|.  The solar system is
+  // constructed with the given |accuracy|, and |backend| is passed to
+  // |NBodySystem::set_massless_accelerations_backend|.
+  std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>>
+  IntegrateSolarSystemAndProbes(
+      Layout const layout,
+      ThreadPool* const thread_pool,
+      double const hierarchical_tolerance = 0,
+      bool const use_quadrupole = false,
+      double const interaction_list_tolerance = 0,
+      NBodySystem<ICRFJ2000Ecliptic>::Statistics* const statistics = nullptr,
+      int const massless_chunks_per_thread = 1,
+      SolarSystem::Accuracy const accuracy =
+          SolarSystem::Accuracy::kAllBodiesAndOblateness,
+      MasslessAccelerationsBackend* const backend = nullptr) {
+    int const kNumberOfProbes = 23;
+    not_null<std::unique_ptr<SolarSystem>> const solar_system =
+        SolarSystem::AtСпутник1Launch(accuracy);
+    NBodySystem<ICRFJ2000Ecliptic>::Trajectories trajectories =
+        solar_system->trajectories();
+    Trajectory<ICRFJ2000Ecliptic> const& earth =
+        *trajectories[SolarSystem::kEarth];
+    std::vector<std::unique_ptr<MasslessBody>> probes;
+    std::vector<std::unique_ptr<Trajectory<ICRFJ2000Ecliptic>>>
+        probe_trajectories;
+    for (int i = 0; i < kNumberOfProbes; ++i) {
+      probes.emplace_back(std::make_unique<MasslessBody>());
+      probe_trajectories.emplace_back(
+          std::make_unique<Trajectory<ICRFJ2000Ecliptic>>(probes.back().get()));
+      probe_trajectories.back()->Append(
+          earth.last().time(),
+          {earth.last().degrees_of_freedom().position() +
+               Vector<Length, ICRFJ2000Ecliptic>(
+                   {(7000 + 100 * i) * Kilo(Metre),
+                    0 * Metre,
+                    0 * Metre}),
+           earth.last().degrees_of_freedom().velocity() +
+               Velocity<ICRFJ2000Ecliptic>({0 * Metre / Second,
+                                            7.5 * Kilo(Metre) / Second,
+                                            0 * Metre / Second})});
+      trajectories.push_back(probe_trajectories.back().get());
+    }
+    std::map<MassiveBody const*, MassiveBody const*> parents;
+    for (int i = SolarSystem::kSun + 1; i <= SolarSystem::kTethys; ++i) {
+      parents.emplace(
+          trajectories[i]->body<MassiveBody>(),
+          trajectories[SolarSystem::parent(i)]->body<MassiveBody>());
+    }
+    NBodySystem<ICRFJ2000Ecliptic> system(layout);
+    system.set_thread_pool(thread_pool);
+    system.set_massless_chunks_per_thread(massless_chunks_per_thread);
+    system.set_massless_accelerations_backend(backend);
+    system.SetHierarchicalForceModel(parents,
+                                     hierarchical_tolerance,
+                                     use_quadrupole);
+    system.SetInteractionLists(interaction_list_tolerance,
+                               10 /*refresh_period*/);
+    system.Integrate(integrator_,
+                     earth.last().time() + 1 * Day,  // tmax
+                     1 * Minute,  // Δt
+                     0,  // sampling_period
+                     true,  // tmax_is_exact
+                     trajectories);
+    if (statistics != nullptr) {
+      *statistics = system.statistics();
+    }
+    std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> result;
+    for (auto const& trajectory : trajectories) {
+      result.push_back(trajectory->last().degrees_of_freedom());
+    }
+    return result;
+  }
+
   MassiveBody body1_;
   MassiveBody body2_;
   MasslessBody body3_;  // A massless probe.
@@ -232,6 +338,982 @@ TEST_F(NBodySystemTest, MoonEarth) {
   EXPECT_THAT(Abs(positions[100].coordinates().x), Lt(2 * SIUnit<Length>()));
 }
 
+// Checks that the statically dispatched integration yields the same results as
+// the virtual one.
+TEST_F(NBodySystemTest, IntegrateStatically) {
+  auto const trajectory3 =
+      make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&body1_);
+  auto const trajectory4 =
+      make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&body2_);
+  trajectory3->Append(trajectory1_->last().time(),
+                      trajectory1_->last().degrees_of_freedom());
+  trajectory4->Append(trajectory2_->last().time(),
+                      trajectory2_->last().degrees_of_freedom());
+  system_->Integrate(integrator_,
+                     trajectory1_->last().time() + period_,
+                     period_ / 100,
+                     1,      // sampling_period
+                     false,  // tmax_is_exact
+                     {trajectory1_.get(), trajectory2_.get()});
+  SPRKIntegrator<Length, Speed>::Workspace workspace;
+  system_->IntegrateStatically(integrator_,
+                               trajectory3->last().time() + period_,
+                               period_ / 100,
+                               1,      // sampling_period
+                               false,  // tmax_is_exact
+                               {trajectory3.get(), trajectory4.get()},
+                               &workspace);
+  EXPECT_THAT(trajectory3->Positions(), Eq(trajectory1_->Positions()));
+  EXPECT_THAT(trajectory3->Velocities(), Eq(trajectory1_->Velocities()));
+  EXPECT_THAT(trajectory4->Positions(), Eq(trajectory2_->Positions()));
+  EXPECT_THAT(trajectory4->Velocities(), Eq(trajectory2_->Velocities()));
+}
+
+// Checks that the rows appended to synchronized histories are the points
+// appended to the trajectories by |Integrate|, with the columns in the order
+// of the trajectories passed to it.
+TEST_F(NBodySystemTest, SynchronizedHistories) {
+  auto const trajectory3 =
+      make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&body1_);
+  auto const trajectory4 =
+      make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&body2_);
+  trajectory3->Append(trajectory1_->last().time(),
+                      trajectory1_->last().degrees_of_freedom());
+  trajectory4->Append(trajectory2_->last().time(),
+                      trajectory2_->last().degrees_of_freedom());
+  system_->Integrate(integrator_,
+                     trajectory1_->last().time() + period_,
+                     period_ / 100,
+                     1,      // sampling_period
+                     false,  // tmax_is_exact
+                     {trajectory1_.get(), trajectory2_.get()});
+  SynchronizedHistories<EarthMoonOrbitPlane> histories(2);
+  system_->Integrate(integrator_,
+                     trajectory3->last().time() + period_,
+                     period_ / 100,
+                     1,      // sampling_period
+                     false,  // tmax_is_exact
+                     {trajectory4.get(), trajectory3.get()},
+                     &histories);
+  ASSERT_THAT(histories.size(), Eq(trajectory1_->size()));
+  std::size_t index = 0;
+  for (auto it = trajectory1_->first(); !it.at_end(); ++it, ++index) {
+    EXPECT_THAT(histories.time(index), Eq(it.time()));
+    EXPECT_THAT(histories.degrees_of_freedom(index, 1),
+                Eq(it.degrees_of_freedom()));
+    EXPECT_THAT(histories.degrees_of_freedom(index, 0),
+                Eq(trajectory2_->EvaluateDegreesOfFreedom(it.time())));
+  }
+  // Only the final state is appended to the trajectories.
+  EXPECT_THAT(trajectory3->size(), Eq(2));
+  EXPECT_THAT(trajectory3->last().time(), Eq(trajectory1_->last().time()));
+  EXPECT_THAT(trajectory3->last().degrees_of_freedom(),
+              Eq(trajectory1_->last().degrees_of_freedom()));
+  EXPECT_THAT(trajectory4->last().degrees_of_freedom(),
+              Eq(trajectory2_->last().degrees_of_freedom()));
+}
+
+// Checks that the integration of a plan yields the same results as that of its
+// trajectories, as massless bodies are added to and removed from the plan.
+TEST_F(NBodySystemTest, Plan) {
+  auto const reference1 =
+      make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&body1_);
+  auto const reference2 =
+      make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&body2_);
+  auto const reference3 =
+      make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&body3_);
+  reference1->Append(trajectory1_->last().time(),
+                     trajectory1_->last().degrees_of_freedom());
+  reference2->Append(trajectory2_->last().time(),
+                     trajectory2_->last().degrees_of_freedom());
+
+  NBodySystem<EarthMoonOrbitPlane>::Plan plan;
+  system_->UpdatePlan({trajectory2_.get(), trajectory1_.get()}, &plan);
+  EXPECT_THAT(plan.trajectories(),
+              ElementsAre(trajectory2_.get(), trajectory1_.get()));
+  Instant t = trajectory1_->last().time() + period_ / 4;
+  system_->IntegratePlan(integrator_,
+                         t,
+                         period_ / 100,
+                         1,      // sampling_period
+                         false,  // tmax_is_exact
+                         &plan);
+  system_->Integrate(integrator_,
+                     t,
+                     period_ / 100,
+                     1,      // sampling_period
+                     false,  // tmax_is_exact
+                     {reference2.get(), reference1.get()});
+  EXPECT_THAT(trajectory1_->Positions(), Eq(reference1->Positions()));
+  EXPECT_THAT(trajectory2_->Velocities(), Eq(reference2->Velocities()));
+
+  // A probe between the Earth and the Moon is added.
+  DegreesOfFreedom<EarthMoonOrbitPlane> const earth =
+      trajectory1_->last().degrees_of_freedom();
+  DegreesOfFreedom<EarthMoonOrbitPlane> const moon =
+      trajectory2_->last().degrees_of_freedom();
+  DegreesOfFreedom<EarthMoonOrbitPlane> const probe(
+      earth.position() + (moon.position() - earth.position()) / 2,
+      earth.velocity() + (moon.velocity() - earth.velocity()) / 2);
+  trajectory3_->Append(trajectory1_->last().time(), probe);
+  reference3->Append(trajectory1_->last().time(), probe);
+  system_->UpdatePlan({trajectory3_.get(),
+                       trajectory2_.get(),
+                       trajectory1_.get()},
+                      &plan);
+  EXPECT_THAT(plan.trajectories(),
+              ElementsAre(trajectory2_.get(),
+                          trajectory1_.get(),
+                          trajectory3_.get()));
+  t += period_ / 4;
+  system_->IntegratePlan(integrator_,
+                         t,
+                         period_ / 100,
+                         1,      // sampling_period
+                         false,  // tmax_is_exact
+                         &plan);
+  system_->Integrate(integrator_,
+                     t,
+                     period_ / 100,
+                     1,      // sampling_period
+                     false,  // tmax_is_exact
+                     {reference3.get(), reference2.get(), reference1.get()});
+  EXPECT_THAT(trajectory1_->Positions(), Eq(reference1->Positions()));
+  EXPECT_THAT(trajectory3_->Positions(), Eq(reference3->Positions()));
+  EXPECT_THAT(trajectory3_->Velocities(), Eq(reference3->Velocities()));
+
+  // The probe is removed.
+  system_->UpdatePlan({trajectory2_.get(), trajectory1_.get()}, &plan);
+  EXPECT_THAT(plan.trajectories(),
+              ElementsAre(trajectory2_.get(), trajectory1_.get()));
+  t += period_ / 4;
+  system_->IntegratePlan(integrator_,
+                         t,
+                         period_ / 100,
+                         1,      // sampling_period
+                         false,  // tmax_is_exact
+                         &plan);
+  system_->Integrate(integrator_,
+                     t,
+                     period_ / 100,
+                     1,      // sampling_period
+                     false,  // tmax_is_exact
+                     {reference2.get(), reference1.get()});
+  EXPECT_THAT(trajectory1_->Positions(), Eq(reference1->Positions()));
+  EXPECT_THAT(trajectory2_->Velocities(), Eq(reference2->Velocities()));
+  EXPECT_THAT(trajectory3_->last().time(), Lt(t));
+}
+
+// The Earth-Moon system far from the origin and from |Instant()|, integrated
+// with recentring, ends exactly at |tmax| and is as accurate as near the
+// origin.
+TEST_F(NBodySystemTest, Recentring) {
+  Vector<Length, EarthMoonOrbitPlane> const translation(
+      {1.5E11 * SIUnit<Length>(),
+       -2E11 * SIUnit<Length>(),
+       3E10 * SIUnit<Length>()});
+  Instant const t0 = Instant(1E9 * SIUnit<Time>());
+  Instant const tmax = t0 + period_;
+  auto const trajectory3 =
+      make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&body1_);
+  auto const trajectory4 =
+      make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&body2_);
+  trajectory3->Append(
+      t0,
+      {trajectory1_->last().degrees_of_freedom().position() + translation,
+       trajectory1_->last().degrees_of_freedom().velocity()});
+  trajectory4->Append(
+      t0,
+      {trajectory2_->last().degrees_of_freedom().position() + translation,
+       trajectory2_->last().degrees_of_freedom().velocity()});
+  system_->set_recentring(true);
+  system_->Integrate(integrator_,
+                     tmax,
+                     period_ / 100,
+                     1,     // sampling_period
+                     true,  // tmax_is_exact
+                     {trajectory3.get(), trajectory4.get()});
+  EXPECT_THAT(trajectory3->last().time(), Eq(tmax));
+  EXPECT_THAT(trajectory4->last().time(), Eq(tmax));
+
+  std::vector<Vector<Length, EarthMoonOrbitPlane>> positions =
+      ValuesOf(trajectory3->Positions(), centre_of_mass_ + translation);
+  EXPECT_THAT(Abs(positions[25].coordinates().y), Lt(3E-2 * SIUnit<Length>()));
+  EXPECT_THAT(Abs(positions[50].coordinates().x), Lt(3E-2 * SIUnit<Length>()));
+  EXPECT_THAT(Abs(positions.back().coordinates().x),
+              Lt(3E-2 * SIUnit<Length>()));
+  positions = ValuesOf(trajectory4->Positions(), centre_of_mass_ + translation);
+  EXPECT_THAT(Abs(positions[25].coordinates().y), Lt(2 * SIUnit<Length>()));
+  EXPECT_THAT(Abs(positions[50].coordinates().x), Lt(2 * SIUnit<Length>()));
+  EXPECT_THAT(Abs(positions.back().coordinates().x), Lt(2 * SIUnit<Length>()));
+}
+
+// On the circular orbits of the Earth and the Moon, the adaptive sampling
+// appends a state every time the velocities have turned by the tolerance, and
+// the final state.  In uniform motion it falls back to the maximum period.
+TEST_F(NBodySystemTest, AdaptiveSampling) {
+  Instant const tmax = trajectory1_->last().time() + period_;
+  NBodySystem<EarthMoonOrbitPlane>::AdaptiveSampling sampling;
+  sampling.angular_tolerance = 0.05 * Radian;
+  sampling.maximum_sampling_period = 1000;
+  system_->Integrate(integrator_,
+                     tmax,
+                     period_ / 1000,
+                     sampling,
+                     true,  // tmax_is_exact
+                     {trajectory1_.get(), trajectory2_.get()});
+  // The velocities turn by 2π / 1000 rad per step, so a state is appended
+  // every 8 steps, including the last one.
+  EXPECT_THAT(trajectory1_->Times().size(), Eq(1 + 1000 / 8));
+  EXPECT_THAT(trajectory2_->Times().size(), Eq(1 + 1000 / 8));
+  EXPECT_THAT(trajectory1_->last().time(), Eq(tmax));
+  std::map<Instant, Velocity<EarthMoonOrbitPlane>> const velocities =
+      trajectory2_->Velocities();
+  for (auto it1 = velocities.begin(), it2 = std::next(it1);
+       it2 != velocities.end();
+       ++it1, ++it2) {
+    Angle const angle = ArcTan(Wedge(it1->second, it2->second).Norm(),
+                               InnerProduct(it1->second, it2->second));
+    EXPECT_THAT(angle, Lt(8.5 * 2 * π / 1000 * Radian));
+  }
+
+  auto const trajectory3 =
+      make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&body3_);
+  trajectory3->Append(
+      trajectory1_->last().time(),
+      {centre_of_mass_,
+       Velocity<EarthMoonOrbitPlane>({1 * SIUnit<Speed>(),
+                                      2 * SIUnit<Speed>(),
+                                      3 * SIUnit<Speed>()})});
+  sampling.maximum_sampling_period = 50;
+  system_->Integrate(integrator_,
+                     trajectory3->last().time() + period_,
+                     period_ / 1000,
+                     sampling,
+                     true,  // tmax_is_exact
+                     {trajectory3.get()});
+  EXPECT_THAT(trajectory3->Times().size(), Eq(1 + 1000 / 50));
+}
+
+// The statistics count one evaluation of the forces per stage and one point per
+// trajectory per sampled step.
+TEST_F(NBodySystemTest, Statistics) {
+  EXPECT_EQ(0, system_->statistics().force_evaluations);
+  EXPECT_EQ(0, system_->statistics().points_appended);
+  system_->Integrate(integrator_,
+                     trajectory1_->last().time() + period_,
+                     period_ / 100,
+                     1,      // sampling_period
+                     false,  // tmax_is_exact
+                     {trajectory1_.get(), trajectory2_.get()});
+  EXPECT_EQ(100 * 6, system_->statistics().force_evaluations);
+  EXPECT_EQ(100 * 2, system_->statistics().points_appended);
+  system_->reset_statistics();
+  EXPECT_EQ(0, system_->statistics().force_evaluations);
+  EXPECT_EQ(0, system_->statistics().points_appended);
+}
+
+// The adaptive integration brings the Earth and the Moon back to their initial
+// positions after one period, and only appends the final state.
+TEST_F(NBodySystemTest, IntegrateAdaptively) {
+  EmbeddedExplicitRungeKuttaNyströmIntegrator<Length> const
+      adaptive_integrator;
+  Instant const tmax = trajectory1_->last().time() + period_;
+  system_->IntegrateAdaptively(adaptive_integrator,
+                               tmax,
+                               period_ / 100,        // first_time_step
+                               1 * Metre,            // length_tolerance
+                               1 * Metre / Second,   // speed_tolerance
+                               {trajectory1_.get(), trajectory2_.get()});
+  std::vector<Vector<Length, EarthMoonOrbitPlane>> positions =
+      ValuesOf(trajectory1_->Positions(), centre_of_mass_);
+  ASSERT_THAT(positions.size(), Eq(2));
+  EXPECT_THAT(trajectory1_->last().time(), Eq(tmax));
+  EXPECT_THAT(RelativeError(positions[0], positions[1]), Lt(1E-5));
+
+  positions = ValuesOf(trajectory2_->Positions(), centre_of_mass_);
+  ASSERT_THAT(positions.size(), Eq(2));
+  EXPECT_THAT(trajectory2_->last().time(), Eq(tmax));
+  EXPECT_THAT(RelativeError(positions[0], positions[1]), Lt(1E-5));
+}
+
+// The Earth and the Moon with a probe in low orbit around the Earth and a probe
+// far away.  The massive bodies get the same results as with |Integrate|, and
+// the probe in low orbit, which is integrated with smaller steps, is close to
+// the result of an integration of the whole system with these steps.
+TEST_F(NBodySystemTest, IntegrateWithBlockTimeSteps) {
+  Time const Δt = period_ / 1000;
+  Length const low_orbit_radius = 1E7 * SIUnit<Length>();
+  DegreesOfFreedom<EarthMoonOrbitPlane> const earth =
+      trajectory1_->last().degrees_of_freedom();
+  MasslessBody far_probe;
+  auto const far_probe_trajectory =
+      make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&far_probe);
+  trajectory3_->Append(
+      trajectory1_->last().time(),
+      {earth.position() +
+           Vector<Length, EarthMoonOrbitPlane>({low_orbit_radius,
+                                                0 * SIUnit<Length>(),
+                                                0 * SIUnit<Length>()}),
+       earth.velocity() +
+           Velocity<EarthMoonOrbitPlane>(
+               {0 * SIUnit<Speed>(),
+                Sqrt(body1_.gravitational_parameter() / low_orbit_radius),
+                0 * SIUnit<Speed>()})});
+  far_probe_trajectory->Append(
+      trajectory1_->last().time(),
+      {earth.position() +
+           Vector<Length, EarthMoonOrbitPlane>({0 * SIUnit<Length>(),
+                                                0 * SIUnit<Length>(),
+                                                1E9 * SIUnit<Length>()}),
+       earth.velocity()});
+
+  // Copies of the trajectories for the reference integrations.
+  std::vector<not_null<std::unique_ptr<Trajectory<EarthMoonOrbitPlane>>>>
+      massive_references;
+  std::vector<not_null<std::unique_ptr<Trajectory<EarthMoonOrbitPlane>>>>
+      all_references;
+  for (auto const trajectory : {trajectory1_.get(), trajectory2_.get()}) {
+    massive_references.push_back(
+        make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(
+            trajectory->body<Body>()));
+    massive_references.back()->Append(
+        trajectory->last().time(), trajectory->last().degrees_of_freedom());
+  }
+  for (auto const trajectory : {trajectory1_.get(),
+                                trajectory2_.get(),
+                                trajectory3_.get(),
+                                far_probe_trajectory.get()}) {
+    all_references.push_back(
+        make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(
+            trajectory->body<Body>()));
+    all_references.back()->Append(
+        trajectory->last().time(), trajectory->last().degrees_of_freedom());
+  }
+
+  Instant const tmax = trajectory1_->last().time() + period_ / 10;
+  system_->IntegrateWithBlockTimeSteps(integrator_,
+                                       tmax,
+                                       Δt,
+                                       0.05,  // timescale_fraction
+                                       10,    // max_level
+                                       {trajectory1_.get(),
+                                        trajectory2_.get(),
+                                        trajectory3_.get(),
+                                        far_probe_trajectory.get()});
+  Instant const final_time = trajectory1_->last().time();
+  EXPECT_THAT(trajectory1_->Positions().size(), Eq(2));
+  EXPECT_THAT(trajectory2_->last().time(), Eq(final_time));
+  EXPECT_THAT(trajectory3_->last().time(), Eq(final_time));
+  EXPECT_THAT(far_probe_trajectory->last().time(), Eq(final_time));
+
+  system_->Integrate(integrator_,
+                     tmax,
+                     Δt,
+                     0,      // sampling_period
+                     false,  // tmax_is_exact
+                     {massive_references[0].get(),
+                      massive_references[1].get()});
+  EXPECT_THAT(massive_references[0]->last().time(), Eq(final_time));
+  EXPECT_THAT(massive_references[0]->last().degrees_of_freedom(),
+              Eq(trajectory1_->last().degrees_of_freedom()));
+  EXPECT_THAT(massive_references[1]->last().degrees_of_freedom(),
+              Eq(trajectory2_->last().degrees_of_freedom()));
+
+  // The probe in low orbit has a free-fall time scale of about 1600 s, so it
+  // is integrated at level 5.
+  system_->Integrate(integrator_,
+                     final_time,
+                     Δt / 32,
+                     0,     // sampling_period
+                     true,  // tmax_is_exact
+                     {all_references[0].get(),
+                      all_references[1].get(),
+                      all_references[2].get(),
+                      all_references[3].get()});
+  EXPECT_THAT(
+      RelativeError(
+          all_references[2]->last().degrees_of_freedom().position() -
+              all_references[0]->last().degrees_of_freedom().position(),
+          trajectory3_->last().degrees_of_freedom().position() -
+              trajectory1_->last().degrees_of_freedom().position()),
+      Lt(1E-6));
+  EXPECT_THAT(
+      RelativeError(
+          all_references[3]->last().degrees_of_freedom().position() -
+              all_references[0]->last().degrees_of_freedom().position(),
+          far_probe_trajectory->last().degrees_of_freedom().position() -
+              trajectory1_->last().degrees_of_freedom().position()),
+      Lt(1E-6));
+}
+
+// A probe on a hyperbolic flyby of the Earth with a periapsis of about
+// 6500 km, integrated with a time step much longer than the time scale of the
+// encounter.  The regularised integration of the close encounter is close to
+// a reference integration with a short time step, while the integration
+// without regularisation is not.
+TEST_F(NBodySystemTest, CloseEncounter) {
+  Time const Δt = period_ / 2000;
+  DegreesOfFreedom<EarthMoonOrbitPlane> const earth =
+      trajectory1_->last().degrees_of_freedom();
+  DegreesOfFreedom<EarthMoonOrbitPlane> const probe(
+      earth.position() +
+          Vector<Length, EarthMoonOrbitPlane>({5E7 * SIUnit<Length>(),
+                                               1.5E7 * SIUnit<Length>(),
+                                               0 * SIUnit<Length>()}),
+      earth.velocity() +
+          Velocity<EarthMoonOrbitPlane>({-5E3 * SIUnit<Speed>(),
+                                         0 * SIUnit<Speed>(),
+                                         0 * SIUnit<Speed>()}));
+  trajectory3_->Append(trajectory1_->last().time(), probe);
+
+  // Copies of the trajectories for the reference and unregularised
+  // integrations.
+  std::vector<not_null<std::unique_ptr<Trajectory<EarthMoonOrbitPlane>>>>
+      references;
+  std::vector<not_null<std::unique_ptr<Trajectory<EarthMoonOrbitPlane>>>>
+      unregularised;
+  for (auto const trajectory : {trajectory1_.get(),
+                                trajectory2_.get(),
+                                trajectory3_.get()}) {
+    for (auto const copies : {&references, &unregularised}) {
+      copies->push_back(
+          make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(
+              trajectory->body<Body>()));
+      copies->back()->Append(trajectory->last().time(),
+                             trajectory->last().degrees_of_freedom());
+    }
+  }
+
+  Instant const tmax = trajectory1_->last().time() + 20 * Δt;
+  system_->Integrate(integrator_,
+                     tmax,
+                     Δt,
+                     0,     // sampling_period
+                     true,  // tmax_is_exact
+                     {unregularised[0].get(),
+                      unregularised[1].get(),
+                      unregularised[2].get()});
+  system_->Integrate(integrator_,
+                     tmax,
+                     Δt / 1000,
+                     0,     // sampling_period
+                     true,  // tmax_is_exact
+                     {references[0].get(),
+                      references[1].get(),
+                      references[2].get()});
+  system_->set_close_encounter_timescale_fraction(0.01);
+  system_->Integrate(integrator_,
+                     tmax,
+                     Δt,
+                     0,     // sampling_period
+                     true,  // tmax_is_exact
+                     {trajectory1_.get(),
+                      trajectory2_.get(),
+                      trajectory3_.get()});
+  EXPECT_THAT(trajectory3_->last().time(), Eq(tmax));
+  EXPECT_THAT(trajectory1_->last().degrees_of_freedom(),
+              Eq(unregularised[0]->last().degrees_of_freedom()));
+
+  auto const probe_from_earth =
+      [](Trajectory<EarthMoonOrbitPlane> const& earth,
+         Trajectory<EarthMoonOrbitPlane> const& probe) {
+    return probe.last().degrees_of_freedom().position() -
+           earth.last().degrees_of_freedom().position();
+  };
+  double const regularised_error =
+      RelativeError(probe_from_earth(*references[0], *references[2]),
+                    probe_from_earth(*trajectory1_, *trajectory3_));
+  double const unregularised_error =
+      RelativeError(probe_from_earth(*references[0], *references[2]),
+                    probe_from_earth(*unregularised[0], *unregularised[2]));
+  EXPECT_THAT(regularised_error, Lt(1E-4));
+  EXPECT_THAT(unregularised_error, Gt(1E-2));
+}
+
+// The Earth and the Moon integrated while recording their steps get the same
+// results as without recording, and a probe in low orbit around the Earth
+// integrated in the field of the recorded steps is close to the result of an
+// integration of the whole system.
+TEST_F(NBodySystemTest, IntegrateMasslessBodiesInSteps) {
+  Time const Δt = period_ / 1000;
+  Length const low_orbit_radius = 1E7 * SIUnit<Length>();
+  DegreesOfFreedom<EarthMoonOrbitPlane> const earth =
+      trajectory1_->last().degrees_of_freedom();
+  trajectory3_->Append(
+      trajectory1_->last().time(),
+      {earth.position() +
+           Vector<Length, EarthMoonOrbitPlane>({low_orbit_radius,
+                                                0 * SIUnit<Length>(),
+                                                0 * SIUnit<Length>()}),
+       earth.velocity() +
+           Velocity<EarthMoonOrbitPlane>(
+               {0 * SIUnit<Speed>(),
+                Sqrt(body1_.gravitational_parameter() / low_orbit_radius),
+                0 * SIUnit<Speed>()})});
+
+  // Copies of the trajectories for the reference integrations.
+  std::vector<not_null<std::unique_ptr<Trajectory<EarthMoonOrbitPlane>>>>
+      massive_references;
+  std::vector<not_null<std::unique_ptr<Trajectory<EarthMoonOrbitPlane>>>>
+      all_references;
+  for (auto const trajectory : {trajectory1_.get(), trajectory2_.get()}) {
+    massive_references.push_back(
+        make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(
+            trajectory->body<Body>()));
+    massive_references.back()->Append(
+        trajectory->last().time(), trajectory->last().degrees_of_freedom());
+  }
+  for (auto const trajectory : {trajectory1_.get(),
+                                trajectory2_.get(),
+                                trajectory3_.get()}) {
+    all_references.push_back(
+        make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(
+            trajectory->body<Body>()));
+    all_references.back()->Append(
+        trajectory->last().time(), trajectory->last().degrees_of_freedom());
+  }
+
+  Instant const tmax = trajectory1_->last().time() + period_ / 10;
+  NBodySystem<EarthMoonOrbitPlane>::MassiveBodiesSteps massive_steps;
+  system_->Integrate(integrator_,
+                     tmax,
+                     Δt,
+                     0,      // sampling_period
+                     false,  // tmax_is_exact
+                     {trajectory1_.get(), trajectory2_.get()},
+                     &massive_steps);
+  Instant const final_time = trajectory1_->last().time();
+  EXPECT_THAT(trajectory1_->Positions().size(), Eq(2));
+  EXPECT_THAT(trajectory2_->last().time(), Eq(final_time));
+
+  system_->Integrate(integrator_,
+                     tmax,
+                     Δt,
+                     0,      // sampling_period
+                     false,  // tmax_is_exact
+                     {massive_references[0].get(),
+                      massive_references[1].get()});
+  EXPECT_THAT(massive_references[0]->last().time(), Eq(final_time));
+  EXPECT_THAT(massive_references[0]->last().degrees_of_freedom(),
+              Eq(trajectory1_->last().degrees_of_freedom()));
+  EXPECT_THAT(massive_references[1]->last().degrees_of_freedom(),
+              Eq(trajectory2_->last().degrees_of_freedom()));
+
+  system_->IntegrateMasslessBodiesInSteps(integrator_,
+                                          massive_steps,
+                                          final_time,
+                                          Δt / 32,
+                                          0,     // sampling_period
+                                          true,  // tmax_is_exact
+                                          {trajectory3_.get()});
+  EXPECT_THAT(trajectory3_->Positions().size(), Eq(2));
+  EXPECT_THAT(trajectory3_->last().time(), Eq(final_time));
+
+  system_->Integrate(integrator_,
+                     final_time,
+                     Δt / 32,
+                     0,     // sampling_period
+                     true,  // tmax_is_exact
+                     {all_references[0].get(),
+                      all_references[1].get(),
+                      all_references[2].get()});
+  EXPECT_THAT(
+      RelativeError(
+          all_references[2]->last().degrees_of_freedom().position() -
+              all_references[0]->last().degrees_of_freedom().position(),
+          trajectory3_->last().degrees_of_freedom().position() -
+              trajectory1_->last().degrees_of_freedom().position()),
+      Lt(1E-6));
+}
+
+// A probe in low orbit around the Earth integrated in the field of existing
+// trajectories of the Earth and the Moon is close to the result of an
+// integration of the whole system.
+TEST_F(NBodySystemTest, IntegrateMassless) {
+  Time const Δt = period_ / 1000;
+  Length const low_orbit_radius = 1E7 * SIUnit<Length>();
+  DegreesOfFreedom<EarthMoonOrbitPlane> const earth =
+      trajectory1_->last().degrees_of_freedom();
+  trajectory3_->Append(
+      trajectory1_->last().time(),
+      {earth.position() +
+           Vector<Length, EarthMoonOrbitPlane>({low_orbit_radius,
+                                                0 * SIUnit<Length>(),
+                                                0 * SIUnit<Length>()}),
+       earth.velocity() +
+           Velocity<EarthMoonOrbitPlane>(
+               {0 * SIUnit<Speed>(),
+                Sqrt(body1_.gravitational_parameter() / low_orbit_radius),
+                0 * SIUnit<Speed>()})});
+
+  // Copies of the trajectories for the reference integration.
+  std::vector<not_null<std::unique_ptr<Trajectory<EarthMoonOrbitPlane>>>>
+      references;
+  for (auto const trajectory : {trajectory1_.get(),
+                                trajectory2_.get(),
+                                trajectory3_.get()}) {
+    references.push_back(
+        make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(
+            trajectory->body<Body>()));
+    references.back()->Append(
+        trajectory->last().time(), trajectory->last().degrees_of_freedom());
+  }
+
+  // The trajectories of the Earth and the Moon, with a point at each step.
+  Instant const tmax = trajectory1_->last().time() + period_ / 10;
+  system_->Integrate(integrator_,
+                     tmax,
+                     Δt,
+                     1,     // sampling_period
+                     true,  // tmax_is_exact
+                     {trajectory1_.get(), trajectory2_.get()});
+  std::size_t const number_of_massive_points =
+      trajectory1_->Positions().size();
+  EXPECT_THAT(number_of_massive_points, Eq(101));
+
+  system_->IntegrateMassless(integrator_,
+                             {trajectory2_.get(), trajectory1_.get()},
+                             tmax,
+                             Δt / 32,
+                             0,     // sampling_period
+                             true,  // tmax_is_exact
+                             {trajectory3_.get()});
+  EXPECT_THAT(trajectory3_->Positions().size(), Eq(2));
+  EXPECT_THAT(trajectory3_->last().time(), Eq(tmax));
+  // The massive trajectories are not modified.
+  EXPECT_THAT(trajectory1_->Positions().size(), Eq(number_of_massive_points));
+  EXPECT_THAT(trajectory2_->Positions().size(), Eq(number_of_massive_points));
+
+  system_->Integrate(integrator_,
+                     tmax,
+                     Δt / 32,
+                     0,     // sampling_period
+                     true,  // tmax_is_exact
+                     {references[0].get(),
+                      references[1].get(),
+                      references[2].get()});
+  EXPECT_THAT(
+      RelativeError(
+          references[2]->last().degrees_of_freedom().position() -
+              references[0]->last().degrees_of_freedom().position(),
+          trajectory3_->last().degrees_of_freedom().position() -
+              trajectory1_->last().degrees_of_freedom().position()),
+      Lt(1E-6));
+}
+
+// A probe in low orbit around the Earth integrated in the field of an ephemeris
+// of the Earth and the Moon is close to the result of an integration of the
+// whole system.
+TEST_F(NBodySystemTest, IntegrateMasslessBodies) {
+  Length const low_orbit_radius = 1E7 * SIUnit<Length>();
+  DegreesOfFreedom<EarthMoonOrbitPlane> const earth =
+      trajectory1_->last().degrees_of_freedom();
+  trajectory3_->Append(
+      trajectory1_->last().time(),
+      {earth.position() +
+           Vector<Length, EarthMoonOrbitPlane>({low_orbit_radius,
+                                                0 * SIUnit<Length>(),
+                                                0 * SIUnit<Length>()}),
+       earth.velocity() +
+           Velocity<EarthMoonOrbitPlane>(
+               {0 * SIUnit<Speed>(),
+                Sqrt(body1_.gravitational_parameter() / low_orbit_radius),
+                0 * SIUnit<Speed>()})});
+  auto const reference_probe_trajectory =
+      make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&body3_);
+  reference_probe_trajectory->Append(
+      trajectory3_->last().time(), trajectory3_->last().degrees_of_freedom());
+
+  Ephemeris<EarthMoonOrbitPlane> ephemeris(
+      {trajectory1_.get(), trajectory2_.get()},
+      integrator_,
+      period_ / 1000,  // Δt
+      8,               // steps_per_series
+      12);             // degree
+  Instant const tmax = trajectory1_->last().time() + period_ / 10;
+  system_->IntegrateMasslessBodies(integrator_,
+                                   &ephemeris,
+                                   tmax,
+                                   period_ / 32000,
+                                   0,     // sampling_period
+                                   true,  // tmax_is_exact
+                                   {trajectory3_.get()});
+  EXPECT_THAT(ephemeris.t_max(), Ge(tmax));
+  EXPECT_THAT(trajectory3_->Positions().size(), Eq(2));
+  EXPECT_THAT(trajectory3_->last().time(), Eq(tmax));
+  // The massive trajectories are not modified.
+  EXPECT_THAT(trajectory1_->Positions().size(), Eq(1));
+
+  system_->Integrate(integrator_,
+                     tmax,
+                     period_ / 32000,
+                     0,     // sampling_period
+                     true,  // tmax_is_exact
+                     {trajectory1_.get(),
+                      trajectory2_.get(),
+                      reference_probe_trajectory.get()});
+  EXPECT_THAT(
+      RelativeError(
+          reference_probe_trajectory->last().degrees_of_freedom().position() -
+              trajectory1_->last().degrees_of_freedom().position(),
+          trajectory3_->last().degrees_of_freedom().position() -
+              ephemeris.EvaluatePosition(0, tmax)),
+      Lt(1E-6));
+}
+
+// Same as above, with the probe integrated relative to the Earth.
+TEST_F(NBodySystemTest, IntegrateMasslessBodiesRelativeToParents) {
+  Length const low_orbit_radius = 1E7 * SIUnit<Length>();
+  DegreesOfFreedom<EarthMoonOrbitPlane> const earth =
+      trajectory1_->last().degrees_of_freedom();
+  trajectory3_->Append(
+      trajectory1_->last().time(),
+      {earth.position() +
+           Vector<Length, EarthMoonOrbitPlane>({low_orbit_radius,
+                                                0 * SIUnit<Length>(),
+                                                0 * SIUnit<Length>()}),
+       earth.velocity() +
+           Velocity<EarthMoonOrbitPlane>(
+               {0 * SIUnit<Speed>(),
+                Sqrt(body1_.gravitational_parameter() / low_orbit_radius),
+                0 * SIUnit<Speed>()})});
+  auto const reference_probe_trajectory =
+      make_not_null_unique<Trajectory<EarthMoonOrbitPlane>>(&body3_);
+  reference_probe_trajectory->Append(
+      trajectory3_->last().time(), trajectory3_->last().degrees_of_freedom());
+
+  Ephemeris<EarthMoonOrbitPlane> ephemeris(
+      {trajectory1_.get(), trajectory2_.get()},
+      integrator_,
+      period_ / 1000,  // Δt
+      8,               // steps_per_series
+      12);             // degree
+  std::size_t earth_index = ephemeris.number_of_bodies();
+  for (std::size_t b = 0; b < ephemeris.number_of_bodies(); ++b) {
+    if (ephemeris.bodies()[b] == &body1_) {
+      earth_index = b;
+    }
+  }
+  ASSERT_THAT(earth_index, Lt(ephemeris.number_of_bodies()));
+  Instant const tmax = trajectory1_->last().time() + period_ / 10;
+  system_->IntegrateMasslessBodiesRelativeToParents(integrator_,
+                                                    &ephemeris,
+                                                    {earth_index},
+                                                    tmax,
+                                                    period_ / 32000,
+                                                    0,     // sampling_period
+                                                    true,  // tmax_is_exact
+                                                    {trajectory3_.get()});
+  EXPECT_THAT(trajectory3_->Positions().size(), Eq(2));
+  EXPECT_THAT(trajectory3_->last().time(), Eq(tmax));
+
+  system_->Integrate(integrator_,
+                     tmax,
+                     period_ / 32000,
+                     0,     // sampling_period
+                     true,  // tmax_is_exact
+                     {trajectory1_.get(),
+                      trajectory2_.get(),
+                      reference_probe_trajectory.get()});
+  EXPECT_THAT(
+      RelativeError(
+          reference_probe_trajectory->last().degrees_of_freedom().position() -
+              trajectory1_->last().degrees_of_freedom().position(),
+          trajectory3_->last().degrees_of_freedom().position() -
+              ephemeris.EvaluatePosition(earth_index, tmax)),
+      Lt(1E-6));
+  EXPECT_THAT(
+      RelativeError(
+          reference_probe_trajectory->last().degrees_of_freedom().velocity() -
+              trajectory1_->last().degrees_of_freedom().velocity(),
+          trajectory3_->last().degrees_of_freedom().velocity() -
+              ephemeris.EvaluateVelocity(earth_index, tmax)),
+      Lt(1E-5));
+}
+
+// The copies of an ensemble follow the same trajectories as when they are
+// integrated one by one, but the forces are only evaluated as often as for a
+// single copy.  The number of copies leaves a remainder for the scalar loop of
+// the vectorized kernels, if any.
+TEST_F(NBodySystemTest, IntegrateEnsemble) {
+  NBodySystem<EarthMoonOrbitPlane> const system(
+      NBodySystem<EarthMoonOrbitPlane>::Layout::kStructureOfArrays);
+  Length const low_orbit_radius = 1E7 * SIUnit<Length>();
+  Instant const& time = trajectory1_->last().time();
+  DegreesOfFreedom<EarthMoonOrbitPlane> const earth =
+      trajectory1_->last().degrees_of_freedom();
+  DegreesOfFreedom<EarthMoonOrbitPlane> const probe(
+      earth.position() +
+          Vector<Length, EarthMoonOrbitPlane>({low_orbit_radius,
+                                               0 * SIUnit<Length>(),
+                                               0 * SIUnit<Length>()}),
+      earth.velocity() +
+          Velocity<EarthMoonOrbitPlane>(
+              {0 * SIUnit<Speed>(),
+               Sqrt(body1_.gravitational_parameter() / low_orbit_radius),
+               0 * SIUnit<Speed>()}));
+  std::vector<RelativeDegreesOfFreedom<EarthMoonOrbitPlane>> perturbations;
+  for (int i = 0; i < 11; ++i) {
+    perturbations.emplace_back(
+        Vector<Length, EarthMoonOrbitPlane>({0 * SIUnit<Length>(),
+                                             0 * SIUnit<Length>(),
+                                             0 * SIUnit<Length>()}),
+        Velocity<EarthMoonOrbitPlane>({(i - 5) * SIUnit<Speed>(),
+                                       0 * SIUnit<Speed>(),
+                                       i * SIUnit<Speed>()}));
+  }
+
+  Ephemeris<EarthMoonOrbitPlane> ephemeris(
+      {trajectory1_.get(), trajectory2_.get()},
+      integrator_,
+      period_ / 1000,  // Δt
+      8,               // steps_per_series
+      12);             // degree
+  std::size_t earth_index = ephemeris.number_of_bodies();
+  for (std::size_t b = 0; b < ephemeris.number_of_bodies(); ++b) {
+    if (ephemeris.bodies()[b] == &body1_) {
+      earth_index = b;
+    }
+  }
+  ASSERT_THAT(earth_index, Lt(ephemeris.number_of_bodies()));
+  Instant const tmax = time + period_ / 100;
+  NBodySystem<EarthMoonOrbitPlane>::Ensemble const ensemble =
+      system.IntegrateEnsemble(integrator_,
+                               &ephemeris,
+                               earth_index,
+                               time,
+                               probe,
+                               perturbations,
+                               tmax,
+                               period_ / 32000,
+                               1,      // sampling_period
+                               true);  // tmax_is_exact
+  ASSERT_THAT(ensemble.trajectories.size(), Eq(perturbations.size()));
+  std::int64_t const ensemble_evaluations =
+      system.statistics().force_evaluations;
+
+  for (std::size_t i = 0; i < perturbations.size(); ++i) {
+    system.reset_statistics();
+    MasslessBody const copy;
+    Trajectory<EarthMoonOrbitPlane> trajectory(&copy);
+    trajectory.Append(time, probe + perturbations[i]);
+    system.IntegrateMasslessBodiesRelativeToParents(integrator_,
+                                                    &ephemeris,
+                                                    {earth_index},
+                                                    tmax,
+                                                    period_ / 32000,
+                                                    1,     // sampling_period
+                                                    true,  // tmax_is_exact
+                                                    {&trajectory});
+    EXPECT_THAT(system.statistics().force_evaluations,
+                Eq(ensemble_evaluations));
+    Trajectory<EarthMoonOrbitPlane> const& member = *ensemble.trajectories[i];
+    EXPECT_THAT(member.Times().size(), Eq(trajectory.Times().size()));
+    EXPECT_THAT(member.last().time(), Eq(tmax));
+    EXPECT_THAT(member.last().degrees_of_freedom().position(),
+                Eq(trajectory.last().degrees_of_freedom().position())) << i;
+    EXPECT_THAT(member.last().degrees_of_freedom().velocity(),
+                Eq(trajectory.last().degrees_of_freedom().velocity())) << i;
+  }
+  // The copies have diverged.
+  EXPECT_THAT((ensemble.trajectories.front()->last().degrees_of_freedom().
+                   position() -
+               ensemble.trajectories.back()->last().degrees_of_freedom().
+                   position()).Norm(),
+              Gt(1 * SIUnit<Length>()));
+}
+
+// The state transition matrices predict the effect of small perturbations of
+// the initial state, as obtained by integrating perturbed copies of the probe.
+TEST_F(NBodySystemTest, IntegrateStateTransitionMatrices) {
+  Length const low_orbit_radius = 1E7 * SIUnit<Length>();
+  Instant const time = trajectory1_->last().time();
+  DegreesOfFreedom<EarthMoonOrbitPlane> const earth =
+      trajectory1_->last().degrees_of_freedom();
+  DegreesOfFreedom<EarthMoonOrbitPlane> const probe(
+      earth.position() +
+          Vector<Length, EarthMoonOrbitPlane>({low_orbit_radius,
+                                               0 * SIUnit<Length>(),
+                                               0 * SIUnit<Length>()}),
+      earth.velocity() +
+          Velocity<EarthMoonOrbitPlane>(
+              {0 * SIUnit<Speed>(),
+               Sqrt(body1_.gravitational_parameter() / low_orbit_radius),
+               0 * SIUnit<Speed>()}));
+  trajectory3_->Append(time, probe);
+
+  Ephemeris<EarthMoonOrbitPlane> ephemeris(
+      {trajectory1_.get(), trajectory2_.get()},
+      integrator_,
+      period_ / 1000,  // Δt
+      8,               // steps_per_series
+      12);             // degree
+  std::vector<Instant> const times = {time + period_ / 200,
+                                      time + period_ / 100};
+  Time const Δt = period_ / 32000;
+  std::vector<NBodySystem<EarthMoonOrbitPlane>::StateTransitionMatrix> const
+      matrices = system_->IntegrateStateTransitionMatrices(integrator_,
+                                                           &ephemeris,
+                                                           times,
+                                                           Δt,
+                                                           trajectory3_.get());
+  ASSERT_THAT(matrices.size(), Eq(times.size()));
+  EXPECT_THAT(trajectory3_->Times(), ElementsAre(time, times[0], times[1]));
+
+  // The probe itself is integrated as by |IntegrateMasslessBodies|.
+  MasslessBody const copy;
+  Trajectory<EarthMoonOrbitPlane> unperturbed(&copy);
+  unperturbed.Append(time, probe);
+  system_->IntegrateMasslessBodies(integrator_,
+                                   &ephemeris,
+                                   times[1],
+                                   Δt,
+                                   0,     // sampling_period
+                                   true,  // tmax_is_exact
+                                   {&unperturbed});
+  EXPECT_THAT(
+      RelativeError(
+          unperturbed.last().degrees_of_freedom().position() - earth.position(),
+          trajectory3_->last().degrees_of_freedom().position() -
+              earth.position()),
+      Lt(1E-12));
+
+  std::vector<RelativeDegreesOfFreedom<EarthMoonOrbitPlane>> const
+      perturbations = {
+          {Vector<Length, EarthMoonOrbitPlane>({10 * SIUnit<Length>(),
+                                                -20 * SIUnit<Length>(),
+                                                5 * SIUnit<Length>()}),
+           Velocity<EarthMoonOrbitPlane>()},
+          {Vector<Length, EarthMoonOrbitPlane>(),
+           Velocity<EarthMoonOrbitPlane>({0.01 * SIUnit<Speed>(),
+                                          0.02 * SIUnit<Speed>(),
+                                          -0.01 * SIUnit<Speed>()})}};
+  for (auto const& perturbation : perturbations) {
+    Trajectory<EarthMoonOrbitPlane> perturbed(&copy);
+    perturbed.Append(time, probe + perturbation);
+    system_->IntegrateMasslessBodies(integrator_,
+                                     &ephemeris,
+                                     times[1],
+                                     Δt,
+                                     0,     // sampling_period
+                                     true,  // tmax_is_exact
+                                     {&perturbed});
+    RelativeDegreesOfFreedom<EarthMoonOrbitPlane> const actual =
+        perturbed.last().degrees_of_freedom() -
+        unperturbed.last().degrees_of_freedom();
+    RelativeDegreesOfFreedom<EarthMoonOrbitPlane> const predicted =
+        matrices[1](perturbation);
+    // The perturbation has grown, and is predicted to first order.
+    EXPECT_THAT(actual.displacement().Norm(),
+                Gt(perturbation.displacement().Norm()));
+    EXPECT_THAT(RelativeError(actual.displacement(), predicted.displacement()),
+                Lt(1E-4));
+    EXPECT_THAT(RelativeError(actual.velocity(), predicted.velocity()),
+                Lt(1E-4));
+  }
+}
+
 // The Moon alone.  It moves in straight line.
 TEST_F(NBodySystemTest, Moon) {
   Position<EarthMoonOrbitPlane> const reference_position =
@@ -507,5 +1589,595 @@ TEST_F(NBodySystemTest, Sputnik1ToSputnik2) {
   }
 }
 
+
+// Checks that both layouts of the state yield bitwise identical results, with
+// oblate, spherical and massless bodies.  The number of probes is chosen so
+// that the vectorized kernels used with |Layout::kStructureOfArrays|, if any,
+// leave a remainder for the scalar loop.
+TEST_F(NBodySystemTest, StructureOfArrays) {
+  std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> const interleaved =
+      IntegrateSolarSystemAndProbes(Layout::kInterleaved,
+                                    nullptr /*thread_pool*/);
+  std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> const structure_of_arrays =
+      IntegrateSolarSystemAndProbes(Layout::kStructureOfArrays,
+                                    nullptr /*thread_pool*/);
+  ASSERT_THAT(structure_of_arrays.size(), Eq(interleaved.size()));
+  for (std::size_t i = 0; i < interleaved.size(); ++i) {
+    EXPECT_THAT(structure_of_arrays[i].position(),
+                Eq(interleaved[i].position())) << i;
+    EXPECT_THAT(structure_of_arrays[i].velocity(),
+                Eq(interleaved[i].velocity())) << i;
+  }
+}
+
+// Checks that the parallel computation of the accelerations yields bitwise
+// identical results to the serial one, irrespective of the chunking.
+TEST_F(NBodySystemTest, Parallel) {
+  ThreadPool thread_pool(3);
+  ThreadPool single_thread_pool(1);
+  for (Layout const layout :
+       {Layout::kInterleaved, Layout::kStructureOfArrays}) {
+    std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> const serial =
+        IntegrateSolarSystemAndProbes(layout, nullptr /*thread_pool*/);
+    std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> const parallel =
+        IntegrateSolarSystemAndProbes(layout, &thread_pool);
+    // Three chunks of at most one cache line on a single thread.
+    std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> const chunked =
+        IntegrateSolarSystemAndProbes(layout,
+                                      &single_thread_pool,
+                                      0 /*hierarchical_tolerance*/,
+                                      false /*use_quadrupole*/,
+                                      0 /*interaction_list_tolerance*/,
+                                      nullptr /*statistics*/,
+                                      4 /*massless_chunks_per_thread*/);
+    ASSERT_THAT(parallel.size(), Eq(serial.size()));
+    ASSERT_THAT(chunked.size(), Eq(serial.size()));
+    for (std::size_t i = 0; i < serial.size(); ++i) {
+      EXPECT_THAT(parallel[i].position(), Eq(serial[i].position())) << i;
+      EXPECT_THAT(parallel[i].velocity(), Eq(serial[i].velocity())) << i;
+      EXPECT_THAT(chunked[i].position(), Eq(serial[i].position())) << i;
+      EXPECT_THAT(chunked[i].velocity(), Eq(serial[i].velocity())) << i;
+    }
+  }
+}
+
+// Checks that the accelerations of the massless bodies computed by a backend
+// yield the same results as those computed on the processor, and that the
+// processor takes over if the backend fails or doesn't support the force
+// model.  The CPU backend performs the same operations as the processor path,
+// so the results are bitwise identical unless the inverse square roots are
+// approximated; a device may differ in the last bits, hence the tolerance.
+TEST_F(NBodySystemTest, MasslessAccelerationsBackend) {
+  // A backend for a device that was lost.
+  class FailingMasslessAccelerationsBackend
+      : public MasslessAccelerationsBackend {
+   public:
+    bool ComputeAccelerations(
+        std::vector<double> const& gravitational_parameters,
+        std::vector<double> const& massive_positions,
+        std::vector<double> const& massless_positions,
+        not_null<std::vector<double>*> const accelerations) override {
+      return false;
+    }
+  };
+
+  CPUMasslessAccelerationsBackend cpu_backend;
+  FailingMasslessAccelerationsBackend failing_backend;
+  for (Layout const layout :
+       {Layout::kInterleaved, Layout::kStructureOfArrays}) {
+    NBodySystem<ICRFJ2000Ecliptic>::Statistics statistics;
+    std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> const processor =
+        IntegrateSolarSystemAndProbes(
+            layout,
+            nullptr /*thread_pool*/,
+            0 /*hierarchical_tolerance*/,
+            false /*use_quadrupole*/,
+            0 /*interaction_list_tolerance*/,
+            &statistics,
+            1 /*massless_chunks_per_thread*/,
+            SolarSystem::Accuracy::kMinorAndMajorBodies);
+    EXPECT_THAT(statistics.backend_force_evaluations, Eq(0));
+    std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> const backend =
+        IntegrateSolarSystemAndProbes(
+            layout,
+            nullptr /*thread_pool*/,
+            0 /*hierarchical_tolerance*/,
+            false /*use_quadrupole*/,
+            0 /*interaction_list_tolerance*/,
+            &statistics,
+            1 /*massless_chunks_per_thread*/,
+            SolarSystem::Accuracy::kMinorAndMajorBodies,
+            &cpu_backend);
+    EXPECT_THAT(statistics.backend_force_evaluations,
+                Eq(statistics.force_evaluations));
+    std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> const failing =
+        IntegrateSolarSystemAndProbes(
+            layout,
+            nullptr /*thread_pool*/,
+            0 /*hierarchical_tolerance*/,
+            false /*use_quadrupole*/,
+            0 /*interaction_list_tolerance*/,
+            &statistics,
+            1 /*massless_chunks_per_thread*/,
+            SolarSystem::Accuracy::kMinorAndMajorBodies,
+            &failing_backend);
+    EXPECT_THAT(statistics.backend_force_evaluations, Eq(0));
+    // The backend doesn't know about oblateness.
+    IntegrateSolarSystemAndProbes(
+        layout,
+        nullptr /*thread_pool*/,
+        0 /*hierarchical_tolerance*/,
+        false /*use_quadrupole*/,
+        0 /*interaction_list_tolerance*/,
+        &statistics,
+        1 /*massless_chunks_per_thread*/,
+        SolarSystem::Accuracy::kAllBodiesAndOblateness,
+        &cpu_backend);
+    EXPECT_THAT(statistics.backend_force_evaluations, Eq(0));
+
+    ASSERT_THAT(backend.size(), Eq(processor.size()));
+    ASSERT_THAT(failing.size(), Eq(processor.size()));
+    for (std::size_t i = 0; i < processor.size(); ++i) {
+      EXPECT_THAT(
+          RelativeError(processor[i].position() - kSolarSystemBarycentre,
+                        backend[i].position() - kSolarSystemBarycentre),
+          Lt(1E-9)) << i;
+      EXPECT_THAT(RelativeError(processor[i].velocity(), backend[i].velocity()),
+                  Lt(1E-9)) << i;
+      EXPECT_THAT(failing[i].position(), Eq(processor[i].position())) << i;
+      EXPECT_THAT(failing[i].velocity(), Eq(processor[i].velocity())) << i;
+    }
+  }
+}
+
+// Checks that the tiled kernel used for many massive bodies yields the same
+// accelerations as a direct summation, and bitwise identical results for both
+// layouts.  The bodies start at rest, far apart, so that over one short step
+// the change of velocity is the initial acceleration times the step.
+TEST_F(NBodySystemTest, ManyMassiveBodies) {
+  int const kNumberOfBodies = 150;
+  Time const Δt = 1 * Second;
+  std::vector<std::unique_ptr<MassiveBody>> bodies;
+  std::vector<Position<EarthMoonOrbitPlane>> positions;
+  for (int i = 0; i < kNumberOfBodies; ++i) {
+    bodies.emplace_back(std::make_unique<MassiveBody>(
+        (1 + i % 3) * 1E10 * SIUnit<GravitationalParameter>()));
+    positions.push_back(
+        centre_of_mass_ +
+        Vector<Length, EarthMoonOrbitPlane>(
+            {(i % 7 + 0.01 * i) * 1E9 * Metre,
+             (i / 7 % 5) * 1E9 * Metre,
+             (i / 35) * 1E9 * Metre}));
+  }
+  using EarthMoonLayout = NBodySystem<EarthMoonOrbitPlane>::Layout;
+  std::vector<Velocity<EarthMoonOrbitPlane>> velocities;
+  for (EarthMoonLayout const layout : {EarthMoonLayout::kInterleaved,
+                                       EarthMoonLayout::kStructureOfArrays}) {
+    std::vector<std::unique_ptr<Trajectory<EarthMoonOrbitPlane>>> trajectories;
+    NBodySystem<EarthMoonOrbitPlane>::Trajectories trajectory_pointers;
+    for (int i = 0; i < kNumberOfBodies; ++i) {
+      trajectories.emplace_back(
+          std::make_unique<Trajectory<EarthMoonOrbitPlane>>(bodies[i].get()));
+      trajectories.back()->Append(Instant(),
+                                  {positions[i],
+                                   Velocity<EarthMoonOrbitPlane>()});
+      trajectory_pointers.push_back(trajectories.back().get());
+    }
+    NBodySystem<EarthMoonOrbitPlane> system(layout);
+    system.Integrate(integrator_,
+                     Instant() + Δt,  // tmax
+                     Δt,
+                     0,  // sampling_period
+                     true,  // tmax_is_exact
+                     trajectory_pointers);
+    for (int i = 0; i < kNumberOfBodies; ++i) {
+      Velocity<EarthMoonOrbitPlane> const velocity =
+          trajectories[i]->last().degrees_of_freedom().velocity();
+      if (layout == EarthMoonLayout::kInterleaved) {
+        velocities.push_back(velocity);
+      } else {
+        EXPECT_THAT(velocity, Eq(velocities[i])) << i;
+      }
+    }
+  }
+  for (int i = 0; i < kNumberOfBodies; ++i) {
+    Vector<Acceleration, EarthMoonOrbitPlane> acceleration;
+    for (int j = 0; j < kNumberOfBodies; ++j) {
+      if (j != i) {
+        Displacement<EarthMoonOrbitPlane> const r = positions[j] - positions[i];
+        acceleration += bodies[j]->gravitational_parameter() * r /
+                        Pow<3>(r.Norm());
+      }
+    }
+    EXPECT_THAT(RelativeError(acceleration * Δt, velocities[i]),
+                Lt(1E-12)) << i;
+  }
+}
+
+// Checks that the hierarchical force model, which groups the systems of the
+// giant planets for the probes, doesn't affect the massive bodies and yields
+// probes close to those of the direct summation.
+TEST_F(NBodySystemTest, Hierarchical) {
+  std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> const direct =
+      IntegrateSolarSystemAndProbes(Layout::kStructureOfArrays,
+                                    nullptr /*thread_pool*/);
+  for (bool const use_quadrupole : {false, true}) {
+    std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> const hierarchical =
+        IntegrateSolarSystemAndProbes(Layout::kStructureOfArrays,
+                                      nullptr /*thread_pool*/,
+                                      1E-4 /*hierarchical_tolerance*/,
+                                      use_quadrupole);
+    ASSERT_THAT(hierarchical.size(), Eq(direct.size()));
+    for (std::size_t i = 0; i <= SolarSystem::kTethys; ++i) {
+      EXPECT_THAT(hierarchical[i].position(), Eq(direct[i].position())) << i;
+      EXPECT_THAT(hierarchical[i].velocity(), Eq(direct[i].velocity())) << i;
+    }
+    for (std::size_t i = SolarSystem::kTethys + 1; i < direct.size(); ++i) {
+      EXPECT_THAT((hierarchical[i].position() - direct[i].position()).Norm(),
+                  Lt(1 * Metre)) << i << " " << use_quadrupole;
+      EXPECT_THAT((hierarchical[i].velocity() - direct[i].velocity()).Norm(),
+                  Lt(1E-3 * Metre / Second)) << i << " " << use_quadrupole;
+    }
+  }
+}
+
+// Checks that the interaction lists, which leave out the distant planets for
+// the probes, don't affect the massive bodies, yield probes close to those of
+// the direct summation, and report an error estimate below the sum of the
+// tolerances.
+TEST_F(NBodySystemTest, InteractionLists) {
+  std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> const direct =
+      IntegrateSolarSystemAndProbes(Layout::kStructureOfArrays,
+                                    nullptr /*thread_pool*/);
+  double const tolerance = 1E-9;
+  NBodySystem<ICRFJ2000Ecliptic>::Statistics statistics;
+  std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> const with_lists =
+      IntegrateSolarSystemAndProbes(Layout::kStructureOfArrays,
+                                    nullptr /*thread_pool*/,
+                                    0 /*hierarchical_tolerance*/,
+                                    false /*use_quadrupole*/,
+                                    tolerance,
+                                    &statistics);
+  ASSERT_THAT(with_lists.size(), Eq(direct.size()));
+  for (std::size_t i = 0; i <= SolarSystem::kTethys; ++i) {
+    EXPECT_THAT(with_lists[i].position(), Eq(direct[i].position())) << i;
+    EXPECT_THAT(with_lists[i].velocity(), Eq(direct[i].velocity())) << i;
+  }
+  for (std::size_t i = SolarSystem::kTethys + 1; i < direct.size(); ++i) {
+    EXPECT_THAT((with_lists[i].position() - direct[i].position()).Norm(),
+                Lt(1 * Metre)) << i;
+    EXPECT_THAT((with_lists[i].velocity() - direct[i].velocity()).Norm(),
+                Lt(1E-3 * Metre / Second)) << i;
+  }
+  EXPECT_THAT(statistics.interaction_list_error, Gt(0));
+  EXPECT_THAT(statistics.interaction_list_error,
+              Lt((SolarSystem::kTethys + 1) * tolerance));
+}
+
+// Checks that the accelerations due to the zonal harmonics of degree 3 and 4
+// derive from the corresponding potential: the energy of a probe in a low
+// orbit around a body with exaggerated harmonics is conserved, whereas the
+// energy computed without the potential of degree 3 and 4 is not.
+TEST_F(NBodySystemTest, HigherOrderZonalHarmonics) {
+  GravitationalParameter const μ = 3.986E14 * SIUnit<GravitationalParameter>();
+  Length const radius = 6378 * Kilo(Metre);
+  double const j2 = 1E-3;
+  double const j3 = -2E-3;
+  double const j4 = 1.5E-3;
+  Vector<double, EarthMoonOrbitPlane> const axis({0.6, 0, 0.8});
+  OblateBody<EarthMoonOrbitPlane> const body(μ, {j2, j3, j4}, radius, axis);
+  EXPECT_THAT(body.zonal_degree(), Eq(4));
+  MasslessBody const probe;
+  Trajectory<EarthMoonOrbitPlane> body_trajectory(&body);
+  Trajectory<EarthMoonOrbitPlane> probe_trajectory(&probe);
+  Position<EarthMoonOrbitPlane> const origin;
+  body_trajectory.Append(Instant(), {origin, Velocity<EarthMoonOrbitPlane>()});
+  probe_trajectory.Append(
+      Instant(),
+      {origin + Vector<Length, EarthMoonOrbitPlane>(
+                    {7000 * Kilo(Metre), 0 * Metre, 1000 * Kilo(Metre)}),
+       Velocity<EarthMoonOrbitPlane>({0 * Metre / Second,
+                                      7 * Kilo(Metre) / Second,
+                                      2 * Kilo(Metre) / Second})});
+
+  // The specific energy of the probe, with or without the potential of the
+  // harmonics of degree 3 and 4.
+  auto const energy = [μ, radius, j2, j3, j4, &axis, &origin](
+      Position<EarthMoonOrbitPlane> const& position,
+      Velocity<EarthMoonOrbitPlane> const& velocity,
+      bool const with_higher_harmonics) {
+    Vector<Length, EarthMoonOrbitPlane> const r = position - origin;
+    Length const r_norm = r.Norm();
+    double const u = InnerProduct(axis, r) / r_norm;
+    double const ρ = radius / r_norm;
+    double sum = j2 * ρ * ρ * (3 * u * u - 1) / 2;
+    if (with_higher_harmonics) {
+      sum += j3 * ρ * ρ * ρ * (5 * u * u * u - 3 * u) / 2 +
+             j4 * ρ * ρ * ρ * ρ * (35 * u * u * u * u - 30 * u * u + 3) / 8;
+    }
+    return InnerProduct(velocity, velocity) / 2 - μ / r_norm * (1 - sum);
+  };
+
+  system_->Integrate(integrator_,
+                     Instant() + 100 * Minute,
+                     1 * Second,
+                     10,     // sampling_period
+                     false,  // tmax_is_exact
+                     {&body_trajectory, &probe_trajectory});
+  std::map<Instant, Position<EarthMoonOrbitPlane>> const positions =
+      probe_trajectory.Positions();
+  std::map<Instant, Velocity<EarthMoonOrbitPlane>> const velocities =
+      probe_trajectory.Velocities();
+  ASSERT_THAT(positions.size(), Ge(600));
+  SpecificEnergy const initial_energy =
+      energy(positions.begin()->second, velocities.begin()->second, true);
+  SpecificEnergy const initial_energy_without_higher_harmonics =
+      energy(positions.begin()->second, velocities.begin()->second, false);
+  double max_error = 0;
+  double max_error_without_higher_harmonics = 0;
+  for (auto const& time_position : positions) {
+    Velocity<EarthMoonOrbitPlane> const& velocity =
+        velocities.at(time_position.first);
+    max_error = std::max(
+        max_error,
+        RelativeError(initial_energy,
+                      energy(time_position.second, velocity, true)));
+    max_error_without_higher_harmonics = std::max(
+        max_error_without_higher_harmonics,
+        RelativeError(initial_energy_without_higher_harmonics,
+                      energy(time_position.second, velocity, false)));
+  }
+  EXPECT_THAT(max_error, Lt(1E-10));
+  EXPECT_THAT(max_error_without_higher_harmonics, Gt(1E-6));
+}
+
+// With an oblateness accuracy of 1E-6, the J2 term of this body is ignored
+// beyond about 55 radii.  A probe close to the body is integrated as without
+// the cutoff, and a probe far from the body as if the body were spherical.
+TEST_F(NBodySystemTest, OblatenessCutoff) {
+  GravitationalParameter const μ = 3.986E14 * SIUnit<GravitationalParameter>();
+  Length const radius = 6378 * Kilo(Metre);
+  OblateBody<EarthMoonOrbitPlane> const oblate_body(
+      μ, 1E-3, radius, Vector<double, EarthMoonOrbitPlane>({0, 0, 1}));
+  MassiveBody const spherical_body(μ);
+  MasslessBody const near_probe;
+  MasslessBody const far_probe;
+  Position<EarthMoonOrbitPlane> const origin;
+
+  // Returns the final positions of the near and far probes.
+  auto const integrate = [this, &near_probe, &far_probe, &origin](
+      MassiveBody const& body, double const oblateness_accuracy) {
+    Trajectory<EarthMoonOrbitPlane> body_trajectory(&body);
+    Trajectory<EarthMoonOrbitPlane> near_probe_trajectory(&near_probe);
+    Trajectory<EarthMoonOrbitPlane> far_probe_trajectory(&far_probe);
+    body_trajectory.Append(Instant(),
+                           {origin, Velocity<EarthMoonOrbitPlane>()});
+    near_probe_trajectory.Append(
+        Instant(),
+        {origin + Vector<Length, EarthMoonOrbitPlane>(
+                      {7000 * Kilo(Metre), 0 * Metre, 1000 * Kilo(Metre)}),
+         Velocity<EarthMoonOrbitPlane>({0 * Metre / Second,
+                                        7 * Kilo(Metre) / Second,
+                                        2 * Kilo(Metre) / Second})});
+    far_probe_trajectory.Append(
+        Instant(),
+        {origin + Vector<Length, EarthMoonOrbitPlane>(
+                      {1E6 * Kilo(Metre), 0 * Metre, 1E5 * Kilo(Metre)}),
+         Velocity<EarthMoonOrbitPlane>({0 * Metre / Second,
+                                        600 * Metre / Second,
+                                        100 * Metre / Second})});
+    system_->set_oblateness_accuracy(oblateness_accuracy);
+    system_->Integrate(integrator_,
+                       Instant() + 100 * Minute,
+                       1 * Second,
+                       10,     // sampling_period
+                       false,  // tmax_is_exact
+                       {&body_trajectory,
+                        &near_probe_trajectory,
+                        &far_probe_trajectory});
+    return std::make_pair(
+        near_probe_trajectory.last().degrees_of_freedom().position(),
+        far_probe_trajectory.last().degrees_of_freedom().position());
+  };
+
+  auto const exact = integrate(oblate_body, 0);
+  auto const cutoff = integrate(oblate_body, 1E-6);
+  auto const spherical = integrate(spherical_body, 0);
+  EXPECT_EQ(exact.first, cutoff.first);
+  EXPECT_NE(exact.second, cutoff.second);
+  EXPECT_EQ(spherical.second, cutoff.second);
+  EXPECT_THAT((exact.second - cutoff.second).Norm(), Lt(1 * Metre));
+}
+
+// The drifts of the Wisdom-Holman integrator solve the two-body problem
+// exactly, whatever the step.
+TEST_F(NBodySystemTest, WisdomHolmanTwoBodies) {
+  WisdomHolmanIntegrator<Length, Speed> integrator;
+  integrator.Initialize(integrator_.CoefficientsOf(SPRKScheme::kLeapfrog));
+  Displacement<EarthMoonOrbitPlane> const initial_displacement =
+      trajectory2_->last().degrees_of_freedom().position() -
+      trajectory1_->last().degrees_of_freedom().position();
+  system_->IntegrateWisdomHolman(integrator,
+                                 {{&body2_, &body1_}},  // parents
+                                 trajectory1_->last().time() + period_,
+                                 period_ / 3,
+                                 1,     // sampling_period
+                                 true,  // tmax_is_exact
+                                 {trajectory1_.get(), trajectory2_.get()});
+  EXPECT_THAT(trajectory1_->Positions().size(), Eq(4));
+  EXPECT_THAT(
+      RelativeError(initial_displacement,
+                    trajectory2_->last().degrees_of_freedom().position() -
+                        trajectory1_->last().degrees_of_freedom().position()),
+      Lt(1E-12));
+  EXPECT_THAT(
+      (geometry::Barycentre<Vector<Length, EarthMoonOrbitPlane>, Mass>(
+           {trajectory1_->last().degrees_of_freedom().position(),
+            trajectory2_->last().degrees_of_freedom().position()},
+           {body1_.mass(), body2_.mass()}) - centre_of_mass_).Norm(),
+      Lt(1E-3 * Metre));
+}
+
+// With the hierarchy of the solar system, the Wisdom-Holman integrator is much
+// more accurate than the splitting in kinetic and potential energies with the
+// same scheme and step.  The recording overload gives the same results.
+TEST_F(NBodySystemTest, WisdomHolmanSolarSystem) {
+  auto const make_solar_system = []() {
+    return SolarSystem::AtСпутник1Launch(
+        SolarSystem::Accuracy::kMajorBodiesOnly);
+  };
+  not_null<std::unique_ptr<SolarSystem>> const reference = make_solar_system();
+  not_null<std::unique_ptr<SolarSystem>> const wisdom_holman =
+      make_solar_system();
+  not_null<std::unique_ptr<SolarSystem>> const recorded = make_solar_system();
+  not_null<std::unique_ptr<SolarSystem>> const leapfrog = make_solar_system();
+  NBodySystem<ICRFJ2000Ecliptic>::Trajectories const trajectories =
+      wisdom_holman->trajectories();
+  std::map<MassiveBody const*, MassiveBody const*> parents;
+  for (std::size_t i = SolarSystem::kSun + 1; i < trajectories.size(); ++i) {
+    parents.emplace(
+        trajectories[i]->body<MassiveBody>(),
+        trajectories[SolarSystem::parent(i)]->body<MassiveBody>());
+  }
+  Instant const tmax =
+      trajectories[SolarSystem::kEarth]->last().time() + 100 * Day;
+  Time const Δt = 12 * 60 * Minute;
+
+  NBodySystem<ICRFJ2000Ecliptic> system;
+  system.Integrate(integrator_,
+                   tmax,
+                   10 * Minute,
+                   0,     // sampling_period
+                   true,  // tmax_is_exact
+                   reference->trajectories());
+  WisdomHolmanIntegrator<Length, Speed> integrator;
+  integrator.Initialize(integrator_.CoefficientsOf(SPRKScheme::kLeapfrog));
+  system.IntegrateWisdomHolman(integrator,
+                               parents,
+                               tmax,
+                               Δt,
+                               0,     // sampling_period
+                               true,  // tmax_is_exact
+                               trajectories);
+  std::map<MassiveBody const*, MassiveBody const*> recorded_parents;
+  for (std::size_t i = SolarSystem::kSun + 1; i < trajectories.size(); ++i) {
+    recorded_parents.emplace(
+        recorded->trajectories()[i]->body<MassiveBody>(),
+        recorded->trajectories()[SolarSystem::parent(i)]->body<MassiveBody>());
+  }
+  NBodySystem<ICRFJ2000Ecliptic>::MassiveBodiesSteps massive_steps;
+  system.IntegrateWisdomHolman(integrator,
+                               recorded_parents,
+                               tmax,
+                               Δt,
+                               0,     // sampling_period
+                               true,  // tmax_is_exact
+                               recorded->trajectories(),
+                               &massive_steps);
+  SPRKIntegrator<Length, Speed> leapfrog_integrator;
+  leapfrog_integrator.Initialize(
+      leapfrog_integrator.CoefficientsOf(SPRKScheme::kLeapfrog));
+  system.Integrate(leapfrog_integrator,
+                   tmax,
+                   Δt,
+                   0,     // sampling_period
+                   true,  // tmax_is_exact
+                   leapfrog->trajectories());
+
+  auto const moon_from_earth = [](SolarSystem const& solar_system) {
+    return solar_system.trajectories()[SolarSystem::kMoon]
+               ->last().degrees_of_freedom().position() -
+           solar_system.trajectories()[SolarSystem::kEarth]
+               ->last().degrees_of_freedom().position();
+  };
+  double const wisdom_holman_error =
+      RelativeError(moon_from_earth(*reference),
+                    moon_from_earth(*wisdom_holman));
+  double const leapfrog_error =
+      RelativeError(moon_from_earth(*reference), moon_from_earth(*leapfrog));
+  EXPECT_THAT(wisdom_holman_error, Lt(1E-4));
+  EXPECT_THAT(leapfrog_error, Gt(1000 * wisdom_holman_error));
+  for (std::size_t i = 0; i < trajectories.size(); ++i) {
+    EXPECT_THAT(
+        recorded->trajectories()[i]->last().degrees_of_freedom(),
+        Eq(trajectories[i]->last().degrees_of_freedom())) << i;
+  }
+}
+
+// The force gradient integrator evaluates the accelerations 4 times per step,
+// 3 of which with the gravity gradient, and is of order 6.  The layouts yield
+// bitwise identical results.
+TEST_F(NBodySystemTest, ForceGradientSolarSystem) {
+  auto const make_solar_system = []() {
+    return SolarSystem::AtСпутник1Launch(
+        SolarSystem::Accuracy::kMajorBodiesOnly);
+  };
+  not_null<std::unique_ptr<SolarSystem>> const reference = make_solar_system();
+  Instant const tmax =
+      reference->trajectories()[SolarSystem::kEarth]->last().time() + 30 * Day;
+  NBodySystem<ICRFJ2000Ecliptic> system;
+  system.Integrate(integrator_,
+                   tmax,
+                   10 * Minute,
+                   0,     // sampling_period
+                   true,  // tmax_is_exact
+                   reference->trajectories());
+
+  auto const moon_from_earth = [](SolarSystem const& solar_system) {
+    return solar_system.trajectories()[SolarSystem::kMoon]
+               ->last().degrees_of_freedom().position() -
+           solar_system.trajectories()[SolarSystem::kEarth]
+               ->last().degrees_of_freedom().position();
+  };
+  ForceGradientIntegrator<Length, Speed> integrator;
+  integrator.Initialize(ForceGradientScheme::kOrder6);
+  auto const force_gradient_error =
+      [&integrator, &make_solar_system, &moon_from_earth, &reference, tmax](
+          Layout const layout,
+          Time const& Δt,
+          not_null<NBodySystem<ICRFJ2000Ecliptic>::Statistics*> const
+              statistics,
+          not_null<std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>>*> const
+              final_states) {
+    not_null<std::unique_ptr<SolarSystem>> const solar_system =
+        make_solar_system();
+    NBodySystem<ICRFJ2000Ecliptic> system(layout);
+    system.Integrate(integrator,
+                     tmax,
+                     Δt,
+                     0,     // sampling_period
+                     true,  // tmax_is_exact
+                     solar_system->trajectories());
+    *statistics = system.statistics();
+    final_states->clear();
+    for (auto const& trajectory : solar_system->trajectories()) {
+      final_states->push_back(trajectory->last().degrees_of_freedom());
+    }
+    return RelativeError(moon_from_earth(*reference),
+                         moon_from_earth(*solar_system));
+  };
+
+  NBodySystem<ICRFJ2000Ecliptic>::Statistics statistics;
+  std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> interleaved;
+  double const error1 = force_gradient_error(
+      Layout::kInterleaved, 6 * 60 * Minute, &statistics, &interleaved);
+  EXPECT_THAT(statistics.force_evaluations, Eq(1 + 4 * 4 * 30));
+  EXPECT_THAT(statistics.gradient_evaluations, Eq(3 * 4 * 30));
+  std::vector<DegreesOfFreedom<ICRFJ2000Ecliptic>> structure_of_arrays;
+  double const soa_error1 = force_gradient_error(Layout::kStructureOfArrays,
+                                                 6 * 60 * Minute,
+                                                 &statistics,
+                                                 &structure_of_arrays);
+  EXPECT_THAT(soa_error1, Eq(error1));
+  ASSERT_THAT(structure_of_arrays.size(), Eq(interleaved.size()));
+  for (std::size_t i = 0; i < interleaved.size(); ++i) {
+    EXPECT_THAT(structure_of_arrays[i], Eq(interleaved[i])) << i;
+  }
+  double const error2 = force_gradient_error(
+      Layout::kInterleaved, 3 * 60 * Minute, &statistics, &interleaved);
+  LOG(INFO) << "Force gradient errors " << error1 << " " << error2;
+  EXPECT_THAT(error1 / error2, Gt(40));
+}
+
 }  // namespace physics
 }  // namespace principia
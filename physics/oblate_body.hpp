@@ -42,11 +42,41 @@ class OblateBody : public MassiveBody {
   OblateBody(Mass const& mass,
              Order2ZonalCoefficient const& j2,
              Vector<double, Frame> const& axis);
+  // A body whose geopotential is truncated to the zonal harmonics of degree at
+  // most n.  |zonal_harmonics| holds the dimensionless coefficients J2, ..., Jn
+  // relative to |reference_radius|.  n must be at least 2 and at most
+  // |kMaxZonalDegree|.
+  OblateBody(GravitationalParameter const& gravitational_parameter,
+             std::vector<double> const& zonal_harmonics,
+             Length const& reference_radius,
+             Vector<double, Frame> const& axis);
+  // Same as above, with the coefficient of degree 2 given by |j2| and the
+  // dimensionless coefficients J3, ..., Jn given by |higher_zonal_harmonics|.
+  OblateBody(GravitationalParameter const& gravitational_parameter,
+             Order2ZonalCoefficient const& j2,
+             std::vector<double> const& higher_zonal_harmonics,
+             Length const& reference_radius,
+             Vector<double, Frame> const& axis);
   ~OblateBody() = default;
 
+  // The maximum degree of the zonal harmonics.
+  static int const kMaxZonalDegree = 8;
+
   // Returns the j2 coefficient.
   Order2ZonalCoefficient const& j2() const;
 
+  // Returns the degree of the highest zonal harmonic, 2 if the body only has
+  // a |j2| coefficient.
+  int zonal_degree() const;
+
+  // Returns the dimensionless coefficients J3, ..., Jn, where n is
+  // |zonal_degree()|.  Empty if the body only has a |j2| coefficient.
+  std::vector<double> const& higher_zonal_harmonics() const;
+
+  // Returns the radius relative to which the |higher_zonal_harmonics()| are
+  // normalized.  Zero if the body only has a |j2| coefficient.
+  Length const& reference_radius() const;
+
   // Returns the axis passed at construction.
   Vector<double, Frame> const& axis() const;
 
@@ -71,6 +101,8 @@ class OblateBody : public MassiveBody {
 
  private:
   Order2ZonalCoefficient const j2_;
+  std::vector<double> const higher_zonal_harmonics_;
+  Length const reference_radius_;
   Vector<double, Frame> const axis_;
 };
 
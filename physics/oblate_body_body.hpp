@@ -11,6 +11,9 @@ double const kNormLow = 0.999;
 double const kNormHigh = 1.001;
 }  // namespace
 
+template<typename Frame>
+int const OblateBody<Frame>::kMaxZonalDegree;
+
 template<typename Frame>
 OblateBody<Frame>::OblateBody(
     GravitationalParameter const& gravitational_parameter,
@@ -36,8 +39,21 @@ OblateBody<Frame>::OblateBody(
     GravitationalParameter const& gravitational_parameter,
     Order2ZonalCoefficient const& j2,
     Vector<double, Frame> const& axis)
-    : MassiveBody(gravitational_parameter),
+    : OblateBody(gravitational_parameter,
+                 j2,
+                 std::vector<double>(),
+                 Length(),
+                 axis) {}
+
+template<typename Frame>
+OblateBody<Frame>::OblateBody(
+    Mass const& mass,
+    Order2ZonalCoefficient const& j2,
+    Vector<double, Frame> const& axis)
+    : MassiveBody(mass),
       j2_(j2),
+      higher_zonal_harmonics_(),
+      reference_radius_(),
       axis_(axis) {
   CHECK_NE(j2, Order2ZonalCoefficient()) << "Oblate cannot have zero j2";
   CHECK_GT(axis.Norm(), kNormLow) << "Axis must have norm one";
@@ -46,15 +62,37 @@ OblateBody<Frame>::OblateBody(
 
 template<typename Frame>
 OblateBody<Frame>::OblateBody(
-    Mass const& mass,
+    GravitationalParameter const& gravitational_parameter,
+    std::vector<double> const& zonal_harmonics,
+    Length const& reference_radius,
+    Vector<double, Frame> const& axis)
+    : OblateBody(gravitational_parameter,
+                 -zonal_harmonics.at(0) * gravitational_parameter *
+                     reference_radius * reference_radius,
+                 std::vector<double>(zonal_harmonics.begin() + 1,
+                                     zonal_harmonics.end()),
+                 reference_radius,
+                 axis) {}
+
+template<typename Frame>
+OblateBody<Frame>::OblateBody(
+    GravitationalParameter const& gravitational_parameter,
     Order2ZonalCoefficient const& j2,
+    std::vector<double> const& higher_zonal_harmonics,
+    Length const& reference_radius,
     Vector<double, Frame> const& axis)
-    : MassiveBody(mass),
+    : MassiveBody(gravitational_parameter),
       j2_(j2),
+      higher_zonal_harmonics_(higher_zonal_harmonics),
+      reference_radius_(reference_radius),
       axis_(axis) {
   CHECK_NE(j2, Order2ZonalCoefficient()) << "Oblate cannot have zero j2";
   CHECK_GT(axis.Norm(), kNormLow) << "Axis must have norm one";
   CHECK_LT(axis.Norm(), kNormHigh) << "Axis must have norm one";
+  CHECK_LE(zonal_degree(), kMaxZonalDegree) << "Too many zonal harmonics";
+  if (!higher_zonal_harmonics.empty()) {
+    CHECK_LT(Length(), reference_radius) << "Reference radius must be positive";
+  }
 }
 
 template<typename Frame>
@@ -62,6 +100,21 @@ Order2ZonalCoefficient const& OblateBody<Frame>::j2() const {
   return j2_;
 }
 
+template<typename Frame>
+int OblateBody<Frame>::zonal_degree() const {
+  return 2 + static_cast<int>(higher_zonal_harmonics_.size());
+}
+
+template<typename Frame>
+std::vector<double> const& OblateBody<Frame>::higher_zonal_harmonics() const {
+  return higher_zonal_harmonics_;
+}
+
+template<typename Frame>
+Length const& OblateBody<Frame>::reference_radius() const {
+  return reference_radius_;
+}
+
 template<typename Frame>
 Vector<double, Frame> const& OblateBody<Frame>::axis() const {
   return axis_;
@@ -92,6 +145,12 @@ inline void OblateBody<Frame>::WriteToMessage(
   Frame::WriteToMessage(oblate_body->mutable_frame());
   j2_.WriteToMessage(oblate_body->mutable_j2());
   axis_.WriteToMessage(oblate_body->mutable_axis());
+  if (!higher_zonal_harmonics_.empty()) {
+    for (double const jn : higher_zonal_harmonics_) {
+      oblate_body->add_higher_zonal_harmonics(jn);
+    }
+    reference_radius_.WriteToMessage(oblate_body->mutable_reference_radius());
+  }
 }
 
 
@@ -108,11 +167,18 @@ not_null<std::unique_ptr<OblateBody<Frame>>> OblateBody<Frame>::ReadFromMessage(
   CHECK(message.HasExtension(serialization::OblateBody::oblate_body));
   serialization::OblateBody const& oblateness_information =
       message.GetExtension(serialization::OblateBody::oblate_body);
+  std::vector<double> const higher_zonal_harmonics(
+      oblateness_information.higher_zonal_harmonics().begin(),
+      oblateness_information.higher_zonal_harmonics().end());
   return std::make_unique<OblateBody<Frame>>(
       GravitationalParameter::ReadFromMessage(
           message.gravitational_parameter()),
       Order2ZonalCoefficient::ReadFromMessage(
           oblateness_information.j2()),
+      higher_zonal_harmonics,
+      oblateness_information.has_reference_radius()
+          ? Length::ReadFromMessage(oblateness_information.reference_radius())
+          : Length(),
       Vector<double, Frame>::ReadFromMessage(
           oblateness_information.axis()));
 }
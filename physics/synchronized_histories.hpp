@@ -0,0 +1,178 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "base/not_null.hpp"
+#include "geometry/named_quantities.hpp"
+#include "geometry/r3_element.hpp"
+#include "physics/degrees_of_freedom.hpp"
+#include "quantities/quantities.hpp"
+
+using principia::base::not_null;
+using principia::geometry::Instant;
+using principia::geometry::R3Element;
+using principia::quantities::Length;
+using principia::quantities::Speed;
+
+namespace principia {
+namespace physics {
+
+// The histories of several bodies sampled at the same times, e.g., by an
+// integration with a constant step.  Instead of one timeline per body, they
+// share a single time axis, and for each time of the axis the degrees of
+// freedom of all the bodies are stored contiguously, as a row.  This saves one
+// |Instant| per point per body, and appending a step is a single contiguous
+// write.  The bodies are identified by their index in [0, number_of_bodies[.
+// The rows are stored in chunks of |kRowsPerChunk| rows, so that appending
+// never moves them and forgetting at either end releases whole chunks.
+// Optionally, the complete chunks are packed, see |set_packing|.
+template<typename Frame>
+class SynchronizedHistories {
+ public:
+  // The error bounds of the packing of the complete chunks.  Both must be
+  // positive.
+  struct Packing {
+    Length position_tolerance;
+    Speed velocity_tolerance;
+  };
+
+  explicit SynchronizedHistories(int const number_of_bodies);
+
+  SynchronizedHistories(SynchronizedHistories const&) = delete;
+  SynchronizedHistories& operator=(SynchronizedHistories const&) = delete;
+
+  int number_of_bodies() const;
+
+  // The number of times of the axis.
+  bool empty() const;
+  std::size_t size() const;
+
+  // The time of index |index| of the axis, which must be less than |size()|.
+  Instant const& time(std::size_t const index) const;
+  // The axis must not be empty.
+  Instant const& first_time() const;
+  Instant const& last_time() const;
+
+  // The degrees of freedom of |body| at the time of index |index|.  If that
+  // row is packed they are decoded.
+  DegreesOfFreedom<Frame> degrees_of_freedom(std::size_t const index,
+                                             int const body) const;
+
+  // Appends |time|, which must be after |last_time()|, to the axis, and the
+  // row of the degrees of freedom at that time, those of body |b| being
+  // |row(b)|.  The row is constructed in place.
+  template<typename RowFunction>
+  void Append(Instant const& time, RowFunction const& row);
+
+  // Returns the index of the first time of the axis at or after |time|, or
+  // |size()| if there is none.  Complexity is O(Ln(|size()|)).
+  std::size_t LowerBound(Instant const& time) const;
+
+  // Returns the degrees of freedom of |body| at |time|, which must be between
+  // the first and the last times of the axis, by cubic Hermite interpolation
+  // as |Trajectory::EvaluateDegreesOfFreedom|.
+  DegreesOfFreedom<Frame> EvaluateDegreesOfFreedom(Instant const& time,
+                                                   int const body) const;
+
+  // Removes the times (strictly) greater than |time| and their rows.
+  void ForgetAfter(Instant const& time);
+  // Removes the times less than or equal to |time| and their rows.
+  void ForgetBefore(Instant const& time);
+
+  // From now on, each chunk is packed when it becomes complete: the degrees of
+  // freedom of its first row are kept as anchors, one per body, and those of
+  // the other rows are stored as offsets from the anchor of their body, in
+  // multiples of the tolerances, as 32-bit integers.  The norm of the error of
+  // a packed position (resp. velocity) is at most |position_tolerance| (resp.
+  // |velocity_tolerance|); a chunk whose offsets don't fit in 32 bits is left
+  // as is.  A packed row takes half the memory of a row of |DegreesOfFreedom|.
+  // The times are not packed.  If |ForgetAfter| reopens a packed chunk, its
+  // remaining rows are unpacked, keeping their errors.  The chunks that are
+  // already complete are packed by this call.  It is an error to call this
+  // function for histories that are already packed.
+  void set_packing(Packing const& packing);
+
+  // The number of rows in packed chunks, including the forgotten rows whose
+  // chunk has not been released yet.
+  std::size_t packed_size() const;
+
+  // Returns an estimate of the memory used by the chunks, in bytes, excluding
+  // this object.
+  std::int64_t MemoryUsage() const;
+
+ private:
+  // The degrees of freedom of a packed row, in multiples of the tolerances,
+  // relative to the anchor of the body.
+  struct PackedDegreesOfFreedom {
+    std::array<std::int32_t, 3> position;
+    std::array<std::int32_t, 3> velocity;
+  };
+
+  struct Chunk {
+    bool packed() const;
+
+    // The capacities are reserved at construction.
+    std::vector<Instant> times;
+    // Empty if the chunk is packed.
+    std::vector<DegreesOfFreedom<Frame>> rows;
+    // Empty unless the chunk is packed.  The anchors are the degrees of
+    // freedom of the first row, one per body.
+    std::vector<DegreesOfFreedom<Frame>> anchors;
+    std::vector<PackedDegreesOfFreedom> packed_rows;
+  };
+
+  // Packs |*chunk|, which must be complete and not packed, unless its offsets
+  // don't fit in 32 bits.
+  void Pack(not_null<Chunk*> const chunk) const;
+  // Sets |*quantized| to the integers nearest to the coordinates of |offset|,
+  // which are in multiples of a tolerance.  Returns false if they don't fit in
+  // 32 bits.
+  static bool Quantize(R3Element<double> const& offset,
+                       not_null<std::array<std::int32_t, 3>*> const quantized);
+  // Unpacks |*chunk|, which must be packed.
+  void Unpack(not_null<Chunk*> const chunk) const;
+  // Returns the degrees of freedom of |body| in row |index_in_chunk| of
+  // |chunk|, which must be packed.
+  DegreesOfFreedom<Frame> Decode(Chunk const& chunk,
+                                 std::size_t const index_in_chunk,
+                                 int const body) const;
+
+  // Returns the chunk and the index in that chunk of the time of index
+  // |index| of the axis.
+  Chunk const& ChunkOf(std::size_t const index,
+                       not_null<std::size_t*> const index_in_chunk) const;
+
+  // Returns the index of the first time of the axis at or after |time|, or
+  // strictly after |time| if |strictly_after| is true; |size()| if there is
+  // none.
+  std::size_t Search(Instant const& time, bool const strictly_after) const;
+
+  // The cubic Hermite interpolation at |time| between |left| and |right|, as
+  // in |Trajectory|.
+  static DegreesOfFreedom<Frame> Interpolate(
+      Instant const& left_time,
+      DegreesOfFreedom<Frame> const& left,
+      Instant const& right_time,
+      DegreesOfFreedom<Frame> const& right,
+      Instant const& time);
+
+  static std::size_t const kRowsPerChunk = 1024;
+
+  int const number_of_bodies_;
+  // All the chunks are full except the last one.
+  std::vector<Chunk> chunks_;
+  // The rows of the first chunk before this index have been forgotten.
+  std::size_t begin_ = 0;
+  std::size_t size_ = 0;
+  // Null if the chunks are not packed.
+  std::unique_ptr<Packing> packing_;
+};
+
+}  // namespace physics
+}  // namespace principia
+
+#include "physics/synchronized_histories_body.hpp"
@@ -0,0 +1,368 @@
+﻿#pragma once
+
+#include "physics/synchronized_histories.hpp"
+
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "base/memory_usage.hpp"
+#include "geometry/grassmann.hpp"
+#include "glog/logging.h"
+#include "quantities/quantities.hpp"
+
+using principia::base::VectorMemoryUsage;
+using principia::geometry::Displacement;
+using principia::geometry::Position;
+using principia::geometry::Vector;
+using principia::geometry::Velocity;
+using principia::quantities::Length;
+using principia::quantities::Time;
+
+namespace principia {
+namespace physics {
+
+template<typename Frame>
+SynchronizedHistories<Frame>::SynchronizedHistories(
+    int const number_of_bodies)
+    : number_of_bodies_(number_of_bodies) {
+  CHECK_LT(0, number_of_bodies_);
+}
+
+template<typename Frame>
+int SynchronizedHistories<Frame>::number_of_bodies() const {
+  return number_of_bodies_;
+}
+
+template<typename Frame>
+bool SynchronizedHistories<Frame>::empty() const {
+  return size_ == 0;
+}
+
+template<typename Frame>
+std::size_t SynchronizedHistories<Frame>::size() const {
+  return size_;
+}
+
+template<typename Frame>
+Instant const& SynchronizedHistories<Frame>::time(
+    std::size_t const index) const {
+  std::size_t index_in_chunk;
+  Chunk const& chunk = ChunkOf(index, &index_in_chunk);
+  return chunk.times[index_in_chunk];
+}
+
+template<typename Frame>
+Instant const& SynchronizedHistories<Frame>::first_time() const {
+  CHECK(!empty());
+  return chunks_.front().times[begin_];
+}
+
+template<typename Frame>
+Instant const& SynchronizedHistories<Frame>::last_time() const {
+  CHECK(!empty());
+  return chunks_.back().times.back();
+}
+
+template<typename Frame>
+DegreesOfFreedom<Frame> SynchronizedHistories<Frame>::degrees_of_freedom(
+    std::size_t const index,
+    int const body) const {
+  DCHECK_LE(0, body);
+  DCHECK_LT(body, number_of_bodies_);
+  std::size_t index_in_chunk;
+  Chunk const& chunk = ChunkOf(index, &index_in_chunk);
+  if (chunk.packed()) {
+    return Decode(chunk, index_in_chunk, body);
+  }
+  return chunk.rows[index_in_chunk * number_of_bodies_ + body];
+}
+
+template<typename Frame>
+template<typename RowFunction>
+void SynchronizedHistories<Frame>::Append(Instant const& time,
+                                          RowFunction const& row) {
+  CHECK(empty() || last_time() < time)
+      << "Append at " << time << " not after " << last_time();
+  if (chunks_.empty() || chunks_.back().times.size() == kRowsPerChunk) {
+    chunks_.emplace_back();
+    chunks_.back().times.reserve(kRowsPerChunk);
+    chunks_.back().rows.reserve(kRowsPerChunk * number_of_bodies_);
+  }
+  Chunk& chunk = chunks_.back();
+  chunk.times.push_back(time);
+  for (int b = 0; b < number_of_bodies_; ++b) {
+    chunk.rows.push_back(row(b));
+  }
+  ++size_;
+  if (packing_ != nullptr && chunk.times.size() == kRowsPerChunk) {
+    Pack(&chunk);
+  }
+}
+
+template<typename Frame>
+std::size_t SynchronizedHistories<Frame>::LowerBound(
+    Instant const& time) const {
+  return Search(time, false /*strictly_after*/);
+}
+
+template<typename Frame>
+DegreesOfFreedom<Frame> SynchronizedHistories<Frame>::EvaluateDegreesOfFreedom(
+    Instant const& time,
+    int const body) const {
+  std::size_t const index = LowerBound(time);
+  CHECK_LT(index, size_) << "Evaluation at " << time << " after "
+                         << last_time();
+  if (this->time(index) == time) {
+    return degrees_of_freedom(index, body);
+  }
+  CHECK_LT(0, index) << "Evaluation at " << time << " before "
+                     << first_time();
+  return Interpolate(this->time(index - 1),
+                     degrees_of_freedom(index - 1, body),
+                     this->time(index),
+                     degrees_of_freedom(index, body),
+                     time);
+}
+
+template<typename Frame>
+void SynchronizedHistories<Frame>::ForgetAfter(Instant const& time) {
+  // The number of rows that are kept.
+  std::size_t const kept = Search(time, true /*strictly_after*/);
+  if (kept == size_) {
+    return;
+  }
+  if (kept == 0) {
+    chunks_.clear();
+    begin_ = 0;
+    size_ = 0;
+    return;
+  }
+  std::size_t const position = begin_ + kept;
+  std::size_t const chunk_index = position / kRowsPerChunk;
+  std::size_t const index_in_chunk = position % kRowsPerChunk;
+  if (index_in_chunk == 0) {
+    chunks_.erase(chunks_.begin() + chunk_index, chunks_.end());
+  } else {
+    Chunk& chunk = chunks_[chunk_index];
+    if (chunk.packed()) {
+      Unpack(&chunk);
+    }
+    chunk.times.erase(chunk.times.begin() + index_in_chunk, chunk.times.end());
+    chunk.rows.erase(
+        chunk.rows.begin() + index_in_chunk * number_of_bodies_,
+        chunk.rows.end());
+    chunks_.erase(chunks_.begin() + chunk_index + 1, chunks_.end());
+  }
+  size_ = kept;
+}
+
+template<typename Frame>
+void SynchronizedHistories<Frame>::ForgetBefore(Instant const& time) {
+  // The number of rows that are forgotten.
+  std::size_t const forgotten = Search(time, true /*strictly_after*/);
+  if (forgotten == size_) {
+    chunks_.clear();
+    begin_ = 0;
+    size_ = 0;
+    return;
+  }
+  std::size_t const position = begin_ + forgotten;
+  chunks_.erase(chunks_.begin(),
+                chunks_.begin() + position / kRowsPerChunk);
+  begin_ = position % kRowsPerChunk;
+  size_ -= forgotten;
+}
+
+template<typename Frame>
+void SynchronizedHistories<Frame>::set_packing(Packing const& packing) {
+  CHECK(packing_ == nullptr) << "Already packed";
+  CHECK_LT(Length(), packing.position_tolerance);
+  CHECK_LT(Speed(), packing.velocity_tolerance);
+  packing_ = std::make_unique<Packing>(packing);
+  for (Chunk& chunk : chunks_) {
+    if (chunk.times.size() == kRowsPerChunk) {
+      Pack(&chunk);
+    }
+  }
+}
+
+template<typename Frame>
+std::size_t SynchronizedHistories<Frame>::packed_size() const {
+  std::size_t packed_size = 0;
+  for (Chunk const& chunk : chunks_) {
+    if (chunk.packed()) {
+      packed_size += chunk.times.size();
+    }
+  }
+  return packed_size;
+}
+
+template<typename Frame>
+std::int64_t SynchronizedHistories<Frame>::MemoryUsage() const {
+  std::int64_t usage = VectorMemoryUsage(chunks_);
+  for (Chunk const& chunk : chunks_) {
+    usage += VectorMemoryUsage(chunk.times) + VectorMemoryUsage(chunk.rows) +
+             VectorMemoryUsage(chunk.anchors) +
+             VectorMemoryUsage(chunk.packed_rows);
+  }
+  return usage;
+}
+
+template<typename Frame>
+bool SynchronizedHistories<Frame>::Chunk::packed() const {
+  return !packed_rows.empty();
+}
+
+template<typename Frame>
+void SynchronizedHistories<Frame>::Pack(not_null<Chunk*> const chunk) const {
+  CHECK(!chunk->packed());
+  Length const& position_tolerance = packing_->position_tolerance;
+  Speed const& velocity_tolerance = packing_->velocity_tolerance;
+  Chunk packed;
+  packed.anchors.assign(chunk->rows.begin(),
+                        chunk->rows.begin() + number_of_bodies_);
+  packed.packed_rows.reserve(chunk->rows.size());
+  for (std::size_t i = 0; i < chunk->rows.size(); ++i) {
+    DegreesOfFreedom<Frame> const& degrees_of_freedom = chunk->rows[i];
+    DegreesOfFreedom<Frame> const& anchor =
+        packed.anchors[i % number_of_bodies_];
+    PackedDegreesOfFreedom packed_degrees_of_freedom;
+    if (!Quantize((degrees_of_freedom.position() - anchor.position())
+                      .coordinates() / position_tolerance,
+                  &packed_degrees_of_freedom.position) ||
+        !Quantize((degrees_of_freedom.velocity() - anchor.velocity())
+                      .coordinates() / velocity_tolerance,
+                  &packed_degrees_of_freedom.velocity)) {
+      return;
+    }
+    packed.packed_rows.push_back(packed_degrees_of_freedom);
+  }
+  // The rounding to the nearest multiple of the tolerances introduces an error
+  // of at most √3 / 2 of the tolerances, but the decoding itself is inexact, so
+  // the bounds are checked.
+  for (std::size_t i = 0; i < chunk->rows.size(); ++i) {
+    DegreesOfFreedom<Frame> const& degrees_of_freedom = chunk->rows[i];
+    DegreesOfFreedom<Frame> const decoded =
+        Decode(packed, i / number_of_bodies_, i % number_of_bodies_);
+    if ((decoded.position() - degrees_of_freedom.position()).Norm() >
+            position_tolerance ||
+        (decoded.velocity() - degrees_of_freedom.velocity()).Norm() >
+            velocity_tolerance) {
+      return;
+    }
+  }
+  chunk->anchors = std::move(packed.anchors);
+  chunk->packed_rows = std::move(packed.packed_rows);
+  // Release the storage of the rows.
+  std::vector<DegreesOfFreedom<Frame>>().swap(chunk->rows);
+}
+
+template<typename Frame>
+bool SynchronizedHistories<Frame>::Quantize(
+    R3Element<double> const& offset,
+    not_null<std::array<std::int32_t, 3>*> const quantized) {
+  double const maximum = std::numeric_limits<std::int32_t>::max();
+  for (int i = 0; i < 3; ++i) {
+    double const rounded = std::round(offset[i]);
+    // Also false if |rounded| is NaN.
+    if (!(std::abs(rounded) <= maximum)) {
+      return false;
+    }
+    (*quantized)[i] = static_cast<std::int32_t>(rounded);
+  }
+  return true;
+}
+
+template<typename Frame>
+void SynchronizedHistories<Frame>::Unpack(not_null<Chunk*> const chunk) const {
+  CHECK(chunk->packed());
+  chunk->rows.reserve(kRowsPerChunk * number_of_bodies_);
+  for (std::size_t i = 0; i < chunk->packed_rows.size(); ++i) {
+    chunk->rows.push_back(
+        Decode(*chunk, i / number_of_bodies_, i % number_of_bodies_));
+  }
+  std::vector<DegreesOfFreedom<Frame>>().swap(chunk->anchors);
+  std::vector<PackedDegreesOfFreedom>().swap(chunk->packed_rows);
+}
+
+template<typename Frame>
+DegreesOfFreedom<Frame> SynchronizedHistories<Frame>::Decode(
+    Chunk const& chunk,
+    std::size_t const index_in_chunk,
+    int const body) const {
+  Length const& position_tolerance = packing_->position_tolerance;
+  Speed const& velocity_tolerance = packing_->velocity_tolerance;
+  DegreesOfFreedom<Frame> const& anchor = chunk.anchors[body];
+  PackedDegreesOfFreedom const& packed =
+      chunk.packed_rows[index_in_chunk * number_of_bodies_ + body];
+  return DegreesOfFreedom<Frame>(
+      anchor.position() +
+          Displacement<Frame>({packed.position[0] * position_tolerance,
+                               packed.position[1] * position_tolerance,
+                               packed.position[2] * position_tolerance}),
+      anchor.velocity() +
+          Velocity<Frame>({packed.velocity[0] * velocity_tolerance,
+                           packed.velocity[1] * velocity_tolerance,
+                           packed.velocity[2] * velocity_tolerance}));
+}
+
+template<typename Frame>
+typename SynchronizedHistories<Frame>::Chunk const&
+SynchronizedHistories<Frame>::ChunkOf(
+    std::size_t const index,
+    not_null<std::size_t*> const index_in_chunk) const {
+  DCHECK_LT(index, size_);
+  // All the chunks but the last one hold |kRowsPerChunk| rows, including the
+  // forgotten ones, so the position of the row is a simple division.
+  std::size_t const position = begin_ + index;
+  *index_in_chunk = position % kRowsPerChunk;
+  return chunks_[position / kRowsPerChunk];
+}
+
+template<typename Frame>
+std::size_t SynchronizedHistories<Frame>::Search(
+    Instant const& time,
+    bool const strictly_after) const {
+  std::size_t first = 0;
+  std::size_t count = size_;
+  while (count > 0) {
+    std::size_t const step = count / 2;
+    Instant const& t = this->time(first + step);
+    if (t < time || (strictly_after && t == time)) {
+      first += step + 1;
+      count -= step + 1;
+    } else {
+      count = step;
+    }
+  }
+  return first;
+}
+
+template<typename Frame>
+DegreesOfFreedom<Frame> SynchronizedHistories<Frame>::Interpolate(
+    Instant const& left_time,
+    DegreesOfFreedom<Frame> const& left,
+    Instant const& right_time,
+    DegreesOfFreedom<Frame> const& right,
+    Instant const& time) {
+  Time const h = right_time - left_time;
+  double const s = (time - left_time) / h;
+  double const s² = s * s;
+  double const s³ = s² * s;
+  double const h10 = s³ - 2 * s² + s;
+  double const h01 = -2 * s³ + 3 * s²;
+  double const h11 = s³ - s²;
+  double const dh10 = 3 * s² - 4 * s + 1;
+  double const dh01 = -6 * s² + 6 * s;
+  double const dh11 = 3 * s² - 2 * s;
+  Vector<Length, Frame> const Δq = right.position() - left.position();
+  Velocity<Frame> const& v0 = left.velocity();
+  Velocity<Frame> const& v1 = right.velocity();
+  return DegreesOfFreedom<Frame>(
+      left.position() + (h01 * Δq + h * (h10 * v0 + h11 * v1)),
+      dh01 * Δq / h + dh10 * v0 + dh11 * v1);
+}
+
+}  // namespace physics
+}  // namespace principia
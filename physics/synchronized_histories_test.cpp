@@ -0,0 +1,221 @@
+﻿#include "physics/synchronized_histories.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include "geometry/frame.hpp"
+#include "geometry/grassmann.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "quantities/si.hpp"
+#include "serialization/geometry.pb.h"
+#include "testing_utilities/almost_equals.hpp"
+
+using principia::geometry::Displacement;
+using principia::geometry::Frame;
+using principia::geometry::Velocity;
+using principia::quantities::Length;
+using principia::quantities::Speed;
+using principia::si::Metre;
+using principia::si::Second;
+using principia::testing_utilities::AlmostEquals;
+using testing::Eq;
+using testing::Ge;
+using testing::Le;
+using testing::Lt;
+
+namespace principia {
+namespace physics {
+
+class SynchronizedHistoriesTest : public testing::Test {
+ protected:
+  using World = Frame<serialization::Frame::TestTag,
+                      serialization::Frame::TEST1, true>;
+
+  SynchronizedHistoriesTest() : histories_(kBodies) {}
+
+  // Appends the rows at i s for i in [first, last[.  Body |b| is in uniform
+  // motion along the x axis with a speed of b m/s.
+  void Append(int const first, int const last) {
+    for (int i = first; i < last; ++i) {
+      histories_.Append(Time(i), [i](int const b) {
+        return DegreesOfFreedom<World>(
+            World::origin + Displacement<World>({i * b * Metre,
+                                                 b * Metre,
+                                                 0 * Metre}),
+            Velocity<World>({b * Metre / Second,
+                             0 * Metre / Second,
+                             0 * Metre / Second}));
+      });
+    }
+  }
+
+  static Instant Time(double const i) {
+    return Instant() + i * Second;
+  }
+
+  static int const kBodies = 3;
+  // The number of rows is chosen so that there are several chunks.
+  int const length_ = 5000;
+  SynchronizedHistories<World> histories_;
+};
+
+int const SynchronizedHistoriesTest::kBodies;
+
+TEST_F(SynchronizedHistoriesTest, Empty) {
+  EXPECT_TRUE(histories_.empty());
+  EXPECT_THAT(histories_.size(), Eq(0));
+  EXPECT_THAT(histories_.number_of_bodies(), Eq(kBodies));
+  EXPECT_THAT(histories_.LowerBound(Time(0)), Eq(0));
+  EXPECT_THAT(histories_.MemoryUsage(), Eq(0));
+}
+
+TEST_F(SynchronizedHistoriesTest, Append) {
+  Append(0, length_);
+  EXPECT_FALSE(histories_.empty());
+  EXPECT_THAT(histories_.size(), Eq(length_));
+  EXPECT_THAT(histories_.first_time(), Eq(Time(0)));
+  EXPECT_THAT(histories_.last_time(), Eq(Time(length_ - 1)));
+  for (int i = 0; i < length_; ++i) {
+    EXPECT_THAT(histories_.time(i), Eq(Time(i)));
+    for (int b = 0; b < kBodies; ++b) {
+      EXPECT_THAT(histories_.degrees_of_freedom(i, b).position() -
+                      World::origin,
+                  Eq(Displacement<World>({i * b * Metre,
+                                          b * Metre,
+                                          0 * Metre})));
+    }
+  }
+  // The rows are stored once, with one time per row.
+  EXPECT_THAT(histories_.MemoryUsage(),
+              Ge(static_cast<std::int64_t>(
+                  length_ * (sizeof(Instant) +
+                             kBodies * sizeof(DegreesOfFreedom<World>)))));
+}
+
+TEST_F(SynchronizedHistoriesTest, LowerBound) {
+  Append(0, length_);
+  EXPECT_THAT(histories_.LowerBound(Time(-1)), Eq(0));
+  EXPECT_THAT(histories_.LowerBound(Time(1234)), Eq(1234));
+  EXPECT_THAT(histories_.LowerBound(Time(1234.5)), Eq(1235));
+  EXPECT_THAT(histories_.LowerBound(Time(length_)), Eq(length_));
+}
+
+TEST_F(SynchronizedHistoriesTest, EvaluateDegreesOfFreedom) {
+  Append(0, length_);
+  DegreesOfFreedom<World> const degrees_of_freedom =
+      histories_.EvaluateDegreesOfFreedom(Time(1234.25), 2);
+  EXPECT_THAT(degrees_of_freedom.position() - World::origin,
+              AlmostEquals(Displacement<World>({2468.5 * Metre,
+                                                2 * Metre,
+                                                0 * Metre}), 0));
+  EXPECT_THAT(degrees_of_freedom.velocity(),
+              AlmostEquals(Velocity<World>({2 * Metre / Second,
+                                            0 * Metre / Second,
+                                            0 * Metre / Second}), 0));
+  EXPECT_THAT(histories_.EvaluateDegreesOfFreedom(Time(17), 1),
+              Eq(histories_.degrees_of_freedom(17, 1)));
+}
+
+TEST_F(SynchronizedHistoriesTest, ForgetAfter) {
+  Append(0, length_);
+  histories_.ForgetAfter(Time(3000.5));
+  EXPECT_THAT(histories_.size(), Eq(3001));
+  EXPECT_THAT(histories_.last_time(), Eq(Time(3000)));
+  histories_.ForgetAfter(Time(2047));
+  EXPECT_THAT(histories_.size(), Eq(2048));
+  EXPECT_THAT(histories_.last_time(), Eq(Time(2047)));
+  // Appending resumes after the truncation.
+  Append(2048, 2100);
+  EXPECT_THAT(histories_.size(), Eq(2100));
+  EXPECT_THAT(histories_.time(2099), Eq(Time(2099)));
+  EXPECT_THAT(histories_.degrees_of_freedom(2099, 1).position() -
+                  World::origin,
+              Eq(Displacement<World>({2099 * Metre, 1 * Metre, 0 * Metre})));
+  histories_.ForgetAfter(Time(-1));
+  EXPECT_TRUE(histories_.empty());
+}
+
+TEST_F(SynchronizedHistoriesTest, ForgetBefore) {
+  Append(0, length_);
+  std::int64_t const memory_usage = histories_.MemoryUsage();
+  histories_.ForgetBefore(Time(2500));
+  EXPECT_THAT(histories_.size(), Eq(length_ - 2501));
+  EXPECT_THAT(histories_.first_time(), Eq(Time(2501)));
+  EXPECT_THAT(histories_.time(0), Eq(Time(2501)));
+  EXPECT_THAT(histories_.degrees_of_freedom(1000, 2).position() -
+                  World::origin,
+              Eq(Displacement<World>({7002 * Metre, 2 * Metre, 0 * Metre})));
+  EXPECT_THAT(histories_.LowerBound(Time(3000)), Eq(499));
+  // The chunks before the first row are released.
+  EXPECT_THAT(histories_.MemoryUsage(), Lt(memory_usage));
+  Append(length_, length_ + 10);
+  EXPECT_THAT(histories_.last_time(), Eq(Time(length_ + 9)));
+  histories_.ForgetBefore(Time(length_ + 9));
+  EXPECT_TRUE(histories_.empty());
+}
+
+TEST_F(SynchronizedHistoriesTest, Packing) {
+  Append(0, 2000);
+  std::vector<DegreesOfFreedom<World>> unpacked;
+  for (int i = 0; i < 2000; ++i) {
+    for (int b = 0; b < kBodies; ++b) {
+      unpacked.push_back(histories_.degrees_of_freedom(i, b));
+    }
+  }
+  std::int64_t const unpacked_memory_usage = histories_.MemoryUsage();
+  Length const position_tolerance = 1e-3 * Metre;
+  Speed const velocity_tolerance = 1e-3 * Metre / Second;
+  histories_.set_packing({position_tolerance, velocity_tolerance});
+  // The first chunk is complete and packed by |set_packing|.
+  EXPECT_THAT(histories_.packed_size(), Eq(1024));
+  EXPECT_THAT(histories_.MemoryUsage(), Lt(unpacked_memory_usage));
+  Append(2000, length_);
+  EXPECT_THAT(histories_.packed_size(), Eq(4096));
+  for (int i = 0; i < 2000; ++i) {
+    for (int b = 0; b < kBodies; ++b) {
+      DegreesOfFreedom<World> const degrees_of_freedom =
+          histories_.degrees_of_freedom(i, b);
+      EXPECT_THAT((degrees_of_freedom.position() -
+                   unpacked[i * kBodies + b].position()).Norm(),
+                  Le(position_tolerance));
+      EXPECT_THAT((degrees_of_freedom.velocity() -
+                   unpacked[i * kBodies + b].velocity()).Norm(),
+                  Le(velocity_tolerance));
+    }
+  }
+  // The last chunk is incomplete, so it is not packed.
+  EXPECT_THAT(histories_.degrees_of_freedom(4999, 2).position() -
+                  World::origin,
+              Eq(Displacement<World>({9998 * Metre, 2 * Metre, 0 * Metre})));
+  // Reopening a packed chunk unpacks it.
+  histories_.ForgetAfter(Time(3000));
+  EXPECT_THAT(histories_.packed_size(), Eq(2048));
+  Append(3001, 3100);
+  EXPECT_THAT(histories_.degrees_of_freedom(3000, 1).position() -
+                  World::origin,
+              AlmostEquals(Displacement<World>({3000 * Metre,
+                                                1 * Metre,
+                                                0 * Metre}), 0));
+}
+
+// The offsets that don't fit in 32 bits are not packed.
+TEST_F(SynchronizedHistoriesTest, PackingOverflow) {
+  histories_.set_packing({1e-3 * Metre, 1e-3 * Metre / Second});
+  for (int i = 0; i < 1024; ++i) {
+    histories_.Append(Time(i), [i](int const b) {
+      return DegreesOfFreedom<World>(
+          World::origin + Displacement<World>({i * 1e7 * Metre,
+                                               0 * Metre,
+                                               0 * Metre}),
+          Velocity<World>());
+    });
+  }
+  EXPECT_THAT(histories_.packed_size(), Eq(0));
+  EXPECT_THAT(histories_.degrees_of_freedom(1023, 0).position() -
+                  World::origin,
+              Eq(Displacement<World>({1023e7 * Metre, 0 * Metre, 0 * Metre})));
+}
+
+}  // namespace physics
+}  // namespace principia
@@ -1,24 +1,34 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <iterator>
 #include <list>
 #include <map>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "base/not_null.hpp"
+#include "base/pool_allocator.hpp"
 #include "geometry/grassmann.hpp"
 #include "geometry/named_quantities.hpp"
+#include "physics/chunked_timeline.hpp"
 #include "physics/degrees_of_freedom.hpp"
 #include "quantities/named_quantities.hpp"
 #include "serialization/physics.pb.h"
 
 using principia::base::not_null;
+using principia::base::PoolAllocator;
 using principia::geometry::Instant;
 using principia::geometry::Vector;
 using principia::geometry::Velocity;
 using principia::quantities::Acceleration;
 using principia::quantities::Length;
+using principia::quantities::Quotient;
 using principia::quantities::Speed;
+using principia::quantities::Time;
 
 namespace principia {
 namespace physics {
@@ -28,22 +38,48 @@ class Body;
 template<typename Frame>
 class Trajectory {
   // There may be several forks starting from the same time, hence the multimap.
-  using Children =
-      std::multimap<Instant, not_null<std::unique_ptr<Trajectory>>>;
-  using Timeline = std::map<Instant, DegreesOfFreedom<Frame>>;
+  // The prolongations are forked and deleted at every step, so the nodes are
+  // recycled by the pool.
+  using Children = std::multimap<
+      Instant,
+      not_null<std::unique_ptr<Trajectory>>,
+      std::less<Instant>,
+      PoolAllocator<std::pair<Instant const,
+                              not_null<std::unique_ptr<Trajectory>>>>>;
+  // Appending is the most frequent operation on a trajectory, and histories may
+  // contain millions of points, hence the contiguous storage.
+  using Timeline = ChunkedTimeline<DegreesOfFreedom<Frame>>;
 
   // The two iterators denote entries in the containers of the parent, and they
-  // are never past the end.  Therefore, they are not invalidated by swapping
-  // the containers of the parent.
+  // are never past the end.  Therefore, they are not invalidated by appending
+  // to the parent, or by forgetting entries of the parent other than the fork
+  // time, which deletes this child anyway.
   struct Fork {
+    static void* operator new(std::size_t const size);
+    static void operator delete(void* const fork, std::size_t const size);
+
     typename Children::const_iterator children;
-    typename Timeline::const_iterator timeline;
+    typename Timeline::Iterator timeline;
   };
 
  public:
   class NativeIterator;
-  template<typename ToFrame>
-  class TransformingIterator;
+
+  // The position of the last lookup made with a hint, from which the next
+  // lookup searches forward.  When a trajectory is looked up at increasing
+  // times, e.g., to transform the points of another trajectory, this makes each
+  // lookup amortised constant time.  A hint may be used with a single
+  // trajectory, and it is invalidated by any change to that trajectory or to
+  // its ancestors other than appending.  A default-constructed hint is valid.
+  class Hint {
+   private:
+    // The trajectory whose timeline contains |upper_|, null if no lookup was
+    // made with this hint.
+    Trajectory const* ancestor_ = nullptr;
+    typename Timeline::Iterator upper_;
+
+    friend class Trajectory;
+  };
 
   // A function that transforms the coordinates to a different frame.
   template<typename ToFrame>
@@ -52,11 +88,24 @@ class Trajectory {
                         DegreesOfFreedom<Frame> const&,
                         not_null<Trajectory<Frame> const*> const)>;
 
+  // |TransformFunctor| must be callable with the same arguments as
+  // |Transform<ToFrame>|.  The default is type-erased; iterators for a specific
+  // functor type avoid the copy of a |std::function| and let the compiler
+  // inline the calls.
+  template<typename ToFrame, typename TransformFunctor = Transform<ToFrame>>
+  class TransformingIterator;
+
   // No transfer of ownership.  |body| must live longer than the trajectory as
   // the trajectory holds a reference to it.  If |body| is oblate it must be
   // expressed in the same frame as the trajectory.
   explicit Trajectory(not_null<Body const*> const body);
-  ~Trajectory() = default;
+  // Notifies the observers.
+  ~Trajectory();
+
+  // The memory of the trajectories is recycled by the pool, since forks are
+  // created and deleted at a high rate.
+  static void* operator new(std::size_t const size);
+  static void operator delete(void* const trajectory, std::size_t const size);
 
   Trajectory(Trajectory const&) = delete;
   Trajectory(Trajectory&&) = delete;
@@ -71,6 +120,11 @@ class Trajectory {
   // Complexity is O(|depth| + Ln(|length|)).  The result may be at end if the
   // |time| is after the end of the trajectory.
   NativeIterator on_or_after(Instant const& time) const;
+  // Same as above, but the lookup starts from |*hint| and updates it.
+  // Complexity is amortised O(|depth|) if the calls are made at increasing
+  // times.
+  NativeIterator on_or_after(Instant const& time,
+                             not_null<Hint*> const hint) const;
 
   // Returns an iterator at the last point of the trajectory.  Complexity is
   // O(1).  The trajectory must not be empty.
@@ -96,6 +150,33 @@ class Trajectory {
   TransformingIterator<ToFrame> last_with_transform(
       Transform<ToFrame> const& transform) const;
 
+  // Same as |first_with_transform|, but the iterator holds a copy of
+  // |transform| with its own type, which is cheap to call in loops.  |ToFrame|
+  // must be specified explicitly.
+  template<typename ToFrame, typename TransformFunctor>
+  TransformingIterator<ToFrame, TransformFunctor> first_with_functor(
+      TransformFunctor const& transform) const;
+
+  // Same as |on_or_after_with_transform|, but the iterator holds a copy of
+  // |transform| with its own type.  |ToFrame| must be specified explicitly.
+  template<typename ToFrame, typename TransformFunctor>
+  TransformingIterator<ToFrame, TransformFunctor> on_or_after_with_functor(
+      Instant const& time,
+      TransformFunctor const& transform) const;
+
+  // Returns the degrees of freedom at |time|, which must be between the first
+  // and the last points of the trajectory.  If |time| is not the time of a
+  // point, the result is obtained by cubic Hermite interpolation between the
+  // points immediately before and after it.  Complexity is O(|depth| +
+  // Ln(|length|)).
+  DegreesOfFreedom<Frame> EvaluateDegreesOfFreedom(Instant const& time) const;
+  // Same as above, but the lookup starts from |*hint| and updates it.
+  // Complexity is amortised O(|depth|) if the calls are made at increasing
+  // times.
+  DegreesOfFreedom<Frame> EvaluateDegreesOfFreedom(
+      Instant const& time,
+      not_null<Hint*> const hint) const;
+
   // These functions return the series of positions/velocities/times for the
   // trajectory of the body.  All three containers are guaranteed to have the
   // same size.  These functions are O(|depth| + |length|).
@@ -103,10 +184,35 @@ class Trajectory {
   std::map<Instant, Velocity<Frame>> Velocities() const;
   std::list<Instant> Times() const;
 
+  struct TimeProjection;
+  struct PositionProjection;
+  struct VelocityProjection;
+  template<typename Projection>
+  class View;
+
+  // These functions return views of the times/positions/velocities of the
+  // trajectory, in increasing order of time, which may be iterated over with a
+  // range-based for loop.  Unlike the functions above, they do not copy the
+  // timeline: creating a view is O(|depth|), iterating over it is O(|depth| +
+  // |length|) and does not allocate.  A view is invalidated by any change to
+  // the trajectory or to its ancestors.
+  View<TimeProjection> times() const;
+  View<PositionProjection> positions() const;
+  View<VelocityProjection> velocities() const;
+
   // Appends one point to the trajectory.
   void Append(Instant const& time,
               DegreesOfFreedom<Frame> const& degrees_of_freedom);
 
+  // A batch of points for |AppendRange|.
+  using Points = std::vector<typename Timeline::Entry>;
+
+  // Same as calling |Append| for each of the |points|, which must be in
+  // strictly increasing time order, but the order is checked in one pass and,
+  // unless the trajectory is downsampled or has levels of detail, the points
+  // are copied to the timeline in contiguous blocks.
+  void AppendRange(Points const& points);
+
   // Removes all data for times (strictly) greater than |time|, as well as all
   // child trajectories forked at times (strictly) greater than |time|.
   void ForgetAfter(Instant const& time);
@@ -116,6 +222,11 @@ class Trajectory {
   // trajectory must be a root.
   void ForgetBefore(Instant const& time);
 
+  // Removes the points at times (strictly) between |begin| and |end|, except
+  // those where children are forked.  This trajectory must be a root.  This
+  // invalidates the iterators and the hints.
+  void ForgetBetween(Instant const& begin, Instant const& end);
+
   // Creates a new child trajectory forked at time |time|, and returns it.  The
   // child trajectory shares its data with the current trajectory for times less
   // than or equal to |time|, and is an exact copy of the current trajectory for
@@ -133,9 +244,53 @@ class Trajectory {
   // previously returned by NewFork for this object.  Nulls |*fork|.
   void DeleteFork(not_null<Trajectory**> const fork);
 
+  // Same as |DeleteFork|, but returns the child trajectory instead of deleting
+  // it, so that the caller may destroy it later, possibly on another thread.
+  // The result still refers to this trajectory, so it must only be destroyed,
+  // and destroying it doesn't touch this trajectory.
+  not_null<std::unique_ptr<Trajectory>> DetachFork(
+      not_null<Trajectory**> const fork);
+
+  // Same as |DeleteFork(&fork)| followed by |fork = NewFork(time)|, but the
+  // child trajectory |fork| and its |Fork| are reused instead of being
+  // destroyed and allocated again, and it keeps its settings, e.g., its
+  // intrinsic acceleration.  The children of |fork| are deleted.  This is
+  // cheaper than creating a new fork, e.g., for the prolongations, which are
+  // forked again at every step of the histories.
+  void ResetFork(not_null<Trajectory*> const fork, Instant const& time);
+
+  // Appends to this trajectory the points of its child |fork| up to |time|,
+  // which must be one of them, and makes |fork| a fork at |time| that keeps its
+  // points after |time|.  |fork| must be forked at the last point of this
+  // trajectory, and must not have children forked at or before |time|.  The
+  // points are moved by |ChunkedTimeline::Splice|, so those of complete chunks
+  // are not copied, unless this trajectory is downsampled or has levels of
+  // detail, which are maintained point by point.
+  void SpliceFork(not_null<Trajectory*> const fork, Instant const& time);
+  // Same as above, but first appends the |gap| points, which must be in
+  // strictly increasing time order and between the fork point of |fork| and
+  // its first point, e.g., points that were kept elsewhere while |fork|
+  // skipped them.  The children of |fork| are kept, but the points that they
+  // share with it change.
+  void SpliceFork(not_null<Trajectory*> const fork,
+                  Points const& gap,
+                  Instant const& time);
+
   // Returns true if this is a root trajectory.
   bool is_root() const;
 
+  // Returns the number of points of the trajectory, which must be a root.
+  // Complexity is O(1).
+  std::size_t size() const;
+
+  // Returns an estimate of the memory used by this trajectory and its
+  // descendants, in bytes: the objects, the chunks of their timelines, see
+  // |ChunkedTimeline::MemoryUsage|, their levels of detail, and their snapshot
+  // blocks, which may be shared with snapshots that outlive the trajectory.
+  // The overhead of the allocators is not included.  Complexity is linear in
+  // the number of chunks and of descendants.
+  std::int64_t MemoryUsage() const;
+
   // Returns the root trajectory.
   not_null<Trajectory const*> root() const;
   not_null<Trajectory*> root();
@@ -155,6 +310,16 @@ class Trajectory {
   using IntrinsicAcceleration =
       std::function<Vector<Acceleration, Frame>(Instant const& time)>;
 
+  // An intrinsic acceleration which is an affine function of time: its value
+  // at |epoch| is |acceleration| and its derivative is |jerk|.  Unlike an
+  // |IntrinsicAcceleration| it is evaluated inline, which matters as it is
+  // evaluated at every stage of the integrator.
+  struct AffineIntrinsicAcceleration {
+    Instant epoch;
+    Vector<Acceleration, Frame> acceleration;
+    Vector<Quotient<Acceleration, Time>, Frame> jerk;
+  };
+
   // Sets the intrinsic acceleration for the trajectory of a massless body.
   // For a nonroot trajectory the intrinsic acceleration only applies to times
   // (strictly) greater than |fork_time()|.  In other words, the function
@@ -166,6 +331,8 @@ class Trajectory {
   // It is an error to call this function for a trajectory that already has an
   // intrinsic acceleration, or for the trajectory of a massive body.
   void set_intrinsic_acceleration(IntrinsicAcceleration const acceleration);
+  void set_intrinsic_acceleration(
+      AffineIntrinsicAcceleration const& acceleration);
 
   // Removes any intrinsic acceleration for the trajectory.
   void clear_intrinsic_acceleration();
@@ -180,10 +347,259 @@ class Trajectory {
   Vector<Acceleration, Frame> evaluate_intrinsic_acceleration(
       Instant const& time) const;
 
-  // This trajectory must be a root.  The intrinsic acceleration is not
-  // serialized.  The body is not owned, and therefore is not serialized.
+  // The parameters of the downsampling of a trajectory.  The points that are
+  // less than |full_resolution_duration| older than the last point are all
+  // retained.  Older points are removed as long as their positions may be
+  // recovered with an error less than |tolerance| by cubic Hermite
+  // interpolation between the points that are retained.
+  struct Downsampling {
+    Time full_resolution_duration;
+    Length tolerance;
+  };
+
+  // Enables the downsampling of this trajectory.  It is performed by |Append|,
+  // in batches, whenever there are at least |full_resolution_duration| worth
+  // of points older than |full_resolution_duration|.  The first point, the
+  // last point and the points where a child trajectory is forked are always
+  // retained.  An |Append| that downsamples invalidates the iterators into
+  // this trajectory and its descendants.
+  // It is an error to call this function for a trajectory that is already
+  // downsampled.
+  void set_downsampling(Downsampling const& downsampling);
+
+  // Stops downsampling this trajectory.  The points already removed are not
+  // restored.
+  void clear_downsampling();
+
+  // A memory-mapped file where the old points of trajectories may be stored.
+  using Archive = typename ChunkedTimeline<DegreesOfFreedom<Frame>>::Archive;
+
+  // From now on, the points of this trajectory (not of its forks) that are
+  // more than |horizon| older than its last point are moved in batches to
+  // |*archive|, which must outlive this trajectory.  The iterators are not
+  // invalidated.  If this trajectory is downsampled, |horizon| should be
+  // longer than the |full_resolution_duration|, otherwise the archived points
+  // are brought back into memory when they are downsampled.  It is an error to
+  // call this function for a trajectory that is already archived.  No transfer
+  // of ownership.
+  void set_archive(not_null<Archive*> const archive, Time const& horizon);
+
+  // Gives the degrees of freedom of the body at a time before the first point
+  // of a trajectory, e.g., from a precomputed ephemeris.
+  using PastEvaluator =
+      std::function<DegreesOfFreedom<Frame>(Instant const& time)>;
+
+  // From now on, |EvaluateDegreesOfFreedom| on this trajectory, which must be a
+  // root, and on its descendants uses |past_evaluator| for the times before
+  // the first point of this trajectory, instead of failing.  The old points
+  // may then be forgotten without breaking the evaluations at their times,
+  // e.g., by |Transforms|.  The iterators and the serialization are not
+  // affected.  An empty |past_evaluator| restores the default behaviour.
+  void set_past_evaluator(PastEvaluator past_evaluator);
+
+  // Gives the degrees of freedom of the body at |time|, strictly between
+  // consecutive points of a trajectory at |left_time| and |right_time|, e.g.,
+  // by integrating again from the point at |left_time|.  Returns false if it
+  // cannot.
+  using GapEvaluator =
+      std::function<bool(Instant const& left_time,
+                         Instant const& right_time,
+                         Instant const& time,
+                         not_null<DegreesOfFreedom<Frame>*> const
+                             degrees_of_freedom)>;
+
+  // From now on, |EvaluateDegreesOfFreedom| on this trajectory, which must be a
+  // root, and on its descendants tries |gap_evaluator| between consecutive
+  // points of this trajectory, and only interpolates if it returns false.  The
+  // points between sparse checkpoints may then be forgotten without degrading
+  // the evaluations at their times.  An empty |gap_evaluator| restores the
+  // default behaviour.
+  void set_gap_evaluator(GapEvaluator gap_evaluator);
+
+  // The points of a level of detail, in increasing time order.
+  using LevelOfDetailPoints =
+      std::vector<std::pair<Instant, DegreesOfFreedom<Frame>>>;
+
+  // From now on, maintains levels of detail of this trajectory, which must be a
+  // root, so that it may be rendered without iterating over all its points.
+  // Level |i| is a subset of the points such that the position of each point
+  // that is not in it is within |tolerances[i]| of the segment between the
+  // points of the level on either side.  The first and last points of the
+  // trajectory are always in each level.  The levels are updated incrementally
+  // by |Append|, at a cost independent of the length of the trajectory, and
+  // truncated by |ForgetAfter| and |ForgetBefore|; the points next to a
+  // truncation may then exceed the tolerance.  The points removed by the
+  // downsampling are kept in the levels.  The levels are not serialized.  It
+  // is an error to call this function for a trajectory that already has levels
+  // of detail.
+  void set_levels_of_detail(std::vector<Length> const& tolerances);
+
+  // The number of levels of detail, 0 if there are none.
+  int number_of_levels_of_detail() const;
+
+  // The tolerance and the points of the level of detail |level|.
+  Length const& level_of_detail_tolerance(int const level) const;
+  LevelOfDetailPoints const& level_of_detail(int const level) const;
+
+  // An immutable view of the points of a trajectory, including those of its
+  // ancestors, at the time of the call to |snapshot|.  A snapshot may be read
+  // by any number of threads while the trajectory is modified or destroyed.
+  // It shares its storage with the other snapshots of the trajectory.
+  class Snapshot {
+   public:
+    using Entry = std::pair<Instant, DegreesOfFreedom<Frame>>;
+
+    class Iterator {
+     public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = Entry;
+      using difference_type = std::ptrdiff_t;
+      using pointer = Entry const*;
+      using reference = Entry const&;
+
+      Iterator() = default;
+
+      Entry const& operator*() const;
+      Entry const* operator->() const;
+
+      Iterator& operator++();
+
+      bool operator==(Iterator const& right) const;
+      bool operator!=(Iterator const& right) const;
+
+     private:
+      Iterator(not_null<Snapshot const*> const snapshot,
+               std::size_t const piece,
+               std::size_t const index);
+
+      Snapshot const* snapshot_ = nullptr;
+      // An index in |snapshot_->pieces_|, equal to its size for the end
+      // iterator.
+      std::size_t piece_ = 0;
+      // An index in the block of that piece, 0 for the end iterator.
+      std::size_t index_ = 0;
+
+      friend class Snapshot;
+    };
+
+    Snapshot() = default;
+
+    bool empty() const;
+    std::size_t size() const;
+
+    Iterator begin() const;
+    Iterator end() const;
+
+    // Returns the first point at or after |time|, or end if there is none.
+    Iterator LowerBound(Instant const& time) const;
+
+   private:
+    using Block = std::vector<Entry>;
+
+    // The entries [begin, end[ of |block|, which are not empty.
+    struct Piece {
+      std::shared_ptr<Block const> block;
+      std::size_t begin;
+      std::size_t end;
+    };
+
+    // Removes the points after |time|.
+    void ForgetAfter(Instant const& time);
+
+    std::vector<Piece> pieces_;
+
+    friend class Trajectory;
+  };
+
+  // Returns a snapshot of the current state of this trajectory.  The points
+  // appended since the last snapshot are copied, the others are shared with
+  // the previous snapshots unless they have been forgotten or downsampled in
+  // the meantime.  Apart from these copies, the cost is proportional to the
+  // number of shared blocks, about one per thousand points.  The shared storage
+  // duplicates the points of the trajectories for which snapshots are taken.
+  // Must not be called concurrently with the modifications of this trajectory
+  // or its ancestors.
+  Snapshot snapshot();
+
+  // The version of the points of this trajectory, including those of its
+  // ancestors.  It starts at 0 and is incremented by each change of these
+  // points, including |Append|.  It is unchanged by the operations that don't
+  // change them, e.g., |NewFork| or |SpliceFork| for the fork.  The consumers
+  // that derive results from the points may compare it to the version at which
+  // they derived them.
+  std::int64_t version() const;
+
+  // An object notified of the changes of the trajectories that it observes, so
+  // that it may invalidate only the results that it derived from the points
+  // that changed.  The notifications are made after the changes, on the thread
+  // that makes them.  An observer must not add or remove observers while it is
+  // being notified.  The default implementations do nothing.
+  class Observer {
+   public:
+    virtual ~Observer() = default;
+
+    // The points of |trajectory| after (resp. at or before) |time| have been
+    // forgotten, by |ForgetAfter| (resp. |ForgetBefore|) on it or on one of its
+    // ancestors, or by |ResetFork|.  New points may later be appended at the
+    // same times.
+    virtual void ForgotAfter(Trajectory const& trajectory, Instant const& time);
+    virtual void ForgotBefore(Trajectory const& trajectory,
+                              Instant const& time);
+
+    // |fork| has been forked from |trajectory|, or is no longer one of its
+    // children, either because it is being destroyed or because it has been
+    // detached.
+    virtual void Forked(Trajectory const& trajectory, Trajectory const& fork);
+    virtual void ForkRemoved(Trajectory const& trajectory,
+                             Trajectory const& fork);
+
+    // |trajectory| is being destroyed, and is no longer observed.
+    virtual void Destroyed(Trajectory const& trajectory);
+  };
+
+  // Adds or removes an observer of this trajectory, which is not owned.  An
+  // observer may be added only once.  The observer must outlive this
+  // trajectory or be removed before it is destroyed.  Observing a trajectory is
+  // not a change of its points, hence these functions are const.
+  void AddObserver(not_null<Observer*> const observer) const;
+  void RemoveObserver(not_null<Observer*> const observer) const;
+
+  // Notifies the observers of this trajectory and of its descendants that they
+  // are destroyed, and removes them.  Must be called on the thread that uses
+  // the observers before this trajectory is handed over to another thread for
+  // destruction, e.g., to a |Reclaimer|, so that the destructors don't touch
+  // the observers concurrently with their users.
+  void PrepareForReclaim();
+
+  // This trajectory must be a root.  The timeline is written in a columnar
+  // format, but |ReadFromMessage| also accepts the older format with one
+  // message per point.  The intrinsic acceleration and the downsampling are
+  // not serialized.  The body is not owned, and therefore is not serialized.
   void WriteToMessage(not_null<serialization::Trajectory*> const message) const;
 
+  // This trajectory must be a root.  Same as |WriteToMessage|, except that
+  // only the points of the timeline after |since| are written; the descendants
+  // are written in full.  The cost is proportional to the number of these
+  // points and of the points of the descendants, not to the length of the
+  // timeline.  The resulting increment must be combined by
+  // |AppendIncrementToMessage| with a message written by |WriteToMessage| (or
+  // itself combined) when the last point of this trajectory was at or before
+  // |since|.
+  void WriteIncrementToMessage(
+      Instant const& since,
+      not_null<serialization::Trajectory*> const message) const;
+
+  // Appends to |message| the points of the timeline of |increment|, written by
+  // |WriteIncrementToMessage|, and replaces its descendants by those of
+  // |increment|.  The last point of |message| must be at or before the
+  // |increment_since| of |increment|.  |message| is then equivalent to the
+  // message written by |WriteToMessage| at the time of the increment, except
+  // that it keeps the points before |increment_since| that have been removed
+  // by the downsampling since.  The timeline of |message| is left uncompressed.
+  static void AppendIncrementToMessage(
+      serialization::Trajectory const& increment,
+      not_null<serialization::Trajectory*> const message);
+
   // NOTE(egg): This should return a |not_null|, but we can't do that until
   // |not_null<std::unique_ptr<T>>| is convertible to |std::unique_ptr<T>|, and
   // that requires a VS 2015 feature (rvalue references for |*this|).
@@ -208,24 +624,40 @@ class Trajectory {
     Instant const& time() const;
 
    protected:
-    using Timeline = std::map<Instant, DegreesOfFreedom<Frame>>;
+    using Timeline = ChunkedTimeline<DegreesOfFreedom<Frame>>;
 
     Iterator() = default;
     // No transfer of ownership.
     void InitializeFirst(not_null<Trajectory const*> const trajectory);
     void InitializeOnOrAfter(Instant const& time,
                              not_null<Trajectory const*> const trajectory);
+    void InitializeOnOrAfter(Instant const& time,
+                             not_null<Trajectory const*> const trajectory,
+                             not_null<Hint*> const hint);
     void InitializeLast(not_null<Trajectory const*> const trajectory);
-    typename Timeline::const_iterator current() const;
+    typename Timeline::Iterator current() const;
     not_null<Trajectory const*> trajectory() const;
 
    private:
-    // |ancestry_| has one more element than |forks_|.  The first element in
-    // |ancestry_| is the root.  There is no element in |forks_| for the root.
-    // It is therefore empty for a root trajectory.
-    typename Timeline::const_iterator current_;
-    std::list<not_null<Trajectory const*>> ancestry_;  // Pointers not owned.
-    std::list<Fork> forks_;
+    // Makes |segment| the trajectory being iterated over, and caches the end of
+    // the part of its timeline that belongs to |trajectory_|.  |segment| must
+    // be |trajectory_| or one of its ancestors.
+    void EnterSegment(not_null<Trajectory const*> const segment);
+
+    // The ancestry is not stored, so that creating or advancing an iterator
+    // does not allocate.  Instead, when the iterator crosses a fork, the child
+    // to continue with is found by walking up from |trajectory_|.  This costs
+    // O(|depth|) per fork, and forks are crossed at most |depth| times.
+    // Pointers not owned.
+    typename Timeline::Iterator current_;
+    // The trajectory in whose timeline |current_| is.
+    Trajectory const* segment_ = nullptr;
+    // The trajectory being iterated over.
+    Trajectory const* trajectory_ = nullptr;
+    // If |segment_| is not |trajectory_|, the point of |segment_| at which the
+    // next trajectory towards |trajectory_| was forked.  That point is the last
+    // one visited in |segment_|.
+    typename Timeline::Iterator fork_point_;
   };
 
   // An iterator which returns the coordinates in the native frame of the
@@ -240,13 +672,72 @@ class Trajectory {
   };
 
   // An iterator which returns the coordinates in another frame.
-  template<typename ToFrame>
+  template<typename ToFrame, typename TransformFunctor>
   class TransformingIterator : public Iterator {
    public:
     DegreesOfFreedom<ToFrame> degrees_of_freedom() const;
    private:
-    explicit TransformingIterator(Transform<ToFrame> const& transform);
-    Transform<ToFrame> transform_;
+    explicit TransformingIterator(TransformFunctor const& transform);
+    TransformFunctor transform_;
+    friend class Trajectory;
+  };
+
+  // The projections used by the views: |Get| extracts the value exposed for a
+  // point from an iterator at that point.
+  struct TimeProjection {
+    using Value = Instant;
+    static Instant const& Get(NativeIterator const& it);
+  };
+  struct PositionProjection {
+    using Value = Position<Frame>;
+    static Position<Frame> const& Get(NativeIterator const& it);
+  };
+  struct VelocityProjection {
+    using Value = Velocity<Frame>;
+    static Velocity<Frame> const& Get(NativeIterator const& it);
+  };
+
+  // An iterator over a view, which exposes the values extracted by
+  // |Projection| from the points of the trajectory.
+  template<typename Projection>
+  class ViewIterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename Projection::Value;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type const*;
+    using reference = value_type const&;
+
+    reference operator*() const;
+    pointer operator->() const;
+    ViewIterator& operator++();
+
+    // Two iterators are equal if they are both at end, or at the same point.
+    bool operator==(ViewIterator const& right) const;
+    bool operator!=(ViewIterator const& right) const;
+
+   private:
+    // If |at_end| is true, the result is at end, irrespective of |iterator|.
+    ViewIterator(NativeIterator const& iterator, bool const at_end);
+
+    bool at_end() const;
+
+    NativeIterator iterator_;
+    bool at_end_;
+    friend class View<Projection>;
+  };
+
+  // A range over the points of a trajectory, see |times|.
+  template<typename Projection>
+  class View {
+   public:
+    ViewIterator<Projection> begin() const;
+    ViewIterator<Projection> end() const;
+
+   private:
+    explicit View(NativeIterator const& first);
+
+    NativeIterator const first_;
     friend class Trajectory;
   };
 
@@ -259,9 +750,88 @@ class Trajectory {
   // This trajectory need not be a root.
   void WriteSubTreeToMessage(
       not_null<serialization::Trajectory*> const message) const;
+  // Writes the descendants of this trajectory to |message|.
+  void WriteChildrenToMessage(
+      not_null<serialization::Trajectory*> const message) const;
+  // Writes the points of the timeline from |begin| to the end, of which there
+  // are |size|, to the columns of |message|.  Does nothing if |size| is 0.
+  void WriteTimelineToMessage(
+      typename Timeline::Iterator begin,
+      int const size,
+      not_null<serialization::Trajectory*> const message) const;
 
   void FillSubTreeFromMessage(serialization::Trajectory const& message);
 
+  // Removes points at or before |time| and after |downsampled_until_|
+  // according to |downsampling_|, and advances |downsampled_until_|.
+  void Downsample(Instant const& time);
+
+  // A level of detail and the state of its incremental construction.
+  struct LevelOfDetail {
+    Length tolerance;
+    LevelOfDetailPoints points;
+    // If true, the last element of |points| was not retained yet: it is
+    // replaced by the next point appended if the points dropped since the
+    // element before it, including itself, are within |tolerance| of the
+    // segment to the next point.
+    bool last_is_provisional = false;
+    // The positions of the points dropped since the element of |points| before
+    // the last one.
+    std::vector<Position<Frame>> dropped;
+  };
+
+  // The number of dropped points after which a point is retained regardless of
+  // the tolerance.  This bounds the cost of |AppendToLevelOfDetail|.
+  static std::size_t const kMaximumLevelOfDetailDroppedPoints = 256;
+
+  // Appends a point of the trajectory, later than all the points of |*level|.
+  static void AppendToLevelOfDetail(
+      Instant const& time,
+      DegreesOfFreedom<Frame> const& degrees_of_freedom,
+      not_null<LevelOfDetail*> const level);
+
+  // Returns the distance from |point| to the segment [|begin|, |end|].
+  static Length DistanceToSegment(Position<Frame> const& point,
+                                  Position<Frame> const& begin,
+                                  Position<Frame> const& end);
+
+  // Erases the children in [first, last[, after notifying the observers.
+  void EraseChildren(typename Children::const_iterator const first,
+                     typename Children::const_iterator const last);
+
+  // Increments the versions of this trajectory and of its descendants, whose
+  // points include ours.
+  void IncrementVersions();
+  // Increments |version_| and notifies the observers that the points after
+  // |time| have been forgotten.
+  void ForgotAfter(Instant const& time);
+  // Increments the versions of this trajectory and of its descendants, and
+  // notifies their observers that the points at or before |time| have been
+  // forgotten.
+  void ForgotBefore(Instant const& time);
+
+  // Moves |child|, one of our children, to the key |time| of |children_|.
+  void MoveChild(not_null<Trajectory*> const child, Instant const& time);
+
+  // Drops the snapshot blocks that contain points after |time|.  Called when
+  // these points are forgotten or changed.
+  void ForgetSnapshotBlocksAfter(Instant const& time);
+
+  // Returns the first point on or after |time|, or end if there is none, and
+  // sets |*segment| to the trajectory in whose timeline it is.  The lookup
+  // starts from |*hint| and updates it.
+  typename Timeline::Iterator LowerBound(
+      Instant const& time,
+      not_null<Hint*> const hint,
+      not_null<Trajectory const**> const segment) const;
+
+  // The cubic Hermite interpolation at |time| between the points |left| and
+  // |right|.
+  static DegreesOfFreedom<Frame> Interpolate(
+      typename Timeline::Entry const& left,
+      typename Timeline::Entry const& right,
+      Instant const& time);
+
   not_null<Body const*> const body_;
 
   // Both of these members are null for a root trajectory.
@@ -271,7 +841,37 @@ class Trajectory {
   Children children_;
   Timeline timeline_;
 
+  // At most one of these members is not null.
   std::unique_ptr<IntrinsicAcceleration> intrinsic_acceleration_;
+  std::unique_ptr<AffineIntrinsicAcceleration> affine_intrinsic_acceleration_;
+
+  // Null if this trajectory is not downsampled.
+  std::unique_ptr<Downsampling> downsampling_;
+  // The points before this time have already been downsampled.  Only
+  // meaningful if |downsampling_| is not null.
+  Instant downsampled_until_;
+
+  // Empty if this trajectory doesn't have levels of detail.
+  std::vector<LevelOfDetail> levels_of_detail_;
+
+  // Empty unless set by |set_past_evaluator|.
+  PastEvaluator past_evaluator_;
+  // Empty unless set by |set_gap_evaluator|.
+  GapEvaluator gap_evaluator_;
+
+  // The copies of the points of |timeline_| shared with the snapshots, in
+  // increasing time order.  Only the blocks smaller than
+  // |kMaximumSnapshotBlockSize| are merged, so that the number of blocks is
+  // logarithmic in the number of snapshots taken between two full blocks.
+  static std::size_t const kMaximumSnapshotBlockSize = 1024;
+  std::vector<std::shared_ptr<typename Snapshot::Block const>> snapshot_blocks_;
+  // The entries of |snapshot_blocks_.front()| before this index have been
+  // forgotten.
+  std::size_t snapshot_blocks_begin_ = 0;
+
+  std::int64_t version_ = 0;
+  // Not owned.  Mutable since observing is not a change of the points.
+  mutable std::vector<not_null<Observer*>> observers_;
 };
 
 }  // namespace physics
@@ -1,21 +1,46 @@
-#pragma once
+﻿#pragma once
 
 #include "trajectory.hpp"
 
 #include <algorithm>
 #include <list>
 #include <map>
+#include <vector>
 
+#include "base/memory_usage.hpp"
+#include "geometry/epoch.hpp"
 #include "geometry/named_quantities.hpp"
+#include "geometry/r3_element.hpp"
 #include "glog/logging.h"
 #include "physics/oblate_body.hpp"
+#include "physics/trajectory_compression.hpp"
+#include "quantities/si.hpp"
 
 using principia::base::make_not_null_unique;
+using principia::base::TreeMemoryUsage;
+using principia::base::VectorMemoryUsage;
+using principia::geometry::Displacement;
+using principia::geometry::InnerProduct;
 using principia::geometry::Instant;
+using principia::geometry::kJ2000;
+using principia::geometry::R3Element;
+using principia::si::Metre;
+using principia::si::Second;
 
 namespace principia {
 namespace physics {
 
+template<typename Frame>
+void* Trajectory<Frame>::Fork::operator new(std::size_t const size) {
+  return base::Pool::Allocate(size);
+}
+
+template<typename Frame>
+void Trajectory<Frame>::Fork::operator delete(void* const fork,
+                                             std::size_t const size) {
+  base::Pool::Deallocate(fork, size);
+}
+
 template<typename Frame>
 Trajectory<Frame>::Trajectory(not_null<Body const*> const body)
     : body_(body),
@@ -24,6 +49,24 @@ Trajectory<Frame>::Trajectory(not_null<Body const*> const body)
       << "Oblate body not in the same frame as the trajectory";
 }
 
+template<typename Frame>
+Trajectory<Frame>::~Trajectory() {
+  for (not_null<Observer*> const observer : observers_) {
+    observer->Destroyed(*this);
+  }
+}
+
+template<typename Frame>
+void* Trajectory<Frame>::operator new(std::size_t const size) {
+  return base::Pool::Allocate(size);
+}
+
+template<typename Frame>
+void Trajectory<Frame>::operator delete(void* const trajectory,
+                                       std::size_t const size) {
+  base::Pool::Deallocate(trajectory, size);
+}
+
 template<typename Frame>
 typename Trajectory<Frame>::NativeIterator Trajectory<Frame>::first() const {
   NativeIterator it;
@@ -39,6 +82,15 @@ typename Trajectory<Frame>::NativeIterator Trajectory<Frame>::on_or_after(
   return it;
 }
 
+template<typename Frame>
+typename Trajectory<Frame>::NativeIterator Trajectory<Frame>::on_or_after(
+    Instant const& time,
+    not_null<Hint*> const hint) const {
+  NativeIterator it;
+  it.InitializeOnOrAfter(time, this, hint);
+  return it;
+}
+
 template<typename Frame>
 typename Trajectory<Frame>::NativeIterator Trajectory<Frame>::last() const {
   NativeIterator it;
@@ -77,6 +129,70 @@ Trajectory<Frame>::last_with_transform(
   return it;
 }
 
+template<typename Frame>
+template<typename ToFrame, typename TransformFunctor>
+typename Trajectory<Frame>::TEMPLATE
+    TransformingIterator<ToFrame, TransformFunctor>
+Trajectory<Frame>::first_with_functor(TransformFunctor const& transform) const {
+  TransformingIterator<ToFrame, TransformFunctor> it(transform);
+  it.InitializeFirst(this);
+  return it;
+}
+
+template<typename Frame>
+template<typename ToFrame, typename TransformFunctor>
+typename Trajectory<Frame>::TEMPLATE
+    TransformingIterator<ToFrame, TransformFunctor>
+Trajectory<Frame>::on_or_after_with_functor(
+    Instant const& time,
+    TransformFunctor const& transform) const {
+  TransformingIterator<ToFrame, TransformFunctor> it(transform);
+  it.InitializeOnOrAfter(time, this);
+  return it;
+}
+
+template<typename Frame>
+DegreesOfFreedom<Frame> Trajectory<Frame>::EvaluateDegreesOfFreedom(
+    Instant const& time) const {
+  Hint hint;
+  return EvaluateDegreesOfFreedom(time, &hint);
+}
+
+template<typename Frame>
+DegreesOfFreedom<Frame> Trajectory<Frame>::EvaluateDegreesOfFreedom(
+    Instant const& time,
+    not_null<Hint*> const hint) const {
+  Trajectory const* ancestor;
+  typename Timeline::Iterator const upper = LowerBound(time, hint, &ancestor);
+  CHECK(upper != ancestor->timeline_.end())
+      << "Time " << time << " is after the end of the trajectory";
+  if (upper->first == time) {
+    return upper->second;
+  }
+  typename Timeline::Iterator lower = upper;
+  if (upper == ancestor->timeline_.begin()) {
+    if (ancestor->fork_ == nullptr && ancestor->past_evaluator_) {
+      return ancestor->past_evaluator_(time);
+    }
+    CHECK(ancestor->fork_ != nullptr)
+        << "Time " << time << " is before the beginning of the trajectory";
+    // The previous point is the fork point, in the timeline of the parent.
+    lower = ancestor->fork_->timeline;
+  } else {
+    --lower;
+    if (ancestor->fork_ == nullptr && ancestor->gap_evaluator_) {
+      DegreesOfFreedom<Frame> degrees_of_freedom = upper->second;
+      if (ancestor->gap_evaluator_(lower->first,
+                                   upper->first,
+                                   time,
+                                   &degrees_of_freedom)) {
+        return degrees_of_freedom;
+      }
+    }
+  }
+  return Interpolate(*lower, *upper, time);
+}
+
 template<typename Frame>
 std::map<Instant, Position<Frame>> Trajectory<Frame>::Positions() const {
   std::map<Instant, Position<Frame>> result;
@@ -106,19 +222,78 @@ std::list<Instant> Trajectory<Frame>::Times() const {
   return result;
 }
 
+template<typename Frame>
+typename Trajectory<Frame>::template View<
+    typename Trajectory<Frame>::TimeProjection>
+Trajectory<Frame>::times() const {
+  return View<TimeProjection>(first());
+}
+
+template<typename Frame>
+typename Trajectory<Frame>::template View<
+    typename Trajectory<Frame>::PositionProjection>
+Trajectory<Frame>::positions() const {
+  return View<PositionProjection>(first());
+}
+
+template<typename Frame>
+typename Trajectory<Frame>::template View<
+    typename Trajectory<Frame>::VelocityProjection>
+Trajectory<Frame>::velocities() const {
+  return View<VelocityProjection>(first());
+}
+
 template<typename Frame>
 void Trajectory<Frame>::Append(
     Instant const& time,
     DegreesOfFreedom<Frame> const& degrees_of_freedom) {
-  auto inserted = timeline_.emplace(time, degrees_of_freedom);
-  CHECK(timeline_.end() == ++inserted.first) << "Append out of order";
-  CHECK(inserted.second) << "Append at existing time";
+  if (!timeline_.empty()) {
+    Instant const& last_time = (--timeline_.end())->first;
+    CHECK_LE(last_time, time) << "Append out of order";
+    CHECK_NE(last_time, time) << "Append at existing time";
+  }
+  timeline_.Append(time, degrees_of_freedom);
+  ++version_;
+  if (downsampling_ != nullptr) {
+    if (timeline_.size() == 1) {
+      downsampled_until_ = time;
+    } else if (time - downsampled_until_ >=
+               2 * downsampling_->full_resolution_duration) {
+      Downsample(time - downsampling_->full_resolution_duration);
+    }
+  }
+  for (auto& level : levels_of_detail_) {
+    AppendToLevelOfDetail(time, degrees_of_freedom, &level);
+  }
+}
+
+template<typename Frame>
+void Trajectory<Frame>::AppendRange(Points const& points) {
+  if (points.empty()) {
+    return;
+  }
+  if (!timeline_.empty()) {
+    Instant const& last_time = (--timeline_.end())->first;
+    CHECK_LT(last_time, points.front().first) << "Append out of order";
+  }
+  for (std::size_t i = 1; i < points.size(); ++i) {
+    CHECK_LT(points[i - 1].first, points[i].first) << "Append out of order";
+  }
+  if (downsampling_ != nullptr || !levels_of_detail_.empty()) {
+    // The downsampling and the levels of detail are maintained point by point.
+    for (auto const& point : points) {
+      Append(point.first, point.second);
+    }
+  } else {
+    timeline_.AppendRange(points);
+    ++version_;
+  }
 }
 
 template<typename Frame>
 void Trajectory<Frame>::ForgetAfter(Instant const& time) {
   // Check that |time| is the time of one of our Timeline or the time of fork.
-  auto const it = timeline_.find(time);
+  auto const it = timeline_.Find(time);
   if (it == timeline_.end()) {
     CHECK(fork_ != nullptr)
         << "ForgetAfter a nonexistent time for a root trajectory";
@@ -129,14 +304,32 @@ void Trajectory<Frame>::ForgetAfter(Instant const& time) {
   // Each of these blocks gets an iterator denoting the first entry with
   // time > |time|.  It then removes that entry and all the entries that follow
   // it.  This preserve any entry with time == |time|.
-  {
-    auto const it = timeline_.upper_bound(time);
-    timeline_.erase(it, timeline_.end());
+  timeline_.ForgetFrom(timeline_.UpperBound(time));
+  ForgetSnapshotBlocksAfter(time);
+  if (downsampling_ != nullptr && time < downsampled_until_) {
+    downsampled_until_ = time;
   }
-  {
-    auto const it = children_.upper_bound(time);
-    children_.erase(it, children_.end());
+  if (!timeline_.empty()) {
+    auto const& last = *--timeline_.end();
+    for (auto& level : levels_of_detail_) {
+      auto& points = level.points;
+      points.erase(
+          std::upper_bound(points.begin(), points.end(), time,
+                           [](Instant const& left,
+                              typename LevelOfDetailPoints::value_type const&
+                                  right) {
+                             return left < right.first;
+                           }),
+          points.end());
+      if (points.empty() || points.back().first != last.first) {
+        points.emplace_back(last.first, last.second);
+      }
+      level.last_is_provisional = false;
+      level.dropped.clear();
+    }
   }
+  EraseChildren(children_.upper_bound(time), children_.end());
+  ForgotAfter(time);
 }
 
 template<typename Frame>
@@ -144,21 +337,78 @@ void Trajectory<Frame>::ForgetBefore(Instant const& time) {
   // Check that this is a root.
   CHECK(is_root()) << "ForgetBefore on a nonroot trajectory";
   // Check that |time| is the time of one of our Timeline or the time of fork.
-  CHECK(timeline_.find(time) != timeline_.end())
+  CHECK(timeline_.Find(time) != timeline_.end())
       << "ForgetBefore a nonexistent time";
-  {
-    auto it = timeline_.upper_bound(time);
-    timeline_.erase(timeline_.begin(), it);
+  timeline_.ForgetBefore(timeline_.UpperBound(time));
+  // Drop the snapshot blocks that only contain forgotten points, and skip the
+  // forgotten points of the first remaining one.
+  while (!snapshot_blocks_.empty() &&
+         (timeline_.empty() ||
+          snapshot_blocks_.front()->back().first <
+              timeline_.begin()->first)) {
+    snapshot_blocks_.erase(snapshot_blocks_.begin());
+  }
+  snapshot_blocks_begin_ = 0;
+  if (!snapshot_blocks_.empty()) {
+    auto const& front = *snapshot_blocks_.front();
+    while (front[snapshot_blocks_begin_].first < timeline_.begin()->first) {
+      ++snapshot_blocks_begin_;
+    }
+  }
+  if (!timeline_.empty()) {
+    auto const& first = *timeline_.begin();
+    auto const& last = *--timeline_.end();
+    for (auto& level : levels_of_detail_) {
+      auto& points = level.points;
+      points.erase(
+          points.begin(),
+          std::lower_bound(points.begin(), points.end(), first.first,
+                           [](typename LevelOfDetailPoints::value_type const&
+                                  left,
+                              Instant const& right) {
+                             return left.first < right;
+                           }));
+      if (points.empty() || points.front().first != first.first) {
+        points.emplace(points.begin(), first.first, first.second);
+      }
+      if (points.back().first != last.first) {
+        points.emplace_back(last.first, last.second);
+      }
+      level.last_is_provisional = false;
+      level.dropped.clear();
+    }
+  }
+  EraseChildren(children_.begin(), children_.upper_bound(time));
+  ForgotBefore(time);
+}
+
+template<typename Frame>
+void Trajectory<Frame>::ForgetBetween(Instant const& begin,
+                                      Instant const& end) {
+  CHECK(is_root()) << "ForgetBetween on a nonroot trajectory";
+  CHECK_LE(begin, end);
+  typename Timeline::Iterator const first = timeline_.UpperBound(begin);
+  typename Timeline::Iterator const last = timeline_.LowerBound(end);
+  if (first == timeline_.end() || first->first >= end) {
+    return;
   }
-  {
-    auto it = children_.upper_bound(time);
-    children_.erase(children_.begin(), it);
+  // The points after |begin| may be removed.
+  ForgetSnapshotBlocksAfter(begin);
+  timeline_.ForgetIf(first,
+                     last,
+                     [this](typename Timeline::Entry const& entry) {
+                       return children_.find(entry.first) == children_.end();
+                     });
+  // The compaction of the timeline has invalidated the forks of our children.
+  for (auto const& pair : children_) {
+    pair.second->fork_->timeline = timeline_.Find(pair.first);
   }
+  IncrementVersions();
 }
 
 template<typename Frame>
 not_null<Trajectory<Frame>*> Trajectory<Frame>::NewFork(Instant const& time) {
-  auto fork_it = timeline_.find(time);
+  auto fork_it = timeline_.Find(time);
   CHECK(fork_it != timeline_.end()) << "NewFork at nonexistent time";
   // We cannot know the iterator into children_ until after we have done the
   // insertion in children_.
@@ -166,14 +416,25 @@ not_null<Trajectory<Frame>*> Trajectory<Frame>::NewFork(Instant const& time) {
   // Can't use make_unique below.
   std::unique_ptr<Trajectory<Frame>> child(
       new Trajectory(body_, this /*parent*/, fork));
-  child->timeline_.insert(++fork_it, timeline_.end());
+  for (auto it = ++fork_it; it != timeline_.end(); ++it) {
+    child->timeline_.Append(it->first, it->second);
+  }
   auto const child_it = children_.emplace(time, std::move(child));
   child_it->second->fork_->children = child_it;
+  for (not_null<Observer*> const observer : observers_) {
+    observer->Forked(*this, *child_it->second);
+  }
   return child_it->second.get();
 }
 
 template<typename Frame>
 void Trajectory<Frame>::DeleteFork(not_null<Trajectory**> const fork) {
+  DetachFork(fork);
+}
+
+template<typename Frame>
+not_null<std::unique_ptr<Trajectory<Frame>>> Trajectory<Frame>::DetachFork(
+    not_null<Trajectory**> const fork) {
   CHECK_NOTNULL(*fork);
   Instant const* const fork_time = (*fork)->fork_time();
   CHECK_NOTNULL(fork_time);
@@ -181,20 +442,132 @@ void Trajectory<Frame>::DeleteFork(not_null<Trajectory**> const fork) {
   auto const range = children_.equal_range(*fork_time);
   for (auto it = range.first; it != range.second; ++it) {
     if (it->second.get() == *fork) {
+      for (not_null<Observer*> const observer : observers_) {
+        observer->ForkRemoved(*this, **fork);
+      }
+      not_null<std::unique_ptr<Trajectory>> detached = std::move(it->second);
       children_.erase(it);
       *fork = nullptr;
-      return;
+      return detached;
     }
   }
   LOG(FATAL) << "fork is not a child of this trajectory";
+  base::noreturn();
+}
+
+
+template<typename Frame>
+void Trajectory<Frame>::ResetFork(not_null<Trajectory*> const fork,
+                                  Instant const& time) {
+  CHECK_EQ(this, fork->parent_) << "fork is not a child of this trajectory";
+  auto fork_it = timeline_.Find(time);
+  CHECK(fork_it != timeline_.end()) << "ResetFork at nonexistent time";
+  // The points of |fork| at or before this time are unchanged.
+  Instant const unchanged_until = std::min(*fork->fork_time(), time);
+  fork->EraseChildren(fork->children_.begin(), fork->children_.end());
+  if (!fork->timeline_.empty()) {
+    fork->timeline_.ForgetFrom(fork->timeline_.begin());
+  }
+  fork->snapshot_blocks_.clear();
+  fork->snapshot_blocks_begin_ = 0;
+  fork->fork_->timeline = fork_it;
+  for (auto it = ++fork_it; it != timeline_.end(); ++it) {
+    fork->timeline_.Append(it->first, it->second);
+  }
+  MoveChild(fork, time);
+  fork->ForgotAfter(unchanged_until);
+}
+
+template<typename Frame>
+void Trajectory<Frame>::SpliceFork(not_null<Trajectory*> const fork,
+                                   Instant const& time) {
+  CHECK_EQ(this, fork->parent_) << "fork is not a child of this trajectory";
+  CHECK(fork->fork_->timeline == --timeline_.end())
+      << "fork is not at the last point of this trajectory";
+  auto const last = fork->timeline_.Find(time);
+  CHECK(last != fork->timeline_.end()) << "SpliceFork at nonexistent time";
+  CHECK(fork->children_.empty() || fork->children_.begin()->first > time)
+      << "SpliceFork at or after a fork of the fork";
+  auto const end = std::next(last);
+  if (downsampling_ == nullptr && levels_of_detail_.empty()) {
+    timeline_.Splice(&fork->timeline_, end);
+    ++version_;
+  } else {
+    // The downsampling and the levels of detail are maintained point by point.
+    for (auto it = fork->timeline_.begin(); it != end; ++it) {
+      Append(it->first, it->second);
+    }
+    fork->timeline_.ForgetBefore(end);
+  }
+  // The snapshot blocks of |fork| are rebuilt by its next snapshot.
+  fork->snapshot_blocks_.clear();
+  fork->snapshot_blocks_begin_ = 0;
+  fork->fork_->timeline = --timeline_.end();
+  MoveChild(fork, time);
 }
 
+template<typename Frame>
+void Trajectory<Frame>::SpliceFork(not_null<Trajectory*> const fork,
+                                   Points const& gap,
+                                   Instant const& time) {
+  CHECK_EQ(this, fork->parent_) << "fork is not a child of this trajectory";
+  CHECK(fork->fork_->timeline == --timeline_.end())
+      << "fork is not at the last point of this trajectory";
+  if (!gap.empty()) {
+    CHECK(fork->timeline_.empty() ||
+          gap.back().first < fork->timeline_.begin()->first)
+        << "gap overlaps the fork";
+    Instant const fork_time = *fork->fork_time();
+    AppendRange(gap);
+    fork->fork_->timeline = --timeline_.end();
+    MoveChild(fork, gap.back().first);
+    fork->IncrementVersions();
+    fork->ForgotAfter(fork_time);
+  }
+  SpliceFork(fork, time);
+}
 
 template<typename Frame>
 bool Trajectory<Frame>::is_root() const {
   return parent_ == nullptr;
 }
 
+template<typename Frame>
+std::size_t Trajectory<Frame>::size() const {
+  CHECK(is_root()) << "size on a nonroot trajectory";
+  return timeline_.size();
+}
+
+template<typename Frame>
+std::int64_t Trajectory<Frame>::MemoryUsage() const {
+  std::int64_t usage = sizeof(Trajectory) + timeline_.MemoryUsage();
+  if (fork_ != nullptr) {
+    usage += sizeof(Fork);
+  }
+  if (intrinsic_acceleration_ != nullptr) {
+    usage += sizeof(IntrinsicAcceleration);
+  }
+  if (affine_intrinsic_acceleration_ != nullptr) {
+    usage += sizeof(AffineIntrinsicAcceleration);
+  }
+  if (downsampling_ != nullptr) {
+    usage += sizeof(Downsampling);
+  }
+  usage += VectorMemoryUsage(levels_of_detail_);
+  for (LevelOfDetail const& level : levels_of_detail_) {
+    usage += VectorMemoryUsage(level.points) + VectorMemoryUsage(level.dropped);
+  }
+  usage += VectorMemoryUsage(snapshot_blocks_);
+  for (auto const& block : snapshot_blocks_) {
+    usage += sizeof(typename Snapshot::Block) + VectorMemoryUsage(*block);
+  }
+  usage += TreeMemoryUsage(children_);
+  for (auto const& pair : children_) {
+    usage += pair.second->MemoryUsage();
+  }
+  return usage;
+}
+
 template<typename Frame>
 not_null<Trajectory<Frame> const*> Trajectory<Frame>::root() const {
   Trajectory const* ancestor = this;
@@ -240,27 +613,44 @@ template<typename Frame>
 void Trajectory<Frame>::set_intrinsic_acceleration(
     IntrinsicAcceleration const acceleration) {
   CHECK(body_->is_massless()) << "Trajectory is for a massive body";
-  CHECK(intrinsic_acceleration_ == nullptr)
+  CHECK(!has_intrinsic_acceleration())
       << "Trajectory already has an intrinsic acceleration";
   intrinsic_acceleration_ =
       std::make_unique<IntrinsicAcceleration>(acceleration);
 }
 
+template<typename Frame>
+void Trajectory<Frame>::set_intrinsic_acceleration(
+    AffineIntrinsicAcceleration const& acceleration) {
+  CHECK(body_->is_massless()) << "Trajectory is for a massive body";
+  CHECK(!has_intrinsic_acceleration())
+      << "Trajectory already has an intrinsic acceleration";
+  affine_intrinsic_acceleration_ =
+      std::make_unique<AffineIntrinsicAcceleration>(acceleration);
+}
+
 template<typename Frame>
 void Trajectory<Frame>::clear_intrinsic_acceleration() {
   intrinsic_acceleration_.reset();
+  affine_intrinsic_acceleration_.reset();
 }
 
 template<typename Frame>
 bool Trajectory<Frame>::has_intrinsic_acceleration() const {
-  return intrinsic_acceleration_ != nullptr;
+  return intrinsic_acceleration_ != nullptr ||
+         affine_intrinsic_acceleration_ != nullptr;
 }
 
 template<typename Frame>
 Vector<Acceleration, Frame> Trajectory<Frame>::evaluate_intrinsic_acceleration(
     Instant const& time) const {
-  if (intrinsic_acceleration_ != nullptr &&
+  if (has_intrinsic_acceleration() &&
       (fork_ == nullptr || time > fork_->timeline->first)) {
+    if (affine_intrinsic_acceleration_ != nullptr) {
+      return affine_intrinsic_acceleration_->acceleration +
+             (time - affine_intrinsic_acceleration_->epoch) *
+                 affine_intrinsic_acceleration_->jerk;
+    }
     return (*intrinsic_acceleration_)(time);
   } else {
     return Vector<Acceleration, Frame>({0 * SIUnit<Acceleration>(),
@@ -269,6 +659,176 @@ Vector<Acceleration, Frame> Trajectory<Frame>::evaluate_intrinsic_acceleration(
   }
 }
 
+template<typename Frame>
+void Trajectory<Frame>::set_downsampling(Downsampling const& downsampling) {
+  CHECK(downsampling_ == nullptr) << "Trajectory is already downsampled";
+  downsampling_ = std::make_unique<Downsampling>(downsampling);
+  if (!timeline_.empty()) {
+    downsampled_until_ = timeline_.begin()->first;
+  }
+}
+
+template<typename Frame>
+void Trajectory<Frame>::clear_downsampling() {
+  downsampling_.reset();
+}
+
+template<typename Frame>
+void Trajectory<Frame>::set_levels_of_detail(
+    std::vector<Length> const& tolerances) {
+  CHECK(is_root()) << "Levels of detail on a nonroot trajectory";
+  CHECK(levels_of_detail_.empty())
+      << "Trajectory already has levels of detail";
+  levels_of_detail_.resize(tolerances.size());
+  for (std::size_t i = 0; i < tolerances.size(); ++i) {
+    levels_of_detail_[i].tolerance = tolerances[i];
+  }
+  for (auto const& entry : timeline_) {
+    for (auto& level : levels_of_detail_) {
+      AppendToLevelOfDetail(entry.first, entry.second, &level);
+    }
+  }
+}
+
+template<typename Frame>
+int Trajectory<Frame>::number_of_levels_of_detail() const {
+  return levels_of_detail_.size();
+}
+
+template<typename Frame>
+Length const& Trajectory<Frame>::level_of_detail_tolerance(
+    int const level) const {
+  CHECK_LE(0, level);
+  CHECK_LT(level, number_of_levels_of_detail());
+  return levels_of_detail_[level].tolerance;
+}
+
+template<typename Frame>
+typename Trajectory<Frame>::LevelOfDetailPoints const&
+Trajectory<Frame>::level_of_detail(int const level) const {
+  CHECK_LE(0, level);
+  CHECK_LT(level, number_of_levels_of_detail());
+  return levels_of_detail_[level].points;
+}
+
+template<typename Frame>
+typename Trajectory<Frame>::Snapshot Trajectory<Frame>::snapshot() {
+  // Copy the points appended since the last snapshot into new blocks.
+  auto it = snapshot_blocks_.empty()
+                ? timeline_.begin()
+                : timeline_.UpperBound(snapshot_blocks_.back()->back().first);
+  while (it != timeline_.end()) {
+    auto const block = std::make_shared<typename Snapshot::Block>();
+    for (; it != timeline_.end() &&
+               block->size() < kMaximumSnapshotBlockSize;
+         ++it) {
+      block->push_back(*it);
+    }
+    snapshot_blocks_.push_back(block);
+  }
+  // Merge the last blocks while they are small compared to their predecessor,
+  // so that frequent snapshots don't fragment the storage.
+  while (snapshot_blocks_.size() >= 2) {
+    auto const& previous = snapshot_blocks_[snapshot_blocks_.size() - 2];
+    auto const& last = snapshot_blocks_.back();
+    std::size_t const begin =
+        snapshot_blocks_.size() == 2 ? snapshot_blocks_begin_ : 0;
+    std::size_t const previous_size = previous->size() - begin;
+    if (previous_size + last->size() > kMaximumSnapshotBlockSize ||
+        previous_size > 2 * last->size()) {
+      break;
+    }
+    auto const merged = std::make_shared<typename Snapshot::Block>(
+        previous->begin() + begin, previous->end());
+    merged->insert(merged->end(), last->begin(), last->end());
+    snapshot_blocks_.pop_back();
+    snapshot_blocks_.back() = merged;
+    if (snapshot_blocks_.size() == 1) {
+      snapshot_blocks_begin_ = 0;
+    }
+  }
+
+  Snapshot result;
+  if (!is_root()) {
+    result = parent_->snapshot();
+    result.ForgetAfter(*fork_time());
+  }
+  for (std::size_t i = 0; i < snapshot_blocks_.size(); ++i) {
+    result.pieces_.push_back({snapshot_blocks_[i],
+                              i == 0 ? snapshot_blocks_begin_ : 0,
+                              snapshot_blocks_[i]->size()});
+  }
+  return result;
+}
+
+template<typename Frame>
+std::int64_t Trajectory<Frame>::version() const {
+  return version_;
+}
+
+template<typename Frame>
+void Trajectory<Frame>::Observer::ForgotAfter(Trajectory const& trajectory,
+                                              Instant const& time) {}
+
+template<typename Frame>
+void Trajectory<Frame>::Observer::ForgotBefore(Trajectory const& trajectory,
+                                               Instant const& time) {}
+
+template<typename Frame>
+void Trajectory<Frame>::Observer::Forked(Trajectory const& trajectory,
+                                         Trajectory const& fork) {}
+
+template<typename Frame>
+void Trajectory<Frame>::Observer::ForkRemoved(Trajectory const& trajectory,
+                                              Trajectory const& fork) {}
+
+template<typename Frame>
+void Trajectory<Frame>::Observer::Destroyed(Trajectory const& trajectory) {}
+
+template<typename Frame>
+void Trajectory<Frame>::AddObserver(not_null<Observer*> const observer) const {
+  CHECK(std::find(observers_.begin(), observers_.end(), observer) ==
+        observers_.end()) << "Observer added twice";
+  observers_.push_back(observer);
+}
+
+template<typename Frame>
+void Trajectory<Frame>::RemoveObserver(
+    not_null<Observer*> const observer) const {
+  auto const it = std::find(observers_.begin(), observers_.end(), observer);
+  CHECK(it != observers_.end()) << "Observer not found";
+  observers_.erase(it);
+}
+
+template<typename Frame>
+void Trajectory<Frame>::PrepareForReclaim() {
+  for (auto const& pair : children_) {
+    pair.second->PrepareForReclaim();
+  }
+  for (not_null<Observer*> const observer : observers_) {
+    observer->Destroyed(*this);
+  }
+  observers_.clear();
+}
+
+template<typename Frame>
+void Trajectory<Frame>::set_past_evaluator(PastEvaluator past_evaluator) {
+  CHECK(is_root()) << "Past evaluator on a nonroot trajectory";
+  past_evaluator_ = std::move(past_evaluator);
+}
+
+template<typename Frame>
+void Trajectory<Frame>::set_gap_evaluator(GapEvaluator gap_evaluator) {
+  CHECK(is_root()) << "Gap evaluator on a nonroot trajectory";
+  gap_evaluator_ = std::move(gap_evaluator);
+}
+
+template<typename Frame>
+void Trajectory<Frame>::set_archive(not_null<Archive*> const archive,
+                                    Time const& horizon) {
+  timeline_.set_archive(archive, horizon);
+}
+
 template<typename Frame>
 void Trajectory<Frame>::WriteToMessage(
     not_null<serialization::Trajectory*> const message) const {
@@ -276,10 +836,68 @@ void Trajectory<Frame>::WriteToMessage(
   WriteSubTreeToMessage(message);
 }
 
+template<typename Frame>
+void Trajectory<Frame>::WriteIncrementToMessage(
+    Instant const& since,
+    not_null<serialization::Trajectory*> const message) const {
+  CHECK(is_root());
+  WriteChildrenToMessage(message);
+  since.WriteToMessage(message->mutable_increment_since());
+  auto const begin = timeline_.UpperBound(since);
+  int size = 0;
+  for (auto it = begin; it != timeline_.end(); ++it) {
+    ++size;
+  }
+  WriteTimelineToMessage(begin, size, message);
+}
+
+template<typename Frame>
+void Trajectory<Frame>::AppendIncrementToMessage(
+    serialization::Trajectory const& increment,
+    not_null<serialization::Trajectory*> const message) {
+  CHECK(increment.has_increment_since());
+  CHECK(!message->has_increment_since());
+  CHECK_EQ(0, message->timeline_size())
+      << "Increments cannot be appended to the pre-Columns format";
+  Instant const since = Instant::ReadFromMessage(increment.increment_since());
+  if (message->has_compressed_columns()) {
+    *message->mutable_columns() =
+        DecompressColumns(message->compressed_columns());
+    message->clear_compressed_columns();
+  }
+  serialization::Trajectory::Columns decompressed_increment_columns;
+  if (increment.has_compressed_columns()) {
+    decompressed_increment_columns =
+        DecompressColumns(increment.compressed_columns());
+  }
+  serialization::Trajectory::Columns const& increment_columns =
+      increment.has_compressed_columns() ? decompressed_increment_columns
+                                         : increment.columns();
+  if (increment.has_columns() || increment.has_compressed_columns()) {
+    Frame::ReadFromMessage(increment_columns.frame());
+    auto* const columns = message->mutable_columns();
+    if (columns->t_size() == 0) {
+      *columns->mutable_frame() = increment_columns.frame();
+    } else {
+      CHECK_LE(kJ2000 + columns->t(columns->t_size() - 1) * Second, since);
+    }
+    columns->mutable_t()->MergeFrom(increment_columns.t());
+    columns->mutable_x()->MergeFrom(increment_columns.x());
+    columns->mutable_y()->MergeFrom(increment_columns.y());
+    columns->mutable_z()->MergeFrom(increment_columns.z());
+    columns->mutable_vx()->MergeFrom(increment_columns.vx());
+    columns->mutable_vy()->MergeFrom(increment_columns.vy());
+    columns->mutable_vz()->MergeFrom(increment_columns.vz());
+  }
+  *message->mutable_children() = increment.children();
+}
+
 template<typename Frame>
 std::unique_ptr<Trajectory<Frame>> Trajectory<Frame>::ReadFromMessage(
     serialization::Trajectory const& message,
     not_null<Body const*> const body) {
+  CHECK(!message.has_increment_since())
+      << "An increment must be appended to the message of its base";
   auto trajectory = std::make_unique<Trajectory>(body);
   trajectory->FillSubTreeFromMessage(message);
   return trajectory;
@@ -292,13 +910,15 @@ void Trajectory<Frame>::WritePointerToMessage(
   while (ancestor->parent_ != nullptr) {
     const Fork& fork = *ancestor->fork_;
     ancestor = ancestor->parent_;
-    int const children_distance =
-        std::distance(ancestor->children_.begin(), fork.children);
-    int const timeline_distance =
-        std::distance(ancestor->timeline_.begin(), fork.timeline);
+    // The fork is identified by its time, so that the cost doesn't depend on
+    // the length of the timeline or on the number of children; the siblings
+    // forked at the same time are few.
+    Instant const& fork_time = fork.children->first;
+    int const sibling_index = std::distance(
+        ancestor->children_.lower_bound(fork_time), fork.children);
     auto* const fork_message = message->add_fork();
-    fork_message->set_children_distance(children_distance);
-    fork_message->set_timeline_distance(timeline_distance);
+    fork_time.WriteToMessage(fork_message->mutable_fork_time());
+    fork_message->set_sibling_index(sibling_index);
   }
 }
 
@@ -310,26 +930,153 @@ not_null<Trajectory<Frame>*> Trajectory<Frame>::ReadPointerFromMessage(
   not_null<Trajectory*> descendant = trajectory;
   for (int i = 0; i < message.fork_size(); ++i) {
     auto const& fork_message = message.fork(i);
-    int const children_distance = fork_message.children_distance();
-    int const timeline_distance = fork_message.timeline_distance();
-    auto children_it = descendant->children_.begin();
-    auto timeline_it = descendant->timeline_.begin();
-    std::advance(children_it, children_distance);
-    std::advance(timeline_it, timeline_distance);
+    typename Children::iterator children_it;
+    if (fork_message.has_fork_time()) {
+      Instant const fork_time =
+          Instant::ReadFromMessage(fork_message.fork_time());
+      children_it = descendant->children_.lower_bound(fork_time);
+      std::advance(children_it, fork_message.sibling_index());
+      CHECK(children_it != descendant->children_.end() &&
+            children_it->first == fork_time)
+          << "No fork " << fork_message.sibling_index() << " at " << fork_time;
+    } else {
+      // A save that predates the fork times.
+      CHECK(fork_message.has_children_distance());
+      children_it = descendant->children_.begin();
+      std::advance(children_it, fork_message.children_distance());
+    }
     descendant = children_it->second.get();
   }
   return descendant;
 }
 
+template<typename Frame>
+typename Trajectory<Frame>::Snapshot::Entry const&
+Trajectory<Frame>::Snapshot::Iterator::operator*() const {
+  return (*snapshot_->pieces_[piece_].block)[index_];
+}
+
+template<typename Frame>
+typename Trajectory<Frame>::Snapshot::Entry const*
+Trajectory<Frame>::Snapshot::Iterator::operator->() const {
+  return &**this;
+}
+
+template<typename Frame>
+typename Trajectory<Frame>::Snapshot::Iterator&
+Trajectory<Frame>::Snapshot::Iterator::operator++() {
+  ++index_;
+  if (index_ == snapshot_->pieces_[piece_].end) {
+    ++piece_;
+    index_ = piece_ == snapshot_->pieces_.size()
+                 ? 0
+                 : snapshot_->pieces_[piece_].begin;
+  }
+  return *this;
+}
+
+template<typename Frame>
+bool Trajectory<Frame>::Snapshot::Iterator::operator==(
+    Iterator const& right) const {
+  return snapshot_ == right.snapshot_ &&
+         piece_ == right.piece_ &&
+         index_ == right.index_;
+}
+
+template<typename Frame>
+bool Trajectory<Frame>::Snapshot::Iterator::operator!=(
+    Iterator const& right) const {
+  return !(*this == right);
+}
+
+template<typename Frame>
+Trajectory<Frame>::Snapshot::Iterator::Iterator(
+    not_null<Snapshot const*> const snapshot,
+    std::size_t const piece,
+    std::size_t const index)
+    : snapshot_(snapshot),
+      piece_(piece),
+      index_(index) {}
+
+template<typename Frame>
+bool Trajectory<Frame>::Snapshot::empty() const {
+  return pieces_.empty();
+}
+
+template<typename Frame>
+std::size_t Trajectory<Frame>::Snapshot::size() const {
+  std::size_t size = 0;
+  for (auto const& piece : pieces_) {
+    size += piece.end - piece.begin;
+  }
+  return size;
+}
+
+template<typename Frame>
+typename Trajectory<Frame>::Snapshot::Iterator
+Trajectory<Frame>::Snapshot::begin() const {
+  return pieces_.empty() ? end() : Iterator(this, 0, pieces_.front().begin);
+}
+
+template<typename Frame>
+typename Trajectory<Frame>::Snapshot::Iterator
+Trajectory<Frame>::Snapshot::end() const {
+  return Iterator(this, pieces_.size(), 0);
+}
+
+template<typename Frame>
+typename Trajectory<Frame>::Snapshot::Iterator
+Trajectory<Frame>::Snapshot::LowerBound(Instant const& time) const {
+  // The first piece whose last point is at or after |time|.
+  auto const piece = std::lower_bound(
+      pieces_.begin(),
+      pieces_.end(),
+      time,
+      [](Piece const& left, Instant const& right) {
+        return (*left.block)[left.end - 1].first < right;
+      });
+  if (piece == pieces_.end()) {
+    return end();
+  }
+  auto const entry = std::lower_bound(
+      piece->block->begin() + piece->begin,
+      piece->block->begin() + piece->end,
+      time,
+      [](Entry const& left, Instant const& right) {
+        return left.first < right;
+      });
+  return Iterator(this,
+                  piece - pieces_.begin(),
+                  entry - piece->block->begin());
+}
+
+template<typename Frame>
+void Trajectory<Frame>::Snapshot::ForgetAfter(Instant const& time) {
+  while (!pieces_.empty() &&
+         (*pieces_.back().block)[pieces_.back().begin].first > time) {
+    pieces_.pop_back();
+  }
+  if (!pieces_.empty()) {
+    Piece& last = pieces_.back();
+    while ((*last.block)[last.end - 1].first > time) {
+      --last.end;
+    }
+  }
+}
+
 template<typename Frame>
 typename Trajectory<Frame>::Iterator&
 Trajectory<Frame>::Iterator::operator++() {
-  if (!forks_.empty() && current_ == forks_.front().timeline) {
-    ancestry_.pop_front();
-    forks_.pop_front();
-    current_ = ancestry_.front()->timeline_.begin();
+  if (segment_ != trajectory_ && current_ == fork_point_) {
+    // Continue with the child of |segment_| that leads to |trajectory_|.
+    Trajectory const* child = trajectory_;
+    while (child->parent_ != segment_) {
+      child = child->parent_;
+    }
+    EnterSegment(child);
+    current_ = child->timeline_.begin();
   } else {
-    CHECK(current_ != ancestry_.front()->timeline_.end())
+    CHECK(current_ != segment_->timeline_.end())
         << "Incrementing beyond end of trajectory";
     ++current_;
   }
@@ -338,7 +1085,7 @@ Trajectory<Frame>::Iterator::operator++() {
 
 template<typename Frame>
 bool Trajectory<Frame>::Iterator::at_end() const {
-  return forks_.empty() && current_ == ancestry_.front()->timeline_.end();
+  return segment_ == trajectory_ && current_ == segment_->timeline_.end();
 }
 
 template<typename Frame>
@@ -349,46 +1096,46 @@ Instant const& Trajectory<Frame>::Iterator::time() const {
 template<typename Frame>
 void Trajectory<Frame>::Iterator::InitializeFirst(
     not_null<Trajectory const*> const trajectory) {
-  not_null<Trajectory const*> ancestor = trajectory;
-  while (ancestor->parent_ != nullptr) {
-    ancestry_.push_front(ancestor);
-    forks_.push_front(*ancestor->fork_);
-    ancestor = ancestor->parent_;
-  }
-  ancestry_.push_front(ancestor);
-  current_ = ancestor->timeline_.begin();
+  trajectory_ = trajectory;
+  not_null<Trajectory const*> const root = trajectory->root();
+  EnterSegment(root);
+  current_ = root->timeline_.begin();
 }
 
 template<typename Frame>
 void Trajectory<Frame>::Iterator::InitializeOnOrAfter(
   Instant const& time, not_null<Trajectory const*> const trajectory) {
-  not_null<Trajectory const*> ancestor = trajectory;
-  while (ancestor->fork_ != nullptr &&
-         time <= ancestor->fork_->timeline->first) {
-    ancestry_.push_front(ancestor);
-    forks_.push_front(*ancestor->fork_);
-    ancestor = ancestor->parent_;
-  }
-  ancestry_.push_front(ancestor);
-  current_ = ancestor->timeline_.lower_bound(time);
+  Hint hint;
+  InitializeOnOrAfter(time, trajectory, &hint);
+}
+
+template<typename Frame>
+void Trajectory<Frame>::Iterator::InitializeOnOrAfter(
+    Instant const& time,
+    not_null<Trajectory const*> const trajectory,
+    not_null<Hint*> const hint) {
+  trajectory_ = trajectory;
+  Trajectory const* segment;
+  current_ = trajectory->LowerBound(time, hint, &segment);
+  EnterSegment(segment);
 }
 
 template<typename Frame>
 void Trajectory<Frame>::Iterator::InitializeLast(
     not_null<Trajectory const*> const trajectory) {
-  // We don't need to really keep track of the forks or of the ancestry.
+  trajectory_ = trajectory;
   if (trajectory->timeline_.empty()) {
     CHECK(trajectory->fork_ != nullptr) << "Empty trajectory";
-    ancestry_.push_front(trajectory->parent_);
+    EnterSegment(trajectory->parent_);
     current_ = trajectory->fork_->timeline;
   } else {
-    ancestry_.push_front(trajectory);
+    EnterSegment(trajectory);
     current_ = --trajectory->timeline_.end();
   }
 }
 
 template<typename Frame>
-typename Trajectory<Frame>::Timeline::const_iterator
+typename Trajectory<Frame>::Timeline::Iterator
 Trajectory<Frame>::Iterator::current() const {
   return current_;
 }
@@ -396,7 +1143,20 @@ Trajectory<Frame>::Iterator::current() const {
 template<typename Frame>
 not_null<Trajectory<Frame> const*>
 Trajectory<Frame>::Iterator::trajectory() const {
-  return ancestry_.back();
+  return trajectory_;
+}
+
+template<typename Frame>
+void Trajectory<Frame>::Iterator::EnterSegment(
+    not_null<Trajectory const*> const segment) {
+  segment_ = segment;
+  if (segment != trajectory_) {
+    Trajectory const* child = trajectory_;
+    while (child->parent_ != segment) {
+      child = child->parent_;
+    }
+    fork_point_ = child->fork_->timeline;
+  }
 }
 
 template<typename Frame>
@@ -406,20 +1166,112 @@ Trajectory<Frame>::NativeIterator::degrees_of_freedom() const {
 }
 
 template<typename Frame>
-template<typename ToFrame>
+template<typename ToFrame, typename TransformFunctor>
 DegreesOfFreedom<ToFrame>
-Trajectory<Frame>::TransformingIterator<ToFrame>::degrees_of_freedom() const {
+Trajectory<Frame>::TransformingIterator<ToFrame, TransformFunctor>::
+degrees_of_freedom() const {
   auto it = this->current();
   return transform_(it->first, it->second, this->trajectory());
 }
 
 template<typename Frame>
-template<typename ToFrame>
-Trajectory<Frame>::TransformingIterator<ToFrame>::TransformingIterator(
-    Transform<ToFrame> const& transform)
+template<typename ToFrame, typename TransformFunctor>
+Trajectory<Frame>::TransformingIterator<ToFrame, TransformFunctor>::
+TransformingIterator(TransformFunctor const& transform)
     : Iterator(),
       transform_(transform) {}
 
+template<typename Frame>
+Instant const& Trajectory<Frame>::TimeProjection::Get(
+    NativeIterator const& it) {
+  return it.time();
+}
+
+template<typename Frame>
+Position<Frame> const& Trajectory<Frame>::PositionProjection::Get(
+    NativeIterator const& it) {
+  return it.degrees_of_freedom().position();
+}
+
+template<typename Frame>
+Velocity<Frame> const& Trajectory<Frame>::VelocityProjection::Get(
+    NativeIterator const& it) {
+  return it.degrees_of_freedom().velocity();
+}
+
+template<typename Frame>
+template<typename Projection>
+typename Trajectory<Frame>::template ViewIterator<Projection>::reference
+Trajectory<Frame>::ViewIterator<Projection>::operator*() const {
+  return Projection::Get(iterator_);
+}
+
+template<typename Frame>
+template<typename Projection>
+typename Trajectory<Frame>::template ViewIterator<Projection>::pointer
+Trajectory<Frame>::ViewIterator<Projection>::operator->() const {
+  return &Projection::Get(iterator_);
+}
+
+template<typename Frame>
+template<typename Projection>
+typename Trajectory<Frame>::template ViewIterator<Projection>&
+Trajectory<Frame>::ViewIterator<Projection>::operator++() {
+  ++iterator_;
+  return *this;
+}
+
+template<typename Frame>
+template<typename Projection>
+bool Trajectory<Frame>::ViewIterator<Projection>::operator==(
+    ViewIterator const& right) const {
+  if (at_end() || right.at_end()) {
+    return at_end() == right.at_end();
+  }
+  // The times of the points of a trajectory are distinct.
+  return iterator_.time() == right.iterator_.time();
+}
+
+template<typename Frame>
+template<typename Projection>
+bool Trajectory<Frame>::ViewIterator<Projection>::operator!=(
+    ViewIterator const& right) const {
+  return !(*this == right);
+}
+
+template<typename Frame>
+template<typename Projection>
+Trajectory<Frame>::ViewIterator<Projection>::ViewIterator(
+    NativeIterator const& iterator,
+    bool const at_end)
+    : iterator_(iterator),
+      at_end_(at_end) {}
+
+template<typename Frame>
+template<typename Projection>
+bool Trajectory<Frame>::ViewIterator<Projection>::at_end() const {
+  return at_end_ || iterator_.at_end();
+}
+
+template<typename Frame>
+template<typename Projection>
+typename Trajectory<Frame>::template ViewIterator<Projection>
+Trajectory<Frame>::View<Projection>::begin() const {
+  return ViewIterator<Projection>(first_, false /*at_end*/);
+}
+
+template<typename Frame>
+template<typename Projection>
+typename Trajectory<Frame>::template ViewIterator<Projection>
+Trajectory<Frame>::View<Projection>::end() const {
+  return ViewIterator<Projection>(first_, true /*at_end*/);
+}
+
+template<typename Frame>
+template<typename Projection>
+Trajectory<Frame>::View<Projection>::View(NativeIterator const& first)
+    : first_(first) {}
+
 template<typename Frame>
 Trajectory<Frame>::Trajectory(not_null<Body const*> const body,
                               not_null<Trajectory*> const parent,
@@ -431,6 +1283,15 @@ Trajectory<Frame>::Trajectory(not_null<Body const*> const body,
 template<typename Frame>
 void Trajectory<Frame>::WriteSubTreeToMessage(
     not_null<serialization::Trajectory*> const message) const {
+  WriteChildrenToMessage(message);
+  WriteTimelineToMessage(timeline_.begin(),
+                         static_cast<int>(timeline_.size()),
+                         message);
+}
+
+template<typename Frame>
+void Trajectory<Frame>::WriteChildrenToMessage(
+    not_null<serialization::Trajectory*> const message) const {
   Instant last_instant;
   bool is_first = true;
   serialization::Trajectory::Litter* litter = nullptr;
@@ -445,40 +1306,338 @@ void Trajectory<Frame>::WriteSubTreeToMessage(
     }
     child->WriteSubTreeToMessage(litter->add_trajectories());
   }
-  for (auto const& pair : timeline_) {
-    Instant const& instant = pair.first;
-    DegreesOfFreedom<Frame> const& degrees_of_freedom = pair.second;
-    auto const instantaneous_degrees_of_freedom = message->add_timeline();
-    instant.WriteToMessage(instantaneous_degrees_of_freedom->mutable_instant());
-    degrees_of_freedom.WriteToMessage(
-        instantaneous_degrees_of_freedom->mutable_degrees_of_freedom());
+}
+
+template<typename Frame>
+void Trajectory<Frame>::WriteTimelineToMessage(
+    typename Timeline::Iterator begin,
+    int const size,
+    not_null<serialization::Trajectory*> const message) const {
+  if (size == 0) {
+    return;
+  }
+  serialization::Trajectory::Columns* const columns =
+      message->mutable_columns();
+  Frame::WriteToMessage(columns->mutable_frame());
+  columns->mutable_t()->Reserve(size);
+  columns->mutable_x()->Reserve(size);
+  columns->mutable_y()->Reserve(size);
+  columns->mutable_z()->Reserve(size);
+  columns->mutable_vx()->Reserve(size);
+  columns->mutable_vy()->Reserve(size);
+  columns->mutable_vz()->Reserve(size);
+  for (auto it = begin; it != timeline_.end(); ++it) {
+    Instant const& instant = it->first;
+    DegreesOfFreedom<Frame> const& degrees_of_freedom = it->second;
+    R3Element<Length> const position =
+        (degrees_of_freedom.position() - Frame::origin).coordinates();
+    R3Element<Speed> const velocity =
+        degrees_of_freedom.velocity().coordinates();
+    columns->add_t((instant - kJ2000) / Second);
+    columns->add_x(position.x / Metre);
+    columns->add_y(position.y / Metre);
+    columns->add_z(position.z / Metre);
+    columns->add_vx(velocity.x / (Metre / Second));
+    columns->add_vy(velocity.y / (Metre / Second));
+    columns->add_vz(velocity.z / (Metre / Second));
   }
 }
 
 template<typename Frame>
 void Trajectory<Frame>::FillSubTreeFromMessage(
     serialization::Trajectory const& message) {
-  auto timeline_it = message.timeline().begin();
+  // The timeline is in |columns|, in |compressed_columns| or, for old saves,
+  // in |timeline|.
+  serialization::Trajectory::Columns decompressed_columns;
+  if (message.has_compressed_columns()) {
+    CHECK(!message.has_columns());
+    decompressed_columns = DecompressColumns(message.compressed_columns());
+  }
+  bool const has_columns =
+      message.has_columns() || message.has_compressed_columns();
+  serialization::Trajectory::Columns const& columns =
+      message.has_compressed_columns() ? decompressed_columns
+                                       : message.columns();
+  int size;
+  if (has_columns) {
+    CHECK_EQ(0, message.timeline_size());
+    Frame::ReadFromMessage(columns.frame());
+    size = columns.t_size();
+    CHECK_EQ(size, columns.x_size());
+    CHECK_EQ(size, columns.y_size());
+    CHECK_EQ(size, columns.z_size());
+    CHECK_EQ(size, columns.vx_size());
+    CHECK_EQ(size, columns.vy_size());
+    CHECK_EQ(size, columns.vz_size());
+  } else {
+    size = message.timeline_size();
+  }
+  auto const time = [has_columns, &columns, &message](int const i) {
+    return has_columns
+               ? kJ2000 + columns.t(i) * Second
+               : Instant::ReadFromMessage(message.timeline(i).instant());
+  };
+  auto const degrees_of_freedom =
+      [has_columns, &columns, &message](int const i) {
+        return has_columns
+                   ? DegreesOfFreedom<Frame>(
+                         Frame::origin +
+                             Vector<Length, Frame>({columns.x(i) * Metre,
+                                                    columns.y(i) * Metre,
+                                                    columns.z(i) * Metre}),
+                         Velocity<Frame>({columns.vx(i) * (Metre / Second),
+                                          columns.vy(i) * (Metre / Second),
+                                          columns.vz(i) * (Metre / Second)}))
+                   : DegreesOfFreedom<Frame>::ReadFromMessage(
+                         message.timeline(i).degrees_of_freedom());
+      };
+
+  int i = 0;
   for (serialization::Trajectory::Litter const& litter : message.children()) {
     Instant const fork_time = Instant::ReadFromMessage(litter.fork_time());
-    for (;
-         timeline_it != message.timeline().end() &&
-         Instant::ReadFromMessage(timeline_it->instant()) <= fork_time;
-         ++timeline_it) {
-      Append(Instant::ReadFromMessage(timeline_it->instant()),
-             DegreesOfFreedom<Frame>::ReadFromMessage(
-                 timeline_it->degrees_of_freedom()));
+    for (; i < size && time(i) <= fork_time; ++i) {
+      Append(time(i), degrees_of_freedom(i));
     }
     for (serialization::Trajectory const& child : litter.trajectories()) {
       NewFork(fork_time)->FillSubTreeFromMessage(child);
     }
   }
-  for (; timeline_it != message.timeline().end(); ++timeline_it) {
-    Append(Instant::ReadFromMessage(timeline_it->instant()),
-           DegreesOfFreedom<Frame>::ReadFromMessage(
-               timeline_it->degrees_of_freedom()));
+  for (; i < size; ++i) {
+    Append(time(i), degrees_of_freedom(i));
   }
 }
 
+template<typename Frame>
+void Trajectory<Frame>::AppendToLevelOfDetail(
+    Instant const& time,
+    DegreesOfFreedom<Frame> const& degrees_of_freedom,
+    not_null<LevelOfDetail*> const level) {
+  auto& points = level->points;
+  if (!level->last_is_provisional) {
+    // The first point is always retained, the others become provisional.
+    level->last_is_provisional = !points.empty();
+    points.emplace_back(time, degrees_of_freedom);
+    return;
+  }
+
+  // Check if the provisional point and those dropped before it may be dropped
+  // in favour of the new point.
+  Position<Frame> const& anchor = points[points.size() - 2].second.position();
+  Position<Frame> const& provisional = points.back().second.position();
+  Position<Frame> const& position = degrees_of_freedom.position();
+  bool may_drop =
+      level->dropped.size() < kMaximumLevelOfDetailDroppedPoints &&
+      DistanceToSegment(provisional, anchor, position) <= level->tolerance;
+  for (auto const& dropped : level->dropped) {
+    if (!may_drop) {
+      break;
+    }
+    may_drop = DistanceToSegment(dropped, anchor, position) <=
+                   level->tolerance;
+  }
+  if (may_drop) {
+    level->dropped.push_back(provisional);
+    points.back() = {time, degrees_of_freedom};
+  } else {
+    // The provisional point is retained.
+    level->dropped.clear();
+    points.emplace_back(time, degrees_of_freedom);
+  }
+}
+
+template<typename Frame>
+Length Trajectory<Frame>::DistanceToSegment(Position<Frame> const& point,
+                                            Position<Frame> const& begin,
+                                            Position<Frame> const& end) {
+  Displacement<Frame> const segment = end - begin;
+  Displacement<Frame> const from_begin = point - begin;
+  auto const segment_norm_squared = InnerProduct(segment, segment);
+  auto const projection = InnerProduct(from_begin, segment);
+  if (projection <= decltype(projection)()) {
+    return from_begin.Norm();
+  } else if (projection >= segment_norm_squared) {
+    return (point - end).Norm();
+  } else {
+    return (from_begin - segment * (projection / segment_norm_squared)).Norm();
+  }
+}
+
+template<typename Frame>
+void Trajectory<Frame>::EraseChildren(
+    typename Children::const_iterator const first,
+    typename Children::const_iterator const last) {
+  for (auto it = first; it != last; ++it) {
+    for (not_null<Observer*> const observer : observers_) {
+      observer->ForkRemoved(*this, *it->second);
+    }
+  }
+  children_.erase(first, last);
+}
+
+template<typename Frame>
+void Trajectory<Frame>::IncrementVersions() {
+  ++version_;
+  for (auto const& pair : children_) {
+    pair.second->IncrementVersions();
+  }
+}
+
+template<typename Frame>
+void Trajectory<Frame>::ForgotAfter(Instant const& time) {
+  ++version_;
+  for (not_null<Observer*> const observer : observers_) {
+    observer->ForgotAfter(*this, time);
+  }
+}
+
+template<typename Frame>
+void Trajectory<Frame>::ForgotBefore(Instant const& time) {
+  ++version_;
+  for (not_null<Observer*> const observer : observers_) {
+    observer->ForgotBefore(*this, time);
+  }
+  for (auto const& pair : children_) {
+    pair.second->ForgotBefore(time);
+  }
+}
+
+template<typename Frame>
+void Trajectory<Frame>::MoveChild(not_null<Trajectory*> const child,
+                                  Instant const& time) {
+  // Erasing an empty range yields a mutable iterator.
+  auto const child_it =
+      children_.erase(child->fork_->children, child->fork_->children);
+  if (child_it->first != time) {
+    not_null<std::unique_ptr<Trajectory>> owned = std::move(child_it->second);
+    children_.erase(child_it);
+    child->fork_->children = children_.emplace(time, std::move(owned));
+  }
+}
+
+template<typename Frame>
+void Trajectory<Frame>::ForgetSnapshotBlocksAfter(Instant const& time) {
+  while (!snapshot_blocks_.empty() &&
+         snapshot_blocks_.back()->back().first > time) {
+    snapshot_blocks_.pop_back();
+  }
+  if (snapshot_blocks_.empty()) {
+    snapshot_blocks_begin_ = 0;
+  }
+}
+
+template<typename Frame>
+void Trajectory<Frame>::Downsample(Instant const& time) {
+  // A bound on the number of consecutive points that are removed, so that the
+  // cost of the search below remains linear in the number of points.
+  std::size_t const max_gap = 64;
+
+  typename Timeline::Iterator const first =
+      timeline_.LowerBound(downsampled_until_);
+  typename Timeline::Iterator const last = timeline_.UpperBound(time);
+  std::vector<typename Timeline::Entry const*> points;
+  for (auto it = first; it != last; ++it) {
+    points.push_back(&*it);
+  }
+  if (points.empty()) {
+    return;
+  }
+  Instant const last_time = points.back()->first;
+  // The points after the first one may be removed.
+  ForgetSnapshotBlocksAfter(points.front()->first);
+
+  // Returns true if the points strictly between |i| and |j| may be recovered
+  // from |i| and |j|.
+  auto const may_be_interpolated = [this, &points](std::size_t const i,
+                                                   std::size_t const j) {
+    for (std::size_t k = i + 1; k < j; ++k) {
+      DegreesOfFreedom<Frame> const interpolated =
+          Interpolate(*points[i], *points[j], points[k]->first);
+      if ((interpolated.position() - points[k]->second.position()).Norm() >
+          downsampling_->tolerance) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  // Greedily retain the farthest point from which the previous retained point
+  // may be interpolated.
+  std::vector<bool> retained(points.size(), false);
+  retained.front() = true;
+  retained.back() = true;
+  for (std::size_t i = 0; i + 1 < points.size();) {
+    std::size_t j = i + 1;
+    while (j + 1 < points.size() &&
+           j - i < max_gap &&
+           children_.find(points[j]->first) == children_.end() &&
+           may_be_interpolated(i, j + 1)) {
+      ++j;
+    }
+    retained[j] = true;
+    i = j;
+  }
+
+  std::size_t index = 0;
+  timeline_.ForgetIf(first,
+                     last,
+                     [&index, &retained](typename Timeline::Entry const&) {
+                       return !retained[index++];
+                     });
+  downsampled_until_ = last_time;
+  // The compaction of the timeline has invalidated the forks of our children.
+  for (auto const& pair : children_) {
+    pair.second->fork_->timeline = timeline_.Find(pair.first);
+  }
+  IncrementVersions();
+}
+
+template<typename Frame>
+typename Trajectory<Frame>::Timeline::Iterator Trajectory<Frame>::LowerBound(
+    Instant const& time,
+    not_null<Hint*> const hint,
+    not_null<Trajectory const**> const segment) const {
+  // Find the trajectory whose timeline contains the first point at or after
+  // |time|.
+  not_null<Trajectory const*> ancestor = this;
+  while (ancestor->fork_ != nullptr &&
+         time <= ancestor->fork_->timeline->first) {
+    ancestor = ancestor->parent_;
+  }
+  if (hint->ancestor_ == ancestor) {
+    hint->upper_ = ancestor->timeline_.LowerBound(hint->upper_, time);
+  } else {
+    hint->ancestor_ = ancestor;
+    hint->upper_ = ancestor->timeline_.LowerBound(time);
+  }
+  *segment = ancestor;
+  return hint->upper_;
+}
+
+template<typename Frame>
+DegreesOfFreedom<Frame> Trajectory<Frame>::Interpolate(
+    typename Timeline::Entry const& left,
+    typename Timeline::Entry const& right,
+    Instant const& time) {
+  Time const h = right.first - left.first;
+  double const s = (time - left.first) / h;
+  double const s² = s * s;
+  double const s³ = s² * s;
+  // The Hermite basis polynomials other than h00, which only contributes
+  // through h00 + h01 = 1, and their derivatives.
+  double const h10 = s³ - 2 * s² + s;
+  double const h01 = -2 * s³ + 3 * s²;
+  double const h11 = s³ - s²;
+  double const dh10 = 3 * s² - 4 * s + 1;
+  double const dh01 = -6 * s² + 6 * s;
+  double const dh11 = 3 * s² - 2 * s;
+  Vector<Length, Frame> const Δq =
+      right.second.position() - left.second.position();
+  Velocity<Frame> const& v0 = left.second.velocity();
+  Velocity<Frame> const& v1 = right.second.velocity();
+  return DegreesOfFreedom<Frame>(
+      left.second.position() + (h01 * Δq + h * (h10 * v0 + h11 * v1)),
+      dh01 * Δq / h + dh10 * v0 + dh11 * v1);
+}
+
 }  // namespace physics
 }  // namespace principia
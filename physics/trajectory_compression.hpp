@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+
+#include "base/not_null.hpp"
+#include "google/protobuf/repeated_field.h"
+#include "serialization/physics.pb.h"
+
+using principia::base::not_null;
+
+namespace principia {
+namespace physics {
+
+// Lossless compression of the columns of serialized trajectories.
+// Each column is a sequence of doubles whose bit patterns, taken as 64-bit
+// integers, are predicted by quadratic extrapolation from the three previous
+// ones.  For equally spaced times the prediction is exact, as with
+// delta-of-delta encoding; for the coordinates, which vary smoothly, it gets
+// the sign, the exponent and the leading bits of the mantissa right.  The
+// difference between a bit pattern and its prediction is written as a single
+// 0 bit if it is zero, and otherwise as a 1 bit followed by its number of
+// significant bits and the bits themselves, as in Gorilla.  The prediction
+// uses integer arithmetic only, so the decoding is exact on all platforms.
+
+// Returns the compressed encoding of |column|.
+std::string CompressColumn(
+    google::protobuf::RepeatedField<double> const& column);
+
+// Appends to |column| the |size| values encoded in |compressed|.
+void DecompressColumn(std::string const& compressed,
+                      int const size,
+                      not_null<google::protobuf::RepeatedField<double>*> const
+                          column);
+
+// Replaces the |columns| of |message| and of its descendants by the equivalent
+// |compressed_columns|.
+void CompressColumns(not_null<serialization::Trajectory*> const message);
+
+// Returns the uncompressed form of |compressed_columns|.
+serialization::Trajectory::Columns DecompressColumns(
+    serialization::Trajectory::CompressedColumns const& compressed_columns);
+
+}  // namespace physics
+}  // namespace principia
+
+#include "physics/trajectory_compression_body.hpp"
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "physics/trajectory_compression.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace physics {
+
+namespace {
+
+// Writes sequences of bits, most significant bit first, to a string of bytes.
+class BitWriter {
+ public:
+  explicit BitWriter(not_null<std::string*> const bytes) : bytes_(bytes) {}
+
+  // Writes the |count| low-order bits of |bits|.  |count| must be in [1, 64].
+  void Write(std::uint64_t const bits, int count) {
+    while (count > 0) {
+      int const taken = std::min(count, 8 - buffered_);
+      count -= taken;
+      current_ = (current_ << taken) |
+                 ((bits >> count) & ((1u << taken) - 1));
+      buffered_ += taken;
+      if (buffered_ == 8) {
+        bytes_->push_back(static_cast<char>(current_));
+        current_ = 0;
+        buffered_ = 0;
+      }
+    }
+  }
+
+  // Pads the last byte with zeros.  Must be called once, after the last
+  // |Write|.
+  void Flush() {
+    if (buffered_ > 0) {
+      bytes_->push_back(static_cast<char>(current_ << (8 - buffered_)));
+    }
+  }
+
+ private:
+  not_null<std::string*> const bytes_;
+  unsigned int current_ = 0;
+  int buffered_ = 0;
+};
+
+// Reads the bits written by a |BitWriter|.
+class BitReader {
+ public:
+  explicit BitReader(std::string const& bytes) : bytes_(bytes) {}
+
+  // Reads |count| bits, which must be in [1, 64].
+  std::uint64_t Read(int count) {
+    std::uint64_t result = 0;
+    while (count > 0) {
+      if (available_ == 0) {
+        CHECK_LT(position_, bytes_.size()) << "Truncated column";
+        current_ = static_cast<unsigned char>(bytes_[position_]);
+        ++position_;
+        available_ = 8;
+      }
+      int const taken = std::min(count, available_);
+      count -= taken;
+      available_ -= taken;
+      result = (result << taken) |
+               ((current_ >> available_) & ((1u << taken) - 1));
+    }
+    return result;
+  }
+
+ private:
+  std::string const& bytes_;
+  std::size_t position_ = 0;
+  unsigned int current_ = 0;
+  int available_ = 0;
+};
+
+// The number of bits needed to represent |value|, in [0, 64].
+inline int SignificantBits(std::uint64_t value) {
+  int bits = 0;
+  for (int shift = 32; shift > 0; shift /= 2) {
+    if ((value >> shift) != 0) {
+      value >>= shift;
+      bits += shift;
+    }
+  }
+  return bits + static_cast<int>(value);
+}
+
+// The bit patterns of the last three values of a column, most recent first,
+// and the quadratic extrapolation from them.
+class Predictor {
+ public:
+  // The prediction of the next bit pattern.  Uses wrapping unsigned
+  // arithmetic, so the result is well-defined.
+  std::uint64_t Predict() const {
+    switch (count_) {
+      case 0:
+        return 0;
+      case 1:
+        return last_[0];
+      case 2:
+        return 2 * last_[0] - last_[1];
+      default:
+        return 3 * last_[0] - 3 * last_[1] + last_[2];
+    }
+  }
+
+  void Push(std::uint64_t const bits) {
+    last_[2] = last_[1];
+    last_[1] = last_[0];
+    last_[0] = bits;
+    count_ = std::min(count_ + 1, 3);
+  }
+
+ private:
+  std::uint64_t last_[3] = {0, 0, 0};
+  int count_ = 0;
+};
+
+}  // namespace
+
+inline std::string CompressColumn(
+    google::protobuf::RepeatedField<double> const& column) {
+  std::string compressed;
+  BitWriter writer(&compressed);
+  Predictor predictor;
+  for (int i = 0; i < column.size(); ++i) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &column.Get(i), sizeof(bits));
+    std::uint64_t const residual = bits - predictor.Predict();
+    // Zigzag encoding, so that small negative residuals have few significant
+    // bits.
+    std::uint64_t const zigzag = (residual << 1) ^ (0 - (residual >> 63));
+    if (zigzag == 0) {
+      writer.Write(0, 1);
+    } else {
+      int const significant_bits = SignificantBits(zigzag);
+      writer.Write(1, 1);
+      writer.Write(significant_bits - 1, 6);
+      writer.Write(zigzag, significant_bits);
+    }
+    predictor.Push(bits);
+  }
+  writer.Flush();
+  return compressed;
+}
+
+inline void DecompressColumn(
+    std::string const& compressed,
+    int const size,
+    not_null<google::protobuf::RepeatedField<double>*> const column) {
+  BitReader reader(compressed);
+  column->Reserve(column->size() + size);
+  Predictor predictor;
+  for (int i = 0; i < size; ++i) {
+    std::uint64_t zigzag = 0;
+    if (reader.Read(1) == 1) {
+      int const significant_bits = static_cast<int>(reader.Read(6)) + 1;
+      zigzag = reader.Read(significant_bits);
+    }
+    std::uint64_t const residual = (zigzag >> 1) ^ (0 - (zigzag & 1));
+    std::uint64_t const bits = residual + predictor.Predict();
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    column->Add(value);
+    predictor.Push(bits);
+  }
+}
+
+inline void CompressColumns(
+    not_null<serialization::Trajectory*> const message) {
+  if (message->has_columns()) {
+    serialization::Trajectory::Columns const& columns = message->columns();
+    serialization::Trajectory::CompressedColumns* const compressed_columns =
+        message->mutable_compressed_columns();
+    *compressed_columns->mutable_frame() = columns.frame();
+    compressed_columns->set_size(columns.t_size());
+    compressed_columns->set_t(CompressColumn(columns.t()));
+    compressed_columns->set_x(CompressColumn(columns.x()));
+    compressed_columns->set_y(CompressColumn(columns.y()));
+    compressed_columns->set_z(CompressColumn(columns.z()));
+    compressed_columns->set_vx(CompressColumn(columns.vx()));
+    compressed_columns->set_vy(CompressColumn(columns.vy()));
+    compressed_columns->set_vz(CompressColumn(columns.vz()));
+    message->clear_columns();
+  }
+  for (auto& litter : *message->mutable_children()) {
+    for (auto& child : *litter.mutable_trajectories()) {
+      CompressColumns(&child);
+    }
+  }
+}
+
+inline serialization::Trajectory::Columns DecompressColumns(
+    serialization::Trajectory::CompressedColumns const& compressed_columns) {
+  serialization::Trajectory::Columns columns;
+  int const size = compressed_columns.size();
+  *columns.mutable_frame() = compressed_columns.frame();
+  DecompressColumn(compressed_columns.t(), size, columns.mutable_t());
+  DecompressColumn(compressed_columns.x(), size, columns.mutable_x());
+  DecompressColumn(compressed_columns.y(), size, columns.mutable_y());
+  DecompressColumn(compressed_columns.z(), size, columns.mutable_z());
+  DecompressColumn(compressed_columns.vx(), size, columns.mutable_vx());
+  DecompressColumn(compressed_columns.vy(), size, columns.mutable_vy());
+  DecompressColumn(compressed_columns.vz(), size, columns.mutable_vz());
+  return columns;
+}
+
+}  // namespace physics
+}  // namespace principia
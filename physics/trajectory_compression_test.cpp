@@ -0,0 +1,130 @@
+#include "physics/trajectory_compression.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+
+#include "geometry/frame.hpp"
+#include "geometry/grassmann.hpp"
+#include "geometry/named_quantities.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "physics/degrees_of_freedom.hpp"
+#include "physics/massless_body.hpp"
+#include "physics/trajectory.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+
+using principia::geometry::Frame;
+using principia::geometry::Instant;
+using principia::geometry::Position;
+using principia::geometry::Vector;
+using principia::geometry::Velocity;
+using principia::quantities::Length;
+using principia::si::Metre;
+using principia::si::Second;
+using testing::Eq;
+using testing::Lt;
+
+namespace principia {
+namespace physics {
+
+class TrajectoryCompressionTest : public testing::Test {
+ protected:
+  using World = Frame<serialization::Frame::TestTag,
+                      serialization::Frame::TEST, true>;
+
+  // Expects |column| to survive compression bit for bit, and returns the size
+  // of its compressed form in bytes.
+  static std::size_t ExpectLossless(
+      google::protobuf::RepeatedField<double> const& column) {
+    std::string const compressed = CompressColumn(column);
+    google::protobuf::RepeatedField<double> decompressed;
+    DecompressColumn(compressed, column.size(), &decompressed);
+    EXPECT_THAT(decompressed.size(), Eq(column.size()));
+    for (int i = 0; i < column.size(); ++i) {
+      std::uint64_t expected;
+      std::uint64_t actual;
+      std::memcpy(&expected, &column.Get(i), sizeof(expected));
+      std::memcpy(&actual, &decompressed.Get(i), sizeof(actual));
+      EXPECT_THAT(actual, Eq(expected)) << i;
+    }
+    return compressed.size();
+  }
+};
+
+TEST_F(TrajectoryCompressionTest, Empty) {
+  google::protobuf::RepeatedField<double> column;
+  EXPECT_THAT(ExpectLossless(column), Eq(0));
+}
+
+TEST_F(TrajectoryCompressionTest, SpecialValues) {
+  google::protobuf::RepeatedField<double> column;
+  column.Add(0.0);
+  column.Add(-0.0);
+  column.Add(std::numeric_limits<double>::infinity());
+  column.Add(-std::numeric_limits<double>::infinity());
+  column.Add(std::numeric_limits<double>::quiet_NaN());
+  column.Add(std::numeric_limits<double>::denorm_min());
+  column.Add(std::numeric_limits<double>::max());
+  column.Add(-std::numeric_limits<double>::max());
+  column.Add(1.0);
+  ExpectLossless(column);
+}
+
+// Equally spaced times cost one bit per point, and smooth coordinates much less
+// than 64 bits.
+TEST_F(TrajectoryCompressionTest, Ratios) {
+  int const size = 10000;
+  google::protobuf::RepeatedField<double> times;
+  google::protobuf::RepeatedField<double> coordinates;
+  for (int i = 0; i < size; ++i) {
+    times.Add(1E8 + 10.0 * i);
+    coordinates.Add(1.5E11 * std::cos(2E-6 * i));
+  }
+  EXPECT_THAT(ExpectLossless(times), Lt(size / 8 + 100));
+  EXPECT_THAT(ExpectLossless(coordinates), Lt(size * 8 / 5));
+}
+
+TEST_F(TrajectoryCompressionTest, Trajectory) {
+  MasslessBody body;
+  Trajectory<World> trajectory(&body);
+  for (int i = 0; i < 100; ++i) {
+    Length const x = std::cos(0.01 * i) * Metre;
+    trajectory.Append(
+        Instant(10 * i * Second),
+        DegreesOfFreedom<World>(
+            World::origin + Vector<Length, World>({x, 2 * x, 3 * x}),
+            Velocity<World>({i * Metre / Second,
+                             2 * Metre / Second,
+                             3 * Metre / Second})));
+  }
+  trajectory.NewFork(Instant(500 * Second))->Append(
+      Instant(2000 * Second),
+      DegreesOfFreedom<World>(World::origin, Velocity<World>()));
+
+  serialization::Trajectory reference_message;
+  trajectory.WriteToMessage(&reference_message);
+  serialization::Trajectory message = reference_message;
+  CompressColumns(&message);
+  EXPECT_FALSE(message.has_columns());
+  EXPECT_TRUE(message.has_compressed_columns());
+  EXPECT_THAT(message.compressed_columns().size(), Eq(100));
+  EXPECT_TRUE(message.children(0).trajectories(0).has_compressed_columns());
+  EXPECT_THAT(DecompressColumns(message.compressed_columns())
+                  .SerializeAsString(),
+              Eq(reference_message.columns().SerializeAsString()));
+
+  std::unique_ptr<Trajectory<World>> const deserialized_trajectory =
+      Trajectory<World>::ReadFromMessage(message, &body);
+  message.Clear();
+  deserialized_trajectory->WriteToMessage(&message);
+  EXPECT_THAT(message.SerializeAsString(),
+              Eq(reference_message.SerializeAsString()));
+}
+
+}  // namespace physics
+}  // namespace principia
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "base/mapped_file.hpp"
+#include "base/not_null.hpp"
+#include "geometry/named_quantities.hpp"
+#include "physics/degrees_of_freedom.hpp"
+#include "physics/trajectory.hpp"
+
+using principia::base::not_null;
+using principia::base::ReadOnlyMappedFile;
+using principia::geometry::Instant;
+
+namespace principia {
+namespace physics {
+
+// A columnar file of the points of trajectories, meant for offline analysis.
+// Each point is a row made of the time, the position and the velocity, and an
+// integer identifying the body, chosen by the writer.  The file is written by
+// streaming, one block of rows at a time, and is read by mapping it in memory,
+// so that the columns are accessed in place.  The file is in the native byte
+// order of the machine that wrote it.
+//
+// The layout of the file is a |Header|, followed by |number_of_blocks|
+// blocks.  A block is a |BlockHeader| giving its number of rows n, followed by
+// the columns t, x, y, z, vx, vy, vz and body, each of n elements, in this
+// order.  t is in seconds from |Instant()|, x, y, z in metres from
+// |Frame::origin|, vx, vy, vz in metres per second; these are doubles.  body
+// is a 64-bit integer.  All the fields are 8 bytes long, so that they are
+// aligned, e.g., for |numpy.memmap|.
+template<typename Frame>
+class TrajectoryFileWriter {
+ public:
+  // Creates, or truncates, the file |filename|.  |rows_per_block| rows are
+  // buffered before being written.
+  TrajectoryFileWriter(std::string const& filename,
+                       std::int64_t const rows_per_block);
+  explicit TrajectoryFileWriter(std::string const& filename);
+  // Calls |Close| if it hasn't been called.
+  ~TrajectoryFileWriter();
+
+  TrajectoryFileWriter(TrajectoryFileWriter const&) = delete;
+  TrajectoryFileWriter& operator=(TrajectoryFileWriter const&) = delete;
+
+  // Appends a row.
+  void Append(std::int64_t const body,
+              Instant const& time,
+              DegreesOfFreedom<Frame> const& degrees_of_freedom);
+  // Appends a row for each point of |trajectory|, in order.
+  void Append(std::int64_t const body, Trajectory<Frame> const& trajectory);
+
+  // Writes the buffered rows and completes the header.  No row may be
+  // appended afterwards.
+  void Close();
+
+  static std::int64_t const kDefaultRowsPerBlock = 1 << 14;
+
+ private:
+  // Writes the buffered rows as a block, if there are any.
+  void WriteBlock();
+
+  std::string const filename_;
+  std::int64_t const rows_per_block_;
+  std::ofstream file_;
+  bool closed_ = false;
+  std::int64_t number_of_blocks_ = 0;
+  std::int64_t number_of_rows_ = 0;
+  // The columns of the current block, in the order of the file.
+  std::vector<double> columns_[7];
+  std::vector<std::int64_t> bodies_;
+};
+
+// The reader for the files written by |TrajectoryFileWriter|.
+template<typename Frame>
+class TrajectoryFile {
+ public:
+  // The columns of a block, which point into the mapping.
+  struct Block {
+    std::int64_t number_of_rows;
+    double const* t;
+    double const* x;
+    double const* y;
+    double const* z;
+    double const* vx;
+    double const* vy;
+    double const* vz;
+    std::int64_t const* body;
+  };
+
+  // Maps the file |filename|, which must have been written by
+  // |TrajectoryFileWriter|.  Only the block headers are read.
+  explicit TrajectoryFile(std::string const& filename);
+
+  TrajectoryFile(TrajectoryFile const&) = delete;
+  TrajectoryFile& operator=(TrajectoryFile const&) = delete;
+
+  std::int64_t number_of_rows() const;
+  std::int64_t number_of_blocks() const;
+  Block const& block(std::int64_t const index) const;
+
+  // The fields of the row with the given |index|, in the order of the calls to
+  // |TrajectoryFileWriter::Append|.  Complexity is O(Ln(number_of_blocks())).
+  std::int64_t body(std::int64_t const index) const;
+  Instant time(std::int64_t const index) const;
+  DegreesOfFreedom<Frame> degrees_of_freedom(std::int64_t const index) const;
+
+ private:
+  struct Header {
+    char magic[8];
+    std::int64_t number_of_blocks;
+    std::int64_t number_of_rows;
+  };
+  struct BlockHeader {
+    std::int64_t number_of_rows;
+  };
+
+  // Sets |*block| to the block containing the row with the given |index|, and
+  // |*row| to the index of that row in it.
+  void Find(std::int64_t const index,
+            not_null<Block const**> const block,
+            not_null<std::int64_t*> const row) const;
+
+  ReadOnlyMappedFile const file_;
+  Header const* header_;
+  std::vector<Block> blocks_;
+  // The index of the first row of each block.
+  std::vector<std::int64_t> block_first_rows_;
+
+  friend class TrajectoryFileWriter<Frame>;
+};
+
+}  // namespace physics
+}  // namespace principia
+
+#include "physics/trajectory_file_body.hpp"
@@ -0,0 +1,246 @@
+#pragma once
+
+#include "physics/trajectory_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "geometry/grassmann.hpp"
+#include "glog/logging.h"
+#include "quantities/si.hpp"
+
+using principia::geometry::Displacement;
+using principia::geometry::Velocity;
+using principia::quantities::Length;
+using principia::quantities::SIUnit;
+using principia::quantities::Speed;
+using principia::quantities::Time;
+
+namespace principia {
+namespace physics {
+
+namespace {
+
+// Identifies the format of the file, and its version.
+char const kTrajectoryFileMagic[8] = {'P', 'R', 'I', 'N', 'T', 'R', 'J', '1'};
+
+}  // namespace
+
+template<typename Frame>
+std::int64_t const TrajectoryFileWriter<Frame>::kDefaultRowsPerBlock;
+
+template<typename Frame>
+TrajectoryFileWriter<Frame>::TrajectoryFileWriter(
+    std::string const& filename,
+    std::int64_t const rows_per_block)
+    : filename_(filename),
+      rows_per_block_(rows_per_block),
+      file_(filename, std::ios::binary | std::ios::trunc) {
+  CHECK_LT(0, rows_per_block_);
+  CHECK(file_.good()) << filename_;
+  // The header is completed by |Close|.
+  typename TrajectoryFile<Frame>::Header header;
+  std::memcpy(header.magic, kTrajectoryFileMagic, sizeof(header.magic));
+  header.number_of_blocks = 0;
+  header.number_of_rows = 0;
+  file_.write(reinterpret_cast<char const*>(&header), sizeof(header));
+  for (auto& column : columns_) {
+    column.reserve(rows_per_block_);
+  }
+  bodies_.reserve(rows_per_block_);
+}
+
+template<typename Frame>
+TrajectoryFileWriter<Frame>::TrajectoryFileWriter(std::string const& filename)
+    : TrajectoryFileWriter(filename, kDefaultRowsPerBlock) {}
+
+template<typename Frame>
+TrajectoryFileWriter<Frame>::~TrajectoryFileWriter() {
+  if (!closed_) {
+    Close();
+  }
+}
+
+template<typename Frame>
+void TrajectoryFileWriter<Frame>::Append(
+    std::int64_t const body,
+    Instant const& time,
+    DegreesOfFreedom<Frame> const& degrees_of_freedom) {
+  CHECK(!closed_) << filename_;
+  Displacement<Frame> const displacement =
+      degrees_of_freedom.position() - Frame::origin;
+  Velocity<Frame> const& velocity = degrees_of_freedom.velocity();
+  columns_[0].push_back((time - Instant()) / SIUnit<Time>());
+  columns_[1].push_back(displacement.coordinates().x / SIUnit<Length>());
+  columns_[2].push_back(displacement.coordinates().y / SIUnit<Length>());
+  columns_[3].push_back(displacement.coordinates().z / SIUnit<Length>());
+  columns_[4].push_back(velocity.coordinates().x / SIUnit<Speed>());
+  columns_[5].push_back(velocity.coordinates().y / SIUnit<Speed>());
+  columns_[6].push_back(velocity.coordinates().z / SIUnit<Speed>());
+  bodies_.push_back(body);
+  if (static_cast<std::int64_t>(bodies_.size()) == rows_per_block_) {
+    WriteBlock();
+  }
+}
+
+template<typename Frame>
+void TrajectoryFileWriter<Frame>::Append(
+    std::int64_t const body,
+    Trajectory<Frame> const& trajectory) {
+  for (auto it = trajectory.first(); !it.at_end(); ++it) {
+    Append(body, it.time(), it.degrees_of_freedom());
+  }
+}
+
+template<typename Frame>
+void TrajectoryFileWriter<Frame>::Close() {
+  CHECK(!closed_) << filename_;
+  closed_ = true;
+  WriteBlock();
+  typename TrajectoryFile<Frame>::Header header;
+  std::memcpy(header.magic, kTrajectoryFileMagic, sizeof(header.magic));
+  header.number_of_blocks = number_of_blocks_;
+  header.number_of_rows = number_of_rows_;
+  file_.seekp(0);
+  file_.write(reinterpret_cast<char const*>(&header), sizeof(header));
+  file_.close();
+  CHECK(file_.good()) << filename_;
+}
+
+template<typename Frame>
+void TrajectoryFileWriter<Frame>::WriteBlock() {
+  if (bodies_.empty()) {
+    return;
+  }
+  typename TrajectoryFile<Frame>::BlockHeader const block_header = {
+      static_cast<std::int64_t>(bodies_.size())};
+  file_.write(reinterpret_cast<char const*>(&block_header),
+              sizeof(block_header));
+  for (auto& column : columns_) {
+    file_.write(reinterpret_cast<char const*>(column.data()),
+                column.size() * sizeof(double));
+    column.clear();
+  }
+  file_.write(reinterpret_cast<char const*>(bodies_.data()),
+              bodies_.size() * sizeof(std::int64_t));
+  CHECK(file_.good()) << filename_;
+  ++number_of_blocks_;
+  number_of_rows_ += block_header.number_of_rows;
+  bodies_.clear();
+}
+
+template<typename Frame>
+TrajectoryFile<Frame>::TrajectoryFile(std::string const& filename)
+    : file_(filename) {
+  CHECK_LE(static_cast<std::int64_t>(sizeof(Header)), file_.size())
+      << filename << ": truncated trajectory file";
+  header_ = reinterpret_cast<Header const*>(file_.data());
+  CHECK_EQ(0, std::memcmp(header_->magic,
+                          kTrajectoryFileMagic,
+                          sizeof(kTrajectoryFileMagic)))
+      << filename << ": not a trajectory file";
+  CHECK_LE(0, header_->number_of_blocks) << filename;
+  blocks_.reserve(header_->number_of_blocks);
+  block_first_rows_.reserve(header_->number_of_blocks);
+  std::int64_t offset = sizeof(Header);
+  std::int64_t number_of_rows = 0;
+  for (std::int64_t b = 0; b < header_->number_of_blocks; ++b) {
+    CHECK_LE(offset + static_cast<std::int64_t>(sizeof(BlockHeader)),
+             file_.size())
+        << filename << ": inconsistent trajectory file";
+    auto const* const block_header =
+        reinterpret_cast<BlockHeader const*>(file_.data() + offset);
+    std::int64_t const n = block_header->number_of_rows;
+    CHECK_LT(0, n) << filename << ": inconsistent trajectory file";
+    CHECK_LE(offset + static_cast<std::int64_t>(sizeof(BlockHeader)) +
+                 8 * n * static_cast<std::int64_t>(sizeof(double)),
+             file_.size())
+        << filename << ": inconsistent trajectory file";
+    double const* const t = reinterpret_cast<double const*>(block_header + 1);
+    Block const block = {n,
+                         t,
+                         t + n,
+                         t + 2 * n,
+                         t + 3 * n,
+                         t + 4 * n,
+                         t + 5 * n,
+                         t + 6 * n,
+                         reinterpret_cast<std::int64_t const*>(t + 7 * n)};
+    blocks_.push_back(block);
+    block_first_rows_.push_back(number_of_rows);
+    number_of_rows += n;
+    offset += sizeof(BlockHeader) + 8 * n * sizeof(double);
+  }
+  CHECK_EQ(file_.size(), offset)
+      << filename << ": inconsistent trajectory file";
+  CHECK_EQ(header_->number_of_rows, number_of_rows)
+      << filename << ": inconsistent trajectory file";
+}
+
+template<typename Frame>
+std::int64_t TrajectoryFile<Frame>::number_of_rows() const {
+  return header_->number_of_rows;
+}
+
+template<typename Frame>
+std::int64_t TrajectoryFile<Frame>::number_of_blocks() const {
+  return header_->number_of_blocks;
+}
+
+template<typename Frame>
+typename TrajectoryFile<Frame>::Block const& TrajectoryFile<Frame>::block(
+    std::int64_t const index) const {
+  CHECK_LE(0, index);
+  CHECK_LT(index, number_of_blocks());
+  return blocks_[index];
+}
+
+template<typename Frame>
+std::int64_t TrajectoryFile<Frame>::body(std::int64_t const index) const {
+  Block const* block;
+  std::int64_t row;
+  Find(index, &block, &row);
+  return block->body[row];
+}
+
+template<typename Frame>
+Instant TrajectoryFile<Frame>::time(std::int64_t const index) const {
+  Block const* block;
+  std::int64_t row;
+  Find(index, &block, &row);
+  return Instant() + block->t[row] * SIUnit<Time>();
+}
+
+template<typename Frame>
+DegreesOfFreedom<Frame> TrajectoryFile<Frame>::degrees_of_freedom(
+    std::int64_t const index) const {
+  Block const* block;
+  std::int64_t row;
+  Find(index, &block, &row);
+  return DegreesOfFreedom<Frame>(
+      Frame::origin +
+          Displacement<Frame>({block->x[row] * SIUnit<Length>(),
+                               block->y[row] * SIUnit<Length>(),
+                               block->z[row] * SIUnit<Length>()}),
+      Velocity<Frame>({block->vx[row] * SIUnit<Speed>(),
+                       block->vy[row] * SIUnit<Speed>(),
+                       block->vz[row] * SIUnit<Speed>()}));
+}
+
+template<typename Frame>
+void TrajectoryFile<Frame>::Find(std::int64_t const index,
+                                 not_null<Block const**> const block,
+                                 not_null<std::int64_t*> const row) const {
+  CHECK_LE(0, index);
+  CHECK_LT(index, number_of_rows());
+  // The last block whose first row is at or before |index|.
+  std::int64_t const b =
+      std::upper_bound(block_first_rows_.begin(),
+                       block_first_rows_.end(),
+                       index) - block_first_rows_.begin() - 1;
+  *block = &blocks_[b];
+  *row = index - block_first_rows_[b];
+}
+
+}  // namespace physics
+}  // namespace principia
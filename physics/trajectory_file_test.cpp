@@ -0,0 +1,122 @@
+#include "physics/trajectory_file.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+
+#include "geometry/frame.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "physics/massless_body.hpp"
+#include "quantities/si.hpp"
+#include "serialization/geometry.pb.h"
+
+using principia::base::make_not_null_unique;
+using principia::geometry::Frame;
+using principia::si::Metre;
+using principia::si::Second;
+using testing::Eq;
+
+namespace principia {
+namespace physics {
+
+class TrajectoryFileTest : public testing::Test {
+ protected:
+  using World = Frame<serialization::Frame::TestTag,
+                      serialization::Frame::TEST, true>;
+
+  TrajectoryFileTest()
+      : trajectory_(make_not_null_unique<Trajectory<World>>(&body_)) {
+    for (int i = 0; i < 10; ++i) {
+      trajectory_->Append(Time(i), DegreesOfFreedomAt(i));
+    }
+  }
+
+  static Instant Time(int const i) {
+    return Instant() + (i + 0.5) * Second;
+  }
+
+  // A point of the uniform motion along (1, 2, 3) m/s.
+  static DegreesOfFreedom<World> DegreesOfFreedomAt(int const i) {
+    return DegreesOfFreedom<World>(
+        World::origin + Displacement<World>({(i + 0.5) * Metre,
+                                             2 * (i + 0.5) * Metre,
+                                             3 * (i + 0.5) * Metre}),
+        Velocity<World>({1 * Metre / Second,
+                         2 * Metre / Second,
+                         3 * Metre / Second}));
+  }
+
+  MasslessBody body_;
+  not_null<std::unique_ptr<Trajectory<World>>> trajectory_;
+};
+
+// The rows are read in the order in which they were written, and the blocks
+// are columnar.
+TEST_F(TrajectoryFileTest, WriteAndRead) {
+  char const filename[] = "trajectory_file_test.bin";
+  {
+    TrajectoryFileWriter<World> writer(filename, 4 /*rows_per_block*/);
+    writer.Append(7, *trajectory_);
+    writer.Append(-3, Time(42), DegreesOfFreedomAt(42));
+  }
+  {
+    TrajectoryFile<World> const file(filename);
+    ASSERT_THAT(file.number_of_rows(), Eq(11));
+    ASSERT_THAT(file.number_of_blocks(), Eq(3));
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_THAT(file.body(i), Eq(7));
+      EXPECT_THAT(file.time(i), Eq(Time(i)));
+      EXPECT_THAT(file.degrees_of_freedom(i), Eq(DegreesOfFreedomAt(i)));
+    }
+    EXPECT_THAT(file.body(10), Eq(-3));
+    EXPECT_THAT(file.time(10), Eq(Time(42)));
+    EXPECT_THAT(file.degrees_of_freedom(10), Eq(DegreesOfFreedomAt(42)));
+
+    auto const& block = file.block(1);
+    ASSERT_THAT(block.number_of_rows, Eq(4));
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_THAT(block.t[i], Eq(4.5 + i));
+      EXPECT_THAT(block.x[i], Eq(4.5 + i));
+      EXPECT_THAT(block.y[i], Eq(9 + 2 * i));
+      EXPECT_THAT(block.z[i], Eq(13.5 + 3 * i));
+      EXPECT_THAT(block.vx[i], Eq(1));
+      EXPECT_THAT(block.vy[i], Eq(2));
+      EXPECT_THAT(block.vz[i], Eq(3));
+      EXPECT_THAT(block.body[i], Eq(7));
+    }
+    EXPECT_THAT(file.block(2).number_of_rows, Eq(3));
+  }
+  std::remove(filename);
+}
+
+TEST_F(TrajectoryFileTest, Empty) {
+  char const filename[] = "trajectory_file_empty_test.bin";
+  {
+    TrajectoryFileWriter<World> writer(filename);
+    writer.Close();
+  }
+  {
+    TrajectoryFile<World> const file(filename);
+    EXPECT_THAT(file.number_of_rows(), Eq(0));
+    EXPECT_THAT(file.number_of_blocks(), Eq(0));
+  }
+  std::remove(filename);
+}
+
+using TrajectoryFileDeathTest = TrajectoryFileTest;
+
+TEST_F(TrajectoryFileDeathTest, Error) {
+  char const filename[] = "trajectory_file_death_test.bin";
+  {
+    std::ofstream file(filename, std::ios::binary);
+    file << "This is not a trajectory file, but it is long enough.";
+  }
+  EXPECT_DEATH({
+    TrajectoryFile<World> const file(filename);
+  }, "not a trajectory file");
+  std::remove(filename);
+}
+
+}  // namespace physics
+}  // namespace principia
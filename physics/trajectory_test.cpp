@@ -1,9 +1,12 @@
-#include "trajectory.hpp"
+﻿#include "trajectory.hpp"
 
+#include <algorithm>
+#include <cstdio>
 #include <functional>
 #include <list>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "body.hpp"
 #include "geometry/frame.hpp"
@@ -16,25 +19,43 @@
 #include "physics/massive_body.hpp"
 #include "physics/massless_body.hpp"
 #include "physics/oblate_body.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/numbers.hpp"
 #include "quantities/quantities.hpp"
 #include "quantities/si.hpp"
+#include "testing_utilities/temporary_file.hpp"
 
+using principia::geometry::Displacement;
 using principia::geometry::Frame;
+using principia::geometry::InnerProduct;
 using principia::geometry::Instant;
 using principia::geometry::Point;
 using principia::geometry::R3Element;
 using principia::geometry::Vector;
+using principia::quantities::Angle;
+using principia::quantities::AngularFrequency;
+using principia::quantities::Cos;
 using principia::quantities::Length;
 using principia::quantities::Mass;
+using principia::quantities::Quotient;
 using principia::quantities::Speed;
 using principia::quantities::SIUnit;
+using principia::quantities::Sin;
+using principia::si::Kilo;
 using principia::si::Metre;
+using principia::si::Radian;
 using principia::si::Second;
+using principia::testing_utilities::TemporaryFilename;
 using std::placeholders::_1;
 using std::placeholders::_2;
 using std::placeholders::_3;
 using testing::ElementsAre;
 using testing::Eq;
+using testing::Gt;
+using testing::IsNull;
+using testing::Le;
+using testing::Lt;
 using testing::Ref;
 
 // Note that we cannot have a |using testing::Pair| here as it would conflict
@@ -102,6 +123,58 @@ class TrajectoryTest : public testing::Test {
         std::bind(transform_, _1, _2, _3, massless_trajectory_.get());
   }
 
+  // Removes the archive if the test didn't.
+  void TearDown() override {
+    std::remove(archive_filename_.c_str());
+  }
+
+  // Expects the columns of |message| to hold the given points.
+  static void ExpectColumns(
+      serialization::Trajectory const& message,
+      std::vector<Instant> const& times,
+      std::vector<DegreesOfFreedom<World>> const& degrees_of_freedom) {
+    serialization::Trajectory::Columns const& columns = message.columns();
+    World::ReadFromMessage(columns.frame());
+    ASSERT_THAT(columns.t_size(), Eq(static_cast<int>(times.size())));
+    for (int i = 0; i < columns.t_size(); ++i) {
+      EXPECT_THAT(Instant(columns.t(i) * Second), Eq(times[i]));
+      EXPECT_THAT(ColumnsDegreesOfFreedom(columns, i),
+                  Eq(degrees_of_freedom[i]));
+    }
+  }
+
+  // Rewrites |*message| and its descendants in the format with one message
+  // per point.
+  static void ConvertToTimeline(
+      not_null<serialization::Trajectory*> const message) {
+    serialization::Trajectory::Columns const& columns = message->columns();
+    for (int i = 0; i < columns.t_size(); ++i) {
+      auto const point = message->add_timeline();
+      Instant(columns.t(i) * Second).WriteToMessage(point->mutable_instant());
+      ColumnsDegreesOfFreedom(columns, i).WriteToMessage(
+          point->mutable_degrees_of_freedom());
+    }
+    message->clear_columns();
+    for (auto& litter : *message->mutable_children()) {
+      for (auto& child : *litter.mutable_trajectories()) {
+        ConvertToTimeline(&child);
+      }
+    }
+  }
+
+  static DegreesOfFreedom<World> ColumnsDegreesOfFreedom(
+      serialization::Trajectory::Columns const& columns,
+      int const i) {
+    return DegreesOfFreedom<World>(
+        Position<World>(Vector<Length, World>({columns.x(i) * Metre,
+                                               columns.y(i) * Metre,
+                                               columns.z(i) * Metre})),
+        Velocity<World>({columns.vx(i) * (Metre / Second),
+                         columns.vy(i) * (Metre / Second),
+                         columns.vz(i) * (Metre / Second)}));
+  }
+
+  std::string const archive_filename_ = TemporaryFilename("archive.bin");
   MassiveBody massive_body_;
   MasslessBody massless_body_;
   Position<World> q1_, q2_, q3_, q4_;
@@ -162,6 +235,29 @@ TEST_F(TrajectoryTest, AppendSuccess) {
   EXPECT_THAT(massive_trajectory_->body<MassiveBody>(), Eq(&massive_body_));
 }
 
+TEST_F(TrajectoryDeathTest, AppendRangeError) {
+  EXPECT_DEATH({
+    massive_trajectory_->Append(t2_, d2_);
+    massive_trajectory_->AppendRange({{t1_, d1_}});
+  }, "out of order");
+  EXPECT_DEATH({
+    massive_trajectory_->AppendRange({{t1_, d1_}, {t3_, d3_}, {t2_, d2_}});
+  }, "out of order");
+}
+
+TEST_F(TrajectoryTest, AppendRangeSuccess) {
+  massive_trajectory_->Append(t1_, d1_);
+  massive_trajectory_->AppendRange({{t2_, d2_}, {t3_, d3_}});
+  EXPECT_THAT(massive_trajectory_->Positions(),
+              ElementsAre(testing::Pair(t1_, q1_),
+                          testing::Pair(t2_, q2_),
+                          testing::Pair(t3_, q3_)));
+  EXPECT_THAT(massive_trajectory_->Velocities(),
+              ElementsAre(testing::Pair(t1_, p1_),
+                          testing::Pair(t2_, p2_),
+                          testing::Pair(t3_, p3_)));
+}
+
 TEST_F(TrajectoryDeathTest, ForkError) {
   EXPECT_DEATH({
     massive_trajectory_->Append(t1_, d1_);
@@ -234,8 +330,8 @@ TEST_F(TrajectoryTest, IteratorSerializationSuccess) {
     serialization::Trajectory::Pointer message;
     fork1->WritePointerToMessage(&message);
     EXPECT_EQ(1, message.fork_size());
-    EXPECT_EQ(0, message.fork(0).children_distance());
-    EXPECT_EQ(1, message.fork(0).timeline_distance());
+    EXPECT_EQ(t2_, Instant::ReadFromMessage(message.fork(0).fork_time()));
+    EXPECT_EQ(0, message.fork(0).sibling_index());
     auto trajectory = Trajectory<World>::ReadPointerFromMessage(
                           message,
                           massive_trajectory_.get());
@@ -254,8 +350,8 @@ TEST_F(TrajectoryTest, IteratorSerializationSuccess) {
     serialization::Trajectory::Pointer message;
     fork2->WritePointerToMessage(&message);
     EXPECT_EQ(1, message.fork_size());
-    EXPECT_EQ(1, message.fork(0).children_distance());
-    EXPECT_EQ(1, message.fork(0).timeline_distance());
+    EXPECT_EQ(t2_, Instant::ReadFromMessage(message.fork(0).fork_time()));
+    EXPECT_EQ(1, message.fork(0).sibling_index());
     auto trajectory = Trajectory<World>::ReadPointerFromMessage(
                           message,
                           massive_trajectory_.get());
@@ -272,8 +368,8 @@ TEST_F(TrajectoryTest, IteratorSerializationSuccess) {
     serialization::Trajectory::Pointer message;
     fork3->WritePointerToMessage(&message);
     EXPECT_EQ(1, message.fork_size());
-    EXPECT_EQ(2, message.fork(0).children_distance());
-    EXPECT_EQ(2, message.fork(0).timeline_distance());
+    EXPECT_EQ(t3_, Instant::ReadFromMessage(message.fork(0).fork_time()));
+    EXPECT_EQ(0, message.fork(0).sibling_index());
     auto trajectory = Trajectory<World>::ReadPointerFromMessage(
                           message,
                           massive_trajectory_.get());
@@ -289,6 +385,18 @@ TEST_F(TrajectoryTest, IteratorSerializationSuccess) {
     ++it;
     EXPECT_TRUE(it.at_end());
   }
+
+  {
+    // A pointer written before the fork times.
+    serialization::Trajectory::Pointer message;
+    auto* const fork_message = message.add_fork();
+    fork_message->set_children_distance(2);
+    fork_message->set_timeline_distance(2);
+    EXPECT_EQ(fork3,
+              Trajectory<World>::ReadPointerFromMessage(
+                  message,
+                  massive_trajectory_.get()));
+  }
 }
 
 TEST_F(TrajectoryTest, PointerSerializationSuccess) {
@@ -349,55 +457,99 @@ TEST_F(TrajectoryTest, TrajectorySerializationSuccess) {
   deserialized_trajectory->WriteToMessage(&message);
   EXPECT_EQ(reference_message.SerializeAsString(), message.SerializeAsString());
   EXPECT_THAT(message.children_size(), Eq(2));
-  EXPECT_THAT(message.timeline_size(), Eq(3));
-  EXPECT_THAT(Instant::ReadFromMessage(message.timeline(0).instant()), Eq(t1_));
-  EXPECT_THAT(Instant::ReadFromMessage(message.timeline(1).instant()), Eq(t2_));
-  EXPECT_THAT(Instant::ReadFromMessage(message.timeline(2).instant()), Eq(t3_));
-  EXPECT_THAT(
-      DegreesOfFreedom<World>::ReadFromMessage(
-          message.timeline(0).degrees_of_freedom()), Eq(d1_));
-  EXPECT_THAT(
-        DegreesOfFreedom<World>::ReadFromMessage(
-            message.timeline(1).degrees_of_freedom()), Eq(d2_));
-  EXPECT_THAT(
-        DegreesOfFreedom<World>::ReadFromMessage(
-            message.timeline(2).degrees_of_freedom()), Eq(d3_));
+  EXPECT_THAT(message.timeline_size(), Eq(0));
+  ExpectColumns(message, {t1_, t2_, t3_}, {d1_, d2_, d3_});
   EXPECT_THAT(message.children(0).trajectories_size(), Eq(2));
   EXPECT_THAT(message.children(0).trajectories(0).children_size(), Eq(0));
-  EXPECT_THAT(message.children(0).trajectories(0).timeline_size(), Eq(1));
-  EXPECT_THAT(
-      Instant::ReadFromMessage(
-          message.children(0).trajectories(0).timeline(0).instant()), Eq(t3_));
-  EXPECT_THAT(
-      DegreesOfFreedom<World>::ReadFromMessage(
-          message.children(0).trajectories(0).timeline(0).degrees_of_freedom()),
-      Eq(d3_));
+  ExpectColumns(message.children(0).trajectories(0), {t3_}, {d3_});
   EXPECT_THAT(message.children(0).trajectories(1).children_size(), Eq(0));
-  EXPECT_THAT(message.children(0).trajectories(1).timeline_size(), Eq(2));
-  EXPECT_THAT(
-      Instant::ReadFromMessage(
-          message.children(0).trajectories(1).timeline(0).instant()), Eq(t3_));
-  EXPECT_THAT(
-      DegreesOfFreedom<World>::ReadFromMessage(
-          message.children(0).trajectories(1).timeline(0).degrees_of_freedom()),
-      Eq(d3_));
-  EXPECT_THAT(
-      Instant::ReadFromMessage(
-          message.children(0).trajectories(1).timeline(1).instant()), Eq(t4_));
-  EXPECT_THAT(
-      DegreesOfFreedom<World>::ReadFromMessage(
-          message.children(0).trajectories(1).timeline(1).degrees_of_freedom()),
-      Eq(d4_));
+  ExpectColumns(message.children(0).trajectories(1), {t3_, t4_}, {d3_, d4_});
   EXPECT_THAT(message.children(1).trajectories_size(), Eq(1));
   EXPECT_THAT(message.children(1).trajectories(0).children_size(), Eq(0));
-  EXPECT_THAT(message.children(1).trajectories(0).timeline_size(), Eq(1));
-  EXPECT_THAT(
-      Instant::ReadFromMessage(
-          message.children(1).trajectories(0).timeline(0).instant()), Eq(t4_));
-  EXPECT_THAT(
-      DegreesOfFreedom<World>::ReadFromMessage(
-          message.children(1).trajectories(0).timeline(0).degrees_of_freedom()),
-      Eq(d4_));
+  ExpectColumns(message.children(1).trajectories(0), {t4_}, {d4_});
+}
+
+TEST_F(TrajectoryTest, IncrementSerialization) {
+  massive_trajectory_->Append(t1_, d1_);
+  massive_trajectory_->Append(t2_, d2_);
+  Trajectory<World>* fork = massive_trajectory_->NewFork(t2_);
+  fork->Append(t3_, d3_);
+  serialization::Trajectory message;
+  massive_trajectory_->WriteToMessage(&message);
+  CompressColumns(&message);
+
+  // The history is advanced and the fork is replaced after the first save.
+  massive_trajectory_->DeleteFork(&fork);
+  massive_trajectory_->Append(t3_, d3_);
+  massive_trajectory_->Append(t4_, d4_);
+  massive_trajectory_->NewFork(t4_);
+  serialization::Trajectory increment;
+  massive_trajectory_->WriteIncrementToMessage(t2_, &increment);
+  EXPECT_TRUE(increment.has_increment_since());
+  ExpectColumns(increment, {t3_, t4_}, {d3_, d4_});
+  EXPECT_THAT(increment.children_size(), Eq(1));
+
+  Trajectory<World>::AppendIncrementToMessage(increment, &message);
+  serialization::Trajectory reference_message;
+  massive_trajectory_->WriteToMessage(&reference_message);
+  EXPECT_EQ(reference_message.SerializeAsString(), message.SerializeAsString());
+  not_null<std::unique_ptr<Trajectory<World>>> const deserialized_trajectory =
+      Trajectory<World>::ReadFromMessage(message, &massive_body_);
+  EXPECT_EQ(t4_, deserialized_trajectory->last().time());
+}
+
+TEST_F(TrajectoryDeathTest, IncrementSerializationError) {
+  EXPECT_DEATH({
+    massive_trajectory_->Append(t1_, d1_);
+    serialization::Trajectory increment;
+    massive_trajectory_->WriteIncrementToMessage(t1_, &increment);
+    Trajectory<World>::ReadFromMessage(increment, &massive_body_);
+  }, "must be appended");
+  EXPECT_DEATH({
+    massive_trajectory_->Append(t1_, d1_);
+    massive_trajectory_->Append(t2_, d2_);
+    serialization::Trajectory message;
+    massive_trajectory_->WriteToMessage(&message);
+    serialization::Trajectory increment;
+    massive_trajectory_->WriteIncrementToMessage(t1_, &increment);
+    Trajectory<World>::AppendIncrementToMessage(increment, &message);
+  }, "Check failed");
+}
+
+// Saves written before the columnar format have one message per point.
+TEST_F(TrajectoryTest, TrajectorySerializationCompatibility) {
+  massive_trajectory_->Append(t1_, d1_);
+  massive_trajectory_->Append(t2_, d2_);
+  massive_trajectory_->Append(t3_, d3_);
+  not_null<Trajectory<World>*> const fork = massive_trajectory_->NewFork(t2_);
+  fork->Append(t4_, d4_);
+  serialization::Trajectory reference_message;
+  massive_trajectory_->WriteToMessage(&reference_message);
+  serialization::Trajectory message = reference_message;
+  ConvertToTimeline(&message);
+  EXPECT_FALSE(message.has_columns());
+  EXPECT_THAT(message.timeline_size(), Eq(3));
+  not_null<std::unique_ptr<Trajectory<World>>> const deserialized_trajectory =
+      Trajectory<World>::ReadFromMessage(message, &massive_body_);
+  message.Clear();
+  deserialized_trajectory->WriteToMessage(&message);
+  EXPECT_EQ(reference_message.SerializeAsString(), message.SerializeAsString());
+}
+
+TEST_F(TrajectoryTest, DetachFork) {
+  massive_trajectory_->Append(t1_, d1_);
+  massive_trajectory_->Append(t2_, d2_);
+  Trajectory<World>* fork = massive_trajectory_->NewFork(t1_);
+  Trajectory<World> const* const expected_fork = fork;
+  fork->Append(t3_, d3_);
+  not_null<std::unique_ptr<Trajectory<World>>> const detached =
+      massive_trajectory_->DetachFork(&fork);
+  EXPECT_THAT(fork, IsNull());
+  EXPECT_EQ(expected_fork, detached.get());
+  EXPECT_EQ(t3_, detached->last().time());
+  serialization::Trajectory message;
+  massive_trajectory_->WriteToMessage(&message);
+  EXPECT_THAT(message.children_size(), Eq(0));
 }
 
 TEST_F(TrajectoryDeathTest, DeleteForkError) {
@@ -453,6 +605,228 @@ TEST_F(TrajectoryTest, DeleteForkSuccess) {
   massive_trajectory_.reset();
 }
 
+TEST_F(TrajectoryDeathTest, ResetForkError) {
+  EXPECT_DEATH({
+    massive_trajectory_->Append(t1_, d1_);
+    massive_trajectory_->Append(t2_, d2_);
+    not_null<Trajectory<World>*> const fork =
+        massive_trajectory_->NewFork(t1_);
+    fork->ResetFork(fork, t2_);
+  }, "not a child");
+  EXPECT_DEATH({
+    massive_trajectory_->Append(t1_, d1_);
+    not_null<Trajectory<World>*> const fork =
+        massive_trajectory_->NewFork(t1_);
+    massive_trajectory_->ResetFork(fork, t2_);
+  }, "nonexistent time");
+}
+
+TEST_F(TrajectoryTest, ResetForkSuccess) {
+  massive_trajectory_->Append(t1_, d1_);
+  massive_trajectory_->Append(t2_, d2_);
+  massive_trajectory_->Append(t3_, d3_);
+  not_null<Trajectory<World>*> const fork1 = massive_trajectory_->NewFork(t1_);
+  not_null<Trajectory<World>*> const fork2 = massive_trajectory_->NewFork(t2_);
+  fork1->Append(t4_, d4_);
+  fork1->NewFork(t4_);
+  EXPECT_THAT(fork1->snapshot().size(), Eq(4));
+
+  // Resetting at the same time only forgets the points of the fork.
+  massive_trajectory_->ResetFork(fork1, t1_);
+  EXPECT_THAT(*fork1->fork_time(), Eq(t1_));
+  EXPECT_THAT(fork1->Times(), ElementsAre(t1_, t2_, t3_));
+  EXPECT_THAT(fork1->snapshot().size(), Eq(3));
+  EXPECT_THAT(fork1->body<MassiveBody>(), Eq(&massive_body_));
+
+  massive_trajectory_->ResetFork(fork1, t3_);
+  fork1->Append(t4_, d4_);
+  EXPECT_THAT(*fork1->fork_time(), Eq(t3_));
+  EXPECT_THAT(fork1->Positions(), ElementsAre(testing::Pair(t1_, q1_),
+                                              testing::Pair(t2_, q2_),
+                                              testing::Pair(t3_, q3_),
+                                              testing::Pair(t4_, q4_)));
+  EXPECT_THAT(fork2->Times(), ElementsAre(t1_, t2_, t3_));
+
+  // |fork1| is now forked after |t2_|, so it is deleted.
+  massive_trajectory_->ForgetAfter(t2_);
+  EXPECT_THAT(massive_trajectory_->Times(), ElementsAre(t1_, t2_));
+  EXPECT_THAT(fork2->Times(), ElementsAre(t1_, t2_, t3_));
+  serialization::Trajectory message;
+  massive_trajectory_->WriteToMessage(&message);
+  EXPECT_THAT(message.children_size(), Eq(1));
+}
+
+TEST_F(TrajectoryDeathTest, SpliceForkError) {
+  EXPECT_DEATH({
+    massive_trajectory_->Append(t1_, d1_);
+    massive_trajectory_->Append(t2_, d2_);
+    not_null<Trajectory<World>*> const fork =
+        massive_trajectory_->NewFork(t1_);
+    massive_trajectory_->SpliceFork(fork, t2_);
+  }, "not at the last point");
+  EXPECT_DEATH({
+    massive_trajectory_->Append(t1_, d1_);
+    not_null<Trajectory<World>*> const fork =
+        massive_trajectory_->NewFork(t1_);
+    fork->Append(t2_, d2_);
+    massive_trajectory_->SpliceFork(fork, t3_);
+  }, "nonexistent time");
+  EXPECT_DEATH({
+    massive_trajectory_->Append(t1_, d1_);
+    not_null<Trajectory<World>*> const fork =
+        massive_trajectory_->NewFork(t1_);
+    fork->Append(t2_, d2_);
+    massive_trajectory_->SpliceFork(fork, {{t2_, d2_}}, t2_);
+  }, "overlaps");
+}
+
+TEST_F(TrajectoryTest, SpliceForkSuccess) {
+  massive_trajectory_->Append(t1_, d1_);
+  not_null<Trajectory<World>*> const fork1 = massive_trajectory_->NewFork(t1_);
+  fork1->Append(t2_, d2_);
+  fork1->Append(t3_, d3_);
+  fork1->Append(t4_, d4_);
+  not_null<Trajectory<World>*> const fork2 = fork1->NewFork(t4_);
+  EXPECT_THAT(fork1->snapshot().size(), Eq(4));
+
+  massive_trajectory_->SpliceFork(fork1, t3_);
+  EXPECT_THAT(massive_trajectory_->Positions(),
+              ElementsAre(testing::Pair(t1_, q1_),
+                          testing::Pair(t2_, q2_),
+                          testing::Pair(t3_, q3_)));
+  EXPECT_THAT(*fork1->fork_time(), Eq(t3_));
+  EXPECT_THAT(fork1->Times(), ElementsAre(t1_, t2_, t3_, t4_));
+  EXPECT_THAT(fork1->snapshot().size(), Eq(4));
+  EXPECT_THAT(*fork2->fork_time(), Eq(t4_));
+  EXPECT_THAT(fork2->Times(), ElementsAre(t1_, t2_, t3_, t4_));
+
+  // |fork1| is now forked after |t2_|, so it is deleted.
+  massive_trajectory_->ForgetAfter(t2_);
+  serialization::Trajectory message;
+  massive_trajectory_->WriteToMessage(&message);
+  EXPECT_THAT(message.children_size(), Eq(0));
+}
+
+// The points of the gap are appended before those of the fork, which keeps its
+// children.
+TEST_F(TrajectoryTest, SpliceForkGap) {
+  massive_trajectory_->Append(t1_, d1_);
+  not_null<Trajectory<World>*> const fork1 = massive_trajectory_->NewFork(t1_);
+  fork1->Append(t3_, d3_);
+  fork1->Append(t4_, d4_);
+  not_null<Trajectory<World>*> const fork2 = fork1->NewFork(t4_);
+  std::int64_t const version = fork2->version();
+
+  massive_trajectory_->SpliceFork(fork1, {{t2_, d2_}}, t3_);
+  EXPECT_THAT(massive_trajectory_->Times(), ElementsAre(t1_, t2_, t3_));
+  EXPECT_THAT(*fork1->fork_time(), Eq(t3_));
+  EXPECT_THAT(fork1->Times(), ElementsAre(t1_, t2_, t3_, t4_));
+  EXPECT_THAT(*fork2->fork_time(), Eq(t4_));
+  EXPECT_THAT(fork2->Times(), ElementsAre(t1_, t2_, t3_, t4_));
+  EXPECT_THAT(fork2->version(), Gt(version));
+}
+
+TEST_F(TrajectoryTest, Observer) {
+  // Records the notifications as strings.
+  class RecordingObserver : public Trajectory<World>::Observer {
+   public:
+    void ForgotAfter(Trajectory<World> const& trajectory,
+                     Instant const& time) override {
+      Record(trajectory, "ForgotAfter", time);
+    }
+    void ForgotBefore(Trajectory<World> const& trajectory,
+                      Instant const& time) override {
+      Record(trajectory, "ForgotBefore", time);
+    }
+    void Forked(Trajectory<World> const& trajectory,
+                Trajectory<World> const& fork) override {
+      Record(trajectory, "Forked", *fork.fork_time());
+    }
+    void ForkRemoved(Trajectory<World> const& trajectory,
+                     Trajectory<World> const& fork) override {
+      Record(trajectory, "ForkRemoved", *fork.fork_time());
+    }
+    void Destroyed(Trajectory<World> const& trajectory) override {
+      notifications.push_back(trajectory.is_root() ? "root Destroyed"
+                                                   : "fork Destroyed");
+    }
+
+    std::vector<std::string> notifications;
+
+   private:
+    void Record(Trajectory<World> const& trajectory,
+                std::string const& notification,
+                Instant const& time) {
+      notifications.push_back(
+          (trajectory.is_root() ? "root " : "fork ") + notification + " " +
+          std::to_string((time - Instant()) / SIUnit<Time>()));
+    }
+  };
+
+  RecordingObserver observer;
+  EXPECT_EQ(0, massive_trajectory_->version());
+  massive_trajectory_->AddObserver(&observer);
+  massive_trajectory_->Append(t1_, d1_);
+  massive_trajectory_->Append(t2_, d2_);
+  massive_trajectory_->Append(t3_, d3_);
+  EXPECT_EQ(3, massive_trajectory_->version());
+  Trajectory<World>* fork1 = massive_trajectory_->NewFork(t2_);
+  massive_trajectory_->NewFork(t3_);
+  fork1->AddObserver(&observer);
+  EXPECT_EQ(3, massive_trajectory_->version());
+  EXPECT_EQ(0, fork1->version());
+
+  // Appending to the parent doesn't change the fork.
+  massive_trajectory_->Append(t4_, d4_);
+  EXPECT_EQ(0, fork1->version());
+  massive_trajectory_->ForgetBefore(t1_);
+  EXPECT_EQ(1, fork1->version());
+  massive_trajectory_->ForgetAfter(t2_);
+  EXPECT_EQ(1, fork1->version());
+  massive_trajectory_->DeleteFork(&fork1);
+  massive_trajectory_->RemoveObserver(&observer);
+  massive_trajectory_->Append(t3_, d3_);
+
+  std::string const t1 = std::to_string((t1_ - Instant()) / SIUnit<Time>());
+  std::string const t2 = std::to_string((t2_ - Instant()) / SIUnit<Time>());
+  std::string const t3 = std::to_string((t3_ - Instant()) / SIUnit<Time>());
+  EXPECT_THAT(observer.notifications,
+              ElementsAre("root Forked " + t2,
+                          "root Forked " + t3,
+                          "root ForgotBefore " + t1,
+                          "fork ForgotBefore " + t1,
+                          "root ForkRemoved " + t3,
+                          "root ForgotAfter " + t2,
+                          "root ForkRemoved " + t2,
+                          "fork Destroyed"));
+}
+
+TEST_F(TrajectoryTest, PrepareForReclaim) {
+  // Counts the notifications of destruction.
+  class DestroyedObserver : public Trajectory<World>::Observer {
+   public:
+    void Destroyed(Trajectory<World> const& trajectory) override {
+      ++destroyed;
+    }
+
+    int destroyed = 0;
+  };
+
+  DestroyedObserver observer;
+  massive_trajectory_->Append(t1_, d1_);
+  massive_trajectory_->Append(t2_, d2_);
+  Trajectory<World>* const fork = massive_trajectory_->NewFork(t1_);
+  massive_trajectory_->AddObserver(&observer);
+  fork->AddObserver(&observer);
+
+  // The observers of the trajectory and of its fork are notified and removed,
+  // so that they are not notified again when it is destroyed.
+  massive_trajectory_->PrepareForReclaim();
+  EXPECT_EQ(2, observer.destroyed);
+  massive_trajectory_.reset();
+  EXPECT_EQ(2, observer.destroyed);
+}
+
 TEST_F(TrajectoryDeathTest, LastError) {
   EXPECT_DEATH({
     massive_trajectory_->last();
@@ -564,8 +938,10 @@ TEST_F(TrajectoryTest, ForgetBeforeSuccess) {
   massive_trajectory_->Append(t3_, d3_);
   not_null<Trajectory<World>*> const fork = massive_trajectory_->NewFork(t2_);
   fork->Append(t4_, d4_);
+  EXPECT_EQ(3, massive_trajectory_->size());
 
   massive_trajectory_->ForgetBefore(t1_);
+  EXPECT_EQ(2, massive_trajectory_->size());
   std::map<Instant, Position<World>> positions =
       massive_trajectory_->Positions();
   std::map<Instant, Velocity<World>> velocities =
@@ -597,6 +973,451 @@ TEST_F(TrajectoryTest, ForgetBeforeSuccess) {
   // Don't use fork, it is dangling.
 }
 
+TEST_F(TrajectoryTest, MemoryUsage) {
+  std::int64_t const empty = massive_trajectory_->MemoryUsage();
+  EXPECT_LE(static_cast<std::int64_t>(sizeof(Trajectory<World>)), empty);
+
+  for (int i = 0; i < 10000; ++i) {
+    massive_trajectory_->Append(t0_ + i * Second, d1_);
+  }
+  std::int64_t const appended = massive_trajectory_->MemoryUsage();
+  std::int64_t const entry_size =
+      sizeof(std::pair<Instant, DegreesOfFreedom<World>>);
+  EXPECT_LE(empty + 10000 * entry_size, appended);
+  // Only the last chunk, of at most 1024 entries, is not full.
+  EXPECT_GE(empty + 11100 * entry_size, appended);
+
+  // The forks are counted, and released when deleted.
+  Trajectory<World>* fork = massive_trajectory_->NewFork(t0_ + 9999 * Second);
+  for (int i = 0; i < 100; ++i) {
+    fork->Append(t0_ + (10000 + i) * Second, d2_);
+  }
+  EXPECT_LE(appended + 100 * entry_size, massive_trajectory_->MemoryUsage());
+  EXPECT_LE(100 * entry_size, fork->MemoryUsage());
+  massive_trajectory_->DeleteFork(&fork);
+  EXPECT_EQ(appended, massive_trajectory_->MemoryUsage());
+}
+
+TEST_F(TrajectoryTest, Downsampling) {
+  // A circular orbit with a period of 6000 s, sampled every 10 s.
+  AngularFrequency const ω = 2 * π * Radian / (6000 * Second);
+  Length const r = 1000 * Kilo(Metre);
+  auto const degrees_of_freedom = [ω, r](Instant const& t) {
+    Angle const θ = ω * (t - Instant());
+    return DegreesOfFreedom<World>(
+        Position<World>(Vector<Length, World>({r * Cos(θ), r * Sin(θ), 0 * r})),
+        Velocity<World>({-r * ω * Sin(θ) / Radian,
+                         r * ω * Cos(θ) / Radian,
+                         0 * r * ω / Radian}));
+  };
+  Time const Δt = 10 * Second;
+  massless_trajectory_->set_downsampling({1000 * Second, 1 * Metre});
+  Trajectory<World>* fork = nullptr;
+  Instant const fork_time = Instant() + 500 * Δt;
+  for (int i = 0; i <= 2000; ++i) {
+    Instant const t = Instant() + i * Δt;
+    massless_trajectory_->Append(t, degrees_of_freedom(t));
+    if (t == fork_time) {
+      fork = massless_trajectory_->NewFork(t);
+      fork->Append(t + Δt / 2, degrees_of_freedom(t + Δt / 2));
+    }
+  }
+  Instant const last_time = massless_trajectory_->last().time();
+
+  std::list<Instant> const times = massless_trajectory_->Times();
+  EXPECT_THAT(times.size(), Lt(400));
+  EXPECT_THAT(times.front(), Eq(Instant()));
+  EXPECT_THAT(times.back(), Eq(Instant() + 2000 * Δt));
+  EXPECT_THAT(std::count(times.begin(), times.end(), fork_time), Eq(1));
+  // The recent points are all retained.
+  EXPECT_THAT(std::count_if(times.begin(),
+                            times.end(),
+                            [last_time](Instant const& t) {
+                              return t > last_time - 1000 * Second;
+                            }),
+              Eq(100));
+  // The retained points are unchanged.
+  for (auto it = massless_trajectory_->first(); !it.at_end(); ++it) {
+    EXPECT_EQ(degrees_of_freedom(it.time()), it.degrees_of_freedom());
+  }
+  // The removed points are recovered within the tolerance.
+  for (int i = 0; i <= 2000; ++i) {
+    Instant const t = Instant() + i * Δt;
+    EXPECT_THAT((massless_trajectory_->EvaluateDegreesOfFreedom(t).position() -
+                 degrees_of_freedom(t).position()).Norm(),
+                Le(1 * Metre)) << i;
+  }
+
+  // The fork is still attached at the right point.
+  EXPECT_THAT(*fork->fork_time(), Eq(fork_time));
+  EXPECT_THAT(fork->Times().back(), Eq(fork_time + Δt / 2));
+  auto it = fork->on_or_after(fork_time);
+  EXPECT_EQ(degrees_of_freedom(fork_time), it.degrees_of_freedom());
+  ++it;
+  EXPECT_EQ(fork_time + Δt / 2, it.time());
+}
+
+TEST_F(TrajectoryTest, LevelsOfDetail) {
+  // A circular orbit with a period of 6000 s, sampled every 10 s.
+  AngularFrequency const ω = 2 * π * Radian / (6000 * Second);
+  Length const r = 1000 * Kilo(Metre);
+  auto const degrees_of_freedom = [ω, r](Instant const& t) {
+    Angle const θ = ω * (t - Instant());
+    return DegreesOfFreedom<World>(
+        Position<World>(Vector<Length, World>({r * Cos(θ), r * Sin(θ), 0 * r})),
+        Velocity<World>({-r * ω * Sin(θ) / Radian,
+                         r * ω * Cos(θ) / Radian,
+                         0 * r * ω / Radian}));
+  };
+  // The distance from |point| to the segment [|begin|, |end|].
+  auto const distance_to_segment = [](Position<World> const& point,
+                                      Position<World> const& begin,
+                                      Position<World> const& end) {
+    Displacement<World> const segment = end - begin;
+    Displacement<World> const from_begin = point - begin;
+    double const λ = std::max(0.0,
+                              std::min(1.0,
+                                       InnerProduct(from_begin, segment) /
+                                           InnerProduct(segment, segment)));
+    return (from_begin - λ * segment).Norm();
+  };
+  Time const Δt = 10 * Second;
+  for (int i = 0; i < 1000; ++i) {
+    Instant const t = Instant() + i * Δt;
+    massless_trajectory_->Append(t, degrees_of_freedom(t));
+  }
+  massless_trajectory_->set_levels_of_detail({100 * Metre, 10 * Kilo(Metre)});
+  for (int i = 1000; i <= 2000; ++i) {
+    Instant const t = Instant() + i * Δt;
+    massless_trajectory_->Append(t, degrees_of_freedom(t));
+  }
+
+  EXPECT_THAT(massless_trajectory_->number_of_levels_of_detail(), Eq(2));
+  EXPECT_THAT(massless_trajectory_->level_of_detail_tolerance(1),
+              Eq(10 * Kilo(Metre)));
+  EXPECT_THAT(massless_trajectory_->level_of_detail(0).size(), Lt(1100));
+  EXPECT_THAT(massless_trajectory_->level_of_detail(1).size(), Lt(100));
+  for (int level = 0; level < 2; ++level) {
+    auto const& points = massless_trajectory_->level_of_detail(level);
+    Length const tolerance =
+        massless_trajectory_->level_of_detail_tolerance(level);
+    EXPECT_THAT(points.front().first, Eq(Instant()));
+    EXPECT_THAT(points.back().first, Eq(Instant() + 2000 * Δt));
+    // The points of the level are points of the trajectory, and the other
+    // points are within the tolerance of the level.
+    std::size_t j = 0;
+    for (int i = 0; i <= 2000; ++i) {
+      Instant const t = Instant() + i * Δt;
+      if (points[j].first == t) {
+        EXPECT_EQ(degrees_of_freedom(t), points[j].second);
+        if (j + 1 < points.size()) {
+          ++j;
+        }
+      } else {
+        EXPECT_THAT(distance_to_segment(degrees_of_freedom(t).position(),
+                                        points[j - 1].second.position(),
+                                        points[j].second.position()),
+                    Le(tolerance)) << level << " " << i;
+      }
+    }
+  }
+
+  // The levels follow the truncations of the trajectory.
+  massless_trajectory_->ForgetAfter(Instant() + 1501 * Δt);
+  massless_trajectory_->ForgetBefore(Instant() + 499 * Δt);
+  for (int level = 0; level < 2; ++level) {
+    auto const& points = massless_trajectory_->level_of_detail(level);
+    EXPECT_THAT(points.front().first, Eq(Instant() + 500 * Δt));
+    EXPECT_THAT(points.back().first, Eq(Instant() + 1501 * Δt));
+  }
+  Instant const t = Instant() + 1502 * Δt;
+  massless_trajectory_->Append(t, degrees_of_freedom(t));
+  for (int level = 0; level < 2; ++level) {
+    EXPECT_THAT(massless_trajectory_->level_of_detail(level).back().first,
+                Eq(t));
+  }
+}
+
+TEST_F(TrajectoryTest, Snapshot) {
+  auto const degrees_of_freedom = [](Instant const& t) {
+    Length const x = (t - Instant()) / Second * Metre;
+    return DegreesOfFreedom<World>(
+        Position<World>(Vector<Length, World>({x, 2 * x, 3 * x})),
+        Velocity<World>({1 * Metre / Second,
+                         2 * Metre / Second,
+                         3 * Metre / Second}));
+  };
+  // Checks that |snapshot| has the points at the given times.
+  auto const expect_points = [&degrees_of_freedom](
+      Trajectory<World>::Snapshot const& snapshot,
+      std::vector<Instant> const& times) {
+    EXPECT_THAT(snapshot.size(), Eq(times.size()));
+    auto it = snapshot.begin();
+    for (Instant const& t : times) {
+      ASSERT_TRUE(it != snapshot.end());
+      EXPECT_THAT(it->first, Eq(t));
+      EXPECT_EQ(degrees_of_freedom(t), it->second);
+      ++it;
+    }
+    EXPECT_TRUE(it == snapshot.end());
+  };
+  auto const times = [](double const first, double const last) {
+    std::vector<Instant> result;
+    for (double t = first; t <= last; ++t) {
+      result.push_back(Instant() + t * Second);
+    }
+    return result;
+  };
+
+  for (int i = 0; i < 3000; ++i) {
+    Instant const t = Instant() + i * Second;
+    massless_trajectory_->Append(t, degrees_of_freedom(t));
+  }
+  Trajectory<World>::Snapshot const snapshot1 =
+      massless_trajectory_->snapshot();
+  // Frequent snapshots of a few points.
+  std::vector<Trajectory<World>::Snapshot> snapshots;
+  for (int i = 3000; i < 3100; ++i) {
+    Instant const t = Instant() + i * Second;
+    massless_trajectory_->Append(t, degrees_of_freedom(t));
+    snapshots.push_back(massless_trajectory_->snapshot());
+  }
+  massless_trajectory_->ForgetAfter(Instant() + 3050 * Second);
+  massless_trajectory_->ForgetBefore(Instant() + 1000 * Second);
+  Trajectory<World>* const fork =
+      massless_trajectory_->NewFork(Instant() + 3000 * Second);
+  Instant const fork_last_time = Instant() + 3051.5 * Second;
+  fork->Append(fork_last_time, degrees_of_freedom(fork_last_time));
+  Trajectory<World>::Snapshot const snapshot2 =
+      massless_trajectory_->snapshot();
+  Trajectory<World>::Snapshot const fork_snapshot = fork->snapshot();
+
+  // The snapshots are not affected by the modifications of the trajectory, or
+  // by its destruction.
+  massless_trajectory_.reset();
+  expect_points(snapshot1, times(0, 2999));
+  expect_points(snapshots[0], times(0, 3000));
+  expect_points(snapshots[50], times(0, 3050));
+  expect_points(snapshots.back(), times(0, 3099));
+  expect_points(snapshot2, times(1001, 3050));
+  std::vector<Instant> expected_fork_times = times(1001, 3050);
+  expected_fork_times.push_back(fork_last_time);
+  expect_points(fork_snapshot, expected_fork_times);
+
+  EXPECT_THAT(snapshot2.LowerBound(Instant() + 1500.5 * Second)->first,
+              Eq(Instant() + 1501 * Second));
+  EXPECT_THAT(snapshot2.LowerBound(Instant())->first,
+              Eq(Instant() + 1001 * Second));
+  EXPECT_TRUE(snapshot2.LowerBound(Instant() + 3050.5 * Second) ==
+              snapshot2.end());
+  EXPECT_TRUE(Trajectory<World>::Snapshot().empty());
+}
+
+TEST_F(TrajectoryTest, Archive) {
+  Trajectory<World>::Archive archive(archive_filename_,
+                                     /*number_of_slots=*/10);
+  massless_trajectory_->set_archive(&archive, 1000 * Second);
+  auto const degrees_of_freedom = [](Instant const& t) {
+    Length const x = (t - Instant()) / Second * Metre;
+    return DegreesOfFreedom<World>(
+        Position<World>(Vector<Length, World>({x, 2 * x, 3 * x})),
+        Velocity<World>({1 * Metre / Second,
+                         2 * Metre / Second,
+                         3 * Metre / Second}));
+  };
+  Instant const fork_time = Instant() + 100 * Second;
+  Trajectory<World>* fork = nullptr;
+  for (int i = 0; i <= 5000; ++i) {
+    Instant const t = Instant() + i * Second;
+    massless_trajectory_->Append(t, degrees_of_freedom(t));
+    if (t == fork_time) {
+      fork = massless_trajectory_->NewFork(t);
+    }
+  }
+  EXPECT_THAT(archive.number_of_free_slots(), Lt(10));
+
+  // The archived points are read transparently, also through the fork.
+  int i = 0;
+  for (auto it = massless_trajectory_->first(); !it.at_end(); ++it, ++i) {
+    EXPECT_EQ(Instant() + i * Second, it.time());
+    EXPECT_EQ(degrees_of_freedom(it.time()), it.degrees_of_freedom());
+  }
+  EXPECT_THAT(i, Eq(5001));
+  EXPECT_EQ(degrees_of_freedom(Instant() + 42 * Second),
+            massless_trajectory_->EvaluateDegreesOfFreedom(
+                Instant() + 42 * Second));
+  EXPECT_EQ(fork_time, fork->last().time());
+
+  // Forgetting releases the archive.
+  massless_trajectory_->ForgetBefore(Instant() + 4500 * Second);
+  EXPECT_THAT(archive.number_of_free_slots(), Eq(10));
+  EXPECT_EQ(Instant() + 4501 * Second, massless_trajectory_->first().time());
+}
+
+TEST_F(TrajectoryDeathTest, EvaluateDegreesOfFreedomError) {
+  EXPECT_DEATH({
+    massive_trajectory_->Append(t1_, d1_);
+    massive_trajectory_->Append(t2_, d2_);
+    massive_trajectory_->EvaluateDegreesOfFreedom(t0_);
+  }, "before the beginning");
+  EXPECT_DEATH({
+    massive_trajectory_->Append(t1_, d1_);
+    massive_trajectory_->Append(t2_, d2_);
+    not_null<Trajectory<World>*> const fork = massive_trajectory_->NewFork(t2_);
+    fork->EvaluateDegreesOfFreedom(t3_);
+  }, "after the end");
+}
+
+// The evaluations before the first point of the root are delegated to the past
+// evaluator, from the root and from its forks.
+TEST_F(TrajectoryTest, PastEvaluator) {
+  massive_trajectory_->Append(t2_, d2_);
+  massive_trajectory_->Append(t3_, d3_);
+  not_null<Trajectory<World>*> const fork = massive_trajectory_->NewFork(t3_);
+  fork->Append(t4_, d4_);
+  std::vector<Instant> evaluated_times;
+  massive_trajectory_->set_past_evaluator(
+      [this, &evaluated_times](Instant const& time) {
+        evaluated_times.push_back(time);
+        return d1_;
+      });
+  EXPECT_EQ(d1_, massive_trajectory_->EvaluateDegreesOfFreedom(t1_));
+  EXPECT_EQ(d1_, fork->EvaluateDegreesOfFreedom(t0_));
+  EXPECT_EQ(d2_, fork->EvaluateDegreesOfFreedom(t2_));
+  EXPECT_EQ(d4_, fork->EvaluateDegreesOfFreedom(t4_));
+  EXPECT_THAT(evaluated_times, ElementsAre(t1_, t0_));
+  // The iterators are not affected.
+  EXPECT_EQ(t2_, massive_trajectory_->first().time());
+}
+
+TEST_F(TrajectoryTest, GapEvaluator) {
+  massive_trajectory_->Append(t1_, d1_);
+  massive_trajectory_->Append(t2_, d2_);
+  massive_trajectory_->Append(t3_, d3_);
+  not_null<Trajectory<World>*> const fork = massive_trajectory_->NewFork(t3_);
+  fork->Append(t4_, d4_);
+  Instant const t12 = t1_ + (t2_ - t1_) / 2;
+  Instant const t23 = t2_ + (t3_ - t2_) / 2;
+  Instant const t34 = t3_ + (t4_ - t3_) / 2;
+  DegreesOfFreedom<World> const interpolated23 =
+      massive_trajectory_->EvaluateDegreesOfFreedom(t23);
+  DegreesOfFreedom<World> const interpolated34 =
+      fork->EvaluateDegreesOfFreedom(t34);
+  std::vector<Instant> evaluated_times;
+  // Only the gap after |t1_| is evaluated.
+  massive_trajectory_->set_gap_evaluator(
+      [this, &evaluated_times](
+          Instant const& left_time,
+          Instant const& right_time,
+          Instant const& time,
+          not_null<DegreesOfFreedom<World>*> const degrees_of_freedom) {
+        evaluated_times.push_back(time);
+        if (left_time != t1_) {
+          return false;
+        }
+        EXPECT_EQ(t2_, right_time);
+        *degrees_of_freedom = d4_;
+        return true;
+      });
+  EXPECT_EQ(d4_, massive_trajectory_->EvaluateDegreesOfFreedom(t12));
+  EXPECT_EQ(d4_, fork->EvaluateDegreesOfFreedom(t12));
+  EXPECT_EQ(interpolated23, fork->EvaluateDegreesOfFreedom(t23));
+  EXPECT_EQ(d2_, fork->EvaluateDegreesOfFreedom(t2_));
+  // The points of the fork are interpolated.
+  EXPECT_EQ(interpolated34, fork->EvaluateDegreesOfFreedom(t34));
+  EXPECT_THAT(evaluated_times, ElementsAre(t12, t12, t23));
+}
+
+TEST_F(TrajectoryTest, ForgetBetween) {
+  massive_trajectory_->Append(t1_, d1_);
+  massive_trajectory_->Append(t2_, d2_);
+  massive_trajectory_->Append(t3_, d3_);
+  massive_trajectory_->Append(t4_, d4_);
+  not_null<Trajectory<World>*> const fork = massive_trajectory_->NewFork(t2_);
+  massive_trajectory_->ForgetBetween(t1_, t4_);
+  EXPECT_THAT(massive_trajectory_->Times(), ElementsAre(t1_, t2_, t4_));
+  EXPECT_THAT(fork->Times(), ElementsAre(t1_, t2_, t3_, t4_));
+  EXPECT_EQ(d3_, fork->EvaluateDegreesOfFreedom(t3_));
+  massive_trajectory_->ForgetBetween(t2_, t2_);
+  massive_trajectory_->ForgetBetween(t2_, t4_);
+  EXPECT_THAT(massive_trajectory_->Times(), ElementsAre(t1_, t2_, t4_));
+}
+
+TEST_F(TrajectoryTest, EvaluateDegreesOfFreedomSuccess) {
+  // A cubic motion, which is recovered exactly by the interpolation.
+  auto const degrees_of_freedom = [](Instant const& t) {
+    double const τ = (t - Instant()) / Second;
+    return DegreesOfFreedom<World>(
+        Position<World>(Vector<Length, World>(
+            {(τ * τ * τ - 2 * τ) * Metre, τ * τ * Metre, 3 * Metre})),
+        Velocity<World>({(3 * τ * τ - 2) * Metre / Second,
+                         2 * τ * Metre / Second,
+                         0 * Metre / Second}));
+  };
+  massive_trajectory_->Append(t1_, degrees_of_freedom(t1_));
+  massive_trajectory_->Append(t2_, degrees_of_freedom(t2_));
+  not_null<Trajectory<World>*> const fork = massive_trajectory_->NewFork(t2_);
+  fork->Append(t4_, degrees_of_freedom(t4_));
+
+  EXPECT_EQ(degrees_of_freedom(t1_),
+            fork->EvaluateDegreesOfFreedom(t1_));
+  EXPECT_EQ(degrees_of_freedom(t2_),
+            fork->EvaluateDegreesOfFreedom(t2_));
+  EXPECT_EQ(degrees_of_freedom(t4_),
+            fork->EvaluateDegreesOfFreedom(t4_));
+  // In the parent, and across the fork.
+  for (Instant const t : {t1_ + 3 * Second, t3_, t4_ - 1 * Second}) {
+    DegreesOfFreedom<World> const expected = degrees_of_freedom(t);
+    DegreesOfFreedom<World> const actual = fork->EvaluateDegreesOfFreedom(t);
+    EXPECT_THAT((actual.position() - expected.position()).Norm(),
+                Lt(1E-9 * Metre));
+    EXPECT_THAT((actual.velocity() - expected.velocity()).Norm(),
+                Lt(1E-10 * Metre / Second));
+  }
+}
+
+// The lookups with a hint, in increasing time order across the fork and then
+// backwards, give the same results as those without.
+TEST_F(TrajectoryTest, Hint) {
+  Time const Δt = 1 * Second;
+  for (int i = 0; i <= 3000; ++i) {
+    Instant const t = Instant() + i * Δt;
+    massless_trajectory_->Append(
+        t,
+        DegreesOfFreedom<World>(
+            Position<World>(Displacement<World>(
+                {i * i * Metre, i * Metre, 0 * Metre})),
+            Velocity<World>({2 * i * Metre / Second,
+                             1 * Metre / Second,
+                             0 * Metre / Second})));
+  }
+  Instant const fork_time = Instant() + 2000 * Δt;
+  not_null<Trajectory<World>*> const fork =
+      massless_trajectory_->NewFork(fork_time);
+  fork->ForgetAfter(fork_time);
+  for (int i = 1; i <= 1000; ++i) {
+    fork->Append(fork_time + (i - 0.5) * Δt,
+                 DegreesOfFreedom<World>(Position<World>(), Velocity<World>()));
+  }
+  Trajectory<World>::Hint evaluate_hint;
+  Trajectory<World>::Hint on_or_after_hint;
+  std::vector<Instant> times;
+  for (int i = 0; i < 2950; i += 3) {
+    times.push_back(Instant() + (i + 0.25) * Δt);
+  }
+  times.push_back(Instant() + 1000 * Δt);
+  for (Instant const& t : times) {
+    EXPECT_EQ(fork->EvaluateDegreesOfFreedom(t),
+              fork->EvaluateDegreesOfFreedom(t, &evaluate_hint));
+    auto const expected = fork->on_or_after(t);
+    auto const actual = fork->on_or_after(t, &on_or_after_hint);
+    EXPECT_EQ(expected.time(), actual.time());
+    EXPECT_EQ(expected.degrees_of_freedom(), actual.degrees_of_freedom());
+  }
+  EXPECT_TRUE(fork->on_or_after(Instant() + 3001 * Δt,
+                                &on_or_after_hint).at_end());
+}
+
 TEST_F(TrajectoryDeathTest, IntrinsicAccelerationError) {
   EXPECT_DEATH({
     massive_trajectory_->set_intrinsic_acceleration(
@@ -661,6 +1482,39 @@ TEST_F(TrajectoryDeathTest, IntrinsicAccelerationSuccess) {
   EXPECT_FALSE(massless_trajectory_->has_intrinsic_acceleration());
 }
 
+TEST_F(TrajectoryDeathTest, AffineIntrinsicAcceleration) {
+  massless_trajectory_->Append(t1_, d1_);
+  massless_trajectory_->Append(t2_, d2_);
+  massless_trajectory_->Append(t3_, d3_);
+  not_null<Trajectory<World>*> const fork = massless_trajectory_->NewFork(t2_);
+
+  Trajectory<World>::AffineIntrinsicAcceleration acceleration;
+  acceleration.epoch = t2_;
+  acceleration.acceleration =
+      Vector<Acceleration, World>({1 * SIUnit<Acceleration>(),
+                                   2 * SIUnit<Acceleration>(),
+                                   3 * SIUnit<Acceleration>()});
+  acceleration.jerk = Vector<Quotient<Acceleration, Time>, World>(
+      {1 * SIUnit<Acceleration>() / Second,
+       -1 * SIUnit<Acceleration>() / Second,
+       0 * SIUnit<Acceleration>() / Second});
+  fork->set_intrinsic_acceleration(acceleration);
+  EXPECT_TRUE(fork->has_intrinsic_acceleration());
+  EXPECT_DEATH({
+    fork->set_intrinsic_acceleration(acceleration);
+  }, "already has.* acceleration");
+  EXPECT_THAT(fork->evaluate_intrinsic_acceleration(t2_),
+              Eq(Vector<Acceleration, World>({0 * SIUnit<Acceleration>(),
+                                              0 * SIUnit<Acceleration>(),
+                                              0 * SIUnit<Acceleration>()})));
+  EXPECT_THAT(fork->evaluate_intrinsic_acceleration(t2_ + 2 * Second),
+              Eq(Vector<Acceleration, World>({3 * SIUnit<Acceleration>(),
+                                              0 * SIUnit<Acceleration>(),
+                                              3 * SIUnit<Acceleration>()})));
+  fork->clear_intrinsic_acceleration();
+  EXPECT_FALSE(fork->has_intrinsic_acceleration());
+}
+
 TEST_F(TrajectoryDeathTest, NativeIteratorError) {
   EXPECT_DEATH({
     Trajectory<World>::NativeIterator it = massive_trajectory_->last();
@@ -712,6 +1566,45 @@ TEST_F(TrajectoryTest, NativeIteratorSuccess) {
   EXPECT_TRUE(it.at_end());
 }
 
+TEST_F(TrajectoryTest, Views) {
+  EXPECT_TRUE(massless_trajectory_->times().begin() ==
+              massless_trajectory_->times().end());
+
+  massless_trajectory_->Append(t1_, d1_);
+  massless_trajectory_->Append(t2_, d2_);
+  massless_trajectory_->Append(t3_, d3_);
+  not_null<Trajectory<World>*> const fork = massless_trajectory_->NewFork(t2_);
+  fork->Append(t4_, d4_);
+
+  auto const times = fork->times();
+  EXPECT_THAT(std::vector<Instant>(times.begin(), times.end()),
+              ElementsAre(t1_, t2_, t3_, t4_));
+  auto const positions = fork->positions();
+  EXPECT_THAT(std::vector<Position<World>>(positions.begin(), positions.end()),
+              ElementsAre(d1_.position(),
+                          d2_.position(),
+                          d3_.position(),
+                          d4_.position()));
+  std::vector<Velocity<World>> velocities;
+  for (Velocity<World> const& velocity : fork->velocities()) {
+    velocities.push_back(velocity);
+  }
+  EXPECT_THAT(velocities,
+              ElementsAre(d1_.velocity(),
+                          d2_.velocity(),
+                          d3_.velocity(),
+                          d4_.velocity()));
+
+  // The views agree with the copies.
+  std::map<Instant, Position<World>> const copied_positions =
+      fork->Positions();
+  auto it = copied_positions.cbegin();
+  for (Position<World> const& position : fork->positions()) {
+    EXPECT_EQ(it->second, position);
+    ++it;
+  }
+}
+
 TEST_F(TrajectoryDeathTest, TransformingIteratorError) {
   EXPECT_DEATH({
     Trajectory<World>::TransformingIterator<World> it =
@@ -790,6 +1683,33 @@ TEST_F(TrajectoryTest, TransformingIteratorSuccess) {
   EXPECT_TRUE(it.at_end());
 }
 
+// An iterator with a functor gives the same results as one with the
+// equivalent |Transform|.
+TEST_F(TrajectoryTest, TransformingIteratorWithFunctor) {
+  massless_trajectory_->Append(t1_, d1_);
+  massless_trajectory_->Append(t2_, d2_);
+  massless_trajectory_->Append(t3_, d3_);
+  auto const functor = [this](
+      Instant const& t,
+      DegreesOfFreedom<World> const& from_degrees_of_freedom,
+      not_null<Trajectory<World> const*> const trajectory) {
+    return transform_(t,
+                      from_degrees_of_freedom,
+                      trajectory,
+                      massless_trajectory_.get());
+  };
+
+  auto it = massless_trajectory_->first_with_functor<World>(functor);
+  Trajectory<World>::TransformingIterator<World> expected_it =
+      massless_trajectory_->first_with_transform(massless_transform_);
+  for (; !expected_it.at_end(); ++it, ++expected_it) {
+    ASSERT_FALSE(it.at_end());
+    EXPECT_EQ(expected_it.time(), it.time());
+    EXPECT_EQ(expected_it.degrees_of_freedom(), it.degrees_of_freedom());
+  }
+  EXPECT_TRUE(it.at_end());
+}
+
 TEST_F(TrajectoryTest, NativeIteratorOnOrAfterSuccess) {
   Trajectory<World>::NativeIterator it = massive_trajectory_->on_or_after(t0_);
   EXPECT_TRUE(it.at_end());
@@ -825,6 +1745,36 @@ TEST_F(TrajectoryTest, NativeIteratorOnOrAfterSuccess) {
   EXPECT_TRUE(it.at_end());
 }
 
+// Iterating over a fork of a fork of a fork crosses each fork point once.
+TEST_F(TrajectoryTest, NativeIteratorDeepForks) {
+  massless_trajectory_->Append(t1_, d1_);
+  massless_trajectory_->Append(t2_, d2_);
+  not_null<Trajectory<World>*> const fork1 = massless_trajectory_->NewFork(t2_);
+  fork1->Append(t3_, d3_);
+  not_null<Trajectory<World>*> const fork2 = fork1->NewFork(t3_);
+  fork2->Append(t4_, d4_);
+  // A fork without points of its own.
+  not_null<Trajectory<World>*> const fork3 = fork2->NewFork(t4_);
+
+  std::list<Instant> times;
+  for (auto it = fork3->first(); !it.at_end(); ++it) {
+    times.push_back(it.time());
+  }
+  EXPECT_THAT(times, ElementsAre(t1_, t2_, t3_, t4_));
+
+  times.clear();
+  for (auto it = fork3->on_or_after(t3_); !it.at_end(); ++it) {
+    times.push_back(it.time());
+  }
+  EXPECT_THAT(times, ElementsAre(t3_, t4_));
+
+  Trajectory<World>::NativeIterator it = fork3->last();
+  EXPECT_EQ(t4_, it.time());
+  EXPECT_EQ(d4_, it.degrees_of_freedom());
+  ++it;
+  EXPECT_TRUE(it.at_end());
+}
+
 TEST_F(TrajectoryTest, TransformingIteratorOnOrAfterSuccess) {
   Trajectory<World>::TransformingIterator<World> it =
       massive_trajectory_->on_or_after_with_transform(t0_, massive_transform_);
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <map>
 #include <memory>
+#include <set>
 #include <utility>
+#include <vector>
 
 #include "base/not_null.hpp"
 #include "physics/trajectory.hpp"
@@ -18,11 +21,18 @@ namespace physics {
 // |ThroughFrame|.  Note that the trajectory in |ToFrame| is not the trajectory
 // of a body since its past changes from moment to moment.
 template<typename FromFrame, typename ThroughFrame, typename ToFrame>
-class Transforms {
+class Transforms : private Trajectory<FromFrame>::Observer {
   static_assert(FromFrame::is_inertial && ToFrame::is_inertial,
                 "Both FromFrame and ToFrame must be inertial");
 
  public:
+  Transforms() = default;
+  // Stops observing the trajectories whose results are cached.
+  ~Transforms();
+
+  Transforms(Transforms const&) = delete;
+  Transforms& operator=(Transforms const&) = delete;
+
   // The trajectories are evaluated lazily because they may be extended or
   // deallocated/reallocated between the time when the transforms are created
   // and the time when they are applied.  Thus, the lambdas couldn't capture the
@@ -59,15 +69,166 @@ class Transforms {
   typename Trajectory<ThroughFrame>:: template TransformingIterator<ToFrame>
   second(Trajectory<ThroughFrame> const& through_trajectory);
 
+  // Applies the second transform to a single point, which need not be part of
+  // a trajectory.
+  DegreesOfFreedom<ToFrame> second(
+      Instant const& time,
+      DegreesOfFreedom<ThroughFrame> const& through_degrees_of_freedom) const;
+
+  // Between a call to |BeginSecondPass| and the following call to
+  // |EndSecondPass|, the second transform uses the state of the trajectories of
+  // the bodies defining |ToFrame| at the time of |BeginSecondPass|, and costs a
+  // single affine map per point.  Outside of a pass it reflects their current
+  // state, which is evaluated for each point.  Passes may not be nested.
+  void BeginSecondPass();
+  void EndSecondPass();
+
+  // Applies both transforms to each point of |from_trajectory| in a single
+  // pass and passes the results to |sink|, in increasing time order.  The
+  // second transform depends on the current state of the trajectories of the
+  // bodies defining |ToFrame|, which is evaluated only once.  This is more
+  // efficient than iterating over the results of |first| and applying |second|
+  // to each point.
+  void Apply(Trajectory<FromFrame> const& from_trajectory,
+             std::function<void(Instant const&,
+                                DegreesOfFreedom<ToFrame> const&)> const& sink);
+  // Same as above, but only for the points on or after |begin|, which are
+  // found in logarithmic time.
+  void Apply(Trajectory<FromFrame> const& from_trajectory,
+             Instant const& begin,
+             std::function<void(Instant const&,
+                                DegreesOfFreedom<ToFrame> const&)> const& sink);
+  // Same as above, but only for the points of the level of detail |level| of
+  // |from_trajectory|.
+  void Apply(Trajectory<FromFrame> const& from_trajectory,
+             int const level,
+             Instant const& begin,
+             std::function<void(Instant const&,
+                                DegreesOfFreedom<ToFrame> const&)> const& sink);
+
+  // These functions drop results of the first transform for |trajectory| from
+  // the cache, with the same semantics as the functions of |Trajectory|.  This
+  // object observes the trajectories whose results it caches, so they are
+  // called automatically when points of these trajectories are forgotten, and
+  // when these trajectories are destroyed.  |first| also calls them for the
+  // points outside of the current extent of the trajectory.
+  void ForgetFirstCacheAfter(Trajectory<FromFrame> const& trajectory,
+                             Instant const& time);
+  void ForgetFirstCacheBefore(Trajectory<FromFrame> const& trajectory,
+                              Instant const& time);
+  void ForgetFirstCache(Trajectory<FromFrame> const& trajectory);
+
+  // The maximum number of points cached for all the trajectories together.
+  // When it is exceeded the caches of the least recently used trajectories are
+  // evicted first, then the oldest points of the trajectory being transformed.
+  std::size_t first_cache_capacity() const;
+  void set_first_cache_capacity(std::size_t const capacity);
+
+  // The number of points currently cached, and the number of lookups in the
+  // cache that succeeded and failed since the creation of this object.
+  std::size_t first_cache_size() const;
+  std::int64_t first_cache_hits() const;
+  std::int64_t first_cache_misses() const;
+
+  // Returns an estimate of the memory used by this object and its cache, in
+  // bytes.
+  std::int64_t MemoryUsage() const;
+
  private:
+  // The results of the |first_| transform for one trajectory, in increasing
+  // time order.
+  using FirstCachePoints =
+      std::vector<std::pair<Instant, DegreesOfFreedom<ThroughFrame>>>;
+  struct FirstCache {
+    FirstCachePoints points;
+    // The index following the point last found or inserted.  The points are
+    // usually looked up in increasing time order, so the next lookup is likely
+    // to find its point at that index.
+    std::size_t next = 0;
+    // The value of |first_cache_clock_| when this cache was last used.
+    std::int64_t last_use = 0;
+  };
+
+  using FirstCaches =
+      std::map<not_null<Trajectory<FromFrame> const*>, FirstCache>;
+
+  // The notifications of the trajectories whose results are cached.
+  void ForgotAfter(Trajectory<FromFrame> const& trajectory,
+                   Instant const& time) override;
+  void ForgotBefore(Trajectory<FromFrame> const& trajectory,
+                    Instant const& time) override;
+  void Destroyed(Trajectory<FromFrame> const& trajectory) override;
+
+  // Drops the cached points of |trajectory| that are before its first point or
+  // after its last point.
+  void ForgetFirstCacheOutside(Trajectory<FromFrame> const& trajectory);
+  // Returns the cached result of |first_| for |trajectory| at |time|, or null
+  // if there is none.
+  DegreesOfFreedom<ThroughFrame> const* FindInFirstCache(
+      not_null<Trajectory<FromFrame> const*> const trajectory,
+      Instant const& time);
+  void InsertInFirstCache(
+      not_null<Trajectory<FromFrame> const*> const trajectory,
+      Instant const& time,
+      DegreesOfFreedom<ThroughFrame> const& through_degrees_of_freedom);
+  // Removes the points in [first, last[ of the cache |it|, and the cache
+  // itself if it becomes empty.
+  void EraseFromFirstCache(
+      typename FirstCaches::iterator const it,
+      typename FirstCachePoints::iterator const first,
+      typename FirstCachePoints::iterator const last);
+  // Evicts points until the size of the cache is within its capacity.  The
+  // cache |used| is evicted last.
+  void EvictFromFirstCache(typename FirstCaches::iterator const used);
+
+  // Returns the degrees of freedom of |trajectory|, the trajectory of the body
+  // with the given |index| among those defining |FromFrame|, at |time|.  During
+  // a call to |Apply| the lookup starts from the previous one for that body.
+  DegreesOfFreedom<FromFrame> EvaluateCentre(
+      Trajectory<FromFrame> const& trajectory,
+      int const index,
+      Instant const& time) const;
+
+  // Roughly 15 MB.
+  static std::size_t const kDefaultFirstCacheCapacity = 1 << 18;
+
+  // The second transform doesn't depend on the trajectory.
+  using SecondTransform = std::function<DegreesOfFreedom<ToFrame>(
+      Instant const&,
+      DegreesOfFreedom<ThroughFrame> const&)>;
+
   typename Trajectory<FromFrame>::template Transform<ThroughFrame> first_;
-  typename Trajectory<ThroughFrame>::template Transform<ToFrame> second_;
+  // Returns the second transform for the current state of the trajectories
+  // that define |ToFrame|.  The result must not be kept once these
+  // trajectories change.
+  std::function<SecondTransform()> make_second_;
+  SecondTransform second_;
+  // The result of |make_second_| during a pass, empty outside of a pass.
+  SecondTransform second_pass_;
+
+  // The number of bodies defining |FromFrame|, at most.
+  static int const kMaxCentres = 2;
+
+  // During a call to |Apply|, which transforms the points in increasing time
+  // order, the hints for the lookups in the trajectories of the bodies
+  // defining |FromFrame|, indexed like them.  Null outside of such a call,
+  // since the trajectories may change in-between.
+  typename Trajectory<FromFrame>::Hint* centre_hints_ = nullptr;
 
-  // A cache for the result of the |first_| transform.  This cache assumes that
-  // the iterator is never called with the same time but different degrees of
-  // freedom.
-  std::map<std::pair<not_null<Trajectory<FromFrame> const*>, Instant const>,
-           DegreesOfFreedom<ThroughFrame>> first_cache_;
+  // A cache for the result of the |first_| transform.  Since the trajectories
+  // are mostly extended at their end, only the points appended since the last
+  // rendering of a trajectory are actually transformed.  This cache assumes
+  // that the iterator is never called with the same time but different degrees
+  // of freedom, unless the cache has been told to forget them.
+  FirstCaches first_cache_;
+  std::size_t first_cache_capacity_ = kDefaultFirstCacheCapacity;
+  std::size_t first_cache_size_ = 0;
+  std::int64_t first_cache_clock_ = 0;
+  std::int64_t first_cache_hits_ = 0;
+  std::int64_t first_cache_misses_ = 0;
+  // The trajectories observed by this object, i.e., those for which results
+  // have been cached.  They remain observed after their results are evicted.
+  std::set<not_null<Trajectory<FromFrame> const*>> observed_trajectories_;
 };
 
 }  // namespace physics
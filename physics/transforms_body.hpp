@@ -2,6 +2,10 @@
 
 #include "physics/transforms.hpp"
 
+#include <algorithm>
+
+#include "base/macros.hpp"
+#include "base/memory_usage.hpp"
 #include "base/not_null.hpp"
 #include "geometry/affine_map.hpp"
 #include "geometry/grassmann.hpp"
@@ -16,6 +20,8 @@
 #include "quantities/si.hpp"
 
 using principia::base::make_not_null_unique;
+using principia::base::TreeMemoryUsage;
+using principia::base::VectorMemoryUsage;
 using principia::geometry::AffineMap;
 using principia::geometry::Bivector;
 using principia::geometry::Displacement;
@@ -83,19 +89,15 @@ Transforms<FromFrame, ThroughFrame, ToFrame>::BodyCentredNonRotating(
           not_null<Trajectory<FromFrame> const*> const trajectory) ->
       DegreesOfFreedom<ThroughFrame> {
     // First check if the result is cached.
-    auto cache_it = that->first_cache_.find(std::make_pair(trajectory, t));
-    if (cache_it != that->first_cache_.end()) {
-      return cache_it->second;
+    DegreesOfFreedom<ThroughFrame> const* const cached =
+        that->FindInFirstCache(trajectory, t);
+    if (cached != nullptr) {
+      return *cached;
     }
 
-    // on_or_after() is Ln(N), but it doesn't matter unless the map gets very
-    // big, in which case we'll have cache misses anyway.
-    TYPENAME Trajectory<FromFrame>::NativeIterator const centre_it =
-        from_centre_trajectory().on_or_after(t);
-    CHECK_EQ(centre_it.time(), t)
-        << "Time " << t << " not in centre trajectory";
-    DegreesOfFreedom<FromFrame> const& centre_degrees_of_freedom =
-        centre_it.degrees_of_freedom();
+    // |t| need not be the time of a point of the centre trajectory.
+    DegreesOfFreedom<FromFrame> const centre_degrees_of_freedom =
+        that->EvaluateCentre(from_centre_trajectory(), 0 /*index*/, t);
 
     AffineMap<FromFrame, ThroughFrame, Length, Identity> const position_map(
         centre_degrees_of_freedom.position(),
@@ -109,17 +111,11 @@ Transforms<FromFrame, ThroughFrame, ToFrame>::BodyCentredNonRotating(
                       centre_degrees_of_freedom.velocity())};
 
     // Cache the result before returning it.
-    that->first_cache_.emplace(std::make_pair(trajectory, t),
-                               through_degrees_of_freedom);
+    that->InsertInFirstCache(trajectory, t, through_degrees_of_freedom);
     return std::move(through_degrees_of_freedom);
   };
 
-  transforms->second_ =
-      [to_centre_trajectory](
-          Instant const& t,
-          DegreesOfFreedom<ThroughFrame> const& through_degrees_of_freedom,
-          Trajectory<ThroughFrame> const* trajectory) ->
-      DegreesOfFreedom<ToFrame> {
+  transforms->make_second_ = [to_centre_trajectory]() -> SecondTransform {
     DegreesOfFreedom<ToFrame> const& last_centre_degrees_of_freedom =
         to_centre_trajectory().last().degrees_of_freedom();
 
@@ -128,8 +124,24 @@ Transforms<FromFrame, ThroughFrame, ToFrame>::BodyCentredNonRotating(
         last_centre_degrees_of_freedom.position(),
         Identity<ThroughFrame, ToFrame>());
     Identity<ThroughFrame, ToFrame> const velocity_map;
-    return {position_map(through_degrees_of_freedom.position()),
-            velocity_map(through_degrees_of_freedom.velocity())};
+    return [position_map, velocity_map](
+        Instant const& t,
+        DegreesOfFreedom<ThroughFrame> const& through_degrees_of_freedom) ->
+    DegreesOfFreedom<ToFrame> {
+      return {position_map(through_degrees_of_freedom.position()),
+              velocity_map(through_degrees_of_freedom.velocity())};
+    };
+  };
+  // Outside of a pass the maps are recomputed for each point, as the
+  // trajectories of the bodies may have changed in-between.
+  transforms->second_ =
+      [that](
+          Instant const& t,
+          DegreesOfFreedom<ThroughFrame> const& through_degrees_of_freedom) {
+    if (that->second_pass_) {
+      return that->second_pass_(t, through_degrees_of_freedom);
+    }
+    return that->make_second_()(t, through_degrees_of_freedom);
   };
 
   return transforms;
@@ -155,25 +167,18 @@ Transforms<FromFrame, ThroughFrame, ToFrame>::BarycentricRotating(
           not_null<Trajectory<FromFrame> const*> const trajectory) ->
       DegreesOfFreedom<ThroughFrame> {
     // First check if the result is cached.
-    auto cache_it = that->first_cache_.find(std::make_pair(trajectory, t));
-    if (cache_it != that->first_cache_.end()) {
-      return cache_it->second;
+    DegreesOfFreedom<ThroughFrame> const* const cached =
+        that->FindInFirstCache(trajectory, t);
+    if (cached != nullptr) {
+      return *cached;
     }
 
-    // on_or_after() is Ln(N).
-    TYPENAME Trajectory<FromFrame>::NativeIterator const primary_it =
-        from_primary_trajectory().on_or_after(t);
-    CHECK_EQ(primary_it.time(), t)
-        << "Time " << t << " not in primary trajectory";
-    TYPENAME Trajectory<FromFrame>::NativeIterator secondary_it =
-        from_secondary_trajectory().on_or_after(t);
-    CHECK_EQ(secondary_it.time(), t)
-        << "Time " << t << " not in secondary trajectory";
-
-    DegreesOfFreedom<FromFrame> const& primary_degrees_of_freedom =
-        primary_it.degrees_of_freedom();
-    DegreesOfFreedom<FromFrame> const& secondary_degrees_of_freedom =
-        secondary_it.degrees_of_freedom();
+    // |t| need not be the time of a point of the primary or secondary
+    // trajectories.
+    DegreesOfFreedom<FromFrame> const primary_degrees_of_freedom =
+        that->EvaluateCentre(from_primary_trajectory(), 0 /*index*/, t);
+    DegreesOfFreedom<FromFrame> const secondary_degrees_of_freedom =
+        that->EvaluateCentre(from_secondary_trajectory(), 1 /*index*/, t);
     DegreesOfFreedom<FromFrame> const barycentre_degrees_of_freedom =
         Barycentre<FromFrame, GravitationalParameter>(
             {primary_degrees_of_freedom,
@@ -210,17 +215,12 @@ Transforms<FromFrame, ThroughFrame, ToFrame>::BarycentricRotating(
                            barycentre_degrees_of_freedom.position()) / Radian)};
 
     // Cache the result before returning it.
-    that->first_cache_.emplace(std::make_pair(trajectory, t),
-                               through_degrees_of_freedom);
+    that->InsertInFirstCache(trajectory, t, through_degrees_of_freedom);
     return std::move(through_degrees_of_freedom);
   };
 
-  transforms->second_ =
-      [to_primary_trajectory, to_secondary_trajectory](
-          Instant const& t,
-          DegreesOfFreedom<ThroughFrame> const& through_degrees_of_freedom,
-          Trajectory<ThroughFrame> const* trajectory) ->
-      DegreesOfFreedom<ToFrame> {
+  transforms->make_second_ =
+      [to_primary_trajectory, to_secondary_trajectory]() -> SecondTransform {
     DegreesOfFreedom<ToFrame> const& last_primary_degrees_of_freedom =
         to_primary_trajectory().last().degrees_of_freedom();
     DegreesOfFreedom<ToFrame> const& last_secondary_degrees_of_freedom =
@@ -253,8 +253,24 @@ Transforms<FromFrame, ThroughFrame, ToFrame>::BarycentricRotating(
         from_standard_basis_to_basis_of_last_barycentric_frame);
     Rotation<ThroughFrame, ToFrame> const& velocity_map =
         from_standard_basis_to_basis_of_last_barycentric_frame;
-    return {position_map(through_degrees_of_freedom.position()),
-            velocity_map(through_degrees_of_freedom.velocity())};
+    return [position_map, velocity_map](
+        Instant const& t,
+        DegreesOfFreedom<ThroughFrame> const& through_degrees_of_freedom) ->
+    DegreesOfFreedom<ToFrame> {
+      return {position_map(through_degrees_of_freedom.position()),
+              velocity_map(through_degrees_of_freedom.velocity())};
+    };
+  };
+  // Outside of a pass the maps are recomputed for each point, as the
+  // trajectories of the bodies may have changed in-between.
+  transforms->second_ =
+      [that](
+          Instant const& t,
+          DegreesOfFreedom<ThroughFrame> const& through_degrees_of_freedom) {
+    if (that->second_pass_) {
+      return that->second_pass_(t, through_degrees_of_freedom);
+    }
+    return that->make_second_()(t, through_degrees_of_freedom);
   };
 
   return transforms;
@@ -270,6 +286,7 @@ template<typename FromFrame, typename ThroughFrame, typename ToFrame>
 typename Trajectory<FromFrame>::template TransformingIterator<ThroughFrame>
 Transforms<FromFrame, ThroughFrame, ToFrame>::first(
     Trajectory<FromFrame> const& from_trajectory) {
+  ForgetFirstCacheOutside(from_trajectory);
   return from_trajectory.first_with_transform(first_);
 }
 
@@ -277,7 +294,389 @@ template<typename FromFrame, typename ThroughFrame, typename ToFrame>
 typename Trajectory<ThroughFrame>::template TransformingIterator<ToFrame>
 Transforms<FromFrame, ThroughFrame, ToFrame>::second(
     Trajectory<ThroughFrame> const& through_trajectory) {
-  return through_trajectory.first_with_transform(second_);
+  typename Trajectory<ThroughFrame>::template Transform<ToFrame> const
+      transform =
+          [this](
+              Instant const& t,
+              DegreesOfFreedom<ThroughFrame> const& through_degrees_of_freedom,
+              not_null<Trajectory<ThroughFrame> const*> const trajectory) {
+            return second_(t, through_degrees_of_freedom);
+          };
+  return through_trajectory.first_with_transform(transform);
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+DegreesOfFreedom<ToFrame> Transforms<FromFrame, ThroughFrame, ToFrame>::second(
+    Instant const& time,
+    DegreesOfFreedom<ThroughFrame> const& through_degrees_of_freedom) const {
+  return second_(time, through_degrees_of_freedom);
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::BeginSecondPass() {
+  CHECK(!second_pass_) << "Nested passes";
+  second_pass_ = make_second_();
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::EndSecondPass() {
+  CHECK(second_pass_) << "No pass in progress";
+  second_pass_ = nullptr;
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::Apply(
+    Trajectory<FromFrame> const& from_trajectory,
+    std::function<void(Instant const&,
+                       DegreesOfFreedom<ToFrame> const&)> const& sink) {
+  auto const it = from_trajectory.first();
+  if (it.at_end()) {
+    ForgetFirstCacheOutside(from_trajectory);
+    return;
+  }
+  Apply(from_trajectory, it.time(), sink);
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::Apply(
+    Trajectory<FromFrame> const& from_trajectory,
+    Instant const& begin,
+    std::function<void(Instant const&,
+                       DegreesOfFreedom<ToFrame> const&)> const& sink) {
+  ForgetFirstCacheOutside(from_trajectory);
+  if (from_trajectory.on_or_after(begin).at_end()) {
+    return;
+  }
+  SecondTransform const second =
+      second_pass_ ? second_pass_ : make_second_();
+  typename Trajectory<FromFrame>::Hint hints[kMaxCentres];
+  centre_hints_ = hints;
+  // The iterator holds the lambda itself, not a |std::function|.
+  auto const both_transforms =
+      [this, &second](
+          Instant const& t,
+          DegreesOfFreedom<FromFrame> const& from_degrees_of_freedom,
+          not_null<Trajectory<FromFrame> const*> const trajectory) {
+        return second(t, first_(t, from_degrees_of_freedom, trajectory));
+      };
+  for (auto it =
+           from_trajectory.template on_or_after_with_functor<ToFrame>(
+               begin, both_transforms);
+       !it.at_end();
+       ++it) {
+    sink(it.time(), it.degrees_of_freedom());
+  }
+  centre_hints_ = nullptr;
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::Apply(
+    Trajectory<FromFrame> const& from_trajectory,
+    int const level,
+    Instant const& begin,
+    std::function<void(Instant const&,
+                       DegreesOfFreedom<ToFrame> const&)> const& sink) {
+  ForgetFirstCacheOutside(from_trajectory);
+  SecondTransform const second =
+      second_pass_ ? second_pass_ : make_second_();
+  typename Trajectory<FromFrame>::Hint hints[kMaxCentres];
+  centre_hints_ = hints;
+  auto const& points = from_trajectory.level_of_detail(level);
+  for (auto it = std::lower_bound(
+           points.begin(),
+           points.end(),
+           begin,
+           [](std::pair<Instant, DegreesOfFreedom<FromFrame>> const& point,
+              Instant const& time) {
+             return point.first < time;
+           });
+       it != points.end();
+       ++it) {
+    sink(it->first,
+         second(it->first, first_(it->first, it->second, &from_trajectory)));
+  }
+  centre_hints_ = nullptr;
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+Transforms<FromFrame, ThroughFrame, ToFrame>::~Transforms() {
+  typename Trajectory<FromFrame>::Observer* const observer = this;
+  for (not_null<Trajectory<FromFrame> const*> const trajectory :
+           observed_trajectories_) {
+    trajectory->RemoveObserver(observer);
+  }
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::ForgetFirstCacheAfter(
+    Trajectory<FromFrame> const& trajectory,
+    Instant const& time) {
+  auto const it = first_cache_.find(&trajectory);
+  if (it == first_cache_.end()) {
+    return;
+  }
+  auto& points = it->second.points;
+  EraseFromFirstCache(
+      it,
+      std::upper_bound(
+          points.begin(),
+          points.end(),
+          time,
+          [](Instant const& time,
+             std::pair<Instant, DegreesOfFreedom<ThroughFrame>> const& point) {
+            return time < point.first;
+          }),
+      points.end());
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::ForgetFirstCacheBefore(
+    Trajectory<FromFrame> const& trajectory,
+    Instant const& time) {
+  auto const it = first_cache_.find(&trajectory);
+  if (it == first_cache_.end()) {
+    return;
+  }
+  auto& points = it->second.points;
+  EraseFromFirstCache(
+      it,
+      points.begin(),
+      std::upper_bound(
+          points.begin(),
+          points.end(),
+          time,
+          [](Instant const& time,
+             std::pair<Instant, DegreesOfFreedom<ThroughFrame>> const& point) {
+            return time < point.first;
+          }));
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::ForgetFirstCache(
+    Trajectory<FromFrame> const& trajectory) {
+  auto const it = first_cache_.find(&trajectory);
+  if (it != first_cache_.end()) {
+    auto& points = it->second.points;
+    EraseFromFirstCache(it, points.begin(), points.end());
+  }
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::ForgotAfter(
+    Trajectory<FromFrame> const& trajectory,
+    Instant const& time) {
+  ForgetFirstCacheAfter(trajectory, time);
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::ForgotBefore(
+    Trajectory<FromFrame> const& trajectory,
+    Instant const& time) {
+  ForgetFirstCacheBefore(trajectory, time);
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::Destroyed(
+    Trajectory<FromFrame> const& trajectory) {
+  ForgetFirstCache(trajectory);
+  observed_trajectories_.erase(&trajectory);
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+std::size_t
+Transforms<FromFrame, ThroughFrame, ToFrame>::first_cache_capacity() const {
+  return first_cache_capacity_;
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::set_first_cache_capacity(
+    std::size_t const capacity) {
+  first_cache_capacity_ = capacity;
+  EvictFromFirstCache(first_cache_.end());
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+std::size_t
+Transforms<FromFrame, ThroughFrame, ToFrame>::first_cache_size() const {
+  return first_cache_size_;
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+std::int64_t
+Transforms<FromFrame, ThroughFrame, ToFrame>::first_cache_hits() const {
+  return first_cache_hits_;
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+std::int64_t
+Transforms<FromFrame, ThroughFrame, ToFrame>::first_cache_misses() const {
+  return first_cache_misses_;
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+std::int64_t Transforms<FromFrame, ThroughFrame, ToFrame>::MemoryUsage() const {
+  std::int64_t usage = sizeof(Transforms) + TreeMemoryUsage(first_cache_);
+  for (auto const& pair : first_cache_) {
+    usage += VectorMemoryUsage(pair.second.points);
+  }
+  return usage;
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::ForgetFirstCacheOutside(
+    Trajectory<FromFrame> const& trajectory) {
+  // The cached points that are outside of the trajectory must have been
+  // forgotten since the last call.
+  auto const it = trajectory.first();
+  if (it.at_end()) {
+    ForgetFirstCache(trajectory);
+  } else {
+    ForgetFirstCacheAfter(trajectory, trajectory.last().time());
+    auto const cache = first_cache_.find(&trajectory);
+    if (cache != first_cache_.end()) {
+      auto& points = cache->second.points;
+      EraseFromFirstCache(
+          cache,
+          points.begin(),
+          std::lower_bound(
+              points.begin(),
+              points.end(),
+              it.time(),
+              [](std::pair<Instant, DegreesOfFreedom<ThroughFrame>> const&
+                     point,
+                 Instant const& time) {
+                return point.first < time;
+              }));
+    }
+  }
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+DegreesOfFreedom<ThroughFrame> const*
+Transforms<FromFrame, ThroughFrame, ToFrame>::FindInFirstCache(
+    not_null<Trajectory<FromFrame> const*> const trajectory,
+    Instant const& time) {
+  auto const it = first_cache_.find(trajectory);
+  if (it == first_cache_.end()) {
+    ++first_cache_misses_;
+    return nullptr;
+  }
+  FirstCache& cache = it->second;
+  cache.last_use = ++first_cache_clock_;
+  auto const& points = cache.points;
+  std::size_t i = cache.next;
+  if (i >= points.size() || points[i].first != time) {
+    i = std::lower_bound(
+            points.begin(),
+            points.end(),
+            time,
+            [](std::pair<Instant, DegreesOfFreedom<ThroughFrame>> const& point,
+               Instant const& time) {
+              return point.first < time;
+            }) - points.begin();
+    if (i == points.size() || points[i].first != time) {
+      ++first_cache_misses_;
+      return nullptr;
+    }
+  }
+  ++first_cache_hits_;
+  cache.next = i + 1;
+  return &points[i].second;
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::InsertInFirstCache(
+    not_null<Trajectory<FromFrame> const*> const trajectory,
+    Instant const& time,
+    DegreesOfFreedom<ThroughFrame> const& through_degrees_of_freedom) {
+  auto cache_it = first_cache_.find(trajectory);
+  if (cache_it == first_cache_.end()) {
+    cache_it = first_cache_.emplace(trajectory, FirstCache()).first;
+    if (observed_trajectories_.insert(trajectory).second) {
+      typename Trajectory<FromFrame>::Observer* const observer = this;
+      trajectory->AddObserver(observer);
+    }
+  }
+  FirstCache& cache = cache_it->second;
+  auto& points = cache.points;
+  auto it = points.end();
+  if (!points.empty() && time < points.back().first) {
+    it = std::lower_bound(
+             points.begin(),
+             points.end(),
+             time,
+             [](std::pair<Instant, DegreesOfFreedom<ThroughFrame>> const& point,
+                Instant const& time) {
+               return point.first < time;
+             });
+  }
+  it = points.emplace(it, time, through_degrees_of_freedom);
+  cache.next = it - points.begin() + 1;
+  cache.last_use = ++first_cache_clock_;
+  ++first_cache_size_;
+  if (first_cache_size_ > first_cache_capacity_) {
+    EvictFromFirstCache(cache_it);
+  }
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::EraseFromFirstCache(
+    typename FirstCaches::iterator const it,
+    typename FirstCachePoints::iterator const first,
+    typename FirstCachePoints::iterator const last) {
+  auto& points = it->second.points;
+  first_cache_size_ -= last - first;
+  points.erase(first, last);
+  if (points.empty()) {
+    first_cache_.erase(it);
+  } else {
+    it->second.next = 0;
+  }
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+void Transforms<FromFrame, ThroughFrame, ToFrame>::EvictFromFirstCache(
+    typename FirstCaches::iterator const used) {
+  // The number of trajectories is small, so a linear search for the least
+  // recently used one is cheap compared to the transforms.
+  while (first_cache_size_ > first_cache_capacity_) {
+    auto least_recently_used = first_cache_.end();
+    for (auto it = first_cache_.begin(); it != first_cache_.end(); ++it) {
+      if (it != used &&
+          (least_recently_used == first_cache_.end() ||
+           it->second.last_use < least_recently_used->second.last_use)) {
+        least_recently_used = it;
+      }
+    }
+    if (least_recently_used == first_cache_.end()) {
+      break;
+    }
+    auto& points = least_recently_used->second.points;
+    EraseFromFirstCache(least_recently_used, points.begin(), points.end());
+  }
+  if (first_cache_size_ > first_cache_capacity_) {
+    // Only |used| remains and it doesn't fit.  Forget at least half of its
+    // points, starting with the oldest ones, so that the cost of the eviction
+    // is amortized over many insertions.
+    CHECK(used != first_cache_.end());
+    auto& points = used->second.points;
+    std::size_t const count = std::max(first_cache_size_ - first_cache_capacity_,
+                                       points.size() / 2);
+    EraseFromFirstCache(used, points.begin(), points.begin() + count);
+  }
+}
+
+template<typename FromFrame, typename ThroughFrame, typename ToFrame>
+DegreesOfFreedom<FromFrame>
+Transforms<FromFrame, ThroughFrame, ToFrame>::EvaluateCentre(
+    Trajectory<FromFrame> const& trajectory,
+    int const index,
+    Instant const& time) const {
+  if (centre_hints_ == nullptr) {
+    return trajectory.EvaluateDegreesOfFreedom(time);
+  }
+  DEBUG_CHECK(index >= 0 && index < kMaxCentres);
+  return trajectory.EvaluateDegreesOfFreedom(time, &centre_hints_[index]);
 }
 
 }  // namespace physics
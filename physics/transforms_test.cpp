@@ -1,6 +1,9 @@
 #include "physics/transforms.hpp"
 
+#include <cstdint>
 #include <limits>
+#include <utility>
+#include <vector>
 
 #include "geometry/frame.hpp"
 #include "base/not_null.hpp"
@@ -170,6 +173,196 @@ TEST_F(TransformsTest, BodyCentredNonRotating) {
   }
 }
 
+// The cached results of the first transform remain correct when the
+// trajectory is extended, and the second transform may be applied to points.
+TEST_F(TransformsTest, IncrementalBodyCentredNonRotating) {
+  auto const transforms = Transforms<From, Through, To>::BodyCentredNonRotating(
+                    body1_from_fn_, body1_to_fn_);
+  Trajectory<From> satellite_from(&satellite_);
+  auto const append_satellite = [&satellite_from](int const i) {
+    satellite_from.Append(
+        Instant(i * SIUnit<Time>()),
+        DegreesOfFreedom<From>(
+            Position<From>(
+                Displacement<From>({10 * i * SIUnit<Length>(),
+                                    -20 * i * SIUnit<Length>(),
+                                    30 * i * SIUnit<Length>()})),
+            Velocity<From>({40 * i * SIUnit<Speed>(),
+                            -80 * i * SIUnit<Speed>(),
+                            160 * i * SIUnit<Speed>()})));
+  };
+  auto const check_satellite = [&satellite_from, &transforms](int const n) {
+    int i = 1;
+    for (auto it = transforms->first(satellite_from); !it.at_end(); ++it, ++i) {
+      EXPECT_THAT(it.degrees_of_freedom(),
+                  Componentwise(
+                      Eq(Through::origin +
+                         Displacement<Through>({9 * i * SIUnit<Length>(),
+                                                -22 * i * SIUnit<Length>(),
+                                                27 * i * SIUnit<Length>()})),
+                      Eq(Velocity<Through>({36 * i * SIUnit<Speed>(),
+                                            -88 * i * SIUnit<Speed>(),
+                                            144 * i * SIUnit<Speed>()}))))
+          << i;
+    }
+    EXPECT_EQ(n + 1, i);
+  };
+
+  for (int i = 1; i <= kNumberOfPoints / 2; ++i) {
+    append_satellite(i);
+  }
+  check_satellite(kNumberOfPoints / 2);
+  check_satellite(kNumberOfPoints / 2);
+  for (int i = kNumberOfPoints / 2 + 1; i <= kNumberOfPoints; ++i) {
+    append_satellite(i);
+  }
+  check_satellite(kNumberOfPoints);
+
+  body1_to_->Append(Instant(),
+                    DegreesOfFreedom<To>(
+                        Position<To>(
+                            Displacement<To>({3 * SIUnit<Length>(),
+                                              1 * SIUnit<Length>(),
+                                              2 * SIUnit<Length>()})),
+                        Velocity<To>({16 * SIUnit<Speed>(),
+                                      4 * SIUnit<Speed>(),
+                                      8 * SIUnit<Speed>()})));
+  EXPECT_THAT(
+      transforms->second(
+          Instant(),
+          DegreesOfFreedom<Through>(
+              Through::origin +
+                  Displacement<Through>({9 * SIUnit<Length>(),
+                                         -22 * SIUnit<Length>(),
+                                         27 * SIUnit<Length>()}),
+              Velocity<Through>({36 * SIUnit<Speed>(),
+                                 -88 * SIUnit<Speed>(),
+                                 144 * SIUnit<Speed>()}))),
+      Componentwise(Eq(To::origin +
+                       Displacement<To>({12 * SIUnit<Length>(),
+                                         -21 * SIUnit<Length>(),
+                                         29 * SIUnit<Length>()})),
+                    Eq(Velocity<To>({36 * SIUnit<Speed>(),
+                                     -88 * SIUnit<Speed>(),
+                                     144 * SIUnit<Speed>()}))));
+}
+
+TEST_F(TransformsTest, FirstCache) {
+  auto const transforms = Transforms<From, Through, To>::BodyCentredNonRotating(
+                    body1_from_fn_, body1_to_fn_);
+  auto const iterate = [&transforms](Trajectory<From> const& trajectory) {
+    int count = 0;
+    for (auto it = transforms->first(trajectory); !it.at_end(); ++it) {
+      it.degrees_of_freedom();
+      ++count;
+    }
+    return count;
+  };
+
+  std::int64_t const empty_memory_usage = transforms->MemoryUsage();
+  EXPECT_EQ(kNumberOfPoints, iterate(*satellite_from_));
+  EXPECT_EQ(kNumberOfPoints, transforms->first_cache_size());
+  EXPECT_EQ(0, transforms->first_cache_hits());
+  EXPECT_EQ(kNumberOfPoints, transforms->first_cache_misses());
+  EXPECT_LE(empty_memory_usage +
+                kNumberOfPoints *
+                    static_cast<std::int64_t>(sizeof(
+                        std::pair<Instant, DegreesOfFreedom<Through>>)),
+            transforms->MemoryUsage());
+  EXPECT_EQ(kNumberOfPoints, iterate(*satellite_from_));
+  EXPECT_EQ(kNumberOfPoints, transforms->first_cache_size());
+  EXPECT_EQ(kNumberOfPoints, transforms->first_cache_hits());
+  EXPECT_EQ(kNumberOfPoints, transforms->first_cache_misses());
+
+  // The points forgotten by the trajectory are dropped from the cache.
+  satellite_from_->ForgetAfter(Instant(15 * SIUnit<Time>()));
+  EXPECT_EQ(15, iterate(*satellite_from_));
+  EXPECT_EQ(15, transforms->first_cache_size());
+  EXPECT_EQ(kNumberOfPoints + 15, transforms->first_cache_hits());
+  transforms->ForgetFirstCacheBefore(*satellite_from_,
+                                     Instant(5 * SIUnit<Time>()));
+  EXPECT_EQ(10, transforms->first_cache_size());
+  transforms->ForgetFirstCacheAfter(*satellite_from_,
+                                    Instant(14 * SIUnit<Time>()));
+  EXPECT_EQ(9, transforms->first_cache_size());
+
+  // The least recently used trajectory is evicted first.
+  EXPECT_EQ(kNumberOfPoints, iterate(*body2_from_));
+  EXPECT_EQ(9 + kNumberOfPoints, transforms->first_cache_size());
+  transforms->set_first_cache_capacity(kNumberOfPoints + 5);
+  EXPECT_EQ(kNumberOfPoints, transforms->first_cache_size());
+  EXPECT_EQ(kNumberOfPoints, iterate(*body2_from_));
+  EXPECT_EQ(kNumberOfPoints, transforms->first_cache_size());
+
+  // A trajectory that doesn't fit in the cache is still transformed correctly.
+  transforms->set_first_cache_capacity(8);
+  EXPECT_EQ(0, transforms->first_cache_size());
+  EXPECT_EQ(8, transforms->first_cache_capacity());
+  auto it = transforms->first(*satellite_from_);
+  for (int i = 1; i <= 15; ++i, ++it) {
+    EXPECT_THAT(it.degrees_of_freedom(),
+                Componentwise(
+                    Eq(Through::origin +
+                       Displacement<Through>({9 * i * SIUnit<Length>(),
+                                              -22 * i * SIUnit<Length>(),
+                                              27 * i * SIUnit<Length>()})),
+                    Eq(Velocity<Through>({36 * i * SIUnit<Speed>(),
+                                          -88 * i * SIUnit<Speed>(),
+                                          144 * i * SIUnit<Speed>()}))));
+    EXPECT_LE(transforms->first_cache_size(), 8);
+  }
+  EXPECT_TRUE(it.at_end());
+
+  transforms->ForgetFirstCache(*satellite_from_);
+  EXPECT_EQ(0, transforms->first_cache_size());
+}
+
+// The cache observes the trajectories, so it drops the results for the points
+// that they forget, even if new points are later appended at the same times,
+// and those for the trajectories that are destroyed.
+TEST_F(TransformsTest, FirstCacheObservesTrajectories) {
+  auto const transforms = Transforms<From, Through, To>::BodyCentredNonRotating(
+                    body1_from_fn_, body1_to_fn_);
+  auto const last = [&transforms](Trajectory<From> const& trajectory) {
+    DegreesOfFreedom<Through> degrees_of_freedom = {Through::origin,
+                                                    Velocity<Through>()};
+    for (auto it = transforms->first(trajectory); !it.at_end(); ++it) {
+      degrees_of_freedom = it.degrees_of_freedom();
+    }
+    return degrees_of_freedom;
+  };
+
+  last(*satellite_from_);
+  EXPECT_EQ(kNumberOfPoints, transforms->first_cache_size());
+  satellite_from_->ForgetAfter(Instant(15 * SIUnit<Time>()));
+  EXPECT_EQ(15, transforms->first_cache_size());
+  satellite_from_->Append(Instant(16 * SIUnit<Time>()),
+                          DegreesOfFreedom<From>(From::origin,
+                                                 Velocity<From>()));
+  EXPECT_THAT(last(*satellite_from_),
+              Componentwise(
+                  Eq(Through::origin +
+                     Displacement<Through>({-16 * SIUnit<Length>(),
+                                            -32 * SIUnit<Length>(),
+                                            -48 * SIUnit<Length>()})),
+                  Eq(Velocity<Through>({-64 * SIUnit<Speed>(),
+                                        -128 * SIUnit<Speed>(),
+                                        -256 * SIUnit<Speed>()}))));
+  EXPECT_EQ(16, transforms->first_cache_size());
+
+  satellite_from_->ForgetBefore(Instant(5 * SIUnit<Time>()));
+  EXPECT_EQ(11, transforms->first_cache_size());
+
+  Trajectory<From>* fork =
+      satellite_from_->NewFork(Instant(16 * SIUnit<Time>()));
+  fork->Append(Instant(17 * SIUnit<Time>()),
+               DegreesOfFreedom<From>(From::origin, Velocity<From>()));
+  last(*fork);
+  EXPECT_EQ(11 + 12, transforms->first_cache_size());
+  satellite_from_->DeleteFork(&fork);
+  EXPECT_EQ(11, transforms->first_cache_size());
+}
+
 // Check that the computations we do match those done using Mathematica.
 TEST_F(TransformsTest, SatelliteBarycentricRotating) {
   auto const transforms = Transforms<From, Through, To>::BarycentricRotating(
@@ -299,5 +492,120 @@ TEST_F(TransformsTest, BodiesBarycentricRotating) {
   }
 }
 
+// During a pass the second transform ignores the points appended to the
+// trajectory of the centre.
+TEST_F(TransformsTest, SecondPass) {
+  auto const transforms = Transforms<From, Through, To>::BodyCentredNonRotating(
+                    body1_from_fn_, body1_to_fn_);
+  auto const append_body1 = [this](int const i) {
+    body1_to_->Append(Instant(i * SIUnit<Time>()),
+                      DegreesOfFreedom<To>(
+                          Position<To>(
+                              Displacement<To>({3 * i * SIUnit<Length>(),
+                                                1 * i * SIUnit<Length>(),
+                                                2 * i * SIUnit<Length>()})),
+                          Velocity<To>({16 * i * SIUnit<Speed>(),
+                                        4 * i * SIUnit<Speed>(),
+                                        8 * i * SIUnit<Speed>()})));
+  };
+  DegreesOfFreedom<Through> const through_degrees_of_freedom(
+      Through::origin + Displacement<Through>({9 * SIUnit<Length>(),
+                                               -22 * SIUnit<Length>(),
+                                               27 * SIUnit<Length>()}),
+      Velocity<Through>({36 * SIUnit<Speed>(),
+                         -88 * SIUnit<Speed>(),
+                         144 * SIUnit<Speed>()}));
+  Position<To> const position_1 =
+      To::origin + Displacement<To>({12 * SIUnit<Length>(),
+                                     -21 * SIUnit<Length>(),
+                                     29 * SIUnit<Length>()});
+  Position<To> const position_2 =
+      To::origin + Displacement<To>({15 * SIUnit<Length>(),
+                                     -20 * SIUnit<Length>(),
+                                     31 * SIUnit<Length>()});
+
+  append_body1(1);
+  transforms->BeginSecondPass();
+  EXPECT_THAT(transforms->second(Instant(), through_degrees_of_freedom)
+                  .position(),
+              Eq(position_1));
+  append_body1(2);
+  EXPECT_THAT(transforms->second(Instant(), through_degrees_of_freedom)
+                  .position(),
+              Eq(position_1));
+  transforms->EndSecondPass();
+  EXPECT_THAT(transforms->second(Instant(), through_degrees_of_freedom)
+                  .position(),
+              Eq(position_2));
+}
+
+// |Apply| gives the same results as the two transforms applied in sequence.
+TEST_F(TransformsTest, Apply) {
+  auto const transforms = Transforms<From, Through, To>::BarycentricRotating(
+                              body1_from_fn_, body1_to_fn_,
+                              body2_from_fn_, body2_to_fn_);
+  body1_to_->Append(
+      Instant(kNumberOfPoints * SIUnit<Time>()),
+      DegreesOfFreedom<To>(
+          Position<To>(Displacement<To>({3 * SIUnit<Length>(),
+                                         1 * SIUnit<Length>(),
+                                         2 * SIUnit<Length>()})),
+          Velocity<To>({16 * SIUnit<Speed>(),
+                        4 * SIUnit<Speed>(),
+                        8 * SIUnit<Speed>()})));
+  body2_to_->Append(
+      Instant(kNumberOfPoints * SIUnit<Time>()),
+      DegreesOfFreedom<To>(
+          Position<To>(Displacement<To>({-1 * SIUnit<Length>(),
+                                         -5 * SIUnit<Length>(),
+                                         -7 * SIUnit<Length>()})),
+          Velocity<To>({3 * SIUnit<Speed>(),
+                        -2 * SIUnit<Speed>(),
+                        -11 * SIUnit<Speed>()})));
+
+  std::vector<Instant> expected_times;
+  std::vector<DegreesOfFreedom<To>> expected_degrees_of_freedom;
+  for (auto it = transforms->first(*satellite_from_); !it.at_end(); ++it) {
+    expected_times.push_back(it.time());
+    expected_degrees_of_freedom.push_back(
+        transforms->second(it.time(), it.degrees_of_freedom()));
+  }
+
+  std::vector<Instant> times;
+  std::vector<DegreesOfFreedom<To>> degrees_of_freedom;
+  transforms->Apply(
+      *satellite_from_,
+      [&times, &degrees_of_freedom](
+          Instant const& time,
+          DegreesOfFreedom<To> const& to_degrees_of_freedom) {
+        times.push_back(time);
+        degrees_of_freedom.push_back(to_degrees_of_freedom);
+      });
+  EXPECT_THAT(times, Eq(expected_times));
+  EXPECT_THAT(degrees_of_freedom, Eq(expected_degrees_of_freedom));
+  EXPECT_THAT(degrees_of_freedom.size(), Eq(kNumberOfPoints));
+
+  // Only the points on or after |begin|.
+  std::size_t const first_index = kNumberOfPoints / 2;
+  times.clear();
+  degrees_of_freedom.clear();
+  transforms->Apply(
+      *satellite_from_,
+      expected_times[first_index],
+      [&times, &degrees_of_freedom](
+          Instant const& time,
+          DegreesOfFreedom<To> const& to_degrees_of_freedom) {
+        times.push_back(time);
+        degrees_of_freedom.push_back(to_degrees_of_freedom);
+      });
+  EXPECT_THAT(times,
+              Eq(std::vector<Instant>(expected_times.begin() + first_index,
+                                      expected_times.end())));
+  EXPECT_THAT(degrees_of_freedom,
+              Eq(std::vector<DegreesOfFreedom<To>>(
+                     expected_degrees_of_freedom.begin() + first_index,
+                     expected_degrees_of_freedom.end())));
+}
+
 }  // namespace physics
 }  // namespace principia
@@ -10,12 +10,13 @@ namespace principia {
 // This namespace contains units commonly used in astronomy that are not
 // accepted for use with the SI.
 namespace astronomy {
-quantities::Mass   const SolarMass     = 1.98855e30 * si::Kilogram;
-quantities::Mass   const JupiterMass   = 1.8986e27 * si::Kilogram;
-quantities::Mass   const EarthMass     = 5.9742e24 * si::Kilogram;
-quantities::Time   const JulianYear    = 365.25 * si::Day;
-quantities::Length const Parsec        = 648000 / π * si::AstronomicalUnit;
-quantities::Length const LightYear     = constants::SpeedOfLight * JulianYear;
-quantities::Length const LunarDistance = 384400000 * si::Metre;
+CONSTEXPR quantities::Mass const SolarMass = 1.98855e30 * si::Kilogram;
+CONSTEXPR quantities::Mass const JupiterMass = 1.8986e27 * si::Kilogram;
+CONSTEXPR quantities::Mass const EarthMass = 5.9742e24 * si::Kilogram;
+CONSTEXPR quantities::Time const JulianYear = 365.25 * si::Day;
+CONSTEXPR quantities::Length const Parsec = 648000 / π * si::AstronomicalUnit;
+CONSTEXPR quantities::Length const LightYear =
+    constants::SpeedOfLight * JulianYear;
+CONSTEXPR quantities::Length const LunarDistance = 384400000 * si::Metre;
 }  // namespace astronomy
 }  // namespace principia
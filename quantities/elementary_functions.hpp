@@ -1,5 +1,8 @@
 ﻿#pragma once
 
+#include <vector>
+
+#include "base/not_null.hpp"
 #include "quantities/quantities.hpp"
 
 namespace principia {
@@ -11,10 +14,45 @@ double Sqrt(double const x);
 template<typename D>
 SquareRoot<Quantity<D>> Sqrt(Quantity<D> const& x);
 
+// The precision of |InverseSqrt|.
+enum class InverseSqrtPrecision {
+  // Computed as |1 / Sqrt(x)|.
+  kExact,
+  // Computed without a division, by refining the hardware approximation of the
+  // inverse square root with Newton iterations.  Within 2 ulps of
+  // |1 / Sqrt(x)|.  Same as |kExact| if the processor has no such
+  // approximation or if |x| is outside of its range.
+  kFast,
+};
+
+// Returns |1 / Sqrt(x)| with the given |precision|.
+template<InverseSqrtPrecision precision = InverseSqrtPrecision::kExact>
+double InverseSqrt(double const x);
+template<InverseSqrtPrecision precision = InverseSqrtPrecision::kExact,
+         typename D>
+Quotient<double, SquareRoot<Quantity<D>>> InverseSqrt(Quantity<D> const& x);
+
 double Sin(Angle const& α);
 double Cos(Angle const& α);
 double Tan(Angle const& α);
 
+// Batched versions of the above, for arrays of arguments: the element of
+// |result| at each index is the function of the element of |α| or |x| at that
+// index.  |result| is resized to the size of the arguments.  If the processor
+// supports AVX, |Sin| and |Cos| evaluate polynomial approximations on four
+// angles at a time; their results are within 1 ulp of the exact values, but
+// may differ in the last bit from those of the scalar functions.  Angles
+// larger than 2^19 π/2 rad in absolute value, and non-finite angles, are
+// passed to the scalar functions.
+// |Sqrt| is correctly rounded in all cases.
+void Sin(std::vector<Angle> const& α,
+         not_null<std::vector<double>*> const result);
+void Cos(std::vector<Angle> const& α,
+         not_null<std::vector<double>*> const result);
+template<typename D>
+void Sqrt(std::vector<Quantity<D>> const& x,
+          not_null<std::vector<SquareRoot<Quantity<D>>>*> const result);
+
 Angle ArcSin(double const x);
 Angle ArcCos(double const x);
 Angle ArcTan(double const y, double const x = 1);
@@ -1,8 +1,10 @@
 ﻿#pragma once
 
+#include "base/macros.hpp"
+
 namespace principia {
 
-double const π = 3.14159265358979323846264338327950288419716939937511;
-double const e = 2.71828182845904523536028747135266249775724709369996;
+CONSTEXPR double const π = 3.14159265358979323846264338327950288419716939937511;
+CONSTEXPR double const e = 2.71828182845904523536028747135266249775724709369996;
 
 }  // namespace principia
@@ -5,6 +5,7 @@
 #include <limits>
 #include <string>
 
+#include "base/macros.hpp"
 #include "base/not_null.hpp"
 #include "serialization/quantities.pb.h"
 
@@ -63,31 +64,34 @@ using SquareRoot = typename type_generators::SquareRootGenerator<Q>::ResultType;
 // Returns the base or derived SI Unit of |Q|.
 // For instance, |SIUnit<Action>() == Joule * Second|.
 template<typename Q>
-Q SIUnit();
+CONSTEXPR Q SIUnit();
 // Returns 1.
 template<>
-double SIUnit<double>();
+CONSTEXPR double SIUnit<double>();
 
 template<typename LDimensions, typename RDimensions>
-Product<Quantity<LDimensions>, Quantity<RDimensions>> operator*(
+CONSTEXPR Product<Quantity<LDimensions>, Quantity<RDimensions>> operator*(
     Quantity<LDimensions> const&,
     Quantity<RDimensions> const&);
 template<typename LDimensions, typename RDimensions>
-Quotient<Quantity<LDimensions>, Quantity<RDimensions>> operator/(
+CONSTEXPR Quotient<Quantity<LDimensions>, Quantity<RDimensions>> operator/(
     Quantity<LDimensions> const&,
     Quantity<RDimensions> const&);
 template<typename RDimensions>
-Quantity<RDimensions> operator*(double const, Quantity<RDimensions> const&);
+CONSTEXPR Quantity<RDimensions> operator*(double const,
+                                          Quantity<RDimensions> const&);
 template<typename RDimensions>
-typename Quantity<RDimensions>::Inverse operator/(double const,
-                                                  Quantity<RDimensions> const&);
+CONSTEXPR typename Quantity<RDimensions>::Inverse operator/(
+    double const,
+    Quantity<RDimensions> const&);
 
 // Equivalent to |std::pow(x, exponent)| unless -3 ≤ x ≤ 3, in which case
-// explicit specialization yields multiplications statically.
+// explicit specialization yields multiplications statically, which may be
+// evaluated at compile time.
 template<int exponent>
 double Pow(double x);
 template<int exponent, typename D>
-Exponentiation<Quantity<D>, exponent> Pow(Quantity<D> const& x);
+CONSTEXPR Exponentiation<Quantity<D>, exponent> Pow(Quantity<D> const& x);
 
 template<typename D>
 std::ostream& operator<<(std::ostream& out, Quantity<D> const& quantity);
@@ -117,57 +121,58 @@ class Quantity {
   using Dimensions = D;
   using Inverse = Quotient<double, Quantity>;
 
-  Quantity();
+  CONSTEXPR Quantity();
   ~Quantity() = default;
 
-  Quantity operator+() const;
-  Quantity operator-() const;
-  Quantity operator+(Quantity const& right) const;
-  Quantity operator-(Quantity const& right) const;
+  CONSTEXPR Quantity operator+() const;
+  CONSTEXPR Quantity operator-() const;
+  CONSTEXPR Quantity operator+(Quantity const& right) const;
+  CONSTEXPR Quantity operator-(Quantity const& right) const;
 
-  Quantity operator*(double const right) const;
-  Quantity operator/(double const right) const;
+  CONSTEXPR Quantity operator*(double const right) const;
+  CONSTEXPR Quantity operator/(double const right) const;
 
   Quantity& operator+=(Quantity const&);
   Quantity& operator-=(Quantity const&);
   Quantity& operator*=(double const);
   Quantity& operator/=(double const);
 
-  bool operator>(Quantity const& right) const;
-  bool operator<(Quantity const& right) const;
-  bool operator>=(Quantity const& right) const;
-  bool operator<=(Quantity const& right) const;
-  bool operator==(Quantity const& right) const;
-  bool operator!=(Quantity const& right) const;
+  CONSTEXPR bool operator>(Quantity const& right) const;
+  CONSTEXPR bool operator<(Quantity const& right) const;
+  CONSTEXPR bool operator>=(Quantity const& right) const;
+  CONSTEXPR bool operator<=(Quantity const& right) const;
+  CONSTEXPR bool operator==(Quantity const& right) const;
+  CONSTEXPR bool operator!=(Quantity const& right) const;
 
   void WriteToMessage(not_null<serialization::Quantity*> const message) const;
   static Quantity ReadFromMessage(serialization::Quantity const& message);
 
  private:
-  explicit Quantity(double const magnitude);
+  explicit CONSTEXPR Quantity(double const magnitude);
   double magnitude_;
 
   template<typename LDimensions, typename RDimensions>
-  friend Product<Quantity<LDimensions>, Quantity<RDimensions>> operator*(
-      Quantity<LDimensions> const& left,
-      Quantity<RDimensions> const& right);
+  friend CONSTEXPR Product<Quantity<LDimensions>, Quantity<RDimensions>>
+  operator*(Quantity<LDimensions> const& left,
+            Quantity<RDimensions> const& right);
   template<typename LDimensions, typename RDimensions>
-  friend Quotient<Quantity<LDimensions>, Quantity<RDimensions>> operator/(
-      Quantity<LDimensions> const& left,
-      Quantity<RDimensions> const& right);
+  friend CONSTEXPR Quotient<Quantity<LDimensions>, Quantity<RDimensions>>
+  operator/(Quantity<LDimensions> const& left,
+            Quantity<RDimensions> const& right);
   template<typename RDimensions>
-  friend Quantity<RDimensions> operator*(double const left,
-                                         Quantity<RDimensions> const& right);
+  friend CONSTEXPR Quantity<RDimensions> operator*(
+      double const left,
+      Quantity<RDimensions> const& right);
   template<typename RDimensions>
-  friend typename Quantity<RDimensions>::Inverse operator/(
+  friend CONSTEXPR typename Quantity<RDimensions>::Inverse operator/(
       double const left,
       Quantity<RDimensions> const& right);
 
   template<typename Q>
-  friend Q SIUnit();
+  friend CONSTEXPR Q SIUnit();
 
   template<int exponent, typename BaseDimensions>
-  friend Exponentiation<Quantity<BaseDimensions>, exponent> Pow(
+  friend CONSTEXPR Exponentiation<Quantity<BaseDimensions>, exponent> Pow(
       Quantity<BaseDimensions> const& x);
 
   friend Quantity<D> Abs<>(Quantity<D> const&);
@@ -175,10 +175,11 @@ struct PowerGenerator<Q, Exponent, Range<(Exponent == 1)>>{
 }  // namespace type_generators
 
 template<typename D>
-inline Quantity<D>::Quantity() : magnitude_(0) {}
+inline CONSTEXPR Quantity<D>::Quantity() : magnitude_(0) {}
 
 template<typename D>
-inline Quantity<D>::Quantity(double const magnitude) : magnitude_(magnitude) {}
+inline CONSTEXPR Quantity<D>::Quantity(double const magnitude)
+    : magnitude_(magnitude) {}
 
 template<typename D>
 inline Quantity<D>& Quantity<D>::operator+=(Quantity const& right) {
@@ -207,54 +208,62 @@ inline Quantity<D>& Quantity<D>::operator/=(double const right) {
 // Additive group
 
 template<typename D>
-inline Quantity<D> Quantity<D>::operator+() const {
+inline CONSTEXPR Quantity<D> Quantity<D>::operator+() const {
   return *this;
 }
 
 template<typename D>
-inline Quantity<D> Quantity<D>::operator-() const {
+inline CONSTEXPR Quantity<D> Quantity<D>::operator-() const {
   return Quantity(-magnitude_);
 }
 
 template<typename D>
-inline Quantity<D> Quantity<D>::operator+(Quantity const& right) const {
+inline CONSTEXPR Quantity<D> Quantity<D>::operator+(
+    Quantity const& right) const {
   return Quantity(magnitude_ + right.magnitude_);
 }
 
 template<typename D>
-inline Quantity<D> Quantity<D>::operator-(Quantity const& right) const {
+inline CONSTEXPR Quantity<D> Quantity<D>::operator-(
+    Quantity const& right) const {
   return Quantity(magnitude_ - right.magnitude_);
 }
 
 // Comparison operators
 
 template<typename D>
-inline bool Quantity<D>::operator>(Quantity const& right) const {
+inline CONSTEXPR bool Quantity<D>::operator>(
+    Quantity const& right) const {
   return magnitude_ > right.magnitude_;
 }
 
 template<typename D>
-inline bool Quantity<D>::operator<(Quantity const& right) const {
+inline CONSTEXPR bool Quantity<D>::operator<(
+    Quantity const& right) const {
   return magnitude_ < right.magnitude_;
 }
 
 template<typename D>
-inline bool Quantity<D>::operator>=(Quantity const& right) const {
+inline CONSTEXPR bool Quantity<D>::operator>=(
+    Quantity const& right) const {
   return magnitude_ >= right.magnitude_;
 }
 
 template<typename D>
-inline bool Quantity<D>::operator<=(Quantity const& right) const {
+inline CONSTEXPR bool Quantity<D>::operator<=(
+    Quantity const& right) const {
   return magnitude_ <= right.magnitude_;
 }
 
 template<typename D>
-inline bool Quantity<D>::operator==(Quantity const& right) const {
+inline CONSTEXPR bool Quantity<D>::operator==(
+    Quantity const& right) const {
   return magnitude_ == right.magnitude_;
 }
 
 template<typename D>
-inline bool Quantity<D>::operator!=(Quantity const& right) const {
+inline CONSTEXPR bool Quantity<D>::operator!=(
+    Quantity const& right) const {
   return magnitude_ != right.magnitude_;
 }
 
@@ -275,17 +284,18 @@ Quantity<D> Quantity<D>::ReadFromMessage(
 // Multiplicative group
 
 template<typename D>
-inline Quantity<D> Quantity<D>::operator/(double const right) const {
+inline CONSTEXPR Quantity<D> Quantity<D>::operator/(double const right) const {
   return Quantity(magnitude_ / right);
 }
 
 template<typename D>
-inline Quantity<D> Quantity<D>::operator*(double const right) const {
+inline CONSTEXPR Quantity<D> Quantity<D>::operator*(double const right) const {
   return Quantity(magnitude_ * right);
 }
 
 template<typename LDimensions, typename RDimensions>
-inline Product<Quantity<LDimensions>, Quantity<RDimensions>> operator*(
+inline CONSTEXPR Product<Quantity<LDimensions>, Quantity<RDimensions>>
+operator*(
     Quantity<LDimensions> const& left,
     Quantity<RDimensions> const& right) {
   return Product<Quantity<LDimensions>,
@@ -293,7 +303,8 @@ inline Product<Quantity<LDimensions>, Quantity<RDimensions>> operator*(
 }
 
 template<typename LDimensions, typename RDimensions>
-inline Quotient<Quantity<LDimensions>, Quantity<RDimensions>> operator/(
+inline CONSTEXPR Quotient<Quantity<LDimensions>, Quantity<RDimensions>>
+operator/(
     Quantity<LDimensions> const& left,
     Quantity<RDimensions> const& right) {
   return Quotient<Quantity<LDimensions>,
@@ -301,13 +312,14 @@ inline Quotient<Quantity<LDimensions>, Quantity<RDimensions>> operator/(
 }
 
 template<typename RDimensions>
-inline Quantity<RDimensions> operator*(double const left,
-                                       Quantity<RDimensions> const& right) {
+inline CONSTEXPR Quantity<RDimensions> operator*(
+    double const left,
+    Quantity<RDimensions> const& right) {
   return Quantity<RDimensions>(left * right.magnitude_);
 }
 
 template<typename RDimensions>
-inline typename Quantity<RDimensions>::Inverse operator/(
+inline CONSTEXPR typename Quantity<RDimensions>::Inverse operator/(
     double const left,
     Quantity<RDimensions> const& right) {
   return typename Quantity<RDimensions>::Inverse(left / right.magnitude_);
@@ -322,43 +334,43 @@ inline double Pow(double x) {
 // turned into multiplications at compile time.
 
 template<>
-inline double Pow<-3>(double x) {
+inline CONSTEXPR double Pow<-3>(double x) {
   return 1 / (x * x * x);
 }
 
 template<>
-inline double Pow<-2>(double x) {
+inline CONSTEXPR double Pow<-2>(double x) {
   return 1 / (x * x);
 }
 
 template<>
-inline double Pow<-1>(double x) {
+inline CONSTEXPR double Pow<-1>(double x) {
   return 1 / x;
 }
 
 template<>
-inline double Pow<0>(double x) {
+inline CONSTEXPR double Pow<0>(double x) {
   return 1;
 }
 
 template<>
-inline double Pow<1>(double x) {
+inline CONSTEXPR double Pow<1>(double x) {
   return x;
 }
 
 template<>
-inline double Pow<2>(double x) {
+inline CONSTEXPR double Pow<2>(double x) {
   return x * x;
 }
 
 template<>
-inline double Pow<3>(double x) {
+inline CONSTEXPR double Pow<3>(double x) {
   return x * x * x;
 }
 
 
 template<int exponent, typename D>
-Exponentiation<Quantity<D>, exponent> Pow(
+CONSTEXPR Exponentiation<Quantity<D>, exponent> Pow(
     Quantity<D> const& x) {
   return Exponentiation<Quantity<D>, exponent>(
       Pow<exponent>(x.magnitude_));
@@ -375,12 +387,12 @@ Quantity<D> Abs(Quantity<D> const& quantity) {
 
 
 template<typename Q>
-inline Q SIUnit() {
+inline CONSTEXPR Q SIUnit() {
   return Q(1);
 }
 
 template<>
-inline double SIUnit<double>() {
+inline CONSTEXPR double SIUnit<double>() {
   return 1;
 }
 
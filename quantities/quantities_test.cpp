@@ -1,5 +1,8 @@
 ﻿
+#include <cmath>
+#include <limits>
 #include <string>
+#include <vector>
 
 #include "glog/logging.h"
 #include "gtest/gtest.h"
@@ -214,6 +217,48 @@ TEST_F(QuantitiesTest, ExpLogAndSqrt) {
   EXPECT_EQ(std::exp(std::log(Rood / Pow<2>(Foot)) / 2) * Foot, Sqrt(Rood));
 }
 
+TEST_F(QuantitiesTest, InverseSqrt) {
+  for (double const x : {1E-300, 1E-40, 0.5, 2.0, 3.0, 1E30, 1E300}) {
+    EXPECT_EQ(1 / Sqrt(x), InverseSqrt(x));
+    EXPECT_THAT(InverseSqrt<InverseSqrtPrecision::kFast>(x),
+                AlmostEquals(1 / Sqrt(x), 0, 2)) << x;
+  }
+  EXPECT_EQ(1 / Sqrt(Rood), InverseSqrt(Rood));
+  EXPECT_THAT(InverseSqrt<InverseSqrtPrecision::kFast>(Rood),
+              AlmostEquals(1 / Sqrt(Rood), 0, 2));
+  EXPECT_EQ(std::numeric_limits<double>::infinity(),
+            InverseSqrt<InverseSqrtPrecision::kFast>(0.0));
+}
+
+TEST_F(QuantitiesTest, BatchedFunctions) {
+  // Not a multiple of the vector size, and the last angle is not reducible.
+  std::vector<Angle> const angles = {0 * Radian, -0.0 * Radian, 1E-10 * Radian,
+                                     0.5 * Radian, π / 2 * Radian, 3 * Radian,
+                                     -4 * Radian, 1E3 * Radian, -1E5 * Radian,
+                                     1E10 * Radian};
+  std::vector<double> sines;
+  std::vector<double> cosines;
+  Sin(angles, &sines);
+  Cos(angles, &cosines);
+  ASSERT_EQ(angles.size(), sines.size());
+  ASSERT_EQ(angles.size(), cosines.size());
+  for (std::size_t i = 0; i < angles.size(); ++i) {
+    EXPECT_THAT(sines[i], AlmostEquals(Sin(angles[i]), 0, 2)) << angles[i];
+    EXPECT_THAT(cosines[i], AlmostEquals(Cos(angles[i]), 0, 2)) << angles[i];
+  }
+  EXPECT_TRUE(std::signbit(sines[1]));
+  EXPECT_EQ(Sin(angles.back()), sines.back());
+
+  std::vector<Area> const areas = {0 * Rood, 1 * Rood, 2 * Rood, 3 * Rood,
+                                   4 * Rood, 5 * Rood};
+  std::vector<Length> lengths;
+  Sqrt(areas, &lengths);
+  ASSERT_EQ(areas.size(), lengths.size());
+  for (std::size_t i = 0; i < areas.size(); ++i) {
+    EXPECT_EQ(Sqrt(areas[i]), lengths[i]);
+  }
+}
+
 TEST_F(QuantitiesDeathTest, SerializationError) {
   EXPECT_DEATH({
     serialization::Quantity message;
@@ -1,12 +1,13 @@
 ﻿#pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
 #include "quantities/quantities.hpp"
 
 // Various statistics on finite populations stored as |std::vector|s of
-// |Quantity| or |Dimensionless|.
+// |Quantity| or |Dimensionless|, or accumulated in a single pass.
 
 namespace principia {
 namespace testing_utilities {
@@ -62,6 +63,69 @@ template<typename T, typename U>
 std::string BidimensionalDatasetMathematicaInput(std::vector<T> const& x,
                                                  std::vector<U> const& y);
 
+// Accumulates the mean and variance of a population in a single pass and in
+// O(1) memory, using Welford's algorithm, which doesn't suffer from the
+// cancellations of the computation from the sums of x and x².  The results
+// are those of the functions above on the population of the values passed to
+// |Add|, up to rounding.  Not thread-safe, but the accumulators of disjoint
+// parts of a population, e.g., filled by different threads, may be combined
+// with |Merge|.
+template<typename T>
+class RunningStatistics {
+ public:
+  RunningStatistics();
+
+  void Add(T const& x);
+
+  // Adds to this object the values that were added to |other|.
+  void Merge(RunningStatistics const& other);
+
+  // The number of values added.
+  std::int64_t count() const;
+
+  // The functions below must not be called if |count()| is 0.
+  T Mean() const;
+  quantities::Product<T, T> Variance() const;
+  T StandardDeviation() const;
+
+ private:
+  std::int64_t count_;
+  T mean_;
+  // The sum of the squares of the differences to the mean.
+  quantities::Product<T, T> m2_;
+
+  template<typename, typename>
+  friend class RunningBivariateStatistics;
+};
+
+// Same as above for a population of pairs (x, y), with the statistics of
+// their correlation.
+template<typename T, typename U>
+class RunningBivariateStatistics {
+ public:
+  RunningBivariateStatistics();
+
+  void Add(T const& x, U const& y);
+  void Merge(RunningBivariateStatistics const& other);
+
+  std::int64_t count() const;
+
+  // The statistics of the x and of the y.
+  RunningStatistics<T> const& x() const;
+  RunningStatistics<U> const& y() const;
+
+  // The functions below must not be called if |count()| is 0.
+  quantities::Product<T, U> Covariance() const;
+  double PearsonProductMomentCorrelationCoefficient() const;
+  quantities::Quotient<U, T> Slope() const;
+
+ private:
+  RunningStatistics<T> x_;
+  RunningStatistics<U> y_;
+  // The sum of the products of the differences to the means.
+  quantities::Product<T, U> c_;
+};
+
 }  // namespace testing_utilities
 }  // namespace principia
 
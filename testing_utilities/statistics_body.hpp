@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -77,5 +78,112 @@ std::string BidimensionalDatasetMathematicaInput(std::vector<T> const& x,
   return result;
 }
 
+template<typename T>
+RunningStatistics<T>::RunningStatistics()
+    : count_(0),
+      mean_(0 * quantities::SIUnit<T>()),
+      m2_(0 * quantities::SIUnit<quantities::Product<T, T>>()) {}
+
+template<typename T>
+void RunningStatistics<T>::Add(T const& x) {
+  ++count_;
+  T const δ = x - mean_;
+  mean_ += δ / static_cast<double>(count_);
+  m2_ += δ * (x - mean_);
+}
+
+template<typename T>
+void RunningStatistics<T>::Merge(RunningStatistics const& other) {
+  if (other.count_ == 0) {
+    return;
+  }
+  double const total = static_cast<double>(count_ + other.count_);
+  double const other_weight = other.count_ / total;
+  T const δ = other.mean_ - mean_;
+  mean_ += δ * other_weight;
+  m2_ += other.m2_ + δ * δ * (count_ * other_weight);
+  count_ += other.count_;
+}
+
+template<typename T>
+std::int64_t RunningStatistics<T>::count() const {
+  return count_;
+}
+
+template<typename T>
+T RunningStatistics<T>::Mean() const {
+  return mean_;
+}
+
+template<typename T>
+quantities::Product<T, T> RunningStatistics<T>::Variance() const {
+  return m2_ / static_cast<double>(count_);
+}
+
+template<typename T>
+T RunningStatistics<T>::StandardDeviation() const {
+  return quantities::Sqrt(Variance());
+}
+
+template<typename T, typename U>
+RunningBivariateStatistics<T, U>::RunningBivariateStatistics()
+    : c_(0 * quantities::SIUnit<quantities::Product<T, U>>()) {}
+
+template<typename T, typename U>
+void RunningBivariateStatistics<T, U>::Add(T const& x, U const& y) {
+  // The difference to the mean of the x before the update and that to the
+  // mean of the y after the update.
+  T const δx = x - x_.mean_;
+  x_.Add(x);
+  y_.Add(y);
+  c_ += δx * (y - y_.mean_);
+}
+
+template<typename T, typename U>
+void RunningBivariateStatistics<T, U>::Merge(
+    RunningBivariateStatistics const& other) {
+  if (other.count() == 0) {
+    return;
+  }
+  double const total = static_cast<double>(count() + other.count());
+  T const δx = other.x_.mean_ - x_.mean_;
+  U const δy = other.y_.mean_ - y_.mean_;
+  c_ += other.c_ + δx * δy * (count() * (other.count() / total));
+  x_.Merge(other.x_);
+  y_.Merge(other.y_);
+}
+
+template<typename T, typename U>
+std::int64_t RunningBivariateStatistics<T, U>::count() const {
+  return x_.count();
+}
+
+template<typename T, typename U>
+RunningStatistics<T> const& RunningBivariateStatistics<T, U>::x() const {
+  return x_;
+}
+
+template<typename T, typename U>
+RunningStatistics<U> const& RunningBivariateStatistics<T, U>::y() const {
+  return y_;
+}
+
+template<typename T, typename U>
+quantities::Product<T, U> RunningBivariateStatistics<T, U>::Covariance()
+    const {
+  return c_ / static_cast<double>(count());
+}
+
+template<typename T, typename U>
+double RunningBivariateStatistics<T, U>::
+    PearsonProductMomentCorrelationCoefficient() const {
+  return Covariance() / (x_.StandardDeviation() * y_.StandardDeviation());
+}
+
+template<typename T, typename U>
+quantities::Quotient<U, T> RunningBivariateStatistics<T, U>::Slope() const {
+  return Covariance() / x_.Variance();
+}
+
 }  // namespace testing_utilities
 }  // namespace principia
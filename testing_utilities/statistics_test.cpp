@@ -1,5 +1,6 @@
 #include "testing_utilities/statistics.hpp"
 
+#include <cmath>
 #include <vector>
 
 #include "gmock/gmock.h"
@@ -17,6 +18,7 @@ using quantities::Time;
 using si::Metre;
 using si::Second;
 using testing::Eq;
+using testing::Lt;
 
 class StatisticsTest : public testing::Test {
  protected:
@@ -64,5 +66,43 @@ TEST_F(StatisticsTest, NegativelyCorrelated) {
               AlmostEquals(-0.5, 1));
 }
 
+// The running statistics agree with those of the complete population, also
+// when they are accumulated in parts that are then merged.
+TEST_F(StatisticsTest, Running) {
+  RunningStatistics<Length> running_x;
+  RunningBivariateStatistics<Time, Length> running_t_x;
+  RunningBivariateStatistics<Time, Length> first_part;
+  RunningBivariateStatistics<Time, Length> second_part;
+  for (std::size_t i = 0; i < population_size_; ++i) {
+    running_x.Add(x_[i]);
+    running_t_x.Add(t_[i], x_[i]);
+    (i < 37 ? first_part : second_part).Add(t_[i], x_[i]);
+  }
+  first_part.Merge(second_part);
+  EXPECT_EQ(population_size_, running_x.count());
+  EXPECT_EQ(population_size_, first_part.count());
+  EXPECT_THAT(running_x.Mean(), AlmostEquals(Mean(x_), 0, 4));
+  EXPECT_THAT(running_x.Variance(), AlmostEquals(Variance(x_), 0, 4));
+  EXPECT_THAT(running_x.StandardDeviation(),
+              AlmostEquals(StandardDeviation(x_), 0, 4));
+  for (auto const* const running : {&running_t_x, &first_part}) {
+    EXPECT_THAT(running->x().Mean(), AlmostEquals(Mean(t_), 0, 4));
+    EXPECT_THAT(running->y().Variance(), AlmostEquals(Variance(x_), 0, 4));
+    EXPECT_THAT(running->Covariance(), AlmostEquals(Covariance(t_, x_), 0, 4));
+    EXPECT_THAT(running->PearsonProductMomentCorrelationCoefficient(),
+                AlmostEquals(1, 0, 4));
+    EXPECT_THAT(running->Slope(), AlmostEquals(v_, 0, 4));
+  }
+
+  RunningBivariateStatistics<Time, Length> uncorrelated;
+  uncorrelated.Add(0 * Second, 0 * Metre);
+  uncorrelated.Add(1 * Second, 0 * Metre);
+  uncorrelated.Add(1 * Second, 1 * Metre);
+  uncorrelated.Add(0 * Second, 1 * Metre);
+  EXPECT_THAT(
+      std::abs(uncorrelated.PearsonProductMomentCorrelationCoefficient()),
+      Lt(1E-15));
+}
+
 }  // namespace testing_utilities
 }  // namespace principia
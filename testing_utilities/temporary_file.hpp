@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+namespace principia {
+namespace testing_utilities {
+
+// Returns the name of a file in the temporary directory of the system, made of
+// the names of the current test case and test and of |suffix|, so that tests
+// running concurrently, possibly in different processes, don't share files,
+// and that the files left by an aborted test don't clutter the working
+// directory.  Must be called while a test is running, e.g., in the constructor
+// of a fixture.  The file is not created.
+std::string TemporaryFilename(std::string const& suffix);
+
+}  // namespace testing_utilities
+}  // namespace principia
+
+#include "testing_utilities/temporary_file_body.hpp"
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "testing_utilities/temporary_file.hpp"
+
+#include <cstdlib>
+#include <string>
+
+#include "base/macros.hpp"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace principia {
+namespace testing_utilities {
+
+inline std::string TemporaryFilename(std::string const& suffix) {
+  testing::TestInfo const* const test_info =
+      testing::UnitTest::GetInstance()->current_test_info();
+  CHECK_NOTNULL(test_info);
+#if OS_WIN
+  char const* directory = std::getenv("TEMP");
+  if (directory == nullptr) {
+    directory = std::getenv("TMP");
+  }
+  if (directory == nullptr) {
+    directory = ".";
+  }
+  char const separator = '\\';
+#else
+  char const* directory = std::getenv("TMPDIR");
+  if (directory == nullptr) {
+    directory = "/tmp";
+  }
+  char const separator = '/';
+#endif
+  // The names of the parameterized tests contain slashes.
+  std::string name = std::string(test_info->test_case_name()) + "." +
+                     test_info->name() + "." + suffix;
+  for (char& c : name) {
+    if (c == '/' || c == '\\') {
+      c = '_';
+    }
+  }
+  return std::string(directory) + separator + name;
+}
+
+}  // namespace testing_utilities
+}  // namespace principia